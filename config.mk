@@ -0,0 +1,126 @@
+# Automatically generated by ./configure
+# Command line: --with-system-malloc
+CONFIGURE_STATUS := started
+CONFIGURE_ERROR := 
+CONFIGURE_COMMAND_LINE :=  --with-system-malloc
+CONFIGURE_MAGIC_NUMBER := 2
+# Bash
+FETCH_LIST := 
+FETCH_VERSIONS := 
+LIB_SEARCH_PATHS := 
+# Use ccache
+USE_CCACHE := 0
+# C++ Compiler
+COMPILER := GCC
+CXX := /usr/bin/c++
+# Host System
+MACHINE := x86_64-linux-gnu
+# Build System
+# Cross-compiling
+CROSS_COMPILING := 0
+# Host Operating System
+OS := Linux
+PTHREAD_LIBS := -pthread
+RT_LIBS := -lrt
+M_LIBS := -lm
+# Build Architecture
+GCC_ARCH := x86_64
+GCC_ARCH_REDUCED := x86_64
+# C++11
+CXX11_LIBS += 
+HAS_CXX11 := 1
+# Protobuf compiler
+PROTOC := /usr/bin/protoc
+PROTOC_BIN_DEP := 
+# python
+PYTHON := /root/.pyenv/shims/python
+PYTHON_BIN_DEP := 
+# Google Test
+FETCH_LIST += gtest
+gtest_VERSION := 1.7.0
+gtest_DEPENDS := 
+gtest_LIB_NAME += GTEST
+HAS_GTEST := 1
+GTEST_LIBS_DEP = $(SUPPORT_BUILD_DIR)/gtest_1.7.0/lib/libgtest.a
+GTEST_INCLUDE = -isystem $(SUPPORT_BUILD_DIR)/gtest_1.7.0/include
+GTEST_INCLUDE_DEP = $(SUPPORT_BUILD_DIR)/gtest_1.7.0/include
+# termcap
+TERMCAP_LIBS += -ltermcap
+HAS_TERMCAP := 1
+HAS_TERMCAP := 1
+TERMCAP_INCLUDE := 
+TERMCAP_INCLUDE_DEP := 
+TERMCAP_LIBS_DEP := 
+# boost_system
+BOOST_SYSTEM_LIBS += -lboost_system
+HAS_BOOST_SYSTEM := 1
+HAS_BOOST_SYSTEM := 1
+BOOST_SYSTEM_INCLUDE := 
+BOOST_SYSTEM_INCLUDE_DEP := 
+BOOST_SYSTEM_LIBS_DEP := 
+# protobuf
+PROTOBUF_LIBS += -lprotobuf
+HAS_PROTOBUF := 1
+HAS_PROTOBUF := 1
+PROTOBUF_INCLUDE := 
+PROTOBUF_INCLUDE_DEP := 
+PROTOBUF_LIBS_DEP := 
+# RE2
+FETCH_LIST += re2
+re2_VERSION := 2015-11-01
+re2_DEPENDS := 
+re2_LIB_NAME += RE2
+HAS_RE2 := 1
+RE2_LIBS_DEP = $(SUPPORT_BUILD_DIR)/re2_2015-11-01/lib/libre2.a
+RE2_INCLUDE = -isystem $(SUPPORT_BUILD_DIR)/re2_2015-11-01/include
+RE2_INCLUDE_DEP = $(SUPPORT_BUILD_DIR)/re2_2015-11-01/include
+# z
+Z_LIBS += -lz
+HAS_Z := 1
+HAS_Z := 1
+Z_INCLUDE := 
+Z_INCLUDE_DEP := 
+Z_LIBS_DEP := 
+# crypto
+CRYPTO_LIBS += -lcrypto
+HAS_CRYPTO := 1
+HAS_CRYPTO := 1
+CRYPTO_INCLUDE := 
+CRYPTO_INCLUDE_DEP := 
+CRYPTO_LIBS_DEP := 
+# ssl
+SSL_LIBS += -lssl
+HAS_SSL := 1
+HAS_SSL := 1
+SSL_INCLUDE := 
+SSL_INCLUDE_DEP := 
+SSL_LIBS_DEP := 
+# curl
+CURL_LIBS += -lcurl
+HAS_CURL := 1
+HAS_CURL := 1
+CURL_INCLUDE := 
+CURL_INCLUDE_DEP := 
+CURL_LIBS_DEP := 
+# malloc
+ALLOCATOR := system
+DEFAULT_ALLOCATOR := jemalloc
+MALLOC_LIBS := 
+MALLOC_LIBS_DEP := 
+STATIC_MALLOC := 0
+# Test protobuf
+# Test boost
+BOOST_LIBS += 
+HAS_BOOST := 1
+HAS_BOOST := 1
+BOOST_INCLUDE := 
+BOOST_INCLUDE_DEP := 
+BOOST_LIBS_DEP := 
+ALLOW_FETCH := 0
+# Installation prefix
+PREFIX := /usr/local
+# Configuration prefix
+SYSCONFDIR := /usr/local/etc
+# Runtime data prefix
+LOCALSTATEDIR := /usr/local/var
+CONFIGURE_STATUS := success
@@ -0,0 +1 @@
+allowed-variables := CONFIG DEFAULT_GOAL IGNORE_MAKEFILE_CHANGES SHOW_COUNTDOWN VERBOSE STATIC VANILLA_PACKAGE_NAME SERVER_EXEC_NAME SYMBOLS SPLIT_SYMBOLS DEBUG UNIT_TESTS VALGRIND BUILD_DIR DESTDIR MAKE_VARIABLE_CHECK COVERAGE GENHTML STRIP_ON_INSTALL PVERSION PVERSION NAMEVERSIONED UBUNTU_RELEASE DEB_RELEASE SHOW_BUILD_REASON RQL_ERROR_BT FULL_PERFMON CORO_PROFILING SIGN_PACKAGE PACKAGE_BUILD_NUMBER THREADED_COROUTINES REQUIRE_SIGNED OSX_SIGNATURE_NAME DIST_CONFIGURE_DEFAULT UGLIFY VERIFY_FETCH_HASH STATIC_LIBGCC BUILD_PORTABLE LEGACY_LINUX LEGACY_GCC NO_EVENTFD NO_EPOLL
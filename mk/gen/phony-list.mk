@@ -0,0 +1,2 @@
+$(TOP)/mk/gen/phony-list.mk: $(patsubst ./%,$(TOP)/%,$(filter-out %.d, mk/main.mk mk/check-env.mk mk/gen/allowed-variables.mk mk/configure.mk config.mk mk/defaults.mk mk/lib.mk mk/paths.mk mk/support/build.mk mk/install.mk src/build.mk mk/packaging.mk mk/tools.mk))
+PHONY_LIST += default-goal FORCE sense love fetch support fetch-gtest build-gtest clean-gtest shrinkwrap-gtest list-patches-gtest support-gtest support-gtest_1.7.0 clean-gtest_1.7.0 fetch-re2 build-re2 clean-re2 shrinkwrap-re2 list-patches-re2 support-re2 support-re2_2015-11-01 clean-re2_2015-11-01 support-include-gtest support-include-gtest_1.7.0 support-include-re2 support-include-re2_2015-11-01 install-binaries install-manpages install-init install-config install-data install-docs install src/all rebirthdb deps build-clean check-syntax prepare_deb_package_dirs build-deb-src deb-src-dir build-deb install-osx build-osx clean-dist-dir reset-dist-dir dist-dir dist tags etags cscope clean all generate test))
@@ -4,6 +4,7 @@
 #include <string.h>
 
 #include "arch/compiler.hpp"
+#include "arch/runtime/numa.hpp"
 #include "config/args.hpp"
 #include "utils.hpp"
 
@@ -114,6 +115,12 @@ blocker_pool_t::blocker_pool_t(int nthreads, linux_event_queue_t *_queue)
             &blocker_pool_t::event_loop, reinterpret_cast<void*>(this));
         guarantee_xerr(res == 0, res, "Could not create blocker-pool thread.");
 
+        const std::vector<int> &cpus = get_thread_placement().blocker_pool_cpus;
+        if (!cpus.empty()) {
+            guarantee(set_thread_cpus(threads[i], cpus),
+                      "Could not set a blocker-pool thread's CPU affinity.");
+        }
+
         res = pthread_attr_destroy(&attr);
         guarantee_xerr(res == 0, res, "pthread_attr_destroy failed.");
     }
@@ -8,23 +8,29 @@
 #include <sys/socket.h>
 #include <sys/stat.h>
 #include <sys/file.h>
+#include <sys/utsname.h>
 #include <libgen.h>
 #endif
 
 #include <unistd.h>
 #include <limits.h>
+#include <stdio.h>
 
 #include <algorithm>
 #include <functional>
+#include <map>
+#include <utility>
 
 #include "arch/types.hpp"
 #include "arch/runtime/thread_pool.hpp"
 #include "arch/runtime/runtime.hpp"
+#include "arch/io/concurrency.hpp"
 #include "arch/io/disk/filestat.hpp"
 #include "arch/io/disk/pool.hpp"
 #include "arch/io/disk/conflict_resolving.hpp"
 #include "arch/io/disk/stats.hpp"
 #include "arch/io/disk/accounting.hpp"
+#include "arch/io/disk/uring.hpp"
 #include "backtrace.hpp"
 #include "config/args.hpp"
 #include "do_on_thread.hpp"
@@ -55,7 +61,6 @@ public:
         conflict_resolver(stats),
         accounter(batch_factor),
         backend_stats(stats, "backend", accounter.producer),
-        backend(queue, backend_stats.producer, max_concurrent_io_requests),
         outstanding_txn(0)
     {
         /* Hook up the `submit_fun`s of the parts of the IO stack that are above the
@@ -66,8 +71,24 @@ public:
         conflict_resolver.submit_fun = std::bind(&accounting_diskmgr_t::submit,
                                                  &accounter, ph::_1);
 
+        /* Pick the backend. We prefer io_uring, but fall back to the blocker pool on
+        kernels that don't support it. */
+#if USE_IO_URING
+        if (uring_diskmgr_t::is_supported()) {
+            uring_backend.init(new uring_diskmgr_t(queue, backend_stats.producer,
+                                                   max_concurrent_io_requests));
+            uring_backend->done_fun = std::bind(&stats_diskmgr_2_t::done,
+                                                &backend_stats, ph::_1);
+        }
+#endif
+        if (!has_backend()) {
+            pool_backend.init(new pool_diskmgr_t(queue, backend_stats.producer,
+                                                 max_concurrent_io_requests));
+            pool_backend->done_fun = std::bind(&stats_diskmgr_2_t::done,
+                                               &backend_stats, ph::_1);
+        }
+
         /* Hook up everything's `done_fun`. */
-        backend.done_fun = std::bind(&stats_diskmgr_2_t::done, &backend_stats, ph::_1);
         backend_stats.done_fun = std::bind(&accounting_diskmgr_t::done, &accounter, ph::_1);
         accounter.done_fun = std::bind(&conflict_resolving_diskmgr_t::done,
                                        &conflict_resolver, ph::_1);
@@ -81,8 +102,9 @@ public:
                 outstanding_txn);
     }
 
-    void *create_account(int pri, int outstanding_requests_limit) {
-        return new accounting_diskmgr_t::account_t(&accounter, pri, outstanding_requests_limit);
+    void *create_account(int pri, io_caller_t caller, int outstanding_requests_limit) {
+        return new accounting_diskmgr_t::account_t(&accounter, pri, caller,
+                                                   outstanding_requests_limit);
     }
 
     void destroy_account(void *account) {
@@ -193,7 +215,21 @@ private:
     conflict_resolving_diskmgr_t conflict_resolver;
     accounting_diskmgr_t accounter;
     stats_diskmgr_2_t backend_stats;
-    pool_diskmgr_t backend;
+
+    /* Exactly one of these is initialized. */
+#if USE_IO_URING
+    scoped_ptr_t<uring_diskmgr_t> uring_backend;
+#endif
+    scoped_ptr_t<pool_diskmgr_t> pool_backend;
+
+    bool has_backend() const {
+#if USE_IO_URING
+        if (uring_backend.has()) {
+            return true;
+        }
+#endif
+        return pool_backend.has();
+    }
 
 
     intptr_t outstanding_txn;
@@ -204,6 +240,7 @@ private:
 io_backender_t::io_backender_t(file_direct_io_mode_t _direct_io_mode,
                                int max_concurrent_io_requests)
     : direct_io_mode(_direct_io_mode),
+      stats_membership(&get_global_perfmon_collection(), &stats, "disk"),
       diskmgr(new linux_disk_manager_t(&linux_thread_pool_t::get_thread()->queue,
                                        DEFAULT_IO_BATCH_FACTOR,
                                        max_concurrent_io_requests,
@@ -222,7 +259,8 @@ linux_file_t::linux_file_t(scoped_fd_t &&_fd, int64_t _file_size, linux_disk_man
     // file_account_t outside of the thread pool?  But they're associated with the diskmgr,
     // aren't they?)
     if (linux_thread_pool_t::get_thread()) {
-        default_account.init(new file_account_t(this, 1, UNLIMITED_OUTSTANDING_REQUESTS));
+        default_account.init(new file_account_t(this, 1, io_caller_t::other,
+                                                UNLIMITED_OUTSTANDING_REQUESTS));
     }
 }
 
@@ -356,6 +394,20 @@ void linux_file_t::writev_async(int64_t offset, size_t length,
 
 }
 
+void linux_file_t::datasync_async(file_account_t *account,
+                                  linux_iocallback_t *callback) {
+    rassert(diskmgr != nullptr,
+            "No diskmgr has been constructed (are we running without an event queue?)");
+    // The disk managers don't have an action that only syncs, but resizing the file to
+    // the size it already has and syncing afterwards does just that.
+    diskmgr->submit_resize(fd.get(), file_size, file_size,
+                           account == DEFAULT_DISK_ACCOUNT
+                           ? default_account->get_account()
+                           : account->get_account(),
+                           callback,
+                           datasync_op::datasync_after);
+}
+
 bool linux_file_t::coop_lock_and_check() {
 #ifdef _WIN32
     // TODO WINDOWS
@@ -369,9 +421,10 @@ bool linux_file_t::coop_lock_and_check() {
 #endif
 }
 
-void *linux_file_t::create_account(int priority, int outstanding_requests_limit) {
+void *linux_file_t::create_account(int priority, io_caller_t caller,
+                                   int outstanding_requests_limit) {
     assert_thread();
-    return diskmgr->create_account(priority, outstanding_requests_limit);
+    return diskmgr->create_account(priority, caller, outstanding_requests_limit);
 }
 
 void linux_file_t::destroy_account(void *account) {
@@ -635,6 +688,116 @@ int perform_datasync(fd_t fd) {
 #endif  // __MACH__
 }
 
+#ifdef __linux__
+namespace {
+
+// Group commit for the datasyncs of one file.  A datasync that comes in while another
+// one of the same file is running waits for it to finish and then runs one more on
+// behalf of everybody who queued up meanwhile, so N concurrent metablock writes to
+// one file cost two syncs instead of N.
+//
+// Files that use direct I/O on a kernel whose `syncfs` reports writeback errors
+// share one group per filesystem, which runs `syncfs` instead.  With buffered I/O
+// that would flush unrelated dirty data, and older kernels silently drop the errors.
+class sync_group_t {
+public:
+    explicit sync_group_t(bool _whole_filesystem)
+        : whole_filesystem(_whole_filesystem), started_(0), completed_(0),
+          running_(false), last_errsv_(0) { }
+
+    int sync(fd_t fd) {
+        system_mutex_t::lock_t lock(&mutex_);
+        // We need a sync that starts after we got here; one that's already running
+        // might miss writes that completed just before we were called.
+        const uint64_t needed = started_ + 1;
+        while (completed_ < needed) {
+            if (running_) {
+                cond_.wait(&mutex_);
+                continue;
+            }
+            running_ = true;
+            const uint64_t generation = ++started_;
+            lock.unlock();
+
+            int errsv;
+            if (whole_filesystem) {
+                int res;
+                do {
+                    res = syncfs(fd);
+                } while (res == -1 && get_errno() == EINTR);
+                errsv = res == -1 ? get_errno() : 0;
+            } else {
+                errsv = perform_datasync(fd);
+            }
+
+            system_mutex_t::lock_t relock(&mutex_);
+            completed_ = generation;
+            last_errsv_ = errsv;
+            running_ = false;
+            cond_.broadcast();
+            return errsv;
+        }
+        return last_errsv_;
+    }
+
+private:
+    const bool whole_filesystem;
+    system_mutex_t mutex_;
+    system_cond_t cond_;
+    uint64_t started_;
+    uint64_t completed_;
+    bool running_;
+    // The result of the sync with generation `completed_`.
+    int last_errsv_;
+
+    DISABLE_COPYING(sync_group_t);
+};
+
+// Linux reports writeback errors from `syncfs` since 5.8.
+bool syncfs_reports_errors() {
+    static const bool reports_errors = []() {
+        struct utsname name;
+        int major, minor;
+        if (uname(&name) != 0 || sscanf(name.release, "%d.%d", &major, &minor) != 2) {
+            return false;
+        }
+        return major > 5 || (major == 5 && minor >= 8);
+    }();
+    return reports_errors;
+}
+
+system_mutex_t sync_groups_mutex;
+// Keyed by device and inode, with an inode of 0 for the group of a whole filesystem.
+// Never shrinks; there's one entry per file or filesystem we've ever synced.
+std::map<std::pair<dev_t, ino_t>, sync_group_t *> sync_groups;
+
+sync_group_t *get_sync_group(dev_t dev, ino_t ino) {
+    system_mutex_t::lock_t lock(&sync_groups_mutex);
+    sync_group_t *&group = sync_groups[std::make_pair(dev, ino)];
+    if (group == nullptr) {
+        group = new sync_group_t(ino == 0);
+    }
+    return group;
+}
+
+}  // namespace
+#endif  // __linux__
+
+int perform_group_datasync(fd_t fd) {
+#ifdef __linux__
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        return perform_datasync(fd);
+    }
+    const int flags = fcntl(fd, F_GETFL);
+    const bool whole_filesystem =
+        flags != -1 && (flags & O_DIRECT) != 0 && syncfs_reports_errors();
+    return get_sync_group(st.st_dev, whole_filesystem ? 0 : st.st_ino)->sync(fd);
+#else
+    return perform_datasync(fd);
+#endif
+}
+
 MUST_USE int fsync_parent_directory(const char *path) {
     // Locate the parent directory
 #ifdef _WIN32
@@ -37,6 +37,7 @@ public:
 protected:
     const file_direct_io_mode_t direct_io_mode;
     perfmon_collection_t stats;
+    perfmon_membership_t stats_membership;
     scoped_ptr_t<linux_disk_manager_t> diskmgr;
 
 private:
@@ -83,9 +84,12 @@ public:
     void writev_async(int64_t offset, size_t length, scoped_array_t<iovec> &&bufs,
                       file_account_t *account, linux_iocallback_t *cb);
 
+    void datasync_async(file_account_t *account, linux_iocallback_t *cb);
+
     bool coop_lock_and_check();
 
-    void *create_account(int priority, int outstanding_requests_limit);
+    void *create_account(int priority, io_caller_t caller,
+                         int outstanding_requests_limit);
     void destroy_account(void *account);
 
     ~linux_file_t();
@@ -123,6 +127,12 @@ void verify_aligned_file_access(int64_t file_size, int64_t offset, size_t length
 // Makes blocking syscalls.  Upon error, returns the errno value.
 int perform_datasync(fd_t fd);
 
+// Like perform_datasync, but concurrent calls for the same file are merged into as few
+// syncs as possible.  Files opened for direct I/O on the same filesystem may share
+// syncs of the whole filesystem, if the kernel reports their errors.  Makes blocking
+// syscalls.  Upon error, returns the errno value.
+int perform_group_datasync(fd_t fd);
+
 // Calls fsync() on the parent directory of the given path.
 // Returns the errno value in case of an error and 0 otherwise.
 MUST_USE int fsync_parent_directory(const char *path);
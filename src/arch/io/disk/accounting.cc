@@ -49,8 +49,9 @@ private:
 
 accounting_diskmgr_account_t::accounting_diskmgr_account_t(accounting_diskmgr_t *_par,
                                                            int _pri,
+                                                           io_caller_t _caller,
                                                            int _outstanding_requests_limit)
-        : par(_par), pri(_pri),
+        : par(_par), pri(_pri), caller(_caller),
           outstanding_requests_limit(_outstanding_requests_limit) { }
 
 accounting_diskmgr_account_t::~accounting_diskmgr_account_t() {
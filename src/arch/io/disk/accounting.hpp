@@ -47,6 +47,7 @@ struct accounting_diskmgr_account_t {
 
     accounting_diskmgr_account_t(accounting_diskmgr_t *_par,
                                  int _pri,
+                                 io_caller_t _caller,
                                  int _outstanding_requests_limit);
 
     ~accounting_diskmgr_account_t();
@@ -54,6 +55,7 @@ struct accounting_diskmgr_account_t {
     void push(action_t *action);
     void on_semaphore_available();
     co_semaphore_t *get_outstanding_requests_limiter();
+    io_caller_t get_caller() const { return caller; }
 
 private:
     typedef accounting_diskmgr_eager_account_t eager_account_t;
@@ -62,6 +64,7 @@ private:
 
     accounting_diskmgr_t *par;
     int pri;
+    io_caller_t caller;
     int outstanding_requests_limit;
     scoped_ptr_t<eager_account_t> eager_account;
     // A scoped pointer because we create the drainer lazily on first use.
@@ -150,7 +150,7 @@ int64_t pool_diskmgr_t::action_t::perform_read_write(iovec *vecs,
 
 void pool_diskmgr_t::action_t::run() {
     if (ds_op == datasync_op::wrap_in_datasyncs) {
-        int errcode = perform_datasync(fd);
+        int errcode = perform_group_datasync(fd);
         if (errcode != 0) {
             io_result = -errcode;
             return;
@@ -196,7 +196,7 @@ void pool_diskmgr_t::action_t::run() {
 
     if (ds_op == datasync_op::wrap_in_datasyncs
         || ds_op == datasync_op::datasync_after) {
-        int errcode = perform_datasync(fd);
+        int errcode = perform_group_datasync(fd);
         if (errcode != 0) {
             io_result = -errcode;
             return;
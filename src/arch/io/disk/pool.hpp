@@ -22,6 +22,7 @@
 struct iovec;
 class pool_diskmgr_t;
 class printf_buffer_t;
+class uring_diskmgr_t;
 
 /* The pool disk manager uses a thread pool in conjunction with synchronous
 (blocking) IO calls to asynchronously run IO requests. */
@@ -80,6 +81,7 @@ struct pool_diskmgr_action_t
     bool get_is_write() const { return type == ACTION_WRITE; }
     bool get_is_resize() const { return type == ACTION_RESIZE; }
     bool get_is_read() const { return type == ACTION_READ; }
+    datasync_op get_datasync_op() const { return ds_op; }
     fd_t get_fd() const { return fd; }
     void get_bufs(iovec **iovecs_out, size_t *iovecs_len_out) {
         if (buf_and_count.iov_base != nullptr) {
@@ -103,6 +105,7 @@ struct pool_diskmgr_action_t
 
 private:
     friend class pool_diskmgr_t;
+    friend class uring_diskmgr_t;
     pool_diskmgr_t *parent;
 
     enum action_type_t {ACTION_READ, ACTION_WRITE, ACTION_RESIZE};
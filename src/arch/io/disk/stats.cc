@@ -1,14 +1,32 @@
 #include "arch/io/disk/stats.hpp"
 
+stats_diskmgr_t::caller_latency_t::caller_latency_t(perfmon_collection_t *parent,
+                                                    io_caller_t caller) :
+    collection_membership(parent, &collection, io_caller_name(caller)),
+    read_latency(secs_to_ticks(1)),
+    write_latency(secs_to_ticks(1)),
+    sync_latency(secs_to_ticks(1)),
+    latency_membership(&collection,
+                       &read_latency, "read",
+                       &write_latency, "write",
+                       &sync_latency, "sync") { }
+
 stats_diskmgr_t::stats_diskmgr_t(perfmon_collection_t *stats, const std::string &name) :
     read_sampler(secs_to_ticks(1)),
     write_sampler(secs_to_ticks(1)),
     stats_membership(stats,
                      &read_sampler, (name + "_read").c_str(),
-                     &write_sampler, (name + "_write").c_str()) { }
+                     &write_sampler, (name + "_write").c_str(),
+                     &latency_collection, (name + "_latency").c_str()) {
+    for (int i = 0; i < IO_CALLER_COUNT; ++i) {
+        caller_latencies[i].init(
+            new caller_latency_t(&latency_collection, static_cast<io_caller_t>(i)));
+    }
+}
 
 
 void stats_diskmgr_t::submit(action_t *a) {
+    a->submit_time = get_ticks();
     if (a->get_is_read()) {
         read_sampler.begin(&a->start_time);
     } else {
@@ -24,5 +42,16 @@ void stats_diskmgr_t::done(conflict_resolving_diskmgr_action_t *p) {
     } else {
         write_sampler.end(&a->start_time);
     }
+
+    caller_latency_t *latencies =
+        caller_latencies[static_cast<int>(a->account->get_caller())].get();
+    const ticks_t latency = ticks_t{get_ticks().nanos - a->submit_time.nanos};
+    if (a->get_is_read()) {
+        latencies->read_latency.record(latency);
+    } else if (a->get_datasync_op() == datasync_op::no_datasyncs) {
+        latencies->write_latency.record(latency);
+    } else {
+        latencies->sync_latency.record(latency);
+    }
     done_fun(a);
 }
@@ -2,12 +2,14 @@
 #ifndef ARCH_IO_DISK_STATS_HPP_
 #define ARCH_IO_DISK_STATS_HPP_
 
+#include <array>
 #include <functional>
 #include <string>
 
 #include "arch/io/disk/pool.hpp"
 #include "arch/io/disk/conflict_resolving.hpp"
-#include "perfmon/types.hpp"
+#include "containers/scoped.hpp"
+#include "perfmon/perfmon.hpp"
 
 /* There are two types of stat-collectors in the disk stack. One type is a passive
 consumer and active producer of disk operations. The other type is an active consumer
@@ -18,6 +20,8 @@ struct stats_diskmgr_t {
 
     struct action_t : public conflict_resolving_diskmgr_action_t {
         ticks_t start_time;
+        /* Unlike `start_time`, this is set even if full perfmon is off. */
+        ticks_t submit_time;
     };
 
     void submit(action_t *a);
@@ -29,8 +33,24 @@ struct stats_diskmgr_t {
     void done(conflict_resolving_diskmgr_action_t *p);
 
 private:
+    /* The latency histograms of the operations of the accounts of one `io_caller_t`,
+    from when they enter the disk stack until they are done. Because that includes the
+    time they spend queued behind the operations of the other accounts, this shows e.g.
+    if the GC is slowing down the cache reads. Writes that wrap in datasyncs count as
+    syncs instead of writes. */
+    struct caller_latency_t {
+        caller_latency_t(perfmon_collection_t *parent, io_caller_t caller);
+
+        perfmon_collection_t collection;
+        perfmon_membership_t collection_membership;
+        perfmon_latency_sampler_t read_latency, write_latency, sync_latency;
+        perfmon_multi_membership_t latency_membership;
+    };
+
     perfmon_duration_sampler_t read_sampler, write_sampler;
+    perfmon_collection_t latency_collection;
     perfmon_multi_membership_t stats_membership;
+    std::array<scoped_ptr_t<caller_latency_t>, IO_CALLER_COUNT> caller_latencies;
 };
 
 #endif /* ARCH_IO_DISK_STATS_HPP_ */
@@ -2,8 +2,17 @@
 
 #include <inttypes.h>
 
+#include <atomic>
+
 #include "containers/printf_buffer.hpp"
 
+/* The files live on different threads, so this is shared between threads. */
+static std::atomic<int64_t> total_disk_request_nanos(0);
+
+int64_t get_total_disk_request_nanos() {
+    return total_disk_request_nanos.load(std::memory_order_relaxed);
+}
+
 void debug_print(printf_buffer_t *buf,
                  const stats_diskmgr_2_action_t &action) {
     buf->appendf("stats_diskmgr_2_action{start_time=%" PRIi64 "}<",
@@ -30,6 +39,8 @@ stats_diskmgr_2_t::stats_diskmgr_2_t(
 
 void stats_diskmgr_2_t::done(pool_diskmgr_t::action_t *p) {
     action_t *a = static_cast<action_t *>(p);
+    total_disk_request_nanos.fetch_add(get_ticks().nanos - a->dispatch_time.nanos,
+                                       std::memory_order_relaxed);
     if (a->get_is_read()) {
         read_sampler.end(&a->start_time);
     } else {
@@ -40,6 +51,7 @@ void stats_diskmgr_2_t::done(pool_diskmgr_t::action_t *p) {
 
 pool_diskmgr_t::action_t *stats_diskmgr_2_t::produce_next_value() {
     action_t *a = source->pop();
+    a->dispatch_time = get_ticks();
     if (a->get_is_read()) {
         read_sampler.begin(&a->start_time);
     } else {
@@ -1,6 +1,8 @@
 #ifndef ARCH_IO_DISK_STATS_2_HPP_
 #define ARCH_IO_DISK_STATS_2_HPP_
 
+#include <stdint.h>
+
 #include <string>
 
 #include "arch/io/disk/pool.hpp"
@@ -8,6 +10,8 @@
 
 struct stats_diskmgr_2_action_t : public pool_diskmgr_t::action_t {
     ticks_t start_time;
+    /* Unlike `start_time`, this is set even if full perfmon is off. */
+    ticks_t dispatch_time;
 };
 
 void debug_print(printf_buffer_t *buf,
@@ -36,5 +40,10 @@ private:
     perfmon_multi_membership_t stats_membership;
 };
 
+/* Returns the sum of the time that all disk requests of the process have spent between
+entering and leaving any `stats_diskmgr_2_t`. Dividing how much this grows in some period
+by the length of the period gives the average number of requests that were queued or in
+progress at the disk, by Little's law. */
+int64_t get_total_disk_request_nanos();
 
 #endif  // ARCH_IO_DISK_STATS_2_HPP_
@@ -0,0 +1,290 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#include "arch/io/disk/uring.hpp"
+
+#if USE_IO_URING
+
+#include <limits.h>
+#include <linux/io_uring.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "arch/runtime/runtime.hpp"
+#include "logger.hpp"
+
+namespace {
+
+int sys_io_uring_setup(unsigned entries, io_uring_params *p) {
+    return static_cast<int>(syscall(__NR_io_uring_setup, entries, p));
+}
+
+int sys_io_uring_enter(int fd, unsigned to_submit, unsigned min_complete,
+                       unsigned flags) {
+    return static_cast<int>(syscall(__NR_io_uring_enter, fd, to_submit, min_complete,
+                                    flags, nullptr, 0));
+}
+
+int sys_io_uring_register(int fd, unsigned opcode, void *arg, unsigned nr_args) {
+    return static_cast<int>(syscall(__NR_io_uring_register, fd, opcode, arg, nr_args));
+}
+
+unsigned *ring_field(void *ring, uint32_t offset) {
+    return reinterpret_cast<unsigned *>(static_cast<char *>(ring) + offset);
+}
+
+bool probe_io_uring() {
+    io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    int fd = sys_io_uring_setup(1, &params);
+    if (fd < 0) {
+        return false;
+    }
+    // We rely on readv/writev (kernel 5.1) and on `IORING_FEAT_NODROP` (5.5) so that
+    // completions can never be lost if the completion queue fills up.
+    bool ok = (params.features & IORING_FEAT_NODROP) != 0;
+    ::close(fd);
+    return ok;
+}
+
+}  // namespace
+
+bool uring_diskmgr_t::is_supported() {
+    static const bool supported = probe_io_uring();
+    return supported;
+}
+
+uring_diskmgr_t::uring_diskmgr_t(linux_event_queue_t *_queue,
+                                 passive_producer_t<action_t *> *_source,
+                                 int max_concurrent_io_requests)
+    : queue_depth(max_concurrent_io_requests * 2),
+      source(_source),
+      queue(_queue),
+      ring_fd(INVALID_FD),
+      n_prepared(0),
+      flush_scheduled(false),
+      n_pending(0),
+      fallback_pool(_queue, &fallback_queue, max_concurrent_io_requests) {
+    guarantee(max_concurrent_io_requests > 0);
+
+    io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    ring_fd = sys_io_uring_setup(queue_depth, &params);
+    guarantee_err(ring_fd >= 0, "io_uring_setup failed");
+    guarantee(params.sq_entries >= static_cast<unsigned>(queue_depth));
+
+    sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+
+    sq_ring = mmap(nullptr, sq_ring_size, PROT_READ | PROT_WRITE,
+                   MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQ_RING);
+    guarantee_err(sq_ring != MAP_FAILED, "Could not map io_uring submission queue");
+    cq_ring = mmap(nullptr, cq_ring_size, PROT_READ | PROT_WRITE,
+                   MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_CQ_RING);
+    guarantee_err(cq_ring != MAP_FAILED, "Could not map io_uring completion queue");
+    void *sqes_mem = mmap(nullptr, sqes_size, PROT_READ | PROT_WRITE,
+                          MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQES);
+    guarantee_err(sqes_mem != MAP_FAILED, "Could not map io_uring submission entries");
+    sqes = static_cast<io_uring_sqe *>(sqes_mem);
+
+    sq_head = ring_field(sq_ring, params.sq_off.head);
+    sq_tail = ring_field(sq_ring, params.sq_off.tail);
+    sq_mask = *ring_field(sq_ring, params.sq_off.ring_mask);
+    sq_array = ring_field(sq_ring, params.sq_off.array);
+    cq_head = ring_field(cq_ring, params.cq_off.head);
+    cq_tail = ring_field(cq_ring, params.cq_off.tail);
+    cq_mask = *ring_field(cq_ring, params.cq_off.ring_mask);
+    cqes = reinterpret_cast<io_uring_cqe *>(static_cast<char *>(cq_ring)
+                                            + params.cq_off.cqes);
+
+    int event_fd = completion_event.get_notify_fd();
+    int res = sys_io_uring_register(ring_fd, IORING_REGISTER_EVENTFD, &event_fd, 1);
+    guarantee_err(res == 0, "Could not register eventfd with io_uring");
+    queue->watch_resource(event_fd, poll_event_in, this);
+
+    fallback_pool.done_fun = std::bind(&uring_diskmgr_t::on_fallback_done, this, ph::_1);
+
+    if (source->available->get()) { pump(); }
+    source->available->set_callback(this);
+}
+
+uring_diskmgr_t::~uring_diskmgr_t() {
+    assert_thread();
+    rassert(n_pending == 0);
+    rassert(!flush_scheduled);
+    source->available->unset_callback();
+    queue->forget_resource(completion_event.get_notify_fd(), this);
+
+    int res = munmap(sqes, sqes_size);
+    guarantee_err(res == 0, "munmap failed");
+    res = munmap(cq_ring, cq_ring_size);
+    guarantee_err(res == 0, "munmap failed");
+    res = munmap(sq_ring, sq_ring_size);
+    guarantee_err(res == 0, "munmap failed");
+    res = ::close(ring_fd);
+    guarantee_err(res == 0, "Could not close io_uring");
+}
+
+void uring_diskmgr_t::on_source_availability_changed() {
+    assert_thread();
+    if (source->available->get()) pump();
+}
+
+bool uring_diskmgr_t::needs_fallback(action_t *a) {
+    if (a->get_is_resize() || a->ds_op != datasync_op::no_datasyncs) {
+        return true;
+    }
+    iovec *vecs;
+    size_t vecs_len;
+    a->get_bufs(&vecs, &vecs_len);
+    return vecs_len > IOV_MAX;
+}
+
+void uring_diskmgr_t::pump() {
+    assert_thread();
+    while (source->available->get() && n_pending < queue_depth) {
+        action_t *a = source->pop();
+        n_pending++;
+        if (needs_fallback(a)) {
+            fallback_queue.push(a);
+        } else {
+            prepare_sqe(a);
+        }
+    }
+
+    if (n_prepared > 0 && !flush_scheduled) {
+        flush_scheduled = true;
+        call_later_on_this_thread(this);
+    }
+}
+
+void uring_diskmgr_t::prepare_sqe(action_t *a) {
+    // `n_pending` is bounded by `queue_depth`, which is no larger than the ring, so
+    // there is always room for another entry.
+    unsigned tail = *sq_tail;
+    rassert(tail - __atomic_load_n(sq_head, __ATOMIC_ACQUIRE) <= sq_mask);
+    unsigned index = tail & sq_mask;
+
+    iovec *vecs;
+    size_t vecs_len;
+    a->get_bufs(&vecs, &vecs_len);
+
+    io_uring_sqe *sqe = &sqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = a->get_is_read() ? IORING_OP_READV : IORING_OP_WRITEV;
+    sqe->fd = a->get_fd();
+    sqe->off = a->get_offset();
+    sqe->addr = reinterpret_cast<uint64_t>(vecs);
+    sqe->len = vecs_len;
+    sqe->user_data = reinterpret_cast<uint64_t>(a);
+
+    sq_array[index] = index;
+    __atomic_store_n(sq_tail, tail + 1, __ATOMIC_RELEASE);
+    ++n_prepared;
+}
+
+void uring_diskmgr_t::on_thread_switch() {
+    assert_thread();
+    flush_scheduled = false;
+    submit_prepared_sqes();
+}
+
+void uring_diskmgr_t::submit_prepared_sqes() {
+    int busy_retries = 0;
+    while (n_prepared > 0) {
+        int res = sys_io_uring_enter(ring_fd, n_prepared, 0, 0);
+        if (res > 0) {
+            rassert(static_cast<unsigned>(res) <= n_prepared);
+            n_prepared -= res;
+            busy_retries = 0;
+        } else if (res < 0 && get_errno() == EINTR) {
+            continue;
+        } else if (res == 0 || get_errno() == EAGAIN || get_errno() == EBUSY) {
+            // The kernel is short on resources, or the completion queue is backed
+            // up. Reaping completions makes room. If that doesn't help, there may be
+            // nothing in flight whose completion would, so we don't wait for one.
+            if (busy_retries < MAX_BUSY_SUBMIT_RETRIES) {
+                ++busy_retries;
+                reap_completions();
+            } else {
+                unprepare_sqes();
+            }
+        } else {
+            crash("io_uring_enter failed: %s", errno_string(get_errno()).c_str());
+        }
+    }
+}
+
+void uring_diskmgr_t::unprepare_sqes() {
+    // Without `IORING_SETUP_SQPOLL` the kernel only reads the submission queue during
+    // `io_uring_enter`, so we can take back the entries it hasn't consumed and run
+    // their actions on the fallback pool instead.
+    unsigned head = __atomic_load_n(sq_head, __ATOMIC_ACQUIRE);
+    unsigned tail = *sq_tail;
+    rassert(tail - head == n_prepared);
+    for (unsigned i = head; i != tail; ++i) {
+        const io_uring_sqe *sqe = &sqes[sq_array[i & sq_mask]];
+        fallback_queue.push(reinterpret_cast<action_t *>(sqe->user_data));
+    }
+    __atomic_store_n(sq_tail, head, __ATOMIC_RELEASE);
+    n_prepared = 0;
+}
+
+void uring_diskmgr_t::on_event(DEBUG_VAR int events) {
+    assert_thread();
+    rassert(events == poll_event_in);
+    completion_event.consume_wakey_wakeys();
+    reap_completions();
+}
+
+void uring_diskmgr_t::reap_completions() {
+    std::vector<action_t *> finished;
+    std::vector<action_t *> retries;
+
+    unsigned head = *cq_head;
+    unsigned tail = __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE);
+    for (; head != tail; ++head) {
+        const io_uring_cqe *cqe = &cqes[head & cq_mask];
+        action_t *a = reinterpret_cast<action_t *>(cqe->user_data);
+        if (cqe->res == static_cast<int64_t>(a->get_count())) {
+            a->io_result = cqe->res;
+            finished.push_back(a);
+        } else if (cqe->res >= 0 || cqe->res == -EINTR || cqe->res == -EAGAIN) {
+            // Short transfers and transient failures are retried on the fallback
+            // pool, which knows how to continue partial reads and writes and how to
+            // report running out of disk space.
+            retries.push_back(a);
+        } else {
+            a->io_result = cqe->res;
+            finished.push_back(a);
+        }
+    }
+    __atomic_store_n(cq_head, head, __ATOMIC_RELEASE);
+
+    for (action_t *a : retries) {
+        fallback_queue.push(a);
+    }
+    for (action_t *a : finished) {
+        finish_action(a);
+    }
+
+    // Entries may have been held back by `EAGAIN` or `EBUSY`.
+    if (n_prepared > 0 && !flush_scheduled) {
+        flush_scheduled = true;
+        call_later_on_this_thread(this);
+    }
+}
+
+void uring_diskmgr_t::on_fallback_done(action_t *a) {
+    finish_action(a);
+}
+
+void uring_diskmgr_t::finish_action(action_t *a) {
+    assert_thread();
+    n_pending--;
+    pump();
+    done_fun(a);
+}
+
+#endif  // USE_IO_URING
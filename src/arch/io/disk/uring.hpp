@@ -0,0 +1,125 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#ifndef ARCH_IO_DISK_URING_HPP_
+#define ARCH_IO_DISK_URING_HPP_
+
+#include <functional>
+#include <vector>
+
+#include "arch/io/disk/pool.hpp"
+#include "arch/runtime/event_queue.hpp"
+#include "arch/runtime/runtime_utils.hpp"
+#include "arch/runtime/system_event/eventfd_event.hpp"
+#include "concurrency/queue/passive_producer.hpp"
+#include "concurrency/queue/unlimited_fifo.hpp"
+
+#if defined(__linux__) && !defined(NO_IO_URING) && !defined(NO_EVENTFD)
+#include <sys/syscall.h>
+#if defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter) \
+    && defined(__NR_io_uring_register)
+#define USE_IO_URING 1
+#endif
+#endif
+
+#ifndef USE_IO_URING
+#define USE_IO_URING 0
+#endif
+
+#if USE_IO_URING
+
+struct io_uring_sqe;
+struct io_uring_cqe;
+
+/* The uring disk manager submits IO requests to the kernel through io_uring instead
+of handing them to blocker pool threads.  It draws actions from the same
+`passive_producer_t` as `pool_diskmgr_t` and calls `done_fun` on them in the same way,
+so it can take the place of `pool_diskmgr_t` at the bottom of the IO stack.
+
+Submission queue entries are prepared as actions arrive, but the `io_uring_enter`
+call is deferred until the end of the current event loop tick, so everything that
+arrives in one tick goes to the kernel with a single system call.  Completions are
+announced through an eventfd that is registered with the ring and are reaped on the
+thread that owns the disk manager.
+
+Actions that io_uring can't handle in a straightforward way (resizes, writes that need
+datasyncs, requests with too many iovecs, and short reads or writes which need to be
+retried) are forwarded to an embedded `pool_diskmgr_t`.  So are actions that the kernel
+keeps refusing to accept with `EAGAIN` or `EBUSY`. */
+class uring_diskmgr_t :
+    private availability_callback_t,
+    private linux_event_callback_t,
+    private linux_thread_message_t,
+    public home_thread_mixin_debug_only_t {
+public:
+    typedef pool_diskmgr_action_t action_t;
+
+    /* Returns true if the running kernel lets us set up an io_uring.  The result is
+    computed once and cached. */
+    static bool is_supported();
+
+    uring_diskmgr_t(linux_event_queue_t *queue, passive_producer_t<action_t *> *source,
+                    int max_concurrent_io_requests);
+    std::function<void(action_t *)> done_fun;
+    ~uring_diskmgr_t();
+
+private:
+    void on_source_availability_changed();
+    void on_event(int events);
+    void on_thread_switch();
+
+    void pump();
+    bool needs_fallback(action_t *a);
+    void prepare_sqe(action_t *a);
+    void submit_prepared_sqes();
+    void unprepare_sqes();
+    void reap_completions();
+    void on_fallback_done(action_t *a);
+    void finish_action(action_t *a);
+
+    const int queue_depth;
+    passive_producer_t<action_t *> *source;
+    linux_event_queue_t *queue;
+
+    // The ring file descriptor and the memory mappings of the submission queue, the
+    // submission queue entry array and the completion queue.
+    fd_t ring_fd;
+    void *sq_ring;
+    size_t sq_ring_size;
+    void *cq_ring;
+    size_t cq_ring_size;
+    io_uring_sqe *sqes;
+    size_t sqes_size;
+
+    unsigned *sq_head;
+    unsigned *sq_tail;
+    unsigned sq_mask;
+    unsigned *sq_array;
+    unsigned *cq_head;
+    unsigned *cq_tail;
+    unsigned cq_mask;
+    io_uring_cqe *cqes;
+
+    // The kernel signals this whenever it posts completions.
+    eventfd_event_t completion_event;
+
+    // Number of SQEs that have been written to the ring but not yet passed to
+    // `io_uring_enter`, and whether a flush is already scheduled for this tick.
+    unsigned n_prepared;
+    bool flush_scheduled;
+
+    // How many times `submit_prepared_sqes` reaps completions and tries again when the
+    // kernel won't take any entries, before it hands them to the fallback pool.
+    static const int MAX_BUSY_SUBMIT_RETRIES = 3;
+
+    // Number of actions popped from `source` that haven't been passed to
+    // `done_fun` yet. This includes actions running on the fallback pool.
+    int n_pending;
+
+    unlimited_fifo_queue_t<action_t *> fallback_queue;
+    pool_diskmgr_t fallback_pool;
+
+    DISABLE_COPYING(uring_diskmgr_t);
+};
+
+#endif  // USE_IO_URING
+
+#endif /* ARCH_IO_DISK_URING_HPP_ */
@@ -4,6 +4,7 @@
 
 #include <errno.h>
 #include <fcntl.h>
+#include <limits.h>
 #include <string.h>
 #include <sys/types.h>
 
@@ -18,24 +19,24 @@
 #include <netinet/tcp.h>
 #include <sys/ioctl.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #endif
 
+#include <atomic>
+
 #include "arch/runtime/runtime.hpp"
 #include "arch/runtime/thread_pool.hpp"
 #include "arch/timing.hpp"
 #include "arch/types.hpp"
 #include "concurrency/auto_drainer.hpp"
 #include "concurrency/exponential_backoff.hpp"
+#include "concurrency/pmap.hpp"
 #include "concurrency/wait_any.hpp"
 #include "containers/printf_buffer.hpp"
 #include "logger.hpp"
 #include "perfmon/perfmon.hpp"
 #include "errors.hpp"
 
-#ifdef _WIN32
-#include "concurrency/pmap.hpp"
-#endif
-
 #ifdef TRACE_WINSOCK
 #define winsock_debugf(...) debugf("winsock: " __VA_ARGS__)
 #else
@@ -212,6 +213,7 @@ linux_tcp_conn_t::linux_tcp_conn_t(const ip_address_t &peer,
         read_buffer(IO_BUFFER_SIZE),
         write_handler(this),
         write_queue_limiter(WRITE_QUEUE_MAX_SIZE),
+        write_queue_size(0),
         write_coro_pool(1, &write_queue, &write_handler),
         current_write_buffer(get_write_buffer()),
         drainer(new auto_drainer_t) {
@@ -253,6 +255,7 @@ linux_tcp_conn_t::linux_tcp_conn_t(fd_t s) :
        read_buffer(IO_BUFFER_SIZE),
        write_handler(this),
        write_queue_limiter(WRITE_QUEUE_MAX_SIZE),
+       write_queue_size(0),
        write_coro_pool(1, &write_queue, &write_handler),
        current_write_buffer(get_write_buffer()),
        drainer(new auto_drainer_t) {
@@ -278,38 +281,27 @@ void linux_tcp_conn_t::enable_keepalive() THROWS_ONLY(tcp_conn_write_closed_exc_
     guarantee_err(res != -1, "Could not set SO_KEEPALIVE option.");
 }
 
-linux_tcp_conn_t::write_buffer_t * linux_tcp_conn_t::get_write_buffer() {
-    write_buffer_t *buffer;
+per_thread_object_pool_t<linux_tcp_conn_t::write_buffer_t>
+    linux_tcp_conn_t::write_buffer_pool(16);
+per_thread_object_pool_t<linux_tcp_conn_t::write_queue_op_t>
+    linux_tcp_conn_t::write_queue_op_pool(256);
 
-    if (unused_write_buffers.empty()) {
-        buffer = new write_buffer_t;
-    } else {
-        buffer = unused_write_buffers.head();
-        unused_write_buffers.pop_front();
-    }
+linux_tcp_conn_t::write_buffer_t * linux_tcp_conn_t::get_write_buffer() {
+    write_buffer_t *buffer = write_buffer_pool.create();
     buffer->size = 0;
     return buffer;
 }
 
 linux_tcp_conn_t::write_queue_op_t * linux_tcp_conn_t::get_write_queue_op() {
-    write_queue_op_t *op;
-
-    if (unused_write_queue_ops.empty()) {
-        op = new write_queue_op_t;
-    } else {
-        op = unused_write_queue_ops.head();
-        unused_write_queue_ops.pop_front();
-    }
-    return op;
+    return write_queue_op_pool.create();
 }
 
 void linux_tcp_conn_t::release_write_buffer(write_buffer_t *buffer) {
-    unused_write_buffers.push_front(buffer);
+    write_buffer_pool.destroy(buffer);
 }
 
 void linux_tcp_conn_t::release_write_queue_op(write_queue_op_t *op) {
-    op->keepalive = auto_drainer_t::lock_t();
-    unused_write_queue_ops.push_front(op);
+    write_queue_op_pool.destroy(op);
 }
 
 size_t linux_tcp_conn_t::read_internal(void *buffer, size_t size) THROWS_ONLY(tcp_conn_read_closed_exc_t) {
@@ -521,19 +513,45 @@ linux_tcp_conn_t::write_handler_t::write_handler_t(linux_tcp_conn_t *_parent) :
 { }
 
 void linux_tcp_conn_t::write_handler_t::coro_pool_callback(write_queue_op_t *operation, UNUSED signal_t *interruptor) {
-    if (operation->buffer != nullptr) {
-        parent->perform_write(operation->buffer, operation->size);
-        if (operation->dealloc != nullptr) {
-            parent->release_write_buffer(operation->dealloc);
-            parent->write_queue_limiter.unlock(operation->size);
+    /* Also take the operations that got queued up behind this one, so that all of
+    their data goes out together. */
+    write_queue_op_t *operations[WRITE_COALESCE_MAX_OPS];
+    size_t num_operations = 0;
+    operations[num_operations++] = operation;
+    while (num_operations < WRITE_COALESCE_MAX_OPS
+           && parent->write_queue.available->get()) {
+        operations[num_operations++] = parent->write_queue.pop();
+    }
+
+    const_buffer_group_t buffers;
+    for (size_t i = 0; i < num_operations; ++i) {
+        write_queue_op_t *op = operations[i];
+        if (op->buffers != nullptr) {
+            for (size_t j = 0; j < op->buffers->num_buffers(); ++j) {
+                const_buffer_group_t::buffer_t b = op->buffers->get_buffer(j);
+                buffers.add_buffer(b.size, b.data);
+            }
+        } else if (op->buffer != nullptr) {
+            buffers.add_buffer(op->size, op->buffer);
         }
     }
-
-    if (operation->cond != nullptr) {
-        operation->cond->pulse();
+    if (buffers.num_buffers() > 0) {
+        parent->perform_write(&buffers);
     }
-    if (operation->dealloc != nullptr) {
-        parent->release_write_queue_op(operation);
+
+    for (size_t i = 0; i < num_operations; ++i) {
+        write_queue_op_t *op = operations[i];
+        if (op->dealloc != nullptr) {
+            parent->release_write_buffer(op->dealloc);
+            parent->write_queue_limiter.unlock(op->size);
+            parent->write_queue_size -= op->size;
+        }
+        if (op->cond != nullptr) {
+            op->cond->pulse();
+        }
+        if (op->dealloc != nullptr) {
+            parent->release_write_queue_op(op);
+        }
     }
 }
 
@@ -547,6 +565,7 @@ void linux_tcp_conn_t::internal_flush_write_buffer() {
     op->buffer = current_write_buffer->buffer;
     op->size = current_write_buffer->size;
     op->dealloc = current_write_buffer.release();
+    op->buffers = nullptr;
     op->cond = nullptr;
     op->keepalive = auto_drainer_t::lock_t(drainer.get());
     current_write_buffer.init(get_write_buffer());
@@ -556,11 +575,12 @@ void linux_tcp_conn_t::internal_flush_write_buffer() {
     rassert(op->size <= WRITE_CHUNK_SIZE);
     rassert(WRITE_CHUNK_SIZE < WRITE_QUEUE_MAX_SIZE);
     write_queue_limiter.co_lock(op->size);
+    write_queue_size += op->size;
 
     write_queue.push(op);
 }
 
-void linux_tcp_conn_t::perform_write(const void *buf, size_t size) {
+void linux_tcp_conn_t::perform_write(const const_buffer_group_t *buffers) {
     assert_thread();
 
     if (write_closed.is_pulsed()) {
@@ -572,12 +592,16 @@ void linux_tcp_conn_t::perform_write(const void *buf, size_t size) {
 
 #ifdef _WIN32
     overlapped_operation_t op(event_watcher.get());
-    WSABUF wsabuf;
-    wsabuf.len = size;
-    wsabuf.buf = const_cast<char*>(reinterpret_cast<const char*>(buf));
+    std::vector<WSABUF> wsabufs(buffers->num_buffers());
+    for (size_t i = 0; i < buffers->num_buffers(); ++i) {
+        const_buffer_group_t::buffer_t b = buffers->get_buffer(i);
+        wsabufs[i].len = b.size;
+        wsabufs[i].buf = const_cast<char*>(reinterpret_cast<const char*>(b.data));
+    }
     DWORD flags = 0;
     winsock_debugf("write on %x\n", sock.get());
-    int res = WSASend(fd_to_socket(sock.get()), &wsabuf, 1, nullptr, flags, &op.overlapped, nullptr);
+    int res = WSASend(fd_to_socket(sock.get()), wsabufs.data(), wsabufs.size(), nullptr,
+                      flags, &op.overlapped, nullptr);
     DWORD error = GetLastError();
     if (res == 0 || error == ERROR_IO_PENDING) {
         op.wait_abortable(&write_closed);
@@ -590,16 +614,40 @@ void linux_tcp_conn_t::perform_write(const void *buf, size_t size) {
     }
     if (error != NO_ERROR) {
         logERR("Could not write to socket %x: %s", sock.get(), winerr_string(error).c_str());
-        on_shutdown_write();
+        on_write_failed();
     } else if (op.nb_bytes == 0) {
-        on_shutdown_write();
+        on_write_failed();
     } else {
         if (write_perfmon) write_perfmon->record(op.nb_bytes);
-        rassert(op.nb_bytes == size);  // TODO WINDOWS: does windows guarantee this?
+        // TODO WINDOWS: does windows guarantee this?
+        rassert(op.nb_bytes == buffers->get_size());
     }
 #else
-    while (size > 0) {
-        ssize_t res = ::write(sock.get(), buf, size);
+    /* `index` is the first buffer that hasn't been written completely yet, and
+       `offset` is how much of it has been written. */
+    size_t index = 0;
+    size_t offset = 0;
+    std::vector<iovec> iovecs;
+    while (index < buffers->num_buffers()) {
+        iovecs.clear();
+        for (size_t i = index;
+             i < buffers->num_buffers() && iovecs.size() < static_cast<size_t>(IOV_MAX);
+             ++i) {
+            const_buffer_group_t::buffer_t b = buffers->get_buffer(i);
+            const size_t skip = i == index ? offset : 0;
+            if (static_cast<size_t>(b.size) > skip) {
+                iovec v;
+                v.iov_base = const_cast<char *>(static_cast<const char *>(b.data)) + skip;
+                v.iov_len = b.size - skip;
+                iovecs.push_back(v);
+            }
+        }
+        if (iovecs.empty()) {
+            /* Only empty buffers are left. */
+            break;
+        }
+
+        ssize_t res = ::writev(sock.get(), iovecs.data(), iovecs.size());
 
         if (res == -1 && (get_errno() == EAGAIN || get_errno() == EWOULDBLOCK)) {
             /* Wait for a notification from the event queue, or for an order to
@@ -619,30 +667,41 @@ void linux_tcp_conn_t::perform_write(const void *buf, size_t size) {
         } else if (res == -1 && (get_errno() == EPIPE || get_errno() == ENOTCONN || get_errno() == EHOSTUNREACH ||
                                  get_errno() == ENETDOWN || get_errno() == EHOSTDOWN || get_errno() == ECONNRESET)) {
             /* These errors are expected to happen at some point in practice */
-            on_shutdown_write();
+            on_write_failed();
             break;
 
         } else if (res == -1) {
             /* In theory this should never happen, but it probably will. So we write a log message
                and then shut down normally. */
             logERR("Could not write to socket: %s", errno_string(get_errno()).c_str());
-            on_shutdown_write();
+            on_write_failed();
             break;
 
         } else if (res == 0) {
             /* This should never happen either, but it's better to write an error message than to
                crash completely. */
-            logERR("Didn't expect write() to return 0.");
-            on_shutdown_write();
+            logERR("Didn't expect writev() to return 0.");
+            on_write_failed();
             break;
 
         } else {
-            rassert(res <= static_cast<ssize_t>(size));
-            buf = reinterpret_cast<const void *>(reinterpret_cast<const char *>(buf) + res);
-            size -= res;
             if (write_perfmon) {
                 write_perfmon->record(res);
             }
+            /* Skip over what was written. */
+            size_t written = res;
+            while (written > 0) {
+                rassert(index < buffers->num_buffers());
+                const size_t left_in_buffer = buffers->get_buffer(index).size - offset;
+                if (written >= left_in_buffer) {
+                    written -= left_in_buffer;
+                    ++index;
+                    offset = 0;
+                } else {
+                    offset += written;
+                    written = 0;
+                }
+            }
         }
     }
 #endif
@@ -665,6 +724,7 @@ void linux_tcp_conn_t::write(const void *buf, size_t size, signal_t *closer) THR
     /* Enqueue the write so it will happen eventually */
     op.buffer = buf;
     op.size = size;
+    op.buffers = nullptr;
     op.dealloc = nullptr;
     op.cond = &to_signal_when_done;
     write_queue.push(&op);
@@ -679,6 +739,31 @@ void linux_tcp_conn_t::write(const void *buf, size_t size, signal_t *closer) THR
     }
 }
 
+void linux_tcp_conn_t::write_buffers(const const_buffer_group_t *buffers, signal_t *closer) THROWS_ONLY(tcp_conn_write_closed_exc_t) {
+    write_op_wrapper_t sentry(this, closer);
+
+    write_queue_op_t op;
+    cond_t to_signal_when_done;
+
+    /* Like in `write()`, flush out any buffered data first, and don't bother with the
+       write semaphore. */
+    if (current_write_buffer->size > 0) {
+        internal_flush_write_buffer();
+    }
+
+    op.buffer = nullptr;
+    op.size = 0;
+    op.buffers = buffers;
+    op.dealloc = nullptr;
+    op.cond = &to_signal_when_done;
+    write_queue.push(&op);
+    to_signal_when_done.wait();
+
+    if (write_closed.is_pulsed()) {
+        throw tcp_conn_write_closed_exc_t();
+    }
+}
+
 void linux_tcp_conn_t::write_buffered(const void *vbuf, size_t size, signal_t *closer) THROWS_ONLY(tcp_conn_write_closed_exc_t) {
     write_op_wrapper_t sentry(this, closer);
 
@@ -721,6 +806,11 @@ void linux_tcp_conn_t::writef(signal_t *closer, const char *format, ...) THROWS_
     va_end(ap);
 }
 
+size_t linux_tcp_conn_t::get_buffered_write_size() const {
+    assert_thread();
+    return write_queue_size + current_write_buffer->size;
+}
+
 void linux_tcp_conn_t::flush_buffer(signal_t *closer) THROWS_ONLY(tcp_conn_write_closed_exc_t) {
     write_op_wrapper_t sentry(this, closer);
 
@@ -737,6 +827,7 @@ void linux_tcp_conn_t::flush_buffer(signal_t *closer) THROWS_ONLY(tcp_conn_write
     write_queue_op_t op;
     cond_t to_signal_when_done;
     op.buffer = nullptr;
+    op.buffers = nullptr;
     op.dealloc = nullptr;
     op.cond = &to_signal_when_done;
     write_queue.push(&op);
@@ -788,6 +879,10 @@ void linux_tcp_conn_t::on_shutdown_write() {
        no-ops, so in practice the write queue empties. */
 }
 
+void linux_tcp_conn_t::on_write_failed() {
+    on_shutdown_write();
+}
+
 bool linux_tcp_conn_t::is_write_open() const {
     assert_thread();
     return !write_closed.is_pulsed();
@@ -908,7 +1003,8 @@ linux_secure_tcp_conn_t::linux_secure_tcp_conn_t(
         signal_t *interruptor, int local_port)
         THROWS_ONLY(connect_failed_exc_t, crypto::openssl_error_t, interrupted_exc_t) :
     linux_tcp_conn_t(host, port, interruptor, local_port),
-    conn(tls_ctx) {
+    conn(tls_ctx),
+    ktls_send(false) {
 
     conn.set_fd(sock.get());
     SSL_set_connect_state(conn.get());
@@ -920,7 +1016,8 @@ linux_secure_tcp_conn_t::linux_secure_tcp_conn_t(
         SSL_CTX *tls_ctx, fd_t _sock, signal_t *interruptor)
         THROWS_ONLY(crypto::openssl_error_t, interrupted_exc_t) :
     linux_tcp_conn_t(_sock),
-    conn(tls_ctx) {
+    conn(tls_ctx),
+    ktls_send(false) {
 
     conn.set_fd(sock.get());
     SSL_set_accept_state(conn.get());
@@ -947,7 +1044,13 @@ void linux_secure_tcp_conn_t::perform_handshake(signal_t *interruptor)
         int ret = SSL_do_handshake(conn.get());
 
         if (ret > 0) {
-            return; // Successful TLS handshake.
+            // Successful TLS handshake.
+#ifdef SSL_OP_ENABLE_KTLS
+            /* If the kernel took over the encryption of what we send, we can write to
+            the socket directly. */
+            ktls_send = BIO_get_ktls_send(SSL_get_wbio(conn.get())) != 0;
+#endif
+            return;
         }
 
         if (ret == 0) {
@@ -1044,15 +1147,29 @@ size_t linux_secure_tcp_conn_t::read_internal(void *buffer, size_t size)
     }
 }
 
-void linux_secure_tcp_conn_t::perform_write(const void *buffer, size_t size) {
+void linux_secure_tcp_conn_t::perform_write(const const_buffer_group_t *buffers) {
     assert_thread();
 
-    if (closed.is_pulsed()) {
-        /* The connection was closed, but there are still operations in the
-        write queue; we are one of those operations. Just don't do anything. */
+    if (ktls_send) {
+        /* The kernel turns plain writes into TLS records, so we can skip OpenSSL and
+        hand all of the buffers to the socket at once. */
+        linux_tcp_conn_t::perform_write(buffers);
         return;
     }
 
+    for (size_t i = 0; i < buffers->num_buffers(); ++i) {
+        if (closed.is_pulsed()) {
+            /* The connection was closed, but there are still operations in the
+            write queue; we are one of those operations. Just don't do anything. */
+            return;
+        }
+        const_buffer_group_t::buffer_t b = buffers->get_buffer(i);
+        perform_ssl_write(b.data, b.size);
+    }
+}
+
+void linux_secure_tcp_conn_t::perform_ssl_write(const void *buffer, size_t size) {
+
     // Loop for retrying if the underlying socket would block and to retry on
     // partial writes.
     while (size > 0) {
@@ -1182,6 +1299,12 @@ void linux_secure_tcp_conn_t::shutdown() {
     shutdown_socket();
 }
 
+void linux_secure_tcp_conn_t::on_write_failed() {
+    if (!closed.is_pulsed()) {
+        shutdown_socket();
+    }
+}
+
 void linux_secure_tcp_conn_t::shutdown_socket() {
     assert_thread();
     rassert(!closed.is_pulsed());
@@ -1258,10 +1381,12 @@ void linux_tcp_conn_descriptor_t::make_server_connection(
 /* Network listener object */
 linux_nonthrowing_tcp_listener_t::linux_nonthrowing_tcp_listener_t(
          const std::set<ip_address_t> &bind_addresses, int _port,
-         const std::function<void(scoped_ptr_t<linux_tcp_conn_descriptor_t> &)> &cb) :
+         const std::function<void(scoped_ptr_t<linux_tcp_conn_descriptor_t> &)> &cb,
+         bool _reuse_port) :
     callback(cb),
     local_addresses(bind_addresses),
     port(_port),
+    reuse_port(_reuse_port),
     bound(false),
     socks(),
     last_used_socket_index(0),
@@ -1360,6 +1485,7 @@ int linux_nonthrowing_tcp_listener_t::init_sockets() {
         // process was binding with `SO_REUSEADDR` before.
         // https://msdn.microsoft.com/en-us/library/windows/desktop/ms740621(v=vs.85).aspx
         // has a table of what this option means.
+        guarantee(!reuse_port, "SO_REUSEPORT is not supported on Windows");
         int res = setsockopt(fd_to_socket(sock_fd), SOL_SOCKET, SO_EXCLUSIVEADDRUSE, reinterpret_cast<char*>(&sockoptval), sizeof(sockoptval));
         guarantee_winerr(res != -1, "Could not set EXCLUSIVEADDRUSE option");
 #else
@@ -1367,6 +1493,13 @@ int linux_nonthrowing_tcp_listener_t::init_sockets() {
         // to be re-bound quickly (e.g. if you restart the server).
         int res = setsockopt(sock_fd, SOL_SOCKET, SO_REUSEADDR, &sockoptval, sizeof(sockoptval)); 
         guarantee_err(res != -1, "Could not set REUSEADDR option");
+        // `SO_REUSEPORT` lets several of our sockets listen on the same port. The
+        // kernel only lets sockets of the same user share a port this way.
+        if (reuse_port) {
+            res = setsockopt(sock_fd, SOL_SOCKET, SO_REUSEPORT,
+                             &sockoptval, sizeof(sockoptval));
+            guarantee_err(res != -1, "Could not set REUSEPORT option");
+        }
 #endif
         /* XXX Making our socket NODELAY prevents the problem where responses to
          * pipelined requests are delayed, since the TCP Nagle algorithm will
@@ -1677,8 +1810,10 @@ int linux_tcp_bound_socket_t::get_port() const {
 }
 
 linux_tcp_listener_t::linux_tcp_listener_t(const std::set<ip_address_t> &bind_addresses, int port,
-    const std::function<void(scoped_ptr_t<linux_tcp_conn_descriptor_t> &)> &callback) :
-        listener(new linux_nonthrowing_tcp_listener_t(bind_addresses, port, callback))
+    const std::function<void(scoped_ptr_t<linux_tcp_conn_descriptor_t> &)> &callback,
+    bool reuse_port) :
+        listener(new linux_nonthrowing_tcp_listener_t(
+            bind_addresses, port, callback, reuse_port))
 {
     if (!listener->begin_listening()) {
         throw address_in_use_exc_t("localhost", listener->get_port());
@@ -1700,6 +1835,47 @@ int linux_tcp_listener_t::get_port() const {
     return listener->get_port();
 }
 
+linux_per_thread_tcp_listener_t::linux_per_thread_tcp_listener_t(
+    const std::set<ip_address_t> &bind_addresses, int _port,
+    const std::function<void(scoped_ptr_t<linux_tcp_conn_descriptor_t> &)> &callback) :
+        listeners(get_num_threads())
+{
+    /* The listener on this thread goes first, so that if we were asked for any port,
+    the others can use the one it got. */
+    const int home_thread = get_thread_id().threadnum;
+    listeners[home_thread].init(
+        new linux_tcp_listener_t(bind_addresses, _port, callback, true));
+    port = listeners[home_thread]->get_port();
+
+    std::atomic<bool> failed(false);
+    pmap_on_all_threads([&](int thread) {
+        if (thread != home_thread) {
+            try {
+                listeners[thread].init(
+                    new linux_tcp_listener_t(bind_addresses, port, callback, true));
+            } catch (const address_in_use_exc_t &) {
+                failed = true;
+            }
+        }
+    });
+    if (failed) {
+        pmap_on_all_threads([&](int thread) {
+            listeners[thread].reset();
+        });
+        throw address_in_use_exc_t("localhost", port);
+    }
+}
+
+linux_per_thread_tcp_listener_t::~linux_per_thread_tcp_listener_t() {
+    pmap_on_all_threads([&](int thread) {
+        listeners[thread].reset();
+    });
+}
+
+int linux_per_thread_tcp_listener_t::get_port() const {
+    return port;
+}
+
 linux_repeated_nonthrowing_tcp_listener_t::linux_repeated_nonthrowing_tcp_listener_t(
     const std::set<ip_address_t> &bind_addresses,
     int port,
@@ -29,6 +29,7 @@
 #include "config/args.hpp"
 #include "concurrency/interruptor.hpp"
 #include "containers/lazy_erase_vector.hpp"
+#include "containers/object_pool.hpp"
 #include "containers/scoped.hpp"
 #include "arch/address.hpp"
 #include "arch/io/event_watcher.hpp"
@@ -41,6 +42,7 @@
 #include "concurrency/semaphore.hpp"
 #include "concurrency/coro_pool.hpp"
 #include "concurrency/exponential_backoff.hpp"
+#include "containers/buffer_group.hpp"
 #include "containers/intrusive_list.hpp"
 #include "crypto/error.hpp"
 #include "perfmon/types.hpp"
@@ -136,6 +138,11 @@ public:
     void write(const void *buf, size_t size, signal_t *closer)
         THROWS_ONLY(tcp_conn_write_closed_exc_t);
 
+    /* write_buffers() is like write(), but writes the contents of all of the buffers
+    in `buffers`, one after the other, without copying them together first. */
+    void write_buffers(const const_buffer_group_t *buffers, signal_t *closer)
+        THROWS_ONLY(tcp_conn_write_closed_exc_t);
+
     /* write_buffered() is like write(), but it might not send the data until
     flush_buffer*() or write() is called. Internally, it bundles together the
     buffered writes; this may improve performance. */
@@ -152,6 +159,10 @@ public:
     void flush_buffer_eventually(signal_t *closer)
         THROWS_ONLY(tcp_conn_write_closed_exc_t);
 
+    /* Returns how many bytes that were written with write_buffered() haven't been
+    handed to the operating system yet. */
+    size_t get_buffered_write_size() const;
+
     /* Call shutdown_write() to close the half of the pipe that goes from us to the peer. If there
     is a write currently happening, it will get tcp_conn_write_closed_exc_t. */
     virtual void shutdown_write();
@@ -178,6 +189,13 @@ protected:
     void on_shutdown_read();
     void on_shutdown_write();
 
+    /* Used to actually perform a write. If the write end of the connection is open, then
+    writes the contents of `buffers` to the socket, in as few system calls as it can. */
+    virtual void perform_write(const const_buffer_group_t *buffers);
+
+    /* Called by `perform_write()` when it can't write to the socket anymore. */
+    virtual void on_write_failed();
+
     // Used by tcp_listener_t and any derived classes.
     explicit linux_tcp_conn_t(fd_t sock);
 
@@ -268,6 +286,9 @@ private:
 
     static const size_t WRITE_QUEUE_MAX_SIZE = 128 * KILOBYTE;
     static const size_t WRITE_CHUNK_SIZE = 8 * KILOBYTE;
+    /* How many queued operations the write coroutine hands to a single
+    `perform_write()` call at most. */
+    static const size_t WRITE_COALESCE_MAX_OPS = 64;
 
     /* Structs to avoid over-using dynamic allocation */
     struct write_buffer_t : public intrusive_list_node_t<write_buffer_t> {
@@ -277,8 +298,10 @@ private:
 
     struct write_queue_op_t : public intrusive_list_node_t<write_queue_op_t> {
         write_buffer_t *dealloc;
+        // Either `buffer` and `size` or `buffers` describe the data to write, if any.
         const void *buffer;
         size_t size;
+        const const_buffer_group_t *buffers;
         cond_t *cond;
         auto_drainer_t::lock_t keepalive;
     };
@@ -291,21 +314,11 @@ private:
         void coro_pool_callback(write_queue_op_t *operation, signal_t *interruptor);
     } write_handler;
 
-    template <class T>
-    class deleting_intrusive_list_t : public intrusive_list_t<T> {
-    public:
-        ~deleting_intrusive_list_t() {
-            while (T *x = this->head()) {
-                this->pop_front();
-                delete x;
-            }
-        }
-    };
-
-    /* Lists of unused buffers, new buffers will be put on this list until needed again, reducing
-       the use of dynamic memory.  TODO: decay over time? */
-    deleting_intrusive_list_t<write_buffer_t> unused_write_buffers;
-    deleting_intrusive_list_t<write_queue_op_t> unused_write_queue_ops;
+    /* Buffers and operations are recycled through per-thread pools that all the
+    connections on a thread share, so that a new connection can reuse the memory of one
+    that closed. */
+    static per_thread_object_pool_t<write_buffer_t> write_buffer_pool;
+    static per_thread_object_pool_t<write_queue_op_t> write_queue_op_pool;
 
     write_buffer_t * get_write_buffer();
     write_queue_op_t * get_write_queue_op();
@@ -318,12 +331,15 @@ private:
     data to be completely written. */
     void internal_flush_write_buffer();
 
-    /* Used to queue up buffers to write. The functions in `write_queue` will all be
-    `std::bind()`s of the `perform_write()` function below. */
+    /* Used to queue up buffers to write. The write coroutine takes the operations off
+    the queue and passes their data to `perform_write()`, several at once when more
+    than one is waiting. */
     unlimited_fifo_queue_t<write_queue_op_t*, intrusive_list_t<write_queue_op_t> > write_queue;
 
     /* This semaphore prevents the write queue from getting arbitrarily big. */
     static_semaphore_t write_queue_limiter;
+    /* The number of bytes in the write buffers on `write_queue`. */
+    size_t write_queue_size;
 
     /* Used to actually perform the writes. Only has one coroutine in it, which will call the
     handle_write_queue callback when operations are ready */
@@ -341,10 +357,6 @@ private:
     virtual size_t read_internal(
         void *buffer, size_t size
     ) THROWS_ONLY(tcp_conn_read_closed_exc_t);
-
-    /* Used to actually perform a write. If the write end of the connection is open, then
-    writes `size` bytes from `buffer` to the socket. */
-    virtual void perform_write(const void *buffer, size_t size);
 };
 
 #ifdef ENABLE_TLS
@@ -405,9 +417,12 @@ private:
     virtual size_t read_internal(void *buffer, size_t size) THROWS_ONLY(
         tcp_conn_read_closed_exc_t);
 
-    /* Used to actually perform a write. If the write end of the connection is open, then
-    writes `size` bytes from `buffer` to the socket. */
-    virtual void perform_write(const void *buffer, size_t size);
+    /* Used to actually perform a write. If the connection is open, then writes the
+    contents of `buffers` to it, one `SSL_write()` per buffer. */
+    virtual void perform_write(const const_buffer_group_t *buffers);
+    void perform_ssl_write(const void *buffer, size_t size);
+
+    virtual void on_write_failed();
 
     void shutdown();
     void shutdown_socket();
@@ -416,6 +431,10 @@ private:
 
     tls_conn_wrapper_t conn;
 
+    /* True if the kernel encrypts what we send (kernel TLS), in which case we write to
+    the socket directly instead of with `SSL_write()`. */
+    bool ktls_send;
+
     cond_t closed;
 };
 
@@ -452,8 +471,11 @@ the provided callback will be called in a new coroutine every time something con
 
 class linux_nonthrowing_tcp_listener_t : private linux_event_callback_t {
 public:
+    /* If `reuse_port` is true, the sockets are bound with `SO_REUSEPORT`, so that other
+    sockets can listen on the same port at the same time and share its connections. */
     linux_nonthrowing_tcp_listener_t(const std::set<ip_address_t> &bind_addresses, int _port,
-        const std::function<void(scoped_ptr_t<linux_tcp_conn_descriptor_t> &)> &callback);
+        const std::function<void(scoped_ptr_t<linux_tcp_conn_descriptor_t> &)> &callback,
+        bool reuse_port = false);
 
     ~linux_nonthrowing_tcp_listener_t();
 
@@ -499,6 +521,9 @@ private:
     // The port we're asked to bind to
     int port;
 
+    // Whether to set `SO_REUSEPORT` on the sockets
+    bool reuse_port;
+
     // Inidicates successful binding to a port
     bool bound;
 
@@ -531,7 +556,8 @@ public:
     linux_tcp_listener_t(linux_tcp_bound_socket_t *bound_socket,
         const std::function<void(scoped_ptr_t<linux_tcp_conn_descriptor_t> &)> &callback);
     linux_tcp_listener_t(const std::set<ip_address_t> &bind_addresses, int port,
-        const std::function<void(scoped_ptr_t<linux_tcp_conn_descriptor_t> &)> &callback);
+        const std::function<void(scoped_ptr_t<linux_tcp_conn_descriptor_t> &)> &callback,
+        bool reuse_port = false);
 
     int get_port() const;
 
@@ -539,6 +565,27 @@ private:
     scoped_ptr_t<linux_nonthrowing_tcp_listener_t> listener;
 };
 
+/* Listens on a port with a separate socket on every thread, all of them bound with
+`SO_REUSEPORT`, so that the kernel spreads the incoming connections over the threads.
+The callback is called on the thread that accepted the connection, so neither the
+accepting nor the handling of connections is funneled through one thread. Throws
+`address_in_use_exc_t` like `linux_tcp_listener_t`. Not supported on Windows. */
+class linux_per_thread_tcp_listener_t {
+public:
+    linux_per_thread_tcp_listener_t(const std::set<ip_address_t> &bind_addresses, int port,
+        const std::function<void(scoped_ptr_t<linux_tcp_conn_descriptor_t> &)> &callback);
+    ~linux_per_thread_tcp_listener_t();
+
+    int get_port() const;
+
+private:
+    // `listeners[i]` lives on thread `i`.
+    scoped_array_t<scoped_ptr_t<linux_tcp_listener_t> > listeners;
+    int port;
+
+    DISABLE_COPYING(linux_per_thread_tcp_listener_t);
+};
+
 /* Like a linux tcp listener but repeatedly tries to bind to its port until successful */
 class linux_repeated_nonthrowing_tcp_listener_t {
 public:
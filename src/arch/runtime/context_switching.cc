@@ -422,6 +422,26 @@ size_t artificial_stack_t::free_space_below(const void *addr) const {
     return reinterpret_cast<uintptr_t>(addr) - lowest_valid_address;
 }
 
+void artificial_stack_t::release_deep_pages(size_t retained_size) {
+    const size_t page_size = getpagesize();
+    retained_size = ceil_aligned(retained_size, page_size);
+    if (retained_size >= stack_size) {
+        return;
+    }
+    char *const boundary = stack.get() + stack_size - retained_size;
+
+    /* Released pages read as zeros, so the word right below the retained part is zero
+    unless something wrote to it since.  A coroutine that went deeper than that has
+    almost certainly put a stack frame over it.  Checking that one word is a lot cheaper
+    than calling `madvise` every time. */
+    const uintptr_t *const probe = reinterpret_cast<const uintptr_t *>(boundary) - 1;
+    if (*probe == 0) {
+        return;
+    }
+    int res = madvise(stack.get(), boundary - stack.get(), MADV_DONTNEED);
+    guarantee_err(res == 0, "madvise failed on a coroutine stack");
+}
+
 extern "C" {
 // `lightweight_swapcontext` is defined in assembly further down.  If we didn't add the
 // asm("_lightweight_swapcontext") here, we'd have to conditionally compile the symbol name in the
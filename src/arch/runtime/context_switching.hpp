@@ -28,6 +28,9 @@ public:
     I think fibers always have some overflow protection though? */
     void enable_overflow_protection() {}
     void disable_overflow_protection() {}
+
+    /* Not implemented for fiber stacks. */
+    void release_deep_pages(size_t) {}
 };
 
 void context_switch(fiber_context_ref_t *current_context_out, fiber_context_ref_t *dest_context_in);
@@ -108,6 +111,11 @@ public:
     /* Disables stack-smashing protection for this stack, if currently enabled */
     void disable_overflow_protection();
 
+    /* Gives the pages that are more than `retained_size` below the base of the stack
+    back to the operating system, if they look like they have been used.  Nothing may
+    be using that part of the stack. */
+    void release_deep_pages(size_t retained_size);
+
 private:
     scoped_page_aligned_ptr_t<char> stack;
     size_t stack_size;
@@ -224,9 +232,10 @@ public:
     /* Returns how many more bytes below the given address can be used */
     size_t free_space_below(const void *addr) const;
 
-    /* These two are currently not implemented for threaded stacks. */
+    /* These three are currently not implemented for threaded stacks. */
     void enable_overflow_protection() {}
     void disable_overflow_protection() {}
+    void release_deep_pages(size_t) {}
 
 private:
     static void *internal_run(void *p);
@@ -0,0 +1,117 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#include "arch/runtime/coro_sampler.hpp"
+
+#include <inttypes.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "arch/runtime/coroutines.hpp"
+#include "arch/runtime/runtime.hpp"
+#include "backtrace.hpp"
+#include "rethinkdb_backtrace.hpp"
+#include "utils.hpp"
+
+coro_sampler_t &coro_sampler_t::get_global_sampler() {
+    static coro_sampler_t sampler;
+    return sampler;
+}
+
+coro_sampler_t::coro_sampler_t() : sample_interval(0) { }
+
+void coro_sampler_t::set_sample_interval(uint64_t interval) {
+    sample_interval.store(interval, std::memory_order_relaxed);
+}
+
+uint64_t coro_sampler_t::get_sample_interval() const {
+    return sample_interval.load(std::memory_order_relaxed);
+}
+
+void coro_sampler_t::reset() {
+    for (auto &thread_samples : per_thread_samples) {
+        spinlock_acq_t lock(&thread_samples.value.lock);
+        thread_samples.value.counts.clear();
+    }
+}
+
+void coro_sampler_t::record_sample() {
+    const uint64_t interval = sample_interval.load(std::memory_order_relaxed);
+    if (interval == 0) {
+        return;
+    }
+    per_thread_samples_t *thread_samples =
+        &per_thread_samples[get_thread_id().threadnum].value;
+    // The second check catches a countdown left over from a larger interval.
+    if (thread_samples->countdown > 0 && thread_samples->countdown < interval) {
+        --thread_samples->countdown;
+        return;
+    }
+    thread_samples->countdown = interval - 1;
+
+    // We strip ourselves, `coro_t::wait()`, and the frames that are inside
+    // `rethinkdb_backtrace()`.
+    const int levels_to_strip = 2 + NUM_FRAMES_INSIDE_RETHINKDB_BACKTRACE;
+    const int max_frames = CORO_SAMPLER_BACKTRACE_DEPTH + levels_to_strip;
+    void *stack_frames[max_frames];
+    int backtrace_size = rethinkdb_backtrace(stack_frames, max_frames);
+    backtrace_size = std::max(backtrace_size, levels_to_strip);
+    const int remaining_size = max_frames - backtrace_size;
+    if (remaining_size > 0) {
+        backtrace_size += coro_t::self()->copy_spawn_backtrace(
+            stack_frames + backtrace_size, remaining_size);
+    }
+
+    trace_t trace;
+    trace.fill(nullptr);
+    std::copy(stack_frames + levels_to_strip, stack_frames + backtrace_size,
+              trace.begin());
+
+    spinlock_acq_t lock(&thread_samples->lock);
+    ++thread_samples->counts[trace];
+}
+
+std::string coro_sampler_t::get_folded_stacks() {
+    std::map<trace_t, uint64_t> counts;
+    for (auto &thread_samples : per_thread_samples) {
+        spinlock_acq_t lock(&thread_samples.value.lock);
+        for (const auto &pair : thread_samples.value.counts) {
+            counts[pair.first] += pair.second;
+        }
+    }
+
+    std::map<void *, std::string> frame_names;
+    std::string result;
+    for (const auto &pair : counts) {
+        // The traces are stored innermost frame first, but folded stacks start with
+        // the outermost one.
+        std::vector<void *> frames;
+        for (void *addr : pair.first) {
+            if (addr == nullptr) {
+                break;
+            }
+            frames.push_back(addr);
+        }
+        for (auto it = frames.rbegin(); it != frames.rend(); ++it) {
+            auto name_it = frame_names.find(*it);
+            if (name_it == frame_names.end()) {
+                backtrace_frame_t frame(*it);
+                frame.initialize_symbols();
+                std::string name;
+                try {
+                    name = frame.get_demangled_name();
+                } catch (const demangle_failed_exc_t &) {
+                    name = strprintf("%p", *it);
+                }
+                // ';' separates frames in the folded format.
+                std::replace(name.begin(), name.end(), ';', ',');
+                name_it = frame_names.insert(std::make_pair(*it, name)).first;
+            }
+            if (it != frames.rbegin()) {
+                result += ";";
+            }
+            result += name_it->second;
+        }
+        result += strprintf(" %" PRIu64 "\n", pair.second);
+    }
+    return result;
+}
@@ -0,0 +1,73 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#ifndef ARCH_RUNTIME_CORO_SAMPLER_HPP_
+#define ARCH_RUNTIME_CORO_SAMPLER_HPP_
+
+#include <stdint.h>
+
+#include <array>
+#include <atomic>
+#include <map>
+#include <string>
+
+#include "arch/spinlock.hpp"
+#include "concurrency/cache_line_padded.hpp"
+#include "config/args.hpp"
+#include "errors.hpp"
+
+// How many frames of each sampled backtrace we keep.  In builds with
+// `CROSS_CORO_BACKTRACES`, the frames that spawned the coroutine follow the frames
+// of the blocking site.
+#define CORO_SAMPLER_BACKTRACE_DEPTH            32
+
+/* `coro_sampler_t` is a sampling counterpart to `coro_profiler_t` that is compiled
+ * into every build.  It starts out turned off, in which case the only thing it costs
+ * is one relaxed atomic load every time a coroutine blocks.  Once it is given a
+ * sample interval of N, every Nth call to `coro_t::wait()` on each thread records
+ * where the coroutine blocked (and, if the build keeps them, where it was spawned).
+ *
+ * The samples can be written out as "folded" stacks, one line per distinct stack
+ * with its outermost frame first, followed by a space and the number of samples.
+ * That is the input format of `flamegraph.pl` and most other flame graph tools. */
+class coro_sampler_t {
+public:
+    static coro_sampler_t &get_global_sampler();
+
+    // Called from `coro_t::wait()`.
+    void on_coro_wait() {
+        if (sample_interval.load(std::memory_order_relaxed) != 0) {
+            record_sample();
+        }
+    }
+
+    // 0 turns sampling off.
+    void set_sample_interval(uint64_t interval);
+    uint64_t get_sample_interval() const;
+
+    // Throws away the samples that have been recorded so far.
+    void reset();
+
+    // Symbolizes the recorded samples and returns them in folded-stack format.
+    std::string get_folded_stacks();
+
+private:
+    typedef std::array<void *, CORO_SAMPLER_BACKTRACE_DEPTH> trace_t;
+
+    struct per_thread_samples_t {
+        per_thread_samples_t() : countdown(0) { }
+        spinlock_t lock;
+        // Only touched by the thread itself, so it doesn't need `lock`.
+        uint64_t countdown;
+        std::map<trace_t, uint64_t> counts;
+    };
+
+    coro_sampler_t();
+
+    void record_sample();
+
+    std::atomic<uint64_t> sample_interval;
+    std::array<cache_line_padded_t<per_thread_samples_t>, MAX_THREADS> per_thread_samples;
+
+    DISABLE_COPYING(coro_sampler_t);
+};
+
+#endif  // ARCH_RUNTIME_CORO_SAMPLER_HPP_
@@ -1,9 +1,11 @@
 // Copyright 2010-2014 RethinkDB, all rights reserved.
 #include "arch/runtime/coroutines.hpp"
 
+#include <inttypes.h>
 #include <stdio.h>
 #include <string.h>
 
+#include <atomic>
 #include <functional>
 #ifndef NDEBUG
 #include <map>
@@ -13,12 +15,15 @@
 
 #include "arch/runtime/context_switching.hpp"
 #include "arch/runtime/coro_profiler.hpp"
+#include "arch/runtime/coro_sampler.hpp"
 #include "arch/runtime/runtime.hpp"
 #include "arch/runtime/thread_pool.hpp"
+#include "backtrace.hpp"
 #include "config/args.hpp"
 #include "debug.hpp"
 #include "do_on_thread.hpp"
 #include "logger.hpp"
+#include "perfmon/memory.hpp"
 #include "perfmon/perfmon.hpp"
 #include "rethinkdb_backtrace.hpp"
 #include "thread_local.hpp"
@@ -75,6 +80,21 @@ struct coro_globals_t {
     used protected coroutine is always at the front of the list. */
     intrusive_list_t<coro_lru_entry_t> protected_coros_lru;
 
+    /* When `coro_t::maybe_yield()` is going to yield, or 0 if it hasn't looked at the
+    clock since the current coroutine was resumed, and how many more calls to it there
+    are before it looks at the clock again. */
+    int64_t yield_deadline_nanos;
+    int calls_until_yield_clock_check;
+
+    /* How many times a coroutine was resumed on this thread; see
+    `coro_t::resume_count()`. */
+    uint64_t resume_count;
+
+    /* When the current coroutine was resumed, if stall warnings are on, and when we
+    last warned about a stall. */
+    int64_t resumed_at_nanos;
+    int64_t last_stall_warning_nanos;
+
 #ifndef NDEBUG
 
     /* An integer counting the number of coros on this thread */
@@ -103,6 +123,11 @@ struct coro_globals_t {
     coro_globals_t()
         : current_coro(nullptr)
         , prev_coro(nullptr)
+        , yield_deadline_nanos(0)
+        , calls_until_yield_clock_check(0)
+        , resume_count(0)
+        , resumed_at_nanos(0)
+        , last_stall_warning_nanos(0)
 #ifndef NDEBUG
         , coro_count(0)
         , printed_high_coro_count_warning(false)
@@ -180,6 +205,7 @@ coro_t::coro_t() :
 #endif
 {
     ++pm_allocated_coroutines;
+    track_memory(memory_tag_t::coroutine_stacks, coro_stack_size);
 
 #ifndef NDEBUG
     TLS_get_cglobals()->coro_count++;
@@ -205,6 +231,8 @@ void coro_t::return_coro_to_free_list(coro_t *coro) {
         delete coro_to_delete;
     }
     rassert(cglobals->free_coros.size() < COROUTINE_FREE_LIST_SIZE);
+    // This can run on `coro`'s own stack, but only on the top few frames of it.
+    coro->stack.release_deep_pages(COROUTINE_STACK_RETAINED_SIZE);
     cglobals->free_coros.push_back(coro);
 }
 
@@ -216,6 +244,7 @@ coro_t::~coro_t() {
     TLS_get_cglobals()->coro_count--;
 #endif
     --pm_allocated_coroutines;
+    track_memory(memory_tag_t::coroutine_stacks, -static_cast<int64_t>(coro_stack_size));
 }
 
 /* Helper function for switching into a new context and making sure that the new context
@@ -274,7 +303,9 @@ void coro_t::run() {
         TLS_get_cglobals()->active_coroutines.insert(coro);
 #endif
         PROFILER_CORO_RESUME;
+        note_resumed();
         coro->action_wrapper.run();
+        note_stopping();
         PROFILER_CORO_YIELD(0);
 #ifndef NDEBUG
         TLS_get_cglobals()->running_coroutine_counts[coro->coroutine_type]--;
@@ -357,10 +388,12 @@ void coro_t::wait() {   /* class method */
         "This code path is not supposed to use coro_t::wait().\nConstraint imposed at: %s:%d",
         TLS_get_cglobals()->no_waiting_call_sites.top().first, TLS_get_cglobals()->no_waiting_call_sites.top().second);
 
+    note_stopping();
     rassert(!self()->waiting_);
     self()->waiting_ = true;
 
     PROFILER_CORO_YIELD(1);
+    coro_sampler_t::get_global_sampler().on_coro_wait();
     if (TLS_get_cglobals()->prev_coro) {
         TLS_get_cglobals()->prev_coro->switch_to_coro_with_protection(
             &self()->stack.context);
@@ -372,6 +405,62 @@ void coro_t::wait() {   /* class method */
     rassert(self());
     rassert(self()->waiting_);
     self()->waiting_ = false;
+    note_resumed();
+}
+
+void coro_t::maybe_yield() {  /* class method */
+    coro_globals_t *cglobals = TLS_get_cglobals();
+    if (cglobals->calls_until_yield_clock_check > 0) {
+        --cglobals->calls_until_yield_clock_check;
+        return;
+    }
+    cglobals->calls_until_yield_clock_check = COROUTINE_YIELD_CLOCK_CHECK_INTERVAL - 1;
+    const int64_t now = get_ticks().nanos;
+    if (cglobals->yield_deadline_nanos == 0) {
+        cglobals->yield_deadline_nanos = now + COROUTINE_YIELD_BUDGET_MS * MILLION;
+    } else if (now >= cglobals->yield_deadline_nanos) {
+        yield();
+    }
+}
+
+static std::atomic<int64_t> stall_warning_nanos(0);
+
+void coro_t::set_stall_warning_ms(int64_t ms) {  /* class method */
+    rassert(ms >= 0);
+    stall_warning_nanos.store(ms * MILLION, std::memory_order_relaxed);
+}
+
+uint64_t coro_t::resume_count() {  /* class method */
+    return TLS_get_cglobals()->resume_count;
+}
+
+void coro_t::note_resumed() {  /* class method */
+    coro_globals_t *cglobals = TLS_get_cglobals();
+    cglobals->yield_deadline_nanos = 0;
+    cglobals->calls_until_yield_clock_check = 0;
+    ++cglobals->resume_count;
+    if (stall_warning_nanos.load(std::memory_order_relaxed) != 0) {
+        cglobals->resumed_at_nanos = get_ticks().nanos;
+    }
+}
+
+void coro_t::note_stopping() {  /* class method */
+    const int64_t threshold = stall_warning_nanos.load(std::memory_order_relaxed);
+    coro_globals_t *cglobals = TLS_get_cglobals();
+    if (threshold == 0 || cglobals->resumed_at_nanos == 0) {
+        return;
+    }
+    const int64_t now = get_ticks().nanos;
+    const int64_t running_nanos = now - cglobals->resumed_at_nanos;
+    cglobals->resumed_at_nanos = 0;
+    if (running_nanos > threshold
+        && now - cglobals->last_stall_warning_nanos > secs_to_ticks(1).nanos) {
+        cglobals->last_stall_warning_nanos = now;
+        logWRN("A coroutine kept thread %d busy for %" PRIi64 " ms without yielding. "
+               "It gave up the thread here:\n%s",
+               get_thread_id().threadnum, running_nanos / static_cast<int64_t>(MILLION),
+               backtrace_t().print_frames(false).c_str());
+    }
 }
 
 void coro_t::yield() {  /* class method */
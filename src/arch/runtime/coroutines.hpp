@@ -105,6 +105,23 @@ public:
     `yield_ordered()` is maintained. */
     static void yield_ordered();
 
+    /* Calls `yield()` if the current coroutine has been running for more than
+    `COROUTINE_YIELD_BUDGET_MS` since the first call to `maybe_yield()` after it was
+    last resumed.  Only every `COROUTINE_YIELD_CLOCK_CHECK_INTERVAL`th call looks at the
+    clock, so it is cheap enough to call in every iteration of a tight loop (as long as
+    it is safe to yield there). */
+    static void maybe_yield();
+
+    /* If `ms` is not zero, every time a coroutine has been running for longer than
+    `ms` without giving up the thread, we log a warning with a backtrace of the place
+    where it finally did (at most once a second per thread).  Zero (the default)
+    turns this off. */
+    static void set_stall_warning_ms(int64_t ms);
+
+    /* How many times a coroutine has been resumed on this thread. If it is the same at
+    two points in the current coroutine, the coroutine kept the thread in between. */
+    static uint64_t resume_count();
+
     /* Returns a pointer to the current coroutine, or `NULL` if we are not in a
     coroutine. */
     static coro_t *self();
@@ -209,6 +226,11 @@ private:
 
     static void return_coro_to_free_list(coro_t *coro);
 
+    // Keep track of when the thread starts and stops running coroutine code, for
+    // `maybe_yield()` and the stall warnings.
+    static void note_resumed();
+    static void note_stopping();
+
     NORETURN static void run();
 
     friend class coro_profiler_t;
@@ -59,7 +59,7 @@ void epoll_event_queue_t::run() {
     // Now, start the loop
     while (!parent->should_shut_down()) {
         // Grab the events from the kernel!
-        res = epoll_wait(epoll_fd, events, MAX_IO_EVENT_PROCESSING_BATCH_SIZE, -1);
+        res = wait_for_events();
 
         // epoll_wait might return with EINTR in some cases (in
         // particular under GDB), we just need to retry.
@@ -122,6 +122,29 @@ void epoll_event_queue_t::run() {
     }
 }
 
+int epoll_event_queue_t::wait_for_events() {
+    const int64_t spin_usecs = linux_thread_pool_t::get_event_loop_spin_usecs();
+    if (spin_usecs > 0) {
+        // Going to sleep in `epoll_wait` and being woken up again takes a lot longer
+        // than a short spin, so we poll without blocking for a while first.
+        const bool began_spinning = parent->begin_spinning();
+        const int64_t deadline = get_ticks().nanos + spin_usecs * THOUSAND;
+        int res;
+        do {
+            res = epoll_wait(epoll_fd, events, MAX_IO_EVENT_PROCESSING_BATCH_SIZE, 0);
+        } while (res == 0
+                 && !parent->has_new_messages()
+                 && get_ticks().nanos < deadline);
+        // If messages came in, this notifies the message hub's event, so the
+        // `epoll_wait` below returns right away.
+        parent->end_spinning(began_spinning);
+        if (res != 0) {
+            return res;
+        }
+    }
+    return epoll_wait(epoll_fd, events, MAX_IO_EVENT_PROCESSING_BATCH_SIZE, -1);
+}
+
 epoll_event_queue_t::~epoll_event_queue_t() {
     DEBUG_VAR int res = close(epoll_fd);
     rassert_err(res == 0, "Could not close epoll_fd");
@@ -30,6 +30,9 @@ public:
     void forget_event(system_event_t *, linux_event_callback_t *cb);
 
 private:
+    // Busy-polls for a while first, if that's turned on.
+    int wait_for_events();
+
     linux_queue_parent_t *parent;
 
     fd_t epoll_fd;
@@ -15,6 +15,15 @@ struct linux_event_callback_t {
 struct linux_queue_parent_t {
     virtual void pump() = 0;
     virtual bool should_shut_down() = 0;
+
+    /* For busy-polling.  The event queue calls `begin_spinning()` before it polls
+    for events without blocking, and passes what it returned to `end_spinning()`
+    before it blocks again.  In between, other threads don't notify the queue of the
+    messages they send to this thread, so the queue has to check
+    `has_new_messages()` itself. */
+    virtual bool begin_spinning() = 0;
+    virtual bool has_new_messages() = 0;
+    virtual void end_spinning(bool began_spinning) = 0;
     virtual ~linux_queue_parent_t() {}
 };
 
@@ -24,6 +24,7 @@ linux_message_hub_t::linux_message_hub_t(linux_event_queue_t *queue,
     : queue_(queue),
       thread_pool_(thread_pool),
       is_woken_up_(false),
+      incoming_messages_(nullptr),
       current_thread_(current_thread) {
 
 #ifndef NDEBUG
@@ -47,7 +48,7 @@ linux_message_hub_t::~linux_message_hub_t() {
         guarantee(get_priority_msg_list(p).empty());
     }
 
-    guarantee(incoming_messages_.empty());
+    guarantee(incoming_messages_.load() == nullptr);
 }
 
 void linux_message_hub_t::do_store_message(threadnum_t nthread, linux_thread_message_t *msg) {
@@ -94,19 +95,57 @@ void linux_message_hub_t::store_message_sometime(threadnum_t nthread, linux_thre
 
 
 void linux_message_hub_t::insert_external_message(linux_thread_message_t *msg) {
-    bool do_wake_up;
-    {
-        spinlock_acq_t acq(&incoming_messages_lock_);
-        do_wake_up = !check_and_set_is_woken_up();
-        incoming_messages_.push_back(msg);
-    }
+    msg_list_t msgs;
+    msgs.push_back(msg);
+    push_incoming_messages(&msgs);
+}
 
-    // Wakey wakey eggs and bakey
-    if (do_wake_up) {
+void linux_message_hub_t::push_incoming_messages(msg_list_t *msgs) {
+    // Link the messages newest first, so that they go onto the stack with a single
+    // compare-and-swap and come off it in order.
+    linux_thread_message_t *newest = nullptr;
+    linux_thread_message_t *oldest = nullptr;
+    while (linux_thread_message_t *m = msgs->head()) {
+        msgs->remove(m);
+        m->next_incoming_ = newest;
+        if (oldest == nullptr) {
+            oldest = m;
+        }
+        newest = m;
+    }
+    if (newest == nullptr) {
+        return;
+    }
+    linux_thread_message_t *top = incoming_messages_.load();
+    do {
+        oldest->next_incoming_ = top;
+    } while (!incoming_messages_.compare_exchange_weak(top, newest));
+
+    // We only need to do a wake up if we're the first people to do a wake up.
+    if (!is_woken_up_.exchange(true)) {
+        // Wakey wakey eggs and bakey
         event_.wakey_wakey();
     }
 }
 
+bool linux_message_hub_t::begin_spinning() {
+    // Pretending that we were already woken up keeps other threads from notifying us.
+    return !is_woken_up_.exchange(true);
+}
+
+bool linux_message_hub_t::has_incoming_messages() const {
+    return incoming_messages_.load() != nullptr;
+}
+
+void linux_message_hub_t::end_spinning(bool began_spinning) {
+    if (began_spinning) {
+        is_woken_up_.store(false);
+        if (incoming_messages_.load() != nullptr && !is_woken_up_.exchange(true)) {
+            event_.wakey_wakey();
+        }
+    }
+}
+
 linux_message_hub_t::msg_list_t &linux_message_hub_t::get_priority_msg_list(int priority) {
     rassert(priority >= MESSAGE_SCHEDULER_MIN_PRIORITY);
     rassert(priority <= MESSAGE_SCHEDULER_MAX_PRIORITY);
@@ -178,12 +217,7 @@ void linux_message_hub_t::on_event(int events) {
             // Place wakey_wakey and then yield to the event processing.
             // It will wake us up again immediately, but can handle a few
             // OS events (such as timers, network messages etc.) in the meantime.
-            bool do_wake_up;
-            {
-                spinlock_acq_t acq(&incoming_messages_lock_);
-                do_wake_up = !check_and_set_is_woken_up();
-            }
-            if (do_wake_up) {
+            if (!is_woken_up_.exchange(true)) {
                 event_.wakey_wakey();
             }
             break;
@@ -192,17 +226,17 @@ void linux_message_hub_t::on_event(int events) {
 }
 
 void linux_message_hub_t::sort_incoming_messages_by_priority() {
-    // We do this in two steps to release the spinlock faster.
-    // append_and_clear is a very cheap operation, while
-    // assigning each message to a different priority queue
-    // is more expensive.
-
-    // 1. Pull the messages
+    // 1. Pull the messages.  We clear is_woken_up_ first, so that anybody who pushes
+    // messages after we take the stack wakes us up again.
+    is_woken_up_.store(false);
+    linux_thread_message_t *m = incoming_messages_.exchange(nullptr);
     msg_list_t new_messages;
-    {
-        spinlock_acq_t acq(&incoming_messages_lock_);
-        new_messages.append_and_clear(&incoming_messages_);
-        is_woken_up_ = false;
+    while (m != nullptr) {
+        // The stack is newest first, so this puts the messages back in order.
+        linux_thread_message_t *next = m->next_incoming_;
+        m->next_incoming_ = nullptr;
+        new_messages.push_front(m);
+        m = next;
     }
 
     // 2. Sort the messages into their respective priority queues
@@ -221,12 +255,6 @@ void linux_message_hub_t::sort_incoming_messages_by_priority() {
     }
 }
 
-bool linux_message_hub_t::check_and_set_is_woken_up() {
-    const bool was_woken_up = is_woken_up_;
-    is_woken_up_ = true;
-    return was_woken_up;
-}
-
 // Pushes messages collected locally global lists available to all
 // threads.
 void linux_message_hub_t::push_messages() {
@@ -236,23 +264,8 @@ void linux_message_hub_t::push_messages() {
         thread_queue_t *queue = &queues_[i];
         if (!queue->msg_local_list.empty()) {
             // Transfer messages to the other core
-
-            bool do_wake_up;
-            {
-                spinlock_acq_t acq(&thread_pool_->threads[i]->message_hub.incoming_messages_lock_);
-
-                // We only need to do a wake up if we're the first people to do a
-                // wake up.
-                do_wake_up =
-                    !thread_pool_->threads[i]->message_hub.check_and_set_is_woken_up();
-
-                thread_pool_->threads[i]->message_hub.incoming_messages_.append_and_clear(&queue->msg_local_list);
-            }
-
-            // Wakey wakey, perhaps eggs and bakey
-            if (do_wake_up) {
-                thread_pool_->threads[i]->message_hub.event_.wakey_wakey();
-            }
+            thread_pool_->threads[i]->message_hub.push_incoming_messages(
+                &queue->msg_local_list);
         }
     }
 }
@@ -4,6 +4,8 @@
 
 #include <pthread.h>
 
+#include <atomic>
+
 #include "arch/runtime/event_queue.hpp"
 #include "arch/runtime/runtime_utils.hpp"
 #include "arch/runtime/system_event.hpp"
@@ -48,6 +50,14 @@ public:
     // (which does not have an event queue)
     void insert_external_message(linux_thread_message_t *msg);
 
+    // While the event queue busy-polls, other threads don't notify event_ of the
+    // messages they send us.  `begin_spinning()` returns false if a notification was
+    // already pending, in which case it doesn't suppress anything.  `end_spinning()`
+    // notifies event_ of any messages that came in while we were spinning.
+    bool begin_spinning();
+    bool has_incoming_messages() const;
+    void end_spinning(bool began_spinning);
+
     ~linux_message_hub_t();
 
 private:
@@ -55,6 +65,10 @@ private:
     // debug mode.
     void do_store_message(threadnum_t nthread, linux_thread_message_t *msg);
 
+    // Called by other threads' message hubs to move `msgs` onto our incoming_messages_,
+    // waking us up if we aren't already awake.
+    void push_incoming_messages(msg_list_t *msgs);
+
     // Moves messages from incoming_messages_ into the respective entries of
     // priority_msg_lists, depending on the messages' priorities.
     void sort_incoming_messages_by_priority();
@@ -68,16 +82,18 @@ private:
     struct thread_queue_t {
         //TODO this doesn't need to be a class anymore
 
-        /* Messages are cached here before being pushed to the global list so that we don't
-        have to acquire the spinlock as often */
+        /* Messages are cached here before being pushed to the other thread's incoming
+        messages so that we don't have to contend for them as often */
         msg_list_t msg_local_list;
     } queues_[MAX_THREADS];
 
-    // Must only be used with acquired incoming_messages_lock_
-    bool check_and_set_is_woken_up();
-    bool is_woken_up_;
-    msg_list_t incoming_messages_;
-    spinlock_t incoming_messages_lock_;
+    // True from when the first incoming message is pushed until we take the incoming
+    // messages, so that only that first push notifies event_.
+    std::atomic<bool> is_woken_up_;
+    // A lock-free stack of messages from other threads, linked by `next_incoming_`
+    // and newest first.  Other threads push onto it with a compare-and-swap, and we
+    // take the whole stack at once.
+    std::atomic<linux_thread_message_t *> incoming_messages_;
 
     // Use `sort_incoming_messages_by_priority()` to sort incoming_messages_ into
     // these lists.
@@ -0,0 +1,209 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#include "arch/runtime/numa.hpp"
+
+#include <sched.h>
+
+#include <algorithm>
+
+#include "arch/runtime/runtime_utils.hpp"
+#include "paths.hpp"
+#include "utils.hpp"
+
+namespace {
+
+struct numa_topology_t {
+    numa_topology_t() {
+#ifdef __linux__
+        std::string online;
+        std::vector<int> nodes;
+        if (blocking_read_file("/sys/devices/system/node/online", &online)
+            && parse_cpu_list(online, &nodes)) {
+            for (int node : nodes) {
+                std::string cpulist;
+                std::vector<int> cpus;
+                if (!blocking_read_file(
+                        strprintf("/sys/devices/system/node/node%d/cpulist",
+                                  node).c_str(),
+                        &cpulist)
+                    || !parse_cpu_list(cpulist, &cpus)) {
+                    // We don't know enough to make use of the topology.
+                    node_cpus.clear();
+                    break;
+                }
+                // Memory-only nodes don't get any threads.
+                if (!cpus.empty()
+                    && node_cpus.size() < static_cast<size_t>(MAX_NUMA_NODES)) {
+                    node_cpus.push_back(std::move(cpus));
+                }
+            }
+        }
+#endif
+        if (node_cpus.empty()) {
+            std::vector<int> cpus;
+            for (int i = 0; i < get_cpu_count(); ++i) {
+                cpus.push_back(i);
+            }
+            node_cpus.push_back(std::move(cpus));
+        }
+    }
+
+    std::vector<std::vector<int> > node_cpus;
+};
+
+const numa_topology_t &get_numa_topology() {
+    static const numa_topology_t topology;
+    return topology;
+}
+
+thread_placement_t thread_placement;
+
+}  // namespace
+
+int get_numa_node_count() {
+    return get_numa_topology().node_cpus.size();
+}
+
+const std::vector<int> &get_numa_node_cpus(int node) {
+    guarantee(node >= 0 && node < get_numa_node_count());
+    return get_numa_topology().node_cpus[node];
+}
+
+int numa_node_for_thread(int threadnum, int num_db_threads, int num_nodes) {
+    guarantee(threadnum >= 0 && threadnum < num_db_threads);
+    guarantee(num_nodes > 0);
+    return static_cast<int64_t>(threadnum) * num_nodes / num_db_threads;
+}
+
+int get_thread_numa_node(threadnum_t thread) {
+    const int num_nodes = get_numa_node_count();
+    if (num_nodes == 1 || thread.threadnum < 0
+        || thread.threadnum >= get_num_db_threads()) {
+        return 0;
+    }
+    return numa_node_for_thread(thread.threadnum, get_num_db_threads(), num_nodes);
+}
+
+bool parse_cpu_list(const std::string &list, std::vector<int> *cpus_out) {
+    cpus_out->clear();
+    const char *p = list.c_str();
+    while (*p != '\0' && *p != '\n') {
+        const char *end;
+        const uint64_t first = strtou64_strict(p, &end, 10);
+        if (end == p) {
+            return false;
+        }
+        uint64_t last = first;
+        p = end;
+        if (*p == '-') {
+            ++p;
+            last = strtou64_strict(p, &end, 10);
+            if (end == p || last < first) {
+                return false;
+            }
+            p = end;
+        }
+        if (last >= 1 << 16) {
+            return false;
+        }
+        for (uint64_t cpu = first; cpu <= last; ++cpu) {
+            cpus_out->push_back(cpu);
+        }
+        if (*p == ',') {
+            ++p;
+        } else if (*p != '\0' && *p != '\n') {
+            return false;
+        }
+    }
+    return true;
+}
+
+std::string format_cpu_list(const std::vector<int> &cpus) {
+    std::vector<int> sorted = cpus;
+    std::sort(sorted.begin(), sorted.end());
+    sorted.erase(std::unique(sorted.begin(), sorted.end()), sorted.end());
+    std::string result;
+    for (size_t i = 0; i < sorted.size(); ) {
+        size_t j = i;
+        while (j + 1 < sorted.size() && sorted[j + 1] == sorted[j] + 1) {
+            ++j;
+        }
+        if (!result.empty()) {
+            result += ",";
+        }
+        result += j == i
+            ? strprintf("%d", sorted[i])
+            : strprintf("%d-%d", sorted[i], sorted[j]);
+        i = j + 1;
+    }
+    return result;
+}
+
+bool parse_cpu_set(const std::string &spec, std::vector<int> *cpus_out) {
+    const std::string node_prefix = "node:";
+    if (spec.compare(0, node_prefix.size(), node_prefix) != 0) {
+        return parse_cpu_list(spec, cpus_out) && !cpus_out->empty();
+    }
+    std::vector<int> nodes;
+    if (!parse_cpu_list(spec.substr(node_prefix.size()), &nodes) || nodes.empty()) {
+        return false;
+    }
+    cpus_out->clear();
+    for (int node : nodes) {
+        if (node >= get_numa_node_count()) {
+            return false;
+        }
+        const std::vector<int> &cpus = get_numa_node_cpus(node);
+        cpus_out->insert(cpus_out->end(), cpus.begin(), cpus.end());
+    }
+    return true;
+}
+
+bool is_cpu_available(int cpu) {
+#ifdef _GNU_SOURCE
+    cpu_set_t mask;
+    CPU_ZERO(&mask);
+    if (cpu < 0 || cpu >= CPU_SETSIZE
+        || sched_getaffinity(0, sizeof(mask), &mask) != 0) {
+        return false;
+    }
+    return CPU_ISSET(cpu, &mask);
+#else
+    return cpu >= 0 && cpu < get_cpu_count();
+#endif
+}
+
+void set_thread_placement(const thread_placement_t &placement) {
+    thread_placement = placement;
+}
+
+const thread_placement_t &get_thread_placement() {
+    return thread_placement;
+}
+
+std::map<std::string, std::string> describe_thread_placement() {
+    std::map<std::string, std::string> result;
+    if (!thread_placement.event_loop_cpus.empty()) {
+        result["event_loop"] = format_cpu_list(thread_placement.event_loop_cpus);
+    }
+    if (!thread_placement.utility_thread_cpus.empty()) {
+        result["utility"] = format_cpu_list(thread_placement.utility_thread_cpus);
+    }
+    if (!thread_placement.blocker_pool_cpus.empty()) {
+        result["blocker_pool"] = format_cpu_list(thread_placement.blocker_pool_cpus);
+    }
+    return result;
+}
+
+bool set_thread_cpus(UNUSED pthread_t thread, UNUSED const std::vector<int> &cpus) {
+#ifdef _GNU_SOURCE
+    cpu_set_t mask;
+    CPU_ZERO(&mask);
+    for (int cpu : cpus) {
+        guarantee(cpu >= 0 && cpu < CPU_SETSIZE);
+        CPU_SET(cpu, &mask);
+    }
+    return pthread_setaffinity_np(thread, sizeof(mask), &mask) == 0;
+#else
+    return false;
+#endif
+}
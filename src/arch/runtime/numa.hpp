@@ -0,0 +1,69 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#ifndef ARCH_RUNTIME_NUMA_HPP_
+#define ARCH_RUNTIME_NUMA_HPP_
+
+#include <pthread.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "threading.hpp"
+
+// The NUMA topology, as far as placing the event loop threads and their memory is
+// concerned.  Where we can't find it out (or on machines that aren't NUMA), there
+// is one node with all the CPUs.
+
+const int MAX_NUMA_NODES = 16;
+
+// Returns how many NUMA nodes with CPUs there are (at most MAX_NUMA_NODES).
+int get_numa_node_count();
+
+// Returns the CPUs of the `node`th NUMA node with CPUs.
+const std::vector<int> &get_numa_node_cpus(int node);
+
+// Returns the node that db thread `threadnum` runs on, when there are
+// `num_db_threads` of them.  The db threads are split into equally sized runs of
+// consecutive threads, one run per node.
+int numa_node_for_thread(int threadnum, int num_db_threads, int num_nodes);
+
+// Returns the node that the given thread of the thread pool runs on.  Threads other
+// than the db threads aren't pinned to a node, we just say they're on node 0.
+int get_thread_numa_node(threadnum_t thread);
+
+// Parses a list of CPUs like "0-3,8,10-11", as in /sys/devices/system/node.
+bool parse_cpu_list(const std::string &list, std::vector<int> *cpus_out);
+
+// The inverse of `parse_cpu_list()`, with the CPUs sorted and ranges merged.
+std::string format_cpu_list(const std::vector<int> &cpus);
+
+// Parses either a list of CPUs or "node:" followed by a list of NUMA nodes (numbered
+// as for `get_numa_node_cpus()`), which stands for all of the nodes' CPUs.
+bool parse_cpu_set(const std::string &spec, std::vector<int> *cpus_out);
+
+// Returns whether the process is allowed to run on `cpu`.
+bool is_cpu_available(int cpu);
+
+// Which CPUs the threads of the thread pool and of the blocker pools may run on.  An
+// empty list leaves those threads where they would be otherwise.
+struct thread_placement_t {
+    // The `i`th event loop thread runs on the `i % event_loop_cpus.size()`th of these.
+    std::vector<int> event_loop_cpus;
+    // The utility thread may run on any of these.
+    std::vector<int> utility_thread_cpus;
+    // Blocker pool threads may run on any of these.
+    std::vector<int> blocker_pool_cpus;
+};
+
+// Must be called before the thread pool starts.
+void set_thread_placement(const thread_placement_t &placement);
+const thread_placement_t &get_thread_placement();
+
+// Returns the CPU lists of `get_thread_placement()` by kind of thread ("event_loop",
+// "utility" and "blocker_pool"), leaving out the kinds that aren't pinned.
+std::map<std::string, std::string> describe_thread_placement();
+
+// Restricts `thread` to `cpus`, and returns whether that worked.
+bool set_thread_cpus(pthread_t thread, const std::vector<int> &cpus);
+
+#endif  // ARCH_RUNTIME_NUMA_HPP_
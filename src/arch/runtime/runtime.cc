@@ -76,3 +76,17 @@ void run_in_thread_pool(const std::function<void()> &fun, int worker_threads) {
     starter_t starter(&thread_pool, fun);
     thread_pool.run_thread_pool(&starter);
 }
+
+void set_event_loop_spin_usecs(int64_t usecs) {
+    linux_thread_pool_t::set_event_loop_spin_usecs(usecs);
+}
+
+void set_use_timer_wheel(bool use_timer_wheel) {
+    linux_thread_pool_t::set_timer_queue_type(use_timer_wheel
+        ? timer_queue_type_t::WHEEL
+        : timer_queue_type_t::PRIORITY_QUEUE);
+}
+
+void set_coroutine_stall_warning_ms(int64_t ms) {
+    coro_t::set_stall_warning_ms(ms);
+}
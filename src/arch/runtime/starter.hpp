@@ -4,6 +4,8 @@
 
 // Implementation in runtime.cc.
 
+#include <stdint.h>
+
 #include <functional>
 
 /* `run_in_thread_pool()` starts a RethinkDB thread pool, runs the given
@@ -12,4 +14,19 @@ shuts down the thread pool. */
 
 void run_in_thread_pool(const std::function<void()> &fun, int worker_threads);
 
+/* Makes idle threads busy-poll for events for `usecs` microseconds before they block,
+which cuts the latency of waking them up.  0 (the default) turns this off.  Must be
+called before `run_in_thread_pool()`.  Only the epoll event queue supports this. */
+void set_event_loop_spin_usecs(int64_t usecs);
+
+/* Makes the threads of thread pools started from then on keep their timers in a timer
+wheel instead of a priority queue.  That lets them add and cancel timers in constant
+time, but rounds timers up to the next millisecond. */
+void set_use_timer_wheel(bool use_timer_wheel);
+
+/* Makes coroutines that keep a thread busy for more than `ms` milliseconds without
+giving it up log a warning, with a backtrace of where they finally did.  0 (the
+default) turns this off. */
+void set_coroutine_stall_warning_ms(int64_t ms);
+
 #endif  // ARCH_RUNTIME_STARTER_HPP_
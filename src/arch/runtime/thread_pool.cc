@@ -15,6 +15,7 @@
 #include "arch/os_signal.hpp"
 #include "arch/io/timer_provider.hpp"
 #include "arch/runtime/event_queue.hpp"
+#include "arch/runtime/numa.hpp"
 #include "arch/runtime/runtime.hpp"
 #include "arch/timing.hpp"
 #include "errors.hpp"
@@ -53,6 +54,24 @@ int linux_thread_pool_t::get_thread_id() {
 void linux_thread_pool_t::set_thread_id(int val) {
     thread_id = val;
 }
+int64_t linux_thread_pool_t::event_loop_spin_usecs = 0;
+
+void linux_thread_pool_t::set_event_loop_spin_usecs(int64_t usecs) {
+    rassert(usecs >= 0);
+    event_loop_spin_usecs = usecs;
+}
+int64_t linux_thread_pool_t::get_event_loop_spin_usecs() {
+    return event_loop_spin_usecs;
+}
+timer_queue_type_t linux_thread_pool_t::timer_queue_type =
+    timer_queue_type_t::PRIORITY_QUEUE;
+
+void linux_thread_pool_t::set_timer_queue_type(timer_queue_type_t type) {
+    timer_queue_type = type;
+}
+timer_queue_type_t linux_thread_pool_t::get_timer_queue_type() {
+    return timer_queue_type;
+}
 linux_thread_t *linux_thread_pool_t::get_thread() {
     rassert(thread != nullptr);
     return thread;
@@ -227,8 +246,16 @@ void linux_thread_pool_t::run_thread_pool(linux_thread_message_t *initial_messag
         int res = pthread_create(&pthreads[i], nullptr, &start_thread, tdata);
         guarantee_xerr(res == 0, res, "Could not create thread");
 
-        // Don't set affinity for the utility thread
-        if (do_set_affinity && !is_utility_thread) {
+        const thread_placement_t &placement = get_thread_placement();
+        if (is_utility_thread && !placement.utility_thread_cpus.empty()) {
+            guarantee(set_thread_cpus(pthreads[i], placement.utility_thread_cpus),
+                      "Could not set the utility thread's CPU affinity");
+        } else if (!is_utility_thread && !placement.event_loop_cpus.empty()) {
+            const int cpu =
+                placement.event_loop_cpus[i % placement.event_loop_cpus.size()];
+            guarantee(set_thread_cpus(pthreads[i], std::vector<int>{cpu}),
+                      "Could not pin thread %d to CPU %d", i, cpu);
+        } else if (do_set_affinity && !is_utility_thread) {
             // On Apple, the thread affinity API has awful documentation, so we don't even bother.
 #ifdef _GNU_SOURCE
             // Distribute threads evenly among CPUs
@@ -238,6 +265,25 @@ void linux_thread_pool_t::run_thread_pool(linux_thread_message_t *initial_messag
             CPU_SET(i % ncpus, &mask);
             res = pthread_setaffinity_np(pthreads[i], sizeof(cpu_set_t), &mask);
             guarantee_xerr(res == 0, res, "Could not set thread affinity");
+#endif
+        } else if (!is_utility_thread && get_numa_node_count() > 1) {
+#ifdef _GNU_SOURCE
+            // Keep every thread on one NUMA node (free to move between the node's
+            // CPUs), so that the memory it first touches, which Linux allocates on
+            // the local node, stays local.
+            const int node = numa_node_for_thread(i, n_threads - 1,
+                                                  get_numa_node_count());
+            cpu_set_t mask;
+            CPU_ZERO(&mask);
+            for (int cpu : get_numa_node_cpus(node)) {
+                if (cpu < CPU_SETSIZE) {
+                    CPU_SET(cpu, &mask);
+                }
+            }
+            // This can fail if the process may only run on some of the node's CPUs
+            // (in a cpuset, for example), in which case the thread just floats.
+            UNUSED int pin_res
+                = pthread_setaffinity_np(pthreads[i], sizeof(cpu_set_t), &mask);
 #endif
         }
     }
@@ -457,7 +503,7 @@ linux_thread_pool_t::~linux_thread_pool_t() {
 linux_thread_t::linux_thread_t(linux_thread_pool_t *parent_pool, int thread_id)
     : queue(this),
       message_hub(&queue, parent_pool, threadnum_t(thread_id)),
-      timer_handler(&queue),
+      timer_handler(&queue, linux_thread_pool_t::get_timer_queue_type()),
       do_shutdown(false)
 #ifndef NDEBUG
       , coroutine_counts_at_shutdown(NULL)
@@ -488,6 +534,18 @@ void linux_thread_t::pump() {
     message_hub.push_messages();
 }
 
+bool linux_thread_t::begin_spinning() {
+    return message_hub.begin_spinning();
+}
+
+bool linux_thread_t::has_new_messages() {
+    return message_hub.has_incoming_messages();
+}
+
+void linux_thread_t::end_spinning(bool began_spinning) {
+    message_hub.end_spinning(began_spinning);
+}
+
 void linux_thread_t::on_event(int events) {
     // No-op. This is just to make sure that the event queue wakes up
     // so it can shut down.
@@ -58,6 +58,14 @@ public:
     void enable_coroutine_summary();
 #endif
 
+    // See `set_event_loop_spin_usecs()` in `arch/runtime/starter.hpp`.
+    static void set_event_loop_spin_usecs(int64_t usecs);
+    static int64_t get_event_loop_spin_usecs();
+
+    // The kind of timer queue that threads get when they are created.
+    static void set_timer_queue_type(timer_queue_type_t type);
+    static timer_queue_type_t get_timer_queue_type();
+
     // Shut down all the threads. Can be called from any thread.
     void shutdown_thread_pool();
 
@@ -130,6 +138,11 @@ private:
     // The event queue for the thread we are currently in (same as &thread_pool->threads[thread_id])
     static THREAD_LOCAL linux_thread_t *thread;
 
+    // How long idle threads busy-poll for events before they block
+    static int64_t event_loop_spin_usecs;
+
+    static timer_queue_type_t timer_queue_type;
+
     DISABLE_COPYING(linux_thread_pool_t);
 };
 
@@ -190,6 +203,9 @@ public:
 
     void pump();   // Called by the event queue
     bool should_shut_down();   // Called by the event queue
+    bool begin_spinning();   // Called by the event queue
+    bool has_new_messages();   // Called by the event queue
+    void end_spinning(bool began_spinning);   // Called by the event queue
 #ifndef NDEBUG
     void initiate_shut_down(std::map<std::string, size_t> *coroutine_counts); // Can be called from any thread
 #else
@@ -7,7 +7,8 @@
 #include "time.hpp"
 #include "utils.hpp"
 
-class timer_token_t : public intrusive_priority_queue_node_t<timer_token_t> {
+class timer_token_t : public intrusive_priority_queue_node_t<timer_token_t>,
+                      public timer_wheel_node_t<timer_token_t> {
     friend class timer_handler_t;
 
 private:
@@ -31,14 +32,19 @@ bool left_is_higher_priority(const timer_token_t *left, const timer_token_t *rig
     return left->next_time_in_nanos < right->next_time_in_nanos;
 }
 
-timer_handler_t::timer_handler_t(linux_event_queue_t *queue)
+timer_handler_t::timer_handler_t(linux_event_queue_t *queue,
+                                 timer_queue_type_t _queue_type)
     : timer_provider(queue),
-      expected_oneshot_time_in_nanos(0) {
+      expected_oneshot_time_in_nanos(0),
+      queue_type(_queue_type),
+      wheel(get_ticks().nanos / MILLION),
+      wheel_oneshot_ms(-1) {
     // Right now, we have no tokens.  So we don't ask the timer provider to do anything for us.
 }
 
 timer_handler_t::~timer_handler_t() {
     guarantee(token_queue.empty());
+    guarantee(wheel.empty());
 }
 
 void timer_handler_t::on_oneshot() {
@@ -48,6 +54,14 @@ void timer_handler_t::on_oneshot() {
     int64_t real_ticks = get_ticks().nanos;
     int64_t ticks = std::max(real_ticks, expected_oneshot_time_in_nanos);
 
+    if (queue_type == timer_queue_type_t::WHEEL) {
+        process_wheel(real_ticks, ticks);
+    } else {
+        process_token_queue(real_ticks, ticks);
+    }
+}
+
+void timer_handler_t::process_token_queue(int64_t real_ticks, int64_t ticks) {
     while (!token_queue.empty() && token_queue.peek()->next_time_in_nanos <= ticks) {
         timer_token_t *token = token_queue.pop();
 
@@ -72,6 +86,40 @@ void timer_handler_t::on_oneshot() {
     }
 }
 
+void timer_handler_t::process_wheel(int64_t real_ticks, int64_t ticks) {
+    wheel_oneshot_ms = -1;
+    wheel.advance(ticks / MILLION);
+
+    // Tokens stay in the wheel until we get to them, so that callbacks can still
+    // cancel them.
+    while (timer_token_t *token = wheel.pop_expired()) {
+        if (token->interval_nanos != 0) {
+            token->next_time_in_nanos = real_ticks + token->interval_nanos;
+            add_to_wheel(token);
+        }
+
+        token->callback->on_timer(ticks_t{real_ticks});
+
+        if (token->interval_nanos == 0) {
+            delete token;
+        }
+    }
+
+    if (!wheel.empty()) {
+        const int64_t next_ms = wheel.next_interesting_tick();
+        if (wheel_oneshot_ms == -1 || next_ms < wheel_oneshot_ms) {
+            wheel_oneshot_ms = next_ms;
+            timer_provider.schedule_oneshot(next_ms * MILLION, this);
+        }
+    }
+}
+
+void timer_handler_t::add_to_wheel(timer_token_t *token) {
+    // Round up, so that the timer doesn't ring early.
+    const int64_t due_ms = (token->next_time_in_nanos + MILLION - 1) / MILLION;
+    wheel.add(token, due_ms);
+}
+
 timer_token_t *timer_handler_t::add_timer_internal(
         const ticks_t next_time, const int64_t interval_ms,
         timer_callback_t *callback) {
@@ -83,6 +131,16 @@ timer_token_t *timer_handler_t::add_timer_internal(
     token->next_time_in_nanos = next_time.nanos;
     token->callback = callback;
 
+    if (queue_type == timer_queue_type_t::WHEEL) {
+        add_to_wheel(token);
+        const int64_t next_ms = wheel.next_interesting_tick();
+        if (wheel_oneshot_ms == -1 || next_ms < wheel_oneshot_ms) {
+            wheel_oneshot_ms = next_ms;
+            timer_provider.schedule_oneshot(next_ms * MILLION, this);
+        }
+        return token;
+    }
+
     const timer_token_t *top_entry = token_queue.peek();
     token_queue.push(token);
 
@@ -94,6 +152,17 @@ timer_token_t *timer_handler_t::add_timer_internal(
 }
 
 void timer_handler_t::cancel_timer(timer_token_t *token) {
+    if (queue_type == timer_queue_type_t::WHEEL) {
+        wheel.remove(token);
+        delete token;
+
+        if (wheel.empty() && wheel_oneshot_ms != -1) {
+            wheel_oneshot_ms = -1;
+            timer_provider.unschedule_oneshot();
+        }
+        return;
+    }
+
     token_queue.remove(token);
     delete token;
 
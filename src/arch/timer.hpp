@@ -4,6 +4,7 @@
 
 #include "arch/io/timer_provider.hpp"
 #include "containers/intrusive_priority_queue.hpp"
+#include "containers/timer_wheel.hpp"
 #include "time.hpp"
 
 class timer_token_t;
@@ -15,13 +16,22 @@ struct timer_callback_t {
     virtual ~timer_callback_t() { }
 };
 
+// Where a `timer_handler_t` keeps its timers.
+enum class timer_queue_type_t {
+    // A priority queue.  Adding or cancelling a timer takes O(log n) time.
+    PRIORITY_QUEUE,
+    // A hierarchical timer wheel, in which adding or cancelling a timer takes O(1)
+    // time.  Timers are rounded up to the next millisecond.
+    WHEEL
+};
+
 /* This timer class uses the underlying OS timer provider to get one-shot timing
  * events. It then manages a list of application timers based on that lower level
  * interface. Everyone who needs a timer should use this class (through the thread
  * pool). */
 class timer_handler_t : private timer_provider_callback_t {
 public:
-    explicit timer_handler_t(linux_event_queue_t *queue);
+    timer_handler_t(linux_event_queue_t *queue, timer_queue_type_t queue_type);
     ~timer_handler_t();
 
     // If interval_ms is zero that means a non-repeating callback.
@@ -31,6 +41,9 @@ public:
 
 private:
     void on_oneshot();
+    void process_token_queue(int64_t real_ticks, int64_t ticks);
+    void process_wheel(int64_t real_ticks, int64_t ticks);
+    void add_to_wheel(timer_token_t *token);
 
     // The timer provider, a platform-dependent typedef for interfacing with the OS.
     timer_provider_t timer_provider;
@@ -39,9 +52,18 @@ private:
     // than this time, we pretend that it had arrived on time.
     int64_t expected_oneshot_time_in_nanos;
 
-    // A priority queue of timer tokens, ordered by the soonest.
+    const timer_queue_type_t queue_type;
+
+    // A priority queue of timer tokens, ordered by the soonest.  Used with
+    // `timer_queue_type_t::PRIORITY_QUEUE`.
     intrusive_priority_queue_t<timer_token_t> token_queue;
 
+    // The timer tokens, by the millisecond they are due in.  Used with
+    // `timer_queue_type_t::WHEEL`.
+    timer_wheel_t<timer_token_t> wheel;
+    // The millisecond for which the oneshot is scheduled, or -1.
+    int64_t wheel_oneshot_ms;
+
     DISABLE_COPYING(timer_handler_t);
 };
 
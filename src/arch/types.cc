@@ -16,9 +16,22 @@ address_in_use_exc_t::address_in_use_exc_t(const char* hostname, int port) throw
     }
 }
 
-file_account_t::file_account_t(file_t *par, int pri, int outstanding_requests_limit) :
+const char *io_caller_name(io_caller_t caller) {
+    switch (caller) {
+    case io_caller_t::other: return "other";
+    case io_caller_t::cache_read: return "cache_read";
+    case io_caller_t::flush_write: return "flush_write";
+    case io_caller_t::gc: return "gc";
+    case io_caller_t::lba: return "lba";
+    case io_caller_t::metablock: return "metablock";
+    default: unreachable();
+    }
+}
+
+file_account_t::file_account_t(file_t *par, int pri, io_caller_t caller,
+                               int outstanding_requests_limit) :
     parent(par),
-    account(parent->create_account(pri, outstanding_requests_limit)) { }
+    account(parent->create_account(pri, caller, outstanding_requests_limit)) { }
 
 file_account_t::~file_account_t() {
     parent->destroy_account(account);
@@ -88,6 +88,9 @@ typedef linux_nonthrowing_tcp_listener_t non_throwing_tcp_listener_t;
 class linux_tcp_listener_t;
 typedef linux_tcp_listener_t tcp_listener_t;
 
+class linux_per_thread_tcp_listener_t;
+typedef linux_per_thread_tcp_listener_t per_thread_tcp_listener_t;
+
 class linux_repeated_nonthrowing_tcp_listener_t;
 typedef linux_repeated_nonthrowing_tcp_listener_t repeated_nonthrowing_tcp_listener_t;
 
@@ -107,6 +110,21 @@ enum class file_direct_io_mode_t {
 
 enum class datasync_op { no_datasyncs, wrap_in_datasyncs, datasync_after };
 
+// What an I/O account is used for. The disk stats keep separate latencies for each of
+// these, so that we can tell if e.g. the garbage collector slows down the cache reads.
+enum class io_caller_t {
+    other,
+    cache_read,
+    flush_write,
+    gc,
+    lba,
+    metablock
+};
+
+static const int IO_CALLER_COUNT = static_cast<int>(io_caller_t::metablock) + 1;
+
+const char *io_caller_name(io_caller_t caller);
+
 // A linux file.  It expects reads and writes and buffers to have an
 // alignment of DEVICE_BLOCK_SIZE.
 class file_t {
@@ -126,19 +144,35 @@ public:
     // writev_async doesn't provide the atomicity guarantees of writev.
     virtual void writev_async(int64_t offset, size_t length, scoped_array_t<iovec> &&bufs,
                               file_account_t *account, linux_iocallback_t *cb) = 0;
+    // Makes the writes that have completed so far durable.
+    virtual void datasync_async(file_account_t *account, linux_iocallback_t *cb) = 0;
 
-    virtual void *create_account(int priority, int outstanding_requests_limit) = 0;
+    virtual void *create_account(int priority, io_caller_t caller,
+                                 int outstanding_requests_limit) = 0;
     virtual void destroy_account(void *account) = 0;
 
     virtual bool coop_lock_and_check() = 0;
 
+    // A file may be spread over several devices (see `striped_file_t`).  These let
+    // the serializer place extents per device.  A plain file is a single device.
+    virtual int device_count() { return 1; }
+    virtual int device_for_offset(UNUSED int64_t offset) { return 0; }
+    // The number of requests submitted to the device that haven't completed yet.
+    virtual int64_t device_outstanding_requests(UNUSED int device) { return 0; }
+    // Whether the device is on the slower storage tier that cold data is moved to.
+    virtual bool device_is_cold(UNUSED int device) { return false; }
+    // How many bytes of the file go to one device before the next one takes over, or
+    // 0 if it's a single device.
+    virtual int64_t device_stripe_size() { return 0; }
+
 private:
     DISABLE_COPYING(file_t);
 };
 
 class file_account_t {
 public:
-    file_account_t(file_t *f, int p, int outstanding_requests_limit = UNLIMITED_OUTSTANDING_REQUESTS);
+    file_account_t(file_t *f, int p, io_caller_t caller,
+                   int outstanding_requests_limit = UNLIMITED_OUTSTANDING_REQUESTS);
     ~file_account_t();
     void *get_account() { return account; }
 
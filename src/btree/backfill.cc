@@ -1,19 +1,24 @@
 // Copyright 2010-2014 RethinkDB, all rights reserved.
 #include "btree/backfill.hpp"
 
+#include <algorithm>
+#include <utility>
+
 #include "arch/runtime/coroutines.hpp"
 #include "btree/backfill_debug.hpp"
 #include "btree/depth_first_traversal.hpp"
 #include "btree/leaf_node.hpp"
+#include "btree/node.hpp"
 #include "concurrency/pmap.hpp"
 #include "containers/archive/optional.hpp"
 #include "containers/archive/stl_types.hpp"
+#include "crypto/hash.hpp"
 
 /* `MAX_CONCURRENT_VALUE_LOADS` is the maximum number of coroutines we'll use for loading
 values from the leaf nodes. */
 static const int MAX_CONCURRENT_VALUE_LOADS = 16;
 
-RDB_IMPL_SERIALIZABLE_1_FOR_CLUSTER(backfill_pre_item_t, range);
+RDB_IMPL_SERIALIZABLE_2_FOR_CLUSTER(backfill_pre_item_t, range, content_hash);
 RDB_IMPL_SERIALIZABLE_3_FOR_CLUSTER(backfill_item_t::pair_t, key, recency, value);
 RDB_IMPL_SERIALIZABLE_3_FOR_CLUSTER(backfill_item_t,
     range, pairs, min_deletion_timestamp);
@@ -54,6 +59,29 @@ key_range_t convert_to_key_range(
         right_incl);
 }
 
+/* `backfill_content_hash()` computes the `content_hash` of a `backfill_pre_item_t`
+from the key-value pairs in its range, which must be sorted by key. Values are hashed in
+the form in which they are stored in the leaf node. So if two B-trees store a large
+value out of line in different blocks, the hashes won't match even though the values do;
+that just means we fall back to re-transmitting the range. */
+static std::string backfill_content_hash(
+        value_sizer_t *sizer,
+        const std::vector<std::pair<store_key_t, const void *> > &pairs) {
+    std::string data;
+    for (const auto &pair : pairs) {
+        rassert(pair.second != nullptr);
+        int value_size = sizer->size(pair.second);
+        data.push_back(static_cast<char>(pair.first.size()));
+        data.append(reinterpret_cast<const char *>(pair.first.contents()),
+            pair.first.size());
+        data.append(reinterpret_cast<const char *>(&value_size), sizeof(value_size));
+        data.append(static_cast<const char *>(pair.second), value_size);
+    }
+    std::array<unsigned char, SHA256_DIGEST_LENGTH> digest =
+        crypto::sha256(data);
+    return std::string(digest.begin(), digest.end());
+}
+
 continue_bool_t btree_send_backfill_pre(
         superblock_t *superblock,
         release_superblock_t release_superblock,
@@ -99,13 +127,33 @@ continue_bool_t btree_send_backfill_pre(
                 pre_item.range = convert_to_key_range(left_excl_or_null, right_incl);
                 backfill_debug_range(pre_item.range, strprintf(
                     "pre-item leaf %" PRIu64, min_deletion_timestamp.longtime));
+                /* Usually most of the node is still the same as on the backfill source,
+                so we attach a hash that lets the source skip the range if it is. */
+                std::vector<std::pair<store_key_t, const void *> > pairs;
+                leaf::visit_entries(
+                    sizer, lnode, buf->lock.get_recency(),
+                    [&](const btree_key_t *key, repli_timestamp_t,
+                            const void *value_or_null) -> continue_bool_t {
+                        if (value_or_null != nullptr
+                                && pre_item.range.contains_key(key)) {
+                            pairs.push_back(std::make_pair(
+                                store_key_t(key), value_or_null));
+                        }
+                        return continue_bool_t::CONTINUE;
+                    });
+                std::sort(pairs.begin(), pairs.end(),
+                    [](const std::pair<store_key_t, const void *> &p1,
+                            const std::pair<store_key_t, const void *> &p2) {
+                        return p1.first < p2.first;
+                    });
+                pre_item.content_hash.set(backfill_content_hash(sizer, pairs));
                 return pre_item_consumer->on_pre_item(std::move(pre_item));
             } else {
-                std::vector<const btree_key_t *> keys;
+                std::vector<std::pair<store_key_t, std::string> > keys;
                 leaf::visit_entries(
                     sizer, lnode, buf->lock.get_recency(),
                     [&](const btree_key_t *key, repli_timestamp_t timestamp,
-                            const void *) -> continue_bool_t {
+                            const void *value_or_null) -> continue_bool_t {
                         if ((left_excl_or_null != nullptr &&
                                     btree_key_cmp(key, left_excl_or_null) <= 0)
                                 || btree_key_cmp(key, right_incl) > 0) {
@@ -121,16 +169,22 @@ continue_bool_t btree_send_backfill_pre(
                         }
                         backfill_debug_key(store_key_t(key), strprintf(
                             "pre-item key %" PRIu64, timestamp.longtime));
-                        keys.push_back(key);
+                        /* The key only lives as long as the callback, since the
+                        node might not store it whole. */
+                        std::vector<std::pair<store_key_t, const void *> > pairs;
+                        if (value_or_null != nullptr) {
+                            pairs.push_back(std::make_pair(
+                                store_key_t(key), value_or_null));
+                        }
+                        keys.push_back(std::make_pair(
+                            store_key_t(key), backfill_content_hash(sizer, pairs)));
                         return continue_bool_t::CONTINUE;
                     });
-                std::sort(keys.begin(), keys.end(),
-                    [](const btree_key_t *k1, const btree_key_t *k2) {
-                        return btree_key_cmp(k1, k2) < 0;
-                    });
-                for (const btree_key_t *key : keys) {
+                std::sort(keys.begin(), keys.end());
+                for (auto &&key : keys) {
                     backfill_pre_item_t pre_item;
-                    pre_item.range = key_range_t::one_key(key);
+                    pre_item.range = key_range_t::one_key(key.first);
+                    pre_item.content_hash.set(std::move(key.second));
                     if (continue_bool_t::ABORT ==
                             pre_item_consumer->on_pre_item(std::move(pre_item))) {
                         return continue_bool_t::ABORT;
@@ -344,11 +398,13 @@ private:
             key_range_t subrange;
             subrange.left = cursor.key();
             std::list<backfill_item_t> items_from_pre;
+            std::vector<optional<std::string> > hashes_from_pre;
             continue_bool_t cont = pre_item_producer->consume_range(
                 &cursor, right_bound,
                 [&](const backfill_pre_item_t &pre_item) {
                     items_from_pre.push_back(backfill_item_t());
                     items_from_pre.back().range = pre_item.range;
+                    hashes_from_pre.push_back(pre_item.content_hash);
                 });
             if (cont == continue_bool_t::ABORT) {
                 return continue_bool_t::ABORT;
@@ -357,7 +413,8 @@ private:
             rassert(!subrange.is_empty());
 
             if (continue_bool_t::ABORT == handle_pre_leaf_subrange(
-                    buf, subrange, std::move(items_from_pre), interruptor)) {
+                    buf, subrange, std::move(items_from_pre), hashes_from_pre,
+                    interruptor)) {
                 /* The subrange has not been fully processed. We must abort
                 and try again next time. */
                 return continue_bool_t::ABORT;
@@ -373,12 +430,14 @@ private:
     given leaf, for which the pre-items are already available. The pre-items are
     delivered in the form of a `std::list<backfill_item_t>` where each item's range is
     the same as one of the pre-items, but the other fields of the item are uninitialized.
+    `hashes_from_pre` holds the pre-items' `content_hash`es in the same order.
     It returns `continue_bool_t::ABORT` if the memory usage limit has been hit.
     */
     continue_bool_t handle_pre_leaf_subrange(
             const counted_t<counted_buf_lock_and_read_t> &buf,
             const key_range_t &subrange,
             std::list<backfill_item_t> &&items_from_pre,
+            const std::vector<optional<std::string> > &hashes_from_pre,
             signal_t *interruptor) {
         const leaf_node_t *lnode = static_cast<const leaf_node_t *>(
             buf->read->get_data_read());
@@ -443,9 +502,13 @@ private:
         } else {
             /* Attach `min_deletion_timestamp` to `items_from_pre`, because it hasn't
             been initialized yet for them. We also need to clip `items_from_pre` because
-            some of them might fall partially outside of `subrange`. */
+            some of them might fall partially outside of `subrange`. A pre-item's hash
+            is only useful to us if the pre-item lies entirely within `subrange`. */
+            rassert(hashes_from_pre.size() == items_from_pre.size());
+            std::vector<bool> hash_usable;
             for (backfill_item_t &i : items_from_pre) {
                 rassert(subrange.overlaps(i.range));
+                hash_usable.push_back(subrange.is_superset(i.range));
                 i.range = i.range.intersection(subrange);
                 i.min_deletion_timestamp = min_deletion_timestamp;
             }
@@ -542,6 +605,22 @@ private:
                     });
             }
 
+            /* Drop the items from `items_from_pre` whose range we haven't changed since
+            `reference_timestamp`, and where the backfill destination has the exact same
+            key-value pairs as we do anyway. */
+            size_t pre_index = 0;
+            for (auto it = items_from_pre.begin(); it != items_from_pre.end();
+                    ++pre_index) {
+                if (hash_usable[pre_index]
+                        && static_cast<bool>(hashes_from_pre[pre_index])
+                        && *hashes_from_pre[pre_index] == content_hash_of_item(*it)) {
+                    backfill_debug_range(it->range, "item_from_pre matches hash");
+                    it = items_from_pre.erase(it);
+                } else {
+                    ++it;
+                }
+            }
+
             /* Merge `items_from_time` into `items_from_pre`, preserving order. */
             items_from_pre.merge(
                 std::move(items_from_time),
@@ -569,6 +648,25 @@ private:
         }
     }
 
+    /* Returns the `content_hash` that a pre-item for the range of `item` would have
+    if it came from us, or an empty string if `item` contains changes that are newer
+    than `reference_timestamp`. The item's values must still be the pointers into the
+    leaf node that `handle_pre_leaf_subrange()` puts there. */
+    std::string content_hash_of_item(const backfill_item_t &item) {
+        std::vector<std::pair<store_key_t, const void *> > pairs;
+        for (const auto &pair : item.pairs) {
+            if (pair.recency > reference_timestamp) {
+                return std::string();
+            }
+            if (static_cast<bool>(pair.value)) {
+                rassert(pair.value->size() == sizeof(void *));
+                pairs.push_back(std::make_pair(pair.key,
+                    *reinterpret_cast<void *const *>(pair.value->data())));
+            }
+        }
+        return backfill_content_hash(sizer, pairs);
+    }
+
     MUST_USE continue_bool_t limit_item_memory_usage(
             const buf_parent_t &parent,
             backfill_item_t *item) {
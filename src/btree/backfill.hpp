@@ -22,19 +22,35 @@ class value_sizer_t;
 /* `backfill_pre_item_t` describes a range of keys which have changed on the backfill
 destination since the source and destination diverged. The backfill destination sends
 pre items to the backfill source so that the source knows to re-transmit the values of
-those keys. */
+those keys.
+
+If `content_hash` is set, it's a digest of the key-value pairs that the destination has
+in `range` (see `backfill_content_hash()` in `btree/backfill.cc`). When the source
+hasn't touched `range` since the two diverged and its own pairs in `range` hash to the
+same value, the destination's changes must have cancelled out, so the source doesn't
+re-transmit the range after all. */
 class backfill_pre_item_t {
 public:
     key_range_t get_range() const {
         return range;
     }
     size_t get_mem_size() const {
-        return sizeof(backfill_pre_item_t);
+        size_t s = sizeof(backfill_pre_item_t);
+        if (static_cast<bool>(content_hash)) {
+            s += content_hash->size();
+        }
+        return s;
     }
     void mask_in_place(const key_range_t &m) {
-        range = range.intersection(m);
+        key_range_t new_range = range.intersection(m);
+        if (new_range != range) {
+            /* The hash describes the whole of the old range */
+            content_hash.reset();
+        }
+        range = new_range;
     }
     key_range_t range;
+    optional<std::string> content_hash;
 };
 RDB_DECLARE_SERIALIZABLE_FOR_CLUSTER(backfill_pre_item_t);
 
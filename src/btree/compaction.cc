@@ -0,0 +1,127 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#include "btree/compaction.hpp"
+
+#include <algorithm>
+
+#include "btree/leaf_node.hpp"
+#include "btree/operations.hpp"
+#include "btree/parallel_traversal.hpp"
+#include "buffer_cache/alt.hpp"
+#include "region/region.hpp"
+
+// We don't dirty a leaf to free up less than this fraction of it.
+const int MIN_RECLAIMED_FRACTION = 8;
+
+class compact_cold_leaves_helper_t : public btree_traversal_helper_t {
+public:
+    compact_cold_leaves_helper_t(value_sizer_t *sizer,
+                                 const key_range_t &range,
+                                 repli_timestamp_t cold_before,
+                                 std::vector<store_key_t> *underfull_keys)
+        : sizer_(sizer), range_(range), cold_before_(cold_before),
+          underfull_keys_(underfull_keys) { }
+
+    void process_a_leaf(buf_lock_t *leaf_node_buf,
+                        const btree_key_t *,
+                        const btree_key_t *right_inclusive_or_null,
+                        signal_t *,
+                        int *) THROWS_ONLY(interrupted_exc_t) {
+        if (!(leaf_node_buf->get_recency() < cold_before_)) {
+            return;
+        }
+        bool underfull;
+        {
+            buf_read_t read(leaf_node_buf);
+            const leaf_node_t *node
+                = static_cast<const leaf_node_t *>(read.get_data_read());
+            underfull = leaf::is_underfull(sizer_, node);
+            if (!underfull && leaf::reclaimable_space(sizer_, node)
+                    < sizer_->block_size().value() / MIN_RECLAIMED_FRACTION) {
+                return;
+            }
+        }
+        {
+            buf_write_t write(leaf_node_buf);
+            leaf_node_t *node = static_cast<leaf_node_t *>(write.get_data_write());
+            leaf::compact(sizer_, node);
+            underfull = leaf::is_underfull(sizer_, node);
+        }
+        if (underfull) {
+            // Any key in the leaf's range leads back to it, even if it's empty.
+            underfull_keys_->push_back(right_inclusive_or_null != nullptr
+                                       ? store_key_t(right_inclusive_or_null)
+                                       : store_key_t::max());
+        }
+    }
+
+    void postprocess_internal_node(buf_lock_t *) { }
+
+    void filter_interesting_children(buf_parent_t,
+                                     ranged_block_ids_t *ids_source,
+                                     interesting_children_callback_t *cb) {
+        for (int i = 0; i < ids_source->num_block_ids(); ++i) {
+            block_id_t block_id;
+            const btree_key_t *left, *right;
+            ids_source->get_block_id_and_bounding_interval(i, &block_id, &left, &right);
+            const key_range_t child_range(
+                left != nullptr ? key_range_t::open : key_range_t::none, left,
+                right != nullptr ? key_range_t::closed : key_range_t::none, right);
+            if (region_overlaps(child_range, range_)) {
+                cb->receive_interesting_child(i);
+            }
+        }
+        cb->no_more_interesting_children();
+    }
+
+    access_t btree_superblock_mode() {
+        return access_t::write;
+    }
+
+    access_t btree_node_mode() {
+        return access_t::write;
+    }
+
+private:
+    value_sizer_t *const sizer_;
+    const key_range_t range_;
+    const repli_timestamp_t cold_before_;
+    std::vector<store_key_t> *const underfull_keys_;
+
+    DISABLE_COPYING(compact_cold_leaves_helper_t);
+};
+
+void btree_compact_cold_leaves(value_sizer_t *sizer,
+                               superblock_t *superblock,
+                               const key_range_t &range,
+                               repli_timestamp_t cold_before,
+                               std::vector<store_key_t> *underfull_keys_out,
+                               signal_t *interruptor)
+    THROWS_ONLY(interrupted_exc_t) {
+    underfull_keys_out->clear();
+    compact_cold_leaves_helper_t helper(sizer, range, cold_before, underfull_keys_out);
+    btree_parallel_traversal(superblock, &helper, interruptor);
+    // The leaves are processed in parallel, so they come in any order.
+    std::sort(underfull_keys_out->begin(), underfull_keys_out->end());
+}
+
+repli_timestamp_t btree_root_recency(superblock_t *superblock) {
+    const block_id_t root_id = superblock->get_root_block_id();
+    if (root_id == NULL_BLOCK_ID) {
+        return repli_timestamp_t::distant_past;
+    }
+    buf_lock_t root(superblock->expose_buf(), root_id, access_t::read);
+    return root.get_recency();
+}
+
+void btree_merge_underfull_leaf(value_sizer_t *sizer,
+                                superblock_t *superblock,
+                                const btree_key_t *key,
+                                const value_deleter_t *balancing_detacher) {
+    keyvalue_location_t kv_location;
+    find_keyvalue_location_for_write(sizer, superblock, key,
+                                     repli_timestamp_t::distant_past,
+                                     balancing_detacher, &kv_location,
+                                     nullptr /* trace */);
+    check_and_handle_underfull(sizer, &kv_location.buf, &kv_location.last_buf,
+                               kv_location.superblock, key, balancing_detacher);
+}
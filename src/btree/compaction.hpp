@@ -0,0 +1,46 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#ifndef BTREE_COMPACTION_HPP_
+#define BTREE_COMPACTION_HPP_
+
+#include <vector>
+
+#include "btree/keys.hpp"
+#include "concurrency/interruptor.hpp"
+#include "concurrency/signal.hpp"
+#include "repli_timestamp.hpp"
+
+class superblock_t;
+class value_deleter_t;
+class value_sizer_t;
+
+// Leaves only get compacted when an insertion doesn't fit otherwise, and they only get
+// merged when a write leaves them underfull.  Leaves that don't get written to any
+// more keep their removed entries and deletion entries around forever.  These
+// functions clean them up in the background; `store_t` runs them on one piece of its
+// primary btree at a time.
+
+// Compacts the leaves in `range` that haven't been written to since `cold_before`
+// (see `leaf::compact()`), if that frees up enough space to be worth it.  This drops
+// deletion entries, so backfills that start before `cold_before` may have to send
+// whole leaves.  Outputs a key of each leaf in `range` that is underfull afterwards, in
+// ascending order.  Releases the superblock.
+void btree_compact_cold_leaves(value_sizer_t *sizer,
+                               superblock_t *superblock,
+                               const key_range_t &range,
+                               repli_timestamp_t cold_before,
+                               std::vector<store_key_t> *underfull_keys_out,
+                               signal_t *interruptor)
+    THROWS_ONLY(interrupted_exc_t);
+
+// Returns the recency of the root of the tree, which is at least that of every node
+// in it.  Doesn't release the superblock.
+repli_timestamp_t btree_root_recency(superblock_t *superblock);
+
+// Merges or levels the leaf that `key` belongs in with a sibling, if it's underfull.
+// Releases the superblock.
+void btree_merge_underfull_leaf(value_sizer_t *sizer,
+                                superblock_t *superblock,
+                                const btree_key_t *key,
+                                const value_deleter_t *balancing_detacher);
+
+#endif  // BTREE_COMPACTION_HPP_
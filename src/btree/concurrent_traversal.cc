@@ -5,11 +5,17 @@
 
 #include <algorithm>
 #include <functional>
+#include <vector>
 
 #include "arch/runtime/coroutines.hpp"
+#include "btree/internal_node.hpp"
+#include "btree/node.hpp"
+#include "btree/operations.hpp"
 #include "concurrency/auto_drainer.hpp"
+#include "concurrency/pmap.hpp"
 #include "concurrency/semaphore.hpp"
 #include "concurrency/fifo_enforcer.hpp"
+#include "containers/scoped.hpp"
 
 class incr_decr_t {
 public:
@@ -32,19 +38,21 @@ namespace concurrent_traversal {
 static const int initial_semaphore_capacity = 3;
 static const int min_semaphore_capacity = 2;
 static const int max_semaphore_capacity = 30;
-static const int yield_interval = 100;
 }  // namespace concurrent_traversal
 
 class concurrent_traversal_adapter_t : public depth_first_traversal_callback_t {
 public:
 
-    explicit concurrent_traversal_adapter_t(concurrent_traversal_callback_t *cb,
-                                            cond_t *failure_cond)
+    // If `predecessor_done_or_null` isn't null, no pair gets exclusive access before
+    // it's pulsed.
+    concurrent_traversal_adapter_t(concurrent_traversal_callback_t *cb,
+                                   cond_t *failure_cond,
+                                   signal_t *predecessor_done_or_null = nullptr)
         : semaphore_(concurrent_traversal::initial_semaphore_capacity, 0.5),
           sink_waiters_(0),
           cb_(cb),
           failure_cond_(failure_cond),
-          yield_counter(0) { }
+          predecessor_done_(predecessor_done_or_null) { }
 
     continue_bool_t filter_range(
             const btree_key_t *left_excl_or_null,
@@ -82,6 +90,13 @@ public:
     }
 
     virtual continue_bool_t handle_pair(scoped_key_value_t &&keyvalue, signal_t *) {
+        bool skip;
+        cb_->filter_key(keyvalue.key(), &skip);
+        if (skip) {
+            return failure_cond_->is_pulsed()
+                ? continue_bool_t::ABORT : continue_bool_t::CONTINUE;
+        }
+
         // First thing first: Get in line with the token enforcer.
 
         fifo_enforcer_write_token_t token = source_.enter_write();
@@ -91,12 +106,7 @@ public:
 
         // Yield occasionally so we don't hog the thread if everything is in
         // memory and `cb->handle_pair()` doesn't block.
-        if (yield_counter == concurrent_traversal::yield_interval) {
-            coro_t::yield();
-            yield_counter = 0;
-        } else {
-            ++yield_counter;
-        }
+        coro_t::maybe_yield();
 
         coro_t::spawn_now_dangerously(
             std::bind(&concurrent_traversal_adapter_t::handle_pair_coro,
@@ -128,8 +138,9 @@ private:
     // the query.
     cond_t *failure_cond_;
 
-    // Counted up every time handle_pair() runs so we can yield occasionally.
-    int yield_counter;
+    // Pulsed once the traversal of the subrange before ours, and all of its calls to
+    // `cb_->handle_pair()`, are done.  Null if there is no such subrange.
+    signal_t *predecessor_done_;
 
     // We don't use the drainer's drain signal, we use failure_cond_
     auto_drainer_t drainer_;
@@ -144,6 +155,10 @@ concurrent_traversal_fifo_enforcer_signal_t(
       parent_(parent) { }
 
 void concurrent_traversal_fifo_enforcer_signal_t::wait() THROWS_NOTHING {
+    // If the subrange before ours aborted, we'd have to be interrupted so that the
+    // pairs after the abort don't get handled.
+    guarantee(parent_->predecessor_done_ == nullptr,
+              "Subranges of a traversal can only wait interruptibly.");
     cond_t non_interruptor;
     wait_with_interruptor(&non_interruptor);
 }
@@ -155,6 +170,11 @@ void concurrent_traversal_fifo_enforcer_signal_t::wait_interruptible()
 
 void concurrent_traversal_fifo_enforcer_signal_t::wait_with_interruptor(
         signal_t *interruptor) THROWS_ONLY(interrupted_exc_t) {
+    if (parent_->predecessor_done_ != nullptr) {
+        // This throws if the subrange before ours aborted the traversal.
+        ::wait_interruptible(parent_->predecessor_done_, interruptor);
+    }
+
     incr_decr_t incr_decr(&parent_->sink_waiters_);
 
     if (parent_->sink_waiters_ >= 2) {
@@ -177,12 +197,113 @@ void concurrent_traversal_fifo_enforcer_signal_t::wait_with_interruptor(
     ::wait_interruptible(eval_exclusivity_signal_, interruptor);
 }
 
+// Splits `range` into up to `max_subranges` subranges at the boundaries of the
+// children of the internal node `root`, in the order of `direction`.
+std::vector<key_range_t> split_range_at_children(const internal_node_t *root,
+                                                 const key_range_t &range,
+                                                 direction_t direction,
+                                                 int max_subranges) {
+    const int start_index = internal_node::get_offset_index(root, range.left.btree_key());
+    int end_index;
+    if (range.right.unbounded) {
+        end_index = root->npairs;
+    } else {
+        store_key_t r = range.right.key();
+        r.decrement();
+        end_index = internal_node::get_offset_index(root, r.btree_key()) + 1;
+    }
+    const int num_children = end_index - start_index;
+    const int num_subranges = std::min(max_subranges, num_children);
+
+    std::vector<key_range_t> subranges;
+    for (int i = 0; i < num_subranges; ++i) {
+        // The subrange covers the children from `first` up to `last`, exclusive.  The
+        // keys that are equal to a separator belong to the child on its left.
+        const int first = start_index + i * num_children / num_subranges;
+        const int last = start_index + (i + 1) * num_children / num_subranges;
+        const btree_key_t *left = i == 0
+            ? nullptr : &internal_node::get_pair_by_index(root, first - 1)->key;
+        const btree_key_t *right = i == num_subranges - 1
+            ? nullptr : &internal_node::get_pair_by_index(root, last - 1)->key;
+        const key_range_t children_range(
+            left != nullptr ? key_range_t::open : key_range_t::none, left,
+            right != nullptr ? key_range_t::closed : key_range_t::none, right);
+        subranges.push_back(children_range.intersection(range));
+    }
+    if (direction == BACKWARD) {
+        std::reverse(subranges.begin(), subranges.end());
+    }
+    return subranges;
+}
+
+// Traverses the subranges of `range` at the same time.  Returns false, having done
+// nothing, if the tree is empty.
+bool btree_concurrent_subrange_traversal(
+        superblock_t *superblock,
+        const key_range_t &range,
+        concurrent_traversal_callback_t *cb,
+        direction_t direction,
+        release_superblock_t release_superblock,
+        int scan_concurrency,
+        cond_t *failure_cond) {
+    const block_id_t root_block_id = superblock->get_root_block_id();
+    if (root_block_id == NULL_BLOCK_ID) {
+        return false;
+    }
+    counted_t<counted_buf_lock_and_read_t> root
+        = make_counted<counted_buf_lock_and_read_t>(
+            superblock->expose_buf(), root_block_id, access_t::read);
+    if (release_superblock == release_superblock_t::RELEASE) {
+        superblock->release();
+    }
+    root->read.init(new buf_read_t(&root->lock, page_access_priority_t::low));
+    const node_t *node = static_cast<const node_t *>(root->read->get_data_read());
+
+    std::vector<key_range_t> subranges;
+    if (node::is_internal(node)) {
+        subranges = split_range_at_children(
+            reinterpret_cast<const internal_node_t *>(node), range, direction,
+            scan_concurrency);
+    } else {
+        subranges.push_back(range);
+    }
+
+    // `subranges_done[i]` gets pulsed when the traversal of `subranges[i]` is done.
+    scoped_array_t<cond_t> subranges_done(subranges.size());
+    pmap(subranges.size(), [&](size_t i) {
+        {
+            concurrent_traversal_adapter_t adapter(
+                cb, failure_cond, i == 0 ? nullptr : &subranges_done[i - 1]);
+            cond_t non_interruptor;
+            const bool failure_seen = (continue_bool_t::ABORT
+                == btree_depth_first_traversal(root, subranges[i], &adapter,
+                                               access_t::read, direction,
+                                               &non_interruptor));
+            guarantee(!(failure_seen && !failure_cond->is_pulsed()));
+        }
+        // The adapter has drained, so all pairs of this subrange have been handled.
+        subranges_done[i].pulse();
+    });
+    return true;
+}
+
 continue_bool_t btree_concurrent_traversal(
         superblock_t *superblock,
         const key_range_t &range,
         concurrent_traversal_callback_t *cb,
         direction_t direction,
-        release_superblock_t release_superblock) {
+        release_superblock_t release_superblock,
+        int scan_concurrency) {
+    if (scan_concurrency > 1 && !range.is_empty()) {
+        cond_t failure_cond;
+        if (btree_concurrent_subrange_traversal(superblock, range, cb, direction,
+                                                release_superblock, scan_concurrency,
+                                                &failure_cond)) {
+            return failure_cond.is_pulsed()
+                ? continue_bool_t::ABORT : continue_bool_t::CONTINUE;
+        }
+    }
+
     cond_t failure_cond;
     bool failure_seen;
     {
@@ -44,9 +44,16 @@ public:
         *skip_out = false;
     }
 
+    /* Called for each key in a leaf before it gets passed to `handle_pair()`.  If it
+    sets `*skip_out` to `true`, the pair is ignored without spawning anything for it. */
+    virtual void filter_key(UNUSED const btree_key_t *key, bool *skip_out) {
+        *skip_out = false;
+    }
+
     // Passes a keyvalue and a callback.  waiter.wait_interruptible() must be called to
     // begin the region of "exclusive access", which only handle_pair implementation
-    // can enters at a time.  (This should happen after loading the value from disk
+    // can enters at a time.  Traversals with a scan concurrency above 1 only allow
+    // wait_interruptible().  (This should happen after loading the value from disk
     // (which should be done concurrently) and before using ql::env_t to evaluate
     // transforms and terminals, or whatever non-reentrant behavior you have in mind.)
     virtual continue_bool_t handle_pair(
@@ -62,11 +69,18 @@ private:
     DISABLE_COPYING(concurrent_traversal_callback_t);
 };
 
+/* If `scan_concurrency` is greater than 1, `range` is split into up to that many
+subranges at the boundaries of the root's children, which are traversed at the same
+time.  The pairs still reach the exclusive region of `cb->handle_pair()` in order, but
+a subrange holds on to the blocks it has reached until the ones before it are done.
+Unless the read sees a snapshot, a writer waiting for one of them could deadlock with
+the subranges before it, so only snapshotted reads should do this. */
 continue_bool_t btree_concurrent_traversal(
         superblock_t *superblock,
         const key_range_t &range,
         concurrent_traversal_callback_t *cb,
         direction_t direction,
-        release_superblock_t release_superblock);
+        release_superblock_t release_superblock,
+        int scan_concurrency = 1);
 
 #endif  // BTREE_CONCURRENT_TRAVERSAL_HPP_
@@ -1,9 +1,13 @@
 // Copyright 2010-2014 RethinkDB, all rights reserved.
 #include "btree/depth_first_traversal.hpp"
 
+#include <algorithm>
+#include <vector>
+
 #include "btree/internal_node.hpp"
 #include "btree/operations.hpp"
 #include "concurrency/interruptor.hpp"
+#include "config/args.hpp"
 #include "rdb_protocol/profile.hpp"
 
 scoped_key_value_t::scoped_key_value_t(const btree_key_t *_key,
@@ -17,7 +21,6 @@ scoped_key_value_t::scoped_key_value_t(scoped_key_value_t &&movee)
     : key_(movee.key_),
       value_(movee.value_),
       buf_(std::move(movee.buf_)) {
-    movee.key_ = nullptr;
     movee.value_ = nullptr;
 }
 
@@ -47,6 +50,28 @@ continue_bool_t btree_depth_first_traversal(
         const btree_key_t *right_incl,
         signal_t *interruptor);
 
+// Converts the non-empty `range` to the bounds that the traversal of a subtree
+// takes.  Returns the left bound, which points into `*left_excl_buf` or is null.
+const btree_key_t *get_range_bounds(const key_range_t &range,
+                                    store_key_t *left_excl_buf,
+                                    store_key_t *right_incl_buf) {
+    const btree_key_t *left_excl_or_null;
+    *left_excl_buf = range.left;
+    if (left_excl_buf->decrement()) {
+        left_excl_or_null = left_excl_buf->btree_key();
+    } else {
+        left_excl_or_null = nullptr;
+    }
+    if (range.right.unbounded) {
+        *right_incl_buf = store_key_t::max();
+    } else {
+        *right_incl_buf = range.right.key();
+        bool ok = right_incl_buf->decrement();
+        guarantee(ok, "this is impossible because we checked range is not empty");
+    }
+    return left_excl_or_null;
+}
+
 continue_bool_t btree_depth_first_traversal(
         superblock_t *superblock,
         const key_range_t &range,
@@ -59,21 +84,10 @@ continue_bool_t btree_depth_first_traversal(
         return continue_bool_t::CONTINUE;
     }
 
-    const btree_key_t *left_excl_or_null;
-    store_key_t left_excl_buf(range.left);
-    if (left_excl_buf.decrement()) {
-        left_excl_or_null = left_excl_buf.btree_key();
-    } else {
-        left_excl_or_null = nullptr;
-    }
+    store_key_t left_excl_buf;
     store_key_t right_incl_buf;
-    if (range.right.unbounded) {
-        right_incl_buf = store_key_t::max();
-    } else {
-        right_incl_buf = range.right.key();
-        bool ok = right_incl_buf.decrement();
-        guarantee(ok, "this is impossible because we checked range is not empty");
-    }
+    const btree_key_t *left_excl_or_null
+        = get_range_bounds(range, &left_excl_buf, &right_incl_buf);
 
     block_id_t root_block_id = superblock->get_root_block_id();
     if (root_block_id == NULL_BLOCK_ID) {
@@ -109,6 +123,25 @@ continue_bool_t btree_depth_first_traversal(
     }
 }
 
+continue_bool_t btree_depth_first_traversal(
+        counted_t<counted_buf_lock_and_read_t> root,
+        const key_range_t &range,
+        depth_first_traversal_callback_t *cb,
+        access_t access,
+        direction_t direction,
+        signal_t *interruptor) {
+    if (range.is_empty()) {
+        return continue_bool_t::CONTINUE;
+    }
+    store_key_t left_excl_buf;
+    store_key_t right_incl_buf;
+    const btree_key_t *left_excl_or_null
+        = get_range_bounds(range, &left_excl_buf, &right_incl_buf);
+    return btree_depth_first_traversal(
+        std::move(root), range, cb, access, direction,
+        left_excl_or_null, right_incl_buf.btree_key(), interruptor);
+}
+
 void get_child_key_range(
         const internal_node_t *inode,
         int child_index,
@@ -163,7 +196,15 @@ continue_bool_t btree_depth_first_traversal(
     if (skip) {
         return continue_bool_t::CONTINUE;
     }
-    block->read.init(new buf_read_t(&block->lock));
+    // A read traversal touches every block in the range once, so it shouldn't make
+    // them look worth keeping in the cache.  Traversals that share a root might have
+    // read it already.
+    if (!block->read.has()) {
+        block->read.init(new buf_read_t(&block->lock,
+                                        access == access_t::read
+                                            ? page_access_priority_t::low
+                                            : page_access_priority_t::normal));
+    }
     const node_t *node = static_cast<const node_t *>(block->read->get_data_read());
     if (node::is_internal(node)) {
         if (continue_bool_t::ABORT == cb->handle_pre_internal(
@@ -180,10 +221,46 @@ continue_bool_t btree_depth_first_traversal(
             r.decrement();
             end_index = internal_node::get_offset_index(inode, r.btree_key()) + 1;
         }
+        auto index_at = [&](int i) {
+            return direction == FORWARD ? start_index + i : (end_index - 1) - i;
+        };
+        // The children that read ahead has been started for are those before
+        // `read_ahead_end`.
+        int read_ahead_end = 1;
         for (int i = 0; i < end_index - start_index; ++i) {
-            int true_index = (direction == FORWARD ? start_index + i : (end_index - 1) - i);
+            int true_index = index_at(i);
             const btree_internal_pair *pair = internal_node::get_pair_by_index(inode, true_index);
 
+            // Once a read traversal gets past the first child, it's probably going to
+            // look at the next few children too.  Whatever order their blocks have on
+            // disk, start loading them now instead of one at a time.  Children that
+            // the callback is going to skip aren't worth loading.
+            if (access == access_t::read && i > 0) {
+                const int target = std::min(i + BTREE_TRAVERSAL_READ_AHEAD_CHILDREN,
+                                            end_index - start_index);
+                std::vector<block_id_t> read_ahead_ids;
+                for (; read_ahead_end < target; ++read_ahead_end) {
+                    const int ahead_index = index_at(read_ahead_end);
+                    const btree_key_t *ahead_left_excl_or_null;
+                    const btree_key_t *ahead_right_incl;
+                    get_child_key_range(inode, ahead_index,
+                                        left_excl_or_null, right_incl,
+                                        &ahead_left_excl_or_null, &ahead_right_incl);
+                    bool ahead_skip;
+                    if (continue_bool_t::ABORT == cb->filter_range(
+                            ahead_left_excl_or_null, ahead_right_incl, interruptor,
+                            &ahead_skip) || ahead_skip) {
+                        continue;
+                    }
+                    read_ahead_ids.push_back(internal_node::get_pair_by_index(
+                        inode, ahead_index)->lnode);
+                }
+                if (!read_ahead_ids.empty()) {
+                    buf_lock_t::prefetch_children(buf_parent_t(&block->lock),
+                                                  read_ahead_ids);
+                }
+            }
+
             // Get the child key range
             const btree_key_t *child_left_excl_or_null;
             const btree_key_t *child_right_incl;
@@ -224,10 +301,12 @@ continue_bool_t btree_depth_first_traversal(
         }
 
         const leaf_node_t *lnode = reinterpret_cast<const leaf_node_t *>(node);
+        const max_block_size_t block_size = block->lock.cache()->max_block_size();
         const btree_key_t *key;
 
         if (direction == FORWARD) {
-            for (auto it = leaf::inclusive_lower_bound(range.left.btree_key(), *lnode);
+            for (auto it = leaf::inclusive_lower_bound(block_size, range.left.btree_key(),
+                                                       *lnode);
                  it != leaf::end(*lnode); ++it) {
                 key = (*it).first;
                 // range.right is exclusive
@@ -246,9 +325,10 @@ continue_bool_t btree_depth_first_traversal(
         } else {
             leaf_node_t::reverse_iterator it;
             if (range.right.unbounded) {
-                it = leaf::rbegin(*lnode);
+                it = leaf::rbegin(block_size, *lnode);
             } else {
-                it = leaf::exclusive_upper_bound(range.right.key().btree_key(), *lnode);
+                it = leaf::exclusive_upper_bound(block_size,
+                                                 range.right.key().btree_key(), *lnode);
             }
             for (/* assignment above */; it != leaf::rend(*lnode); ++it) {
                 key = (*it).first;
@@ -37,7 +37,7 @@ public:
 
     const btree_key_t *key() const {
         guarantee(buf_.has());
-        return key_;
+        return key_.btree_key();
     }
     const void *value() const {
         guarantee(buf_.has());
@@ -50,7 +50,8 @@ public:
     void reset();
 
 private:
-    const btree_key_t *key_;
+    // A copy, since leaf nodes don't necessarily store the whole key.
+    store_key_t key_;
     const void *value_;
     movable_t<counted_buf_lock_and_read_t> buf_;
 
@@ -155,4 +156,15 @@ continue_bool_t btree_depth_first_traversal(
     release_superblock_t release_superblock,
     signal_t *interruptor);
 
+/* Like the above, but starts at `root`, which the caller has already acquired and may
+have read, instead of at the superblock. Several traversals of disjoint ranges can
+share the same `root` at the same time. */
+continue_bool_t btree_depth_first_traversal(
+    counted_t<counted_buf_lock_and_read_t> root,
+    const key_range_t &range,
+    depth_first_traversal_callback_t *cb,
+    access_t access,
+    direction_t direction,
+    signal_t *interruptor);
+
 #endif /* BTREE_DEPTH_FIRST_TRAVERSAL_HPP_ */
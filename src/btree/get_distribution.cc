@@ -4,6 +4,7 @@
 #include "btree/internal_node.hpp"
 #include "btree/node.hpp"
 #include "btree/leaf_node.hpp"
+#include "btree/operations.hpp"
 #include "btree/parallel_traversal.hpp"
 #include "buffer_cache/alt.hpp"
 #include "utils.hpp"
@@ -34,7 +35,8 @@ public:
         const leaf_node_t *node
             = static_cast<const leaf_node_t *>(read.get_data_read());
 
-        for (auto it = leaf::begin(*node); it != leaf::end(*node); ++it) {
+        const max_block_size_t block_size = leaf_node_buf->cache()->max_block_size();
+        for (auto it = leaf::begin(block_size, *node); it != leaf::end(*node); ++it) {
             const btree_key_t *key = (*it).first;
             keys->push_back(store_key_t(key->size, key->contents));
         }
@@ -98,3 +100,18 @@ void get_btree_key_distribution(superblock_t *superblock, int depth_limit,
     btree_parallel_traversal(superblock, &helper, &non_interruptor);
     *key_count_out = helper.key_count;
 }
+
+bool get_btree_population(superblock_t *superblock, int64_t *population_out) {
+    const block_id_t stat_block_id = superblock->get_stat_block_id();
+    if (stat_block_id == NULL_BLOCK_ID) {
+        return false;
+    }
+    buf_lock_t stat_block(superblock->expose_buf(), stat_block_id, access_t::read);
+    buf_read_t read(&stat_block);
+    uint16_t sb_size;
+    const btree_statblock_t *sb_data =
+        static_cast<const btree_statblock_t *>(read.get_data_read(&sb_size));
+    guarantee(sb_size == BTREE_STATBLOCK_SIZE);
+    *population_out = sb_data->population;
+    return true;
+}
@@ -13,4 +13,8 @@ void get_btree_key_distribution(superblock_t *superblock, int depth_limit,
                                 int64_t *key_count_out,
                                 std::vector<store_key_t> *keys_out);
 
+// Reads the number of keys in the btree from its stat block, in the same version of
+// the btree as `superblock`.  Returns false if the btree doesn't keep a stat block.
+bool get_btree_population(superblock_t *superblock, int64_t *population_out);
+
 #endif /* BTREE_GET_DISTRIBUTION_HPP_ */
@@ -357,7 +357,21 @@ btree_internal_pair *get_pair_by_index(internal_node_t *node, int index) {
 }
 
 int get_offset_index(const internal_node_t *node, const btree_key_t *key) {
-    return std::lower_bound(node->pair_offsets, node->pair_offsets+node->npairs-1, (uint16_t) internal_key_comp::faux_offset, internal_key_comp(node, key)) - node->pair_offsets;
+    // This is a `std::lower_bound()` with `internal_key_comp`, except that it compares
+    // the first bytes of the keys as words before it compares the whole keys.
+    const uint64_t word = key_prefix_word(key->contents, key->size);
+    int beg = 0;
+    int end = node->npairs - 1;
+    while (beg < end) {
+        int test_point = beg + (end - beg) / 2;
+        const btree_key_t *pair_key = &get_pair_by_index(node, test_point)->key;
+        if (key_prefix_word_cmp(word, key->contents, key->size, pair_key) > 0) {
+            beg = test_point + 1;
+        } else {
+            end = test_point;
+        }
+    }
+    return beg;
 }
 
 int nodecmp(const internal_node_t *node1, const internal_node_t *node2) {
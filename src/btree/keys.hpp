@@ -3,6 +3,7 @@
 #define BTREE_KEYS_HPP_
 
 #include <stddef.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <string.h>
 
@@ -52,6 +53,40 @@ inline int btree_key_cmp(const btree_key_t *left, const btree_key_t *right) {
     return sized_strcmp(left->contents, left->size, right->contents, right->size);
 }
 
+// The first eight bytes of a key as a big-endian number, padded with zeroes.  If the
+// words of two keys differ, the keys compare the same way their words do, so binary
+// searches can compare the word of the key they look for with the words of the keys
+// in the node and only compare whole keys when the words are equal.
+inline uint64_t key_prefix_word(const uint8_t *contents, int size) {
+    uint64_t word = 0;
+    if (size >= 8) {
+        memcpy(&word, contents, sizeof(word));
+#if defined(__GNUC__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+        return __builtin_bswap64(word);
+#elif defined(__GNUC__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        return word;
+#else
+        size = 8;
+        word = 0;
+#endif
+    }
+    for (int i = 0; i < size; ++i) {
+        word |= static_cast<uint64_t>(contents[i]) << (56 - 8 * i);
+    }
+    return word;
+}
+
+// Compares the key in `contents` and `size`, whose `key_prefix_word()` is `word`, to
+// `right`, like `btree_key_cmp()`.
+inline int key_prefix_word_cmp(uint64_t word, const uint8_t *contents, int size,
+                               const btree_key_t *right) {
+    const uint64_t right_word = key_prefix_word(right->contents, right->size);
+    if (word != right_word) {
+        return word < right_word ? -1 : 1;
+    }
+    return sized_strcmp(contents, size, right->contents, right->size);
+}
+
 struct store_key_t {
 public:
     store_key_t() {
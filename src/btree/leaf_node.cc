@@ -6,7 +6,9 @@
 #include <algorithm>
 #include <set>
 
+#include "btree/keys.hpp"
 #include "btree/node.hpp"
+#include "containers/scoped.hpp"
 #include "repli_timestamp.hpp"
 #include "utils.hpp"
 
@@ -45,7 +47,13 @@ const int SKIP_ENTRY_CODE_TWO = 253;
 // Means we have a skipped entry exactly N bytes long, of form { uint8_t 252; uint16_t N; char garbage[]; }
 const int SKIP_ENTRY_CODE_MANY = 252;
 
-// A reserved meaningless value.
+// Means the entry's key is stored in full, without leaving out the prefix that the
+// node's other keys share.  Only nodes in the prefixed format (see below) have these.
+const int FULL_KEY_ENTRY_CODE = 251;
+
+// A meaningless value that the extra bytes of skip entries get filled with.  It's
+// the same as FULL_KEY_ENTRY_CODE, but since an entry never starts with one of the
+// extra bytes, that doesn't matter.
 const int SKIP_ENTRY_RESERVED = 251;
 
 
@@ -79,6 +87,80 @@ const int SKIP_ENTRY_RESERVED = 251;
 // itself three bytes, so it can't fit in a slot of size one or two. We don't
 // expect to actually see many entries of size one or two, but it pays to be
 // thorough.
+//
+// Nodes in the prefixed format leave out the prefix that their keys have in common
+// from the keys of their entries, and store it once at the very end of the block,
+// followed by its size.  Their entries end where the prefix starts:
+//
+//   .....[entry][entry][entry][prefix bytes][prefix size]
+//                             ^                          ^
+//                       (entries end)               (block size)
+//
+// A key that got inserted later and doesn't start with the prefix is stored in
+// full in an entry of its own kind:
+//
+//   [251][btree key][btree value]                  -- a live entry with a full key
+//   [255][251][btree key]                          -- a deletion entry with a full key
+//
+// Keys get compared, binary searched and handed out as whole keys, so none of this
+// is visible outside of this file.  Nodes only get a prefix when they are built from
+// scratch, which happens when they get split, merged or leveled, and only if that
+// saves space.  Nodes in the old format can still be read and get converted then.
+// Prefixed nodes have the value type's leaf magic with its last byte replaced by
+// PREFIXED_LEAF_MAGIC_MARKER, so we can tell them apart without a value sizer.
+
+const uint8_t PREFIXED_LEAF_MAGIC_MARKER = '+';
+
+bool is_prefixed(const leaf_node_t *node) {
+    return node->magic.bytes[3] == PREFIXED_LEAF_MAGIC_MARKER;
+}
+
+block_magic_t prefixed_leaf_magic(value_sizer_t *sizer) {
+    block_magic_t magic = sizer->btree_leaf_magic();
+    rassert(magic.bytes[3] != PREFIXED_LEAF_MAGIC_MARKER);
+    magic.bytes[3] = PREFIXED_LEAF_MAGIC_MARKER;
+    return magic;
+}
+
+bool has_leaf_magic(value_sizer_t *sizer, const leaf_node_t *node) {
+    return node->magic == sizer->btree_leaf_magic()
+        || node->magic == prefixed_leaf_magic(sizer);
+}
+
+// The prefix that the keys of a node share.  It's empty for nodes in the old format.
+struct key_prefix_t {
+    const uint8_t *contents;
+    int size;
+};
+
+key_prefix_t get_prefix(max_block_size_t block_size, const leaf_node_t *node) {
+    key_prefix_t ret;
+    if (!is_prefixed(node)) {
+        ret.contents = nullptr;
+        ret.size = 0;
+    } else {
+        const uint8_t *end = reinterpret_cast<const uint8_t *>(node) + block_size.value();
+        ret.size = end[-1];
+        ret.contents = end - 1 - ret.size;
+    }
+    return ret;
+}
+
+key_prefix_t get_prefix(value_sizer_t *sizer, const leaf_node_t *node) {
+    return get_prefix(sizer->block_size(), node);
+}
+
+// The offset that the entries of `node` end at.
+int entries_end(value_sizer_t *sizer, const leaf_node_t *node) {
+    int bs = sizer->block_size().value();
+    return is_prefixed(node) ? bs - 1 - get_prefix(sizer, node).size : bs;
+}
+
+bool has_prefix(const btree_key_t *key, key_prefix_t prefix) {
+    return prefix.size == 0
+        || (key->size >= prefix.size
+            && memcmp(key->contents, prefix.contents, prefix.size) == 0);
+}
 
 
 struct entry_t;
@@ -86,34 +168,76 @@ struct value_t;
 
 bool entry_is_deletion(const entry_t *p) {
     uint8_t x = *reinterpret_cast<const uint8_t *>(p);
-    rassert(x != SKIP_ENTRY_RESERVED);
     return x == DELETE_ENTRY_CODE;
 }
 
 bool entry_is_live(const entry_t *p) {
     uint8_t x = *reinterpret_cast<const uint8_t *>(p);
-    rassert(x != SKIP_ENTRY_RESERVED);
     rassert(MAX_KEY_SIZE == 250);
-    return x <= MAX_KEY_SIZE;
+    return x <= MAX_KEY_SIZE || x == FULL_KEY_ENTRY_CODE;
 }
 
 bool entry_is_skip(const entry_t *p) {
     return !entry_is_deletion(p) && !entry_is_live(p);
 }
 
+// Returns the number of code bytes in front of the key of a live or deletion entry.
+int entry_key_offset(const entry_t *p) {
+    const uint8_t *q = reinterpret_cast<const uint8_t *>(p);
+    int offset = (q[0] == DELETE_ENTRY_CODE ? 1 : 0);
+    return q[offset] == FULL_KEY_ENTRY_CODE ? offset + 1 : offset;
+}
+
+// True if the key of `p` doesn't leave out the node's prefix.
+bool entry_has_full_key(const entry_t *p) {
+    return entry_key_offset(p) != (entry_is_deletion(p) ? 1 : 0);
+}
+
+// The key as it's stored in the entry, which is only the part of the key after the
+// node's prefix unless `entry_has_full_key()`.
 const btree_key_t *entry_key(const entry_t *p) {
-    if (entry_is_deletion(p)) {
-        return reinterpret_cast<const btree_key_t *>(1 + reinterpret_cast<const char *>(p));
-    } else {
-        return reinterpret_cast<const btree_key_t *>(p);
+    return reinterpret_cast<const btree_key_t *>(
+        entry_key_offset(p) + reinterpret_cast<const char *>(p));
+}
+
+// Compares `key` to the whole key of `p`, in a node whose keys share `prefix`.
+int entry_key_cmp(const btree_key_t *key, key_prefix_t prefix, const entry_t *p) {
+    const btree_key_t *ek = entry_key(p);
+    if (prefix.size == 0 || entry_has_full_key(p)) {
+        return btree_key_cmp(key, ek);
+    }
+    int res = memcmp(key->contents, prefix.contents,
+                     std::min<int>(key->size, prefix.size));
+    if (res != 0) {
+        return res;
+    }
+    if (key->size < prefix.size) {
+        // `key` is a proper prefix of the entry's key.
+        return -1;
     }
+    return sized_strcmp(key->contents + prefix.size, key->size - prefix.size,
+                        ek->contents, ek->size);
+}
+
+// Returns the whole key of `p`.  It's either in the node or in `buf`.
+const btree_key_t *full_entry_key(key_prefix_t prefix, const entry_t *p,
+                                  store_key_t *buf) {
+    const btree_key_t *ek = entry_key(p);
+    if (prefix.size == 0 || entry_has_full_key(p)) {
+        return ek;
+    }
+    rassert(prefix.size + ek->size <= MAX_KEY_SIZE);
+    buf->set_size(prefix.size + ek->size);
+    memcpy(buf->contents(), prefix.contents, prefix.size);
+    memcpy(buf->contents() + prefix.size, ek->contents, ek->size);
+    return buf->btree_key();
 }
 
 const void *entry_value(const entry_t *p) {
     if (entry_is_deletion(p)) {
         return nullptr;
     } else {
-        return reinterpret_cast<const char *>(p) + entry_key(p)->full_size();
+        return reinterpret_cast<const char *>(entry_key(p)) + entry_key(p)->full_size();
     }
 }
 
@@ -121,7 +245,7 @@ int entry_size(value_sizer_t *sizer, const entry_t *p) {
     uint8_t code = *reinterpret_cast<const uint8_t *>(p);
     switch (code) {
     case DELETE_ENTRY_CODE:
-        return 1 + entry_key(p)->full_size();
+        return entry_key_offset(p) + entry_key(p)->full_size();
     case SKIP_ENTRY_CODE_ONE:
         return 1;
     case SKIP_ENTRY_CODE_TWO:
@@ -129,8 +253,9 @@ int entry_size(value_sizer_t *sizer, const entry_t *p) {
     case SKIP_ENTRY_CODE_MANY:
         return 3 + *reinterpret_cast<const uint16_t *>(1 + reinterpret_cast<const char *>(p));
     default:
-        rassert(code <= MAX_KEY_SIZE);
-        return entry_key(p)->full_size() + sizer->size(entry_value(p));
+        rassert(code <= MAX_KEY_SIZE || code == FULL_KEY_ENTRY_CODE);
+        return entry_key_offset(p) + entry_key(p)->full_size()
+            + sizer->size(entry_value(p));
     }
 }
 
@@ -152,22 +277,23 @@ repli_timestamp_t get_timestamp(const leaf_node_t *node, int offset) {
 
 struct entry_iter_t {
     int offset;
+    int end;
 
     void step(value_sizer_t *sizer, const leaf_node_t *node) {
-        rassert(!done(sizer));
+        rassert(!done());
 
         offset += entry_size(sizer, get_entry(node, offset)) + (offset < node->tstamp_cutpoint ? sizeof(repli_timestamp_t) : 0);
     }
 
-    bool done(value_sizer_t *sizer) const {
-        int bs = sizer->block_size().value();
-        guarantee(offset <= bs, "offset=%d, bs=%d", offset, bs);
-        return offset == bs;
+    bool done() const {
+        guarantee(offset <= end, "offset=%d, end=%d", offset, end);
+        return offset == end;
     }
 
-    static entry_iter_t make(const leaf_node_t *node) {
+    static entry_iter_t make(value_sizer_t *sizer, const leaf_node_t *node) {
         entry_iter_t ret;
         ret.offset = node->frontmost;
+        ret.end = entries_end(sizer, node);
         return ret;
     }
 };
@@ -194,6 +320,12 @@ std::string strprint_leaf(value_sizer_t *sizer, const leaf_node_t *node) {
     out += strprintf("Leaf(magic='%4.4s', num_pairs=%u, live_size=%u, frontmost=%u, tstamp_cutpoint=%u)\n",
             node->magic.bytes, node->num_pairs, node->live_size, node->frontmost, node->tstamp_cutpoint);
 
+    if (is_prefixed(node)) {
+        const key_prefix_t prefix = get_prefix(sizer, node);
+        out += strprintf("  Prefix: %.*s\n", prefix.size,
+                         reinterpret_cast<const char *>(prefix.contents));
+    }
+
     out += strprintf("  Offsets:");
     for (int i = 0; i < node->num_pairs; ++i) {
         out += strprintf(" %d", node->pair_offsets[i]);
@@ -209,8 +341,8 @@ std::string strprint_leaf(value_sizer_t *sizer, const leaf_node_t *node) {
 
     out += strprintf("  By Offset:");
 
-    entry_iter_t iter = entry_iter_t::make(node);
-    while (out += strprintf(" %d", iter.offset), !iter.done(sizer)) {
+    entry_iter_t iter = entry_iter_t::make(sizer, node);
+    while (out += strprintf(" %d", iter.offset), !iter.done()) {
         out += strprintf(":");
         if (iter.offset < node->tstamp_cutpoint) {
             repli_timestamp_t tstamp = get_timestamp(node, iter.offset);
@@ -247,6 +379,12 @@ void print(FILE *fp, value_sizer_t *sizer, const leaf_node_t *node) {
     fprintf(fp, "Leaf(magic='%4.4s', num_pairs=%u, live_size=%u, frontmost=%u, tstamp_cutpoint=%u)\n",
             node->magic.bytes, node->num_pairs, node->live_size, node->frontmost, node->tstamp_cutpoint);
 
+    if (is_prefixed(node)) {
+        const key_prefix_t prefix = get_prefix(sizer, node);
+        fprintf(fp, "  Prefix: %.*s\n", prefix.size,
+                reinterpret_cast<const char *>(prefix.contents));
+    }
+
     fprintf(fp, "  Offsets:");
     for (int i = 0; i < node->num_pairs; ++i) {
         fprintf(fp, " %d", node->pair_offsets[i]);
@@ -264,8 +402,8 @@ void print(FILE *fp, value_sizer_t *sizer, const leaf_node_t *node) {
     fprintf(fp, "  By Offset:");
     fflush(fp);
 
-    entry_iter_t iter = entry_iter_t::make(node);
-    while (fprintf(fp, " %d", iter.offset), fflush(fp), !iter.done(sizer)) {
+    entry_iter_t iter = entry_iter_t::make(sizer, node);
+    while (fprintf(fp, " %d", iter.offset), fflush(fp), !iter.done()) {
         fprintf(fp, ":");
         fflush(fp);
         if (iter.offset < node->tstamp_cutpoint) {
@@ -308,17 +446,22 @@ bool fsck(value_sizer_t *sizer, const btree_key_t *left_exclusive_or_null, const
     // tstamp_cutpoint lies on an entry boundary, and that frontmost
     // is not before the end of pair_offsets
 
+    if (failed(has_leaf_magic(sizer, node), "bad leaf magic")
+        || failed(get_prefix(sizer, node).size <= MAX_KEY_SIZE, "prefix is too long")) {
+        return false;
+    }
+    const key_prefix_t prefix = get_prefix(sizer, node);
+    const int end = entries_end(sizer, node);
+
     // Basic sanity checks on fields' values.
-    if (failed(node->magic == sizer->btree_leaf_magic(),
-               "bad leaf magic")
-        || failed(node->frontmost >= offsetof(leaf_node_t, pair_offsets) + node->num_pairs * sizeof(uint16_t),
+    if (failed(node->frontmost >= offsetof(leaf_node_t, pair_offsets) + node->num_pairs * sizeof(uint16_t),
                   "frontmost offset is before the end of pair_offsets")
-        || failed(node->live_size <= (sizer->block_size().value() - node->frontmost) + sizeof(uint16_t) * node->num_pairs,
+        || failed(node->live_size <= (end - node->frontmost) + sizeof(uint16_t) * node->num_pairs,
                   "live_size is impossibly large")
         || failed(node->tstamp_cutpoint >= node->frontmost,
                   "timestamp cut offset below frontmost offset")
-        || failed(node->tstamp_cutpoint <= sizer->block_size().value(),
-                  "timestamp cut offset larger than block size")
+        || failed(node->tstamp_cutpoint <= end,
+                  "timestamp cut offset larger than the end of the entries")
         ) {
         return false;
     }
@@ -331,13 +474,13 @@ bool fsck(value_sizer_t *sizer, const btree_key_t *left_exclusive_or_null, const
 
     if (failed(node->num_pairs == 0 || node->frontmost <= offs[0],
                "smallest pair offset is before frontmost offset")
-        || failed(node->num_pairs == 0 || offs[node->num_pairs - 1] < sizer->block_size().value(),
-                  "largest pair offset is larger than block size")
+        || failed(node->num_pairs == 0 || offs[node->num_pairs - 1] < end,
+                  "largest pair offset is past the end of the entries")
         ) {
         return false;
     }
 
-    entry_iter_t iter = entry_iter_t::make(node);
+    entry_iter_t iter = entry_iter_t::make(sizer, node);
 
     int observed_live_size = 0;
 
@@ -346,7 +489,7 @@ bool fsck(value_sizer_t *sizer, const btree_key_t *left_exclusive_or_null, const
     static_assert(std::is_same<uint64_t, decltype(repli_timestamp_t::longtime)>::value,
                   "This code assumes repli_timestamp_t is a uint64_t.");
     uint64_t earliest_so_far = UINT64_MAX;
-    while (!iter.done(sizer)) {
+    while (!iter.done()) {
         int offset = iter.offset;
 
         // tstamp_cutpoint is supposed to be on some entry's offset.
@@ -357,8 +500,9 @@ bool fsck(value_sizer_t *sizer, const btree_key_t *left_exclusive_or_null, const
             seen_tstamp_cutpoint = true;
         }
 
-        if (failed(offset + (offset < node->tstamp_cutpoint ? sizeof(repli_timestamp_t) : 0) < sizer->block_size().value(),
-                   "offset would be past block size after accounting for the timestamp")) {
+        int tstamp_size = offset < node->tstamp_cutpoint ? sizeof(repli_timestamp_t) : 0;
+        if (failed(offset + tstamp_size < end,
+                   "offset would be past the end of the entries after accounting for the timestamp")) {
             return false;
         }
 
@@ -372,16 +516,24 @@ bool fsck(value_sizer_t *sizer, const btree_key_t *left_exclusive_or_null, const
         }
 
         const entry_t *ent = get_entry(node, offset);
+        if (!entry_is_skip(ent)
+            && failed(entry_has_full_key(ent)
+                      || prefix.size + entry_key(ent)->size <= MAX_KEY_SIZE,
+                      "key is too long together with the prefix")) {
+            return false;
+        }
         if (entry_is_live(ent)) {
             const void *value = entry_value(ent);
-            int space = sizer->block_size().value() - (reinterpret_cast<const char *>(value) - reinterpret_cast<const char *>(node));
+            int space = end - (reinterpret_cast<const char *>(value) - reinterpret_cast<const char *>(node));
             if (!sizer->fits(value, space)) {
                 *msg_out = strprintf("problem with key %.*s: value does not fit\n", entry_key(ent)->size, entry_key(ent)->contents);
                 return false;
             }
 
             std::string fscker_msg;
-            if (!fscker->fsck(sizer, entry_key(ent), value, &fscker_msg)) {
+            store_key_t key_buf;
+            if (!fscker->fsck(sizer, full_entry_key(prefix, ent, &key_buf), value,
+                              &fscker_msg)) {
                 *msg_out = strprintf("Problem with key %.*s: %s\n", entry_key(ent)->size, entry_key(ent)->contents, fscker_msg.c_str());
                 return false;
             }
@@ -420,13 +572,17 @@ bool fsck(value_sizer_t *sizer, const btree_key_t *left_exclusive_or_null, const
     // Entries look valid, check key ordering.
 
     const btree_key_t *last = left_exclusive_or_null;
+    store_key_t key_buf;
+    store_key_t last_buf;
     for (int k = 0; k < node->num_pairs; ++k) {
-        const btree_key_t *key = entry_key(get_entry(node, node->pair_offsets[k]));
+        const btree_key_t *key = full_entry_key(
+            prefix, get_entry(node, node->pair_offsets[k]), &key_buf);
         if (failed(last == nullptr || btree_key_cmp(last, key) < 0,
                    "keys out of order")) {
             return false;
         }
-        last = key;
+        last_buf.assign(key);
+        last = last_buf.btree_key();
     }
 
     if (failed(last == nullptr || right_inclusive_or_null == nullptr
@@ -456,12 +612,48 @@ void init(value_sizer_t *sizer, leaf_node_t *node) {
     node->tstamp_cutpoint = node->frontmost;
 }
 
-int free_space(value_sizer_t *sizer) {
-    return sizer->block_size().value() - offsetof(leaf_node_t, pair_offsets);
+int free_space(value_sizer_t *sizer, const leaf_node_t *node) {
+    return entries_end(sizer, node) - offsetof(leaf_node_t, pair_offsets);
+}
+
+// The size of the entry for `key` without its value.
+int encoded_key_size(key_prefix_t prefix, const btree_key_t *key) {
+    return prefix.size == 0 || has_prefix(key, prefix)
+        ? key->full_size() - prefix.size
+        : 1 + key->full_size();
+}
+
+// The size of the entry for `key` without its timestamp, in a node whose keys share
+// `prefix`.  `value` is null for deletion entries.
+int encoded_entry_size(value_sizer_t *sizer, key_prefix_t prefix,
+                       const btree_key_t *key, const void *value) {
+    return encoded_key_size(prefix, key)
+        + (value == nullptr ? 1 : sizer->size(value));
+}
+
+// Writes the entry for `key` to `dest`, which has room for `encoded_entry_size()`
+// bytes.
+void write_entry(value_sizer_t *sizer, key_prefix_t prefix, const btree_key_t *key,
+                 const void *value, char *dest) {
+    if (value == nullptr) {
+        *dest++ = static_cast<char>(DELETE_ENTRY_CODE);
+    }
+    if (prefix.size == 0 || has_prefix(key, prefix)) {
+        *reinterpret_cast<uint8_t *>(dest) = key->size - prefix.size;
+        memcpy(dest + 1, key->contents + prefix.size, key->size - prefix.size);
+        dest += key->full_size() - prefix.size;
+    } else {
+        *dest++ = static_cast<char>(FULL_KEY_ENTRY_CODE);
+        memcpy(dest, key, key->full_size());
+        dest += key->full_size();
+    }
+    if (value != nullptr) {
+        memcpy(dest, value, sizer->size(value));
+    }
 }
 
 // Returns the mandatory storage cost of the node, returning a value
-// in the closed interval [0, free_space(sizer)].  Outputs the offset
+// in the closed interval [0, free_space(sizer, node)].  Outputs the offset
 // of the first entry for which storing a timestamp is not mandatory.
 int mandatory_cost(value_sizer_t *sizer, const leaf_node_t *node, int required_timestamps, int *tstamp_back_offset_out) {
     int size = node->live_size;
@@ -470,11 +662,11 @@ int mandatory_cost(value_sizer_t *sizer, const leaf_node_t *node, int required_t
     // entries' timestamps, and live entries' timestamps.  We add that
     // to size.
 
-    entry_iter_t iter = entry_iter_t::make(node);
+    entry_iter_t iter = entry_iter_t::make(sizer, node);
     int count = 0;
     int deletions_cost = 0;
-    int max_deletions_cost = free_space(sizer) / DELETION_RESERVE_FRACTION;
-    while (!(count == required_timestamps || iter.done(sizer) || iter.offset >= node->tstamp_cutpoint)) {
+    int max_deletions_cost = free_space(sizer, node) / DELETION_RESERVE_FRACTION;
+    while (!(count == required_timestamps || iter.done() || iter.offset >= node->tstamp_cutpoint)) {
         const entry_t *ent = get_entry(node, iter.offset);
         if (entry_is_deletion(ent)) {
             if (deletions_cost >= max_deletions_cost) {
@@ -507,7 +699,8 @@ int leaf_epsilon(value_sizer_t *sizer) {
     // Returns the maximum possible entry size, i.e. the key cost plus
     // the value cost plus pair_offsets plus timestamp cost.
 
-    int key_cost = sizeof(uint8_t) + MAX_KEY_SIZE;
+    // Keys that don't have the node's prefix take FULL_KEY_ENTRY_CODE as well.
+    int key_cost = sizeof(uint8_t) + sizeof(uint8_t) + MAX_KEY_SIZE;
 
     // If the value is always empty, the DELETE_ENTRY_CODE byte needs to be considered.
     int n = std::max(sizer->max_possible_size(), 1);
@@ -522,6 +715,11 @@ bool is_empty(const leaf_node_t *node) {
 }
 
 bool is_full(value_sizer_t *sizer, const leaf_node_t *node, const btree_key_t *key, const void *value) {
+    return is_full_for_value_size(sizer, node, key, sizer->size(value));
+}
+
+bool is_full_for_value_size(value_sizer_t *sizer, const leaf_node_t *node,
+                            const btree_key_t *key, int value_size) {
 
     // Upon an insertion, we preserve `MANDATORY_TIMESTAMPS - 1`
     // timestamps and add our own (accounted for below)
@@ -540,10 +738,11 @@ bool is_full(value_sizer_t *sizer, const leaf_node_t *node, const btree_key_t *k
     // insert.  We conservatively assume the key is not already
     // contained in the node.
 
-    size += sizeof(uint16_t) + sizeof(repli_timestamp_t) + key->full_size() + sizer->size(value);
+    size += sizeof(uint16_t) + sizeof(repli_timestamp_t)
+        + encoded_key_size(get_prefix(sizer, node), key) + value_size;
 
     // The node is full if we can't fit all that data within the free space.
-    return size > free_space(sizer);
+    return size > free_space(sizer, node);
 }
 
 bool is_underfull(value_sizer_t *sizer, const leaf_node_t *node) {
@@ -562,9 +761,19 @@ bool is_underfull(value_sizer_t *sizer, const leaf_node_t *node) {
     // free_space / 2 - leaf_epsilon.  We don't want an immediately
     // split node to be underfull, hence the threshold used below.
 
-    return mandatory_cost(sizer, node, MANDATORY_TIMESTAMPS) < free_space(sizer) / 2 - leaf_epsilon(sizer);
+    return mandatory_cost(sizer, node, MANDATORY_TIMESTAMPS) < free_space(sizer, node) / 2 - leaf_epsilon(sizer);
 }
 
+bool change_unsafe(value_sizer_t *sizer, const leaf_node_t *node,
+                   const btree_key_t *key) {
+    if (is_full_for_value_size(sizer, node, key, sizer->max_possible_size())) {
+        return true;
+    }
+    // Removing an entry lowers the mandatory cost by at most the size of the
+    // biggest possible entry.
+    return mandatory_cost(sizer, node, MANDATORY_TIMESTAMPS) - leaf_epsilon(sizer)
+        < free_space(sizer, node) / 2 - leaf_epsilon(sizer);
+}
 
 // Compares indices by looking at values in another array.
 class indirect_index_comparator_t {
@@ -602,7 +811,7 @@ void garbage_collect(
         mand_offset = std::min(*tstamp_cutoff_upper_bound, mand_offset);
     }
 
-    int w = sizer->block_size().value();
+    int w = entries_end(sizer, node);
     int i = node->num_pairs - 1;
     for (; i >= 0; --i) {
         int offset = node->pair_offsets[indices[i]];
@@ -671,6 +880,16 @@ void garbage_collect(value_sizer_t *sizer, leaf_node_t *node, int num_tstamped)
     rassert(ignore == 0);
 }
 
+int reclaimable_space(value_sizer_t *sizer, const leaf_node_t *node) {
+    const int used = entries_end(sizer, node) - node->frontmost
+        + sizeof(uint16_t) * node->num_pairs;
+    return used - mandatory_cost(sizer, node, MANDATORY_TIMESTAMPS);
+}
+
+void compact(value_sizer_t *sizer, leaf_node_t *node) {
+    garbage_collect(sizer, node, MANDATORY_TIMESTAMPS);
+}
+
 void clean_entry(void *p, int sz) {
     rassert(sz > 0);
 
@@ -692,348 +911,387 @@ void clean_entry(void *p, int sz) {
     }
 }
 
-// Moves entries with pair_offsets indices in the clopen range [beg,
-// end) from fro to tow.
-void move_elements(value_sizer_t *sizer, leaf_node_t *fro, int beg, int end,
-                   int wpoint, leaf_node_t *tow, int fro_copysize,
-                   int fro_mand_offset,
-                   std::vector<const void *> *moved_values_out) {
-    rassert(is_underfull(sizer, tow));
-    rassert(end >= beg);
-
-    // This assertion is a bit loose.
-    rassert(fro_copysize + mandatory_cost(sizer, tow, MANDATORY_TIMESTAMPS) <= free_space(sizer));
-
-    // Make tow have a nice big region we can copy entries to.  Also,
-    // this means we have no "skip" entries in tow.
-    garbage_collect(sizer, tow, MANDATORY_TIMESTAMPS, &wpoint);
-
-    // Now resize and move tow's pair_offsets.
-    memmove(tow->pair_offsets + wpoint + (end - beg), tow->pair_offsets + wpoint, sizeof(uint16_t) * (tow->num_pairs - wpoint));
-
-    tow->num_pairs += end - beg;
-
-    // pos a
-
-    // Now we're going to do something crazy.  Fill the new hole in
-    // the pair offsets with the numbers in [0, end - beg).
-    for (int i = 0; i < end - beg; ++i) {
-        tow->pair_offsets[wpoint + i] = i;
-    }
-
-    // We treat these numbers as indices into [beg, end) in fro, and
-    // sort them so that we can access [beg, end) in order by
-    // increasing offset.
-    std::sort(tow->pair_offsets + wpoint, tow->pair_offsets + wpoint + (end - beg), indirect_index_comparator_t(fro->pair_offsets + beg));
-
-    int tow_offset = tow->frontmost;
-
-    // The offset we read from (indirectly pointing to fro's [beg,
-    // end)) in tow->pair_offsets, and the offset at which we stop.
-    int fro_index = wpoint;
-    int fro_index_end = wpoint + (end - beg);
-
-    const int new_frontmost = tow->frontmost - fro_copysize;
-
-    int wri_offset = new_frontmost;
-
-    int adjustable_tow_offsets[MANDATORY_TIMESTAMPS];
-    int num_adjustable_tow_offsets = 0;
-
-    // To detect bugs in the code
-    int actually_copied = 0;
+// An entry of a node that's getting rebuilt, with its whole key.
+struct rebuild_entry_t {
+    store_key_t key;
+    // Null for deletion entries.  Points into a copy of the old node.
+    const void *value;
+    bool has_tstamp;
+    repli_timestamp_t tstamp;
+    // Whether the old node had to keep the entry's timestamp, see `mandatory_cost()`.
+    bool mandatory;
+    // The entry's share of the mandatory cost of the old node.
+    int weight;
+};
 
-    // We will gradually compute the live size.
-    int livesize = tow->live_size;
+// Collects the entries of `node` from the most to the least recent.
+void collect_entries(value_sizer_t *sizer, const leaf_node_t *node,
+                     std::vector<rebuild_entry_t> *entries_out) {
+    int tstamp_back_offset;
+    mandatory_cost(sizer, node, MANDATORY_TIMESTAMPS, &tstamp_back_offset);
+    const key_prefix_t prefix = get_prefix(sizer, node);
 
-    for (int i = 0; i < wpoint; ++i) {
-        if (tow->pair_offsets[i] < tow->tstamp_cutpoint) {
-            rassert(num_adjustable_tow_offsets < MANDATORY_TIMESTAMPS);
-            adjustable_tow_offsets[num_adjustable_tow_offsets] = i;
-            ++num_adjustable_tow_offsets;
+    entries_out->clear();
+    entries_out->reserve(node->num_pairs);
+    for (entry_iter_t iter = entry_iter_t::make(sizer, node);
+            !iter.done(); iter.step(sizer, node)) {
+        const entry_t *ent = get_entry(node, iter.offset);
+        if (entry_is_skip(ent)) {
+            continue;
         }
-    }
-
-    for (int i = wpoint + (end - beg); i < tow->num_pairs; ++i) {
-        if (tow->pair_offsets[i] < tow->tstamp_cutpoint) {
-            rassert(num_adjustable_tow_offsets < MANDATORY_TIMESTAMPS);
-            adjustable_tow_offsets[num_adjustable_tow_offsets] = i;
-            ++num_adjustable_tow_offsets;
+        entries_out->push_back(rebuild_entry_t());
+        rebuild_entry_t *e = &entries_out->back();
+        const btree_key_t *key = full_entry_key(prefix, ent, &e->key);
+        if (key != e->key.btree_key()) {
+            e->key.assign(key);
+        }
+        e->value = entry_value(ent);
+        e->has_tstamp = iter.offset < node->tstamp_cutpoint;
+        e->tstamp = e->has_tstamp
+            ? get_timestamp(node, iter.offset)
+            : repli_timestamp_t::distant_past;
+        e->mandatory = iter.offset < tstamp_back_offset;
+        if (entry_is_live(ent)) {
+            e->weight = sizeof(uint16_t) + entry_size(sizer, ent)
+                + (e->mandatory ? sizeof(repli_timestamp_t) : 0);
+        } else {
+            e->weight = e->mandatory
+                ? sizeof(uint16_t) + sizeof(repli_timestamp_t) + entry_size(sizer, ent)
+                : 0;
         }
     }
+}
 
-    int fro_live_size_adjustment = 0;
+store_key_t node_prefix(value_sizer_t *sizer, const leaf_node_t *node) {
+    const key_prefix_t prefix = get_prefix(sizer, node);
+    return store_key_t(prefix.size, prefix.contents);
+}
 
-    for (;;) {
-        rassert(tow_offset <= tow->tstamp_cutpoint);
-        if (tow_offset == tow->tstamp_cutpoint || fro_index == fro_index_end) {
-            // We have no more timestamped information to push.
-            break;
-        }
+key_prefix_t as_prefix(const store_key_t &key) {
+    key_prefix_t ret;
+    ret.contents = key.contents();
+    ret.size = key.size();
+    return ret;
+}
 
-        int fro_offset = fro->pair_offsets[beg + tow->pair_offsets[fro_index]];
+// An entry as it will be written to a node that's getting rebuilt.
+struct planned_entry_t {
+    const rebuild_entry_t *entry;
+    bool has_tstamp;
+};
 
-        if (fro_offset >= fro_mand_offset) {
-            // We have no more timestamped information to push.
-            break;
+// Appends `entries` to `plan` in the same order.  If `drop_optional_tstamps` is
+// true, the entries whose timestamps weren't mandatory lose them, and deletion
+// entries without a timestamp get dropped, just like `garbage_collect()` does it.
+template <class entries_t>
+void plan_entries(const entries_t &entries, bool drop_optional_tstamps,
+                  std::vector<planned_entry_t> *plan) {
+    for (const rebuild_entry_t *e : entries) {
+        planned_entry_t p;
+        p.entry = e;
+        p.has_tstamp = e->has_tstamp && (e->mandatory || !drop_optional_tstamps);
+        if (p.has_tstamp || e->value != nullptr) {
+            plan->push_back(p);
         }
+    }
+}
 
-        repli_timestamp_t fro_tstamp = get_timestamp(fro, fro_offset);
-        repli_timestamp_t tow_tstamp = get_timestamp(tow, tow_offset);
-
+// Interleaves the entries `fro` that move into a node with the entries `tow` that are
+// already there, from the most to the least recent.  Once one of them runs out of
+// timestamped entries, its remaining entries could be more recent than the
+// timestamped entries the other one has left, so those lose their timestamps.
+std::vector<planned_entry_t> interleave_plans(const std::vector<planned_entry_t> &tow,
+                                              const std::vector<planned_entry_t> &fro) {
+    size_t tow_tstamped = 0;
+    while (tow_tstamped < tow.size() && tow[tow_tstamped].has_tstamp) {
+        ++tow_tstamped;
+    }
+    size_t fro_tstamped = 0;
+    while (fro_tstamped < fro.size() && fro[fro_tstamped].has_tstamp) {
+        ++fro_tstamped;
+    }
+
+    std::vector<planned_entry_t> ret;
+    ret.reserve(tow.size() + fro.size());
+    size_t i = 0, j = 0;
+    while (i < tow_tstamped && j < fro_tstamped) {
         // Greater timestamps go first.
-        if (tow_tstamp < fro_tstamp) {
-            entry_t *ent = get_entry(fro, fro_offset);
-            int entsz = entry_size(sizer, ent);
-            int sz = sizeof(repli_timestamp_t) + entsz;
-            memmove(get_at_offset(tow, wri_offset), get_at_offset(fro, fro_offset), sz);
-
-            if (entry_is_live(ent)) {
-                livesize += entsz + sizeof(uint16_t);
-                fro_live_size_adjustment -= entsz + sizeof(uint16_t);
-            }
-
-            clean_entry(ent, entsz);
-
-            // Update the pair offset in fro to be the offset in tow
-            // -- we'll never use the old value again and we'll copy
-            // the newer values to tow later.
-            fro->pair_offsets[beg + tow->pair_offsets[fro_index]] = wri_offset;
-
-            wri_offset += sz;
-            actually_copied += sz;
-            fro_index++;
-
+        if (tow[i].entry->tstamp < fro[j].entry->tstamp) {
+            ret.push_back(fro[j++]);
         } else {
-            int sz = sizeof(repli_timestamp_t) + entry_size(sizer, get_entry(tow, tow_offset));
-            memmove(get_at_offset(tow, wri_offset), get_at_offset(tow, tow_offset), sz);
-
-            // Update the pair offset of the entry we've moved.
-            int i;
-            for (i = 0; i < num_adjustable_tow_offsets; ++i) {
-                int j = adjustable_tow_offsets[i];
-                if (tow->pair_offsets[j] == tow_offset) {
-                    tow->pair_offsets[j] = wri_offset;
-                    break;
-                }
-            }
-
-            // Make sure we updated something.
-            rassert(i != num_adjustable_tow_offsets);
-
-            wri_offset += sz;
-            tow_offset += sz;
+            ret.push_back(tow[i++]);
         }
     }
 
-    uint16_t new_tstamp_cutpoint = wri_offset;
-
-    // Now we have some untimestamped entries to write.
-    for (; fro_index < fro_index_end; ++fro_index) {
-        int fro_offset = fro->pair_offsets[beg + tow->pair_offsets[fro_index]];
-        entry_t *ent = get_entry(fro, fro_offset);
-        if (entry_is_live(ent)) {
-            int sz = entry_size(sizer, ent);
-            memmove(get_at_offset(tow, wri_offset), ent, sz);
-            clean_entry(ent, sz);
-            fro_live_size_adjustment -= sz + sizeof(uint16_t);
-
-            fro->pair_offsets[beg + tow->pair_offsets[fro_index]] = wri_offset;
-
-            wri_offset += sz;
-            livesize += sz + sizeof(uint16_t);
-            actually_copied += sz;
-            rassert(wri_offset <= tow_offset);
-        } else {
-            rassert(entry_is_deletion(ent));
-
-            // This is a dead entry.  We'll need to squash this dead entry later.
-            fro->pair_offsets[beg + tow->pair_offsets[fro_index]] = 0;
-
-            int sz = entry_size(sizer, ent);
-            clean_entry(ent, sz);
+    const bool keep_tstamps = i == tow_tstamped
+        ? tow_tstamped == tow.size()
+        : fro_tstamped == fro.size();
+    const std::vector<planned_entry_t> &rest = i == tow_tstamped ? fro : tow;
+    for (size_t k = (i == tow_tstamped ? j : i);
+            k < (i == tow_tstamped ? fro_tstamped : tow_tstamped); ++k) {
+        planned_entry_t p = rest[k];
+        p.has_tstamp = keep_tstamps;
+        if (p.has_tstamp || p.entry->value != nullptr) {
+            ret.push_back(p);
         }
     }
+    ret.insert(ret.end(), tow.begin() + tow_tstamped, tow.end());
+    ret.insert(ret.end(), fro.begin() + fro_tstamped, fro.end());
+    return ret;
+}
 
-    guarantee(actually_copied <= fro_copysize);
-    rassert(wri_offset <= tow_offset);
+int planned_entry_size(value_sizer_t *sizer, key_prefix_t prefix,
+                       const planned_entry_t &p) {
+    return encoded_entry_size(sizer, prefix, p.entry->key.btree_key(), p.entry->value)
+        + (p.has_tstamp ? sizeof(repli_timestamp_t) : 0);
+}
 
-    // tow may have some timestamped entries that need to become
-    // un-timestamped.
-    while (tow_offset < tow->tstamp_cutpoint) {
-        rassert(wri_offset <= tow_offset);
+// How many bytes of the block a node with `plan` and `prefix` takes up.
+int planned_node_size(value_sizer_t *sizer, const std::vector<planned_entry_t> &plan,
+                      const store_key_t &prefix) {
+    int size = offsetof(leaf_node_t, pair_offsets)
+        + (prefix.size() == 0 ? 0 : 1 + prefix.size());
+    for (const planned_entry_t &p : plan) {
+        size += sizeof(uint16_t) + planned_entry_size(sizer, as_prefix(prefix), p);
+    }
+    return size;
+}
 
-        entry_t *ent = get_entry(tow, tow_offset);
-        int sz = entry_size(sizer, ent);
-        if (entry_is_live(ent)) {
-            memmove(get_at_offset(tow, wri_offset), ent, sz);
-
-            // Update the pair offset of the entry we've moved.
-            int i;
-            for (i = 0; i < num_adjustable_tow_offsets; ++i) {
-                int j = adjustable_tow_offsets[i];
-                if (tow->pair_offsets[j] == tow_offset) {
-                    tow->pair_offsets[j] = wri_offset;
-                    break;
-                }
+// Picks the prefix that takes up the least space for `plan`.  That's either the
+// prefix all of its keys share, or one of `candidates`, which some of its keys might
+// not have.  An empty prefix means that the node gets built in the old format.
+store_key_t choose_prefix(value_sizer_t *sizer, const std::vector<planned_entry_t> &plan,
+                          const std::vector<store_key_t> &candidates) {
+    store_key_t common;
+    if (!plan.empty()) {
+        common = plan[0].entry->key;
+        for (const planned_entry_t &p : plan) {
+            const store_key_t &key = p.entry->key;
+            int n = 0;
+            while (n < common.size() && n < key.size()
+                   && common.contents()[n] == key.contents()[n]) {
+                ++n;
             }
+            common.set_size(n);
+        }
+    }
 
-            // Make sure we updated something.
-            rassert(i != num_adjustable_tow_offsets);
-
-            wri_offset += sz;
-        } else {
-
-            // Update the pair offset of the entry we've deleted, so
-            // that it gets squashed later.
-            int i;
-            for (i = 0; i < num_adjustable_tow_offsets; ++i) {
-                int j = adjustable_tow_offsets[i];
-                if (tow->pair_offsets[j] == tow_offset) {
-                    tow->pair_offsets[j] = 0;
-                }
+    store_key_t best;
+    int best_size = planned_node_size(sizer, plan, best);
+    if (common.size() > 0) {
+        int size = planned_node_size(sizer, plan, common);
+        if (size < best_size) {
+            best = common;
+            best_size = size;
+        }
+    }
+    for (const store_key_t &candidate : candidates) {
+        if (candidate.size() > 0) {
+            int size = planned_node_size(sizer, plan, candidate);
+            if (size < best_size) {
+                best = candidate;
+                best_size = size;
             }
         }
-        tow_offset += sizeof(repli_timestamp_t) + sz;
     }
+    return best;
+}
 
-    guarantee(wri_offset <= tow_offset);
-
-    // If we needed to untimestamp any tow entries, we'll need a skip
-    // entry for the open space.
-    if (wri_offset < tow_offset) {
-        // printf("wri_offset = %d, tow_offset = %d\n", wri_offset, tow_offset);
-        clean_entry(get_at_offset(tow, wri_offset), tow_offset - wri_offset);
+// Writes a node with the entries in `plan`, which go from the most to the least
+// recent, over `node`.  Outputs the offsets of the entries if `offsets_out` isn't
+// null.
+void build_node(value_sizer_t *sizer, const std::vector<planned_entry_t> &plan,
+                const store_key_t &prefix, leaf_node_t *node,
+                std::vector<int> *offsets_out) {
+    guarantee(planned_node_size(sizer, plan, prefix) <= sizer->block_size().value());
+
+    const int bs = sizer->block_size().value();
+    char *const base = reinterpret_cast<char *>(node);
+    int end = bs;
+    if (prefix.size() == 0) {
+        node->magic = sizer->btree_leaf_magic();
+    } else {
+        node->magic = prefixed_leaf_magic(sizer);
+        base[bs - 1] = static_cast<char>(prefix.size());
+        end = bs - 1 - prefix.size();
+        memcpy(base + end, prefix.contents(), prefix.size());
     }
+    const key_prefix_t key_prefix = as_prefix(prefix);
 
-    // We don't need to do anything else for tow entries because we
-    // did a garbage collection in tow so they are contiguous through
-    // the end of the buffer (and the rest don't have timestamps).
-
-    // Copy the valid tow offsets from [beg, end) to the wpoint point
-    // in tow, and move fro entries.
-    memcpy(tow->pair_offsets + wpoint, fro->pair_offsets + beg,
-           sizeof(uint16_t) * (end - beg));
-    memmove(fro->pair_offsets + beg, fro->pair_offsets + end, sizeof(uint16_t) * (fro->num_pairs - end));
-    fro->num_pairs -= end - beg;
-
-    tow->frontmost = new_frontmost;
-
-    tow->live_size = livesize;
-
-    tow->tstamp_cutpoint = new_tstamp_cutpoint;
-
-    fro->live_size += fro_live_size_adjustment;
+    int total = 0;
+    for (const planned_entry_t &p : plan) {
+        total += planned_entry_size(sizer, key_prefix, p);
+    }
 
-    if (moved_values_out != nullptr) {
-        // Collect value pointers of the moved values
-        moved_values_out->clear();
-        moved_values_out->reserve(end - beg);
-        for (int pair_idx = wpoint; pair_idx < wpoint + (end - beg); ++pair_idx) {
-            const int offset = tow->pair_offsets[pair_idx];
-            // Skip dead entries
-            if (offset != 0) {
-                const entry_t *entry = get_entry(tow, offset);
-                // Skip deletions
-                if (entry_is_live(entry)) {
-                    moved_values_out->push_back(entry_value(entry));
-                }
+    node->num_pairs = plan.size();
+    node->live_size = 0;
+    node->frontmost = end - total;
+    node->tstamp_cutpoint = end;
+
+    std::vector<int> offsets;
+    offsets.reserve(plan.size());
+    int w = node->frontmost;
+    for (const planned_entry_t &p : plan) {
+        offsets.push_back(w);
+        if (p.has_tstamp) {
+            rassert(node->tstamp_cutpoint == end);
+            *reinterpret_cast<repli_timestamp_t *>(base + w) = p.entry->tstamp;
+            w += sizeof(repli_timestamp_t);
+        } else {
+            rassert(p.entry->value != nullptr);
+            if (node->tstamp_cutpoint == end) {
+                node->tstamp_cutpoint = w;
             }
         }
+        int sz = encoded_entry_size(sizer, key_prefix, p.entry->key.btree_key(),
+                                    p.entry->value);
+        write_entry(sizer, key_prefix, p.entry->key.btree_key(), p.entry->value,
+                    base + w);
+        if (p.entry->value != nullptr) {
+            node->live_size += sizeof(uint16_t) + sz;
+        }
+        w += sz;
     }
+    rassert(w == end);
 
-    {
-        // Squash dead entries that we copied pair_offsets from fro,
-        // for, and that we removed from tow, as well.
-        int j, k;
-        for (j = 0, k = 0; k < tow->num_pairs; ++k) {
-            if (tow->pair_offsets[k] != 0) {
-                tow->pair_offsets[j] = tow->pair_offsets[k];
+    std::vector<uint16_t> indices(plan.size());
+    for (size_t i = 0; i < plan.size(); ++i) {
+        indices[i] = i;
+    }
+    std::sort(indices.begin(), indices.end(), [&](uint16_t x, uint16_t y) {
+        return btree_key_cmp(plan[x].entry->key.btree_key(),
+                             plan[y].entry->key.btree_key()) < 0;
+    });
+    for (size_t i = 0; i < plan.size(); ++i) {
+        node->pair_offsets[i] = offsets[indices[i]];
+    }
+    guarantee(offsetof(leaf_node_t, pair_offsets)
+              + sizeof(uint16_t) * node->num_pairs <= node->frontmost);
 
-                j += 1;
-            }
-        }
-        tow->num_pairs = j;
+    if (offsets_out != nullptr) {
+        *offsets_out = std::move(offsets);
     }
 
-    validate(sizer, fro);
-    validate(sizer, tow);
+    validate(sizer, node);
 }
 
-void split(value_sizer_t *sizer, leaf_node_t *node, leaf_node_t *rnode, btree_key_t *median_out) {
-    int tstamp_back_offset;
-    int mandatory = mandatory_cost(sizer, node, MANDATORY_TIMESTAMPS, &tstamp_back_offset);
-
-    guarantee(mandatory >= free_space(sizer) - leaf_epsilon(sizer));
-
-    // We shall split the mandatory cost of this node as evenly as possible.
-
-    int num_mandatories = 0;
-    int i = node->num_pairs - 1;
-    int prev_rcost = 0;
-    int rcost = 0;
-    while (i >= 0 && rcost < mandatory / 2) {
-        int offset = node->pair_offsets[i];
-        entry_t *ent = get_entry(node, offset);
-
-        // We only take mandatory entries' costs into consideration,
-        // which guarantees correct behavior (in that neither node nor
-        // can become underfull after a split).  If we didn't do this,
-        // it would be possible to bias one node with a bunch of
-        // deletions that makes its mandatory_cost artificially small.
-
-        if (entry_is_live(ent)) {
-            prev_rcost = rcost;
-            rcost += entry_size(sizer, ent) + sizeof(uint16_t) + (offset < tstamp_back_offset ? sizeof(repli_timestamp_t) : 0);
+// Returns the entries sorted by key.
+std::vector<const rebuild_entry_t *> sort_by_key(
+        const std::vector<rebuild_entry_t> &entries) {
+    std::vector<const rebuild_entry_t *> ret;
+    ret.reserve(entries.size());
+    for (const rebuild_entry_t &e : entries) {
+        ret.push_back(&e);
+    }
+    std::sort(ret.begin(), ret.end(),
+              [](const rebuild_entry_t *x, const rebuild_entry_t *y) {
+                  return btree_key_cmp(x->key.btree_key(), y->key.btree_key()) < 0;
+              });
+    return ret;
+}
 
-            ++num_mandatories;
+// Splits `entries` into those whose keys are at most `key` and the rest, in the
+// same order.  If `to_left` is false, the entries with keys of at least `key` go
+// into `out` instead.
+void split_moved_entries(const std::vector<rebuild_entry_t> &entries,
+                         const store_key_t &key, bool to_left,
+                         std::vector<const rebuild_entry_t *> *out,
+                         std::vector<const rebuild_entry_t *> *rest_out) {
+    out->clear();
+    rest_out->clear();
+    for (const rebuild_entry_t &e : entries) {
+        int cmp = btree_key_cmp(e.key.btree_key(), key.btree_key());
+        if (to_left ? cmp <= 0 : cmp >= 0) {
+            out->push_back(&e);
         } else {
-            rassert(entry_is_deletion(ent));
-
-            if (offset < tstamp_back_offset) {
-                prev_rcost = rcost;
-                rcost += entry_size(sizer, ent) + sizeof(uint16_t) + sizeof(repli_timestamp_t);
-
-                ++num_mandatories;
-            }
+            rest_out->push_back(&e);
         }
-
-        --i;
     }
+}
 
-    // Since the mandatory_cost is at least free_space - leaf_epsilon there's no way i can equal num_pairs or zero.
-    guarantee(i < node->num_pairs);
-    guarantee(i > 0);
-
-    // Now prev_rcost and rcost envelope mandatory / 2.
-    guarantee(prev_rcost < mandatory / 2);
-    guarantee(rcost >= mandatory / 2, "rcost = %d, mandatory / 2 = %d, i = %d", rcost, mandatory / 2, i);
+// Split, merge and level build the nodes they produce from scratch.  That way they
+// don't have to move entries from one prefix to another, and every node they touch
+// gets the prefix that suits its keys.
 
-    int s;
-    int end_rcost;
-    if ((mandatory - prev_rcost) - prev_rcost < rcost - (mandatory - rcost)) {
-        end_rcost = prev_rcost;
-        s = i + 2;
-        --num_mandatories;
-    } else {
-        end_rcost = rcost;
+void split(value_sizer_t *sizer, leaf_node_t *node, leaf_node_t *rnode, btree_key_t *median_out) {
+    const int bs = sizer->block_size().value();
+    scoped_malloc_t<leaf_node_t> old(bs);
+    memcpy(old.get(), node, bs);
+
+    std::vector<rebuild_entry_t> entries;
+    collect_entries(sizer, old.get(), &entries);
+    guarantee(entries.size() >= 2);
+
+    // We shall split the mandatory cost of this node as evenly as possible.  We only
+    // take mandatory entries' costs into consideration, which guarantees correct
+    // behavior (in that neither node can become underfull after a split).  If we
+    // didn't do this, it would be possible to bias one node with a bunch of deletions
+    // that makes its mandatory_cost artificially small.
+    std::vector<const rebuild_entry_t *> by_key = sort_by_key(entries);
+    int total_weight = 0;
+    for (const rebuild_entry_t *e : by_key) {
+        total_weight += e->weight;
+    }
+    size_t s = 1;
+    int lweight = by_key[0]->weight;
+    for (size_t i = 1; i + 1 < by_key.size(); ++i) {
+        int next_lweight = lweight + by_key[i]->weight;
+        if (std::abs(total_weight - 2 * next_lweight)
+                >= std::abs(total_weight - 2 * lweight)) {
+            break;
+        }
+        lweight = next_lweight;
         s = i + 1;
     }
+    keycpy(median_out, by_key[s - 1]->key.btree_key());
 
-    // If our math was right, neither node can be underfull just
-    // considering the split of the mandatory costs.
-    guarantee(end_rcost >= free_space(sizer) / 2 - leaf_epsilon(sizer));
-    guarantee(mandatory - end_rcost >= free_space(sizer) / 2 - leaf_epsilon(sizer));
+    std::vector<const rebuild_entry_t *> left, right;
+    split_moved_entries(entries, by_key[s - 1]->key, true, &left, &right);
+    std::vector<planned_entry_t> left_plan, right_plan;
+    plan_entries(left, false, &left_plan);
+    plan_entries(right, false, &right_plan);
+    std::vector<store_key_t> candidates(1, node_prefix(sizer, old.get()));
 
-    // Now we wish to move the elements at indices [s, num_pairs) to rnode.
+    build_node(sizer, left_plan, choose_prefix(sizer, left_plan, candidates), node,
+               nullptr);
+    build_node(sizer, right_plan, choose_prefix(sizer, right_plan, candidates), rnode,
+               nullptr);
+}
 
-    init(sizer, rnode);
+bool is_past_end(value_sizer_t *sizer, const leaf_node_t *node,
+                 const btree_key_t *key) {
+    rassert(node->num_pairs > 0);
+    int index;
+    return !find_key(sizer, node, key, &index) && index == node->num_pairs;
+}
 
-    int node_copysize = end_rcost - num_mandatories * sizeof(uint16_t);
-    move_elements(sizer, node, s, node->num_pairs, 0, rnode, node_copysize,
-                  tstamp_back_offset, nullptr);
+void split_at_end(value_sizer_t *sizer, leaf_node_t *node, leaf_node_t *rnode,
+                  btree_key_t *median_out) {
+    store_key_t key_buf;
+    const entry_t *last = get_entry(node, node->pair_offsets[node->num_pairs - 1]);
+    keycpy(median_out, full_entry_key(get_prefix(sizer, node), last, &key_buf));
+    init(sizer, rnode);
+}
 
-    keycpy(median_out, entry_key(get_entry(node, node->pair_offsets[s - 1])));
+// Works out how `left` and `right` get merged, from copies of them.
+std::vector<planned_entry_t> plan_merge(value_sizer_t *sizer,
+                                        const leaf_node_t *left,
+                                        const leaf_node_t *right,
+                                        std::vector<rebuild_entry_t> *left_entries,
+                                        std::vector<rebuild_entry_t> *right_entries) {
+    collect_entries(sizer, left, left_entries);
+    collect_entries(sizer, right, right_entries);
+    std::vector<const rebuild_entry_t *> l, r;
+    for (const rebuild_entry_t &e : *left_entries) {
+        l.push_back(&e);
+    }
+    for (const rebuild_entry_t &e : *right_entries) {
+        r.push_back(&e);
+    }
+    std::vector<planned_entry_t> left_plan, right_plan;
+    plan_entries(l, true, &left_plan);
+    plan_entries(r, true, &right_plan);
+    return interleave_plans(right_plan, left_plan);
 }
 
 void merge(value_sizer_t *sizer, leaf_node_t *left, leaf_node_t *right) {
@@ -1042,22 +1300,20 @@ void merge(value_sizer_t *sizer, leaf_node_t *left, leaf_node_t *right) {
     rassert(is_underfull(sizer, left));
     rassert(is_underfull(sizer, right));
 
-    int tstamp_back_offset;
-    int mandatory = mandatory_cost(sizer, left, MANDATORY_TIMESTAMPS, &tstamp_back_offset);
-
-    int left_copysize = mandatory;
-    // Uncount the uint16_t cost of mandatory entries.  Sigh.
-    // This includes deletion entries *before* the `tstamp_back_offset`, as well
-    // as all non-deletion entries.
-    for (int i = 0; i < left->num_pairs; ++i) {
-        if (left->pair_offsets[i] < tstamp_back_offset
-            || !entry_is_deletion(get_entry(left, left->pair_offsets[i]))) {
-            left_copysize -= sizeof(uint16_t);
-        }
-    }
-
-    move_elements(sizer, left, 0, left->num_pairs, 0, right, left_copysize,
-                  tstamp_back_offset, nullptr);
+    const int bs = sizer->block_size().value();
+    scoped_malloc_t<leaf_node_t> old_left(bs);
+    memcpy(old_left.get(), left, bs);
+    scoped_malloc_t<leaf_node_t> old_right(bs);
+    memcpy(old_right.get(), right, bs);
+
+    std::vector<rebuild_entry_t> left_entries, right_entries;
+    std::vector<planned_entry_t> plan = plan_merge(sizer, old_left.get(), old_right.get(),
+                                                   &left_entries, &right_entries);
+    std::vector<store_key_t> candidates;
+    candidates.push_back(node_prefix(sizer, old_left.get()));
+    candidates.push_back(node_prefix(sizer, old_right.get()));
+    build_node(sizer, plan, choose_prefix(sizer, plan, candidates), right, nullptr);
+    init(sizer, left);
 }
 
 // We move keys out of sibling and into node.
@@ -1071,116 +1327,131 @@ bool level(value_sizer_t *sizer, int nodecmp_node_with_sib,
     rassert(is_underfull(sizer, node));
     rassert(!is_underfull(sizer, sibling));
 
-    // First figure out the inclusive range [beg, end] of elements we want to move
-    // from sibling.
-    int beg, end, *w, wstep;
-
     int node_weight = mandatory_cost(sizer, node, MANDATORY_TIMESTAMPS);
-    int tstamp_back_offset;
-    int sibling_weight = mandatory_cost(sizer, sibling, MANDATORY_TIMESTAMPS,
-                                        &tstamp_back_offset);
+    int sibling_weight = mandatory_cost(sizer, sibling, MANDATORY_TIMESTAMPS);
 
     guarantee(node_weight < sibling_weight);
 
-    if (nodecmp_node_with_sib < 0) {
-        // node is to the left of sibling, so we want to move elements
-        // [0, k) from sibling.
-
-        beg = 0;
-        end = 0;
-        w = &end;
-        wstep = 1;
-    } else {
-        // node is to the right of sibling, so we want to move
-        // elements [num_pairs - k, num_pairs) from sibling.
-
-        beg = sibling->num_pairs - 1;
-        end = sibling->num_pairs - 1;
-        w = &beg;
-        wstep = -1;
-    }
-
-    guarantee(end - beg != sibling->num_pairs - 1);
-
-    int prev_weight_movement = 0;
-    int weight_movement = 0;
-    int num_mandatories = 0;
-    int prev_diff = sizer->block_size().value();  // some impossibly large value
-    for (;;) {
-        int offset = sibling->pair_offsets[*w];
-        entry_t *ent = get_entry(sibling, offset);
-
-        // We only take mandatory entries' costs into consideration.
-        if (entry_is_live(ent)) {
-            int sz = entry_size(sizer, ent) + sizeof(uint16_t) + (offset < tstamp_back_offset ? sizeof(repli_timestamp_t) : 0);
-            prev_diff = sibling_weight - node_weight;
-            prev_weight_movement = weight_movement;
-            weight_movement += sz;
-            node_weight += sz;
-            sibling_weight -= sz;
-
-            ++num_mandatories;
-        } else {
-            rassert(entry_is_deletion(ent));
-
-            if (offset < tstamp_back_offset) {
-                int sz = entry_size(sizer, ent) + sizeof(uint16_t) + sizeof(repli_timestamp_t);
-                prev_diff = sibling_weight - node_weight;
-                prev_weight_movement = weight_movement;
-                weight_movement += sz;
-                node_weight += sz;
-                sibling_weight -= sz;
-
-                ++num_mandatories;
-            }
-        }
-
-        if (end - beg == sibling->num_pairs - 1 || node_weight >= sibling_weight) {
+    const int bs = sizer->block_size().value();
+    scoped_malloc_t<leaf_node_t> old_node(bs);
+    memcpy(old_node.get(), node, bs);
+    scoped_malloc_t<leaf_node_t> old_sibling(bs);
+    memcpy(old_sibling.get(), sibling, bs);
+
+    std::vector<rebuild_entry_t> node_entries, sibling_entries;
+    collect_entries(sizer, old_node.get(), &node_entries);
+    collect_entries(sizer, old_sibling.get(), &sibling_entries);
+    std::vector<const rebuild_entry_t *> by_key = sort_by_key(sibling_entries);
+
+    // If node is to the left of sibling, we move the first `num_moved` entries of
+    // sibling, otherwise the last ones.  We only take mandatory entries' costs into
+    // consideration.
+    auto moved_entry = [&](size_t i) {
+        return nodecmp_node_with_sib < 0 ? by_key[i] : by_key[by_key.size() - 1 - i];
+    };
+    size_t num_moved = 0;
+    int prev_diff = sibling_weight - node_weight;
+    while (num_moved + 1 < by_key.size() && node_weight < sibling_weight) {
+        prev_diff = sibling_weight - node_weight;
+        node_weight += moved_entry(num_moved)->weight;
+        sibling_weight -= moved_entry(num_moved)->weight;
+        ++num_moved;
+    }
+    if (num_moved > 0 && prev_diff <= sibling_weight - node_weight) {
+        --num_moved;
+    }
+
+    std::vector<const rebuild_entry_t *> tow;
+    for (const rebuild_entry_t &e : node_entries) {
+        tow.push_back(&e);
+    }
+    std::vector<planned_entry_t> tow_plan;
+    plan_entries(tow, true, &tow_plan);
+    std::vector<store_key_t> candidates;
+    candidates.push_back(node_prefix(sizer, old_node.get()));
+    candidates.push_back(node_prefix(sizer, old_sibling.get()));
+
+    // The entries might not fit into node with the prefix they end up sharing there,
+    // in which case we move fewer of them.
+    std::vector<const rebuild_entry_t *> moved, staying;
+    std::vector<planned_entry_t> node_plan;
+    for (; num_moved > 0; --num_moved) {
+        split_moved_entries(sibling_entries, moved_entry(num_moved - 1)->key,
+                            nodecmp_node_with_sib < 0, &moved, &staying);
+        std::vector<planned_entry_t> fro_plan;
+        plan_entries(moved, true, &fro_plan);
+        node_plan = interleave_plans(tow_plan, fro_plan);
+        if (planned_node_size(sizer, node_plan,
+                              choose_prefix(sizer, node_plan, candidates)) <= bs) {
             break;
         }
-
-        *w += wstep;
     }
 
-    guarantee(end - beg < sibling->num_pairs - 1);
-
-    if (prev_diff <= sibling_weight - node_weight) {
-        *w -= wstep;
-        --num_mandatories;
-        weight_movement = prev_weight_movement;
-    }
-
-    if (end < beg) {
+    if (num_moved == 0) {
         // Alas, there is no actual leveling to do.
-        guarantee(end + 1 == beg);
         return false;
     }
 
-    int sib_copysize = weight_movement - num_mandatories * sizeof(uint16_t);
-    move_elements(sizer, sibling, beg, end + 1,
-                  nodecmp_node_with_sib < 0 ? node->num_pairs : 0, node,
-                  sib_copysize, tstamp_back_offset, moved_values_out);
+    std::vector<planned_entry_t> sibling_plan;
+    plan_entries(staying, false, &sibling_plan);
+
+    std::vector<int> offsets;
+    build_node(sizer, node_plan, choose_prefix(sizer, node_plan, candidates), node,
+               &offsets);
+    build_node(sizer, sibling_plan, choose_prefix(sizer, sibling_plan, candidates),
+               sibling, nullptr);
 
-    guarantee(node->num_pairs > 0);
     guarantee(sibling->num_pairs > 0);
 
+    if (moved_values_out != nullptr) {
+        // Collect value pointers of the moved values
+        moved_values_out->clear();
+        const rebuild_entry_t *sib_begin = sibling_entries.data();
+        const rebuild_entry_t *sib_end = sib_begin + sibling_entries.size();
+        for (size_t i = 0; i < node_plan.size(); ++i) {
+            const rebuild_entry_t *e = node_plan[i].entry;
+            if (e->value != nullptr && e >= sib_begin && e < sib_end) {
+                moved_values_out->push_back(entry_value(get_entry(node, offsets[i])));
+            }
+        }
+    }
+
     if (nodecmp_node_with_sib < 0) {
-        keycpy(replacement_key_out, entry_key(get_entry(node, node->pair_offsets[node->num_pairs - 1])));
+        keycpy(replacement_key_out, moved_entry(num_moved - 1)->key.btree_key());
     } else {
-        keycpy(replacement_key_out, entry_key(get_entry(sibling, sibling->pair_offsets[sibling->num_pairs - 1])));
+        keycpy(replacement_key_out, moved_entry(num_moved)->key.btree_key());
     }
 
     return true;
 }
 
 bool is_mergable(value_sizer_t *sizer, const leaf_node_t *node, const leaf_node_t *sibling) {
-    return is_underfull(sizer, node) && is_underfull(sizer, sibling);
+    if (!is_underfull(sizer, node) || !is_underfull(sizer, sibling)) {
+        return false;
+    }
+    // The keys of the merged node might share a shorter prefix than they do now.
+    std::vector<rebuild_entry_t> node_entries, sibling_entries;
+    std::vector<planned_entry_t> plan = plan_merge(sizer, node, sibling, &node_entries,
+                                                   &sibling_entries);
+    std::vector<store_key_t> candidates;
+    candidates.push_back(node_prefix(sizer, node));
+    candidates.push_back(node_prefix(sizer, sibling));
+    return planned_node_size(sizer, plan, choose_prefix(sizer, plan, candidates))
+        <= sizer->block_size().value();
 }
 
 // Sets *index_out to the index for the live entry or deletion entry
 // for the key, or to the index the key would have if it were
 // inserted.  Returns true if the key at said index is actually equal.
-bool find_key(const leaf_node_t *node, const btree_key_t *key, int *index_out) {
+bool find_key(const leaf_node_t *node, key_prefix_t prefix, const btree_key_t *key,
+              int *index_out) {
+    // Entries that leave out the prefix can be compared with the rest of `key` by their
+    // words first, see `key_prefix_word()`.
+    const bool key_has_prefix = has_prefix(key, prefix);
+    const uint8_t *suffix = key->contents + (key_has_prefix ? prefix.size : 0);
+    const int suffix_size = key->size - (key_has_prefix ? prefix.size : 0);
+    const uint64_t suffix_word = key_prefix_word(suffix, suffix_size);
+
     int beg = 0;
     int end = node->num_pairs;
 
@@ -1191,9 +1462,10 @@ bool find_key(const leaf_node_t *node, const btree_key_t *key, int *index_out) {
         // when (end - beg) > 0, (end - beg) / 2 is always less than (end - beg).  So beg <= test_point < end.
         int test_point = beg + (end - beg) / 2;
 
-        const btree_key_t *ek = entry_key(get_entry(node, node->pair_offsets[test_point]));
-
-        int res = btree_key_cmp(key, ek);
+        const entry_t *ent = get_entry(node, node->pair_offsets[test_point]);
+        int res = key_has_prefix && !entry_has_full_key(ent)
+            ? key_prefix_word_cmp(suffix_word, suffix, suffix_size, entry_key(ent))
+            : entry_key_cmp(key, prefix, ent);
 
         if (res < 0) {
             // key < *test_point.
@@ -1215,9 +1487,14 @@ bool find_key(const leaf_node_t *node, const btree_key_t *key, int *index_out) {
     return false;
 }
 
+bool find_key(value_sizer_t *sizer, const leaf_node_t *node, const btree_key_t *key,
+              int *index_out) {
+    return find_key(node, get_prefix(sizer, node), key, index_out);
+}
+
 bool lookup(value_sizer_t *sizer, const leaf_node_t *node, const btree_key_t *key, void *value_out) {
     int index;
-    if (find_key(node, key, &index)) {
+    if (find_key(sizer, node, key, &index)) {
         const entry_t *ent = get_entry(node, node->pair_offsets[index]);
         if (entry_is_live(ent)) {
             const void *val = entry_value(ent);
@@ -1285,7 +1562,7 @@ MUST_USE bool prepare_space_for_new_entry(
     already exists, clean it. */
 
     int index;
-    bool found = find_key(node, key, &index);
+    bool found = find_key(sizer, node, key, &index);
 
     if (found) {
         int offset = node->pair_offsets[index];
@@ -1344,7 +1621,7 @@ MUST_USE bool prepare_space_for_new_entry(
         /* Make sure that `index` still refers to where the new key should be
         inserted. */
         DEBUG_VAR int index2;
-        rassert(!find_key(node, key, &index2));
+        rassert(!find_key(sizer, node, key, &index2));
         rassert(index == index2, "garbage_collect() failed to preserve index");
     }
 
@@ -1353,7 +1630,7 @@ MUST_USE bool prepare_space_for_new_entry(
     uint16_t end_of_where_new_entry_should_go;
     bool new_entry_should_have_timestamp;
 
-    if (node->frontmost == sizer->block_size().value() ||
+    if (node->frontmost == entries_end(sizer, node) ||
             (node->frontmost < node->tstamp_cutpoint && get_timestamp(node, node->frontmost) <= tstamp)) {
         /* In the most common case, the new value will go right at
         `node->frontmost` and will get a timestamp. For performance reasons, we
@@ -1364,14 +1641,14 @@ MUST_USE bool prepare_space_for_new_entry(
         new_entry_should_have_timestamp = true;
 
     } else {
-        entry_iter_t iter = entry_iter_t::make(node);
-        while (!iter.done(sizer) && iter.offset < node->tstamp_cutpoint && get_timestamp(node, iter.offset) > tstamp) {
+        entry_iter_t iter = entry_iter_t::make(sizer, node);
+        while (!iter.done() && iter.offset < node->tstamp_cutpoint && get_timestamp(node, iter.offset) > tstamp) {
             iter.step(sizer, node);
         }
         end_of_where_new_entry_should_go = iter.offset;
 
         if (end_of_where_new_entry_should_go == node->tstamp_cutpoint &&
-                node->tstamp_cutpoint != sizer->block_size().value()) {
+                node->tstamp_cutpoint != entries_end(sizer, node)) {
             /* We are after all of the timestamped entries, but before at least
             one non-timestamped entry. We know that the non-timestamped entries
             have a timestamp of at most maximum_existing_tstamp. If our own timestamp
@@ -1491,7 +1768,7 @@ MUST_USE bool prepare_space_for_new_entry(
     } else {
         *space_out = get_at_offset(node, start_of_where_new_entry_should_go);
     }
-    guarantee(end_of_where_new_entry_should_go <= sizer->block_size().value());
+    guarantee(end_of_where_new_entry_should_go <= entries_end(sizer, node));
 
     return true;
 }
@@ -1510,20 +1787,20 @@ void insert(
 
     /* Make space for the entry itself */
 
+    const key_prefix_t prefix = get_prefix(sizer, node);
+    const int entry_size = encoded_entry_size(sizer, prefix, key, value);
     char *location_to_write_data;
     bool should_write = prepare_space_for_new_entry(sizer, node,
-        key, key->full_size() + sizer->size(value), tstamp, maximum_existing_tstamp,
+        key, entry_size, tstamp, maximum_existing_tstamp,
         true,
         &location_to_write_data);
     guarantee(should_write);
 
     /* Now copy the data into the node itself */
 
-    memcpy(location_to_write_data, key, key->full_size());
-    location_to_write_data += key->full_size();
-    memcpy(location_to_write_data, value, sizer->size(value));
+    write_entry(sizer, prefix, key, value, location_to_write_data);
 
-    node->live_size += sizeof(uint16_t) + key->full_size() + sizer->size(value);
+    node->live_size += sizeof(uint16_t) + entry_size;
 
     validate(sizer, node);
 }
@@ -1540,17 +1817,16 @@ void remove(
     `prepare_space_for_new_entry()` will return false because we pass false for
     `allow_after_tstamp_cutpoint`. */
 
+    const key_prefix_t prefix = get_prefix(sizer, node);
     char *location_to_write_data;
     if (prepare_space_for_new_entry(sizer, node,
             key,
-            1 + key->full_size(),   /* 1 for `DELETE_ENTRY_CODE` */
+            encoded_entry_size(sizer, prefix, key, nullptr),
             tstamp,
             maximum_existing_tstamp,
             false,
             &location_to_write_data)) {
-        *location_to_write_data = static_cast<char>(DELETE_ENTRY_CODE);
-        ++location_to_write_data;
-        memcpy(location_to_write_data, key, key->full_size());
+        write_entry(sizer, prefix, key, nullptr, location_to_write_data);
     }
 
     validate(sizer, node);
@@ -1559,7 +1835,7 @@ void remove(
 // Erases the entry for the given key, leaving behind no trace.
 void erase_presence(value_sizer_t *sizer, leaf_node_t *node, const btree_key_t *key, UNUSED key_modification_proof_t km_proof) {
     int index;
-    bool found = find_key(node, key, &index);
+    bool found = find_key(sizer, node, key, &index);
     if (found) {
         int offset = node->pair_offsets[index];
         entry_t *ent = get_entry(node, offset);
@@ -1583,8 +1859,8 @@ repli_timestamp_t min_deletion_timestamp(
         const leaf_node_t *node,
         repli_timestamp_t maximum_existing_timestamp) {
     repli_timestamp_t earliest_so_far = maximum_existing_timestamp;
-    entry_iter_t iter = entry_iter_t::make(node);
-    while (!iter.done(sizer) && iter.offset < node->tstamp_cutpoint) {
+    entry_iter_t iter = entry_iter_t::make(sizer, node);
+    while (!iter.done() && iter.offset < node->tstamp_cutpoint) {
         repli_timestamp_t tstamp = get_timestamp(node, iter.offset);
         rassert(earliest_so_far >= tstamp,
             "asserted earliest_so_far (%" PRIu64 ") >= tstamp (%" PRIu64 ")",
@@ -1602,13 +1878,13 @@ void erase_deletions(
         value_sizer_t *sizer, leaf_node_t *node,
         optional<repli_timestamp_t> min_del_timestamp) {
     int old_tstamp_cutpoint = node->tstamp_cutpoint;
-    entry_iter_t iter = entry_iter_t::make(node);
+    entry_iter_t iter = entry_iter_t::make(sizer, node);
 
     if (min_del_timestamp.has_value()) {
         /* Advance `iter` to the first entry with a timestamp that's lower than
         `min_del_timestamp - 1`. */
         while (true) {
-            if (iter.done(sizer) || iter.offset >= old_tstamp_cutpoint) {
+            if (iter.done() || iter.offset >= old_tstamp_cutpoint) {
                 return;
             }
             if (get_timestamp(node, iter.offset).next() < *min_del_timestamp) {
@@ -1628,7 +1904,7 @@ void erase_deletions(
     go. Make a note of each deletion's offset so we can remove them from the
     `pair_offsets` array later. */
     std::set<int> deletion_offsets;
-    while (!iter.done(sizer) && iter.offset != old_tstamp_cutpoint) {
+    while (!iter.done() && iter.offset != old_tstamp_cutpoint) {
         int off = iter.offset;
         guarantee(off >= new_tstamp_cutpoint && off < old_tstamp_cutpoint);
         const entry_t *ent = get_entry(node, off);
@@ -1684,9 +1960,11 @@ continue_bool_t visit_entries(
             repli_timestamp_t timestamp,
             const void *value   /* null for deletion */
             )> &cb) {
+    const key_prefix_t prefix = get_prefix(sizer, node);
+    store_key_t key_buf;
     repli_timestamp_t earliest_so_far = maximum_existing_timestamp;
-    for (entry_iter_t iter = entry_iter_t::make(node);
-            !iter.done(sizer); iter.step(sizer, node)) {
+    for (entry_iter_t iter = entry_iter_t::make(sizer, node);
+            !iter.done(); iter.step(sizer, node)) {
         repli_timestamp_t tstamp;
         if (iter.offset < node->tstamp_cutpoint) {
             tstamp = get_timestamp(node, iter.offset);
@@ -1701,7 +1979,8 @@ continue_bool_t visit_entries(
             continue;
         }
 
-        if (continue_bool_t::ABORT == cb(entry_key(ent), tstamp, entry_value(ent))) {
+        if (continue_bool_t::ABORT
+                == cb(full_entry_key(prefix, ent, &key_buf), tstamp, entry_value(ent))) {
             return continue_bool_t::ABORT;
         }
     }
@@ -1709,16 +1988,28 @@ continue_bool_t visit_entries(
 }
 
 iterator::iterator()
-    : node_(nullptr), index_(-1) { }
+    : node_(nullptr), index_(-1), prefix_(nullptr), prefix_size_(0) { }
+
+iterator::iterator(max_block_size_t block_size, const leaf_node_t *node, int index)
+    : node_(node), index_(index) {
+    const key_prefix_t prefix = get_prefix(block_size, node);
+    prefix_ = prefix.contents;
+    prefix_size_ = prefix.size;
+}
 
 iterator::iterator(const leaf_node_t *node, int index)
-    : node_(node), index_(index) { }
+    : node_(node), index_(index), prefix_(nullptr), prefix_size_(-1) { }
 
 std::pair<const btree_key_t *, const void *> iterator::operator*() const {
     guarantee(index_ < static_cast<int>(node_->num_pairs));
     guarantee(index_ >= 0);
+    guarantee(prefix_size_ >= 0,
+              "Trying to dereference an iterator without a block size.");
     const entry_t *entree = get_entry(node_, node_->pair_offsets[index_]);
-    return std::make_pair(entry_key(entree), entry_value(entree));
+    key_prefix_t prefix;
+    prefix.contents = prefix_;
+    prefix.size = prefix_size_;
+    return std::make_pair(full_entry_key(prefix, entree, &key_buf_), entry_value(entree));
 }
 
 iterator &iterator::operator++() {
@@ -1752,6 +2043,10 @@ int iterator::cmp(const iterator &other) const {
 
 reverse_iterator::reverse_iterator() { }
 
+reverse_iterator::reverse_iterator(max_block_size_t block_size, const leaf_node_t *node,
+                                   int index)
+    : inner_(block_size, node, index) { }
+
 reverse_iterator::reverse_iterator(const leaf_node_t *node, int index)
     : inner_(node, index) { }
 
@@ -1777,48 +2072,52 @@ bool reverse_iterator::operator<=(const reverse_iterator &other) const { return
 bool reverse_iterator::operator>=(const reverse_iterator &other) const { return inner_ <= other.inner_; }
 
 
-leaf_node_t::iterator begin(const leaf_node_t &leaf_node) {
-    return ++leaf_node_t::iterator(&leaf_node, -1);
+leaf_node_t::iterator begin(max_block_size_t block_size, const leaf_node_t &leaf_node) {
+    return ++leaf_node_t::iterator(block_size, &leaf_node, -1);
 }
 
 leaf_node_t::iterator end(const leaf_node_t &leaf_node) {
     return leaf_node_t::iterator(&leaf_node, leaf_node.num_pairs);
 }
 
-leaf_node_t::reverse_iterator rbegin(const leaf_node_t &leaf_node) {
-    return ++leaf_node_t::reverse_iterator(&leaf_node, leaf_node.num_pairs);
+leaf_node_t::reverse_iterator rbegin(max_block_size_t block_size,
+                                     const leaf_node_t &leaf_node) {
+    return ++leaf_node_t::reverse_iterator(block_size, &leaf_node, leaf_node.num_pairs);
 }
 
 leaf_node_t::reverse_iterator rend(const leaf_node_t &leaf_node) {
     return leaf_node_t::reverse_iterator(&leaf_node, -1);
 }
 
-leaf::iterator inclusive_lower_bound(const btree_key_t *key, const leaf_node_t &leaf_node) {
+leaf::iterator inclusive_lower_bound(max_block_size_t block_size, const btree_key_t *key,
+                                     const leaf_node_t &leaf_node) {
     int index;
-    leaf::find_key(&leaf_node, key, &index);
+    leaf::find_key(&leaf_node, get_prefix(block_size, &leaf_node), key, &index);
     if (index == leaf_node.num_pairs ||
         entry_is_live(leaf::get_entry(&leaf_node, leaf_node.pair_offsets[index]))) {
-        return leaf_node_t::iterator(&leaf_node, index);
+        return leaf_node_t::iterator(block_size, &leaf_node, index);
     } else {
-        return ++leaf_node_t::iterator(&leaf_node, index);
+        return ++leaf_node_t::iterator(block_size, &leaf_node, index);
     }
 }
 
-leaf::reverse_iterator exclusive_upper_bound(const btree_key_t *key, const leaf_node_t &leaf_node) {
+leaf::reverse_iterator exclusive_upper_bound(max_block_size_t block_size,
+                                             const btree_key_t *key,
+                                             const leaf_node_t &leaf_node) {
+    const key_prefix_t prefix = get_prefix(block_size, &leaf_node);
     int index;
-    leaf::find_key(&leaf_node, key, &index);
+    leaf::find_key(&leaf_node, prefix, key, &index);
     if (index < leaf_node.num_pairs) {
         const leaf::entry_t *entry = leaf::get_entry(&leaf_node, leaf_node.pair_offsets[index]);
-        const btree_key_t *ekey = leaf::entry_key(entry);
         if (entry_is_live(entry) &&
-            btree_key_cmp(ekey, key) == 0) {
+            entry_key_cmp(key, prefix, entry) == 0) {
             // We have to skip this entry to make the iterator exclusive,
             // hence the ++.
-            return ++leaf_node_t::reverse_iterator(&leaf_node, index);
+            return ++leaf_node_t::reverse_iterator(block_size, &leaf_node, index);
         }
     }
 
-    return ++leaf_node_t::reverse_iterator(&leaf_node, index);
+    return ++leaf_node_t::reverse_iterator(block_size, &leaf_node, index);
 }
 
 }  // namespace leaf
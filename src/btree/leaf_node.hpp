@@ -7,6 +7,7 @@
 #include <vector>
 
 #include "arch/compiler.hpp"
+#include "btree/keys.hpp"
 #include "btree/types.hpp"
 #include "buffer_cache/types.hpp"
 #include "containers/optional.hpp"
@@ -67,14 +68,21 @@ ATTR_PACKED(struct leaf_node_t {
 
 namespace leaf {
 
-leaf_node_t::iterator begin(const leaf_node_t &leaf_node);
+// Iterators need the block size to find the prefix that the node's keys share.  The
+// key an iterator hands out stays valid until the iterator changes.
+leaf_node_t::iterator begin(max_block_size_t block_size, const leaf_node_t &leaf_node);
 leaf_node_t::iterator end(const leaf_node_t &leaf_node);
 
-leaf_node_t::reverse_iterator rbegin(const leaf_node_t &leaf_node);
+leaf_node_t::reverse_iterator rbegin(max_block_size_t block_size,
+                                     const leaf_node_t &leaf_node);
 leaf_node_t::reverse_iterator rend(const leaf_node_t &leaf_node);
 
-leaf_node_t::iterator inclusive_lower_bound(const btree_key_t *key, const leaf_node_t &leaf_node);
-leaf_node_t::reverse_iterator exclusive_upper_bound(const btree_key_t *key, const leaf_node_t &leaf_node);
+leaf_node_t::iterator inclusive_lower_bound(max_block_size_t block_size,
+                                            const btree_key_t *key,
+                                            const leaf_node_t &leaf_node);
+leaf_node_t::reverse_iterator exclusive_upper_bound(max_block_size_t block_size,
+                                                    const btree_key_t *key,
+                                                    const leaf_node_t &leaf_node);
 
 
 
@@ -120,17 +128,49 @@ bool fsck(value_sizer_t *sizer, const btree_key_t *left_exclusive_or_null, const
 
 void validate(value_sizer_t *sizer, const leaf_node_t *node);
 
+// True if `node` has one of the leaf magics of the value type, with or without a key
+// prefix.
+bool has_leaf_magic(value_sizer_t *sizer, const leaf_node_t *node);
+
 void init(value_sizer_t *sizer, leaf_node_t *node);
 
 bool is_empty(const leaf_node_t *node);
 
 bool is_full(value_sizer_t *sizer, const leaf_node_t *node, const btree_key_t *key, const void *value);
 
+// Like `is_full()`, for a value of `value_size` bytes that doesn't exist yet.
+bool is_full_for_value_size(value_sizer_t *sizer, const leaf_node_t *node,
+                            const btree_key_t *key, int value_size);
+
 bool is_underfull(value_sizer_t *sizer, const leaf_node_t *node);
 
+// True if writing or removing the pair for `key` might make `node` full or underfull,
+// so that its parent is needed to split or merge it.
+bool change_unsafe(value_sizer_t *sizer, const leaf_node_t *node,
+                   const btree_key_t *key);
+
+// How many bytes `compact()` would free up.
+int reclaimable_space(value_sizer_t *sizer, const leaf_node_t *node);
+
+// Reclaims the space of the entries that were removed, and drops the deletion entries
+// and timestamps that the node doesn't have to keep, like an insertion into a full node
+// would.  Backfills that start before the oldest deletion the node keeps afterwards
+// have to send the whole node.
+void compact(value_sizer_t *sizer, leaf_node_t *node);
+
 void split(value_sizer_t *sizer, leaf_node_t *node, leaf_node_t *sibling,
            btree_key_t *median_out);
 
+// True if `key` comes after every entry of `node`, which must not be empty.
+bool is_past_end(value_sizer_t *sizer, const leaf_node_t *node, const btree_key_t *key);
+
+// Splits `node` for the insertion of a key that `is_past_end()`: all its entries stay
+// where they are, and `sibling` starts out empty.  When keys are inserted in ascending
+// order, this leaves full leaves behind instead of half-full ones.  `sibling` is
+// underfull until it fills up, so it mustn't be merged or leveled on insertions.
+void split_at_end(value_sizer_t *sizer, leaf_node_t *node, leaf_node_t *sibling,
+                  btree_key_t *median_out);
+
 void merge(value_sizer_t *sizer, leaf_node_t *left, leaf_node_t *right);
 
 // The pointers in `moved_values_out` point to positions in `node` and
@@ -141,7 +181,8 @@ bool level(value_sizer_t *sizer, int nodecmp_node_with_sib, leaf_node_t *node,
 
 bool is_mergable(value_sizer_t *sizer, const leaf_node_t *node, const leaf_node_t *sibling);
 
-bool find_key(const leaf_node_t *node, const btree_key_t *key, int *index_out);
+bool find_key(value_sizer_t *sizer, const leaf_node_t *node, const btree_key_t *key,
+              int *index_out);
 
 bool lookup(value_sizer_t *sizer, const leaf_node_t *node, const btree_key_t *key, void *value_out);
 
@@ -186,7 +227,8 @@ void erase_deletions(
 
 /* Calls `cb` on every entry in the node, whether a real entry or a deletion. The calls
 will be in order from most recent to least recent. For entries with no timestamp, the
-callback will get `min_deletion_timestamp() - 1`. */
+callback will get `min_deletion_timestamp() - 1`. The key is only valid during the call.
+*/
 continue_bool_t visit_entries(
     value_sizer_t *sizer,
     const leaf_node_t *node,
@@ -201,6 +243,8 @@ continue_bool_t visit_entries(
 class iterator {
 public:
     iterator();
+    iterator(max_block_size_t block_size, const leaf_node_t *node, int index);
+    // For iterators that only get compared, like `end()`.  They can't be dereferenced.
     iterator(const leaf_node_t *node, int index);
     std::pair<const btree_key_t *, const void *> operator*() const;
     iterator &operator++();
@@ -216,11 +260,16 @@ private:
     int cmp(const iterator &other) const;
     const leaf_node_t *node_;
     int index_;
+    const uint8_t *prefix_;
+    int prefix_size_;
+    // Holds the key of the current entry if it doesn't fit in the node as it is.
+    mutable store_key_t key_buf_;
 };
 
 class reverse_iterator {
 public:
     reverse_iterator();
+    reverse_iterator(max_block_size_t block_size, const leaf_node_t *node, int index);
     reverse_iterator(const leaf_node_t *node, int index);
     std::pair<const btree_key_t *, const void *> operator*() const;
     reverse_iterator &operator++();
@@ -42,12 +42,12 @@ buf_lock_t get_root(value_sizer_t *sizer, superblock_t *sb) {
 // Helper function for `check_and_handle_split()` and `check_and_handle_underfull()`.
 // Detaches all values in the given node if it's an internal node, and calls
 // `detacher` on each value if it's a leaf node.
-void detach_all_children(const node_t *node, buf_parent_t parent,
+void detach_all_children(value_sizer_t *sizer, const node_t *node, buf_parent_t parent,
                          const value_deleter_t *detacher) {
     if (node::is_leaf(node)) {
         const leaf_node_t *leaf = reinterpret_cast<const leaf_node_t *>(node);
         // Detach the values that are now in `rbuf` with `buf` as their parent.
-        for (auto it = leaf::begin(*leaf); it != leaf::end(*leaf); ++it) {
+        for (auto it = leaf::begin(sizer->block_size(), *leaf); it != leaf::end(*leaf); ++it) {
             detacher->delete_value(parent, (*it).second);
         }
     } else {
@@ -99,6 +99,25 @@ void check_and_handle_split(value_sizer_t *sizer,
         sb->expose_buf().detach_child(buf->block_id());
     }
 
+    // Keys that are inserted in ascending order, like timestamps or counters, all go
+    // past the end of the last leaf.  If we split that leaf evenly, every leaf they
+    // leave behind is only half full, so we split it at its end instead.
+    bool at_end = false;
+    if (new_value != nullptr) {
+        buf_read_t buf_read(buf);
+        const leaf_node_t *node
+            = static_cast<const leaf_node_t *>(buf_read.get_data_read());
+        bool is_last_child = true;
+        if (!last_buf->empty()) {
+            buf_read_t last_buf_read(last_buf);
+            const internal_node_t *parent
+                = static_cast<const internal_node_t *>(last_buf_read.get_data_read());
+            is_last_child
+                = internal_node::get_offset_index(parent, key) == parent->npairs - 1;
+        }
+        at_end = is_last_child && leaf::is_past_end(sizer, node, key);
+    }
+
     // Allocate a new node to split into, and some temporary memory to keep
     // track of the median key in the split; then actually split.
     buf_lock_t rbuf(last_buf->empty() ? sb->expose_buf() : buf_parent_t(last_buf),
@@ -109,17 +128,24 @@ void check_and_handle_split(value_sizer_t *sizer,
     {
         buf_write_t buf_write(buf);
         buf_write_t rbuf_write(&rbuf);
-        node::split(sizer,
-                    static_cast<node_t *>(buf_write.get_data_write()),
-                    static_cast<node_t *>(rbuf_write.get_data_write()),
-                    median);
+        if (at_end) {
+            leaf::split_at_end(sizer,
+                               static_cast<leaf_node_t *>(buf_write.get_data_write()),
+                               static_cast<leaf_node_t *>(rbuf_write.get_data_write()),
+                               median);
+        } else {
+            node::split(sizer,
+                        static_cast<node_t *>(buf_write.get_data_write()),
+                        static_cast<node_t *>(rbuf_write.get_data_write()),
+                        median);
+        }
 
         // We must detach all entries that we have removed from `buf`.
         buf_read_t rbuf_read(&rbuf);
         const node_t *node = static_cast<const node_t *>(rbuf_read.get_data_read());
         // The parent of the entries used to be `buf`, even though they are now in
         // `rbuf`...
-        detach_all_children(node, buf_parent_t(buf), detacher);
+        detach_all_children(sizer, node, buf_parent_t(buf), detacher);
     }
 
     // Since we moved subtrees from `buf` to `rbuf`, we need to set `rbuf`'s recency
@@ -259,7 +285,7 @@ void check_and_handle_underfull(value_sizer_t *sizer,
                 buf_read_t sib_buf_read(&sib_buf);
                 const node_t *node =
                     static_cast<const node_t *>(sib_buf_read.get_data_read());
-                detach_all_children(node, buf_parent_t(&sib_buf), detacher);
+                detach_all_children(sizer, node, buf_parent_t(&sib_buf), detacher);
 
                 const internal_node_t *parent_node
                     = static_cast<const internal_node_t *>(last_buf_read.get_data_read());
@@ -363,6 +389,20 @@ void check_and_handle_underfull(value_sizer_t *sizer,
  * keyvalue_location_t that's passed in (keyvalue_location_out) is destroyed.
  * This is because it may need to use the superblock for some of its methods.
  * */
+// Releases the superblock of `kv_loc`, or passes it back, unless that already
+// happened.
+void release_superblock_for_write(keyvalue_location_t *kv_loc) {
+    if (kv_loc->superblock == nullptr) {
+        return;
+    }
+    if (kv_loc->pass_back_superblock != nullptr) {
+        kv_loc->pass_back_superblock->pulse(kv_loc->superblock);
+    } else {
+        kv_loc->superblock->release();
+    }
+    kv_loc->superblock = nullptr;
+}
+
 void find_keyvalue_location_for_write(
         value_sizer_t *sizer,
         superblock_t *superblock, const btree_key_t *key,
@@ -374,7 +414,11 @@ void find_keyvalue_location_for_write(
     keyvalue_location_out->superblock = superblock;
     keyvalue_location_out->pass_back_superblock = pass_back_superblock;
 
-    keyvalue_location_out->stat_block = keyvalue_location_out->superblock->get_stat_block_id();
+    const block_id_t stat_block_id = superblock->get_stat_block_id();
+    if (stat_block_id != NULL_BLOCK_ID) {
+        keyvalue_location_out->stat_block
+            = buf_lock_t(superblock->expose_buf(), stat_block_id, access_t::write);
+    }
 
     buf_lock_t last_buf;
     buf_lock_t buf;
@@ -416,14 +460,8 @@ void find_keyvalue_location_for_write(
         // already released it). If we're still at the root or at one of
         // its direct children, we might still want to replace the root, so
         // we can't release the superblock yet.
-        if (!last_buf.empty() && keyvalue_location_out->superblock) {
-            if (pass_back_superblock != nullptr) {
-                pass_back_superblock->pulse(superblock);
-                keyvalue_location_out->superblock = nullptr;
-            } else {
-                keyvalue_location_out->superblock->release();
-                keyvalue_location_out->superblock = nullptr;
-            }
+        if (!last_buf.empty()) {
+            release_superblock_for_write(keyvalue_location_out);
         }
 
         // Release the old previous node (unless we're at the root), and set
@@ -467,6 +505,16 @@ void find_keyvalue_location_for_write(
             keyvalue_location_out->there_originally_was_value = true;
             keyvalue_location_out->value = std::move(tmp);
         }
+
+        // Writers to the other children of the parent queue up behind us for as
+        // long as we hold it, which includes however long the caller takes to come
+        // up with the new value.  We only need the parent (and the superblock) if
+        // the leaf has to be split or merged, so if no write of `key` can make that
+        // necessary, we let go of them right away.
+        if (!last_buf.empty() && !leaf::change_unsafe(sizer, node, key)) {
+            last_buf.reset_buf_lock();
+            release_superblock_for_write(keyvalue_location_out);
+        }
     }
 
     keyvalue_location_out->last_buf.swap(last_buf);
@@ -520,6 +568,23 @@ void find_keyvalue_location_for_read(
         }
         rassert(node_id != NULL_BLOCK_ID && node_id != SUPERBLOCK_ID);
 
+        // Writers have to come through `buf` to modify the nodes below it, so we can
+        // look up the key in the internal nodes that are in memory and that no writer
+        // holds without acquiring them, as long as we don't yield.
+        for (;;) {
+            const void *data = buf_lock_t::peek_clean_descendant(&buf, node_id);
+            if (data == nullptr
+                || !node::is_internal(static_cast<const node_t *>(data))) {
+                break;
+            }
+#ifndef NDEBUG
+            node::validate(sizer, static_cast<const node_t *>(data));
+#endif  // NDEBUG
+            node_id = internal_node::lookup(static_cast<const internal_node_t *>(data),
+                                            key);
+            rassert(node_id != NULL_BLOCK_ID && node_id != SUPERBLOCK_ID);
+        }
+
         {
             PROFILE_STARTER_IF_ENABLED(
                 trace != nullptr, "Acquire a block for read.", trace);
@@ -552,13 +617,34 @@ void find_keyvalue_location_for_read(
     }
 }
 
-void apply_keyvalue_change(
+bool find_keyvalue_location_in_same_leaf(
+        value_sizer_t *sizer,
+        keyvalue_location_t *kv_loc,
+        const btree_key_t *key) {
+    scoped_malloc_t<void> tmp(sizer->max_possible_size());
+    buf_read_t read(&kv_loc->buf);
+    auto node = static_cast<const leaf_node_t *>(read.get_data_read());
+    if (!leaf::lookup(sizer, node, key, tmp.get())) {
+        return false;
+    }
+    // Once `find_keyvalue_location_for_write()` has let go of the parent, nothing we do
+    // to the leaf may leave it underfull.
+    if (kv_loc->last_buf.empty() && leaf::change_unsafe(sizer, node, key)) {
+        return false;
+    }
+    kv_loc->there_originally_was_value = true;
+    kv_loc->value = std::move(tmp);
+    return true;
+}
+
+static void apply_keyvalue_change_impl(
         value_sizer_t *sizer,
         keyvalue_location_t *kv_loc,
         const btree_key_t *key, repli_timestamp_t tstamp,
         const value_deleter_t *balancing_detacher,
         key_modification_callback_t *km_callback,
-        delete_mode_t delete_mode) {
+        delete_mode_t delete_mode,
+        bool rebalance) {
     key_modification_proof_t km_proof
         = km_callback->value_modification(kv_loc, key);
 
@@ -653,19 +739,42 @@ void apply_keyvalue_change(
     }
 
     // Check to see if the leaf is underfull (following a change in
-    // size or a deletion, and merge/level if it is.
-    check_and_handle_underfull(sizer, &kv_loc->buf, &kv_loc->last_buf,
-                               kv_loc->superblock, key, balancing_detacher);
-
-    // Modify the stats block.  The stats block is detached from the rest of the
-    // btree, we don't keep a consistent view of it, so we pass the txn as its
-    // parent.
-    if (kv_loc->stat_block != NULL_BLOCK_ID) {
-        buf_lock_t stat_block(buf_parent_t(kv_loc->buf.txn()),
-                              kv_loc->stat_block, access_t::write);
-        buf_write_t stat_block_write(&stat_block);
+    // size or a deletion, and merge/level if it is.  Inserting a new key only grows
+    // the leaf, so it can only be underfull if `check_and_handle_split()` just split
+    // it at its end, and then it has to stay that way to fill up.
+    if (rebalance && population_change != 1) {
+        check_and_handle_underfull(sizer, &kv_loc->buf, &kv_loc->last_buf,
+                                   kv_loc->superblock, key, balancing_detacher);
+    }
+
+    // Modify the stats block.  Readers that get it through their superblock see the
+    // changes of exactly the writes that got the superblock before them.
+    if (!kv_loc->stat_block.empty()) {
+        buf_write_t stat_block_write(&kv_loc->stat_block);
         auto stat_block_buf = static_cast<btree_statblock_t *>(
                 stat_block_write.get_data_write(BTREE_STATBLOCK_SIZE));
         stat_block_buf->population += population_change;
     }
 }
+
+void apply_keyvalue_change(
+        value_sizer_t *sizer,
+        keyvalue_location_t *kv_loc,
+        const btree_key_t *key, repli_timestamp_t tstamp,
+        const value_deleter_t *balancing_detacher,
+        key_modification_callback_t *km_callback,
+        delete_mode_t delete_mode) {
+    apply_keyvalue_change_impl(sizer, kv_loc, key, tstamp, balancing_detacher,
+                               km_callback, delete_mode, true);
+}
+
+void apply_keyvalue_change_in_place(
+        value_sizer_t *sizer,
+        keyvalue_location_t *kv_loc,
+        const btree_key_t *key, repli_timestamp_t tstamp,
+        key_modification_callback_t *km_callback,
+        delete_mode_t delete_mode) {
+    rassert(!kv_loc->value.has());
+    apply_keyvalue_change_impl(sizer, kv_loc, key, tstamp, nullptr, km_callback,
+                               delete_mode, false);
+}
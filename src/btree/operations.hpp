@@ -63,11 +63,25 @@ public:
         : btree_collection(),
           pm_keys_read(secs_to_ticks(1)),
           pm_keys_set(secs_to_ticks(1)),
+          pm_keys_returned(secs_to_ticks(1)),
+          pm_bytes_read(secs_to_ticks(1)),
+          pm_bytes_written(secs_to_ticks(1)),
+          pm_sindex_keys_updated(secs_to_ticks(1)),
+          pm_sindex_update_latency(secs_to_ticks(1)),
           pm_keys_membership(&btree_collection,
               &pm_keys_read, "keys_read",
               &pm_total_keys_read, "total_keys_read",
               &pm_keys_set, "keys_set",
-              &pm_total_keys_set, "total_keys_set") {
+              &pm_total_keys_set, "total_keys_set",
+              &pm_keys_returned, "keys_returned",
+              &pm_total_keys_returned, "total_keys_returned",
+              &pm_bytes_read, "bytes_read",
+              &pm_total_bytes_read, "total_bytes_read",
+              &pm_bytes_written, "bytes_written",
+              &pm_total_bytes_written, "total_bytes_written",
+              &pm_sindex_keys_updated, "sindex_keys_updated",
+              &pm_total_sindex_keys_updated, "total_sindex_keys_updated",
+              &pm_sindex_update_latency, "sindex_update_latency") {
         if (parent != nullptr) {
             rename(parent, identifier);
         }
@@ -88,12 +102,27 @@ public:
 
     perfmon_collection_t btree_collection;
     scoped_ptr_t<perfmon_membership_t> btree_collection_membership;
+    /* `keys_read` counts every row that a read looks at, while `keys_returned` only
+    counts the rows of range reads that are left after the filters and other
+    transformations that run on the shard. The bytes are the sizes of the serialized
+    documents, whether or not they were in the cache. */
     perfmon_rate_monitor_t
         pm_keys_read,
-        pm_keys_set;
+        pm_keys_set,
+        pm_keys_returned,
+        pm_bytes_read,
+        pm_bytes_written,
+        pm_sindex_keys_updated;
     perfmon_counter_t
         pm_total_keys_read,
-        pm_total_keys_set;
+        pm_total_keys_set,
+        pm_total_keys_returned,
+        pm_total_bytes_read,
+        pm_total_bytes_written,
+        pm_total_sindex_keys_updated;
+    // How long it takes to update all the indexes for one write, or for one batch of
+    // writes that update the indexes together
+    perfmon_latency_sampler_t pm_sindex_update_latency;
     perfmon_multi_membership_t pm_keys_membership;
 };
 
@@ -101,7 +130,7 @@ class keyvalue_location_t {
 public:
     keyvalue_location_t()
         : superblock(nullptr), pass_back_superblock(nullptr),
-          there_originally_was_value(false), stat_block(NULL_BLOCK_ID) { }
+          there_originally_was_value(false) { }
 
     ~keyvalue_location_t() {
         if (superblock != nullptr) {
@@ -117,7 +146,8 @@ public:
 
     promise_t<superblock_t *> *pass_back_superblock;
 
-    // The parent buf of buf, if buf is not the root node.  This is hacky.
+    // The parent buf of buf, if buf is not the root node and the write might have to
+    // split or merge it.  This is hacky.
     buf_lock_t last_buf;
 
     // The buf owning the leaf node which contains the value.
@@ -131,9 +161,10 @@ public:
     template <class T>
     T *value_as() { return static_cast<T *>(value.get()); }
 
-    // Stat block when modifications are made using this class the statblock is
-    // update.
-    block_id_t stat_block;
+    // The stat block, if the tree has one, which modifications made using this class
+    // update.  It gets acquired while we still hold the superblock, so the population
+    // changes in the same order as the tree does.
+    buf_lock_t stat_block;
 private:
 
     DISABLE_COPYING(keyvalue_location_t);
@@ -238,4 +269,25 @@ void apply_keyvalue_change(
         key_modification_callback_t *km_callback,
         delete_mode_t delete_mode);
 
+/* For deleting many keys that are next to each other: `apply_keyvalue_change()` for a
+deletion, except that the leaf doesn't get merged or leveled afterwards.  Instead,
+`kv_loc` can go on to another key in the same leaf with
+`find_keyvalue_location_in_same_leaf()`.  After the last change to the leaf, call
+`check_and_handle_underfull()` to rebalance it once. */
+void apply_keyvalue_change_in_place(
+        value_sizer_t *sizer,
+        keyvalue_location_t *kv_loc,
+        const btree_key_t *key,
+        repli_timestamp_t tstamp,
+        key_modification_callback_t *km_callback,
+        delete_mode_t delete_mode);
+
+/* Points `kv_loc`, which `find_keyvalue_location_for_write()` found, at `key` instead.
+Returns false without changing anything if `key` isn't in the same leaf, or if deleting
+it could leave the leaf underfull and `kv_loc` has let go of the leaf's parent. */
+bool find_keyvalue_location_in_same_leaf(
+        value_sizer_t *sizer,
+        keyvalue_location_t *kv_loc,
+        const btree_key_t *key);
+
 #endif  // BTREE_OPERATIONS_HPP_
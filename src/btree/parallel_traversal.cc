@@ -352,8 +352,8 @@ void btree_parallel_traversal(superblock_t *superblock,
 
     if (state.stat_block != NULL_BLOCK_ID) {
         /* Give the helper a look at the stat block */
-        buf_lock_t stat_block(buf_parent_t(superblock->expose_buf().txn()),
-                              state.stat_block, access_t::read);
+        buf_lock_t stat_block(superblock->expose_buf(), state.stat_block,
+                              access_t::read);
         helper->read_stat_block(&stat_block);
     } else {
         helper->read_stat_block(nullptr);
@@ -108,8 +108,12 @@ btree_sindex_block_magic_t<cluster_version_t::v2_4>::value
     = { { 's', 'i', 'n', 'l' } };
 template <>
 const block_magic_t
-btree_sindex_block_magic_t<cluster_version_t::v2_5_is_latest>::value
+btree_sindex_block_magic_t<cluster_version_t::v2_5>::value
     = { { 's', 'i', 'n', 'm' } };
+template <>
+const block_magic_t
+btree_sindex_block_magic_t<cluster_version_t::v2_6_is_latest>::value
+    = { { 's', 'i', 'n', 'n' } };
 
 cluster_version_t sindex_block_version(const btree_sindex_block_t *data) {
     if (data->magic == v1_13_sindex_block_magic) {
@@ -144,8 +148,12 @@ cluster_version_t sindex_block_version(const btree_sindex_block_t *data) {
         return cluster_version_t::v2_4;
     } else if (data->magic
                == btree_sindex_block_magic_t<
-                   cluster_version_t::v2_5_is_latest_disk>::value) {
-        return cluster_version_t::v2_5_is_latest_disk;
+                   cluster_version_t::v2_5>::value) {
+        return cluster_version_t::v2_5;
+    } else if (data->magic
+               == btree_sindex_block_magic_t<
+                   cluster_version_t::v2_6_is_latest_disk>::value) {
+        return cluster_version_t::v2_6_is_latest_disk;
     } else {
         crash("Unexpected magic in btree_sindex_block_t.");
     }
@@ -5,6 +5,7 @@
 #include "arch/types.hpp"
 #include "arch/runtime/coroutines.hpp"
 #include "buffer_cache/stats.hpp"
+#include "buffer_cache/warm_up.hpp"
 #include "concurrency/auto_drainer.hpp"
 #include "utils.hpp"
 
@@ -141,6 +142,17 @@ void cache_t::configure_flush_interval(flush_interval_t interval) {
         clamp_ring_length(which_cpu_shard_, interval.millis));
 }
 
+void cache_t::configure_quota(cache_quota_t quota) {
+    assert_thread();
+    page_cache_.evicter().set_quota(quota);
+}
+
+void cache_t::start_warm_up(const std::string &file_path) {
+    assert_thread();
+    guarantee(!warm_up_.has());
+    warm_up_.init(new alt::cache_warm_up_t(&page_cache_, file_path));
+}
+
 cache_account_t cache_t::create_cache_account(int priority) {
     return page_cache_.create_cache_account(priority);
 }
@@ -275,6 +287,10 @@ txn_t::~txn_t() {
 }
 
 void txn_t::commit() {
+    commit(std::function<void()>());
+}
+
+void txn_t::commit(const std::function<void()> &before_waiting) {
     cache_->assert_thread();
 
     guarantee(!is_committed_);
@@ -286,12 +302,18 @@ void txn_t::commit() {
             std::move(page_txn_),
             durability_,
             nullptr);
+        if (before_waiting) {
+            before_waiting();
+        }
     } else {
         page_txn_complete_cb_t cb;
         cache_->page_cache_.flush_and_destroy_txn(
             std::move(page_txn_),
             durability_,
             &cb);
+        if (before_waiting) {
+            before_waiting();
+        }
         cb.cond.wait_lazily_unordered();
     }
 }
@@ -737,6 +759,25 @@ current_page_acq_t *buf_lock_t::current_page_acq() const {
     }
 }
 
+void buf_lock_t::prefetch_children(buf_parent_t parent,
+                                   const std::vector<block_id_t> &child_ids) {
+    ASSERT_NO_CORO_WAITING;
+    parent.cache()->page_cache_.prefetch_blocks(child_ids, parent.txn()->account());
+}
+
+const void *buf_lock_t::peek_clean_descendant(buf_lock_t *ancestor,
+                                              block_id_t block_id) {
+    ASSERT_NO_CORO_WAITING;
+    guarantee(!ancestor->empty());
+    guarantee(ancestor->read_acq_signal()->is_pulsed());
+    // Snapshotted readers have to see the version of the block that belongs to the
+    // snapshot, which only the snapshot nodes know about.
+    if (ancestor->is_snapshotted()) {
+        return nullptr;
+    }
+    return ancestor->cache()->page_cache_.peek_clean_page(block_id);
+}
+
 void buf_lock_t::detach_child(block_id_t child_id) {
     ASSERT_FINITE_CORO_WAITING;
     guarantee(!empty());
@@ -816,8 +857,8 @@ page_t *buf_lock_t::get_held_page_for_write() {
     return current_page_acq_->current_page_for_write(txn()->account());
 }
 
-buf_read_t::buf_read_t(buf_lock_t *lock)
-    : lock_(lock) {
+buf_read_t::buf_read_t(buf_lock_t *lock, page_access_priority_t priority)
+    : lock_(lock), priority_(priority) {
     guarantee(!lock_->empty());
     lock_->access_ref_count_++;
 }
@@ -835,7 +876,7 @@ const void *buf_read_t::get_data_read(uint16_t *block_size_out) {
     }
     page_acq_.buf_ready_signal()->wait();
     *block_size_out = page_acq_.get_buf_size().value();
-    return page_acq_.get_buf_read();
+    return page_acq_.get_buf_read(priority_);
 }
 
 buf_write_t::buf_write_t(buf_lock_t *lock)
@@ -2,7 +2,9 @@
 #ifndef BUFFER_CACHE_ALT_HPP_
 #define BUFFER_CACHE_ALT_HPP_
 
+#include <functional>
 #include <map>
+#include <string>
 #include <vector>
 #include <utility>
 
@@ -20,6 +22,10 @@ class alt_snapshot_node_t;
 class perfmon_collection_t;
 class cache_balancer_t;
 
+namespace alt {
+class cache_warm_up_t;
+}
+
 class alt_txn_throttler_t {
 public:
     explicit alt_txn_throttler_t(int64_t minimum_unwritten_changes_limit);
@@ -64,6 +70,14 @@ public:
 
     void configure_flush_interval(flush_interval_t interval);
 
+    // Protects some or all of the cache's pages from eviction.
+    void configure_quota(cache_quota_t quota);
+
+    // Starts warming up the cache with the blocks recorded in the file at
+    // `file_path`, and from then on records the blocks in the cache there.  (See
+    // alt::cache_warm_up_t.)
+    void start_warm_up(const std::string &file_path);
+
 private:
     friend class txn_t;
     friend class buf_read_t;
@@ -82,6 +96,8 @@ private:
 
     scoped_ptr_t<alt_cache_stats_t> stats_;
 
+    scoped_ptr_t<alt::cache_warm_up_t> warm_up_;
+
     std::map<block_id_t, intrusive_list_t<alt_snapshot_node_t> >
         snapshot_nodes_by_block_id_;
 
@@ -109,6 +125,11 @@ public:
     // write-transaction will terminate the server.
     void commit();
 
+    // The same, but calls `before_waiting` as soon as the changes have been handed to
+    // the page cache, before waiting for a hard durability flush to finish.  From then
+    // on, later transactions see the changes and are flushed after them.
+    void commit(const std::function<void()> &before_waiting);
+
     cache_t *cache() { return cache_; }
     alt::page_txn_t *page_txn() { return page_txn_.get(); }
     access_t access() const { return access_; }
@@ -204,6 +225,20 @@ public:
 
     void detach_child(block_id_t child_id);
 
+    // Starts loading the given children of `parent` into the cache, without
+    // acquiring them, so that acquiring them later doesn't have to wait for the disk.
+    static void prefetch_children(buf_parent_t parent,
+                                  const std::vector<block_id_t> &child_ids);
+
+    // Returns the contents of the block `block_id` without acquiring it, if it's in
+    // memory and no write acquirer holds it or waits for it, and null otherwise.
+    // This is only correct for blocks that writers can only get to through
+    // `ancestor`, like the btree nodes below it: as long as we hold `ancestor`, any
+    // writer that could modify the block is already in line for it.  The contents
+    // are only valid until the coroutine yields.
+    static const void *peek_clean_descendant(buf_lock_t *ancestor,
+                                             block_id_t block_id);
+
     block_id_t block_id() const {
         guarantee(txn_ != nullptr);
         return current_page_acq()->block_id();
@@ -310,6 +345,11 @@ public:
         return txn_ == nullptr;
     }
 
+    // Whether the children acquired through this parent see a snapshot.
+    bool is_snapshotted() const {
+        return lock_or_null_ != nullptr && lock_or_null_->is_snapshotted();
+    }
+
     txn_t *txn() const {
         guarantee(!empty());
         return txn_;
@@ -327,7 +367,11 @@ private:
 
 class buf_read_t {
 public:
-    explicit buf_read_t(buf_lock_t *lock);
+    // Scans that read every block once should pass page_access_priority_t::low, so
+    // that they don't make the blocks look worth keeping in the cache.
+    explicit buf_read_t(
+            buf_lock_t *lock,
+            page_access_priority_t priority = page_access_priority_t::normal);
     ~buf_read_t();
 
     const void *get_data_read(uint16_t *block_size_out);
@@ -340,6 +384,7 @@ public:
 
 private:
     buf_lock_t *lock_;
+    const page_access_priority_t priority_;
     alt::page_acq_t page_acq_;
 
     DISABLE_COPYING(buf_read_t);
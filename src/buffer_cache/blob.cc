@@ -424,6 +424,14 @@ make_tree_from_block_ids(buf_parent_t parent, access_t mode, int levels,
 
     filler.nodes = new temporary_acq_tree_node_t[filler.hi - filler.lo];
 
+    // The acquisitions below don't wait for the blocks to be loaded, and they're
+    // throttled anyway.  Readers then wait for the blocks one by one, so we start
+    // loading all of them at once, instead of paying a disk round trip per block.
+    if (mode == access_t::read) {
+        const std::vector<block_id_t> ids(block_ids + filler.lo, block_ids + filler.hi);
+        buf_lock_t::prefetch_children(parent, ids);
+    }
+
     throttled_pmap(filler.hi - filler.lo, filler, choose_concurrency(levels));
 
     return filler.nodes;
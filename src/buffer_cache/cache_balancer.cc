@@ -11,7 +11,7 @@ const uint64_t alt_cache_balancer_t::rebalance_check_interval_ms = 20;
 const uint64_t alt_cache_balancer_t::rebalance_access_count_threshold = 100;
 const int64_t alt_cache_balancer_t::rebalance_timeout_ms = 500;
 
-const double alt_cache_balancer_t::read_ahead_proportion = 0.9;
+const double alt_cache_balancer_t::read_ahead_proportion = 4.0;
 
 alt_cache_balancer_t::cache_data_t::cache_data_t(alt::evicter_t *_evicter) :
     evicter(_evicter),
@@ -20,12 +20,17 @@ alt_cache_balancer_t::cache_data_t::cache_data_t(alt::evicter_t *_evicter) :
     unevictable_size(evicter->unevictable_size()),
     evictable_disk_backed_size(evicter->evictable_disk_backed_size()),
     evictable_unbacked_size(evicter->evictable_unbacked_size()),
+    reserved_size(evicter->reserved_size()),
     bytes_loaded(evicter->get_bytes_loaded()),
     access_count(evicter->access_count()) { }
 
 alt_cache_balancer_t::alt_cache_balancer_t(
-        clone_ptr_t<watchable_t<uint64_t> > _total_cache_size_watchable) :
+        clone_ptr_t<watchable_t<uint64_t> > _total_cache_size_watchable,
+        eviction_policy_t _eviction_policy,
+        double _compressed_tier_fraction) :
     total_cache_size_watchable(_total_cache_size_watchable),
+    eviction_policy_(_eviction_policy),
+    compressed_tier_fraction_(_compressed_tier_fraction),
     rebalance_timer(make_scoped<repeating_timer_t>(rebalance_check_interval_ms, this)),
     rebalance_timer_state(rebalance_timer_state_t::normal),
     last_rebalance_time{0},
@@ -53,6 +58,11 @@ bool *alt_cache_balancer_t::notify_activity_boolean(threadnum_t thread) {
     return &per_thread_data[thread.threadnum].wake_up_balancer;
 }
 
+alt::eviction_domain_t *alt_cache_balancer_t::eviction_domain(threadnum_t thread) {
+    guarantee(thread == get_thread_id());
+    return &per_thread_data[thread.threadnum].eviction_domain;
+}
+
 void alt_cache_balancer_t::wake_up_activity_happened() {
     assert_thread();
 
@@ -170,8 +180,9 @@ void alt_cache_balancer_t::rebalance_blocking(UNUSED signal_t *interruptor) {
                     new_size += data->old_size;
                     new_size = std::max<int64_t>(new_size, 0);
 
-                    int64_t existing_unevictable
-                        = data->unevictable_size + data->evictable_unbacked_size;
+                    int64_t existing_unevictable = std::max<int64_t>(
+                        data->unevictable_size + data->evictable_unbacked_size,
+                        data->reserved_size);
 
                     if (new_size < existing_unevictable) {
                         new_size = existing_unevictable;
@@ -204,6 +215,9 @@ void alt_cache_balancer_t::rebalance_blocking(UNUSED signal_t *interruptor) {
                     // Give soft durability flush caches with high intervals some
                     // breathing room.  (This is really gross.)
                     existing_unevictable *= 1.05;
+                    // Pages protected by the cache's quota can't be evicted either.
+                    existing_unevictable = std::max<int64_t>(existing_unevictable,
+                                                             data->reserved_size);
 
                     // Avoid underflow
                     if (static_cast<int64_t>(data->new_size) + delta > existing_unevictable) {
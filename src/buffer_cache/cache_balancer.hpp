@@ -10,6 +10,8 @@
 
 #include "threading.hpp"
 #include "arch/timing.hpp"
+#include "buffer_cache/eviction_domain.hpp"
+#include "buffer_cache/types.hpp"
 #include "concurrency/pump_coro.hpp"
 #include "concurrency/watchable.hpp"
 #include "containers/scoped.hpp"
@@ -30,6 +32,17 @@ public:
     // Tells caches whether to start read ahead initially
     virtual bool read_ahead_ok_at_start() const = 0;
 
+    // Tells caches how to pick the pages they evict
+    virtual eviction_policy_t eviction_policy() const = 0;
+
+    // Tells caches which fraction of their memory limit they may use to keep
+    // compressed copies of evicted pages (zero if they shouldn't keep any)
+    virtual double compressed_tier_fraction() const = 0;
+
+    // Returns the eviction domain that the caches on the given thread (which must be
+    // the current thread) share, or null if they evict their pages on their own.
+    virtual alt::eviction_domain_t *eviction_domain(threadnum_t) = 0;
+
     // Returns a pointer to a boolean for the given thread number (which must be the
     // current thread) which, when set to true, means you should notify the balancer
     // that it should wake up.  Stuff outside the balancer should only set it from
@@ -55,8 +68,13 @@ protected:
 // Dummy balancer that does nothing but provide the initial size of a cache
 class dummy_cache_balancer_t final : public cache_balancer_t {
 public:
-    explicit dummy_cache_balancer_t(uint64_t _base_mem_per_store)
+    explicit dummy_cache_balancer_t(
+            uint64_t _base_mem_per_store,
+            eviction_policy_t _eviction_policy = eviction_policy_t::scan_resistant,
+            double _compressed_tier_fraction = 0)
         : base_mem_per_store_(_base_mem_per_store),
+          eviction_policy_(_eviction_policy),
+          compressed_tier_fraction_(_compressed_tier_fraction),
           notify_activity_boolean_(false) { }
     ~dummy_cache_balancer_t() { }
 
@@ -68,6 +86,18 @@ public:
         return false;
     }
 
+    eviction_policy_t eviction_policy() const final {
+        return eviction_policy_;
+    }
+
+    double compressed_tier_fraction() const final {
+        return compressed_tier_fraction_;
+    }
+
+    alt::eviction_domain_t *eviction_domain(threadnum_t) final {
+        return nullptr;
+    }
+
     bool *notify_activity_boolean(threadnum_t) final {
         return &notify_activity_boolean_;
     }
@@ -79,6 +109,8 @@ private:
     void remove_evicter(alt::evicter_t *) { }
 
     uint64_t base_mem_per_store_;
+    eviction_policy_t eviction_policy_;
+    double compressed_tier_fraction_;
 
     bool notify_activity_boolean_;
 
@@ -90,7 +122,9 @@ class alt_cache_balancer_t final :
     public repeating_timer_callback_t {
 public:
     explicit alt_cache_balancer_t(
-        clone_ptr_t<watchable_t<uint64_t> > _total_cache_size_watchable);
+        clone_ptr_t<watchable_t<uint64_t> > _total_cache_size_watchable,
+        eviction_policy_t _eviction_policy = eviction_policy_t::scan_resistant,
+        double _compressed_tier_fraction = 0);
     ~alt_cache_balancer_t();
 
     uint64_t base_mem_per_store() const final {
@@ -101,6 +135,18 @@ public:
         return true;
     }
 
+    eviction_policy_t eviction_policy() const final {
+        return eviction_policy_;
+    }
+
+    double compressed_tier_fraction() const final {
+        return compressed_tier_fraction_;
+    }
+
+    // All the caches on a thread share one eviction domain, so in between
+    // rebalances, the busy ones can use the memory the others don't need.
+    alt::eviction_domain_t *eviction_domain(threadnum_t thread) final;
+
     bool *notify_activity_boolean(threadnum_t thread) final;
 
     void wake_up_activity_happened() final;
@@ -113,7 +159,10 @@ private:
     static const int64_t rebalance_timeout_ms;
     static const uint64_t rebalance_check_interval_ms;
 
-    // Controls how much read ahead is allowed out of total cache size
+    // Caches stop reading ahead on their own once their read-ahead pages get evicted
+    // without being used (see `evicter_t::read_ahead_pays_off`).  Since caches
+    // can't evict their current pages while they read ahead, all of them stop
+    // anyway once they have loaded this many times the total cache size.
     static const double read_ahead_proportion;
 
     // Constants to determine when to stop read-ahead
@@ -147,6 +196,9 @@ private:
         uint64_t evictable_disk_backed_size;
         uint64_t evictable_unbacked_size;
 
+        // The part of the memory usage that the cache's quota protects
+        uint64_t reserved_size;
+
         int64_t bytes_loaded;
         uint64_t access_count;
     };
@@ -162,6 +214,8 @@ private:
                                    bool new_read_ahead_ok);
 
     clone_ptr_t<watchable_t<uint64_t> > total_cache_size_watchable;
+    const eviction_policy_t eviction_policy_;
+    const double compressed_tier_fraction_;
     scoped_ptr_t<repeating_timer_t> rebalance_timer;
     enum class rebalance_timer_state_t {
         // Normal operating condition: there is a timer, and it'll ping soon.  Can
@@ -184,6 +238,7 @@ private:
     struct per_thread_data_t {
         per_thread_data_t() : wake_up_balancer(false) { }
         std::set<alt::evicter_t *> evicters;
+        alt::eviction_domain_t eviction_domain;
         // true if the balancer should wake up (because there was activity on this
         // thread).
         bool wake_up_balancer;
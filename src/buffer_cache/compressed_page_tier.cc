@@ -0,0 +1,99 @@
+#include "buffer_cache/compressed_page_tier.hpp"
+
+#include "serializer/log/block_codec.hpp"
+
+namespace alt {
+
+// Compressing pages is on the eviction path, so we use the fastest codec we have.
+const block_codec_t COMPRESSED_PAGE_TIER_CODEC = block_codec_t::zlib;
+
+compressed_page_t::compressed_page_t(const counted_t<block_token_t> &block_token,
+                                     buf_ptr_t compressed,
+                                     block_size_t uncompressed_size)
+    : block_token_(block_token),
+      compressed_(std::move(compressed)),
+      uncompressed_size_(uncompressed_size) { }
+
+bool compressed_page_t::is_copy_of(const counted_t<block_token_t> &block_token) const {
+    // Two tokens for the same block version always have the same offset, even if
+    // the GC moves the block.
+    return has() && block_token.has()
+        && block_token_->offset() == block_token->offset();
+}
+
+buf_ptr_t compressed_page_t::decompress() const {
+    rassert(has());
+    return decompress_block(compressed_.ser_buffer(), compressed_.block_size(),
+                            uncompressed_size_);
+}
+
+uint64_t compressed_page_t::memory_usage() const {
+    return compressed_.has() ? compressed_.aligned_block_size() : 0;
+}
+
+compressed_page_tier_t::compressed_page_tier_t()
+    : memory_limit_(0), size_(0), hits_(0), misses_(0) { }
+
+compressed_page_tier_t::~compressed_page_tier_t() {
+    set_memory_limit(0);
+    guarantee(entries_.empty());
+}
+
+void compressed_page_tier_t::set_memory_limit(uint64_t memory_limit) {
+    memory_limit_ = memory_limit;
+    shrink_to_memory_limit();
+}
+
+void compressed_page_tier_t::add(block_id_t block_id,
+                                 const counted_t<block_token_t> &block_token,
+                                 const ser_buffer_t *buf,
+                                 block_size_t block_size) {
+    if (!is_enabled()) {
+        return;
+    }
+    remove(block_id);
+    buf_ptr_t compressed = compress_block(COMPRESSED_PAGE_TIER_CODEC, buf, block_size);
+    if (!compressed.has()) {
+        return;
+    }
+
+    entry_t *entry = new entry_t(block_id,
+                                 compressed_page_t(block_token, std::move(compressed),
+                                                   block_size));
+    entries_.insert(std::make_pair(block_id, entry));
+    age_order_.push_back(entry);
+    size_ += entry->memory_usage;
+    shrink_to_memory_limit();
+}
+
+compressed_page_t compressed_page_tier_t::take(block_id_t block_id) {
+    compressed_page_t ret;
+    auto it = entries_.find(block_id);
+    if (it != entries_.end()) {
+        ret = std::move(it->second->page);
+        remove_entry(it->second);
+    }
+    return ret;
+}
+
+void compressed_page_tier_t::remove(block_id_t block_id) {
+    auto it = entries_.find(block_id);
+    if (it != entries_.end()) {
+        remove_entry(it->second);
+    }
+}
+
+void compressed_page_tier_t::remove_entry(entry_t *entry) {
+    size_ -= entry->memory_usage;
+    entries_.erase(entry->block_id);
+    age_order_.remove(entry);
+    delete entry;
+}
+
+void compressed_page_tier_t::shrink_to_memory_limit() {
+    while (size_ > memory_limit_ && !age_order_.empty()) {
+        remove_entry(age_order_.head());
+    }
+}
+
+}  // namespace alt
@@ -0,0 +1,112 @@
+#ifndef BUFFER_CACHE_COMPRESSED_PAGE_TIER_HPP_
+#define BUFFER_CACHE_COMPRESSED_PAGE_TIER_HPP_
+
+#include <stdint.h>
+
+#include <unordered_map>
+
+#include "containers/counted.hpp"
+#include "containers/intrusive_list.hpp"
+#include "serializer/buf_ptr.hpp"
+#include "serializer/types.hpp"
+
+namespace alt {
+
+// A compressed copy of the contents of a block, as of some block token.
+class compressed_page_t {
+public:
+    compressed_page_t() : uncompressed_size_(block_size_t::unsafe_make(0)) { }
+    compressed_page_t(const counted_t<block_token_t> &block_token,
+                      buf_ptr_t compressed,
+                      block_size_t uncompressed_size);
+    compressed_page_t(compressed_page_t &&movee) = default;
+    compressed_page_t &operator=(compressed_page_t &&movee) = default;
+
+    bool has() const { return compressed_.has(); }
+
+    // Tells whether this is a copy of the block version `block_token` points to.
+    // This has to be called on the serializer's thread, because that's where the
+    // tokens' offsets are kept up to date.
+    bool is_copy_of(const counted_t<block_token_t> &block_token) const;
+
+    buf_ptr_t decompress() const;
+
+    uint64_t memory_usage() const;
+
+private:
+    counted_t<block_token_t> block_token_;
+    buf_ptr_t compressed_;
+    block_size_t uncompressed_size_;
+
+    DISABLE_COPYING(compressed_page_t);
+};
+
+// Keeps compressed copies of clean pages that the evicter evicts, so that loading
+// them again doesn't need a disk read.  When the tier gets full, it drops its oldest
+// copies.  A page is either loaded or in the tier, never both: loading a page takes
+// its copy out of the tier.
+class compressed_page_tier_t {
+public:
+    compressed_page_tier_t();
+    ~compressed_page_tier_t();
+
+    // A memory limit of zero disables the tier.
+    void set_memory_limit(uint64_t memory_limit);
+    bool is_enabled() const { return memory_limit_ > 0; }
+
+    // How much memory the compressed copies use.
+    uint64_t size() const { return size_; }
+
+    // Keeps a compressed copy of the block, if it compresses well enough, replacing
+    // any older copy.
+    void add(block_id_t block_id,
+             const counted_t<block_token_t> &block_token,
+             const ser_buffer_t *buf,
+             block_size_t block_size);
+
+    // Takes the copy of the block out of the tier.  Returns an empty
+    // compressed_page_t if there is none.
+    compressed_page_t take(block_id_t block_id);
+
+    // Drops the copy of the block, because the block is getting modified.
+    void remove(block_id_t block_id);
+
+    // Tells the tier whether a load of a block was served from it.
+    void note_load(bool hit) {
+        if (is_enabled()) {
+            ++(hit ? hits_ : misses_);
+        }
+    }
+    uint64_t hits() const { return hits_; }
+    uint64_t misses() const { return misses_; }
+
+private:
+    struct entry_t : public intrusive_list_node_t<entry_t> {
+        entry_t(block_id_t _block_id, compressed_page_t &&_page)
+            : block_id(_block_id),
+              memory_usage(sizeof(entry_t) + _page.memory_usage()),
+              page(std::move(_page)) { }
+        const block_id_t block_id;
+        // How much memory the entry uses (as long as `page` hasn't been taken).
+        const uint64_t memory_usage;
+        compressed_page_t page;
+    };
+
+    void remove_entry(entry_t *entry);
+    void shrink_to_memory_limit();
+
+    uint64_t memory_limit_;
+    uint64_t size_;
+    uint64_t hits_;
+    uint64_t misses_;
+
+    std::unordered_map<block_id_t, entry_t *> entries_;
+    // The oldest copies come first.
+    intrusive_list_t<entry_t> age_order_;
+
+    DISABLE_COPYING(compressed_page_tier_t);
+};
+
+}  // namespace alt
+
+#endif  // BUFFER_CACHE_COMPRESSED_PAGE_TIER_HPP_
@@ -1,22 +1,43 @@
 #include "buffer_cache/evicter.hpp"
 
+#include <algorithm>
+
 #include "arch/runtime/coroutines.hpp"
 #include "buffer_cache/alt.hpp"
 #include "buffer_cache/page.hpp"
 #include "buffer_cache/page_cache.hpp"
 #include "buffer_cache/cache_balancer.hpp"
+#include "buffer_cache/eviction_domain.hpp"
 
 namespace alt {
 
+// With the scan-resistant policy, pages that have been accessed only once are
+// evicted before the others once they take up more than this fraction of the memory
+// limit.
+const uint64_t ONCE_ACCESSED_MEMORY_DIVISOR = 4;
+
+// We don't stop read-ahead before it has wasted this many pages, so that a few
+// unlucky evictions early on don't turn it off.
+const uint64_t READ_AHEAD_MIN_WASTED_PAGES = 64;
+
 evicter_t::evicter_t()
     : initialized_(false),
       page_cache_(nullptr),
       balancer_(nullptr),
       balancer_notify_activity_boolean_(nullptr),
+      policy_(eviction_policy_t::access_time),
+      compressed_tier_fraction_(0),
+      domain_(nullptr),
       throttler_(nullptr),
+      quota_{0, false},
       bytes_loaded_counter_(0),
       access_count_counter_(0),
-      access_time_counter_(INITIAL_ACCESS_TIME),
+      read_ahead_useful_pages_(0),
+      read_ahead_wasted_pages_(0),
+      page_hits_(0),
+      page_misses_(0),
+      access_time_counter_(&own_access_time_counter_),
+      own_access_time_counter_(INITIAL_ACCESS_TIME),
       evict_if_necessary_active_(false),
       last_force_flush_time_(ticks_t{0}) { }
 
@@ -24,6 +45,9 @@ evicter_t::~evicter_t() {
     assert_thread();
     drainer_.drain();
     if (initialized_) {
+        if (domain_ != nullptr) {
+            domain_->remove_evicter(this);
+        }
         balancer_->remove_evicter(this);
     }
     guarantee(!evict_if_necessary_active_);
@@ -40,6 +64,14 @@ void evicter_t::initialize(page_cache_t *page_cache,
     page_cache_ = page_cache;
     throttler_ = throttler;
     balancer_ = balancer;
+    policy_ = balancer_->eviction_policy();
+    compressed_tier_fraction_ = balancer_->compressed_tier_fraction();
+    compressed_tier_.set_memory_limit(memory_limit_ * compressed_tier_fraction_);
+    domain_ = balancer_->eviction_domain(get_thread_id());
+    if (domain_ != nullptr) {
+        access_time_counter_ = domain_->access_time_counter();
+        domain_->add_evicter(this);
+    }
     balancer_notify_activity_boolean_
         = balancer_->notify_activity_boolean(get_thread_id());
     balancer_->add_evicter(this);
@@ -53,19 +85,28 @@ void evicter_t::update_memory_limit(uint64_t new_memory_limit,
                                     bool read_ahead_ok) {
     guarantee_initialized();
 
-    if (!read_ahead_ok) {
+    // Read-ahead can't start again once it has stopped, because the page cache
+    // starts evicting current pages then.
+    if (!read_ahead_ok || !read_ahead_pays_off()) {
         page_cache_->have_read_ahead_cb_destroyed();
     }
 
     bytes_loaded_counter_ -= bytes_loaded_accounted_for;
     access_count_counter_ -= access_count_accounted_for;
     memory_limit_ = new_memory_limit;
+    compressed_tier_.set_memory_limit(memory_limit_ * compressed_tier_fraction_);
     evict_if_necessary();
 
     throttler_->inform_memory_limit_change(memory_limit_,
                                            page_cache_->max_block_size());
 }
 
+bool evicter_t::read_ahead_pays_off() const {
+    // Read-ahead pages that are still in the cache unused don't count either way.
+    return read_ahead_wasted_pages_ < READ_AHEAD_MIN_WASTED_PAGES
+        || read_ahead_wasted_pages_ <= read_ahead_useful_pages_;
+}
+
 void wake_up_balancer(cache_balancer_t *balancer,
                       UNUSED auto_drainer_t::lock_t drainer_lock) {
     on_thread_t th(balancer->home_thread());
@@ -127,7 +168,11 @@ void evicter_t::add_to_evictable_unbacked(page_t *page) {
 
 void evicter_t::add_to_evictable_disk_backed(page_t *page) {
     guarantee_initialized();
-    evictable_disk_backed_.add(page, page->hypothetical_memory_usage(page_cache_));
+    eviction_bag_t *bag = correct_eviction_category(page);
+    rassert(bag == &evictable_scanned_
+            || bag == &evictable_once_
+            || bag == &evictable_disk_backed_);
+    bag->add(page, page->hypothetical_memory_usage(page_cache_));
     evict_if_necessary();
     notify_bytes_loading(page->hypothetical_memory_usage(page_cache_));
 }
@@ -137,7 +182,9 @@ void evicter_t::move_unevictable_to_evictable(page_t *page) {
     rassert(unevictable_.has_page(page));
     unevictable_.remove(page, page->hypothetical_memory_usage(page_cache_));
     eviction_bag_t *new_bag = correct_eviction_category(page);
-    rassert(new_bag == &evictable_disk_backed_
+    rassert(new_bag == &evictable_scanned_
+            || new_bag == &evictable_once_
+            || new_bag == &evictable_disk_backed_
             || new_bag == &evictable_unbacked_);
     new_bag->add(page, page->hypothetical_memory_usage(page_cache_));
     evict_if_necessary();
@@ -160,6 +207,13 @@ eviction_bag_t *evicter_t::correct_eviction_category(page_t *page) {
     } else if (!page->is_loaded()) {
         return &evicted_;
     } else if (page->is_disk_backed()) {
+        if (policy_ == eviction_policy_t::scan_resistant) {
+            switch (page->access_count()) {
+            case 0: return &evictable_scanned_;
+            case 1: return &evictable_once_;
+            default: break;
+            }
+        }
         return &evictable_disk_backed_;
     } else {
         return &evictable_unbacked_;
@@ -176,8 +230,59 @@ void evicter_t::remove_page(page_t *page) {
 uint64_t evicter_t::in_memory_size() const {
     guarantee_initialized();
     return unevictable_.size()
-        + evictable_disk_backed_.size()
-        + evictable_unbacked_.size();
+        + evictable_disk_backed_size()
+        + evictable_unbacked_.size()
+        + compressed_tier_.size();
+}
+
+void evicter_t::set_quota(cache_quota_t quota) {
+    guarantee_initialized();
+    quota_ = quota;
+    evict_if_necessary();
+}
+
+uint64_t evicter_t::reserved_size() const {
+    guarantee_initialized();
+    const uint64_t size = in_memory_size();
+    return quota_.pinned ? size : std::min(size, quota_.reserved_size);
+}
+
+evicter_t::eviction_tier_t evicter_t::tier_to_evict_from(uint64_t scanned_size,
+                                                         uint64_t once_size,
+                                                         uint64_t hot_size,
+                                                         uint64_t memory_limit) {
+    // Pages that only scans have looked at go first.  Then come the pages that have
+    // been accessed once, if there are too many of them, so that pages only get to
+    // stay in the cache for long if they're accessed again while in evictable_once_
+    // (like in 2Q).  (With the access time policy, the other bags are empty.)
+    if (scanned_size > 0) {
+        return eviction_tier_t::scanned;
+    } else if (once_size > 0
+               && (once_size > memory_limit / ONCE_ACCESSED_MEMORY_DIVISOR
+                   || hot_size == 0)) {
+        return eviction_tier_t::once;
+    } else {
+        return eviction_tier_t::hot;
+    }
+}
+
+eviction_bag_t *evicter_t::tier_bag(eviction_tier_t tier) {
+    switch (tier) {
+    case eviction_tier_t::scanned: return &evictable_scanned_;
+    case eviction_tier_t::once: return &evictable_once_;
+    case eviction_tier_t::hot: return &evictable_disk_backed_;
+    default: unreachable();
+    }
+}
+
+void evicter_t::evict_page(eviction_bag_t *bag, page_t *page) {
+    uint32_t mem_usage = page->hypothetical_memory_usage(page_cache_);
+    bag->remove(page, mem_usage);
+    evicted_.add(page, mem_usage);
+    compressed_tier_.add(page->block_id(), page->block_token(),
+                         page->get_loaded_ser_buffer(), page->get_page_buf_size());
+    page->evict_self(page_cache_);
+    page_cache_->consider_evicting_current_page(page->block_id());
 }
 
 void evicter_t::evict_if_necessary() THROWS_NOTHING {
@@ -195,18 +300,27 @@ void evicter_t::evict_if_necessary() THROWS_NOTHING {
     // currently being written for the purpose of eviction.
 
     evict_if_necessary_active_ = true;
-    page_t *page;
-    while (in_memory_size() > memory_limit_
-           && eviction_bag_t::select_oldish(
-                &evictable_disk_backed_, access_time_counter_, &page)) {
-        uint32_t mem_usage = page->hypothetical_memory_usage(page_cache_);
-        evictable_disk_backed_.remove(page, mem_usage);
-        evicted_.add(page, mem_usage);
-        page->evict_self(page_cache_);
-        page_cache_->consider_evicting_current_page(page->block_id());
+    bool over_limit;
+    if (domain_ != nullptr) {
+        domain_->evict_if_necessary();
+        // We might be using memory that other caches in the domain don't need, which
+        // is fine.
+        over_limit = domain_->is_over_limit() && in_memory_size() > memory_limit_;
+    } else {
+        while (in_memory_size() > memory_limit_ && can_evict()) {
+            eviction_bag_t *bag = tier_bag(tier_to_evict_from(
+                    evictable_scanned_.size(), evictable_once_.size(),
+                    evictable_disk_backed_.size(), memory_limit_));
+            page_t *page;
+            if (!eviction_bag_t::select_oldish(bag, *access_time_counter_, &page)) {
+                break;
+            }
+            evict_page(bag, page);
+        }
+        over_limit = in_memory_size() > memory_limit_;
     }
 
-    if (in_memory_size() > memory_limit_) {
+    if (over_limit) {
         // This is pretty lame and hackish -- we'd like something better tuned.
         // Basically we force a fast flush once every 5 seconds if we've got many
         // unaccounted for dirty pages.
@@ -5,7 +5,9 @@
 
 #include <functional>
 
+#include "buffer_cache/compressed_page_tier.hpp"
 #include "buffer_cache/eviction_bag.hpp"
+#include "buffer_cache/types.hpp"
 #include "concurrency/auto_drainer.hpp"
 #include "concurrency/cache_line_padded.hpp"
 #include "concurrency/pubsub.hpp"
@@ -17,6 +19,7 @@ class alt_txn_throttler_t;
 
 namespace alt {
 
+class eviction_domain_t;
 class page_cache_t;
 
 class evicter_t : public home_thread_mixin_debug_only_t {
@@ -49,7 +52,7 @@ public:
 
     uint64_t next_access_time() {
         guarantee_initialized();
-        return ++access_time_counter_;
+        return ++*access_time_counter_;
     }
 
     uint64_t memory_limit() const {
@@ -66,21 +69,70 @@ public:
     }
     uint64_t evictable_disk_backed_size() const {
         guarantee_initialized();
-        return evictable_disk_backed_.size();
+        return evictable_scanned_.size()
+            + evictable_once_.size()
+            + evictable_disk_backed_.size();
     }
     uint64_t evictable_unbacked_size() const {
         guarantee_initialized();
         return evictable_unbacked_.size();
     }
 
+    compressed_page_tier_t *compressed_tier() {
+        guarantee_initialized();
+        return &compressed_tier_;
+    }
+
     int64_t get_bytes_loaded() const {
         guarantee_initialized();
         return bytes_loaded_counter_;
     }
 
+    // Called once for every page that read-ahead loaded, when the page either gets
+    // used or gets evicted without having been used.
+    void note_read_ahead_page(bool useful) {
+        guarantee_initialized();
+        ++(useful ? read_ahead_useful_pages_ : read_ahead_wasted_pages_);
+    }
+    uint64_t read_ahead_useful_pages() const {
+        guarantee_initialized();
+        return read_ahead_useful_pages_;
+    }
+    uint64_t read_ahead_wasted_pages() const {
+        guarantee_initialized();
+        return read_ahead_wasted_pages_;
+    }
+
+    // Called whenever something starts waiting for a page, with whether the page
+    // was already in memory.
+    void note_page_access(bool hit) {
+        guarantee_initialized();
+        ++(hit ? page_hits_ : page_misses_);
+    }
+    uint64_t page_hits() const {
+        guarantee_initialized();
+        return page_hits_;
+    }
+    uint64_t page_misses() const {
+        guarantee_initialized();
+        return page_misses_;
+    }
+
 
     uint64_t in_memory_size() const;
 
+    // Protects some or all of the cache's pages from eviction, see `cache_quota_t`.
+    void set_quota(cache_quota_t quota);
+
+    // How much of `in_memory_size()` the evicter won't evict.  The cache balancer
+    // doesn't give the cache a memory limit below this.
+    uint64_t reserved_size() const;
+
+    // Whether the evicter may evict a page right now.
+    bool can_evict() const {
+        return in_memory_size() > reserved_size();
+    }
+
     // This is decremented past UINT64_MAX to force code to be aware of access time
     // rollovers.
     static const uint64_t INITIAL_ACCESS_TIME = UINT64_MAX - 100;
@@ -92,30 +144,72 @@ private:
     }
 
     friend class usage_adjuster_t;
+    friend class eviction_domain_t;
 
     // Tells the cache balancer about a page being loaded
     void notify_bytes_loading(int64_t ser_buf_change);
 
-    // Evicts any evictable pages until under the memory limit
+    // Evicts any evictable pages until under the memory limit (or, if the evicter is
+    // in an eviction domain, until the domain is under its memory limit)
     void evict_if_necessary() THROWS_NOTHING;
 
+    // The disk backed evictable bags, in the order pages get evicted from them.
+    enum class eviction_tier_t { scanned, once, hot };
+
+    // Returns the tier that the next page to evict should come from, given the sizes
+    // of the tiers' bags and the memory limit of the pages in them.
+    static eviction_tier_t tier_to_evict_from(uint64_t scanned_size,
+                                              uint64_t once_size,
+                                              uint64_t hot_size,
+                                              uint64_t memory_limit);
+    eviction_bag_t *tier_bag(eviction_tier_t tier);
+
+    // Evicts the page, which has to be in `bag`, keeping a compressed copy of it if
+    // the compressed tier is enabled.
+    void evict_page(eviction_bag_t *bag, page_t *page);
+
+    // Whether the read-ahead pages have been worth the memory until now.
+    bool read_ahead_pays_off() const;
+
     bool initialized_;
     page_cache_t *page_cache_;
     cache_balancer_t *balancer_;
     bool *balancer_notify_activity_boolean_;
 
+    eviction_policy_t policy_;
+
+    // The fraction of memory_limit_ that compressed_tier_ may use.
+    double compressed_tier_fraction_;
+
+    // The balancer's eviction domain for this thread, or null if the balancer
+    // doesn't have any and the evicter evicts its pages on its own.
+    eviction_domain_t *domain_;
+
     alt_txn_throttler_t *throttler_;
 
     uint64_t memory_limit_;
 
+    cache_quota_t quota_;
+
     // These are updated every time a page is loaded, created, or destroyed, and
     // cleared when cache memory limits are re-evaluated.  This value can go
     // negative, if you keep deleting blocks or suddenly drop a snapshot.
     int64_t bytes_loaded_counter_;
     uint64_t access_count_counter_;
 
-    // This gets incremented every time a page is accessed.
-    uint64_t access_time_counter_;
+    // How many read-ahead pages got used, and how many got evicted unused.
+    uint64_t read_ahead_useful_pages_;
+    uint64_t read_ahead_wasted_pages_;
+
+    // How many page accesses found the page in memory, and how many had to wait
+    // for it to be loaded.
+    uint64_t page_hits_;
+    uint64_t page_misses_;
+
+    // This gets incremented every time a page is accessed.  It points at
+    // own_access_time_counter_, or at the domain's counter if there is a domain.
+    uint64_t *access_time_counter_;
+    uint64_t own_access_time_counter_;
 
     // This is set to true while `evict_if_necessary()` is active.
     // It avoids reentrant calls to that function.
@@ -123,10 +217,20 @@ private:
 
     // These track every page's eviction status.
     eviction_bag_t unevictable_;
+    // With the scan-resistant policy, disk backed pages that have only been accessed
+    // with low priority go into evictable_scanned_, the ones that have been accessed
+    // once go into evictable_once_, and only the others go into
+    // evictable_disk_backed_.  With the access time policy, they all go into
+    // evictable_disk_backed_.
+    eviction_bag_t evictable_scanned_;
+    eviction_bag_t evictable_once_;
     eviction_bag_t evictable_disk_backed_;
     eviction_bag_t evictable_unbacked_;
     eviction_bag_t evicted_;
 
+    // Compressed copies of evicted pages.  Its memory counts towards memory_limit_.
+    compressed_page_tier_t compressed_tier_;
+
     ticks_t last_force_flush_time_;
 
     auto_drainer_t drainer_;
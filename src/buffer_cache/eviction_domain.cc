@@ -0,0 +1,103 @@
+#include "buffer_cache/eviction_domain.hpp"
+
+#include <algorithm>
+
+#include "buffer_cache/evicter.hpp"
+#include "buffer_cache/page.hpp"
+
+namespace alt {
+
+eviction_domain_t::eviction_domain_t()
+    : access_time_counter_(evicter_t::INITIAL_ACCESS_TIME),
+      evict_if_necessary_active_(false) { }
+
+eviction_domain_t::~eviction_domain_t() {
+    guarantee(evicters_.empty());
+    guarantee(!evict_if_necessary_active_);
+}
+
+void eviction_domain_t::add_evicter(evicter_t *evicter) {
+    evicter->assert_thread();
+    rassert(std::find(evicters_.begin(), evicters_.end(), evicter) == evicters_.end());
+    evicters_.push_back(evicter);
+}
+
+void eviction_domain_t::remove_evicter(evicter_t *evicter) {
+    evicter->assert_thread();
+    auto it = std::find(evicters_.begin(), evicters_.end(), evicter);
+    guarantee(it != evicters_.end());
+    evicters_.erase(it);
+}
+
+uint64_t eviction_domain_t::in_memory_size() const {
+    uint64_t ret = 0;
+    for (evicter_t *evicter : evicters_) {
+        ret += evicter->in_memory_size();
+    }
+    return ret;
+}
+
+uint64_t eviction_domain_t::memory_limit() const {
+    uint64_t ret = 0;
+    for (evicter_t *evicter : evicters_) {
+        ret += evicter->memory_limit();
+    }
+    return ret;
+}
+
+bool eviction_domain_t::is_over_limit() const {
+    return in_memory_size() > memory_limit();
+}
+
+void eviction_domain_t::evict_if_necessary() THROWS_NOTHING {
+    if (evict_if_necessary_active_) {
+        return;
+    }
+    evict_if_necessary_active_ = true;
+
+    const uint64_t limit = memory_limit();
+    while (in_memory_size() > limit) {
+        // We pick the tier like a single evicter would, looking at all the pages in
+        // the domain, and then the oldish page of that tier among all the evicters.
+        // The evicters whose pages are protected by their quota are left out.
+        uint64_t scanned_size = 0;
+        uint64_t once_size = 0;
+        uint64_t hot_size = 0;
+        for (evicter_t *evicter : evicters_) {
+            if (!evicter->can_evict()) {
+                continue;
+            }
+            scanned_size += evicter->evictable_scanned_.size();
+            once_size += evicter->evictable_once_.size();
+            hot_size += evicter->evictable_disk_backed_.size();
+        }
+        const evicter_t::eviction_tier_t tier = evicter_t::tier_to_evict_from(
+                scanned_size, once_size, hot_size, limit);
+
+        evicter_t *victim_evicter = nullptr;
+        page_t *victim = nullptr;
+        for (evicter_t *evicter : evicters_) {
+            page_t *page;
+            if (!evicter->can_evict() || !eviction_bag_t::select_oldish(
+                    evicter->tier_bag(tier), access_time_counter_, &page)) {
+                continue;
+            }
+            // We compare relative to the access time counter, like
+            // `eviction_bag_t::select_oldish` does.
+            if (victim == nullptr
+                || access_time_counter_ - page->access_time()
+                   > access_time_counter_ - victim->access_time()) {
+                victim_evicter = evicter;
+                victim = page;
+            }
+        }
+        if (victim == nullptr) {
+            break;
+        }
+        victim_evicter->evict_page(victim_evicter->tier_bag(tier), victim);
+    }
+
+    evict_if_necessary_active_ = false;
+}
+
+}  // namespace alt
@@ -0,0 +1,56 @@
+#ifndef BUFFER_CACHE_EVICTION_DOMAIN_HPP_
+#define BUFFER_CACHE_EVICTION_DOMAIN_HPP_
+
+#include <stdint.h>
+
+#include <vector>
+
+#include "errors.hpp"
+
+namespace alt {
+
+class evicter_t;
+
+// All the evicters on a thread that share an eviction domain evict their pages as
+// if they were one cache, with a memory limit that is the sum of their memory
+// limits.  So a busy cache can use the memory an idle cache on the same thread
+// doesn't need right away, without waiting for the cache balancer to move memory
+// limits around.  The pages to evict are picked by comparing their access times,
+// which is why the evicters also share their access time counter.
+//
+// An eviction domain must only be used on one thread, and it must outlive the
+// evicters in it.
+class eviction_domain_t {
+public:
+    eviction_domain_t();
+    ~eviction_domain_t();
+
+    void add_evicter(evicter_t *evicter);
+    void remove_evicter(evicter_t *evicter);
+
+    uint64_t *access_time_counter() { return &access_time_counter_; }
+
+    // Whether the evicters use more memory than all of their memory limits together.
+    bool is_over_limit() const;
+
+    // Evicts pages from any of the evicters, until they are no longer over their
+    // memory limits together (or there is nothing left to evict).
+    void evict_if_necessary() THROWS_NOTHING;
+
+private:
+    uint64_t in_memory_size() const;
+    uint64_t memory_limit() const;
+
+    std::vector<evicter_t *> evicters_;
+
+    uint64_t access_time_counter_;
+
+    // Avoids reentrant calls to `evict_if_necessary()`, like in `evicter_t`.
+    bool evict_if_necessary_active_;
+
+    DISABLE_COPYING(eviction_domain_t);
+};
+
+}  // namespace alt
+
+#endif  // BUFFER_CACHE_EVICTION_DOMAIN_HPP_
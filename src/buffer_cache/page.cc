@@ -56,6 +56,8 @@ page_t::page_t(block_id_t _block_id, page_cache_t *page_cache)
     : block_id_(_block_id),
       loader_(nullptr),
       access_time_(page_cache->evicter().next_access_time()),
+      access_count_(0),
+      unused_read_ahead_(false),
       snapshot_refcount_(0) {
     page_cache->evicter().add_deferred_loaded(this);
 
@@ -70,6 +72,8 @@ page_t::page_t(block_id_t _block_id, page_cache_t *page_cache,
     : block_id_(_block_id),
       loader_(nullptr),
       access_time_(page_cache->evicter().next_access_time()),
+      access_count_(0),
+      unused_read_ahead_(false),
       snapshot_refcount_(0) {
     page_cache->evicter().add_not_yet_loaded(this);
 
@@ -86,6 +90,8 @@ page_t::page_t(block_id_t _block_id, buf_ptr_t buf,
       loader_(nullptr),
       buf_(std::move(buf)),
       access_time_(page_cache->evicter().next_access_time()),
+      access_count_(0),
+      unused_read_ahead_(false),
       snapshot_refcount_(0) {
     rassert(buf_.has());
     page_cache->evicter().add_to_evictable_unbacked(this);
@@ -100,6 +106,8 @@ page_t::page_t(block_id_t _block_id,
       buf_(std::move(buf)),
       block_token_(_block_token),
       access_time_(READ_AHEAD_ACCESS_TIME),
+      access_count_(0),
+      unused_read_ahead_(true),
       snapshot_refcount_(0) {
     rassert(buf_.has());
     page_cache->evicter().add_to_evictable_disk_backed(this);
@@ -109,6 +117,8 @@ page_t::page_t(page_t *copyee, page_cache_t *page_cache, cache_account_t *accoun
     : block_id_(copyee->block_id_),
       loader_(nullptr),
       access_time_(page_cache->evicter().next_access_time()),
+      access_count_(0),
+      unused_read_ahead_(false),
       snapshot_refcount_(0) {
     page_cache->evicter().add_not_yet_loaded(this);
     coro_t::spawn_now_dangerously(std::bind(&page_t::load_from_copyee,
@@ -161,6 +171,7 @@ void page_t::load_from_copyee(page_t *page, page_t *copyee,
                 page->buf_ = buf_ptr_t::alloc_copy(copyee->buf_);
                 page->loader_ = nullptr;
             }
+            copyee->note_read_ahead_use(page_cache);
 
             page->pulse_waiters_or_make_evictable(page_cache);
         }
@@ -236,6 +247,33 @@ private:
     DISABLE_COPYING(deferred_page_loader_t);
 };
 
+// Reads the block `block_token` points to, unless `compressed` is a copy of it, in
+// which case this returns an empty buf_ptr_t.  Must be called on the serializer's
+// thread.
+static buf_ptr_t read_block_unless_compressed(
+        serializer_t *serializer,
+        const counted_t<block_token_t> &block_token,
+        const compressed_page_t &compressed,
+        file_account_t *account) {
+    if (compressed.is_copy_of(block_token)) {
+        return buf_ptr_t();
+    }
+    return serializer->block_read(block_token, account);
+}
+
+// Takes what read_block_unless_compressed returned, back on the cache's thread, and
+// decompresses the compressed copy if the block wasn't read.
+static buf_ptr_t finish_read_unless_compressed(
+        page_cache_t *page_cache,
+        buf_ptr_t buf,
+        const compressed_page_t &compressed) {
+    page_cache->evicter().compressed_tier()->note_load(!buf.has());
+    if (buf.has()) {
+        return buf;
+    }
+    return compressed.decompress();
+}
+
 void page_t::catch_up_with_deferred_load(
         deferred_page_loader_t *deferred_loader,
         page_cache_t *page_cache,
@@ -261,6 +299,9 @@ void page_t::catch_up_with_deferred_load(
     // Before blocking, tell the evicter to put us in the right category.
     page_cache->evicter().catch_up_deferred_load(page);
 
+    const compressed_page_t compressed
+        = page_cache->evicter().compressed_tier()->take(page->block_id_);
+
     buf_ptr_t buf;
     {
         serializer_t *const serializer = page_cache->serializer();
@@ -271,14 +312,15 @@ void page_t::catch_up_with_deferred_load(
         on_thread_t th(serializer->home_thread());
         // Now finish what the rest of load_with_block_id would do.
         rassert(block_token_ptr->token.has());
-        buf = serializer->block_read(block_token_ptr->token,
-                                     account->get());
+        buf = read_block_unless_compressed(serializer, block_token_ptr->token,
+                                           compressed, account->get());
     }
 
     ASSERT_FINITE_CORO_WAITING;
     if (our_loader.abandon_page()) {
         return;
     }
+    buf = finish_read_unless_compressed(page_cache, std::move(buf), compressed);
 
     page_t::finish_load_with_block_id(page, page_cache,
                                       std::move(block_token_ptr->token),
@@ -346,6 +388,9 @@ void page_t::load_with_block_id(page_t *page, block_id_t block_id,
 
     auto_drainer_t::lock_t lock = page_cache->drainer_lock();
 
+    const compressed_page_t compressed
+        = page_cache->evicter().compressed_tier()->take(block_id);
+
     buf_ptr_t buf;
     counted_t<block_token_t> block_token;
 
@@ -354,14 +399,15 @@ void page_t::load_with_block_id(page_t *page, block_id_t block_id,
         on_thread_t th(serializer->home_thread());
         block_token = serializer->index_read(block_id);
         rassert(block_token.has());
-        buf = serializer->block_read(block_token,
-                                     account->get());
+        buf = read_block_unless_compressed(serializer, block_token, compressed,
+                                           account->get());
     }
 
     ASSERT_FINITE_CORO_WAITING;
     if (loader.abandon_page()) {
         return;
     }
+    buf = finish_read_unless_compressed(page_cache, std::move(buf), compressed);
 
     page_t::finish_load_with_block_id(page, page_cache,
                                       std::move(block_token),
@@ -415,6 +461,7 @@ void page_t::add_waiter(page_acq_t *acq, cache_account_t *account) {
         = acq->page_cache()->evicter().correct_eviction_category(this);
     waiters_.push_front(acq);
     acq->page_cache()->evicter().change_to_correct_eviction_bag(old_bag, this);
+    acq->page_cache()->evicter().note_page_access(buf_.has());
     if (buf_.has()) {
         acq->buf_ready_signal_.pulse();
     } else if (loader_ != nullptr) {
@@ -445,19 +492,23 @@ void page_t::load_using_block_token(page_t *page, page_cache_t *page_cache,
     counted_t<block_token_t> block_token = page->block_token_;
     rassert(block_token.has());
 
+    const compressed_page_t compressed
+        = page_cache->evicter().compressed_tier()->take(page->block_id_);
+
     buf_ptr_t buf;
     {
         serializer_t *const serializer = page_cache->serializer();
 
         on_thread_t th(serializer->home_thread());
-        buf = serializer->block_read(block_token,
-                                     account->get());
+        buf = read_block_unless_compressed(serializer, block_token, compressed,
+                                           account->get());
     }
 
     ASSERT_FINITE_CORO_WAITING;
     if (loader.abandon_page()) {
         return;
     }
+    buf = finish_read_unless_compressed(page_cache, std::move(buf), compressed);
 
     rassert(page->block_token_.get() == block_token.get());
     rassert(!page->buf_.has());
@@ -515,12 +566,25 @@ uint32_t page_t::hypothetical_memory_usage(page_cache_t *page_cache) const {
     }
 }
 
-void *page_t::get_page_buf(page_cache_t *page_cache) {
+void *page_t::get_page_buf(page_cache_t *page_cache,
+                           page_access_priority_t priority) {
     rassert(buf_.has());
     access_time_ = page_cache->evicter().next_access_time();
+    if (priority == page_access_priority_t::normal
+        && access_count_ < MAX_ACCESS_COUNT) {
+        ++access_count_;
+    }
+    note_read_ahead_use(page_cache);
     return buf_.cache_data();
 }
 
+void page_t::note_read_ahead_use(page_cache_t *page_cache) {
+    if (unused_read_ahead_) {
+        unused_read_ahead_ = false;
+        page_cache->evicter().note_read_ahead_page(true);
+    }
+}
+
 void page_t::reset_block_token(DEBUG_VAR page_cache_t *page_cache) {
     // The page is supposed to have its buffer acquired in reset_block_token -- it's
     // the thing modifying the page.  We thus assume that the page is unevictable and
@@ -550,12 +614,16 @@ void page_t::remove_waiter(page_acq_t *acq) {
     rassert(snapshot_refcount_ > 0);
 }
 
-void page_t::evict_self(DEBUG_VAR page_cache_t *page_cache) {
+void page_t::evict_self(page_cache_t *page_cache) {
     // A page_t can only self-evict if it has a block token (for now).
     rassert(waiters_.empty());
     rassert(block_token_.has());
     rassert(buf_.has());
     rassert(block_token_->block_size() == buf_.block_size());
+    if (unused_read_ahead_) {
+        unused_read_ahead_ = false;
+        page_cache->evicter().note_read_ahead_page(false);
+    }
 #ifndef NDEBUG
     const uint32_t usage_before = hypothetical_memory_usage(page_cache);
 #endif
@@ -621,12 +689,12 @@ void *page_acq_t::get_buf_write(block_size_t block_size) {
     buf_ready_signal_.wait();
     page_->reset_block_token(page_cache_);
     page_->set_page_buf_size(block_size, page_cache_);
-    return page_->get_page_buf(page_cache_);
+    return page_->get_page_buf(page_cache_, page_access_priority_t::normal);
 }
 
-const void *page_acq_t::get_buf_read() {
+const void *page_acq_t::get_buf_read(page_access_priority_t priority) {
     buf_ready_signal_.wait();
-    return page_->get_page_buf(page_cache_);
+    return page_->get_page_buf(page_cache_, priority);
 }
 
 void page_ptr_t::init(page_t *page) {
@@ -1,6 +1,7 @@
 #ifndef BUFFER_CACHE_PAGE_HPP_
 #define BUFFER_CACHE_PAGE_HPP_
 
+#include "buffer_cache/types.hpp"
 #include "concurrency/cond_var.hpp"
 #include "containers/backindex_bag.hpp"
 #include "containers/half_intrusive_list.hpp"
@@ -43,7 +44,7 @@ public:
     void remove_waiter(page_acq_t *acq);
 
     // These may not be called until the page_acq_t's buf_ready_signal is pulsed.
-    void *get_page_buf(page_cache_t *page_cache);
+    void *get_page_buf(page_cache_t *page_cache, page_access_priority_t priority);
     void reset_block_token(page_cache_t *page_cache);
     void set_page_buf_size(block_size_t block_size, page_cache_t *page_cache);
 
@@ -55,6 +56,12 @@ public:
 
     uint32_t hypothetical_memory_usage(page_cache_t *page_cache) const;
     uint64_t access_time() const { return access_time_; }
+    // How many times (up to MAX_ACCESS_COUNT) the page has been accessed with normal
+    // priority.
+    uint8_t access_count() const { return access_count_; }
+    static const uint8_t MAX_ACCESS_COUNT = 2;
+    // Whether the page came from read-ahead and nobody has used it yet.
+    bool is_unused_read_ahead() const { return unused_read_ahead_; }
 
     bool is_loading() const {
         return loader_ != nullptr && page_t::loader_is_loading(loader_);
@@ -91,6 +98,9 @@ private:
 
     void pulse_waiters_or_make_evictable(page_cache_t *page_cache);
 
+    // Tells the evicter that read-ahead loaded this page for a reason.
+    void note_read_ahead_use(page_cache_t *page_cache);
+
 
     static void finish_load_with_block_id(page_t *page, page_cache_t *page_cache,
                                           counted_t<block_token_t> block_token,
@@ -131,6 +141,8 @@ private:
     counted_t<block_token_t> block_token_;
 
     uint64_t access_time_;
+    uint8_t access_count_;
+    bool unused_read_ahead_;
 
     // How many page_ptr_t's point at this page, expecting nothing to modify it,
     // other than themselves.
@@ -146,7 +158,9 @@ private:
     // if loader_ is non-null:  unevictable_
     // else if waiters_ is non-empty: unevictable_
     // else if buf_ is null: evicted_ (and block_token_ is non-null)
-    // else if block_token_ is non-null: evictable_disk_backed_
+    // else if block_token_ is non-null: evictable_disk_backed_ (or, with the
+    //     scan-resistant eviction policy, evictable_scanned_ or evictable_once_,
+    //     depending on access_count_)
     // else: evictable_unbacked_ (buf_ is non-null, block_token_ is null)
     //
     // So, when loader_, waiters_, buf_, or block_token_ is touched, we might
@@ -275,7 +289,8 @@ public:
     // These block, uninterruptibly waiting for buf_ready_signal() to be pulsed.
     block_size_t get_buf_size();
     void *get_buf_write(block_size_t block_size);
-    const void *get_buf_read();
+    const void *get_buf_read(
+            page_access_priority_t priority = page_access_priority_t::normal);
 
 private:
     friend class page_t;
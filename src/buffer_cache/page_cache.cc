@@ -163,6 +163,8 @@ void page_cache_t::add_read_ahead_buf(block_id_t block_id,
                                       scoped_device_block_aligned_ptr_t<ser_buffer_t> ptr,
                                       const counted_t<block_token_t> &token) {
     assert_thread();
+    // This gives the buffer back to the buffer pool if we drop it.
+    buf_ptr_t buf(token->block_size(), std::move(ptr));
 
     // We MUST stop if read_ahead_cb_ is NULL because that means current_page_t's
     // could start being destroyed.
@@ -182,7 +184,6 @@ void page_cache_t::add_read_ahead_buf(block_id_t block_id,
     // modified (not to mention that we've already got the page in memory, so there is
     // no useful work to be done).
 
-    buf_ptr_t buf(token->block_size(), std::move(ptr));
     current_pages_[block_id] = new current_page_t(block_id, std::move(buf), token, this);
 }
 
@@ -244,6 +245,12 @@ page_cache_t::page_cache_t(serializer_t *_serializer,
                            cache_balancer_t *balancer,
                            alt_txn_throttler_t *throttler)
     : max_block_size_(_serializer->max_block_size()),
+      num_active_asap_false_flushes_(0),
+      num_active_flushes_(0),
+      pending_flush_asap_(false),
+      pending_flush_soft_deadline_(ticks_t{0}),
+      gathering_flush_(nullptr),
+      gathering_flush_asap_(false),
       serializer_(_serializer),
       // Start the counter at 1 so we can distinguish empty values.
       next_block_version_(block_version_t().subsequent()),
@@ -263,8 +270,10 @@ page_cache_t::page_cache_t(serializer_t *_serializer,
         if (start_read_ahead) {
             local_read_ahead_cb = new page_read_ahead_cb_t(_serializer, this);
         }
-        default_reads_account_.init(_serializer->home_thread(),
-                                    _serializer->make_io_account(CACHE_READS_IO_PRIORITY));
+        default_reads_account_.init(
+            _serializer->home_thread(),
+            _serializer->make_io_account(CACHE_READS_IO_PRIORITY,
+                                         io_caller_t::cache_read));
         index_write_sink_.init(new page_cache_index_write_sink_t);
         recencies_ = _serializer->get_all_recencies();
     }
@@ -389,6 +398,103 @@ current_page_t *page_cache_t::page_for_block_id(block_id_t block_id) {
     return page_it->second;
 }
 
+void page_cache_t::prefetch_blocks(const std::vector<block_id_t> &block_ids,
+                                   cache_account_t *account) {
+    assert_thread();
+    for (block_id_t block_id : block_ids) {
+        current_page_t *current_page;
+        auto page_it = current_pages_.find(block_id);
+        if (page_it == current_pages_.end()) {
+            // The caller might have found the block id in a snapshotted parent, so the
+            // block could have been deleted since.
+            if (!is_aux_block_id(block_id)
+                && recency_for_block_id(block_id) == repli_timestamp_t::invalid) {
+                continue;
+            }
+            current_page = page_for_block_id(block_id);
+        } else {
+            current_page = page_it->second;
+            if (current_page->is_deleted() || current_page->page_.has()) {
+                continue;
+            }
+        }
+        current_page->convert_from_serializer_if_necessary(
+            current_page_help_t(block_id, this), account);
+    }
+}
+
+const void *page_cache_t::peek_clean_page(block_id_t block_id) {
+    assert_thread();
+    ASSERT_NO_CORO_WAITING;
+    auto page_it = current_pages_.find(block_id);
+    if (page_it == current_pages_.end()) {
+        return nullptr;
+    }
+    current_page_t *current_page = page_it->second;
+    if (current_page->is_deleted() || !current_page->page_.has()
+        || current_page->has_write_acquirer()) {
+        return nullptr;
+    }
+    page_t *page = current_page->page_.get_page_for_read();
+    if (!page->is_loaded()) {
+        return nullptr;
+    }
+    // Accessing the page can change its eviction bag.
+    eviction_bag_t *old_bag = evicter_.correct_eviction_category(page);
+    const void *buf = page->get_page_buf(this, page_access_priority_t::normal);
+    evicter_.change_to_correct_eviction_bag(old_bag, page);
+    return buf;
+}
+
+void page_cache_t::load_blocks(const std::vector<block_id_t> &block_ids,
+                               cache_account_t *account) {
+    assert_thread();
+    prefetch_blocks(block_ids, account);
+    for (block_id_t block_id : block_ids) {
+        auto page_it = current_pages_.find(block_id);
+        if (page_it == current_pages_.end() || !page_it->second->page_.has()) {
+            continue;
+        }
+        // The page_acq_t has to be bounded by the lifetime of a page_ptr_t of our own,
+        // because the current_page_t might move on to a new page while we wait.
+        page_ptr_t page_ptr(page_it->second->page_.get_page_for_read());
+        {
+            page_acq_t acq;
+            acq.init(page_ptr.get_page_for_read(), this, account);
+            acq.buf_ready_signal()->wait();
+        }
+        page_ptr.reset_page_ptr(this);
+        consider_evicting_current_page(block_id);
+    }
+}
+
+std::vector<block_id_t> page_cache_t::resident_block_ids() const {
+    assert_thread();
+    std::vector<std::pair<uint64_t, block_id_t> > resident;
+    for (const auto &pair : current_pages_) {
+        if (is_aux_block_id(pair.first) || !pair.second->page_.has()) {
+            continue;
+        }
+        const page_t *page = pair.second->page_.get_page_for_read();
+        if (page->is_loaded()) {
+            resident.push_back(std::make_pair(page->access_time(), pair.first));
+        }
+    }
+    // Access times roll over past UINT64_MAX shortly after the start, so we compare
+    // them by their difference rather than by their values.
+    std::sort(resident.begin(), resident.end(),
+              [](const std::pair<uint64_t, block_id_t> &a,
+                 const std::pair<uint64_t, block_id_t> &b) {
+                  return static_cast<int64_t>(a.first - b.first) > 0;
+              });
+    std::vector<block_id_t> ret;
+    ret.reserve(resident.size());
+    for (const auto &pair : resident) {
+        ret.push_back(pair.second);
+    }
+    return ret;
+}
+
 current_page_t *page_cache_t::page_for_new_block_id(
         block_type_t block_type,
         block_id_t *block_id_out) {
@@ -459,6 +565,7 @@ cache_account_t page_cache_t::create_cache_account(int priority) {
         // what the file account API is right now, deep in the I/O layer.
         on_thread_t thread_switcher(serializer_->home_thread());
         io_account = serializer_->make_io_account(io_priority,
+                                                  io_caller_t::cache_read,
                                                   outstanding_requests_limit);
     }
 
@@ -849,6 +956,17 @@ bool current_page_t::should_be_evicted() const {
     return true;
 }
 
+bool current_page_t::has_write_acquirer() const {
+    for (current_page_acq_t *acq = acquirers_.head();
+         acq != nullptr;
+         acq = acquirers_.next(acq)) {
+        if (acq->access_ == access_t::write) {
+            return true;
+        }
+    }
+    return false;
+}
+
 void current_page_t::add_acquirer(current_page_acq_t *acq) {
     const block_version_t prev_version = last_write_acquirer_version_;
 
@@ -1016,6 +1134,8 @@ page_t *current_page_t::the_page_for_read_or_deleted(current_page_help_t help) {
 page_t *current_page_t::the_page_for_write(current_page_help_t help,
                                            cache_account_t *account) {
     guarantee(!is_deleted_);
+    // Any compressed copy of the block is about to be out of date.
+    help.page_cache->evicter().compressed_tier()->remove(help.block_id);
     convert_from_serializer_if_necessary(help, account);
     return page_.get_page_for_write(help.page_cache, account);
 }
@@ -1364,11 +1484,12 @@ page_cache_t::compute_changes(page_cache_t *page_cache,
         std::move(first->drainer_lock_),
         std::move(first->throttler_acq_),
         std::move(first->changes_),
-        std::move(first->flush_complete_waiters_)
+        std::move(first->flush_complete_waiters_),
+        first->dirty_changes_pages_
     };
 
     // We merge out the throttler_acq's of the txn's.
-    int64_t dirty_changes_pages = first->dirty_changes_pages_;
+    int64_t &dirty_changes_pages = ret.dirty_changes_pages;
 
     for (auto it = txns.begin() + 1; it != txns.end(); ++it) {
         page_txn_t *txn = it->get();
@@ -1549,7 +1670,8 @@ flush_prep_t page_cache_t::prep_flush_changes(
                     prep.write_infos.emplace_back(
                         page->get_loaded_ser_buffer(),
                         page->get_page_buf_size(),
-                        it->first);
+                        it->first,
+                        it->second.tstamp);
                     prep.ancillary_infos.emplace_back(it->second.tstamp);
                     // The account doesn't matter because the page is already
                     // loaded.
@@ -1840,24 +1962,61 @@ void page_cache_t::do_flush_txn_set(
     // set of changes we're actually doing is, since any transaction may have touched
     // the same blocks.
 
-    collapsed_txns_t coltx = std::move(*coltx_ptr);
+    scoped_ptr_t<collapsed_txns_t> coltx(new collapsed_txns_t(std::move(*coltx_ptr)));
+
+    ++page_cache->num_active_flushes_;
 
-    rassert(!coltx.changes.empty());
+    for (;;) {
+        rassert(!coltx->changes.empty());
 
-    fifo_enforcer_write_token_t index_write_token
-        = page_cache->index_write_source_.enter_write();
+        fifo_enforcer_write_token_t index_write_token
+            = page_cache->index_write_source_.enter_write();
 
-    page_cache->num_active_asap_false_flushes_ += (asap ? 0 : 1);
+        page_cache->num_active_asap_false_flushes_ += (asap ? 0 : 1);
 
-    // Okay, yield, thank you.
-    coro_t::yield();
+        // Okay, yield, thank you.  Until we're back, flush sets that become ready get
+        // merged into ours.
+        page_cache->gathering_flush_ = coltx.get();
+        page_cache->gathering_flush_asap_ = asap;
+        coro_t::yield();
+        if (page_cache->gathering_flush_ == coltx.get()) {
+            page_cache->gathering_flush_ = nullptr;
+        }
+
+        do_flush_changes(page_cache, coltx.get(), index_write_token, asap,
+                         soft_deadline);
+
+        page_cache->num_active_asap_false_flushes_ -= (asap ? 0 : 1);
+
+        // Flush complete.
+        page_cache_t::pulse_flush_complete(std::move(*coltx));
 
-    do_flush_changes(page_cache, &coltx, index_write_token, asap, soft_deadline);
+        // The flush sets that became ready in the meantime go next, all at once.
+        if (!page_cache->pending_flush_.has()) {
+            break;
+        }
+        coltx = std::move(page_cache->pending_flush_);
+        asap = page_cache->pending_flush_asap_;
+        soft_deadline = page_cache->pending_flush_soft_deadline_;
+    }
 
-    page_cache->num_active_asap_false_flushes_ -= (asap ? 0 : 1);
+    // `coltx` still holds a drainer lock, so the page cache is still there.
+    --page_cache->num_active_flushes_;
+}
 
-    // Flush complete.
-    page_cache_t::pulse_flush_complete(std::move(coltx));
+void page_cache_t::merge_collapsed_txns(page_cache_t *page_cache,
+                                        collapsed_txns_t *onto,
+                                        collapsed_txns_t &&from) {
+    ASSERT_NO_CORO_WAITING;
+    onto->acq.merge(std::move(from.acq));
+    // Like in `compute_changes`, pages that both sets changed only count once.
+    int64_t net_dirty
+        = page_cache_t::merge_changes(page_cache, &onto->changes,
+                                      std::move(from.changes));
+    onto->dirty_changes_pages += from.dirty_changes_pages + net_dirty;
+    from.dirty_changes_pages = 0;
+    onto->acq.update_dirty_page_count(onto->dirty_changes_pages);
+    onto->flush_complete_waiters.append_and_clear(&from.flush_complete_waiters);
 }
 
 std::vector<scoped_ptr_t<page_txn_t>>
@@ -1985,15 +2144,49 @@ void page_cache_t::spawn_flush_flushables(
     collapsed_txns_t coltx
         = page_cache_t::compute_changes(this, std::move(flush_set));
 
-    if (!coltx.changes.empty()) {
+    if (coltx.changes.empty()) {
+        // Flush complete.  do_flush_txn_set does this in the write case.
+        page_cache_t::pulse_flush_complete(std::move(coltx));
+    } else if (gathering_flush_ != nullptr && !pending_flush_.has()
+               && (gathering_flush_asap_ || !asap)) {
+        // The gathering flush is the most recently spawned one, so it's fine for these
+        // txn's to be written with it.  (A hard durability flush set doesn't join a
+        // soft one, which could be smeared over a long time.)  Once there's a pending
+        // flush, that one gets written after it, so later sets can't join it anymore.
+        page_cache_t::merge_collapsed_txns(this, gathering_flush_, std::move(coltx));
+    } else if (num_active_flushes_ < PAGE_CACHE_MAX_ACTIVE_FLUSHES
+               || (asap && num_active_asap_false_flushes_ > 0)) {
+        // An asap flush always starts right away, so that it can tell the smeared
+        // soft durability flushes ahead of it to hurry up.  The pending flush is
+        // older than these txn's, so it has to be written first: it goes along with
+        // them, since a flush that starts later takes a later index write token.
+        collapsed_txns_t *to_flush = &coltx;
+        scoped_ptr_t<collapsed_txns_t> pending;
+        if (pending_flush_.has()) {
+            page_cache_t::merge_collapsed_txns(this, pending_flush_.get(),
+                                               std::move(coltx));
+            pending = std::move(pending_flush_);
+            to_flush = pending.get();
+            soft_deadline.nanos
+                = std::min(pending_flush_soft_deadline_.nanos, soft_deadline.nanos);
+        }
         coro_t::spawn_now_dangerously(std::bind(&page_cache_t::do_flush_txn_set,
                                                 this,
-                                                &coltx,
+                                                to_flush,
                                                 asap,
                                                 soft_deadline));
+    } else if (!pending_flush_.has()) {
+        // Later flush sets may depend on these txn's, so they can't join a flush that
+        // gets written before this one anymore.
+        gathering_flush_ = nullptr;
+        pending_flush_.init(new collapsed_txns_t(std::move(coltx)));
+        pending_flush_asap_ = asap;
+        pending_flush_soft_deadline_ = soft_deadline;
     } else {
-        // Flush complete.  do_flush_txn_set does this in the write case.
-        page_cache_t::pulse_flush_complete(std::move(coltx));
+        page_cache_t::merge_collapsed_txns(this, pending_flush_.get(), std::move(coltx));
+        pending_flush_asap_ |= asap;
+        pending_flush_soft_deadline_.nanos
+            = std::min(pending_flush_soft_deadline_.nanos, soft_deadline.nanos);
     }
 }
 
@@ -145,6 +145,9 @@ private:
 
     bool is_deleted() const { return is_deleted_; }
 
+    // Returns true if a write acquirer holds the page or waits for it.
+    bool has_write_acquirer() const;
+
     // KSI: We could get rid of this variable if
     // page_txn_t::pages_write_acquired_last_ noted each page's block_id_t.  Other
     // space reductions are more important.
@@ -459,6 +462,27 @@ public:
         block_id_t *block_id_out);
     current_page_t *page_for_new_chosen_block_id(block_id_t block_id);
 
+    // Starts loading the blocks that aren't in memory yet, without acquiring them.
+    // Used by traversals to read ahead the blocks they're about to acquire, in key
+    // order rather than in the order the blocks happen to be in on disk.
+    void prefetch_blocks(const std::vector<block_id_t> &block_ids,
+                         cache_account_t *account);
+
+    // Returns the buf of the block if it's loaded and no write acquirer holds it or
+    // waits for it, so that it can be read right away without acquiring it.  Returns
+    // null otherwise.  The buf may change or go away as soon as the caller yields,
+    // and it's up to the caller to make sure no writer could have acquired the block
+    // after it decided to read it.
+    const void *peek_clean_page(block_id_t block_id);
+
+    // Like prefetch_blocks, but waits until the blocks have been loaded.
+    void load_blocks(const std::vector<block_id_t> &block_ids,
+                     cache_account_t *account);
+
+    // Returns the ids of the (non-aux) blocks that are loaded in memory, the most
+    // recently accessed ones first.
+    std::vector<block_id_t> resident_block_ids() const;
+
     // Returns how much memory is being used by all the pages in the cache at this
     // moment in time.
     size_t total_page_memory() const;
@@ -506,6 +530,8 @@ private:
         throttler_acq_t acq;
         std::unordered_map<block_id_t, block_change_t> changes;
         intrusive_list_t<page_txn_complete_cb_t> flush_complete_waiters;
+        // How many of `changes` have a page, which `acq` is kept up to date with.
+        int64_t dirty_changes_pages;
     };
 
     friend class page_txn_t;
@@ -532,6 +558,12 @@ private:
 
     static void pulse_flush_complete(collapsed_txns_t &&txns);
 
+    // Merges the changes of `from`, which became ready to flush after `onto`, into
+    // `onto`, so that they get written in the same index write.
+    static void merge_collapsed_txns(page_cache_t *page_cache,
+                                     collapsed_txns_t *onto,
+                                     collapsed_txns_t &&from);
+
     // We only pass the cache to reset the page ptr.
     static collapsed_txns_t
     compute_changes(page_cache_t *page_cache,
@@ -610,7 +642,24 @@ private:
     // than an ongoing write, the ongoing write becomes "asap" too.)
     state_timestamp_t ser_thread_max_asap_write_token_timestamp_;
     // Number of flushes started, not yet completed, that are asap=false.
-    bool num_active_asap_false_flushes_;
+    int64_t num_active_asap_false_flushes_;
+    // Number of flushes started, not yet completed.
+    int64_t num_active_flushes_;
+
+    // Flush sets that became ready while PAGE_CACHE_MAX_ACTIVE_FLUSHES flushes were
+    // running, collapsed into one flush that starts as soon as one of them is done.
+    // So the more time the device takes for a flush, the more txn's we write with
+    // one index write.  Empty if there are no such flush sets.
+    scoped_ptr_t<collapsed_txns_t> pending_flush_;
+    bool pending_flush_asap_;
+    ticks_t pending_flush_soft_deadline_;
+
+    // The most recently spawned flush, while it yields before writing anything.  Flush
+    // sets that become ready meanwhile join it instead of starting a flush of their
+    // own, so hard durability txn's committed by concurrent writes share one index
+    // write and one metablock sync.  Null if there's no such flush.
+    collapsed_txns_t *gathering_flush_;
+    bool gathering_flush_asap_;
 
     scoped_ptr_t<page_cache_index_write_sink_t> index_write_sink_;
 
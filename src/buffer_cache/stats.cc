@@ -8,13 +8,48 @@ alt_cache_stats_t::alt_cache_stats_t(alt::page_cache_t *_page_cache,
     page_cache(_page_cache),
     cache_collection(),
     cache_membership(parent, &cache_collection, "cache"),
-    in_use_bytes(this),
+    in_use_bytes(this, [](alt::evicter_t *evicter) {
+        return evicter->in_memory_size();
+    }),
     in_use_bytes_membership(&cache_collection,
                             &in_use_bytes, "in_use_bytes"),
+    compressed_tier_hits(this, [](alt::evicter_t *evicter) {
+        return evicter->compressed_tier()->hits();
+    }),
+    compressed_tier_hits_membership(&cache_collection,
+                                    &compressed_tier_hits, "compressed_tier_hits"),
+    compressed_tier_misses(this, [](alt::evicter_t *evicter) {
+        return evicter->compressed_tier()->misses();
+    }),
+    compressed_tier_misses_membership(&cache_collection,
+                                      &compressed_tier_misses,
+                                      "compressed_tier_misses"),
+    read_ahead_useful_pages(this, [](alt::evicter_t *evicter) {
+        return evicter->read_ahead_useful_pages();
+    }),
+    read_ahead_useful_pages_membership(&cache_collection,
+                                       &read_ahead_useful_pages,
+                                       "read_ahead_useful_pages"),
+    read_ahead_wasted_pages(this, [](alt::evicter_t *evicter) {
+        return evicter->read_ahead_wasted_pages();
+    }),
+    read_ahead_wasted_pages_membership(&cache_collection,
+                                       &read_ahead_wasted_pages,
+                                       "read_ahead_wasted_pages"),
+    page_hits(this, [](alt::evicter_t *evicter) {
+        return evicter->page_hits();
+    }),
+    page_hits_membership(&cache_collection, &page_hits, "page_hits"),
+    page_misses(this, [](alt::evicter_t *evicter) {
+        return evicter->page_misses();
+    }),
+    page_misses_membership(&cache_collection, &page_misses, "page_misses"),
     cache_collection_membership(&cache_collection) { }
 
-alt_cache_stats_t::perfmon_value_t::perfmon_value_t(alt_cache_stats_t *_parent) :
-    parent(_parent) { }
+alt_cache_stats_t::perfmon_value_t::perfmon_value_t(
+        alt_cache_stats_t *_parent,
+        std::function<uint64_t(alt::evicter_t *)> _getter) :
+    parent(_parent), getter(std::move(_getter)) { }
 
 void *alt_cache_stats_t::perfmon_value_t::begin_stats() {
     return new uint64_t;
@@ -23,7 +58,7 @@ void *alt_cache_stats_t::perfmon_value_t::begin_stats() {
 void alt_cache_stats_t::perfmon_value_t::visit_stats(void *ptr) {
     if (get_thread_id() == parent->home_thread()) {
         uint64_t *value = reinterpret_cast<uint64_t *>(ptr);
-        *value = parent->page_cache->evicter().in_memory_size();
+        *value = getter(&parent->page_cache->evicter());
     }
 }
 
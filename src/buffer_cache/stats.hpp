@@ -2,6 +2,8 @@
 #ifndef BUFFER_CACHE_STATS_HPP_
 #define BUFFER_CACHE_STATS_HPP_
 
+#include <functional>
+
 #include "perfmon/perfmon.hpp"
 #include "buffer_cache/page_cache.hpp"
 
@@ -15,19 +17,40 @@ public:
     perfmon_collection_t cache_collection;
     perfmon_membership_t cache_membership;
 
+    // Reports a value that the getter reads from the evicter.
     class perfmon_value_t : public perfmon_t {
     public:
-        explicit perfmon_value_t(alt_cache_stats_t *_parent);
+        perfmon_value_t(alt_cache_stats_t *_parent,
+                        std::function<uint64_t(alt::evicter_t *)> _getter);
         void *begin_stats();
         void visit_stats(void *);
         ql::datum_t end_stats(void *);
     private:
         alt_cache_stats_t *parent;
+        std::function<uint64_t(alt::evicter_t *)> getter;
         DISABLE_COPYING(perfmon_value_t);
     };
     perfmon_value_t in_use_bytes;
     perfmon_membership_t in_use_bytes_membership;
 
+    // How many page loads the compressed tier did and didn't serve
+    perfmon_value_t compressed_tier_hits;
+    perfmon_membership_t compressed_tier_hits_membership;
+    perfmon_value_t compressed_tier_misses;
+    perfmon_membership_t compressed_tier_misses_membership;
+
+    // How many pages that read-ahead loaded got used, and how many got evicted
+    // without being used
+    perfmon_value_t read_ahead_useful_pages;
+    perfmon_membership_t read_ahead_useful_pages_membership;
+    perfmon_value_t read_ahead_wasted_pages;
+    perfmon_membership_t read_ahead_wasted_pages_membership;
+
+    // How many page accesses found the page in memory, and how many had to load it
+    perfmon_value_t page_hits;
+    perfmon_membership_t page_hits_membership;
+    perfmon_value_t page_misses;
+    perfmon_membership_t page_misses_membership;
 
     perfmon_multi_membership_t cache_collection_membership;
 };
@@ -14,6 +14,17 @@ ARCHIVE_PRIM_MAKE_RANGED_SERIALIZABLE(write_durability_t, int8_t,
                                       write_durability_t::SOFT,
                                       write_durability_t::HARD);
 
+// How the evicter picks the pages it evicts.  With `access_time`, it evicts
+// (approximately) the least recently used page.  With `scan_resistant`, pages that
+// only scans have read, and then pages that have been accessed only once, are
+// evicted before the others, so that a big scan doesn't push the working set out of
+// the cache (the idea is the same as in 2Q).
+enum class eviction_policy_t { access_time, scan_resistant };
+
+// Low priority accesses to a page, like those of a scan that reads every page once,
+// don't make the page any more worth keeping in the cache.
+enum class page_access_priority_t { normal, low };
+
 #define DEFAULT_FLUSH_INTERVAL 1000
 // Converting this value from millis to nanos is less than half of 2^63.
 #define NEVER_FLUSH_INTERVAL (0x100000000ll * 1000ll)
@@ -22,6 +33,14 @@ struct flush_interval_t {
     int64_t millis;
 };
 
+// How much of a cache's contents is protected from eviction.  The evicter evicts
+// nothing while the cache holds no more than `reserved_size` bytes, and nothing at all
+// if `pinned` is true.
+struct cache_quota_t {
+    uint64_t reserved_size;
+    bool pinned;
+};
+
 typedef uint32_t block_magic_comparison_t;
 
 struct block_magic_t {
@@ -0,0 +1,169 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#include "buffer_cache/warm_up.hpp"
+
+#include <string.h>
+
+#include <algorithm>
+#include <functional>
+#include <utility>
+
+#include "arch/runtime/coroutines.hpp"
+#include "arch/runtime/thread_pool.hpp"
+#include "buffer_cache/page_cache.hpp"
+#include "config/args.hpp"
+#include "logger.hpp"
+#include "paths.hpp"
+#include "serializer/serializer.hpp"
+
+namespace alt {
+
+// The file starts with this, followed by the block ids.  Everything is in host byte
+// order, since the file only ever gets read by the server that wrote it.
+const uint64_t WARM_UP_FILE_MAGIC = 0x31707557524d5244ull;
+
+cache_warm_up_t::cache_warm_up_t(page_cache_t *page_cache,
+                                 const std::string &file_path)
+    : page_cache_(page_cache),
+      file_path_(file_path),
+      account_(page_cache->create_cache_account(CACHE_WARM_UP_CACHE_PRIORITY)),
+      saving_(false) {
+    coro_t::spawn_sometime(std::bind(&cache_warm_up_t::warm_up, this,
+                                     drainer_.lock()));
+}
+
+cache_warm_up_t::~cache_warm_up_t() {
+    assert_thread();
+    save_timer_.reset();
+    drainer_.drain();
+    // If we got interrupted while warming up, the file still describes the cache
+    // better than the cache does.
+    if (warm_up_done_.is_pulsed()) {
+        save(auto_drainer_t::lock_t());
+    }
+}
+
+std::string cache_warm_up_t::serialize_block_ids(
+        const std::vector<block_id_t> &block_ids) {
+    std::string ret((block_ids.size() + 1) * sizeof(uint64_t), '\0');
+    memcpy(&ret[0], &WARM_UP_FILE_MAGIC, sizeof(uint64_t));
+    if (!block_ids.empty()) {
+        memcpy(&ret[sizeof(uint64_t)], block_ids.data(),
+               block_ids.size() * sizeof(uint64_t));
+    }
+    return ret;
+}
+
+bool cache_warm_up_t::deserialize_block_ids(const std::string &contents,
+                                            std::vector<block_id_t> *block_ids_out) {
+    CT_ASSERT(sizeof(block_id_t) == sizeof(uint64_t));
+    block_ids_out->clear();
+    uint64_t magic;
+    if (contents.size() < sizeof(uint64_t) || contents.size() % sizeof(uint64_t) != 0) {
+        return false;
+    }
+    memcpy(&magic, contents.data(), sizeof(uint64_t));
+    if (magic != WARM_UP_FILE_MAGIC) {
+        return false;
+    }
+    block_ids_out->resize(contents.size() / sizeof(uint64_t) - 1);
+    if (!block_ids_out->empty()) {
+        memcpy(block_ids_out->data(), contents.data() + sizeof(uint64_t),
+               block_ids_out->size() * sizeof(uint64_t));
+    }
+    return true;
+}
+
+void cache_warm_up_t::warm_up(auto_drainer_t::lock_t lock) {
+    assert_thread();
+    std::string contents;
+    bool read_ok;
+    thread_pool_t::run_in_blocker_pool([&]() {
+        read_ok = blocking_read_file(file_path_.c_str(), &contents);
+    });
+
+    // A missing or broken file just means there's nothing to warm up with.
+    std::vector<block_id_t> block_ids;
+    if (read_ok && !contents.empty() && !deserialize_block_ids(contents, &block_ids)) {
+        logWRN("Ignoring malformed cache warm-up file %s.", file_path_.c_str());
+    }
+
+    for (size_t i = 0; i < block_ids.size(); i += CACHE_WARM_UP_BATCH_BLOCKS) {
+        if (lock.get_drain_signal()->is_pulsed()) {
+            return;
+        }
+        const size_t end = std::min<size_t>(block_ids.size(),
+                                            i + CACHE_WARM_UP_BATCH_BLOCKS);
+        if (!load_batch(std::vector<block_id_t>(block_ids.begin() + i,
+                                                block_ids.begin() + end))) {
+            // Our loads tell the balancer that the cache could use more memory, so
+            // we give it a moment to hand some out before we give up.
+            const uint64_t memory_limit = page_cache_->evicter().memory_limit();
+            try {
+                nap(CACHE_WARM_UP_BALANCER_WAIT_MS, lock.get_drain_signal());
+            } catch (const interrupted_exc_t &) {
+                return;
+            }
+            if (page_cache_->evicter().memory_limit() <= memory_limit) {
+                break;
+            }
+        }
+    }
+
+    if (lock.get_drain_signal()->is_pulsed()) {
+        return;
+    }
+    warm_up_done_.pulse();
+    // We don't record the blocks while we're still warming up, when the cache holds
+    // fewer blocks than the file lists.
+    save_timer_.init(new repeating_timer_t(CACHE_WARM_UP_SAVE_INTERVAL_MS, [this]() {
+        coro_t::spawn_sometime(std::bind(&cache_warm_up_t::save, this,
+                                         drainer_.lock()));
+    }));
+}
+
+bool cache_warm_up_t::load_batch(const std::vector<block_id_t> &block_ids) {
+    std::vector<std::pair<int64_t, block_id_t> > offsets;
+    {
+        serializer_t *serializer = page_cache_->serializer();
+        on_thread_t thread_switcher(serializer->home_thread());
+        for (block_id_t block_id : block_ids) {
+            counted_t<block_token_t> token = serializer->index_read(block_id);
+            // Blocks that were deleted since they got recorded have no token.
+            if (token.has()) {
+                offsets.push_back(std::make_pair(token->offset(), block_id));
+            }
+        }
+    }
+    std::sort(offsets.begin(), offsets.end());
+
+    std::vector<block_id_t> sorted_block_ids;
+    sorted_block_ids.reserve(offsets.size());
+    for (const auto &pair : offsets) {
+        sorted_block_ids.push_back(pair.second);
+    }
+    page_cache_->load_blocks(sorted_block_ids, &account_);
+
+    const evicter_t &evicter = page_cache_->evicter();
+    return evicter.in_memory_size() < evicter.memory_limit();
+}
+
+void cache_warm_up_t::save(UNUSED auto_drainer_t::lock_t lock) {
+    assert_thread();
+    if (saving_) {
+        return;
+    }
+    saving_ = true;
+    const std::string contents
+        = serialize_block_ids(page_cache_->resident_block_ids());
+    bool write_ok;
+    thread_pool_t::run_in_blocker_pool([&]() {
+        write_ok = blocking_replace_file(file_path_.c_str(), contents);
+    });
+    // We just try again next time, the file is only a hint.
+    if (!write_ok) {
+        logDBG("Failed to write the cache warm-up file %s.", file_path_.c_str());
+    }
+    saving_ = false;
+}
+
+}  // namespace alt
@@ -0,0 +1,69 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#ifndef BUFFER_CACHE_WARM_UP_HPP_
+#define BUFFER_CACHE_WARM_UP_HPP_
+
+#include <string>
+#include <vector>
+
+#include "arch/timing.hpp"
+#include "buffer_cache/cache_account.hpp"
+#include "concurrency/auto_drainer.hpp"
+#include "concurrency/cond_var.hpp"
+#include "containers/scoped.hpp"
+#include "serializer/types.hpp"
+#include "threading.hpp"
+
+namespace alt {
+
+class page_cache_t;
+
+// Warms up a page cache after a restart.  Every so often, and when it's destroyed,
+// it records which blocks the cache has in memory in a small file next to the table.
+// When it's created it loads the blocks listed there in the background, so the
+// cache doesn't have to fill up again through random reads.
+//
+// The most recently used blocks get loaded first, in batches that are read in the
+// order of their offsets on disk, so that the serializer reads them more or less
+// sequentially and its read-ahead picks up their neighbours.  The warm-up stops
+// once the cache is full and the balancer doesn't give it more memory, so it
+// doesn't push out the blocks that are actually being used.
+class cache_warm_up_t : public home_thread_mixin_t {
+public:
+    cache_warm_up_t(page_cache_t *page_cache, const std::string &file_path);
+    // Records the blocks in the cache one last time, so this has to be destroyed in
+    // a coroutine.
+    ~cache_warm_up_t();
+
+    // Pulsed when the cache is done loading the blocks from the file.
+    signal_t *warm_up_done() { return &warm_up_done_; }
+
+    // The format of the file.  Returns false if `contents` is malformed.
+    static std::string serialize_block_ids(const std::vector<block_id_t> &block_ids);
+    static bool deserialize_block_ids(const std::string &contents,
+                                      std::vector<block_id_t> *block_ids_out);
+
+private:
+    void warm_up(auto_drainer_t::lock_t lock);
+
+    // Loads the blocks that still exist in the order of their offsets, and returns
+    // false if the cache is full.
+    bool load_batch(const std::vector<block_id_t> &block_ids);
+
+    void save(auto_drainer_t::lock_t lock);
+
+    page_cache_t *const page_cache_;
+    const std::string file_path_;
+    cache_account_t account_;
+
+    cond_t warm_up_done_;
+    bool saving_;
+
+    auto_drainer_t drainer_;
+    scoped_ptr_t<repeating_timer_t> save_timer_;
+
+    DISABLE_COPYING(cache_warm_up_t);
+};
+
+}  // namespace alt
+
+#endif  // BUFFER_CACHE_WARM_UP_HPP_
@@ -0,0 +1,134 @@
+// Copyright 2010-2015 RethinkDB, all rights reserved.
+#include "client_protocol/admission_control.hpp"
+
+#include <algorithm>
+
+#include "time.hpp"
+
+admission_controller_t::admission_controller_t()
+    : concurrency_limit(ADMISSION_INITIAL_CONCURRENCY),
+      running(0),
+      num_waiting(0),
+      above_target_since_nanos(0),
+      overloaded(false),
+      last_limit_decrease_nanos(0) { }
+
+admission_controller_t::~admission_controller_t() {
+    guarantee(running == 0);
+    guarantee(num_waiting == 0);
+}
+
+admission_controller_t::ticket_t::~ticket_t() {
+    if (parent != nullptr) {
+        parent->release();
+    }
+}
+
+bool admission_controller_t::admit(
+        int priority, ticket_t *ticket_out, signal_t *interruptor)
+        THROWS_ONLY(interrupted_exc_t) {
+    assert_thread();
+    guarantee(ticket_out->parent == nullptr);
+    priority = std::min(std::max(priority, MESSAGE_SCHEDULER_MIN_PRIORITY),
+                        MESSAGE_SCHEDULER_MAX_PRIORITY);
+    const int64_t now = get_ticks().nanos;
+
+    if (num_waiting == 0 && static_cast<double>(running) < concurrency_limit) {
+        note_queue_delay(0, now);
+        ++running;
+        ticket_out->parent = this;
+        return true;
+    }
+    if ((overloaded && priority < MESSAGE_SCHEDULER_DEFAULT_PRIORITY)
+            || num_waiting >= ADMISSION_MAX_WAITING_QUERIES) {
+        return false;
+    }
+
+    waiter_t waiter(priority, now);
+    waiters_for(priority)->push_back(&waiter);
+    ++num_waiting;
+    try {
+        wait_interruptible(&waiter.done, interruptor);
+    } catch (const interrupted_exc_t &) {
+        if (!waiter.done.is_pulsed()) {
+            waiters_for(priority)->remove(&waiter);
+            --num_waiting;
+        } else if (waiter.admitted) {
+            release();
+        }
+        throw;
+    }
+    if (!waiter.admitted) {
+        return false;
+    }
+    ticket_out->parent = this;
+    return true;
+}
+
+intrusive_list_t<admission_controller_t::waiter_t> *
+admission_controller_t::waiters_for(int priority) {
+    return &waiters[priority - MESSAGE_SCHEDULER_MIN_PRIORITY];
+}
+
+void admission_controller_t::release() {
+    assert_thread();
+    guarantee(running > 0);
+    --running;
+    if (!overloaded && num_waiting > 0
+            && concurrency_limit < ADMISSION_MAX_CONCURRENCY) {
+        // Grows the limit by about one slot for every `concurrency_limit` queries
+        // that finish, like the additive increase of TCP congestion control.
+        concurrency_limit += 1.0 / concurrency_limit;
+    }
+    admit_waiters();
+}
+
+void admission_controller_t::admit_waiters() {
+    while (num_waiting > 0 && static_cast<double>(running) < concurrency_limit) {
+        waiter_t *waiter = nullptr;
+        for (int p = MESSAGE_SCHEDULER_MAX_PRIORITY;
+             p >= MESSAGE_SCHEDULER_MIN_PRIORITY; --p) {
+            if (!waiters_for(p)->empty()) {
+                waiter = waiters_for(p)->head();
+                waiters_for(p)->remove(waiter);
+                break;
+            }
+        }
+        guarantee(waiter != nullptr);
+        --num_waiting;
+
+        const int64_t now = get_ticks().nanos;
+        const int64_t delay = now - waiter->enqueued_nanos;
+        note_queue_delay(delay, now);
+        if (overloaded && delay > ADMISSION_QUEUE_DELAY_TARGET_MS * MILLION) {
+            // By the time this query would run its client has probably given up on
+            // it, so we may as well free the slot for one that waited less.
+            waiter->done.pulse();
+            continue;
+        }
+        ++running;
+        waiter->admitted = true;
+        waiter->done.pulse();
+    }
+}
+
+void admission_controller_t::note_queue_delay(int64_t delay_nanos, int64_t now_nanos) {
+    if (delay_nanos <= ADMISSION_QUEUE_DELAY_TARGET_MS * MILLION) {
+        above_target_since_nanos = 0;
+        overloaded = false;
+        return;
+    }
+    if (above_target_since_nanos == 0) {
+        above_target_since_nanos = now_nanos;
+        return;
+    }
+    if (now_nanos - above_target_since_nanos >= ADMISSION_INTERVAL_MS * MILLION) {
+        overloaded = true;
+        if (now_nanos - last_limit_decrease_nanos >= ADMISSION_INTERVAL_MS * MILLION) {
+            concurrency_limit = std::max(
+                static_cast<double>(ADMISSION_MIN_CONCURRENCY),
+                concurrency_limit * 3 / 4);
+            last_limit_decrease_nanos = now_nanos;
+        }
+    }
+}
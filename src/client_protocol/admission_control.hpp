@@ -0,0 +1,80 @@
+// Copyright 2010-2015 RethinkDB, all rights reserved.
+#ifndef CLIENT_PROTOCOL_ADMISSION_CONTROL_HPP_
+#define CLIENT_PROTOCOL_ADMISSION_CONTROL_HPP_
+
+#include "concurrency/cond_var.hpp"
+#include "concurrency/interruptor.hpp"
+#include "config/args.hpp"
+#include "containers/intrusive_list.hpp"
+#include "threading.hpp"
+
+/* `admission_controller_t` limits how many driver queries may start running at the
+same time on one thread, so that an overloaded server fails some queries early with an
+error that clients can retry, instead of letting every query queue up until they all
+time out together.
+
+Queries that find all slots taken wait in line, the ones with a higher coroutine
+priority first. How long they wait works like the queue delay of CoDel: once it has
+stayed above `ADMISSION_QUEUE_DELAY_TARGET_MS` for `ADMISSION_INTERVAL_MS` the thread
+counts as overloaded. While it is, queries of a lower priority than the default are
+turned away without waiting, and queries that waited longer than the target are turned
+away when their turn comes. The number of slots shrinks while the thread stays
+overloaded and grows back slowly while it has waiting queries but isn't. */
+class admission_controller_t : public home_thread_mixin_t {
+public:
+    admission_controller_t();
+    ~admission_controller_t();
+
+    /* Holds a slot of the controller for as long as it exists. */
+    class ticket_t {
+    public:
+        ticket_t() : parent(nullptr) { }
+        ~ticket_t();
+    private:
+        friend class admission_controller_t;
+        admission_controller_t *parent;
+        DISABLE_COPYING(ticket_t);
+    };
+
+    /* Waits until a query with coroutine priority `priority` may run, puts its slot
+    into `ticket_out` and returns true, or returns false if the query should fail
+    because the thread is overloaded. */
+    bool admit(int priority, ticket_t *ticket_out, signal_t *interruptor)
+        THROWS_ONLY(interrupted_exc_t);
+
+    bool is_overloaded() const { return overloaded; }
+
+private:
+    class waiter_t : public intrusive_list_node_t<waiter_t> {
+    public:
+        waiter_t(int _priority, int64_t _enqueued_nanos)
+            : priority(_priority), enqueued_nanos(_enqueued_nanos), admitted(false) { }
+        const int priority;
+        const int64_t enqueued_nanos;
+        bool admitted;
+        cond_t done;
+    };
+
+    intrusive_list_t<waiter_t> *waiters_for(int priority);
+    void release();
+    void admit_waiters();
+    void note_queue_delay(int64_t delay_nanos, int64_t now_nanos);
+
+    /* How many queries may run at the same time. This is a `double` so that it can
+    grow by a fraction of a slot for every query that finishes. */
+    double concurrency_limit;
+    size_t running;
+
+    intrusive_list_t<waiter_t> waiters[
+        MESSAGE_SCHEDULER_MAX_PRIORITY - MESSAGE_SCHEDULER_MIN_PRIORITY + 1];
+    size_t num_waiting;
+
+    /* Since when the queue delay has been above the target, or 0 if it isn't. */
+    int64_t above_target_since_nanos;
+    bool overloaded;
+    int64_t last_limit_decrease_nanos;
+
+    DISABLE_COPYING(admission_controller_t);
+};
+
+#endif  // CLIENT_PROTOCOL_ADMISSION_CONTROL_HPP_
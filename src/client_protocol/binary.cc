@@ -0,0 +1,87 @@
+// Copyright 2010-2015 RethinkDB, all rights reserved.
+#include "client_protocol/binary.hpp"
+
+#include <utility>
+#include <vector>
+
+#include "arch/io/network.hpp"
+#include "client_protocol/json.hpp"
+#include "client_protocol/protocols.hpp"
+#include "containers/archive/archive.hpp"
+#include "rdb_protocol/datum.hpp"
+#include "rdb_protocol/query_params.hpp"
+#include "rdb_protocol/rdb_backtrace.hpp"
+#include "rdb_protocol/response.hpp"
+#include "rdb_protocol/serialize_datum.hpp"
+#include "rdb_protocol/term_storage.hpp"
+
+scoped_ptr_t<ql::query_params_t> binary_protocol_t::parse_query(
+        tcp_conn_t *conn,
+        signal_t *interruptor,
+        ql::query_cache_t *query_cache,
+        const response_options_t &response_options) {
+    return json_protocol_t::parse_query_for_protocol<binary_protocol_t>(
+        conn, interruptor, query_cache, response_options);
+}
+
+static ql::datum_t response_to_datum(const ql::response_t &response) {
+    ql::datum_object_builder_t builder;
+    builder.overwrite("t", ql::datum_t(static_cast<double>(response.type())));
+    if (response.type() == Response::RUNTIME_ERROR && response.error_type()) {
+        builder.overwrite(
+            "e", ql::datum_t(static_cast<double>(*response.error_type())));
+    }
+    std::vector<ql::datum_t> data = response.data();
+    builder.overwrite(
+        "r", ql::datum_t(std::move(data),
+                         ql::datum_t::no_array_size_limit_check_t()));
+    if (response.backtrace()) {
+        builder.overwrite("b", *response.backtrace());
+    }
+    if (response.profile()) {
+        builder.overwrite("p", *response.profile());
+    }
+    if (response.type() == Response::SUCCESS_PARTIAL ||
+        response.type() == Response::SUCCESS_SEQUENCE) {
+        std::vector<ql::datum_t> notes;
+        for (const auto &note : response.notes()) {
+            notes.push_back(ql::datum_t(static_cast<double>(note)));
+        }
+        builder.overwrite(
+            "n", ql::datum_t(std::move(notes),
+                             ql::datum_t::no_array_size_limit_check_t()));
+    }
+    return std::move(builder).to_datum();
+}
+
+void binary_protocol_t::send_response(ql::response_t *response,
+                                      int64_t token,
+                                      tcp_conn_t *conn,
+                                      const response_options_t &options,
+                                      signal_t *interruptor) {
+    ql::datum_t datum = response_to_datum(*response);
+    const size_t payload_size = ql::datum_serialized_size(
+        datum, ql::check_datum_serialization_errors_t::NO);
+
+    if (payload_size >= wire_protocol_t::TOO_LARGE_RESPONSE_SIZE) {
+        response->fill_error(Response::RUNTIME_ERROR,
+                             Response::RESOURCE_LIMIT,
+                             wire_protocol_t::too_large_response_message(payload_size),
+                             ql::backtrace_registry_t::EMPTY_BACKTRACE);
+        send_response(response, token, conn, options, interruptor);
+        return;
+    }
+
+    write_message_t wm;
+    // The result only tells us whether the datum could be written to disk (it might
+    // contain a large array), which doesn't matter here.
+    UNUSED ql::serialization_result_t res = ql::datum_serialize(
+        &wm, datum, ql::check_datum_serialization_errors_t::NO);
+
+    intrusive_list_t<write_buffer_t> *buffers = wm.unsafe_expose_buffers();
+    const_buffer_group_t chunks;
+    for (write_buffer_t *b = buffers->head(); b != nullptr; b = buffers->next(b)) {
+        chunks.add_buffer(b->size, b->contents());
+    }
+    wire_protocol_t::write_response(token, &chunks, options, conn, interruptor);
+}
@@ -0,0 +1,42 @@
+// Copyright 2010-2015 RethinkDB, all rights reserved.
+#ifndef CLIENT_PROTOCOL_BINARY_HPP_
+#define CLIENT_PROTOCOL_BINARY_HPP_
+
+#include <stdint.h>
+
+#include "arch/types.hpp"
+#include "containers/scoped.hpp"
+
+class signal_t;
+struct response_options_t;
+
+namespace ql {
+class response_t;
+class query_cache_t;
+class query_params_t;
+}
+
+/* Clients that ask for `protocol_version` 1 in the V1_0 handshake get this protocol.
+Queries are read as JSON, just like with `json_protocol_t`.  Responses are framed the
+same way as JSON responses (the 8-byte token, then the 4-byte size of the payload,
+both little-endian), but the payload is the response object (with the same "t", "e",
+"r", "b", "p" and "n" fields that a JSON response has) in the datum serialization
+format of `datum_serialize()`.  Documents that were read from disk are usually
+already in that format and get sent as they are. */
+class binary_protocol_t {
+public:
+    // Errors are sent back right away, in the way that `response_options` says.
+    static scoped_ptr_t<ql::query_params_t> parse_query(
+            tcp_conn_t *conn,
+            signal_t *interruptor,
+            ql::query_cache_t *query_cache,
+            const response_options_t &response_options);
+
+    static void send_response(ql::response_t *response,
+                              int64_t token,
+                              tcp_conn_t *conn,
+                              const response_options_t &options,
+                              signal_t *interruptor);
+};
+
+#endif  // CLIENT_PROTOCOL_BINARY_HPP_
@@ -3,8 +3,10 @@
 
 #include "arch/io/network.hpp"
 #include "arch/timing.hpp"
+#include "client_protocol/binary.hpp"
 #include "client_protocol/protocols.hpp"
 #include "concurrency/pmap.hpp"
+#include "containers/chunked_string_buffer.hpp"
 #include "containers/scoped.hpp"
 #include "rapidjson/document.h"
 #include "rapidjson/stringbuffer.h"
@@ -17,11 +19,11 @@
 #include "utils.hpp"
 
 scoped_ptr_t<ql::query_params_t> json_protocol_t::parse_query_from_buffer(
-        scoped_array_t<char> &&buffer, size_t offset,
+        counted_t<shared_buf_t> &&buffer, size_t offset,
         ql::query_cache_t *query_cache, int64_t token,
         ql::response_t *error_out) {
     rapidjson::Document doc;
-    doc.ParseInsitu(buffer.data() + offset);
+    doc.ParseInsitu(buffer->data(offset));
 
     scoped_ptr_t<ql::query_params_t> res;
     if (!doc.HasParseError()) {
@@ -48,7 +50,22 @@ scoped_ptr_t<ql::query_params_t> json_protocol_t::parse_query_from_buffer(
 scoped_ptr_t<ql::query_params_t> json_protocol_t::parse_query(
         tcp_conn_t *conn,
         signal_t *interruptor,
-        ql::query_cache_t *query_cache) {
+        ql::query_cache_t *query_cache,
+        const response_options_t &response_options) {
+    return parse_query_for_protocol<json_protocol_t>(
+        conn, interruptor, query_cache, response_options);
+}
+
+template <class protocol_t>
+scoped_ptr_t<ql::query_params_t> json_protocol_t::parse_query_for_protocol(
+        tcp_conn_t *conn,
+        signal_t *interruptor,
+        ql::query_cache_t *query_cache,
+        const response_options_t &response_options) {
+    // Errors are written right away, since no other response may follow them.
+    response_options_t error_options = response_options;
+    error_options.buffered = false;
+
     int64_t token;
     uint32_t size;
     conn->read_buffered(&token, sizeof(token), interruptor);
@@ -75,31 +92,43 @@ scoped_ptr_t<ql::query_params_t> json_protocol_t::parse_query(
             conn->pop(size, &pop_interruptor);
         }
 
-        send_response(&error, token, conn, interruptor);
+        protocol_t::send_response(&error, token, conn, error_options, interruptor);
         throw tcp_conn_read_closed_exc_t();
     }
 
-    scoped_array_t<char> data(size + 1);
+    // The query is parsed in place and its terms point into `data` for as long as
+    // it runs, so it needs a buffer of its own rather than a view of the connection's
+    // read buffer, which gets reused for the queries that come after it.  Small
+    // queries get a recycled buffer from `shared_buf_t`'s free lists.
+    counted_t<shared_buf_t> data = shared_buf_t::create(size + 1);
     // It's *usually* more efficient to do an un-buffered read here. The client is
     // usually not going to group multiple queries into the same network package
     // (especially not with tcp_nodelay set), and using the non-buffered `read` can
     // avoid an extra copy.
-    conn->read(data.data(), size, interruptor);
-    data[size] = 0; // Null terminate the string, which the json parser requires
+    conn->read(data->data(), size, interruptor);
+    data->data()[size] = 0; // Null terminate the string, which the json parser requires
 
     scoped_ptr_t<ql::query_params_t> res =
         parse_query_from_buffer(std::move(data), 0, query_cache, token, &error);
 
     if (!res.has()) {
-        send_response(&error, token, conn, interruptor);
+        protocol_t::send_response(&error, token, conn, error_options, interruptor);
     }
     return res;
 }
 
+template scoped_ptr_t<ql::query_params_t>
+json_protocol_t::parse_query_for_protocol<json_protocol_t>(
+    tcp_conn_t *, signal_t *, ql::query_cache_t *, const response_options_t &);
+template scoped_ptr_t<ql::query_params_t>
+json_protocol_t::parse_query_for_protocol<binary_protocol_t>(
+    tcp_conn_t *, signal_t *, ql::query_cache_t *, const response_options_t &);
+
+template <class buffer_t>
 void write_response_internal(ql::response_t *response,
-                             rapidjson::StringBuffer *buffer_out,
+                             buffer_t *buffer_out,
                              bool throw_errors) {
-    rapidjson::Writer<rapidjson::StringBuffer> writer(*buffer_out);
+    rapidjson::Writer<buffer_t> writer(*buffer_out);
     size_t start_offset = buffer_out->GetSize();
 
     try {
@@ -135,18 +164,18 @@ void write_response_internal(ql::response_t *response,
                         response->data().size() : (per_thread * (m + 1));
 
                     for (size_t i = offset; i < end; ++i) {
-                        const size_t YIELD_INTERVAL = 2000;
-                        if ((i + 1) % YIELD_INTERVAL == 0) {
-                            coro_t::yield();
-                        }
+                        coro_t::maybe_yield();
                         response->data()[i].write_json(&thread_writer);
                     }
 
                     thread_writer.EndArray();
                 });
 
-            for (const auto &buffer : buffers) {
+            for (auto &buffer : buffers) {
                 writer.SpliceArray(buffer);
+                // Free it right away, so that we don't hold on to two copies of the
+                // whole response.
+                buffer = rapidjson::StringBuffer();
             }
         } else {
             for (const auto &item : response->data()) {
@@ -204,16 +233,19 @@ void json_protocol_t::write_response_to_buffer(ql::response_t *response,
 void json_protocol_t::send_response(ql::response_t *response,
                                     int64_t token,
                                     tcp_conn_t *conn,
+                                    const response_options_t &options,
                                     signal_t *interruptor) {
-    uint32_t data_size; // filled in below
-    const size_t prefix_size = sizeof(token) + sizeof(data_size);
-
-    // Reserve space for the token and the size
-    rapidjson::StringBuffer buffer;
-    buffer.Push(prefix_size);
+    // We write the response into chunks, which get handed to the connection as they
+    // are, so that a large response doesn't need one big buffer that gets copied
+    // every time it grows.
+    chunked_string_buffer_t buffer;
 
-    write_response_to_buffer(response, &buffer);
-    int64_t payload_size = buffer.GetSize() - prefix_size;
+#ifdef NDEBUG
+    write_response_internal(response, &buffer, false);
+#else
+    write_response_internal(response, &buffer, true);
+#endif
+    int64_t payload_size = buffer.GetSize();
     guarantee(payload_size > 0);
 
     static_assert(std::is_same<decltype(wire_protocol_t::TOO_LARGE_RESPONSE_SIZE),
@@ -225,28 +257,14 @@ void json_protocol_t::send_response(ql::response_t *response,
                              Response::RESOURCE_LIMIT,
                              wire_protocol_t::too_large_response_message(payload_size),
                              ql::backtrace_registry_t::EMPTY_BACKTRACE);
-        send_response(response, token, conn, interruptor);
+        send_response(response, token, conn, options, interruptor);
         return;
     }
 
-    // Fill in the token and size
-    char *mutable_buffer = buffer.GetMutableBuffer();
-#ifdef __s390x__
-    token = __builtin_bswap64(token);
-#endif
-    for (size_t i = 0; i < sizeof(token); ++i) {
-        mutable_buffer[i] = reinterpret_cast<const char *>(&token)[i];
+    const_buffer_group_t chunks;
+    for (size_t i = 0; i < buffer.num_chunks(); ++i) {
+        chunks.add_buffer(buffer.chunk_size(i), buffer.chunk_data(i));
     }
-
-    data_size = static_cast<uint32_t>(payload_size);
-#ifdef __s390x__
-    data_size = __builtin_bswap32(data_size);
-#endif
-    for (size_t i = 0; i < sizeof(data_size); ++i) {
-        mutable_buffer[i + sizeof(token)] =
-            reinterpret_cast<const char *>(&data_size)[i];
-    }
-
-    conn->write(buffer.GetString(), buffer.GetSize(), interruptor);
+    wire_protocol_t::write_response(token, &chunks, options, conn, interruptor);
 }
 
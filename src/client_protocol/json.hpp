@@ -6,9 +6,11 @@
 
 #include "arch/types.hpp"
 #include "containers/scoped.hpp"
+#include "containers/shared_buffer.hpp"
 #include "rapidjson/stringbuffer.h"
 
 class signal_t;
+struct response_options_t;
 
 namespace ql {
 class response_t;
@@ -21,13 +23,25 @@ class query_params_t;
 class json_protocol_t {
 public:
     static scoped_ptr_t<ql::query_params_t> parse_query_from_buffer(
-            scoped_array_t<char> &&mutable_buffer, size_t offset,
+            counted_t<shared_buf_t> &&mutable_buffer, size_t offset,
             ql::query_cache_t *query_cache, int64_t token,
             ql::response_t *error_out);
 
-    static scoped_ptr_t<ql::query_params_t> parse_query(tcp_conn_t *conn,
-                                                        signal_t *interruptor,
-                                                        ql::query_cache_t *query_cache);
+    // Errors are sent back right away, in the way that `response_options` says.
+    static scoped_ptr_t<ql::query_params_t> parse_query(
+            tcp_conn_t *conn,
+            signal_t *interruptor,
+            ql::query_cache_t *query_cache,
+            const response_options_t &response_options);
+
+    // Like `parse_query`, but sends errors back with `protocol_t::send_response`, for
+    // protocols that read queries in JSON but respond differently.
+    template <class protocol_t>
+    static scoped_ptr_t<ql::query_params_t> parse_query_for_protocol(
+            tcp_conn_t *conn,
+            signal_t *interruptor,
+            ql::query_cache_t *query_cache,
+            const response_options_t &response_options);
 
     // Used by the HTTP ReQL server to write the query response into the HTTP response
     static void write_response_to_buffer(ql::response_t *response,
@@ -36,6 +50,7 @@ public:
     static void send_response(ql::response_t *response,
                               int64_t token,
                               tcp_conn_t *conn,
+                              const response_options_t &options,
                               signal_t *interruptor);
 };
 
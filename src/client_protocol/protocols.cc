@@ -1,8 +1,15 @@
 // Copyright 2010-2015 RethinkDB, all rights reserved.
 #include "client_protocol/protocols.hpp"
 
+#include <string.h>
+#include <zlib.h>
+
 #include <limits>
 
+#include "arch/io/network.hpp"
+#include "arch/runtime/coroutines.hpp"
+#include "containers/buffer_group.hpp"
+#include "containers/scoped.hpp"
 #include "utils.hpp"
 
 const uint32_t wire_protocol_t::HARD_LIMIT_TOO_LARGE_QUERY_SIZE = GIGABYTE;
@@ -11,6 +18,8 @@ const uint32_t wire_protocol_t::TOO_LARGE_QUERY_SIZE = 128 * MEGABYTE;
 const uint32_t wire_protocol_t::TOO_LARGE_RESPONSE_SIZE =
     std::numeric_limits<uint32_t>::max();
 
+const size_t wire_protocol_t::MIN_COMPRESSED_RESPONSE_SIZE = KILOBYTE;
+
 const std::string wire_protocol_t::unparseable_query_message =
     "Client is buggy (failed to deserialize query).";
 
@@ -23,3 +32,99 @@ std::string wire_protocol_t::too_large_response_message(size_t size) {
     return strprintf("Response size (%zu) greater than maximum (%" PRIu32 ").",
                      size, TOO_LARGE_RESPONSE_SIZE - 1);
 }
+
+namespace {
+
+/* Compresses `payload` into `out` and returns the compressed size, or 0 if that
+wouldn't be smaller than the payload. */
+size_t deflate_payload(const const_buffer_group_t *payload, scoped_array_t<char> *out) {
+    const size_t payload_size = payload->get_size();
+    out->init(payload_size);
+
+    z_stream zstream;
+    zstream.zalloc = Z_NULL;
+    zstream.zfree = Z_NULL;
+    zstream.opaque = Z_NULL;
+    // The compression runs on the thread that serves the connection's queries, so we
+    // prefer speed over a better ratio.
+    int zres = deflateInit(&zstream, Z_BEST_SPEED);
+    guarantee(zres == Z_OK, "deflateInit() failed (%d)", zres);
+    zstream.next_out = reinterpret_cast<Bytef *>(out->data());
+    zstream.avail_out = static_cast<uInt>(payload_size);
+
+    bool smaller = true;
+    for (size_t i = 0; i < payload->num_buffers() && smaller; ++i) {
+        const const_buffer_group_t::buffer_t chunk = payload->get_buffer(i);
+        zstream.next_in =
+            reinterpret_cast<Bytef *>(const_cast<void *>(chunk.data));
+        zstream.avail_in = static_cast<uInt>(chunk.size);
+        const bool last = i + 1 == payload->num_buffers();
+        zres = deflate(&zstream, last ? Z_FINISH : Z_NO_FLUSH);
+        // Running out of output space means that the result wouldn't be smaller.
+        smaller = zstream.avail_in == 0 && (!last || zres == Z_STREAM_END);
+        coro_t::maybe_yield();
+    }
+    const size_t compressed_size = smaller ? zstream.total_out : 0;
+    deflateEnd(&zstream);
+    return compressed_size;
+}
+
+}  // namespace
+
+void wire_protocol_t::write_response(int64_t token,
+                                     const const_buffer_group_t *payload,
+                                     const response_options_t &options,
+                                     tcp_conn_t *conn,
+                                     signal_t *interruptor) {
+    const size_t payload_size = payload->get_size();
+    scoped_array_t<char> compressed;
+    size_t compressed_size = 0;
+    if (options.compressed && payload_size >= MIN_COMPRESSED_RESPONSE_SIZE) {
+        compressed_size = deflate_payload(payload, &compressed);
+    }
+    const response_format_t format = compressed_size != 0
+        ? response_format_t::DEFLATE
+        : response_format_t::PLAIN;
+
+    rassert(payload_size < TOO_LARGE_RESPONSE_SIZE);
+    uint32_t data_size = static_cast<uint32_t>(
+        (compressed_size != 0 ? compressed_size : payload_size)
+        + (options.compressed ? sizeof(format) : 0));
+#ifdef __s390x__
+    token = __builtin_bswap64(token);
+    data_size = __builtin_bswap32(data_size);
+#endif
+
+    char prefix[sizeof(token) + sizeof(data_size) + sizeof(format)];
+    size_t prefix_size = 0;
+    memcpy(prefix + prefix_size, &token, sizeof(token));
+    prefix_size += sizeof(token);
+    memcpy(prefix + prefix_size, &data_size, sizeof(data_size));
+    prefix_size += sizeof(data_size);
+    if (options.compressed) {
+        prefix[prefix_size] = static_cast<char>(format);
+        prefix_size += sizeof(format);
+    }
+
+    const_buffer_group_t chunks;
+    chunks.add_buffer(prefix_size, prefix);
+    if (format == response_format_t::DEFLATE) {
+        chunks.add_buffer(compressed_size, compressed.data());
+    } else {
+        for (size_t i = 0; i < payload->num_buffers(); ++i) {
+            const const_buffer_group_t::buffer_t chunk = payload->get_buffer(i);
+            chunks.add_buffer(chunk.size, chunk.data);
+        }
+    }
+
+    if (options.buffered) {
+        for (size_t i = 0; i < chunks.num_buffers(); ++i) {
+            const const_buffer_group_t::buffer_t chunk = chunks.get_buffer(i);
+            conn->write_buffered(
+                chunk.data, static_cast<size_t>(chunk.size), interruptor);
+        }
+        conn->flush_buffer_eventually(interruptor);
+    } else {
+        conn->write_buffers(&chunks, interruptor);
+    }
+}
@@ -7,8 +7,31 @@
 #include <string>
 
 // Include all available wire protocols
+#include "client_protocol/binary.hpp"
 #include "client_protocol/json.hpp"
 
+class const_buffer_group_t;
+class signal_t;
+
+/* How the responses of a connection get written. */
+struct response_options_t {
+    response_options_t() : buffered(false), compressed(false) { }
+
+    // Whether responses may sit in the connection's write buffer for a while; see
+    // `wire_protocol_t::write_response`.
+    bool buffered;
+    // Whether the client asked for compressed responses during the handshake.  Each
+    // response payload then starts with a `response_format_t` byte.
+    bool compressed;
+};
+
+enum class response_format_t : uint8_t {
+    // The rest of the payload is the response, as it is.
+    PLAIN = 0,
+    // The rest of the payload is the response, compressed into a zlib stream.
+    DEFLATE = 1
+};
+
 // Contains common declarations used by all wire protocols, this is a class rather than
 // a namespace so we don't have to extern stuff.
 class wire_protocol_t {
@@ -21,6 +44,20 @@ public:
     static const std::string unparseable_query_message;
     static std::string too_large_query_message(uint32_t size);
     static std::string too_large_response_message(size_t size);
+
+    // Responses smaller than this are never compressed.
+    static const size_t MIN_COMPRESSED_RESPONSE_SIZE;
+
+    /* Writes the response to the query `token`, whose payload has been serialized
+    into `payload`, in front of which this puts the token and the size.  Without
+    `options.buffered`, this blocks until the response has been written.  With it, the
+    response is copied into the connection's write buffer, which the connection's write
+    coroutine sends together with whatever else has been buffered by then. */
+    static void write_response(int64_t token,
+                               const const_buffer_group_t *payload,
+                               const response_options_t &options,
+                               tcp_conn_t *conn,
+                               signal_t *interruptor);
 };
 
 #endif // CLIENT_PROTOCOL_PROTOCOLS_HPP_
@@ -221,27 +221,48 @@ query_server_t::query_server_t(rdb_context_t *_rdb_ctx,
                                int port,
                                query_handler_t *_handler,
                                uint32_t http_timeout_sec,
-                               tls_ctx_t *_tls_ctx) :
+                               tls_ctx_t *_tls_ctx,
+                               const query_server_options_t &_options) :
         tls_ctx(_tls_ctx),
         rdb_ctx(_rdb_ctx),
         handler(_handler),
+        options(_options),
         http_conn_cache(http_timeout_sec),
+        connections_per_thread(get_num_db_threads(), 0),
         next_thread(0) {
     rassert(rdb_ctx != nullptr);
+    guarantee(options.max_queries_per_connection > 0);
+    if (options.admission_control) {
+        admission_controllers.init(new one_per_thread_t<admission_controller_t>());
+    }
     try {
-        tcp_listener.init(new tcp_listener_t(local_addresses, port,
-            std::bind(&query_server_t::handle_conn,
-                      this, ph::_1, auto_drainer_t::lock_t(&drainer))));
+        if (options.reuse_port) {
+            thread_drainers.init(new one_per_thread_t<auto_drainer_t>());
+            per_thread_listener.init(new per_thread_tcp_listener_t(local_addresses, port,
+                [this](const scoped_ptr_t<tcp_conn_descriptor_t> &nconn) {
+                    handle_conn(nconn, auto_drainer_t::lock_t(thread_drainers->get()));
+                }));
+        } else {
+            tcp_listener.init(new tcp_listener_t(local_addresses, port,
+                std::bind(&query_server_t::handle_conn,
+                          this, ph::_1, auto_drainer_t::lock_t(&drainer))));
+        }
     } catch (const address_in_use_exc_t &ex) {
         throw address_in_use_exc_t(
             strprintf("Could not bind to RDB protocol port: %s", ex.what()));
     }
 }
 
-query_server_t::~query_server_t() { }
+query_server_t::~query_server_t() {
+    // Stop accepting connections, then wait for the ones we have to go away.
+    per_thread_listener.reset();
+    thread_drainers.reset();
+}
 
 int query_server_t::get_port() const {
-    return tcp_listener->get_port();
+    return options.reuse_port
+        ? per_thread_listener->get_port()
+        : tcp_listener->get_port();
 }
 
 void write_datum(tcp_conn_t *connection, ql::datum_t datum, signal_t *interruptor) {
@@ -279,10 +300,42 @@ ql::datum_t read_datum(tcp_conn_t *connection, signal_t *interruptor) {
     }
 }
 
+threadnum_t query_server_t::choose_thread() {
+    const int num_threads = connections_per_thread.size();
+    int best = next_thread;
+    for (int i = 1; i < num_threads; ++i) {
+        int thread = (next_thread + i) % num_threads;
+        if (connections_per_thread[thread] < connections_per_thread[best]) {
+            best = thread;
+        }
+    }
+    next_thread = (best + 1) % num_threads;
+    return threadnum_t(best);
+}
+
+// Counts a connection in `query_server_t::connections_per_thread` for as long as it
+// exists.  It must be destroyed on the thread it was created on.
+class thread_connection_count_t {
+public:
+    thread_connection_count_t(std::vector<int> *_counts, threadnum_t _thread)
+        : counts(_counts), thread(_thread) {
+        ++(*counts)[thread.threadnum];
+    }
+    ~thread_connection_count_t() {
+        --(*counts)[thread.threadnum];
+    }
+private:
+    std::vector<int> *const counts;
+    const threadnum_t thread;
+
+    DISABLE_COPYING(thread_connection_count_t);
+};
+
 void query_server_t::handle_conn(const scoped_ptr_t<tcp_conn_descriptor_t> &nconn,
                                  auto_drainer_t::lock_t keepalive) {
-    threadnum_t chosen_thread = threadnum_t(next_thread);
-    next_thread = (next_thread + 1) % get_num_db_threads();
+    threadnum_t chosen_thread = options.reuse_port ? get_thread_id() : choose_thread();
+    // This is destroyed after `rethreader` has switched back to this thread.
+    thread_connection_count_t connection_count(&connections_per_thread, chosen_thread);
 
     cross_thread_signal_t ct_keepalive(keepalive.get_drain_signal(), chosen_thread);
     on_thread_t rethreader(chosen_thread);
@@ -301,6 +354,10 @@ void query_server_t::handle_conn(const scoped_ptr_t<tcp_conn_descriptor_t> &ncon
     }
 
     uint8_t version = 0;
+    // Whether the client asked for `binary_protocol_t` responses during the handshake.
+    bool binary_responses = false;
+    response_options_t response_options;
+    response_options.buffered = options.pipelining;
     std::unique_ptr<auth::base_authenticator_t> authenticator;
     uint32_t error_code = 0;
     std::string error_message;
@@ -344,7 +401,7 @@ void query_server_t::handle_conn(const scoped_ptr_t<tcp_conn_descriptor_t> &ncon
         } else if (version < 10) {
             // We'll get std::make_unique in C++14
             authenticator.reset(
-                new auth::plaintext_authenticator_t(rdb_ctx->get_auth_watchable()));
+                new auth::plaintext_authenticator_t(rdb_ctx->get_auth_snapshot()));
 
             uint32_t auth_key_size;
             conn->read_buffered(&auth_key_size, sizeof(uint32_t), &ct_keepalive);
@@ -391,15 +448,21 @@ void query_server_t::handle_conn(const scoped_ptr_t<tcp_conn_descriptor_t> &ncon
             conn->write(success_msg, strlen(success_msg) + 1, &ct_keepalive);
         } else {
             authenticator.reset(
-                new auth::scram_authenticator_t(rdb_ctx->get_auth_watchable()));
+                new auth::scram_authenticator_t(rdb_ctx->get_auth_snapshot()));
 
             {
                 ql::datum_object_builder_t datum_object_builder;
                 datum_object_builder.overwrite("success", ql::datum_t::boolean(true));
-                datum_object_builder.overwrite("max_protocol_version", ql::datum_t(0.0));
+                datum_object_builder.overwrite("max_protocol_version", ql::datum_t(1.0));
                 datum_object_builder.overwrite("min_protocol_version", ql::datum_t(0.0));
                 datum_object_builder.overwrite(
                     "server_version", ql::datum_t(REBIRTHDB_VERSION));
+                // Clients that know about compressed responses can ask for them with
+                // a `compression` field in their next message.
+                datum_object_builder.overwrite(
+                    "compression_methods",
+                    ql::datum_t(std::vector<ql::datum_t>{ql::datum_t("deflate")},
+                                ql::configured_limits_t::unlimited));
 
                 write_datum(
                     conn.get(),
@@ -416,7 +479,10 @@ void query_server_t::handle_conn(const scoped_ptr_t<tcp_conn_descriptor_t> &ncon
                     throw client_protocol::client_server_error_t(
                         1, "Expected a number for `protocol_version`.");
                 }
-                if (protocol_version.as_num() != 0.0) {
+                if (protocol_version.as_num() == 1.0) {
+                    // Respond with serialized datums instead of JSON.
+                    binary_responses = true;
+                } else if (protocol_version.as_num() != 0.0) {
                     throw client_protocol::client_server_error_t(
                         2, "Unsupported `protocol_version`.");
                 }
@@ -432,6 +498,19 @@ void query_server_t::handle_conn(const scoped_ptr_t<tcp_conn_descriptor_t> &ncon
                         4, "Unsupported `authentication_method`.");
                 }
 
+                ql::datum_t compression = datum.get_field("compression", ql::NOTHROW);
+                if (compression.has()) {
+                    if (compression.get_type() != ql::datum_t::R_STR) {
+                        throw client_protocol::client_server_error_t(
+                            6, "Expected a string for `compression`.");
+                    }
+                    if (compression.as_str() != "deflate") {
+                        throw client_protocol::client_server_error_t(
+                            7, "Unsupported `compression`.");
+                    }
+                    response_options.compressed = true;
+                }
+
                 ql::datum_t authentication =
                     datum.get_field("authentication", ql::NOTHROW);
                 if (authentication.get_type() != ql::datum_t::R_STR) {
@@ -487,14 +566,19 @@ void query_server_t::handle_conn(const scoped_ptr_t<tcp_conn_descriptor_t> &ncon
                 ? ql::return_empty_normal_batches_t::YES
                 : ql::return_empty_normal_batches_t::NO,
             auth::user_context_t(authenticator->get_authenticated_username()));
-
-        connection_loop<json_protocol_t>(
-            conn.get(),
-            (version < 4)
-                ? 1
-                : 1024,
-            &query_cache,
-            &ct_keepalive);
+        query_cache.set_connection(conn.get());
+
+        const size_t max_concurrent_queries =
+            (version < 4) ? 1 : options.max_queries_per_connection;
+        if (binary_responses) {
+            connection_loop<binary_protocol_t>(
+                conn.get(), max_concurrent_queries, response_options, &query_cache,
+                &ct_keepalive);
+        } else {
+            connection_loop<json_protocol_t>(
+                conn.get(), max_concurrent_queries, response_options, &query_cache,
+                &ct_keepalive);
+        }
     } catch (client_protocol::client_server_error_t const &error) {
         // We can't write the response here due to coroutine switching inside an
         // exception handler
@@ -591,6 +675,7 @@ void save_exception(std::exception_ptr *err,
 template <class protocol_t>
 void query_server_t::connection_loop(tcp_conn_t *conn,
                                      size_t max_concurrent_queries,
+                                     const response_options_t &response_options,
                                      ql::query_cache_t *query_cache,
                                      signal_t *drain_signal) {
     std::exception_ptr err;
@@ -611,7 +696,7 @@ void query_server_t::connection_loop(tcp_conn_t *conn,
     auto_drainer_t coro_drainer;
     while (!err) {
         scoped_ptr_t<ql::query_params_t> outer_query =
-            protocol_t::parse_query(conn, &interruptor, query_cache);
+            protocol_t::parse_query(conn, &interruptor, query_cache, response_options);
         if (outer_query.has()) {
             outer_query->throttler.init(&sem, 1);
             wait_interruptible(outer_query->throttler.acquisition_signal(),
@@ -627,11 +712,28 @@ void query_server_t::connection_loop(tcp_conn_t *conn,
                 bool replied = false;
 
                 save_exception(&err, &err_str, &abort, [&]() {
-                    handler->run_query(query.get(), &response, &cb_interruptor);
+                    {
+                        // Only new queries go through admission control, so that
+                        // the ones that already run can finish.
+                        admission_controller_t::ticket_t admission;
+                        if (admission_controllers.has()
+                                && query->type == Query::START
+                                && !admission_controllers->get()->admit(
+                                    query->priority, &admission, &cb_interruptor)) {
+                            response.fill_error(
+                                Response::RUNTIME_ERROR,
+                                Response::OP_FAILED,
+                                "The server is overloaded.  Try the query again later.",
+                                ql::backtrace_registry_t::EMPTY_BACKTRACE);
+                        } else {
+                            handler->run_query(query.get(), &response, &cb_interruptor);
+                        }
+                    }
                     if (!query->noreply) {
                         new_mutex_acq_t send_lock(&send_mutex, &cb_interruptor);
                         protocol_t::send_response(&response, query->token,
-                                                  conn, &cb_interruptor);
+                                                  conn, response_options,
+                                                  &cb_interruptor);
                         replied = true;
                     }
                 });
@@ -641,15 +743,22 @@ void query_server_t::connection_loop(tcp_conn_t *conn,
                                             err_str, &response);
                         new_mutex_acq_t send_lock(&send_mutex, drain_signal);
                         protocol_t::send_response(&response, query->token,
-                                                  conn, &cb_interruptor);
+                                                  conn, response_options,
+                                                  &cb_interruptor);
                     }
                 });
             });
             guarantee(!outer_query.has());
             // Since we're using `spawn_now_dangerously` above, we need to yield
             // here to stop a client sending a constant stream of expensive queries
-            // from stalling the thread.
-            coro_t::yield();
+            // from stalling the thread.  When pipelining, the next query is usually
+            // already in the read buffer, so we only yield once the time budget of
+            // this coroutine has run out.
+            if (options.pipelining) {
+                coro_t::maybe_yield();
+            } else {
+                coro_t::yield();
+            }
         }
     }
 
@@ -696,12 +805,12 @@ void query_server_t::handle(const http_req_t &req,
     }
 
     // Copy the body into a mutable buffer so we can move it into parse_json_pb.
-    scoped_array_t<char> body_buf(req.body.size() + 1);
-    memcpy(body_buf.data(), req.body.data(), req.body.size());
-    body_buf[req.body.size()] = '\0';
+    counted_t<shared_buf_t> body_buf = shared_buf_t::create(req.body.size() + 1);
+    memcpy(body_buf->data(), req.body.data(), req.body.size());
+    body_buf->data()[req.body.size()] = '\0';
 
     // Parse the token out from the start of the request
-    char *data = body_buf.data();
+    char *data = body_buf->data();
     token = *reinterpret_cast<const int64_t *>(data);
 #ifdef __s390x__
     token = __builtin_bswap64(token);
@@ -14,8 +14,10 @@
 #include "arch/io/openssl.hpp"
 #include "arch/runtime/runtime.hpp"
 #include "arch/timing.hpp"
+#include "client_protocol/admission_control.hpp"
 #include "concurrency/auto_drainer.hpp"
 #include "concurrency/cross_thread_signal.hpp"
+#include "concurrency/one_per_thread.hpp"
 #include "containers/archive/archive.hpp"
 #include "containers/counted.hpp"
 #include "http/http.hpp"
@@ -23,6 +25,7 @@
 #include "utils.hpp"
 
 class auth_key_t;
+struct response_options_t;
 
 class rdb_context_t;
 namespace ql {
@@ -95,6 +98,27 @@ public:
                            signal_t *interruptor) = 0;
 };
 
+/* How the driver port accepts connections and runs their queries. */
+struct query_server_options_t {
+    query_server_options_t()
+        : reuse_port(false), max_queries_per_connection(1024), pipelining(false),
+          admission_control(false) { }
+
+    // Whether every thread accepts connections on its own `SO_REUSEPORT` socket.
+    bool reuse_port;
+    // How many queries of one connection may run at the same time.  Connections with
+    // a protocol version before V1_0 always run their queries one after the other.
+    size_t max_queries_per_connection;
+    /* Whether responses are buffered and flushed by the connection's write coroutine
+    instead of being written before the next response can go out.  Clients that send
+    many small queries without waiting for the answers get their responses in fewer
+    system calls this way. */
+    bool pipelining;
+    /* Whether new queries wait for or are refused a slot of the thread's
+    `admission_controller_t` before they run. */
+    bool admission_control;
+};
+
 class query_server_t : public http_app_t {
 public:
     query_server_t(
@@ -103,7 +127,8 @@ public:
         int port,
         query_handler_t *_handler,
         uint32_t http_timeout_sec,
-        tls_ctx_t* tls_ctx);
+        tls_ctx_t* tls_ctx,
+        const query_server_options_t &options = query_server_options_t());
     ~query_server_t();
 
     int get_port() const;
@@ -114,6 +139,10 @@ private:
                              const std::string &err,
                              ql::response_t *response_out);
 
+    // Picks the thread with the fewest driver connections for a new one.  Not used
+    // with `reuse_port`.
+    threadnum_t choose_thread();
+
     // For the client driver socket
     void handle_conn(const scoped_ptr_t<tcp_conn_descriptor_t> &nconn,
                      auto_drainer_t::lock_t);
@@ -122,6 +151,7 @@ private:
     template<class protocol_t>
     void connection_loop(tcp_conn_t *conn,
                          size_t max_concurrent_queries,
+                         const response_options_t &response_options,
                          ql::query_cache_t *query_cache,
                          signal_t *interruptor);
 
@@ -133,12 +163,26 @@ private:
     tls_ctx_t *tls_ctx;
     rdb_context_t *const rdb_ctx;
     query_handler_t *const handler;
+    const query_server_options_t options;
+
+    // Only with `options.admission_control`.  These must outlive the connections.
+    scoped_ptr_t<one_per_thread_t<admission_controller_t> > admission_controllers;
 
     /* WARNING: The order here is fragile. */
     auto_drainer_t drainer;
     http_conn_cache_t http_conn_cache;
     scoped_ptr_t<tcp_listener_t> tcp_listener;
 
+    /* With `reuse_port`, we have a listener on every thread instead of `tcp_listener`,
+    and each connection stays on the thread that accepted it and gets drained through
+    the drainer of that thread. */
+    scoped_ptr_t<one_per_thread_t<auto_drainer_t> > thread_drainers;
+    scoped_ptr_t<per_thread_tcp_listener_t> per_thread_listener;
+
+    // The number of driver connections on each thread.  A connection's queries run on
+    // its thread, so balancing them keeps cores from idling while one is overloaded.
+    std::vector<int> connections_per_thread;
+    // Where `choose_thread` starts looking, so that ties are broken round-robin.
     int next_thread;
 };
 
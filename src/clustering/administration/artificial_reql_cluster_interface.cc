@@ -820,6 +820,20 @@ artificial_reql_cluster_backends_t::artificial_reql_cluster_backends_t(
         name_string_t::guarantee_valid("jobs"),
         std::make_pair(jobs_backend[0].get(), jobs_backend[1].get()));
 
+    for (int format = 0; format < 2; ++format) {
+        slow_queries_backend[format].init(
+            new slow_queries_artificial_table_backend_t(
+                rdb_context,
+                name_resolver,
+                mailbox_manager,
+                directory_map_view,
+                static_cast<admin_identifier_format_t>(format)));
+    }
+    slow_queries_sentry = backend_sentry_t(
+        artificial_reql_cluster_interface->get_table_backends_map_mutable(),
+        name_string_t::guarantee_valid("slow_queries"),
+        std::make_pair(slow_queries_backend[0].get(), slow_queries_backend[1].get()));
+
     debug_scratch_backend.init(
         new in_memory_artificial_table_backend_t(
             name_string_t::guarantee_valid("_debug_scratch"),
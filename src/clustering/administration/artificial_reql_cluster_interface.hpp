@@ -11,6 +11,7 @@
 #include "clustering/administration/servers/server_config.hpp"
 #include "clustering/administration/servers/server_status.hpp"
 #include "clustering/administration/stats/debug_stats_backend.hpp"
+#include "clustering/administration/stats/slow_queries_backend.hpp"
 #include "clustering/administration/stats/stats_backend.hpp"
 #include "clustering/administration/tables/db_config.hpp"
 #include "clustering/administration/tables/debug_table_status.hpp"
@@ -339,6 +340,9 @@ private:
     scoped_ptr_t<jobs_artificial_table_backend_t> jobs_backend[2];
     backend_sentry_t jobs_sentry;
 
+    scoped_ptr_t<slow_queries_artificial_table_backend_t> slow_queries_backend[2];
+    backend_sentry_t slow_queries_sentry;
+
     scoped_ptr_t<in_memory_artificial_table_backend_t> debug_scratch_backend;
     backend_sentry_t debug_scratch_sentry;
 
@@ -7,14 +7,15 @@
 #include "clustering/administration/auth/authentication_error.hpp"
 #include "clustering/administration/auth/username.hpp"
 #include "clustering/administration/metadata.hpp"
+#include "concurrency/per_thread_snapshot.hpp"
 
 namespace auth {
 
 class base_authenticator_t {
 public:
-    base_authenticator_t(
-            clone_ptr_t<watchable_t<auth_semilattice_metadata_t>> auth_watchable)
-        : m_auth_watchable(auth_watchable) {
+    explicit base_authenticator_t(
+            per_thread_snapshot_t<auth_semilattice_metadata_t> *auth_snapshot)
+        : m_auth_snapshot(auth_snapshot) {
     }
     virtual ~base_authenticator_t() {
     }
@@ -25,7 +26,7 @@ public:
             THROWS_ONLY(authentication_error_t) = 0;
 
 protected:
-    clone_ptr_t<watchable_t<auth_semilattice_metadata_t>> m_auth_watchable;
+    per_thread_snapshot_t<auth_semilattice_metadata_t> *m_auth_snapshot;
 };
 
 }  // namespace auth
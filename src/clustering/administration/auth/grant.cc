@@ -4,6 +4,7 @@
 #include "clustering/administration/admin_op_exc.hpp"
 #include "clustering/administration/auth/user.hpp"
 #include "clustering/administration/metadata.hpp"
+#include "concurrency/per_thread_snapshot.hpp"
 #include "rpc/semilattice/view.hpp"
 
 namespace auth {
@@ -76,7 +77,7 @@ bool grant(
     auth_semilattice_view->join(auth_metadata);
 
     // Wait for the metadata to propegate
-    rdb_context->get_auth_watchable()->run_until_satisfied(
+    rdb_context->get_auth_snapshot()->run_until_satisfied(
         [&](auth_semilattice_metadata_t const &metadata) -> bool {
             auth_semilattice_metadata_t copy = metadata;
             semilattice_join(&copy, auth_metadata);
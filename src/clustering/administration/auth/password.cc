@@ -1,9 +1,13 @@
 // Copyright 2010-2015 RethinkDB, all rights reserved.
 #include "clustering/administration/auth/password.hpp"
 
+#include <exception>
+
 #include "errors.hpp"
 #include <boost/algorithm/string/join.hpp>
 
+#include "arch/runtime/coroutines.hpp"
+#include "arch/runtime/thread_pool.hpp"
 #include "clustering/administration/admin_op_exc.hpp"
 #include "containers/archive/stl_types.hpp"
 #include "crypto/pbkcs5_pbkdf2_hmac.hpp"
@@ -17,7 +21,7 @@ password_t::password_t() {
 password_t::password_t(std::string const &password, uint32_t iteration_count)
     : m_iteration_count(iteration_count),
       m_salt(crypto::random_bytes<salt_length>()),
-      m_hash(crypto::pbkcs5_pbkdf2_hmac_sha256(password, m_salt, m_iteration_count)),
+      m_hash(compute_hash(password, m_salt, m_iteration_count)),
       m_is_empty(password.empty()) {
 }
 
@@ -64,8 +68,7 @@ password_t::password_t(ql::datum_t const &datum) {
             query_state_t::FAILED);
     }
     keys.erase("password");
-    m_hash = crypto::pbkcs5_pbkdf2_hmac_sha256(
-        password.as_str().to_std(), m_salt, m_iteration_count);
+    m_hash = compute_hash(password.as_str().to_std(), m_salt, m_iteration_count);
     m_is_empty = password.as_str().to_std().empty();
 
     if (!keys.empty()) {
@@ -84,6 +87,29 @@ password_t::password_t(ql::datum_t const &datum) {
     return password;
 }
 
+/* static */ std::array<unsigned char, SHA256_DIGEST_LENGTH> password_t::compute_hash(
+        std::string const &password,
+        std::array<unsigned char, salt_length> const &salt,
+        uint32_t iteration_count) {
+    if (coro_t::self() == nullptr) {
+        return crypto::pbkcs5_pbkdf2_hmac_sha256(password, salt, iteration_count);
+    }
+
+    std::array<unsigned char, SHA256_DIGEST_LENGTH> hash;
+    std::exception_ptr error;
+    thread_pool_t::run_in_blocker_pool([&]() {
+        try {
+            hash = crypto::pbkcs5_pbkdf2_hmac_sha256(password, salt, iteration_count);
+        } catch (...) {
+            error = std::current_exception();
+        }
+    });
+    if (error) {
+        std::rethrow_exception(error);
+    }
+    return hash;
+}
+
 uint32_t password_t::get_iteration_count() const {
     return m_iteration_count;
 }
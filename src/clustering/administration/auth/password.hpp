@@ -26,6 +26,14 @@ public:
 
     static password_t generate_password_for_unknown_user();
 
+    /* Computes the SCRAM salted password.  With the default iteration count that
+    takes milliseconds, so in a coroutine this runs in the blocker pool instead of
+    holding up the rest of the thread. */
+    static std::array<unsigned char, SHA256_DIGEST_LENGTH> compute_hash(
+        std::string const &password,
+        std::array<unsigned char, salt_length> const &salt,
+        uint32_t iteration_count);
+
     uint32_t get_iteration_count() const;
     std::array<unsigned char, salt_length> const &get_salt() const;
     std::array<unsigned char, SHA256_DIGEST_LENGTH> const &get_hash() const;
@@ -4,15 +4,14 @@
 #include "clustering/administration/auth/authentication_error.hpp"
 #include "clustering/administration/metadata.hpp"
 #include "crypto/compare_equal.hpp"
-#include "crypto/pbkcs5_pbkdf2_hmac.hpp"
 #include "crypto/saslprep.hpp"
 
 namespace auth {
 
 plaintext_authenticator_t::plaintext_authenticator_t(
-        clone_ptr_t<watchable_t<auth_semilattice_metadata_t>> auth_watchable,
+        per_thread_snapshot_t<auth_semilattice_metadata_t> *auth_snapshot,
         username_t const &username)
-    : base_authenticator_t(auth_watchable),
+    : base_authenticator_t(auth_snapshot),
       m_username(username),
       m_is_authenticated(false) {
 }
@@ -21,7 +20,7 @@ plaintext_authenticator_t::plaintext_authenticator_t(
         std::string const &password) THROWS_ONLY(authentication_error_t) {
     optional<user_t> user;
 
-    m_auth_watchable->apply_read(
+    m_auth_snapshot->apply_read(
         [&](auth_semilattice_metadata_t const *auth_metadata) {
             auto iter = auth_metadata->m_users.find(m_username);
             if (iter != auth_metadata->m_users.end()) {
@@ -35,7 +34,7 @@ plaintext_authenticator_t::plaintext_authenticator_t(
     }
 
     std::array<unsigned char, SHA256_DIGEST_LENGTH> hash =
-        crypto::pbkcs5_pbkdf2_hmac_sha256(
+        password_t::compute_hash(
             crypto::saslprep(password),
             user->get_password().get_salt(),
             user->get_password().get_iteration_count());
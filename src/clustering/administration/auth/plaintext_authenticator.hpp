@@ -12,7 +12,7 @@ namespace auth {
 class plaintext_authenticator_t : public base_authenticator_t {
 public:
     plaintext_authenticator_t(
-        clone_ptr_t<watchable_t<auth_semilattice_metadata_t>> auth_watchable,
+        per_thread_snapshot_t<auth_semilattice_metadata_t> *auth_snapshot,
         username_t const &username = username_t("admin"));
 
     /* virtual */ std::string next_message(std::string const &)
@@ -13,8 +13,8 @@
 namespace auth {
 
 scram_authenticator_t::scram_authenticator_t(
-        clone_ptr_t<watchable_t<auth_semilattice_metadata_t>> auth_watchable)
-    : base_authenticator_t(auth_watchable),
+        per_thread_snapshot_t<auth_semilattice_metadata_t> *auth_snapshot)
+    : base_authenticator_t(auth_snapshot),
       m_state(state_t::FIRST_MESSAGE) {
 }
 
@@ -54,7 +54,7 @@ std::string scram_authenticator_t::next_message(std::string const &message)
                     throw authentication_error_t(10, "Invalid encoding");
                 }
 
-                m_auth_watchable->apply_read(
+                m_auth_snapshot->apply_read(
                     [&](auth_semilattice_metadata_t const *auth_metadata) {
                         auto user = auth_metadata->m_users.find(m_username);
                         if (user == auth_metadata->m_users.end() ||
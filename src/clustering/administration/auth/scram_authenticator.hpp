@@ -15,7 +15,7 @@ namespace auth {
 class scram_authenticator_t : public base_authenticator_t {
 public:
     scram_authenticator_t(
-        clone_ptr_t<watchable_t<auth_semilattice_metadata_t>> auth_watchable);
+        per_thread_snapshot_t<auth_semilattice_metadata_t> *auth_snapshot);
 
     /* virtual */ std::string next_message(std::string const &)
             THROWS_ONLY(authentication_error_t);
@@ -2,6 +2,7 @@
 #include "clustering/administration/auth/user_context.hpp"
 
 #include "clustering/administration/metadata.hpp"
+#include "concurrency/per_thread_snapshot.hpp"
 #include "containers/archive/boost_types.hpp"
 #include "rdb_protocol/context.hpp"
 
@@ -59,7 +60,7 @@ void require_permission_internal(
         }
         // The admin user always has the permission
         if (!username->is_admin()) {
-            rdb_context->get_auth_watchable()->apply_read(
+            rdb_context->get_auth_snapshot()->apply_read(
                 [&](auth_semilattice_metadata_t const *auth_metadata) {
                     auto user = auth_metadata->m_users.find(*username);
                     if (user == auth_metadata->m_users.end() ||
@@ -0,0 +1,48 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#include "clustering/administration/http/coro_sampler_app.hpp"
+
+#include <inttypes.h>
+
+#include <string>
+
+#include "arch/runtime/coro_sampler.hpp"
+#include "utils.hpp"
+
+void coro_sampler_http_app_t::handle(
+        const http_req_t &req, http_res_t *result, signal_t *) {
+    coro_sampler_t *sampler = &coro_sampler_t::get_global_sampler();
+    if (req.method == http_method_t::GET) {
+        result->set_body("text/plain", sampler->get_folded_stacks());
+        result->code = http_status_code_t::OK;
+        return;
+    }
+    if (req.method != http_method_t::POST) {
+        *result = http_error_res("Only GET and POST are supported.\n",
+                                 http_status_code_t::METHOD_NOT_ALLOWED);
+        return;
+    }
+
+    optional<std::string> interval_param = req.find_query_param("sample_interval");
+    uint64_t interval = 0;
+    if (interval_param && !strtou64_strict(*interval_param, 10, &interval)) {
+        *result = http_error_res("Expected a non-negative integer for "
+                                 "\"sample_interval\".\n");
+        return;
+    }
+    optional<std::string> reset_param = req.find_query_param("reset");
+    if (reset_param && *reset_param != "true" && *reset_param != "false") {
+        *result = http_error_res("Expected \"true\" or \"false\" for \"reset\".\n");
+        return;
+    }
+
+    if (interval_param) {
+        sampler->set_sample_interval(interval);
+    }
+    if (reset_param && *reset_param == "true") {
+        sampler->reset();
+    }
+    result->set_body("text/plain",
+                     strprintf("sample_interval=%" PRIu64 "\n",
+                               sampler->get_sample_interval()));
+    result->code = http_status_code_t::OK;
+}
@@ -0,0 +1,16 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#ifndef CLUSTERING_ADMINISTRATION_HTTP_CORO_SAMPLER_APP_HPP_
+#define CLUSTERING_ADMINISTRATION_HTTP_CORO_SAMPLER_APP_HPP_
+
+#include "http/http.hpp"
+
+/* This is an `http_app_t` that exposes the `coro_sampler_t`.  A GET returns the
+ * recorded samples as folded stacks, ready to be fed to `flamegraph.pl`.  A POST
+ * with `sample_interval=N` samples every Nth coroutine wait from then on, where N = 0
+ * turns sampling off, and a POST with `reset=true` throws away the samples so far. */
+class coro_sampler_http_app_t : public http_app_t {
+public:
+    void handle(const http_req_t &req, http_res_t *result, signal_t *interruptor);
+};
+
+#endif /* CLUSTERING_ADMINISTRATION_HTTP_CORO_SAMPLER_APP_HPP_ */
@@ -0,0 +1,106 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#include "clustering/administration/http/metrics_app.hpp"
+
+#include <cmath>
+
+#include <map>
+#include <vector>
+
+#include "containers/uuid.hpp"
+#include "perfmon/collect.hpp"
+#include "utils.hpp"
+
+/* Metric names may only contain letters, digits, underscores and colons. */
+static std::string sanitize_metric_name_part(const std::string &part) {
+    std::string result = part;
+    for (char &c : result) {
+        if (!((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+              (c >= '0' && c <= '9') || c == '_' || c == ':')) {
+            c = '_';
+        }
+    }
+    return result;
+}
+
+static std::string format_metric_value(double value) {
+    if (std::isnan(value)) {
+        return "NaN";
+    } else if (std::isinf(value)) {
+        return value > 0 ? "+Inf" : "-Inf";
+    }
+    return strprintf("%.17g", value);
+}
+
+/* Maps the name of every metric family to its samples, which must be output together
+even though the samples of different tables are far apart in the perfmon tree. */
+typedef std::map<std::string, std::vector<std::string> > metric_families_t;
+
+static void collect_metrics(const ql::datum_t &stat,
+                            const std::string &name,
+                            const std::string &labels,
+                            metric_families_t *families) {
+    switch (stat.get_type()) {
+    case ql::datum_t::R_OBJECT:
+        for (size_t i = 0; i < stat.obj_size(); ++i) {
+            std::pair<datum_string_t, ql::datum_t> pair = stat.get_pair(i);
+            const std::string key = pair.first.to_std();
+            uuid_u table_id;
+            if (name == "rethinkdb" && labels.empty() && str_to_uuid(key, &table_id)) {
+                collect_metrics(pair.second, name,
+                                strprintf("table=\"%s\"", uuid_to_str(table_id).c_str()),
+                                families);
+            } else {
+                collect_metrics(pair.second, name + "_" + sanitize_metric_name_part(key),
+                                labels, families);
+            }
+        }
+        break;
+    case ql::datum_t::R_NUM:
+    case ql::datum_t::R_BOOL: {
+        const double value = stat.get_type() == ql::datum_t::R_NUM
+            ? stat.as_num()
+            : (stat.as_bool() ? 1 : 0);
+        (*families)[name].push_back(
+            strprintf("%s%s%s%s %s\n", name.c_str(), labels.empty() ? "" : "{",
+                      labels.c_str(), labels.empty() ? "" : "}",
+                      format_metric_value(value).c_str()));
+    } break;
+    case ql::datum_t::R_NULL:
+    case ql::datum_t::R_STR:
+    case ql::datum_t::R_ARRAY:
+    case ql::datum_t::R_BINARY:
+    case ql::datum_t::MINVAL:
+    case ql::datum_t::MAXVAL:
+        // Nulls, strings and arrays don't make sense as metrics.
+        break;
+    case ql::datum_t::UNINITIALIZED:
+    default:
+        unreachable();
+    }
+}
+
+std::string perfmon_stats_to_openmetrics(const ql::datum_t &stats) {
+    metric_families_t families;
+    collect_metrics(stats, "rethinkdb", "", &families);
+    std::string result;
+    for (const auto &family : families) {
+        result += strprintf("# TYPE %s gauge\n", family.first.c_str());
+        for (const std::string &sample : family.second) {
+            result += sample;
+        }
+    }
+    result += "# EOF\n";
+    return result;
+}
+
+void metrics_http_app_t::handle(
+        const http_req_t &req, http_res_t *result, signal_t *) {
+    if (req.method != http_method_t::GET) {
+        *result = http_error_res("Only GET is supported.\n",
+                                 http_status_code_t::METHOD_NOT_ALLOWED);
+        return;
+    }
+    result->set_body("application/openmetrics-text; version=1.0.0; charset=utf-8",
+                     perfmon_stats_to_openmetrics(perfmon_get_stats()));
+    result->code = http_status_code_t::OK;
+}
@@ -0,0 +1,26 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#ifndef CLUSTERING_ADMINISTRATION_HTTP_METRICS_APP_HPP_
+#define CLUSTERING_ADMINISTRATION_HTTP_METRICS_APP_HPP_
+
+#include <string>
+
+#include "http/http.hpp"
+#include "rdb_protocol/datum.hpp"
+
+/* This is an `http_app_t` that exposes this server's perfmons to Prometheus and other
+ * scrapers that understand the OpenMetrics text format.  A GET collects the perfmons
+ * directly, without going through ReQL and the `stats` table like a query on
+ * `rethinkdb.stats` would, so it is cheap enough to be scraped every few seconds. */
+class metrics_http_app_t : public http_app_t {
+public:
+    void handle(const http_req_t &req, http_res_t *result, signal_t *interruptor);
+};
+
+/* Turns the output of `perfmon_get_stats()` into OpenMetrics text.  Every number in
+ * the tree becomes a gauge named after its path, prefixed with `rethinkdb_`; booleans
+ * become 0 or 1 and everything else is left out.  Table ids, which are the top level
+ * keys of the per-table perfmons, become a `table` label so that the same stat of
+ * different tables ends up in one metric family. */
+std::string perfmon_stats_to_openmetrics(const ql::datum_t &stats);
+
+#endif /* CLUSTERING_ADMINISTRATION_HTTP_METRICS_APP_HPP_ */
@@ -92,7 +92,7 @@ void jobs_manager_t::on_get_job_reports(
 
                     std::string render = pprint::pretty_print_as_js(
                         printed_query_columns,
-                        pair.second->term_storage->root_term());
+                        pair.second->compiled_query->term_storage->root_term());
 
                     query_job_reports_inner.emplace_back(
                         pair.second->job_id,
@@ -100,7 +100,9 @@ void jobs_manager_t::on_get_job_reports(
                         server_id,
                         query_cache->get_client_addr_port(),
                         std::move(render),
-                        query_cache->get_user_context());
+                        query_cache->get_user_context(),
+                        pair.second->prefetched_size,
+                        query_cache->get_buffered_size());
                 }
             }
         }
@@ -219,7 +219,9 @@ RDB_IMPL_SERIALIZABLE_9_FOR_CLUSTER(
     progress_denominator);
 
 query_job_report_t::query_job_report_t()
-    : job_report_base_t<query_job_report_t>() { }
+    : job_report_base_t<query_job_report_t>(),
+      buffered_bytes(0),
+      connection_buffered_bytes(0) { }
 
 query_job_report_t::query_job_report_t(
         uuid_u const &_id,
@@ -227,11 +229,15 @@ query_job_report_t::query_job_report_t(
         server_id_t const &_server_id,
         ip_and_port_t const &_client_addr_port,
         std::string const &_query,
-        auth::user_context_t const &_user_context)
+        auth::user_context_t const &_user_context,
+        int64_t _buffered_bytes,
+        int64_t _connection_buffered_bytes)
     : job_report_base_t<query_job_report_t>("query", _id, _duration, _server_id),
       client_addr_port(_client_addr_port),
       query(_query),
-      user_context(_user_context) { }
+      user_context(_user_context),
+      buffered_bytes(_buffered_bytes),
+      connection_buffered_bytes(_connection_buffered_bytes) { }
 
 void query_job_report_t::merge_derived(query_job_report_t const &) { }
 
@@ -248,12 +254,18 @@ bool query_job_report_t::info_derived(
     info_builder_out->overwrite("query", convert_string_to_datum(query));
     info_builder_out->overwrite(
         "user", convert_string_to_datum(user_context.to_string()));
+    info_builder_out->overwrite(
+        "buffered_bytes", ql::datum_t(static_cast<double>(buffered_bytes)));
+    info_builder_out->overwrite(
+        "connection_buffered_bytes",
+        ql::datum_t(static_cast<double>(connection_buffered_bytes)));
 
     return true;
 }
 
-RDB_IMPL_SERIALIZABLE_7_FOR_CLUSTER(
-    query_job_report_t, type, id, duration, servers, client_addr_port, query, user_context);
+RDB_IMPL_SERIALIZABLE_9_FOR_CLUSTER(
+    query_job_report_t, type, id, duration, servers, client_addr_port, query,
+    user_context, buffered_bytes, connection_buffered_bytes);
 
 RDB_IMPL_SERIALIZABLE_2_FOR_CLUSTER(jobs_manager_business_card_t,
                                     get_job_reports_mailbox_address,
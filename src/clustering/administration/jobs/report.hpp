@@ -140,7 +140,9 @@ public:
             server_id_t const &server_id,
             ip_and_port_t const &client_addr_port,
             std::string const &query,
-            auth::user_context_t const &user_context);
+            auth::user_context_t const &user_context,
+            int64_t buffered_bytes,
+            int64_t connection_buffered_bytes);
 
     void merge_derived(query_job_report_t const &job_report);
 
@@ -154,6 +156,10 @@ public:
     ip_and_port_t client_addr_port;
     std::string query;
     auth::user_context_t user_context;
+    // The data that the query, and all queries of its connection, hold on to until the
+    // client reads it; see `query_cache_t::get_buffered_size()`.
+    int64_t buffered_bytes;
+    int64_t connection_buffered_bytes;
 };
 RDB_DECLARE_SERIALIZABLE_FOR_CLUSTER(query_job_report_t);
 
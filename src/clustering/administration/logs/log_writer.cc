@@ -16,6 +16,7 @@
 #include "arch/io/disk/filestat.hpp"
 #include "arch/io/disk.hpp"
 #include "concurrency/promise.hpp"
+#include "config/args.hpp"
 #include "containers/scoped.hpp"
 #include "thread_local.hpp"
 
@@ -542,7 +543,10 @@ TLS_with_init(auto_drainer_t *, global_log_drainer, nullptr);
 TLS_with_init(int, log_writer_block, 0);
 
 thread_pool_log_writer_t::thread_pool_log_writer_t()
-        : has_parse_error(false) {
+        : last_message_repeats(0),
+          dropped_messages(0),
+          write_in_progress(false),
+          has_parse_error(false) {
     pmap(
         get_num_threads(),
         std::bind(&thread_pool_log_writer_t::install_on_thread, this, ph::_1));
@@ -616,21 +620,81 @@ void thread_pool_log_writer_t::uninstall_on_thread(int i) {
     TLS_set_global_log_drainer(nullptr);
 }
 
-void thread_pool_log_writer_t::write(const log_message_t &lm) {
-    mutex_t::acq_t write_mutex_acq(&write_mutex);
-    std::string error_message;
-    bool ok;
-    thread_pool_t::run_in_blocker_pool(std::bind(&thread_pool_log_writer_t::write_blocking, this, lm, &error_message, &ok));
-    if (ok) {
-        log_write_issue_tracker.report_success();
+void thread_pool_log_writer_t::write(log_level_t level, const std::string &message) {
+    assert_thread();
+    /* A component that got into a bad state often logs the same message over and
+    over. We write such a run of messages once, followed by a note of how often it was
+    repeated. */
+    if (!pending_messages.empty()
+            && pending_messages.back().level == level
+            && pending_messages.back().message == message) {
+        ++last_message_repeats;
     } else {
-        log_write_issue_tracker.report_error(error_message);
+        note_repeats();
+        if (pending_messages.size() >= LOG_WRITER_MAX_PENDING_MESSAGES) {
+            ++dropped_messages;
+        } else {
+            pending_messages.push_back(
+                fallback_log_writer.assemble_log_message(level, message));
+        }
+    }
+
+    if (write_in_progress) {
+        /* The coroutine that is doing the write will pick up our message when it's
+        done. */
+        return;
     }
+    write_in_progress = true;
+    while (!pending_messages.empty() || last_message_repeats > 0
+            || dropped_messages > 0) {
+        note_repeats();
+        if (dropped_messages > 0) {
+            pending_messages.push_back(fallback_log_writer.assemble_log_message(
+                log_level_warn,
+                strprintf("%zu log messages were dropped because they were logged "
+                          "faster than they could be written to the log file.",
+                          dropped_messages)));
+            dropped_messages = 0;
+        }
+        std::vector<log_message_t> batch;
+        batch.swap(pending_messages);
+
+        std::string error_message;
+        bool ok;
+        thread_pool_t::run_in_blocker_pool(std::bind(
+            &thread_pool_log_writer_t::write_blocking,
+            this, std::cref(batch), &error_message, &ok));
+        if (ok) {
+            log_write_issue_tracker.report_success();
+        } else {
+            log_write_issue_tracker.report_error(error_message);
+        }
+    }
+    write_in_progress = false;
 }
 
-void thread_pool_log_writer_t::write_blocking(const log_message_t &msg, std::string *error_out, bool *ok_out) {
-    *ok_out = fallback_log_writer.write(msg, error_out);
-    return;
+void thread_pool_log_writer_t::note_repeats() {
+    if (last_message_repeats > 0) {
+        guarantee(!pending_messages.empty());
+        log_level_t level = pending_messages.back().level;
+        pending_messages.push_back(fallback_log_writer.assemble_log_message(
+            level,
+            strprintf("The previous message was repeated %zu more times.",
+                      last_message_repeats)));
+        last_message_repeats = 0;
+    }
+}
+
+void thread_pool_log_writer_t::write_blocking(
+        const std::vector<log_message_t> &msgs, std::string *error_out, bool *ok_out) {
+    *ok_out = true;
+    for (const log_message_t &msg : msgs) {
+        std::string error;
+        if (!fallback_log_writer.write(msg, &error)) {
+            *ok_out = false;
+            *error_out = error;
+        }
+    }
 }
 
 void thread_pool_log_writer_t::tail_blocking(
@@ -697,8 +761,7 @@ void thread_pool_log_writer_t::tail_blocking(
 void log_coro(thread_pool_log_writer_t *writer, log_level_t level, const std::string &message, auto_drainer_t::lock_t) {
     on_thread_t thread_switcher(writer->home_thread());
 
-    log_message_t log_msg = fallback_log_writer.assemble_log_message(level, message);
-    writer->write(log_msg);
+    writer->write(level, message);
 }
 
 /* Declared in `logger.hpp`, not `clustering/administration/logs/logger.hpp` like the
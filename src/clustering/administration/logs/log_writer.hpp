@@ -81,8 +81,9 @@ private:
     friend void vlog_internal(const char *src_file, int src_line, log_level_t level, const char *format, va_list args);
     void install_on_thread(int i);
     void uninstall_on_thread(int i);
-    void write(const log_message_t &msg);
-    void write_blocking(const log_message_t &msg, std::string *error_out, bool *ok_out);
+    void write(log_level_t level, const std::string &message);
+    void note_repeats();
+    void write_blocking(const std::vector<log_message_t> &msgs, std::string *error_out, bool *ok_out);
     void tail_blocking(int max_lines,
                        struct timespec min_timestamp,
                        struct timespec max_timestamp,
@@ -91,7 +92,16 @@ private:
                        std::string *error_out,
                        bool *ok_out);
 
-    mutex_t write_mutex;
+    /* Messages that are waiting to be written to the log file. Whichever `log_coro()`
+    finds no write in progress writes them out in batches, one blocker pool call per
+    batch, until none are left. `last_message_repeats` counts how many more times the
+    last of them has been logged since, and `dropped_messages` how many messages were
+    discarded because `pending_messages` was full. */
+    std::vector<log_message_t> pending_messages;
+    size_t last_message_repeats;
+    size_t dropped_messages;
+    bool write_in_progress;
+
     log_write_issue_tracker_t log_write_issue_tracker;
     bool has_parse_error;
 
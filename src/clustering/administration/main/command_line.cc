@@ -71,6 +71,7 @@
 #include "arch/io/disk.hpp"
 #include "arch/io/openssl.hpp"
 #include "arch/os_signal.hpp"
+#include "arch/runtime/numa.hpp"
 #include "arch/runtime/starter.hpp"
 #include "arch/filesystem.hpp"
 
@@ -93,6 +94,7 @@
 #include "clustering/administration/servers/server_metadata.hpp"
 #include "containers/scoped.hpp"
 #include "crypto/random.hpp"
+#include "crypto/session_tickets.hpp"
 #include "logger.hpp"
 
 // The python driver was renamed
@@ -920,6 +922,35 @@ bool initialize_tls_ctx(
         tls_ctx_out->get(),
         SSL_OP_CIPHER_SERVER_PREFERENCE|SSL_OP_SINGLE_DH_USE|SSL_OP_SINGLE_ECDH_USE);
 
+    /* With kernel TLS, OpenSSL hands the session keys to the kernel after the
+    handshake, and the kernel does the record encryption. That takes the crypto off
+    the event loop threads. OpenSSL only does this for cipher suites that the kernel
+    supports, and falls back to encrypting in user space otherwise. */
+    if (exists_option(opts, "--tls-ktls")) {
+#ifdef SSL_OP_ENABLE_KTLS
+        SSL_CTX_set_options(tls_ctx_out->get(), SSL_OP_ENABLE_KTLS);
+#else
+        logWRN("This build's OpenSSL doesn't support kernel TLS; ignoring --tls-ktls.");
+#endif
+    }
+
+    /* Drivers that reconnect can resume their TLS session from a ticket and skip the
+    key exchange. We encrypt the tickets with keys that we replace regularly rather
+    than with OpenSSL's default key, which lives as long as the process. */
+    int64_t ticket_lifetime_secs = 3600;
+    if (exists_option(opts, "--tls-session-ticket-lifetime")) {
+        ticket_lifetime_secs = get_single_int(opts, "--tls-session-ticket-lifetime");
+        if (ticket_lifetime_secs <= 0) {
+            logERR("--tls-session-ticket-lifetime must be a positive number of seconds.");
+            return false;
+        }
+    }
+    if (!crypto::enable_session_ticket_rotation(
+            tls_ctx_out->get(), ticket_lifetime_secs)) {
+        ERR_print_errors_fp(stderr);
+        return false;
+    }
+
     /* This is pretty important. We want to use the most secure TLS cipher
     suite that we can. Our default list only allows ciphers suites which employ
     ECDHE (Elliptic Curve Diffie-Hellman with Ephemeral keys) for encryption
@@ -1445,10 +1476,40 @@ options::help_section_t get_file_options(std::vector<options::option_t> *options
                                              options::OPTIONAL_NO_PARAMETER));
     help.add("--direct-io", "use direct I/O for file access");
 #endif
+    options_out->push_back(options::option_t(options::names_t("--stripe-directory"),
+                                             options::OPTIONAL_REPEAT));
+    help.add("--stripe-directory path", "spread the files of new tables over this "
+             "directory and the data directory (may be repeated)");
+    options_out->push_back(options::option_t(options::names_t("--cold-directory"),
+                                             options::OPTIONAL_REPEAT));
+    help.add("--cold-directory path", "also spread the files of new tables over this "
+             "directory, and move data that hasn't been written to in a while there "
+             "(may be repeated)");
     options_out->push_back(options::option_t(options::names_t("--cache-size"),
                                              options::OPTIONAL));
     help.add("--cache-size mb", "total cache size (in megabytes) for the process. Can "
         "be 'auto'.");
+    options_out->push_back(options::option_t(options::names_t("--cache-eviction-policy"),
+                                             options::OPTIONAL,
+                                             "scan-resistant"));
+    help.add("--cache-eviction-policy policy", "how the cache picks the blocks it "
+             "evicts: 'scan-resistant' (the default) or 'access-time'");
+    options_out->push_back(
+        options::option_t(options::names_t("--cache-compressed-percent"),
+                          options::OPTIONAL,
+                          "0"));
+    help.add("--cache-compressed-percent n", "how much of the cache (in percent) may "
+             "hold compressed copies of evicted blocks");
+    options_out->push_back(options::option_t(options::names_t("--cache-huge-pages"),
+                                             options::OPTIONAL,
+                                             "off"));
+    help.add("--cache-huge-pages mode", "back the cache with 2MB pages: 'off' (the "
+             "default), 'transparent' or 'explicit' (needs vm.nr_hugepages)");
+    options_out->push_back(options::option_t(options::names_t("--block-compression"),
+                                             options::OPTIONAL,
+                                             "none"));
+    help.add("--block-compression codec", "compress the blocks that tables write to "
+             "disk: 'none' (the default) or 'zlib'");
     return help;
 }
 
@@ -1626,6 +1687,40 @@ options::help_section_t get_network_options(const bool join_required, std::vecto
                                              strprintf("%d", port_defaults::reql_port)));
     help.add("--driver-port port", "port for rebirthdb protocol client drivers");
 
+    options_out->push_back(options::option_t(options::names_t("--driver-reuse-port"),
+                                             options::OPTIONAL_NO_PARAMETER));
+    help.add("--driver-reuse-port", "accept client driver connections on every thread "
+             "with a separate SO_REUSEPORT socket, and keep each connection on the "
+             "thread that accepted it (Linux only)");
+
+    options_out->push_back(options::option_t(
+        options::names_t("--driver-max-queries-per-connection"),
+        options::OPTIONAL,
+        "1024"));
+    help.add("--driver-max-queries-per-connection n",
+             "the number of queries of one client driver connection that may run at "
+             "the same time");
+
+    options_out->push_back(options::option_t(options::names_t("--driver-pipelining"),
+                                             options::OPTIONAL_NO_PARAMETER));
+    help.add("--driver-pipelining", "buffer the responses to client driver queries and "
+             "send them in batches, for clients that send many queries without waiting "
+             "for the responses");
+
+    options_out->push_back(options::option_t(
+        options::names_t("--driver-admission-control"),
+        options::OPTIONAL_NO_PARAMETER));
+    help.add("--driver-admission-control", "refuse new client driver queries with a "
+             "retryable error while queries have to wait too long to start, instead of "
+             "letting the backlog grow");
+
+    options_out->push_back(options::option_t(options::names_t("--slow-query-threshold"),
+                                             options::OPTIONAL,
+                                             "1000"));
+    help.add("--slow-query-threshold ms", "log the queries that take at least this many "
+             "milliseconds to the `rethinkdb.slow_queries` table, or 0 to turn the slow "
+             "query log off");
+
     options_out->push_back(options::option_t(options::names_t("--port-offset", "-o"),
                                              options::OPTIONAL,
                                              strprintf("%d", port_defaults::port_offset)));
@@ -1639,6 +1734,18 @@ options::help_section_t get_network_options(const bool join_required, std::vecto
                                              options::OPTIONAL));
     help.add("--reql-http-proxy [protocol://]host[:port]", "HTTP proxy to use for performing `r.http(...)` queries, default port is 1080");
 
+    options_out->push_back(options::option_t(options::names_t("--hedge-outdated-reads"),
+                                             options::OPTIONAL_NO_PARAMETER));
+    help.add("--hedge-outdated-reads", "send reads with `read_mode: \"outdated\"` to a "
+             "second replica if the first one takes longer than 95% of its recent reads, "
+             "and use the answer that arrives first");
+
+    options_out->push_back(options::option_t(options::names_t("--lease-reads"),
+                                             options::OPTIONAL_NO_PARAMETER));
+    help.add("--lease-reads", "answer reads with `read_mode: \"single\"` from a "
+             "secondary replica on this server while it holds a read lease from the "
+             "primary, instead of asking the primary");
+
     options_out->push_back(options::option_t(options::names_t("--canonical-address"),
                                              options::OPTIONAL_REPEAT));
     help.add("--canonical-address host[:port]", "address that other rebirthdb instances will use to connect to us, can be specified multiple times");
@@ -1656,6 +1763,12 @@ options::help_section_t get_network_options(const bool join_required, std::vecto
                                                     "before giving up, the default is "
                                                     "24 hours");
 
+    options_out->push_back(options::option_t(options::names_t("--cluster-parallel-streams"),
+                                             options::OPTIONAL_NO_PARAMETER));
+    help.add("--cluster-parallel-streams", "open separate TCP connections to other "
+             "servers for query and backfill traffic, so that a large backfill doesn't "
+             "delay other messages");
+
     return help;
 }
 
@@ -1665,10 +1778,65 @@ options::help_section_t get_cpu_options(std::vector<options::option_t> *options_
                                              options::OPTIONAL,
                                              strprintf("%d", get_cpu_count())));
     help.add("-c [ --cores ] n", "the number of cores to use");
+    options_out->push_back(options::option_t(options::names_t("--event-loop-spin"),
+                                             options::OPTIONAL,
+                                             "0"));
+    help.add("--event-loop-spin usecs",
+             "how many microseconds an idle thread busy-polls for events before it "
+             "sleeps, trading CPU time for lower latency (Linux only, default 0)");
+    options_out->push_back(options::option_t(options::names_t("--timer-wheel"),
+                                             options::OPTIONAL_NO_PARAMETER));
+    help.add("--timer-wheel",
+             "keep each thread's timers in a timer wheel, which makes adding and "
+             "cancelling them cheaper but rounds them up to the next millisecond");
+    options_out->push_back(
+        options::option_t(options::names_t("--coroutine-stall-warning"),
+                          options::OPTIONAL,
+                          "0"));
+    help.add("--coroutine-stall-warning ms",
+             "log a warning with a backtrace when a coroutine keeps a thread busy for "
+             "longer than this many milliseconds without yielding (default 0, off)");
+    options_out->push_back(options::option_t(options::names_t("--event-loop-cpus"),
+                                             options::OPTIONAL));
+    help.add("--event-loop-cpus cpus",
+             "pin the event loop threads to these CPUs, one CPU per thread, given as "
+             "a list like 0-3,8 or as NUMA nodes like node:0 (Linux only)");
+    options_out->push_back(options::option_t(options::names_t("--utility-thread-cpus"),
+                                             options::OPTIONAL));
+    help.add("--utility-thread-cpus cpus",
+             "run the utility thread only on these CPUs (Linux only)");
+    options_out->push_back(options::option_t(options::names_t("--blocker-pool-cpus"),
+                                             options::OPTIONAL));
+    help.add("--blocker-pool-cpus cpus",
+             "run the threads that do blocking work such as disk I/O only on these "
+             "CPUs, preferably ones that the event loop threads don't use (Linux only)");
     return help;
 }
 
-MUST_USE bool parse_cores_option(const std::map<std::string, options::values_t> &opts,
+MUST_USE bool parse_cpu_set_option(const std::map<std::string, options::values_t> &opts,
+                                   const std::string &name,
+                                   std::vector<int> *cpus_out) {
+    optional<std::string> spec = get_optional_option(opts, name);
+    cpus_out->clear();
+    if (!spec) {
+        return true;
+    }
+    if (!parse_cpu_set(*spec, cpus_out)) {
+        fprintf(stderr, "ERROR: could not parse the CPU list given to %s\n",
+                name.c_str());
+        return false;
+    }
+    for (int cpu : *cpus_out) {
+        if (!is_cpu_available(cpu)) {
+            fprintf(stderr, "ERROR: CPU %d given to %s is not available\n",
+                    cpu, name.c_str());
+            return false;
+        }
+    }
+    return true;
+}
+
+MUST_USE bool parse_cpu_options(const std::map<std::string, options::values_t> &opts,
                                  int *num_workers_out) {
     int num_workers = get_single_int(opts, "--cores");
     if (num_workers <= 0 || num_workers > MAX_THREADS) {
@@ -1676,6 +1844,31 @@ MUST_USE bool parse_cores_option(const std::map<std::string, options::values_t>
         return false;
     }
     *num_workers_out = num_workers;
+
+    int spin_usecs = get_single_int(opts, "--event-loop-spin");
+    if (spin_usecs < 0) {
+        fprintf(stderr, "ERROR: event-loop-spin must not be negative\n");
+        return false;
+    }
+    set_event_loop_spin_usecs(spin_usecs);
+    set_use_timer_wheel(exists_option(opts, "--timer-wheel"));
+
+    int stall_warning_ms = get_single_int(opts, "--coroutine-stall-warning");
+    if (stall_warning_ms < 0) {
+        fprintf(stderr, "ERROR: coroutine-stall-warning must not be negative\n");
+        return false;
+    }
+    set_coroutine_stall_warning_ms(stall_warning_ms);
+
+    thread_placement_t placement;
+    if (!parse_cpu_set_option(opts, "--event-loop-cpus", &placement.event_loop_cpus)
+        || !parse_cpu_set_option(opts, "--utility-thread-cpus",
+                                 &placement.utility_thread_cpus)
+        || !parse_cpu_set_option(opts, "--blocker-pool-cpus",
+                                 &placement.blocker_pool_cpus)) {
+        return false;
+    }
+    set_thread_placement(placement);
     return true;
 }
 
@@ -1762,6 +1955,10 @@ options::help_section_t get_tls_options(std::vector<options::option_t> *options_
                                              options::OPTIONAL));
     options_out->push_back(options::option_t(options::names_t("--tls-dhparams"),
                                              options::OPTIONAL));
+    options_out->push_back(options::option_t(options::names_t("--tls-ktls"),
+                                             options::OPTIONAL_NO_PARAMETER));
+    options_out->push_back(options::option_t(
+        options::names_t("--tls-session-ticket-lifetime"), options::OPTIONAL));
     help.add(
         "--tls-min-protocol protocol",
         "the minimum TLS protocol version that the server accepts; options are "
@@ -1776,6 +1973,14 @@ options::help_section_t get_tls_options(std::vector<options::option_t> *options_
         "--tls-dhparams dhparams_filename",
         "provide parameters for DHE key agreement; REQUIRED if using DHE cipher suites; "
         "at least 2048-bit recommended");
+    help.add(
+        "--tls-ktls",
+        "let the kernel encrypt outgoing TLS traffic where the kernel and OpenSSL "
+        "support it (Linux only)");
+    help.add(
+        "--tls-session-ticket-lifetime seconds",
+        "how often the keys that encrypt TLS session tickets are replaced; a ticket "
+        "stays usable for up to twice this long; default is 3600");
 
     return help;
 }
@@ -1931,6 +2136,116 @@ file_direct_io_mode_t parse_direct_io_mode_option(const std::map<std::string, op
         file_direct_io_mode_t::buffered_desired;
 }
 
+// The stripe and cold directories have to exist already; they usually are mount
+// points of other devices.
+std::vector<base_path_t> parse_directories_option(
+        const std::map<std::string, options::values_t> &opts,
+        const std::string &option_name) {
+    std::vector<base_path_t> paths;
+    for (const std::string &dir : all_options(opts, option_name)) {
+        base_path_t path(dir);
+        if (!is_rw_directory(path)) {
+            throw std::runtime_error(strprintf(
+                    "ERROR: %s '%s' is not a writable directory",
+                    option_name.c_str(), dir.c_str()));
+        }
+        path.make_absolute();
+        recreate_temporary_directory(path);
+        paths.push_back(path);
+    }
+    return paths;
+}
+
+eviction_policy_t parse_cache_eviction_policy_option(
+        const std::map<std::string, options::values_t> &opts) {
+    const std::string policy = get_single_option(opts, "--cache-eviction-policy");
+    if (policy == "scan-resistant") {
+        return eviction_policy_t::scan_resistant;
+    } else if (policy == "access-time") {
+        return eviction_policy_t::access_time;
+    } else {
+        throw std::runtime_error(strprintf(
+                "ERROR: cache-eviction-policy should be 'scan-resistant' or "
+                "'access-time', got '%s'", policy.c_str()));
+    }
+}
+
+double parse_cache_compressed_percent_option(
+        const std::map<std::string, options::values_t> &opts) {
+    const std::string percent_opt = get_single_option(opts, "--cache-compressed-percent");
+    uint64_t percent;
+    if (!strtou64_strict(percent_opt, 10, &percent) || percent > 90) {
+        throw std::runtime_error(strprintf(
+                "ERROR: cache-compressed-percent should be a number between 0 and 90, "
+                "got '%s'", percent_opt.c_str()));
+    }
+    return percent / 100.0;
+}
+
+huge_page_mode_t parse_cache_huge_pages_option(
+        const std::map<std::string, options::values_t> &opts) {
+    const std::string mode = get_single_option(opts, "--cache-huge-pages");
+    if (mode == "off") {
+        return huge_page_mode_t::none;
+    } else if (mode == "transparent") {
+        return huge_page_mode_t::transparent;
+    } else if (mode == "explicit") {
+        return huge_page_mode_t::hugetlb;
+    } else {
+        throw std::runtime_error(strprintf(
+                "ERROR: cache-huge-pages should be 'off', 'transparent' or 'explicit', "
+                "got '%s'", mode.c_str()));
+    }
+}
+
+block_codec_t parse_block_compression_option(
+        const std::map<std::string, options::values_t> &opts) {
+    const std::string codec = get_single_option(opts, "--block-compression");
+    if (codec == "none") {
+        return block_codec_t::none;
+    } else if (codec == "zlib") {
+        return block_codec_t::zlib;
+    } else {
+        throw std::runtime_error(strprintf(
+                "ERROR: block-compression should be 'none' or 'zlib', got '%s'",
+                codec.c_str()));
+    }
+}
+
+bool parse_driver_reuse_port_option(
+        const std::map<std::string, options::values_t> &opts) {
+    const bool reuse_port = exists_option(opts, "--driver-reuse-port");
+#ifdef _WIN32
+    if (reuse_port) {
+        throw std::runtime_error(
+            "ERROR: --driver-reuse-port is not supported on Windows");
+    }
+#endif
+    return reuse_port;
+}
+
+size_t parse_driver_max_queries_option(
+        const std::map<std::string, options::values_t> &opts) {
+    const int max_queries = get_single_int(opts, "--driver-max-queries-per-connection");
+    if (max_queries < 1) {
+        throw std::runtime_error(strprintf(
+                "ERROR: driver-max-queries-per-connection should be at least 1, "
+                "got %d", max_queries));
+    }
+    return static_cast<size_t>(max_queries);
+}
+
+int parse_slow_query_threshold_option(
+        const std::map<std::string, options::values_t> &opts) {
+    const int threshold_ms = get_single_int(opts, "--slow-query-threshold");
+    if (threshold_ms < 0) {
+        throw std::runtime_error(strprintf(
+                "ERROR: slow-query-threshold should not be negative, got %d",
+                threshold_ms));
+    }
+    return threshold_ms;
+}
+
 int main_rethinkdb_create(int argc, char *argv[]) {
     std::vector<options::option_t> options;
     std::vector<options::help_section_t> help;
@@ -2080,7 +2395,7 @@ int main_rethinkdb_serve(int argc, char *argv[]) {
         std::string web_path = get_web_path(opts);
 
         int num_workers;
-        if (!parse_cores_option(opts, &num_workers)) {
+        if (!parse_cpu_options(opts, &num_workers)) {
             return EXIT_FAILURE;
         }
 
@@ -2140,6 +2455,24 @@ int main_rethinkdb_serve(int argc, char *argv[]) {
                                 join_delay_secs.value_or(0),
                                 node_reconnect_timeout_secs.value_or(cluster_defaults::reconnect_timeout),
                                 tls_configs);
+        serve_info.stripe_paths = parse_directories_option(opts, "--stripe-directory");
+        serve_info.cold_paths = parse_directories_option(opts, "--cold-directory");
+        serve_info.cache_eviction_policy = parse_cache_eviction_policy_option(opts);
+        serve_info.cache_compressed_tier_fraction
+            = parse_cache_compressed_percent_option(opts);
+        serve_info.cache_huge_pages = parse_cache_huge_pages_option(opts);
+        serve_info.block_compression = parse_block_compression_option(opts);
+        serve_info.cluster_parallel_streams =
+            exists_option(opts, "--cluster-parallel-streams");
+        serve_info.hedge_outdated_reads = exists_option(opts, "--hedge-outdated-reads");
+        serve_info.lease_reads = exists_option(opts, "--lease-reads");
+        serve_info.driver_reuse_port = parse_driver_reuse_port_option(opts);
+        serve_info.driver_max_queries_per_connection =
+            parse_driver_max_queries_option(opts);
+        serve_info.driver_pipelining = exists_option(opts, "--driver-pipelining");
+        serve_info.driver_admission_control =
+            exists_option(opts, "--driver-admission-control");
+        serve_info.slow_query_threshold_ms = parse_slow_query_threshold_option(opts);
 
         const file_direct_io_mode_t direct_io_mode = parse_direct_io_mode_option(opts);
 
@@ -2243,6 +2576,17 @@ int main_rethinkdb_proxy(int argc, char *argv[]) {
                                 join_delay_secs.value_or(0),
                                 node_reconnect_timeout_secs.value_or(cluster_defaults::reconnect_timeout),
                                 tls_configs);
+        serve_info.cluster_parallel_streams =
+            exists_option(opts, "--cluster-parallel-streams");
+        serve_info.hedge_outdated_reads = exists_option(opts, "--hedge-outdated-reads");
+        serve_info.lease_reads = exists_option(opts, "--lease-reads");
+        serve_info.driver_reuse_port = parse_driver_reuse_port_option(opts);
+        serve_info.driver_max_queries_per_connection =
+            parse_driver_max_queries_option(opts);
+        serve_info.driver_pipelining = exists_option(opts, "--driver-pipelining");
+        serve_info.driver_admission_control =
+            exists_option(opts, "--driver-admission-control");
+        serve_info.slow_query_threshold_ms = parse_slow_query_threshold_option(opts);
 
         bool result;
         run_in_thread_pool(
@@ -2351,7 +2695,7 @@ int main_rethinkdb_porcelain(int argc, char *argv[]) {
         std::string web_path = get_web_path(opts);
 
         int num_workers;
-        if (!parse_cores_option(opts, &num_workers)) {
+        if (!parse_cpu_options(opts, &num_workers)) {
             return EXIT_FAILURE;
         }
 
@@ -2433,6 +2777,24 @@ int main_rethinkdb_porcelain(int argc, char *argv[]) {
                                 join_delay_secs.value_or(0),
                                 node_reconnect_timeout_secs.value_or(cluster_defaults::reconnect_timeout),
                                 tls_configs);
+        serve_info.stripe_paths = parse_directories_option(opts, "--stripe-directory");
+        serve_info.cold_paths = parse_directories_option(opts, "--cold-directory");
+        serve_info.cache_eviction_policy = parse_cache_eviction_policy_option(opts);
+        serve_info.cache_compressed_tier_fraction
+            = parse_cache_compressed_percent_option(opts);
+        serve_info.cache_huge_pages = parse_cache_huge_pages_option(opts);
+        serve_info.block_compression = parse_block_compression_option(opts);
+        serve_info.cluster_parallel_streams =
+            exists_option(opts, "--cluster-parallel-streams");
+        serve_info.hedge_outdated_reads = exists_option(opts, "--hedge-outdated-reads");
+        serve_info.lease_reads = exists_option(opts, "--lease-reads");
+        serve_info.driver_reuse_port = parse_driver_reuse_port_option(opts);
+        serve_info.driver_max_queries_per_connection =
+            parse_driver_max_queries_option(opts);
+        serve_info.driver_pipelining = exists_option(opts, "--driver-pipelining");
+        serve_info.driver_admission_control =
+            exists_option(opts, "--driver-admission-control");
+        serve_info.slow_query_threshold_ms = parse_slow_query_threshold_option(opts);
 
         const file_direct_io_mode_t direct_io_mode = parse_direct_io_mode_option(opts);
 
@@ -2,25 +2,35 @@
 #include "clustering/administration/main/memory_checker.hpp"
 
 #include <math.h>
+#include <string.h>
 #ifndef _WIN32
 #include <sys/resource.h>
 #endif
 
+#include "arch/runtime/thread_pool.hpp"
 #include "clustering/administration/metadata.hpp"
 #include "clustering/table_manager/table_meta_client.hpp"
 #include "logger.hpp"
+#include "paths.hpp"
+#include "perfmon/memory.hpp"
 #include "rdb_protocol/env.hpp"
 #include "rdb_protocol/pseudo_time.hpp"
+#include "serializer/ser_buffer_pool.hpp"
 
 static const int64_t delay_time = 60*1000;
 static const int64_t reset_checks = 10;
 
 static const int64_t practice_runs = 2;
 
+// We only complain about missing huge pages once the cache has grown this big, since
+// the kernel may take a while to collapse a young arena into huge pages.
+static const size_t huge_page_warning_min_size = 256 * MEGABYTE;
+
 memory_checker_t::memory_checker_t() :
     checks_until_reset(0),
     swap_usage(0),
     print_log_message(true),
+    print_huge_page_message(true),
     practice_runs_remaining(practice_runs),
     timer(delay_time, this)
 {
@@ -29,7 +39,89 @@ memory_checker_t::memory_checker_t() :
                                      drainer.lock()));
 }
 
+bool memory_checker_t::parse_proc_kb_field(const std::string &contents,
+                                           const char *field, uint64_t *kb_out) {
+    const size_t field_size = strlen(field);
+    for (size_t pos = 0; pos < contents.size();) {
+        size_t line_end = contents.find('\n', pos);
+        if (line_end == std::string::npos) {
+            line_end = contents.size();
+        }
+        if (contents.compare(pos, field_size, field) == 0
+                && contents.size() > pos + field_size
+                && contents[pos + field_size] == ':') {
+            unsigned long long kb;  // NOLINT(runtime/int)
+            if (sscanf(contents.c_str() + pos + field_size + 1, " %llu kB", &kb) != 1) {
+                return false;
+            }
+            *kb_out = kb;
+            return true;
+        }
+        pos = line_end + 1;
+    }
+    return false;
+}
+
+void memory_checker_t::check_huge_pages() {
+    const huge_page_usage_t usage = ser_buffer_pool_huge_page_usage();
+    if (usage.mode == huge_page_mode_t::none) {
+        return;
+    }
+
+#ifdef __linux__
+    // The kernel reports transparent huge pages process-wide, so this is an upper
+    // bound on how much of the arena they back.
+    const bool transparent = usage.mode == huge_page_mode_t::transparent;
+    const char *path = transparent ? "/proc/self/smaps_rollup" : "/proc/self/status";
+    std::string contents;
+    bool read_ok;
+    thread_pool_t::run_in_blocker_pool([&]() {
+        read_ok = blocking_read_file(path, &contents);
+    });
+    uint64_t backed_kb;
+    if (!read_ok || !parse_proc_kb_field(contents,
+                                         transparent ? "AnonHugePages" : "HugetlbPages",
+                                         &backed_kb)) {
+        logDBG("Couldn't read the huge page usage from %s.", path);
+        return;
+    }
+    const size_t backed_size = backed_kb * KILOBYTE;
+    const size_t backed_mb = backed_size / MEGABYTE;
+    const size_t used_mb = usage.used_size / MEGABYTE;
+    DEBUG_VAR const size_t arena_mb = usage.arena_size / MEGABYTE;
+    logDBG("The cache uses %zu MB of its %zu MB huge page arena, the kernel backs "
+           "%zu MB with huge pages.", used_mb, arena_mb, backed_mb);
+
+    if (transparent && print_huge_page_message
+            && usage.used_size >= huge_page_warning_min_size
+            && backed_size < usage.used_size / 2) {
+        logWRN("The kernel only backs %zu MB of the %zu MB of cache memory with "
+               "transparent huge pages.  Check that "
+               "/sys/kernel/mm/transparent_hugepage/enabled is 'always' or 'madvise'.",
+               backed_mb, used_mb);
+        print_huge_page_message = false;
+    }
+#endif
+}
+
+void memory_checker_t::check_resident_memory() {
+#ifdef __linux__
+    std::string contents;
+    bool read_ok;
+    thread_pool_t::run_in_blocker_pool([&]() {
+        read_ok = blocking_read_file("/proc/self/status", &contents);
+    });
+    uint64_t resident_kb;
+    if (read_ok && parse_proc_kb_field(contents, "VmRSS", &resident_kb)) {
+        set_resident_memory_size(resident_kb * KILOBYTE);
+    }
+#endif
+}
+
 void memory_checker_t::do_check(UNUSED auto_drainer_t::lock_t keepalive) {
+    check_huge_pages();
+    check_resident_memory();
+
 #if defined(__MACH__) || defined(_WIN32)
     size_t new_swap_usage = 0;
 #else
@@ -3,6 +3,7 @@
 #define CLUSTERING_ADMINISTRATION_MAIN_MEMORY_CHECKER_HPP_
 
 #include <functional>
+#include <string>
 
 #include "arch/runtime/coroutines.hpp"
 #include "arch/timing.hpp"
@@ -16,15 +17,25 @@ class table_meta_client_t;
 // memory_checker_t is created in serve.cc, and calls a repeating timer to
 // Periodically check if we're using swap by looking at the proc file or system calls.
 // If we're using swap, it creates an issue in a local issue tracker, and logs an error.
+// It also reports how much of the cache the kernel backs with huge pages, if the cache
+// was told to use them, and keeps the resident size of the process up to date for the
+// "memory" perfmon.
 class memory_checker_t : private repeating_timer_callback_t {
 public:
     memory_checker_t();
 
+    // Finds a "<field>: <n> kB" line in a file such as /proc/self/status.
+    static bool parse_proc_kb_field(const std::string &contents, const char *field,
+                                    uint64_t *kb_out);
+
     memory_issue_tracker_t *get_memory_issue_tracker() {
         return &memory_issue_tracker;
     }
 private:
     void do_check(auto_drainer_t::lock_t keepalive);
+    void check_huge_pages();
+    // Updates the resident size in the "memory" perfmon.
+    void check_resident_memory();
     void on_ring() final {
         coro_t::spawn_sometime(std::bind(&memory_checker_t::do_check,
                                          this,
@@ -36,6 +47,7 @@ private:
     uint64_t swap_usage;
 
     bool print_log_message;
+    bool print_huge_page_message;
 
     int practice_runs_remaining;
 
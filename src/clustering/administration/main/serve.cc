@@ -36,6 +36,7 @@
 #include "arch/arch.hpp"
 #include "arch/io/network.hpp"
 #include "arch/os_signal.hpp"
+#include "arch/runtime/numa.hpp"
 #include "buffer_cache/cache_balancer.hpp"
 #include "clustering/administration/artificial_reql_cluster_interface.hpp"
 #include "clustering/administration/http/server.hpp"
@@ -265,7 +266,8 @@ bool do_serve(io_backender_t *io_backender,
                 serve_info.ports.client_port,
                 semilattice_manager_heartbeat.get_root_view(),
                 semilattice_manager_auth.get_root_view(),
-                serve_info.tls_configs.cluster.get()));
+                serve_info.tls_configs.cluster.get(),
+                serve_info.cluster_parallel_streams));
         } catch (const address_in_use_exc_t &ex) {
             throw address_in_use_exc_t(strprintf("Could not bind to cluster port: %s", ex.what()));
         }
@@ -312,7 +314,10 @@ bool do_serve(io_backender_t *io_backender,
                               nullptr,   /* we'll fill this in later */
                               semilattice_manager_auth.get_root_view(),
                               &get_global_perfmon_collection(),
-                              serve_info.reql_http_proxy);
+                              serve_info.reql_http_proxy,
+                              serve_info.hedge_outdated_reads,
+                              serve_info.lease_reads,
+                              ticks_t{serve_info.slow_query_threshold_ms * MILLION});
         {
             /* Extract a subview of the directory with all the table meta manager
             business cards. */
@@ -333,13 +338,27 @@ bool do_serve(io_backender_t *io_backender,
                 table_persistence_interface;
             scoped_ptr_t<multi_table_manager_t> multi_table_manager;
             if (i_am_a_server) {
+                /* The arena only covers the cache size at startup, the buffers
+                beyond that come from the allocator. */
+                if (serve_info.cache_huge_pages != huge_page_mode_t::none &&
+                    !ser_buffer_pool_enable_huge_pages(
+                        serve_info.cache_huge_pages,
+                        server_config_server->get_actual_cache_size_bytes()->get())) {
+                    logWRN("Failed to reserve huge pages for the cache, it's going to "
+                           "use regular pages instead.");
+                }
                 cache_balancer.init(new alt_cache_balancer_t(
-                    server_config_server->get_actual_cache_size_bytes()));
+                    server_config_server->get_actual_cache_size_bytes(),
+                    serve_info.cache_eviction_policy,
+                    serve_info.cache_compressed_tier_fraction));
                 table_persistence_interface.init(
                     new real_table_persistence_interface_t(
                         io_backender,
                         cache_balancer.get(),
                         base_path,
+                        serve_info.stripe_paths,
+                        serve_info.cold_paths,
+                        serve_info.block_compression,
                         &rdb_ctx,
                         metadata_file));
                 multi_table_manager.init(new multi_table_manager_t(
@@ -484,7 +503,8 @@ bool do_serve(io_backender_t *io_backender,
                     ? optional<uint16_t>()
                     : optional<uint16_t>(serve_info.ports.http_port),
                 connectivity_cluster_run->get_canonical_addresses(),
-                serve_info.argv };
+                serve_info.argv,
+                describe_thread_placement() };
             cluster_directory_metadata_t initial_directory(
                 server_id,
                 connectivity_cluster.get_me(),
@@ -564,6 +584,14 @@ bool do_serve(io_backender_t *io_backender,
             }
 
             {
+                query_server_options_t query_server_options;
+                query_server_options.reuse_port = serve_info.driver_reuse_port;
+                query_server_options.max_queries_per_connection =
+                    serve_info.driver_max_queries_per_connection;
+                query_server_options.pipelining = serve_info.driver_pipelining;
+                query_server_options.admission_control =
+                    serve_info.driver_admission_control;
+
                 /* The `rdb_query_server_t` listens for client requests and processes the
                 queries it receives. */
                 rdb_query_server_t rdb_query_server(
@@ -572,7 +600,8 @@ bool do_serve(io_backender_t *io_backender,
                     &rdb_ctx,
                     &server_config_client,
                     server_id,
-                    serve_info.tls_configs.driver.get());
+                    serve_info.tls_configs.driver.get(),
+                    query_server_options);
                 logNTC("Listening for client driver connections on port %d\n",
                        rdb_query_server.get_port());
                 /* If `serve_info.ports.reql_port` was zero then the OS assigned us a
@@ -13,6 +13,9 @@
 #include "clustering/administration/main/version_check.hpp"
 #include "arch/address.hpp"
 #include "arch/io/openssl.hpp"
+#include "buffer_cache/types.hpp"
+#include "serializer/log/block_codec.hpp"
+#include "serializer/ser_buffer_pool.hpp"
 
 class os_signal_cond_t;
 
@@ -128,7 +131,19 @@ public:
         config_file(_config_file),
         argv(std::move(_argv)),
         join_delay_secs(_join_delay_secs),
-        node_reconnect_timeout_secs(_node_reconnect_timeout_secs)
+        node_reconnect_timeout_secs(_node_reconnect_timeout_secs),
+        cache_eviction_policy(eviction_policy_t::scan_resistant),
+        cache_compressed_tier_fraction(0),
+        cache_huge_pages(huge_page_mode_t::none),
+        block_compression(block_codec_t::none),
+        cluster_parallel_streams(false),
+        hedge_outdated_reads(false),
+        lease_reads(false),
+        driver_reuse_port(false),
+        driver_max_queries_per_connection(1024),
+        driver_pipelining(false),
+        driver_admission_control(false),
+        slow_query_threshold_ms(1000)
     {
         tls_configs = _tls_configs;
     }
@@ -149,6 +164,39 @@ public:
     std::vector<std::string> argv;
     int join_delay_secs;
     int node_reconnect_timeout_secs;
+    /* Directories that the files of new tables are striped over, in addition to the
+    data directory. */
+    std::vector<base_path_t> stripe_paths;
+    /* Directories on slower devices that new tables' files are also striped over, and
+    that the GC moves cold data to. */
+    std::vector<base_path_t> cold_paths;
+    eviction_policy_t cache_eviction_policy;
+    /* Which fraction of the cache may hold compressed copies of evicted pages. */
+    double cache_compressed_tier_fraction;
+    /* Which huge pages the cache's buffers should live in, if any. */
+    huge_page_mode_t cache_huge_pages;
+    /* How tables compress the blocks they write.  Blocks describe their own codec, so
+    this only affects new writes. */
+    block_codec_t block_compression;
+    /* Whether connections to other servers carry query and backfill traffic over
+    separate TCP streams. */
+    bool cluster_parallel_streams;
+    /* Whether outdated reads are sent to a second replica if the first one is slow. */
+    bool hedge_outdated_reads;
+    /* Whether `read_mode: "single"` reads may be answered by a local secondary
+    replica that holds a read lease from the primary. */
+    bool lease_reads;
+    /* Whether every thread accepts driver connections on its own `SO_REUSEPORT`
+    socket. */
+    bool driver_reuse_port;
+    /* How many queries of one driver connection may run at the same time. */
+    size_t driver_max_queries_per_connection;
+    /* Whether responses to driver queries are buffered and sent in batches. */
+    bool driver_pipelining;
+    /* Whether driver queries are refused when the server is overloaded. */
+    bool driver_admission_control;
+    /* Queries that take at least this long go to the slow query log, unless it's 0. */
+    int slow_query_threshold_ms;
     tls_configs_t tls_configs;
 };
 
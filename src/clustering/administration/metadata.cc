@@ -7,21 +7,35 @@
 #include "containers/archive/stl_types.hpp"
 #include "containers/archive/versioned.hpp"
 #include "rdb_protocol/protocol.hpp"
+#include "rpc/semilattice/joins/map.hpp"
 #include "stl_utils.hpp"
 
 RDB_IMPL_SERIALIZABLE_1_SINCE_v2_1(cluster_semilattice_metadata_t, databases);
 RDB_IMPL_SEMILATTICE_JOINABLE_1(cluster_semilattice_metadata_t, databases);
 RDB_IMPL_EQUALITY_COMPARABLE_1(cluster_semilattice_metadata_t, databases);
 
+void semilattice_diff(const cluster_semilattice_metadata_t &before,
+                      const cluster_semilattice_metadata_t &after,
+                      cluster_semilattice_metadata_t *diff_out) {
+    semilattice_diff(before.databases.databases, after.databases.databases,
+        &diff_out->databases.databases);
+}
+
 RDB_IMPL_SERIALIZABLE_1_SINCE_v2_3(auth_semilattice_metadata_t, m_users);
 RDB_IMPL_SEMILATTICE_JOINABLE_1(auth_semilattice_metadata_t, m_users);
 RDB_IMPL_EQUALITY_COMPARABLE_1(auth_semilattice_metadata_t, m_users);
 
+void semilattice_diff(const auth_semilattice_metadata_t &before,
+                      const auth_semilattice_metadata_t &after,
+                      auth_semilattice_metadata_t *diff_out) {
+    semilattice_diff(before.m_users, after.m_users, &diff_out->m_users);
+}
+
 RDB_IMPL_SERIALIZABLE_1_SINCE_v2_1(heartbeat_semilattice_metadata_t, heartbeat_timeout);
 RDB_IMPL_SEMILATTICE_JOINABLE_1(heartbeat_semilattice_metadata_t, heartbeat_timeout);
 RDB_IMPL_EQUALITY_COMPARABLE_1(heartbeat_semilattice_metadata_t, heartbeat_timeout);
 
-RDB_IMPL_SERIALIZABLE_9_FOR_CLUSTER(proc_directory_metadata_t,
+RDB_IMPL_SERIALIZABLE_10_FOR_CLUSTER(proc_directory_metadata_t,
     version,
     time_started,
     pid,
@@ -30,7 +44,8 @@ RDB_IMPL_SERIALIZABLE_9_FOR_CLUSTER(proc_directory_metadata_t,
     reql_port,
     http_admin_port,
     canonical_addresses,
-    argv);
+    argv,
+    thread_placement);
 
 RDB_IMPL_SERIALIZABLE_12_FOR_CLUSTER(cluster_directory_metadata_t,
      server_id,
@@ -33,6 +33,10 @@ public:
 RDB_DECLARE_SERIALIZABLE(cluster_semilattice_metadata_t);
 RDB_DECLARE_SEMILATTICE_JOINABLE(cluster_semilattice_metadata_t);
 RDB_DECLARE_EQUALITY_COMPARABLE(cluster_semilattice_metadata_t);
+/* Only the databases that changed; see `rpc/semilattice/joins/diff.hpp` */
+void semilattice_diff(const cluster_semilattice_metadata_t &before,
+                      const cluster_semilattice_metadata_t &after,
+                      cluster_semilattice_metadata_t *diff_out);
 
 class auth_semilattice_metadata_t {
 public:
@@ -75,6 +79,10 @@ public:
 
 RDB_DECLARE_SERIALIZABLE(auth_semilattice_metadata_t);
 RDB_DECLARE_SEMILATTICE_JOINABLE(auth_semilattice_metadata_t);
+/* Only the users that changed */
+void semilattice_diff(const auth_semilattice_metadata_t &before,
+                      const auth_semilattice_metadata_t &after,
+                      auth_semilattice_metadata_t *diff_out);
 RDB_DECLARE_EQUALITY_COMPARABLE(auth_semilattice_metadata_t);
 
 class heartbeat_semilattice_metadata_t {
@@ -110,6 +118,9 @@ public:
     optional<uint16_t> http_admin_port;
     std::set<host_and_port_t> canonical_addresses;
     std::vector<std::string> argv;
+    /* The CPUs that each kind of thread is pinned to, see `describe_thread_placement()`
+    in `arch/runtime/numa.hpp` */
+    std::map<std::string, std::string> thread_placement;
 };
 
 RDB_DECLARE_SERIALIZABLE(proc_directory_metadata_t);
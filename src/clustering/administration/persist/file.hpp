@@ -90,6 +90,10 @@ public:
             return &txn;
         }
 
+        void release_lock() {
+            rwlock_acq.reset();
+        }
+
     private:
         friend class metadata_file_t;
 
@@ -141,7 +145,11 @@ public:
         // is not interrupted in the middle, which could leave the
         // metadata in an inconsistent state.
         void commit() {
-            get_txn()->commit();
+            /* We let go of the file as soon as the page cache has our changes instead
+            of holding it until they're on disk. The next transactions can then make
+            their changes while we wait, and the page cache writes all of theirs in the
+            same flush, so concurrent writers share the cost of a flush. */
+            get_txn()->commit([this]() { release_lock(); });
         }
 
     private:
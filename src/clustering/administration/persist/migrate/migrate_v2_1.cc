@@ -77,9 +77,10 @@ void migrate_metadata_v2_1_to_v2_3(cluster_version_t serialization_version,
         break;
     case cluster_version_t::v2_3:
     case cluster_version_t::v2_4:
+    case cluster_version_t::v2_5:
         unreachable();
-    case cluster_version_t::v2_5_is_latest_disk:
-        migrate_metadata_v2_1_to_v2_3<cluster_version_t::v2_5_is_latest_disk>(
+    case cluster_version_t::v2_6_is_latest_disk:
+        migrate_metadata_v2_1_to_v2_3<cluster_version_t::v2_6_is_latest_disk>(
             txn, interruptor);
         break;
     case cluster_version_t::v1_14:
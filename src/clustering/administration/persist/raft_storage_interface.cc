@@ -164,6 +164,30 @@ void table_raft_storage_interface_t::write_log_replace_tail(
         raft_log_index_t first_replaced) {
     cond_t non_interruptor;
     metadata_file_t::write_txn_t txn(file, &non_interruptor);
+    replace_tail(&txn, source, first_replaced, &non_interruptor);
+    txn.commit();
+}
+
+void table_raft_storage_interface_t::write_log_replace_tail_and_commit_index(
+        const raft_log_t<table_raft_state_t> &source,
+        raft_log_index_t first_replaced,
+        raft_log_index_t commit_index) {
+    cond_t non_interruptor;
+    metadata_file_t::write_txn_t txn(file, &non_interruptor);
+    replace_tail(&txn, source, first_replaced, &non_interruptor);
+    state.commit_index = commit_index;
+    txn.write(
+        mdprefix_table_raft_header().suffix(uuid_to_str(table_id)),
+        table_raft_stored_header_t::from_state(state),
+        &non_interruptor);
+    txn.commit();
+}
+
+void table_raft_storage_interface_t::replace_tail(
+        metadata_file_t::write_txn_t *txn,
+        const raft_log_t<table_raft_state_t> &source,
+        raft_log_index_t first_replaced,
+        signal_t *interruptor) {
     guarantee(first_replaced > state.log.prev_index);
     guarantee(first_replaced <= state.log.get_latest_index() + 1);
     for (raft_log_index_t i = first_replaced;
@@ -172,9 +196,9 @@ void table_raft_storage_interface_t::write_log_replace_tail(
             mdprefix_table_raft_log().suffix(
                 uuid_to_str(table_id) + "/" + log_index_to_str(i));
         if (i <= source.get_latest_index()) {
-            txn.write(key, source.get_entry_ref(i), &non_interruptor);
+            txn->write(key, source.get_entry_ref(i), interruptor);
         } else {
-            txn.erase(key, &non_interruptor);
+            txn->erase(key, interruptor);
         }
     }
     if (first_replaced != state.log.get_latest_index() + 1) {
@@ -183,7 +207,6 @@ void table_raft_storage_interface_t::write_log_replace_tail(
     for (raft_log_index_t i = first_replaced; i <= source.get_latest_index(); ++i) {
         state.log.append(source.get_entry_ref(i));
     }
-    txn.commit();
 }
 
 void table_raft_storage_interface_t::write_log_append_one(
@@ -70,6 +70,10 @@ public:
     void write_log_replace_tail(
         const raft_log_t<table_raft_state_t> &source,
         raft_log_index_t first_replaced);
+    void write_log_replace_tail_and_commit_index(
+        const raft_log_t<table_raft_state_t> &source,
+        raft_log_index_t first_replaced,
+        raft_log_index_t commit_index);
     void write_log_append_one(
         const raft_log_entry_t<table_raft_state_t> &entry);
     void write_snapshot(
@@ -81,6 +85,14 @@ public:
         raft_log_index_t commit_index);
 
 private:
+    /* Shared by `write_log_replace_tail()` and
+    `write_log_replace_tail_and_commit_index()`. */
+    void replace_tail(
+        metadata_file_t::write_txn_t *txn,
+        const raft_log_t<table_raft_state_t> &source,
+        raft_log_index_t first_replaced,
+        signal_t *interruptor);
+
     metadata_file_t *const file;
     namespace_id_t const table_id;
     raft_persistent_state_t<table_raft_state_t> state;
@@ -4,6 +4,8 @@
 #include <algorithm>
 #include <array>
 
+#include "arch/runtime/numa.hpp"
+#include "buffer_cache/alt.hpp"
 #include "clustering/administration/persist/branch_history_manager.hpp"
 #include "clustering/administration/persist/file_keys.hpp"
 #include "clustering/administration/persist/raft_storage_interface.hpp"
@@ -14,12 +16,21 @@
 #include "serializer/merger.hpp"
 #include "serializer/translator.hpp"
 
+// The file in which the cache of the `shard`th CPU shard records its blocks, for
+// warming up after a restart.
+static std::string warm_up_file_path(const serializer_filepath_t &path, int shard) {
+    return path.permanent_path() + strprintf(".warm_up_%d", shard);
+}
+
 class real_multistore_ptr_t :
     public multistore_ptr_t {
 public:
     real_multistore_ptr_t(
             const namespace_id_t &table_id,
             const serializer_filepath_t &path,
+            const std::vector<serializer_filepath_t> &stripe_paths,
+            const std::vector<serializer_filepath_t> &cold_paths,
+            block_codec_t block_codec,
             scoped_ptr_t<real_branch_history_manager_t> &&bhm,
             const base_path_t &base_path,
             io_backender_t *io_backender,
@@ -51,7 +62,7 @@ public:
         bool create = (res != 0);
 
         on_thread_t thread_switcher(serializer_thread_allocation->get_thread());
-        filepath_file_opener_t file_opener(path, io_backender);
+        filepath_file_opener_t file_opener(path, io_backender, stripe_paths, cold_paths);
 
         if (create) {
             log_serializer_t::create(
@@ -62,8 +73,10 @@ public:
         // TODO: Could we handle failure when loading the serializer?  Right
         // now, we don't.
 
+        log_serializer_t::dynamic_config_t dynamic_config;
+        dynamic_config.block_codec = block_codec;
         scoped_ptr_t<serializer_t> inner_serializer(new log_serializer_t(
-            log_serializer_t::dynamic_config_t(),
+            dynamic_config,
             &file_opener,
             perfmon_collection_serializers));
         serializer.init(new merger_serializer_t(
@@ -96,6 +109,7 @@ public:
                 table_id,
                 update_sindexes_t::UPDATE,
                 which_cpu_shard_t{ix, CPU_SHARDING_FACTOR}));
+            stores[ix]->cache->start_warm_up(warm_up_file_path(path, ix));
 
             /* Initialize the metainfo if necessary */
             if (create) {
@@ -285,14 +299,21 @@ void real_table_persistence_interface_t::load_multistore(
 
     scoped_ptr_t<thread_allocation_t> serializer_thread(
         new thread_allocation_t(&thread_allocator));
+    // The stores' caches and the serializer keep passing blocks back and forth, so we
+    // keep them on the same NUMA node.
+    const int numa_node = get_thread_numa_node(serializer_thread->get_thread());
     std::vector<scoped_ptr_t<thread_allocation_t> > store_threads;
     for (size_t i = 0; i < CPU_SHARDING_FACTOR; ++i) {
-        store_threads.emplace_back(new thread_allocation_t(&thread_allocator));
+        store_threads.emplace_back(
+            new thread_allocation_t(&thread_allocator, numa_node));
     }
 
     multistore_ptr_out->init(new real_multistore_ptr_t(
         table_id,
         file_name_for(table_id),
+        file_names_in(stripe_paths, table_id),
+        file_names_in(cold_paths, table_id),
+        block_codec,
         std::move(bhm),
         base_path,
         io_backender,
@@ -321,11 +342,26 @@ void real_table_persistence_interface_t::destroy_multistore(
     guarantee(multistore_ptr_in->has());
     multistore_ptr_in->reset();
 
-    std::string filepath = file_name_for(table_id).permanent_path();
-    logNTC("Removing file %s\n", filepath.c_str());
-    const int res = ::unlink(filepath.c_str());
-    guarantee_err(res == 0 || get_errno() == ENOENT,
-                  "unlink failed for file %s", filepath.c_str());
+    std::vector<serializer_filepath_t> filepaths(1, file_name_for(table_id));
+    for (const serializer_filepath_t &path : file_names_in(stripe_paths, table_id)) {
+        filepaths.push_back(path);
+    }
+    for (const serializer_filepath_t &path : file_names_in(cold_paths, table_id)) {
+        filepaths.push_back(path);
+    }
+    for (const serializer_filepath_t &path : filepaths) {
+        std::string filepath = path.permanent_path();
+        logNTC("Removing file %s\n", filepath.c_str());
+        const int res = ::unlink(filepath.c_str());
+        guarantee_err(res == 0 || get_errno() == ENOENT,
+                      "unlink failed for file %s", filepath.c_str());
+    }
+    for (int shard = 0; shard < CPU_SHARDING_FACTOR; ++shard) {
+        const std::string filepath = warm_up_file_path(file_name_for(table_id), shard);
+        const int res = ::unlink(filepath.c_str());
+        guarantee_err(res == 0 || get_errno() == ENOENT,
+                      "unlink failed for file %s", filepath.c_str());
+    }
 }
 
 serializer_filepath_t real_table_persistence_interface_t::file_name_for(
@@ -333,6 +369,16 @@ serializer_filepath_t real_table_persistence_interface_t::file_name_for(
     return serializer_filepath_t(base_path, uuid_to_str(table_id));
 }
 
+std::vector<serializer_filepath_t>
+real_table_persistence_interface_t::file_names_in(
+        const std::vector<base_path_t> &dirs, const namespace_id_t &table_id) {
+    std::vector<serializer_filepath_t> res;
+    for (const base_path_t &path : dirs) {
+        res.push_back(serializer_filepath_t(path, uuid_to_str(table_id)));
+    }
+    return res;
+}
+
 bool real_table_persistence_interface_t::is_gc_active() const {
     for (int thread = 0; thread < get_num_db_threads(); ++thread) {
         std::map<serializer_t *, auto_drainer_t::lock_t> serializers_copy;
@@ -5,6 +5,7 @@
 #include "clustering/administration/perfmon_collection_repo.hpp"
 #include "clustering/administration/persist/raft_storage_interface.hpp"
 #include "clustering/table_manager/table_metadata.hpp"
+#include "serializer/log/block_codec.hpp"
 
 class cache_balancer_t;
 class metadata_file_t;
@@ -18,11 +19,17 @@ public:
             io_backender_t *_io_backender,
             cache_balancer_t *_cache_balancer,
             const base_path_t &_base_path,
+            const std::vector<base_path_t> &_stripe_paths,
+            const std::vector<base_path_t> &_cold_paths,
+            block_codec_t _block_codec,
             rdb_context_t *_rdb_context,
             metadata_file_t *_metadata_file) :
         io_backender(_io_backender),
         cache_balancer(_cache_balancer),
         base_path(_base_path),
+        stripe_paths(_stripe_paths),
+        cold_paths(_cold_paths),
+        block_codec(_block_codec),
         rdb_context(_rdb_context),
         metadata_file(_metadata_file),
         /* We assign threads from the lowest thread number upwards. This is to reduce
@@ -74,11 +81,19 @@ public:
 
 private:
     serializer_filepath_t file_name_for(const namespace_id_t &table_id);
+    std::vector<serializer_filepath_t> file_names_in(
+        const std::vector<base_path_t> &dirs, const namespace_id_t &table_id);
     threadnum_t pick_thread();
 
     io_backender_t * const io_backender;
     cache_balancer_t * const cache_balancer;
     base_path_t const base_path;
+    /* New tables are striped over `base_path` and these. */
+    std::vector<base_path_t> const stripe_paths;
+    /* ...followed by these, which are the cold storage tier. */
+    std::vector<base_path_t> const cold_paths;
+    /* The codec that tables compress their new blocks with. */
+    block_codec_t const block_codec;
     rdb_context_t * const rdb_context;
     metadata_file_t * const metadata_file;
 
@@ -18,7 +18,6 @@
 #include "rdb_protocol/table_common.hpp"
 #include "rdb_protocol/terms/write_hook.hpp"
 #include "rdb_protocol/val.hpp"
-#include "rpc/semilattice/watchable.hpp"
 #include "rpc/semilattice/view/field.hpp"
 
 #define NAMESPACE_INTERFACE_EXPIRATION_MS (60 * 1000)
@@ -41,7 +40,9 @@ real_reql_cluster_interface_t::real_reql_cluster_interface_t(
     m_auth_semilattice_view(auth_semilattice_view),
     m_cluster_semilattice_view(cluster_semilattice_view),
     m_table_meta_client(table_meta_client),
-    m_cross_thread_database_watchables(get_num_threads()),
+    m_databases_snapshot(
+        metadata_field(&cluster_semilattice_metadata_t::databases,
+                       m_cluster_semilattice_view)),
     m_rdb_context(rdb_context),
     m_namespace_repo(
         m_mailbox_manager,
@@ -61,13 +62,6 @@ real_reql_cluster_interface_t::real_reql_cluster_interface_t(
     guarantee(m_cluster_semilattice_view->home_thread() == home_thread());
     guarantee(m_table_meta_client->home_thread() == home_thread());
     guarantee(m_server_config_client->home_thread() == home_thread());
-    for (int thr = 0; thr < get_num_threads(); ++thr) {
-        m_cross_thread_database_watchables[thr].init(
-            new cross_thread_watchable_variable_t<databases_semilattice_metadata_t>(
-                clone_ptr_t<semilattice_watchable_t<databases_semilattice_metadata_t> >
-                    (new semilattice_watchable_t<databases_semilattice_metadata_t>(
-                        metadata_field(&cluster_semilattice_metadata_t::databases, m_cluster_semilattice_view))), threadnum_t(thr)));
-    }
 }
 
 bool real_reql_cluster_interface_t::db_create(
@@ -228,9 +222,9 @@ bool real_reql_cluster_interface_t::db_list(
         UNUSED signal_t *interruptor_on_caller,
         std::set<name_string_t> *names_out,
         UNUSED admin_err_t *error_out) {
-    databases_semilattice_metadata_t db_metadata;
-    get_databases_metadata(&db_metadata);
-    for (const auto &pair : db_metadata.databases) {
+    std::shared_ptr<const databases_semilattice_metadata_t> db_metadata =
+        get_databases_metadata();
+    for (const auto &pair : db_metadata->databases) {
         if (!pair.second.is_deleted()) {
             names_out->insert(pair.second.get_ref().name.get_ref());
         }
@@ -246,10 +240,10 @@ bool real_reql_cluster_interface_t::db_find(
     guarantee(name != name_string_t::guarantee_valid("rethinkdb"),
         "real_reql_cluster_interface_t should never get queries for system tables");
     /* Find the specified database */
-    databases_semilattice_metadata_t db_metadata;
-    get_databases_metadata(&db_metadata);
+    std::shared_ptr<const databases_semilattice_metadata_t> db_metadata =
+        get_databases_metadata();
     database_id_t db_id;
-    if (!search_db_metadata_by_name(db_metadata, name, &db_id, error_out)) {
+    if (!search_db_metadata_by_name(*db_metadata, name, &db_id, error_out)) {
         return false;
     }
     *db_out = make_counted<const ql::db_t>(db_id, name);
@@ -335,6 +329,7 @@ bool real_reql_cluster_interface_t::table_create(
         config.config.write_ack_config = write_ack_config_t::MAJORITY;
         config.config.durability = durability;
         config.config.user_data = default_user_data();
+        config.config.cache = default_table_cache_config();
 
         table_id = generate_uuid();
         m_table_meta_client->create(table_id, config, &interruptor_on_home);
@@ -691,6 +686,8 @@ void real_reql_cluster_interface_t::reconfigure_internal(
     new_config.config.write_ack_config = old_config.config.write_ack_config;
     new_config.config.durability = old_config.config.durability;
     new_config.config.user_data = old_config.config.user_data;
+    new_config.config.cache = old_config.config.cache;
+    new_config.config.ttl = old_config.config.ttl;
 
     calculate_split_points_intelligently(
         table_id,
@@ -1010,13 +1007,15 @@ void real_reql_cluster_interface_t::rebalance_internal(
         throw no_such_table_exc_t();
     }
 
-    std::map<store_key_t, int64_t> counts;
-    fetch_distribution(table_id, this, interruptor_on_home, &counts);
+    std::map<store_key_t, int64_t> counts, load_counts;
+    fetch_distribution(table_id, this, interruptor_on_home, &counts, &load_counts);
 
     /* If there's not enough data to rebalance, return `rebalanced: 0` but don't report
-    an error */
+    an error. Hot key ranges get smaller shards than their document count alone would
+    give them. */
     bool actually_rebalanced = calculate_split_points_with_distribution(
-        counts, config.config.shards.size(), &config.shard_scheme);
+        combine_distribution_with_load(counts, load_counts),
+        config.config.shards.size(), &config.shard_scheme);
     if (actually_rebalanced) {
         table_config_and_shards_change_t table_config_and_shards_change(
             table_config_and_shards_change_t::set_table_config_and_shards_t{ config });
@@ -1415,28 +1414,16 @@ bool is_joined(const T &multiple, const T &divisor) {
 void real_reql_cluster_interface_t::wait_for_cluster_metadata_to_propagate(
         const cluster_semilattice_metadata_t &metadata,
         signal_t *interruptor_on_caller) {
-    int threadnum = get_thread_id().threadnum;
-
-    guarantee(m_cross_thread_database_watchables[threadnum].has());
-    m_cross_thread_database_watchables[threadnum]->get_watchable()->run_until_satisfied(
+    m_databases_snapshot.get()->run_until_satisfied(
         [&](const databases_semilattice_metadata_t &md) -> bool {
             return is_joined(md, metadata.databases);
         },
         interruptor_on_caller);
 }
 
-template <class T>
-void copy_value(const T *in, T *out) {
-    *out = *in;
-}
-
-void real_reql_cluster_interface_t::get_databases_metadata(
-        databases_semilattice_metadata_t *out) {
-    int threadnum = get_thread_id().threadnum;
-    r_sanity_check(m_cross_thread_database_watchables[threadnum].has());
-    m_cross_thread_database_watchables[threadnum]->apply_read(
-            std::bind(&copy_value<databases_semilattice_metadata_t>,
-                      ph::_1, out));
+std::shared_ptr<const databases_semilattice_metadata_t>
+        real_reql_cluster_interface_t::get_databases_metadata() {
+    return m_databases_snapshot.get()->get();
 }
 
 void real_reql_cluster_interface_t::make_single_selection(
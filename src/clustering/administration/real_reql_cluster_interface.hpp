@@ -12,6 +12,7 @@
 #include "concurrency/cross_thread_watchable.hpp"
 #include "concurrency/watchable.hpp"
 #include "rdb_protocol/context.hpp"
+#include "rpc/semilattice/snapshot.hpp"
 #include "rpc/semilattice/view.hpp"
 
 class artificial_reql_cluster_interface_t;
@@ -279,8 +280,7 @@ private:
     std::shared_ptr<semilattice_readwrite_view_t<
         cluster_semilattice_metadata_t> > m_cluster_semilattice_view;
     table_meta_client_t *m_table_meta_client;
-    scoped_array_t< scoped_ptr_t< cross_thread_watchable_variable_t<
-        databases_semilattice_metadata_t > > > m_cross_thread_database_watchables;
+    semilattice_snapshot_t<databases_semilattice_metadata_t> m_databases_snapshot;
     rdb_context_t *m_rdb_context;
 
     namespace_repo_t m_namespace_repo;
@@ -291,8 +291,7 @@ private:
             const cluster_semilattice_metadata_t &metadata,
             signal_t *interruptor);
 
-    // This could soooo be optimized if you don't want to copy the whole thing.
-    void get_databases_metadata(databases_semilattice_metadata_t *out);
+    std::shared_ptr<const databases_semilattice_metadata_t> get_databases_metadata();
 
     void make_single_selection(
             auth::user_context_t const &user_context,
@@ -72,6 +72,12 @@ bool server_status_artificial_table_backend_t::format_row(
             metadata.proc.argv));
     proc_builder.overwrite("cache_size_mb", ql::datum_t(
         static_cast<double>(metadata.actual_cache_size_bytes) / MEGABYTE));
+    ql::datum_object_builder_t placement_builder;
+    for (const auto &pair : metadata.proc.thread_placement) {
+        placement_builder.overwrite(datum_string_t(pair.first),
+            ql::datum_t(datum_string_t(pair.second)));
+    }
+    proc_builder.overwrite("thread_placement", std::move(placement_builder).to_datum());
     builder.overwrite("process", std::move(proc_builder).to_datum());
 
     ASSERT_NO_CORO_WAITING;
@@ -34,12 +34,19 @@ const char *table_server_stats_request_t::table_server_request_type = "table_ser
 parsed_stats_t::server_stats_t::server_stats_t() :
     responsive(false),
     queries_per_sec(0), queries_total(0),
-    client_connections(0), clients_active(0) { }
+    client_connections(0), clients_active(0),
+    query_latency_p50(0), query_latency_p99(0), query_latency_p999(0) { }
 
 parsed_stats_t::table_stats_t::table_stats_t() :
     read_docs_per_sec(0), read_docs_total(0),
     written_docs_per_sec(0), written_docs_total(0),
-    in_use_bytes(0), metadata_bytes(0), data_bytes(0),
+    returned_docs_per_sec(0), returned_docs_total(0),
+    read_doc_bytes_per_sec(0), read_doc_bytes_total(0),
+    written_doc_bytes_per_sec(0), written_doc_bytes_total(0),
+    sindex_keys_updated_per_sec(0), sindex_keys_updated_total(0),
+    sindex_update_latency_p99(0),
+    in_use_bytes(0), page_hits_total(0), page_misses_total(0),
+    metadata_bytes(0), data_bytes(0),
     garbage_bytes(0), preallocated_bytes(0),
     read_bytes_per_sec(0), read_bytes_total(0),
     written_bytes_per_sec(0), written_bytes_total(0) { }
@@ -65,6 +72,8 @@ parsed_stats_t::parsed_stats_t(const std::vector<ql::datum_t> &stats) {
             std::pair<datum_string_t, ql::datum_t> perf_pair = s.get_pair(i);
             if (perf_pair.first == "query_engine") {
                 store_query_engine_stats(perf_pair.second, &serv_stats);
+            } else if (perf_pair.first == "memory") {
+                serv_stats.memory = perf_pair.second;
             } else {
                 namespace_id_t table_id;
                 res = str_to_uuid(perf_pair.first.to_std(), &table_id);
@@ -122,9 +131,39 @@ void parsed_stats_t::store_shard_values(const ql::datum_t &shard_perf,
                                       &stats_out->read_docs_total);
                     add_perfmon_value(sub_pair.second, "total_keys_set",
                                       &stats_out->written_docs_total);
+                    add_perfmon_value(sub_pair.second, "keys_returned",
+                                      &stats_out->returned_docs_per_sec);
+                    add_perfmon_value(sub_pair.second, "total_keys_returned",
+                                      &stats_out->returned_docs_total);
+                    add_perfmon_value(sub_pair.second, "bytes_read",
+                                      &stats_out->read_doc_bytes_per_sec);
+                    add_perfmon_value(sub_pair.second, "total_bytes_read",
+                                      &stats_out->read_doc_bytes_total);
+                    add_perfmon_value(sub_pair.second, "bytes_written",
+                                      &stats_out->written_doc_bytes_per_sec);
+                    add_perfmon_value(sub_pair.second, "total_bytes_written",
+                                      &stats_out->written_doc_bytes_total);
+                    add_perfmon_value(sub_pair.second, "sindex_keys_updated",
+                                      &stats_out->sindex_keys_updated_per_sec);
+                    add_perfmon_value(sub_pair.second, "total_sindex_keys_updated",
+                                      &stats_out->sindex_keys_updated_total);
+                    ql::datum_t latency = sub_pair.second.get_field(
+                        "sindex_update_latency", ql::throw_bool_t::NOTHROW);
+                    // The percentiles are null if there were no index updates.
+                    ql::datum_t p99 = latency.has()
+                        ? latency.get_field("p99", ql::throw_bool_t::NOTHROW)
+                        : ql::datum_t();
+                    if (p99.has() && p99.get_type() == ql::datum_t::R_NUM) {
+                        stats_out->sindex_update_latency_p99 = std::max(
+                            stats_out->sindex_update_latency_p99, p99.as_num());
+                    }
                 } else if (key == "cache") {
                     add_perfmon_value(sub_pair.second, "in_use_bytes",
                                       &stats_out->in_use_bytes);
+                    add_perfmon_value(sub_pair.second, "page_hits",
+                                      &stats_out->page_hits_total);
+                    add_perfmon_value(sub_pair.second, "page_misses",
+                                      &stats_out->page_misses_total);
                 }
             }
         }
@@ -167,6 +206,16 @@ void parsed_stats_t::store_query_engine_stats(const ql::datum_t &qe_perf,
     store_perfmon_value(qe_perf, "queries_total", &stats_out->queries_total);
     store_perfmon_value(qe_perf, "client_connections", &stats_out->client_connections);
     store_perfmon_value(qe_perf, "clients_active", &stats_out->clients_active);
+    ql::datum_t latency_perf = qe_perf.get_field("query_latency",
+                                                 ql::throw_bool_t::NOTHROW);
+    // The percentiles are null if there were no queries in the last interval.
+    if (latency_perf.has() &&
+        latency_perf.get_field("p50", ql::throw_bool_t::NOTHROW).get_type()
+            == ql::datum_t::R_NUM) {
+        store_perfmon_value(latency_perf, "p50", &stats_out->query_latency_p50);
+        store_perfmon_value(latency_perf, "p99", &stats_out->query_latency_p99);
+        store_perfmon_value(latency_perf, "p999", &stats_out->query_latency_p999);
+    }
 }
 
 void parsed_stats_t::store_table_stats(const namespace_id_t &table_id,
@@ -344,7 +393,8 @@ table_stats_request_t::table_stats_request_t(const namespace_id_t &_table_id) :
 
 std::set<std::vector<std::string> > table_stats_request_t::get_filter() const {
     return std::set<std::vector<std::string> >({
-        { uuid_to_str(table_id), "serializers", "shard_[0-9]+", "btree-.*", "keys_.*" }
+        { uuid_to_str(table_id), "serializers", "shard_[0-9]+", "btree-.*", "keys_.*" },
+        { uuid_to_str(table_id), "serializers", "shard_[0-9]+", "btree-.*", "bytes_.*" }
         });
 }
 
@@ -374,6 +424,9 @@ bool table_stats_request_t::to_datum(const parsed_stats_t &stats,
     ql::datum_object_builder_t qe_builder;
     ADD_TABLE_STAT(qe_builder, stats, table_id, read_docs_per_sec);
     ADD_TABLE_STAT(qe_builder, stats, table_id, written_docs_per_sec);
+    ADD_TABLE_STAT(qe_builder, stats, table_id, returned_docs_per_sec);
+    ADD_TABLE_STAT(qe_builder, stats, table_id, read_doc_bytes_per_sec);
+    ADD_TABLE_STAT(qe_builder, stats, table_id, written_doc_bytes_per_sec);
     row_builder.overwrite("query_engine", std::move(qe_builder).to_datum());
 
     *result_out = std::move(row_builder).to_datum();
@@ -407,6 +460,7 @@ server_stats_request_t::server_stats_request_t(const server_id_t &_server_id) :
 std::set<std::vector<std::string> > server_stats_request_t::get_filter() const {
     return std::set<std::vector<std::string> >(
         { {"query_engine"},
+          {"memory"},
           {".*", "serializers", "shard_[0-9]+", "btree-.*" } });
 }
 
@@ -452,11 +506,17 @@ bool server_stats_request_t::to_datum(const parsed_stats_t &stats,
         ADD_STAT(qe_builder, server_stats, clients_active);
         ADD_STAT(qe_builder, server_stats, queries_per_sec);
         ADD_STAT(qe_builder, server_stats, queries_total);
+        ADD_STAT(qe_builder, server_stats, query_latency_p50);
+        ADD_STAT(qe_builder, server_stats, query_latency_p99);
+        ADD_STAT(qe_builder, server_stats, query_latency_p999);
         ADD_SERVER_STAT(qe_builder, stats, server_id, read_docs_per_sec);
         ADD_SERVER_STAT(qe_builder, stats, server_id, read_docs_total);
         ADD_SERVER_STAT(qe_builder, stats, server_id, written_docs_per_sec);
         ADD_SERVER_STAT(qe_builder, stats, server_id, written_docs_total);
         row_builder.overwrite("query_engine", std::move(qe_builder).to_datum());
+        if (server_stats.memory.has()) {
+            row_builder.overwrite("memory", server_stats.memory);
+        }
     }
     *result_out = std::move(row_builder).to_datum();
     return true;
@@ -549,9 +609,20 @@ bool table_server_stats_request_t::to_datum(const parsed_stats_t &stats,
         ADD_STAT(qe_builder, table_stats, read_docs_total);
         ADD_STAT(qe_builder, table_stats, written_docs_per_sec);
         ADD_STAT(qe_builder, table_stats, written_docs_total);
+        ADD_STAT(qe_builder, table_stats, returned_docs_per_sec);
+        ADD_STAT(qe_builder, table_stats, returned_docs_total);
+        ADD_STAT(qe_builder, table_stats, read_doc_bytes_per_sec);
+        ADD_STAT(qe_builder, table_stats, read_doc_bytes_total);
+        ADD_STAT(qe_builder, table_stats, written_doc_bytes_per_sec);
+        ADD_STAT(qe_builder, table_stats, written_doc_bytes_total);
+        ADD_STAT(qe_builder, table_stats, sindex_keys_updated_per_sec);
+        ADD_STAT(qe_builder, table_stats, sindex_keys_updated_total);
+        ADD_STAT(qe_builder, table_stats, sindex_update_latency_p99);
 
         ql::datum_object_builder_t se_cache_builder;
         ADD_STAT(se_cache_builder, table_stats, in_use_bytes);
+        ADD_STAT(se_cache_builder, table_stats, page_hits_total);
+        ADD_STAT(se_cache_builder, table_stats, page_misses_total);
 
         ql::datum_object_builder_t se_disk_space_builder;
         ADD_STAT(se_disk_space_builder, table_stats, metadata_bytes);
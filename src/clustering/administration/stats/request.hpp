@@ -27,7 +27,23 @@ public:
         double read_docs_total;
         double written_docs_per_sec;
         double written_docs_total;
+        // The documents that range reads return after the filters and other
+        // transformations that run on the shards.
+        double returned_docs_per_sec;
+        double returned_docs_total;
+        // The serialized sizes of the documents that were read and written.
+        double read_doc_bytes_per_sec;
+        double read_doc_bytes_total;
+        double written_doc_bytes_per_sec;
+        double written_doc_bytes_total;
+        double sindex_keys_updated_per_sec;
+        double sindex_keys_updated_total;
+        // The highest p99 of the shards, so this isn't summed up over tables or
+        // servers either.
+        double sindex_update_latency_p99;
         double in_use_bytes;
+        double page_hits_total;
+        double page_misses_total;
         double metadata_bytes;
         double data_bytes;
         double garbage_bytes;
@@ -46,6 +62,13 @@ public:
         double queries_total;
         double client_connections;
         double clients_active;
+        // Percentiles of the query latency in seconds. These aren't summed up over
+        // servers, so they only appear in the rows of individual servers.
+        double query_latency_p50;
+        double query_latency_p99;
+        double query_latency_p999;
+        // The server's "memory" perfmon as it is, or an empty datum if it's missing.
+        ql::datum_t memory;
 
         std::map<namespace_id_t, table_stats_t> tables;
     };
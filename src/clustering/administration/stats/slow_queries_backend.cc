@@ -0,0 +1,148 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#include "clustering/administration/stats/slow_queries_backend.hpp"
+
+#include <map>
+#include <set>
+#include <utility>
+
+#include "clustering/administration/datum_adapter.hpp"
+#include "clustering/administration/stats/stat_manager.hpp"
+#include "concurrency/cross_thread_signal.hpp"
+#include "concurrency/pmap.hpp"
+
+slow_queries_artificial_table_backend_t::slow_queries_artificial_table_backend_t(
+        rdb_context_t *rdb_context,
+        lifetime_t<name_resolver_t const &> name_resolver,
+        mailbox_manager_t *_mailbox_manager,
+        watchable_map_t<peer_id_t, cluster_directory_metadata_t> *_directory,
+        admin_identifier_format_t _identifier_format)
+    : timer_cfeed_artificial_table_backend_t(
+        name_string_t::guarantee_valid("slow_queries"), rdb_context, name_resolver),
+      mailbox_manager(_mailbox_manager),
+      directory(_directory),
+      identifier_format(_identifier_format) {
+}
+
+slow_queries_artificial_table_backend_t::~slow_queries_artificial_table_backend_t() {
+    begin_changefeed_destruction();
+}
+
+std::string slow_queries_artificial_table_backend_t::get_primary_key_name() {
+    return "id";
+}
+
+void slow_queries_artificial_table_backend_t::get_all_slow_queries(
+        auth::user_context_t const &user_context,
+        signal_t *interruptor_on_home,
+        std::vector<ql::datum_t> *rows_out) {
+    assert_thread();
+
+    std::map<peer_id_t, std::pair<ql::datum_t, get_stats_mailbox_address_t> > servers;
+    directory->read_all(
+        [&](const peer_id_t &peer_id, const cluster_directory_metadata_t *value) {
+            if (value->peer_type == SERVER_PEER) {
+                servers.insert(std::make_pair(peer_id, std::make_pair(
+                    convert_name_or_server_id_to_datum(
+                        value->server_config.config.name,
+                        value->server_id,
+                        identifier_format),
+                    value->get_stats_mailbox_address)));
+            }
+        });
+
+    std::set<std::vector<stat_manager_t::stat_id_t> > filter;
+    filter.insert(std::vector<stat_manager_t::stat_id_t>{"query_engine", "slow_queries"});
+
+    const datum_string_t user(user_context.to_string());
+    std::map<peer_id_t, std::vector<ql::datum_t> > rows_by_server;
+    pmap(servers.begin(), servers.end(),
+        [&](const std::pair<peer_id_t,
+                            std::pair<ql::datum_t, get_stats_mailbox_address_t> > &s) {
+            ql::datum_t stats;
+            admin_err_t error;
+            try {
+                if (!fetch_stats_from_server(mailbox_manager, s.second.second, filter,
+                                             interruptor_on_home, &stats, &error)) {
+                    /* The server disconnected or timed out. Ignore it. */
+                    return;
+                }
+            } catch (const interrupted_exc_t &) {
+                /* We'll deal with it outside the `pmap()` */
+                return;
+            }
+
+            ql::datum_t entries = stats.get_field("query_engine", ql::NOTHROW);
+            if (entries.has()) {
+                entries = entries.get_field("slow_queries", ql::NOTHROW);
+            }
+            if (!entries.has() || entries.get_type() != ql::datum_t::R_ARRAY) {
+                return;
+            }
+            std::vector<ql::datum_t> *rows = &rows_by_server[s.first];
+            for (size_t i = 0; i < entries.arr_size(); ++i) {
+                ql::datum_t entry = entries.get(i);
+                if (!user_context.is_admin_user() &&
+                        entry.get_field("user", ql::NOTHROW).as_str() != user) {
+                    continue;
+                }
+                ql::datum_object_builder_t builder(entry);
+                builder.overwrite("server", s.second.first);
+                rows->push_back(std::move(builder).to_datum());
+            }
+        });
+
+    if (interruptor_on_home->is_pulsed()) {
+        throw interrupted_exc_t();
+    }
+
+    rows_out->clear();
+    for (auto &&pair : rows_by_server) {
+        rows_out->insert(rows_out->end(), pair.second.begin(), pair.second.end());
+    }
+}
+
+bool slow_queries_artificial_table_backend_t::read_all_rows_as_vector(
+        auth::user_context_t const &user_context,
+        signal_t *interruptor_on_caller,
+        std::vector<ql::datum_t> *rows_out,
+        UNUSED admin_err_t *error_out) {
+    cross_thread_signal_t interruptor_on_home(interruptor_on_caller, home_thread());
+    on_thread_t rethreader(home_thread());
+    get_all_slow_queries(user_context, &interruptor_on_home, rows_out);
+    return true;
+}
+
+bool slow_queries_artificial_table_backend_t::read_row(
+        auth::user_context_t const &user_context,
+        ql::datum_t primary_key,
+        signal_t *interruptor_on_caller,
+        ql::datum_t *row_out,
+        UNUSED admin_err_t *error_out) {
+    *row_out = ql::datum_t();
+
+    cross_thread_signal_t interruptor_on_home(interruptor_on_caller, home_thread());
+    on_thread_t rethreader(home_thread());
+
+    std::vector<ql::datum_t> rows;
+    get_all_slow_queries(user_context, &interruptor_on_home, &rows);
+    for (ql::datum_t &row : rows) {
+        if (row.get_field("id") == primary_key) {
+            *row_out = std::move(row);
+            break;
+        }
+    }
+    return true;
+}
+
+bool slow_queries_artificial_table_backend_t::write_row(
+        UNUSED auth::user_context_t const &user_context,
+        UNUSED ql::datum_t primary_key,
+        UNUSED bool pkey_was_autogenerated,
+        UNUSED ql::datum_t *new_value_inout,
+        UNUSED signal_t *interruptor_on_caller,
+        admin_err_t *error_out) {
+    *error_out = admin_err_t{
+        "It's illegal to write to the `rethinkdb.slow_queries` table.",
+        query_state_t::FAILED};
+    return false;
+}
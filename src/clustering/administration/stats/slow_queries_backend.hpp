@@ -0,0 +1,62 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#ifndef CLUSTERING_ADMINISTRATION_STATS_SLOW_QUERIES_BACKEND_HPP_
+#define CLUSTERING_ADMINISTRATION_STATS_SLOW_QUERIES_BACKEND_HPP_
+
+#include <string>
+#include <vector>
+
+#include "clustering/administration/metadata.hpp"
+#include "rdb_protocol/artificial_table/caching_cfeed_backend.hpp"
+
+/* `rethinkdb.slow_queries` shows the slow query log of every connected server, which is
+the `query_engine.slow_queries` perfmon. Every row is one slow response; see
+`slow_query_log_t` for what goes into it. The logs only live in memory, so a server's
+rows go away when it restarts. */
+class slow_queries_artificial_table_backend_t :
+    public timer_cfeed_artificial_table_backend_t
+{
+public:
+    slow_queries_artificial_table_backend_t(
+            rdb_context_t *rdb_context,
+            lifetime_t<name_resolver_t const &> name_resolver,
+            mailbox_manager_t *_mailbox_manager,
+            watchable_map_t<peer_id_t, cluster_directory_metadata_t> *_directory,
+            admin_identifier_format_t _identifier_format);
+    ~slow_queries_artificial_table_backend_t();
+
+    std::string get_primary_key_name();
+
+    bool read_all_rows_as_vector(
+            auth::user_context_t const &user_context,
+            signal_t *interruptor,
+            std::vector<ql::datum_t> *rows_out,
+            admin_err_t *error_out);
+
+    bool read_row(
+            auth::user_context_t const &user_context,
+            ql::datum_t primary_key,
+            signal_t *interruptor,
+            ql::datum_t *row_out,
+            admin_err_t *error_out);
+
+    bool write_row(
+            auth::user_context_t const &user_context,
+            ql::datum_t primary_key,
+            bool pkey_was_autogenerated,
+            ql::datum_t *new_value_inout,
+            signal_t *interruptor,
+            admin_err_t *error_out);
+
+private:
+    /* Users other than `admin` only see their own queries. */
+    void get_all_slow_queries(
+            auth::user_context_t const &user_context,
+            signal_t *interruptor_on_home,
+            std::vector<ql::datum_t> *rows_out);
+
+    mailbox_manager_t *mailbox_manager;
+    watchable_map_t<peer_id_t, cluster_directory_metadata_t> *directory;
+    admin_identifier_format_t identifier_format;
+};
+
+#endif /* CLUSTERING_ADMINISTRATION_STATS_SLOW_QUERIES_BACKEND_HPP_ */
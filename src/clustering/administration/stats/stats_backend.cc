@@ -18,13 +18,15 @@ stats_artificial_table_backend_t::stats_artificial_table_backend_t(
         mailbox_manager_t *_mailbox_manager,
         admin_identifier_format_t _admin_format) :
     timer_cfeed_artificial_table_backend_t(
-        name_string_t::guarantee_valid("stats"), rdb_context, name_resolver),
+        name_string_t::guarantee_valid("stats"), rdb_context, name_resolver,
+        STATS_TABLE_MAX_STALENESS_MS),
     directory_view(_directory_view),
     cluster_sl_view(_cluster_sl_view),
     server_config_client(_server_config_client),
     table_meta_client(_table_meta_client),
     mailbox_manager(_mailbox_manager),
-    admin_format(_admin_format) { }
+    admin_format(_admin_format),
+    global_stats_time(0) { }
 
 stats_artificial_table_backend_t::~stats_artificial_table_backend_t() {
     begin_changefeed_destruction();
@@ -81,6 +83,26 @@ void stats_artificial_table_backend_t::perform_stats_request(
     }
 }
 
+void stats_artificial_table_backend_t::get_global_stats(
+        std::vector<ql::datum_t> *results_out,
+        signal_t *interruptor_on_home) {
+    assert_thread();
+    new_mutex_acq_t acq(&global_stats_mutex, interruptor_on_home);
+    microtime_t now = current_microtime();
+    if (global_stats_time == 0 ||
+            now < global_stats_time ||
+            now - global_stats_time >= STATS_TABLE_MAX_STALENESS_MS * 1000) {
+        std::vector<peer_id_t> peers =
+            stats_request_t::all_peers(directory_view->get().get_inner());
+        std::vector<ql::datum_t> results;
+        perform_stats_request(peers, stats_request_t::global_stats_filter(), &results,
+            interruptor_on_home);
+        global_stats = std::move(results);
+        global_stats_time = now;
+    }
+    *results_out = global_stats;
+}
+
 // A row is excluded if it fails to convert to a datum - which should only
 // happen if the entity was deleted from the metadata
 void maybe_append_result(const stats_request_t &request,
@@ -108,12 +130,8 @@ bool stats_artificial_table_backend_t::read_all_rows_as_vector(
 
     cluster_semilattice_metadata_t metadata = cluster_sl_view->get();
 
-    std::set<std::vector<std::string> > filter = stats_request_t::global_stats_filter();
-    std::vector<peer_id_t> peers =
-        stats_request_t::all_peers(directory_view->get().get_inner());
-
     std::vector<ql::datum_t> results;
-    perform_stats_request(peers, filter, &results, &interruptor_on_home);
+    get_global_stats(&results, &interruptor_on_home);
     parsed_stats_t parsed_stats(results);
 
     // Start building results
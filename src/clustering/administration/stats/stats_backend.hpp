@@ -9,6 +9,7 @@
 #include "rdb_protocol/artificial_table/caching_cfeed_backend.hpp"
 #include "clustering/administration/metadata.hpp"
 #include "clustering/administration/servers/config_client.hpp"
+#include "concurrency/new_mutex.hpp"
 #include "concurrency/watchable.hpp"
 
 class stats_artificial_table_backend_t :
@@ -63,6 +64,13 @@ private:
                                std::vector<ql::datum_t> *results_out,
                                signal_t *interruptor_on_home);
 
+    /* `get_global_stats()` is like `perform_stats_request()` for all of the servers and
+    `stats_request_t::global_stats_filter()`, but it reuses the last results if they're
+    less than `STATS_TABLE_MAX_STALENESS_MS` old. Concurrent calls wait for the same
+    request instead of each sending their own. */
+    void get_global_stats(std::vector<ql::datum_t> *results_out,
+                          signal_t *interruptor_on_home);
+
     clone_ptr_t<watchable_t<change_tracking_map_t<peer_id_t,
         cluster_directory_metadata_t> > > directory_view;
     std::shared_ptr<semilattice_read_view_t<cluster_semilattice_metadata_t> >
@@ -71,6 +79,13 @@ private:
     table_meta_client_t *table_meta_client;
     mailbox_manager_t *mailbox_manager;
     admin_identifier_format_t admin_format;
+
+    /* `global_stats` holds the results of the last request that `get_global_stats()`
+    made, and `global_stats_time` is when that request was made, or 0 if there wasn't
+    one yet. `global_stats_mutex` protects both. */
+    new_mutex_t global_stats_mutex;
+    std::vector<ql::datum_t> global_stats;
+    microtime_t global_stats_time;
 };
 
 #endif /* CLUSTERING_ADMINISTRATION_STATS_STATS_BACKEND_HPP_ */
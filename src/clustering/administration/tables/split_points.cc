@@ -89,7 +89,8 @@ void fetch_distribution(
         const namespace_id_t &table_id,
         real_reql_cluster_interface_t *reql_cluster_interface,
         signal_t *interruptor,
-        std::map<store_key_t, int64_t> *counts_out)
+        std::map<store_key_t, int64_t> *counts_out,
+        std::map<store_key_t, int64_t> *load_counts_out)
         THROWS_ONLY(interrupted_exc_t, failed_table_op_exc_t, no_such_table_exc_t) {
     namespace_interface_access_t ns_if_access =
         reql_cluster_interface->get_namespace_repo()->get_namespace_interface(
@@ -113,8 +114,35 @@ void fetch_distribution(
         /* If `get_name()` didn't throw, the table exists but is inaccessible */
         throw failed_table_op_exc_t();
     }
-    *counts_out = std::move(
-        boost::get<distribution_read_response_t>(resp.response).key_counts);
+    distribution_read_response_t *dist_resp =
+        boost::get<distribution_read_response_t>(&resp.response);
+    *counts_out = std::move(dist_resp->key_counts);
+    if (load_counts_out != nullptr) {
+        *load_counts_out = std::move(dist_resp->load_counts);
+    }
+}
+
+std::map<store_key_t, int64_t> combine_distribution_with_load(
+        const std::map<store_key_t, int64_t> &counts,
+        const std::map<store_key_t, int64_t> &load_counts) {
+    int64_t total_count = 0, total_load = 0;
+    for (const auto &pair : counts) {
+        total_count += pair.second;
+    }
+    for (const auto &pair : load_counts) {
+        total_load += pair.second;
+    }
+    if (total_load == 0) {
+        return counts;
+    }
+    /* If the table is empty but busy, the load alone decides. */
+    const double scale = total_count == 0
+        ? 1.0 : static_cast<double>(total_count) / static_cast<double>(total_load);
+    std::map<store_key_t, int64_t> combined = counts;
+    for (const auto &pair : load_counts) {
+        combined[pair.first] += static_cast<int64_t>(pair.second * scale);
+    }
+    return combined;
 }
 
 bool calculate_split_points_with_distribution(
@@ -224,10 +252,12 @@ void calculate_split_points_intelligently(
         table_shard_scheme_t *split_points_out)
         THROWS_ONLY(interrupted_exc_t, failed_table_op_exc_t, no_such_table_exc_t) {
     if (num_shards > old_split_points.num_shards()) {
-        std::map<store_key_t, int64_t> counts;
-        fetch_distribution(table_id, reql_cluster_interface, interruptor, &counts);
+        std::map<store_key_t, int64_t> counts, load_counts;
+        fetch_distribution(
+            table_id, reql_cluster_interface, interruptor, &counts, &load_counts);
         if (!calculate_split_points_with_distribution(
-                counts, num_shards, split_points_out)) {
+                combine_distribution_with_load(counts, load_counts),
+                num_shards, split_points_out)) {
             /* There aren't enough documents to calculate distribution. We'll just assume
             the user is going to use UUID primary keys. If we got it wrong, they will end
             up with horribly unbalanced data, but it's the best we can do. */
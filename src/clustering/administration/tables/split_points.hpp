@@ -14,14 +14,24 @@ class real_reql_cluster_interface_t;
 class signal_t;
 class table_shard_scheme_t;
 
-/* `fetch_distribution` fetches the distribution information from the database. */
+/* `fetch_distribution` fetches the distribution information from the database. If
+`load_counts_out` is non-null, it's filled with the distribution of recent reads and
+writes over the key space. */
 void fetch_distribution(
         const namespace_id_t &table_id,
         real_reql_cluster_interface_t *reql_cluster_interface,
         signal_t *interruptor,
-        std::map<store_key_t, int64_t> *counts_out)
+        std::map<store_key_t, int64_t> *counts_out,
+        std::map<store_key_t, int64_t> *load_counts_out = nullptr)
         THROWS_ONLY(interrupted_exc_t, failed_table_op_exc_t, no_such_table_exc_t);
 
+/* `combine_distribution_with_load` produces a distribution in which the documents and
+the recent load each account for half of the total weight, so that splitting it evenly
+balances both. If there was no load, it returns `counts` unchanged. */
+std::map<store_key_t, int64_t> combine_distribution_with_load(
+        const std::map<store_key_t, int64_t> &counts,
+        const std::map<store_key_t, int64_t> &load_counts);
+
 /* `calculate_split_points_with_distribution` generates a set of split points that are
 guaranteed to divide the data approximately evenly, using the results of
 `fetch_distribution()`. It returns `false` if there are too few documents in the
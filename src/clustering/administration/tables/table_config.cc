@@ -275,6 +275,125 @@ bool convert_flush_interval_from_datum(
     return true;
 }
 
+ql::datum_t convert_cache_config_to_datum(const table_cache_config_t &cache) {
+    ql::datum_object_builder_t builder;
+    builder.overwrite("reserved_size_mb",
+        ql::datum_t(static_cast<double>(cache.reserved_size) / MEGABYTE));
+    builder.overwrite("pinned", ql::datum_t::boolean(cache.pinned));
+    return std::move(builder).to_datum();
+}
+
+bool convert_cache_config_from_datum(
+        const ql::datum_t &datum,
+        table_cache_config_t *cache_out,
+        admin_err_t *error_out) {
+    converter_from_datum_object_t converter;
+    if (!converter.init(datum, error_out)) {
+        return false;
+    }
+
+    ql::datum_t reserved_size_datum;
+    if (converter.get("reserved_size_mb", &reserved_size_datum, error_out)) {
+        if (reserved_size_datum.get_type() != ql::datum_t::R_NUM) {
+            *error_out = admin_err_t{
+                "In `reserved_size_mb`: Expected a number, got "
+                    + reserved_size_datum.print(),
+                query_state_t::FAILED};
+            return false;
+        }
+        double reserved_size_mb = reserved_size_datum.as_num();
+        if (reserved_size_mb * MEGABYTE >
+                static_cast<double>(std::numeric_limits<int64_t>::max())) {
+            *error_out = admin_err_t{
+                "In `reserved_size_mb`: Value is too big.",
+                query_state_t::FAILED};
+            return false;
+        }
+        if (reserved_size_mb < 0) {
+            *error_out = admin_err_t{
+                "In `reserved_size_mb`: Reserved size cannot be negative.",
+                query_state_t::FAILED};
+            return false;
+        }
+        cache_out->reserved_size = reserved_size_mb * MEGABYTE;
+    } else {
+        cache_out->reserved_size = default_table_cache_config().reserved_size;
+    }
+
+    ql::datum_t pinned_datum;
+    if (converter.get("pinned", &pinned_datum, error_out)) {
+        if (pinned_datum.get_type() != ql::datum_t::R_BOOL) {
+            *error_out = admin_err_t{
+                "In `pinned`: Expected a boolean, got " + pinned_datum.print(),
+                query_state_t::FAILED};
+            return false;
+        }
+        cache_out->pinned = pinned_datum.as_bool();
+    } else {
+        cache_out->pinned = default_table_cache_config().pinned;
+    }
+
+    if (!converter.check_no_extra_keys(error_out)) {
+        return false;
+    }
+
+    return true;
+}
+
+ql::datum_t convert_ttl_config_to_datum(const optional<table_ttl_config_t> &ttl) {
+    if (!ttl.has_value()) {
+        return ql::datum_t::null();
+    }
+    ql::datum_object_builder_t builder;
+    builder.overwrite("index", convert_string_to_datum(ttl->index));
+    builder.overwrite("seconds", ql::datum_t(ttl->seconds));
+    return std::move(builder).to_datum();
+}
+
+bool convert_ttl_config_from_datum(
+        const ql::datum_t &datum,
+        optional<table_ttl_config_t> *ttl_out,
+        admin_err_t *error_out) {
+    if (datum.get_type() == ql::datum_t::R_NULL) {
+        *ttl_out = r_nullopt;
+        return true;
+    }
+    converter_from_datum_object_t converter;
+    if (!converter.init(datum, error_out)) {
+        return false;
+    }
+    table_ttl_config_t ttl;
+
+    ql::datum_t index_datum;
+    if (!converter.get("index", &index_datum, error_out)) {
+        return false;
+    }
+    if (!convert_string_from_datum(index_datum, &ttl.index, error_out)) {
+        error_out->msg = "In `index`: " + error_out->msg;
+        return false;
+    }
+
+    ql::datum_t seconds_datum;
+    if (!converter.get("seconds", &seconds_datum, error_out)) {
+        return false;
+    }
+    if (seconds_datum.get_type() != ql::datum_t::R_NUM
+            || !(seconds_datum.as_num() > 0)) {
+        *error_out = admin_err_t{
+            "In `seconds`: Expected a positive number, got "
+                + seconds_datum.print(),
+            query_state_t::FAILED};
+        return false;
+    }
+    ttl.seconds = seconds_datum.as_num();
+
+    if (!converter.check_no_extra_keys(error_out)) {
+        return false;
+    }
+    *ttl_out = make_optional(std::move(ttl));
+    return true;
+}
+
 ql::datum_t convert_table_config_shard_to_datum(
         const table_config_t::shard_t &shard,
         admin_identifier_format_t identifier_format,
@@ -461,6 +580,8 @@ ql::datum_t convert_table_config_to_datum(
     builder.overwrite("flush_interval",
         convert_flush_interval_to_datum(config.flush_interval));
     builder.overwrite("data", config.user_data.datum);
+    builder.overwrite("cache", convert_cache_config_to_datum(config.cache));
+    builder.overwrite("ttl", convert_ttl_config_to_datum(config.ttl));
     return std::move(builder).to_datum();
 }
 
@@ -531,7 +652,8 @@ bool convert_table_config_and_name_from_datum(
     }
 
     /* As a special case, we allow the user to omit `indexes`, `primary_key`, `shards`,
-    `write_acks`, `durability`, and/or `data` for newly-created tables. */
+    `write_acks`, `durability`, `data`, `cache`, and/or `ttl` for newly-created
+    tables. */
 
     if (converter.has("indexes")) {
         ql::datum_t indexes_datum;
@@ -703,6 +825,33 @@ bool convert_table_config_and_name_from_datum(
         config_out->user_data = default_user_data();
     }
 
+    if (existed_before || converter.has("cache")) {
+        ql::datum_t cache_datum;
+        if (!converter.get("cache", &cache_datum, error_out)) {
+            return false;
+        }
+        if (!convert_cache_config_from_datum(
+                cache_datum, &config_out->cache, error_out)) {
+            error_out->msg = "In `cache`: " + error_out->msg;
+            return false;
+        }
+    } else {
+        config_out->cache = default_table_cache_config();
+    }
+
+    if (existed_before || converter.has("ttl")) {
+        ql::datum_t ttl_datum;
+        if (!converter.get("ttl", &ttl_datum, error_out)) {
+            return false;
+        }
+        if (!convert_ttl_config_from_datum(ttl_datum, &config_out->ttl, error_out)) {
+            error_out->msg = "In `ttl`: " + error_out->msg;
+            return false;
+        }
+    } else {
+        config_out->ttl = r_nullopt;
+    }
+
     if (!converter.check_no_extra_keys(error_out)) {
         return false;
     }
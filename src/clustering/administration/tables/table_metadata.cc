@@ -34,6 +34,16 @@ RDB_IMPL_EQUALITY_COMPARABLE_1(user_data_t, datum);
 
 RDB_IMPL_EQUALITY_COMPARABLE_1(flush_interval_config_t, variant);
 
+table_cache_config_t default_table_cache_config() {
+    return table_cache_config_t{0, false};
+}
+
+RDB_IMPL_SERIALIZABLE_2_SINCE_v2_6(table_cache_config_t, reserved_size, pinned);
+RDB_IMPL_EQUALITY_COMPARABLE_2(table_cache_config_t, reserved_size, pinned);
+
+RDB_IMPL_SERIALIZABLE_2_SINCE_v2_6(table_ttl_config_t, index, seconds);
+RDB_IMPL_EQUALITY_COMPARABLE_2(table_ttl_config_t, index, seconds);
+
 RDB_DECLARE_SERIALIZABLE(table_config_t);
 
 template <cluster_version_t W>
@@ -68,6 +78,8 @@ archive_result_t deserialize_table_config_pre_v2_4(
     tc->durability = std::move(durability);
     tc->flush_interval = default_flush_interval_config();
     tc->user_data = default_user_data();
+    tc->cache = default_table_cache_config();
+    tc->ttl = r_nullopt;
 
     return res;
 }
@@ -108,7 +120,60 @@ archive_result_t deserialize_table_config_v2_4(
                          std::move(write_ack_config),
                          std::move(durability),
                          default_flush_interval_config(),
-                         default_user_data()};
+                         default_user_data(),
+                         default_table_cache_config(),
+                         r_nullopt};
+
+    return res;
+}
+
+archive_result_t deserialize_table_config_v2_5(
+    read_stream_t *s, table_config_t *tc) {
+    const cluster_version_t W = cluster_version_t::v2_5;
+    archive_result_t res;
+
+    table_basic_config_t basic;
+    res = deserialize<W>(s, &basic);
+    if (bad(res)) { return res; }
+
+    std::vector<table_config_t::shard_t> shards;
+    res = deserialize<W>(s, &shards);
+    if (bad(res)) { return res; }
+
+    optional<write_hook_config_t> write_hook;
+    res = deserialize<W>(s, &write_hook);
+    if (bad(res)) { return res; }
+
+    std::map<std::string, sindex_config_t> sindexes;
+    res = deserialize<W>(s, &sindexes);
+    if (bad(res)) { return res; }
+
+    write_ack_config_t write_ack_config;
+    res = deserialize<W>(s, &write_ack_config);
+    if (bad(res)) { return res; }
+
+    write_durability_t durability;
+    res = deserialize<W>(s, &durability);
+    if (bad(res)) { return res; }
+
+    flush_interval_config_t flush_interval;
+    res = deserialize<W>(s, &flush_interval);
+    if (bad(res)) { return res; }
+
+    user_data_t user_data;
+    res = deserialize<W>(s, &user_data);
+    if (bad(res)) { return res; }
+
+    *tc = table_config_t{std::move(basic),
+                         std::move(shards),
+                         std::move(sindexes),
+                         std::move(write_hook),
+                         std::move(write_ack_config),
+                         std::move(durability),
+                         std::move(flush_interval),
+                         std::move(user_data),
+                         default_table_cache_config(),
+                         r_nullopt};
 
     return res;
 }
@@ -137,13 +202,19 @@ archive_result_t deserialize<cluster_version_t::v2_4>(
     return deserialize_table_config_v2_4(s, tc);
 }
 
-RDB_IMPL_SERIALIZABLE_8_SINCE_v2_5(table_config_t,
+template <>
+archive_result_t deserialize<cluster_version_t::v2_5>(
+    read_stream_t *s, table_config_t *tc) {
+    return deserialize_table_config_v2_5(s, tc);
+}
+
+RDB_IMPL_SERIALIZABLE_10_SINCE_v2_6(table_config_t,
     basic, shards, write_hook, sindexes, write_ack_config, durability,
-    flush_interval, user_data);
+    flush_interval, user_data, cache, ttl);
 
-RDB_IMPL_EQUALITY_COMPARABLE_8(table_config_t,
+RDB_IMPL_EQUALITY_COMPARABLE_10(table_config_t,
     basic, shards, write_hook, sindexes, write_ack_config, durability,
-    flush_interval, user_data);
+    flush_interval, user_data, cache, ttl);
 
 RDB_IMPL_SERIALIZABLE_1_SINCE_v1_16(table_shard_scheme_t, split_points);
 RDB_IMPL_EQUALITY_COMPARABLE_1(table_shard_scheme_t, split_points);
@@ -77,6 +77,33 @@ public:
 
 user_data_t default_user_data();
 
+/* `table_cache_config_t` protects a table's data in the cache from the other tables
+on the server. Every replica of the table keeps at least `reserved_size` bytes of it in
+the cache (if it has that much), and a `pinned` table never gets evicted at all. */
+class table_cache_config_t {
+public:
+    uint64_t reserved_size;
+    bool pinned;
+};
+
+table_cache_config_t default_table_cache_config();
+
+RDB_DECLARE_SERIALIZABLE(table_cache_config_t);
+RDB_DECLARE_EQUALITY_COMPARABLE(table_cache_config_t);
+
+/* `table_ttl_config_t` makes rows of a table expire. A row expires `seconds` after the
+time that the secondary index `index` maps it to, and the primary replicas delete
+expired rows in the background. Rows that the index doesn't map to a time never
+expire. */
+class table_ttl_config_t {
+public:
+    std::string index;
+    double seconds;
+};
+
+RDB_DECLARE_SERIALIZABLE(table_ttl_config_t);
+RDB_DECLARE_EQUALITY_COMPARABLE(table_ttl_config_t);
+
 /* `table_config_t` describes the complete contents of the `rethinkdb.table_config`
 artificial table. */
 
@@ -107,6 +134,8 @@ public:
     write_durability_t durability;
     flush_interval_config_t flush_interval;
     user_data_t user_data;  // has user-exposed name "data"
+    table_cache_config_t cache;
+    optional<table_ttl_config_t> ttl;
 };
 
 RDB_DECLARE_EQUALITY_COMPARABLE(table_config_t);
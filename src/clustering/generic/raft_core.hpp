@@ -5,6 +5,7 @@
 #include <deque>
 #include <set>
 #include <map>
+#include <string>
 
 #include "errors.hpp"
 #include <boost/variant.hpp>
@@ -412,6 +413,19 @@ public:
         const raft_log_t<state_t> &source,
         raft_log_index_t first_replaced) = 0;
 
+    /* Does the same as `write_log_replace_tail()` followed by `write_commit_index()`.
+    Followers use this when an append-entries RPC advances the commit index too, so that
+    implementations can store both changes with a single disk write. The default
+    implementation just calls the other two methods; that's still safe, since a crash
+    between them only loses the commit index update. */
+    virtual void write_log_replace_tail_and_commit_index(
+            const raft_log_t<state_t> &source,
+            raft_log_index_t first_replaced,
+            raft_log_index_t commit_index) {
+        write_log_replace_tail(source, first_replaced);
+        write_commit_index(commit_index);
+    }
+
     /* Append a single entry to the log. */
     virtual void write_log_append_one(
         const raft_log_entry_t<state_t> &entry) = 0;
@@ -459,21 +473,21 @@ private:
     described in Figure 13 of the Raft paper. */
     class install_snapshot_t {
     public:
-        /* `term`, `leader_id`, `last_included_index`, and `last_included_term`
-        correspond to the parameters with the same names in the Raft paper. In the Raft
-        paper, the content of the snapshot is sent as a series of binary blobs, but we
-        don't want to do that; instead, we send the `state_t` and `raft_complex_config_t`
-        directly. So our `snapshot_state` and `snapshot_config` parameters replace the
-        `offset`, `data`, and `done` parameters of the Raft paper. */
+        /* `term`, `leader_id`, `last_included_index`, `last_included_term`, `offset`,
+        `data`, and `done` correspond to the parameters with the same names in the Raft
+        paper. The snapshot is the serialized `state_t` and `raft_complex_config_t`,
+        split into chunks of at most `snapshot_chunk_size` bytes, so a large snapshot
+        doesn't have to go out in a single message. */
         raft_term_t term;
         raft_member_id_t leader_id;
         raft_log_index_t last_included_index;
         raft_term_t last_included_term;
-        state_t snapshot_state;
-        raft_complex_config_t snapshot_config;
-        RDB_MAKE_ME_SERIALIZABLE_6(install_snapshot_t,
-            term, leader_id, last_included_index, last_included_term, snapshot_state,
-            snapshot_config);
+        uint64_t offset;
+        std::string data;
+        bool done;
+        RDB_MAKE_ME_SERIALIZABLE_7(install_snapshot_t,
+            term, leader_id, last_included_index, last_included_term, offset, data,
+            done);
     };
 
     /* `append_entries_t` describes the parameters of the "AppendEntries RPC" described
@@ -514,8 +528,13 @@ private:
     "InstallSnapshot RPC" described in Figure 13 of the Raft paper. */
     class install_snapshot_t {
     public:
+        /* `next_offset` doesn't appear in the Raft paper. It's the offset of the next
+        chunk the follower expects. Usually that's right after the chunk it just got,
+        but it's zero if the follower lost track of the snapshot (say, because it
+        restarted), in which case the leader starts over. */
         raft_term_t term;
-        RDB_MAKE_ME_SERIALIZABLE_1(install_snapshot_t, term);
+        uint64_t next_offset;
+        RDB_MAKE_ME_SERIALIZABLE_2(install_snapshot_t, term, next_offset);
     };
 
     /* `append_entries_t` describes the information returned from the
@@ -751,6 +770,14 @@ private:
     a snapshot to compress them. */
     const size_t snapshot_threshold = 20;
 
+    /* When an install-snapshot RPC is necessary, the snapshot is sent in chunks of this
+    many bytes. */
+    const size_t snapshot_chunk_size = 1024 * 1024;
+
+    /* This is the maximum number of append-entries RPCs that `leader_send_updates()`
+    will have outstanding to a single peer at once. */
+    const size_t max_append_entries_in_flight = 4;
+
     /* Note: Methods prefixed with `follower_`, `candidate_`, or `leader_` are methods
     that are only used when in that state. This convention will hopefully make the code
     slightly clearer. */
@@ -812,7 +839,8 @@ private:
                      const new_mutex_acq_t *mutex_acq);
 
     /* When we change the commit index we have to also apply changes to the state
-    machine. `update_commit_index()` handles that automatically. */
+    machine. `update_commit_index()` handles that automatically. It only writes the new
+    commit index to disk if the caller hasn't already done so. */
     void update_commit_index(raft_log_index_t new_commit_index,
                              const new_mutex_acq_t *mutex_acq);
 
@@ -956,6 +984,20 @@ private:
     then it must be empty. */
     std::map<raft_member_id_t, raft_log_index_t> match_indexes;
 
+    /* `snapshot_transfer_t` describes a snapshot that is being sent in chunks. The
+    leader's `leader_send_updates()` keeps one for each peer that it's sending a
+    snapshot to; `incoming_snapshot` holds the chunks we've received so far if we're a
+    follower. `term` is the leader's term; if a new leader comes along, it will start
+    over from the first chunk. */
+    class snapshot_transfer_t {
+    public:
+        raft_term_t term;
+        raft_log_index_t last_included_index;
+        raft_term_t last_included_term;
+        std::string data;
+    };
+    optional<snapshot_transfer_t> incoming_snapshot;
+
     /* `readiness_for_change` and `readiness_for_config_change` track whether this member
     is ready to accept changes. A member is ready for changes if it is leader and in
     contact with a quorum of followers; it is ready for config changes if those
@@ -7,6 +7,7 @@
 #include "arch/compiler.hpp"
 #include "arch/runtime/coroutines.hpp"
 #include "concurrency/exponential_backoff.hpp"
+#include "containers/archive/string_stream.hpp"
 #include "containers/map_sentries.hpp"
 #include "logger.hpp"
 
@@ -526,6 +527,8 @@ void raft_member_t<state_t>::on_install_snapshot_rpc(
     new_mutex_acq_t mutex_acq(&mutex);
     DEBUG_ONLY_CODE(check_invariants(&mutex_acq));
 
+    reply_out->next_offset = 0;
+
     if (!on_rpc_from_leader(request.leader_id, request.term, &mutex_acq)) {
         /* Raft paper, Figure 2: term should be set to "currentTerm, for leader to update
         itself" */
@@ -534,6 +537,55 @@ void raft_member_t<state_t>::on_install_snapshot_rpc(
         return;
     }
 
+    /* Raft paper, Figure 13: "Create new snapshot file if first chunk (offset is 0)"
+    and "Write data into snapshot file at given offset". We keep the chunks in memory
+    rather than in a file. A chunk that repeats data we already have is fine; a chunk
+    that would leave a gap, or that belongs to a snapshot we don't know about, makes
+    us ask the leader to start over. */
+    if (request.offset == 0) {
+        snapshot_transfer_t snapshot;
+        snapshot.term = request.term;
+        snapshot.last_included_index = request.last_included_index;
+        snapshot.last_included_term = request.last_included_term;
+        incoming_snapshot.set(std::move(snapshot));
+    } else if (!incoming_snapshot.has_value() ||
+            incoming_snapshot.get().term != request.term ||
+            incoming_snapshot.get().last_included_index != request.last_included_index ||
+            incoming_snapshot.get().last_included_term != request.last_included_term) {
+        incoming_snapshot.reset();
+        reply_out->term = ps().current_term;
+        DEBUG_ONLY_CODE(check_invariants(&mutex_acq));
+        return;
+    } else if (request.offset > incoming_snapshot.get().data.size()) {
+        reply_out->term = ps().current_term;
+        reply_out->next_offset = incoming_snapshot.get().data.size();
+        DEBUG_ONLY_CODE(check_invariants(&mutex_acq));
+        return;
+    }
+    std::string *snapshot_data = &incoming_snapshot.get().data;
+    snapshot_data->resize(request.offset);
+    snapshot_data->append(request.data);
+    reply_out->next_offset = snapshot_data->size();
+
+    /* Raft paper, Figure 13: "Reply and wait for more data chunks if done is false" */
+    if (!request.done) {
+        reply_out->term = ps().current_term;
+        DEBUG_ONLY_CODE(check_invariants(&mutex_acq));
+        return;
+    }
+
+    state_t snapshot_state;
+    raft_complex_config_t snapshot_config;
+    {
+        string_read_stream_t stream(std::move(*snapshot_data), 0);
+        incoming_snapshot.reset();
+        archive_result_t res =
+            deserialize<cluster_version_t::CLUSTER>(&stream, &snapshot_state);
+        guarantee_deserialization(res, "Raft snapshot state");
+        res = deserialize<cluster_version_t::CLUSTER>(&stream, &snapshot_config);
+        guarantee_deserialization(res, "Raft snapshot config");
+    }
+
     mutex_assertion_t::acq_t log_mutex_acq(&log_mutex);
 
     /* This implementation deviates from the Raft paper in the order it does things. The
@@ -568,8 +620,8 @@ void raft_member_t<state_t>::on_install_snapshot_rpc(
         Raft paper, Figure 13: "Save snapshot file"
         (We're going slightly out of order, as described above) */
         storage->write_snapshot(
-            request.snapshot_state,
-            request.snapshot_config,
+            snapshot_state,
+            snapshot_config,
             false,
             request.last_included_index,
             request.last_included_term,
@@ -586,8 +638,8 @@ void raft_member_t<state_t>::on_install_snapshot_rpc(
         Raft paper, Figure 13: "Save snapshot file"
         (We're going slightly out of order, as described above) */
         storage->write_snapshot(
-            request.snapshot_state,
-            request.snapshot_config,
+            snapshot_state,
+            snapshot_config,
             true,
             request.last_included_index,
             request.last_included_term,
@@ -697,13 +749,28 @@ void raft_member_t<state_t>::on_append_entries_rpc(
      In this case we truncate our own log starting at `first_nonmatching_index`, and
      replace it by the suffix of the `request` log starting at `first_nonmatching_index`.
     */
+    /* Raft paper, Figure 2: "If leaderCommit > commitIndex, set commitIndex = min(
+    leaderCommit, index of last new entry)"
+    We only apply the new commit index further down, but if we have to change the log
+    anyway then we store both changes on disk in the same write. */
+    optional<raft_log_index_t> new_commit_index;
+    if (request.leader_commit > committed_state.get_ref().log_index) {
+        new_commit_index.set(
+            std::min(request.leader_commit, request.entries.get_latest_index()));
+    }
+
     if (conflict || first_nonmatching_index > ps().log.get_latest_index()) {
         /* The Leader Completeness property ensures that the leader has all committed log
         entries. We must never truncate our log to become shorter than the current
         `commit_index`. */
         guarantee(first_nonmatching_index > ps().commit_index);
-        storage->write_log_replace_tail(
-            request.entries, first_nonmatching_index);
+        if (new_commit_index.has_value()) {
+            storage->write_log_replace_tail_and_commit_index(
+                request.entries, first_nonmatching_index, new_commit_index.get());
+        } else {
+            storage->write_log_replace_tail(
+                request.entries, first_nonmatching_index);
+        }
     }
 
     /* Because we modified `ps().log`, we need to update `latest_state`. */
@@ -719,12 +786,8 @@ void raft_member_t<state_t>::on_append_entries_rpc(
         return true;
     });
 
-    /* Raft paper, Figure 2: "If leaderCommit > commitIndex, set commitIndex = min(
-    leaderCommit, index of last new entry)" */
-    if (request.leader_commit > committed_state.get_ref().log_index) {
-        update_commit_index(
-            std::min(request.leader_commit, request.entries.get_latest_index()),
-            &mutex_acq);
+    if (new_commit_index.has_value()) {
+        update_commit_index(new_commit_index.get(), &mutex_acq);
     }
 
     reply_out->term = ps().current_term;
@@ -1133,7 +1196,9 @@ void raft_member_t<state_t>::update_commit_index(
     /* This implementation deviates from the Raft paper in that we persist the commit
     index to disk whenever it changes. This ensures that the state machine never appears
     to go backwards. */
-    storage->write_commit_index(new_commit_index);
+    if (ps().commit_index != new_commit_index) {
+        storage->write_commit_index(new_commit_index);
+    }
 
     /* Raft paper, Figure 2: "If commitIndex > lastApplied: increment lastApplied, apply
     log[lastApplied] to state machine"
@@ -1734,6 +1799,44 @@ void raft_member_t<state_t>::leader_send_updates(
         immediately. */
         exponential_backoff_t backoff(100, 1000);
 
+        /* If we're in the middle of sending a snapshot to the peer, `outgoing_snapshot`
+        is the serialized snapshot and `snapshot_offset` is where the next chunk starts.
+        If an RPC fails we resend from `snapshot_offset`, so a connection problem
+        doesn't make us start over. */
+        optional<snapshot_transfer_t> outgoing_snapshot;
+        uint64_t snapshot_offset = 0;
+
+        /* This implementation deviates from the Raft paper in that it doesn't wait for
+        the reply to an append-entries RPC before sending the next one. Up to
+        `max_append_entries_in_flight` of them can be outstanding at once, each one
+        waiting for its reply in its own coroutine. When we send an RPC we assume it
+        will succeed and advance `next_index` right away; if it turns out to fail, the
+        reply handler moves `next_index` back and we resend from there. This hides the
+        network round trip (and the follower's disk write) from a follower that is
+        falling behind. While the pipeline is full, new log entries pile up and go out
+        together in the next RPC.
+
+        `rpc_done_waiter` is pulsed when an outstanding RPC finishes, and
+        `got_higher_term` is set if a reply had a higher term than ours.
+        `rpc_drainer` must be declared after the other variables, because the reply
+        handlers use them. */
+        size_t rpcs_in_flight = 0;
+        cond_t *rpc_done_waiter = nullptr;
+        bool got_higher_term = false;
+        auto_drainer_t rpc_drainer;
+
+        /* Releases the mutex until an outstanding RPC finishes. */
+        auto wait_for_rpc_done = [&]() {
+            cond_t rpc_done;
+            assignment_sentry_t<cond_t *> rpc_done_sentry(&rpc_done_waiter, &rpc_done);
+            DEBUG_ONLY_CODE(check_invariants(mutex_acq.get()));
+            mutex_acq.reset();
+            wait_interruptible(&rpc_done, update_keepalive.get_drain_signal());
+            mutex_acq.init(
+                new new_mutex_acq_t(&mutex, update_keepalive.get_drain_signal()));
+            DEBUG_ONLY_CODE(check_invariants(mutex_acq.get()));
+        };
+
         /* This implementation deviates slightly from the Raft paper in that the initial
         message may not be an empty append-entries RPC. Because `leader_send_updates()`
         runs in its own coroutine, it's possible that entries may be appended to the log
@@ -1760,21 +1863,56 @@ void raft_member_t<state_t>::leader_send_updates(
                 new new_mutex_acq_t(&mutex, update_keepalive.get_drain_signal()));
             DEBUG_ONLY_CODE(check_invariants(mutex_acq.get()));
 
-            if (next_index <= ps().log.prev_index) {
+            if (got_higher_term) {
+                /* `candidate_and_leader_coro()` will be interrupted soon. */
+                return;
+            }
+
+            if (next_index <= ps().log.prev_index && rpcs_in_flight != 0) {
+                /* Let the outstanding append-entries RPCs finish first, so that their
+                replies don't get mixed up with the install-snapshot RPC. */
+                wait_for_rpc_done();
+
+            } else if (next_index <= ps().log.prev_index) {
                 /* The peer's log ends before our log begins. So we have to send an
                 install-snapshot RPC instead of an append-entries RPC. */
 
+                if (!outgoing_snapshot.has_value()) {
+                    snapshot_transfer_t snapshot;
+                    snapshot.term = ps().current_term;
+                    snapshot.last_included_index = ps().log.prev_index;
+                    snapshot.last_included_term = ps().log.prev_term;
+                    /* TODO: Maybe we should send `committed_state` instead of the
+                    snapshot. Under the current implementation, they will always be the
+                    same; but if we were to allow the snapshot to lag behind the
+                    committed state, sending `committed_state` would help the follower
+                    catch up faster. */
+                    write_message_t wm;
+                    serialize<cluster_version_t::CLUSTER>(&wm, ps().snapshot_state);
+                    serialize<cluster_version_t::CLUSTER>(&wm, ps().snapshot_config);
+                    string_stream_t stream;
+                    int write_res = send_write_message(&stream, &wm);
+                    guarantee(write_res == 0);
+                    snapshot.data = std::move(stream.str());
+                    outgoing_snapshot.set(std::move(snapshot));
+                    snapshot_offset = 0;
+                }
+
+                /* We keep sending the snapshot we started with, even if we've taken a
+                newer one in the meantime; otherwise we might never finish sending a
+                large snapshot while we're taking new ones quickly. */
+                const snapshot_transfer_t &snapshot = outgoing_snapshot.get();
+                const size_t chunk_size = std::min<size_t>(
+                    snapshot_chunk_size, snapshot.data.size() - snapshot_offset);
+
                 typename raft_rpc_request_t<state_t>::install_snapshot_t request;
                 request.term = ps().current_term;
                 request.leader_id = this_member_id;
-                request.last_included_index = ps().log.prev_index;
-                request.last_included_term = ps().log.prev_term;
-                /* TODO: Maybe we should send `committed_state` instead of the snapshot.
-                Under the current implementation, they will always be the same; but if we
-                were to allow the snapshot to lag behind the committed state, sending
-                `committed_state` would help the follower catch up faster. */
-                request.snapshot_state = ps().snapshot_state;
-                request.snapshot_config = ps().snapshot_config;
+                request.last_included_index = snapshot.last_included_index;
+                request.last_included_term = snapshot.last_included_term;
+                request.offset = snapshot_offset;
+                request.data = snapshot.data.substr(snapshot_offset, chunk_size);
+                request.done = snapshot_offset + chunk_size == snapshot.data.size();
                 raft_rpc_request_t<state_t> request_wrapper;
                 request_wrapper.request = request;
 
@@ -1798,8 +1936,9 @@ void raft_member_t<state_t>::leader_send_updates(
                     /* Raft paper, Section 5.1: "Servers retry RPCs if they do not
                     receive a response in a timely manner"
                     This implementation deviates from the Raft paper slightly in that we
-                    don't retry the exact same RPC necessarily. If the snapshot has been
-                    updated, we could send a newer snapshot on our next try. */
+                    don't retry the exact same RPC necessarily. If the peer's log grows
+                    past our snapshot in the meantime, we could send an append-entries
+                    RPC instead. */
                     continue;
                 }
 
@@ -1818,6 +1957,15 @@ void raft_member_t<state_t>::leader_send_updates(
                     return;
                 }
 
+                guarantee(reply->next_offset <= snapshot.data.size());
+                if (!request.done || reply->next_offset != snapshot.data.size()) {
+                    /* Raft paper, Figure 13: "Send the next chunk". If the peer lost
+                    track of the snapshot, `next_offset` will be zero. */
+                    snapshot_offset = reply->next_offset;
+                    continue;
+                }
+
+                outgoing_snapshot.reset();
                 next_index = request.last_included_index + 1;
                 leader_update_match_index(
                     peer,
@@ -1825,6 +1973,10 @@ void raft_member_t<state_t>::leader_send_updates(
                     mutex_acq.get());
                 send_even_if_empty = false;
 
+            } else if (rpcs_in_flight >= max_append_entries_in_flight) {
+                /* The pipeline is full. */
+                wait_for_rpc_done();
+
             } else if (next_index <= ps().log.get_latest_index() ||
                     member_commit_index < committed_state.get_ref().log_index ||
                     send_even_if_empty) {
@@ -1847,84 +1999,128 @@ void raft_member_t<state_t>::leader_send_updates(
                 raft_rpc_request_t<state_t> request_wrapper;
                 request_wrapper.request = request;
 
-                raft_rpc_reply_t reply_wrapper;
-                DEBUG_ONLY_CODE(check_invariants(mutex_acq.get()));
-                mutex_acq.reset();
-
-                bool ok = network->send_rpc(peer, request_wrapper,
-                    update_keepalive.get_drain_signal(), &reply_wrapper);
+                /* Assume that the RPC will succeed; see the comment by
+                `rpcs_in_flight`. */
+                next_index = request.entries.get_latest_index() + 1;
+                member_commit_index = request.leader_commit;
+                send_even_if_empty = false;
 
-                /* If the RPC failed, do the backoff before reacquiring the mutex */
-                if (!ok) {
-                    backoff.failure(update_keepalive.get_drain_signal());
-                }
+                ++rpcs_in_flight;
+                raft_log_index_t prev_index = request.entries.prev_index;
+                raft_log_index_t latest_index = request.entries.get_latest_index();
+                auto_drainer_t::lock_t rpc_keepalive(&rpc_drainer);
+                coro_t::spawn_sometime([this, &peer, &next_index, &send_even_if_empty,
+                        &backoff, &rpcs_in_flight, &rpc_done_waiter, &got_higher_term,
+                        request_wrapper, prev_index, latest_index, rpc_keepalive]() {
+                    try {
+                        raft_rpc_reply_t reply_wrapper;
+                        bool ok = network->send_rpc(peer, request_wrapper,
+                            rpc_keepalive.get_drain_signal(), &reply_wrapper);
+
+                        /* If the RPC failed, do the backoff before reacquiring the
+                        mutex */
+                        if (!ok) {
+                            backoff.failure(rpc_keepalive.get_drain_signal());
+                        }
 
-                mutex_acq.init(
-                    new new_mutex_acq_t(&mutex, update_keepalive.get_drain_signal()));
-                DEBUG_ONLY_CODE(check_invariants(mutex_acq.get()));
+                        new_mutex_acq_t rpc_mutex_acq(
+                            &mutex, rpc_keepalive.get_drain_signal());
+                        DEBUG_ONLY_CODE(this->check_invariants(&rpc_mutex_acq));
+                        --rpcs_in_flight;
+                        if (rpc_done_waiter != nullptr) {
+                            rpc_done_waiter->pulse_if_not_already_pulsed();
+                        }
+                        if (got_higher_term) {
+                            /* Another reply already told us that we're stepping down. */
+                            return;
+                        }
 
-                if (!ok) {
-                    /* Raft paper, Section 5.1: "Servers retry RPCs if they do not
-                    receive a response in a timely manner"
-                    This implementation deviates from the Raft paper slightly in that we
-                    don't retry the exact same RPC necessarily. If more entries have been
-                    added to the log, the RPC we retry will include those new entries; or
-                    if the peer falls too far behind, we might send an install-snapshot
-                    RPC next time. */
-                    continue;
-                }
+                        if (!ok) {
+                            /* Raft paper, Section 5.1: "Servers retry RPCs if they do
+                            not receive a response in a timely manner"
+                            This implementation deviates from the Raft paper slightly in
+                            that we don't retry the exact same RPC necessarily. We resend
+                            everything from where this RPC started, including any entries
+                            that were added to the log in the meantime; or if the peer
+                            falls too far behind, we might send an install-snapshot RPC
+                            next time. The RPC might also have carried a new commit index,
+                            so we resend even if there are no entries. */
+                            next_index = std::min(next_index, prev_index + 1);
+                            send_even_if_empty = true;
+                            return;
+                        }
 
-                backoff.success();
+                        backoff.success();
 
-                const raft_rpc_reply_t::append_entries_t *reply =
-                    boost::get<raft_rpc_reply_t::append_entries_t>(
-                        &reply_wrapper.reply);
-                guarantee(reply != nullptr, "Got wrong type of RPC response");
+                        const raft_rpc_reply_t::append_entries_t *reply =
+                            boost::get<raft_rpc_reply_t::append_entries_t>(
+                                &reply_wrapper.reply);
+                        guarantee(reply != nullptr, "Got wrong type of RPC response");
 
-                if (candidate_or_leader_note_term(reply->term, mutex_acq.get())) {
-                    /* We got a reply with a higher term than our term.
-                    `candidate_and_leader_coro()` will be interrupted soon. */
-                    RAFT_DEBUG_THIS("got rpc reply with term %" PRIu64 " from %s\n",
-                                    reply->term, show_member_id(peer).c_str());
-                    return;
-                }
+                        if (this->candidate_or_leader_note_term(
+                                reply->term, &rpc_mutex_acq)) {
+                            /* We got a reply with a higher term than our term.
+                            `candidate_and_leader_coro()` will be interrupted soon. */
+                            RAFT_DEBUG("got rpc reply with term %" PRIu64 " from %s\n",
+                                       reply->term, show_member_id(peer).c_str());
+                            got_higher_term = true;
+                            return;
+                        }
 
-                if (reply->success) {
-                    /* Raft paper, Figure 2: "If successful: update nextIndex and
-                    matchIndex for follower */
-                    next_index = request.entries.get_latest_index() + 1;
-                    if (match_indexes.at(peer) < request.entries.get_latest_index()) {
-                        leader_update_match_index(
-                            peer,
-                            request.entries.get_latest_index(),
-                            mutex_acq.get());
+                        if (reply->success) {
+                            /* Raft paper, Figure 2: "If successful: update nextIndex and
+                            matchIndex for follower"
+                            `next_index` is usually past `latest_index` already, but not
+                            if another RPC failed in the meantime. */
+                            next_index = std::max(next_index, latest_index + 1);
+                            if (this->match_indexes.at(peer) < latest_index) {
+                                this->leader_update_match_index(
+                                    peer, latest_index, &rpc_mutex_acq);
+                            }
+                        } else {
+                            /* Raft paper, Section 5.3: "After a rejection, the leader
+                            decrements nextIndex and retries the AppendEntries RPC.
+                            A rejection can also mean that this RPC overtook an earlier
+                            one; then the retry will overlap with the earlier RPC, which
+                            is harmless. */
+                            next_index = std::min(next_index, prev_index);
+                            send_even_if_empty = true;
+                        }
+                        DEBUG_ONLY_CODE(this->check_invariants(&rpc_mutex_acq));
+                    } catch (const interrupted_exc_t &) {
+                        /* `leader_send_updates()` is returning. */
                     }
-                    member_commit_index = request.leader_commit;
-                } else {
-                    /* Raft paper, Section 5.3: "After a rejection, the leader decrements
-                    nextIndex and retries the AppendEntries RPC. */
-                    --next_index;
-                }
-                send_even_if_empty = false;
+                });
 
             } else {
                 guarantee(next_index == ps().log.get_latest_index() + 1);
                 guarantee(member_commit_index == committed_state.get_ref().log_index);
-                /* OK, the peer is completely up-to-date. Wait until either an entry is
-                appended to the log or our commit index advances, and then go around the
-                loop again. */
+                /* OK, we've sent the peer everything. Wait until either an entry is
+                appended to the log, our commit index advances, or a reply to an
+                outstanding RPC arrives, and then go around the loop again. */
+
+                cond_t rpc_done;
+                assignment_sentry_t<cond_t *> rpc_done_sentry(
+                    &rpc_done_waiter, &rpc_done);
+                wait_any_t interruptor(&rpc_done, update_keepalive.get_drain_signal());
 
                 DEBUG_ONLY_CODE(check_invariants(mutex_acq.get()));
                 mutex_acq.reset();
 
-                run_until_satisfied_2(
-                    committed_state.get_watchable(),
-                    latest_state.get_watchable(),
-                    [&](const state_and_config_t &cs, const state_and_config_t &ls) {
-                        return cs.log_index > member_commit_index ||
-                            ls.log_index >= next_index;
-                    },
-                    update_keepalive.get_drain_signal());
+                try {
+                    run_until_satisfied_2(
+                        committed_state.get_watchable(),
+                        latest_state.get_watchable(),
+                        [&](const state_and_config_t &cs, const state_and_config_t &ls) {
+                            return cs.log_index > member_commit_index ||
+                                ls.log_index >= next_index;
+                        },
+                        &interruptor);
+                } catch (const interrupted_exc_t &) {
+                    if (update_keepalive.get_drain_signal()->is_pulsed()) {
+                        throw;
+                    }
+                }
 
                 mutex_acq.init(
                     new new_mutex_acq_t(&mutex, update_keepalive.get_drain_signal()));
@@ -1,16 +1,71 @@
 // Copyright 2010-2015 RethinkDB, all rights reserved.
 #include "clustering/immediate_consistency/backfill_metadata.hpp"
 
+#include <zlib.h>
+
+#include "containers/archive/string_stream.hpp"
+
 backfill_config_t::backfill_config_t() :
     item_queue_mem_size(4 * MEGABYTE),
     item_chunk_mem_size(100 * KILOBYTE),
     pre_item_queue_mem_size(4 * MEGABYTE),
-    pre_item_chunk_mem_size(100 * KILOBYTE)
+    pre_item_chunk_mem_size(100 * KILOBYTE),
+    compress_items(true)
     { }
 
-RDB_IMPL_SERIALIZABLE_4_FOR_CLUSTER(backfill_config_t,
+RDB_IMPL_SERIALIZABLE_5_FOR_CLUSTER(backfill_config_t,
     item_queue_mem_size, item_chunk_mem_size, pre_item_queue_mem_size,
-    pre_item_chunk_mem_size);
+    pre_item_chunk_mem_size, compress_items);
+
+/* The backfill competes with queries for CPU time, so we go for speed over ratio. */
+static const int backfill_compression_level = 1;
+
+compressed_backfill_item_seq_t::compressed_backfill_item_seq_t(
+        const backfill_item_seq_t<backfill_item_t> &seq, bool compress) :
+        compressed(false) {
+    write_message_t wm;
+    serialize<cluster_version_t::CLUSTER>(&wm, seq);
+    string_stream_t stream;
+    int res = send_write_message(&stream, &wm);
+    guarantee(res == 0);
+    data = std::move(stream.str());
+    uncompressed_size = data.size();
+
+    if (compress) {
+        /* If the compressed chunk wouldn't be smaller, `compress2()` runs out of room
+        and we send the chunk uncompressed. */
+        std::string compressed_data(data.size(), '\0');
+        uLongf compressed_size = compressed_data.size();
+        int zres = compress2(reinterpret_cast<Bytef *>(&compressed_data[0]),
+            &compressed_size, reinterpret_cast<const Bytef *>(data.data()),
+            data.size(), backfill_compression_level);
+        if (zres == Z_OK && compressed_size < data.size()) {
+            compressed_data.resize(compressed_size);
+            data = std::move(compressed_data);
+            compressed = true;
+        }
+    }
+}
+
+backfill_item_seq_t<backfill_item_t> compressed_backfill_item_seq_t::decompress() const {
+    std::string serialized;
+    if (compressed) {
+        serialized.resize(uncompressed_size);
+        uLongf decompressed_size = uncompressed_size;
+        int zres = uncompress(reinterpret_cast<Bytef *>(&serialized[0]),
+            &decompressed_size, reinterpret_cast<const Bytef *>(data.data()),
+            data.size());
+        guarantee(zres == Z_OK && decompressed_size == uncompressed_size,
+            "Got a corrupted chunk of backfill items.");
+    } else {
+        serialized = data;
+    }
+    string_read_stream_t stream(std::move(serialized), 0);
+    backfill_item_seq_t<backfill_item_t> seq;
+    archive_result_t res = deserialize<cluster_version_t::CLUSTER>(&stream, &seq);
+    guarantee_deserialization(res, "backfill item chunk");
+    return seq;
+}
 
 RDB_IMPL_SERIALIZABLE_8_FOR_CLUSTER(backfiller_bcard_t::intro_2_t,
     common_version, final_version_history, pre_items_mailbox, begin_session_mailbox,
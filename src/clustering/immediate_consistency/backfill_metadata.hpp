@@ -2,6 +2,8 @@
 #ifndef CLUSTERING_IMMEDIATE_CONSISTENCY_BACKFILL_METADATA_HPP_
 #define CLUSTERING_IMMEDIATE_CONSISTENCY_BACKFILL_METADATA_HPP_
 
+#include <string>
+
 #include "btree/backfill.hpp"
 #include "clustering/generic/registration_metadata.hpp"
 #include "clustering/immediate_consistency/backfill_item_seq.hpp"
@@ -34,10 +36,43 @@ public:
     /* The maximum size, in bytes, of a chunk of pre-items sent over the network from the
     backfillee to the backfiller. */
     size_t pre_item_chunk_mem_size;
+
+    /* Whether the backfiller should compress the chunks of items it sends to the
+    backfillee. The backfillee sends its `backfill_config_t` to the backfiller when it
+    registers, so this is how the two agree on it. */
+    bool compress_items;
 };
 
 RDB_DECLARE_SERIALIZABLE(backfill_config_t);
 
+/* `compressed_backfill_item_seq_t` is how a chunk of backfill items travels from the
+backfiller to the backfillee. If compression was asked for, the serialized chunk is
+compressed with zlib; if it was not, or if the chunk doesn't get any smaller, the chunk
+is sent as it is. Chunks are about `item_chunk_mem_size` bytes, so zlib's window spans
+many documents of the table, and the similarities between them are put to use without
+a separately trained dictionary. */
+class compressed_backfill_item_seq_t {
+public:
+    compressed_backfill_item_seq_t() : compressed(false), uncompressed_size(0) { }
+    compressed_backfill_item_seq_t(
+        const backfill_item_seq_t<backfill_item_t> &seq, bool compress);
+
+    bool is_compressed() const { return compressed; }
+
+    /* Returns the size of the chunk as it's sent over the network */
+    size_t get_data_size() const { return data.size(); }
+
+    backfill_item_seq_t<backfill_item_t> decompress() const;
+
+private:
+    bool compressed;
+    uint64_t uncompressed_size;
+    std::string data;
+
+    RDB_MAKE_ME_SERIALIZABLE_3(compressed_backfill_item_seq_t,
+        compressed, uncompressed_size, data);
+};
+
 /* The backfiller publishes a `backfiller_bcard_t` which the backfillee uses to contact
 it. The member types of `backfiller_bcard_t` describe the communications protocol between
 the backfiller and the backfillee.
@@ -169,7 +204,7 @@ public:
         fifo_enforcer_write_token_t,
         /* The `region_map_t` and the `backfill_item_seq_t` have the same region. */
         region_map_t<version_t>,
-        backfill_item_seq_t<backfill_item_t>
+        compressed_backfill_item_seq_t
         > items_mailbox_t;
 
     typedef mailbox_t<
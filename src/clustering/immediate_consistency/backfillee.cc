@@ -86,7 +86,9 @@ private:
     void run(auto_drainer_t::lock_t keepalive) {
         with_priority_t p(CORO_PRIORITY_BACKFILL_RECEIVER);
         try {
-            send(parent->mailbox_manager, parent->intro.begin_session_mailbox,
+            send(parent->mailbox_manager,
+                connectivity_cluster_t::message_class_t::BACKFILL,
+                parent->intro.begin_session_mailbox,
                 parent->fifo_source.enter_write(), threshold);
 
             /* Loop until we reach the end of the backfill range. */
@@ -259,7 +261,9 @@ private:
         size_t diff = items_mem_size_unacked - items.get_mem_size();
         if (diff != 0) {
             items_mem_size_unacked -= diff;
-            send(parent->mailbox_manager, parent->intro.ack_items_mailbox,
+            send(parent->mailbox_manager,
+                connectivity_cluster_t::message_class_t::BACKFILL,
+                parent->intro.ack_items_mailbox,
                 parent->fifo_source.enter_write(), diff);
         }
     }
@@ -267,7 +271,8 @@ private:
     void send_end_session_message() {
         guarantee(!sent_end_session);
         sent_end_session = true;
-        send(parent->mailbox_manager, parent->intro.end_session_mailbox,
+        send(parent->mailbox_manager, connectivity_cluster_t::message_class_t::BACKFILL,
+            parent->intro.end_session_mailbox,
             parent->fifo_source.enter_write());
     }
 
@@ -423,14 +428,14 @@ void backfillee_t::on_items(
         signal_t *interruptor,
         const fifo_enforcer_write_token_t &fifo_token,
         region_map_t<version_t> &&version,
-        backfill_item_seq_t<backfill_item_t> &&chunk) {
+        compressed_backfill_item_seq_t &&chunk) {
     fifo_enforcer_sink_t::exit_write_t exit_write(&fifo_sink, fifo_token);
     wait_interruptible(&exit_write, interruptor);
     if (session_interrupted) {
         return;
     }
     guarantee(current_session != nullptr);
-    current_session->on_items(std::move(version), std::move(chunk));
+    current_session->on_items(std::move(version), chunk.decompress());
 }
 
 void backfillee_t::on_ack_end_session(
@@ -501,7 +506,8 @@ void backfillee_t::send_pre_items(auto_drainer_t::lock_t keepalive) {
             pre_item_throttler_acq.transfer_in(std::move(sem_acq));
 
             /* Send the chunk over the network */
-            send(mailbox_manager, intro.pre_items_mailbox,
+            send(mailbox_manager, connectivity_cluster_t::message_class_t::BACKFILL,
+                intro.pre_items_mailbox,
                 fifo_source.enter_write(), chunk);
 
             /* Update `progress` */
@@ -120,7 +120,8 @@ backfiller_t::client_t::client_t(
     our_intro.ack_items_mailbox = ack_items_mailbox.get_address();
     our_intro.num_changes_estimate = num_changes_estimate;
     our_intro.progress_estimator = std::move(progress_estimator);
-    send(parent->mailbox_manager, intro.intro_mailbox, our_intro);
+    send(parent->mailbox_manager, connectivity_cluster_t::message_class_t::BACKFILL,
+        intro.intro_mailbox, our_intro);
 }
 
 /* `item_seq_pre_item_producer_t` is a `backfill_pre_item_producer_t` that reads from a
@@ -377,8 +378,11 @@ private:
                     try {
                         /* Send the chunk over the network */
                         send(parent->parent->mailbox_manager,
+                            connectivity_cluster_t::message_class_t::BACKFILL,
                             parent->intro.items_mailbox,
-                            parent->fifo_source.enter_write(), metainfo, chunk);
+                            parent->fifo_source.enter_write(), metainfo,
+                            compressed_backfill_item_seq_t(
+                                chunk, parent->intro.config.compress_items));
 
                         /* Update `common_version` to reflect the changes that will
                         happen on the backfillee in response to the chunk */
@@ -413,6 +417,7 @@ private:
                         chunk. */
                         if (old_size != new_size) {
                             send(parent->parent->mailbox_manager,
+                                connectivity_cluster_t::message_class_t::BACKFILL,
                                 parent->intro.ack_pre_items_mailbox,
                                 parent->fifo_source.enter_write(), old_size - new_size);
                         }
@@ -469,7 +474,8 @@ void backfiller_t::client_t::on_end_session(
     /* `session_t`'s destructor won't return until it's done sending items over the
     network, so we can be sure that the ack-end-session message comes after all of the
     items that were part of the session. */
-    send(parent->mailbox_manager, intro.ack_end_session_mailbox,
+    send(parent->mailbox_manager, connectivity_cluster_t::message_class_t::BACKFILL,
+        intro.ack_end_session_mailbox,
         fifo_source.enter_write());
 }
 
@@ -0,0 +1,33 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#include "clustering/immediate_consistency/foreground_latency.hpp"
+
+#include <algorithm>
+
+#include "arch/runtime/coroutines.hpp"
+#include "arch/runtime/runtime.hpp"
+#include "concurrency/cache_line_padded.hpp"
+#include "concurrency/pmap.hpp"
+#include "config/args.hpp"
+
+/* Each thread only touches its own entry, except that `collect_foreground_latencies()`
+switches to every thread in turn to take its entry. */
+static std::array<cache_line_padded_t<latency_histogram_t>, MAX_THREADS>
+    per_thread_latencies;
+
+void record_foreground_latency(ticks_t start_time) {
+    per_thread_latencies[get_thread_id().threadnum].value.add(
+        get_ticks().nanos - start_time.nanos);
+}
+
+latency_histogram_t collect_foreground_latencies() {
+    latency_histogram_t result;
+    pmap(get_num_threads(), [&](int thread) {
+        latency_histogram_t histogram;
+        {
+            on_thread_t thread_switcher((threadnum_t(thread)));
+            std::swap(histogram, per_thread_latencies[thread].value);
+        }
+        result.merge(histogram);
+    });
+    return result;
+}
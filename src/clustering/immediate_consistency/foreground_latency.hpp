@@ -0,0 +1,18 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#ifndef CLUSTERING_IMMEDIATE_CONSISTENCY_FOREGROUND_LATENCY_HPP_
+#define CLUSTERING_IMMEDIATE_CONSISTENCY_FOREGROUND_LATENCY_HPP_
+
+#include "containers/latency_histogram.hpp"
+#include "time.hpp"
+
+/* Reads and writes on behalf of the user report how long they spent in the store with
+`record_foreground_latency()`. Every thread keeps its own histogram. The backfill
+throttler periodically calls `collect_foreground_latencies()` to find out whether the
+backfills are slowing down queries. */
+void record_foreground_latency(ticks_t start_time);
+
+/* Returns the histogram of all latencies recorded on any thread since the last call, and
+clears the histograms. This may block, because it visits every thread. */
+latency_histogram_t collect_foreground_latencies();
+
+#endif  // CLUSTERING_IMMEDIATE_CONSISTENCY_FOREGROUND_LATENCY_HPP_
@@ -1,6 +1,9 @@
 // Copyright 2010-2015 RethinkDB, all rights reserved.
 #include "clustering/immediate_consistency/primary_dispatcher.hpp"
 
+#include "arch/timing.hpp"
+#include "time.hpp"
+
 /* Limits how many writes should be sent to a dispatchee at once. */
 const size_t DISPATCH_WRITES_CORO_POOL_SIZE = 64;
 
@@ -24,7 +27,8 @@ primary_dispatcher_t::dispatchee_registration_t::dispatchee_registration_t(
         DISPATCH_WRITES_CORO_POOL_SIZE,
         &background_write_queue,
         &background_write_caller),
-    latest_acked_write(state_timestamp_t::zero())
+    latest_acked_write(state_timestamp_t::zero()),
+    lease_expiry_us(0)
 {
     parent->assert_thread();
 
@@ -40,6 +44,8 @@ primary_dispatcher_t::dispatchee_registration_t::~dispatchee_registration_t() {
     ASSERT_FINITE_CORO_WAITING;
     parent->assert_thread();
     parent->dispatchees.erase(this);
+    parent->departed_lease_expiry_us =
+        std::max(parent->departed_lease_expiry_us, lease_expiry_us);
     if (is_ready) {
         parent->refresh_ready_dispatchees_as_set();
     }
@@ -53,6 +59,21 @@ void primary_dispatcher_t::dispatchee_registration_t::mark_ready() {
     parent->refresh_ready_dispatchees_as_set();
 }
 
+bool primary_dispatcher_t::dispatchee_registration_t::grant_lease(
+        int64_t duration_us, state_timestamp_t *timestamp_out) {
+    DEBUG_VAR mutex_assertion_t::acq_t acq(&parent->mutex);
+    ASSERT_FINITE_CORO_WAITING;
+    if (!is_ready) {
+        return false;
+    }
+    lease_expiry_us = std::max(lease_expiry_us, get_kiloticks().micros + duration_us);
+    /* Writes that have been spawned already might get acked without waiting for this
+    dispatchee, so the dispatchee must wait for all of them before relying on the
+    lease. */
+    *timestamp_out = parent->current_timestamp;
+    return true;
+}
+
 primary_dispatcher_t::write_callback_t::write_callback_t() : write(nullptr) { }
 
 primary_dispatcher_t::write_callback_t::~write_callback_t() {
@@ -66,6 +87,7 @@ primary_dispatcher_t::primary_dispatcher_t(
         perfmon_collection_t *parent_perfmon_collection,
         const region_map_t<version_t> &base_version) :
     perfmon_membership(parent_perfmon_collection, &perfmon_collection, "broadcaster"),
+    departed_lease_expiry_us(0),
     ready_dispatchees_as_set(std::set<server_id_t>())
 {
     current_timestamp = state_timestamp_t::zero();
@@ -187,6 +209,26 @@ void primary_dispatcher_t::spawn_write(
     guarantee(cb->write == nullptr);
     cb->write = incomplete_write.get();
 
+    /* Until the read leases that are currently valid expire, the write can't be acked
+    before the lease holders have performed it. */
+    const int64_t now_us = get_kiloticks().micros;
+    for (const auto &pair : dispatchees) {
+        if (pair.first->lease_expiry_us > now_us) {
+            incomplete_write->pending_lease_holders.insert(pair.first);
+            incomplete_write->lease_deadline_us = std::max(
+                incomplete_write->lease_deadline_us, pair.first->lease_expiry_us);
+        }
+    }
+    if (departed_lease_expiry_us > now_us) {
+        incomplete_write->wait_for_lease_expiry = true;
+        incomplete_write->lease_deadline_us = std::max(
+            incomplete_write->lease_deadline_us, departed_lease_expiry_us);
+    }
+    if (incomplete_write->pending_lease_holders.empty() &&
+            !incomplete_write->wait_for_lease_expiry) {
+        incomplete_write->leases_done.pulse();
+    }
+
     for (const auto &pair : dispatchees) {
         pair.first->background_write_queue.push(
             std::bind(&primary_dispatcher_t::background_write, this,
@@ -197,7 +239,8 @@ void primary_dispatcher_t::spawn_write(
 primary_dispatcher_t::incomplete_write_t::incomplete_write_t(
         const write_t &w, state_timestamp_t ts, order_token_t ot,
         write_durability_t dur, write_callback_t *cb) :
-    write(w), timestamp(ts), order_token(ot), durability(dur), callback(cb)
+    write(w), timestamp(ts), order_token(ot), durability(dur), callback(cb),
+    wait_for_lease_expiry(false), lease_deadline_us(0)
     { }
 
 primary_dispatcher_t::incomplete_write_t::~incomplete_write_t() {
@@ -242,6 +285,16 @@ void primary_dispatcher_t::background_write(
             dispatchee->latest_acked_write =
                 std::max(dispatchee->latest_acked_write, write->timestamp);
 
+            /* If this dispatchee holds a read lease, the other dispatchees might be
+            waiting for it before they can ack the write. Conversely, this dispatchee
+            can't ack the write before the other lease holders have performed it. */
+            if (write->pending_lease_holders.erase(dispatchee) == 1 &&
+                    write->pending_lease_holders.empty() &&
+                    !write->wait_for_lease_expiry) {
+                write->leases_done.pulse();
+            }
+            wait_for_lease_holders(write.get(), dispatchee_lock.get_drain_signal());
+
             /* The write could potentially get acked when we call `on_ack()` on the
             callback. So make sure all reads started after this point will see this
             write. This is more conservative than necessary, since the write might not
@@ -264,6 +317,23 @@ void primary_dispatcher_t::background_write(
     }
 }
 
+void primary_dispatcher_t::wait_for_lease_holders(
+        incomplete_write_t *write, signal_t *interruptor)
+        THROWS_ONLY(interrupted_exc_t) {
+    if (write->leases_done.is_pulsed()) {
+        return;
+    }
+    /* A lease holder that doesn't perform the write, for example because it lost
+    contact with us, can only hold up the write until its lease expires. */
+    const int64_t remaining_us = write->lease_deadline_us - get_kiloticks().micros;
+    if (remaining_us <= 0) {
+        return;
+    }
+    signal_timer_t lease_expired(remaining_us / 1000 + 1);
+    wait_any_t waiter(&write->leases_done, &lease_expired);
+    wait_interruptible(&waiter, interruptor);
+}
+
 void primary_dispatcher_t::refresh_ready_dispatchees_as_set() {
     /* Note that it's possible that we'll have multiple dispatchees with the same server
     ID. This won't happen during normal operation, but it can happen temporarily during
@@ -2,7 +2,10 @@
 #ifndef CLUSTERING_IMMEDIATE_CONSISTENCY_PRIMARY_DISPATCHER_HPP_
 #define CLUSTERING_IMMEDIATE_CONSISTENCY_PRIMARY_DISPATCHER_HPP_
 
+#include <set>
+
 #include "clustering/immediate_consistency/history.hpp"
+#include "concurrency/cond_var.hpp"
 #include "concurrency/coro_pool.hpp"
 #include "concurrency/queue/unlimited_fifo.hpp"
 #include "concurrency/watchable.hpp"
@@ -91,6 +94,14 @@ public:
         `do_write_sync()`, and `do_dummy_write()` calls. */
         void mark_ready();
 
+        /* `grant_lease()` gives the dispatchee a read lease that lasts `duration_us`
+        microseconds from now. Until the lease expires, no write will be acked before
+        this dispatchee has performed it too. So once the dispatchee has performed every
+        write up to `*timestamp_out`, it can answer up-to-date reads by itself until
+        its copy of the lease runs out. Returns `false` if the dispatchee isn't ready
+        yet, because only ready dispatchees get `do_write_sync()` calls. */
+        bool grant_lease(int64_t duration_us, state_timestamp_t *timestamp_out);
+
     private:
         friend class primary_dispatcher_t;
 
@@ -115,6 +126,10 @@ public:
         to. */
         state_timestamp_t latest_acked_write;
 
+        /* When the dispatchee's read lease expires, in `get_kiloticks()` microseconds,
+        or 0 if it never had one. */
+        int64_t lease_expiry_us;
+
         auto_drainer_t drainer;
     };
 
@@ -191,6 +206,16 @@ private:
         order_token_t order_token;
         write_durability_t durability;
         write_callback_t *callback;
+
+        /* The dispatchees that held a read lease when the write was spawned and
+        haven't performed it yet. If a dispatchee that held a lease went away,
+        `wait_for_lease_expiry` is set instead, because it can't perform the write
+        anymore. `leases_done` is pulsed once neither is the case, and after
+        `lease_deadline_us` the write can be acked regardless. */
+        std::set<dispatchee_registration_t *> pending_lease_holders;
+        bool wait_for_lease_expiry;
+        int64_t lease_deadline_us;
+        cond_t leases_done;
     };
 
     void background_write(
@@ -198,6 +223,10 @@ private:
         auto_drainer_t::lock_t dispatchee_lock,
         counted_t<incomplete_write_t> write) THROWS_NOTHING;
 
+    /* Blocks until the write may be acked as far as read leases are concerned. */
+    void wait_for_lease_holders(incomplete_write_t *write, signal_t *interruptor)
+        THROWS_ONLY(interrupted_exc_t);
+
     void refresh_ready_dispatchees_as_set();
 
     branch_id_t branch_id;
@@ -217,6 +246,11 @@ private:
     read to a listener. */
     state_timestamp_t most_recent_acked_write_timestamp;
 
+    /* The latest expiry time of the read leases held by dispatchees that have been
+    deregistered. Writes that start before then might be racing with reads on those
+    dispatchees' servers, so they have to wait for it. */
+    int64_t departed_lease_expiry_us;
+
     std::map<dispatchee_registration_t *, auto_drainer_t::lock_t> dispatchees;
 
     /* This is just a set that contains the peer ID of each dispatchee in `dispatchees`
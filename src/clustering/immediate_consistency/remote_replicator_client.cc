@@ -1,11 +1,25 @@
 // Copyright 2010-2015 RethinkDB, all rights reserved.
 #include "clustering/immediate_consistency/remote_replicator_client.hpp"
 
+#include "arch/timing.hpp"
 #include "clustering/immediate_consistency/backfill_throttler.hpp"
 #include "clustering/immediate_consistency/backfillee.hpp"
 #include "clustering/table_manager/backfill_progress_tracker.hpp"
+#include "concurrency/pmap.hpp"
 #include "stl_utils.hpp"
 #include "store_view.hpp"
+#include "time.hpp"
+
+/* We ask the primary for read leases of `LEASE_DURATION_MS` and renew them every
+`LEASE_RENEWAL_INTERVAL_MS`, so that a lease is still valid when the next renewal
+arrives. Our copy of the lease starts when we send the request, which is before the
+primary's copy starts, and also ends `LEASE_SAFETY_MARGIN_MS` early in case our clock
+runs slower than the primary's. Once no lease reads have arrived for
+`LEASE_IDLE_TIMEOUT_MS`, we let the lease expire so that writes stop waiting for us. */
+const int64_t LEASE_DURATION_MS = 2 * THOUSAND;
+const int64_t LEASE_RENEWAL_INTERVAL_MS = 500;
+const int64_t LEASE_SAFETY_MARGIN_MS = 200;
+const int64_t LEASE_IDLE_TIMEOUT_MS = 10 * THOUSAND;
 
 class remote_replicator_client_t::timestamp_range_tracker_t {
 public:
@@ -162,18 +176,20 @@ remote_replicator_client_t::remote_replicator_client_t(
 
     next_write_waiter_(nullptr),
 
-    write_async_mailbox_(mailbox_manager,
-        std::bind(&remote_replicator_client_t::on_write_async, this,
-            ph::_1, ph::_2, ph::_3, ph::_4, ph::_5)),
-    write_sync_mailbox_(mailbox_manager,
-        std::bind(&remote_replicator_client_t::on_write_sync, this,
-            ph::_1, ph::_2, ph::_3, ph::_4, ph::_5, ph::_6)),
+    write_batch_mailbox_(mailbox_manager,
+        std::bind(&remote_replicator_client_t::on_write_batch, this,
+            ph::_1, ph::_2, ph::_3)),
     dummy_write_mailbox_(mailbox_manager,
         std::bind(&remote_replicator_client_t::on_dummy_write, this,
             ph::_1, ph::_2)),
     read_mailbox_(mailbox_manager,
         std::bind(&remote_replicator_client_t::on_read, this,
-            ph::_1, ph::_2, ph::_3, ph::_4))
+            ph::_1, ph::_2, ph::_3, ph::_4)),
+
+    lease_valid_until_us_(0),
+    lease_min_timestamp_(state_timestamp_t::zero()),
+    last_lease_read_us_(0),
+    renewing_lease_(false)
 {
     guarantee(remote_replicator_server_bcard.branch == branch_id);
     guarantee(remote_replicator_server_bcard.region == region_);
@@ -198,6 +214,7 @@ remote_replicator_client_t::remote_replicator_client_t(
             mailbox_manager,
             [&](signal_t *, const remote_replicator_client_intro_t &i) {
                 intro = i;
+                lease_mailbox_ = intro.lease_mailbox;
                 mode_ = backfill_mode_t::PAUSED;
                 timestamp_enforcer_.init(new timestamp_enforcer_t(
                     intro.streaming_begin_timestamp));
@@ -208,8 +225,7 @@ remote_replicator_client_t::remote_replicator_client_t(
         remote_replicator_client_bcard_t our_bcard {
             server_id,
             intro_mailbox.get_address(),
-            write_async_mailbox_.get_address(),
-            write_sync_mailbox_.get_address(),
+            write_batch_mailbox_.get_address(),
             dummy_write_mailbox_.get_address(),
             read_mailbox_.get_address() };
         registrant_.init(new registrant_t<remote_replicator_client_bcard_t>(
@@ -261,7 +277,8 @@ remote_replicator_client_t::remote_replicator_client_t(
             mailbox_t<> ack_mbox(
                 mailbox_manager,
                 [&](signal_t *) { backfiller_is_up_to_date.pulse(); });
-            send(mailbox_manager, replica_bcard.synchronize_mailbox,
+            send(mailbox_manager, connectivity_cluster_t::message_class_t::QUERY,
+                replica_bcard.synchronize_mailbox,
                 backfill_start_timestamp, ack_mbox.get_address());
             wait_interruptible(&backfiller_is_up_to_date, interruptor);
         }
@@ -358,7 +375,8 @@ remote_replicator_client_t::remote_replicator_client_t(
 
     /* Now that we're completely up-to-date, tell the primary that it's OK to send us
     reads and synchronous writes */
-    send(mailbox_manager, intro.ready_mailbox);
+    send(mailbox_manager, connectivity_cluster_t::message_class_t::QUERY,
+        intro.ready_mailbox);
 }
 
 remote_replicator_client_t::~remote_replicator_client_t() {
@@ -366,12 +384,47 @@ remote_replicator_client_t::~remote_replicator_client_t() {
     destructor for `timestamp_range_tracker_t` */
 }
 
-void remote_replicator_client_t::on_write_async(
+void remote_replicator_client_t::on_write_batch(
         signal_t *interruptor,
-        write_t &&write,
+        const std::vector<remote_replicator_write_t> &writes,
+        const mailbox_t<std::vector<write_response_t> >::address_t &ack_addr)
+        THROWS_ONLY(interrupted_exc_t) {
+    /* The writes run concurrently, just like they would if they had arrived in separate
+    messages; `timestamp_enforcer_` and `replica_` put them in order. */
+    std::vector<write_response_t> responses(writes.size());
+    bool interrupted = false;
+    pmap(writes.size(), [&](int64_t i) {
+        try {
+            const remote_replicator_write_t &w = writes[i];
+            if (static_cast<bool>(w.durability)) {
+                do_write_sync(w.write, w.timestamp, w.order_token, *w.durability,
+                    interruptor, &responses[i]);
+            } else {
+                do_write_async(w.write, w.timestamp, w.order_token, interruptor);
+            }
+        } catch (const interrupted_exc_t &) {
+            interrupted = true;
+        }
+    });
+    if (interrupted) {
+        throw interrupted_exc_t();
+    }
+
+    std::vector<write_response_t> sync_responses;
+    for (size_t i = 0; i < writes.size(); ++i) {
+        if (static_cast<bool>(writes[i].durability)) {
+            sync_responses.push_back(std::move(responses[i]));
+        }
+    }
+    send(mailbox_manager_, connectivity_cluster_t::message_class_t::QUERY,
+        ack_addr, sync_responses);
+}
+
+void remote_replicator_client_t::do_write_async(
+        const write_t &write,
         state_timestamp_t timestamp,
         order_token_t order_token,
-        const mailbox_t<>::address_t &ack_addr)
+        signal_t *interruptor)
         THROWS_ONLY(interrupted_exc_t) {
     wait_interruptible(&registered_, interruptor);
 
@@ -442,28 +495,24 @@ void remote_replicator_client_t::on_write_async(
             }
         }
     }
-
-    send(mailbox_manager_, ack_addr);
 }
 
-void remote_replicator_client_t::on_write_sync(
-        signal_t *interruptor,
+void remote_replicator_client_t::do_write_sync(
         const write_t &write,
         state_timestamp_t timestamp,
         order_token_t order_token,
         write_durability_t durability,
-        const mailbox_t<write_response_t>::address_t &ack_addr)
+        signal_t *interruptor,
+        write_response_t *response_out)
         THROWS_ONLY(interrupted_exc_t) {
     /* The current implementation of the dispatcher will never send us an async write
     once it's started sending sync writes, but we don't want to rely on that detail, so
     we pass sync writes through the timestamp enforcer too. */
     timestamp_enforcer_->complete(timestamp);
 
-    write_response_t response;
     replica_->do_write(
         write, timestamp, order_token, durability,
-        interruptor, &response);
-    send(mailbox_manager_, ack_addr, response);
+        interruptor, response_out);
 }
 
 void remote_replicator_client_t::on_dummy_write(
@@ -472,7 +521,8 @@ void remote_replicator_client_t::on_dummy_write(
         THROWS_ONLY(interrupted_exc_t) {
     write_response_t response;
     replica_->do_dummy_write(interruptor, &response);
-    send(mailbox_manager_, ack_addr, response);
+    send(mailbox_manager_, connectivity_cluster_t::message_class_t::QUERY,
+        ack_addr, response);
 }
 
 void remote_replicator_client_t::on_read(
@@ -483,7 +533,70 @@ void remote_replicator_client_t::on_read(
         THROWS_ONLY(interrupted_exc_t) {
     read_response_t response;
     replica_->do_read(read, min_timestamp, interruptor, &response);
-    send(mailbox_manager_, ack_addr, response);
+    send(mailbox_manager_, connectivity_cluster_t::message_class_t::QUERY,
+        ack_addr, response);
+}
+
+bool remote_replicator_client_t::lease_read(
+        const read_t &read,
+        read_response_t *response_out,
+        signal_t *interruptor)
+        THROWS_ONLY(interrupted_exc_t) {
+    guarantee(mode_ == backfill_mode_t::STREAMING);
+    const int64_t now_us = get_kiloticks().micros;
+    last_lease_read_us_ = now_us;
+    if (!renewing_lease_) {
+        renewing_lease_ = true;
+        coro_t::spawn_sometime(std::bind(&remote_replicator_client_t::renew_lease,
+            this, lease_drainer_.lock()));
+    }
+    if (now_us >= lease_valid_until_us_) {
+        return false;
+    }
+    /* The lease was valid when the read started, so it's enough to wait for the writes
+    that the primary had started when it granted the lease. */
+    replica_->do_read(read, lease_min_timestamp_, interruptor, response_out);
+    return true;
+}
+
+void remote_replicator_client_t::renew_lease(auto_drainer_t::lock_t keepalive)
+        THROWS_NOTHING {
+    try {
+        while (get_kiloticks().micros - last_lease_read_us_
+                < LEASE_IDLE_TIMEOUT_MS * THOUSAND) {
+            const int64_t request_us = get_kiloticks().micros;
+            cond_t got_reply;
+            bool granted = false;
+            state_timestamp_t timestamp;
+            remote_replicator_client_intro_t::lease_reply_mailbox_t reply_mailbox(
+                mailbox_manager_,
+                [&](signal_t *, bool g, state_timestamp_t ts) {
+                    granted = g;
+                    timestamp = ts;
+                    got_reply.pulse_if_not_already_pulsed();
+                });
+            send(mailbox_manager_, connectivity_cluster_t::message_class_t::QUERY,
+                lease_mailbox_, LEASE_DURATION_MS, reply_mailbox.get_address());
+
+            /* A reply that takes longer than the lease itself would be useless. */
+            signal_timer_t timeout(LEASE_DURATION_MS);
+            wait_any_t waiter(&got_reply, &timeout);
+            wait_interruptible(&waiter, keepalive.get_drain_signal());
+            if (got_reply.is_pulsed() && granted) {
+                /* The new expiry and minimum timestamp have to be updated together;
+                the extended lease isn't safe to use with an older timestamp. */
+                const int64_t valid_until_us = request_us
+                    + (LEASE_DURATION_MS - LEASE_SAFETY_MARGIN_MS) * THOUSAND;
+                lease_valid_until_us_ = std::max(lease_valid_until_us_, valid_until_us);
+                lease_min_timestamp_ = std::max(lease_min_timestamp_, timestamp);
+            }
+
+            nap(LEASE_RENEWAL_INTERVAL_MS, keepalive.get_drain_signal());
+        }
+    } catch (const interrupted_exc_t &) {
+        /* We're being destroyed */
+    }
+    renewing_lease_ = false;
 }
 
 bool remote_replicator_client_t::next_write_can_proceed(
@@ -2,14 +2,11 @@
 #ifndef CLUSTERING_IMMEDIATE_CONSISTENCY_REMOTE_REPLICATOR_CLIENT_HPP_
 #define CLUSTERING_IMMEDIATE_CONSISTENCY_REMOTE_REPLICATOR_CLIENT_HPP_
 
-#include <queue>
-
 #include "clustering/generic/registrant.hpp"
 #include "clustering/immediate_consistency/backfill_throttler.hpp"
 #include "clustering/immediate_consistency/remote_replicator_metadata.hpp"
 #include "clustering/immediate_consistency/replica.hpp"
 #include "concurrency/coro_pool.hpp"
-#include "concurrency/queue/disk_backed_queue_wrapper.hpp"
 #include "concurrency/semaphore.hpp"
 
 class backfill_progress_tracker_t;
@@ -51,6 +48,12 @@ public:
         area, so we have to receive those changes as part of the backfill or we won't
         get them at all.
 
+    Writes that we can't apply yet don't pile up anywhere that could overflow. Only as
+    many writes as the `primary_dispatcher_t` has workers for each dispatchee are in
+    flight to us at a time; the rest wait in memory in its `background_write_queue`,
+    which is unbounded. So falling behind only ever delays streaming, and never makes us
+    start the backfill over.
+
     The `remote_replicator_client_t` constructor blocks until this entire process is
     complete. The backfilled data will be safely flushed to disk by the time it returns.
     */
@@ -75,27 +78,48 @@ public:
 
     ~remote_replicator_client_t();
 
+    /* `lease_read()` performs an up-to-date read on the local replica without going
+    through the primary, if we hold a read lease from the primary. While the lease lasts,
+    the primary doesn't ack any write before we have performed it, so every write that
+    was acked before the read started is either already in our store or has a timestamp
+    up to the one the primary gave us with the lease, and we wait for those.
+
+    Returns `false` without performing the read if we don't hold a lease right now; the
+    caller should send the read to the primary instead. The lease is requested the
+    first time this is called and renewed for as long as lease reads keep arriving. Must
+    only be called once the constructor has returned. */
+    bool lease_read(
+            const read_t &read,
+            read_response_t *response_out,
+            signal_t *interruptor)
+        THROWS_ONLY(interrupted_exc_t);
+
 private:
     class timestamp_range_tracker_t;
 
-    /* `on_write_async()`, `on_write_sync()`, `on_dummy_write()`, and `on_read()`
-    are mailbox callbacks for `write_async_mailbox_`, `write_sync_mailbox_`,
-    `dummy_write_mailbox_` and `read_mailbox_`. */
-    void on_write_async(
+    /* `on_write_batch()`, `on_dummy_write()`, and `on_read()` are mailbox callbacks for
+    `write_batch_mailbox_`, `dummy_write_mailbox_` and `read_mailbox_`. */
+    void on_write_batch(
             signal_t *interruptor,
-            write_t &&write,
+            const std::vector<remote_replicator_write_t> &writes,
+            const mailbox_t<std::vector<write_response_t> >::address_t &ack_addr)
+        THROWS_ONLY(interrupted_exc_t);
+
+    /* `on_write_batch()` calls these for each of the writes in the batch. */
+    void do_write_async(
+            const write_t &write,
             state_timestamp_t timestamp,
             order_token_t order_token,
-            const mailbox_t<>::address_t &ack_addr)
+            signal_t *interruptor)
         THROWS_ONLY(interrupted_exc_t);
 
-    void on_write_sync(
-            signal_t *interruptor,
+    void do_write_sync(
             const write_t &write,
             state_timestamp_t timestamp,
             order_token_t order_token,
             write_durability_t durability,
-            const mailbox_t<write_response_t>::address_t &ack_addr)
+            signal_t *interruptor,
+            write_response_t *response_out)
         THROWS_ONLY(interrupted_exc_t);
 
     void on_dummy_write(
@@ -110,6 +134,10 @@ private:
             const mailbox_t<read_response_t>::address_t &ack_addr)
         THROWS_ONLY(interrupted_exc_t);
 
+    /* `renew_lease()` runs in a coroutine while lease reads are arriving, and keeps
+    asking the primary to extend our read lease. */
+    void renew_lease(auto_drainer_t::lock_t keepalive) THROWS_NOTHING;
+
     mailbox_manager_t *const mailbox_manager_;
     store_view_t *const store_;
     region_t const region_;   /* same as `store_->get_region()` */
@@ -162,7 +190,7 @@ private:
     mutex_assertion_t mutex_assertion_;
 
     /* `registered_` is pulsed once `timestamp_enforcer_` is set up. So
-    `on_write_async()` has to wait for it before proceeding. */
+    `do_write_async()` has to wait for it before proceeding. */
     cond_t registered_;
 
     /* `cleanup_rwlock_` is used to temporarily lock out writes when doing the very last
@@ -170,14 +198,28 @@ private:
     acquires it in write mode. */
     rwlock_t cleanup_rwlock_;
 
-    remote_replicator_client_bcard_t::write_async_mailbox_t write_async_mailbox_;
-    remote_replicator_client_bcard_t::write_sync_mailbox_t write_sync_mailbox_;
+    remote_replicator_client_bcard_t::write_batch_mailbox_t write_batch_mailbox_;
     remote_replicator_client_bcard_t::dummy_write_mailbox_t dummy_write_mailbox_;
     remote_replicator_client_bcard_t::read_mailbox_t read_mailbox_;
 
     /* We use `registrant_` to subscribe to a stream of reads and writes from the
     dispatcher via the `remote_replicator_server_t`. */
     scoped_ptr_t<registrant_t<remote_replicator_client_bcard_t> > registrant_;
+
+    /* `lease_mailbox_` is where we ask the `remote_replicator_server_t` for read leases.
+    We consider the lease valid until `lease_valid_until_us_`; reads that rely on it must
+    wait for `lease_min_timestamp_`. `last_lease_read_us_` is when `lease_read()` was
+    last called, so that `renew_lease()` can stop when lease reads stop arriving. All
+    times are in `get_kiloticks()` microseconds. */
+    remote_replicator_client_intro_t::lease_mailbox_t::address_t lease_mailbox_;
+    int64_t lease_valid_until_us_;
+    state_timestamp_t lease_min_timestamp_;
+    int64_t last_lease_read_us_;
+    bool renewing_lease_;
+
+    /* `lease_drainer_` must be destroyed first, because `renew_lease()` uses the other
+    member variables. */
+    auto_drainer_t lease_drainer_;
 };
 
 #endif /* CLUSTERING_IMMEDIATE_CONSISTENCY_REMOTE_REPLICATOR_HPP_ */
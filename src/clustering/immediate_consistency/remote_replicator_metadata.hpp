@@ -4,31 +4,51 @@
 
 #include "clustering/generic/registration_metadata.hpp"
 #include "clustering/immediate_consistency/history.hpp"
+#include "containers/archive/optional.hpp"
+#include "containers/archive/stl_types.hpp"
 #include "rdb_protocol/protocol.hpp"
 
 class remote_replicator_client_intro_t {
 public:
     typedef mailbox_t<> ready_mailbox_t;
+    /* The client asks for a read lease of the given duration in milliseconds by sending
+    a message to the `lease_mailbox`. The reply says whether the lease was granted, and
+    which timestamp the client has to reach before it can rely on it. */
+    typedef mailbox_t<bool, state_timestamp_t> lease_reply_mailbox_t;
+    typedef mailbox_t<int64_t, lease_reply_mailbox_t::address_t> lease_mailbox_t;
 
     state_timestamp_t streaming_begin_timestamp;
     ready_mailbox_t::address_t ready_mailbox;
+    lease_mailbox_t::address_t lease_mailbox;
 };
 
 RDB_DECLARE_SERIALIZABLE(remote_replicator_client_intro_t);
 
+/* `remote_replicator_server_t` groups the writes that it's asked to send to one
+`remote_replicator_client_t` at about the same time into a single message. Each write
+in the batch carries its own timestamp. Sync writes have a `durability`; async writes
+don't, and the client doesn't send a response for them. */
+class remote_replicator_write_t {
+public:
+    write_t write;
+    state_timestamp_t timestamp;
+    order_token_t order_token;
+    optional<write_durability_t> durability;
+};
+
+RDB_DECLARE_SERIALIZABLE(remote_replicator_write_t);
+
 class remote_replicator_client_bcard_t {
 public:
     typedef mailbox_t<
         remote_replicator_client_intro_t
         > intro_mailbox_t;
+    /* The reply contains the responses to the sync writes in the batch, in the same
+    order as the writes. It's sent once all of the writes have been performed. */
     typedef mailbox_t<
-        write_t, state_timestamp_t, order_token_t,
-        mailbox_t<>::address_t
-        > write_async_mailbox_t;
-    typedef mailbox_t<
-        write_t, state_timestamp_t, order_token_t, write_durability_t,
-        mailbox_t<write_response_t>::address_t
-        > write_sync_mailbox_t;
+        std::vector<remote_replicator_write_t>,
+        mailbox_t<std::vector<write_response_t> >::address_t
+        > write_batch_mailbox_t;
     typedef mailbox_t<
         mailbox_t<write_response_t>::address_t
         > dummy_write_mailbox_t;
@@ -39,8 +59,7 @@ public:
 
     server_id_t server_id;
     intro_mailbox_t::address_t intro_mailbox;
-    write_async_mailbox_t::address_t write_async_mailbox;
-    write_sync_mailbox_t::address_t write_sync_mailbox;
+    write_batch_mailbox_t::address_t write_batch_mailbox;
     dummy_write_mailbox_t::address_t dummy_write_mailbox;
     read_mailbox_t::address_t read_mailbox;
 };
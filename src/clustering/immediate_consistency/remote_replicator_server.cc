@@ -1,6 +1,15 @@
 // Copyright 2010-2015 RethinkDB, all rights reserved.
 #include "clustering/immediate_consistency/remote_replicator_server.hpp"
 
+/* Clients ask for short leases and keep renewing them, so this only matters if a
+client misbehaves. A longer lease would hold up writes for longer if the client lost
+contact with us. */
+const int64_t MAX_LEASE_DURATION_MS = 10 * THOUSAND;
+
+/* Once a batch has this many writes, further writes start a new batch. This bounds how
+long the first write in a batch can be held up by the ones after it. */
+const size_t MAX_WRITES_PER_BATCH = 64;
+
 remote_replicator_server_t::remote_replicator_server_t(
         mailbox_manager_t *_mailbox_manager,
         primary_dispatcher_t *_primary) :
@@ -16,15 +25,20 @@ remote_replicator_server_t::proxy_replica_t::proxy_replica_t(
     client_bcard(_client_bcard), parent(_parent), is_ready(false),
     ready_mailbox(
         parent->mailbox_manager,
-        std::bind(&proxy_replica_t::on_ready, this, ph::_1))
+        std::bind(&proxy_replica_t::on_ready, this, ph::_1)),
+    lease_mailbox(
+        parent->mailbox_manager,
+        std::bind(&proxy_replica_t::on_lease_request, this, ph::_1, ph::_2, ph::_3))
 {
     state_timestamp_t first_timestamp;
     registration = make_scoped<primary_dispatcher_t::dispatchee_registration_t>(
         parent->primary, this, client_bcard.server_id, 1.0, &first_timestamp);
-    send(parent->mailbox_manager, client_bcard.intro_mailbox,
+    send(parent->mailbox_manager, connectivity_cluster_t::message_class_t::QUERY,
+        client_bcard.intro_mailbox,
         remote_replicator_client_intro_t {
             first_timestamp,
-            ready_mailbox.get_address() });
+            ready_mailbox.get_address(),
+            lease_mailbox.get_address() });
 }
 
 void remote_replicator_server_t::proxy_replica_t::do_read(
@@ -40,7 +54,8 @@ void remote_replicator_server_t::proxy_replica_t::do_read(
             *response_out = response;
             got_response.pulse();
         });
-    send(parent->mailbox_manager, client_bcard.read_mailbox,
+    send(parent->mailbox_manager, connectivity_cluster_t::message_class_t::QUERY,
+        client_bcard.read_mailbox,
         read, min_timestamp, response_mailbox.get_address());
     wait_interruptible(&got_response, interruptor);
 }
@@ -53,16 +68,14 @@ void remote_replicator_server_t::proxy_replica_t::do_write_sync(
         signal_t *interruptor,
         write_response_t *response_out) {
     guarantee(is_ready);
-    cond_t got_response;
-    mailbox_t<write_response_t> response_mailbox(
-        parent->mailbox_manager,
-        [&](signal_t *, const write_response_t &response) {
-            *response_out = response;
-            got_response.pulse();
-        });
-    send(parent->mailbox_manager, client_bcard.write_sync_mailbox,
-        write, timestamp, order_token, durability, response_mailbox.get_address());
-    wait_interruptible(&got_response, interruptor);
+    size_t sync_index;
+    std::shared_ptr<write_batch_t> batch = add_to_batch(
+        remote_replicator_write_t {
+            write, timestamp, order_token, make_optional(durability) },
+        &sync_index);
+    wait_interruptible(&batch->done, interruptor);
+    guarantee(sync_index < batch->responses.size());
+    *response_out = batch->responses[sync_index];
 }
 
 void remote_replicator_server_t::proxy_replica_t::do_dummy_write(
@@ -76,7 +89,8 @@ void remote_replicator_server_t::proxy_replica_t::do_dummy_write(
             *response_out = response;
             got_response.pulse();
         });
-    send(parent->mailbox_manager, client_bcard.dummy_write_mailbox,
+    send(parent->mailbox_manager, connectivity_cluster_t::message_class_t::QUERY,
+        client_bcard.dummy_write_mailbox,
         response_mailbox.get_address());
     wait_interruptible(&got_response, interruptor);
 }
@@ -86,13 +100,58 @@ void remote_replicator_server_t::proxy_replica_t::do_write_async(
         state_timestamp_t timestamp,
         order_token_t order_token,
         signal_t *interruptor) {
-    cond_t got_ack;
-    mailbox_t<> ack_mailbox(
+    std::shared_ptr<write_batch_t> batch = add_to_batch(
+        remote_replicator_write_t {
+            write, timestamp, order_token, optional<write_durability_t>() },
+        nullptr);
+    wait_interruptible(&batch->done, interruptor);
+}
+
+std::shared_ptr<remote_replicator_server_t::proxy_replica_t::write_batch_t>
+remote_replicator_server_t::proxy_replica_t::add_to_batch(
+        remote_replicator_write_t &&write,
+        size_t *sync_index_out) {
+    if (pending_batch.get() == nullptr) {
+        pending_batch = std::make_shared<write_batch_t>();
+        coro_t::spawn_sometime(std::bind(&proxy_replica_t::send_batch, this,
+            pending_batch, drainer.lock()));
+    }
+    std::shared_ptr<write_batch_t> batch = pending_batch;
+    batch->writes.push_back(std::move(write));
+    if (sync_index_out != nullptr) {
+        *sync_index_out = batch->num_sync_writes++;
+    }
+    if (batch->writes.size() >= MAX_WRITES_PER_BATCH) {
+        pending_batch.reset();
+    }
+    return batch;
+}
+
+void remote_replicator_server_t::proxy_replica_t::send_batch(
+        std::shared_ptr<write_batch_t> batch,
+        auto_drainer_t::lock_t keepalive) {
+    /* The `primary_dispatcher_t` spawns a coroutine for every write and dispatchee, so
+    the writes that arrived together will have joined the batch by the time we get to
+    run again. */
+    coro_t::yield();
+    if (pending_batch == batch) {
+        pending_batch.reset();
+    }
+    mailbox_t<std::vector<write_response_t> > response_mailbox(
         parent->mailbox_manager,
-        [&](signal_t *) { got_ack.pulse(); });
-    send(parent->mailbox_manager, client_bcard.write_async_mailbox,
-        write, timestamp, order_token, ack_mailbox.get_address());
-    wait_interruptible(&got_ack, interruptor);
+        [&](signal_t *, const std::vector<write_response_t> &responses) {
+            guarantee(responses.size() == batch->num_sync_writes);
+            batch->responses = responses;
+            batch->done.pulse();
+        });
+    send(parent->mailbox_manager, connectivity_cluster_t::message_class_t::QUERY,
+        client_bcard.write_batch_mailbox,
+        batch->writes, response_mailbox.get_address());
+    try {
+        wait_interruptible(&batch->done, keepalive.get_drain_signal());
+    } catch (const interrupted_exc_t &) {
+        /* The writers have already been interrupted by the `primary_dispatcher_t`. */
+    }
 }
 
 void remote_replicator_server_t::proxy_replica_t::on_ready(signal_t *) {
@@ -103,3 +162,15 @@ void remote_replicator_server_t::proxy_replica_t::on_ready(signal_t *) {
     registration->mark_ready();
 }
 
+
+void remote_replicator_server_t::proxy_replica_t::on_lease_request(
+        signal_t *,
+        int64_t duration_ms,
+        const remote_replicator_client_intro_t::lease_reply_mailbox_t::address_t
+            &reply_addr) {
+    duration_ms = std::min(std::max(duration_ms, int64_t{0}), MAX_LEASE_DURATION_MS);
+    state_timestamp_t timestamp = state_timestamp_t::zero();
+    bool granted = registration->grant_lease(duration_ms * THOUSAND, &timestamp);
+    send(parent->mailbox_manager, connectivity_cluster_t::message_class_t::QUERY,
+        reply_addr, granted, timestamp);
+}
@@ -2,6 +2,9 @@
 #ifndef CLUSTERING_IMMEDIATE_CONSISTENCY_REMOTE_REPLICATOR_SERVER_HPP_
 #define CLUSTERING_IMMEDIATE_CONSISTENCY_REMOTE_REPLICATOR_SERVER_HPP_
 
+#include <memory>
+#include <vector>
+
 #include "clustering/generic/registrar.hpp"
 #include "clustering/immediate_consistency/primary_dispatcher.hpp"
 #include "clustering/immediate_consistency/remote_replicator_metadata.hpp"
@@ -64,16 +67,53 @@ private:
             write_response_t *response_out);
 
     private:
+        /* `write_batch_t` collects the writes for one message to the client. */
+        class write_batch_t {
+        public:
+            write_batch_t() : num_sync_writes(0) { }
+            std::vector<remote_replicator_write_t> writes;
+            size_t num_sync_writes;
+            std::vector<write_response_t> responses;
+            /* Pulsed when the client has performed all of the writes */
+            cond_t done;
+        };
+
+        /* Adds the write to the batch that is currently being collected, starting a
+        new one if necessary. If `sync_index_out` is non-null, it's set to the index of
+        the write's response in the batch's `responses`. */
+        std::shared_ptr<write_batch_t> add_to_batch(
+            remote_replicator_write_t &&write,
+            size_t *sync_index_out);
+
+        /* `send_batch()` runs in a coroutine for every batch. It waits for the writes
+        that arrive at about the same time to join the batch, then sends it. */
+        void send_batch(
+            std::shared_ptr<write_batch_t> batch,
+            auto_drainer_t::lock_t keepalive);
+
         void on_ready(signal_t *interruptor);
+        void on_lease_request(
+            signal_t *interruptor,
+            int64_t duration_ms,
+            const remote_replicator_client_intro_t::lease_reply_mailbox_t::address_t
+                &reply_addr);
 
         remote_replicator_client_bcard_t client_bcard;
         remote_replicator_server_t *parent;
         bool is_ready;
 
-        // The destruction order matters: The `ready_mailbox` callback assumes
-        // that `registration` is still valid.
+        /* The batch that new writes are added to, or empty if there is none */
+        std::shared_ptr<write_batch_t> pending_batch;
+
+        /* `drainer` must be destroyed after `registration`, because writes already in
+        progress may still add themselves to a batch. */
+        auto_drainer_t drainer;
+
+        // The destruction order matters: The `ready_mailbox` and `lease_mailbox`
+        // callbacks assume that `registration` is still valid.
         scoped_ptr_t<primary_dispatcher_t::dispatchee_registration_t> registration;
         remote_replicator_client_intro_t::ready_mailbox_t ready_mailbox;
+        remote_replicator_client_intro_t::lease_mailbox_t lease_mailbox;
     };
 
     mailbox_manager_t *mailbox_manager;
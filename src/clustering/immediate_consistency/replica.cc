@@ -118,6 +118,6 @@ void replica_t::on_synchronize(
         state_timestamp_t timestamp,
         mailbox_t<>::address_t ack_addr) {
     end_enforcer.wait_all_before(timestamp, interruptor);
-    send(mailbox_manager, ack_addr);
+    send(mailbox_manager, connectivity_cluster_t::message_class_t::QUERY, ack_addr);
 }
 
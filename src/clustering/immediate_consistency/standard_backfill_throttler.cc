@@ -1,10 +1,38 @@
 // Copyright 2010-2015 RethinkDB, all rights reserved.
 #include "clustering/immediate_consistency/standard_backfill_throttler.hpp"
 
+#include <algorithm>
+
+#include "arch/io/disk/stats_2.hpp"
+#include "arch/runtime/runtime.hpp"
+#include "arch/timing.hpp"
+#include "clustering/immediate_consistency/foreground_latency.hpp"
+#include "clustering/table_contract/cpu_sharding.hpp"
 #include "concurrency/cross_thread_signal.hpp"
 #include "concurrency/wait_any.hpp"
 
-static const size_t max_active_backfills = 8;
+/* How often the AIMD controller looks at the foreground latency and the disk queue */
+static const int64_t adjust_interval_ms = 1000;
+
+/* The 99th percentile latency of foreground reads and writes in the stores that the
+controller tries to stay below */
+static const int64_t foreground_latency_target_ms = 50;
+
+/* With fewer samples than this in an interval, the 99th percentile isn't meaningful;
+and with so few queries, there isn't much to slow down either. */
+static const uint64_t min_latency_samples = 100;
+
+/* The average number of disk requests queued or in progress above which the controller
+considers the disk overloaded */
+static const double max_disk_queue_depth = 64;
+
+standard_backfill_throttler_t::standard_backfill_throttler_t() :
+    max_active_backfills(std::max<size_t>(
+        CPU_SHARDING_FACTOR, static_cast<size_t>(get_num_threads()))),
+    adaptive_limit(max_active_backfills) {
+    coro_t::spawn_sometime(std::bind(
+        &standard_backfill_throttler_t::adjust_limit, this, drainer.lock()));
+}
 
 standard_backfill_throttler_t::~standard_backfill_throttler_t() {
     guarantee(active.empty());
@@ -17,7 +45,7 @@ void standard_backfill_throttler_t::enter(lock_t *lock, signal_t *interruptor_on
     scoped_ptr_t<new_mutex_acq_t> mutex_acq(
         new new_mutex_acq_t(&mutex, &interruptor_on_home));
 
-    if (active.size() < max_active_backfills) {
+    if (active.size() < get_limit(lock->priority)) {
         /* There is no contention, so we can start right away */
         active.insert(std::make_pair(lock->priority, lock));
 
@@ -73,17 +101,88 @@ void standard_backfill_throttler_t::exit(lock_t *lock) {
     guarantee(it != active.end());
     active.erase(it);
 
-    /* Find the highest-priority backfill that's waiting to start */
-    auto jt = waiting.end();
-    if (jt != waiting.begin()) {
+    start_waiting_backfills();
+}
+
+size_t standard_backfill_throttler_t::get_limit(const priority_t &priority) const {
+    if (priority.critical == priority_t::critical_t::YES) {
+        return max_active_backfills;
+    } else {
+        return adaptive_limit;
+    }
+}
+
+void standard_backfill_throttler_t::start_waiting_backfills() {
+    ASSERT_NO_CORO_WAITING;
+    while (!waiting.empty()) {
+        /* Find the highest-priority backfill that's waiting to start */
+        auto jt = waiting.end();
         --jt;
+        if (active.size() >= get_limit(jt->first)) {
+            break;
+        }
 
         /* Pulse the `cond_t` so that `enter()` can return */
         jt->second.second->pulse();
 
-        /* Transfer the backfill from `active` to `waiting` */
+        /* Transfer the backfill from `waiting` to `active` */
         active.insert(std::make_pair(jt->first, jt->second.first));
         waiting.erase(jt);
     }
 }
 
+void standard_backfill_throttler_t::preempt_backfills_over_limit() {
+    /* `active` is sorted by priority, so we start with the lowest-priority backfills.
+    Preempted backfills stay in `active` until they call `exit()`. */
+    size_t num_over_limit =
+        active.size() > adaptive_limit ? active.size() - adaptive_limit : 0;
+    for (auto it = active.begin(); it != active.end() && num_over_limit > 0; ++it) {
+        if (it->first.critical == priority_t::critical_t::YES) {
+            break;
+        }
+        on_thread_t thread_switcher(it->second->home_thread());
+        if (!it->second->get_preempt_signal()->is_pulsed()) {
+            preempt(it->second);
+        }
+        --num_over_limit;
+    }
+}
+
+void standard_backfill_throttler_t::adjust_limit(auto_drainer_t::lock_t keepalive) {
+    try {
+        int64_t last_disk_nanos = get_total_disk_request_nanos();
+        ticks_t last_time = get_ticks();
+        /* Throw away what was recorded before we started */
+        collect_foreground_latencies();
+        while (true) {
+            nap(adjust_interval_ms, keepalive.get_drain_signal());
+
+            latency_histogram_t latencies = collect_foreground_latencies();
+            const int64_t disk_nanos = get_total_disk_request_nanos();
+            const ticks_t now = get_ticks();
+            const double disk_queue_depth =
+                static_cast<double>(disk_nanos - last_disk_nanos)
+                / std::max<int64_t>(1, now.nanos - last_time.nanos);
+            last_disk_nanos = disk_nanos;
+            last_time = now;
+
+            const bool overloaded =
+                (latencies.num_samples() >= min_latency_samples
+                    && latencies.percentile_nanos(0.99)
+                        > foreground_latency_target_ms * MILLION)
+                || disk_queue_depth > max_disk_queue_depth;
+
+            new_mutex_acq_t mutex_acq(&mutex, keepalive.get_drain_signal());
+            if (overloaded) {
+                adaptive_limit = std::max<size_t>(1, adaptive_limit / 2);
+                preempt_backfills_over_limit();
+            } else if (adaptive_limit < max_active_backfills) {
+                ++adaptive_limit;
+                start_waiting_backfills();
+            }
+        }
+    } catch (const interrupted_exc_t &) {
+        /* The throttler is being destroyed */
+    }
+}
+
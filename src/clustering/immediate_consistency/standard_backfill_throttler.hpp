@@ -5,26 +5,58 @@
 #include <set>
 
 #include "clustering/immediate_consistency/backfill_throttler.hpp"
+#include "concurrency/auto_drainer.hpp"
 #include "concurrency/new_mutex.hpp"
 
 /* `standard_backfill_throttler_t` is the `backfill_throttler_t` that is used in
-production. It allows a fixed number of backfills total (currently 8); if there are more
-than 8 backfills trying to run, it will always allow the highest-priority backfills to go
-first, preempting the lower-priority backfills if necessary. */
+production. It allows a limited number of backfills total; if there are more backfills
+trying to run, it will always allow the highest-priority backfills to go first,
+preempting the lower-priority backfills if necessary.
+
+Every shard of a table is backfilled as `CPU_SHARDING_FACTOR` independent backfills, one
+for each CPU shard, each with its own B-tree traversals and item stream. So the limit is
+at least `CPU_SHARDING_FACTOR`, so that a single shard is backfilled in parallel, and
+grows with the number of threads, so that several shards can be backfilled at once
+without leaving cores idle.
+
+Backfills compete with queries for the disk and the cache, so the throttler also
+watches how long foreground reads and writes take in the stores (see
+`foreground_latency.hpp`) and how many disk requests are in flight. It runs an AIMD
+controller on the number of non-critical backfills it lets run at once: every time the
+99th percentile latency exceeds the latency target, or the disk queue is too deep, the
+limit is halved and the lowest-priority backfills over it are preempted; otherwise the
+limit grows by one. Critical backfills are only subject to the fixed limit, because the
+availability of a table depends on them. */
 
 class standard_backfill_throttler_t : public backfill_throttler_t {
 public:
-    standard_backfill_throttler_t() { }
+    standard_backfill_throttler_t();
     ~standard_backfill_throttler_t();
 
 private:
     void enter(lock_t *lock, signal_t *interruptor);
     void exit(lock_t *lock);
 
+    size_t get_limit(const priority_t &priority) const;
+
+    /* These must be called while holding `mutex`. */
+    void start_waiting_backfills();
+    void preempt_backfills_over_limit();
+
+    void adjust_limit(auto_drainer_t::lock_t keepalive);
+
+    const size_t max_active_backfills;
+
+    /* The limit on the number of non-critical backfills that the AIMD controller has
+    settled on, between 1 and `max_active_backfills`. */
+    size_t adaptive_limit;
+
     std::multimap<priority_t, std::pair<lock_t *, cond_t *> > waiting;
     std::set<std::pair<priority_t, lock_t *> > active;
 
     new_mutex_t mutex;
+
+    auto_drainer_t drainer;
 };
 
 #endif /* CLUSTERING_IMMEDIATE_CONSISTENCY_STANDARD_BACKFILL_THROTTLER_HPP_ */
@@ -28,7 +28,8 @@ void direct_query_server_t::on_read(
         read_response_t response;
         response.response = dummy_read_response_t();
         response.n_shards = 1;
-        send(mailbox_manager, cont, response);
+        send(mailbox_manager, connectivity_cluster_t::message_class_t::QUERY,
+            cont, response);
         return;
     }
 
@@ -47,7 +48,8 @@ void direct_query_server_t::on_read(
                   &response,
                   &token,
                   interruptor);
-        send(mailbox_manager, cont, response);
+        send(mailbox_manager, connectivity_cluster_t::message_class_t::QUERY,
+            cont, response);
     } catch (const interrupted_exc_t &) {
         /* ignore */
     }
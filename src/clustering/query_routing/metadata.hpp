@@ -10,6 +10,7 @@
 #include "clustering/generic/multi_client_metadata.hpp"
 #include "clustering/generic/registration_metadata.hpp"
 #include "concurrency/fifo_checker.hpp"
+#include "containers/archive/optional.hpp"
 #include "concurrency/fifo_enforcer.hpp"
 #include "rdb_protocol/protocol.hpp"
 #include "rpc/mailbox/typed.hpp"
@@ -77,11 +78,19 @@ secondary replica for. */
 class direct_query_bcard_t {
 public:
     typedef mailbox_t<read_t, mailbox_addr_t<read_response_t>> read_mailbox_t;
+    /* Answers up-to-date reads under a read lease from the primary. The reply is empty
+    if the replica doesn't hold a lease, in which case the read should go to the
+    primary instead. */
+    typedef mailbox_t<read_t, mailbox_addr_t<optional<read_response_t>>>
+        lease_read_mailbox_t;
 
     direct_query_bcard_t() { }
     explicit direct_query_bcard_t(const read_mailbox_t::address_t &rm) : read_mailbox(rm) { }
 
     read_mailbox_t::address_t read_mailbox;
+
+    /* Only set on secondary replicas that are streaming writes from the primary. */
+    lease_read_mailbox_t::address_t lease_read_mailbox;
 };
 
 RDB_DECLARE_SERIALIZABLE(direct_query_bcard_t);
@@ -54,7 +54,8 @@ void primary_query_server_t::client_t::perform_request(
             if (!ok) {
                 reply = cannot_perform_query_exc_t(error.msg, error.query_state);
             }
-            send(parent->mailbox_manager, read->cont_addr, reply);
+            send(parent->mailbox_manager, connectivity_cluster_t::message_class_t::QUERY,
+                read->cont_addr, reply);
 
         } else if (const primary_query_bcard_t::write_request_t *write =
                 boost::get<primary_query_bcard_t::write_request_t>(&request)) {
@@ -70,7 +71,8 @@ void primary_query_server_t::client_t::perform_request(
             if (!ok) {
                 reply = cannot_perform_query_exc_t(error.msg, error.query_state);
             }
-            send(parent->mailbox_manager, write->cont_addr, reply);
+            send(parent->mailbox_manager, connectivity_cluster_t::message_class_t::QUERY,
+                write->cont_addr, reply);
 
         } else {
             unreachable();
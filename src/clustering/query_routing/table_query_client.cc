@@ -1,8 +1,10 @@
 // Copyright 2010-2015 RethinkDB, all rights reserved.
 #include "clustering/query_routing/table_query_client.hpp"
 
+#include <algorithm>
 #include <functional>
 
+#include "arch/timing.hpp"
 #include "clustering/query_routing/primary_query_client.hpp"
 #include "clustering/table_contract/cpu_sharding.hpp"
 #include "clustering/table_manager/multi_table_manager.hpp"
@@ -10,6 +12,7 @@
 #include "concurrency/fifo_enforcer.hpp"
 #include "concurrency/watchable.hpp"
 #include "rdb_protocol/env.hpp"
+#include "time.hpp"
 
 table_query_client_t::table_query_client_t(
         const namespace_id_t &_table_id,
@@ -123,6 +126,12 @@ void table_query_client_t::read(
     } else if (r.read_mode == read_mode_t::DEBUG_DIRECT) {
         guarantee(!r.route_to_primary());
         dispatch_debug_direct_read(r, response, interruptor);
+    } else if (r.read_mode == read_mode_t::SINGLE && ctx->lease_reads
+            && !r.route_to_primary()
+            && boost::get<dummy_read_t>(&r.read) == nullptr
+            && dispatch_lease_read(r, response, interruptor)) {
+        /* The local replicas answered the read, so we're done. Dummy reads are left
+        out because they check whether the primaries are available. */
     } else {
         dispatch_immediate_op<read_t, fifo_enforcer_sink_t::exit_read_t, read_response_t>(
                 &primary_query_client_t::new_read_token,
@@ -331,6 +340,39 @@ void table_query_client_t::perform_immediate_op(
     }
 }
 
+/* How much weight each new latency gets in the moving average. */
+#define READ_LATENCY_EWMA_WEIGHT 0.1
+
+table_query_client_t::read_latency_stats_t::read_latency_stats_t() :
+    in_flight(0), ewma_latency_us(0), num_recorded(0) { }
+
+void table_query_client_t::read_latency_stats_t::record(int64_t latency_us) {
+    if (num_recorded == 0) {
+        ewma_latency_us = latency_us;
+    } else {
+        ewma_latency_us += READ_LATENCY_EWMA_WEIGHT * (latency_us - ewma_latency_us);
+    }
+    recent_latencies[num_recorded % WINDOW_SIZE] = latency_us;
+    ++num_recorded;
+}
+
+double table_query_client_t::read_latency_stats_t::expected_latency_us() const {
+    /* If the reads that are already waiting for the replica are about as expensive
+    as this one, it will take about this long to get to ours. */
+    return (in_flight + 1) * ewma_latency_us;
+}
+
+int64_t table_query_client_t::read_latency_stats_t::p95_latency_us() const {
+    if (num_recorded < MIN_SAMPLES_FOR_P95) {
+        return -1;
+    }
+    const size_t n = std::min(num_recorded, WINDOW_SIZE);
+    std::array<int64_t, WINDOW_SIZE> sorted = recent_latencies;
+    const size_t index = (n * 95) / 100;
+    std::nth_element(sorted.begin(), sorted.begin() + index, sorted.begin() + n);
+    return sorted[index];
+}
+
 void table_query_client_t::dispatch_outdated_read(
     const read_t &op,
     read_response_t *response,
@@ -345,24 +387,44 @@ void table_query_client_t::dispatch_outdated_read(
     relationships.visit(region_t::universe(),
     [&](const region_t &region, const std::set<relationship_t *> &rels) {
         if (op.shard(region, &new_op_info->sharded_op)) {
-            std::vector<relationship_t *> potential_relationships;
+            /* Pick the replica that is expected to answer first, and the runner-up
+            for hedging. Ties go to the local replica, then to a random one, so that
+            replicas we know nothing about yet get to answer some reads. */
             relationship_t *chosen_relationship = nullptr;
+            relationship_t *runner_up = nullptr;
+            double chosen_latency = 0, runner_up_latency = 0;
+            size_t num_ties = 0;
             for (auto jt = rels.begin(); jt != rels.end(); ++jt) {
                 // See the comment in `dispatch_immediate_op` about why we need to
                 // check that `region` and the relationship's region are the same.
-                if ((*jt)->direct_bcard != nullptr && (*jt)->region == region) {
-                    if ((*jt)->is_local) {
-                        chosen_relationship = *jt;
-                        break;
-                    } else {
-                        potential_relationships.push_back(*jt);
+                if ((*jt)->direct_bcard == nullptr || (*jt)->region != region) {
+                    continue;
+                }
+                const double latency = (*jt)->read_stats.expected_latency_us();
+                bool better;
+                if (chosen_relationship == nullptr || latency < chosen_latency) {
+                    better = true;
+                    num_ties = 1;
+                } else if (latency > chosen_latency || chosen_relationship->is_local) {
+                    better = false;
+                } else if ((*jt)->is_local) {
+                    better = true;
+                } else {
+                    ++num_ties;
+                    better = randint(num_ties) == 0;
+                }
+                if (better) {
+                    if (chosen_relationship != nullptr) {
+                        runner_up = chosen_relationship;
+                        runner_up_latency = chosen_latency;
                     }
+                    chosen_relationship = *jt;
+                    chosen_latency = latency;
+                } else if (runner_up == nullptr || latency < runner_up_latency) {
+                    runner_up = *jt;
+                    runner_up_latency = latency;
                 }
             }
-            if (!chosen_relationship && !potential_relationships.empty()) {
-                chosen_relationship
-                    = potential_relationships[randint(potential_relationships.size())];
-            }
             if (!chosen_relationship) {
                 /* Don't bother looking for masters; if there are no direct
                    readers, there won't be any masters either. */
@@ -370,9 +432,17 @@ void table_query_client_t::dispatch_outdated_read(
                     "no replica is available",
                     query_state_t::FAILED);
             }
-            new_op_info->direct_bcard = chosen_relationship->direct_bcard;
+            new_op_info->relationship = chosen_relationship;
             new_op_info->keepalive = auto_drainer_t::lock_t(
                 &chosen_relationship->drainer);
+            new_op_info->hedge_relationship = nullptr;
+            const int64_t p95_us = chosen_relationship->read_stats.p95_latency_us();
+            if (ctx->hedge_outdated_reads && runner_up != nullptr && p95_us != -1) {
+                new_op_info->hedge_relationship = runner_up;
+                new_op_info->hedge_keepalive = auto_drainer_t::lock_t(
+                    &runner_up->drainer);
+                new_op_info->hedge_delay_ms = std::max<int64_t>(1, (p95_us + 999) / 1000);
+            }
             replicas_to_contact.push_back(std::move(new_op_info));
             new_op_info.init(new outdated_read_info_t());
         }
@@ -404,24 +474,88 @@ void table_query_client_t::perform_outdated_read(
         signal_t *interruptor) THROWS_NOTHING {
     outdated_read_info_t *replica_to_contact = (*replicas_to_contact)[i].get();
 
+    /* One `attempt_t` for each replica that we send the read to. It keeps
+    `in_flight` up to date. */
+    class attempt_t {
+    public:
+        explicit attempt_t(relationship_t *_relationship) :
+                relationship(_relationship), start(get_kiloticks()) {
+            ++relationship->read_stats.in_flight;
+        }
+        ~attempt_t() {
+            --relationship->read_stats.in_flight;
+        }
+        void record_latency() {
+            relationship->read_stats.record(get_kiloticks().micros - start.micros);
+        }
+        relationship_t *const relationship;
+        const kiloticks_t start;
+    };
+
     try {
         cond_t done;
-        mailbox_t<read_response_t> cont(mailbox_manager,
-            [&](signal_t *, const read_response_t &res) {
+        relationship_t *winner = nullptr;
+        auto on_response = [&](relationship_t *relationship, const read_response_t &res) {
+            /* If the read went to two replicas, the slower one's answer is dropped
+            here. */
+            if (winner == nullptr) {
+                winner = relationship;
                 results->at(i) = res;
                 done.pulse();
+            }
+        };
+        mailbox_t<read_response_t> cont(mailbox_manager,
+            [&](signal_t *, const read_response_t &res) {
+                on_response(replica_to_contact->relationship, res);
+            });
+        mailbox_t<read_response_t> hedge_cont(mailbox_manager,
+            [&](signal_t *, const read_response_t &res) {
+                on_response(replica_to_contact->hedge_relationship, res);
             });
 
-        send(mailbox_manager,
-            replica_to_contact->direct_bcard->read_mailbox,
+        attempt_t attempt(replica_to_contact->relationship);
+        send(mailbox_manager, connectivity_cluster_t::message_class_t::QUERY,
+            replica_to_contact->relationship->direct_bcard->read_mailbox,
             replica_to_contact->sharded_op,
             cont.get_address());
-        wait_any_t waiter(replica_to_contact->keepalive.get_drain_signal(), &done);
+
+        signal_timer_t hedge_timer;
+        if (replica_to_contact->hedge_relationship != nullptr) {
+            hedge_timer.start(replica_to_contact->hedge_delay_ms);
+        }
+        wait_any_t waiter(
+            replica_to_contact->keepalive.get_drain_signal(), &done, &hedge_timer);
         wait_interruptible(&waiter, interruptor);
+
+        scoped_ptr_t<attempt_t> hedge_attempt;
+        if (!done.is_pulsed() && hedge_timer.is_pulsed()
+                && !replica_to_contact->keepalive.get_drain_signal()->is_pulsed()) {
+            /* The replica is slower than it usually is, so ask the other one too. We
+            can't stop the slow replica from performing the read, but we stop waiting
+            for it as soon as either of them answers. */
+            hedge_attempt.init(new attempt_t(replica_to_contact->hedge_relationship));
+            send(mailbox_manager, connectivity_cluster_t::message_class_t::QUERY,
+                replica_to_contact->hedge_relationship->direct_bcard->read_mailbox,
+                replica_to_contact->sharded_op,
+                hedge_cont.get_address());
+            wait_any_t hedge_waiter(
+                replica_to_contact->keepalive.get_drain_signal(),
+                replica_to_contact->hedge_keepalive.get_drain_signal(),
+                &done);
+            wait_interruptible(&hedge_waiter, interruptor);
+        }
+
         if (!done.is_pulsed()) {
-            /* `wait_interruptible()` returned because
-            `replica_to_contact->keepalive.get_drain_signal()` was pulsed */
+            /* `wait_interruptible()` returned because the drain signal of a replica
+            that we sent the read to was pulsed */
             failures->at(i).assign("lost contact with replica");
+        } else if (winner == attempt.relationship) {
+            attempt.record_latency();
+        } else {
+            /* The first replica hasn't answered yet, so its latency is at least as
+            long as it has been waiting. */
+            hedge_attempt->record_latency();
+            attempt.record_latency();
         }
     } catch (const interrupted_exc_t &) {
         /* Return immediately. `dispatch_immediate_op()` will notice that the
@@ -429,6 +563,83 @@ void table_query_client_t::perform_outdated_read(
     }
 }
 
+bool table_query_client_t::dispatch_lease_read(
+        const read_t &op,
+        read_response_t *response,
+        signal_t *interruptor)
+        THROWS_ONLY(interrupted_exc_t, cannot_perform_query_exc_t) {
+    if (interruptor->is_pulsed()) throw interrupted_exc_t();
+
+    std::vector<read_t> sharded_ops;
+    std::vector<relationship_t *> replicas;
+    std::vector<auto_drainer_t::lock_t> keepalives;
+    bool all_shards_local = true;
+    relationships.visit(region_t::universe(),
+    [&](const region_t &region, const std::set<relationship_t *> &rels) {
+        read_t sharded_op;
+        if (!all_shards_local || !op.shard(region, &sharded_op)) {
+            return;
+        }
+        relationship_t *chosen_relationship = nullptr;
+        for (relationship_t *rel : rels) {
+            // See the comment in `dispatch_immediate_op` about why we need to check
+            // that `region` and the relationship's region are the same.
+            if (rel->is_local && rel->direct_bcard != nullptr
+                    && !rel->direct_bcard->lease_read_mailbox.is_nil()
+                    && rel->region == region) {
+                chosen_relationship = rel;
+                break;
+            }
+        }
+        if (chosen_relationship == nullptr) {
+            all_shards_local = false;
+            return;
+        }
+        sharded_ops.push_back(std::move(sharded_op));
+        replicas.push_back(chosen_relationship);
+        keepalives.push_back(auto_drainer_t::lock_t(&chosen_relationship->drainer));
+    });
+    if (!all_shards_local || sharded_ops.empty()) {
+        return false;
+    }
+
+    std::vector<read_response_t> results(sharded_ops.size());
+    std::vector<bool> answered(sharded_ops.size(), false);
+    pmap(sharded_ops.size(), [&](size_t i) {
+        try {
+            cond_t done;
+            mailbox_t<optional<read_response_t>> cont(mailbox_manager,
+                [&](signal_t *, const optional<read_response_t> &res) {
+                    if (res.has_value()) {
+                        results[i] = res.get();
+                        answered[i] = true;
+                    }
+                    done.pulse();
+                });
+            send(mailbox_manager, connectivity_cluster_t::message_class_t::QUERY,
+                replicas[i]->direct_bcard->lease_read_mailbox,
+                sharded_ops[i],
+                cont.get_address());
+            wait_any_t waiter(keepalives[i].get_drain_signal(), &done);
+            wait_interruptible(&waiter, interruptor);
+        } catch (const interrupted_exc_t &) {
+            /* Return immediately. `dispatch_lease_read()` will notice that the
+            interruptor has been pulsed. */
+        }
+    });
+
+    if (interruptor->is_pulsed()) throw interrupted_exc_t();
+
+    /* Reads have no side effects, so if any shard couldn't be read under a lease, we
+    can simply start over on the primaries. */
+    if (std::find(answered.begin(), answered.end(), false) != answered.end()) {
+        return false;
+    }
+
+    op.unshard(results.data(), results.size(), response, ctx, interruptor);
+    return true;
+}
+
 void table_query_client_t::dispatch_debug_direct_read(
         const read_t &op,
         read_response_t *response,
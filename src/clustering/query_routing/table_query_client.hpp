@@ -4,6 +4,7 @@
 
 #include <math.h>
 
+#include <array>
 #include <map>
 #include <string>
 #include <vector>
@@ -68,12 +69,44 @@ public:
     std::set<region_t> get_sharding_scheme() THROWS_ONLY(cannot_perform_query_exc_t);
 
 private:
+    /* `read_latency_stats_t` keeps track of the outdated reads that went to one
+    replica, so that `dispatch_outdated_read()` can pick the replica that is likely to
+    answer first. */
+    class read_latency_stats_t {
+    public:
+        read_latency_stats_t();
+
+        void record(int64_t latency_us);
+
+        /* How long the replica is expected to take to answer a read that is sent to it
+        now, given the reads that are already waiting for it. */
+        double expected_latency_us() const;
+
+        /* The 95th percentile of the recent latencies, or -1 if there aren't enough
+        of them to tell. */
+        int64_t p95_latency_us() const;
+
+        int64_t in_flight;
+
+    private:
+        static const size_t WINDOW_SIZE = 64;
+        static const size_t MIN_SAMPLES_FOR_P95 = 20;
+
+        double ewma_latency_us;
+        /* The latest `WINDOW_SIZE` latencies, in a ring buffer. */
+        std::array<int64_t, WINDOW_SIZE> recent_latencies;
+        size_t num_recorded;
+    };
+
     class relationship_t {
     public:
         bool is_local;
         region_t region;
         primary_query_client_t *primary_client;
         const direct_query_bcard_t *direct_bcard;
+        /* This must be declared before `drainer`, because reads that hold a lock on
+        `drainer` update it. */
+        read_latency_stats_t read_stats;
         auto_drainer_t drainer;
     };
 
@@ -93,8 +126,14 @@ private:
     class outdated_read_info_t {
     public:
         read_t sharded_op;
-        const direct_query_bcard_t *direct_bcard;
+        relationship_t *relationship;
         auto_drainer_t::lock_t keepalive;
+        /* If `hedge_relationship` is set, the read goes to that replica as well if the
+        first one hasn't answered after `hedge_delay_ms`. Whichever answers first
+        wins. */
+        relationship_t *hedge_relationship;
+        auto_drainer_t::lock_t hedge_keepalive;
+        int64_t hedge_delay_ms;
     };
 
     template <class op_type, class fifo_enforcer_token_type, class op_response_type>
@@ -137,6 +176,16 @@ private:
             signal_t *interruptor)
         THROWS_NOTHING;
 
+    /* Tries to perform an up-to-date read on secondary replicas on this server that
+    hold read leases from their primaries. Returns `false` if some shard has no such
+    replica, or if the replica doesn't hold a lease right now; then the read should go
+    to the primaries instead. */
+    bool dispatch_lease_read(
+            const read_t &op,
+            read_response_t *response,
+            signal_t *interruptor)
+        THROWS_ONLY(interrupted_exc_t, cannot_perform_query_exc_t);
+
     void dispatch_debug_direct_read(
             const read_t &op,
             read_response_t *response,
@@ -161,6 +210,11 @@ private:
     table_meta_client_t *m_table_meta_client;
 
     std::map<std::pair<peer_id_t, uuid_u>, scoped_ptr_t<cond_t> > coro_stoppers;
+
+    /* `namespace_repo_t` creates a separate `table_query_client_t` on every thread that
+    runs queries against the table, and `directory` is a copy of the directory on that
+    thread. So `relationships` is only ever read or written on the thread the queries run
+    on, and routing a query to its shards never has to switch threads. */
     region_map_t<std::set<relationship_t *> > relationships;
 
     /* `start_cond` will be pulsed when we have either successfully connected to
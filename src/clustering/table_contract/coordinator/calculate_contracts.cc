@@ -726,7 +726,11 @@ void calculate_all_contracts(
             std::move(new_contract_region_vector), std::move(new_contract_vector));
 
     /* Slice the new contracts by CPU shard and by user shard, so that no contract spans
-    more than one CPU shard or user shard. */
+    more than one CPU shard or user shard. Note that when the user only moves a shard
+    boundary, the slices on either side of it inherit the old contract unchanged, so the
+    same servers keep the same data and nothing is erased. Their executions restart and
+    the primary starts a new branch, but the replicas' backfills from it start at the
+    common ancestor on the old branch, so only writes made since then are copied. */
     std::map<region_t, contract_t> new_contract_map;
     for (size_t cpu = 0; cpu < CPU_SHARDING_FACTOR; ++cpu) {
         region_t region = cpu_sharding_subspace(cpu);
@@ -22,8 +22,7 @@ primary_execution_t::primary_execution_t(
     guarantee(contract.primary->server == context->server_id);
     guarantee(raft_state.contracts.at(contract_id).first == region);
     latest_contract_home_thread = make_counted<contract_info_t>(
-        contract_id, contract, raft_state.config.config.durability,
-        raft_state.config.config.write_ack_config);
+        contract_id, contract, raft_state.config.config);
     latest_contract_store_thread = latest_contract_home_thread;
     begin_write_mutex_assertion.rethread(store->home_thread());
     coro_t::spawn_sometime(std::bind(&primary_execution_t::run, this, drainer.lock()));
@@ -69,8 +68,7 @@ void primary_execution_t::update_contract_or_raft_state(
     counted_t<contract_info_t> new_contract = make_counted<contract_info_t>(
         contract_id,
         contract,
-        raft_state.config.config.durability,
-        raft_state.config.config.write_ack_config);
+        raft_state.config.config);
 
     /* Exit early if there aren't actually any changes. This is for performance reasons.
     */
@@ -239,8 +237,10 @@ void primary_execution_t::run(auto_drainer_t::lock_t keepalive) {
             directory_entry_primary(
                 context->local_table_query_bcards, generate_uuid(), tq_bcard_primary);
 
-        /* Wait until we are no longer the primary, or it's time to shut down */
-        keepalive.get_drain_signal()->wait_lazily_unordered();
+        /* Expire rows if the table has a TTL, until we are no longer the primary or
+        it's time to shut down */
+        on_thread_t thread_switcher_5(store->home_thread());
+        expire_rows(&order_source, &interruptor_store_thread);
 
     } catch (const interrupted_exc_t &) {
         /* do nothing */
@@ -342,6 +342,7 @@ bool primary_execution_t::on_write(
                                     contract_snapshot->default_write_durability,
                                     contract_snapshot->write_ack_config,
                                     &contract_snapshot->contract);
+    const ticks_t spawn_time = get_ticks();
     our_dispatcher->spawn_write(request, order_token, &write_callback);
 
     /* Now that we've called `spawn_write()`, our write is in the queue. So it's safe to
@@ -356,6 +357,13 @@ bool primary_execution_t::on_write(
     wait_interruptible(write_callback.result.get_ready_signal(), interruptor);
 
     bool res = write_callback.result.assert_get_value();
+    if (res && request.profile == profile_bool_t::PROFILE) {
+        /* The event log comes from the replica whose ack made the write safe to ack,
+        so this includes the time that replica took as well as the network. */
+        profile::add_shard_sample(&response_out->event_log,
+            "Replicate the write and wait for acks.",
+            ticks_t{get_ticks().nanos - spawn_time.nanos});
+    }
     if (!res) {
         *error_out = admin_err_t{
             "The primary replica lost contact with the secondary "
@@ -410,6 +418,93 @@ bool primary_execution_t::sync_committed_read(const read_t &read_request,
     return res;
 }
 
+void primary_execution_t::expire_rows(
+        order_source_t *order_source,
+        signal_t *interruptor) {
+    store->assert_thread();
+    guarantee(our_dispatcher != nullptr);
+    while (true) {
+        nap(TTL_SWEEP_INTERVAL_MS, interruptor);
+
+        counted_t<contract_info_t> contract = latest_contract_store_thread;
+        if (!static_cast<bool>(contract->ttl)) {
+            continue;
+        }
+
+        /* We use the same cutoff for the whole round, so that it ends even if rows
+        keep expiring while we delete them. */
+        double cutoff = current_microtime() / 1000000.0 - contract->ttl->seconds;
+        while (expire_batch(contract, cutoff, order_source, interruptor)) {
+            nap(TTL_SWEEP_WRITE_DELAY_MS, interruptor);
+        }
+    }
+}
+
+bool primary_execution_t::expire_batch(
+        counted_t<contract_info_t> contract,
+        double cutoff,
+        order_source_t *order_source,
+        signal_t *interruptor) {
+    store->assert_thread();
+    guarantee(our_dispatcher != nullptr);
+
+    /* Our copy of the index might be missing rows that another replica has, or have
+    rows that were changed since. That's fine, because every replica checks each row
+    again before deleting it. */
+    std::vector<store_key_t> keys;
+    store->get_expired_keys(
+        contract->ttl->index, cutoff, TTL_SWEEP_MAX_ROWS_PER_WRITE, &keys, interruptor);
+    if (keys.empty()) {
+        return false;
+    }
+    const bool batch_full = keys.size() >= TTL_SWEEP_MAX_ROWS_PER_WRITE;
+
+    write_t request(
+        ttl_expire_t(std::move(keys), contract->primary_key, contract->ttl_index, cutoff),
+        profile_bool_t::DONT_PROFILE,
+        ql::configured_limits_t());
+    write_response_t response;
+
+    /* See the comments in `on_write` for an explanation about why we're acquiring
+    `begin_write_mutex_assertion` here. */
+    mutex_assertion_t::acq_t begin_write_mutex_acq(&begin_write_mutex_assertion);
+    DEBUG_ONLY(scoped_ptr_t<assert_finite_coro_waiting_t> finite_coro_waiting(
+                   make_scoped<assert_finite_coro_waiting_t>(__FILE__, __LINE__)));
+    counted_t<contract_info_t> contract_snapshot = latest_contract_store_thread;
+
+    /* Like user writes, we don't expire rows while the primary is being handed over or
+    if we can't reach a majority of the replicas. We'll try again in the next round. */
+    if (static_cast<bool>(contract_snapshot->contract.primary->hand_over) ||
+            !is_majority_available(contract_snapshot, our_dispatcher)) {
+        return false;
+    }
+
+    write_callback_t write_callback(&response,
+                                    contract_snapshot->default_write_durability,
+                                    contract_snapshot->write_ack_config,
+                                    &contract_snapshot->contract);
+    our_dispatcher->spawn_write(
+        request, order_source->check_in("primary_t::expire_rows"), &write_callback);
+
+    DEBUG_ONLY(finite_coro_waiting.reset());
+    begin_write_mutex_acq.reset();
+
+    wait_interruptible(write_callback.result.get_ready_signal(), interruptor);
+
+    if (!write_callback.result.assert_get_value() || !batch_full) {
+        return false;
+    }
+
+    /* If none of the rows were actually deleted, they were all changed since the index
+    said they expired. Stop here rather than finding the same rows again. */
+    const ql::datum_t *stats = boost::get<ql::datum_t>(&response.response);
+    if (stats == nullptr) {
+        return false;
+    }
+    ql::datum_t deleted = stats->get_field("deleted", ql::NOTHROW);
+    return deleted.has() && deleted.as_num() > 0;
+}
+
 bool primary_execution_t::on_read(
         const read_t &request,
         fifo_enforcer_sink_t::exit_read_t *exiter,
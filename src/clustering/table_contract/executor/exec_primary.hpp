@@ -63,24 +63,42 @@ private:
     public:
         contract_info_t(const contract_id_t &_contract_id,
                         const contract_t &_contract,
-                        write_durability_t _default_write_durability,
-                        write_ack_config_t _write_ack_config) :
+                        const table_config_t &config) :
                 contract_id(_contract_id),
                 contract(_contract),
-                default_write_durability(_default_write_durability),
-                write_ack_config(_write_ack_config) {
+                default_write_durability(config.durability),
+                write_ack_config(config.write_ack_config),
+                primary_key(config.basic.primary_key) {
+            /* We only expire rows if the TTL's index can actually tell us which ones
+            are old. */
+            if (static_cast<bool>(config.ttl)) {
+                auto it = config.sindexes.find(config.ttl->index);
+                if (it != config.sindexes.end() &&
+                        it->second.multi == sindex_multi_bool_t::SINGLE &&
+                        it->second.geo == sindex_geo_bool_t::REGULAR) {
+                    ttl = config.ttl;
+                    ttl_index = it->second;
+                }
+            }
         }
         bool equivalent(const contract_info_t &other) const {
             /* This method is called `equivalent` rather than `operator==` to avoid
             confusion, because it doesn't actually compare every member */
             return contract_id == other.contract_id &&
                 default_write_durability == other.default_write_durability &&
-                write_ack_config == other.write_ack_config;
+                write_ack_config == other.write_ack_config &&
+                ttl == other.ttl &&
+                ttl_index == other.ttl_index;
         }
         contract_id_t contract_id;
         contract_t contract;
         write_durability_t default_write_durability;
         write_ack_config_t write_ack_config;
+        std::string primary_key;
+        /* `ttl` is only set if the table has a TTL whose index exists, in which case
+        `ttl_index` is that index's configuration. */
+        optional<table_ttl_config_t> ttl;
+        sindex_config_t ttl_index;
         cond_t obsolete;
     };
 
@@ -114,6 +132,22 @@ private:
                              signal_t *interruptor,
                              admin_err_t *error_out);
 
+    /* `expire_rows()` is run on the store's thread for as long as we are the primary.
+    If the table has a TTL, it periodically deletes the rows that have expired, a few
+    at a time so that it doesn't crowd out the user's queries. Each batch is an
+    ordinary write to all of the replicas. It only returns by throwing
+    `interrupted_exc_t`. */
+    void expire_rows(order_source_t *order_source, signal_t *interruptor);
+
+    /* `expire_batch()` is a helper for `expire_rows()`. It deletes one batch of expired
+    rows, and returns `true` if there might be more of them left. It returns `false` if
+    the write couldn't be performed right now. */
+    bool expire_batch(
+        counted_t<contract_info_t> contract,
+        double cutoff,
+        order_source_t *order_source,
+        signal_t *interruptor);
+
     /* `update_contract_or_raft_state()` spawns `update_contract_on_store_thread()`
     to deliver the new contract to `store->home_thread()`. It has two jobs:
     1. It sets `latest_contract_store_thread` to the new contract
@@ -186,6 +186,23 @@ void secondary_execution_t::run(auto_drainer_t::lock_t keepalive) {
                 context->branch_history_manager,
                 &stop_signal_on_store_thread);
 
+            /* Answer up-to-date reads from servers that use read leases. The mailbox
+            has to live on the store's thread, like `remote_replicator_client`. */
+            direct_query_bcard_t::lease_read_mailbox_t lease_read_mailbox(
+                context->mailbox_manager,
+                [&](signal_t *interruptor, const read_t &read,
+                        const mailbox_addr_t<optional<read_response_t>> &cont) {
+                    read_response_t response;
+                    optional<read_response_t> reply;
+                    if (remote_replicator_client.lease_read(
+                            read, &response, interruptor)) {
+                        reply.set(std::move(response));
+                    }
+                    send(context->mailbox_manager,
+                        connectivity_cluster_t::message_class_t::QUERY,
+                        cont, reply);
+                });
+
             on_thread_t thread_switcher_4(home_thread());
 
             /* Now that we've backfilled, it's safe to call `enable_gc()`. */
@@ -197,11 +214,13 @@ void secondary_execution_t::run(auto_drainer_t::lock_t keepalive) {
             /* Let the coordinator know we finished backfilling */
             send_ack(contract_ack_t(contract_ack_t::state_t::secondary_streaming));
 
-            /* Resume serving outdated reads now that the backfill is over */
+            /* Resume serving outdated reads now that the backfill is over, and start
+            serving lease reads */
             {
                 table_query_bcard_t tq_bcard;
                 tq_bcard.region = region;
                 tq_bcard.direct = make_optional(direct_query_server.get_bcard());
+                tq_bcard.direct->lease_read_mailbox = lease_read_mailbox.get_address();
                 directory_entry.create(
                     context->local_table_query_bcards, generate_uuid(), tq_bcard);
             }
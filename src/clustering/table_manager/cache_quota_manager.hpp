@@ -0,0 +1,35 @@
+// Copyright 2010-2015 RethinkDB, all rights reserved.
+#ifndef CLUSTERING_TABLE_MANAGER_CACHE_QUOTA_MANAGER_HPP_
+#define CLUSTERING_TABLE_MANAGER_CACHE_QUOTA_MANAGER_HPP_
+
+#include "clustering/table_contract/cpu_sharding.hpp"
+#include "clustering/administration/tables/table_metadata.hpp"
+#include "concurrency/pump_coro.hpp"
+#include "concurrency/watchable.hpp"
+
+/* The `cache_quota_manager_t` is responsible for reading the cache settings from the
+`table_config_t` and updating the cache quota on the `store_t`s. The reserved size is
+split evenly between the CPU shards. */
+
+class cache_quota_manager_t {
+public:
+    cache_quota_manager_t(
+        multistore_ptr_t *multistore,
+        const clone_ptr_t<watchable_t<table_config_t> > &table_config);
+
+private:
+    void update_blocking(signal_t *interruptor);
+
+    multistore_ptr_t *const multistore;
+    clone_ptr_t<watchable_t<table_config_t> > const table_config;
+
+    /* Destructor order matters: The `table_config_subs` must be destroyed before the
+    `update_pumper` because it calls `update_pumper.notify()`. But `update_pumper` must
+    be destroyed before the other variables because it runs `update_blocking()`, which
+    accesses the other variables. */
+    pump_coro_t update_pumper;
+
+    watchable_t<table_config_t>::subscription_t table_config_subs;
+};
+
+#endif /* CLUSTERING_TABLE_MANAGER_CACHE_QUOTA_MANAGER_HPP_ */
@@ -3,7 +3,9 @@
 
 #include "clustering/generic/raft_core.tcc"
 #include "clustering/table_manager/table_manager.hpp"
+#include "concurrency/pmap.hpp"
 #include "logger.hpp"
+#include "time.hpp"
 
 multi_table_manager_t::multi_table_manager_t(
         const server_id_t &_server_id,
@@ -31,27 +33,27 @@ multi_table_manager_t::multi_table_manager_t(
     io_backender(_io_backender),
     perfmon_collection_repo(_perfmon_collection_repo) {
 
-    /* Resurrect any tables that were sitting on disk from when we last shut down */
+    /* Resurrect any tables that were sitting on disk from when we last shut down. The
+    active tables' stores are what takes the time, so we only note them down while we
+    read the metadata and then load up to `TABLE_STARTUP_CONCURRENCY` of them at once. */
+    struct active_load_t {
+        namespace_id_t table_id;
+        table_t *table;
+        table_active_persistent_state_t state;
+        raft_storage_interface_t<table_raft_state_t> *raft_storage;
+    };
+    std::vector<active_load_t> active_loads;
     cond_t non_interruptor;
     persistence_interface->read_all_metadata(
         [&](const namespace_id_t &table_id,
                 const table_active_persistent_state_t &state,
                 raft_storage_interface_t<table_raft_state_t> *raft_storage,
-                metadata_file_t::read_txn_t *metadata_read_txn) {
+                metadata_file_t::read_txn_t *) {
             guarantee(tables.count(table_id) == 0);
             table_t *table;
             tables[table_id].init(table = new table_t);
-            rwlock_acq_t table_lock_acq(&table->access_rwlock, access_t::write);
-            perfmon_collection_repo_t::collections_t *perfmon_collections =
-                perfmon_collection_repo->get_perfmon_collections_for_namespace(table_id);
             table->status = table_t::status_t::ACTIVE;
-            persistence_interface->load_multistore(
-                table_id, metadata_read_txn, &table->multistore_ptr, &non_interruptor,
-                &perfmon_collections->serializers_collection);
-            table->active = make_scoped<active_table_t>(
-                this, table, table_id, state.epoch, state.raft_member_id, raft_storage,
-                raft_start_election_immediately_t::NO, table->multistore_ptr.get(),
-                &perfmon_collections->namespace_collection);
+            active_loads.push_back(active_load_t{table_id, table, state, raft_storage});
         },
         [&](const namespace_id_t &table_id,
                 const table_inactive_persistent_state_t &state,
@@ -66,6 +68,29 @@ multi_table_manager_t::multi_table_manager_t(
         },
         &non_interruptor);
 
+    const microtime_t start_time = current_microtime();
+    throttled_pmap(active_loads.size(), [&](int64_t i) {
+        const active_load_t &load = active_loads[i];
+        rwlock_acq_t table_lock_acq(&load.table->access_rwlock, access_t::write);
+        perfmon_collection_repo_t::collections_t *perfmon_collections =
+            perfmon_collection_repo->get_perfmon_collections_for_namespace(
+                load.table_id);
+        /* This opens a metadata read transaction of its own, so the loads don't have
+        to wait for each other to be done with one. */
+        persistence_interface->create_multistore(
+            load.table_id, &load.table->multistore_ptr, &non_interruptor,
+            &perfmon_collections->serializers_collection);
+        load.table->active = make_scoped<active_table_t>(
+            this, load.table, load.table_id, load.state.epoch,
+            load.state.raft_member_id, load.raft_storage,
+            raft_start_election_immediately_t::NO, load.table->multistore_ptr.get(),
+            &perfmon_collections->namespace_collection);
+    }, TABLE_STARTUP_CONCURRENCY);
+    if (!active_loads.empty()) {
+        logNTC("Loaded %zu tables in %.2f seconds.\n", active_loads.size(),
+               (current_microtime() - start_time) / 1000000.0);
+    }
+
     help_construct();
 }
 
@@ -1,11 +1,48 @@
 #include "concurrency/interruptor.hpp"
 
-#include "concurrency/wait_any.hpp"
+#include "arch/runtime/coroutines.hpp"
+#include "concurrency/signal.hpp"
+
+namespace {
+
+/* Wakes up the waiting coroutine when either of the two signals is pulsed, but only
+once. This is all that `wait_interruptible()` needs of a `wait_any_t`, without being a
+`signal_t` itself. */
+class wake_once_subscription_t : public signal_t::subscription_t {
+public:
+    wake_once_subscription_t(coro_t *_coro, bool *_woken)
+        : coro(_coro), woken(_woken) { }
+    void run() {
+        if (!*woken) {
+            *woken = true;
+            coro->notify_sometime();
+        }
+    }
+private:
+    coro_t *coro;
+    bool *woken;
+    DISABLE_COPYING(wake_once_subscription_t);
+};
+
+}  // namespace
 
 void wait_interruptible(const signal_t *signal, const signal_t *interruptor)
         THROWS_ONLY(interrupted_exc_t) {
-    wait_any_t waiter(signal, interruptor);
-    waiter.wait_lazily_unordered();
+    // The signal is usually pulsed already, so check before subscribing to anything.
+    if (interruptor->is_pulsed()) {
+        throw interrupted_exc_t();
+    }
+    if (signal->is_pulsed()) {
+        return;
+    }
+    {
+        bool woken = false;
+        wake_once_subscription_t signal_sub(coro_t::self(), &woken);
+        wake_once_subscription_t interruptor_sub(coro_t::self(), &woken);
+        signal_sub.reset(const_cast<signal_t *>(signal));
+        interruptor_sub.reset(const_cast<signal_t *>(interruptor));
+        coro_t::wait();
+    }
     if (interruptor->is_pulsed()) {
         throw interrupted_exc_t();
     }
@@ -14,13 +14,12 @@ public:
         one_per_thread_t *parent_;
         explicit construct_0_t(one_per_thread_t *p) : parent_(p) { }
         void operator()(int thread) const {
-            on_thread_t th((threadnum_t(thread)));
             parent_->array[thread].create();
         }
     };
 
     one_per_thread_t() : array(get_num_threads()) {
-        pmap(get_num_threads(), construct_0_t(this));
+        pmap_on_all_threads(construct_0_t(this));
     }
 
     template <class arg1_t>
@@ -30,7 +29,6 @@ public:
         construct_1_t(one_per_thread_t *p, const arg1_t &arg1) : parent_(p), arg1_(arg1) { }
 
         void operator()(int thread) const {
-            on_thread_t th((threadnum_t(thread)));
             parent_->array[thread].create(arg1_);
         }
     };
@@ -38,7 +36,7 @@ public:
 
     template<class arg1_t>
     explicit one_per_thread_t(const arg1_t &arg1) : array(get_num_threads()) {
-        pmap(get_num_threads(), construct_1_t<arg1_t>(this, arg1));
+        pmap_on_all_threads(construct_1_t<arg1_t>(this, arg1));
     }
 
     template <class arg1_t, class arg2_t>
@@ -49,14 +47,13 @@ public:
         construct_2_t(one_per_thread_t *p, const arg1_t &arg1, const arg2_t &arg2) : parent_(p), arg1_(arg1), arg2_(arg2) { }
 
         void operator()(int thread) const {
-            on_thread_t th((threadnum_t(thread)));
             parent_->array[thread].create(arg1_, arg2_);
         }
     };
 
     template<class arg1_t, class arg2_t>
     one_per_thread_t(const arg1_t &arg1, const arg2_t &arg2) : array(get_num_threads()) {
-        pmap(get_num_threads(), construct_2_t<arg1_t, arg2_t>(this, arg1, arg2));
+        pmap_on_all_threads(construct_2_t<arg1_t, arg2_t>(this, arg1, arg2));
     }
 
 
@@ -64,13 +61,12 @@ public:
         one_per_thread_t *parent_;
         explicit destruct_t(one_per_thread_t *p) : parent_(p) { }
         void operator()(int thread) const {
-            on_thread_t th((threadnum_t(thread)));
             parent_->array[thread].reset();
         }
     };
 
     ~one_per_thread_t() {
-        pmap(get_num_threads(), destruct_t(this));
+        pmap_on_all_threads(destruct_t(this));
     }
 
     inner_t *get() {
@@ -0,0 +1,94 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#ifndef CONCURRENCY_PER_THREAD_SNAPSHOT_HPP_
+#define CONCURRENCY_PER_THREAD_SNAPSHOT_HPP_
+
+#include <memory>
+#include <utility>
+
+#include "arch/runtime/coroutines.hpp"
+#include "arch/runtime/runtime.hpp"
+#include "concurrency/one_per_thread.hpp"
+#include "concurrency/pmap.hpp"
+#include "concurrency/watchable.hpp"
+
+/* `per_thread_snapshot_t` is for values that are read on every thread, often, and
+written rarely, such as the user table that every permission check looks at. Every
+thread has its own slot pointing at an immutable copy of the current value, so `get()`
+doesn't take a lock, switch threads or copy anything; it only bumps a reference count.
+
+`publish()` must be called on the home thread. It makes one new immutable copy, and
+then visits every thread to point that thread's slot at it. Readers that already hold
+the old copy keep using it, and it's freed once the last of them drops it, on whichever
+thread that happens. So `value_t` must be safe to destroy on any thread; plain metadata
+is, but anything that has a home thread isn't.
+
+Compared to a `cross_thread_watchable_variable_t` per thread, this keeps one copy of the
+value instead of one per thread, and readers can hang on to a consistent version across
+blocking operations without copying it. */
+
+template<class value_t>
+class per_thread_snapshot_t : public home_thread_mixin_t {
+public:
+    explicit per_thread_snapshot_t(value_t initial_value)
+        : next_version(1),
+          slots(std::shared_ptr<const value_t>(
+            std::make_shared<const value_t>(std::move(initial_value)))) { }
+
+    /* The current value as seen from the calling thread. */
+    std::shared_ptr<const value_t> get() {
+        return slots.get()->snapshot.get_ref();
+    }
+
+    /* Calls `read` on the current value, like `watchable_t::apply_read()`. */
+    template<class callable_t>
+    void apply_read(callable_t &&read) {
+        const std::shared_ptr<const value_t> value = get();
+        read(value.get());
+    }
+
+    /* Blocks until every thread sees `new_value` or a value that was published after
+    it. */
+    void publish(value_t new_value) {
+        assert_thread();
+        const uint64_t version = next_version++;
+        const std::shared_ptr<const value_t> ptr =
+            std::make_shared<const value_t>(std::move(new_value));
+        pmap(get_num_threads(), [&](int thread) {
+            on_thread_t thread_switcher((threadnum_t(thread)));
+            slot_t *slot = slots.get();
+            /* Two `publish()` calls can overlap if the first one blocks; don't let the
+            older of them overwrite the newer value. */
+            if (slot->version < version) {
+                slot->version = version;
+                slot->snapshot.set_value_no_equals(ptr);
+            }
+        });
+    }
+
+    /* Waits until `fun` returns `true` for the current value as seen from the calling
+    thread. This is how a writer waits for its change to become visible here. */
+    template<class callable_t>
+    void run_until_satisfied(const callable_t &fun, signal_t *interruptor)
+            THROWS_ONLY(interrupted_exc_t) {
+        slots.get()->snapshot.get_watchable()->run_until_satisfied(
+            [&](const std::shared_ptr<const value_t> &value) -> bool {
+                return fun(*value);
+            },
+            interruptor);
+    }
+
+private:
+    struct slot_t {
+        explicit slot_t(const std::shared_ptr<const value_t> &initial)
+            : version(0), snapshot(initial) { }
+        uint64_t version;
+        watchable_variable_t<std::shared_ptr<const value_t> > snapshot;
+    };
+
+    uint64_t next_version;
+    one_per_thread_t<slot_t> slots;
+
+    DISABLE_COPYING(per_thread_snapshot_t);
+};
+
+#endif  // CONCURRENCY_PER_THREAD_SNAPSHOT_HPP_
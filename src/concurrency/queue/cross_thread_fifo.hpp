@@ -0,0 +1,232 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#ifndef CONCURRENCY_QUEUE_CROSS_THREAD_FIFO_HPP_
+#define CONCURRENCY_QUEUE_CROSS_THREAD_FIFO_HPP_
+
+#include <stdint.h>
+
+#include <atomic>
+#include <list>
+
+#include "arch/runtime/coroutines.hpp"
+#include "arch/runtime/runtime.hpp"
+#include "arch/runtime/runtime_utils.hpp"
+#include "concurrency/cache_line_padded.hpp"
+#include "concurrency/cond_var.hpp"
+#include "concurrency/cross_thread_signal.hpp"
+#include "concurrency/interruptor.hpp"
+#include "concurrency/queue/passive_producer.hpp"
+#include "containers/scoped.hpp"
+
+/* `mpmc_bounded_queue_t` is a fixed-size ring buffer that any number of threads can
+push to and pop from at the same time without taking a lock. Every cell carries a
+sequence number that says whether it's ready to be written or to be read for the current
+lap around the ring, so producers and consumers only contend on the position counter
+they're advancing.
+
+`capacity` must be a power of two. `value_t` must be default-constructible; popped cells
+are reset to `value_t()` so they don't hold on to whatever the value refers to. */
+template<class value_t>
+class mpmc_bounded_queue_t {
+public:
+    explicit mpmc_bounded_queue_t(size_t _capacity)
+        : cells(_capacity), mask(_capacity - 1) {
+        guarantee(_capacity >= 2 && (_capacity & mask) == 0,
+                  "mpmc_bounded_queue_t capacity must be a power of two");
+        for (size_t i = 0; i < _capacity; ++i) {
+            cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+        enqueue_pos.value.store(0, std::memory_order_relaxed);
+        dequeue_pos.value.store(0, std::memory_order_relaxed);
+    }
+
+    /* Returns `false` if the queue is full. */
+    bool try_push(const value_t &value) {
+        size_t pos = enqueue_pos.value.load(std::memory_order_relaxed);
+        cell_t *cell;
+        for (;;) {
+            cell = &cells[pos & mask];
+            const size_t seq = cell->sequence.load(std::memory_order_acquire);
+            const intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+            if (diff == 0) {
+                if (enqueue_pos.value.compare_exchange_weak(
+                        pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = enqueue_pos.value.load(std::memory_order_relaxed);
+            }
+        }
+        cell->value = value;
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    /* Returns `false` if the queue is empty, or if the oldest value has been claimed by
+    a producer that hasn't finished writing it yet. */
+    bool try_pop(value_t *out) {
+        size_t pos = dequeue_pos.value.load(std::memory_order_relaxed);
+        cell_t *cell;
+        for (;;) {
+            cell = &cells[pos & mask];
+            const size_t seq = cell->sequence.load(std::memory_order_acquire);
+            const intptr_t diff =
+                static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+            if (diff == 0) {
+                if (dequeue_pos.value.compare_exchange_weak(
+                        pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = dequeue_pos.value.load(std::memory_order_relaxed);
+            }
+        }
+        *out = std::move(cell->value);
+        cell->value = value_t();
+        cell->sequence.store(pos + mask + 1, std::memory_order_release);
+        return true;
+    }
+
+    size_t capacity() const {
+        return mask + 1;
+    }
+
+private:
+    struct cell_t {
+        std::atomic<size_t> sequence;
+        value_t value;
+    };
+
+    scoped_array_t<cell_t> cells;
+    const size_t mask;
+    cache_line_padded_t<std::atomic<size_t> > enqueue_pos;
+    cache_line_padded_t<std::atomic<size_t> > dequeue_pos;
+
+    DISABLE_COPYING(mpmc_bounded_queue_t);
+};
+
+/* `cross_thread_fifo_queue_t` is a `passive_producer_t` that can be pushed to from any
+thread. Unlike `limited_fifo_queue_t` and `unlimited_fifo_queue_t`, producers on other
+threads don't have to switch to the queue's home thread to push; they write into an
+`mpmc_bounded_queue_t` and, if the consumer doesn't already know that there's data, send
+its thread a single message. Only producers that find the queue full go to the home
+thread, to wait there until a consumer makes room.
+
+The consumer side (usually a `coro_pool_t`) must run on the home thread, as with any
+`passive_producer_t`. Stop all producers before destroying the queue. */
+template<class value_t>
+class cross_thread_fifo_queue_t :
+    public home_thread_mixin_t,
+    public passive_producer_t<value_t>,
+    private linux_thread_message_t {
+public:
+    explicit cross_thread_fifo_queue_t(size_t _capacity)
+        : passive_producer_t<value_t>(&available_control),
+          ring(_capacity),
+          size(0),
+          wakeup_pending(false) { }
+
+    ~cross_thread_fifo_queue_t() {
+        assert_thread();
+        /* A producer's wakeup message may still be on its way to us. */
+        while (wakeup_pending.load()) {
+            coro_t::yield();
+        }
+        guarantee(full_waiters.empty());
+    }
+
+    /* May be called on any thread. Returns `false` without blocking if the queue is
+    full. */
+    bool try_push(const value_t &value) {
+        if (!ring.try_push(value)) {
+            return false;
+        }
+        notify_consumer();
+        return true;
+    }
+
+    /* May be called on any thread. Blocks while the queue is full. */
+    void push(const value_t &value, signal_t *interruptor)
+            THROWS_ONLY(interrupted_exc_t) {
+        if (try_push(value)) {
+            return;
+        }
+        cross_thread_signal_t interruptor_on_home(interruptor, home_thread());
+        on_thread_t thread_switcher(home_thread());
+        while (!ring.try_push(value)) {
+            cond_t space_available;
+            auto it = full_waiters.insert(full_waiters.end(), &space_available);
+            try {
+                wait_interruptible(&space_available, &interruptor_on_home);
+            } catch (const interrupted_exc_t &) {
+                if (space_available.is_pulsed()) {
+                    /* We were already woken up, so pass the free slot on. */
+                    wake_one_producer();
+                } else {
+                    full_waiters.erase(it);
+                }
+                throw;
+            }
+        }
+        notify_consumer();
+    }
+
+    size_t capacity() const {
+        return ring.capacity();
+    }
+
+private:
+    value_t produce_next_value() {
+        assert_thread();
+        value_t value;
+        /* `size` only counts values that have been completely written, but the oldest
+        cell may belong to a producer that claimed it first and is still writing it.
+        That's a handful of instructions on the producer's side, so just retry. */
+        while (!ring.try_pop(&value)) { }
+        size.value.fetch_sub(1);
+        available_control.set_available(size.value.load() > 0);
+        wake_one_producer();
+        return value;
+    }
+
+    void notify_consumer() {
+        size.value.fetch_add(1);
+        if (get_thread_id() == home_thread()) {
+            available_control.set_available(true);
+        } else if (!wakeup_pending.exchange(true)) {
+            DEBUG_VAR bool on_home = continue_on_thread(home_thread(), this);
+            rassert(!on_home);
+        }
+    }
+
+    void on_thread_switch() {
+        assert_thread();
+        /* Clear the flag before looking at `size`, so a producer that pushes after we
+        look sends a new message. */
+        wakeup_pending.store(false);
+        available_control.set_available(size.value.load() > 0);
+    }
+
+    void wake_one_producer() {
+        if (!full_waiters.empty()) {
+            cond_t *waiter = full_waiters.front();
+            full_waiters.pop_front();
+            waiter->pulse();
+        }
+    }
+
+    availability_control_t available_control;
+    mpmc_bounded_queue_t<value_t> ring;
+    cache_line_padded_t<std::atomic<size_t> > size;
+    std::atomic<bool> wakeup_pending;
+
+    /* Producers that are waiting on the home thread for the queue to have room. */
+    std::list<cond_t *> full_waiters;
+
+    DISABLE_COPYING(cross_thread_fifo_queue_t);
+};
+
+#endif /* CONCURRENCY_QUEUE_CROSS_THREAD_FIFO_HPP_ */
@@ -13,6 +13,7 @@
 #include "containers/archive/vector_stream.hpp"
 #include "containers/disk_backed_queue.hpp"
 #include "paths.hpp"
+#include "perfmon/memory.hpp"
 
 /* `disk_backed_queue_t` can't be used directly as a `passive_producer_t`
 because its `pop()` method can sometimes block, and `passive_producer_t`'s
@@ -33,6 +34,7 @@ public:
             int64_t memory_queue_bytes) :
         passive_producer_t<T>(&available_control),
         memory_queue_free_space(memory_queue_bytes),
+        memory_queue_memory(memory_tag_t::disk_backed_queues),
         notify_when_room_in_memory_queue(nullptr),
         items_in_queue(0),
         io_backender(_io_backender),
@@ -69,6 +71,7 @@ public:
                     &disk_backed_queue_wrapper_t<T>::copy_from_disk_queue_to_memory_queue,
                     this, auto_drainer_t::lock_t(&drainer)));
             } else {
+                memory_queue_memory.set_size(memory_queue_memory.size() + wm.size());
                 memory_queue.emplace_back(std::move(wm));
                 available_control.set_available(true);
             }
@@ -87,6 +90,7 @@ private:
         write_message_t wm(std::move(memory_queue.front()));
         memory_queue.pop_front();
         memory_queue_free_space += wm.size();
+        memory_queue_memory.set_size(memory_queue_memory.size() - wm.size());
         items_in_queue--;
         if (memory_queue.empty()) {
             available_control.set_available(false);
@@ -94,18 +98,8 @@ private:
         if (notify_when_room_in_memory_queue != nullptr) {
             notify_when_room_in_memory_queue->pulse_if_not_already_pulsed();
         }
-        // TODO: This does some unnecessary copying.
-        vector_stream_t stream;
-        stream.reserve(wm.size());
-        int res = send_write_message(&stream, &wm);
-        guarantee(res == 0);
-        std::vector<char> data;
-        stream.swap(&data);
-        vector_read_stream_t rstream(std::move(data));
         T value;
-        archive_result_t dres =
-            deserialize<cluster_version_t::LATEST_OVERALL>(&rstream, &value);
-        guarantee_deserialization(dres, "disk backed queue wrapper");
+        deserialize_from_write_message(wm, &value);
         return value;
     }
 
@@ -133,6 +127,7 @@ private:
                     wait_interruptible(&cond, keepalive.get_drain_signal());
                 }
                 memory_queue_free_space -= wm.size();
+                memory_queue_memory.set_size(memory_queue_memory.size() + wm.size());
                 memory_queue.emplace_back(std::move(wm));
                 available_control.set_available(true);
             }
@@ -147,6 +142,8 @@ private:
     std::list<write_message_t> memory_queue;
     // Note that `memory_queue_free_space` can sometimes be negative
     int64_t memory_queue_free_space;
+    // The size of the messages in `memory_queue`.
+    tracked_memory_t memory_queue_memory;
     cond_t *notify_when_room_in_memory_queue;
     size_t items_in_queue;
     auto_drainer_t drainer;
@@ -18,6 +18,15 @@ wait_any_t::~wait_any_t() {
 
 void wait_any_t::add(const signal_t *s) {
     rassert(s);
+    // Once we're pulsed, there's nothing left to watch for. Signals are often pulsed
+    // already, and then we don't need a subscription either.
+    if (is_pulsed()) {
+        return;
+    }
+    if (s->is_pulsed()) {
+        pulse();
+        return;
+    }
     wait_any_subscription_t *sub;
 
     // Use preallocated subscriptions, if possible, to save on dynamic memory usage
@@ -96,6 +96,25 @@
 // 0 = minimal priority
 #define SINDEX_POST_CONSTRUCTION_CACHE_PRIORITY   5
 
+// The cache priority of the reads that warm up a cache after a restart, and how many
+// of the most recently used blocks it reads at a time.
+#define CACHE_WARM_UP_CACHE_PRIORITY              20
+#define CACHE_WARM_UP_BATCH_BLOCKS                1024
+
+// How often a cache records which blocks it has in memory, for warming up after a
+// restart.
+#define CACHE_WARM_UP_SAVE_INTERVAL_MS            (5 * 60 * 1000)
+
+// How long a full cache that is warming up waits for the balancer to give it more
+// memory, before it stops warming up.
+#define CACHE_WARM_UP_BALANCER_WAIT_MS            2000
+
+// How many flushes a page cache runs at a time.  The txn's that become ready to flush
+// while this many are running get written together, in one flush, once one of them
+// is done.  With two, one flush can write its blocks while the other one waits for
+// its index write.
+#define PAGE_CACHE_MAX_ACTIVE_FLUSHES             2
+
 // Size of the buffer used to perform IO operations (in bytes).
 #define IO_BUFFER_SIZE                            (4 * KILOBYTE)
 
@@ -105,6 +124,68 @@
 // Size of each btree node (in bytes) on disk
 #define DEFAULT_BTREE_BLOCK_SIZE                  (4 * KILOBYTE)
 
+// How many children of an internal node a read traversal of the btree loads ahead of
+// the child it's currently in, once it has moved past the first child.
+#define BTREE_TRAVERSAL_READ_AHEAD_CHILDREN       8
+
+// How often a store compacts the cold leaves of one piece of its primary btree (see
+// `btree_compact_cold_leaves()`), and how deep in the btree the boundaries between the
+// pieces are. A leaf counts as cold once nothing has written to it since the store
+// moved on to the previous piece.
+#define COLD_LEAF_COMPACTION_INTERVAL_MS          (60 * 1000)
+#define COLD_LEAF_COMPACTION_PIECE_DEPTH          2
+
+// How many subranges of a range read are traversed at the same time.  The root's
+// children are divided between them, so that the subranges load their blocks while
+// the ones before them are processed.
+#define BTREE_SCAN_CONCURRENCY                    4
+
+// How many tables are loaded at the same time when the server starts up.  Each table
+// opens its files and starts its stores on the threads that were allocated to it, so
+// loading several at once keeps the disks and the threads busy.
+#define TABLE_STARTUP_CONCURRENCY                 16
+
+// How often the primary replica of a table with a TTL looks for expired rows, how many
+// rows each of its writes deletes at most, and how long it waits between those writes
+// when there are more rows to delete. This bounds the load that expiring rows puts
+// on the cluster to about TTL_SWEEP_MAX_ROWS_PER_WRITE deletes per
+// TTL_SWEEP_WRITE_DELAY_MS for each shard.
+#define TTL_SWEEP_INTERVAL_MS                     1000
+#define TTL_SWEEP_MAX_ROWS_PER_WRITE              256
+#define TTL_SWEEP_WRITE_DELAY_MS                  10
+
+// How old the stats that reading all of `rethinkdb.stats` returns may be. Every server
+// gets asked for its stats at most this often, however many clients and changefeeds
+// read the table; changefeeds on it are updated at the same rate.
+#define STATS_TABLE_MAX_STALENESS_MS              1000
+
+// How many log messages may wait to be written to the log file. Messages logged while
+// this many are already waiting are dropped, and the number of dropped messages gets
+// logged instead once the log file has caught up.
+#define LOG_WRITER_MAX_PENDING_MESSAGES           1024
+
+// Admission control of driver queries (see `admission_controller_t`): a thread counts
+// as overloaded once queries have been waiting longer than
+// ADMISSION_QUEUE_DELAY_TARGET_MS to start for ADMISSION_INTERVAL_MS. How many queries
+// may run at once on a thread starts at ADMISSION_INITIAL_CONCURRENCY and stays
+// between the minimum and the maximum; at most ADMISSION_MAX_WAITING_QUERIES wait.
+#define ADMISSION_QUEUE_DELAY_TARGET_MS           5
+#define ADMISSION_INTERVAL_MS                     100
+#define ADMISSION_INITIAL_CONCURRENCY             64
+#define ADMISSION_MIN_CONCURRENCY                 4
+#define ADMISSION_MAX_CONCURRENCY                 1024
+#define ADMISSION_MAX_WAITING_QUERIES             1024
+
+// A store stops keeping the counts of the values of a secondary index up to date (see
+// `sindex_count_view_t`) once the index has more than this many distinct values.
+#define SINDEX_COUNT_VIEW_MAX_GROUPS              100000
+
+// How many read results a store keeps for queries that ask for the `result_cache`
+// (see `read_result_cache_t`), and how large (serialized, in bytes) a result may be.
+// Every write to the store checks all of the entries, so there shouldn't be too many.
+#define READ_RESULT_CACHE_MAX_ENTRIES             256
+#define READ_RESULT_CACHE_MAX_RESULT_SIZE         (64 * KILOBYTE)
+
 // Size of each extent (in bytes)
 // This should not be too small, or garbage collection will become
 // inefficient (especially on rotational drives).
@@ -180,6 +261,16 @@
 #define COROUTINE_STACK_SIZE                      131072
 #endif
 
+// A finished coroutine that used more than this much of its stack gives the rest of
+// its stack's pages back to the operating system before the stack gets reused, so
+// that a long-lived coroutine doesn't hold on to pages that a previous one touched.
+#define COROUTINE_STACK_RETAINED_SIZE             (32 * KILOBYTE)
+
+// How long a coroutine may keep running before `coro_t::maybe_yield()` yields, and how
+// many calls to `maybe_yield()` share one look at the clock.
+#define COROUTINE_YIELD_BUDGET_MS                 5
+#define COROUTINE_YIELD_CLOCK_CHECK_INTERVAL      64
+
 
 /**
  * Message scheduler configuration
@@ -210,13 +301,21 @@
 // 2^(MESSAGE_SCHEDULER_MAX_PRIORITY - MESSAGE_SCHEDULER_MIN_PRIORITY + 1)
 #define MESSAGE_SCHEDULER_GRANULARITY           32
 
+// Priorities of the scheduling classes.  Queries run at the default priority unless
+// they ask for one of the classes with the `scheduling_class` optarg.  Because of the
+// way the message scheduler works, each class gets about half the share of the class
+// above it while they are competing.
+#define CORO_PRIORITY_INTERACTIVE               1
+#define CORO_PRIORITY_BATCH                     (-1)
+#define CORO_PRIORITY_BACKGROUND                (-2)
+
 // Priorities for specific tasks
-#define CORO_PRIORITY_SINDEX_CONSTRUCTION       (-2)
-#define CORO_PRIORITY_BACKFILL_SENDER           (-2)
-#define CORO_PRIORITY_BACKFILL_RECEIVER         (-2)
-#define CORO_PRIORITY_RESET_DATA                (-2)
-#define CORO_PRIORITY_DIRECTORY_CHANGES         (-2)
-#define CORO_PRIORITY_LBA_GC                    (-2)
+#define CORO_PRIORITY_SINDEX_CONSTRUCTION       CORO_PRIORITY_BACKGROUND
+#define CORO_PRIORITY_BACKFILL_SENDER           CORO_PRIORITY_BACKGROUND
+#define CORO_PRIORITY_BACKFILL_RECEIVER         CORO_PRIORITY_BACKGROUND
+#define CORO_PRIORITY_RESET_DATA                CORO_PRIORITY_BACKGROUND
+#define CORO_PRIORITY_DIRECTORY_CHANGES         CORO_PRIORITY_BACKGROUND
+#define CORO_PRIORITY_LBA_GC                    CORO_PRIORITY_BACKGROUND
 
 #endif  // CONFIG_ARGS_HPP_
 
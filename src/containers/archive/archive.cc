@@ -10,8 +10,10 @@
 #endif
 
 #include <algorithm>
+#include <limits>
 
 #include "containers/archive/versioned.hpp"
+#include "containers/shared_buffer.hpp"
 #include "containers/uuid.hpp"
 #include "rpc/serialize_macros.hpp"
 
@@ -34,7 +36,7 @@ const char *archive_result_as_str(archive_result_t archive_result) {
     }
 }
 
-int64_t force_read(read_stream_t *s, void *p, int64_t n) {
+int64_t force_read_slow(read_stream_t *s, void *p, int64_t n) {
     rassert(n >= 0);
 
     char *chp = static_cast<char *>(p);
@@ -65,9 +67,17 @@ write_message_t::~write_message_t() {
     }
 }
 
-void write_message_t::append(const void *p, int64_t n) {
+write_buffer_t::~write_buffer_t() {
+    if (external_buf != nullptr) {
+        counted_release(external_buf);
+    }
+}
+
+void write_message_t::append_slow(const void *p, int64_t n) {
     while (n > 0) {
-        if (buffers_.empty() || buffers_.tail()->size == write_buffer_t::DATA_SIZE) {
+        if (buffers_.empty()
+            || buffers_.tail()->external_data != nullptr
+            || buffers_.tail()->size == write_buffer_t::DATA_SIZE) {
             buffers_.push_back(new write_buffer_t);
         }
 
@@ -81,6 +91,28 @@ void write_message_t::append(const void *p, int64_t n) {
     }
 }
 
+void write_message_t::append_shared(const shared_buf_t *buf, const void *p, int64_t n) {
+    /* A reference costs a buffer of its own, so it only saves anything over copying
+    if there is at least a buffer's worth of data. */
+    if (n < write_buffer_t::DATA_SIZE) {
+        append(p, n);
+        return;
+    }
+    rassert(static_cast<const char *>(p) >= buf->data());
+    rassert(static_cast<const char *>(p) + n <= buf->data() + buf->size());
+    rassert(n <= std::numeric_limits<int>::max());
+    write_buffer_t *b = new write_buffer_t;
+    counted_add_ref(buf);
+    b->external_buf = buf;
+    b->external_data = static_cast<const char *>(p);
+    b->size = static_cast<int>(n);
+    buffers_.push_back(b);
+}
+
+void write_message_t::append_and_clear(write_message_t *other) {
+    buffers_.append_and_clear(&other->buffers_);
+}
+
 size_t write_message_t::size() const {
     size_t ret = 0;
     for (write_buffer_t *h = buffers_.head(); h != nullptr; h = buffers_.next(h)) {
@@ -92,7 +124,7 @@ size_t write_message_t::size() const {
 int send_write_message(write_stream_t *s, const write_message_t *wm) {
     intrusive_list_t<write_buffer_t> *list = const_cast<write_message_t *>(wm)->unsafe_expose_buffers();
     for (write_buffer_t *p = list->head(); p; p = list->next(p)) {
-        int64_t res = s->write(p->data, p->size);
+        int64_t res = s->write(p->contents(), p->size);
         if (res == -1) {
             return -1;
         }
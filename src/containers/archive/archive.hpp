@@ -3,6 +3,7 @@
 #define CONTAINERS_ARCHIVE_ARCHIVE_HPP_
 
 #include <stdint.h>
+#include <string.h>
 
 #include <string>
 #include <type_traits>
@@ -12,6 +13,7 @@
 #include "version.hpp"
 #include "valgrind.hpp"
 
+class shared_buf_t;
 class uuid_u;
 
 struct fake_archive_exc_t {
@@ -22,12 +24,34 @@ struct fake_archive_exc_t {
 
 class read_stream_t {
 public:
-    read_stream_t() { }
+    read_stream_t() : direct_pos_(nullptr), direct_end_(nullptr) { }
     // Returns number of bytes read or 0 upon EOF, -1 upon error.
     virtual MUST_USE int64_t read(void *p, int64_t n) = 0;
+
+    /* Streams that read from a contiguous buffer in memory make the unread part of it
+    available through these, so that `force_read()` and `deserialize_varint_uint64()`
+    can take the bytes out of it without a virtual call for every primitive. For other
+    streams, `direct_bytes_left()` is always zero. */
+    int64_t direct_bytes_left() const { return direct_end_ - direct_pos_; }
+    const char *direct_pos() const { return direct_pos_; }
+    void direct_consume(int64_t n) {
+        rassert(n >= 0 && n <= direct_bytes_left());
+        direct_pos_ += n;
+    }
+
 protected:
     virtual ~read_stream_t() { }
+
+    // `read()` must consume from the same window.
+    void set_direct_window(const char *pos, const char *end) {
+        direct_pos_ = pos;
+        direct_end_ = end;
+    }
+
 private:
+    const char *direct_pos_;
+    const char *direct_end_;
+
     DISABLE_COPYING(read_stream_t);
 };
 
@@ -76,9 +100,18 @@ private:
         }                                                               \
     } while (0)
 
+MUST_USE int64_t force_read_slow(read_stream_t *s, void *p, int64_t n);
+
 // Returns the number of bytes written, or -1.  Returns a
 // non-negative value less than n upon EOF.
-MUST_USE int64_t force_read(read_stream_t *s, void *p, int64_t n);
+inline MUST_USE int64_t force_read(read_stream_t *s, void *p, int64_t n) {
+    if (n <= s->direct_bytes_left()) {
+        memcpy(p, s->direct_pos(), n);
+        s->direct_consume(n);
+        return n;
+    }
+    return force_read_slow(s, p, n);
+}
 
 class write_stream_t {
 public:
@@ -93,12 +126,23 @@ private:
 
 class write_buffer_t : public intrusive_list_node_t<write_buffer_t> {
 public:
-    write_buffer_t() : size(0) { }
+    write_buffer_t() : size(0), external_data(nullptr), external_buf(nullptr) { }
+    ~write_buffer_t();
+
+    // The `size` bytes that the buffer holds.
+    const char *contents() const {
+        return external_data != nullptr ? external_data : data;
+    }
 
     static const int DATA_SIZE = 4096;
     int size;
     char data[DATA_SIZE];
 
+    /* If `external_data` is set, the buffer refers to `size` bytes in the shared buffer
+    `external_buf`, which it holds a reference to, instead of holding them in `data`. */
+    const char *external_data;
+    const shared_buf_t *external_buf;
+
 private:
     DISABLE_COPYING(write_buffer_t);
 };
@@ -106,16 +150,35 @@ private:
 // A set of buffers in which an atomic message to be sent on a stream
 // gets built up.  (This way we don't flush after the first four bytes
 // sent to a stream, or buffer things and then forget to manually
-// flush.  This type can be extended to support holding references to
-// large buffers, to save copying.)  Generally speaking, you serialize
-// to a write_message_t, and then flush that to a write_stream_t.
+// flush.)  Large pieces of shared buffers can be added by reference, to
+// save copying them.  Generally speaking, you serialize to a
+// write_message_t, and then flush that to a write_stream_t.
 class write_message_t {
 public:
     write_message_t() { }
     explicit write_message_t(write_message_t &&) = default;
     ~write_message_t();
 
-    void append(const void *p, int64_t n);
+    void append(const void *p, int64_t n) {
+        // Serializers append a few bytes at a time, which almost always fit into the
+        // last buffer.
+        write_buffer_t *tail = buffers_.tail();
+        if (tail != nullptr && tail->external_data == nullptr
+            && n <= write_buffer_t::DATA_SIZE - tail->size) {
+            memcpy(tail->data + tail->size, p, n);
+            tail->size += n;
+            return;
+        }
+        append_slow(p, n);
+    }
+
+    /* Like `append()`, but if there are enough bytes to make it worthwhile, the message
+    keeps a reference to `buf` instead of copying them. `p` must point into `buf`. */
+    void append_shared(const shared_buf_t *buf, const void *p, int64_t n);
+
+    /* Moves the buffers of `other` to the end of this message, without copying them.
+    Leaves `other` empty. */
+    void append_and_clear(write_message_t *other);
 
     size_t size() const;
 
@@ -124,6 +187,8 @@ public:
 private:
     friend int send_write_message(write_stream_t *s, const write_message_t *wm);
 
+    void append_slow(const void *p, int64_t n);
+
     intrusive_list_t<write_buffer_t> buffers_;
 
     DISABLE_COPYING(write_message_t);
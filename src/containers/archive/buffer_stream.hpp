@@ -5,6 +5,7 @@
 #include <string.h>
 
 #include "containers/archive/archive.hpp"
+#include "containers/shared_buffer.hpp"
 
 // Reads from a buffer without taking ownership over it
 class buffer_read_stream_t : public read_stream_t {
@@ -16,33 +17,59 @@ public:
     // If we end up compiling with whole-program link-time optimization some day,
     // we can probably move this back to a .cc file.
 
+    // The whole buffer is the direct window (see `read_stream_t`), which also keeps
+    // track of our position.
     explicit buffer_read_stream_t(const char *buf, size_t size, int64_t offset = 0)
-        : pos_(offset), buf_(buf), size_(size) {
-        guarantee(pos_ >= 0);
-        guarantee(static_cast<uint64_t>(pos_) <= size_);
+        : buf_(buf) {
+        guarantee(offset >= 0);
+        guarantee(static_cast<uint64_t>(offset) <= size);
+        set_direct_window(buf + offset, buf + size);
     }
     virtual ~buffer_read_stream_t() { }
 
     virtual MUST_USE int64_t read(void *p, int64_t n) {
-        int64_t num_left = size_ - pos_;
+        int64_t num_left = direct_bytes_left();
         int64_t num_to_read = n < num_left ? n : num_left;
 
-        memcpy(p, buf_ + pos_, num_to_read);
+        memcpy(p, direct_pos(), num_to_read);
 
-        pos_ += num_to_read;
+        direct_consume(num_to_read);
 
         return num_to_read;
     }
 
-    int64_t tell() const { return pos_; }
+    int64_t tell() const { return direct_pos() - buf_; }
+
+    // Like `read()`, but doesn't copy the bytes anywhere.
+    MUST_USE int64_t skip(int64_t n) {
+        int64_t num_left = direct_bytes_left();
+        int64_t num_to_skip = n < num_left ? n : num_left;
+        direct_consume(num_to_skip);
+        return num_to_skip;
+    }
 
 private:
-    int64_t pos_;
     const char *buf_;
-    size_t size_;
 
     DISABLE_COPYING(buffer_read_stream_t);
 };
 
+/* Reads from a shared buffer and holds a reference to it. Deserializers can check for
+this type of stream and make what they deserialize point into the buffer rather than
+copying the bytes out of it; see `datum_deserialize()`. */
+class shared_buf_read_stream_t : public buffer_read_stream_t {
+public:
+    explicit shared_buf_read_stream_t(const shared_buf_ref_t<char> &buf)
+        : buffer_read_stream_t(buf.get(), buf.get_safety_boundary()), buf_(buf) { }
+
+    // Returns a reference to the data at `offset`, as returned by `tell()`.
+    shared_buf_ref_t<char> ref_at(int64_t offset) const {
+        return buf_.make_child(offset);
+    }
+
+private:
+    shared_buf_ref_t<char> buf_;
+};
+
 
 #endif  // CONTAINERS_ARCHIVE_BUFFER_STREAM_HPP_
@@ -58,6 +58,16 @@ int64_t tcp_conn_stream_t::write_buffered(const void *p, int64_t n) {
     }
 }
 
+bool tcp_conn_stream_t::write_buffers(const const_buffer_group_t *buffers) {
+    try {
+        cond_t non_closer;
+        conn_->write_buffers(buffers, &non_closer);
+        return true;
+    } catch (const tcp_conn_write_closed_exc_t &) {
+        return false;
+    }
+}
+
 bool tcp_conn_stream_t::flush_buffer() {
     try {
         cond_t non_closer;
@@ -147,6 +157,14 @@ int64_t keepalive_tcp_conn_stream_t::write_buffered(const void *p, int64_t n) {
     return tcp_conn_stream_t::write_buffered(p, n);
 }
 
+bool keepalive_tcp_conn_stream_t::write_buffers(const const_buffer_group_t *buffers) {
+    if (keepalive_callback != nullptr) {
+        keepalive_callback->keepalive_write();
+    }
+
+    return tcp_conn_stream_t::write_buffers(buffers);
+}
+
 bool keepalive_tcp_conn_stream_t::flush_buffer() {
     if (keepalive_callback != nullptr) {
         keepalive_callback->keepalive_write();
@@ -34,6 +34,27 @@ size_t serialize_varint_uint64_into_buf(const uint64_t value, uint8_t *buf_out);
 // If we end up compiling with whole-program link-time optimization some day,
 // we can probably move this back to the .cc file.
 inline archive_result_t deserialize_varint_uint64(read_stream_t *s, uint64_t *value_out) {
+    // If the stream is in memory, decode straight out of it. A varint has at most ten
+    // bytes; if there are fewer left, the loop below takes care of it.
+    if (s->direct_bytes_left() >= 10) {
+        const uint8_t *p = reinterpret_cast<const uint8_t *>(s->direct_pos());
+        uint64_t value = p[0] & 0x7f;
+        int i = 0;
+        while ((p[i] & 0x80) != 0) {
+            ++i;
+            if (i == 10) {
+                return archive_result_t::RANGE_ERROR;
+            }
+            value |= static_cast<uint64_t>(p[i] & 0x7f) << (7 * i);
+        }
+        if (i == 9 && p[9] > 1) {
+            return archive_result_t::RANGE_ERROR;
+        }
+        s->direct_consume(i + 1);
+        *value_out = value;
+        return archive_result_t::SUCCESS;
+    }
+
     uint64_t value = 0;
 
     int offset = 0;
@@ -23,30 +23,33 @@ void vector_stream_t::reserve(size_t reserve_size) {
 }
 
 vector_read_stream_t::vector_read_stream_t(std::vector<char> &&vector, int64_t offset)
-    : pos_(offset), vec_(std::move(vector)) {
-    guarantee(pos_ >= 0);
-    guarantee(static_cast<uint64_t>(pos_) <= vec_.size());
+    : vec_(std::move(vector)) {
+    reset_window(offset);
 }
 vector_read_stream_t::~vector_read_stream_t() { }
 
 int64_t vector_read_stream_t::read(void *p, int64_t n) {
-    int64_t num_left = vec_.size() - pos_;
+    int64_t num_left = direct_bytes_left();
     int64_t num_to_read = n < num_left ? n : num_left;
 
-    memcpy(p, vec_.data() + pos_, num_to_read);
+    memcpy(p, direct_pos(), num_to_read);
 
-    pos_ += num_to_read;
+    direct_consume(num_to_read);
 
     return num_to_read;
 }
 
 void vector_read_stream_t::swap(std::vector<char> *other_vec, int64_t *other_pos) {
     int64_t temp_pos = *other_pos;
-    *other_pos = pos_;
-    pos_ = temp_pos;
+    *other_pos = direct_pos() - vec_.data();
 
     vec_.swap(*other_vec);
 
-    guarantee(pos_ >= 0);
-    guarantee(static_cast<uint64_t>(pos_) <= vec_.size());
+    reset_window(temp_pos);
+}
+
+void vector_read_stream_t::reset_window(int64_t pos) {
+    guarantee(pos >= 0);
+    guarantee(static_cast<uint64_t>(pos) <= vec_.size());
+    set_direct_window(vec_.data() + pos, vec_.data() + vec_.size());
 }
@@ -35,7 +35,10 @@ public:
     void swap(std::vector<char> *other_vec, int64_t *other_pos);
 
 private:
-    int64_t pos_;
+    // Our position is kept by the direct window (see `read_stream_t`), which covers
+    // the unread part of `vec_`.
+    void reset_window(int64_t pos);
+
     std::vector<char> vec_;
 
     DISABLE_COPYING(vector_read_stream_t);
@@ -0,0 +1,80 @@
+// Copyright 2010-2015 RethinkDB, all rights reserved.
+#ifndef CONTAINERS_CHUNKED_STRING_BUFFER_HPP_
+#define CONTAINERS_CHUNKED_STRING_BUFFER_HPP_
+
+#include <vector>
+
+#include "config/args.hpp"
+#include "containers/scoped.hpp"
+#include "errors.hpp"
+
+/* chunked_string_buffer_t is an output stream for rapidjson writers, like
+`rapidjson::StringBuffer`, except that it keeps what gets written to it in a list of
+fixed-size chunks.  It never has to copy the characters it holds in order to grow,
+which `rapidjson::StringBuffer` does every time it runs out of space, and which
+briefly needs room for both copies. */
+
+class chunked_string_buffer_t {
+public:
+    typedef char Ch;
+
+    static const size_t DEFAULT_CHUNK_SIZE = 64 * KILOBYTE;
+
+    explicit chunked_string_buffer_t(size_t chunk_size = DEFAULT_CHUNK_SIZE)
+        : chunk_size_(chunk_size), last_chunk_size_(0) {
+        guarantee(chunk_size_ > 0);
+    }
+
+    void Put(char c) {
+        if (chunks_.empty() || last_chunk_size_ == chunk_size_) {
+            chunks_.emplace_back(chunk_size_);
+            last_chunk_size_ = 0;
+        }
+        chunks_.back()[last_chunk_size_] = c;
+        ++last_chunk_size_;
+    }
+
+    void Flush() { }
+
+    size_t GetSize() const {
+        return chunks_.empty()
+            ? 0
+            : (chunks_.size() - 1) * chunk_size_ + last_chunk_size_;
+    }
+
+    // Removes the last `count` characters.
+    void Pop(size_t count) {
+        guarantee(count <= GetSize());
+        while (count > 0) {
+            if (count < last_chunk_size_) {
+                last_chunk_size_ -= count;
+                return;
+            }
+            count -= last_chunk_size_;
+            chunks_.pop_back();
+            last_chunk_size_ = chunks_.empty() ? 0 : chunk_size_;
+        }
+    }
+
+    size_t num_chunks() const { return chunks_.size(); }
+
+    char *chunk_data(size_t i) {
+        rassert(i < chunks_.size());
+        return chunks_[i].data();
+    }
+
+    size_t chunk_size(size_t i) const {
+        rassert(i < chunks_.size());
+        return i + 1 == chunks_.size() ? last_chunk_size_ : chunk_size_;
+    }
+
+private:
+    const size_t chunk_size_;
+    std::vector<scoped_array_t<char> > chunks_;
+    // How many characters of the last chunk are in use.
+    size_t last_chunk_size_;
+
+    DISABLE_COPYING(chunked_string_buffer_t);
+};
+
+#endif  // CONTAINERS_CHUNKED_STRING_BUFFER_HPP_
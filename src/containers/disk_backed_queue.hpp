@@ -2,6 +2,7 @@
 #ifndef CONTAINERS_DISK_BACKED_QUEUE_HPP_
 #define CONTAINERS_DISK_BACKED_QUEUE_HPP_
 
+#include <deque>
 #include <string>
 #include <vector>
 
@@ -11,7 +12,9 @@
 #include "containers/archive/buffer_group_stream.hpp"
 #include "containers/archive/vector_stream.hpp"
 #include "containers/scoped.hpp"
+#include "paths.hpp"
 #include "perfmon/core.hpp"
+#include "perfmon/memory.hpp"
 #include "serializer/types.hpp"
 
 class cache_balancer_t;
@@ -20,7 +23,6 @@ class cache_t;
 class txn_t;
 class io_backender_t;
 class perfmon_collection_t;
-class serializer_filepath_t;
 
 ATTR_PACKED(struct queue_block_t {
     block_id_t next;
@@ -125,11 +127,44 @@ private:
     DISABLE_COPYING(copying_viewer_t);
 };
 
+// Deserializes a value that was serialized into `wm` using LATEST.
+template <class T>
+void deserialize_from_write_message(const write_message_t &wm, T *value_out) {
+    // TODO: This does some unnecessary copying.
+    vector_stream_t stream;
+    stream.reserve(wm.size());
+    int res = send_write_message(&stream, &wm);
+    guarantee(res == 0);
+    std::vector<char> data;
+    stream.swap(&data);
+    vector_read_stream_t rstream(std::move(data));
+    archive_result_t dres =
+        deserialize<cluster_version_t::LATEST_OVERALL>(&rstream, value_out);
+    guarantee_deserialization(dres, "disk backed queue");
+}
+
+/* If `memory_queue_bytes` is positive, `disk_backed_queue_t` keeps values in memory
+until their serialized size adds up to that many bytes, and only the overflow goes to
+disk. The serializer file isn't created until something has to be spilled, so a
+queue that only ever sees short bursts never touches the disk. With
+`memory_queue_bytes` of zero every value goes to disk, as it used to.
+
+Values come out in the order they were pushed. Everything in memory is older than
+everything on disk: once a value has been spilled, later values are spilled as well
+until the disk tier has been drained. */
 template <class T>
 class disk_backed_queue_t {
 public:
-    disk_backed_queue_t(io_backender_t *io_backender, const serializer_filepath_t& filename, perfmon_collection_t *stats_parent)
-        : internal_(io_backender, filename, stats_parent) { }
+    disk_backed_queue_t(io_backender_t *_io_backender,
+                        const serializer_filepath_t& _filename,
+                        perfmon_collection_t *_stats_parent,
+                        int64_t _memory_queue_bytes = 0)
+        : io_backender(_io_backender),
+          filename(_filename),
+          stats_parent(_stats_parent),
+          memory_queue_bytes(_memory_queue_bytes),
+          memory_queue_memory(memory_tag_t::disk_backed_queues),
+          disk_queue_size(0) { }
 
     void push(const T &t) {
         // TODO: There's an unnecessary copying of data here (which would require a
@@ -140,24 +175,67 @@ public:
         // queues are not intended to persist across restarts, so this
         // is safe.
         serialize<cluster_version_t::LATEST_OVERALL>(&wm, t);
-        internal_.push(wm);
+        const int64_t new_memory_size =
+            static_cast<int64_t>(memory_queue_memory.size() + wm.size());
+        if (disk_queue_size == 0 && new_memory_size <= memory_queue_bytes) {
+            memory_queue_memory.set_size(new_memory_size);
+            memory_queue.emplace_back(std::move(wm));
+            return;
+        }
+        // Count the value before we block, so that values pushed in the meantime go
+        // to disk behind it.
+        ++disk_queue_size;
+        mutex_t::acq_t acq(&disk_queue_mutex);
+        if (!disk_queue.has()) {
+            disk_queue.init(new internal_disk_backed_queue_t(
+                io_backender, filename, stats_parent));
+        }
+        disk_queue->push(wm);
     }
 
     void pop(T *out) {
-        deserializing_viewer_t<T> viewer(out);
-        internal_.pop(&viewer);
+        if (!memory_queue.empty()) {
+            write_message_t wm(std::move(memory_queue.front()));
+            memory_queue.pop_front();
+            memory_queue_memory.set_size(memory_queue_memory.size() - wm.size());
+            deserialize_from_write_message(wm, out);
+            return;
+        }
+        guarantee(disk_queue_size > 0);
+        {
+            // Wait for the pushes of any values we already counted.
+            mutex_t::acq_t acq(&disk_queue_mutex);
+            deserializing_viewer_t<T> viewer(out);
+            disk_queue->pop(&viewer);
+        }
+        // The serializer file stays around, so the next spill doesn't have to
+        // create it again.
+        --disk_queue_size;
     }
 
     bool empty() {
-        return internal_.empty();
+        return size() == 0;
     }
 
     int64_t size() {
-        return internal_.size();
+        return static_cast<int64_t>(memory_queue.size()) + disk_queue_size;
     }
 
 private:
-    internal_disk_backed_queue_t internal_;
+    io_backender_t *const io_backender;
+    const serializer_filepath_t filename;
+    perfmon_collection_t *const stats_parent;
+
+    const int64_t memory_queue_bytes;
+    std::deque<write_message_t> memory_queue;
+    // The size of the messages in `memory_queue`.
+    tracked_memory_t memory_queue_memory;
+
+    // Includes values that are still being pushed to `disk_queue`.
+    int64_t disk_queue_size;
+    mutex_t disk_queue_mutex;
+    scoped_ptr_t<internal_disk_backed_queue_t> disk_queue;
+
     DISABLE_COPYING(disk_backed_queue_t);
 };
 
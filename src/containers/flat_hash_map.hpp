@@ -0,0 +1,308 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#ifndef CONTAINERS_FLAT_HASH_MAP_HPP_
+#define CONTAINERS_FLAT_HASH_MAP_HPP_
+
+#include <stdint.h>
+#include <string.h>
+
+#include <functional>
+#include <iterator>
+#include <new>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include "errors.hpp"
+
+/* `flat_hash_map_t` is an open-addressing hash map for lookup-heavy maps on hot paths,
+where `std::map` spends its time walking the tree and missing the cache. All the entries
+live in one array. Next to it is an array with one control byte per slot: the byte says
+whether the slot is empty, was erased, or is full, and for a full slot it also holds seven
+bits of the key's hash. Probing (linearly) compares these bytes first, so it hardly ever
+has to look at a key that doesn't match.
+
+The interface is the subset of `std::map`'s that we use, but there are differences:
+  - The iteration order is arbitrary.
+  - Inserting can rehash, which moves the entries and invalidates all iterators, pointers
+    and references into the map. Keep a `scoped_ptr_t` in the map if something needs to
+    hold on to an entry.
+  - Erasing only invalidates iterators to the erased entry, and `erase(iterator)` returns
+    the next one, so it's safe to erase while iterating.
+*/
+template<class key_t, class mapped_t, class hash_t = std::hash<key_t>,
+         class equal_t = std::equal_to<key_t> >
+class flat_hash_map_t {
+public:
+    typedef std::pair<const key_t, mapped_t> value_type;
+
+    template<bool is_const>
+    class basic_iterator_t {
+    public:
+        typedef std::forward_iterator_tag iterator_category;
+        typedef typename flat_hash_map_t::value_type value_type;
+        typedef ptrdiff_t difference_type;
+        typedef typename std::conditional<
+            is_const, const value_type *, value_type *>::type pointer;
+        typedef typename std::conditional<
+            is_const, const value_type &, value_type &>::type reference;
+
+        basic_iterator_t() : map(nullptr), index(0) { }
+        // Converts an `iterator` to a `const_iterator`.
+        operator basic_iterator_t<true>() const {
+            return basic_iterator_t<true>(map, index);
+        }
+
+        reference operator*() const { return map->slots[index]; }
+        pointer operator->() const { return &map->slots[index]; }
+
+        basic_iterator_t &operator++() {
+            index = map->next_full(index + 1);
+            return *this;
+        }
+        basic_iterator_t operator++(int) {
+            basic_iterator_t old = *this;
+            ++*this;
+            return old;
+        }
+
+        bool operator==(const basic_iterator_t &other) const {
+            return map == other.map && index == other.index;
+        }
+        bool operator!=(const basic_iterator_t &other) const {
+            return !(*this == other);
+        }
+
+    private:
+        friend class flat_hash_map_t;
+        friend class basic_iterator_t<!is_const>;
+        typedef typename std::conditional<is_const,
+            const flat_hash_map_t *, flat_hash_map_t *>::type map_ptr_t;
+        basic_iterator_t(map_ptr_t _map, size_t _index) : map(_map), index(_index) { }
+        map_ptr_t map;
+        size_t index;
+    };
+
+    typedef basic_iterator_t<false> iterator;
+    typedef basic_iterator_t<true> const_iterator;
+
+    flat_hash_map_t()
+        : ctrl(nullptr), slots(nullptr), capacity(0), num_full(0), num_deleted(0) { }
+
+    ~flat_hash_map_t() {
+        clear();
+        free_storage();
+    }
+
+    size_t size() const { return num_full; }
+    bool empty() const { return num_full == 0; }
+
+    iterator begin() { return iterator(this, next_full(0)); }
+    iterator end() { return iterator(this, capacity); }
+    const_iterator begin() const { return const_iterator(this, next_full(0)); }
+    const_iterator end() const { return const_iterator(this, capacity); }
+
+    iterator find(const key_t &key) {
+        return iterator(this, find_index(key));
+    }
+    const_iterator find(const key_t &key) const {
+        return const_iterator(this, find_index(key));
+    }
+    size_t count(const key_t &key) const {
+        return find_index(key) == capacity ? 0 : 1;
+    }
+
+    /* Constructs the value from `args` if `key` isn't in the map yet. If it is, `args`
+    are left alone, so they may still be moved somewhere else. */
+    template<class... Args>
+    std::pair<iterator, bool> emplace(const key_t &key, Args &&... args) {
+        const size_t hash = mix(hasher(key));
+        size_t index = find_index_with_hash(key, hash);
+        if (index != capacity) {
+            return std::make_pair(iterator(this, index), false);
+        }
+        if ((num_full + num_deleted + 1) * 8 > capacity * 7) {
+            rehash(num_full + 1);
+        }
+        index = find_insert_slot(hash);
+        new (&slots[index]) value_type(
+            std::piecewise_construct,
+            std::forward_as_tuple(key),
+            std::forward_as_tuple(std::forward<Args>(args)...));
+        if (ctrl[index] == CTRL_DELETED) {
+            --num_deleted;
+        }
+        ctrl[index] = h2(hash);
+        ++num_full;
+        return std::make_pair(iterator(this, index), true);
+    }
+
+    std::pair<iterator, bool> insert(value_type &&value) {
+        return emplace(value.first, std::move(value.second));
+    }
+    std::pair<iterator, bool> insert(const value_type &value) {
+        return emplace(value.first, value.second);
+    }
+
+    mapped_t &operator[](const key_t &key) {
+        return emplace(key).first->second;
+    }
+
+    iterator erase(iterator it) {
+        rassert(it.map == this && it.index < capacity && is_full(ctrl[it.index]));
+        erase_index(it.index);
+        ++it;
+        return it;
+    }
+
+    size_t erase(const key_t &key) {
+        const size_t index = find_index(key);
+        if (index == capacity) {
+            return 0;
+        }
+        erase_index(index);
+        return 1;
+    }
+
+    void clear() {
+        for (size_t i = 0; i < capacity; ++i) {
+            if (is_full(ctrl[i])) {
+                slots[i].~value_type();
+            }
+            ctrl[i] = CTRL_EMPTY;
+        }
+        num_full = 0;
+        num_deleted = 0;
+    }
+
+    /* Makes room for `n` entries without rehashing. */
+    void reserve(size_t n) {
+        if (n * 8 > capacity * 7) {
+            rehash(n);
+        }
+    }
+
+private:
+    static const uint8_t CTRL_EMPTY = 0x80;
+    static const uint8_t CTRL_DELETED = 0xFE;
+    static const size_t MIN_CAPACITY = 16;
+
+    static bool is_full(uint8_t c) { return (c & 0x80) == 0; }
+
+    /* `std::hash` of an integer is often the integer itself, so mix the bits up before
+    splitting the hash into a starting slot and the seven bits we keep. */
+    static size_t mix(size_t hash) {
+        uint64_t h = static_cast<uint64_t>(hash) * 0x9E3779B97F4A7C15ull;
+        return static_cast<size_t>(h ^ (h >> 32));
+    }
+    static uint8_t h2(size_t hash) { return static_cast<uint8_t>(hash & 0x7F); }
+    size_t h1(size_t hash) const { return (hash >> 7) & (capacity - 1); }
+
+    size_t next_full(size_t index) const {
+        while (index < capacity && !is_full(ctrl[index])) {
+            ++index;
+        }
+        return index;
+    }
+
+    size_t find_index(const key_t &key) const {
+        return find_index_with_hash(key, mix(hasher(key)));
+    }
+
+    /* Returns `capacity` if `key` isn't in the map. */
+    size_t find_index_with_hash(const key_t &key, size_t hash) const {
+        if (capacity == 0) {
+            return 0;
+        }
+        const uint8_t tag = h2(hash);
+        size_t index = h1(hash);
+        for (size_t probes = 0; probes < capacity; ++probes) {
+            const uint8_t c = ctrl[index];
+            if (c == tag && key_equal(slots[index].first, key)) {
+                return index;
+            }
+            if (c == CTRL_EMPTY) {
+                break;
+            }
+            index = (index + 1) & (capacity - 1);
+        }
+        return capacity;
+    }
+
+    /* The first slot in `hash`'s probe sequence that isn't full. The caller has made
+    sure that one exists. */
+    size_t find_insert_slot(size_t hash) const {
+        size_t index = h1(hash);
+        while (is_full(ctrl[index])) {
+            index = (index + 1) & (capacity - 1);
+        }
+        return index;
+    }
+
+    void erase_index(size_t index) {
+        slots[index].~value_type();
+        --num_full;
+        /* If the next slot is empty, no probe sequence goes past this one, so it can be
+        empty again. Otherwise it has to stay a tombstone so lookups keep probing. */
+        if (ctrl[(index + 1) & (capacity - 1)] == CTRL_EMPTY) {
+            ctrl[index] = CTRL_EMPTY;
+        } else {
+            ctrl[index] = CTRL_DELETED;
+            ++num_deleted;
+        }
+    }
+
+    void rehash(size_t min_entries) {
+        size_t new_capacity = MIN_CAPACITY;
+        while (min_entries * 8 > new_capacity * 7) {
+            new_capacity *= 2;
+        }
+        /* If it's mostly tombstones that fill the table, rehashing at the same size
+        is enough. */
+        if (new_capacity < capacity) {
+            new_capacity = capacity;
+        }
+
+        uint8_t *old_ctrl = ctrl;
+        value_type *old_slots = slots;
+        const size_t old_capacity = capacity;
+
+        ctrl = new uint8_t[new_capacity];
+        memset(ctrl, CTRL_EMPTY, new_capacity);
+        slots = static_cast<value_type *>(
+            ::operator new(new_capacity * sizeof(value_type)));
+        capacity = new_capacity;
+        num_deleted = 0;
+
+        for (size_t i = 0; i < old_capacity; ++i) {
+            if (is_full(old_ctrl[i])) {
+                const size_t hash = mix(hasher(old_slots[i].first));
+                const size_t index = find_insert_slot(hash);
+                new (&slots[index]) value_type(std::move(old_slots[i]));
+                ctrl[index] = h2(hash);
+                old_slots[i].~value_type();
+            }
+        }
+        delete[] old_ctrl;
+        ::operator delete(old_slots);
+    }
+
+    void free_storage() {
+        delete[] ctrl;
+        ::operator delete(slots);
+        ctrl = nullptr;
+        slots = nullptr;
+        capacity = 0;
+    }
+
+    uint8_t *ctrl;
+    value_type *slots;
+    size_t capacity;
+    size_t num_full;
+    size_t num_deleted;
+    hash_t hasher;
+    equal_t key_equal;
+
+    DISABLE_COPYING(flat_hash_map_t);
+};
+
+#endif  // CONTAINERS_FLAT_HASH_MAP_HPP_
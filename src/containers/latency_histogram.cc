@@ -0,0 +1,56 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#include "containers/latency_histogram.hpp"
+
+#include <algorithm>
+
+#include "errors.hpp"
+
+void latency_histogram_t::add(int64_t nanos) {
+    int bucket;
+    if (nanos < 4) {
+        bucket = std::max<int64_t>(0, nanos);
+    } else {
+        const int exponent = 63 - __builtin_clzll(nanos);
+        bucket = std::min(NUM_BUCKETS - 1,
+            4 * exponent + static_cast<int>((nanos >> (exponent - 2)) & 3));
+    }
+    ++counts[bucket];
+}
+
+int64_t latency_histogram_t::bucket_upper_bound(int bucket) {
+    if (bucket < 8) {
+        return bucket + 1;
+    }
+    const int exponent = bucket / 4;
+    return (int64_t{5} + bucket % 4) << (exponent - 2);
+}
+
+void latency_histogram_t::merge(const latency_histogram_t &other) {
+    for (int i = 0; i < NUM_BUCKETS; ++i) {
+        counts[i] += other.counts[i];
+    }
+}
+
+uint64_t latency_histogram_t::num_samples() const {
+    uint64_t total = 0;
+    for (uint64_t count : counts) {
+        total += count;
+    }
+    return total;
+}
+
+int64_t latency_histogram_t::percentile_nanos(double fraction) const {
+    const uint64_t total = num_samples();
+    if (total == 0) {
+        return 0;
+    }
+    const uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(fraction * total));
+    uint64_t seen = 0;
+    for (int i = 0; i < NUM_BUCKETS; ++i) {
+        seen += counts[i];
+        if (seen >= rank) {
+            return bucket_upper_bound(i);
+        }
+    }
+    unreachable();
+}
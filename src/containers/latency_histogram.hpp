@@ -0,0 +1,37 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#ifndef CONTAINERS_LATENCY_HISTOGRAM_HPP_
+#define CONTAINERS_LATENCY_HISTOGRAM_HPP_
+
+#include <stdint.h>
+
+#include <array>
+
+/* `latency_histogram_t` counts latencies in buckets that split every power of two into
+four, so adding a sample is cheap and percentiles can be read off to within 25%. */
+class latency_histogram_t {
+public:
+    latency_histogram_t() {
+        counts.fill(0);
+    }
+
+    void add(int64_t nanos);
+    void merge(const latency_histogram_t &other);
+
+    uint64_t num_samples() const;
+
+    /* Returns an upper bound for the latency that a fraction `fraction` of the samples
+    didn't exceed, or 0 if there are no samples. */
+    int64_t percentile_nanos(double fraction) const;
+
+private:
+    /* Latencies in `[2^e, 2^(e+1))` nanoseconds go into buckets `4 * e` to `4 * e + 3`,
+    except that latencies of less than 4 nanoseconds get a bucket each. The last bucket
+    also holds everything that's even longer. */
+    static const int NUM_BUCKETS = 160;
+
+    static int64_t bucket_upper_bound(int bucket);
+
+    std::array<uint64_t, NUM_BUCKETS> counts;
+};
+
+#endif  // CONTAINERS_LATENCY_HISTOGRAM_HPP_
@@ -54,6 +54,25 @@ public:
         }
     }
 
+    // Removes every entry for which `pred(key, value)` returns true.
+    template <class Pred>
+    void erase_if(const Pred &pred) {
+        for (auto it = list_.begin(); it != list_.end();) {
+            if (pred(it->first, it->second)) {
+                DEBUG_VAR size_t count = map_.erase(it->first);
+                rassert(count == 1);
+                it = list_.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    void clear() {
+        map_.clear();
+        list_.clear();
+    }
+
 private:
     using list_iterator = typename std::list<std::pair<K, V>>::iterator;
 
@@ -0,0 +1,88 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#ifndef CONTAINERS_OBJECT_POOL_HPP_
+#define CONTAINERS_OBJECT_POOL_HPP_
+
+#include <array>
+#include <new>
+#include <utility>
+#include <vector>
+
+#include "arch/runtime/runtime.hpp"
+#include "concurrency/cache_line_padded.hpp"
+#include "config/args.hpp"
+#include "errors.hpp"
+
+/* `per_thread_object_pool_t` hands out `T`s whose memory is recycled through a free
+list on each thread, for short-lived objects that are allocated and freed all the time.
+`create()` and `destroy()` construct and destruct the object as `new T(...)` and
+`delete` would; only the memory is kept around, up to `max_free_per_thread` blocks per
+thread. Beyond that, or outside of a thread pool thread, they fall back to the global
+heap.
+
+An object may be destroyed on a different thread than it was created on; its memory then
+goes to that thread's free list. Because the memory comes from `::operator new()`, an
+object from the pool may also be freed with plain `delete` (for example by a
+`scoped_ptr_t`), which just bypasses the pool.
+
+Instances are meant to be long-lived, usually static. None of this is thread-safe in
+the preemptive sense; each thread only ever touches its own free list. */
+template<class T>
+class per_thread_object_pool_t {
+public:
+    explicit per_thread_object_pool_t(size_t _max_free_per_thread)
+        : max_free_per_thread(_max_free_per_thread) { }
+
+    ~per_thread_object_pool_t() {
+        for (auto &&free_list : free_lists) {
+            for (void *block : free_list.value) {
+                ::operator delete(block);
+            }
+        }
+    }
+
+    T *create() {
+        return new (take_block()) T;
+    }
+
+    template<class... Args>
+    T *create(Args &&... args) {
+        return new (take_block()) T(std::forward<Args>(args)...);
+    }
+
+    void destroy(T *object) {
+        rassert(object != nullptr);
+        object->~T();
+        std::vector<void *> *free_list = get_free_list();
+        if (free_list != nullptr && free_list->size() < max_free_per_thread) {
+            free_list->push_back(object);
+        } else {
+            ::operator delete(object);
+        }
+    }
+
+private:
+    void *take_block() {
+        std::vector<void *> *free_list = get_free_list();
+        if (free_list != nullptr && !free_list->empty()) {
+            void *block = free_list->back();
+            free_list->pop_back();
+            return block;
+        }
+        return ::operator new(sizeof(T));
+    }
+
+    std::vector<void *> *get_free_list() {
+        const int thread = get_thread_id().threadnum;
+        if (thread < 0 || thread >= MAX_THREADS) {
+            return nullptr;
+        }
+        return &free_lists[thread].value;
+    }
+
+    const size_t max_free_per_thread;
+    std::array<cache_line_padded_t<std::vector<void *> >, MAX_THREADS> free_lists;
+
+    DISABLE_COPYING(per_thread_object_pool_t);
+};
+
+#endif  // CONTAINERS_OBJECT_POOL_HPP_
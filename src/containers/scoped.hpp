@@ -301,6 +301,18 @@ public:
         swap(tmp);
     }
 
+    // The opposite of release.  `ptr` must be something `dealloc` can free.
+    void init(T *ptr) {
+        rassert(ptr_ == nullptr);
+        ptr_ = ptr;
+    }
+
+    MUST_USE T *release() {
+        T *tmp = ptr_;
+        ptr_ = nullptr;
+        return tmp;
+    }
+
 #if !CAN_ALIAS_TEMPLATES
 protected:
 #endif
@@ -3,18 +3,96 @@
 
 #include <stdlib.h>
 
+#include <array>
+#include <vector>
+
+#include "arch/runtime/runtime.hpp"
+#include "concurrency/cache_line_padded.hpp"
+#include "config/args.hpp"
+#include "math.hpp"
 #include "utils.hpp"
 
+namespace {
+
+/* Most datum strings are small, and queries create and drop lots of them.  Instead of
+going to the allocator for every one of them, each thread keeps some of the small
+buffers that get freed on it around, in free lists by size class.  The buffers don't
+belong to any thread; a buffer that was allocated on one thread can end up in the
+free lists of another. */
+const size_t SMALL_BUF_GRANULARITY = 16;
+const size_t MAX_SMALL_BUF_MEMORY_SIZE = 256;
+const size_t NUM_SMALL_BUF_CLASSES = MAX_SMALL_BUF_MEMORY_SIZE / SMALL_BUF_GRANULARITY;
+
+// How many buffers of each size class a thread keeps at most.
+const size_t MAX_FREE_SMALL_BUFS = 1024;
+
+struct small_buf_free_lists_t {
+    small_buf_free_lists_t() { }
+    ~small_buf_free_lists_t() {
+        for (size_t i = 0; i < NUM_SMALL_BUF_CLASSES; ++i) {
+            for (void *buf : lists[i]) {
+                ::free(buf);
+            }
+        }
+    }
+
+    std::vector<void *> lists[NUM_SMALL_BUF_CLASSES];
+
+    DISABLE_COPYING(small_buf_free_lists_t);
+};
+
+std::array<cache_line_padded_t<small_buf_free_lists_t>, MAX_THREADS>
+    small_buf_free_lists;
+
+// Returns the free list of the calling thread for buffers of `memory_size` bytes,
+// rounded up to the granularity, or null if they aren't kept.
+std::vector<void *> *small_buf_free_list(size_t memory_size) {
+    // Blocker pool threads and threads outside the thread pool don't keep any.
+    const int thread = get_thread_id().threadnum;
+    if (memory_size > MAX_SMALL_BUF_MEMORY_SIZE || thread < 0) {
+        return nullptr;
+    }
+    rassert(thread < MAX_THREADS);
+    const size_t size_class = (memory_size - 1) / SMALL_BUF_GRANULARITY;
+    return &small_buf_free_lists[thread].value.lists[size_class];
+}
+
+size_t allocated_memory_size(size_t memory_size) {
+    return memory_size <= MAX_SMALL_BUF_MEMORY_SIZE
+        ? ceil_aligned(memory_size, SMALL_BUF_GRANULARITY)
+        : memory_size;
+}
+
+}  // namespace
+
 counted_t<shared_buf_t> shared_buf_t::create(size_t size) {
     // This allocates size bytes for the data_ field (which is declared as char[1])
-    size_t memory_size = sizeof(shared_buf_t) + size - 1;
-    void *raw_result = ::rmalloc(memory_size);
+    size_t memory_size = allocated_memory_size(sizeof(shared_buf_t) + size - 1);
+    void *raw_result;
+    std::vector<void *> *list = small_buf_free_list(memory_size);
+    if (list != nullptr && !list->empty()) {
+        raw_result = list->back();
+        list->pop_back();
+    } else {
+        raw_result = ::rmalloc(memory_size);
+    }
     shared_buf_t *result = static_cast<shared_buf_t *>(raw_result);
     result->refcount_ = 0;
     result->size_ = size;
     return counted_t<shared_buf_t>(result);
 }
 
+void shared_buf_t::destroy(shared_buf_t *buf) {
+    const size_t memory_size =
+        allocated_memory_size(sizeof(shared_buf_t) + buf->size_ - 1);
+    std::vector<void *> *list = small_buf_free_list(memory_size);
+    if (list != nullptr && list->size() < MAX_FREE_SMALL_BUFS) {
+        list->push_back(buf);
+    } else {
+        delete buf;
+    }
+}
+
 void shared_buf_t::operator delete(void *p) {
     ::free(p);
 }
@@ -32,6 +32,9 @@ private:
     friend void counted_release(const shared_buf_t *p);
     friend intptr_t counted_use_count(const shared_buf_t *p);
 
+    // Frees `buf`, or keeps it around for reuse by `create()`.
+    static void destroy(shared_buf_t *buf);
+
     mutable std::atomic<intptr_t> refcount_;
 
     // The size of data_, for boundary checking.
@@ -87,6 +90,9 @@ public:
         return (buf->size() - offset) / sizeof(T);
     }
 
+    const counted_t<const shared_buf_t> &get_buf() const { return buf; }
+    size_t get_offset() const { return offset; }
+
 private:
     counted_t<const shared_buf_t> buf;
     size_t offset;
@@ -103,7 +109,7 @@ inline void counted_release(const shared_buf_t *p) {
     int64_t res = --(p->refcount_);
     rassert(res >= 0);
     if (res == 0) {
-        delete const_cast<shared_buf_t *>(p);
+        shared_buf_t::destroy(const_cast<shared_buf_t *>(p));
     }
 }
 
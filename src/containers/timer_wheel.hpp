@@ -0,0 +1,222 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#ifndef CONTAINERS_TIMER_WHEEL_HPP_
+#define CONTAINERS_TIMER_WHEEL_HPP_
+
+#include <stdint.h>
+
+#include <algorithm>
+#include <array>
+
+#include "containers/intrusive_list.hpp"
+#include "errors.hpp"
+
+template <class node_t>
+class timer_wheel_t;
+
+template <class node_t>
+class timer_wheel_node_t : public intrusive_list_node_t<node_t> {
+public:
+    timer_wheel_node_t() : expiry_tick(0), slot(nullptr) { }
+
+protected:
+    ~timer_wheel_node_t() {
+        rassert(slot == nullptr);
+    }
+
+private:
+    friend class timer_wheel_t<node_t>;
+    int64_t expiry_tick;
+    // The list in the wheel that the node is on, so that it can be removed in O(1).
+    intrusive_list_t<node_t> *slot;
+
+    DISABLE_COPYING(timer_wheel_node_t);
+};
+
+/* `timer_wheel_t` is a hierarchical timing wheel, an alternative to keeping timers in
+a priority queue.  Adding and removing a node are O(1).  Time is measured in integer
+"ticks", and the wheel only moves forward when `advance()` is called.
+
+Each of the `LEVELS` levels has `SLOTS` slots.  A slot of level 0 holds the nodes that
+expire on one particular tick, and a slot of level N holds the nodes that expire within
+a range of `SLOTS^N` ticks.  When the wheel reaches the start of such a range, the
+nodes in the slot are moved down to lower levels.  Nodes farther away than the top
+level can cover wait in its last slot and go around again. */
+template <class node_t>
+class timer_wheel_t {
+public:
+    explicit timer_wheel_t(int64_t current_tick)
+        : current_tick_(current_tick), size_(0) {
+        for (auto &level : occupied_) {
+            level.fill(0);
+        }
+    }
+
+    ~timer_wheel_t() {
+        rassert(empty());
+    }
+
+    bool empty() const {
+        return size_ == 0;
+    }
+
+    size_t size() const {
+        return size_;
+    }
+
+    int64_t current_tick() const {
+        return current_tick_;
+    }
+
+    // A node that expires on a tick that the wheel has already reached expires on the
+    // next one.
+    void add(node_t *node, int64_t expiry_tick) {
+        rassert(node->slot == nullptr);
+        node->expiry_tick = std::max(expiry_tick, current_tick_ + 1);
+        insert(node);
+        ++size_;
+    }
+
+    void remove(node_t *node) {
+        rassert(node->slot != nullptr);
+        unlink(node);
+        --size_;
+    }
+
+    /* Returns a tick no later than the earliest expiry tick of the nodes in the wheel,
+    and later than the current tick.  Calling `advance()` before then won't expire
+    anything.  Nodes that have already expired but haven't been taken out with
+    `pop_expired()` are not taken into account.  Must not be called if there are no
+    nodes besides those. */
+    int64_t next_interesting_tick() const {
+        rassert(size_ > expired_.size());
+        int64_t result = INT64_MAX;
+        for (int level = 0; level < LEVELS; ++level) {
+            const int shift = level * SLOT_BITS;
+            const int index = static_cast<int>((current_tick_ >> shift) & SLOT_MASK);
+            const int distance = distance_to_occupied_slot(level, index);
+            if (distance != 0) {
+                result = std::min(result,
+                                  ((current_tick_ >> shift) + distance) << shift);
+            }
+        }
+        rassert(result != INT64_MAX);
+        return result;
+    }
+
+    // Moves the wheel forward to `tick`.  The nodes that expire on or before `tick`
+    // can then be taken out with `pop_expired()`.
+    void advance(int64_t tick) {
+        while (current_tick_ < tick) {
+            if (size_ == expired_.size()) {
+                current_tick_ = tick;
+                break;
+            }
+            current_tick_ = std::min(tick, next_interesting_tick());
+            for (int level = LEVELS - 1; level > 0; --level) {
+                const int shift = level * SLOT_BITS;
+                if ((current_tick_ & ((int64_t{1} << shift) - 1)) == 0) {
+                    cascade(level,
+                            static_cast<int>((current_tick_ >> shift) & SLOT_MASK));
+                }
+            }
+            const int index = static_cast<int>(current_tick_ & SLOT_MASK);
+            intrusive_list_t<node_t> *expired_slot = &slots_[0][index];
+            for (node_t *node = expired_slot->head();
+                 node != nullptr;
+                 node = expired_slot->next(node)) {
+                rassert(node->expiry_tick == current_tick_);
+                node->slot = &expired_;
+            }
+            expired_.append_and_clear(expired_slot);
+            mark_empty(0, index);
+        }
+    }
+
+    // Returns the next node that has expired and removes it from the wheel, or
+    // `nullptr` if there are none.
+    node_t *pop_expired() {
+        node_t *node = expired_.head();
+        if (node != nullptr) {
+            remove(node);
+        }
+        return node;
+    }
+
+private:
+    static const int SLOT_BITS = 8;
+    static const int SLOTS = 1 << SLOT_BITS;
+    static const int64_t SLOT_MASK = SLOTS - 1;
+    static const int LEVELS = 4;
+    static const int WORD_BITS = 64;
+
+    void insert(node_t *node) {
+        const int64_t max_distance = (int64_t{1} << (LEVELS * SLOT_BITS)) - 1;
+        const int64_t slot_tick =
+            std::min(node->expiry_tick, current_tick_ + max_distance);
+        const int64_t distance = slot_tick - current_tick_;
+        rassert(distance >= 0);
+        int level = 0;
+        while (level < LEVELS - 1 && distance >> ((level + 1) * SLOT_BITS) != 0) {
+            ++level;
+        }
+        const int index =
+            static_cast<int>((slot_tick >> (level * SLOT_BITS)) & SLOT_MASK);
+        node->slot = &slots_[level][index];
+        node->slot->push_back(node);
+        occupied_[level][index / WORD_BITS] |= uint64_t{1} << (index % WORD_BITS);
+    }
+
+    void unlink(node_t *node) {
+        intrusive_list_t<node_t> *slot = node->slot;
+        slot->remove(node);
+        node->slot = nullptr;
+        if (slot != &expired_ && slot->empty()) {
+            for (int level = 0; level < LEVELS; ++level) {
+                if (slot >= slots_[level].data() && slot < slots_[level].data() + SLOTS) {
+                    mark_empty(level, static_cast<int>(slot - slots_[level].data()));
+                    break;
+                }
+            }
+        }
+    }
+
+    void cascade(int level, int index) {
+        intrusive_list_t<node_t> nodes;
+        nodes.append_and_clear(&slots_[level][index]);
+        mark_empty(level, index);
+        while (node_t *node = nodes.head()) {
+            nodes.remove(node);
+            insert(node);
+        }
+    }
+
+    void mark_empty(int level, int index) {
+        occupied_[level][index / WORD_BITS] &= ~(uint64_t{1} << (index % WORD_BITS));
+    }
+
+    // Returns how many slots past `index` the next occupied slot of `level` is, going
+    // around the wheel, between 1 and `SLOTS`.  Returns 0 if the level is empty.
+    int distance_to_occupied_slot(int level, int index) const {
+        for (int distance = 1; distance <= SLOTS; ) {
+            const int slot = (index + distance) & SLOT_MASK;
+            const uint64_t word =
+                occupied_[level][slot / WORD_BITS] >> (slot % WORD_BITS);
+            if (word != 0) {
+                return std::min(SLOTS, distance + __builtin_ctzll(word));
+            }
+            distance += WORD_BITS - slot % WORD_BITS;
+        }
+        return 0;
+    }
+
+    int64_t current_tick_;
+    size_t size_;
+    std::array<std::array<intrusive_list_t<node_t>, SLOTS>, LEVELS> slots_;
+    std::array<std::array<uint64_t, SLOTS / WORD_BITS>, LEVELS> occupied_;
+    // The nodes that `advance()` has found to be expired.
+    intrusive_list_t<node_t> expired_;
+
+    DISABLE_COPYING(timer_wheel_t);
+};
+
+#endif  // CONTAINERS_TIMER_WHEEL_HPP_
@@ -10,10 +10,19 @@
 #include <array>
 #include <stdexcept>
 
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <emmintrin.h>
+#define UUID_HAS_SSE2 1
+#else
+#define UUID_HAS_SSE2 0
+#endif
+
+#include "arch/runtime/runtime.hpp"
+#include "concurrency/cache_line_padded.hpp"
+#include "config/args.hpp"
 #include "containers/printf_buffer.hpp"
 #include "containers/name_string.hpp"
 #include "utils.hpp"
-#include "thread_local.hpp"
 
 // We keep the sha1 functions in this .cc file to avoid encouraging others from using it.
 namespace sha1 {
@@ -69,61 +78,132 @@ bool operator<(const uuid_u& x, const uuid_u& y) {
     return memcmp(x.data(), y.data(), uuid_u::static_size()) < 0;
 }
 
-TLS_with_init(bool, next_uuid_initialized, false);
-typedef std::array<uint8_t, uuid_u::kStaticSize> next_uuid_t;
-TLS_with_init(next_uuid_t, next_uuid, next_uuid_t{{0}});
-
-uuid_u get_and_increment_uuid() {
-    uuid_u result;
+namespace {
+
+/* Random UUIDs are cut out of a ChaCha20 (RFC 7539) keystream. Every thread has its own
+stream, keyed from the system's random source the first time the thread needs a UUID,
+and produces a few blocks of the keystream at a time. That's a lot cheaper than hashing
+a counter for every UUID, and it's still unpredictable. */
+class uuid_random_pool_t {
+public:
+    void take(uint8_t *out, size_t size) {
+        if (!keyed) {
+            init_key();
+        }
+        while (size > 0) {
+            if (position == sizeof(buffer)) {
+                refill();
+            }
+            size_t n = std::min(size, sizeof(buffer) - position);
+            memcpy(out, buffer + position, n);
+            // Don't leave around what we've handed out.
+            memset(buffer + position, 0, n);
+            position += n;
+            out += n;
+            size -= n;
+        }
+    }
 
-    next_uuid_t next_uuid = TLS_get_next_uuid();
+private:
+    static const size_t BLOCK_SIZE = 64;
+    static const size_t BLOCKS_PER_REFILL = 4;
 
-    // Copy over the next_uuid buffer
-    uint8_t *result_buffer = result.data();
-    memcpy(result_buffer, next_uuid.data(), uuid_u::static_size());
+    static uint32_t rotl(uint32_t v, int bits) {
+        return (v << bits) | (v >> (32 - bits));
+    }
 
-    // Increment the next_uuid buffer
-    bool carry = true;
-    for (size_t i = uuid_u::static_size(); carry && i > 0; --i) {
-        next_uuid[i - 1] = next_uuid[i - 1] + 1;
-        carry = (next_uuid[i - 1] == 0);
+    static void quarter_round(uint32_t *x, int a, int b, int c, int d) {
+        x[a] += x[b]; x[d] = rotl(x[d] ^ x[a], 16);
+        x[c] += x[d]; x[b] = rotl(x[b] ^ x[c], 12);
+        x[a] += x[b]; x[d] = rotl(x[d] ^ x[a], 8);
+        x[c] += x[d]; x[b] = rotl(x[b] ^ x[c], 7);
     }
-    TLS_set_next_uuid(next_uuid);
 
-    return result;
-}
+    void init_key() {
+        // "expand 32-byte k"
+        state[0] = 0x61707865;
+        state[1] = 0x3320646e;
+        state[2] = 0x79622d32;
+        state[3] = 0x6b206574;
+        // The key and the nonce.
+        system_random_bytes(&state[4], 8 * sizeof(uint32_t));
+        system_random_bytes(&state[13], 3 * sizeof(uint32_t));
+        state[12] = 0;
+        position = sizeof(buffer);
+        keyed = true;
+    }
 
-// TODO(sam):  Make sure this isn't messed up somehow.
-void hash_uuid(uuid_u *uuid) {
-    CT_ASSERT(20 >= uuid_u::kStaticSize);
-    uint8_t output_buffer[20];
+    void refill() {
+        for (size_t block = 0; block < BLOCKS_PER_REFILL; ++block) {
+            uint32_t x[16];
+            memcpy(x, state, sizeof(x));
+            for (int i = 0; i < 10; ++i) {
+                quarter_round(x, 0, 4, 8, 12);
+                quarter_round(x, 1, 5, 9, 13);
+                quarter_round(x, 2, 6, 10, 14);
+                quarter_round(x, 3, 7, 11, 15);
+                quarter_round(x, 0, 5, 10, 15);
+                quarter_round(x, 1, 6, 11, 12);
+                quarter_round(x, 2, 7, 8, 13);
+                quarter_round(x, 3, 4, 9, 14);
+            }
+            for (int i = 0; i < 16; ++i) {
+                x[i] += state[i];
+            }
+            memcpy(buffer + block * BLOCK_SIZE, x, BLOCK_SIZE);
+            // The block counter. Rolling it over would take 256 GB of UUIDs, so we
+            // just take a new key instead.
+            if (++state[12] == 0) {
+                system_random_bytes(&state[4], 8 * sizeof(uint32_t));
+            }
+        }
+        position = 0;
+    }
 
-    sha1::calc(uuid->data(), uuid_u::static_size(), output_buffer);
+    uint32_t state[16];
+    uint8_t buffer[BLOCK_SIZE * BLOCKS_PER_REFILL];
+    size_t position;
+    bool keyed;
+};
 
-    // Set some bits to obey standard for version 4 UUIDs.
-    output_buffer[6] = ((output_buffer[6] & 0x0f) | 0x40);
-    output_buffer[8] = ((output_buffer[8] & 0x3f) | 0x80);
+/* Static rather than `TLS` so that we don't copy the pool in and out on every call.
+It's zero-initialized, so every pool starts out unkeyed. */
+std::array<cache_line_padded_t<uuid_random_pool_t>, MAX_THREADS> uuid_random_pools;
 
-    // Copy the beginning of the hash into our uuid
-    memcpy(uuid->data(), output_buffer, uuid_u::static_size());
+void random_uuid_bytes(uint8_t *out, size_t size) {
+    const int thread = get_thread_id().threadnum;
+    if (thread >= 0 && thread < MAX_THREADS) {
+        uuid_random_pools[thread].value.take(out, size);
+    } else {
+        // This isn't a thread pool thread, so there's no pool for it.
+        system_random_bytes(out, size);
+    }
 }
 
-void initialize_dev_random_uuid() {
-    next_uuid_t next_uuid;
-    system_random_bytes(next_uuid.data(), uuid_u::static_size());
-    TLS_set_next_uuid(next_uuid);
+// Sets some bits to obey the standard for version 4 UUIDs.
+void set_version_4(uuid_u *uuid) {
+    uint8_t *data = uuid->data();
+    data[6] = ((data[6] & 0x0f) | 0x40);
+    data[8] = ((data[8] & 0x3f) | 0x80);
 }
 
+}  // namespace
+
 uuid_u generate_uuid() {
-    if (!TLS_get_next_uuid_initialized()) {
-        initialize_dev_random_uuid();
-        TLS_set_next_uuid_initialized(true);
-    }
-    uuid_u result = get_and_increment_uuid();
-    hash_uuid(&result);
+    uuid_u result;
+    random_uuid_bytes(result.data(), uuid_u::static_size());
+    set_version_4(&result);
     return result;
 }
 
+void generate_uuids(uuid_u *out, size_t count) {
+    CT_ASSERT(sizeof(uuid_u) == uuid_u::kStaticSize);
+    random_uuid_bytes(out->data(), count * uuid_u::static_size());
+    for (size_t i = 0; i < count; ++i) {
+        set_version_4(&out[i]);
+    }
+}
+
 uuid_u nil_uuid() {
     uuid_u ret;
     memset(ret.data(), 0, uuid_u::static_size());
@@ -134,49 +214,37 @@ void debug_print(printf_buffer_t *buf, const uuid_u& id) {
     buf->appendf("%s", uuid_to_str(id).c_str());
 }
 
-void push_hex(std::string *s, uint8_t byte) {
-    const char *buf = "0123456789abcdef";
-    s->push_back(buf[byte >> 4]);
-    s->push_back(buf[byte & 0x0f]);
-}
-
-std::string uuid_to_str(uuid_u id) {
-    const uint8_t *data = id.data();
+/* The hexadecimal digits of a UUID are grouped 8-4-4-4-12. These are the offsets of the
+groups in the string, and of the first digit of each group in the 32 digits without the
+hyphens. */
+static const size_t uuid_group_string_offsets[5] = { 0, 9, 14, 19, 24 };
+static const size_t uuid_group_digit_offsets[6] = { 0, 8, 12, 16, 20, 32 };
 
-    std::string ret;
-    ret.reserve(uuid_u::kStringSize);
-    size_t i = 0;
-    for (; i < 4; ++i) {
-        push_hex(&ret, data[i]);
-    }
-    ret.push_back('-');
-    for (; i < 6; ++i) {
-        push_hex(&ret, data[i]);
-    }
-    ret.push_back('-');
-    for (; i < 8; ++i) {
-        push_hex(&ret, data[i]);
-    }
-    ret.push_back('-');
-    for (; i < 10; ++i) {
-        push_hex(&ret, data[i]);
-    }
-    ret.push_back('-');
+// Writes the 32 lowercase hex digits of `data`.
+static void uuid_bytes_to_hex(const uint8_t *data, char *hex) {
     CT_ASSERT(uuid_u::kStaticSize == 16);  // This code just feels this assertion in its bones.
-    for (; i < uuid_u::kStaticSize; ++i) {
-        push_hex(&ret, data[i]);
+#if UUID_HAS_SSE2
+    const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data));
+    const __m128i low_nibble = _mm_set1_epi8(0x0f);
+    const __m128i high = _mm_and_si128(_mm_srli_epi16(bytes, 4), low_nibble);
+    const __m128i low = _mm_and_si128(bytes, low_nibble);
+    // Digits 0-9 map to '0'-'9', and 10-15 to 'a'-'f', which is 39 characters further.
+    const __m128i nine = _mm_set1_epi8(9);
+    const __m128i to_letter = _mm_set1_epi8('a' - '0' - 10);
+    const __m128i zero_char = _mm_set1_epi8('0');
+    __m128i digits[2] = { _mm_unpacklo_epi8(high, low), _mm_unpackhi_epi8(high, low) };
+    for (int i = 0; i < 2; ++i) {
+        const __m128i letters = _mm_and_si128(_mm_cmpgt_epi8(digits[i], nine), to_letter);
+        digits[i] = _mm_add_epi8(_mm_add_epi8(digits[i], zero_char), letters);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(hex + 16 * i), digits[i]);
     }
-
-    return ret;
-}
-
-uuid_u str_to_uuid(const std::string &uuid) {
-    uuid_u ret;
-    if (str_to_uuid(uuid, &ret)) {
-        return ret;
-    } else {
-        throw std::runtime_error("invalid uuid");  // Sigh.
+#else
+    const char *buf = "0123456789abcdef";
+    for (size_t i = 0; i < uuid_u::kStaticSize; ++i) {
+        hex[2 * i] = buf[data[i] >> 4];
+        hex[2 * i + 1] = buf[data[i] & 0x0f];
     }
+#endif
 }
 
 MUST_USE bool from_hexdigit(int ch, int *out) {
@@ -192,46 +260,98 @@ MUST_USE bool from_hexdigit(int ch, int *out) {
     return false;
 }
 
-MUST_USE bool str_to_uuid(const std::string &str, uuid_u *uuid) {
-    if (str.size() != uuid_u::kStaticSize * 2 + 4) {
-        return false;
+// Parses 32 hex digits, in either case, into `data`.
+static MUST_USE bool uuid_hex_to_bytes(const char *hex, uint8_t *data) {
+#if UUID_HAS_SSE2
+    // Characters outside of ASCII are negative as signed bytes, so they fail both
+    // range checks.
+    const __m128i before_zero = _mm_set1_epi8('0' - 1);
+    const __m128i after_nine = _mm_set1_epi8('9' + 1);
+    const __m128i before_a = _mm_set1_epi8('a' - 1);
+    const __m128i after_f = _mm_set1_epi8('f' + 1);
+    const __m128i lowercase_bit = _mm_set1_epi8(0x20);
+    __m128i values[2];
+    for (int i = 0; i < 2; ++i) {
+        const __m128i chars =
+            _mm_loadu_si128(reinterpret_cast<const __m128i *>(hex + 16 * i));
+        const __m128i is_digit = _mm_and_si128(_mm_cmpgt_epi8(chars, before_zero),
+                                               _mm_cmpgt_epi8(after_nine, chars));
+        const __m128i lower = _mm_or_si128(chars, lowercase_bit);
+        const __m128i is_letter = _mm_and_si128(_mm_cmpgt_epi8(lower, before_a),
+                                                _mm_cmpgt_epi8(after_f, lower));
+        if (_mm_movemask_epi8(_mm_or_si128(is_digit, is_letter)) != 0xFFFF) {
+            return false;
+        }
+        const __m128i digit_values =
+            _mm_and_si128(is_digit, _mm_sub_epi8(chars, _mm_set1_epi8('0')));
+        const __m128i letter_values =
+            _mm_and_si128(is_letter, _mm_sub_epi8(lower, _mm_set1_epi8('a' - 10)));
+        const __m128i nibbles = _mm_or_si128(digit_values, letter_values);
+        // Each 16-bit lane holds a high nibble in its low byte and a low nibble in its
+        // high byte; put them together in the low byte.
+        values[i] = _mm_or_si128(
+            _mm_slli_epi16(_mm_and_si128(nibbles, _mm_set1_epi16(0x00ff)), 4),
+            _mm_srli_epi16(nibbles, 8));
     }
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(data),
+                     _mm_packus_epi16(values[0], values[1]));
+    return true;
+#else
+    for (size_t i = 0; i < uuid_u::kStaticSize; ++i) {
+        int high, low;
+        if (!from_hexdigit(hex[2 * i], &high) || !from_hexdigit(hex[2 * i + 1], &low)) {
+            return false;
+        }
+        data[i] = ((high << 4) | low);
+    }
+    return true;
+#endif
+}
 
-    uint8_t *data = uuid->data();
+std::string uuid_to_str(uuid_u id) {
+    char hex[2 * uuid_u::kStaticSize];
+    uuid_bytes_to_hex(id.data(), hex);
 
-    size_t j = 0;
-    for (size_t i = 0; i < uuid_u::kStaticSize; ++i) {
-        // Uh oh.. a for/switch loop!
-        switch (i) {
-        case 4:
-        case 6:
-        case 8:
-        case 10:
-            rassert(j < uuid_u::kStringSize);
-            if (str[j] != '-') {
-                return false;
-            }
-            ++j;
-            // fall through
-        default: {
-            rassert(j < uuid_u::kStringSize);
-            int high;
-            if (!from_hexdigit(str[j], &high)) {
-                return false;
-            }
-            ++j;
-            rassert(j < uuid_u::kStringSize);
-            int low;
-            if (!from_hexdigit(str[j], &low)) {
-                return false;
-            }
-            ++j;
-            data[i] = ((high << 4) | low);
-        } break;
+    char buf[uuid_u::kStringSize];
+    for (size_t g = 0; g < 5; ++g) {
+        if (g > 0) {
+            buf[uuid_group_string_offsets[g] - 1] = '-';
         }
+        memcpy(buf + uuid_group_string_offsets[g], hex + uuid_group_digit_offsets[g],
+               uuid_group_digit_offsets[g + 1] - uuid_group_digit_offsets[g]);
+    }
+    return std::string(buf, uuid_u::kStringSize);
+}
+
+uuid_u str_to_uuid(const std::string &uuid) {
+    uuid_u ret;
+    if (str_to_uuid(uuid, &ret)) {
+        return ret;
+    } else {
+        throw std::runtime_error("invalid uuid");  // Sigh.
+    }
+}
+
+MUST_USE bool str_to_uuid(const std::string &str, uuid_u *uuid) {
+    if (str.size() != uuid_u::kStringSize) {
+        return false;
     }
 
-    rassert(j == uuid_u::kStringSize);
+    char hex[2 * uuid_u::kStaticSize];
+    for (size_t g = 0; g < 5; ++g) {
+        if (g > 0 && str[uuid_group_string_offsets[g] - 1] != '-') {
+            return false;
+        }
+        memcpy(hex + uuid_group_digit_offsets[g],
+               str.data() + uuid_group_string_offsets[g],
+               uuid_group_digit_offsets[g + 1] - uuid_group_digit_offsets[g]);
+    }
+    // Only write to `uuid` if the whole string is valid.
+    uint8_t data[uuid_u::kStaticSize];
+    if (!uuid_hex_to_bytes(hex, data)) {
+        return false;
+    }
+    memcpy(uuid->data(), data, uuid_u::kStaticSize);
     return true;
 }
 
@@ -0,0 +1,203 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#include "crypto/session_tickets.hpp"
+
+#ifdef ENABLE_TLS
+
+#include <openssl/evp.h>
+#include <openssl/hmac.h>
+#include <openssl/opensslv.h>
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+#include <openssl/core_names.h>
+#include <openssl/params.h>
+#endif
+#include <string.h>
+#include <time.h>
+
+#include <array>
+
+#include "arch/spinlock.hpp"
+#include "crypto/error.hpp"
+#include "crypto/random.hpp"
+#include "errors.hpp"
+
+namespace crypto {
+
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+typedef EVP_MAC_CTX ticket_mac_ctx_t;
+#else
+typedef HMAC_CTX ticket_mac_ctx_t;
+#endif
+
+class session_ticket_keys_t {
+public:
+    struct key_t {
+        // OpenSSL puts the name in the ticket, so that we can tell which key to use.
+        std::array<unsigned char, 16> name;
+        std::array<unsigned char, 32> aes_key;
+        std::array<unsigned char, 32> hmac_key;
+        time_t created;
+    };
+
+    explicit session_ticket_keys_t(int64_t _key_lifetime_secs)
+        : key_lifetime_secs(_key_lifetime_secs), has_previous(false) {
+        current = make_key(time(nullptr));
+    }
+
+    // Returns the key to encrypt new tickets with.  May throw `openssl_error_t`.
+    key_t get_current() {
+        spinlock_acq_t acq(&lock);
+        rotate_if_needed();
+        return current;
+    }
+
+    /* Looks for the key named `name`.  Returns 0 if there is none, 1 if it's the
+    current key and 2 if it's the previous one, which are the values that OpenSSL
+    expects from the ticket callback.  May throw `openssl_error_t`. */
+    int find(const unsigned char *name, key_t *key_out) {
+        spinlock_acq_t acq(&lock);
+        rotate_if_needed();
+        if (memcmp(name, current.name.data(), current.name.size()) == 0) {
+            *key_out = current;
+            return 1;
+        }
+        if (has_previous
+                && memcmp(name, previous.name.data(), previous.name.size()) == 0) {
+            *key_out = previous;
+            return 2;
+        }
+        return 0;
+    }
+
+private:
+    void rotate_if_needed() {
+        const time_t now = time(nullptr);
+        if (now - current.created >= key_lifetime_secs) {
+            // Tickets made with a key older than this have expired anyway.
+            has_previous = now - current.created < 2 * key_lifetime_secs;
+            previous = current;
+            current = make_key(now);
+        }
+    }
+
+    static key_t make_key(time_t now) {
+        key_t key;
+        key.name = random_bytes<16>();
+        key.aes_key = random_bytes<32>();
+        key.hmac_key = random_bytes<32>();
+        key.created = now;
+        return key;
+    }
+
+    const int64_t key_lifetime_secs;
+    spinlock_t lock;
+    key_t current;
+    key_t previous;
+    bool has_previous;
+
+    DISABLE_COPYING(session_ticket_keys_t);
+};
+
+int session_ticket_keys_index() {
+    static const int index = SSL_CTX_get_ex_new_index(
+        0, nullptr, nullptr, nullptr,
+        [](void *, void *ptr, CRYPTO_EX_DATA *, int, long, void *) {  // NOLINT
+            delete static_cast<session_ticket_keys_t *>(ptr);
+        });
+    return index;
+}
+
+bool init_ticket_mac(ticket_mac_ctx_t *mac_ctx,
+                     const session_ticket_keys_t::key_t &key) {
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+    char digest[] = "SHA256";
+    OSSL_PARAM params[] = {
+        OSSL_PARAM_construct_octet_string(
+            OSSL_MAC_PARAM_KEY,
+            const_cast<unsigned char *>(key.hmac_key.data()),
+            key.hmac_key.size()),
+        OSSL_PARAM_construct_utf8_string(OSSL_MAC_PARAM_DIGEST, digest, 0),
+        OSSL_PARAM_construct_end()
+    };
+    return EVP_MAC_CTX_set_params(mac_ctx, params) == 1;
+#else
+    return HMAC_Init_ex(mac_ctx, key.hmac_key.data(), key.hmac_key.size(),
+                        EVP_sha256(), nullptr) == 1;
+#endif
+}
+
+int session_ticket_callback(SSL *ssl,
+                            unsigned char *key_name,
+                            unsigned char *iv,
+                            EVP_CIPHER_CTX *cipher_ctx,
+                            ticket_mac_ctx_t *mac_ctx,
+                            int encrypt) {
+    session_ticket_keys_t *keys = static_cast<session_ticket_keys_t *>(
+        SSL_CTX_get_ex_data(SSL_get_SSL_CTX(ssl), session_ticket_keys_index()));
+    guarantee(keys != nullptr);
+    const EVP_CIPHER *cipher = EVP_aes_256_cbc();
+
+    // This is called from OpenSSL, so we mustn't let exceptions through.
+    try {
+        session_ticket_keys_t::key_t key;
+        if (encrypt == 1) {
+            key = keys->get_current();
+            detail::random_bytes(iv, EVP_CIPHER_iv_length(cipher));
+            memcpy(key_name, key.name.data(), key.name.size());
+            if (EVP_EncryptInit_ex(
+                    cipher_ctx, cipher, nullptr, key.aes_key.data(), iv) != 1
+                    || !init_ticket_mac(mac_ctx, key)) {
+                return -1;
+            }
+            return 1;
+        }
+
+        const int found = keys->find(key_name, &key);
+        if (found == 0) {
+            // Unknown or expired key; OpenSSL falls back to a full handshake.
+            return 0;
+        }
+        if (!init_ticket_mac(mac_ctx, key)
+                || EVP_DecryptInit_ex(
+                    cipher_ctx, cipher, nullptr, key.aes_key.data(), iv) != 1) {
+            return -1;
+        }
+        return found;
+    } catch (const openssl_error_t &) {
+        return -1;
+    }
+}
+
+bool enable_session_ticket_rotation(tls_ctx_t *ctx, int64_t key_lifetime_secs) {
+    guarantee(key_lifetime_secs > 0);
+    const int index = session_ticket_keys_index();
+    if (index < 0) {
+        return false;
+    }
+    session_ticket_keys_t *keys = new session_ticket_keys_t(key_lifetime_secs);
+    if (SSL_CTX_set_ex_data(ctx, index, keys) != 1) {
+        delete keys;
+        return false;
+    }
+
+    /* Without a session id context OpenSSL refuses to resume sessions when it
+    verifies client certificates.  Every context only serves one kind of connection,
+    so a constant is enough. */
+    static const unsigned char session_id_context[] = "rethinkdb";
+    if (SSL_CTX_set_session_id_context(
+            ctx, session_id_context, sizeof(session_id_context) - 1) != 1) {
+        return false;
+    }
+
+    // A ticket can be decrypted for up to two key lifetimes.
+    SSL_CTX_set_timeout(ctx, 2 * key_lifetime_secs);
+
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+    return SSL_CTX_set_tlsext_ticket_key_evp_cb(ctx, session_ticket_callback) == 1;
+#else
+    return SSL_CTX_set_tlsext_ticket_key_cb(ctx, session_ticket_callback) == 1;
+#endif
+}
+
+}  // namespace crypto
+
+#endif  // ENABLE_TLS
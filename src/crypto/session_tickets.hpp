@@ -0,0 +1,25 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#ifndef CRYPTO_SESSION_TICKETS_HPP
+#define CRYPTO_SESSION_TICKETS_HPP
+
+#include <stdint.h>
+
+#include "arch/io/openssl.hpp"
+
+#ifdef ENABLE_TLS
+
+namespace crypto {
+
+/* Makes `ctx` encrypt TLS session tickets with keys of its own, which it replaces
+every `key_lifetime_secs` seconds, so that a leaked key only exposes the sessions of
+that period.  A ticket made with the previous key is still accepted, and the client
+gets a new one, so clients that reconnect regularly can keep resuming their sessions
+instead of doing full handshakes.  The keys are shared by all the connections that use
+`ctx`, on every thread.  Returns false if OpenSSL didn't accept the configuration. */
+bool enable_session_ticket_rotation(tls_ctx_t *ctx, int64_t key_lifetime_secs);
+
+}  // namespace crypto
+
+#endif  // ENABLE_TLS
+
+#endif  // CRYPTO_SESSION_TICKETS_HPP
@@ -1,7 +1,9 @@
 // Copyright 2010-2013 RethinkDB, all rights reserved.
 #include "containers/object_buffer.hpp"
+#include "extproc/extproc_job.hpp"
 #include "extproc/extproc_pool.hpp"
 #include "extproc/extproc_spawner.hpp"
+#include "logger.hpp"
 
 extproc_pool_t::extproc_pool_t(size_t worker_count) :
     ct_interruptors(&interruptor),
@@ -46,6 +48,30 @@ void extproc_pool_t::dealloc_blocking(UNUSED signal_t *interruptor_) {
             worker_lock.get()->get_value()->kill_process();
         }
     }
+
+    prespawn_blocking();
+}
+
+void extproc_pool_t::prespawn_blocking() {
+    // The locks are held until the end, so that every iteration gets a different
+    // worker.
+    std::vector<scoped_ptr_t<cross_thread_semaphore_t<extproc_worker_t>::try_lock_t> >
+        worker_locks;
+    for (size_t i = 0; i < WARM_WORKERS; ++i) {
+        worker_locks.push_back(
+            make_scoped<cross_thread_semaphore_t<extproc_worker_t>::try_lock_t>(
+                get_worker_semaphore()));
+        extproc_worker_t *worker = worker_locks.back()->get_value();
+        if (worker == nullptr) {
+            break;
+        }
+        try {
+            worker->prespawn();
+        } catch (const extproc_worker_exc_t &ex) {
+            logWRN("Failed to start an extproc worker ahead of time: %s", ex.what());
+            break;
+        }
+    }
 }
 
 void extproc_pool_t::on_worker_acquired()
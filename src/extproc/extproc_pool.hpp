@@ -74,6 +74,13 @@ private:
     // timer callback or have multiple deallocations happening at once
     void dealloc_blocking(UNUSED signal_t *interruptor);
 
+    // Spawning a worker takes a fork, which shouldn't happen while a query waits for
+    // the worker. So after deallocating, `dealloc_blocking()` makes sure that the
+    // `WARM_WORKERS` idle workers that will be handed out next are running. Workers
+    // that are in use are left alone.
+    static const size_t WARM_WORKERS = 2;
+    void prespawn_blocking();
+
     // Cross-threaded semaphore allowing workers to be acquired from any thread
     cross_thread_semaphore_t<extproc_worker_t> worker_semaphore;
 
@@ -20,6 +20,20 @@
 
 extproc_spawner_t *extproc_spawner_t::instance = nullptr;
 
+#ifndef _WIN32
+// The default buffer of a unix socket is a couple of hundred kilobytes, so a large HTTP
+// response would make the worker block and the main process wake up many times before
+// it has all been moved over. The kernel only allocates the memory as it is used.
+static const int WORKER_SOCKET_BUFFER_SIZE = 4 * MEGABYTE;
+
+static void enlarge_socket_buffers(fd_t fd) {
+    // This is only an optimization, so failures are ignored.
+    const int size = WORKER_SOCKET_BUFFER_SIZE;
+    UNUSED int res = setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &size, sizeof(size));
+    res = setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+}
+#endif
+
 // This is the class that runs in the external process, doing all the work
 class worker_run_t {
 public:
@@ -287,6 +301,8 @@ scoped_fd_t extproc_spawner_t::spawn(process_id_t *pid_out) {
 
     scoped_fd_t fd0(fds[0]);
     scoped_fd_t fd1(fds[1]);
+    enlarge_socket_buffers(fds[0]);
+    enlarge_socket_buffers(fds[1]);
 
     res = send_fds(spawner_socket.get(), 1, &fds[1]);
     if (res != 0) {
@@ -148,6 +148,14 @@ void extproc_worker_t::released(bool user_error, signal_t *user_interruptor) {
     }
 }
 
+void extproc_worker_t::prespawn() {
+#ifndef _WIN32
+    if (worker_pid == INVALID_PROCESS_ID) {
+        socket = spawner->spawn(&worker_pid);
+    }
+#endif
+}
+
 void extproc_worker_t::kill_process() {
     // TODO: this guarantee is violated when certain exception occur before worker_pid is set
     guarantee(worker_pid != INVALID_PROCESS_ID);
@@ -30,6 +30,11 @@ public:
     read_stream_t *get_read_stream();
     write_stream_t *get_write_stream();
 
+    // Starts the worker process if it isn't running, so that the next `acquired()`
+    // doesn't have to. Does nothing on Windows, where `acquired()` also has to wait for
+    // a new process to connect.
+    void prespawn();
+
     void kill_process();
     bool is_process_alive();
 
@@ -84,23 +84,19 @@ public:
     const std::string error_string;
 };
 
-class scoped_curl_handle_t {
-public:
-    scoped_curl_handle_t() :
-        curl_handle(curl_easy_init()) {
-    }
-
-    ~scoped_curl_handle_t() {
-        curl_easy_cleanup(curl_handle);
-    }
-
-    CURL *get() {
-        return curl_handle;
+// A worker handles one request at a time, and keeps using the same easy handle for all
+// of them, so that libcurl can reuse open connections, cached DNS lookups and TLS
+// sessions when a query makes several requests to the same host. `curl_easy_reset()`
+// clears the options of the previous request but keeps those caches.
+CURL *reset_worker_curl_handle() {
+    static CURL *curl_handle = nullptr;
+    if (curl_handle == nullptr) {
+        curl_handle = curl_easy_init();
+    } else {
+        curl_easy_reset(curl_handle);
     }
-
-private:
-    CURL *curl_handle;
-};
+    return curl_handle;
+}
 
 // Used for adding headers, which cannot be freed until after the request is done
 class scoped_curl_slist_t {
@@ -563,6 +559,15 @@ void set_default_opts(CURL *curl_handle,
 
     // Enable cookies - needed for multiple requests like redirects or digest auth
     exc_setopt(curl_handle, CURLOPT_COOKIEFILE, "", "COOKIEFILE");
+    // The handle is reused, and resetting it doesn't forget the cookies of the last
+    // request.
+    exc_setopt(curl_handle, CURLOPT_COOKIELIST, "ALL", "COOKIELIST");
+
+#if LIBCURL_VERSION_NUM >= 0x072f00
+    // Use HTTP/2 for HTTPS where the server supports it. This fails if libcurl was
+    // built without HTTP/2, which is fine.
+    curl_easy_setopt(curl_handle, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_2TLS);
+#endif
 
     // Use the proxy set when launched
     if (!proxy.empty()) {
@@ -572,22 +577,22 @@ void set_default_opts(CURL *curl_handle,
 
 // TODO: implement streaming API support
 void perform_http(http_opts_t *opts, http_result_t *res_out) {
-    scoped_curl_handle_t curl_handle;
+    CURL *curl_handle = reset_worker_curl_handle();
     curl_data_t curl_data;
 
-    if (curl_handle.get() == nullptr) {
+    if (curl_handle == nullptr) {
         res_out->error.assign("initialization");
         return;
     }
 
-    set_default_opts(curl_handle.get(), opts->proxy, curl_data);
-    transfer_opts(opts, curl_handle.get(), &curl_data);
+    set_default_opts(curl_handle, opts->proxy, curl_data);
+    transfer_opts(opts, curl_handle, &curl_data);
 
     CURLcode curl_res = CURLE_OK;
     long response_code = 0; // NOLINT(runtime/int)
     for (uint64_t attempts = 0; attempts < opts->attempts; ++attempts) {
         // Do the HTTP operation, then check for errors
-        curl_res = curl_easy_perform(curl_handle.get());
+        curl_res = curl_easy_perform(curl_handle);
 
         if (curl_res == CURLE_SEND_ERROR ||
             curl_res == CURLE_RECV_ERROR ||
@@ -599,7 +604,7 @@ void perform_http(http_opts_t *opts, http_result_t *res_out) {
             return;
         }
 
-        curl_res = curl_easy_getinfo(curl_handle.get(),
+        curl_res = curl_easy_getinfo(curl_handle,
                                      CURLINFO_RESPONSE_CODE,
                                      &response_code);
 
@@ -640,7 +645,7 @@ void perform_http(http_opts_t *opts, http_result_t *res_out) {
         res_out->error = strprintf("status code %ld", response_code);
     } else {
         parse_header(header_data, res_out);
-        save_cookies(curl_handle.get(), res_out);
+        save_cookies(curl_handle, res_out);
 
         // If this was a HEAD request, we should not be handling data, just return R_NULL
         // so the user knows the request succeeded
@@ -656,7 +661,7 @@ void perform_http(http_opts_t *opts, http_result_t *res_out) {
             {
                 std::string content_type;
                 char *content_type_buffer = nullptr;
-                curl_easy_getinfo(curl_handle.get(),
+                curl_easy_getinfo(curl_handle,
                                   CURLINFO_CONTENT_TYPE,
                                   &content_type_buffer);
 
@@ -42,6 +42,7 @@
 #include <stdint.h>
 
 #include <limits>
+#include <map>
 
 #include "containers/archive/boost_types.hpp"
 #include "containers/archive/stl_types.hpp"
@@ -75,6 +76,9 @@ static js_result_t rduk_eval(rduk_env_t *env, const std::string &source,
                       const ql::configured_limits_t &limits);
 static js_result_t rduk_call(js_id_t id, const std::vector<ql::datum_t> &args,
                       const ql::configured_limits_t &limits);
+static std::vector<js_result_t> rduk_call_batch(
+        js_id_t id, const std::vector<std::vector<ql::datum_t> > &args_batch,
+        const ql::configured_limits_t &limits);
 static void rduk_release(js_id_t id);
 
 static js_result_t run_eval(
@@ -85,6 +89,10 @@ static js_result_t run_call(
         js_id_t id,
         std::vector<ql::datum_t> args,
         ql::configured_limits_t limits);
+static std::vector<js_result_t> run_call_batch(
+        js_id_t id,
+        const std::vector<std::vector<ql::datum_t> > &args_batch,
+        const ql::configured_limits_t &limits);
 static void run_release(js_id_t id);
 static void run_exit();
 
@@ -102,6 +110,11 @@ js_result_t js_job_t::call(js_id_t id, const std::vector<ql::datum_t> &args) {
     return run_call(id, args, limits);
 }
 
+std::vector<js_result_t> js_job_t::call_batch(
+        js_id_t id, const std::vector<std::vector<ql::datum_t> > &args_batch) {
+    return run_call_batch(id, args_batch, limits);
+}
+
 void js_job_t::release(js_id_t id) {
     run_release(id);
 }
@@ -149,6 +162,22 @@ static js_result_t run_call(
     return js_result;
 }
 
+static std::vector<js_result_t> run_call_batch(
+        js_id_t id,
+        const std::vector<std::vector<ql::datum_t> > &args_batch,
+        const ql::configured_limits_t &limits) {
+    worker_fn();
+
+    try {
+        return rduk_call_batch(id, args_batch, limits);
+    } catch (const std::exception &e) {
+        return std::vector<js_result_t>(args_batch.size(), std::string(e.what()));
+    } catch (...) {
+        return std::vector<js_result_t>(args_batch.size(),
+            std::string("encountered an unknown exception"));
+    }
+}
+
 static void run_release(js_id_t id) {
     worker_fn();
 
@@ -192,6 +221,69 @@ struct rduk_pop_exit {
 
 
 
+// Queries that use the same `r.js` function usually each get their own `js_runner_t`,
+// and used to compile the source again every time. The bytecode of each compiled
+// source is also kept in the heap stash, so that a later eval of the same source only
+// has to load it. It is loaded and run again in a new global environment, so nothing
+// one query does to its globals is seen by the next. Like the function ids, the cache
+// lasts for the lifetime of the duk heap.
+static const size_t COMPILED_PROGRAM_CACHE_SIZE = 1000;
+
+// When each source in the cache was last evaluated, by `compiled_program_clock`.
+static std::map<std::string, uint64_t> compiled_program_uses;
+static uint64_t compiled_program_clock = 0;
+
+// Function ids are decimal numbers, so these can't collide with them.
+static std::string cached_program_prop_name(const std::string &source) {
+    return "src:" + source;
+}
+
+// With ctx's stack: [...] [program] -> [...] [program]
+static void cache_compiled_program(duk_context *ctx, const std::string &source) {
+    duk_require_stack(ctx, 2);
+    duk_push_heap_stash(ctx);
+    rduk_pop_exit pop_stash(ctx);
+
+    if (compiled_program_uses.size() >= COMPILED_PROGRAM_CACHE_SIZE) {
+        auto oldest = compiled_program_uses.begin();
+        for (auto it = compiled_program_uses.begin();
+             it != compiled_program_uses.end(); ++it) {
+            if (it->second < oldest->second) {
+                oldest = it;
+            }
+        }
+        std::string oldest_name = cached_program_prop_name(oldest->first);
+        duk_del_prop_lstring(ctx, -1, oldest_name.data(), oldest_name.size());
+        compiled_program_uses.erase(oldest);
+    }
+
+    duk_dup(ctx, -2);
+    duk_dump_function(ctx);
+    std::string name = cached_program_prop_name(source);
+    duk_bool_t res = duk_put_prop_lstring(ctx, -2, name.data(), name.size());
+    guarantee(res);
+    compiled_program_uses[source] = ++compiled_program_clock;
+}
+
+// With ctx's stack: [...] -> [...] [program]
+// Pushes nothing and returns false if `source` hasn't been compiled yet.
+static bool push_cached_program(duk_context *ctx, const std::string &source) {
+    auto it = compiled_program_uses.find(source);
+    if (it == compiled_program_uses.end()) {
+        return false;
+    }
+    it->second = ++compiled_program_clock;
+
+    duk_require_stack(ctx, 2);
+    duk_push_heap_stash(ctx);
+    std::string name = cached_program_prop_name(source);
+    bool res = duk_get_prop_lstring(ctx, -1, name.data(), name.size());
+    guarantee(res, "cached program not found");
+    duk_remove(ctx, -2);
+    duk_load_function(ctx);
+    return true;
+}
+
 static js_result_t rduk_eval(rduk_env_t *env, const std::string &source,
                       const ql::configured_limits_t &limits) {
     duk_require_stack(rduk_root_ctx, 1);
@@ -203,7 +295,21 @@ static js_result_t rduk_eval(rduk_env_t *env, const std::string &source,
     static_assert(std::is_same<size_t, duk_size_t>::value, "size_t != duk_size_t");
 
     duk_require_stack(ctx, 1);
-    duk_int_t res = duk_peval_lstring(ctx, source.data(), source.size());
+    if (!push_cached_program(ctx, source)) {
+        duk_int_t res = duk_pcompile_lstring(ctx, DUK_COMPILE_EVAL,
+                                             source.data(), source.size());
+        if (0 != res) {
+            rduk_pop_exit pop_compile_error(ctx);
+            size_t msg_size;
+            const char *msg = duk_safe_to_lstring(ctx, -1, &msg_size);
+            boost::get<std::string>(result).append(msg, msg_size);
+            return result;
+        }
+        cache_compiled_program(ctx, source);
+    }
+
+    // Like `duk_peval_lstring`, which is a compile followed by this call.
+    duk_int_t res = duk_pcall(ctx, 0);
     rduk_pop_exit pop_peval_result(ctx);
     if (0 != res) {
         size_t msg_size;
@@ -335,14 +441,10 @@ static bool push_js_from_datum(duk_context *ctx,
     }
 }
 
-static js_result_t rduk_call(js_id_t id, const std::vector<ql::datum_t> &args,
-                      const ql::configured_limits_t &limits) {
-    duk_require_stack(rduk_root_ctx, 1);
-    duk_push_thread_new_globalenv(rduk_root_ctx);
-    rduk_pop_exit pop_root_ctx(rduk_root_ctx);
-
-    duk_context *ctx = duk_get_context(rduk_root_ctx, -1);
-
+// Calls the function in the context `ctx`, leaving its stack as it was.
+static js_result_t rduk_call_in_ctx(duk_context *ctx, js_id_t id,
+                                    const std::vector<ql::datum_t> &args,
+                                    const ql::configured_limits_t &limits) {
     duk_idx_t num_args = args.size();
     duk_require_stack(ctx, 1 + num_args);
     // Alright, we pushed the function onto the stack.
@@ -384,6 +486,34 @@ static js_result_t rduk_call(js_id_t id, const std::vector<ql::datum_t> &args,
     return result;
 }
 
+static js_result_t rduk_call(js_id_t id, const std::vector<ql::datum_t> &args,
+                      const ql::configured_limits_t &limits) {
+    duk_require_stack(rduk_root_ctx, 1);
+    duk_push_thread_new_globalenv(rduk_root_ctx);
+    rduk_pop_exit pop_root_ctx(rduk_root_ctx);
+
+    return rduk_call_in_ctx(duk_get_context(rduk_root_ctx, -1), id, args, limits);
+}
+
+// Setting up a new context with its own global environment is a large part of the cost
+// of a call, so all of the calls in a batch share one. The function still runs in the
+// global environment it was created in, so this isn't visible to the calls.
+static std::vector<js_result_t> rduk_call_batch(
+        js_id_t id, const std::vector<std::vector<ql::datum_t> > &args_batch,
+        const ql::configured_limits_t &limits) {
+    duk_require_stack(rduk_root_ctx, 1);
+    duk_push_thread_new_globalenv(rduk_root_ctx);
+    rduk_pop_exit pop_root_ctx(rduk_root_ctx);
+
+    duk_context *ctx = duk_get_context(rduk_root_ctx, -1);
+    std::vector<js_result_t> results;
+    results.reserve(args_batch.size());
+    for (const std::vector<ql::datum_t> &args : args_batch) {
+        results.push_back(rduk_call_in_ctx(ctx, id, args, limits));
+    }
+    return results;
+}
+
 static void rduk_release(js_id_t id) {
     duk_push_heap_stash(rduk_root_ctx);
     rduk_pop_exit pop_stash(rduk_root_ctx);
@@ -60,6 +60,10 @@ public:
 
     js_result_t eval(const std::string &source);
     js_result_t call(js_id_t id, const std::vector<ql::datum_t> &args);
+    // Calls the function once for each element of `args_batch`. This is cheaper than
+    // calling `call()` repeatedly because the calls share one JS context.
+    std::vector<js_result_t> call_batch(
+        js_id_t id, const std::vector<std::vector<ql::datum_t> > &args_batch);
     void release(js_id_t id);
     void exit();
 
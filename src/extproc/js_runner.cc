@@ -232,6 +232,51 @@ js_result_t js_runner_t::call(const std::string &source,
     return result;
 }
 
+std::vector<js_result_t> js_runner_t::call_batch(
+        const std::string &source,
+        const std::vector<std::vector<ql::datum_t> > &args_batch,
+        const req_config_t &config) {
+    assert_thread();
+    guarantee(job_data.has());
+
+    js_result_t fn = eval(source, config);
+    js_id_t *fn_id = boost::get<js_id_t>(&fn);
+    if (fn_id == nullptr) {
+        if (boost::get<ql::datum_t>(&fn) != nullptr) {
+            fn = strprintf("Javascript query `%s` returned a value when it should "
+                           "have returned a function.", source.c_str());
+        }
+        return std::vector<js_result_t>(args_batch.size(), fn);
+    }
+
+    const uint64_t timeout_ms = config.timeout_ms * args_batch.size();
+    object_buffer_t<js_timeout_t::sentry_t> sentry;
+    sentry.create(&job_data->js_timeout, timeout_ms);
+
+    bool is_timeout = false;
+    try {
+        try {
+            return job_data->js_job.call_batch(*fn_id, args_batch);
+        } catch (...) {
+            // See `call()`.
+            is_timeout = job_data->js_timeout.get_signal()->is_pulsed();
+            sentry.reset();
+            job_data->js_job.worker_error();
+            job_data.reset();
+
+            throw;
+        }
+    } catch (interrupted_exc_t const &e) {
+        if (is_timeout) {
+            return std::vector<js_result_t>(args_batch.size(), strprintf(
+                "JavaScript query `%s` timed out after %" PRIu64 ".%03" PRIu64
+                " seconds.", source.c_str(), timeout_ms / 1000, timeout_ms % 1000));
+        } else {
+            throw;
+        }
+    }
+}
+
 void js_runner_t::cache_id(js_id_t id, const std::string &source) {
     guarantee(job_data.has());
     guarantee(id != INVALID_ID);
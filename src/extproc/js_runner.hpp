@@ -80,6 +80,14 @@ public:
                      const std::vector<ql::datum_t> &args,
                      const req_config_t &config);
 
+    // Calls a previously compiled function once for each element of `args_batch`. The
+    // function is only looked up once, and the calls share one timer that allows
+    // `config.timeout_ms` for each call. If the batch times out, every call fails.
+    std::vector<js_result_t> call_batch(
+        const std::string &source,
+        const std::vector<std::vector<ql::datum_t> > &args_batch,
+        const req_config_t &config);
+
 private:
     static const size_t CACHE_SIZE;
 
@@ -11,12 +11,17 @@
 #include <boost/algorithm/string.hpp>
 
 #include "arch/io/network.hpp"
+#include "arch/timing.hpp"
+#include "concurrency/wait_any.hpp"
 #include "logger.hpp"
 #include "math.hpp"
 
 static const char *const resource_parts_sep_char = "/";
 static boost::char_separator<char> resource_parts_sep(resource_parts_sep_char, "", boost::keep_empty_tokens);
 
+// How long a persistent connection may wait for its next request before we close it.
+static const int64_t keepalive_timeout_ms = 60 * 1000;
+
 http_req_t::resource_t::resource_t() {
 }
 
@@ -393,16 +398,52 @@ std::string human_readable_status(http_status_code_t code) {
     }
 }
 
-void write_http_msg(tcp_conn_t *conn, const http_res_t &res, signal_t *closer) THROWS_ONLY(tcp_conn_write_closed_exc_t) {
-    conn->writef(closer, "HTTP/%s %" PRIu32 " %s\r\n",
-                 res.version.c_str(),
-                 static_cast<uint32_t>(res.code),
-                 human_readable_status(res.code).c_str());
+/* Writes the response into the connection's write buffer.  Unless `wait_for_flush` is
+false, this waits until the response has gone out; otherwise it gets sent a bit later,
+maybe together with the responses to requests that the client has already sent. */
+void write_http_msg(tcp_conn_t *conn, const http_res_t &res, bool wait_for_flush,
+                    signal_t *closer) THROWS_ONLY(tcp_conn_write_closed_exc_t) {
+    std::string head = strprintf("HTTP/%s %" PRIu32 " %s\r\n",
+                                 res.version.c_str(),
+                                 static_cast<uint32_t>(res.code),
+                                 human_readable_status(res.code).c_str());
     for (auto const &line: res.header_lines) {
-        conn->writef(closer, "%s: %s\r\n", line.first.c_str(), line.second.c_str());
+        head += line.first;
+        head += ": ";
+        head += line.second;
+        head += "\r\n";
+    }
+    head += "\r\n";
+    conn->write_buffered(head.data(), head.size(), closer);
+    conn->write_buffered(res.body.data(), res.body.size(), closer);
+    if (wait_for_flush) {
+        conn->flush_buffer(closer);
+    } else {
+        conn->flush_buffer_eventually(closer);
+    }
+}
+
+/* Decides whether the connection stays open for another request after `res`, and
+sets the "Connection" header of `res` accordingly.  HTTP/1.1 connections are
+persistent unless either side says otherwise, and HTTP/1.0 ones only if the client
+asks for it. */
+bool set_keepalive(const http_req_t &req, http_res_t *res) {
+    optional<std::string> req_connection = req.find_header_line("Connection");
+    auto res_connection = res->header_lines.find("connection");
+    bool keepalive;
+    if (res_connection != res->header_lines.end()) {
+        keepalive = !boost::icontains(res_connection->second, "close");
+    } else if (req_connection && boost::icontains(*req_connection, "close")) {
+        keepalive = false;
+    } else if (req.version == "1.1") {
+        keepalive = true;
+    } else {
+        keepalive = req_connection && boost::icontains(*req_connection, "keep-alive");
     }
-    conn->writef(closer, "\r\n");
-    conn->write(res.body.c_str(), res.body.size(), closer);
+    if (res_connection == res->header_lines.end()) {
+        res->add_header_line("Connection", keepalive ? "keep-alive" : "close");
+    }
+    return keepalive;
 }
 
 void http_server_t::handle_conn(const scoped_ptr_t<tcp_conn_descriptor_t> &nconn, auto_drainer_t::lock_t keepalive) {
@@ -419,33 +460,55 @@ void http_server_t::handle_conn(const scoped_ptr_t<tcp_conn_descriptor_t> &nconn
         return;
     }
 
-    http_req_t req;
+    ip_and_port_t peer(ip_address_t::any(AF_INET), port_t(0));
+    UNUSED bool peer_res = conn->getpeername(&peer);
     tcp_http_msg_parser_t http_msg_parser;
 
-    // Parse the request
     try {
-        http_res_t res;
-        UNUSED bool peer_res = conn->getpeername(&req.peer);
+        // Serve requests until one of the sides closes the connection.  The client may
+        // send requests before it has the responses to the earlier ones; those get
+        // parsed out of the read buffer and answered in order.
+        bool persistent = true;
+        while (persistent) {
+            http_req_t req;
+            req.peer = peer;
+            http_res_t res;
+
+            // Parse the request
+            bool parsed;
+            {
+                signal_timer_t idle_timeout(keepalive_timeout_ms);
+                wait_any_t read_closer(keepalive.get_drain_signal(), &idle_timeout);
+                parsed = http_msg_parser.parse(conn.get(), &req, &read_closer);
+            }
 
-        if (http_msg_parser.parse(conn.get(), &req, keepalive.get_drain_signal())) {
-            application->handle(req, &res, keepalive.get_drain_signal());
-            res.version = req.version;
-            maybe_gzip_response(req, &res);
-        } else {
-            res = http_res_t(http_status_code_t::BAD_REQUEST);
-        }
+            if (parsed) {
+                application->handle(req, &res, keepalive.get_drain_signal());
+                res.version = req.version;
+                maybe_gzip_response(req, &res);
+            } else {
+                res = http_res_t(http_status_code_t::BAD_REQUEST);
+            }
 
-        // Disable keepalive on Safari because it seems like a partial cause of #3983
-        auto user_agent = req.header_lines.find("user-agent");
-        if (user_agent != req.header_lines.end()) {
-            if (user_agent->second.find("Safari") != std::string::npos) {
-                // Chrome also has "Safari" in the user-agent string.
-                if (user_agent->second.find("Chrome") == std::string::npos) {
-                    res.add_header_line("Connection", "close");
+            // Disable keepalive on Safari because it seems like a partial cause of #3983
+            auto user_agent = req.header_lines.find("user-agent");
+            if (user_agent != req.header_lines.end()) {
+                if (user_agent->second.find("Safari") != std::string::npos) {
+                    // Chrome also has "Safari" in the user-agent string.
+                    if (user_agent->second.find("Chrome") == std::string::npos) {
+                        res.add_header_line("Connection", "close");
+                    }
                 }
             }
+            // We don't know where a request that we couldn't parse ends.
+            persistent = set_keepalive(req, &res) && parsed;
+
+            // If the next request is already here, its response can go out together
+            // with this one.
+            const_charslice pending = conn->peek();
+            write_http_msg(conn.get(), res, !persistent || pending.beg == pending.end,
+                           keepalive.get_drain_signal());
         }
-        write_http_msg(conn.get(), res, keepalive.get_drain_signal());
     } catch (const interrupted_exc_t &) {
         // The query was interrupted, no response since we are shutting down
     } catch (const tcp_conn_read_closed_exc_t &) {
@@ -499,20 +562,26 @@ bool tcp_http_msg_parser_t::parse(tcp_conn_t *conn, http_req_t *req, signal_t *c
     version_parser.parse(version_str);
     req->version = version_parser.version;
 
-    // Parse header lines.
+    // Parse header lines.  They are parsed straight out of the connection's read
+    // buffer, which only leaves the key and the value to be copied.
     while (true) {
-        std::string header_line = parser.readLine(closer);
-        if (header_line.length() == 0) {
+        const_charslice header_line = parser.peekLine(closer);
+        if (header_line.beg == header_line.end) {
             // Blank line separates header from body. We're done here.
+            parser.popLine(closer);
             break;
         }
 
         header_line_parser_t header_parser;
-        if (!header_parser.parse(header_line)) {
+        const bool header_parsed = header_parser.parse(header_line);
+        parser.popLine(closer);
+        if (!header_parsed) {
             return false;
         }
 
-        req->add_header_line(header_parser.key, header_parser.val);
+        // Like `add_header_line`, this keeps the first value of a repeated header.
+        req->header_lines.emplace(std::move(header_parser.key),
+                                  std::move(header_parser.val));
     }
 
     // Parse body
@@ -584,26 +653,27 @@ bool tcp_http_msg_parser_t::resource_string_parser_t::parse(const std::string &s
     return true;
 }
 
-bool tcp_http_msg_parser_t::header_line_parser_t::parse(const std::string &src) {
-    std::string::const_iterator iter = src.begin();
-    while (iter != src.end() && *iter != ':') {
+bool tcp_http_msg_parser_t::header_line_parser_t::parse(const const_charslice &src) {
+    const char *iter = src.beg;
+    while (iter != src.end && *iter != ':') {
         ++iter;
     }
 
-    if (iter == src.end()) {
+    if (iter == src.end) {
         // No ':' found, error
         return false;
     }
 
-    key = std::string(src.begin(), iter);
+    key.assign(src.beg, iter);
+    boost::to_lower(key);
 
     /* Strip away spaces before parsing value */
     ++iter;
-    while (iter != src.end() && *iter == ' ') {
+    while (iter != src.end && *iter == ' ') {
         ++iter;
     }
 
-    val = std::string(iter, src.end());
+    val.assign(iter, src.end);
 
     return true;
 }
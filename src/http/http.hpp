@@ -129,10 +129,11 @@ private:
     };
 
     struct header_line_parser_t {
+        // The key is lower-cased, like the keys of `http_req_t::header_lines`.
         std::string key;
         std::string val;
 
-        bool parse(const std::string &src);
+        bool parse(const const_charslice &src);
     };
 };
 
@@ -20,6 +20,17 @@ std::string line_parser_t::readLine(signal_t *closer) {
     return line;
 }
 
+const_charslice line_parser_t::peekLine(signal_t *closer) {
+    while (!readCRLF(closer)) {
+        bytes_read++;
+    }
+    return const_charslice(start_position, start_position + bytes_read - 2);
+}
+
+void line_parser_t::popLine(signal_t *closer) {
+    pop(closer);
+}
+
 std::string line_parser_t::readWord(signal_t *closer) {
     while (current(closer) != ' ') {
         bytes_read++;
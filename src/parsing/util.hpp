@@ -27,6 +27,12 @@ public:
     // Reads a single space terminated word from the TCP conn
     std::string readWord(signal_t *closer);
 
+    // Like readLine(), but returns the line without copying it out of the TCP conn's
+    // buffer.  The slice is only valid until popLine() is called, which must happen
+    // before anything else is read.
+    const_charslice peekLine(signal_t *closer);
+    void popLine(signal_t *closer);
+
 private:
     void peek();
     void pop(signal_t *closer);
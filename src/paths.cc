@@ -2,6 +2,7 @@
 
 #include <fcntl.h>
 #include <limits.h>
+#include <stdio.h>
 #include <unistd.h>
 
 #ifdef _WIN32
@@ -214,6 +215,29 @@ bool blocking_read_file(const char *path, std::string *contents_out) {
 #endif
 }
 
+bool blocking_replace_file(const char *path, const std::string &contents) {
+    const std::string temporary_path = std::string(path) + ".tmp";
+    FILE *file = fopen(temporary_path.c_str(), "wb");
+    if (file == nullptr) {
+        return false;
+    }
+    const size_t written = fwrite(contents.data(), 1, contents.size(), file);
+    const int close_res = fclose(file);
+    if (written != contents.size() || close_res != 0) {
+        ::unlink(temporary_path.c_str());
+        return false;
+    }
+#ifdef _WIN32
+    if (!MoveFileEx(temporary_path.c_str(), path, MOVEFILE_REPLACE_EXISTING)) {
+#else
+    if (::rename(temporary_path.c_str(), path) != 0) {
+#endif
+        ::unlink(temporary_path.c_str());
+        return false;
+    }
+    return true;
+}
+
 std::string blocking_read_file(const char *path) {
     std::string ret;
     bool success = blocking_read_file(path, &ret);
@@ -60,6 +60,8 @@ private:
     const std::string temporary_path_;
 };
 
+bool is_rw_directory(const base_path_t& path);
+
 void recreate_temporary_directory(const base_path_t& base_path);
 
 void remove_directory_recursive(const char *path);
@@ -67,4 +69,9 @@ void remove_directory_recursive(const char *path);
 std::string blocking_read_file(const char *path);
 bool blocking_read_file(const char *path, std::string *contents_out);
 
+// Writes `contents` to a temporary file next to `path`, and then renames it to
+// `path`, so readers see either the old or the new contents.  Returns false on
+// failure.
+bool blocking_replace_file(const char *path, const std::string &contents);
+
 #endif  // PATHS_HPP_
@@ -0,0 +1,123 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#include "perfmon/memory.hpp"
+
+#include <array>
+#include <atomic>
+
+#include "arch/runtime/runtime.hpp"
+#include "concurrency/cache_line_padded.hpp"
+#include "perfmon/perfmon.hpp"
+
+namespace {
+
+struct memory_counters_t {
+    int64_t bytes[MEMORY_TAG_COUNT];
+};
+
+std::array<cache_line_padded_t<memory_counters_t>, MAX_THREADS> thread_counters;
+
+// For the threads that aren't in the thread pool, such as the blocker pool threads.
+std::array<std::atomic<int64_t>, MEMORY_TAG_COUNT> other_thread_counters;
+
+std::atomic<int64_t> resident_memory_size(-1);
+
+class memory_usage_perfmon_t : public perfmon_perthread_t<memory_counters_t> {
+private:
+    void get_thread_stat(memory_counters_t *stat) {
+        *stat = thread_counters[get_thread_id().threadnum].value;
+    }
+
+    memory_counters_t combine_stats(const memory_counters_t *stats) {
+        memory_counters_t combined;
+        for (int tag = 0; tag < MEMORY_TAG_COUNT; ++tag) {
+            combined.bytes[tag] = other_thread_counters[tag].load();
+            for (int i = 0; i < get_num_threads(); ++i) {
+                combined.bytes[tag] += stats[i].bytes[tag];
+            }
+        }
+        return combined;
+    }
+
+    ql::datum_t output_stat(const memory_counters_t &combined) {
+        ql::datum_object_builder_t builder;
+        int64_t tracked = 0;
+        for (int tag = 0; tag < MEMORY_TAG_COUNT; ++tag) {
+            builder.overwrite(
+                strprintf("%s_bytes",
+                          memory_tag_name(static_cast<memory_tag_t>(tag))).c_str(),
+                ql::datum_t(static_cast<double>(combined.bytes[tag])));
+            tracked += combined.bytes[tag];
+        }
+        builder.overwrite("tracked_bytes", ql::datum_t(static_cast<double>(tracked)));
+        const int64_t resident = resident_memory_size.load();
+        if (resident >= 0) {
+            builder.overwrite("resident_bytes",
+                              ql::datum_t(static_cast<double>(resident)));
+            builder.overwrite("untracked_bytes",
+                              ql::datum_t(static_cast<double>(resident - tracked)));
+        } else {
+            builder.overwrite("resident_bytes", ql::datum_t::null());
+            builder.overwrite("untracked_bytes", ql::datum_t::null());
+        }
+        return std::move(builder).to_datum();
+    }
+};
+
+memory_usage_perfmon_t pm_memory_usage;
+perfmon_membership_t pm_memory_usage_membership(
+    &get_global_perfmon_collection(), &pm_memory_usage, "memory");
+
+}  // namespace
+
+const char *memory_tag_name(memory_tag_t tag) {
+    switch (tag) {
+    case memory_tag_t::page_cache: return "page_cache";
+    case memory_tag_t::coroutine_stacks: return "coroutine_stacks";
+    case memory_tag_t::query_terms: return "query_terms";
+    case memory_tag_t::changefeed_queues: return "changefeed_queues";
+    case memory_tag_t::disk_backed_queues: return "disk_backed_queues";
+    default: unreachable();
+    }
+}
+
+void track_memory(memory_tag_t tag, int64_t bytes) {
+    const int thread = get_thread_id().threadnum;
+    if (thread >= 0) {
+        thread_counters[thread].value.bytes[static_cast<int>(tag)] += bytes;
+    } else {
+        other_thread_counters[static_cast<int>(tag)] += bytes;
+    }
+}
+
+void set_resident_memory_size(int64_t bytes) {
+    resident_memory_size.store(bytes);
+}
+
+tracked_memory_t::tracked_memory_t(memory_tag_t tag, size_t size)
+    : tag_(tag), size_(size) {
+    track_memory(tag_, size_);
+}
+
+tracked_memory_t::tracked_memory_t(tracked_memory_t &&other)
+    : tag_(other.tag_), size_(other.size_) {
+    other.size_ = 0;
+}
+
+tracked_memory_t::~tracked_memory_t() {
+    track_memory(tag_, -static_cast<int64_t>(size_));
+}
+
+tracked_memory_t &tracked_memory_t::operator=(tracked_memory_t &&other) {
+    if (this != &other) {
+        track_memory(tag_, -static_cast<int64_t>(size_));
+        tag_ = other.tag_;
+        size_ = other.size_;
+        other.size_ = 0;
+    }
+    return *this;
+}
+
+void tracked_memory_t::set_size(size_t size) {
+    track_memory(tag_, static_cast<int64_t>(size) - static_cast<int64_t>(size_));
+    size_ = size;
+}
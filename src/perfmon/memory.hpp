@@ -0,0 +1,61 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#ifndef PERFMON_MEMORY_HPP_
+#define PERFMON_MEMORY_HPP_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "errors.hpp"
+
+/* Memory accounting for the subsystems that can hold a lot of memory. Every thread has
+its own counters, so that tracking an allocation doesn't take any synchronization. The
+totals are in the "memory" perfmon, along with the resident size of the process, so
+that one can tell how much of the resident memory isn't accounted for (which includes
+the allocator's own overhead and fragmentation). */
+
+enum class memory_tag_t {
+    // The buffers of the blocks that are in memory, which are mostly the pages of the
+    // caches (including the caches of the disk backed queues).
+    page_cache,
+    // This counts the whole size of the stacks, although the kernel only backs the
+    // parts of them with memory that the coroutines have touched.
+    coroutine_stacks,
+    // The terms of the queries that are running or have open cursors.
+    query_terms,
+    // The changes that wait in the queues of the changefeeds, by their serialized size.
+    changefeed_queues,
+    // The items that the disk backed queues keep in memory, i.e. not on disk.
+    disk_backed_queues
+};
+
+static const int MEMORY_TAG_COUNT =
+    static_cast<int>(memory_tag_t::disk_backed_queues) + 1;
+
+const char *memory_tag_name(memory_tag_t tag);
+
+/* `bytes` is negative when memory is freed. Memory may be freed on another thread than
+it was allocated on; only the sum over the threads is meaningful. */
+void track_memory(memory_tag_t tag, int64_t bytes);
+
+/* Called by the memory checker every now and then. */
+void set_resident_memory_size(int64_t bytes);
+
+/* Tracks `size()` bytes of memory as long as it exists. */
+class tracked_memory_t {
+public:
+    explicit tracked_memory_t(memory_tag_t tag, size_t size = 0);
+    tracked_memory_t(tracked_memory_t &&other);
+    ~tracked_memory_t();
+    tracked_memory_t &operator=(tracked_memory_t &&other);
+
+    void set_size(size_t size);
+    size_t size() const { return size_; }
+
+private:
+    memory_tag_t tag_;
+    size_t size_;
+
+    DISABLE_COPYING(tracked_memory_t);
+};
+
+#endif  // PERFMON_MEMORY_HPP_
@@ -16,6 +16,9 @@ static const char *stat_per_sec = "per_sec";
 static const char *stat_count = "count";
 static const char *stat_mean = "mean";
 static const char *stat_std_dev = "std_dev";
+static const char *stat_p50 = "p50";
+static const char *stat_p99 = "p99";
+static const char *stat_p999 = "p999";
 
 
 #ifdef FULL_PERFMON
@@ -302,11 +305,82 @@ ql::datum_t perfmon_rate_monitor_t::output_stat(const double &stat) {
     return ql::datum_t(stat / ticks_to_secs(length));
 }
 
+/* perfmon_latency_sampler_t */
+
+perfmon_latency_sampler_t::perfmon_latency_sampler_t(ticks_t _length)
+    : perfmon_perthread_t<latency_histogram_t>(), length(_length) { }
+
+void perfmon_latency_sampler_t::update(thread_info_t *thread, ticks_t now) {
+    const int64_t interval = now.nanos / length.nanos;
+    if (thread->current_interval == interval) {
+        /* We're up to date; nothing to do */
+    } else if (thread->current_interval + 1 == interval) {
+        /* We're one step behind */
+        thread->last = thread->current;
+        thread->current = latency_histogram_t();
+        thread->current_interval = interval;
+    } else {
+        /* We're more than one step behind */
+        thread->last = thread->current = latency_histogram_t();
+        thread->current_interval = interval;
+    }
+}
+
+void perfmon_latency_sampler_t::record(ticks_t duration) {
+    rassert(get_thread_id().threadnum >= 0);
+    const ticks_t now = get_ticks();
+    scoped_ptr_t<thread_info_t> *thread = &thread_data[get_thread_id().threadnum];
+    if (!thread->has()) {
+        thread->init(new thread_info_t());
+        (*thread)->current_interval = now.nanos / length.nanos;
+    }
+    update(thread->get(), now);
+    (*thread)->current.add(duration.nanos);
+}
+
+void perfmon_latency_sampler_t::get_thread_stat(latency_histogram_t *stat) {
+    rassert(get_thread_id().threadnum >= 0);
+    scoped_ptr_t<thread_info_t> *thread = &thread_data[get_thread_id().threadnum];
+    if (thread->has()) {
+        /* As in `perfmon_sampler_t`, we report the last complete interval. */
+        update(thread->get(), get_ticks());
+        *stat = (*thread)->last;
+    }
+}
+
+latency_histogram_t perfmon_latency_sampler_t::combine_stats(
+        const latency_histogram_t *stats) {
+    latency_histogram_t combined;
+    for (int i = 0; i < get_num_threads(); ++i) {
+        combined.merge(stats[i]);
+    }
+    return combined;
+}
+
+ql::datum_t perfmon_latency_sampler_t::output_stat(const latency_histogram_t &stat) {
+    ql::datum_object_builder_t builder;
+    builder.overwrite(stat_count, ql::datum_t(static_cast<double>(stat.num_samples())));
+    if (stat.num_samples() > 0) {
+        builder.overwrite(stat_p50,
+            ql::datum_t(ticks_to_secs(ticks_t{stat.percentile_nanos(0.5)})));
+        builder.overwrite(stat_p99,
+            ql::datum_t(ticks_to_secs(ticks_t{stat.percentile_nanos(0.99)})));
+        builder.overwrite(stat_p999,
+            ql::datum_t(ticks_to_secs(ticks_t{stat.percentile_nanos(0.999)})));
+    } else {
+        builder.overwrite(stat_p50, ql::datum_t::null());
+        builder.overwrite(stat_p99, ql::datum_t::null());
+        builder.overwrite(stat_p999, ql::datum_t::null());
+    }
+    return std::move(builder).to_datum();
+}
+
 perfmon_duration_sampler_t::perfmon_duration_sampler_t(ticks_t length, bool _ignore_global_full_perfmon)
-    : stat(), active(), total(), recent(length, true),
+    : stat(), active(), total(), recent(length, true), recent_latency(length),
       active_membership(&stat, &active, "active_count"),
       total_membership(&stat, &total, "total"),
       recent_membership(&stat, &recent, "recent_duration"),
+      recent_latency_membership(&stat, &recent_latency, "recent_latency"),
       ignore_global_full_perfmon(_ignore_global_full_perfmon)
 { }
 
@@ -323,7 +397,9 @@ void perfmon_duration_sampler_t::begin(ticks_t *v) {
 void perfmon_duration_sampler_t::end(ticks_t *v) {
     --active;
     if (v->nanos != 0) {
-        recent.record(ticks_to_secs(ticks_t{get_ticks().nanos - v->nanos}));
+        const ticks_t duration{get_ticks().nanos - v->nanos};
+        recent.record(ticks_to_secs(duration));
+        recent_latency.record(duration);
     }
 }
 
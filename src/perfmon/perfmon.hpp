@@ -9,6 +9,7 @@
 #define PERFMON_PERFMON_HPP_
 
 #include <algorithm>
+#include <array>
 #include <limits>
 #include <string>
 #include <map>
@@ -16,6 +17,7 @@
 
 #include "concurrency/cache_line_padded.hpp"
 #include "config/args.hpp"
+#include "containers/latency_histogram.hpp"
 #include "perfmon/types.hpp"
 #include "perfmon/core.hpp"
 #include "time.hpp"
@@ -215,12 +217,40 @@ public:
     void record(double value = 1.0);
 };
 
+/* `perfmon_latency_sampler_t` records how long events took, like the durations that
+ * `perfmon_sampler_t` can record, but it keeps them in a histogram so that it can
+ * report percentiles of the latency and not only the average. Like
+ * `perfmon_sampler_t`, it reports on the last complete interval of length `length`.
+ * A thread only allocates its histograms once it records something, because most
+ * perfmons are only ever used on a few of the threads.
+ */
+class perfmon_latency_sampler_t : public perfmon_perthread_t<latency_histogram_t> {
+public:
+    explicit perfmon_latency_sampler_t(ticks_t length);
+    void record(ticks_t duration);
+
+private:
+    struct thread_info_t {
+        latency_histogram_t current, last;
+        int64_t current_interval;
+    };
+
+    void update(thread_info_t *thread, ticks_t now);
+
+    void get_thread_stat(latency_histogram_t *);
+    latency_histogram_t combine_stats(const latency_histogram_t *);
+    ql::datum_t output_stat(const latency_histogram_t &);
+
+    const ticks_t length;
+    std::array<scoped_ptr_t<thread_info_t>, MAX_THREADS> thread_data;
+};
+
 /* perfmon_duration_sampler_t is a perfmon_t that monitors events that have a
  * starting and ending time. When something starts, call begin(); when
  * something ends, call end() with the same value as begin. It will produce
  * stats for the number of active events, the average length of an event, and
- * so on. If `global_full_perfmon` is false, it won't report any timing-related
- * stats because `get_ticks()` is rather slow.
+ * so on, including percentiles of the length. If `global_full_perfmon` is false,
+ * it won't report any timing-related stats because `get_ticks()` is rather slow.
  *
  * Frequently we're in the case where we'd like to have a single slow perfmon
  * up, but don't want the other ones, perfmon_duration_sampler_t has an
@@ -234,9 +264,11 @@ private:
     perfmon_counter_t active;
     perfmon_counter_t total;
     perfmon_sampler_t recent;
+    perfmon_latency_sampler_t recent_latency;
     perfmon_membership_t active_membership;
     perfmon_membership_t total_membership;
     perfmon_membership_t recent_membership;
+    perfmon_membership_t recent_latency_membership;
 
     bool ignore_global_full_perfmon;
 public:
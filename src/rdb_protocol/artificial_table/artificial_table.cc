@@ -337,6 +337,16 @@ ql::datum_t artificial_table_t::write_batched_insert(
     return std::move(obj_builder).to_datum();
 }
 
+ql::datum_t artificial_table_t::write_range_delete(
+        UNUSED ql::env_t *env,
+        UNUSED const ql::datum_range_t &range,
+        UNUSED durability_requirement_t durability,
+        UNUSED ignore_write_hook_t ignore_write_hook) {
+    /* The backend has no notion of ranges, so the rows have to be deleted one by one
+    through `write_batched_replace()`. */
+    return ql::datum_t();
+}
+
 bool artificial_table_t::write_sync_depending_on_durability(
         ql::env_t *env,
         UNUSED durability_requirement_t durability) {
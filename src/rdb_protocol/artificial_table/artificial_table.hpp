@@ -79,6 +79,11 @@ public:
         return_changes_t return_changes,
         durability_requirement_t durability,
         ignore_write_hook_t ignore_write_hook);
+    ql::datum_t write_range_delete(
+        ql::env_t *env,
+        const ql::datum_range_t &range,
+        durability_requirement_t durability,
+        ignore_write_hook_t ignore_write_hook);
     bool write_sync_depending_on_durability(
         ql::env_t *env,
         durability_requirement_t durability);
@@ -278,8 +278,10 @@ bool caching_cfeed_artificial_table_backend_t::caching_machinery_t::get_values(
 timer_cfeed_artificial_table_backend_t::timer_cfeed_artificial_table_backend_t(
         name_string_t const &table_name,
         rdb_context_t *rdb_context,
-        lifetime_t<name_resolver_t const &> name_resolver)
-    : caching_cfeed_artificial_table_backend_t(table_name, rdb_context, name_resolver) {
+        lifetime_t<name_resolver_t const &> name_resolver,
+        int64_t _interval_ms)
+    : caching_cfeed_artificial_table_backend_t(table_name, rdb_context, name_resolver),
+      interval_ms(_interval_ms) {
 }
 
 scoped_ptr_t<cfeed_artificial_table_backend_t::machinery_t>
@@ -297,7 +299,7 @@ caching_cfeed_artificial_table_backend_t::construct_changefeed_machinery(
 void timer_cfeed_artificial_table_backend_t::set_notifications(bool notify) {
     if (notify && !timer.has()) {
         timer.init(new repeating_timer_t(
-            1000,
+            interval_ms,
             [this]() { notify_all(); }
             ));
     }
@@ -107,7 +107,8 @@ private:
 };
 
 /* `timer_cfeed_artificial_table_backend_t` implements changefeeds by simply setting a
-repeating timer and retrieving the contents of the table every time the timer rings. It's
+repeating timer and retrieving the contents of the table every time the timer rings, every
+`interval_ms` milliseconds. Only the rows that changed get sent to the changefeeds. It's
 inefficient, but for many tables it's the most practical choice. */
 class timer_cfeed_artificial_table_backend_t :
     public caching_cfeed_artificial_table_backend_t {
@@ -115,10 +116,12 @@ public:
     timer_cfeed_artificial_table_backend_t(
             name_string_t const &table_name,
             rdb_context_t *rdb_context,
-            lifetime_t<name_resolver_t const &> name_resolver);
+            lifetime_t<name_resolver_t const &> name_resolver,
+            int64_t interval_ms = 1000);
 
 private:
     void set_notifications(bool);
+    const int64_t interval_ms;
     scoped_ptr_t<repeating_timer_t> timer;
 };
 
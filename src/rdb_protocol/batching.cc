@@ -175,6 +175,28 @@ batchspec_t batchspec_t::with_at_most(uint64_t raw_max_els) const {
         start_time);
 }
 
+batchspec_t batchspec_t::with_slow_start(int64_t batches_sent) const {
+    r_sanity_check(batches_sent >= 1);
+    if (batch_type != batch_type_t::NORMAL || batches_sent >= 63) {
+        return *this;
+    }
+    const int64_t divisor = first_scaledown_factor >> batches_sent;
+    if (divisor <= 1) {
+        return *this;
+    }
+    int64_t new_max_els =
+        max_els == std::numeric_limits<decltype(batchspec_t().max_els)>::max()
+            ? max_els
+            : std::max(min_els, max_els / divisor);
+    int64_t new_max_size =
+        max_size == std::numeric_limits<decltype(batchspec_t().max_size)>::max()
+            ? max_size
+            : std::max<int64_t>(1, max_size / divisor);
+    return batchspec_t(batch_type, min_els, new_max_els, new_max_size,
+                       first_scaledown_factor, kiloticks_t{max_dur.micros / divisor},
+                       start_time);
+}
+
 batchspec_t batchspec_t::with_lazy_sorting_override(sorting_t sort) const {
     batchspec_t ret = *this;
     ret.lazy_sorting_override.set(sort);
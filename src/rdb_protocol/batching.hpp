@@ -88,6 +88,10 @@ public:
     batchspec_t with_min_els(int64_t new_min_els) const;
     batchspec_t with_max_dur(kiloticks_t new_max_dur) const;
     batchspec_t with_at_most(uint64_t max_els) const;
+    // For the `NORMAL` batches that follow a `NORMAL_FIRST` one.  Instead of jumping
+    // straight to the full limits, they grow back to them like TCP slow start, by
+    // halving the first batch's scaledown factor with every batch sent.
+    batchspec_t with_slow_start(int64_t batches_sent) const;
 
     // These are used to allow batchspecs to override the default ordering on a
     // stream.  This is only really useful when a stream is being treated as a
@@ -16,7 +16,9 @@
 #include "buffer_cache/serialize_onto_blob.hpp"
 #include "concurrency/coro_pool.hpp"
 #include "concurrency/new_mutex.hpp"
+#include "concurrency/pmap.hpp"
 #include "concurrency/queue/unlimited_fifo.hpp"
+#include "config/args.hpp"
 #include "containers/archive/boost_types.hpp"
 #include "containers/archive/buffer_group_stream.hpp"
 #include "containers/archive/buffer_stream.hpp"
@@ -86,6 +88,18 @@ void detach_rdb_value(buf_parent_t parent, const void *value) {
     blob.detach_subtrees(parent);
 }
 
+void record_bytes_read(btree_slice_t *slice, int64_t bytes) {
+    slice->stats.pm_bytes_read.record(bytes);
+    slice->stats.pm_total_bytes_read += bytes;
+}
+
+// `value_ref` is the reference to a new value as in `rdb_modification_info_t`.
+void record_bytes_written(btree_slice_t *slice, const std::vector<char> &value_ref) {
+    const int64_t bytes = blob::value_size(value_ref.data(), blob::btree_maxreflen);
+    slice->stats.pm_bytes_written.record(bytes);
+    slice->stats.pm_total_bytes_written += bytes;
+}
+
 void rdb_get(const store_key_t &store_key, btree_slice_t *slice,
              superblock_t *superblock, point_read_response_t *response,
              profile::trace_t *trace) {
@@ -98,8 +112,9 @@ void rdb_get(const store_key_t &store_key, btree_slice_t *slice,
     if (!kv_location.value.has()) {
         response->data = ql::datum_t::null();
     } else {
-        response->data = get_data(static_cast<rdb_value_t *>(kv_location.value.get()),
-                                  buf_parent_t(&kv_location.buf));
+        const rdb_value_t *value = kv_location.value_as<rdb_value_t>();
+        record_bytes_read(slice, value->value_size());
+        response->data = get_data(value, buf_parent_t(&kv_location.buf));
     }
 }
 
@@ -293,6 +308,7 @@ batched_replace_response_t rdb_replace_and_return_superblock(
             if (new_val.get_type() != ql::datum_t::R_NULL) {
                 guarantee(!mod_info_out->added.second.empty());
                 mod_info_out->added.first = new_val;
+                record_bytes_written(info.btree->slice, mod_info_out->added.second);
             } else {
                 guarantee(mod_info_out->added.second.empty());
             }
@@ -375,6 +391,15 @@ ql::datum_t btree_batched_replacer_t::apply_write_hook(
     return res;
 }
 
+threadnum_t btree_batched_replacer_t::evaluation_thread(size_t index) {
+    const int others = get_num_threads() - 1;
+    if (others == 0) {
+        return get_thread_id();
+    }
+    const int thread = index % others;
+    return threadnum_t(thread < get_thread_id().threadnum ? thread : thread + 1);
+}
+
 class one_replace_t : public btree_point_replacer_t {
 public:
     one_replace_t(const btree_batched_replacer_t *_replacer, size_t _index)
@@ -469,9 +494,30 @@ batched_replace_response_t rdb_batched_replace(
         // write operations depending on the presence of limit changefeeds.
         scoped_ptr_t<real_superblock_t> current_superblock(superblock->release());
         bool update_pkey_cfeeds = sindex_cb->has_pkey_cfeeds(keys);
+        // Every replace descends from the root on its own, right behind the one
+        // before it.  If we go through the keys in order, consecutive replaces take
+        // the same path down to the same leaves, so each of them finds the nodes
+        // it needs already in memory and write-acquired just before it, instead of
+        // every one of them going to a different part of the tree.  We keep the
+        // order of the batch if the changes have to be returned, since they are
+        // returned in the order of the replaces.  The sort is stable, so that
+        // repeated keys are still replaced in order.  We don't sort either if the
+        // replacer evaluates functions on other threads: each replace holds its leaf
+        // while its function gets evaluated, so the functions can only run in
+        // parallel if consecutive replaces go to different leaves.
+        std::vector<size_t> order(keys.size());
+        for (size_t i = 0; i < keys.size(); ++i) {
+            order[i] = i;
+        }
+        if (replacer->should_return_changes() == return_changes_t::NO
+                && !replacer->evaluates_on_other_threads()) {
+            std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+                return keys[a] < keys[b];
+            });
+        }
         {
             auto_drainer_t drainer;
-            for (size_t i = 0; i < keys.size(); ++i) {
+            for (size_t i : order) {
                 promise_t<superblock_t *> superblock_promise;
                 coro_queue.push(
                     std::bind(
@@ -550,6 +596,7 @@ void rdb_set(const store_key_t &key,
         r_sanity_check(!ql::bad(res));
         guarantee(mod_info->deleted.second.empty() == !had_value &&
                   !mod_info->added.second.empty());
+        record_bytes_written(slice, mod_info->added.second);
     }
     response_out->result =
         (had_value ? point_write_result_t::DUPLICATE : point_write_result_t::STORED);
@@ -735,6 +782,193 @@ private:
     optional<std::string> skey_left;
 };
 
+// Reads the pairs for a set of primary keys in one traversal, skipping the subtrees
+// and the keys that aren't in the set.
+class rget_keys_cb_wrapper_t : public concurrent_traversal_callback_t {
+public:
+    rget_keys_cb_wrapper_t(
+            rget_cb_t *_cb,
+            const std::map<store_key_t, uint64_t> *_keys)
+        : cb(_cb), keys(_keys) { }
+    virtual void filter_range(
+            const btree_key_t *left_excl_or_null,
+            const btree_key_t *right_incl,
+            bool *skip_out) {
+        auto it = left_excl_or_null == nullptr
+            ? keys->begin()
+            : keys->upper_bound(store_key_t(left_excl_or_null));
+        *skip_out = it == keys->end()
+            || btree_key_cmp(it->first.btree_key(), right_incl) > 0;
+    }
+    virtual void filter_key(const btree_key_t *key, bool *skip_out) {
+        *skip_out = keys->count(store_key_t(key)) == 0;
+    }
+    virtual continue_bool_t handle_pair(
+        scoped_key_value_t &&keyvalue,
+        concurrent_traversal_fifo_enforcer_signal_t waiter)
+        THROWS_ONLY(interrupted_exc_t) {
+        auto it = keys->find(store_key_t(keyvalue.key()));
+        guarantee(it != keys->end());
+        return cb->handle_pair(
+            std::move(keyvalue),
+            it->second,
+            r_nullopt,
+            std::move(waiter));
+    }
+private:
+    rget_cb_t *cb;
+    const std::map<store_key_t, uint64_t> *keys;
+};
+
+// Reads the pairs for a set of secondary index values in one traversal, skipping the
+// subtrees and the keys that aren't in the index key range of any of the values.
+// `ranges` must be sorted and must not overlap.
+class rget_sindex_keys_cb_wrapper_t : public concurrent_traversal_callback_t {
+public:
+    rget_sindex_keys_cb_wrapper_t(
+            rget_cb_t *_cb,
+            const std::vector<key_range_t> *_ranges,
+            const std::map<std::string, uint64_t> *_copies)
+        : cb(_cb), ranges(_ranges), copies(_copies) { }
+    virtual void filter_range(
+            const btree_key_t *left_excl_or_null,
+            const btree_key_t *right_incl,
+            bool *skip_out) {
+        auto it = left_excl_or_null == nullptr
+            ? ranges->begin()
+            : first_range_after(store_key_t(left_excl_or_null));
+        *skip_out = it == ranges->end()
+            || btree_key_cmp(it->left.btree_key(), right_incl) > 0;
+    }
+    virtual void filter_key(const btree_key_t *key, bool *skip_out) {
+        store_key_t store_key(key);
+        auto it = first_range_after(store_key);
+        *skip_out = it == ranges->end() || !it->contains_key(store_key);
+    }
+    virtual continue_bool_t handle_pair(
+        scoped_key_value_t &&keyvalue,
+        concurrent_traversal_fifo_enforcer_signal_t waiter)
+        THROWS_ONLY(interrupted_exc_t) {
+        std::string skey = ql::datum_t::extract_secondary(
+            key_to_unescaped_str(store_key_t(keyvalue.key())));
+        // A key with a truncated index value can be in the range of a value that its
+        // row doesn't have.  `rget_cb_t` computes the index value to find out.
+        auto it = copies->find(skey);
+        return cb->handle_pair(
+            std::move(keyvalue),
+            it == copies->end() ? 0 : it->second,
+            make_optional(std::move(skey)),
+            std::move(waiter));
+    }
+private:
+    // Returns the first range that ends after `key`.
+    std::vector<key_range_t>::const_iterator first_range_after(
+            const store_key_t &key) const {
+        return std::upper_bound(
+            ranges->begin(), ranges->end(), key,
+            [](const store_key_t &k, const key_range_t &range) {
+                return range.right.unbounded || k < range.right.key();
+            });
+    }
+
+    rget_cb_t *cb;
+    const std::vector<key_range_t> *ranges;
+    const std::map<std::string, uint64_t> *copies;
+};
+
+// The size of the part of the secondary index key `key` that holds the key of the
+// first element of an array index value, including the null byte after it, or 0 if we
+// can't tell where that is.
+size_t skip_scan_prefix_size(const btree_key_t *key) {
+    // Everything before `max_trunc_size()` belongs to the index value, even if it got
+    // truncated.  The first byte is the type prefix of the array, with its top bit set
+    // (see `tag_skey_version`).  We don't look into leading elements that are arrays.
+    const size_t limit = std::min<size_t>(key->size, ql::datum_t::max_trunc_size());
+    if (limit < 3 || (key->contents[0] & 0x7f) != 'A' || key->contents[1] == 'A') {
+        return 0;
+    }
+    const void *end = memchr(key->contents + 1, '\0', limit - 1);
+    return end == nullptr
+        ? 0
+        : static_cast<const uint8_t *>(end) - key->contents + 1;
+}
+
+// Compares the part of `key` after `prefix_size` to `tail_key`, as far as that tells
+// how the elements after the first of the index value compare to those of a bound.
+// Returns 0 if it doesn't tell.
+int skip_scan_tail_cmp(const btree_key_t *key,
+                       size_t prefix_size,
+                       const std::string &tail_key) {
+    const size_t limit = std::min<size_t>(key->size, ql::datum_t::max_trunc_size());
+    const size_t n = std::min(limit - prefix_size, tail_key.size());
+    return memcmp(key->contents + prefix_size, tail_key.data(), n);
+}
+
+// Reads a skip-scan range (see `datum_range_t::with_skip_scan()`) of a secondary index,
+// skipping the keys and subtrees in which the elements after the first of the index
+// values are outside of the range, without loading their rows.  The index key of an
+// array starts with the key of its first element, and the keys with the same first
+// element are ordered by the keys of the other elements.  So when both ends of a
+// subtree start with the same first element, all of its keys do, and if the rest of
+// its right end is less than the left bound, or the rest of its left end greater than
+// the right bound, none of them are in the range.
+class rget_skip_scan_cb_wrapper_t : public concurrent_traversal_callback_t {
+public:
+    rget_skip_scan_cb_wrapper_t(
+            rget_cb_t *_cb,
+            size_t _copies,
+            optional<std::string> _skey_left,
+            std::string _left_tail_key,
+            std::string _right_tail_key)
+        : cb(_cb),
+          copies(_copies),
+          skey_left(std::move(_skey_left)),
+          left_tail_key(std::move(_left_tail_key)),
+          right_tail_key(std::move(_right_tail_key)) { }
+    virtual void filter_range(
+            const btree_key_t *left_excl_or_null,
+            const btree_key_t *right_incl,
+            bool *skip_out) {
+        *skip_out = false;
+        if (left_excl_or_null == nullptr) {
+            return;
+        }
+        const size_t prefix_size = skip_scan_prefix_size(right_incl);
+        if (prefix_size == 0
+            || skip_scan_prefix_size(left_excl_or_null) != prefix_size
+            || memcmp(left_excl_or_null->contents,
+                      right_incl->contents,
+                      prefix_size) != 0) {
+            return;
+        }
+        *skip_out =
+            skip_scan_tail_cmp(right_incl, prefix_size, left_tail_key) < 0
+            || skip_scan_tail_cmp(left_excl_or_null, prefix_size, right_tail_key) > 0;
+    }
+    virtual void filter_key(const btree_key_t *key, bool *skip_out) {
+        const size_t prefix_size = skip_scan_prefix_size(key);
+        *skip_out = prefix_size != 0
+            && (skip_scan_tail_cmp(key, prefix_size, left_tail_key) < 0
+                || skip_scan_tail_cmp(key, prefix_size, right_tail_key) > 0);
+    }
+    virtual continue_bool_t handle_pair(
+        scoped_key_value_t &&keyvalue,
+        concurrent_traversal_fifo_enforcer_signal_t waiter)
+        THROWS_ONLY(interrupted_exc_t) {
+        return cb->handle_pair(
+            std::move(keyvalue),
+            copies,
+            skey_left,
+            std::move(waiter));
+    }
+private:
+    rget_cb_t *cb;
+    size_t copies;
+    optional<std::string> skey_left;
+    const std::string left_tail_key;
+    const std::string right_tail_key;
+};
+
 rget_cb_t::rget_cb_t(rget_io_data_t &&_io,
                      job_data_t &&_job,
                      optional<rget_sindex_data_t> &&_sindex)
@@ -784,18 +1018,145 @@ continue_bool_t rget_cb_t::handle_pair(
     if (sindex && !sindex->pkey_range.contains_key(ql::datum_t::extract_primary(key))) {
         return continue_bool_t::CONTINUE;
     }
-    lazy_btree_val_t row(static_cast<const rdb_value_t *>(keyvalue.value()),
-                         keyvalue.expose_buf());
+    // Check whether we're outside the sindex range.
+    // We only need to check this if we are on the boundary of the sindex range, and
+    // the involved keys are truncated.  In that case we have to compute the sindex
+    // value, which has to wait for exclusive access.  Otherwise we can tell how many
+    // copies of the row there are from the key alone.
+    bool must_check_copies = false;
+    size_t unchecked_copies = default_copies;
+    if (sindex) {
+        /* Here's an attempt at explaining the different case distinctions handled in
+           this check (for the left bound; the right bound check is similar):
+           The case distinctions are as follows:
+           1. left_bound_is_truncated
+            If the left bound key had to be truncated, we first compare the prefix of
+            the current secondary key (skey_current), and the left bound key.
+            The comparison cannot be -1, because that would mean that we computed the
+            traversal key range incorrectly in the first place (there's no need to
+            consider keys that are *smaller* than the left bound).
+            If the comparison is 1, the current key's secondary part is larger than
+            the left bound, and we know that the corresponding datum_t value must
+            also be larger than the datum_t corresponding to the left bound.
+            Finally, since the left bound is truncated, the comparison can determine
+            that the prefix is equal for values in the btree with corresponding index
+            values that are either left of the bound (but match in the truncated
+            prefix), at the bound (which we want to include only if the left bound is
+            closed), or right of the bound (which we always want to include, as far
+            as the left bound id concerned). We can't determine which case we have,
+            by looking only at the keys. Hence we must check the number of copies for
+            `cmp == 0`. The only exception is if the current key was actually not
+            truncated, in which case we know that it will actually be smaller than
+            the left bound (that's encoded in line 825).
+           2. !left_bound_is_truncated && left_bound is closed
+            If the bound wasn't truncated, we know that the traversal range will not
+            include any values which are smaller than the left bound. Hence we can
+            skip the check for whether the sindex value is actually in the datum
+            range.
+           3. !left_bound_is_truncated && left_bound is open
+            In contrast, if the left bound is open, we compare the left bound and
+            current key. If they have the same size and their contents compare equal,
+            we actually know that they are outside the range and could set the number
+            of copies to 0. We do the slightly less optimal but simpler thing and
+            just check the number of copies in this case, so that we can share the
+            code path with case 1. */
+        const size_t max_trunc_size = ql::datum_t::max_trunc_size();
+        sindex->datumspec.visit<void>(
+        [&](const ql::datum_range_t &r) {
+            if (r.is_skip_scan()) {
+                // Whether a row is in a skip-scan range doesn't only depend on where
+                // its key is in the key range.
+                must_check_copies = true;
+                return;
+            }
+            std::string skey_current =
+                ql::datum_t::extract_truncated_secondary(key_to_unescaped_str(key));
+            const bool left_bound_is_truncated =
+                sindex->lbound_trunc_key.size() == max_trunc_size;
+            if (left_bound_is_truncated
+                || r.left_bound_type == key_range_t::bound_t::open) {
+                int cmp = memcmp(
+                    skey_current.data(),
+                    sindex->lbound_trunc_key.data(),
+                    std::min<size_t>(skey_current.size(),
+                                     sindex->lbound_trunc_key.size()));
+                if (skey_current.size() < sindex->lbound_trunc_key.size()) {
+                    guarantee(cmp != 0);
+                }
+                guarantee(cmp >= 0);
+                if (cmp == 0
+                    && skey_current.size() == sindex->lbound_trunc_key.size()) {
+                    must_check_copies = true;
+                }
+            }
+            if (!must_check_copies) {
+                const bool right_bound_is_truncated =
+                    sindex->rbound_trunc_key.size() == max_trunc_size;
+                if (right_bound_is_truncated
+                    || r.right_bound_type == key_range_t::bound_t::open) {
+                    int cmp = memcmp(
+                        skey_current.data(),
+                        sindex->rbound_trunc_key.data(),
+                        std::min<size_t>(skey_current.size(),
+                                         sindex->rbound_trunc_key.size()));
+                    if (skey_current.size() > sindex->rbound_trunc_key.size()) {
+                        guarantee(cmp != 0);
+                    }
+                    guarantee(cmp <= 0);
+                    if (cmp == 0
+                        && skey_current.size() == sindex->rbound_trunc_key.size()) {
+                        must_check_copies = true;
+                    }
+                }
+            }
+            if (!must_check_copies) {
+                unchecked_copies = 1;
+            }
+        },
+        [&](const std::map<ql::datum_t, uint64_t> &) {
+            guarantee(skey_left);
+            std::string skey_current =
+                ql::datum_t::extract_secondary(key_to_unescaped_str(key));
+            const bool skey_current_is_truncated =
+                skey_current.size() >= max_trunc_size;
+            const bool skey_left_is_truncated = skey_left->size() >= max_trunc_size;
+
+            if (skey_current_is_truncated || skey_left_is_truncated) {
+                must_check_copies = true;
+            } else if (*skey_left != skey_current) {
+                unchecked_copies = 0;
+            }
+        });
+    }
+
+    const rdb_value_t *rdb_value = static_cast<const rdb_value_t *>(keyvalue.value());
+    lazy_btree_val_t row(rdb_value, keyvalue.expose_buf());
     ql::datum_t val;
     // Count stats whether or not we deserialize the value
     io.slice->stats.pm_keys_read.record();
     io.slice->stats.pm_total_keys_read += 1;
-    // We only load the value if we actually use it (`count` does not).
-    if (job.accumulator->uses_val() || job.transformers.size() != 0 || sindex) {
+    record_bytes_read(io.slice, rdb_value->value_size());
+    // We only load the value if we actually use it (`count` does not).  The rows of
+    // a secondary index are whole copies of the documents, so this also holds for
+    // counts over secondary index ranges, unless we need the sindex value.
+    if (job.accumulator->uses_val() || job.transformers.size() != 0
+        || must_check_copies) {
         val = row.get();
     } else {
         row.reset();
     }
+    // If the first transformation is a filter whose function compiled to a
+    // `term_program_t`, we run it here, so that rows get filtered concurrently.
+    bool first_transformer_done = false;
+    bool filtered_out = false;
+    if (val.has() && !job.transformers.empty()
+        && job.env->profile() == profile_bool_t::DONT_PROFILE) {
+        bool keep;
+        if (job.transformers[0]->try_filter_without_env(val, &keep)) {
+            first_transformer_done = true;
+            filtered_out = !keep;
+        }
+    }
     guarantee(!row.references_parent());
     keyvalue.reset();
     waiter.wait_interruptible(); // This enforces ordering.
@@ -856,6 +1217,7 @@ continue_bool_t rget_cb_t::handle_pair(
         ql::datum_t sindex_val_cache; // an empty `datum_t` until initialized
         auto lazy_sindex_val = [&]() -> ql::datum_t {
             if (sindex && !sindex_val_cache.has()) {
+                r_sanity_check(val.has());
                 sindex_val_cache =
                     sindex->func->call(sindex_env.get(), val)->as_datum();
                 if (sindex->multi == sindex_multi_bool_t::MULTI
@@ -868,119 +1230,32 @@ continue_bool_t rget_cb_t::handle_pair(
             return sindex_val_cache;
         };
 
-        // Check whether we're outside the sindex range.
-        // We only need to check this if we are on the boundary of the sindex range, and
-        // the involved keys are truncated.
+        // See above for when we have to check how many copies of the row are in the
+        // sindex range.
         size_t copies = default_copies;
         if (sindex) {
-            /* Here's an attempt at explaining the different case distinctions handled in
-               this check (for the left bound; the right bound check is similar):
-               The case distinctions are as follows:
-               1. left_bound_is_truncated
-                If the left bound key had to be truncated, we first compare the prefix of
-                the current secondary key (skey_current), and the left bound key.
-                The comparison cannot be -1, because that would mean that we computed the
-                traversal key range incorrectly in the first place (there's no need to
-                consider keys that are *smaller* than the left bound).
-                If the comparison is 1, the current key's secondary part is larger than
-                the left bound, and we know that the corresponding datum_t value must
-                also be larger than the datum_t corresponding to the left bound.
-                Finally, since the left bound is truncated, the comparison can determine
-                that the prefix is equal for values in the btree with corresponding index
-                values that are either left of the bound (but match in the truncated
-                prefix), at the bound (which we want to include only if the left bound is
-                closed), or right of the bound (which we always want to include, as far
-                as the left bound id concerned). We can't determine which case we have,
-                by looking only at the keys. Hence we must check the number of copies for
-                `cmp == 0`. The only exception is if the current key was actually not
-                truncated, in which case we know that it will actually be smaller than
-                the left bound (that's encoded in line 825).
-               2. !left_bound_is_truncated && left_bound is closed
-                If the bound wasn't truncated, we know that the traversal range will not
-                include any values which are smaller than the left bound. Hence we can
-                skip the check for whether the sindex value is actually in the datum
-                range.
-               3. !left_bound_is_truncated && left_bound is open
-                In contrast, if the left bound is open, we compare the left bound and
-                current key. If they have the same size and their contents compare equal,
-                we actually know that they are outside the range and could set the number
-                of copies to 0. We do the slightly less optimal but simpler thing and
-                just check the number of copies in this case, so that we can share the
-                code path with case 1. */
-            const size_t max_trunc_size = ql::datum_t::max_trunc_size();
-            sindex->datumspec.visit<void>(
-            [&](const ql::datum_range_t &r) {
-                bool must_check_copies = false;
-                std::string skey_current =
-                    ql::datum_t::extract_truncated_secondary(key_to_unescaped_str(key));
-                const bool left_bound_is_truncated =
-                    sindex->lbound_trunc_key.size() == max_trunc_size;
-                if (left_bound_is_truncated
-                    || r.left_bound_type == key_range_t::bound_t::open) {
-                    int cmp = memcmp(
-                        skey_current.data(),
-                        sindex->lbound_trunc_key.data(),
-                        std::min<size_t>(skey_current.size(),
-                                         sindex->lbound_trunc_key.size()));
-                    if (skey_current.size() < sindex->lbound_trunc_key.size()) {
-                        guarantee(cmp != 0);
-                    }
-                    guarantee(cmp >= 0);
-                    if (cmp == 0
-                        && skey_current.size() == sindex->lbound_trunc_key.size()) {
-                        must_check_copies = true;
-                    }
-                }
-                if (!must_check_copies) {
-                    const bool right_bound_is_truncated =
-                        sindex->rbound_trunc_key.size() == max_trunc_size;
-                    if (right_bound_is_truncated
-                        || r.right_bound_type == key_range_t::bound_t::open) {
-                        int cmp = memcmp(
-                            skey_current.data(),
-                            sindex->rbound_trunc_key.data(),
-                            std::min<size_t>(skey_current.size(),
-                                             sindex->rbound_trunc_key.size()));
-                        if (skey_current.size() > sindex->rbound_trunc_key.size()) {
-                            guarantee(cmp != 0);
-                        }
-                        guarantee(cmp <= 0);
-                        if (cmp == 0
-                            && skey_current.size() == sindex->rbound_trunc_key.size()) {
-                            must_check_copies = true;
-                        }
-                    }
-                }
-                if (must_check_copies) {
-                    copies = sindex->datumspec.copies(lazy_sindex_val());
-                } else {
-                    copies = 1;
-                }
-            },
-            [&](const std::map<ql::datum_t, uint64_t> &) {
-                guarantee(skey_left);
-                std::string skey_current =
-                    ql::datum_t::extract_secondary(key_to_unescaped_str(key));
-                const bool skey_current_is_truncated =
-                    skey_current.size() >= max_trunc_size;
-                const bool skey_left_is_truncated = skey_left->size() >= max_trunc_size;
-
-                if (skey_current_is_truncated || skey_left_is_truncated) {
-                    copies = sindex->datumspec.copies(lazy_sindex_val());
-                } else if (*skey_left != skey_current) {
-                    copies = 0;
-                }
-            });
+            copies = must_check_copies
+                ? sindex->datumspec.copies(lazy_sindex_val())
+                : unchecked_copies;
             if (copies == 0) {
                 return continue_bool_t::CONTINUE;
             }
         }
 
-        ql::groups_t data = {{ql::datum_t(), ql::datums_t(copies, val)}};
+        ql::groups_t data = {{ql::datum_t(),
+                              filtered_out ? ql::datums_t() : ql::datums_t(copies, val)}};
 
-        for (auto it = job.transformers.begin(); it != job.transformers.end(); ++it) {
+        for (auto it = job.transformers.begin() + (first_transformer_done ? 1 : 0);
+             it != job.transformers.end();
+             ++it) {
             (**it)(job.env, &data, lazy_sindex_val);
         }
+        size_t returned = 0;
+        for (const auto &group : data) {
+            returned += group.second.size();
+        }
+        io.slice->stats.pm_keys_returned.record(returned);
+        io.slice->stats.pm_total_keys_returned += returned;
         // We need lots of extra data for the accumulation because we might be
         // accumulating `rget_item_t`s for a batch.
         continue_bool_t cont = (*job.accumulator)(job.env, &data, key, lazy_sindex_val);
@@ -1041,40 +1316,30 @@ void rdb_rget_slice(
         r_nullopt);
 
     direction_t direction = reversed(sorting) ? BACKWARD : FORWARD;
-    continue_bool_t cont = continue_bool_t::CONTINUE;
+    // Subranges wait for the ones before them while holding on to their blocks,
+    // which would deadlock with writers unless the read sees a snapshot.
+    const int scan_concurrency = superblock->expose_buf().is_snapshotted()
+        ? BTREE_SCAN_CONCURRENCY : 1;
+    continue_bool_t cont;
     if (primary_keys.has_value()) {
-        auto cb = [&](const std::pair<store_key_t, uint64_t> &pair, bool is_last) {
-            rget_cb_wrapper_t wrapper(&callback, pair.second, r_nullopt);
-            return btree_concurrent_traversal(
-                superblock,
-                key_range_t::one_key(pair.first),
-                &wrapper,
-                direction,
-                is_last ? release_superblock : release_superblock_t::KEEP);
-        };
-        if (!reversed(sorting)) {
-            for (auto it = primary_keys->begin(); it != primary_keys->end();) {
-                auto this_it = it++;
-                if (cb(*this_it, it == primary_keys->end()) == continue_bool_t::ABORT) {
-                    // If required the superblock will get released further up the stack.
-                    cont = continue_bool_t::ABORT;
-                    break;
-                }
-            }
+        if (primary_keys->empty()) {
+            // If required the superblock will get released further up the stack.
+            cont = continue_bool_t::CONTINUE;
         } else {
-            for (auto it = primary_keys->rbegin(); it != primary_keys->rend();) {
-                auto this_it = it++;
-                if (cb(*this_it, it == primary_keys->rend()) == continue_bool_t::ABORT) {
-                    // If required the superblock will get released further up the stack.
-                    cont = continue_bool_t::ABORT;
-                    break;
-                }
-            }
+            // Going through the keys in one traversal visits each block at most once,
+            // instead of walking down from the root for each key.
+            rget_keys_cb_wrapper_t wrapper(&callback, &*primary_keys);
+            cont = btree_concurrent_traversal(
+                superblock,
+                key_range_t(key_range_t::closed, primary_keys->begin()->first,
+                            key_range_t::closed, primary_keys->rbegin()->first),
+                &wrapper, direction, release_superblock, scan_concurrency);
         }
     } else {
         rget_cb_wrapper_t wrapper(&callback, 1, r_nullopt);
         cont = btree_concurrent_traversal(
-            superblock, range, &wrapper, direction, release_superblock);
+            superblock, range, &wrapper, direction, release_superblock,
+            scan_concurrency);
     }
     callback.finish(cont);
 }
@@ -1127,6 +1392,59 @@ void rdb_rget_secondary_slice(
             sindex_info.multi)));
 
     direction_t direction = reversed(sorting) ? BACKWARD : FORWARD;
+
+    // Going through the keys of a `get_all` in one traversal visits each block at most
+    // once, instead of walking down from the root for each index value.
+    std::vector<key_range_t> multi_key_ranges;
+    std::map<std::string, uint64_t> multi_key_copies;
+    datumspec.visit<void>(
+        [](const ql::datum_range_t &) { },
+        [&](const std::map<ql::datum_t, uint64_t> &m) {
+            if (m.size() < 2) {
+                return;
+            }
+            for (const auto &pair : m) {
+                key_range_t sindex_keyrange = ql::datum_range_t(pair.first)
+                    .to_sindex_keyrange(sindex_func_reql_version);
+                multi_key_copies.insert(std::make_pair(
+                    key_to_unescaped_str(sindex_keyrange.left), pair.second));
+                multi_key_ranges.push_back(std::move(sindex_keyrange));
+            }
+        });
+    if (!multi_key_ranges.empty()) {
+        // The ranges of values whose keys got truncated can overlap.
+        std::sort(multi_key_ranges.begin(), multi_key_ranges.end(),
+                  [](const key_range_t &a, const key_range_t &b) {
+                      return a.left < b.left;
+                  });
+        std::vector<key_range_t> merged_ranges;
+        for (const key_range_t &range : multi_key_ranges) {
+            if (!merged_ranges.empty()
+                && (merged_ranges.back().right.unbounded
+                    || !(merged_ranges.back().right.key() < range.left))) {
+                if (range.right.unbounded
+                    || (!merged_ranges.back().right.unbounded
+                        && merged_ranges.back().right.key() < range.right.key())) {
+                    merged_ranges.back().right = range.right;
+                }
+            } else {
+                merged_ranges.push_back(range);
+            }
+        }
+        key_range_t covering_range = merged_ranges.front();
+        covering_range.right = merged_ranges.back().right;
+        covering_range = active_region_range.intersection(covering_range);
+        continue_bool_t cont = continue_bool_t::CONTINUE;
+        if (!covering_range.is_empty()) {
+            rget_sindex_keys_cb_wrapper_t wrapper(
+                &callback, &merged_ranges, &multi_key_copies);
+            cont = btree_concurrent_traversal(
+                superblock, covering_range, &wrapper, direction, release_superblock);
+        }
+        callback.finish(cont);
+        return;
+    }
+
     auto cb = [&](const std::pair<ql::datum_range_t, uint64_t> &pair, bool is_last) {
         key_range_t sindex_keyrange =
             pair.first.to_sindex_keyrange(sindex_func_reql_version);
@@ -1137,6 +1455,23 @@ void rdb_rget_secondary_slice(
         key_range_t active_range = active_region_range.intersection(sindex_keyrange);
         // This can happen sometimes with truncated keys.
         if (active_range.is_empty()) return continue_bool_t::CONTINUE;
+        std::string left_tail_key, right_tail_key;
+        if (pair.first.is_skip_scan()
+            && pair.first.get_skip_scan_tail_keys(
+                sindex_func_reql_version, &left_tail_key, &right_tail_key)) {
+            rget_skip_scan_cb_wrapper_t skip_scan_wrapper(
+                &callback,
+                pair.second,
+                make_optional(key_to_unescaped_str(sindex_keyrange.left)),
+                std::move(left_tail_key),
+                std::move(right_tail_key));
+            return btree_concurrent_traversal(
+                superblock,
+                active_range,
+                &skip_scan_wrapper,
+                direction,
+                is_last ? release_superblock : release_superblock_t::KEEP);
+        }
         return btree_concurrent_traversal(
             superblock,
             active_range,
@@ -1663,7 +1998,8 @@ void deserialize_sindex_info(
     case cluster_version_t::v2_2:
     case cluster_version_t::v2_3:
     case cluster_version_t::v2_4:
-    case cluster_version_t::v2_5_is_latest:
+    case cluster_version_t::v2_5:
+    case cluster_version_t::v2_6_is_latest:
         success = deserialize_reql_version(
                 &read_stream,
                 &info_out->mapping_version_info.original_reql_version,
@@ -1701,7 +2037,8 @@ void deserialize_sindex_info(
     case cluster_version_t::v2_2: // fallthru
     case cluster_version_t::v2_3: // fallthru
     case cluster_version_t::v2_4: // fallthru
-    case cluster_version_t::v2_5_is_latest:
+    case cluster_version_t::v2_5: // fallthru
+    case cluster_version_t::v2_6_is_latest:
         success = deserialize_for_version(cluster_version, &read_stream, &info_out->geo);
         throw_if_bad_deserialization(success, "sindex description");
         break;
@@ -1735,6 +2072,44 @@ void deserialize_sindex_info_or_crash(
         });
 }
 
+/* Sets `keys` of the secondary index with the superblock `superblock` to `value`,
+the serialized value of the row. */
+void set_sindex_keys(
+        sindex_superblock_t *superblock,
+        const std::vector<std::pair<store_key_t, ql::datum_t> > &keys,
+        const std::vector<char> &value,
+        const deletion_context_t *deletion_context,
+        profile::trace_t *trace) {
+    for (auto it = keys.begin(); it != keys.end(); ++it) {
+        promise_t<superblock_t *> return_superblock_local;
+        {
+            keyvalue_location_t kv_location;
+
+            rdb_value_sizer_t sizer(superblock->cache()->max_block_size());
+            find_keyvalue_location_for_write(
+                &sizer,
+                superblock,
+                it->first.btree_key(),
+                repli_timestamp_t::distant_past,
+                deletion_context->balancing_detacher(),
+                &kv_location,
+                trace,
+                &return_superblock_local);
+
+            ql::serialization_result_t res =
+                kv_location_set(&kv_location, it->first,
+                                value,
+                                repli_timestamp_t::distant_past,
+                                deletion_context);
+            // this particular context cannot fail AT THE MOMENT.
+            guarantee(!bad(res));
+            // The keyvalue location gets destroyed here.
+        }
+        superblock = static_cast<sindex_superblock_t *>(
+            return_superblock_local.wait());
+    }
+}
+
 /* Used below by rdb_update_sindexes. */
 void rdb_update_single_sindex(
         store_t *store,
@@ -1770,6 +2145,14 @@ void rdb_update_single_sindex(
 
     auto cserver = store->changefeed_server(modification->primary_key);
 
+    // No view can be started while we hold the index's superblock for write.  But one
+    // that gets dropped while we update the index can be replaced by a new one whose
+    // snapshot already holds our changes, so we only apply them to the view we saw.
+    const optional<uint64_t> count_view_build_id =
+        store->sindex_count_view_build_id(sindex->sindex.id);
+    const bool has_count_view = count_view_build_id.has_value();
+    std::vector<ql::datum_t> removed_values, added_values;
+
     if (modification->info.deleted.first.has()) {
         guarantee(!modification->info.deleted.second.empty());
         try {
@@ -1779,6 +2162,11 @@ void rdb_update_single_sindex(
             compute_keys(
                 modification->primary_key, deleted, sindex_info,
                 &keys, cfeed_old_keys_out);
+            if (has_count_view) {
+                for (const auto &pair : keys) {
+                    removed_values.push_back(pair.second);
+                }
+            }
             if (cserver.first != nullptr) {
                 cserver.first->foreach_limit(
                     make_optional(sindex->name.name),
@@ -1825,6 +2213,8 @@ void rdb_update_single_sindex(
                 superblock =
                     static_cast<sindex_superblock_t *>(return_superblock_local.wait());
             }
+            store->btree->stats.pm_sindex_keys_updated.record(keys.size());
+            store->btree->stats.pm_total_sindex_keys_updated += keys.size();
         } catch (const ql::base_exc_t &) {
             // Do nothing (it wasn't actually in the index).
 
@@ -1848,6 +2238,11 @@ void rdb_update_single_sindex(
             compute_keys(
                 modification->primary_key, added, sindex_info,
                 &keys, cfeed_new_keys_out);
+            if (has_count_view) {
+                for (const auto &pair : keys) {
+                    added_values.push_back(pair.second);
+                }
+            }
             if (keys_available_cond != nullptr) {
                 guarantee(*updates_left > 0);
                 decremented_updates_left = true;
@@ -1872,34 +2267,10 @@ void rdb_update_single_sindex(
                         }
                     }, cserver.second);
             }
-            for (auto it = keys.begin(); it != keys.end(); ++it) {
-                promise_t<superblock_t *> return_superblock_local;
-                {
-                    keyvalue_location_t kv_location;
-
-                    rdb_value_sizer_t sizer(superblock->cache()->max_block_size());
-                    find_keyvalue_location_for_write(
-                        &sizer,
-                        superblock,
-                        it->first.btree_key(),
-                        repli_timestamp_t::distant_past,
-                        deletion_context->balancing_detacher(),
-                        &kv_location,
-                        trace,
-                        &return_superblock_local);
-
-                    ql::serialization_result_t res =
-                        kv_location_set(&kv_location, it->first,
-                                        modification->info.added.second,
-                                        repli_timestamp_t::distant_past,
-                                        deletion_context);
-                    // this particular context cannot fail AT THE MOMENT.
-                    guarantee(!bad(res));
-                    // The keyvalue location gets destroyed here.
-                }
-                superblock = static_cast<sindex_superblock_t *>(
-                    return_superblock_local.wait());
-            }
+            set_sindex_keys(superblock, keys, modification->info.added.second,
+                            deletion_context, trace);
+            store->btree->stats.pm_sindex_keys_updated.record(keys.size());
+            store->btree->stats.pm_total_sindex_keys_updated += keys.size();
         } catch (const ql::base_exc_t &) {
             // Do nothing (we just drop the row from the index).
 
@@ -1942,6 +2313,11 @@ void rdb_update_single_sindex(
                         sindex->btree, superblock, &sindex_info});
             }, cserver.second);
     }
+
+    if (has_count_view) {
+        store->apply_to_sindex_count_view(
+            sindex->sindex.id, *count_view_build_id, removed_values, added_values);
+    }
 }
 
 void rdb_update_sindexes(
@@ -1953,6 +2329,7 @@ void rdb_update_sindexes(
     cond_t *keys_available_cond,
     index_vals_t *cfeed_old_keys_out,
     index_vals_t *cfeed_new_keys_out) {
+    const ticks_t start_time = get_ticks();
 
     rdb_noop_deletion_context_t noop_deletion_context;
     {
@@ -2003,6 +2380,11 @@ void rdb_update_sindexes(
         }
     }
 
+    if (!sindexes.empty()) {
+        store->btree->stats.pm_sindex_update_latency.record(
+            ticks_t{get_ticks().nanos - start_time.nanos});
+    }
+
     /* All of the sindex have been updated now it's time to actually clear the
      * deleted blob if it exists. */
     if (modification->info.deleted.first.has()) {
@@ -2011,6 +2393,188 @@ void rdb_update_sindexes(
     }
 }
 
+// One key that `rdb_update_sindex_batch` adds to or deletes from an index.
+struct sindex_key_update_t {
+    store_key_t key;
+    // The report whose added value goes into the index, or null for a deletion.
+    const rdb_modification_report_t *added;
+};
+
+void rdb_update_sindex_batch(
+        store_t *store,
+        const store_t::sindex_access_t *sindex,
+        const std::vector<rdb_modification_report_t> &mod_reports,
+        const deletion_context_t *deletion_context) {
+    // Limit changefeeds on the index have to see every report separately.
+    bool has_limits = false;
+    for (const auto &report : mod_reports) {
+        auto cserver = store->changefeed_server(report.primary_key);
+        if (cserver.first != nullptr
+            && cserver.first->has_limit(make_optional(sindex->name.name),
+                                        cserver.second)) {
+            has_limits = true;
+            break;
+        }
+    }
+    if (has_limits) {
+        auto_drainer_t drainer;
+        for (const auto &report : mod_reports) {
+            if (!sindex->sindex.needs_post_construction_range.contains_key(
+                    report.primary_key)) {
+                size_t updates_left = 0;
+                rdb_update_single_sindex(store, sindex, deletion_context, &report,
+                                         &updates_left, auto_drainer_t::lock_t(&drainer),
+                                         nullptr, nullptr, nullptr);
+            }
+        }
+        return;
+    }
+
+    sindex_disk_info_t sindex_info;
+    try {
+        deserialize_sindex_info_or_crash(sindex->sindex.opaque_definition, &sindex_info);
+    } catch (const archive_exc_t &e) {
+        crash("%s", e.what());
+    }
+
+    // See `rdb_update_single_sindex`.
+    const optional<uint64_t> count_view_build_id =
+        store->sindex_count_view_build_id(sindex->sindex.id);
+    const bool has_count_view = count_view_build_id.has_value();
+    std::vector<ql::datum_t> removed_values, added_values;
+
+    std::vector<sindex_key_update_t> updates;
+    std::vector<std::pair<store_key_t, ql::datum_t> > keys;
+    for (const auto &report : mod_reports) {
+        guarantee(report.primary_key.size() != 0);
+        if (sindex->sindex.needs_post_construction_range.contains_key(
+                report.primary_key)) {
+            continue;
+        }
+        if (report.info.deleted.first.has()) {
+            guarantee(!report.info.deleted.second.empty());
+            keys.clear();
+            try {
+                compute_keys(report.primary_key, report.info.deleted.first, sindex_info,
+                             &keys, nullptr);
+                for (auto &&pair : keys) {
+                    if (has_count_view) {
+                        removed_values.push_back(std::move(pair.second));
+                    }
+                    updates.push_back(
+                        sindex_key_update_t{std::move(pair.first), nullptr});
+                }
+            } catch (const ql::base_exc_t &) {
+                // Do nothing (it wasn't actually in the index).
+            }
+        }
+        // See `rdb_update_single_sindex` for why we don't add to indexes that are
+        // being deleted.
+        if (!sindex->sindex.being_deleted && report.info.added.first.has()) {
+            keys.clear();
+            try {
+                compute_keys(report.primary_key, report.info.added.first, sindex_info,
+                             &keys, nullptr);
+                for (auto &&pair : keys) {
+                    if (has_count_view) {
+                        added_values.push_back(std::move(pair.second));
+                    }
+                    updates.push_back(
+                        sindex_key_update_t{std::move(pair.first), &report});
+                }
+            } catch (const ql::base_exc_t &) {
+                // Do nothing (we just drop the row from the index).
+            }
+        }
+    }
+
+    // Neighboring keys share the nodes on their path, so we get to visit each node
+    // once (and usually find it in the cache) instead of once per report.  The sort
+    // is stable so that the updates of a key still happen in the order of the
+    // reports.
+    std::stable_sort(updates.begin(), updates.end(),
+                     [](const sindex_key_update_t &a, const sindex_key_update_t &b) {
+                         return a.key < b.key;
+                     });
+    store->btree->stats.pm_sindex_keys_updated.record(updates.size());
+    store->btree->stats.pm_total_sindex_keys_updated += updates.size();
+
+    superblock_t *superblock = sindex->superblock.get();
+    for (const auto &update : updates) {
+        promise_t<superblock_t *> return_superblock_local;
+        {
+            keyvalue_location_t kv_location;
+            rdb_value_sizer_t sizer(superblock->cache()->max_block_size());
+            find_keyvalue_location_for_write(
+                &sizer,
+                superblock,
+                update.key.btree_key(),
+                repli_timestamp_t::distant_past,
+                deletion_context->balancing_detacher(),
+                &kv_location,
+                nullptr,
+                &return_superblock_local);
+            if (update.added != nullptr) {
+                ql::serialization_result_t res =
+                    kv_location_set(&kv_location, update.key,
+                                    update.added->info.added.second,
+                                    repli_timestamp_t::distant_past,
+                                    deletion_context);
+                // this particular context cannot fail AT THE MOMENT.
+                guarantee(!bad(res));
+            } else if (kv_location.value.has()) {
+                kv_location_delete(
+                    &kv_location,
+                    update.key,
+                    repli_timestamp_t::distant_past,
+                    deletion_context,
+                    delete_mode_t::REGULAR_QUERY,
+                    nullptr);
+            }
+            // The keyvalue location gets destroyed here.
+        }
+        superblock = return_superblock_local.wait();
+    }
+
+    if (has_count_view) {
+        store->apply_to_sindex_count_view(
+            sindex->sindex.id, *count_view_build_id, removed_values, added_values);
+    }
+}
+
+void rdb_update_sindexes_batch(
+        store_t *store,
+        const store_t::sindex_access_vector_t &sindexes,
+        const std::vector<rdb_modification_report_t> &mod_reports,
+        txn_t *txn,
+        const deletion_context_t *deletion_context) {
+    const ticks_t start_time = get_ticks();
+    rdb_noop_deletion_context_t noop_deletion_context;
+    pmap(sindexes.size(), [&](size_t i) {
+        // See `rdb_update_sindexes` for why we need the noop deletion context.
+        rdb_update_sindex_batch(
+            store,
+            sindexes[i].get(),
+            mod_reports,
+            sindexes[i]->sindex.post_construction_complete()
+                ? deletion_context
+                : &noop_deletion_context);
+    });
+    if (!sindexes.empty()) {
+        store->btree->stats.pm_sindex_update_latency.record(
+            ticks_t{get_ticks().nanos - start_time.nanos});
+    }
+
+    /* All of the sindex have been updated now it's time to actually clear the
+     * deleted blobs if they exist. */
+    for (const auto &report : mod_reports) {
+        if (report.info.deleted.first.has()) {
+            deletion_context->post_deleter()->delete_value(buf_parent_t(txn),
+                    report.info.deleted.second.data());
+        }
+    }
+}
+
 class post_construct_traversal_helper_t : public concurrent_traversal_callback_t {
 public:
     post_construct_traversal_helper_t(
@@ -2053,37 +2617,50 @@ public:
         store_->btree->stats.pm_keys_read.record();
         store_->btree->stats.pm_total_keys_read += 1;
 
-        // Grab the key and value and construct a modification report for the key/value
-        // pair.
+        // Grab the key and value of the pair.
         const store_key_t primary_key(keyvalue.key());
         const rdb_value_t *rdb_value =
             static_cast<const rdb_value_t *>(keyvalue.value());
-        rdb_modification_report_t mod_report(primary_key);
         const max_block_size_t block_size =
             keyvalue.expose_buf().cache()->max_block_size();
-        mod_report.info.added
-            = std::make_pair(
-                get_data(rdb_value, buf_parent_t(keyvalue.expose_buf())),
-                std::vector<char>(rdb_value->value_ref(),
-                    rdb_value->value_ref() + rdb_value->inline_size(block_size)));
+        const ql::datum_t doc =
+            get_data(rdb_value, buf_parent_t(keyvalue.expose_buf()));
+        const std::vector<char> value(
+            rdb_value->value_ref(),
+            rdb_value->value_ref() + rdb_value->inline_size(block_size));
+
+        // We compute the index keys before we wait for the write transaction, so
+        // that the pairs that `btree_concurrent_traversal` hands us at the same time
+        // get their index functions evaluated while other pairs are being written.
+        // (JavaScript index functions even get evaluated in parallel in the extproc
+        // pool.)
+        std::map<uuid_u, std::vector<std::pair<store_key_t, ql::datum_t> > > keys;
+        for (const auto &pair : sindex_infos_) {
+            std::vector<std::pair<store_key_t, ql::datum_t> > sindex_keys;
+            try {
+                compute_keys(primary_key, doc, pair.second, &sindex_keys, nullptr);
+            } catch (const ql::base_exc_t &) {
+                // We just drop the row from the index.
+                continue;
+            }
+            keys[pair.first] = std::move(sindex_keys);
+        }
 
         // Store the value into the secondary indexes
         {
             // We need this mutex because we don't want `wtxn` to be destructed,
-            // but also because only one coroutine can be traversing the indexes
-            // through `rdb_update_sindexes` at a time (or else the btree will get
-            // corrupted!).
+            // but also because only one coroutine can be writing to the indexes at a
+            // time (or else the btree will get corrupted!).
             new_mutex_acq_t wtxn_acq(&wtxn_lock_, interruptor_);
             guarantee(wtxn_.has());
             const rdb_post_construction_deletion_context_t deletion_context;
-            rdb_update_sindexes(store_,
-                                sindexes_,
-                                &mod_report,
-                                wtxn_.get(),
-                                &deletion_context,
-                                nullptr,
-                                nullptr,
-                                nullptr);
+            pmap(sindexes_.size(), [&](size_t i) {
+                auto it = keys.find(sindexes_[i]->sindex.id);
+                if (it != keys.end()) {
+                    set_sindex_keys(sindexes_[i]->superblock.get(), it->second, value,
+                                    &deletion_context, nullptr);
+                }
+            });
         }
 
         // Account for the sindex writes in the stats
@@ -2174,6 +2751,16 @@ private:
         guarantee(sindexes_.empty());
         for (auto &&access : all_sindexes) {
             if (!access->sindex.being_deleted) {
+                if (sindex_infos_.count(access->sindex.id) == 0) {
+                    sindex_disk_info_t info;
+                    try {
+                        deserialize_sindex_info_or_crash(
+                            access->sindex.opaque_definition, &info);
+                    } catch (const archive_exc_t &e) {
+                        crash("%s", e.what());
+                    }
+                    sindex_infos_[access->sindex.id] = std::move(info);
+                }
                 sindexes_.emplace_back(std::move(access));
             }
         }
@@ -2212,6 +2799,10 @@ private:
     // are already live will also be delayed.
     scoped_ptr_t<txn_t> wtxn_;
     store_t::sindex_access_vector_t sindexes_;
+    // The definitions of the indexes in `sindexes_`, so that we only deserialize
+    // them once.  A definition never changes, and only the first call to
+    // `start_write_transaction` adds to this, so it can be used without the lock.
+    std::map<uuid_u, sindex_disk_info_t> sindex_infos_;
     int current_chunk_size_;
     // Controls access to `sindexes_` and `wtxn_`.
     new_mutex_t wtxn_lock_;
@@ -14,6 +14,7 @@
 #include "rdb_protocol/func.hpp"
 #include "rdb_protocol/protocol.hpp"
 #include "rdb_protocol/store.hpp"
+#include "threading.hpp"
 
 class btree_slice_t;
 enum class delete_mode_t;
@@ -96,6 +97,9 @@ struct btree_batched_replacer_t {
     virtual ql::datum_t replace(
         const ql::datum_t &d, size_t index) const = 0;
     virtual return_changes_t should_return_changes() const = 0;
+    // True if `replace()` evaluates (deterministic) ReQL functions on other threads,
+    // so that the functions for the rows of a batch get evaluated in parallel.
+    virtual bool evaluates_on_other_threads() const { return false; }
 
     ql::datum_t apply_write_hook(
         const datum_string_t &pkey,
@@ -103,6 +107,11 @@ struct btree_batched_replacer_t {
         const ql::datum_t &res_,
         const ql::datum_t &write_timestamp,
         const counted_t<const ql::func_t> &write_hook) const;
+
+protected:
+    // The thread to evaluate the functions for the `index`th row of the batch on.  The
+    // rows are spread over the threads other than ours, which is busy with the btree.
+    static threadnum_t evaluation_thread(size_t index);
 };
 struct btree_point_replacer_t {
     virtual ~btree_point_replacer_t() { }
@@ -337,6 +346,15 @@ void rdb_update_sindexes(
     index_vals_t *old_keys_out,
     index_vals_t *new_keys_out);
 
+/* Like calling `rdb_update_sindexes` for every report in `mod_reports`, but it
+computes all the keys of an index first, and then updates them in sorted order. */
+void rdb_update_sindexes_batch(
+    store_t *store,
+    const store_t::sindex_access_vector_t &sindexes,
+    const std::vector<rdb_modification_report_t> &mod_reports,
+    txn_t *txn,
+    const deletion_context_t *deletion_context);
+
 void post_construct_secondary_index_range(
         store_t *store,
         const std::set<uuid_u> &sindexes_to_post_construct,
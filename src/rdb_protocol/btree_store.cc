@@ -2,6 +2,7 @@
 #include "rdb_protocol/store.hpp"  // NOLINT(build/include_order)
 
 #include <functional>  // NOLINT(build/include_order)
+#include <limits>  // NOLINT(build/include_order)
 
 #include "arch/runtime/coroutines.hpp"
 #include "btree/depth_first_traversal.hpp"
@@ -12,6 +13,7 @@
 #include "buffer_cache/alt.hpp"
 #include "buffer_cache/cache_balancer.hpp"
 #include "clustering/administration/issues/outdated_index.hpp"
+#include "clustering/immediate_consistency/foreground_latency.hpp"
 #include "concurrency/wait_any.hpp"
 #include "containers/archive/buffer_stream.hpp"
 #include "containers/archive/vector_stream.hpp"
@@ -22,6 +24,7 @@
 #include "rdb_protocol/btree.hpp"
 #include "rdb_protocol/erase_range.hpp"
 #include "rdb_protocol/protocol.hpp"
+#include "rdb_protocol/pseudo_time.hpp"
 #include "stl_utils.hpp"
 
 // The maximal number of writes that can be in line for a superblock acquisition
@@ -94,6 +97,7 @@ store_t::store_t(const region_t &_region,
       perfmon_collection_membership(parent_perfmon_collection, &perfmon_collection, perfmon_name),
       ctx(_ctx),
       table_id(_table_id),
+      next_sindex_count_view_build_id(0),
       write_superblock_acq_semaphore(WRITE_SUPERBLOCK_ACQ_WAITERS_LIMIT)
 {
     cache.init(new cache_t(serializer, balancer, &perfmon_collection, which_cpu_shard));
@@ -170,6 +174,8 @@ store_t::store_t(const region_t &_region,
     switch (_update_sindexes) {
     case update_sindexes_t::UPDATE:
         help_construct_bring_sindexes_up_to_date();
+        coro_t::spawn_sometime(std::bind(&store_t::compact_cold_leaves,
+                                         this, drainer.lock()));
         break;
     case update_sindexes_t::LEAVE_ALONE:
         break;
@@ -191,15 +197,27 @@ void store_t::read(
         signal_t *interruptor)
         THROWS_ONLY(interrupted_exc_t) {
     assert_thread();
+    const ticks_t start_time = get_ticks();
     scoped_ptr_t<txn_t> txn;
     scoped_ptr_t<real_superblock_t> superblock;
 
     acquire_superblock_for_read(token, &txn, &superblock,
                                 interruptor,
                                 _read.use_snapshot());
+    // Any write that has to drop an entry of the cache before we could insert our
+    // result acquires the superblock after us, so it changes the generation.
+    const uint64_t result_cache_generation = read_result_cache.generation();
+    const ticks_t acquired_time = get_ticks();
     DEBUG_ONLY_CODE(metainfo->visit(
         superblock.get(), metainfo_checker.region, metainfo_checker.callback));
-    protocol_read(_read, response, superblock.get(), interruptor);
+    protocol_read(_read, response, superblock.get(), result_cache_generation,
+                  interruptor);
+    if (_read.profile == profile_bool_t::PROFILE) {
+        profile::add_shard_sample(&response->event_log,
+            "Wait for the superblock on shard.",
+            ticks_t{acquired_time.nanos - start_time.nanos});
+    }
+    record_foreground_latency(start_time);
 }
 
 void store_t::write(
@@ -214,6 +232,7 @@ void store_t::write(
         signal_t *interruptor)
         THROWS_ONLY(interrupted_exc_t) {
     assert_thread();
+    const ticks_t start_time = get_ticks();
 
     scoped_ptr_t<txn_t> txn;
     scoped_ptr_t<real_superblock_t> real_superblock;
@@ -221,6 +240,8 @@ void store_t::write(
     const int expected_change_count = 2 + _write.expected_document_changes();
     acquire_superblock_for_write(expected_change_count, durability, token,
                                  &txn, &real_superblock, interruptor);
+    read_result_cache.invalidate(_write);
+    const ticks_t acquired_time = get_ticks();
     DEBUG_ONLY_CODE(metainfo->visit(
         real_superblock.get(), metainfo_checker.region, metainfo_checker.callback));
     metainfo->update(real_superblock.get(), new_metainfo);
@@ -235,8 +256,18 @@ void store_t::write(
         txn->commit();
         throw;
     }
+    const ticks_t commit_start_time = get_ticks();
     real_superblock.reset();
     txn->commit();
+    if (_write.profile == profile_bool_t::PROFILE) {
+        profile::add_shard_sample(&response->event_log,
+            "Wait for the superblock on shard.",
+            ticks_t{acquired_time.nanos - start_time.nanos});
+        profile::add_shard_sample(&response->event_log,
+            "Commit the write on shard.",
+            ticks_t{get_ticks().nanos - commit_start_time.nanos});
+    }
+    record_foreground_latency(start_time);
 }
 
 void store_t::reset_data(
@@ -266,6 +297,7 @@ void store_t::reset_data(
                                      &txn,
                                      &superblock,
                                      interruptor);
+        read_result_cache.invalidate(subregion.inner);
 
         buf_lock_t sindex_block(superblock->expose_buf(),
                                 superblock->get_sindex_block_id(),
@@ -358,6 +390,88 @@ std::map<std::string, std::pair<sindex_config_t, sindex_status_t> > store_t::sin
     return results;
 }
 
+/* Collects the primary keys out of a secondary index traversal, and stops once it has
+enough of them. */
+class expired_keys_traversal_cb_t : public depth_first_traversal_callback_t {
+public:
+    expired_keys_traversal_cb_t(size_t max_keys, std::vector<store_key_t> *keys_out)
+        : max_keys_(max_keys), keys_out_(keys_out) { }
+
+    continue_bool_t handle_pair(
+            scoped_key_value_t &&keyvalue,
+            UNUSED signal_t *interruptor) {
+        if (keys_out_->size() >= max_keys_) {
+            return continue_bool_t::ABORT;
+        }
+        keys_out_->push_back(
+            ql::datum_t::extract_primary(store_key_t(keyvalue.key())));
+        return keys_out_->size() >= max_keys_
+            ? continue_bool_t::ABORT
+            : continue_bool_t::CONTINUE;
+    }
+
+private:
+    size_t max_keys_;
+    std::vector<store_key_t> *keys_out_;
+};
+
+void store_t::get_expired_keys(
+        const std::string &sindex,
+        double cutoff,
+        size_t max_keys,
+        std::vector<store_key_t> *keys_out,
+        signal_t *interruptor)
+        THROWS_ONLY(interrupted_exc_t) {
+    assert_thread();
+    keys_out->clear();
+    if (max_keys == 0) {
+        return;
+    }
+
+    scoped_ptr_t<real_superblock_t> superblock;
+    scoped_ptr_t<txn_t> txn;
+    get_btree_superblock_and_txn_for_reading(general_cache_conn.get(),
+        CACHE_SNAPSHOTTED_NO, &superblock, &txn);
+
+    scoped_ptr_t<sindex_superblock_t> sindex_sb;
+    std::vector<char> opaque_definition;
+    uuid_u sindex_uuid;
+    try {
+        bool found = acquire_sindex_superblock_for_read(
+            sindex_name_t(sindex), "", superblock.get(), &sindex_sb,
+            &opaque_definition, &sindex_uuid);
+        if (!found) {
+            return;
+        }
+    } catch (const sindex_not_ready_exc_t &) {
+        return;
+    }
+
+    sindex_disk_info_t disk_info;
+    try {
+        deserialize_sindex_info_or_crash(opaque_definition, &disk_info);
+    } catch (const archive_exc_t &) {
+        crash("corrupted sindex definition");
+    }
+    if (disk_info.multi == sindex_multi_bool_t::MULTI
+            || disk_info.geo == sindex_geo_bool_t::GEO) {
+        return;
+    }
+
+    /* Times sort by their epoch time in the index, so the expired rows are the ones
+    from the start of the times up to the cutoff. */
+    key_range_t range = ql::datum_range_t(
+            ql::pseudo::make_time(std::numeric_limits<double>::lowest(), "+00:00"),
+            key_range_t::closed,
+            ql::pseudo::make_time(cutoff, "+00:00"),
+            key_range_t::open)
+        .to_sindex_keyrange(disk_info.mapping_version_info.latest_compatible_reql_version);
+
+    expired_keys_traversal_cb_t cb(max_keys, keys_out);
+    btree_depth_first_traversal(sindex_sb.get(), range, &cb, access_t::read,
+        direction_t::FORWARD, release_superblock_t::RELEASE, interruptor);
+}
+
 void store_t::sindex_create(
         const std::string &name,
         const sindex_config_t &config,
@@ -419,6 +533,8 @@ void store_t::sindex_rename_multi(
     buf_lock_t sindex_block(superblock->expose_buf(),
                             superblock->get_sindex_block_id(),
                             access_t::write);
+    // Reads name the index they use, so we can't tell which results still match.
+    read_result_cache.invalidate_all();
     superblock->release();
 
     /* First we remove all the secondary indexes and hide their perfmons, but put the
@@ -466,6 +582,7 @@ void store_t::sindex_drop(
     buf_lock_t sindex_block(superblock->expose_buf(),
                             superblock->get_sindex_block_id(),
                             access_t::write);
+    read_result_cache.invalidate_all();
     superblock->release();
 
     secondary_index_t sindex;
@@ -491,6 +608,10 @@ void store_t::configure_flush_interval(flush_interval_t interval) {
     cache->configure_flush_interval(interval);
 }
 
+void store_t::configure_cache_quota(cache_quota_t quota) {
+    cache->configure_quota(quota);
+}
+
 new_mutex_in_line_t store_t::get_in_line_for_sindex_queue(buf_lock_t *sindex_block) {
     assert_thread();
     // The line for the sindex queue is there to guarantee that we push things to
@@ -564,16 +685,7 @@ void store_t::update_sindexes(
         }
 
         rdb_live_deletion_context_t deletion_context;
-        for (size_t i = 0; i < mod_reports.size(); ++i) {
-            rdb_update_sindexes(this,
-                                sindexes,
-                                &mod_reports[i],
-                                txn,
-                                &deletion_context,
-                                NULL,
-                                NULL,
-                                NULL);
-        }
+        rdb_update_sindexes_batch(this, sindexes, mod_reports, txn, &deletion_context);
     }
 
     // Write mod reports onto the sindex queue. We are in line for the
@@ -826,7 +938,65 @@ void store_t::clear_sindex_data(
     }
 }
 
+sindex_count_view_t *store_t::sindex_count_view(uuid_u sindex_id) {
+    assert_thread();
+    auto it = sindex_count_views.find(sindex_id);
+    return it == sindex_count_views.end() ? nullptr : it->second.get();
+}
+
+optional<uint64_t> store_t::sindex_count_view_build_id(uuid_u sindex_id) {
+    sindex_count_view_t *view = sindex_count_view(sindex_id);
+    return view == nullptr ? r_nullopt : make_optional(view->get_build_id());
+}
+
+void store_t::apply_to_sindex_count_view(uuid_u sindex_id,
+                                         uint64_t build_id,
+                                         const std::vector<ql::datum_t> &removed,
+                                         const std::vector<ql::datum_t> &added) {
+    assert_thread();
+    auto it = sindex_count_views.find(sindex_id);
+    if (it == sindex_count_views.end() || it->second->get_build_id() != build_id) {
+        return;
+    }
+    it->second->apply(removed, added);
+    if (!it->second->is_valid()) {
+        // Nothing can use the view anymore, and keeping it around would make every
+        // write compute its changes for nothing.  The next read builds a new one.
+        sindex_count_views.erase(it);
+    }
+}
+
+uint64_t store_t::start_sindex_count_view(uuid_u sindex_id) {
+    assert_thread();
+    uint64_t build_id = next_sindex_count_view_build_id++;
+    sindex_count_views[sindex_id].init(new sindex_count_view_t(build_id));
+    return build_id;
+}
+
+void store_t::finish_sindex_count_view(uuid_u sindex_id,
+                                       uint64_t build_id,
+                                       ql::grouped_t<uint64_t> *counts) {
+    assert_thread();
+    sindex_count_view_t *view = sindex_count_view(sindex_id);
+    if (view != nullptr && view->get_build_id() == build_id && view->is_building()) {
+        view->finish_building(counts);
+        if (!view->is_valid()) {
+            sindex_count_views.erase(sindex_id);
+        }
+    }
+}
+
+void store_t::drop_sindex_count_view(uuid_u sindex_id, optional<uint64_t> build_id) {
+    assert_thread();
+    auto it = sindex_count_views.find(sindex_id);
+    if (it != sindex_count_views.end()
+        && (!build_id.has_value() || it->second->get_build_id() == *build_id)) {
+        sindex_count_views.erase(it);
+    }
+}
+
 void store_t::drop_sindex(uuid_u sindex_id) THROWS_NOTHING {
+    drop_sindex_count_view(sindex_id, r_nullopt);
     /* Start a transaction. */
     write_token_t token;
     new_write_token(&token);
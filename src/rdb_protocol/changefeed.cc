@@ -9,6 +9,8 @@
 #include "concurrency/cross_thread_signal.hpp"
 #include "concurrency/interruptor.hpp"
 #include "containers/archive/boost_types.hpp"
+#include "containers/archive/string_stream.hpp"
+#include "perfmon/memory.hpp"
 #include "rdb_protocol/artificial_table/backend.hpp"
 #include "rdb_protocol/btree.hpp"
 #include "rdb_protocol/env.hpp"
@@ -16,6 +18,7 @@
 #include "rdb_protocol/geo/intersection.hpp"
 #include "rdb_protocol/protocol.hpp"
 #include "rdb_protocol/response.hpp"
+#include "rdb_protocol/serialize_datum.hpp"
 #include "rdb_protocol/val.hpp"
 #include "rpc/mailbox/typed.hpp"
 
@@ -73,7 +76,9 @@ struct change_val_t {
           pkey(_pkey),
           old_val(std::move(_old_val)),
           new_val(std::move(_new_val))
-          DEBUG_ONLY(, sindex(std::move(_sindex))) {
+          DEBUG_ONLY(, sindex(std::move(_sindex))),
+          tracked_memory(memory_tag_t::changefeed_queues,
+                         pkey.size() + val_size(old_val) + val_size(new_val)) {
         guarantee(old_val || new_val);
         if (old_val && new_val) {
             guarantee(static_cast<bool>(old_val->btree_index_key)
@@ -86,8 +91,18 @@ struct change_val_t {
     optional<indexed_datum_t> old_val;
     optional<indexed_datum_t> new_val;
     DEBUG_ONLY(optional<std::string> sindex;);
+    // Changes only live for long in the queues of the subscriptions, so this is what
+    // the changefeed queues account for.
+    tracked_memory_t tracked_memory;
 
     MOVABLE_BUT_NOT_COPYABLE(change_val_t);
+
+private:
+    static size_t val_size(const optional<indexed_datum_t> &val) {
+        return val
+            ? datum_serialized_size(val->val, check_datum_serialization_errors_t::NO)
+            : 0;
+    }
 };
 
 namespace debug {
@@ -311,7 +326,8 @@ optional<datum_t> apply_ops(
 }
 
 server_t::client_info_t::client_info_t()
-    : limit_clients(),
+    : only_squashing_subs(true),
+      limit_clients(),
       limit_clients_lock(new rwlock_t()) { }
 
 server_t::server_t(mailbox_manager_t *_manager, store_t *_parent)
@@ -515,9 +531,91 @@ void server_t::send_one_with_lock(
         ASSERT_NO_CORO_WAITING;
         stamp = client->second.stamp++;
     }
+    // The client would wait for the batched changes anyway, because they have
+    // lower stamps.
+    flush_batched_changes(client->first);
     send(manager, client->first, stamped_msg_t(uuid, stamp, std::move(msg)));
 }
 
+bool server_t::batch_change(
+        const client_t::addr_t &addr,
+        uint64_t stamp,
+        const msg_t::change_t &change,
+        bool coalesce,
+        const auto_drainer_t::lock_t &keepalive) {
+    keepalive.assert_is_holding(&drainer);
+    auto it = batched_changes.find(addr);
+    if (it == batched_changes.end()) {
+        it = batched_changes.insert(std::make_pair(addr, pending_changes_t())).first;
+        // This runs after the writes that are running now had a chance to add
+        // their changes to the batch.
+        coro_t::spawn_sometime(
+            std::bind(&server_t::flush_batched_changes_cb, this, addr, keepalive));
+    }
+    pending_changes_t *pending = &it->second;
+    std::vector<std::pair<uint64_t, msg_t::change_t> > *changes =
+        &pending->batch.changes;
+    auto pos = coalesce
+        ? pending->positions.find(change.pkey)
+        : pending->positions.end();
+    if (pos == pending->positions.end()) {
+        if (coalesce) {
+            pending->positions[change.pkey] = changes->size();
+        }
+        changes->push_back(std::make_pair(stamp, change));
+    } else {
+        // Every subscription squashes, so it's as if the client had squashed the
+        // two changes together itself.
+        const size_t i = pos->second;
+        std::pair<uint64_t, msg_t::change_t> *prev = &(*changes)[i];
+        pending->batch.skipped_stamps.push_back(prev->first);
+        prev->first = stamp;
+        prev->second.new_indexes = change.new_indexes;
+        prev->second.new_val = change.new_val;
+        if (!prev->second.old_val.has() && !prev->second.new_val.has()) {
+            pending->batch.skipped_stamps.push_back(stamp);
+            pending->positions.erase(pos);
+            if (i + 1 != changes->size()) {
+                (*changes)[i] = std::move(changes->back());
+                auto moved = pending->positions.find((*changes)[i].second.pkey);
+                if (moved != pending->positions.end()
+                    && moved->second + 1 == changes->size()) {
+                    moved->second = i;
+                }
+            }
+            changes->pop_back();
+        }
+    }
+    return changes->size() >= MAX_BATCHED_CHANGES;
+}
+
+void server_t::flush_batched_changes(const client_t::addr_t &addr) {
+    auto it = batched_changes.find(addr);
+    if (it == batched_changes.end()) {
+        return;
+    }
+    // We remove the batch before sending it, because `send` can block.
+    msg_t::change_batch_t batch = std::move(it->second.batch);
+    batched_changes.erase(it);
+    guarantee(!batch.changes.empty() || !batch.skipped_stamps.empty());
+    uint64_t stamp = batch.changes.empty()
+        ? batch.skipped_stamps[0]
+        : batch.changes[0].first;
+    if (batch.changes.size() == 1 && batch.skipped_stamps.empty()) {
+        send(manager, addr,
+             stamped_msg_t(uuid, stamp, msg_t(std::move(batch.changes[0].second))));
+    } else {
+        send(manager, addr, stamped_msg_t(uuid, stamp, msg_t(std::move(batch))));
+    }
+}
+
+void server_t::flush_batched_changes_cb(
+        client_t::addr_t addr,
+        auto_drainer_t::lock_t keepalive) {
+    keepalive.assert_is_holding(&drainer);
+    flush_batched_changes(addr);
+}
+
 void server_t::send_all(
         const msg_t &msg,
         const store_key_t &key,
@@ -528,7 +626,9 @@ void server_t::send_all(
     stamp_spot->write_signal()->wait_lazily_unordered();
 
     rwlock_acq_t acq(&clients_lock, access_t::read);
+    const msg_t::change_t *change = boost::get<msg_t::change_t>(&msg.op);
     std::map<client_t::addr_t, uint64_t> stamps;
+    std::vector<client_t::addr_t> full_batches;
     for (auto &&pair : clients) {
         // We don't need a write lock as long as we make sure the coroutine
         // doesn't block between reading and updating the stamp.
@@ -536,11 +636,25 @@ void server_t::send_all(
         if (std::any_of(pair.second.regions.begin(),
                         pair.second.regions.end(),
                         std::bind(&region_contains_key, ph::_1, std::cref(key)))) {
-            stamps[pair.first] = pair.second.stamp++;
+            uint64_t stamp = pair.second.stamp++;
+            if (change != nullptr) {
+                // We batch the change before releasing the stamp lock, so that the
+                // changes in a batch are in stamp order and `get_stamp` can't run
+                // between stamping a change and batching it.
+                if (batch_change(pair.first, stamp, *change,
+                                 pair.second.only_squashing_subs, keepalive)) {
+                    full_batches.push_back(pair.first);
+                }
+            } else {
+                stamps[pair.first] = stamp;
+            }
         }
     }
     acq.reset();
     stamp_spot->reset(); // Done stamping, no need to hold onto it while we send.
+    for (const auto &addr : full_batches) {
+        flush_batched_changes(addr);
+    }
     for (const auto &pair : stamps) {
         send(manager, pair.first, stamped_msg_t(uuid, pair.second, msg));
     }
@@ -556,6 +670,7 @@ server_t::limit_addr_t server_t::get_limit_stop_addr() {
 
 optional<uint64_t> server_t::get_stamp(
         const client_t::addr_t &addr,
+        bool squash,
         const auto_drainer_t::lock_t &keepalive) {
     keepalive.assert_is_holding(&drainer);
     rwlock_acq_t stamp_acq(&parent->cfeed_stamp_lock, access_t::read);
@@ -564,6 +679,14 @@ optional<uint64_t> server_t::get_stamp(
     if (it == clients.end()) {
         return r_nullopt;
     } else {
+        ASSERT_NO_CORO_WAITING;
+        if (!squash) {
+            it->second.only_squashing_subs = false;
+        }
+        auto batch = batched_changes.find(addr);
+        if (batch != batched_changes.end()) {
+            batch->second.positions.clear();
+        }
         return make_optional(it->second.stamp);
     }
 }
@@ -576,8 +699,8 @@ bool server_t::has_limit(
         const optional<std::string> &sindex_name,
         const auto_drainer_t::lock_t &keepalive) {
     keepalive.assert_is_holding(&drainer);
-    auto spot = make_scoped<rwlock_in_line_t>(&clients_lock, access_t::read);
-    spot->read_signal()->wait_lazily_unordered();
+    rwlock_in_line_t spot(&clients_lock, access_t::read);
+    spot.read_signal()->wait_lazily_unordered();
     for (auto &&client : clients) {
         // We don't need a drainer lock here because we're still holding a read
         // lock on `clients_lock`.
@@ -606,8 +729,8 @@ void server_t::foreach_limit(
                            limit_manager_t *)> f,
         const auto_drainer_t::lock_t &keepalive) THROWS_NOTHING {
     keepalive.assert_is_holding(&drainer);
-    auto spot = make_scoped<rwlock_in_line_t>(&clients_lock, access_t::read);
-    spot->read_signal()->wait_lazily_unordered();
+    rwlock_in_line_t spot(&clients_lock, access_t::read);
+    spot.read_signal()->wait_lazily_unordered();
     for (auto &&client : clients) {
         // We don't need a drainer lock here because we're still holding a read
         // lock on `clients_lock`.
@@ -640,7 +763,7 @@ void server_t::foreach_limit(
                         "The secondary index `%s` was replaced by a different one.",
                         sindex_name->c_str());
                 }
-                f(spot.get(), &lspot, &lc_spot, (*lc).get());
+                f(&spot, &lspot, &lc_spot, (*lc).get());
             } catch (const exc_t &e) {
                 error.set(e);
             }
@@ -872,6 +995,7 @@ limit_manager_t::limit_manager_t(
       spec(std::move(_spec)),
       gt(std::move(_gt)),
       item_queue(gt),
+      spare_queue(gt),
       aborted(false) {
     guarantee(clients_lock->read_signal()->is_pulsed());
 
@@ -941,6 +1065,7 @@ public:
                   const keyspec_t::limit_t *_spec,
                   sorting_t _sorting,
                   optional<item_t> _start,
+                  size_t _n,
                   const item_queue_t *_item_queue)
         : env(_env),
           ops(_ops),
@@ -948,6 +1073,7 @@ public:
           spec(_spec),
           sorting(_sorting),
           start(std::move(_start)),
+          n(_n),
           item_queue(_item_queue) { }
 
     std::vector<item_t> operator()(const primary_ref_t &ref) {
@@ -971,7 +1097,6 @@ public:
         case sorting_t::UNORDERED: // fallthru
         default: unreachable();
         }
-        size_t n = spec->limit - item_queue->size();
         rdb_rget_slice(
             ref.btree,
             region_t(),
@@ -1026,7 +1151,7 @@ public:
                 [](const datum_range_t &) { return true; },
                 [](const std::map<datum_t, uint64_t> &) { return false; }));
         datum_range_t srange = spec->range.datumspec.covering_range();
-        size_t n = spec->limit - item_queue->size();
+        size_t n = this->n;
         if (start) {
             datum_t dstart = start->second.first;
             switch (sorting) {
@@ -1103,18 +1228,44 @@ private:
     const keyspec_t::limit_t *spec;
     sorting_t sorting;
     optional<item_t> start;
+    size_t n;
     const item_queue_t *item_queue;
 };
 
 std::vector<item_t> limit_manager_t::read_more(
     const boost::variant<primary_ref_t, sindex_ref_t> &ref,
-    const optional<item_t> &start) {
+    const optional<item_t> &start,
+    size_t n) {
     guarantee(item_queue.size() < spec.limit);
+    guarantee(spare_queue.size() == 0);
     ref_visitor_t visitor(
-        env.get(), &ops, &region.inner, &spec, spec.range.sorting, start, &item_queue);
+        env.get(), &ops, &region.inner, &spec, spec.range.sorting, start, n,
+        &item_queue);
     return boost::apply_visitor(visitor, ref);
 }
 
+void limit_manager_t::truncate_into_spare(
+    item_queue_t *real_added,
+    std::set<std::string> *real_deleted) {
+    while (item_queue.size() > spec.limit) {
+        auto it = item_queue.begin();
+        item_t item = **it;
+        item_queue.erase(it);
+        auto added_it = real_added->find_id(item.first);
+        if (added_it != real_added->end()) {
+            real_added->erase(added_it);
+        } else {
+            bool inserted = real_deleted->insert(item.first).second;
+            guarantee(inserted);
+        }
+        bool inserted = spare_queue.insert(std::move(item)).second;
+        guarantee(inserted);
+    }
+    // What doesn't fit into `spare_queue` comes after everything in it, so we can
+    // read it again later.
+    spare_queue.truncate_top(spec.limit);
+}
+
 void limit_manager_t::commit(
     rwlock_in_line_t *spot,
     const boost::variant<primary_ref_t, sindex_ref_t> &sindex_ref) THROWS_NOTHING {
@@ -1123,14 +1274,14 @@ void limit_manager_t::commit(
         return;
     }
 
-    // Before we delete anything, we get the boundary between the active set and
-    // the data that didn't make it into the set.  Anything <= that according to
-    // our ordering could never be kicked out of the set because of a read from
-    // disk.
+    // Before we delete anything, we get the boundary between the data in memory
+    // and the data that is only on disk.  Anything <= that according to our
+    // ordering could never be kicked out of the set because of a read from disk.
     optional<item_t> active_boundary;
-    auto item_queue_it = item_queue.begin();
-    if (item_queue_it != item_queue.end()) {
-        active_boundary.set(**item_queue_it);
+    if (spare_queue.size() != 0) {
+        active_boundary.set(**spare_queue.begin());
+    } else if (item_queue.size() != 0) {
+        active_boundary.set(**item_queue.begin());
     }
 
     item_queue_t real_added(gt);
@@ -1140,6 +1291,8 @@ void limit_manager_t::commit(
         if (data_deleted) {
             bool inserted = real_deleted.insert(id).second;
             guarantee(inserted);
+        } else if (spare_queue.del_id(id)) {
+            // The client never saw it, so there's nothing to tell it.
         }
     }
     deleted.clear();
@@ -1162,15 +1315,17 @@ void limit_manager_t::commit(
     }
     added.clear();
 
-    std::vector<std::string> truncated = item_queue.truncate_top(spec.limit);
-    for (auto &&id : truncated) {
-        auto it = real_added.find_id(id);
-        if (it != real_added.end()) {
-            real_added.erase(it);
-        } else {
-            bool inserted = real_deleted.insert(std::move(id)).second;
-            guarantee(inserted);
-        }
+    truncate_into_spare(&real_added, &real_deleted);
+
+    // Make up for deletions with the spare items first.
+    while (item_queue.size() < spec.limit && spare_queue.size() != 0) {
+        auto it = std::prev(spare_queue.end());
+        item_t item = **it;
+        spare_queue.erase(it);
+        bool inserted = item_queue.insert(item).second;
+        guarantee(inserted);
+        inserted = real_added.insert(std::move(item)).second;
+        guarantee(inserted);
     }
 
     bool anything_on_disk = real_deleted.size() != 0 || added_on_disk;
@@ -1178,7 +1333,9 @@ void limit_manager_t::commit(
         std::vector<item_t> s;
         optional<exc_t> exc;
         try {
-            s = read_more(sindex_ref, active_boundary);
+            // We read enough to fill up `spare_queue` too.
+            s = read_more(sindex_ref, active_boundary,
+                          2 * spec.limit - item_queue.size());
         } catch (const exc_t &e) {
             exc.set(e);
         }
@@ -1196,18 +1353,7 @@ void limit_manager_t::commit(
                 guarantee(added_insert);
             }
         }
-        // We need to truncate again because `read_more` may read too much in
-        // the secondary index case.
-        std::vector<std::string> read_trunc = item_queue.truncate_top(spec.limit);
-        for (auto &&id : read_trunc) {
-            auto it = real_added.find_id(id);
-            if (it != real_added.end()) {
-                real_added.erase(it);
-            } else {
-                bool inserted = real_deleted.insert(std::move(id)).second;
-                guarantee(inserted);
-            }
-        }
+        truncate_into_spare(&real_added, &real_deleted);
     }
     std::set<std::string> remaining_deleted;
     for (auto &&id : real_deleted) {
@@ -1263,6 +1409,8 @@ RDB_IMPL_SERIALIZABLE_5(
     old_indexes, new_indexes, pkey, old_val, new_val);
 INSTANTIATE_SERIALIZABLE_FOR_CLUSTER(msg_t::change_t);
 RDB_IMPL_SERIALIZABLE_0_SINCE_v1_13(msg_t::stop_t);
+RDB_IMPL_SERIALIZABLE_2(msg_t::change_batch_t, changes, skipped_stamps);
+INSTANTIATE_SERIALIZABLE_FOR_CLUSTER(msg_t::change_batch_t);
 
 enum class detach_t { NO, YES };
 
@@ -1598,6 +1746,14 @@ private:
 };
 
 class range_sub_t;
+
+// The values that range subs can be indexed by.  These are the ones that are only
+// equal to themselves.
+bool is_routing_value(const datum_t &val) {
+    datum_t::type_t type = val.get_type();
+    return type == datum_t::R_NULL || type == datum_t::R_BOOL
+        || type == datum_t::R_NUM || type == datum_t::R_STR;
+}
 class empty_sub_t;
 class point_sub_t;
 class limit_sub_t;
@@ -1619,8 +1775,13 @@ public:
     void add_limit_sub(limit_sub_t *sub, const uuid_u &uuid) THROWS_NOTHING;
     void del_limit_sub(limit_sub_t *sub, const uuid_u &uuid) THROWS_NOTHING;
 
-    void each_range_sub(const auto_drainer_t::lock_t &lock,
-                        const std::function<void(range_sub_t *)> &f) THROWS_NOTHING;
+    // Calls `f` once for every group of range subs with the same transformations
+    // that a change from `old_val` to `new_val` could produce values for.
+    void each_range_sub_group_for_change(
+        const datum_t &old_val,
+        const datum_t &new_val,
+        const auto_drainer_t::lock_t &lock,
+        const std::function<void(const std::set<range_sub_t *> &)> &f) THROWS_NOTHING;
     void update_stamps(uuid_u server_uuid, uint64_t stamp);
     std::map<uuid_u, uint64_t> get_stamps();
     void on_point_sub(
@@ -1652,6 +1813,32 @@ protected:
     bool detached;
     int64_t num_subs;
 private:
+    // The range subs on one thread, grouped by `range_sub_t::transforms_key` so that
+    // each change only gets transformed once for every group.  Groups whose filter
+    // needs a field to equal a constant (see `range_sub_t::routing_key`) are also
+    // indexed by that field and constant, so that a change only visits them if its
+    // old or new value has that field set to that constant.
+    class range_sub_groups_t {
+    public:
+        typedef std::set<range_sub_t *> group_t;
+
+        void add(range_sub_t *sub);
+        size_t del(range_sub_t *sub);
+        void each_group_for_change(
+            const datum_t &old_val,
+            const datum_t &new_val,
+            const std::function<void(const group_t &)> &f) const;
+
+        const std::map<std::string, group_t> &get_groups() const { return groups; }
+        size_t size() const;
+        bool empty() const { return groups.empty(); }
+        void clear();
+    private:
+        std::map<std::string, group_t> groups;
+        std::map<datum_string_t, std::map<datum_t, std::set<const group_t *> > > routed;
+        std::set<const group_t *> unrouted;
+    };
+
     virtual void maybe_remove_feed() = 0;
     virtual void stop_limit_sub(limit_sub_t *sub) = 0;
 
@@ -1671,6 +1858,10 @@ private:
                             const std::vector<std::set<Sub *> > &vec,
                             const std::vector<int> &sub_threads,
                             int i);
+    void each_range_sub_groups_with_lock(
+        rwlock_in_line_t *spot,
+        const auto_drainer_t::lock_t &lock,
+        const std::function<void(const range_sub_groups_t &)> &f) THROWS_NOTHING;
     void each_point_sub_cb(const std::function<void(point_sub_t *)> &f, int i);
     void each_point_sub_with_lock(
         rwlock_in_line_t *spot,
@@ -1684,7 +1875,7 @@ private:
     rwlock_t point_subs_lock;
     std::vector<std::set<empty_sub_t *> > empty_subs;
     rwlock_t empty_subs_lock;
-    std::vector<std::set<range_sub_t *> > range_subs;
+    std::vector<range_sub_groups_t> range_subs;
     rwlock_t range_subs_lock;
     std::map<uuid_u, std::vector<std::set<limit_sub_t *> > > limit_subs;
     rwlock_t limit_subs_lock;
@@ -1705,14 +1896,12 @@ private:
 };
 
 void feed_t::update_stamps(uuid_u server_uuid, uint64_t stamp) {
-    pmap(get_num_threads(),
-         [&](int thread) {
-             on_thread_t th((threadnum_t(thread)));
-             stamps_t *rs = stamps.get();
-             rwlock_acq_t acq(&rs->lock, access_t::write);
-             rassert(stamp >= rs->latest[server_uuid]);
-             rs->latest[server_uuid] = stamp;
-         });
+    pmap_on_all_threads([&](int) {
+        stamps_t *rs = stamps.get();
+        rwlock_acq_t acq(&rs->lock, access_t::write);
+        rassert(stamp >= rs->latest[server_uuid]);
+        rs->latest[server_uuid] = stamp;
+    });
 }
 
 // We have to return by value here because we release the lock right away.
@@ -2062,7 +2251,8 @@ public:
         read_response_t read_resp;
         nif->read(
             env->get_user_context(),
-            read_t(changefeed_point_stamp_t{addr, store_key_t(pkey.print_primary())},
+            read_t(changefeed_point_stamp_t{
+                       addr, store_key_t(pkey.print_primary()), squash},
                    profile_bool_t::DONT_PROFILE, read_mode_t::SINGLE),
             &read_resp,
             order_token_t::ignore,
@@ -2185,6 +2375,8 @@ public:
         for (const auto &transform : spec.transforms) {
             ops.push_back(make_op(transform));
         }
+        transforms_key = make_transforms_key();
+        routing_key = make_routing_key();
         store_keys = spec.datumspec.primary_key_map();
         if (!store_keys.has_value()) {
             store_key_range.set(spec.datumspec.covering_range().to_primary_keyrange());
@@ -2223,6 +2415,11 @@ public:
     }
 
     bool has_ops() { return ops.size() != 0; }
+    // Subs with the same key transform every value the same way.
+    const std::string &get_transforms_key() const { return transforms_key; }
+    const optional<std::pair<datum_string_t, datum_t> > &get_routing_key() const {
+        return routing_key;
+    }
 
     optional<datum_t> apply_ops(datum_t val) {
         guarantee(active());
@@ -2308,7 +2505,7 @@ public:
         // Note that we use the `outer_env`'s interruptor for the read.
         nif->read(
             outer_env->get_user_context(),
-            read_t(changefeed_stamp_t(addr),
+            read_t(changefeed_stamp_t(addr, squash),
                    profile_bool_t::DONT_PROFILE,
                    read_mode_t::SINGLE),
             &read_resp, order_token_t::ignore, outer_env->interruptor);
@@ -2340,7 +2537,7 @@ public:
             // releasing the old one.
             scoped_ptr_t<range_sub_t> sub_self(this);
             UNUSED subscription_t *super_self = self.release();
-            bool stamped = maybe_src->add_stamp(changefeed_stamp_t(addr));
+            bool stamped = maybe_src->add_stamp(changefeed_stamp_t(addr, squash));
             rcheck_src(bt, stamped, base_exc_t::LOGIC,
                        "Cannot call `include_initial` on an unstampable stream.");
             return make_splice_stream(maybe_src, std::move(sub_self), bt);
@@ -2381,6 +2578,51 @@ public:
     const std::map<uuid_u, uint64_t> &get_next_stamps() { return next_stamps; }
     const std::map<uuid_u, uint64_t> &get_orig_stamps() { return orig_stamps; }
 private:
+    // Like `sindex_config_t::operator==`, this compares functions by serializing
+    // them.  The array size limit is part of it because it decides which
+    // transformations fail.  So are the time that `r.now()` evaluates to and the global
+    // optargs, since the transformations may use them.
+    std::string make_transforms_key() const {
+        write_message_t wm;
+        serialize<cluster_version_t::CLUSTER>(&wm, spec.transforms);
+        serialize<cluster_version_t::CLUSTER>(
+            &wm, static_cast<uint64_t>(env->limits().array_size_limit()));
+        const datum_t &now = env->get_deterministic_time();
+        serialize<cluster_version_t::CLUSTER>(&wm, now.has());
+        if (now.has()) {
+            serialize<cluster_version_t::CLUSTER>(&wm, now);
+        }
+        serialize<cluster_version_t::CLUSTER>(&wm, env->get_all_optargs());
+        string_stream_t stream;
+        int res = send_write_message(&stream, &wm);
+        guarantee(res == 0);
+        return std::move(stream.str());
+    }
+
+    optional<std::pair<datum_string_t, datum_t> > make_routing_key() const {
+        if (spec.transforms.empty()) {
+            return r_nullopt;
+        }
+        const filter_wire_func_t *filter =
+            boost::get<filter_wire_func_t>(&spec.transforms[0]);
+        // With a default the filter can let through rows that lack the field.
+        if (filter == nullptr || filter->default_filter_val) {
+            return r_nullopt;
+        }
+        datum_t predicate =
+            filter->filter_func.compile_wire_func()->constant_filter_object();
+        if (!predicate.has() || predicate.is_ptype()) {
+            return r_nullopt;
+        }
+        for (size_t i = 0; i < predicate.obj_size(); ++i) {
+            auto pair = predicate.get_pair(i);
+            if (is_routing_value(pair.second)) {
+                return make_optional(std::make_pair(pair.first, pair.second));
+            }
+        }
+        return r_nullopt;
+    }
+
     scoped_ptr_t<env_t> make_env(env_t *outer_env) {
         // This is to support fake environments from the unit tests that don't
         // actually have a context.
@@ -2398,6 +2640,11 @@ private:
 
     scoped_ptr_t<env_t> env;
     std::vector<scoped_ptr_t<op_t> > ops;
+    std::string transforms_key;
+    // If set, the first transformation filters out every value whose field
+    // `routing_key->first` isn't equal to `routing_key->second`.  Such values can't
+    // produce anything for this sub.
+    optional<std::pair<datum_string_t, datum_t> > routing_key;
 
     // The stamp (see `stamped_msg_t`) associated with our `changefeed_stamp_t`
     // read.  We use these to make sure we don't see changes from writes before
@@ -2836,97 +3083,26 @@ public:
             });
     }
     void operator()(const msg_t::change_t &change) const {
-        datum_t null = datum_t::null();
-
-        feed->each_range_sub(*lock, [&](range_sub_t *sub) {
-            datum_t new_val = null, old_val = null;
-            if (!sub->active()) return;
-            bool trivial = false;
-            if (sub->has_ops()) {
-                if (change.new_val.has()) {
-                    if (optional<datum_t> d = sub->apply_ops(change.new_val)) {
-                        new_val = *d;
-                    }
-                }
-                if (!sub->active()) return;
-                if (change.old_val.has()) {
-                    if (optional<datum_t> d = sub->apply_ops(change.old_val)) {
-                        old_val = *d;
-                    }
-                }
-                if (!sub->active()) return;
-                // Duplicate values are caught before being written to disk and
-                // don't generate a `mod_report`, but if we have transforms the
-                // values might have changed.
-                trivial = (new_val == old_val);
-            } else {
-                guarantee(change.old_val.has() || change.new_val.has());
-                if (change.new_val.has()) {
-                    new_val = change.new_val;
-                }
-                if (change.old_val.has()) {
-                    old_val = change.old_val;
-                }
-            }
-            ASSERT_NO_CORO_WAITING;
-            optional<std::string> sindex = sub->sindex();
-            if (sindex) {
-                std::vector<indexed_datum_t> old_idxs, new_idxs;
-                auto old_it = change.old_indexes.find(*sindex);
-                if (old_it != change.old_indexes.end()) {
-                    for (const auto &idx : old_it->second) {
-                        for (size_t i = 0; i < sub->copies(idx.first); ++i) {
-                            old_idxs.push_back(
-                                indexed_datum_t(old_val, make_optional(idx.second)));
-                        }
-                    }
-                }
-                auto new_it = change.new_indexes.find(*sindex);
-                if (new_it != change.new_indexes.end()) {
-                    for (const auto &idx : new_it->second) {
-                        for (size_t i = 0; i < sub->copies(idx.first); ++i) {
-                            new_idxs.push_back(
-                                indexed_datum_t(new_val, make_optional(idx.second)));
+        feed->each_range_sub_group_for_change(
+            change.old_val, change.new_val, *lock,
+            [&](const std::set<range_sub_t *> &subs) {
+                // All the subs in `subs` transform values the same way, so the first
+                // active one transforms the change for all of them.
+                bool transformed = false;
+                datum_t new_val, old_val;
+                bool trivial = false;
+                for (range_sub_t *sub : subs) {
+                    if (!sub->active()) continue;
+                    if (!transformed) {
+                        if (!transform_change(
+                                sub, change, &new_val, &old_val, &trivial)) {
+                            continue;
                         }
+                        transformed = true;
                     }
+                    add_range_change(sub, change, new_val, old_val, trivial);
                 }
-                while (old_idxs.size() > 0 && new_idxs.size() > 0) {
-                    if (!trivial) {
-                        sub->add_el(server_uuid, stamp, change.pkey, sindex,
-                                    make_optional(std::move(old_idxs.back())),
-                                    make_optional(std::move(new_idxs.back())));
-                    }
-                    old_idxs.pop_back();
-                    new_idxs.pop_back();
-                }
-                while (old_idxs.size() > 0) {
-                    guarantee(new_idxs.size() == 0);
-                    if (old_val != null) {
-                        sub->add_el(server_uuid, stamp, change.pkey, sindex,
-                                    make_optional(std::move(old_idxs.back())),
-                                    r_nullopt);
-                    }
-                    old_idxs.pop_back();
-                }
-                while (new_idxs.size() > 0) {
-                    guarantee(old_idxs.size() == 0);
-                    if (new_val != null) {
-                        sub->add_el(server_uuid, stamp, change.pkey, sindex,
-                                    r_nullopt,
-                                    make_optional(std::move(new_idxs.back())));
-                    }
-                    new_idxs.pop_back();
-                }
-            } else {
-                if (!trivial) {
-                    for (size_t i = 0; i < sub->copies(change.pkey); ++i) {
-                        sub->add_el(server_uuid, stamp, change.pkey, sindex,
-                                    make_optional(indexed_datum_t(old_val, r_nullopt)),
-                                    make_optional(indexed_datum_t(new_val, r_nullopt)));
-                    }
-                }
-            }
-        });
+            });
         feed->on_point_sub(
             change.pkey,
             *lock,
@@ -2945,7 +3121,117 @@ public:
     void operator()(const msg_t::stop_t &) const {
         feed->abort_feed();
     }
+    void operator()(const msg_t::change_batch_t &batch) const {
+        // `real_feed_t::mailbox_cb` splits batches up into their changes, and
+        // queues an empty batch for each of their skipped stamps.
+        guarantee(batch.changes.empty());
+    }
 private:
+    // Returns false if `sub` stopped while it was transforming the change.
+    bool transform_change(range_sub_t *sub,
+                          const msg_t::change_t &change,
+                          datum_t *new_val_out,
+                          datum_t *old_val_out,
+                          bool *trivial_out) const {
+        const datum_t null = datum_t::null();
+        *new_val_out = null;
+        *old_val_out = null;
+        *trivial_out = false;
+        if (sub->has_ops()) {
+            if (change.new_val.has()) {
+                if (optional<datum_t> d = sub->apply_ops(change.new_val)) {
+                    *new_val_out = *d;
+                }
+            }
+            if (!sub->active()) return false;
+            if (change.old_val.has()) {
+                if (optional<datum_t> d = sub->apply_ops(change.old_val)) {
+                    *old_val_out = *d;
+                }
+            }
+            if (!sub->active()) return false;
+            // Duplicate values are caught before being written to disk and
+            // don't generate a `mod_report`, but if we have transforms the
+            // values might have changed.
+            *trivial_out = (*new_val_out == *old_val_out);
+        } else {
+            guarantee(change.old_val.has() || change.new_val.has());
+            if (change.new_val.has()) {
+                *new_val_out = change.new_val;
+            }
+            if (change.old_val.has()) {
+                *old_val_out = change.old_val;
+            }
+        }
+        return true;
+    }
+
+    void add_range_change(range_sub_t *sub,
+                          const msg_t::change_t &change,
+                          const datum_t &new_val,
+                          const datum_t &old_val,
+                          bool trivial) const {
+        const datum_t null = datum_t::null();
+        ASSERT_NO_CORO_WAITING;
+        optional<std::string> sindex = sub->sindex();
+        if (sindex) {
+            std::vector<indexed_datum_t> old_idxs, new_idxs;
+            auto old_it = change.old_indexes.find(*sindex);
+            if (old_it != change.old_indexes.end()) {
+                for (const auto &idx : old_it->second) {
+                    for (size_t i = 0; i < sub->copies(idx.first); ++i) {
+                        old_idxs.push_back(
+                            indexed_datum_t(old_val, make_optional(idx.second)));
+                    }
+                }
+            }
+            auto new_it = change.new_indexes.find(*sindex);
+            if (new_it != change.new_indexes.end()) {
+                for (const auto &idx : new_it->second) {
+                    for (size_t i = 0; i < sub->copies(idx.first); ++i) {
+                        new_idxs.push_back(
+                            indexed_datum_t(new_val, make_optional(idx.second)));
+                    }
+                }
+            }
+            while (old_idxs.size() > 0 && new_idxs.size() > 0) {
+                if (!trivial) {
+                    sub->add_el(server_uuid, stamp, change.pkey, sindex,
+                                make_optional(std::move(old_idxs.back())),
+                                make_optional(std::move(new_idxs.back())));
+                }
+                old_idxs.pop_back();
+                new_idxs.pop_back();
+            }
+            while (old_idxs.size() > 0) {
+                guarantee(new_idxs.size() == 0);
+                if (old_val != null) {
+                    sub->add_el(server_uuid, stamp, change.pkey, sindex,
+                                make_optional(std::move(old_idxs.back())),
+                                r_nullopt);
+                }
+                old_idxs.pop_back();
+            }
+            while (new_idxs.size() > 0) {
+                guarantee(old_idxs.size() == 0);
+                if (new_val != null) {
+                    sub->add_el(server_uuid, stamp, change.pkey, sindex,
+                                r_nullopt,
+                                make_optional(std::move(new_idxs.back())));
+                }
+                new_idxs.pop_back();
+            }
+        } else {
+            if (!trivial) {
+                for (size_t i = 0; i < sub->copies(change.pkey); ++i) {
+                    sub->add_el(server_uuid, stamp, change.pkey, sindex,
+                                make_optional(indexed_datum_t(old_val, r_nullopt)),
+                                make_optional(indexed_datum_t(new_val, r_nullopt)));
+                }
+            }
+        }
+    }
+
     feed_t *feed;
     const auto_drainer_t::lock_t *lock;
     uuid_u server_uuid;
@@ -2989,8 +3275,22 @@ void real_feed_t::mailbox_cb(signal_t *, stamped_msg_t msg) {
             if (detached) return;
 
             // Add us to the queue.
-            guarantee(msg.stamp >= queue->next);
-            queue->map.push(std::move(msg));
+            if (msg_t::change_batch_t *batch =
+                    boost::get<msg_t::change_batch_t>(&msg.submsg.op)) {
+                for (auto &&pair : batch->changes) {
+                    guarantee(pair.first >= queue->next);
+                    queue->map.push(stamped_msg_t(
+                        msg.server_uuid, pair.first, msg_t(std::move(pair.second))));
+                }
+                for (uint64_t stamp : batch->skipped_stamps) {
+                    guarantee(stamp >= queue->next);
+                    queue->map.push(stamped_msg_t(
+                        msg.server_uuid, stamp, msg_t(msg_t::change_batch_t())));
+                }
+            } else {
+                guarantee(msg.stamp >= queue->next);
+                queue->map.push(std::move(msg));
+            }
 
             // Read as much as we can from the queue (this enforces ordering.)
             while (queue->map.size() != 0 && queue->map.top().stamp == queue->next) {
@@ -3516,18 +3816,102 @@ void feed_t::del_point_sub(point_sub_t *sub, const store_key_t &key) THROWS_NOTH
 // If this throws we might leak the increment to `num_subs`.
 void feed_t::add_range_sub(range_sub_t *sub) THROWS_NOTHING {
     add_sub_with_lock(&range_subs_lock, [this, sub]() {
-            auto pair = range_subs[sub->home_thread().threadnum].insert(sub);
-            guarantee(pair.second);
+            range_subs[sub->home_thread().threadnum].add(sub);
         });
 }
 
 // Can't throw because it's called in a destructor.
 void feed_t::del_range_sub(range_sub_t *sub) THROWS_NOTHING {
     del_sub_with_lock(&range_subs_lock, [this, sub]() {
-            return range_subs[sub->home_thread().threadnum].erase(sub);
+            return range_subs[sub->home_thread().threadnum].del(sub);
         });
 }
 
+void feed_t::range_sub_groups_t::add(range_sub_t *sub) {
+    group_t *group = &groups[sub->get_transforms_key()];
+    if (group->empty()) {
+        // All the subs in a group have the same routing key.
+        if (const auto &key = sub->get_routing_key()) {
+            routed[key->first][key->second].insert(group);
+        } else {
+            unrouted.insert(group);
+        }
+    }
+    auto pair = group->insert(sub);
+    guarantee(pair.second);
+}
+
+size_t feed_t::range_sub_groups_t::del(range_sub_t *sub) {
+    auto it = groups.find(sub->get_transforms_key());
+    if (it == groups.end()) {
+        return 0;
+    }
+    size_t erased = it->second.erase(sub);
+    if (it->second.empty()) {
+        if (const auto &key = sub->get_routing_key()) {
+            auto field_it = routed.find(key->first);
+            guarantee(field_it != routed.end());
+            auto value_it = field_it->second.find(key->second);
+            guarantee(value_it != field_it->second.end());
+            value_it->second.erase(&it->second);
+            if (value_it->second.empty()) {
+                field_it->second.erase(value_it);
+                if (field_it->second.empty()) {
+                    routed.erase(field_it);
+                }
+            }
+        } else {
+            unrouted.erase(&it->second);
+        }
+        groups.erase(it);
+    }
+    return erased;
+}
+
+void feed_t::range_sub_groups_t::each_group_for_change(
+    const datum_t &old_val,
+    const datum_t &new_val,
+    const std::function<void(const group_t &)> &f) const {
+    for (const group_t *group : unrouted) {
+        f(*group);
+    }
+    if (routed.empty()) {
+        return;
+    }
+    std::set<const group_t *> matched;
+    for (const datum_t *val : {&old_val, &new_val}) {
+        if (!val->has() || val->get_type() != datum_t::R_OBJECT) {
+            continue;
+        }
+        for (const auto &field : routed) {
+            datum_t field_val = val->get_field(field.first, NOTHROW);
+            if (field_val.has() && is_routing_value(field_val)) {
+                auto it = field.second.find(field_val);
+                if (it != field.second.end()) {
+                    matched.insert(it->second.begin(), it->second.end());
+                }
+            }
+        }
+    }
+    for (const group_t *group : matched) {
+        f(*group);
+    }
+}
+
+size_t feed_t::range_sub_groups_t::size() const {
+    size_t res = 0;
+    for (const auto &pair : groups) {
+        res += pair.second.size();
+    }
+    return res;
+}
+
+void feed_t::range_sub_groups_t::clear() {
+    groups.clear();
+    routed.clear();
+    unrouted.clear();
+}
+
 // If this throws we might leak the increment to `num_subs`.
 void feed_t::add_empty_sub(empty_sub_t *sub) THROWS_NOTHING {
     add_sub_with_lock(&empty_subs_lock, [this, sub]() {
@@ -3584,12 +3968,38 @@ void feed_t::each_sub_in_vec(
          });
 }
 
-void feed_t::each_range_sub(
+void feed_t::each_range_sub_group_for_change(
+    const datum_t &old_val,
+    const datum_t &new_val,
     const auto_drainer_t::lock_t &lock,
-    const std::function<void(range_sub_t *)> &f) THROWS_NOTHING {
+    const std::function<void(const std::set<range_sub_t *> &)> &f) THROWS_NOTHING {
     assert_thread();
     rwlock_in_line_t spot(&range_subs_lock, access_t::read);
-    each_sub_in_vec(range_subs, &spot, lock, f);
+    each_range_sub_groups_with_lock(
+        &spot, lock, [&](const range_sub_groups_t &subs) {
+            subs.each_group_for_change(old_val, new_val, f);
+        });
+}
+
+void feed_t::each_range_sub_groups_with_lock(
+    rwlock_in_line_t *spot,
+    const auto_drainer_t::lock_t &lock,
+    const std::function<void(const range_sub_groups_t &)> &f) THROWS_NOTHING {
+    assert_thread();
+    guarantee(lock.has_lock());
+    spot->read_signal()->wait_lazily_unordered();
+
+    std::vector<int> subscription_threads;
+    for (int i = 0; i < get_num_threads(); ++i) {
+        if (!range_subs[i].empty()) {
+            subscription_threads.push_back(i);
+        }
+    }
+    pmap(subscription_threads.size(),
+         [this, &f, &subscription_threads](int i) {
+             on_thread_t th((threadnum_t(subscription_threads[i])));
+             f(range_subs[subscription_threads[i]]);
+         });
 }
 
 void feed_t::each_point_sub_cb(const std::function<void(point_sub_t *)> &f, int i) {
@@ -3682,10 +4092,17 @@ void feed_t::stop_subs(const auto_drainer_t::lock_t &lock) {
     {
         rwlock_in_line_t spot(&range_subs_lock, access_t::write);
         spot.write_signal()->wait_lazily_unordered();
-        each_sub_in_vec<range_sub_t>(range_subs, &spot, lock, f);
-        for (auto &&set : range_subs) {
-            num_subs -= set.size();
-            set.clear();
+        each_range_sub_groups_with_lock(
+            &spot, lock, [&f](const range_sub_groups_t &subs) {
+                for (const auto &pair : subs.get_groups()) {
+                    for (range_sub_t *sub : pair.second) {
+                        f(sub);
+                    }
+                }
+            });
+        for (auto &&subs : range_subs) {
+            num_subs -= subs.size();
+            subs.clear();
         }
     }
     {
@@ -108,6 +108,15 @@ struct msg_t {
     struct stop_t {
         RDB_DECLARE_ME_SERIALIZABLE(stop_t);
     };
+    // Changes for one client, each with the stamp it would have had if it had been
+    // sent on its own.  See `server_t::send_all`.
+    struct change_batch_t {
+        std::vector<std::pair<uint64_t, change_t> > changes;
+        // The stamps of changes that were coalesced into a later change to the same
+        // row, or dropped because the row was created and deleted again.
+        std::vector<uint64_t> skipped_stamps;
+        RDB_DECLARE_ME_SERIALIZABLE(change_batch_t);
+    };
 
     msg_t() { }
     msg_t(msg_t &&msg) : op(std::move(msg.op)) { }
@@ -119,7 +128,8 @@ struct msg_t {
                            change_t,
                            limit_start_t,
                            limit_change_t,
-                           limit_stop_t> op_t;
+                           limit_stop_t,
+                           change_batch_t> op_t;
     op_t op;
 
     // Accursed reference collapsing!
@@ -436,7 +446,12 @@ private:
     // Can throw `exc_t` exceptions if an error occurs while reading from disk.
     std::vector<item_t> read_more(
         const boost::variant<primary_ref_t, sindex_ref_t> &ref,
-        const optional<item_t> &start);
+        const optional<item_t> &start,
+        size_t n);
+    // Moves the items that don't fit into `item_queue` to `spare_queue`, and
+    // updates `real_added` and `real_deleted` for the ones that the client saw.
+    void truncate_into_spare(item_queue_t *real_added,
+                             std::set<std::string> *real_deleted);
     void send(msg_t &&msg);
 
     scoped_ptr_t<env_t> env;
@@ -448,7 +463,12 @@ private:
     std::vector<scoped_ptr_t<op_t> > ops;
 
     limit_order_t gt;
+    // The top `spec.limit` items, which is what the client sees.
     item_queue_t item_queue;
+    // Up to `spec.limit` of the items that come right after the ones in
+    // `item_queue`, so that most deletions can be made up for without reading
+    // from disk.  Everything that isn't in either queue comes after these.
+    item_queue_t spare_queue;
 
     std::map<std::string, std::pair<datum_t, datum_t> > added;
     std::set<std::string> deleted;
@@ -486,6 +506,10 @@ public:
         std::vector<item_t> &&start_data,
         const auto_drainer_t::lock_t &keepalive);
     // `key` should be non-NULL if there is a key associated with the message.
+    // Changes aren't sent right away, but batched with the other changes for the
+    // same client that come in before the coroutines that are running now are done,
+    // up to `MAX_BATCHED_CHANGES` of them.  If every subscription on a client
+    // squashes, changes in its batch to the same row are coalesced into one.
     void send_all(
         const msg_t &msg,
         const store_key_t &key,
@@ -493,8 +517,10 @@ public:
         const auto_drainer_t::lock_t &keepalive);
     addr_t get_stop_addr();
     limit_addr_t get_limit_stop_addr();
+    // `squash` is whether the subscription reading the stamp squashes changes.
     optional<uint64_t> get_stamp(
         const client_t::addr_t &addr,
+        bool squash,
         const auto_drainer_t::lock_t &keepalive);
     uuid_u get_uuid();
     // `f` will be called with a read lock on `clients` and a write lock on the
@@ -534,6 +560,9 @@ private:
         client_info_t();
         scoped_ptr_t<cond_t> cond;
         uint64_t stamp;
+        // False once a subscription that doesn't squash has read a stamp.  This
+        // never goes back to true, since we don't know when that subscription stops.
+        bool only_squashing_subs;
         std::vector<region_t> regions;
         std::map<optional<std::string>,
                  std::vector<scoped_ptr_t<limit_manager_t>>> limit_clients;
@@ -552,6 +581,28 @@ private:
                             msg_t msg,
                             const auto_drainer_t::lock_t &lock);
 
+    static const size_t MAX_BATCHED_CHANGES = 64;
+    // Returns true if the batch is full and should be flushed.  This doesn't block.
+    bool batch_change(const client_t::addr_t &addr,
+                      uint64_t stamp,
+                      const msg_t::change_t &change,
+                      bool coalesce,
+                      const auto_drainer_t::lock_t &keepalive);
+    void flush_batched_changes(const client_t::addr_t &addr);
+    void flush_batched_changes_cb(client_t::addr_t addr,
+                                  auto_drainer_t::lock_t keepalive);
+    struct pending_changes_t {
+        msg_t::change_batch_t batch;
+        // Where the last change to each row is in `batch.changes`, if later changes
+        // to the row can still be coalesced into it.  `get_stamp` clears this,
+        // because a subscription starting at that stamp must see the changes after
+        // it separately from the changes before it.
+        std::map<store_key_t, size_t> positions;
+    };
+    // The changes that `send_all` stamped but didn't send yet, for each client.
+    // This doesn't need a lock because nothing blocks while using it.
+    std::map<client_t::addr_t, pending_changes_t> batched_changes;
+
     // Controls access to `clients`.  A `server_t` needs to read `clients` when:
     // * `send_all` is called
     // * `get_stamp` is called
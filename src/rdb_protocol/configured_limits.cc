@@ -46,6 +46,41 @@ configured_limits_t from_optargs(
     return configured_limits_t(changefeed_queue_size, array_size_limit);
 }
 
+query_quota_t quota_from_optargs(
+        rdb_context_t *ctx, signal_t *interruptor, global_optargs_t *args,
+        ql::datum_t deterministic_time) {
+    query_quota_t quota;
+    // As in `from_optargs`, the optargs get evaluated in an environment without any.
+    if (args != nullptr) {
+        bool has_cpu_limit = args->has_optarg("cpu_limit");
+        bool has_read_limit = args->has_optarg("read_limit");
+        if (has_cpu_limit || has_read_limit) {
+            env_t env(
+                ctx,
+                return_empty_normal_batches_t::NO,
+                interruptor,
+                serializable_env_t{
+                    global_optargs_t(),
+                    auth::user_context_t(auth::permissions_t(tribool::False, tribool::False, tribool::False, tribool::False)),
+                    deterministic_time},
+                nullptr);
+            if (has_cpu_limit) {
+                double seconds = args->get_optarg(&env, "cpu_limit")->as_num();
+                rcheck_datum(
+                    seconds > 0 && seconds < static_cast<double>(INT64_MAX / BILLION),
+                    base_exc_t::LOGIC,
+                    strprintf("Illegal CPU time limit `%g`.  (Must be > 0.)", seconds));
+                quota.cpu_limit_nanos = static_cast<int64_t>(seconds * BILLION);
+            }
+            if (has_read_limit) {
+                int64_t limit = args->get_optarg(&env, "read_limit")->as_int();
+                quota.read_limit = check_limit("read limit", limit);
+            }
+        }
+    }
+    return quota;
+}
+
 size_t check_limit(const char *name, int64_t limit) {
     rcheck_datum(
         limit >= 1, base_exc_t::LOGIC,
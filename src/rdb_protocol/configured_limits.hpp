@@ -35,9 +35,33 @@ private:
     RDB_DECLARE_ME_SERIALIZABLE(configured_limits_t);
 };
 
+// How much CPU time a query may spend evaluating on the server it was sent to, and how
+// many rows it may read from tables, set with the `cpu_limit` (in seconds) and
+// `read_limit` global optargs.  Zero means no limit.  Unlike `configured_limits_t` these
+// only apply to the query's own evaluation, so they never get sent to other servers.
+class query_quota_t {
+public:
+    query_quota_t() : cpu_limit_nanos(0), read_limit(0) { }
+    int64_t cpu_limit_nanos;
+    uint64_t read_limit;
+};
+
+// What a query has used so far of the resources `query_quota_t` limits.  This outlives
+// the `env_t`s of the query's individual batches, so that a long-running stream can't
+// escape its quota by spreading its work over many batches.
+class query_usage_t {
+public:
+    query_usage_t() : cpu_nanos(0), rows_read(0) { }
+    int64_t cpu_nanos;
+    uint64_t rows_read;
+};
+
 configured_limits_t from_optargs(rdb_context_t *ctx, signal_t *interruptor,
                                  global_optargs_t *optargs,
                                  ql::datum_t deterministic_time);
+query_quota_t quota_from_optargs(rdb_context_t *ctx, signal_t *interruptor,
+                                 global_optargs_t *optargs,
+                                 ql::datum_t deterministic_time);
 size_t check_limit(const char *name, int64_t limit);
 
 } // namespace ql
@@ -2,11 +2,10 @@
 #include "rdb_protocol/context.hpp"
 
 #include "clustering/administration/metadata.hpp"
-#include "concurrency/cross_thread_watchable.hpp"
 #include "rdb_protocol/query_cache.hpp"
 #include "rdb_protocol/datum.hpp"
 #include "rpc/semilattice/view/field.hpp"
-#include "rpc/semilattice/watchable.hpp"
+#include "rpc/semilattice/snapshot.hpp"
 #include "time.hpp"
 
 bool sindex_config_t::operator==(const sindex_config_t &o) const {
@@ -62,7 +61,8 @@ RDB_IMPL_SERIALIZABLE_5_FOR_CLUSTER(sindex_status_t,
 
 const char *rql_perfmon_name = "query_engine";
 
-rdb_context_t::stats_t::stats_t(perfmon_collection_t *global_stats)
+rdb_context_t::stats_t::stats_t(perfmon_collection_t *global_stats,
+                                ticks_t slow_query_threshold)
     : qe_stats_membership(global_stats, &qe_stats_collection, rql_perfmon_name),
       client_connections_membership(&qe_stats_collection,
                                     &client_connections, "client_connections"),
@@ -72,14 +72,22 @@ rdb_context_t::stats_t::stats_t(perfmon_collection_t *global_stats)
       queries_per_sec_membership(&qe_stats_collection,
                                  &queries_per_sec, "queries_per_sec"),
       queries_total_membership(&qe_stats_collection,
-                               &queries_total, "queries_total") { }
+                               &queries_total, "queries_total"),
+      query_latency(secs_to_ticks(1)),
+      query_latency_membership(&qe_stats_collection,
+                               &query_latency, "query_latency"),
+      slow_queries(slow_query_threshold),
+      slow_queries_membership(&qe_stats_collection,
+                              &slow_queries, "slow_queries") { }
 
 rdb_context_t::rdb_context_t()
     : extproc_pool(nullptr),
       cluster_interface(nullptr),
       manager(nullptr),
       reql_http_proxy(),
-      stats(&get_global_perfmon_collection()) { }
+      hedge_outdated_reads(false),
+      lease_reads(false),
+      stats(&get_global_perfmon_collection(), ticks_t{0}) { }
 
 rdb_context_t::rdb_context_t(
         extproc_pool_t *_extproc_pool,
@@ -90,9 +98,12 @@ rdb_context_t::rdb_context_t(
       cluster_interface(_cluster_interface),
       manager(nullptr),
       reql_http_proxy(),
-      stats(&get_global_perfmon_collection()) {
-    init_auth_watchables(auth_semilattice_view);
-}
+      hedge_outdated_reads(false),
+      lease_reads(false),
+      stats(&get_global_perfmon_collection(), ticks_t{0}),
+      m_auth_snapshot(
+          new semilattice_snapshot_t<auth_semilattice_metadata_t>(
+              auth_semilattice_view)) { }
 
 rdb_context_t::rdb_context_t(
         extproc_pool_t *_extproc_pool,
@@ -101,27 +112,20 @@ rdb_context_t::rdb_context_t(
         std::shared_ptr<semilattice_read_view_t<auth_semilattice_metadata_t>>
             auth_semilattice_view,
         perfmon_collection_t *global_stats,
-        const std::string &_reql_http_proxy)
+        const std::string &_reql_http_proxy,
+        bool _hedge_outdated_reads,
+        bool _lease_reads,
+        ticks_t _slow_query_threshold)
     : extproc_pool(_extproc_pool),
       cluster_interface(_cluster_interface),
       manager(_mailbox_manager),
       reql_http_proxy(_reql_http_proxy),
-      stats(global_stats) {
-    init_auth_watchables(auth_semilattice_view);
-}
-
-void rdb_context_t::init_auth_watchables(
-    std::shared_ptr<semilattice_read_view_t<auth_semilattice_metadata_t>>
-        auth_semilattice_view) {
-    for (int thread = 0; thread < get_num_threads(); ++thread) {
-        m_cross_thread_auth_watchables.emplace_back(
-            new cross_thread_watchable_variable_t<auth_semilattice_metadata_t>(
-                clone_ptr_t<semilattice_watchable_t<auth_semilattice_metadata_t>>(
-                    new semilattice_watchable_t<auth_semilattice_metadata_t>(
-                        auth_semilattice_view)),
-                threadnum_t(thread)));
-    }
-}
+      hedge_outdated_reads(_hedge_outdated_reads),
+      lease_reads(_lease_reads),
+      stats(global_stats, _slow_query_threshold),
+      m_auth_snapshot(
+          new semilattice_snapshot_t<auth_semilattice_metadata_t>(
+              auth_semilattice_view)) { }
 
 rdb_context_t::~rdb_context_t() { }
 
@@ -129,7 +133,8 @@ std::set<ql::query_cache_t *> *rdb_context_t::get_query_caches_for_this_thread()
     return query_caches.get();
 }
 
-clone_ptr_t<watchable_t<auth_semilattice_metadata_t>>
-        rdb_context_t::get_auth_watchable() const{
-    return m_cross_thread_auth_watchables[get_thread_id().threadnum]->get_watchable();
+per_thread_snapshot_t<auth_semilattice_metadata_t> *
+        rdb_context_t::get_auth_snapshot() {
+    guarantee(m_auth_snapshot.has());
+    return m_auth_snapshot->get();
 }
@@ -22,6 +22,7 @@
 #include "rdb_protocol/geo/distances.hpp"
 #include "rdb_protocol/geo/lon_lat_types.hpp"
 #include "rdb_protocol/shards.hpp"
+#include "rdb_protocol/slow_query_log.hpp"
 #include "rdb_protocol/wire_func.hpp"
 
 namespace auth {
@@ -43,6 +44,8 @@ ARCHIVE_PRIM_MAKE_RANGED_SERIALIZABLE(
         return_changes_t::NO, return_changes_t::ALWAYS);
 
 class auth_semilattice_metadata_t;
+template<class> class per_thread_snapshot_t;
+template<class> class semilattice_snapshot_t;
 class ellipsoid_spec_t;
 class extproc_pool_t;
 class name_string_t;
@@ -218,6 +221,14 @@ public:
         return_changes_t return_changes,
         durability_requirement_t durability,
         ignore_write_hook_t ignore_write_hook) = 0;
+    /* Deletes the rows whose primary keys are in `range` without reading them first.
+    Returns an empty datum if the table can't do that, for example because it has a
+    write hook; then the caller has to delete the rows itself. */
+    virtual ql::datum_t write_range_delete(
+        ql::env_t *env,
+        const ql::datum_range_t &range,
+        durability_requirement_t durability,
+        ignore_write_hook_t ignore_write_hook) = 0;
     virtual bool write_sync_depending_on_durability(
         ql::env_t *env,
         durability_requirement_t durability) = 0;
@@ -468,7 +479,10 @@ public:
         std::shared_ptr<semilattice_read_view_t<auth_semilattice_metadata_t>>
             auth_semilattice_view,
         perfmon_collection_t *global_stats,
-        const std::string &_reql_http_proxy);
+        const std::string &_reql_http_proxy,
+        bool _hedge_outdated_reads,
+        bool _lease_reads,
+        ticks_t _slow_query_threshold);
 
     ~rdb_context_t();
 
@@ -479,9 +493,18 @@ public:
 
     const std::string reql_http_proxy;
 
+    /* Whether an outdated read also goes to a second replica if the first one takes
+    longer than it usually does. */
+    const bool hedge_outdated_reads;
+
+    /* Whether a `read_mode: "single"` read may be answered by a secondary replica on
+    this server while it holds a read lease from the primary, instead of going to the
+    primary. */
+    const bool lease_reads;
+
     class stats_t {
     public:
-        explicit stats_t(perfmon_collection_t *global_stats);
+        stats_t(perfmon_collection_t *global_stats, ticks_t slow_query_threshold);
 
         perfmon_collection_t qe_stats_collection;
         perfmon_membership_t qe_stats_membership;
@@ -493,21 +516,22 @@ public:
         perfmon_membership_t queries_per_sec_membership;
         perfmon_counter_t queries_total;
         perfmon_membership_t queries_total_membership;
+        perfmon_latency_sampler_t query_latency;
+        perfmon_membership_t query_latency_membership;
+        slow_query_log_t slow_queries;
+        perfmon_membership_t slow_queries_membership;
     private:
         DISABLE_COPYING(stats_t);
     } stats;
 
     std::set<ql::query_cache_t *> *get_query_caches_for_this_thread();
 
-    clone_ptr_t<watchable_t<auth_semilattice_metadata_t>> get_auth_watchable() const;
+    /* Every permission check reads this, so it's a per-thread snapshot rather than a
+    watchable that has to be copied or proxied for each read. */
+    per_thread_snapshot_t<auth_semilattice_metadata_t> *get_auth_snapshot();
 
 private:
-    void init_auth_watchables(
-        std::shared_ptr<semilattice_read_view_t<auth_semilattice_metadata_t>>
-            auth_semilattice_view);
-
-    std::vector<std::unique_ptr<cross_thread_watchable_variable_t<
-        auth_semilattice_metadata_t>>> m_cross_thread_auth_watchables;
+    scoped_ptr_t<semilattice_snapshot_t<auth_semilattice_metadata_t>> m_auth_snapshot;
 
     one_per_thread_t<std::set<ql::query_cache_t *> > query_caches;
 
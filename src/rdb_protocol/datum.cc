@@ -17,9 +17,11 @@
 #include "arch/runtime/coroutines.hpp"
 #include "cjson/json.hpp"
 #include "containers/archive/stl_types.hpp"
+#include "containers/chunked_string_buffer.hpp"
 #include "containers/scoped.hpp"
 #include "rapidjson/prettywriter.h"
 #include "rapidjson/rapidjson.h"
+#include "rapidjson/reader.h"
 #include "rapidjson/stringbuffer.h"
 #include "rapidjson/writer.h"
 #include "rdb_protocol/datum_stream/array.hpp"
@@ -456,6 +458,23 @@ datum_t datum_t::utf8(datum_string_t _data) {
     return datum_t(std::move(_data));
 }
 
+// Sorts the pairs of an object that came from JSON by key, and makes sure that no key
+// appears twice.  This is cheaper than inserting them into a map one by one.
+datum_t object_from_json_pairs(std::vector<std::pair<datum_string_t, datum_t> > &&pairs) {
+    std::sort(pairs.begin(), pairs.end(),
+              [](const std::pair<datum_string_t, datum_t> &p1,
+                 const std::pair<datum_string_t, datum_t> &p2) {
+                  return p1.first < p2.first;
+              });
+    for (size_t i = 1; i < pairs.size(); ++i) {
+        rcheck_datum(!(pairs[i - 1].first == pairs[i].first), base_exc_t::LOGIC,
+                     strprintf("Duplicate key %s in JSON.",
+                               datum_t(pairs[i].first).print().c_str()));
+    }
+    static const std::set<std::string> pts = { pseudo::literal_string };
+    return datum_t(std::move(pairs), pts);
+}
+
 datum_t to_datum(const rapidjson::Value &json, const configured_limits_t &limits,
                  reql_version_t reql_version) {
     switch(json.GetType()) {
@@ -470,21 +489,19 @@ datum_t to_datum(const rapidjson::Value &json, const configured_limits_t &limits
     } break;
     case rapidjson::kObjectType: {
         return call_with_enough_stack<datum_t>([&]() {
-            datum_object_builder_t builder;
+            std::vector<std::pair<datum_string_t, datum_t> > pairs;
+            pairs.reserve(json.MemberCount());
             for (rapidjson::Value::ConstMemberIterator it = json.MemberBegin();
                  it != json.MemberEnd();
                  ++it) {
                 fail_if_invalid(it->name.GetString(),
                                 it->name.GetStringLength());
-                datum_string_t key(it->name.GetStringLength(),
-                                   it->name.GetString());
-                bool dup = builder.add(key, to_datum(it->value, limits, reql_version));
-                rcheck_datum(!dup, base_exc_t::LOGIC,
-                             strprintf("Duplicate key %s in JSON.",
-                                       datum_t(key).print().c_str()));
+                pairs.emplace_back(
+                    datum_string_t::interned(it->name.GetStringLength(),
+                                             it->name.GetString()),
+                    to_datum(it->value, limits, reql_version));
             }
-            const std::set<std::string> pts = { pseudo::literal_string };
-            return std::move(builder).to_datum(pts);
+            return object_from_json_pairs(std::move(pairs));
         }, MIN_DATUM_RECURSION_STACK_SPACE);
     } break;
     case rapidjson::kArrayType: {
@@ -510,6 +527,120 @@ datum_t to_datum(const rapidjson::Value &json, const configured_limits_t &limits
     }
 }
 
+// A rapidjson SAX handler that builds a datum from the events of the parser.  It
+// keeps a stack of the arrays and objects that are still open, whose entries get
+// reused by later containers at the same depth.
+class json_to_datum_handler_t {
+public:
+    explicit json_to_datum_handler_t(const configured_limits_t &limits)
+        : limits_(limits), depth_(0) { }
+
+    bool Null() { return add(datum_t::null()); }
+    bool Bool(bool b) { return add(datum_t::boolean(b)); }
+    bool Int(int i) { return add(datum_t(static_cast<double>(i))); }
+    bool Uint(unsigned u) { return add(datum_t(static_cast<double>(u))); }
+    bool Int64(int64_t i) { return add(datum_t(static_cast<double>(i))); }
+    bool Uint64(uint64_t u) { return add(datum_t(static_cast<double>(u))); }
+    bool Double(double d) { return add(datum_t(d)); }
+
+    bool String(const char *str, rapidjson::SizeType length, bool) {
+        fail_if_invalid(str, length);
+        return add(datum_t(datum_string_t(length, str)));
+    }
+
+    bool StartObject() {
+        push()->is_object = true;
+        return true;
+    }
+    bool Key(const char *str, rapidjson::SizeType length, bool) {
+        fail_if_invalid(str, length);
+        top()->key = datum_string_t::interned(length, str);
+        return true;
+    }
+    bool EndObject(rapidjson::SizeType) {
+        container_t *c = top();
+        --depth_;
+        return add(object_from_json_pairs(std::move(c->pairs)));
+    }
+
+    bool StartArray() {
+        push()->is_object = false;
+        return true;
+    }
+    bool EndArray(rapidjson::SizeType) {
+        container_t *c = top();
+        --depth_;
+        return add(datum_t(std::move(c->array), limits_));
+    }
+
+    datum_t result() {
+        rassert(depth_ == 0);
+        return std::move(result_);
+    }
+
+private:
+    struct container_t {
+        bool is_object;
+        std::vector<datum_t> array;
+        std::vector<std::pair<datum_string_t, datum_t> > pairs;
+        // The key of the next value in `pairs`.
+        datum_string_t key;
+    };
+
+    container_t *push() {
+        if (depth_ == stack_.size()) {
+            stack_.emplace_back();
+        }
+        container_t *c = &stack_[depth_];
+        ++depth_;
+        c->array.clear();
+        c->pairs.clear();
+        return c;
+    }
+
+    container_t *top() {
+        rassert(depth_ > 0);
+        return &stack_[depth_ - 1];
+    }
+
+    bool add(datum_t &&val) {
+        if (depth_ == 0) {
+            result_ = std::move(val);
+        } else if (top()->is_object) {
+            container_t *c = top();
+            c->pairs.emplace_back(std::move(c->key), std::move(val));
+        } else {
+            container_t *c = top();
+            c->array.push_back(std::move(val));
+            rcheck_array_size_datum(c->array, limits_);
+        }
+        return true;
+    }
+
+    const configured_limits_t limits_;
+    std::vector<container_t> stack_;
+    size_t depth_;
+    datum_t result_;
+
+    DISABLE_COPYING(json_to_datum_handler_t);
+};
+
+datum_t parse_json_to_datum_insitu(char *json,
+                                   const configured_limits_t &limits,
+                                   rapidjson::ParseErrorCode *error_out) {
+    json_to_datum_handler_t handler(limits);
+    rapidjson::Reader reader;
+    rapidjson::InsituStringStream stream(json);
+    // The iterative parser doesn't recurse, so deeply nested JSON doesn't need any
+    // more stack than flat JSON.
+    if (!reader.Parse<rapidjson::kParseInsituFlag | rapidjson::kParseIterativeFlag>(
+            stream, handler)) {
+        *error_out = reader.GetParseErrorCode();
+        return datum_t();
+    }
+    return handler.result();
+}
+
 const shared_buf_ref_t<char> *datum_t::get_buf_ref() const {
     if (data.get_internal_type() == internal_type_t::BUF_R_ARRAY
         || data.get_internal_type() == internal_type_t::BUF_R_OBJECT) {
@@ -1487,23 +1618,25 @@ std::pair<datum_string_t, datum_t> datum_t::unchecked_get_pair(size_t index) con
 }
 
 datum_t datum_t::get_field(const datum_string_t &key, throw_bool_t throw_bool) const {
-    // Use binary search on top of unchecked_get_pair()
-    size_t range_beg = 0;
-    // The obj_size() also makes sure that this has the right type (R_OBJECT)
-    size_t range_end = obj_size();
-    while (range_beg < range_end) {
-        const size_t center = range_beg + ((range_end - range_beg) / 2);
-        auto center_pair = unchecked_get_pair(center);
-        const int cmp_res = key.compare(center_pair.first);
-        if (cmp_res == 0) {
-            // Found it
-            return center_pair.second;
-        } else if (cmp_res < 0) {
-            range_end = center;
-        } else {
-            range_beg = center + 1;
+    check_type(R_OBJECT);
+    if (data.get_internal_type() == internal_type_t::BUF_R_OBJECT) {
+        // Search the keys in the buffer, so that we only deserialize the value we
+        // are looking for.
+        size_t value_offset;
+        if (datum_find_field_in_buf(data.buf_ref, key, &value_offset)) {
+            return datum_deserialize_from_buf(data.buf_ref, value_offset);
+        }
+    } else {
+        r_sanity_check(data.get_internal_type() == internal_type_t::R_OBJECT);
+        auto it = std::lower_bound(
+            data.r_object->begin(), data.r_object->end(), key,
+            [](const std::pair<datum_string_t, datum_t> &pair,
+               const datum_string_t &k) {
+                return pair.first < k;
+            });
+        if (it != data.r_object->end() && it->first == key) {
+            return it->second;
         }
-        rassert(range_beg <= range_end);
     }
 
     // Didn't find it
@@ -1574,6 +1707,8 @@ template void datum_t::write_json(
     rapidjson::Writer<rapidjson::StringBuffer> *writer) const;
 template void datum_t::write_json(
     rapidjson::PrettyWriter<rapidjson::StringBuffer> *writer) const;
+template void datum_t::write_json(
+    rapidjson::Writer<chunked_string_buffer_t> *writer) const;
 
 rapidjson::Value datum_t::as_json(rapidjson::Value::AllocatorType *allocator) const {
     switch (get_type()) {
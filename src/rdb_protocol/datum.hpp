@@ -469,6 +469,13 @@ datum_t to_datum(
     const configured_limits_t &,
     reql_version_t);
 
+// Parses the null-terminated `json`, which gets modified in the process, into a
+// datum without building a rapidjson document first.  Returns an empty datum, and
+// sets `*error_out`, if it isn't valid JSON.
+datum_t parse_json_to_datum_insitu(char *json,
+                                   const configured_limits_t &limits,
+                                   rapidjson::ParseErrorCode *error_out);
+
 // DEPRECATED: Used in the r.json term for pre 2.1 backwards compatibility
 datum_t to_datum(cJSON *json, const configured_limits_t &, reql_version_t);
 
@@ -7,6 +7,7 @@
 #include "rdb_protocol/datum_stream/array.hpp"
 #include "rdb_protocol/datum_stream/eq_join.hpp"
 #include "rdb_protocol/datum_stream/fold.hpp"
+#include "rdb_protocol/datum_stream/in_memory_sort.hpp"
 #include "rdb_protocol/datum_stream/indexed_sort.hpp"
 #include "rdb_protocol/datum_stream/lazy.hpp"
 #include "rdb_protocol/datum_stream/map.hpp"
@@ -366,6 +367,21 @@ changefeed::keyspec_t empty_reader_t::get_changespec() const {
         table_name);
 }
 
+datum_t reader_t::explain(UNUSED env_t *env) const {
+    datum_object_builder_t plan;
+    plan.overwrite("type", datum_t("computed"));
+    return std::move(plan).to_datum();
+}
+
+datum_t empty_reader_t::explain(UNUSED env_t *env) const {
+    datum_object_builder_t plan;
+    plan.overwrite("type", datum_t("table_read"));
+    plan.overwrite("table", datum_t(datum_string_t(table_name)));
+    plan.overwrite("access", datum_t("empty"));
+    plan.overwrite("estimated_rows", datum_t(0.0));
+    return std::move(plan).to_datum();
+}
+
 raw_stream_t rget_response_reader_t::unshard(
     sorting_t sorting,
     rget_read_response_t &&res) {
@@ -460,12 +476,8 @@ raw_stream_t rget_response_reader_t::unshard(
 
     // Do the unsharding.
     if (sorting != sorting_t::UNORDERED) {
-        size_t num_iters = 0;
         for (;;) {
-            const size_t YIELD_INTERVAL = 2000;
-            if (++num_iters % YIELD_INTERVAL == 0) {
-                coro_t::yield();
-            }
+            coro_t::maybe_yield();
             pseudoshard_t *best_shard = &pseudoshards[0];
             const store_key_t *best_key = best_shard->best_unpopped_key();
             for (size_t i = 1; i < pseudoshards.size(); ++i) {
@@ -477,7 +489,7 @@ raw_stream_t rget_response_reader_t::unshard(
                 }
             }
             if (auto maybe_item = best_shard->pop()) {
-                ret.push_back(*maybe_item);
+                ret.push_back(std::move(*maybe_item));
             } else {
                 break;
             }
@@ -542,6 +554,57 @@ void rget_response_reader_t::add_transformation(transform_variant_t &&tv) {
     transforms.push_back(std::move(tv));
 }
 
+datum_t rget_response_reader_t::explain(env_t *env) const {
+    datum_object_builder_t plan;
+    plan.overwrite("type", datum_t("table_read"));
+    readgen->add_explain_info(&plan);
+    const optional<std::string> sindex = readgen->sindex_name();
+    plan.overwrite("index",
+                   datum_t(datum_string_t(sindex ? *sindex : table->get_pkey())));
+    plan.overwrite("primary_index", datum_t::boolean(!sindex.has_value()));
+    datum_array_builder_t pushed_down(configured_limits_t::unlimited);
+    for (const transform_variant_t &tv : transforms) {
+        pushed_down.add(datum_t(transform_name(tv)));
+    }
+    plan.overwrite("pushed_down", std::move(pushed_down).to_datum());
+
+    // Secondary index reads go to every shard, and we only know how the primary keys
+    // are distributed, so for them the estimates are of the documents on each shard.
+    const key_range_t range = sindex
+        ? key_range_t::universe()
+        : readgen->original_keyrange(reql_version_t::LATEST);
+    const std::vector<std::pair<key_range_t, int64_t> > shards =
+        table->estimate_shard_doc_counts(env, range);
+    datum_array_builder_t shards_out(configured_limits_t::unlimited);
+    int64_t estimated_rows = 0;
+    for (const auto &shard : shards) {
+        if (!region_overlaps(shard.first, range)) {
+            continue;
+        }
+        datum_object_builder_t shard_out;
+        shard_out.overwrite("key_range", datum_t(datum_string_t(shard.first.print())));
+        shard_out.overwrite("estimated_docs",
+                            datum_t(static_cast<double>(shard.second)));
+        shards_out.add(std::move(shard_out).to_datum());
+        estimated_rows += shard.second;
+    }
+    plan.overwrite("shards", std::move(shards_out).to_datum());
+
+    const optional<uint64_t> max_rows = readgen->max_rows();
+    if (max_rows) {
+        estimated_rows = std::min(estimated_rows, static_cast<int64_t>(*max_rows));
+    }
+    // We don't keep statistics on secondary indexes, so we can only estimate a
+    // secondary index read that covers the whole index (ignoring multi indexes and
+    // rows without the indexed field).
+    const bool can_estimate = !sindex
+        || plan.try_get(datum_string_t("access")) == datum_t("full_scan");
+    plan.overwrite("estimated_rows", can_estimate
+                   ? datum_t(static_cast<double>(estimated_rows))
+                   : datum_t::null());
+    return std::move(plan).to_datum();
+}
+
 bool rget_response_reader_t::add_stamp(changefeed_stamp_t _stamp) {
     stamp.set(std::move(_stamp));
     return true;
@@ -725,7 +788,9 @@ rget_reader_t::do_range_read(env_t *env, const read_t &read) {
     r_sanity_check(stamp.has_value() == rr->stamp.has_value());
     validate_and_record_stamps(stamp, res.stamp_response, &shard_stamp_infos);
 
-    return unshard(rr->sorting, std::move(res));
+    std::vector<rget_item_t> read_items = unshard(rr->sorting, std::move(res));
+    env->charge_rows_read(read_items.size());
+    return read_items;
 }
 
 bool rget_reader_t::load_items(env_t *env, const batchspec_t &batchspec) {
@@ -889,7 +954,9 @@ std::vector<rget_item_t> intersecting_reader_t::do_intersecting_read(
     r_sanity_check(stamp.has_value() == gr->stamp.has_value());
     validate_and_record_stamps(stamp, res.stamp_response, &shard_stamp_infos);
 
-    return unshard(sorting_t::UNORDERED, std::move(res));
+    std::vector<rget_item_t> read_items = unshard(sorting_t::UNORDERED, std::move(res));
+    env->charge_rows_read(read_items.size());
+    return read_items;
 }
 
 readgen_t::readgen_t(
@@ -942,6 +1009,42 @@ sorting_t readgen_t::sorting(const batchspec_t &batchspec) const {
     return batchspec.lazy_sorting(sorting_);
 }
 
+void readgen_t::add_explain_info(datum_object_builder_t *plan) const {
+    plan->overwrite("table", datum_t(datum_string_t(table_name)));
+    switch (read_mode) {
+    case read_mode_t::MAJORITY:
+        plan->overwrite("read_mode", datum_t("majority"));
+        break;
+    case read_mode_t::SINGLE:
+        plan->overwrite("read_mode", datum_t("single"));
+        break;
+    case read_mode_t::OUTDATED:
+        plan->overwrite("read_mode", datum_t("outdated"));
+        break;
+    case read_mode_t::DEBUG_DIRECT:
+        plan->overwrite("read_mode", datum_t("_debug_direct"));
+        break;
+    default: unreachable();
+    }
+    switch (sorting_) {
+    case sorting_t::UNORDERED:
+        plan->overwrite("sorting", datum_t("UNORDERED"));
+        break;
+    case sorting_t::ASCENDING:
+        plan->overwrite("sorting", datum_t("ASCENDING"));
+        break;
+    case sorting_t::DESCENDING:
+        plan->overwrite("sorting", datum_t("DESCENDING"));
+        break;
+    default: unreachable();
+    }
+}
+
+void rget_readgen_t::add_explain_info(datum_object_builder_t *plan) const {
+    readgen_t::add_explain_info(plan);
+    datumspec.add_explain_info(plan);
+}
+
 // TODO: this is how we did it before, but it sucks.
 read_t rget_readgen_t::terminal_read(
     const std::vector<transform_variant_t> &transforms,
@@ -1096,6 +1199,17 @@ optional<std::string> primary_readgen_t::sindex_name() const {
     return optional<std::string>();
 }
 
+optional<uint64_t> primary_readgen_t::max_rows() const {
+    if (!store_keys) {
+        return r_nullopt;
+    }
+    uint64_t rows = 0;
+    for (const auto &pair : *store_keys) {
+        rows += pair.second;
+    }
+    return make_optional(rows);
+}
+
 changefeed::keyspec_t::range_t primary_readgen_t::get_range_spec(
         std::vector<transform_variant_t> transforms) const {
     return changefeed::keyspec_t::range_t{
@@ -1335,6 +1449,17 @@ changefeed::keyspec_t::range_t intersecting_readgen_t::get_range_spec(
         make_optional(query_geometry)};
 }
 
+void intersecting_readgen_t::add_explain_info(datum_object_builder_t *plan) const {
+    readgen_t::add_explain_info(plan);
+    plan->overwrite("access", datum_t("get_intersecting"));
+}
+
+datum_t datum_stream_t::explain(UNUSED env_t *env) const {
+    datum_object_builder_t plan;
+    plan.overwrite("type", datum_t("computed"));
+    return std::move(plan).to_datum();
+}
+
 bool datum_stream_t::add_stamp(changefeed_stamp_t) {
     // By default most datum streams can't stamp their responses.
     return false;
@@ -1359,6 +1484,7 @@ scoped_ptr_t<val_t> datum_stream_t::to_array(env_t *env) {
 
 // DATUM_STREAM_T
 counted_t<datum_stream_t> datum_stream_t::slice(size_t l, size_t r) {
+    note_read_limit(r);
     return make_counted<slice_datum_stream_t>(l, r, this->counted_from_this());
 }
 counted_t<datum_stream_t> datum_stream_t::offsets_of(counted_t<const func_t> f) {
@@ -1436,6 +1562,31 @@ void eager_datum_stream_t::add_transformation(
     update_bt(_bt);
 }
 
+datum_t eager_datum_stream_t::explain(env_t *env) const {
+    datum_t source = explain_source(env);
+    if (transforms.empty()) {
+        return source;
+    }
+    datum_object_builder_t plan(source);
+    datum_array_builder_t names(configured_limits_t::unlimited);
+    for (const transform_variant_t &tv : transforms) {
+        names.add(datum_t(transform_name(tv)));
+    }
+    plan.overwrite("transforms", std::move(names).to_datum());
+    return std::move(plan).to_datum();
+}
+
+datum_t eager_datum_stream_t::explain_source(env_t *env) const {
+    return datum_stream_t::explain(env);
+}
+
+datum_t wrapper_datum_stream_t::explain_source(env_t *env) const {
+    datum_object_builder_t plan;
+    plan.overwrite("type", datum_t(explain_type()));
+    plan.overwrite("source", source->explain(env));
+    return std::move(plan).to_datum();
+}
+
 eager_datum_stream_t::done_t eager_datum_stream_t::next_grouped_batch(
     env_t *env, const batchspec_t &bs, groups_t *out) {
     r_sanity_check(out->size() == 0);
@@ -1622,6 +1773,117 @@ indexed_sort_datum_stream_t::next_raw_batch(env_t *env, const batchspec_t &batch
     return ret;
 }
 
+// IN_MEMORY_SORT_DATUM_STREAM_T
+in_memory_sort_datum_stream_t::in_memory_sort_datum_stream_t(
+    counted_t<datum_stream_t> _source,
+    std::vector<std::pair<order_direction_t, counted_t<const func_t> > >
+        _comparisons,
+    backtrace_id_t bt)
+    : eager_datum_stream_t(bt),
+      source(std::move(_source)),
+      comparisons(std::move(_comparisons)),
+      lt_cmp(comparisons),
+      sorted(false),
+      index(0) { }
+
+bool in_memory_sort_datum_stream_t::is_exhausted() const {
+    return sorted
+        ? index >= data.size() && batch_cache_exhausted()
+        : source->is_exhausted();
+}
+
+feed_type_t in_memory_sort_datum_stream_t::cfeed_type() const {
+    return feed_type_t::not_feed;
+}
+
+bool in_memory_sort_datum_stream_t::is_infinite() const {
+    return false;
+}
+
+datum_t in_memory_sort_datum_stream_t::explain_source(env_t *env) const {
+    datum_object_builder_t plan;
+    plan.overwrite("type", datum_t("order_by"));
+    plan.overwrite("in_memory", datum_t::boolean(true));
+    plan.overwrite("source", source->explain(env));
+    return std::move(plan).to_datum();
+}
+
+bool in_memory_sort_datum_stream_t::is_array() const {
+    return !is_grouped();
+}
+
+void in_memory_sort_datum_stream_t::note_read_limit(uint64_t n) {
+    // A transformation between the sort and the slice (like a `filter`) could drop or
+    // add elements, and then we can't tell which elements the slice will end up with.
+    if (!sorted && !ops_to_do()) {
+        read_limit.set(read_limit.has_value() ? std::min(*read_limit, n) : n);
+    }
+}
+
+void in_memory_sort_datum_stream_t::read_and_sort(env_t *env) {
+    const size_t array_size_limit = env->limits().array_size_limit();
+    if (read_limit.has_value()
+        && *read_limit <= array_size_limit
+        && !source->is_grouped()
+        && !source->is_sorted_table_read()) {
+        // The terminal throws away everything that can't end up in the first
+        // `read_limit` elements, on the shards if `source` reads a table.
+        datum_t kept = source->run_terminal(
+            env, top_k_wire_func_t(comparisons, *read_limit))->as_datum();
+        data.reserve(kept.arr_size());
+        for (size_t i = 0; i < kept.arr_size(); ++i) {
+            data.push_back(kept.get(i));
+        }
+        profile::sampler_t sampler("Sorting in-memory.", env->trace);
+        lt_cmp.sort_prefix(env, &sampler, &data, *read_limit);
+        sorted = true;
+        return;
+    }
+
+    batchspec_t batchspec = batchspec_t::user(batch_type_t::TERMINAL, env);
+    for (;;) {
+        std::vector<datum_t> batch = source->next_batch(env, batchspec);
+        if (batch.size() == 0) {
+            break;
+        }
+        std::move(batch.begin(), batch.end(), std::back_inserter(data));
+        if (read_limit.has_value()) {
+            // Throwing away everything past the first `n` elements whenever we hold
+            // `2n` of them keeps the cost of doing so linear in the input size.
+            const uint64_t n = *read_limit;
+            if (data.size() / 2 >= n) {
+                lt_cmp.sort_prefix(env, nullptr, &data, n);
+            }
+            rcheck(std::min<uint64_t>(data.size(), n) <= array_size_limit,
+                   base_exc_t::RESOURCE,
+                   format_array_size_error(array_size_limit).c_str());
+        } else {
+            rcheck_array_size(data, env->limits());
+        }
+    }
+    profile::sampler_t sampler("Sorting in-memory.", env->trace);
+    if (read_limit.has_value()) {
+        lt_cmp.sort_prefix(env, &sampler, &data, *read_limit);
+    } else {
+        lt_cmp.sort(env, &sampler, &data);
+    }
+    sorted = true;
+}
+
+std::vector<datum_t>
+in_memory_sort_datum_stream_t::next_raw_batch(env_t *env, const batchspec_t &batchspec) {
+    if (!sorted) {
+        read_and_sort(env);
+    }
+    std::vector<datum_t> ret;
+    batcher_t batcher = batchspec.to_batcher();
+    for (; index < data.size() && !batcher.should_send_batch(); ++index) {
+        batcher.note_el(data[index]);
+        ret.push_back(std::move(data[index]));
+    }
+    return ret;
+}
+
 // ORDERED_DISTINCT_DATUM_STREAM_T
 ordered_distinct_datum_stream_t::ordered_distinct_datum_stream_t(
     counted_t<datum_stream_t> _source) : wrapper_datum_stream_t(_source) { }
@@ -1786,6 +2048,15 @@ bool slice_datum_stream_t::is_infinite() const {
     return source->is_infinite() && right == std::numeric_limits<size_t>::max();
 }
 
+datum_t slice_datum_stream_t::explain_source(env_t *env) const {
+    datum_object_builder_t plan(wrapper_datum_stream_t::explain_source(env));
+    plan.overwrite("left", datum_t(static_cast<double>(left)));
+    plan.overwrite("right", right == std::numeric_limits<size_t>::max()
+                       ? datum_t::null()
+                       : datum_t(static_cast<double>(right)));
+    return std::move(plan).to_datum();
+}
+
 // UNION_DATUM_STREAM_T
 class coro_stream_t {
 public:
@@ -1973,6 +2244,18 @@ std::vector<datum_t> ordered_union_datum_stream_t::next_raw_batch(
     return batch;
 }
 
+datum_t ordered_union_datum_stream_t::explain_source(env_t *env) const {
+    datum_object_builder_t plan;
+    plan.overwrite("type", datum_t("union"));
+    plan.overwrite("interleave", datum_t::boolean(is_ordered_by_field));
+    datum_array_builder_t sources(configured_limits_t::unlimited);
+    for (const counted_t<datum_stream_t> &stream : streams) {
+        sources.add(stream->explain(env));
+    }
+    plan.overwrite("sources", std::move(sources).to_datum());
+    return std::move(plan).to_datum();
+}
+
 bool ordered_union_datum_stream_t::is_exhausted() const {
     if (is_ordered_by_field) {
         if (merge_cache.size() == 0 && !do_prelim_cache) {
@@ -2162,6 +2445,17 @@ bool union_datum_stream_t::is_infinite() const {
     return is_infinite_union;
 }
 
+datum_t union_datum_stream_t::explain(env_t *env) const {
+    datum_object_builder_t plan;
+    plan.overwrite("type", datum_t("union"));
+    datum_array_builder_t sources(configured_limits_t::unlimited);
+    for (const scoped_ptr_t<coro_stream_t> &coro_stream : coro_streams) {
+        sources.add(coro_stream->stream->explain(env));
+    }
+    plan.overwrite("sources", std::move(sources).to_datum());
+    return std::move(plan).to_datum();
+}
+
 std::vector<changespec_t> union_datum_stream_t::get_changespecs() {
     std::vector<changespec_t> specs;
     for (auto &&coro_stream : coro_streams) {
@@ -2286,6 +2580,17 @@ map_datum_stream_t::next_raw_batch(env_t *env, const batchspec_t &batchspec) {
     return batch;
 }
 
+datum_t map_datum_stream_t::explain_source(env_t *env) const {
+    datum_object_builder_t plan;
+    plan.overwrite("type", datum_t("map"));
+    datum_array_builder_t sources(configured_limits_t::unlimited);
+    for (const counted_t<datum_stream_t> &stream : streams) {
+        sources.add(stream->explain(env));
+    }
+    plan.overwrite("sources", std::move(sources).to_datum());
+    return std::move(plan).to_datum();
+}
+
 bool map_datum_stream_t::is_exhausted() const {
     for (size_t i = 0; i < streams.size(); ++i) {
         if (streams[i]->is_exhausted() &&
@@ -2312,23 +2617,102 @@ eq_join_datum_stream_t::eq_join_datum_stream_t(counted_t<datum_stream_t> _stream
     is_infinite_eq_join(stream->is_infinite()),
     eq_join_type(stream->cfeed_type()) { }
 
+bool eq_join_datum_stream_t::get_join_key(env_t *env,
+                                          const datum_t &row,
+                                          datum_t *key_out) const {
+    try {
+        *key_out = predicate->call(env, std::vector<datum_t>{row})->as_datum();
+    } catch (const exc_t &e) {
+        if (e.get_type() == base_exc_t::NON_EXISTENCE) {
+            return false;
+        } else {
+            throw;
+        }
+    }
+    return key_out->get_type() != datum_t::type_t::R_NULL;
+}
+
+datum_t eq_join_datum_stream_t::get_right_key(const rget_item_t &item) const {
+    return item.sindex_key.has()
+        ? item.sindex_key
+        : item.data.get_field(join_index);
+}
+
+static datum_t make_eq_join_pair(const datum_t &left, const datum_t &right) {
+    ql::datum_object_builder_t res_item;
+    bool conflict = true;
+    conflict &= res_item.add(datum_string_t("right"), right);
+    conflict &= res_item.add(datum_string_t("left"), left);
+    guarantee(!conflict);
+    return std::move(res_item).to_datum();
+}
+
+bool eq_join_datum_stream_t::fetch_ordered_results(env_t *env,
+                                                   const batchspec_t &batchspec) {
+    std::vector<datum_t> stream_batch = stream->next_batch(env, batchspec);
+    if (stream_batch.empty()) {
+        return false;
+    }
+    std::vector<std::pair<datum_t, datum_t> > left_rows;
+    std::map<datum_t, uint64_t> keys;
+    for (const datum_t &row : stream_batch) {
+        datum_t key_val;
+        if (get_join_key(env, row, &key_val)) {
+            keys[key_val] = 1;
+            left_rows.push_back(std::make_pair(std::move(key_val), row));
+        }
+    }
+    if (keys.empty()) {
+        return true;
+    }
+
+    // Look up the right rows for the whole batch at once, and then emit the pairs in
+    // the order of the left rows.
+    std::multimap<datum_t, datum_t> key_to_right;
+    scoped_ptr_t<reader_t> reader = table->get_all_with_sindexes(
+        env, datumspec_t(std::move(keys)), join_index.to_std(), backtrace());
+    while (!reader->is_finished()) {
+        for (rget_item_t &item : reader->raw_next_batch(env, batchspec)) {
+            datum_t right_key = get_right_key(item);
+            key_to_right.insert(std::make_pair(std::move(right_key),
+                                               std::move(item.data)));
+        }
+    }
+    for (const auto &left_row : left_rows) {
+        auto range = key_to_right.equal_range(left_row.first);
+        for (auto it = range.first; it != range.second; ++it) {
+            ordered_results.push_back(
+                make_eq_join_pair(left_row.second, it->second));
+        }
+    }
+    return true;
+}
+
 std::vector<datum_t> eq_join_datum_stream_t::next_raw_batch(
     env_t *env,
     const batchspec_t &batchspec) {
     batcher_t batcher = batchspec.to_batcher();
 
-    batchspec_t inner_batchspec = ordered ?
-        batchspec_t::all().with_at_most(1) :
-        batchspec;
-
     std::vector<datum_t> res;
     while (!is_exhausted() && !batcher.should_send_batch()) {
+        if (ordered) {
+            if (ordered_results.empty()) {
+                if (!fetch_ordered_results(env, batchspec)) {
+                    // We got an empty batch from the input stream.  See below.
+                    break;
+                }
+                continue;
+            }
+            batcher.note_el(ordered_results.front());
+            res.push_back(std::move(ordered_results.front()));
+            ordered_results.pop_front();
+            continue;
+        }
         if (!get_all_reader.has() ||
             (get_all_reader->is_finished() &&
              get_all_items.empty())) {
             // Get a new batch of keys
-            std::vector<datum_t> stream_batch = stream->next_batch(env,
-                                                                   inner_batchspec);
+            std::vector<datum_t> stream_batch = stream->next_batch(env, batchspec);
             if (stream_batch.empty()) {
                 // We got an empty batch from the input stream. It's either exhausted
                 // or a changefeed. In either case we abort and emit our current results.
@@ -2340,19 +2724,8 @@ std::vector<datum_t> eq_join_datum_stream_t::next_raw_batch(
             std::map<datum_t, uint64_t> keys;
             for (size_t i = 0; i < stream_batch.size(); ++i) {
                 datum_t key_val;
-                try {
-                    key_val = predicate->call(
-                        env,
-                        std::vector<datum_t>{stream_batch[i]})->as_datum();
-                } catch (const exc_t &e) {
-                    if (e.get_type() == base_exc_t::NON_EXISTENCE) {
-                        continue;
-                    } else {
-                        throw;
-                    }
-                }
                 // Build a multimap from sindex value to datums from left side stream.
-                if (key_val.get_type() != datum_t::type_t::R_NULL) {
+                if (get_join_key(env, stream_batch[i], &key_val)) {
                     sindex_to_datum.insert(std::pair<datum_t, datum_t>{
                             key_val, stream_batch[i]});
                     keys[key_val] = 1;
@@ -2376,22 +2749,9 @@ std::vector<datum_t> eq_join_datum_stream_t::next_raw_batch(
         }
         // Get each item in get_all results, and match it with all datums that match
         // in the multimap from the left side stream.
-        std::pair<std::multimap<datum_t, datum_t>::iterator,
-                  std::multimap<datum_t, datum_t>::iterator> range;
-        if (item.sindex_key.has()) {
-            range = sindex_to_datum.equal_range(item.sindex_key);
-        } else {
-            range = sindex_to_datum.equal_range(item.data.get_field(join_index));
-        }
-        datum_string_t right("right");
-        datum_string_t left("left");
+        auto range = sindex_to_datum.equal_range(get_right_key(item));
         for (auto pair = range.first; pair != range.second; ++pair) {
-            ql::datum_object_builder_t res_item;
-            bool conflict = true;
-            conflict &= res_item.add(right, item.data);
-            conflict &= res_item.add(left, pair->second);
-            guarantee(!conflict);
-            datum_t res_datum = std::move(res_item).to_datum();
+            datum_t res_datum = make_eq_join_pair(pair->second, item.data);
             batcher.note_el(res_datum);
             res.push_back(std::move(res_datum));
         }
@@ -2399,9 +2759,20 @@ std::vector<datum_t> eq_join_datum_stream_t::next_raw_batch(
     return res;
 }
 
+datum_t eq_join_datum_stream_t::explain_source(env_t *env) const {
+    // The right side is read with a `get_all` for every batch of the left side.
+    datum_object_builder_t plan;
+    plan.overwrite("type", datum_t("eq_join"));
+    plan.overwrite("source", stream->explain(env));
+    plan.overwrite("table", datum_t(datum_string_t(table->name)));
+    plan.overwrite("index", datum_t(join_index));
+    return std::move(plan).to_datum();
+}
+
 bool eq_join_datum_stream_t::is_exhausted() const {
     if (stream->is_exhausted() &&
         get_all_items.empty() &&
+        ordered_results.empty() &&
         (!get_all_reader.has() || get_all_reader->is_finished())) {
         return batch_cache_exhausted();
     }
@@ -2514,6 +2885,13 @@ fold_datum_stream_t::next_raw_batch(env_t *env, const batchspec_t &batchspec) {
     return batch;
 }
 
+datum_t fold_datum_stream_t::explain_source(env_t *env) const {
+    datum_object_builder_t plan;
+    plan.overwrite("type", datum_t("fold"));
+    plan.overwrite("source", stream->explain(env));
+    return std::move(plan).to_datum();
+}
+
 bool fold_datum_stream_t::is_exhausted() const {
     if (stream->is_exhausted()) {
         return batch_cache_exhausted();
@@ -98,6 +98,20 @@ public:
     virtual feed_type_t cfeed_type() const = 0;
     virtual bool is_infinite() const = 0;
 
+    // Called by `slice`: nothing past the first `n` elements of this stream is ever
+    // going to be read.  Streams that buffer their input may use this to buffer less.
+    virtual void note_read_limit(UNUSED uint64_t n) { }
+
+    // True if the stream reads a table in an order it was asked for.  The shards
+    // each run a terminal on their own rows, so the terminal doesn't see that order.
+    virtual bool is_sorted_table_read() const { return false; }
+
+    // Describes how the stream would be computed, for the `explain` run option.  This
+    // reads no documents, though it may ask the shards how a table's keys are
+    // distributed.  The default is for streams computed on the server that parses the
+    // query.
+    virtual datum_t explain(env_t *env) const;
+
     virtual void accumulate(
         env_t *env, eager_acc_t *acc, const terminal_variant_t &tv) = 0;
     virtual void accumulate_all(env_t *env, eager_acc_t *acc) = 0;
@@ -132,6 +146,10 @@ protected:
     virtual void add_transformation(transform_variant_t &&tv,
                                     backtrace_id_t bt);
 
+    // Adds the `transforms`, which run on this server, to `explain_source()`.
+    virtual datum_t explain(env_t *env) const final;
+    virtual datum_t explain_source(env_t *env) const;
+
 private:
     enum class done_t { YES, NO };
 
@@ -171,6 +189,10 @@ private:
     }
 
 protected:
+    virtual datum_t explain_source(env_t *env) const;
+    // The name of the operation in `explain` plans, e.g. "slice".
+    virtual const char *explain_type() const = 0;
+
     const counted_t<datum_stream_t> source;
 };
 
@@ -1,6 +1,10 @@
 #ifndef RDB_PROTOCOL_DATUM_STREAM_EQ_JOIN_HPP_
 #define RDB_PROTOCOL_DATUM_STREAM_EQ_JOIN_HPP_
 
+#include <deque>
+#include <map>
+#include <vector>
+
 #include "rdb_protocol/datum_stream.hpp"
 
 namespace ql {
@@ -30,6 +34,14 @@ public:
     }
 
 private:
+    datum_t explain_source(env_t *env) const final;
+    // Returns false if `row` doesn't have a key to join on.
+    bool get_join_key(env_t *env, const datum_t &row, datum_t *key_out) const;
+    datum_t get_right_key(const rget_item_t &item) const;
+    // For ordered joins.  Reads a batch of rows from `stream`, and appends the pairs
+    // for them to `ordered_results`.  Returns false if the batch was empty.
+    bool fetch_ordered_results(env_t *env, const batchspec_t &batchspec);
+
     counted_t<datum_stream_t> stream;
     scoped_ptr_t<reader_t> get_all_reader;
     std::vector<rget_item_t> get_all_items;
@@ -40,6 +52,8 @@ private:
     std::multimap<ql::datum_t,
                   ql::datum_t> sindex_to_datum;
 
+    std::deque<datum_t> ordered_results;
+
     counted_t<const func_t> predicate;
 
     bool ordered;
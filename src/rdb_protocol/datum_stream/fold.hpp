@@ -32,6 +32,8 @@ public:
     }
 
 private:
+    datum_t explain_source(env_t *env) const final;
+
     counted_t<datum_stream_t> stream;
     counted_t<const func_t> acc_func;
     counted_t<const func_t> emit_func;
@@ -0,0 +1,51 @@
+// Copyright 2010-2015 RethinkDB, all rights reserved.
+#ifndef RDB_PROTOCOL_DATUM_STREAM_IN_MEMORY_SORT_HPP_
+#define RDB_PROTOCOL_DATUM_STREAM_IN_MEMORY_SORT_HPP_
+
+#include <utility>
+#include <vector>
+
+#include "containers/optional.hpp"
+#include "rdb_protocol/datum_stream.hpp"
+#include "rdb_protocol/order_util.hpp"
+
+namespace ql {
+
+// Reads all of `source` and sorts it in memory the first time anything is read from
+// it.  If the stream gets sliced before that, it only holds on to the elements that
+// can end up in the slice, so `orderBy(...).limit(n)` keeps O(n) elements around no
+// matter how big `source` is.  On a table, that's done by every shard.
+class in_memory_sort_datum_stream_t : public eager_datum_stream_t {
+public:
+    in_memory_sort_datum_stream_t(
+        counted_t<datum_stream_t> source,
+        std::vector<std::pair<order_direction_t, counted_t<const func_t> > >
+            comparisons,
+        backtrace_id_t bt);
+
+    virtual bool is_exhausted() const;
+    virtual feed_type_t cfeed_type() const;
+    virtual bool is_infinite() const;
+    virtual void note_read_limit(uint64_t n);
+
+private:
+    virtual bool is_array() const;
+    virtual std::vector<datum_t>
+    next_raw_batch(env_t *env, const batchspec_t &batchspec);
+    virtual datum_t explain_source(env_t *env) const;
+    void read_and_sort(env_t *env);
+
+    const counted_t<datum_stream_t> source;
+    const std::vector<std::pair<order_direction_t, counted_t<const func_t> > >
+        comparisons;
+    const lt_cmp_t lt_cmp;
+    // How many elements of the sorted order can ever be read from us, if known.
+    optional<uint64_t> read_limit;
+    bool sorted;
+    size_t index;
+    std::vector<datum_t> data;
+};
+
+}  // namespace ql
+
+#endif  // RDB_PROTOCOL_DATUM_STREAM_IN_MEMORY_SORT_HPP_
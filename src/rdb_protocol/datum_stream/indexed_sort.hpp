@@ -16,6 +16,7 @@ public:
 private:
     virtual std::vector<datum_t>
     next_raw_batch(env_t *env, const batchspec_t &batchspec);
+    virtual const char *explain_type() const { return "order_by"; }
 
     std::function<bool(env_t *,  // NOLINT(readability/casting)
                        profile::sampler_t *,
@@ -20,6 +20,8 @@ public:
     bool is_exhausted() const;
     virtual feed_type_t cfeed_type() const;
     virtual bool is_infinite() const;
+    virtual bool is_sorted_table_read() const { return reader->is_sorted(); }
+    virtual datum_t explain(env_t *env) const { return reader->explain(env); }
 
     virtual bool add_stamp(changefeed_stamp_t stamp) {
         return reader->add_stamp(std::move(stamp));
@@ -26,6 +26,8 @@ public:
     }
 
 private:
+    virtual datum_t explain_source(env_t *env) const;
+
     std::vector<counted_t<datum_stream_t> > streams;
     counted_t<const func_t> func;
     feed_type_t union_type;
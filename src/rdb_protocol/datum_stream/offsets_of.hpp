@@ -12,6 +12,7 @@ public:
 private:
     std::vector<datum_t>
     next_raw_batch(env_t *env, const batchspec_t &batchspec);
+    virtual const char *explain_type() const { return "offsets_of"; }
 
     counted_t<const func_t> f;
     int64_t index;
@@ -11,6 +11,7 @@ public:
 private:
     std::vector<datum_t>
     next_raw_batch(env_t *env, const batchspec_t &batchspec);
+    virtual const char *explain_type() const { return "distinct"; }
     datum_t last_val;
 };
 
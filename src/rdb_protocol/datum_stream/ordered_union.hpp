@@ -33,6 +33,8 @@ public:
     }
 
 private:
+    datum_t explain_source(env_t *env) const final;
+
     std::deque<counted_t<datum_stream_t> > streams;
 
     feed_type_t union_type;
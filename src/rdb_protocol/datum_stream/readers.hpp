@@ -22,8 +22,13 @@ public:
     virtual std::vector<rget_item_t> raw_next_batch(
         env_t *, const batchspec_t &) { unreachable(); }
     virtual bool is_finished() const = 0;
+    // True if the reader returns the rows in an order it was asked for.
+    virtual bool is_sorted() const { return false; }
 
     virtual changefeed::keyspec_t get_changespec() const = 0;
+
+    // See `datum_stream_t::explain`.
+    virtual datum_t explain(env_t *env) const;
 };
 
 // To handle empty range on getAll
@@ -52,6 +57,7 @@ public:
         return true;
     }
     virtual changefeed::keyspec_t get_changespec() const;
+    virtual datum_t explain(env_t *env) const;
 
 private:
     counted_t<real_table_t> table;
@@ -125,6 +131,7 @@ public:
     virtual std::vector<rget_item_t> raw_next_batch(env_t *env,
                                                     const batchspec_t &batchspec);
     virtual bool is_finished() const;
+    virtual bool is_sorted() const { return readgen->is_sorted(); }
 
     virtual changefeed::keyspec_t get_changespec() const {
         return changefeed::keyspec_t(
@@ -132,6 +139,7 @@ public:
             table,
             readgen->get_table_name());
     }
+    virtual datum_t explain(env_t *env) const;
 
 protected:
     raw_stream_t unshard(sorting_t sorting, rget_read_response_t &&res);
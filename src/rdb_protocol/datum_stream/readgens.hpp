@@ -42,10 +42,16 @@ public:
     virtual changefeed::keyspec_t::range_t get_range_spec(
         std::vector<transform_variant_t>) const = 0;
 
+    // Adds what the reads cover to an `explain` plan.
+    virtual void add_explain_info(datum_object_builder_t *plan) const;
+    // The most rows the reads can return, if we know that without reading.
+    virtual optional<uint64_t> max_rows() const { return r_nullopt; }
+
     const std::string &get_table_name() const { return table_name; }
     read_mode_t get_read_mode() const { return read_mode; }
     // Returns `sorting_` unless the batchspec overrides it.
     sorting_t sorting(const batchspec_t &batchspec) const;
+    bool is_sorted() const { return sorting_ != sorting_t::UNORDERED; }
 protected:
     const serializable_env_t serializable_env;
     const std::string table_name;
@@ -77,6 +83,8 @@ public:
         std::vector<transform_variant_t> transform,
         const batchspec_t &batchspec) const;
 
+    virtual void add_explain_info(datum_object_builder_t *plan) const;
+
 private:
     virtual rget_read_t next_read_impl(
         const optional<active_ranges_t> &active_ranges,
@@ -118,6 +126,7 @@ private:
     virtual optional<std::string> sindex_name() const;
     void restrict_active_ranges(
         sorting_t sorting, active_ranges_t *active_ranges_inout) const final;
+    virtual optional<uint64_t> max_rows() const;
 
     virtual changefeed::keyspec_t::range_t get_range_spec(
             std::vector<transform_variant_t> transforms) const;
@@ -196,6 +205,8 @@ public:
     virtual changefeed::keyspec_t::range_t get_range_spec(
         std::vector<transform_variant_t>) const;
 
+    virtual void add_explain_info(datum_object_builder_t *plan) const;
+
 private:
     intersecting_readgen_t(
         serializable_env_t s_env,
@@ -15,6 +15,8 @@ private:
     virtual bool is_exhausted() const;
     virtual feed_type_t cfeed_type() const;
     virtual bool is_infinite() const;
+    virtual datum_t explain_source(env_t *env) const;
+    virtual const char *explain_type() const { return "slice"; }
     uint64_t index, left, right;
 };
 
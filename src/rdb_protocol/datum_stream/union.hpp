@@ -26,6 +26,7 @@ public:
     virtual bool is_exhausted() const;
     virtual feed_type_t cfeed_type() const;
     virtual bool is_infinite() const;
+    virtual datum_t explain(env_t *env) const;
 
 private:
     friend class coro_stream_t;
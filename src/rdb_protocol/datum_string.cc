@@ -6,8 +6,12 @@
 #include <string.h>
 
 #include <algorithm>
+#include <array>
 #include <limits>
 
+#include "arch/runtime/runtime.hpp"
+#include "concurrency/cache_line_padded.hpp"
+#include "config/args.hpp"
 #include "containers/archive/archive.hpp"
 #include "containers/archive/buffer_stream.hpp"
 #include "containers/archive/varint.hpp"
@@ -15,19 +19,24 @@
 #include "debug.hpp"
 #include "utils.hpp"
 
+static_assert(sizeof(datum_string_t) == 2 * sizeof(void *),
+              "datum_string_t should be as big as a shared_buf_ref_t.");
+
 datum_string_t::datum_string_t() {
-    init(0, "");
+    init_inline(0, "");
 }
 
 datum_string_t::datum_string_t(size_t _size, const char *_data) {
     init(_size, _data);
 }
 
-datum_string_t::datum_string_t(const shared_buf_ref_t<char> &_ref)
-    : data_(_ref) { }
+datum_string_t::datum_string_t(const shared_buf_ref_t<char> &_ref) {
+    init_from_ref(_ref);
+}
 
-datum_string_t::datum_string_t(shared_buf_ref_t<char> &&_ref)
-    : data_(std::move(_ref)) { }
+datum_string_t::datum_string_t(shared_buf_ref_t<char> &&_ref) {
+    init_from_ref(_ref);
+}
 
 datum_string_t::datum_string_t(const char *c_str) {
     init(strlen(c_str), c_str);
@@ -37,25 +46,163 @@ datum_string_t::datum_string_t(const std::string &str) {
     init(str.size(), str.data());
 }
 
+datum_string_t::datum_string_t(const datum_string_t &copyee) {
+    memcpy(&buf_, &copyee.buf_, sizeof(buf_));
+    if (!is_inline()) {
+        counted_add_ref(buf_.buf);
+    }
+}
+
+datum_string_t::datum_string_t(datum_string_t &&movee) noexcept {
+    memcpy(&buf_, &movee.buf_, sizeof(buf_));
+    movee.init_inline(0, "");
+}
+
+datum_string_t &datum_string_t::operator=(const datum_string_t &copyee) {
+    if (this != &copyee) {
+        release();
+        memcpy(&buf_, &copyee.buf_, sizeof(buf_));
+        if (!is_inline()) {
+            counted_add_ref(buf_.buf);
+        }
+    }
+    return *this;
+}
+
+datum_string_t &datum_string_t::operator=(datum_string_t &&movee) noexcept {
+    if (this != &movee) {
+        release();
+        memcpy(&buf_, &movee.buf_, sizeof(buf_));
+        movee.init_inline(0, "");
+    }
+    return *this;
+}
+
+namespace {
+
+/* Every thread remembers the last few long-ish strings that were `interned()` on it,
+by the hash of their content.  A string that's too long to be stored inline but
+isn't longer than this gets interned. */
+const size_t MAX_INTERNED_SIZE = 64;
+const size_t INTERNED_TABLE_SIZE = 256;
+
+struct interned_strings_t {
+    // Each `datum_string_t` keeps its buffer alive.  The tables get destroyed when
+    // the process exits, on a thread that frees the buffers directly.
+    std::array<datum_string_t, INTERNED_TABLE_SIZE> table;
+};
+
+std::array<cache_line_padded_t<interned_strings_t>, MAX_THREADS> interned_strings;
+
+size_t hash_string(size_t size, const char *data) {
+    // FNV-1a
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < size; ++i) {
+        hash = (hash ^ static_cast<uint8_t>(data[i])) * 1099511628211ULL;
+    }
+    return static_cast<size_t>(hash);
+}
+
+}  // namespace
+
+datum_string_t datum_string_t::interned(size_t _size, const char *_data) {
+    const int thread = get_thread_id().threadnum;
+    if (_size <= INLINE_CAPACITY || _size > MAX_INTERNED_SIZE || thread < 0) {
+        return datum_string_t(_size, _data);
+    }
+    rassert(thread < MAX_THREADS);
+    datum_string_t *entry = &interned_strings[thread].value.table[
+        hash_string(_size, _data) % INTERNED_TABLE_SIZE];
+    if (entry->compare(_size, _data) != 0) {
+        *entry = datum_string_t(_size, _data);
+    }
+    return *entry;
+}
+
+datum_string_t::~datum_string_t() {
+    release();
+}
+
 void datum_string_t::init(size_t _size, const char *_data) {
+    if (_size <= INLINE_CAPACITY) {
+        init_inline(_size, _data);
+        return;
+    }
     const size_t str_offset = varint_uint64_serialized_size(_size);
     counted_t<shared_buf_t> buffer = shared_buf_t::create(str_offset + _size);
     serialize_varint_uint64_into_buf(_size, reinterpret_cast<uint8_t *>(buffer->data()));
     memcpy(buffer->data() + str_offset, _data, _size);
-    data_ = shared_buf_ref_t<char>(std::move(buffer), 0);
+    init_from_ref(shared_buf_ref_t<char>(std::move(buffer), 0));
+}
+
+void datum_string_t::init_from_ref(const shared_buf_ref_t<char> &ref) {
+    buffer_read_stream_t data_stream(ref.get(), ref.get_safety_boundary());
+    uint64_t str_size = 0;
+    guarantee_deserialization(deserialize_varint_uint64(&data_stream, &str_size),
+                              "wire_string size");
+    if (str_size <= INLINE_CAPACITY) {
+        // We don't hold on to the buffer for a string this short.
+        const size_t data_offset = static_cast<size_t>(data_stream.tell());
+        ref.guarantee_in_boundary(data_offset + str_size);
+        init_inline(static_cast<size_t>(str_size), ref.get() + data_offset);
+        return;
+    }
+
+    const size_t offset = ref.get_offset();
+    guarantee(offset < (static_cast<uint64_t>(1) << 56), "Buffer offset too large.");
+    buf_.buf = ref.get_buf().get();
+    counted_add_ref(buf_.buf);
+    buf_.offset_low = static_cast<uint32_t>(offset);
+    buf_.offset_mid = static_cast<uint16_t>(offset >> 32);
+    buf_.offset_high = static_cast<uint8_t>(offset >> 48);
+    buf_.tag = 0;
+}
+
+void datum_string_t::init_inline(size_t _size, const char *_data) {
+    static_assert(sizeof(inline_rep_t) == sizeof(buf_rep_t)
+                  && offsetof(inline_rep_t, tag) == offsetof(buf_rep_t, tag),
+                  "The tags of both representations must be in the same place.");
+    rassert(_size <= INLINE_CAPACITY);
+    memcpy(inline_.data, _data, _size);
+    inline_.tag = static_cast<uint8_t>(_size + 1);
+}
+
+void datum_string_t::release() {
+    if (!is_inline()) {
+        counted_release(buf_.buf);
+    }
+}
+
+const char *datum_string_t::buf_data() const {
+    rassert(!is_inline());
+    const size_t offset = static_cast<size_t>(buf_.offset_low)
+        | (static_cast<size_t>(buf_.offset_mid) << 32)
+        | (static_cast<size_t>(buf_.offset_high) << 48);
+    rassert(buf_.buf->size() >= offset);
+    return buf_.buf->data(offset);
+}
+
+size_t datum_string_t::buf_safety_boundary() const {
+    return buf_.buf->size() - (buf_data() - buf_.buf->data());
 }
 
 const char *datum_string_t::data() const {
+    if (is_inline()) {
+        return inline_.data;
+    }
     const size_t str_size = size();
     size_t data_offset = varint_uint64_serialized_size(str_size);
-    data_.guarantee_in_boundary(data_offset + str_size);
-    return data_.get() + data_offset;
+    guarantee(buf_safety_boundary() >= data_offset + str_size);
+    return buf_data() + data_offset;
 }
 
 size_t datum_string_t::size() const {
+    if (is_inline()) {
+        return inline_.tag - 1;
+    }
     uint64_t res = 0;
     static_assert(sizeof(uint8_t) == sizeof(char), "sizeof(uint8_t) != sizeof(char)");
-    buffer_read_stream_t data_stream(data_.get(), data_.get_safety_boundary());
+    buffer_read_stream_t data_stream(buf_data(), buf_safety_boundary());
     guarantee_deserialization(deserialize_varint_uint64(&data_stream, &res),
                               "wire_string size");
     guarantee(res <= static_cast<uint64_t>(std::numeric_limits<size_t>::max()));
@@ -67,6 +214,10 @@ bool datum_string_t::empty() const {
 }
 
 int datum_string_t::compare(const datum_string_t &other) const {
+    // Interned strings and copies of the same string point to the same buffer.
+    if (!is_inline() && memcmp(&buf_, &other.buf_, sizeof(buf_)) == 0) {
+        return 0;
+    }
     return compare(other.size(), other.data());
 }
 
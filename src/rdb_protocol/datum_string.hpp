@@ -2,6 +2,8 @@
 #ifndef RDB_PROTOCOL_DATUM_STRING_HPP_
 #define RDB_PROTOCOL_DATUM_STRING_HPP_
 
+#include <stdint.h>
+
 #include <string>
 
 #include "containers/archive/archive.hpp"
@@ -13,7 +15,9 @@
  * - it can contain any character, including '\0'
  *
  * Underneath `datum_string_t` uses a `shared_buf_ref_t`. This makes it
- * relatively cheap to copy.
+ * relatively cheap to copy.  Short strings are stored inline instead, so that they
+ * don't need a buffer of their own, and copying them doesn't have to touch an
+ * (atomic) reference count.
  */
 class datum_string_t {
 public:
@@ -35,6 +39,17 @@ public:
     explicit datum_string_t(const shared_buf_ref_t<char> &_ref);
     explicit datum_string_t(shared_buf_ref_t<char> &&_ref);
 
+    datum_string_t(const datum_string_t &copyee);
+    datum_string_t(datum_string_t &&movee) noexcept;
+    datum_string_t &operator=(const datum_string_t &copyee);
+    datum_string_t &operator=(datum_string_t &&movee) noexcept;
+    ~datum_string_t();
+
+    // Like the `(size, data)` constructor, but strings with the same content that are
+    // created this way on the same thread usually share a buffer.  This is meant for
+    // object keys, which tend to be the same in every document of a batch.
+    static datum_string_t interned(size_t _size, const char *_data);
+
     // The result of data() is not automatically null terminated. Do not use
     // as a C string.
     const char *data() const;
@@ -57,11 +72,37 @@ public:
 
 private:
     void init(size_t _size, const char *_data);
+    void init_from_ref(const shared_buf_ref_t<char> &ref);
+    void init_inline(size_t _size, const char *_data);
+    void release();
     int compare(size_t other_size, const char *other_data) const;
 
-    // Contains the length of the string in varint encoding, followed by the actual
-    // string content.
-    shared_buf_ref_t<char> data_;
+    bool is_inline() const { return inline_.tag != 0; }
+    // The location of the string in the shared buffer, which contains the length
+    // of the string in varint encoding, followed by the actual string content.
+    const char *buf_data() const;
+    size_t buf_safety_boundary() const;
+
+    // Both representations end in `tag`, which is 0 for a string in a shared buffer,
+    // and the size plus one for an inline string.
+    struct buf_rep_t {
+        // We hold a reference to `buf`.
+        const shared_buf_t *buf;
+        uint32_t offset_low;
+        uint16_t offset_mid;
+        uint8_t offset_high;
+        uint8_t tag;
+    };
+    static const size_t INLINE_CAPACITY = sizeof(buf_rep_t) - 1;
+    struct inline_rep_t {
+        char data[INLINE_CAPACITY];
+        uint8_t tag;
+    };
+
+    union {
+        buf_rep_t buf_;
+        inline_rep_t inline_;
+    };
 };
 
 datum_string_t concat(const datum_string_t &a, const datum_string_t &b);
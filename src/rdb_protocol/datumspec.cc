@@ -13,19 +13,20 @@ void debug_print(printf_buffer_t *buf, const datum_range_t &rng) {
 }
 
 datum_range_t::datum_range_t()
-    : left_bound_type(key_range_t::none), right_bound_type(key_range_t::none) { }
+    : left_bound_type(key_range_t::none), right_bound_type(key_range_t::none),
+      skip_scan(false) { }
 
 datum_range_t::datum_range_t(
     datum_t _left_bound, key_range_t::bound_t _left_bound_type,
     datum_t _right_bound, key_range_t::bound_t _right_bound_type)
     : left_bound_type(_left_bound_type), right_bound_type(_right_bound_type),
-      left_bound(_left_bound), right_bound(_right_bound) {
+      left_bound(_left_bound), right_bound(_right_bound), skip_scan(false) {
     r_sanity_check(left_bound.has() && right_bound.has());
 }
 
 datum_range_t::datum_range_t(datum_t val)
     : left_bound_type(key_range_t::closed), right_bound_type(key_range_t::closed),
-      left_bound(val), right_bound(val) {
+      left_bound(val), right_bound(val), skip_scan(false) {
     r_sanity_check(val.has());
 }
 
@@ -50,12 +51,40 @@ bool datum_range_t::operator<(const datum_range_t &o) const {
     if (bound_lt(o.left_bound_type, o.left_bound, left_bound_type, left_bound)) {
         return false;
     }
-    return bound_lt(right_bound_type, right_bound, o.right_bound_type, o.right_bound);
+    if (bound_lt(right_bound_type, right_bound, o.right_bound_type, o.right_bound)) {
+        return true;
+    }
+    if (bound_lt(o.right_bound_type, o.right_bound, right_bound_type, right_bound)) {
+        return false;
+    }
+    return !skip_scan && o.skip_scan;
+}
+
+// The elements of the array `arr` after the first one.
+static datum_t array_tail(const datum_t &arr) {
+    datum_array_builder_t tail(configured_limits_t::unlimited);
+    for (size_t i = 1; i < arr.arr_size(); ++i) {
+        tail.add(arr.get(i));
+    }
+    return std::move(tail).to_datum();
 }
 
 bool datum_range_t::contains(datum_t val) const {
     r_sanity_check(left_bound.has() && right_bound.has());
 
+    if (skip_scan) {
+        if (val.get_type() != datum_t::R_ARRAY || val.arr_size() == 0) {
+            return false;
+        }
+        datum_t first = val.get(0);
+        if (first < left_bound.get(0) || first > right_bound.get(0)) {
+            return false;
+        }
+        return datum_range_t(array_tail(left_bound), left_bound_type,
+                             array_tail(right_bound), right_bound_type)
+            .contains(array_tail(val));
+    }
+
     int left_cmp = left_bound.cmp(val);
     int right_cmp = right_bound.cmp(val);
     return (left_cmp < 0
@@ -121,14 +150,87 @@ std::string datum_range_t::get_right_bound_trunc_key(reql_version_t reql_ver) co
         ql::extrema_ok_t::OK));
 }
 
+void datum_range_t::add_bounds_info(datum_object_builder_t *info) const {
+    if (left_bound.get_type() == datum_t::type_t::MINVAL) {
+        info->overwrite("left_bound_type", datum_t("unbounded"));
+    } else if (left_bound.get_type() == datum_t::type_t::MAXVAL) {
+        info->overwrite("left_bound_type", datum_t("unachievable"));
+    } else {
+        info->overwrite("left_bound", left_bound);
+        info->overwrite("left_bound_type", datum_t(
+            left_bound_type == key_range_t::open ? "open" : "closed"));
+    }
+    if (right_bound.get_type() == datum_t::type_t::MAXVAL) {
+        info->overwrite("right_bound_type", datum_t("unbounded"));
+    } else if (right_bound.get_type() == datum_t::type_t::MINVAL) {
+        info->overwrite("right_bound_type", datum_t("unachievable"));
+    } else {
+        info->overwrite("right_bound", right_bound);
+        info->overwrite("right_bound_type", datum_t(
+            right_bound_type == key_range_t::open ? "open" : "closed"));
+    }
+}
+
 datum_range_t datum_range_t::with_left_bound(datum_t d, key_range_t::bound_t type) {
     r_sanity_check(d.has() && right_bound.has());
-    return datum_range_t(d, type, right_bound, right_bound_type);
+    datum_range_t res(d, type, right_bound, right_bound_type);
+    res.skip_scan = skip_scan;
+    return res;
 }
 
 datum_range_t datum_range_t::with_right_bound(datum_t d, key_range_t::bound_t type) {
     r_sanity_check(left_bound.has() && d.has());
-    return datum_range_t(left_bound, left_bound_type, d, type);
+    datum_range_t res(left_bound, left_bound_type, d, type);
+    res.skip_scan = skip_scan;
+    return res;
+}
+
+datum_range_t datum_range_t::with_skip_scan() const {
+    r_sanity_check(left_bound.get_type() == datum_t::R_ARRAY
+                   && left_bound.arr_size() >= 2
+                   && right_bound.get_type() == datum_t::R_ARRAY
+                   && right_bound.arr_size() >= 2);
+    datum_range_t res = *this;
+    res.skip_scan = true;
+    return res;
+}
+
+// The key of the elements of `bound` after the first, as they appear in the index key
+// of an array with the same elements.
+static bool skip_scan_tail_key(const datum_t &bound,
+                        reql_version_t reql_version,
+                        std::string *tail_key_out) {
+    datum_t tail = array_tail(bound);
+    for (size_t i = 0; i < tail.arr_size(); ++i) {
+        // The key of an array element ends with two null bytes, which could be
+        // mistaken for the end of the index value.
+        if (tail.get(i).get_type() == datum_t::R_ARRAY) {
+            return false;
+        }
+    }
+    // That's the type prefix of the array, the keys of its elements each followed by a
+    // null byte, and the null byte that every index value ends with.
+    std::string key = key_to_unescaped_str(
+        tail.truncated_secondary(reql_version, extrema_ok_t::OK));
+    if (key.size() >= datum_t::max_trunc_size()) {
+        return false;
+    }
+    guarantee(key.size() >= 2);
+    *tail_key_out = key.substr(1, key.size() - 2);
+    return true;
+}
+
+bool datum_range_t::get_skip_scan_tail_keys(reql_version_t reql_version,
+                                            std::string *left_tail_out,
+                                            std::string *right_tail_out) const {
+    r_sanity_check(skip_scan);
+    // Before 2.3 `r.minval` was a null byte in an index key, so null bytes didn't
+    // tell where the elements of an array end.
+    if (reql_version < reql_version_t::v2_3) {
+        return false;
+    }
+    return skip_scan_tail_key(left_bound, reql_version, left_tail_out)
+        && skip_scan_tail_key(right_bound, reql_version, right_tail_out);
 }
 
 datumspec_t datumspec_t::trim_secondary(
@@ -194,10 +296,34 @@ optional<std::map<store_key_t, uint64_t> > datumspec_t::primary_key_map() const
         });
 }
 
+void datumspec_t::add_explain_info(datum_object_builder_t *info) const {
+    visit<void>(
+        [&](const datum_range_t &dr) {
+            if (dr.is_universe()) {
+                info->overwrite("access", datum_t("full_scan"));
+            } else if (dr.is_skip_scan()) {
+                info->overwrite("access", datum_t("skip_scan"));
+                dr.add_bounds_info(info);
+            } else {
+                info->overwrite("access", datum_t("between"));
+                dr.add_bounds_info(info);
+            }
+        },
+        [&](const std::map<datum_t, uint64_t> &m) {
+            info->overwrite("access", datum_t("get_all"));
+            datum_array_builder_t keys(configured_limits_t::unlimited);
+            for (const auto &pair : m) {
+                keys.add(pair.first);
+            }
+            info->overwrite("keys", std::move(keys).to_datum());
+        });
+}
+
 ARCHIVE_PRIM_MAKE_RANGED_SERIALIZABLE(key_range_t::bound_t, int8_t,
                                       key_range_t::open, key_range_t::none);
-RDB_IMPL_SERIALIZABLE_4(
-        datum_range_t, left_bound, right_bound, left_bound_type, right_bound_type);
+RDB_IMPL_SERIALIZABLE_5(
+        datum_range_t, left_bound, right_bound, left_bound_type, right_bound_type,
+        skip_scan);
 INSTANTIATE_SERIALIZABLE_FOR_CLUSTER(datum_range_t);
 
 RDB_IMPL_SERIALIZABLE_1(datumspec_t, spec);
@@ -29,6 +29,22 @@ public:
     bool is_empty() const;
     bool is_universe() const;
 
+    // A skip-scan range of arrays contains the arrays whose first element is between
+    // the first elements of the bounds (inclusive), and whose other elements are
+    // between the other elements of the bounds, as arrays.  That is a subset of the
+    // arrays between the bounds, so the key range of a skip-scan range is the same as
+    // that of the plain one, and readers can skip the parts of it in between.
+    datum_range_t with_skip_scan() const;
+    bool is_skip_scan() const { return skip_scan; }
+
+    // Computes the keys that the elements after the first of `left_bound` and
+    // `right_bound` have in an index key, which is what `rget_skip_scan_cb_wrapper_t`
+    // compares the index keys of the leading element's values to.  Returns false if
+    // the index keys of `reql_version` can't be compared that way.
+    bool get_skip_scan_tail_keys(reql_version_t reql_version,
+                                 std::string *left_tail_out,
+                                 std::string *right_tail_out) const;
+
     RDB_DECLARE_ME_SERIALIZABLE(datum_range_t);
 
     // Make sure you know what you're doing if you call these, and think about
@@ -45,18 +61,24 @@ public:
     datum_range_t with_right_bound(datum_t d, key_range_t::bound_t type);
 
     std::string print() const {
-        return strprintf("%c%s,%s%c",
+        return strprintf("%c%s,%s%c%s",
                          left_bound_type == key_range_t::open ? '(' : '[',
                          left_bound.print().c_str(),
                          right_bound.print().c_str(),
-                         right_bound_type == key_range_t::open ? ')' : ']');
+                         right_bound_type == key_range_t::open ? ')' : ']',
+                         skip_scan ? " skip_scan" : "");
     }
 
+    // Adds `left_bound`, `left_bound_type` and so on to `info`, the way `info` and
+    // `explain` show a range to the user.
+    void add_bounds_info(datum_object_builder_t *info) const;
+
     key_range_t::bound_t left_bound_type, right_bound_type;
 
 private:
     friend class info_term_t;
     datum_t left_bound, right_bound;
+    bool skip_scan;
 };
 
 void debug_print(printf_buffer_t *buf, const datum_range_t &rng);
@@ -131,6 +153,8 @@ public:
     datum_range_t covering_range() const;
     size_t copies(datum_t key) const;
     optional<std::map<store_key_t, uint64_t> > primary_key_map() const;
+    // Describes the range or keys for `explain`.
+    void add_explain_info(datum_object_builder_t *info) const;
 
     RDB_DECLARE_ME_SERIALIZABLE(datumspec_t);
 private:
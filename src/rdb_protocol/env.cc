@@ -31,22 +31,66 @@
 
 #include "rdb_protocol/env.hpp"
 
+#include <array>
+
+#include "concurrency/cache_line_padded.hpp"
 #include "concurrency/cross_thread_watchable.hpp"
 #include "extproc/js_runner.hpp"
+#include "perfmon/perfmon.hpp"
 #include "rdb_protocol/func.hpp"
 #include "rdb_protocol/minidriver.hpp"
 #include "rdb_protocol/term_walker.hpp"
 
 #include "debug.hpp"
 
-// This is a totally arbitrary constant limiting the size of the regex cache.  1000
-// was chosen out of a hat; if you have a good argument for it being something else
-// (apart from cache line concerns, which are irrelevant due to the implementation)
-// you're probably right.
+// This is a totally arbitrary constant limiting the size of each thread's regex
+// cache.  1000 was chosen out of a hat; if you have a good argument for it being
+// something else (apart from cache line concerns, which are irrelevant due to the
+// implementation) you're probably right.
 const size_t LRU_CACHE_SIZE = 1000;
 
 namespace ql {
 
+struct regex_cache_stats_t {
+    perfmon_counter_t pm_hits;
+    perfmon_counter_t pm_misses;
+    perfmon_multi_membership_t membership;
+
+    regex_cache_stats_t()
+        : membership(&get_global_perfmon_collection(),
+                     &pm_hits, "regex_cache_hits",
+                     &pm_misses, "regex_cache_misses") { }
+};
+
+static regex_cache_stats_t *get_regex_cache_stats() {
+    static regex_cache_stats_t stats;
+    return &stats;
+}
+
+bool regex_cache_t::lookup(const std::string &pattern,
+                           std::shared_ptr<re2::RE2> **out) {
+    if (regexes.lookup(pattern, out)) {
+        ++get_regex_cache_stats()->pm_hits;
+        return true;
+    } else {
+        ++get_regex_cache_stats()->pm_misses;
+        return false;
+    }
+}
+
+// Each thread only touches its own entry. The caches are created on first use.
+static std::array<cache_line_padded_t<scoped_ptr_t<regex_cache_t> >, MAX_THREADS>
+    per_thread_regex_caches;
+
+regex_cache_t &env_t::regex_cache() {
+    scoped_ptr_t<regex_cache_t> *cache =
+        &per_thread_regex_caches[get_thread_id().threadnum].value;
+    if (!cache->has()) {
+        cache->init(new regex_cache_t(LRU_CACHE_SIZE));
+    }
+    return **cache;
+}
+
 void env_t::set_eval_callback(eval_callback_t *callback) {
     eval_callback_ = callback;
 }
@@ -92,12 +136,16 @@ env_t::env_t(rdb_context_t *ctx,
     : serializable_(std::move(s_env)),
       limits_(from_optargs(ctx, _interruptor, &serializable_.global_optargs,
                            serializable_.deterministic_time)),
+      quota_(quota_from_optargs(ctx, _interruptor, &serializable_.global_optargs,
+                                serializable_.deterministic_time)),
+      usage_(&own_usage_),
+      cpu_sample_nanos_(0),
+      cpu_sample_resume_count_(0),
+      calls_until_cpu_sample_(0),
       reql_version_(reql_version_t::LATEST),
-      regex_cache_(LRU_CACHE_SIZE),
       return_empty_normal_batches(_return_empty_normal_batches),
       interruptor(_interruptor),
       trace(_trace),
-      evals_since_yield_(0),
       rdb_ctx_(ctx),
       eval_callback_(NULL) {
     rassert(ctx != NULL);
@@ -128,12 +176,14 @@ env_t::env_t(signal_t *_interruptor,
         global_optargs_t(),
         auth::user_context_t(auth::permissions_t(tribool::False, tribool::False, tribool::False, tribool::False)),
         datum_t()},
+      usage_(&own_usage_),
+      cpu_sample_nanos_(0),
+      cpu_sample_resume_count_(0),
+      calls_until_cpu_sample_(0),
       reql_version_(_reql_version),
-      regex_cache_(LRU_CACHE_SIZE),
       return_empty_normal_batches(_return_empty_normal_batches),
       interruptor(_interruptor),
       trace(NULL),
-      evals_since_yield_(0),
       rdb_ctx_(NULL),
       eval_callback_(NULL) {
     rassert(interruptor != NULL);
@@ -142,10 +192,50 @@ env_t::env_t(signal_t *_interruptor,
 env_t::~env_t() { }
 
 void env_t::maybe_yield() {
-    if (++evals_since_yield_ > EVALS_BEFORE_YIELD) {
-        evals_since_yield_ = 0;
-        coro_t::yield();
+    if (quota_.cpu_limit_nanos == 0) {
+        coro_t::maybe_yield();
+        return;
     }
+    if (calls_until_cpu_sample_ > 0) {
+        --calls_until_cpu_sample_;
+    } else {
+        calls_until_cpu_sample_ = COROUTINE_YIELD_CLOCK_CHECK_INTERVAL - 1;
+        // We only charge the time since the last sample if the coroutine kept the
+        // thread all along, so that time spent waiting for other servers or the disk
+        // is free. The interval is charged before we yield below, and the sample
+        // restarts when we get the thread back, so queries that run long enough to
+        // yield here still get charged.
+        if (cpu_sample_nanos_ != 0
+            && coro_t::resume_count() == cpu_sample_resume_count_) {
+            const int64_t now = get_ticks().nanos;
+            usage_->cpu_nanos += now - cpu_sample_nanos_;
+            cpu_sample_nanos_ = now;
+            rcheck_datum(
+                usage_->cpu_nanos <= quota_.cpu_limit_nanos,
+                base_exc_t::RESOURCE,
+                strprintf("Query exceeded its CPU time limit of %g seconds.  (Use "
+                          "the `cpu_limit` optarg to raise it.)",
+                          static_cast<double>(quota_.cpu_limit_nanos) / BILLION));
+        } else {
+            cpu_sample_nanos_ = 0;
+        }
+    }
+    const uint64_t resume_count = coro_t::resume_count();
+    coro_t::maybe_yield();
+    if (cpu_sample_nanos_ == 0 || coro_t::resume_count() != resume_count) {
+        cpu_sample_nanos_ = get_ticks().nanos;
+        cpu_sample_resume_count_ = coro_t::resume_count();
+    }
+}
+
+void env_t::charge_rows_read(size_t rows) {
+    usage_->rows_read += rows;
+    rcheck_datum(
+        quota_.read_limit == 0 || usage_->rows_read <= quota_.read_limit,
+        base_exc_t::RESOURCE,
+        strprintf("Query exceeded its read limit of %" PRIu64 " rows.  (Use the "
+                  "`read_limit` optarg to raise it.)",
+                  quota_.read_limit));
 }
 
 } // namespace ql
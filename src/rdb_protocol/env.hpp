@@ -65,9 +65,22 @@ class term_t;
 
 scoped_ptr_t<profile::trace_t> maybe_make_profile_trace(profile_bool_t profile);
 
-struct regex_cache_t {
+// Compiled regexes for `match`. There is one cache per thread, shared by all of the
+// queries on it, because the same few patterns tend to be used by many queries.
+class regex_cache_t {
+public:
     explicit regex_cache_t(size_t cache_size) : regexes(cache_size) {}
+
+    // Like `lru_cache_t::lookup()`, but also counts hits and misses in the stats.
+    bool lookup(const std::string &pattern, std::shared_ptr<re2::RE2> **out);
+    void insert(const std::string &pattern, std::shared_ptr<re2::RE2> regex) {
+        regexes.insert(pattern, std::move(regex));
+    }
+
+private:
     lru_cache_t<std::string, std::shared_ptr<re2::RE2> > regexes;
+
+    DISABLE_COPYING(regex_cache_t);
 };
 
 class env_t : public home_thread_mixin_t {
@@ -96,9 +109,21 @@ public:
 
     ~env_t();
 
-    // Will yield after EVALS_BEFORE_YIELD calls
+    // Yields if the coroutine has been running for a while; see `coro_t::maybe_yield()`.
+    // If the query has a `cpu_limit`, this is also where the time it spent running is
+    // charged to it, failing the query once it goes over the limit.
     void maybe_yield();
 
+    // Charges rows that the query read from a table to it, failing the query if that
+    // takes it over its `read_limit`.
+    void charge_rows_read(size_t rows);
+
+    // Makes this environment charge the resources it uses to `usage`, which belongs to
+    // the query it evaluates, instead of to itself.
+    void set_usage(query_usage_t *usage) {
+        usage_ = usage;
+    }
+
     extproc_pool_t *get_extproc_pool();
 
     reql_cluster_interface_t *reql_cluster_interface();
@@ -152,7 +177,8 @@ public:
         }
     }
 
-    regex_cache_t &regex_cache() { return regex_cache_; }
+    // Returns the cache of the current thread.
+    regex_cache_t &regex_cache();
 
     reql_version_t reql_version() const { return reql_version_; }
 
@@ -162,14 +188,21 @@ private:
     // User specified configuration limits; e.g. array size limits
     const configured_limits_t limits_;
 
+    const query_quota_t quota_;
+    query_usage_t own_usage_;
+    query_usage_t *usage_;
+
+    // When `maybe_yield()` last looked at the clock and `coro_t::resume_count()` at the
+    // time, and how many more calls to it there are before it looks again.
+    int64_t cpu_sample_nanos_;
+    uint64_t cpu_sample_resume_count_;
+    int calls_until_cpu_sample_;
+
     // The version of ReQL behavior that we should use.  Normally this is
     // LATEST_DISK, but when evaluating secondary index functions, it could be an
     // earlier value.
     const reql_version_t reql_version_;
 
-    // query specific cache parameters; for example match regexes.
-    regex_cache_t regex_cache_;
-
 public:
     const return_empty_normal_batches_t return_empty_normal_batches;
 
@@ -184,9 +217,6 @@ public:
     rdb_context_t *get_rdb_ctx() { return rdb_ctx_; }
 
 private:
-    static const uint32_t EVALS_BEFORE_YIELD = 256;
-    uint32_t evals_since_yield_;
-
     rdb_context_t *const rdb_ctx_;
 
     eval_callback_t *eval_callback_;
@@ -67,12 +67,17 @@ private:
     DISABLE_COPYING(collect_keys_helper_t);
 };
 
-continue_bool_t rdb_erase_small_range(
+/* This does the work for both `rdb_erase_small_range()` and
+`rdb_delete_small_range()`. `delete_mode` is `ERASE` for the former and `REGULAR_QUERY`
+for the latter, and `timestamp` is only used for `REGULAR_QUERY`. */
+static continue_bool_t remove_small_range(
         btree_slice_t *btree_slice,
         key_tester_t *tester,
         const key_range_t &key_range,
         superblock_t *superblock,
         const deletion_context_t *deletion_context,
+        delete_mode_t delete_mode,
+        repli_timestamp_t timestamp,
         signal_t *interruptor,
         uint64_t max_keys_to_erase,
         std::vector<rdb_modification_report_t> *mod_reports_out,
@@ -95,67 +100,84 @@ continue_bool_t rdb_erase_small_range(
         throw interrupted_exc_t();
     }
 
-    /* Step 2: Erase each key individually and create the corresponding
-       modification reports. */
+    /* Step 2: Erase the keys and create the corresponding modification reports. We
+       go down the tree once per leaf: the keys are in order, so we erase all of them
+       that are in the same leaf in one go, and only rebalance the leaf at the end. */
     const max_block_size_t max_block_size = superblock->cache()->max_block_size();
     rdb_value_sizer_t sizer(max_block_size);
-    for (const auto &key : key_collector.get_collected_keys()) {
+    const std::vector<store_key_t> &keys = key_collector.get_collected_keys();
+    for (size_t i = 0; i < keys.size();) {
         promise_t<superblock_t *> pass_back_superblock_promise;
         {
             keyvalue_location_t kv_location;
             find_keyvalue_location_for_write(
                 &sizer,
                 superblock,
-                key.btree_key(),
-                /* don't update subtree recencies as we traverse the tree */
-                repli_timestamp_t::distant_past,
+                keys[i].btree_key(),
+                /* Erasing doesn't update subtree recencies as we traverse the tree,
+                but deleting has to, so that the tombstones get backfilled. */
+                delete_mode == delete_mode_t::ERASE
+                    ? repli_timestamp_t::distant_past
+                    : timestamp,
                 deletion_context->balancing_detacher(),
                 &kv_location,
                 NULL /* profile::trace_t */,
                 &pass_back_superblock_promise);
-            btree_slice->stats.pm_keys_set.record();
-            btree_slice->stats.pm_total_keys_set += 1;
-
-            // We're still holding a write lock on the superblock, so if the value
-            // disappeared since we've populated key_collector, something fishy
-            // is going on.
-            guarantee(kv_location.value.has());
-
-            // The mod_report we generate is a simple delete. While there is generally
-            // a difference between an erase and a delete (deletes get backfilled,
-            // while an erase is as if the value had never existed), that
-            // difference is irrelevant in the case of secondary indexes.
-            rdb_modification_report_t mod_report;
-            mod_report.primary_key = key;
-            // Get the full data
-            const rdb_value_t *rdb_value = kv_location.value_as<rdb_value_t>();
-            mod_report.info.deleted.first = get_data(rdb_value,
-                                                     buf_parent_t(&kv_location.buf));
-            // Get the inline value
-            mod_report.info.deleted.second.assign(rdb_value->value_ref(),
-                rdb_value->value_ref() + rdb_value->inline_size(max_block_size));
-            mod_reports_out->push_back(mod_report);
-
-            // Detach the value
-            deletion_context->in_tree_deleter()->delete_value(
-                buf_parent_t(&kv_location.buf), kv_location.value.get());
-            // Erase the entry from the leaf node
-            kv_location.value.reset();
-            null_key_modification_callback_t null_cb;
-            apply_keyvalue_change(&sizer, &kv_location, key.btree_key(),
-                                  repli_timestamp_t::invalid /* ignored for erase */,
-                                  deletion_context->in_tree_deleter(),
-                                  &null_cb,
-                                  delete_mode_t::ERASE);
+
+            do {
+                const store_key_t &key = keys[i];
+                btree_slice->stats.pm_keys_set.record();
+                btree_slice->stats.pm_total_keys_set += 1;
+
+                // We're still holding a write lock on the superblock, so if the value
+                // disappeared since we've populated key_collector, something fishy
+                // is going on.
+                guarantee(kv_location.value.has());
+
+                // The mod_report we generate is a simple delete. While there is
+                // generally a difference between an erase and a delete (deletes get
+                // backfilled, while an erase is as if the value had never existed),
+                // that difference is irrelevant in the case of secondary indexes.
+                rdb_modification_report_t mod_report;
+                mod_report.primary_key = key;
+                // Get the full data
+                const rdb_value_t *rdb_value = kv_location.value_as<rdb_value_t>();
+                mod_report.info.deleted.first = get_data(
+                    rdb_value, buf_parent_t(&kv_location.buf));
+                // Get the inline value
+                mod_report.info.deleted.second.assign(rdb_value->value_ref(),
+                    rdb_value->value_ref() + rdb_value->inline_size(max_block_size));
+                mod_reports_out->push_back(mod_report);
+
+                // Detach the value
+                deletion_context->in_tree_deleter()->delete_value(
+                    buf_parent_t(&kv_location.buf), kv_location.value.get());
+                // Erase the entry from the leaf node
+                kv_location.value.reset();
+                null_key_modification_callback_t null_cb;
+                apply_keyvalue_change_in_place(
+                    &sizer, &kv_location, key.btree_key(),
+                    delete_mode == delete_mode_t::ERASE
+                        ? repli_timestamp_t::invalid /* ignored for erase */
+                        : timestamp,
+                    &null_cb, delete_mode);
+
+                guarantee(key >= deleted_out->right.key());
+                *deleted_out = key_range_t(key_range_t::closed, key_range.left,
+                                           key_range_t::closed, key);
+                ++i;
+            } while (i < keys.size()
+                     && find_keyvalue_location_in_same_leaf(
+                         &sizer, &kv_location, keys[i].btree_key()));
+
+            check_and_handle_underfull(&sizer, &kv_location.buf, &kv_location.last_buf,
+                                       kv_location.superblock, keys[i - 1].btree_key(),
+                                       deletion_context->in_tree_deleter());
         } // kv_location is destroyed here. That's important because sometimes
           // pass_back_superblock_promise isn't pulsed before the kv_location
           // gets deleted.
         guarantee(pass_back_superblock_promise.wait() == superblock);
 
-        guarantee(key >= deleted_out->right.key());
-        *deleted_out = key_range_t(key_range_t::closed, key_range.left,
-                                   key_range_t::closed, key);
-
         if (interruptor->is_pulsed()) {
             /* Note: We have to check the interruptor at the beginning or the end of the
             loop. If we check it in the middle, we might leave the B-tree in a half-
@@ -180,3 +202,54 @@ continue_bool_t rdb_erase_small_range(
         ? continue_bool_t::CONTINUE : continue_bool_t::ABORT;
 }
 
+continue_bool_t rdb_erase_small_range(
+        btree_slice_t *btree_slice,
+        key_tester_t *tester,
+        const key_range_t &key_range,
+        superblock_t *superblock,
+        const deletion_context_t *deletion_context,
+        signal_t *interruptor,
+        uint64_t max_keys_to_erase,
+        std::vector<rdb_modification_report_t> *mod_reports_out,
+        key_range_t *deleted_out) {
+    return remove_small_range(
+        btree_slice, tester, key_range, superblock, deletion_context,
+        delete_mode_t::ERASE, repli_timestamp_t::invalid, interruptor,
+        max_keys_to_erase, mod_reports_out, deleted_out);
+}
+
+continue_bool_t rdb_delete_small_range(
+        btree_slice_t *btree_slice,
+        repli_timestamp_t timestamp,
+        const key_range_t &key_range,
+        superblock_t *superblock,
+        const deletion_context_t *deletion_context,
+        signal_t *interruptor,
+        uint64_t max_keys_to_delete,
+        std::vector<rdb_modification_report_t> *mod_reports_out,
+        key_range_t *deleted_out) {
+    always_true_key_tester_t tester;
+    return remove_small_range(
+        btree_slice, &tester, key_range, superblock, deletion_context,
+        delete_mode_t::REGULAR_QUERY, timestamp, interruptor,
+        max_keys_to_delete, mod_reports_out, deleted_out);
+}
+
+continue_bool_t rdb_collect_keys_in_range(
+        const key_range_t &key_range,
+        superblock_t *superblock,
+        signal_t *interruptor,
+        uint64_t max_keys,
+        std::vector<store_key_t> *keys_out) {
+    always_true_key_tester_t tester;
+    collect_keys_helper_t key_collector(&tester, key_range, max_keys, interruptor);
+    btree_depth_first_traversal(
+        superblock, key_range, &key_collector, access_t::read, direction_t::FORWARD,
+        release_superblock_t::KEEP, interruptor);
+    if (interruptor->is_pulsed()) {
+        throw interrupted_exc_t();
+    }
+    *keys_out = key_collector.get_collected_keys();
+    return key_collector.get_aborted()
+        ? continue_bool_t::CONTINUE : continue_bool_t::ABORT;
+}
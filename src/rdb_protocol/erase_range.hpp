@@ -55,4 +55,28 @@ continue_bool_t rdb_erase_small_range(
     std::vector<rdb_modification_report_t> *mod_reports_out,
     key_range_t *deleted_out);
 
+/* `rdb_delete_small_range` is like `rdb_erase_small_range`, except that it deletes the
+documents the way a delete query would: it leaves tombstones with the given timestamp
+behind and updates the recencies on the way down, so that the deletes get backfilled. It
+deletes every document in `keys`. */
+continue_bool_t rdb_delete_small_range(
+    btree_slice_t *btree_slice,
+    repli_timestamp_t timestamp,
+    const key_range_t &keys,
+    superblock_t *superblock,
+    const deletion_context_t *deletion_context,
+    signal_t *interruptor,
+    uint64_t max_keys_to_delete /* 0 = unlimited */,
+    std::vector<rdb_modification_report_t> *mod_reports_out,
+    key_range_t *deleted_out);
+
+/* Collects the keys of up to `max_keys` documents in `keys`, in order. Returns
+`CONTINUE` if it stopped because it found `max_keys` of them. */
+continue_bool_t rdb_collect_keys_in_range(
+    const key_range_t &keys,
+    superblock_t *superblock,
+    signal_t *interruptor,
+    uint64_t max_keys /* 0 = unlimited */,
+    std::vector<store_key_t> *keys_out);
+
 #endif  // RDB_PROTOCOL_ERASE_RANGE_HPP_
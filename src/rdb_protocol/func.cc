@@ -63,6 +63,12 @@ scoped_ptr_t<val_t> func_t::call(env_t *env,
     return call(env, make_vector(arg1, arg2), eval_flags);
 }
 
+void func_t::call_each(env_t *env, std::vector<datum_t> *args) const {
+    for (auto it = args->begin(); it != args->end(); ++it) {
+        *it = call(env, *it)->as_datum();
+    }
+}
+
 void func_t::assert_deterministic(constant_now_t cn, const char *extra_msg) const {
     rcheck(is_deterministic().test(single_server_t::no, cn),
            base_exc_t::LOGIC,
@@ -75,7 +81,9 @@ reql_func_t::reql_func_t(const var_scope_t &_captured_scope,
     : func_t(_body->backtrace()),
       captured_scope(_captured_scope),
       arg_names(std::move(_arg_names)),
-      body(std::move(_body)) { }
+      body(std::move(_body)) {
+    init_program();
+}
 
 reql_func_t::reql_func_t(scoped_ptr_t<term_storage_t> &&_storage,
                          const var_scope_t &_captured_scope,
@@ -85,10 +93,36 @@ reql_func_t::reql_func_t(scoped_ptr_t<term_storage_t> &&_storage,
       captured_scope(_captured_scope),
       arg_names(std::move(_arg_names)),
       term_storage(std::move(_storage)),
-      body(std::move(_body)) { }
+      body(std::move(_body)) {
+    init_program();
+}
 
 reql_func_t::~reql_func_t() { }
 
+void reql_func_t::init_program() {
+    if (arg_names.empty()) {
+        return;
+    }
+    program.init(new term_program_t(arg_names,
+                                    function_emits_implicit_variable(arg_names)));
+    if (!body->compile(program.get()) || !program->is_complete()) {
+        program.reset();
+    }
+}
+
+datum_t reql_func_t::call_program(env_t *env, const std::vector<datum_t> &args) const {
+    if (!program.has() || env->profile() == profile_bool_t::PROFILE) {
+        return datum_t();
+    }
+    // Do what evaluating the terms in `body` would do before evaluating them.
+    env->do_eval_callback();
+    if (env->interruptor->is_pulsed()) {
+        throw interrupted_exc_t();
+    }
+    env->maybe_yield();
+    return program->run(args);
+}
+
 scoped_ptr_t<val_t> reql_func_t::call(env_t *env,
                                       const std::vector<datum_t> &args,
                                       eval_flags_t eval_flags) const {
@@ -105,6 +139,11 @@ scoped_ptr_t<val_t> reql_func_t::call(env_t *env,
                          arg_names.size(),
                          (arg_names.size() == 1 ? "" : "s")));
 
+        datum_t result = call_program(env, args);
+        if (result.has()) {
+            return make_scoped<val_t>(result, body->backtrace());
+        }
+
         var_scope_t new_scope = arg_names.size() == 0
             ? captured_scope
             : captured_scope.with_func_arg_list(arg_names, args);
@@ -166,6 +205,40 @@ scoped_ptr_t<val_t> js_func_t::call(
     }
 }
 
+void js_func_t::call_each(env_t *env, std::vector<datum_t> *args) const {
+    try {
+        js_runner_t::req_config_t config;
+        config.timeout_ms = js_timeout_ms;
+
+        r_sanity_check(!js_source.empty());
+        std::vector<std::vector<datum_t> > args_batch;
+        args_batch.reserve(args->size());
+        for (const datum_t &arg : *args) {
+            args_batch.push_back(make_vector(arg));
+        }
+        std::vector<js_result_t> results;
+
+        try {
+            results = js_runner_t(env->limits()).call_batch(
+                js_source, args_batch, config);
+        } catch (const extproc_worker_exc_t &e) {
+            rfail(base_exc_t::INTERNAL,
+                  "Javascript query `%s` caused a crash in a worker process.",
+                  js_source.c_str());
+        }
+
+        guarantee(results.size() == args->size());
+        for (size_t i = 0; i < results.size(); ++i) {
+            (*args)[i] = boost::apply_visitor(
+                js_result_visitor_t(js_source, js_timeout_ms, this),
+                results[i])->as_datum();
+        }
+    } catch (const datum_exc_t &e) {
+        rfail(e.get_type(), "%s", e.what());
+        unreachable();
+    }
+}
+
 optional<size_t> js_func_t::arity() const {
     return r_nullopt;
 }
@@ -290,6 +363,64 @@ bool filter_match(datum_t predicate, datum_t value,
     }
 }
 
+bool reql_func_t::try_filter_without_env(const datum_t &arg, bool *result_out) const {
+    if (!program.has()) {
+        return false;
+    }
+    datum_t d = program->run(make_vector(arg));
+    // Objects can mean that `filter_helper` uses `filter_match`.
+    if (!d.has() || d.get_type() == datum_t::R_OBJECT) {
+        return false;
+    }
+    *result_out = d.as_bool();
+    return true;
+}
+
+// Whether `term` only builds a value out of literals.
+bool is_constant_term(const raw_term_t &term) {
+    if (term.type() == Term::DATUM) {
+        return true;
+    } else if (term.type() == Term::MAKE_ARRAY) {
+        for (size_t i = 0; i < term.num_args(); ++i) {
+            if (!is_constant_term(term.arg(i))) {
+                return false;
+            }
+        }
+        return true;
+    } else if (term.type() == Term::MAKE_OBJ) {
+        bool constant = term.num_args() == 0;
+        term.each_optarg([&](const raw_term_t &optarg, const std::string &) {
+                constant = constant && is_constant_term(optarg);
+            });
+        return constant;
+    } else {
+        return false;
+    }
+}
+
+datum_t reql_func_t::constant_filter_object() const {
+    const raw_term_t src = body->get_src();
+    if (!program.has()
+        || (src.type() != Term::MAKE_OBJ && src.type() != Term::DATUM)
+        || !is_constant_term(src)) {
+        return datum_t();
+    }
+    // The argument doesn't matter because the body doesn't use it.
+    datum_t d = program->run(make_vector(datum_t::null()));
+    if (!d.has() || d.get_type() != datum_t::R_OBJECT) {
+        return datum_t();
+    }
+    return d;
+}
+
+datum_t reql_func_t::constant_result() const {
+    const raw_term_t src = body->get_src();
+    if (src.type() != Term::DATUM) {
+        return datum_t();
+    }
+    return src.datum();
+}
+
 bool reql_func_t::filter_helper(env_t *env, datum_t arg) const {
     datum_t d = call(env, make_vector(arg), NO_FLAGS)->as_datum();
     if (d.get_type() == datum_t::R_OBJECT &&
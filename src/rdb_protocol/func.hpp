@@ -17,6 +17,7 @@
 #include "rdb_protocol/op.hpp"
 #include "rdb_protocol/sym.hpp"
 #include "rdb_protocol/term.hpp"
+#include "rdb_protocol/term_program.hpp"
 #include "rdb_protocol/term_storage.hpp"
 #include "rpc/serialize_macros.hpp"
 
@@ -55,6 +56,27 @@ public:
                      datum_t arg,
                      counted_t<const func_t> default_filter_val) const;
 
+    // Tries to find out what `filter_call` would return for `arg` without an
+    // environment, so that it can be done outside of the order in which rows get
+    // processed.  Returns false if it can't be done.
+    virtual bool try_filter_without_env(UNUSED const datum_t &arg,
+                                        UNUSED bool *result_out) const {
+        return false;
+    }
+
+    // If `filter_call` matches rows against an object that doesn't depend on the
+    // row, returns that object.  Otherwise returns an empty datum.
+    virtual datum_t constant_filter_object() const { return datum_t(); }
+
+    // If the function returns a literal that doesn't depend on its arguments, returns
+    // that literal.  Otherwise returns an empty datum.
+    virtual datum_t constant_result() const { return datum_t(); }
+
+    // Replaces every element of `args` with the result of calling the function on it.
+    // Subclasses can override this when calling the function on many rows at once is
+    // cheaper than calling it on each row in turn.
+    virtual void call_each(env_t *env, std::vector<datum_t> *args) const;
+
     // These are simple, they call the vector version of call.
     scoped_ptr_t<val_t> call(env_t *env, eval_flags_t eval_flags = NO_FLAGS) const;
     scoped_ptr_t<val_t> call(env_t *env,
@@ -109,9 +131,20 @@ public:
 
     bool is_simple_selector() const final;
 
+    bool try_filter_without_env(const datum_t &arg, bool *result_out) const final;
+
+    datum_t constant_filter_object() const final;
+
+    datum_t constant_result() const final;
+
 private:
     template <cluster_version_t> friend class wire_func_serialization_visitor_t;
     bool filter_helper(env_t *env, datum_t arg) const;
+    void init_program();
+    // Evaluates the function by running `program` instead of evaluating `body`.
+    // Returns an empty datum if that didn't work out and `body` has to be evaluated
+    // after all, for example to produce an error.
+    datum_t call_program(env_t *env, const std::vector<datum_t> &args) const;
 
     // Only contains the parts of the scope that `body` uses.
     var_scope_t captured_scope;
@@ -126,6 +159,9 @@ private:
     // The body of the function, which gets ->eval(...) called when call(...) is called.
     counted_t<const term_t> body;
 
+    // What `body` compiles to, if it can be compiled.
+    scoped_ptr_t<term_program_t> program;
+
     DISABLE_COPYING(reql_func_t);
 };
 
@@ -142,6 +178,10 @@ public:
                              const std::vector<datum_t> &args,
                              eval_flags_t eval_flags) const;
 
+    // Runs all of the calls in one JS runner, so that the function is only compiled
+    // once for the whole batch.
+    void call_each(env_t *env, std::vector<datum_t> *args) const;
+
     optional<size_t> arity() const;
 
     deterministic_t is_deterministic() const;
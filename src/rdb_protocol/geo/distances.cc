@@ -1,6 +1,11 @@
 // Copyright 2010-2014 RethinkDB, all rights reserved.
 #include "rdb_protocol/geo/distances.hpp"
 
+#include <math.h>
+
+#include <algorithm>
+#include <limits>
+
 #include "rdb_protocol/geo/ellipsoid.hpp"
 #include "rdb_protocol/geo/exceptions.hpp"
 #include "rdb_protocol/geo/geojson.hpp"
@@ -25,60 +30,92 @@ double geodesic_distance(const lon_lat_point_t &p1,
     return dist;
 }
 
-double geodesic_distance(const geo::S2Point &p,
-                         const ql::datum_t &g,
-                         const ellipsoid_spec_t &e) {
-    class distance_estimator_t : public s2_geo_visitor_t<double> {
-    public:
-        distance_estimator_t(
-                lon_lat_point_t r, const geo::S2Point &r_s2, const ellipsoid_spec_t &_e)
-            : ref_(r), ref_s2_(r_s2), e_(_e) { }
-        double on_point(const geo::S2Point &point) {
-            lon_lat_point_t llpoint =
-                lon_lat_point_t(geo::S2LatLng::Longitude(point).degrees(),
-                                geo::S2LatLng::Latitude(point).degrees());
-            return geodesic_distance(ref_, llpoint, e_);
-        }
-        double on_line(const geo::S2Polyline &line) {
-            // This sometimes over-estimates large distances, because the
-            // projection assumes spherical rather than ellipsoid geometry.
-            int next_vertex;
-            geo::S2Point prj = line.Project(ref_s2_, &next_vertex);
-            if (prj == ref_s2_) {
-                // ref_ is on the line
-                return 0.0;
-            } else {
-                lon_lat_point_t llprj =
-                    lon_lat_point_t(geo::S2LatLng::Longitude(prj).degrees(),
-                                    geo::S2LatLng::Latitude(prj).degrees());
-                return geodesic_distance(ref_, llprj, e_);
-            }
+/* Bounds the ellipsoidal distance between two points from the angle between them on the
+unit sphere. On the ellipsoid, a step of `d` radians in latitude is `M * d` meters long
+and a step of `d` radians in longitude is `N * cos(lat) * d` meters long. The radii of
+curvature `M` and `N` lie between `a * (1 - e^2)`, `a` and `a / sqrt(1 - e^2)` for the
+equator radius `a` and eccentricity `e`. So no path on the ellipsoid is shorter than
+the smallest of those times the length of the corresponding path on the sphere, and the
+shortest path on the sphere is `angle` long. */
+static double geodesic_distance_lower_bound(double angle, const ellipsoid_spec_t &e) {
+    const double f = e.flattening();
+    const double e_squared = f * (2.0 - f);
+    const double min_radius = e.equator_radius() * std::min(
+        std::min(1.0 - e_squared, 1.0), 1.0 / sqrt(1.0 - e_squared));
+    // Leave some room for rounding errors in the angle.
+    return angle * min_radius * (1.0 - 1e-9);
+}
+
+class distance_estimator_t : public s2_geo_visitor_t<double> {
+public:
+    distance_estimator_t(
+            lon_lat_point_t r, const geo::S2Point &r_s2, const ellipsoid_spec_t &_e,
+            double _max_dist)
+        : ref_(r), ref_s2_(r_s2), e_(_e), max_dist_(_max_dist) { }
+    double on_point(const geo::S2Point &point) {
+        return distance_to(point);
+    }
+    double on_line(const geo::S2Polyline &line) {
+        // This sometimes over-estimates large distances, because the
+        // projection assumes spherical rather than ellipsoid geometry.
+        int next_vertex;
+        geo::S2Point prj = line.Project(ref_s2_, &next_vertex);
+        if (prj == ref_s2_) {
+            // ref_ is on the line
+            return 0.0;
+        } else {
+            return distance_to(prj);
         }
-        double on_polygon(const geo::S2Polygon &polygon) {
-            // This sometimes over-estimates large distances, because the
-            // projection assumes spherical rather than ellipsoid geometry.
-            geo::S2Point prj = polygon.Project(ref_s2_);
-            if (prj == ref_s2_) {
-                // ref_ is inside/on the polygon
-                return 0.0;
-            } else {
-                lon_lat_point_t llprj =
-                    lon_lat_point_t(geo::S2LatLng::Longitude(prj).degrees(),
-                                    geo::S2LatLng::Latitude(prj).degrees());
-                return geodesic_distance(ref_, llprj, e_);
-            }
+    }
+    double on_polygon(const geo::S2Polygon &polygon) {
+        // This sometimes over-estimates large distances, because the
+        // projection assumes spherical rather than ellipsoid geometry.
+        geo::S2Point prj = polygon.Project(ref_s2_);
+        if (prj == ref_s2_) {
+            // ref_ is inside/on the polygon
+            return 0.0;
+        } else {
+            return distance_to(prj);
         }
-        double on_latlngrect(const geo::S2LatLngRect &) {
-            throw geo_exception_t("Distance calculation not implemented on LatLngRect.");
+    }
+    double on_latlngrect(const geo::S2LatLngRect &) {
+        throw geo_exception_t("Distance calculation not implemented on LatLngRect.");
+    }
+
+private:
+    double distance_to(const geo::S2Point &point) {
+        // Karney's algorithm iterates, so skip it if the distance is clearly too large.
+        const double lower_bound =
+            geodesic_distance_lower_bound(ref_s2_.Angle(point), e_);
+        if (lower_bound > max_dist_) {
+            return lower_bound;
         }
-        lon_lat_point_t ref_;
-        const geo::S2Point &ref_s2_;
-        const ellipsoid_spec_t &e_;
-    };
+        lon_lat_point_t llpoint =
+            lon_lat_point_t(geo::S2LatLng::Longitude(point).degrees(),
+                            geo::S2LatLng::Latitude(point).degrees());
+        return geodesic_distance(ref_, llpoint, e_);
+    }
+
+    lon_lat_point_t ref_;
+    const geo::S2Point &ref_s2_;
+    const ellipsoid_spec_t &e_;
+    double max_dist_;
+};
+
+double geodesic_distance(const geo::S2Point &p,
+                         const ql::datum_t &g,
+                         const ellipsoid_spec_t &e) {
+    return geodesic_distance_up_to(p, g, e, std::numeric_limits<double>::infinity());
+}
+
+double geodesic_distance_up_to(const geo::S2Point &p,
+                               const ql::datum_t &g,
+                               const ellipsoid_spec_t &e,
+                               double max_dist) {
     distance_estimator_t estimator(
             lon_lat_point_t(geo::S2LatLng::Longitude(p).degrees(),
                             geo::S2LatLng::Latitude(p).degrees()),
-        p, e);
+        p, e, max_dist);
     return visit_geojson(&estimator, g);
 }
 
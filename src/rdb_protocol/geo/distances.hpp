@@ -26,6 +26,13 @@ double geodesic_distance(const lon_lat_point_t &p1,
 double geodesic_distance(const geo::S2Point &p,
                          const ql::datum_t &g,
                          const ellipsoid_spec_t &e);
+// Like `geodesic_distance()` if the distance is at most `max_dist`. Otherwise returns
+// some lower bound of the distance that is greater than `max_dist`, which is often
+// much cheaper to get.
+double geodesic_distance_up_to(const geo::S2Point &p,
+                               const ql::datum_t &g,
+                               const ellipsoid_spec_t &e,
+                               double max_dist);
 
 // Returns a point at distance `dist` (in meters) of `p` in direction `azimuth`
 // (in degrees between -180 and 180)
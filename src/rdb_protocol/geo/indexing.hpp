@@ -23,7 +23,12 @@ If the number is small, index insertion becomes more efficient, but querying the
 index becomes less efficient. High values make geo indexes larger and inserting
 into them slower, while usually improving query efficiency.
 See the comments in s2regioncoverer.h for further explanation and for statistics
-on the effects of different choices of this parameter.*/
+on the effects of different choices of this parameter.
+The coverer picks the cell levels to fit the geometry, so this bounds the number of
+keys per document no matter how large a polygon is. Points don't use the coverer at
+all; they are indexed by their leaf cell, which is as precise as the grid gets. This is
+why there is no per-index setting. Changing this value changes the keys of existing
+geo indexes, so it would have to be recorded in the index's metadata.*/
 extern const int GEO_INDEX_GOAL_GRID_CELLS;
 
 std::vector<std::string> compute_index_grid_keys(
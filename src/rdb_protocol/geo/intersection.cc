@@ -6,10 +6,13 @@
 #include "rdb_protocol/geo/geojson.hpp"
 #include "rdb_protocol/geo/geo_visitor.hpp"
 #include "rdb_protocol/geo/s2/s2.h"
+#include "rdb_protocol/geo/s2/s2latlng.h"
+#include "rdb_protocol/geo/s2/s2latlngrect.h"
 #include "rdb_protocol/geo/s2/s2polygon.h"
 #include "rdb_protocol/geo/s2/s2polyline.h"
 #include "rdb_protocol/datum.hpp"
 
+using geo::S2LatLng;
 using geo::S2Point;
 using geo::S2Polygon;
 using geo::S2Polyline;
@@ -70,6 +73,89 @@ bool geo_does_intersect(const ql::datum_t &g1,
     return visit_geojson(&tester, g1);
 }
 
+// The bounds are only used to rule out intersections, so they are made a little larger
+// than they have to be. Otherwise rounding could rule out objects that `Project()`
+// considers to touch the boundary.
+static S2LatLngRect expand_bound(const S2LatLngRect &bound) {
+    return bound.Expanded(S2LatLng::FromRadians(1e-9, 1e-9));
+}
+
+class prepared_geometry_t::builder_t : public s2_geo_visitor_t<void> {
+public:
+    explicit builder_t(prepared_geometry_t *_parent) : parent(_parent) { }
+
+    void on_point(const S2Point &point) {
+        parent->point.init(new S2Point(point));
+        parent->bound.init(new S2LatLngRect(
+            expand_bound(S2LatLngRect::FromPoint(S2LatLng(point)))));
+    }
+    void on_line(const S2Polyline &line) {
+        parent->line.init(line.Clone());
+        parent->bound.init(new S2LatLngRect(expand_bound(line.GetRectBound())));
+    }
+    void on_polygon(const S2Polygon &polygon) {
+        parent->polygon.init(new S2Polygon());
+        parent->polygon->Copy(&polygon);
+        parent->bound.init(new S2LatLngRect(expand_bound(polygon.GetRectBound())));
+    }
+    void on_latlngrect(const S2LatLngRect &rect) {
+        parent->rect.init(new S2LatLngRect(rect));
+        parent->bound.init(new S2LatLngRect(expand_bound(rect)));
+    }
+
+private:
+    prepared_geometry_t *parent;
+};
+
+class prepared_geometry_t::tester_t : public s2_geo_visitor_t<bool> {
+public:
+    explicit tester_t(const prepared_geometry_t *_parent) : parent(_parent) { }
+
+    bool on_point(const S2Point &point) {
+        return parent->bound->Contains(point) && parent->intersects_exactly(point);
+    }
+    bool on_line(const S2Polyline &line) {
+        return parent->bound->Intersects(line.GetRectBound())
+            && parent->intersects_exactly(line);
+    }
+    bool on_polygon(const S2Polygon &polygon) {
+        return parent->bound->Intersects(polygon.GetRectBound())
+            && parent->intersects_exactly(polygon);
+    }
+    bool on_latlngrect(const S2LatLngRect &rect) {
+        return parent->bound->Intersects(rect) && parent->intersects_exactly(rect);
+    }
+
+private:
+    const prepared_geometry_t *parent;
+};
+
+prepared_geometry_t::prepared_geometry_t(const datum_t &geojson) {
+    builder_t builder(this);
+    visit_geojson(&builder, geojson);
+    guarantee(bound.has());
+}
+
+prepared_geometry_t::~prepared_geometry_t() { }
+
+bool prepared_geometry_t::intersects(const datum_t &other) const {
+    tester_t tester(this);
+    return visit_geojson(&tester, other);
+}
+
+template <class other_t>
+bool prepared_geometry_t::intersects_exactly(const other_t &other) const {
+    if (point.has()) {
+        return geo_does_intersect(*point, other);
+    } else if (line.has()) {
+        return geo_does_intersect(*line, other);
+    } else if (polygon.has()) {
+        return geo_does_intersect(*polygon, other);
+    } else {
+        return geo_does_intersect(*rect, other);
+    }
+}
+
 bool geo_does_intersect(const S2Point &point,
                         const S2Point &other_point) {
     return point == other_point;
@@ -3,6 +3,7 @@
 #define RDB_PROTOCOL_GEO_INTERSECTION_HPP_
 
 #include "containers/counted.hpp"
+#include "containers/scoped.hpp"
 #include "rdb_protocol/geo/s2/util/math/vector3.h"
 
 namespace geo {
@@ -20,6 +21,35 @@ class datum_t;
 bool geo_does_intersect(const ql::datum_t &g1,
                         const ql::datum_t &g2);
 
+/* Gives the same results as `geo_does_intersect(geojson, other)`, but only parses
+`geojson` once, for testing it against many other objects. It also compares bounding
+rectangles first, so most objects that are nowhere near it never get to the exact
+test. */
+class prepared_geometry_t {
+public:
+    explicit prepared_geometry_t(const ql::datum_t &geojson);
+    ~prepared_geometry_t();
+
+    bool intersects(const ql::datum_t &other) const;
+
+private:
+    class builder_t;
+    class tester_t;
+
+    template <class other_t>
+    bool intersects_exactly(const other_t &other) const;
+
+    // Exactly one of these is set.
+    scoped_ptr_t<geo::S2Point> point;
+    scoped_ptr_t<geo::S2Polyline> line;
+    scoped_ptr_t<geo::S2Polygon> polygon;
+    scoped_ptr_t<geo::S2LatLngRect> rect;
+
+    scoped_ptr_t<geo::S2LatLngRect> bound;
+
+    DISABLE_COPYING(prepared_geometry_t);
+};
+
 /* Variants for each pair of S2 geometry */
 bool geo_does_intersect(const geo::S2Point &point,
                         const geo::S2Point &other_point);
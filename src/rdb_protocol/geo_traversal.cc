@@ -98,8 +98,11 @@ geo_intersecting_cb_t::geo_intersecting_cb_t(
                                         env->trace));
 }
 
+geo_intersecting_cb_t::~geo_intersecting_cb_t() { }
+
 void geo_intersecting_cb_t::init_query(const ql::datum_t &_query_geometry) {
     query_geometry = _query_geometry;
+    prepared_query_geometry.init(new prepared_geometry_t(query_geometry));
     std::vector<geo::S2CellId> covering(
         compute_cell_covering(query_geometry, QUERYING_GOAL_GRID_CELLS));
     geo_index_traversal_helper_t::init_query(
@@ -131,6 +134,9 @@ continue_bool_t geo_intersecting_cb_t::on_candidate(
     if (distinct_emitted->count(primary_and_tag) > 0) {
         return continue_bool_t::CONTINUE;
     }
+    if (skip_candidate(primary_and_tag)) {
+        return continue_bool_t::CONTINUE;
+    }
 
     lazy_btree_val_t row(static_cast<const rdb_value_t *>(keyvalue.value()),
                          keyvalue.expose_buf());
@@ -174,9 +180,8 @@ continue_bool_t geo_intersecting_cb_t::on_candidate(
             }
         }
 
-        // TODO (daniel): This is a little inefficient because we re-parse
-        // the query_geometry for each test.
-        if ((definitely_intersects || geo_does_intersect(query_geometry, sindex_val))
+        if ((definitely_intersects
+             || prepared_query_geometry->intersects(sindex_val))
             && post_filter(sindex_val, val)) {
             if (distinct_emitted->size() >= env->limits().array_size_limit()) {
                 emit_error(ql::exc_t(ql::base_exc_t::RESOURCE,
@@ -196,6 +201,7 @@ continue_bool_t geo_intersecting_cb_t::on_candidate(
                 && sindex_val.get_field("type").as_str() != "Point") {
                 already_processed.insert(primary_and_tag);
             }
+            on_rejected(primary_and_tag, sindex_val);
             return continue_bool_t::CONTINUE;
         }
     } catch (const ql::exc_t &e) {
@@ -382,7 +388,8 @@ bool nearest_traversal_cb_t::post_filter(
     // Filter out results that are outside of the current inradius
     const S2Point s2center =
         S2LatLng::FromDegrees(state->center.latitude, state->center.longitude).ToPoint();
-    const double dist = geodesic_distance(s2center, sindex_val, state->reference_ellipsoid);
+    const double dist = geodesic_distance_up_to(
+        s2center, sindex_val, state->reference_ellipsoid, state->current_inradius);
     return dist <= state->current_inradius;
 }
 
@@ -407,6 +414,27 @@ void nearest_traversal_cb_t::emit_error(
     error.set(_error);
 }
 
+bool nearest_traversal_cb_t::skip_candidate(
+        const std::pair<store_key_t, optional<uint64_t> > &primary_and_tag) {
+    auto it = state->known_distances.find(primary_and_tag);
+    return it != state->known_distances.end() && it->second > state->current_inradius;
+}
+
+void nearest_traversal_cb_t::on_rejected(
+        const std::pair<store_key_t, optional<uint64_t> > &primary_and_tag,
+        const ql::datum_t &sindex_val)
+        THROWS_ONLY(interrupted_exc_t, ql::base_exc_t, geo_exception_t) {
+    if (state->known_distances.size() >= MAX_PROCESSED_SET_SIZE
+        || state->known_distances.count(primary_and_tag) > 0) {
+        return;
+    }
+    const S2Point s2center =
+        S2LatLng::FromDegrees(state->center.latitude, state->center.longitude).ToPoint();
+    // A lower bound is good enough for `skip_candidate()`.
+    state->known_distances[primary_and_tag] = geodesic_distance_up_to(
+        s2center, sindex_val, state->reference_ellipsoid, state->current_inradius);
+}
+
 bool nearest_pairs_less(
         const std::pair<double, ql::datum_t> &p1,
         const std::pair<double, ql::datum_t> &p2) {
@@ -2,6 +2,7 @@
 #ifndef RDB_PROTOCOL_GEO_TRAVERSAL_HPP_
 #define RDB_PROTOCOL_GEO_TRAVERSAL_HPP_
 
+#include <map>
 #include <set>
 #include <utility>
 #include <vector>
@@ -32,6 +33,7 @@ namespace profile {
 class disabler_t;
 class sampler_t;
 }
+class prepared_geometry_t;
 
 class geo_job_data_t {
 public:
@@ -86,7 +88,7 @@ public:
             ql::env_t *_env,
             std::set<std::pair<store_key_t, optional<uint64_t> > >
                 *_distinct_emitted_in_out);
-    virtual ~geo_intersecting_cb_t() { }
+    virtual ~geo_intersecting_cb_t();
 
     void init_query(const ql::datum_t &_query_geometry);
 
@@ -111,10 +113,24 @@ protected:
             const ql::exc_t &error)
             THROWS_ONLY(interrupted_exc_t) = 0;
 
+    // Called before a candidate is loaded. Subclasses that already know that they
+    // won't emit the document can return true to skip it.
+    virtual bool skip_candidate(
+            UNUSED const std::pair<store_key_t, optional<uint64_t> > &primary_and_tag) {
+        return false;
+    }
+
+    // Called for candidates that were loaded but not emitted.
+    virtual void on_rejected(
+            UNUSED const std::pair<store_key_t, optional<uint64_t> > &primary_and_tag,
+            UNUSED const ql::datum_t &sindex_val)
+            THROWS_ONLY(interrupted_exc_t, ql::base_exc_t, geo_exception_t) { }
+
 private:
     btree_slice_t *slice;
     geo_sindex_data_t sindex;
     ql::datum_t query_geometry;
+    scoped_ptr_t<prepared_geometry_t> prepared_query_geometry;
 
     ql::env_t *env;
 
@@ -183,6 +199,11 @@ private:
 
     /* State that changes over time */
     std::set<std::pair<store_key_t, optional<uint64_t> > > distinct_emitted;
+    // Lower bounds for the distances of documents that were loaded in an earlier batch
+    // but were too far away for it, up to some limit. All batches see the same snapshot
+    // of the index, so a later batch only has to load them again once its radius
+    // reaches them.
+    std::map<std::pair<store_key_t, optional<uint64_t> >, double> known_distances;
     size_t previous_size;
     // Which radius around `center` has been previously processed?
     double processed_inradius;
@@ -222,6 +243,14 @@ protected:
             const ql::exc_t &error)
             THROWS_ONLY(interrupted_exc_t);
 
+    bool skip_candidate(
+            const std::pair<store_key_t, optional<uint64_t> > &primary_and_tag);
+
+    void on_rejected(
+            const std::pair<store_key_t, optional<uint64_t> > &primary_and_tag,
+            const ql::datum_t &sindex_val)
+            THROWS_ONLY(interrupted_exc_t, ql::base_exc_t, geo_exception_t);
+
 private:
     void init_query_geometry();
 
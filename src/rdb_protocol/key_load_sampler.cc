@@ -0,0 +1,27 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#include "rdb_protocol/key_load_sampler.hpp"
+
+key_load_sampler_t::key_load_sampler_t() :
+    num_operations(0), next_sample(0) {
+    samples.reserve(MAX_SAMPLES);
+}
+
+void key_load_sampler_t::get_load_counts(
+        const key_range_t &range,
+        std::map<store_key_t, int64_t> *counts_out) const {
+    assert_thread();
+    for (const store_key_t &key : samples) {
+        if (range.contains_key(key)) {
+            (*counts_out)[key] += SAMPLE_INTERVAL;
+        }
+    }
+}
+
+void key_load_sampler_t::add_sample(const store_key_t &key) {
+    if (samples.size() < MAX_SAMPLES) {
+        samples.push_back(key);
+    } else {
+        samples[next_sample] = key;
+        next_sample = (next_sample + 1) % MAX_SAMPLES;
+    }
+}
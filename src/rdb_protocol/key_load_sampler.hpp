@@ -0,0 +1,51 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#ifndef RDB_PROTOCOL_KEY_LOAD_SAMPLER_HPP_
+#define RDB_PROTOCOL_KEY_LOAD_SAMPLER_HPP_
+
+#include <stdint.h>
+
+#include <map>
+#include <vector>
+
+#include "btree/keys.hpp"
+#include "threading.hpp"
+
+/* `key_load_sampler_t` keeps track of which keys a `store_t` has recently been
+reading and writing, so that `rebalance()` can place shard boundaries according to the
+load on the table and not only according to where its documents are. It remembers every
+`SAMPLE_INTERVAL`th key that it's told about, up to `MAX_SAMPLES` of them, and then
+starts overwriting the oldest ones. So the samples always describe the most recent
+`SAMPLE_INTERVAL * MAX_SAMPLES` operations. It's only accessed on the store's home
+thread. */
+class key_load_sampler_t : public home_thread_mixin_debug_only_t {
+public:
+    static const uint64_t SAMPLE_INTERVAL = 16;
+    static const size_t MAX_SAMPLES = 1024;
+
+    key_load_sampler_t();
+
+    void record(const store_key_t &key) {
+        assert_thread();
+        if (++num_operations % SAMPLE_INTERVAL == 0) {
+            add_sample(key);
+        }
+    }
+
+    /* Adds the estimated number of recent operations in `range` to `counts_out`,
+    broken down by key. Keys that don't appear in `counts_out` yet are inserted. */
+    void get_load_counts(
+        const key_range_t &range,
+        std::map<store_key_t, int64_t> *counts_out) const;
+
+private:
+    void add_sample(const store_key_t &key);
+
+    uint64_t num_operations;
+    std::vector<store_key_t> samples;
+    /* Where the next sample goes once `samples` is full */
+    size_t next_sample;
+
+    DISABLE_COPYING(key_load_sampler_t);
+};
+
+#endif  // RDB_PROTOCOL_KEY_LOAD_SAMPLER_HPP_
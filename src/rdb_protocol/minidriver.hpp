@@ -176,7 +176,7 @@ public:
 
     template <class T>
     reql_t error(T &&message) {
-        return reql_t(Term::ERROR, std::forward<T>(message));
+        return reql_t(this, Term::ERROR, std::forward<T>(message));
     }
 
     template <class Cond, class Then, class Else>
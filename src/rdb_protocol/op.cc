@@ -283,6 +283,18 @@ const std::vector<counted_t<const term_t> > &op_term_t::get_original_args() cons
     return arg_terms->get_original_args();
 }
 
+bool op_term_t::compile_args(term_program_t *program) const {
+    if (!optargs.empty()) {
+        return false;
+    }
+    for (const auto &arg : get_original_args()) {
+        if (!arg->compile(program)) {
+            return false;
+        }
+    }
+    return true;
+}
+
 deterministic_t op_term_t::is_deterministic() const {
     const std::vector<counted_t<const term_t> > &original_args
         = arg_terms->get_original_args();
@@ -183,6 +183,10 @@ protected:
         return true;
     }
 
+    // Compiles the arguments, in order, for terms that implement `compile()`.
+    // Returns false if there are optargs.
+    bool compile_args(term_program_t *program) const;
+
 private:
     friend class args_t;
     // Union term is a friend so we can steal arguments from an array.
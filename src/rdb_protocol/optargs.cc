@@ -47,6 +47,7 @@ static const std::set<std::string> acceptable_optargs({
     "binary_format",
     "changefeed_queue_size",
     "conflict",
+    "cpu_limit",
     "data",
     "db",
     "default",
@@ -55,6 +56,7 @@ static const std::set<std::string> acceptable_optargs({
     "durability",
     "emergency_repair",
     "emit",
+    "explain",
     "fill",
     "final_emit",
     "first_batch_scaledown_factor",
@@ -92,13 +94,16 @@ static const std::set<std::string> acceptable_optargs({
     "primary_key",
     "primary_replica_tag",
     "profile",
+    "read_limit",
     "read_mode",
     "redirects",
     "replicas",
+    "result_cache",
     "result_format",
     "return_changes",
     "return_vals",
     "right_bound",
+    "scheduling_class",
     "shards",
     "squash",
     "time_format",
@@ -1,8 +1,10 @@
 // Copyright 2010-2015 RethinkDB, all rights reserved.
 #include "rdb_protocol/order_util.hpp"
 
+#include <algorithm>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include "rdb_protocol/datum_stream.hpp"
 #include "rdb_protocol/error.hpp"
@@ -94,6 +96,30 @@ build_comparisons_from_optional_terms(const term_t *target,
 lt_cmp_t::lt_cmp_t(std::vector<std::pair<order_direction_t, counted_t<const func_t> > > _comparisons)
             : comparisons(std::move(_comparisons)) { }
 
+// Returns the value that `func` sorts `d` by, or an empty datum if `d` doesn't have
+// one.  Those sort before everything else.
+static datum_t eval_sort_key(env_t *env, const func_t *func, const datum_t &d) {
+    try {
+        return func->call(env, d)->as_datum();
+    } catch (const base_exc_t &e) {
+        if (e.get_type() != base_exc_t::NON_EXISTENCE) {
+            throw;
+        }
+        return datum_t();
+    }
+}
+
+static int cmp_sort_keys(order_direction_t direction,
+                         const datum_t &l, const datum_t &r) {
+    int cmp_res;
+    if (!l.has() || !r.has()) {
+        cmp_res = static_cast<int>(l.has()) - static_cast<int>(r.has());
+    } else {
+        cmp_res = l.cmp(r);
+    }
+    return direction == DESC ? -cmp_res : cmp_res;
+}
+
 bool lt_cmp_t::operator()(env_t *env,
                           profile::sampler_t *sampler,
                           datum_t l,
@@ -104,41 +130,72 @@ bool lt_cmp_t::operator()(env_t *env,
     }
 
     for (auto it = comparisons.begin(); it != comparisons.end(); ++it) {
-        datum_t lval;
-        datum_t rval;
-        try {
-            lval = it->second->call(env, l)->as_datum();
-        } catch (const base_exc_t &e) {
-            if (e.get_type() != base_exc_t::NON_EXISTENCE) {
-                throw;
-            }
+        int cmp_res = cmp_sort_keys(it->first,
+                                    eval_sort_key(env, it->second.get(), l),
+                                    eval_sort_key(env, it->second.get(), r));
+        if (cmp_res != 0) {
+            return cmp_res < 0;
         }
+    }
 
-        try {
-            rval = it->second->call(env, r)->as_datum();
-        } catch (const base_exc_t &e) {
-            if (e.get_type() != base_exc_t::NON_EXISTENCE) {
-                throw;
-            }
-        }
+    return false;
+}
 
-        if (!lval.has() && !rval.has()) {
-            continue;
-        }
-        if (!lval.has()) {
-            return true != (it->first == DESC);
+void lt_cmp_t::sort(env_t *env,
+                    profile::sampler_t *sampler,
+                    std::vector<datum_t> *data) const {
+    sort_prefix(env, sampler, data, data->size());
+}
+
+void lt_cmp_t::sort_prefix(env_t *env,
+                           profile::sampler_t *sampler,
+                           std::vector<datum_t> *data,
+                           size_t n) const {
+    n = std::min(n, data->size());
+    const size_t num_comparisons = comparisons.size();
+    // The sort key of row `i` for comparison `j` is `keys[i * num_comparisons + j]`.
+    // We only compute the keys of later comparisons when there's a tie, just like
+    // `operator()` does, so that they don't produce errors `operator()` wouldn't.
+    std::vector<datum_t> keys(data->size() * num_comparisons);
+    std::vector<bool> computed(keys.size(), false);
+    auto key = [&](size_t row, size_t j) -> const datum_t & {
+        const size_t ix = row * num_comparisons + j;
+        if (!computed[ix]) {
+            keys[ix] = eval_sort_key(env, comparisons[j].second.get(), (*data)[row]);
+            computed[ix] = true;
         }
-        if (!rval.has()) {
-            return false != (it->first == DESC);
+        return keys[ix];
+    };
+
+    std::vector<size_t> order(data->size());
+    for (size_t i = 0; i < order.size(); ++i) {
+        order[i] = i;
+    }
+    // Ties are broken by position, which makes the order the same as a stable sort's.
+    auto less = [&](size_t l, size_t r) {
+        if (sampler != nullptr) {
+            sampler->new_sample();
         }
-        int cmp_res = lval.cmp(rval);
-        if (cmp_res == 0) {
-            continue;
+        for (size_t j = 0; j < num_comparisons; ++j) {
+            int cmp_res = cmp_sort_keys(comparisons[j].first, key(l, j), key(r, j));
+            if (cmp_res != 0) {
+                return cmp_res < 0;
+            }
         }
-        return (cmp_res < 0) != (it->first == DESC);
+        return l < r;
+    };
+    if (n == order.size()) {
+        std::sort(order.begin(), order.end(), less);
+    } else {
+        std::partial_sort(order.begin(), order.begin() + n, order.end(), less);
     }
 
-    return false;
+    std::vector<datum_t> sorted;
+    sorted.reserve(n);
+    for (size_t i = 0; i < n; ++i) {
+        sorted.push_back(std::move((*data)[order[i]]));
+    }
+    data->swap(sorted);
 }
 
 } // namespace ql
@@ -168,6 +168,16 @@ void print_event_log(const event_log_t &event_log) {
     }
 }
 
+void add_shard_sample(event_log_t *event_log,
+                      const std::string &description,
+                      ticks_t duration) {
+    auto position = event_log->end();
+    if (!event_log->empty() && boost::get<stop_t>(&event_log->back()) != nullptr) {
+        --position;
+    }
+    event_log->insert(position, sample_t(description, duration, 1));
+}
+
 starter_t::starter_t(const std::string &description, trace_t *parent) {
     init(description, parent);
 }
@@ -208,6 +208,14 @@ private:
 
 void print_event_log(const event_log_t &event_log);
 
+/* `add_shard_sample()` adds a single sample to the event log that a shard returned
+ * for a read or write, just before the `stop_t` that ends the shard's task. It's used
+ * for the time the operation spends outside of the shard's `trace_t`, such as
+ * waiting for the superblock, committing to disk or waiting for replicas. */
+void add_shard_sample(event_log_t *event_log,
+                      const std::string &description,
+                      ticks_t duration);
+
 }  // namespace profile
 
 #endif  // RDB_PROTOCOL_PROFILE_HPP_
@@ -799,13 +799,13 @@ void rdb_r_unshard_visitor_t::operator()(const changefeed_stamp_t &) {
 void rdb_r_unshard_visitor_t::operator()(const changefeed_point_stamp_t &) {
     guarantee(count == 1);
     guarantee(boost::get<changefeed_point_stamp_response_t>(&responses[0].response));
-    *response_out = responses[0];
+    *response_out = std::move(responses[0]);
 }
 
 void rdb_r_unshard_visitor_t::operator()(const point_read_t &) {
     guarantee(count == 1);
     guarantee(NULL != boost::get<point_read_response_t>(&responses[0].response));
-    *response_out = responses[0];
+    *response_out = std::move(responses[0]);
 }
 
 void rdb_r_unshard_visitor_t::operator()(const intersecting_geo_read_t &query) {
@@ -1016,10 +1016,21 @@ void rdb_r_unshard_visitor_t::operator()(const distribution_read_t &dg) {
         }
     }
 
+    // Unlike the key counts, every hash shard samples the load separately, so we
+    // simply add them up.
+    for (const distribution_read_response_t &result : results) {
+        for (const auto &pair : result.load_counts) {
+            res.load_counts[pair.first] += pair.second;
+        }
+    }
+
     // If the result is larger than the requested limit, scale it down
     if (dg.result_limit > 0 && res.key_counts.size() > dg.result_limit) {
         scale_down_distribution(dg.result_limit, &res.key_counts);
     }
+    if (dg.result_limit > 0 && res.load_counts.size() > dg.result_limit) {
+        scale_down_distribution(dg.result_limit, &res.load_counts);
+    }
 
     response_out->response = res;
 }
@@ -1161,6 +1172,14 @@ struct rdb_w_get_region_visitor : public boost::static_visitor<region_t> {
         return region_from_keys(keys);
     }
 
+    region_t operator()(const ttl_expire_t &te) const {
+        return region_from_keys(te.keys);
+    }
+
+    region_t operator()(const range_delete_t &rd) const {
+        return rd.region;
+    }
+
     region_t operator()(const point_write_t &pw) const {
         return rdb_protocol::monokey_region(pw.key);
     }
@@ -1271,6 +1290,26 @@ struct rdb_w_shard_visitor_t : public boost::static_visitor<bool> {
         }
     }
 
+    bool operator()(const ttl_expire_t &te) const {
+        std::vector<store_key_t> shard_keys;
+        for (const store_key_t &key : te.keys) {
+            if (region_contains_key(*region, key)) {
+                shard_keys.push_back(key);
+            }
+        }
+        if (!shard_keys.empty()) {
+            *payload_out = ttl_expire_t(
+                std::move(shard_keys), te.pkey, te.index, te.cutoff);
+            return true;
+        } else {
+            return false;
+        }
+    }
+
+    bool operator()(const range_delete_t &rd) const {
+        return rangey_write(rd);
+    }
+
     bool operator()(const point_write_t &pw) const {
         return keyed_write(pw);
     }
@@ -1387,6 +1426,14 @@ struct rdb_w_unshard_visitor_t : public boost::static_visitor<void> {
         merge_stats();
     }
 
+    void operator()(const ttl_expire_t &) const {
+        merge_stats();
+    }
+
+    void operator()(const range_delete_t &) const {
+        merge_stats();
+    }
+
     void operator()(const point_write_t &) const { monokey_response(); }
     void operator()(const point_delete_t &) const { monokey_response(); }
 
@@ -1452,6 +1499,12 @@ struct rdb_w_expected_document_changes_visitor_t : public boost::static_visitor<
     int operator()(const batched_insert_t &w) const {
         return w.inserts.size();
     }
+    int operator()(const ttl_expire_t &w) const {
+        return w.keys.size();
+    }
+    int operator()(const range_delete_t &w) const {
+        return w.max_rows;
+    }
     int operator()(const point_write_t &) const { return 1; }
     int operator()(const point_delete_t &) const { return 1; }
     int operator()(const sync_t &) const { return 0; }
@@ -1470,7 +1523,8 @@ ARCHIVE_PRIM_MAKE_RANGED_SERIALIZABLE(
 RDB_IMPL_SERIALIZABLE_3_FOR_CLUSTER(
     rget_read_response_t, stamp_response, result, reql_version);
 RDB_IMPL_SERIALIZABLE_1_FOR_CLUSTER(nearest_geo_read_response_t, results_or_error);
-RDB_IMPL_SERIALIZABLE_2_FOR_CLUSTER(distribution_read_response_t, region, key_counts);
+RDB_IMPL_SERIALIZABLE_3_FOR_CLUSTER(
+        distribution_read_response_t, region, key_counts, load_counts);
 RDB_IMPL_SERIALIZABLE_2_FOR_CLUSTER(
     changefeed_subscribe_response_t, server_uuids, addrs);
 RDB_IMPL_SERIALIZABLE_2_FOR_CLUSTER(
@@ -1550,8 +1604,8 @@ RDB_IMPL_SERIALIZABLE_7_FOR_CLUSTER(
     serializable_env,
     region,
     current_shard);
-RDB_IMPL_SERIALIZABLE_2_FOR_CLUSTER(changefeed_stamp_t, addr, region);
-RDB_IMPL_SERIALIZABLE_2_FOR_CLUSTER(changefeed_point_stamp_t, addr, key);
+RDB_IMPL_SERIALIZABLE_3_FOR_CLUSTER(changefeed_stamp_t, addr, region, squash);
+RDB_IMPL_SERIALIZABLE_3_FOR_CLUSTER(changefeed_point_stamp_t, addr, key, squash);
 
 RDB_IMPL_SERIALIZABLE_3_FOR_CLUSTER(read_t, read, profile, read_mode);
 
@@ -1580,6 +1634,13 @@ RDB_IMPL_SERIALIZABLE_8_FOR_CLUSTER(
         limits,
         serializable_env,
         return_changes);
+RDB_IMPL_SERIALIZABLE_4_FOR_CLUSTER(
+        ttl_expire_t,
+        keys,
+        pkey,
+        index,
+        cutoff);
+RDB_IMPL_SERIALIZABLE_3_FOR_CLUSTER(range_delete_t, region, pkey, max_rows);
 
 RDB_IMPL_SERIALIZABLE_3_SINCE_v1_13(point_write_t, key, data, overwrite);
 RDB_IMPL_SERIALIZABLE_1_SINCE_v1_13(point_delete_t, key);
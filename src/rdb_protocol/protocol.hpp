@@ -161,6 +161,9 @@ struct distribution_read_response_t {
     // key_counts[kn] = the number of keys in [kn, right_key)
     region_t region;
     std::map<store_key_t, int64_t> key_counts;
+    // load_counts[k] = the estimated number of recent point reads and writes of keys
+    // in [k, k') where k' is the next key in load_counts (see `key_load_sampler_t`)
+    std::map<store_key_t, int64_t> load_counts;
 };
 RDB_DECLARE_SERIALIZABLE_FOR_CLUSTER(distribution_read_response_t);
 
@@ -284,11 +287,14 @@ struct sindex_rangespec_t {
 RDB_DECLARE_SERIALIZABLE_FOR_CLUSTER(sindex_rangespec_t);
 
 struct changefeed_stamp_t {
-    changefeed_stamp_t() : region(region_t::universe()) { }
-    explicit changefeed_stamp_t(ql::changefeed::client_t::addr_t _addr)
-        : addr(std::move(_addr)), region(region_t::universe()) { }
+    changefeed_stamp_t() : region(region_t::universe()), squash(false) { }
+    changefeed_stamp_t(ql::changefeed::client_t::addr_t _addr, bool _squash)
+        : addr(std::move(_addr)), region(region_t::universe()), squash(_squash) { }
     ql::changefeed::client_t::addr_t addr;
     region_t region;
+    // Whether the subscription reading the stamp squashes changes.  See
+    // `ql::changefeed::server_t::get_stamp`.
+    bool squash;
 };
 RDB_DECLARE_SERIALIZABLE_FOR_CLUSTER(changefeed_stamp_t);
 
@@ -477,6 +483,7 @@ RDB_DECLARE_SERIALIZABLE(changefeed_limit_subscribe_t);
 struct changefeed_point_stamp_t {
     ql::changefeed::client_t::addr_t addr;
     store_key_t key;
+    bool squash;
 };
 RDB_DECLARE_SERIALIZABLE_FOR_CLUSTER(changefeed_point_stamp_t);
 
@@ -623,6 +630,47 @@ struct batched_insert_t {
 };
 RDB_DECLARE_SERIALIZABLE_FOR_CLUSTER(batched_insert_t);
 
+/* `ttl_expire_t` deletes the rows with the given keys that have expired, that is whose
+value for `index` is a time before `cutoff` (in seconds since the epoch). The TTL sweep
+on the primary replica picks the keys from its copy of the index, and every replica
+checks the rows again with the index function. So the write does the same thing on
+every replica, whether or not it has the index, and rows that changed in the meantime
+stay. */
+struct ttl_expire_t {
+    ttl_expire_t() { }
+    ttl_expire_t(std::vector<store_key_t> &&_keys,
+                 const std::string &_pkey,
+                 const sindex_config_t &_index,
+                 double _cutoff)
+        : keys(std::move(_keys)), pkey(_pkey), index(_index), cutoff(_cutoff) {
+        r_sanity_check(keys.size() != 0);
+    }
+    std::vector<store_key_t> keys;
+    std::string pkey;
+    sindex_config_t index;
+    double cutoff;
+};
+RDB_DECLARE_SERIALIZABLE_FOR_CLUSTER(ttl_expire_t);
+
+/* `range_delete_t` deletes the rows whose primary keys are in `region`. It does the same
+as a `batched_replace_t` that replaces each of those rows with `null`, but the keys don't
+have to be read first and sent along, and the rows are deleted a leaf at a time. Each
+shard deletes at most `max_rows` of its rows, in key order, so that a large range is
+deleted over several writes; the caller repeats the write until it deletes nothing. */
+struct range_delete_t {
+    range_delete_t() { }
+    range_delete_t(const region_t &_region,
+                   const std::string &_pkey,
+                   uint64_t _max_rows)
+        : region(_region), pkey(_pkey), max_rows(_max_rows) {
+        r_sanity_check(max_rows != 0);
+    }
+    region_t region;
+    std::string pkey;
+    uint64_t max_rows;
+};
+RDB_DECLARE_SERIALIZABLE_FOR_CLUSTER(range_delete_t);
+
 class point_write_t {
 public:
     point_write_t() { }
@@ -672,7 +720,9 @@ struct write_t {
                            point_write_t,
                            point_delete_t,
                            sync_t,
-                           dummy_write_t> variant_t;
+                           dummy_write_t,
+                           ttl_expire_t,
+                           range_delete_t> variant_t;
     variant_t write;
 
     durability_requirement_t durability_requirement;
@@ -1,13 +1,116 @@
 // Copyright 2010-2015 RethinkDB, all rights reserved.
 #include "rdb_protocol/query_cache.hpp"
 
+#include <string.h>
+
+#include "arch/io/network.hpp"
+#include "pprint/js_pprint.hpp"
 #include "rdb_protocol/env.hpp"
 #include "rdb_protocol/pseudo_time.hpp"
 #include "rdb_protocol/response.hpp"
+#include "rdb_protocol/serialize_datum.hpp"
 #include "rdb_protocol/term_walker.hpp"
 
 namespace ql {
 
+// Queries with more JSON values than this aren't worth keeping compiled; they're
+// usually writes with large documents in them.
+const size_t MAX_COMPILED_QUERY_VALUES = 1000;
+
+// Hashes everything that `json_identical` compares.  Returns false if there are more
+// than `*budget` values.
+static bool hash_json(const rapidjson::Value &json, uint64_t *hash, size_t *budget) {
+    if (*budget == 0) {
+        return false;
+    }
+    --*budget;
+    auto mix = [hash](const void *data, size_t size) {
+        const uint8_t *bytes = static_cast<const uint8_t *>(data);
+        for (size_t i = 0; i < size; ++i) {
+            *hash = (*hash ^ bytes[i]) * 1099511628211ULL;
+        }
+    };
+    const uint8_t type = static_cast<uint8_t>(json.GetType());
+    mix(&type, sizeof(type));
+    switch (json.GetType()) {
+    case rapidjson::kObjectType:
+        for (auto it = json.MemberBegin(); it != json.MemberEnd(); ++it) {
+            if (!hash_json(it->name, hash, budget)
+                || !hash_json(it->value, hash, budget)) {
+                return false;
+            }
+        }
+        return true;
+    case rapidjson::kArrayType:
+        for (auto it = json.Begin(); it != json.End(); ++it) {
+            if (!hash_json(*it, hash, budget)) {
+                return false;
+            }
+        }
+        return true;
+    case rapidjson::kStringType:
+        mix(json.GetString(), json.GetStringLength());
+        return true;
+    case rapidjson::kNumberType: {
+        const double d = json.GetDouble();
+        mix(&d, sizeof(d));
+        return true;
+    }
+    case rapidjson::kNullType:
+    case rapidjson::kFalseType:
+    case rapidjson::kTrueType:
+    default:
+        return true;
+    }
+}
+
+// Unlike `rapidjson::Value::operator==`, this tells `0` and `-0.0` apart, and only
+// considers objects identical if their members are in the same order.
+static bool json_identical(const rapidjson::Value &a, const rapidjson::Value &b) {
+    if (a.GetType() != b.GetType()) {
+        return false;
+    }
+    switch (a.GetType()) {
+    case rapidjson::kObjectType: {
+        if (a.MemberCount() != b.MemberCount()) {
+            return false;
+        }
+        for (auto it = a.MemberBegin(), jt = b.MemberBegin();
+             it != a.MemberEnd(); ++it, ++jt) {
+            if (!json_identical(it->name, jt->name)
+                || !json_identical(it->value, jt->value)) {
+                return false;
+            }
+        }
+        return true;
+    }
+    case rapidjson::kArrayType: {
+        if (a.Size() != b.Size()) {
+            return false;
+        }
+        for (rapidjson::SizeType i = 0; i < a.Size(); ++i) {
+            if (!json_identical(a[i], b[i])) {
+                return false;
+            }
+        }
+        return true;
+    }
+    case rapidjson::kStringType:
+        return a.GetStringLength() == b.GetStringLength()
+            && memcmp(a.GetString(), b.GetString(), a.GetStringLength()) == 0;
+    case rapidjson::kNumberType: {
+        const double da = a.GetDouble();
+        const double db = b.GetDouble();
+        return memcmp(&da, &db, sizeof(double)) == 0;
+    }
+    case rapidjson::kNullType:
+    case rapidjson::kFalseType:
+    case rapidjson::kTrueType:
+    default:
+        return true;
+    }
+}
+
 query_cache_t::query_cache_t(
             rdb_context_t *_rdb_ctx,
             ip_and_port_t _client_addr_port,
@@ -17,6 +120,9 @@ query_cache_t::query_cache_t(
         client_addr_port(_client_addr_port),
         return_empty_normal_batches(_return_empty_normal_batches),
         user_context(std::move(_user_context)),
+        prefetch_budget(MAX_PREFETCHED_BATCHES),
+        prefetched_size(0),
+        conn(nullptr),
         next_query_id(0),
         oldest_outstanding_query_id(0) {
     auto res = rdb_ctx->get_query_caches_for_this_thread()->insert(this);
@@ -28,6 +134,15 @@ query_cache_t::~query_cache_t() {
     guarantee(res == 1);
 }
 
+int64_t query_cache_t::get_buffered_size() const {
+    assert_thread();
+    int64_t size = prefetched_size;
+    if (conn != nullptr) {
+        size += conn->get_buffered_write_size();
+    }
+    return size;
+}
+
 query_cache_t::const_iterator query_cache_t::begin() const {
     return queries.begin();
 }
@@ -48,14 +163,11 @@ scoped_ptr_t<query_cache_t::ref_t> query_cache_t::create(query_params_t *query_p
     }
 
     global_optargs_t global_optargs;
-    counted_t<const term_t> term_tree;
+    counted_t<const compiled_query_t> compiled_query;
     try {
         query_params->term_storage->preprocess();
         global_optargs = query_params->term_storage->global_optargs();
-
-        compile_env_t compile_env((var_visibility_t()));
-        term_tree = compile_term(&compile_env, query_params->term_storage->root_term());
-
+        compiled_query = compile_query(&query_params->term_storage);
     } catch (const exc_t &e) {
         throw bt_exc_t(Response::COMPILE_ERROR,
             e.get_error_type(),
@@ -70,19 +182,47 @@ scoped_ptr_t<query_cache_t::ref_t> query_cache_t::create(query_params_t *query_p
     scoped_ptr_t<entry_t> entry(new entry_t(query_params,
                                             std::move(global_optargs),
                                             std::move(deterministic_time),
-                                            std::move(term_tree)));
+                                            std::move(compiled_query)));
 
     scoped_ptr_t<ref_t> ref(new ref_t(this,
                                       query_params->token,
                                       std::move(query_params->throttler),
                                       entry.get(),
                                       interruptor));
-    auto insert_res = queries.insert(std::make_pair(query_params->token,
-                                                    std::move(entry)));
+    auto insert_res = queries.emplace(query_params->token, std::move(entry));
     guarantee(insert_res.second);
     return ref;
 }
 
+counted_t<const query_cache_t::compiled_query_t> query_cache_t::compile_query(
+        scoped_ptr_t<term_storage_t> *term_storage) {
+    const rapidjson::Value *json = (*term_storage)->root_term_json();
+    counted_t<const compiled_query_t> *slot = nullptr;
+    size_t hash = 0;
+    uint64_t json_hash = 14695981039346656037ULL;
+    size_t budget = MAX_COMPILED_QUERY_VALUES;
+    if (json != nullptr && hash_json(*json, &json_hash, &budget)) {
+        // Zero means that a query isn't kept.
+        hash = json_hash == 0 ? 1 : static_cast<size_t>(json_hash);
+        slot = &compiled_queries[hash % COMPILED_QUERIES_SIZE];
+        // Compiled terms don't depend on anything but the JSON they come from.
+        if (slot->has() && (*slot)->hash == hash
+            && json_identical(*json, *(*slot)->term_storage->root_term_json())) {
+            return *slot;
+        }
+    }
+
+    compile_env_t compile_env((var_visibility_t()));
+    counted_t<const term_t> term_tree =
+        compile_term(&compile_env, (*term_storage)->root_term());
+    counted_t<const compiled_query_t> res = make_counted<compiled_query_t>(
+        hash, std::move(*term_storage), std::move(term_tree));
+    if (slot != nullptr) {
+        *slot = res;
+    }
+    return res;
+}
+
 scoped_ptr_t<query_cache_t::ref_t> query_cache_t::get(query_params_t *query_params,
                                                       signal_t *interruptor) {
     guarantee(this == query_params->query_cache);
@@ -171,6 +311,11 @@ query_cache_t::ref_t::~ref_t() {
         //     removed, including the one in this reference
         // We remove the entry from the cache so no new queries can acquire it
         entry->state = entry_t::state_t::DELETING;
+        // The entry may be destroyed after the query cache, so it can't keep this.
+        // There is no prefetch running, since it would be holding the entry's mutex.
+        entry->prefetch_slot.reset();
+        query_cache->prefetched_size -= entry->prefetched_size;
+        entry->prefetched_size = 0;
 
         auto it = query_cache->queries.find(token);
         guarantee(it != query_cache->queries.end());
@@ -181,6 +326,58 @@ query_cache_t::ref_t::~ref_t() {
 }
 
 void query_cache_t::ref_t::fill_response(response_t *res) {
+    const ticks_t start_time = get_ticks();
+    const int64_t batch = entry->batches_sent;
+    try {
+        respond(res);
+    } catch (const bt_exc_t &ex) {
+        maybe_log_slow_query(start_time, batch, nullptr, &ex.message);
+        throw;
+    }
+    maybe_log_slow_query(start_time, batch, res, nullptr);
+}
+
+void query_cache_t::ref_t::maybe_log_slow_query(ticks_t start_time,
+                                                int64_t batch,
+                                                const response_t *res,
+                                                const std::string *error) {
+    const ticks_t duration{get_ticks().nanos - start_time.nanos};
+    slow_query_log_t *log = &query_cache->rdb_ctx->stats.slow_queries;
+    if (!log->is_slow(duration)) {
+        return;
+    }
+
+    // The same width as the queries in the `rethinkdb.jobs` table.
+    const size_t printed_query_columns = 89;
+    slow_query_log_entry_t log_entry;
+    log_entry.id = generate_uuid();
+    log_entry.time = current_microtime();
+    log_entry.duration = duration;
+    log_entry.query = pprint::pretty_print_as_js(
+        printed_query_columns, entry->compiled_query->term_storage->root_term());
+    log_entry.batch = batch;
+    log_entry.client_address = query_cache->client_addr_port.ip().to_string();
+    log_entry.client_port = query_cache->client_addr_port.port().value();
+    log_entry.user = query_cache->get_user_context().to_string();
+    log_entry.rows_returned = 0;
+    if (res != nullptr) {
+        for (const datum_t &d : res->data()) {
+            log_entry.rows_returned += res->type() == Response::SUCCESS_ATOM
+                    && d.get_type() == datum_t::R_ARRAY
+                ? d.arr_size()
+                : 1;
+        }
+        if (res->profile().has_value()) {
+            log_entry.shards_touched.set(count_shards_in_profile(*res->profile()));
+        }
+    }
+    if (error != nullptr) {
+        log_entry.error.set(*error);
+    }
+    log->record(std::move(log_entry));
+}
+
+void query_cache_t::ref_t::respond(response_t *res) {
     query_cache->assert_thread();
     if (entry->state != entry_t::state_t::START &&
         entry->state != entry_t::state_t::STREAM) {
@@ -194,6 +391,8 @@ void query_cache_t::ref_t::fill_response(response_t *res) {
             backtrace_registry_t::EMPTY_BACKTRACE);
     }
 
+    // Coroutines that the query spawns inherit this.
+    with_priority_t query_priority(entry->priority);
     try {
         serializable_env_t serializable{
                 entry->global_optargs,
@@ -205,6 +404,7 @@ void query_cache_t::ref_t::fill_response(response_t *res) {
             &combined_interruptor,
             serializable,
             trace.get_or_null());
+        env.set_usage(&entry->usage);
 
         if (entry->state == entry_t::state_t::START) {
             run(&env, res);
@@ -252,14 +452,15 @@ void query_cache_t::ref_t::fill_response(response_t *res) {
         throw bt_exc_t(Response::RUNTIME_ERROR,
                        ex.get_error_type(),
                        ex.what(),
-                       entry->term_storage->backtrace_registry().datum_backtrace(ex));
+                       entry->compiled_query->term_storage->backtrace_registry()
+                           .datum_backtrace(ex));
     } catch (const datum_exc_t &ex) {
         query_cache->terminate_internal(entry);
         throw bt_exc_t(Response::RUNTIME_ERROR,
                        ex.get_error_type(),
                        ex.what(),
-                       entry->term_storage->backtrace_registry().datum_backtrace(
-                            backtrace_id_t::empty(), 0));
+                       entry->compiled_query->term_storage->backtrace_registry()
+                           .datum_backtrace(backtrace_id_t::empty(), 0));
     } catch (const std::exception &ex) {
         query_cache->terminate_internal(entry);
         throw bt_exc_t(Response::RUNTIME_ERROR,
@@ -270,9 +471,31 @@ void query_cache_t::ref_t::fill_response(response_t *res) {
 }
 
 void query_cache_t::ref_t::run(env_t *env, response_t *res) {
+    if (entry->explain) {
+        optional<raw_term_t> write_term = find_write_or_meta_term(
+            entry->compiled_query->term_storage->root_term());
+        if (write_term) {
+            rfail_src(write_term->bt(), base_exc_t::LOGIC,
+                      "Cannot `explain` a query that writes or changes the cluster.");
+        }
+    }
+
     scope_env_t scope_env(env, var_scope_t());
     scoped_ptr_t<val_t> val = entry->term_tree->eval(&scope_env);
 
+    if (entry->explain) {
+        // Streams on tables are lazy, so evaluating the root term hasn't read any
+        // documents yet.  Anything else has already been computed by now.
+        rcheck_toplevel(val->get_type().is_convertible(val_t::type_t::SEQUENCE),
+                        base_exc_t::LOGIC,
+                        strprintf("Can only `explain` a query that returns a sequence "
+                                  "(got %s).", val->get_type().name()));
+        res->set_type(Response::SUCCESS_ATOM);
+        res->set_data(val->as_seq(env)->explain(env));
+        entry->state = entry_t::state_t::DONE;
+        return;
+    }
+
     if (val->get_type().is_convertible(val_t::type_t::DATUM)) {
         res->set_type(Response::SUCCESS_ATOM);
         res->set_data(val->as_datum());
@@ -292,7 +515,7 @@ void query_cache_t::ref_t::run(env_t *env, response_t *res) {
             entry->state = entry_t::state_t::DONE;
         } else {
             entry->stream = seq;
-            entry->has_sent_batch = false;
+            entry->batches_sent = 0;
             entry->state = entry_t::state_t::STREAM;
         }
     } else {
@@ -312,12 +535,26 @@ void query_cache_t::ref_t::serve(env_t *env, response_t *res) {
         throttler.reset();
     }
 
-    batch_type_t batch_type = entry->has_sent_batch
-                                  ? batch_type_t::NORMAL
-                                  : batch_type_t::NORMAL_FIRST;
-    std::vector<datum_t> ds = entry->stream->next_batch(
-            env, batchspec_t::user(batch_type, env));
-    entry->has_sent_batch = true;
+    std::vector<datum_t> ds;
+    if (entry->prefetched_batch.has_value() || entry->prefetch_error) {
+        entry->prefetch_slot.reset();
+        if (entry->prefetch_error) {
+            std::exception_ptr error;
+            std::swap(error, entry->prefetch_error);
+            std::rethrow_exception(error);
+        }
+        ds = std::move(*entry->prefetched_batch);
+        entry->prefetched_batch.reset();
+        query_cache->prefetched_size -= entry->prefetched_size;
+        entry->prefetched_size = 0;
+    } else {
+        batchspec_t batchspec = entry->batches_sent == 0
+            ? batchspec_t::user(batch_type_t::NORMAL_FIRST, env)
+            : batchspec_t::user(batch_type_t::NORMAL, env)
+                  .with_slow_start(entry->batches_sent);
+        ds = entry->stream->next_batch(env, batchspec);
+    }
+    ++entry->batches_sent;
     res->set_data(std::move(ds));
 
     // Note that `SUCCESS_SEQUENCE` is possible for feeds if you call `.limit`
@@ -354,24 +591,105 @@ void query_cache_t::ref_t::serve(env_t *env, response_t *res) {
     default: unreachable();
     }
     entry->stream->set_notes(res);
+
+    // Feeds can block for as long as they like, and a prefetched batch would end up
+    // in the wrong request's profile.  A client that doesn't keep up with reading its
+    // responses doesn't get batches read ahead for it either, so that it can't make
+    // us hold on to more and more data.
+    if (entry->state == entry_t::state_t::STREAM
+        && cfeed_type == feed_type_t::not_feed
+        && entry->profile == profile_bool_t::DONT_PROFILE
+        && !entry->prefetch_slot.has_semaphore()
+        && query_cache->prefetch_budget.current()
+           < query_cache->prefetch_budget.capacity()
+        && query_cache->get_buffered_size() < MAX_BUFFERED_SIZE) {
+        entry->prefetch_slot.init(&query_cache->prefetch_budget, 1);
+        // This gets in line for the entry's mutex before returning, so the prefetch
+        // runs before the client's next request for this query.
+        query_cache_t *cache = query_cache;
+        query_cache_t::entry_t *e = entry;
+        auto_drainer_t::lock_t lock(&entry->drainer);
+        coro_t::spawn_now_dangerously([cache, e, lock]() {
+            cache->prefetch(e, lock);
+        });
+    }
 }
 
+void query_cache_t::prefetch(query_cache_t::entry_t *entry,
+                             auto_drainer_t::lock_t drainer_lock) {
+    try {
+        wait_any_t interruptor(&entry->persistent_interruptor,
+                               drainer_lock.get_drain_signal());
+        new_mutex_in_line_t mutex_lock(&entry->mutex);
+        wait_interruptible(mutex_lock.acq_signal(), &interruptor);
+        // The entry may have finished, or be waiting to be destroyed (in which case
+        // the query cache might be gone), while we waited for the mutex.
+        if (entry->state != entry_t::state_t::STREAM
+            || entry->prefetched_batch.has_value()
+            || entry->prefetch_error) {
+            return;
+        }
+
+        serializable_env_t serializable{
+                entry->global_optargs,
+                user_context,
+                entry->deterministic_time};
+        env_t env(
+            rdb_ctx,
+            return_empty_normal_batches,
+            &interruptor,
+            serializable,
+            nullptr);
+        env.set_usage(&entry->usage);
+        const batchspec_t batchspec = batchspec_t::user(batch_type_t::NORMAL, &env)
+            .with_slow_start(entry->batches_sent);
+        try {
+            std::vector<datum_t> batch = entry->stream->next_batch(&env, batchspec);
+            for (const datum_t &d : batch) {
+                entry->prefetched_size += serialized_size<cluster_version_t::CLUSTER>(d);
+            }
+            prefetched_size += entry->prefetched_size;
+            entry->prefetched_batch.set(std::move(batch));
+        } catch (const interrupted_exc_t &) {
+            throw;
+        } catch (...) {
+            // `serve` rethrows this when the client asks for the batch.
+            entry->prefetch_error = std::current_exception();
+        }
+    } catch (const interrupted_exc_t &) {
+        // The query was stopped or deleted, which the next request for it (if there
+        // is any) finds out about on its own.
+    }
+}
+
+query_cache_t::compiled_query_t::compiled_query_t(
+        size_t _hash,
+        scoped_ptr_t<term_storage_t> &&_term_storage,
+        counted_t<const term_t> &&_term_tree) :
+    hash(_hash),
+    term_storage(std::move(_term_storage)),
+    term_tree(std::move(_term_tree)) { }
+
 query_cache_t::entry_t::entry_t(query_params_t *query_params,
                                 global_optargs_t &&_global_optargs,
                                 ql::datum_t && _deterministic_time,
-                                counted_t<const term_t> &&_term_tree) :
+                                counted_t<const compiled_query_t> &&_compiled_query) :
         state(state_t::START),
         interrupt_reason(interrupt_reason_t::UNKNOWN),
         job_id(generate_uuid()),
         noreply(query_params->noreply),
         profile(query_params->profile ? profile_bool_t::PROFILE :
                                         profile_bool_t::DONT_PROFILE),
+        explain(query_params->explain),
+        priority(query_params->priority),
+        compiled_query(std::move(_compiled_query)),
         term_storage(std::move(query_params->term_storage)),
         global_optargs(std::move(_global_optargs)),
         deterministic_time(_deterministic_time),
         start_time(get_kiloticks()),
-        term_tree(std::move(_term_tree)),
-        has_sent_batch(false) { }
+        term_tree(compiled_query->term_tree),
+        batches_sent(0),
+        prefetched_size(0) { }
 
 query_cache_t::entry_t::~entry_t() { }
 
@@ -4,22 +4,27 @@
 
 #include <time.h>
 
+#include <array>
 #include <exception>
 #include <map>
 #include <set>
 #include <string>
 
 #include "arch/address.hpp"
+#include "arch/types.hpp"
 #include "clustering/administration/auth/user_context.hpp"
 #include "concurrency/auto_drainer.hpp"
 #include "concurrency/new_mutex.hpp"
+#include "concurrency/new_semaphore.hpp"
 #include "concurrency/wait_any.hpp"
 #include "concurrency/signal.hpp"
 #include "concurrency/watchable.hpp"
 #include "containers/scoped.hpp"
 #include "containers/counted.hpp"
+#include "containers/flat_hash_map.hpp"
 #include "containers/intrusive_list.hpp"
 #include "containers/object_buffer.hpp"
+#include "containers/optional.hpp"
 #include "rdb_protocol/datum_stream.hpp"
 #include "rdb_protocol/rdb_backtrace.hpp"
 #include "rdb_protocol/error.hpp"
@@ -33,6 +38,7 @@
 namespace ql {
 
 class query_cache_t : public home_thread_mixin_t {
+    class compiled_query_t;
     class entry_t;
 public:
     query_cache_t(rdb_context_t *_rdb_ctx,
@@ -55,6 +61,15 @@ public:
               query_cache_t::entry_t *_entry,
               signal_t *interruptor);
 
+        // Does the work of `fill_response()`, which times it for the slow query log
+        void respond(response_t *res);
+        // Records the response in the slow query log if it took too long.  `error` is
+        // the error message if the response failed, or `nullptr`.
+        void maybe_log_slow_query(ticks_t start_time,
+                                  int64_t batch,
+                                  const response_t *res,
+                                  const std::string *error);
+
         // Run a new query
         void run(env_t *env, response_t *res);
         // Serve a batch from a stream
@@ -74,13 +89,23 @@ public:
     };
 
     // const iteration for the jobs table
-    typedef std::map<int64_t, scoped_ptr_t<entry_t> >::const_iterator const_iterator;
+    typedef flat_hash_map_t<int64_t, scoped_ptr_t<entry_t> >::const_iterator
+        const_iterator;
     const_iterator begin() const;
     const_iterator end() const;
 
     // Helper function used by the jobs table
     ip_and_port_t get_client_addr_port() const { return client_addr_port; }
 
+    // The connection whose queries this caches, so that the data waiting to be written
+    // to it can be counted in `get_buffered_size()`.  The HTTP server doesn't have one.
+    void set_connection(const tcp_conn_t *_conn) { conn = _conn; }
+
+    // The number of bytes that this connection's queries hold on to: read-ahead
+    // batches and responses that haven't been written to the connection yet.  Once
+    // this gets over `MAX_BUFFERED_SIZE`, batches aren't read ahead any more.
+    int64_t get_buffered_size() const;
+
     // Methods to obtain a unique reference to a given entry in the cache
     scoped_ptr_t<ref_t> create(query_params_t *query_params,
                                ql::datum_t &&deterministic_time,
@@ -103,12 +128,34 @@ public:
     auth::user_context_t const &get_user_context() const;
 
 private:
+    // A compiled term tree, along with the term storage its terms point into.  Clients
+    // tend to send the same queries over and over, so identical queries share these.
+    class compiled_query_t : public single_threaded_countable_t<compiled_query_t> {
+    public:
+        compiled_query_t(size_t _hash,
+                         scoped_ptr_t<term_storage_t> &&_term_storage,
+                         counted_t<const term_t> &&_term_tree);
+
+        // The hash of the root term's JSON, or 0 if it has none.
+        const size_t hash;
+        const scoped_ptr_t<const term_storage_t> term_storage;
+        const counted_t<const term_t> term_tree;
+
+    private:
+        DISABLE_COPYING(compiled_query_t);
+    };
+
+    // Compiles the root term of `*term_storage`, or finds it in `compiled_queries`.
+    // If it has to compile it, the result takes over `*term_storage`.
+    counted_t<const compiled_query_t> compile_query(
+        scoped_ptr_t<term_storage_t> *term_storage);
+
     class entry_t {
     public:
         entry_t(query_params_t *query_params,
                 global_optargs_t &&_global_optargs,
                 ql::datum_t &&_deterministic_time,
-                counted_t<const term_t> &&_term_tree);
+                counted_t<const compiled_query_t> &&_compiled_query);
         ~entry_t();
 
         enum class state_t { START, STREAM, DONE, DELETING } state;
@@ -117,6 +164,12 @@ private:
         const uuid_u job_id;
         const bool noreply;
         const profile_bool_t profile;
+        const bool explain;
+        const int priority;
+        // The backtraces of errors are looked up in this query's term storage.
+        const counted_t<const compiled_query_t> compiled_query;
+        // The query's own term storage, if `compiled_query` came from an earlier
+        // query.  The global optargs point into it.
         const scoped_ptr_t<const term_storage_t> term_storage;
         const global_optargs_t global_optargs;
         // TODO: deterministic_time and start_time represent approximately the same
@@ -134,7 +187,19 @@ private:
         // If this resulted in a stream, this will not be empty until the
         // stream is finished
         counted_t<datum_stream_t> stream;
-        bool has_sent_batch;
+        int64_t batches_sent;
+        // The resources the query used so far, in all of its batches.
+        query_usage_t usage;
+
+        // The next batch of `stream` (or the error reading it), if it was read
+        // before the client asked for it.  `prefetch_slot` holds a unit of the query
+        // cache's `prefetch_budget` while the batch is being read or waits to be sent.
+        optional<std::vector<datum_t> > prefetched_batch;
+        std::exception_ptr prefetch_error;
+        new_semaphore_in_line_t prefetch_slot;
+        // The serialized size of `prefetched_batch`, which is part of the query
+        // cache's `prefetched_size`.
+        int64_t prefetched_size;
 
         // The order of these is very important, do not move them around
         new_mutex_t mutex; // Only one coroutine may be using this query at a time
@@ -146,11 +211,29 @@ private:
 
     static void async_destroy_entry(entry_t *entry);
 
+    // Reads the next batch of `entry`'s stream ahead of the client's next `CONTINUE`,
+    // so that computing it overlaps with sending the last one.
+    void prefetch(entry_t *entry, auto_drainer_t::lock_t drainer_lock);
+
     rdb_context_t *const rdb_ctx;
     ip_and_port_t client_addr_port;
     return_empty_normal_batches_t return_empty_normal_batches;
     auth::user_context_t user_context;
-    std::map<int64_t, scoped_ptr_t<entry_t> > queries;
+
+    // Bounds the number of batches that are prefetched on this connection at a time.
+    // This has to outlive `queries`, since their entries hold units of it.
+    static const int64_t MAX_PREFETCHED_BATCHES = 8;
+    new_semaphore_t prefetch_budget;
+    static const int64_t MAX_BUFFERED_SIZE = 16 * MEGABYTE;
+    int64_t prefetched_size;
+    const tcp_conn_t *conn;
+
+    flat_hash_map_t<int64_t, scoped_ptr_t<entry_t> > queries;
+
+    // Recently compiled queries, indexed by the hash of their root term.
+    static const size_t COMPILED_QUERIES_SIZE = 32;
+    std::array<counted_t<const compiled_query_t>, COMPILED_QUERIES_SIZE>
+        compiled_queries;
 
     // Used for noreply waiting, this contains all allocated-but-incomplete query ids
     friend class query_params_t::query_id_t;
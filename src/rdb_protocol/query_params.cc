@@ -68,11 +68,35 @@ query_params_t::query_params_t(int64_t _token,
                                scoped_ptr_t<term_storage_t> &&_term_storage) :
         query_cache(_query_cache),
         term_storage(std::move(_term_storage)),
-        id(query_cache), token(_token), noreply(false), profile(false) {
+        id(query_cache), token(_token), noreply(false), profile(false),
+        explain(false), priority(MESSAGE_SCHEDULER_DEFAULT_PRIORITY) {
     // Parse out information that is needed before query evaluation
     type = term_storage->query_type();
     noreply = term_storage->static_optarg_as_bool("noreply", noreply);
     profile = term_storage->static_optarg_as_bool("profile", profile);
+    explain = term_storage->static_optarg_as_bool("explain", explain);
+    if (type == Query::START) {
+        optional<std::string> scheduling_class =
+            term_storage->static_optarg_as_string("scheduling_class");
+        if (scheduling_class) {
+            priority = scheduling_class_priority(*scheduling_class);
+        }
+    }
+}
+
+int query_params_t::scheduling_class_priority(const std::string &scheduling_class) {
+    if (scheduling_class == "interactive") {
+        return CORO_PRIORITY_INTERACTIVE;
+    } else if (scheduling_class == "batch") {
+        return CORO_PRIORITY_BATCH;
+    } else if (scheduling_class == "background") {
+        return CORO_PRIORITY_BACKGROUND;
+    }
+    throw bt_exc_t(Response::CLIENT_ERROR, Response::QUERY_LOGIC,
+                   strprintf("Unrecognized scheduling_class `%s` (expected "
+                             "`interactive`, `batch` or `background`).",
+                             scheduling_class.c_str()),
+                   backtrace_registry_t::EMPTY_BACKTRACE);
 }
 
 } // namespace ql
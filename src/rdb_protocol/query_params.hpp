@@ -37,6 +37,9 @@ public:
 
     void maybe_release_query_id();
 
+    // Throws a `bt_exc_t` for an unknown class.
+    static int scheduling_class_priority(const std::string &scheduling_class);
+
     query_cache_t *query_cache;
     scoped_ptr_t<term_storage_t> term_storage;
     query_id_t id;
@@ -45,6 +48,10 @@ public:
     Query::QueryType type;
     bool noreply;
     bool profile;
+    // Return how the query would be run instead of running it.
+    bool explain;
+    // The coroutine priority of the query's scheduling class
+    int priority;
 
     new_semaphore_in_line_t throttler;
 
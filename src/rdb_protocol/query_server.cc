@@ -12,10 +12,12 @@
 rdb_query_server_t::rdb_query_server_t(
     const std::set<ip_address_t> &local_addresses, int port,
     rdb_context_t *_rdb_ctx, server_config_client_t *_server_config_client,
-    const server_id_t &_server_id, tls_ctx_t *tls_ctx
+    const server_id_t &_server_id, tls_ctx_t *tls_ctx,
+    const query_server_options_t &options
 ) :
     server(
-        _rdb_ctx, local_addresses, port, this, default_http_timeout_sec, tls_ctx
+        _rdb_ctx, local_addresses, port, this, default_http_timeout_sec, tls_ctx,
+        options
     ),
     rdb_ctx(_rdb_ctx),
     server_config_client(_server_config_client),
@@ -35,6 +37,7 @@ void rdb_query_server_t::run_query(ql::query_params_t *query_params,
                                    signal_t *interruptor) {
     guarantee(interruptor != nullptr);
     guarantee(rdb_ctx->cluster_interface != nullptr);
+    const ticks_t start_time = get_ticks();
     try {
         // TODO: make this perfmon correct now that we have parallelized queries
         scoped_perfmon_counter_t client_active(&rdb_ctx->stats.clients_active);
@@ -81,6 +84,7 @@ void rdb_query_server_t::run_query(ql::query_params_t *query_params,
 
     rdb_ctx->stats.queries_per_sec.record();
     ++rdb_ctx->stats.queries_total;
+    rdb_ctx->stats.query_latency.record(ticks_t{get_ticks().nanos - start_time.nanos});
 }
 
 void rdb_query_server_t::fill_server_info(ql::response_t *out) {
@@ -7,20 +7,41 @@ namespace ql {
 
 const datum_t backtrace_registry_t::EMPTY_BACKTRACE = datum_t::empty_array();
 
-backtrace_registry_t::frame_t::frame_t(backtrace_id_t _parent, datum_t _val) :
-    parent(_parent), val(_val) { }
+const uint32_t backtrace_registry_t::frame_t::OPTARG;
 
-bool backtrace_registry_t::frame_t::is_head() const {
-    return val.get_type() == datum_t::type_t::R_NULL;
+backtrace_registry_t::frame_t::frame_t(backtrace_id_t _parent,
+                                       uint32_t _arg_index,
+                                       uint32_t _name_offset,
+                                       uint32_t _name_size) :
+    parent(_parent),
+    arg_index(_arg_index),
+    name_offset(_name_offset),
+    name_size(_name_size) { }
+
+datum_t backtrace_registry_t::frame_t::val(const std::string &names) const {
+    if (arg_index != OPTARG) {
+        return datum_t(static_cast<double>(arg_index));
+    }
+    r_sanity_check(name_offset + name_size <= names.size());
+    return datum_t(datum_string_t(name_size, names.data() + name_offset));
 }
 
 backtrace_registry_t::backtrace_registry_t() {
-    frames.emplace_back(backtrace_id_t::empty(), datum_t::null());
+    frames.emplace_back(backtrace_id_t::empty(), 0, 0, 0);
+}
+
+backtrace_id_t backtrace_registry_t::new_arg_frame(backtrace_id_t parent_bt,
+                                                   size_t index) {
+    r_sanity_check(index < frame_t::OPTARG);
+    frames.emplace_back(parent_bt, index, 0, 0);
+    return backtrace_id_t(frames.size() - 1);
 }
 
-backtrace_id_t backtrace_registry_t::new_frame(backtrace_id_t parent_bt,
-                                               const datum_t &val) {
-    frames.emplace_back(parent_bt, val);
+backtrace_id_t backtrace_registry_t::new_optarg_frame(backtrace_id_t parent_bt,
+                                                      const char *name,
+                                                      size_t name_size) {
+    frames.emplace_back(parent_bt, frame_t::OPTARG, optarg_names.size(), name_size);
+    optarg_names.append(name, name_size);
     return backtrace_id_t(frames.size() - 1);
 }
 
@@ -32,13 +53,13 @@ datum_t backtrace_registry_t::datum_backtrace(backtrace_id_t bt,
                                               size_t dummy_frames) const {
     r_sanity_check(bt.get() < frames.size());
     std::vector<datum_t> res;
-    for (const frame_t *f = &frames[bt.get()];
-         !f->is_head(); f = &frames[f->parent.get()]) {
-        r_sanity_check(f->parent.get() < frames.size());
+    for (backtrace_id_t id = bt; id.get() != 0; id = frames[id.get()].parent) {
+        const frame_t &f = frames[id.get()];
+        r_sanity_check(f.parent.get() < frames.size());
         if (dummy_frames > 0) {
             --dummy_frames;
         } else {
-            res.push_back(f->val);
+            res.push_back(f.val(optarg_names));
         }
     }
     std::reverse(res.begin(), res.end());
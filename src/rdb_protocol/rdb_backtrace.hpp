@@ -2,6 +2,8 @@
 #ifndef RDB_PROTOCOL_RDB_BACKTRACE_HPP_
 #define RDB_PROTOCOL_RDB_BACKTRACE_HPP_
 
+#include <limits>
+#include <string>
 #include <vector>
 #include <stdexcept>
 
@@ -36,13 +38,23 @@ public:
     const datum_t bt_datum;
 };
 
+/* `backtrace_registry_t` holds a frame for every term of a query, so that an error can
+be reported with the path from the root term to the term that caused it. Every query
+registers its frames when it gets compiled, but few of them ever report an error, so
+the frames only hold the position of a term in its parent; the datums of a backtrace
+only get built by `datum_backtrace()`. */
 class backtrace_registry_t {
 public:
     backtrace_registry_t();
     backtrace_registry_t(backtrace_registry_t &&) = default;
 
-    backtrace_id_t new_frame(backtrace_id_t parent_bt,
-                             const datum_t &val);
+    // The frame of the argument at position `index` of the term at `parent_bt`.
+    backtrace_id_t new_arg_frame(backtrace_id_t parent_bt, size_t index);
+    // The frame of the optional argument with the name `name` of the term at
+    // `parent_bt`.
+    backtrace_id_t new_optarg_frame(backtrace_id_t parent_bt,
+                                    const char *name,
+                                    size_t name_size);
 
     datum_t datum_backtrace(const exc_t &ex) const;
     datum_t datum_backtrace(backtrace_id_t bt, size_t dummy_frames = 0) const;
@@ -51,15 +63,27 @@ public:
 
 private:
     struct frame_t {
-        frame_t(); // Only for creating the HEAD term
-        frame_t(backtrace_id_t _parent, datum_t _val);
-        bool is_head() const;
+        static const uint32_t OPTARG = std::numeric_limits<uint32_t>::max();
+
+        frame_t(backtrace_id_t _parent,
+                uint32_t _arg_index,
+                uint32_t _name_offset,
+                uint32_t _name_size);
+        datum_t val(const std::string &names) const;
 
         backtrace_id_t parent;
-        datum_t val;
+        // The position of the argument, or `OPTARG` for the optional argument whose
+        // name is at `name_offset` in `optarg_names`.
+        uint32_t arg_index;
+        uint32_t name_offset;
+        uint32_t name_size;
     };
 
+    // The first frame is the root of all backtraces and has no value.
     std::vector<frame_t> frames;
+    // The names of the optional arguments in `frames`, one after the other, so that
+    // registering a frame doesn't have to allocate anything most of the time.
+    std::string optarg_names;
     DISABLE_COPYING(backtrace_registry_t);
 };
 
@@ -0,0 +1,228 @@
+// Copyright 2010-2015 RethinkDB, all rights reserved.
+#include "rdb_protocol/read_result_cache.hpp"
+
+#include "containers/archive/string_stream.hpp"
+#include "rdb_protocol/func.hpp"
+#include "rdb_protocol/op.hpp"
+
+namespace {
+
+// The cached responses only get served by the server that computed them, and
+// `deterministic_time` is part of the key, so `r.now()` counts as deterministic.
+bool is_deterministic(const counted_t<const ql::func_t> &f) {
+    return !f.has()
+        || f->is_deterministic().test(ql::single_server_t::yes, ql::constant_now_t::yes);
+}
+
+class deterministic_visitor_t : public boost::static_visitor<bool> {
+public:
+    bool operator()(const ql::map_wire_func_t &f) const {
+        return is_deterministic(f.compile_wire_func());
+    }
+    bool operator()(const ql::group_wire_func_t &f) const {
+        for (const auto &func : f.compile_funcs()) {
+            if (!is_deterministic(func)) {
+                return false;
+            }
+        }
+        return true;
+    }
+    bool operator()(const ql::filter_wire_func_t &f) const {
+        return is_deterministic(f.filter_func.compile_wire_func())
+            && (!f.default_filter_val.has_value()
+                || is_deterministic(f.default_filter_val->compile_wire_func()));
+    }
+    bool operator()(const ql::concatmap_wire_func_t &f) const {
+        return is_deterministic(f.compile_wire_func());
+    }
+    bool operator()(const ql::distinct_wire_func_t &) const { return true; }
+    bool operator()(const ql::zip_wire_func_t &) const { return true; }
+
+    bool operator()(const ql::count_wire_func_t &) const { return true; }
+    bool operator()(const ql::sum_wire_func_t &f) const {
+        return is_deterministic(f.compile_wire_func_or_null());
+    }
+    bool operator()(const ql::avg_wire_func_t &f) const {
+        return is_deterministic(f.compile_wire_func_or_null());
+    }
+    bool operator()(const ql::min_wire_func_t &f) const {
+        return is_deterministic(f.compile_wire_func_or_null());
+    }
+    bool operator()(const ql::max_wire_func_t &f) const {
+        return is_deterministic(f.compile_wire_func_or_null());
+    }
+    bool operator()(const ql::reduce_wire_func_t &f) const {
+        return is_deterministic(f.compile_wire_func());
+    }
+    bool operator()(const ql::top_k_wire_func_t &f) const {
+        for (const auto &comparison : f.compile_comparisons()) {
+            if (!is_deterministic(comparison.second)) {
+                return false;
+            }
+        }
+        return true;
+    }
+    // Only used within a store, and it can't be serialized into a key anyway.
+    bool operator()(const ql::limit_read_t &) const { return false; }
+};
+
+key_range_t keys_range(const std::vector<store_key_t> &keys) {
+    guarantee(!keys.empty());
+    store_key_t min_key = keys[0];
+    store_key_t max_key = keys[0];
+    for (const store_key_t &key : keys) {
+        if (key < min_key) {
+            min_key = key;
+        }
+        if (key > max_key) {
+            max_key = key;
+        }
+    }
+    return key_range_t(key_range_t::closed, min_key, key_range_t::closed, max_key);
+}
+
+// Like `write_t::get_region()`, but without the hash part and `r_nullopt` if the
+// write can't change anything.
+class written_range_visitor_t : public boost::static_visitor<optional<key_range_t> > {
+public:
+    optional<key_range_t> operator()(const batched_replace_t &br) const {
+        return br.keys.empty() ? r_nullopt : make_optional(keys_range(br.keys));
+    }
+    optional<key_range_t> operator()(const batched_insert_t &bi) const {
+        if (bi.inserts.empty()) {
+            return r_nullopt;
+        }
+        std::vector<store_key_t> keys;
+        keys.reserve(bi.inserts.size());
+        for (const ql::datum_t &insert : bi.inserts) {
+            keys.emplace_back(insert.get_field(datum_string_t(bi.pkey)).print_primary());
+        }
+        return make_optional(keys_range(keys));
+    }
+    optional<key_range_t> operator()(const point_write_t &pw) const {
+        return make_optional(key_range_t(
+            key_range_t::closed, pw.key, key_range_t::closed, pw.key));
+    }
+    optional<key_range_t> operator()(const point_delete_t &pd) const {
+        return make_optional(key_range_t(
+            key_range_t::closed, pd.key, key_range_t::closed, pd.key));
+    }
+    optional<key_range_t> operator()(const ttl_expire_t &te) const {
+        return make_optional(keys_range(te.keys));
+    }
+    optional<key_range_t> operator()(const range_delete_t &rd) const {
+        return make_optional(rd.region.inner);
+    }
+    optional<key_range_t> operator()(const sync_t &) const { return r_nullopt; }
+    optional<key_range_t> operator()(const dummy_write_t &) const { return r_nullopt; }
+};
+
+}  // namespace
+
+read_result_cache_t::read_result_cache_t()
+    : entries(READ_RESULT_CACHE_MAX_ENTRIES), generation_(0), num_suspensions(0) { }
+
+bool read_result_cache_t::make_key(const rget_read_t &rget, std::string *key_out) {
+    // Without a terminal the response is one batch of a stream, and where the batch
+    // ends depends on the time it took to read it.
+    if (rget.stamp.has_value()
+        || !rget.terminal.has_value()
+        || !boost::apply_visitor(deterministic_visitor_t(), *rget.terminal)) {
+        return false;
+    }
+    for (const auto &transform : rget.transforms) {
+        if (!boost::apply_visitor(deterministic_visitor_t(), transform)) {
+            return false;
+        }
+    }
+
+    // This is all of `rget_read_t` except for the `batchspec`, which terminals don't
+    // look at and which has a time of its own.
+    write_message_t wm;
+    serialize<cluster_version_t::CLUSTER>(&wm, rget.region);
+    serialize<cluster_version_t::CLUSTER>(&wm, rget.current_shard);
+    serialize<cluster_version_t::CLUSTER>(&wm, rget.hints);
+    serialize<cluster_version_t::CLUSTER>(&wm, rget.primary_keys);
+    serialize<cluster_version_t::CLUSTER>(&wm, rget.serializable_env);
+    serialize<cluster_version_t::CLUSTER>(&wm, rget.table_name);
+    serialize<cluster_version_t::CLUSTER>(&wm, rget.transforms);
+    serialize<cluster_version_t::CLUSTER>(&wm, rget.terminal);
+    serialize<cluster_version_t::CLUSTER>(&wm, rget.sindex);
+    serialize<cluster_version_t::CLUSTER>(&wm, static_cast<int8_t>(rget.sorting));
+    string_stream_t stream;
+    int res = send_write_message(&stream, &wm);
+    guarantee(res == 0);
+    *key_out = std::move(stream.str());
+    return true;
+}
+
+const rget_read_response_t *read_result_cache_t::find(const std::string &key) {
+    assert_thread();
+    entry_t *entry;
+    if (!entries.lookup(key, &entry)) {
+        return nullptr;
+    }
+    return &entry->response;
+}
+
+void read_result_cache_t::insert(std::string &&key,
+                                 const rget_read_t &rget,
+                                 uint64_t generation,
+                                 const rget_read_response_t &response) {
+    assert_thread();
+    if (generation != generation_
+        || num_suspensions > 0
+        || boost::get<ql::exc_t>(&response.result) != nullptr) {
+        return;
+    }
+    write_message_t wm;
+    serialize<cluster_version_t::CLUSTER>(&wm, response);
+    if (wm.size() > READ_RESULT_CACHE_MAX_RESULT_SIZE) {
+        return;
+    }
+    entry_t entry;
+    entry.range = rget.sindex.has_value() ? key_range_t::universe() : rget.region.inner;
+    entry.response = response;
+    entries.insert(std::move(key), std::move(entry));
+}
+
+void read_result_cache_t::invalidate(const write_t &write) {
+    assert_thread();
+    if (entries.size() == 0) {
+        // Nothing to drop, but a read in progress may be about to insert something.
+        ++generation_;
+        return;
+    }
+    optional<key_range_t> range =
+        boost::apply_visitor(written_range_visitor_t(), write.write);
+    if (range.has_value()) {
+        invalidate(*range);
+    }
+}
+
+void read_result_cache_t::invalidate(const key_range_t &range) {
+    assert_thread();
+    ++generation_;
+    entries.erase_if([&](const std::string &, const entry_t &entry) {
+        return entry.range.overlaps(range);
+    });
+}
+
+void read_result_cache_t::invalidate_all() {
+    assert_thread();
+    ++generation_;
+    entries.clear();
+}
+
+read_result_cache_t::suspension_t::suspension_t(read_result_cache_t *_parent)
+    : parent(_parent) {
+    parent->invalidate_all();
+    ++parent->num_suspensions;
+}
+
+read_result_cache_t::suspension_t::~suspension_t() {
+    guarantee(parent->num_suspensions > 0);
+    --parent->num_suspensions;
+    // A read that started before we went away may still have seen a change we made.
+    ++parent->generation_;
+}
@@ -0,0 +1,74 @@
+// Copyright 2010-2015 RethinkDB, all rights reserved.
+#ifndef RDB_PROTOCOL_READ_RESULT_CACHE_HPP_
+#define RDB_PROTOCOL_READ_RESULT_CACHE_HPP_
+
+#include <string>
+
+#include "btree/keys.hpp"
+#include "containers/lru_cache.hpp"
+#include "rdb_protocol/protocol.hpp"
+#include "threading.hpp"
+
+/* `read_result_cache_t` remembers the responses of one store to recent reads that end
+in a terminal, like `count()` or `sum()`, so that asking the same question again
+doesn't have to traverse the btree. Only the reads of queries that ask for it with the
+`result_cache` optarg and whose functions are deterministic get cached; see
+`make_key()`.
+
+An entry is valid until a write touches the range of primary keys it read. (Reads of a
+secondary index read all of the store as far as this is concerned, since we don't know
+which index keys a write changes before it is applied.) Writes drop the entries they
+touch as soon as they acquire the superblock, and each time they do `generation()`
+changes. A read samples the generation when it acquires the superblock and passes it
+to `insert()`: if it has changed since, a write that comes after the read may already
+have dropped what the read is about to insert, so the read's result isn't cached. */
+class read_result_cache_t : public home_thread_mixin_debug_only_t {
+public:
+    read_result_cache_t();
+
+    // Computes the key under which the response to `rget` is cached and returns true,
+    // or returns false if the response can't be cached.
+    static bool make_key(const rget_read_t &rget, std::string *key_out);
+
+    uint64_t generation() const { return generation_; }
+
+    // Returns the cached response for `key`, or null.
+    const rget_read_response_t *find(const std::string &key);
+
+    // Caches `response` for `rget`, unless the cache changed since `generation`.
+    void insert(std::string &&key,
+                const rget_read_t &rget,
+                uint64_t generation,
+                const rget_read_response_t &response);
+
+    // Drops the entries that `write` may change.
+    void invalidate(const write_t &write);
+    void invalidate(const key_range_t &range);
+    void invalidate_all();
+
+    // Keeps results from being cached for as long as it exists, for changes to the
+    // store that don't go through `store_t::write()`, like backfills.
+    class suspension_t {
+    public:
+        explicit suspension_t(read_result_cache_t *parent);
+        ~suspension_t();
+    private:
+        read_result_cache_t *const parent;
+        DISABLE_COPYING(suspension_t);
+    };
+
+private:
+    struct entry_t {
+        // The primary keys that the read depended on.
+        key_range_t range;
+        rget_read_response_t response;
+    };
+
+    lru_cache_t<std::string, entry_t> entries;
+    uint64_t generation_;
+    size_t num_suspensions;
+
+    DISABLE_COPYING(read_result_cache_t);
+};
+
+#endif  // RDB_PROTOCOL_READ_RESULT_CACHE_HPP_
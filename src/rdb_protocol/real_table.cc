@@ -330,6 +330,119 @@ ql::datum_t real_table_t::write_batched_insert(
     return std::move(result).to_datum();
 }
 
+/* How many rows each shard deletes at most in one `range_delete_t`. This keeps the
+writes about as large as the batches of `write_batched_replace()` for each shard, but
+they don't have to carry the keys. */
+const uint64_t range_delete_max_rows = 1000;
+
+/* Reads the largest primary key in `region`. Returns `false` if `region` has no
+rows. */
+static bool read_range_delete_last_key(real_table_t *table,
+                                       ql::env_t *env,
+                                       const region_t &region,
+                                       store_key_t *last_key_out) {
+    /* Every shard sends its largest key first, so one row from each of them is
+    enough. */
+    read_t last_read(
+        rget_read_t(
+            optional<changefeed_stamp_t>(),
+            region,
+            r_nullopt,
+            r_nullopt,
+            env->get_serializable_env(),
+            "",
+            ql::batchspec_t::all().with_at_most(1),
+            std::vector<ql::transform_variant_t>(),
+            optional<ql::terminal_variant_t>(),
+            optional<sindex_rangespec_t>(),
+            sorting_t::DESCENDING),
+        env->profile(),
+        read_mode_t::SINGLE);
+    read_response_t last_res;
+    table->read_with_profile(env, last_read, &last_res);
+    auto last_resp = boost::get<rget_read_response_t>(&last_res.response);
+    r_sanity_check(last_resp != NULL);
+    if (auto exc = boost::get<ql::exc_t>(&last_resp->result)) {
+        throw *exc;
+    }
+    auto streams = boost::get<ql::grouped_t<ql::stream_t> >(&last_resp->result);
+    r_sanity_check(streams != NULL);
+    bool found = false;
+    for (const auto &pair : *streams) {
+        for (const auto &substream : pair.second.substreams) {
+            for (const ql::rget_item_t &item : substream.second.stream) {
+                if (!found || *last_key_out < item.key) {
+                    *last_key_out = item.key;
+                    found = true;
+                }
+            }
+        }
+    }
+    return found;
+}
+
+ql::datum_t real_table_t::write_range_delete(
+    ql::env_t *env,
+    const ql::datum_range_t &range,
+    durability_requirement_t durability,
+    ignore_write_hook_t ignore_write_hook) {
+
+    /* The write hook has to see every row that gets deleted, and could change what
+    happens to it. */
+    if (get_write_hook(env, ignore_write_hook).has_value()) {
+        return ql::datum_t();
+    }
+
+    region_t region(range.to_primary_keyrange());
+    ql::datum_t stats((std::map<datum_string_t, ql::datum_t>()));
+    std::set<std::string> conditions;
+
+    /* Only go up to the last key that was there when we started, so that rows
+    inserted behind it while we delete can't keep us going forever. */
+    store_key_t last_key;
+    if (!read_range_delete_last_key(this, env, region, &last_key)) {
+        return stats;
+    }
+    region.inner.right = key_range_t::right_bound_t(last_key);
+    region.inner.right.increment();
+
+    bool write_succeeded = false;
+    for (;;) {
+        ql::datum_t deleted;
+        try {
+            range_delete_t write(region, pkey, range_delete_max_rows);
+            write_t w(std::move(write), durability, env->profile(), env->limits());
+            write_response_t response;
+            write_with_profile(env, &w, &response);
+            auto dp = boost::get<ql::datum_t>(&response.response);
+            r_sanity_check(dp != NULL);
+            stats = stats.merge(*dp, ql::stats_merge, env->limits(), &conditions);
+            deleted = dp->get_field("deleted", ql::NOTHROW);
+        } catch (const ql::datum_exc_t &e) {
+            throw write_succeeded
+                ? ql::datum_exc_t(ql::base_exc_t::OP_INDETERMINATE, e.what())
+                : e;
+        } catch (const ql::exc_t &e) {
+            throw write_succeeded
+                ? ql::exc_t(ql::base_exc_t::OP_INDETERMINATE,
+                            e.what(),
+                            e.backtrace(),
+                            e.dummy_frames())
+                : e;
+        }
+        write_succeeded = true;
+        /* Each shard deletes its rows from the left, so once a write deletes nothing
+        the range is empty. Counting the rows instead doesn't work, because
+        concurrent writes can delete some of them for us. */
+        if (!deleted.has() || deleted.as_num() == 0) {
+            break;
+        }
+    }
+    ql::datum_object_builder_t result(stats);
+    result.add_warnings(conditions, env->limits());
+    return std::move(result).to_datum();
+}
+
 bool real_table_t::write_sync_depending_on_durability(ql::env_t *env,
         durability_requirement_t durability) {
     write_t write(sync_t(), durability, env->profile(), env->limits());
@@ -371,6 +484,51 @@ void real_table_t::read_with_profile(ql::env_t *env, const read_t &read,
     splitter.give_splits(response->n_shards, response->event_log);
 }
 
+std::vector<std::pair<key_range_t, int64_t> > real_table_t::estimate_shard_doc_counts(
+        ql::env_t *env, const key_range_t &range) {
+    std::vector<std::pair<key_range_t, int64_t> > shards;
+    try {
+        for (const region_t &region : namespace_access.get()->get_sharding_scheme()) {
+            shards.push_back(std::make_pair(region.inner, 0));
+        }
+    } catch (const cannot_perform_query_exc_t &e) {
+        rfail_datum(ql::base_exc_t::OP_FAILED, "Cannot explain read: %s", e.what());
+    }
+
+    // The same depth and limit as `fetch_distribution()`.
+    read_t read(distribution_read_t(2, 128), env->profile(), read_mode_t::OUTDATED);
+    read_response_t res;
+    read_with_profile(env, read, &res);
+    distribution_read_response_t *dist_res =
+        boost::get<distribution_read_response_t>(&res.response);
+    r_sanity_check(dist_res != nullptr);
+
+    /* Every entry of `key_counts` is the number of keys from its key up to the next
+    entry's key. We split the count evenly between the shards it overlaps, and only
+    count it if it overlaps `range` at all, so the estimates err on the high side. */
+    for (auto it = dist_res->key_counts.begin();
+         it != dist_res->key_counts.end();
+         ++it) {
+        auto jt = it;
+        ++jt;
+        const key_range_t bucket = jt == dist_res->key_counts.end()
+            ? key_range_t(key_range_t::closed, it->first,
+                          key_range_t::none, store_key_t())
+            : key_range_t(key_range_t::closed, it->first,
+                          key_range_t::open, jt->first);
+        std::vector<size_t> overlapping;
+        for (size_t i = 0; i < shards.size(); ++i) {
+            if (region_overlaps(bucket, region_intersection(shards[i].first, range))) {
+                overlapping.push_back(i);
+            }
+        }
+        for (size_t i : overlapping) {
+            shards[i].second += it->second / static_cast<int64_t>(overlapping.size());
+        }
+    }
+    return shards;
+}
+
 void real_table_t::write_with_profile(ql::env_t *env, write_t *write,
         write_response_t *response) {
     PROFILE_STARTER_IF_ENABLED(
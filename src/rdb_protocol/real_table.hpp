@@ -5,6 +5,7 @@
 #include <map>
 #include <set>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "rdb_protocol/configured_limits.hpp"
@@ -93,6 +94,11 @@ public:
         return_changes_t return_changes,
         durability_requirement_t durability,
         ignore_write_hook_t ignore_write_hook);
+    ql::datum_t write_range_delete(
+        ql::env_t *env,
+        const ql::datum_range_t &range,
+        durability_requirement_t durability,
+        ignore_write_hook_t ignore_write_hook);
     bool write_sync_depending_on_durability(ql::env_t *env,
         durability_requirement_t durability);
 
@@ -118,6 +124,12 @@ public:
     void read_with_profile(ql::env_t *env, const read_t &, read_response_t *response);
     void write_with_profile(ql::env_t *env, write_t *, write_response_t *response);
 
+    /* `explain` uses this to find out which shards a read would go to without running
+    it. It returns the key range of every shard of the table, together with an estimate
+    of how many of its documents fall within `range`, from a distribution query. */
+    std::vector<std::pair<key_range_t, int64_t> > estimate_shard_doc_counts(
+        ql::env_t *env, const key_range_t &range);
+
 private:
     optional<counted_t<const ql::func_t> > get_write_hook(
         ql::env_t *env,
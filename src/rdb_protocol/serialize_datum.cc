@@ -304,7 +304,8 @@ serialization_result_t datum_array_serialize(
         && check_errors == check_datum_serialization_errors_t::NO) {
 
         // Subtract 1 for the type byte, which we don't have to rewrite
-        wm->append(existing_buf_ref->get(), precomputed_sizes.size - 1);
+        wm->append_shared(existing_buf_ref->get_buf().get(), existing_buf_ref->get(),
+                          precomputed_sizes.size - 1);
         return serialization_result_t::SUCCESS;
     }
 
@@ -400,6 +401,7 @@ size_t datum_object_serialized_size(const datum_t &datum,
 // Keep in sync with datum_get_element_offset.
 // Keep in sync with datum_get_array_size.
 // Keep in sync with datum_deserialize_pair_from_buf.
+// Keep in sync with datum_find_field_in_buf.
 serialization_result_t datum_object_serialize(
         write_message_t *wm,
         const datum_t &datum,
@@ -412,7 +414,8 @@ serialization_result_t datum_object_serialize(
         && check_errors == check_datum_serialization_errors_t::NO) {
 
         // Subtract 1 for the type byte, which we don't have to rewrite
-        wm->append(existing_buf_ref->get(), precomputed_sizes.size - 1);
+        wm->append_shared(existing_buf_ref->get_buf().get(), existing_buf_ref->get(),
+                          precomputed_sizes.size - 1);
         return serialization_result_t::SUCCESS;
     }
 
@@ -750,6 +753,16 @@ archive_result_t datum_deserialize(read_stream_t *s, datum_t *datum) {
     case datum_serialized_type_t::BUF_R_ARRAY: // fallthru
     case datum_serialized_type_t::BUF_R_OBJECT:
     {
+        datum_t::type_t dtype = type == datum_serialized_type_t::BUF_R_ARRAY
+                                ? datum_t::R_ARRAY
+                                : datum_t::R_OBJECT;
+
+        // If the stream reads from a shared buffer, e.g. a cluster message, the datum
+        // can point into that instead of a copy.
+        shared_buf_read_stream_t *buf_stream =
+            dynamic_cast<shared_buf_read_stream_t *>(s);
+        const int64_t start = buf_stream != nullptr ? buf_stream->tell() : 0;
+
         // First read the serialized size of the buffer
         uint64_t ser_size;
         res = deserialize_varint_uint64(s, &ser_size);
@@ -763,7 +776,19 @@ archive_result_t datum_deserialize(read_stream_t *s, datum_t *datum) {
             return archive_result_t::RANGE_ERROR;
         }
 
-        // Then read the data into a shared_buf_t
+        if (buf_stream != nullptr) {
+            if (static_cast<uint64_t>(buf_stream->skip(ser_size)) < ser_size) {
+                return archive_result_t::SOCK_EOF;
+            }
+            try {
+                *datum = datum_t(dtype, buf_stream->ref_at(start));
+            } catch (const base_exc_t &) {
+                return archive_result_t::RANGE_ERROR;
+            }
+            break;
+        }
+
+        // Otherwise read the data into a shared_buf_t
         counted_t<shared_buf_t> buf = shared_buf_t::create(static_cast<size_t>(ser_size) + ser_size_sz);
         serialize_varint_uint64_into_buf(ser_size, reinterpret_cast<uint8_t *>(buf->data()));
         int64_t num_read = force_read(s, buf->data() + ser_size_sz, ser_size);
@@ -775,9 +800,6 @@ archive_result_t datum_deserialize(read_stream_t *s, datum_t *datum) {
         }
 
         // ...from which we create the datum_t
-        datum_t::type_t dtype = type == datum_serialized_type_t::BUF_R_ARRAY
-                                ? datum_t::R_ARRAY
-                                : datum_t::R_OBJECT;
         try {
             *datum = datum_t(dtype, shared_buf_ref_t<char>(std::move(buf), 0));
         } catch (const base_exc_t &) {
@@ -887,22 +909,35 @@ size_t datum_get_array_size(const shared_buf_ref_t<char> &array) {
      varint num_elements
      uint*_t offsets[num_elements - 1] // counted from `data`, first element omitted
      T data[num_elements] */
-size_t datum_get_element_offset(const shared_buf_ref_t<char> &array, size_t index) {
+struct datum_array_layout_t {
+    size_t num_elements;
+    datum_offset_size_t offset_size;
+    size_t serialized_offset_size;
+    // Where `offsets` and `data` start in the buffer.
+    size_t offsets_offset;
+    size_t data_offset;
+};
+
+static datum_array_layout_t datum_get_array_layout(const shared_buf_ref_t<char> &array) {
     buffer_read_stream_t sz_read_stream(array.get(), array.get_safety_boundary());
     uint64_t ser_size = 0;
     guarantee_deserialization(deserialize_varint_uint64(&sz_read_stream, &ser_size),
                               "datum decode array");
-    const datum_offset_size_t offset_size = get_offset_size_from_inner_size(ser_size);
-    size_t serialized_offset_size;
-    switch (offset_size) {
+    datum_array_layout_t layout;
+    layout.offset_size = get_offset_size_from_inner_size(ser_size);
+    switch (layout.offset_size) {
     case datum_offset_size_t::U8BIT:
-        serialized_offset_size = serialize_universal_size_t<uint8_t>::value; break;
+        layout.serialized_offset_size = serialize_universal_size_t<uint8_t>::value;
+        break;
     case datum_offset_size_t::U16BIT:
-        serialized_offset_size = serialize_universal_size_t<uint16_t>::value; break;
+        layout.serialized_offset_size = serialize_universal_size_t<uint16_t>::value;
+        break;
     case datum_offset_size_t::U32BIT:
-        serialized_offset_size = serialize_universal_size_t<uint32_t>::value; break;
+        layout.serialized_offset_size = serialize_universal_size_t<uint32_t>::value;
+        break;
     case datum_offset_size_t::U64BIT:
-        serialized_offset_size = serialize_universal_size_t<uint64_t>::value; break;
+        layout.serialized_offset_size = serialize_universal_size_t<uint64_t>::value;
+        break;
     default:
         unreachable();
     }
@@ -911,21 +946,26 @@ size_t datum_get_element_offset(const shared_buf_ref_t<char> &array, size_t inde
     guarantee_deserialization(deserialize_varint_uint64(&sz_read_stream, &num_elements),
                               "datum decode array");
     guarantee(num_elements <= std::numeric_limits<size_t>::max());
-    const size_t sz = static_cast<size_t>(num_elements);
-
-    guarantee(index < sz);
+    layout.num_elements = static_cast<size_t>(num_elements);
+
+    layout.offsets_offset = static_cast<size_t>(sz_read_stream.tell());
+    layout.data_offset = layout.num_elements == 0
+        ? layout.offsets_offset
+        : layout.offsets_offset
+          + (layout.num_elements - 1) * layout.serialized_offset_size;
+    return layout;
+}
 
-    rassert(sz > 0);
-    const size_t data_offset =
-        static_cast<size_t>(sz_read_stream.tell())
-        + (num_elements - 1) * serialized_offset_size;
+static size_t datum_get_element_offset(const shared_buf_ref_t<char> &array,
+                                       const datum_array_layout_t &layout,
+                                       size_t index) {
+    guarantee(index < layout.num_elements);
 
     if (index == 0) {
-        return data_offset;
+        return layout.data_offset;
     } else {
         const size_t element_offset_offset =
-            static_cast<size_t>(sz_read_stream.tell())
-            + (index - 1) * serialized_offset_size;
+            layout.offsets_offset + (index - 1) * layout.serialized_offset_size;
 
         array.guarantee_in_boundary(element_offset_offset);
         buffer_read_stream_t read_stream(
@@ -933,7 +973,7 @@ size_t datum_get_element_offset(const shared_buf_ref_t<char> &array, size_t inde
             array.get_safety_boundary() - element_offset_offset);
 
         uint64_t element_offset;
-        switch (offset_size) {
+        switch (layout.offset_size) {
         case datum_offset_size_t::U8BIT: {
             uint8_t off;
             guarantee_deserialization(deserialize_universal(&read_stream, &off),
@@ -958,12 +998,63 @@ size_t datum_get_element_offset(const shared_buf_ref_t<char> &array, size_t inde
                                       "datum decode array offset");
             element_offset = off;
         } break;
+        default:
+            unreachable();
         }
         guarantee(element_offset <= std::numeric_limits<size_t>::max(),
                   "Datum too large for this architecture.");
 
-        return data_offset + static_cast<size_t>(element_offset);
+        return layout.data_offset + static_cast<size_t>(element_offset);
+    }
+}
+
+size_t datum_get_element_offset(const shared_buf_ref_t<char> &array, size_t index) {
+    return datum_get_element_offset(array, datum_get_array_layout(array), index);
+}
+
+// Compares `key` to the serialized datum_string_t at `at_offset` in `buf`, the same
+// way that `datum_string_t::compare()` would.
+static int datum_compare_to_string_in_buf(const datum_string_t &key,
+                                          const shared_buf_ref_t<char> &buf,
+                                          size_t at_offset) {
+    buf.guarantee_in_boundary(at_offset);
+    buffer_read_stream_t read_stream(buf.get() + at_offset,
+                                     buf.get_safety_boundary() - at_offset);
+    uint64_t other_size;
+    guarantee_deserialization(deserialize_varint_uint64(&read_stream, &other_size),
+                              "datum_string_t size");
+    const size_t data_offset = at_offset + static_cast<size_t>(read_stream.tell());
+    guarantee(other_size <= buf.get_safety_boundary() - data_offset);
+    const size_t common_size = std::min<size_t>(key.size(), other_size);
+    const int content_compare = memcmp(key.data(), buf.get() + data_offset, common_size);
+    if (content_compare != 0) {
+        return content_compare;
+    }
+    return key.size() < other_size ? -1 : key.size() > other_size ? 1 : 0;
+}
+
+bool datum_find_field_in_buf(const shared_buf_ref_t<char> &object,
+                             const datum_string_t &key,
+                             size_t *value_offset_out) {
+    // The offset table lets us binary search the pairs, which are sorted by key.  We
+    // only look at the keys, until we've found the one we're looking for.
+    const datum_array_layout_t layout = datum_get_array_layout(object);
+    size_t range_beg = 0;
+    size_t range_end = layout.num_elements;
+    while (range_beg < range_end) {
+        const size_t center = range_beg + ((range_end - range_beg) / 2);
+        const size_t pair_offset = datum_get_element_offset(object, layout, center);
+        const int cmp_res = datum_compare_to_string_in_buf(key, object, pair_offset);
+        if (cmp_res == 0) {
+            *value_offset_out = pair_offset + datum_serialized_size(key);
+            return true;
+        } else if (cmp_res < 0) {
+            range_end = center;
+        } else {
+            range_beg = center + 1;
+        }
     }
+    return false;
 }
 
 size_t datum_serialized_size(const datum_string_t &s) {
@@ -1,6 +1,8 @@
 // Copyright 2010-2014 RethinkDB, all rights reserved.
 #include "rdb_protocol/shards.hpp"
 
+#include <algorithm>
+#include <iterator>
 #include <utility>
 
 #include "errors.hpp"
@@ -8,6 +10,7 @@
 
 #include "debug.hpp"
 #include "rdb_protocol/func.hpp"
+#include "rdb_protocol/order_util.hpp"
 #include "rdb_protocol/profile.hpp"
 #include "rdb_protocol/protocol.hpp"
 
@@ -108,19 +111,58 @@ private:
 
     virtual void unshard(env_t *env, const std::vector<result_t *> &results) {
         guarantee(acc.size() == 0);
-        std::map<datum_t, std::vector<T *>, optional_datum_less_t> vecs;
         r_sanity_check(results.size() != 0);
-        for (auto res = results.begin(); res != results.end(); ++res) {
-            guarantee(*res);
-            grouped_t<T> *gres = boost::get<grouped_t<T> >(*res);
+        typedef typename std::map<datum_t, T, optional_datum_less_t>::iterator
+            iterator_t;
+        struct cursor_t {
+            size_t result_index;
+            iterator_t it;
+            iterator_t end;
+        };
+        // Each result is already sorted by group, so we merge them with a heap of
+        // cursors instead of sorting every group into a map again.  The heap keeps
+        // the cursor with the smallest group at the front.
+        std::vector<cursor_t> cursors;
+        for (size_t i = 0; i < results.size(); ++i) {
+            guarantee(results[i]);
+            grouped_t<T> *gres = boost::get<grouped_t<T> >(results[i]);
             guarantee(gres);
-            for (auto kv = gres->begin(); kv != gres->end(); ++kv) {
-                vecs[kv->first].push_back(&kv->second);
+            if (gres->begin() != gres->end()) {
+                cursors.push_back(cursor_t{i, gres->begin(), gres->end()});
             }
         }
-        for (auto kv = vecs.begin(); kv != vecs.end(); ++kv) {
-            auto t_it = acc.insert(std::make_pair(kv->first, default_val)).first;
-            unshard_impl(env, &t_it->second, kv->second);
+        const optional_datum_less_t less;
+        auto cursor_greater = [&less](const cursor_t &a, const cursor_t &b) {
+            return less(b.it->first, a.it->first);
+        };
+        std::make_heap(cursors.begin(), cursors.end(), cursor_greater);
+
+        std::map<datum_t, T, optional_datum_less_t> *out = acc.get_underlying_map();
+        std::vector<std::pair<size_t, T *> > group_results;
+        std::vector<T *> ts;
+        while (!cursors.empty()) {
+            const datum_t group = cursors.front().it->first;
+            group_results.clear();
+            do {
+                std::pop_heap(cursors.begin(), cursors.end(), cursor_greater);
+                cursor_t *cursor = &cursors.back();
+                group_results.push_back(
+                    std::make_pair(cursor->result_index, &cursor->it->second));
+                if (++cursor->it == cursor->end) {
+                    cursors.pop_back();
+                } else {
+                    std::push_heap(cursors.begin(), cursors.end(), cursor_greater);
+                }
+            } while (!cursors.empty() && !less(group, cursors.front().it->first));
+            // Keep the results of each group in the order they were passed in.
+            std::sort(group_results.begin(), group_results.end());
+            ts.clear();
+            for (const auto &pair : group_results) {
+                ts.push_back(pair.second);
+            }
+            // The groups come out in order, so they always go at the end.
+            auto t_it = out->insert(out->end(), std::make_pair(group, default_val));
+            unshard_impl(env, &t_it->second, ts);
         }
     }
     virtual void unshard_impl(env_t *env, T *acc, const std::vector<T *> &ts) = 0;
@@ -213,8 +255,10 @@ protected:
         r_sanity_check(streams.size() > 0);
         for (auto &&stream : streams) {
             r_sanity_check(stream->substreams.size() > 0);
+            // The shard responses are cannibalized, so we take their batches
+            // rather than copying every `rget_item_t`.
             for (auto &&pair : stream->substreams) {
-                bool inserted = out->substreams.insert(pair).second;
+                bool inserted = out->substreams.insert(std::move(pair)).second;
                 guarantee(inserted);
             }
         }
@@ -517,9 +561,7 @@ private:
             auto pair = _acc->insert(std::make_pair(it->first, *_default_val));
             auto t_it = pair.first;
             bool keep = !pair.second;
-            for (auto el = it->second.begin(); el != it->second.end(); ++el) {
-                keep |= accumulate(env, *el, &t_it->second);
-            }
+            keep |= accumulate_all(env, it->second, &t_it->second);
             if (!keep) {
                 _acc->erase(t_it);
             }
@@ -586,6 +628,18 @@ private:
     virtual bool accumulate(env_t *env,
                             const datum_t &el,
                             T *t) = 0;
+    // Accumulates the elements of one group of a batch, and returns true if any of
+    // them counted.  Terminals that can do better than going through the elements
+    // one at a time override this.
+    virtual bool accumulate_all(env_t *env,
+                                const datums_t &els,
+                                T *t) {
+        bool keep = false;
+        for (auto el = els.begin(); el != els.end(); ++el) {
+            keep |= accumulate(env, *el, t);
+        }
+        return keep;
+    }
 
     virtual void unshard_impl(
         env_t *env, T *out, const std::vector<T *> &ts) {
@@ -637,8 +691,18 @@ protected:
     virtual bool accumulate(env_t *env,
                             const datum_t &el,
                             T *out) {
+        return skip_non_existence([&]() { maybe_acc(env, el, out, f); });
+    }
+    // Puts the value of the function for `el` into `val_out`, or returns false if the
+    // element should be skipped.
+    bool map_el(env_t *env, const datum_t &el, datum_t *val_out) {
+        return skip_non_existence([&]() { *val_out = f(env, el); });
+    }
+private:
+    template<class callable_t>
+    bool skip_non_existence(const callable_t &fn) {
         try {
-            maybe_acc(env, el, out, f);
+            fn();
             return true;
         } catch (const datum_exc_t &e) {
             if (e.get_type() != base_exc_t::NON_EXISTENCE) {
@@ -651,7 +715,7 @@ protected:
         }
         return false;
     }
-private:
+
     virtual void maybe_acc(env_t *env,
                            const datum_t &el,
                            T *out,
@@ -747,14 +811,24 @@ bool datum_gt(const datum_t &val1, const datum_t &val2) {
     return val1 > val2;
 }
 
+bool num_lt(double num1, double num2) {
+    return num1 < num2;
+}
+
+bool num_gt(double num1, double num2) {
+    return num1 > num2;
+}
+
 class optimizing_terminal_t : public skip_terminal_t<optimizer_t> {
 public:
     optimizing_terminal_t(const skip_wire_func_t &_f,
                           const char *_name,
-                          bool (*_cmp)(const datum_t &val1, const datum_t &val2))
+                          bool (*_cmp)(const datum_t &val1, const datum_t &val2),
+                          bool (*_num_cmp)(double num1, double num2))
         : skip_terminal_t<optimizer_t>(_f, optimizer_t()),
           name(_name),
-          cmp(_cmp) { }
+          cmp(_cmp),
+          num_cmp(_num_cmp) { }
 private:
     virtual void maybe_acc(env_t *env,
                            const datum_t &el,
@@ -763,6 +837,34 @@ private:
         optimizer_t other(el, _f(env, el));
         out->swap_if_other_better(&other, cmp);
     }
+    virtual bool accumulate_all(env_t *env, const datums_t &els, optimizer_t *out) {
+        // Finds the best element of the batch first, comparing numbers directly
+        // instead of as datums.  Like `swap_if_other_better`, a later element only
+        // wins if it is strictly better, so the result is the same.
+        optimizer_t best;
+        for (const datum_t &el : els) {
+            datum_t val;
+            if (!map_el(env, el, &val)) {
+                continue;
+            }
+            if (best.val.has()
+                && val.get_type() == datum_t::R_NUM
+                && best.val.get_type() == datum_t::R_NUM) {
+                if (num_cmp(val.as_num(), best.val.as_num())) {
+                    best.row = el;
+                    best.val = std::move(val);
+                }
+            } else {
+                optimizer_t other(el, std::move(val));
+                best.swap_if_other_better(&other, cmp);
+            }
+        }
+        if (!best.val.has()) {
+            return false;
+        }
+        out->swap_if_other_better(&best, cmp);
+        return true;
+    }
     virtual datum_t unpack(optimizer_t *el) {
         return el->unpack(name);
     }
@@ -771,6 +873,7 @@ private:
     }
     const char *name;
     bool (*cmp)(const datum_t &val1, const datum_t &val2);
+    bool (*num_cmp)(double num1, double num2);
 };
 
 const char *const empty_stream_msg =
@@ -805,6 +908,41 @@ private:
     counted_t<const func_t> f;
 };
 
+class top_k_terminal_t : public terminal_t<datums_t> {
+public:
+    explicit top_k_terminal_t(const top_k_wire_func_t &f)
+        : terminal_t<datums_t>(datums_t()),
+          lt_cmp(f.compile_comparisons()),
+          n(f.n) { }
+private:
+    virtual bool accumulate(env_t *env,
+                            const datum_t &el,
+                            datums_t *out) {
+        out->push_back(el);
+        maybe_compact(env, out);
+        return true;
+    }
+    virtual datum_t unpack(datums_t *ds) {
+        return datum_t(std::move(*ds), datum_t::no_array_size_limit_check_t());
+    }
+    virtual void unshard_impl(env_t *env, datums_t *out, datums_t *el) {
+        std::move(el->begin(), el->end(), std::back_inserter(*out));
+        maybe_compact(env, out);
+    }
+    // Cutting the elements down to `n` once there are `2n` of them keeps the total
+    // cost at O(N log n) comparisons.  The ones we keep come first in `lt_cmp`'s
+    // stable order, and sorting the result again keeps it stable because they're
+    // still in front of everything that gets added later.
+    void maybe_compact(env_t *env, datums_t *ds) {
+        if (ds->size() / 2 >= n) {
+            lt_cmp.sort_prefix(env, nullptr, ds, n);
+        }
+    }
+
+    lt_cmp_t lt_cmp;
+    uint64_t n;
+};
+
 template<class T>
 class terminal_visitor_t : public boost::static_visitor<T *> {
 public:
@@ -818,14 +956,17 @@ public:
         return new avg_terminal_t(f);
     }
     T *operator()(const min_wire_func_t &f) const {
-        return new optimizing_terminal_t(f, "min", datum_lt);
+        return new optimizing_terminal_t(f, "min", datum_lt, num_lt);
     }
     T *operator()(const max_wire_func_t &f) const {
-        return new optimizing_terminal_t(f, "max", datum_gt);
+        return new optimizing_terminal_t(f, "max", datum_gt, num_gt);
     }
     T *operator()(const reduce_wire_func_t &f) const {
         return new reduce_terminal_t(f);
     }
+    T *operator()(const top_k_wire_func_t &f) const {
+        return new top_k_terminal_t(f);
+    }
     T *operator()(const limit_read_t &lr) const {
         return new limit_append_t(
             lr.is_primary,
@@ -987,9 +1128,7 @@ private:
     virtual void lst_transform(
         env_t *env, datums_t *lst, const std::function<datum_t()> &) {
         try {
-            for (auto it = lst->begin(); it != lst->end(); ++it) {
-                *it = f->call(env, *it)->as_datum();
-            }
+            f->call_each(env, lst);
         } catch (const datum_exc_t &e) {
             throw exc_t(e, f->backtrace(), 1);
         }
@@ -1036,6 +1175,12 @@ public:
           default_val(_f.default_filter_val.has_value()
                       ? _f.default_filter_val->compile_wire_func()
                       : counted_t<const func_t>()) { }
+
+    bool try_filter_without_env(const datum_t &row, bool *keep_out) const final {
+        // The default value only matters when the function throws, and in that case
+        // `try_filter_without_env` gives up.
+        return f->try_filter_without_env(row, keep_out);
+    }
 private:
     virtual void lst_transform(
         env_t *env, datums_t *lst, const std::function<datum_t()> &) {
@@ -1128,6 +1273,20 @@ scoped_ptr_t<op_t> make_op(const transform_variant_t &tv) {
     return scoped_ptr_t<op_t>(boost::apply_visitor(transform_visitor_t(), tv));
 }
 
+class transform_name_visitor_t : public boost::static_visitor<const char *> {
+public:
+    const char *operator()(const map_wire_func_t &) const { return "map"; }
+    const char *operator()(const group_wire_func_t &) const { return "group"; }
+    const char *operator()(const filter_wire_func_t &) const { return "filter"; }
+    const char *operator()(const concatmap_wire_func_t &) const { return "concat_map"; }
+    const char *operator()(const distinct_wire_func_t &) const { return "distinct"; }
+    const char *operator()(const zip_wire_func_t &) const { return "zip"; }
+};
+
+const char *transform_name(const transform_variant_t &tv) {
+    return boost::apply_visitor(transform_name_visitor_t(), tv);
+}
+
 RDB_IMPL_SERIALIZABLE_3_FOR_CLUSTER(rget_item_t, key, sindex_key, data);
 RDB_IMPL_SERIALIZABLE_2_FOR_CLUSTER(keyed_stream_t, stream, last_key);
 RDB_IMPL_SERIALIZABLE_1_FOR_CLUSTER(stream_t, substreams);
@@ -66,15 +66,11 @@ RDB_DECLARE_SERIALIZABLE(rget_item_t);
 class sindex_compare_t {
 public:
     explicit sindex_compare_t(sorting_t _sorting)
-        : sorting(_sorting), iterations_since_last_yield(0) { }
+        : sorting(_sorting) { }
     bool operator()(const rget_item_t &l, const rget_item_t &r) {
         r_sanity_check(l.sindex_key.has() && r.sindex_key.has());
 
-        ++iterations_since_last_yield;
-        const size_t YIELD_INTERVAL = 10000;
-        if (iterations_since_last_yield % YIELD_INTERVAL == 0) {
-            coro_t::yield();
-        }
+        coro_t::maybe_yield();
 
         int cmp = l.sindex_key.cmp(r.sindex_key);
         if (cmp == 0) {
@@ -89,7 +85,6 @@ public:
     }
 private:
     sorting_t sorting;
-    size_t iterations_since_last_yield;
 };
 
 void debug_print(printf_buffer_t *, const rget_item_t &);
@@ -344,6 +339,7 @@ typedef boost::variant<
     grouped_t<std::pair<double, uint64_t> >, // Avg.
     grouped_t<ql::datum_t>, // Reduce (may be NULL)
     grouped_t<optimizer_t>, // min, max
+    grouped_t<datums_t>, // Top k.
     grouped_t<stream_t>, // No terminal.
     exc_t // Don't re-order (we don't want this to initialize to an error.)
     > result_t;
@@ -364,6 +360,13 @@ public:
                             groups_t *groups,
                             // Returns a datum that might be null
                             const std::function<datum_t()> &lazy_sindex_val) = 0;
+
+    // Filters may be able to decide whether they keep a row without an environment,
+    // and out of order.  Returns false if that's not possible.
+    virtual bool try_filter_without_env(UNUSED const datum_t &row,
+                                        UNUSED bool *keep_out) const {
+        return false;
+    }
 };
 
 struct limit_read_t {
@@ -384,6 +387,7 @@ typedef boost::variant<count_wire_func_t,
                        min_wire_func_t,
                        max_wire_func_t,
                        reduce_wire_func_t,
+                       top_k_wire_func_t,
                        limit_read_t
                        > terminal_variant_t;
 
@@ -431,6 +435,8 @@ scoped_ptr_t<accumulator_t> make_terminal(const terminal_variant_t &t);
 scoped_ptr_t<eager_acc_t> make_to_array();
 scoped_ptr_t<eager_acc_t> make_eager_terminal(const terminal_variant_t &t);
 scoped_ptr_t<op_t> make_op(const transform_variant_t &tv);
+// The name of the ReQL term a transformation came from, e.g. "filter".
+const char *transform_name(const transform_variant_t &tv);
 
 } // namespace ql
 
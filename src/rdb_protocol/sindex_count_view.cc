@@ -0,0 +1,65 @@
+// Copyright 2010-2015 RethinkDB, all rights reserved.
+#include "rdb_protocol/sindex_count_view.hpp"
+
+#include "config/args.hpp"
+
+void sindex_count_view_t::apply(const std::vector<ql::datum_t> &removed,
+                                const std::vector<ql::datum_t> &added) {
+    if (!valid) {
+        return;
+    }
+    for (const ql::datum_t &value : removed) {
+        note_count(value, -1);
+    }
+    for (const ql::datum_t &value : added) {
+        note_count(value, 1);
+    }
+    if (!valid || counts.size() > SINDEX_COUNT_VIEW_MAX_GROUPS) {
+        valid = false;
+        counts.clear();
+    }
+}
+
+void sindex_count_view_t::finish_building(ql::grouped_t<uint64_t> *read_counts) {
+    guarantee(building);
+    building = false;
+    if (!valid) {
+        return;
+    }
+    for (const auto &pair : *read_counts) {
+        note_count(pair.first, static_cast<int64_t>(pair.second));
+    }
+    for (const auto &pair : counts) {
+        if (pair.second < 0) {
+            valid = false;
+        }
+    }
+    if (!valid || counts.size() > SINDEX_COUNT_VIEW_MAX_GROUPS) {
+        valid = false;
+        counts.clear();
+    }
+}
+
+bool sindex_count_view_t::get_counts(
+        size_t max_groups, ql::grouped_t<uint64_t> *counts_out) const {
+    guarantee(is_ready());
+    if (counts.size() > max_groups) {
+        return false;
+    }
+    counts_out->clear();
+    for (const auto &pair : counts) {
+        counts_out->insert(
+            std::make_pair(pair.first, static_cast<uint64_t>(pair.second)));
+    }
+    return true;
+}
+
+void sindex_count_view_t::note_count(const ql::datum_t &value, int64_t delta) {
+    auto it = counts.insert(std::make_pair(value, 0)).first;
+    it->second += delta;
+    if (it->second == 0) {
+        counts.erase(it);
+    } else if (it->second < 0 && !building) {
+        valid = false;
+    }
+}
@@ -0,0 +1,57 @@
+// Copyright 2010-2015 RethinkDB, all rights reserved.
+#ifndef RDB_PROTOCOL_SINDEX_COUNT_VIEW_HPP_
+#define RDB_PROTOCOL_SINDEX_COUNT_VIEW_HPP_
+
+#include <map>
+#include <vector>
+
+#include "rdb_protocol/datum.hpp"
+#include "rdb_protocol/datum_utils.hpp"
+#include "rdb_protocol/shards.hpp"
+
+/* How many entries of one secondary index of a store have each value, kept up to date
+by the writes to the index so that `group({index: ...}).count()` over the whole index
+doesn't have to traverse it.
+
+The first such read builds the view: it registers an empty view while it holds the
+index's superblock for read, before it takes its snapshot.  Writes to the index apply
+their changes to the view while they hold the superblock for write, so the view then
+holds exactly the changes that the read's snapshot doesn't, and adding the counts that
+the read came up with makes it complete.  Later reads that hold the superblock for
+read get the same counts that traversing the index would have. */
+class sindex_count_view_t {
+public:
+    explicit sindex_count_view_t(uint64_t _build_id)
+        : build_id(_build_id), building(true), valid(true) { }
+
+    uint64_t get_build_id() const { return build_id; }
+    bool is_building() const { return building; }
+    bool is_ready() const { return !building && valid; }
+    bool is_valid() const { return valid; }
+
+    // Takes into account the values of the index entries that a write removed and
+    // added.
+    void apply(const std::vector<ql::datum_t> &removed,
+               const std::vector<ql::datum_t> &added);
+
+    // Adds the counts that the read that built the view came up with.
+    void finish_building(ql::grouped_t<uint64_t> *counts);
+
+    // Only if `is_ready()`.  Returns false if there are more than `max_groups`.
+    bool get_counts(size_t max_groups, ql::grouped_t<uint64_t> *counts_out) const;
+
+private:
+    void note_count(const ql::datum_t &value, int64_t delta);
+
+    const uint64_t build_id;
+    bool building;
+    // False once the view found out that it can't be trusted, for example because it
+    // would have to remove an entry it doesn't know of, or got too large.
+    bool valid;
+    // While the view is being built, these may be negative.
+    std::map<ql::datum_t, int64_t, optional_datum_less_t> counts;
+
+    DISABLE_COPYING(sindex_count_view_t);
+};
+
+#endif  // RDB_PROTOCOL_SINDEX_COUNT_VIEW_HPP_
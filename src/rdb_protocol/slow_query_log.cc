@@ -0,0 +1,93 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#include "rdb_protocol/slow_query_log.hpp"
+
+#include <algorithm>
+
+#include "rdb_protocol/datum.hpp"
+#include "rdb_protocol/math_utils.hpp"
+#include "rdb_protocol/pseudo_time.hpp"
+
+slow_query_log_t::slow_query_log_t(ticks_t _threshold)
+    : perfmon_perthread_t<std::vector<slow_query_log_entry_t> >(),
+      threshold(_threshold) { }
+
+void slow_query_log_t::record(slow_query_log_entry_t &&entry) {
+    rassert(get_thread_id().threadnum >= 0);
+    std::deque<slow_query_log_entry_t> *entries =
+        &thread_entries[get_thread_id().threadnum].value;
+    if (entries->size() == MAX_ENTRIES_PER_THREAD) {
+        entries->pop_front();
+    }
+    entries->push_back(std::move(entry));
+}
+
+void slow_query_log_t::get_thread_stat(std::vector<slow_query_log_entry_t> *stat) {
+    rassert(get_thread_id().threadnum >= 0);
+    const std::deque<slow_query_log_entry_t> &entries =
+        thread_entries[get_thread_id().threadnum].value;
+    stat->assign(entries.begin(), entries.end());
+}
+
+std::vector<slow_query_log_entry_t> slow_query_log_t::combine_stats(
+        const std::vector<slow_query_log_entry_t> *stats) {
+    std::vector<slow_query_log_entry_t> combined;
+    for (int i = 0; i < get_num_threads(); ++i) {
+        combined.insert(combined.end(), stats[i].begin(), stats[i].end());
+    }
+    std::sort(combined.begin(), combined.end(),
+        [](const slow_query_log_entry_t &a, const slow_query_log_entry_t &b) {
+            return a.time < b.time;
+        });
+    return combined;
+}
+
+ql::datum_t slow_query_log_t::output_stat(
+        const std::vector<slow_query_log_entry_t> &entries) {
+    ql::datum_array_builder_t array(ql::configured_limits_t::unlimited);
+    for (const slow_query_log_entry_t &entry : entries) {
+        ql::datum_object_builder_t builder;
+        builder.overwrite("id", ql::datum_t(datum_string_t(uuid_to_str(entry.id))));
+        builder.overwrite("time", ql::pseudo::make_time(
+            entry.time / static_cast<double>(MILLION), "+00:00"));
+        builder.overwrite("duration_ms",
+            ql::datum_t(safe_to_double(entry.duration.nanos) / MILLION));
+        builder.overwrite("query", ql::datum_t(datum_string_t(entry.query)));
+        builder.overwrite("batch", ql::datum_t(static_cast<double>(entry.batch)));
+        builder.overwrite("client_address",
+            ql::datum_t(datum_string_t(entry.client_address)));
+        builder.overwrite("client_port",
+            ql::datum_t(static_cast<double>(entry.client_port)));
+        builder.overwrite("user", ql::datum_t(datum_string_t(entry.user)));
+        builder.overwrite("rows_returned",
+            ql::datum_t(static_cast<double>(entry.rows_returned)));
+        builder.overwrite("shards_touched", entry.shards_touched.has_value()
+            ? ql::datum_t(static_cast<double>(*entry.shards_touched))
+            : ql::datum_t::null());
+        builder.overwrite("error", entry.error.has_value()
+            ? ql::datum_t(datum_string_t(*entry.error))
+            : ql::datum_t::null());
+        array.add(std::move(builder).to_datum());
+    }
+    return std::move(array).to_datum();
+}
+
+size_t count_shards_in_profile(const ql::datum_t &profile) {
+    size_t count = 0;
+    if (profile.get_type() == ql::datum_t::R_ARRAY) {
+        for (size_t i = 0; i < profile.arr_size(); ++i) {
+            count += count_shards_in_profile(profile.get(i));
+        }
+    } else if (profile.get_type() == ql::datum_t::R_OBJECT) {
+        ql::datum_t description = profile.get_field("description", ql::NOTHROW);
+        if (description.has() && description.get_type() == ql::datum_t::R_STR) {
+            const std::string str = description.as_str().to_std();
+            if (str == "Perform read on shard." || str == "Perform write on shard.") {
+                ++count;
+            }
+        }
+        for (size_t i = 0; i < profile.obj_size(); ++i) {
+            count += count_shards_in_profile(profile.get_pair(i).second);
+        }
+    }
+    return count;
+}
@@ -0,0 +1,67 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#ifndef RDB_PROTOCOL_SLOW_QUERY_LOG_HPP_
+#define RDB_PROTOCOL_SLOW_QUERY_LOG_HPP_
+
+#include <deque>
+#include <string>
+#include <vector>
+
+#include "containers/optional.hpp"
+#include "containers/uuid.hpp"
+#include "perfmon/perfmon.hpp"
+#include "time.hpp"
+
+/* What we know about one response that took too long. Each batch of a stream is its own
+entry, since the time between the batches belongs to the client. */
+struct slow_query_log_entry_t {
+    uuid_u id;
+    microtime_t time;
+    ticks_t duration;
+    // The pretty-printed root term.
+    std::string query;
+    // Zero for the response to the `START` of the query, then one per `CONTINUE`.
+    int64_t batch;
+    std::string client_address;
+    int client_port;
+    std::string user;
+    size_t rows_returned;
+    // Only known if the query ran with `profile: true`, since that's what tracks the
+    // work each shard does.
+    optional<size_t> shards_touched;
+    // The error message, if the response was an error.
+    optional<std::string> error;
+};
+
+/* `slow_query_log_t` remembers the most recent queries on this server that took longer
+than the threshold to answer. Every thread keeps the last `MAX_ENTRIES_PER_THREAD` of its
+own slow queries. The log is a perfmon, so that the `rethinkdb.slow_queries` table can
+fetch it from every server through the stats mailbox. */
+class slow_query_log_t :
+    public perfmon_perthread_t<std::vector<slow_query_log_entry_t> > {
+public:
+    /* A threshold of zero turns the log off. */
+    explicit slow_query_log_t(ticks_t _threshold);
+
+    bool is_slow(ticks_t duration) const {
+        return threshold.nanos > 0 && duration.nanos >= threshold.nanos;
+    }
+
+    void record(slow_query_log_entry_t &&entry);
+
+    static const size_t MAX_ENTRIES_PER_THREAD = 32;
+
+private:
+    void get_thread_stat(std::vector<slow_query_log_entry_t> *);
+    std::vector<slow_query_log_entry_t> combine_stats(
+        const std::vector<slow_query_log_entry_t> *);
+    ql::datum_t output_stat(const std::vector<slow_query_log_entry_t> &);
+
+    const ticks_t threshold;
+    std::array<cache_line_padded_t<std::deque<slow_query_log_entry_t> >, MAX_THREADS>
+        thread_entries;
+};
+
+/* Counts the reads and writes on shards in a profile as returned to the client. */
+size_t count_shards_in_profile(const ql::datum_t &profile);
+
+#endif  // RDB_PROTOCOL_SLOW_QUERY_LOG_HPP_
@@ -1,9 +1,13 @@
 // Copyright 2010-2014 RethinkDB, all rights reserved.
 #include "rdb_protocol/store.hpp"
 
+#include <algorithm>
 #include <list>
 
+#include "arch/timing.hpp"
 #include "btree/backfill_debug.hpp"
+#include "btree/compaction.hpp"
+#include "btree/get_distribution.hpp"
 #include "btree/reql_specific.hpp"
 #include "btree/superblock.hpp"
 #include "concurrency/cross_thread_signal.hpp"
@@ -15,6 +19,7 @@
 #include "rdb_protocol/env.hpp"
 #include "rdb_protocol/erase_range.hpp"
 #include "rdb_protocol/func.hpp"
+#include "rdb_protocol/pseudo_time.hpp"
 #include "rdb_protocol/shards.hpp"
 #include "rdb_protocol/table_common.hpp"
 
@@ -193,6 +198,77 @@ scoped_ptr_t<sindex_superblock_t> acquire_sindex_for_read(
     return sindex_sb;
 }
 
+// A plain `count()` of the whole store doesn't have to traverse the btree, since the
+// stat block keeps track of how many keys it has.  Returns false if `rget` isn't
+// such a count.
+bool count_from_stat_block(store_t *store,
+                           real_superblock_t *superblock,
+                           const rget_read_t &rget,
+                           rget_read_response_t *res) {
+    if (!rget.terminal.has_value()
+        || boost::get<ql::count_wire_func_t>(&*rget.terminal) == nullptr
+        || !rget.transforms.empty()
+        || rget.primary_keys.has_value()
+        || !region_is_superset(rget.region, store->get_region())) {
+        return false;
+    }
+    int64_t population;
+    if (!get_btree_population(superblock, &population)) {
+        return false;
+    }
+    guarantee(population >= 0);
+    // This is what the count terminal would have come up with.
+    res->result = ql::grouped_t<uint64_t>();
+    if (population > 0) {
+        boost::get<ql::grouped_t<uint64_t> >(res->result)[ql::datum_t()] = population;
+    }
+    return true;
+}
+
+// Whether `rget` is a `group({index: ...}).count()` over all of the index in the whole
+// store, which `sindex_count_view_t` can answer.
+bool is_whole_sindex_group_count(store_t *store, const rget_read_t &rget) {
+    if (!rget.sindex.has_value()
+        || !rget.sindex->datumspec.is_universe()
+        || (rget.sindex->region.has_value()
+            && rget.sindex->region->inner != key_range_t::universe())
+        || !rget.terminal.has_value()
+        || boost::get<ql::count_wire_func_t>(&*rget.terminal) == nullptr
+        || rget.transforms.size() != 1
+        || rget.primary_keys.has_value()
+        || !region_is_superset(rget.region, store->get_region())) {
+        return false;
+    }
+    auto *group = boost::get<ql::group_wire_func_t>(&rget.transforms[0]);
+    return group != nullptr
+        && group->num_funcs() == 0
+        && group->should_append_index()
+        && !group->is_multi();
+}
+
+// Drops the view that a read started building, unless the read got to finish it.
+class sindex_count_view_builder_t {
+public:
+    sindex_count_view_builder_t(store_t *_store, uuid_u _sindex_id)
+        : store(_store), sindex_id(_sindex_id),
+          build_id(store->start_sindex_count_view(sindex_id)), finished(false) { }
+    ~sindex_count_view_builder_t() {
+        if (!finished) {
+            store->drop_sindex_count_view(sindex_id, make_optional(build_id));
+        }
+    }
+    void finish(ql::grouped_t<uint64_t> *counts) {
+        store->finish_sindex_count_view(sindex_id, build_id, counts);
+        finished = true;
+    }
+private:
+    store_t *const store;
+    const uuid_u sindex_id;
+    const uint64_t build_id;
+    bool finished;
+    DISABLE_COPYING(sindex_count_view_builder_t);
+};
+
 void do_read(ql::env_t *env,
              store_t *store,
              btree_slice_t *btree,
@@ -207,6 +283,12 @@ void do_read(ql::env_t *env,
         if (sindex_id_out != nullptr) {
             *sindex_id_out = r_nullopt;
         }
+        if (count_from_stat_block(store, superblock, rget, res)) {
+            if (release_superblock == release_superblock_t::RELEASE) {
+                superblock->release();
+            }
+            return;
+        }
         rdb_rget_slice(
             btree,
             *rget.current_shard,
@@ -259,6 +341,26 @@ void do_read(ql::env_t *env,
                 return;
             }
 
+            scoped_ptr_t<sindex_count_view_builder_t> view_builder;
+            if (is_whole_sindex_group_count(store, rget)) {
+                // Writes to the index change the view while they hold its superblock
+                // for write, so once we hold it for read the view matches what the
+                // index holds.  See `sindex_count_view_t`.
+                wait_interruptible(sindex_sb->get()->read_acq_signal(), env->interruptor);
+                sindex_count_view_t *view = store->sindex_count_view(sindex_uuid);
+                if (view != nullptr && view->is_ready()) {
+                    ql::grouped_t<uint64_t> counts;
+                    if (view->get_counts(env->limits().array_size_limit(), &counts)) {
+                        sindex_sb.reset();
+                        res->result = std::move(counts);
+                        return;
+                    }
+                } else if (view == nullptr || !view->is_building()) {
+                    view_builder.init(
+                        new sindex_count_view_builder_t(store, sindex_uuid));
+                }
+            }
+
             rdb_rget_secondary_slice(
                 store->get_sindex_slice(sindex_uuid),
                 *rget.current_shard,
@@ -275,6 +377,12 @@ void do_read(ql::env_t *env,
                 sindex_info,
                 res,
                 release_superblock_t::RELEASE);
+            if (view_builder.has()) {
+                auto *counts = boost::get<ql::grouped_t<uint64_t> >(&res->result);
+                if (counts != nullptr) {
+                    view_builder->finish(counts);
+                }
+            }
         } catch (const ql::exc_t &e) {
             res->result = e;
             return;
@@ -402,7 +510,7 @@ struct rdb_read_visitor_t : public boost::static_visitor<void> {
         auto cserver = store->changefeed_server(s.region);
         if (cserver.first != nullptr) {
             if (optional<uint64_t> stamp
-                    = cserver.first->get_stamp(s.addr, cserver.second)) {
+                    = cserver.first->get_stamp(s.addr, s.squash, cserver.second)) {
                 changefeed_stamp_response_t out;
                 out.stamp_infos.set(std::map<uuid_u, shard_stamp_info_t>());
                 (*out.stamp_infos)[cserver.first->get_uuid()] = shard_stamp_info_t{
@@ -431,7 +539,7 @@ struct rdb_read_visitor_t : public boost::static_visitor<void> {
             res->resp.set(changefeed_point_stamp_response_t::valid_response_t());
             auto *vres = &*res->resp;
             if (optional<uint64_t> stamp
-                    = cserver.first->get_stamp(s.addr, cserver.second)) {
+                    = cserver.first->get_stamp(s.addr, s.squash, cserver.second)) {
                 vres->stamp = std::make_pair(cserver.first->get_uuid(), *stamp);
             } else {
                 // The client was removed, so no future messages are coming.
@@ -450,6 +558,7 @@ struct rdb_read_visitor_t : public boost::static_visitor<void> {
         response->response = point_read_response_t();
         point_read_response_t *res =
             boost::get<point_read_response_t>(&response->response);
+        store->load_sampler.record(get.key);
         rdb_get(get.key, btree, superblock, res, trace);
     }
 
@@ -637,8 +746,39 @@ struct rdb_read_visitor_t : public boost::static_visitor<void> {
             interruptor,
             rget.serializable_env,
             trace);
+
+        // Profiled reads need their event log, which the cache doesn't keep.
+        std::string cache_key;
+        bool use_cache = false;
+        if (trace == nullptr) {
+            try {
+                scoped_ptr_t<ql::val_t> v = ql_env.get_optarg(&ql_env, "result_cache");
+                use_cache = v.has() && v->as_bool()
+                    && read_result_cache_t::make_key(rget, &cache_key);
+            } catch (const ql::exc_t &e) {
+                res->result = e;
+                return;
+            } catch (const ql::datum_exc_t &e) {
+                res->result = ql::exc_t(e, ql::backtrace_id_t::empty());
+                return;
+            }
+        }
+        if (use_cache) {
+            const rget_read_response_t *cached =
+                store->read_result_cache.find(cache_key);
+            if (cached != nullptr) {
+                superblock->release();
+                *res = *cached;
+                return;
+            }
+        }
+
         do_read(&ql_env, store, btree, superblock, rget, res,
                 release_superblock_t::RELEASE, nullptr);
+        if (use_cache) {
+            store->read_result_cache.insert(
+                std::move(cache_key), rget, result_cache_generation, *res);
+        }
     }
 
     void operator()(const distribution_read_t &dg) {
@@ -646,6 +786,7 @@ struct rdb_read_visitor_t : public boost::static_visitor<void> {
         distribution_read_response_t *res = boost::get<distribution_read_response_t>(&response->response);
         rdb_distribution_get(dg.max_depth, dg.region.inner.left,
                              superblock, res);
+        store->load_sampler.get_load_counts(dg.region.inner, &res->load_counts);
         for (std::map<store_key_t, int64_t>::iterator it = res->key_counts.begin(); it != res->key_counts.end(); ) {
             if (!dg.region.inner.contains_key(store_key_t(it->first))) {
                 std::map<store_key_t, int64_t>::iterator tmp = it;
@@ -674,6 +815,7 @@ struct rdb_read_visitor_t : public boost::static_visitor<void> {
                        rdb_context_t *_ctx,
                        read_response_t *_response,
                        profile::trace_t *_trace,
+                       uint64_t _result_cache_generation,
                        signal_t *_interruptor) :
         response(_response),
         ctx(_ctx),
@@ -681,7 +823,8 @@ struct rdb_read_visitor_t : public boost::static_visitor<void> {
         btree(_btree),
         store(_store),
         superblock(_superblock),
-        trace(_trace) { }
+        trace(_trace),
+        result_cache_generation(_result_cache_generation) { }
 
 private:
 
@@ -692,6 +835,7 @@ private:
     store_t *const store;
     real_superblock_t *const superblock;
     profile::trace_t *const trace;
+    const uint64_t result_cache_generation;
 
     DISABLE_COPYING(rdb_read_visitor_t);
 };
@@ -699,6 +843,7 @@ private:
 void store_t::protocol_read(const read_t &_read,
                             read_response_t *response,
                             real_superblock_t *superblock,
+                            uint64_t result_cache_generation,
                             signal_t *interruptor) {
     scoped_ptr_t<profile::trace_t> trace = ql::maybe_make_profile_trace(_read.profile);
 
@@ -707,7 +852,8 @@ void store_t::protocol_read(const read_t &_read,
             _read.profile == profile_bool_t::PROFILE, "Perform read on shard.", trace);
         rdb_read_visitor_t v(btree.get(), this,
                              superblock,
-                             ctx, response, trace.get_or_null(), interruptor);
+                             ctx, response, trace.get_or_null(),
+                             result_cache_generation, interruptor);
         boost::apply_visitor(v, _read.read);
     }
 
@@ -736,14 +882,21 @@ public:
           write_hook(std::move(wh)),
           return_changes(_return_changes) { }
     ql::datum_t replace(
-        const ql::datum_t &d, size_t) const {
+        const ql::datum_t &d, size_t index) const {
         ql::datum_t res = f->call(env, d, ql::LITERAL_OK)->as_datum();
 
         const ql::datum_t &write_timestamp = env->get_deterministic_time();
         r_sanity_check(write_timestamp.has());
+        if (!write_hook.has()) {
+            return res;
+        }
+        // `f` may be non-deterministic and use `env`, but the write hook gets an
+        // environment of its own, so it can be evaluated on another thread.
+        on_thread_t thread_switcher(evaluation_thread(index));
         return apply_write_hook(pkey, d, res, write_timestamp, write_hook);
     }
     return_changes_t should_return_changes() const { return return_changes; }
+    bool evaluates_on_other_threads() const { return write_hook.has(); }
 private:
     ql::env_t *const env;
     datum_string_t pkey;
@@ -772,19 +925,39 @@ public:
                         size_t index) const {
         guarantee(index < datums->size());
         ql::datum_t newd = (*datums)[index];
-        ql::datum_t res = resolve_insert_conflict(env,
-                                             pkey,
-                                             d,
-                                             newd,
-                                             conflict_behavior,
-                                             conflict_func);
         const ql::datum_t &write_timestamp = env->get_deterministic_time();
         r_sanity_check(write_timestamp.has());
-        res = apply_write_hook(datum_string_t(pkey), d, res, write_timestamp,
-                               write_hook);
-        return res;
+        const bool calls_conflict_func = conflict_func.has_value()
+            && d.get_type() != ql::datum_t::R_NULL;
+        if (!calls_conflict_func && !write_hook.has()) {
+            return resolve_insert_conflict(env, pkey, d, newd, conflict_behavior,
+                                           conflict_func);
+        }
+
+        // The conflict function and the write hook are deterministic, so we can
+        // evaluate them on another thread, in an environment of our own there.
+        serializable_env_t serializable_env = env->get_serializable_env();
+        rdb_context_t *ctx = env->get_rdb_ctx();
+        on_thread_t thread_switcher(evaluation_thread(index));
+        cond_t non_interruptor;
+        ql::env_t thread_env(ctx,
+                             ql::return_empty_normal_batches_t::NO,
+                             &non_interruptor,
+                             std::move(serializable_env),
+                             nullptr);
+        ql::datum_t res = resolve_insert_conflict(&thread_env,
+                                                  pkey,
+                                                  d,
+                                                  newd,
+                                                  conflict_behavior,
+                                                  conflict_func);
+        return apply_write_hook(datum_string_t(pkey), d, res, write_timestamp,
+                                write_hook);
     }
     return_changes_t should_return_changes() const { return return_changes; }
+    bool evaluates_on_other_threads() const {
+        return conflict_func.has_value() || write_hook.has();
+    }
 private:
     ql::env_t *env;
 
@@ -797,6 +970,51 @@ private:
     optional<counted_t<const ql::func_t> > conflict_func;
 };
 
+/* Deletes the rows of a `ttl_expire_t` that have expired, and leaves the others as they
+are. Like in `compute_keys()`, the index function is deterministic and gets evaluated in
+a pristine environment. */
+class ttl_replacer_t : public btree_batched_replacer_t {
+public:
+    explicit ttl_replacer_t(const ttl_expire_t &te)
+        : mapping(te.index.func.compile_wire_func()),
+          reql_version(te.index.func_version),
+          cutoff(te.cutoff) { }
+    ql::datum_t replace(const ql::datum_t &d, size_t) const {
+        if (d.get_type() == ql::datum_t::R_NULL) {
+            return d;
+        }
+        cond_t non_interruptor;
+        ql::env_t ttl_env(&non_interruptor,
+                          ql::return_empty_normal_batches_t::NO,
+                          reql_version);
+        try {
+            ql::datum_t value = mapping->call(&ttl_env, d)->as_datum();
+            if (value.is_ptype(ql::pseudo::time_string)
+                    && ql::pseudo::time_to_epoch_time(value) < cutoff) {
+                return ql::datum_t::null();
+            }
+        } catch (const ql::base_exc_t &) {
+            // Rows that aren't in the index don't expire.
+        }
+        return d;
+    }
+    return_changes_t should_return_changes() const { return return_changes_t::NO; }
+private:
+    const counted_t<const ql::func_t> mapping;
+    const reql_version_t reql_version;
+    const double cutoff;
+};
+
+/* Deletes every row, for a `range_delete_t` that has to go through
+`rdb_batched_replace()`. */
+class delete_replacer_t : public btree_batched_replacer_t {
+public:
+    ql::datum_t replace(const ql::datum_t &, size_t) const {
+        return ql::datum_t::null();
+    }
+    return_changes_t should_return_changes() const { return return_changes_t::NO; }
+};
+
 struct rdb_write_visitor_t : public boost::static_visitor<void> {
     void operator()(const batched_replace_t &br) {
         ql::env_t ql_env(
@@ -820,6 +1038,10 @@ struct rdb_write_visitor_t : public boost::static_visitor<void> {
                                  write_hook,
                                  br.return_changes);
 
+        for (const store_key_t &key : br.keys) {
+            store->load_sampler.record(key);
+        }
+
         response->response =
             rdb_batched_replace(
                 btree_info_t(btree, timestamp, datum_string_t(br.pkey)),
@@ -848,6 +1070,7 @@ struct rdb_write_visitor_t : public boost::static_visitor<void> {
         keys.reserve(bi.inserts.size());
         for (auto it = bi.inserts.begin(); it != bi.inserts.end(); ++it) {
             keys.emplace_back(it->get_field(datum_string_t(bi.pkey)).print_primary());
+            store->load_sampler.record(keys.back());
         }
         response->response =
             rdb_batched_replace(
@@ -861,11 +1084,90 @@ struct rdb_write_visitor_t : public boost::static_visitor<void> {
                 trace);
     }
 
+    void operator()(const ttl_expire_t &te) {
+        rdb_modification_report_cb_t sindex_cb(
+            store, &sindex_block,
+            auto_drainer_t::lock_t(&store->drainer));
+        ttl_replacer_t replacer(te);
+        response->response =
+            rdb_batched_replace(
+                btree_info_t(btree, timestamp, datum_string_t(te.pkey)),
+                superblock,
+                te.keys,
+                &replacer,
+                &sindex_cb,
+                ql::configured_limits_t(),
+                sampler,
+                trace);
+    }
+
+    void operator()(const range_delete_t &rd) {
+        sampler->new_sample();
+
+        /* Changefeeds have to hear about every row that gets deleted, and
+        `rdb_batched_replace()` already takes care of that. So if there might be a
+        changefeed on the range, we delete the rows through it instead. The rows that
+        get deleted are the same either way, so the replicas stay the same. */
+        if (may_have_changefeeds(rd.region)) {
+            std::vector<store_key_t> keys;
+            rdb_collect_keys_in_range(
+                rd.region.inner, superblock->get(), interruptor, rd.max_rows, &keys);
+            if (keys.empty()) {
+                response->response = ql::datum_t::empty_object();
+                return;
+            }
+            rdb_modification_report_cb_t sindex_cb(
+                store, &sindex_block,
+                auto_drainer_t::lock_t(&store->drainer));
+            delete_replacer_t replacer;
+            response->response =
+                rdb_batched_replace(
+                    btree_info_t(btree, timestamp, datum_string_t(rd.pkey)),
+                    superblock,
+                    keys,
+                    &replacer,
+                    &sindex_cb,
+                    ql::configured_limits_t(),
+                    sampler,
+                    trace);
+            return;
+        }
+
+        /* Note we don't allow interruption while we delete; it's too easy to end up in
+        an inconsistent state. */
+        cond_t non_interruptor;
+        rdb_live_deletion_context_t deletion_context;
+        std::vector<rdb_modification_report_t> mod_reports;
+        key_range_t deleted_range;
+        rdb_delete_small_range(btree,
+                               timestamp,
+                               rd.region.inner,
+                               superblock->get(),
+                               &deletion_context,
+                               &non_interruptor,
+                               rd.max_rows,
+                               &mod_reports,
+                               &deleted_range);
+        superblock->reset();
+
+        /* Update the secondary indexes for all of the deleted rows at once, rather
+        than one row at a time. */
+        if (!mod_reports.empty()) {
+            store->update_sindexes(txn, &sindex_block, mod_reports,
+                                   true /* release_sindex_block */);
+        }
+
+        ql::datum_object_builder_t stats;
+        stats.overwrite("deleted", ql::datum_t(static_cast<double>(mod_reports.size())));
+        response->response = std::move(stats).to_datum();
+    }
+
     void operator()(const point_write_t &w) {
         sampler->new_sample();
         response->response = point_write_response_t();
         point_write_response_t *res =
             boost::get<point_write_response_t>(&response->response);
+        store->load_sampler.record(w.key);
 
         backfill_debug_key(w.key, strprintf("upsert %" PRIu64, timestamp.longtime));
 
@@ -882,6 +1184,7 @@ struct rdb_write_visitor_t : public boost::static_visitor<void> {
         response->response = point_delete_response_t();
         point_delete_response_t *res =
             boost::get<point_delete_response_t>(&response->response);
+        store->load_sampler.record(d.key);
 
         backfill_debug_key(d.key, strprintf("delete %" PRIu64, timestamp.longtime));
 
@@ -934,6 +1237,16 @@ struct rdb_write_visitor_t : public boost::static_visitor<void> {
     }
 
 private:
+    bool may_have_changefeeds(const region_t &region) {
+        auto cservers = store->access_changefeed_servers();
+        for (auto &&pair : *cservers.first) {
+            if (pair.first.inner.overlaps(region.inner)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
     void update_sindexes(const rdb_modification_report_t &mod_report) {
         std::vector<rdb_modification_report_t> mod_reports;
         // This copying of the mod_report is inefficient, but it seems this
@@ -1028,6 +1341,97 @@ void store_t::delayed_clear_and_drop_sindex(
     }
 }
 
+void store_t::compact_cold_leaves(auto_drainer_t::lock_t store_keepalive)
+        THROWS_NOTHING {
+    signal_t *interruptor = store_keepalive.get_drain_signal();
+    rdb_value_sizer_t sizer(cache->max_block_size());
+    rdb_live_deletion_context_t deletion_context;
+    /* Leaves that nothing has written to since we looked at the previous piece are
+    cold. */
+    repli_timestamp_t cold_before = repli_timestamp_t::distant_past;
+    store_key_t left = store_key_t::min();
+    try {
+        for (;;) {
+            nap(COLD_LEAF_COMPACTION_INTERVAL_MS, interruptor);
+
+            /* The piece goes from `left` to the next boundary between subtrees at
+            `COLD_LEAF_COMPACTION_PIECE_DEPTH`, so that it covers a similar number of
+            leaves however big the btree is. */
+            key_range_t piece;
+            repli_timestamp_t recency;
+            {
+                read_token_t token;
+                new_read_token(&token);
+                scoped_ptr_t<txn_t> txn;
+                scoped_ptr_t<real_superblock_t> superblock;
+                acquire_superblock_for_read(&token, &txn, &superblock, interruptor,
+                                            false /* don't use snapshot */);
+                recency = btree_root_recency(superblock.get());
+                int64_t key_count;
+                std::vector<store_key_t> boundaries;
+                get_btree_key_distribution(superblock.get(),
+                                           COLD_LEAF_COMPACTION_PIECE_DEPTH,
+                                           &key_count, &boundaries);
+                std::sort(boundaries.begin(), boundaries.end());
+                auto right = std::upper_bound(boundaries.begin(), boundaries.end(),
+                                              left);
+                piece = right == boundaries.end()
+                    ? key_range_t(key_range_t::closed, left,
+                                  key_range_t::none, store_key_t())
+                    : key_range_t(key_range_t::closed, left,
+                                  key_range_t::open, *right);
+            }
+
+            std::vector<store_key_t> underfull_keys;
+            {
+                write_token_t token;
+                new_write_token(&token);
+                scoped_ptr_t<txn_t> txn;
+                scoped_ptr_t<real_superblock_t> superblock;
+                acquire_superblock_for_write(
+                    // Not really the right value, since we don't know how many of the
+                    // leaves are cold:
+                    1,
+                    write_durability_t::SOFT,
+                    &token,
+                    &txn,
+                    &superblock,
+                    interruptor);
+                try {
+                    btree_compact_cold_leaves(&sizer, superblock.get(), piece,
+                                              cold_before, &underfull_keys,
+                                              interruptor);
+                } catch (const interrupted_exc_t &) {
+                    // The leaves that were compacted so far are fine as they are.
+                    superblock.reset();
+                    txn->commit();
+                    throw;
+                }
+                superblock.reset();
+                txn->commit();
+            }
+
+            for (const store_key_t &key : underfull_keys) {
+                write_token_t token;
+                new_write_token(&token);
+                scoped_ptr_t<txn_t> txn;
+                scoped_ptr_t<real_superblock_t> superblock;
+                acquire_superblock_for_write(1, write_durability_t::SOFT, &token,
+                                             &txn, &superblock, interruptor);
+                btree_merge_underfull_leaf(&sizer, superblock.get(), key.btree_key(),
+                                           deletion_context.balancing_detacher());
+                superblock.reset();
+                txn->commit();
+            }
+
+            left = piece.right.unbounded ? store_key_t::min() : piece.right.key();
+            cold_before = recency;
+        }
+    } catch (const interrupted_exc_t &) {
+        /* The store is shutting down. */
+    }
+}
+
 namespace_id_t const &store_t::get_table_id() const {
     return table_id;
 }
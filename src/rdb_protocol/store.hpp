@@ -23,7 +23,10 @@
 #include "paths.hpp"
 #include "protocol_api.hpp"
 #include "rdb_protocol/changefeed.hpp"
+#include "rdb_protocol/key_load_sampler.hpp"
 #include "rdb_protocol/protocol.hpp"
+#include "rdb_protocol/read_result_cache.hpp"
+#include "rdb_protocol/sindex_count_view.hpp"
 #include "rdb_protocol/store_metainfo.hpp"
 #include "rpc/mailbox/typed.hpp"
 #include "store_view.hpp"
@@ -176,6 +179,14 @@ public:
             signal_t *interruptor)
         THROWS_ONLY(interrupted_exc_t);
 
+    void get_expired_keys(
+            const std::string &sindex,
+            double cutoff,
+            size_t max_keys,
+            std::vector<store_key_t> *keys_out,
+            signal_t *interruptor)
+        THROWS_ONLY(interrupted_exc_t);
+
     /* End of `store_view_t` interface */
 
     std::map<std::string, std::pair<sindex_config_t, sindex_status_t> > sindex_list(
@@ -201,6 +212,7 @@ public:
             THROWS_ONLY(interrupted_exc_t);
 
     void configure_flush_interval(flush_interval_t interval);
+    void configure_cache_quota(cache_quota_t quota);
 
     new_mutex_in_line_t get_in_line_for_sindex_queue(buf_lock_t *sindex_block);
     rwlock_in_line_t get_in_line_for_cfeed_stamp(access_t access);
@@ -300,9 +312,12 @@ public:
         return secondary_index_slices.at(id).get();
     }
 
+    // `result_cache_generation` is what `read_result_cache.generation()` was when the
+    // read acquired `superblock`.
     void protocol_read(const read_t &read,
                        read_response_t *response,
                        real_superblock_t *superblock,
+                       uint64_t result_cache_generation,
                        signal_t *interruptor);
 
     void protocol_write(const write_t &write,
@@ -345,6 +360,10 @@ private:
             secondary_index_t sindex,
             auto_drainer_t::lock_t store_keepalive)
             THROWS_NOTHING;
+    // Compacts and merges the cold leaves of the primary btree, one piece of it every
+    // `COLD_LEAF_COMPACTION_INTERVAL_MS`, until the store shuts down. To be run in a
+    // coroutine.
+    void compact_cold_leaves(auto_drainer_t::lock_t store_keepalive) THROWS_NOTHING;
     // Drops a secondary index. Assumes that the index has previously been cleared
     // through `clear_sindex_data()`.
     void drop_sindex(uuid_u sindex_id) THROWS_NOTHING;
@@ -401,6 +420,34 @@ public:
     // `btree.cc`.
     rwlock_t cfeed_stamp_lock;
 
+    // Remembers the keys of recent point reads and writes, for `distribution_read_t`.
+    key_load_sampler_t load_sampler;
+
+    // The responses to recent reads that asked for the `result_cache`.
+    read_result_cache_t read_result_cache;
+
+    // The `sindex_count_view_t` of the index `sindex_id`, or null if there is none.
+    sindex_count_view_t *sindex_count_view(uuid_u sindex_id);
+    // Replaces the view of the index `sindex_id` with a new one that is being built,
+    // and returns the build id the builder passes to `finish_sindex_count_view()`.
+    uint64_t start_sindex_count_view(uuid_u sindex_id);
+    // The build id of the view of the index `sindex_id`, or empty if there is none.
+    optional<uint64_t> sindex_count_view_build_id(uuid_u sindex_id);
+    // Applies the changes of a write to the view of the index `sindex_id`, if it is
+    // still the one with the build id `build_id`, and drops it if that makes it
+    // invalid.
+    void apply_to_sindex_count_view(uuid_u sindex_id,
+                                    uint64_t build_id,
+                                    const std::vector<ql::datum_t> &removed,
+                                    const std::vector<ql::datum_t> &added);
+    // Completes the view that `build_id` started, unless it was dropped since.
+    void finish_sindex_count_view(uuid_u sindex_id,
+                                  uint64_t build_id,
+                                  ql::grouped_t<uint64_t> *counts);
+    // Drops the view of the index `sindex_id` if it is still the one `build_id`
+    // started, or unconditionally if `build_id` is empty.
+    void drop_sindex_count_view(uuid_u sindex_id, optional<uint64_t> build_id);
+
 private:
     rdb_context_t *ctx;
     // We store regions here even though we only really need the key ranges
@@ -431,6 +478,9 @@ public:
 private:
     namespace_id_t table_id;
 
+    std::map<uuid_u, scoped_ptr_t<sindex_count_view_t> > sindex_count_views;
+    uint64_t next_sindex_count_view_build_id;
+
     sindex_context_map_t sindex_context;
 
     // Having a lot of writes queued up waiting for the superblock to become available
@@ -14,6 +14,13 @@ backfill faster, but it will also cause the backfill-related transactions to hol
 superblock for a longer time. */
 static const int MAX_CHANGES_PER_TXN = 16;
 
+/* `MAX_PAIRS_PER_EMPTY_RANGE_TXN` is the maximum number of pairs we'll insert in a single
+transaction when applying a multi-key backfill item to a part of the B-tree that turned
+out to hold no data, which is the common case when backfilling a new replica. Since
+nothing has to be deleted there, the transactions are cheap enough to do many more
+insertions each. */
+static const int MAX_PAIRS_PER_EMPTY_RANGE_TXN = 256;
+
 /* `MAX_UNSAVED_CHANGES` is the maximum number of keys we'll modify or delete before
 flushing our changes out to disk. This prevents the backfill from using too much of the
 cache's unsaved data limit, which would slow down queries on other shards. */
@@ -293,13 +300,18 @@ void apply_multi_key_item(
         bool is_first = true;
         size_t next_pair = 0;
         key_range_t::right_bound_t threshold(item.range.left);
+        /* `max_pairs` is how many pairs of the item we'll apply in the next cycle. It
+        grows once a cycle finds nothing to delete, and shrinks back as soon as one
+        does. */
+        size_t max_pairs = MAX_CHANGES_PER_TXN / 2;
         while (threshold != item.range.right) {
             std::vector<rdb_modification_report_t> mod_reports;
 
-            /* Block until there's not too much unsaved data. Note that
-            `MAX_CHANGES_PER_TXN` might be an overestimate, but that's OK. */
+            /* Block until there's not too much unsaved data. Note that this might be an
+            overestimate, but that's OK. */
             tokens.info->limiter->prepare_for_changes(
-                MAX_CHANGES_PER_TXN, tokens.keepalive.get_drain_signal());
+                MAX_CHANGES_PER_TXN / 2 + max_pairs,
+                tokens.keepalive.get_drain_signal());
 
             /* We must not throw within the transaction. So we check the
             drain signal now. */
@@ -330,12 +342,12 @@ void apply_multi_key_item(
 
             /* Establish an upper limit on how much of the range we're willing to delete
             in this cycle. We choose the upper limit such that it contains no more than
-            `MAX_CHANGES_PER_TXN / 2` of the pairs in the backfill item. */
+            `max_pairs` of the pairs in the backfill item. */
             key_range_t range_to_delete;
             range_to_delete.left = threshold.key();
-            if (next_pair + MAX_CHANGES_PER_TXN / 2 + 1 < item.pairs.size()) {
+            if (next_pair + max_pairs + 1 < item.pairs.size()) {
                 range_to_delete.right = key_range_t::right_bound_t(
-                    item.pairs[next_pair + MAX_CHANGES_PER_TXN / 2 + 1].key);
+                    item.pairs[next_pair + max_pairs + 1].key);
             } else {
                 range_to_delete.right = item.range.right;
             }
@@ -351,6 +363,9 @@ void apply_multi_key_item(
                 &mod_reports, &range_deleted);
             guarantee(range_deleted.right == range_to_delete.right
                 || res == continue_bool_t::CONTINUE);
+            max_pairs = mod_reports.empty()
+                ? MAX_PAIRS_PER_EMPTY_RANGE_TXN
+                : MAX_CHANGES_PER_TXN / 2;
 
             /* Apply any pairs from the item that fall within the deleted region */
             while (next_pair < item.pairs.size() &&
@@ -389,6 +404,9 @@ continue_bool_t store_t::receive_backfill(
         THROWS_ONLY(interrupted_exc_t) {
     guarantee(_region.beg == get_region().beg && _region.end == get_region().end);
 
+    // The backfill changes the data without telling the cache what changed.
+    read_result_cache_t::suspension_t result_cache_suspension(&read_result_cache);
+
     unsaved_data_limiter_t unsaved_data_limiter(general_cache_conn.get());
     receive_backfill_info_t info(
         general_cache_conn.get(), btree.get(), &unsaved_data_limiter);
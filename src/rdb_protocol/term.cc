@@ -273,13 +273,14 @@ scoped_ptr_t<val_t> runtime_term_t::eval_on_current_stack(
     if (env->env->interruptor->is_pulsed()) {
         throw interrupted_exc_t();
     }
-    env->env->maybe_yield();
     INC_DEPTH;
 
 #ifdef INSTRUMENT
     try {
 #endif // INSTRUMENT
         try {
+            // This can fail the query if it went over its CPU time limit.
+            env->env->maybe_yield();
             scoped_ptr_t<val_t> ret = term_eval(env, eval_flags);
             DEC_DEPTH;
             DBG("%s returned %s\n", name(), ret->print().c_str());
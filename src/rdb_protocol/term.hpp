@@ -33,6 +33,7 @@ class func_t;
 class scope_env_t;
 class table_t;
 class table_slice_t;
+class term_program_t;
 class var_captures_t;
 class compile_env_t;
 class deterministic_t;
@@ -81,6 +82,12 @@ public:
     // in sindex_manager.
     virtual bool is_simple_selector() const { return false; }
 
+    // Appends instructions that evaluate this term to `program`, see
+    // term_program.hpp.  Returns false if the term can't be compiled.
+    virtual bool compile(UNUSED term_program_t *program) const {
+        return false;
+    }
+
 protected:
     // Union term is a friend so we can steal arguments from an array in an optarg.
     friend class union_term_t;
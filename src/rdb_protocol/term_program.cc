@@ -0,0 +1,176 @@
+// Copyright 2010-2015 RethinkDB, all rights reserved.
+#include "rdb_protocol/term_program.hpp"
+
+#include <limits>
+#include <utility>
+
+#include "rdb_protocol/error.hpp"
+
+namespace ql {
+
+term_program_t::term_program_t(std::vector<sym_t> _arg_names,
+                               bool _implicit_is_first_arg)
+    : arg_names(std::move(_arg_names)),
+      implicit_is_first_arg(_implicit_is_first_arg),
+      stack_size(0) { }
+
+bool term_program_t::push_var(sym_t var) {
+    for (size_t i = 0; i < arg_names.size(); ++i) {
+        if (arg_names[i].value == var.value) {
+            return append(opcode_t::PUSH_ARG, 0, i);
+        }
+    }
+    // The variable is from an enclosing scope.
+    return false;
+}
+
+bool term_program_t::push_implicit_var() {
+    return implicit_is_first_arg && append(opcode_t::PUSH_ARG, 0, 0);
+}
+
+bool term_program_t::push_datum(datum_t datum) {
+    datums.push_back(std::move(datum));
+    return append(opcode_t::PUSH_DATUM, 0, datums.size() - 1);
+}
+
+bool term_program_t::get_field() {
+    return append(opcode_t::GET_FIELD, 2, 0);
+}
+
+bool term_program_t::compare(bool (*pred)(const datum_t &, const datum_t &),
+                             bool invert,
+                             size_t num_args) {
+    if (num_args == 0 || !append(opcode_t::COMPARE, num_args, num_args)) {
+        return false;
+    }
+    instructions.back().pred = pred;
+    instructions.back().invert = invert;
+    return true;
+}
+
+bool term_program_t::logical_not() {
+    return append(opcode_t::NOT, 1, 0);
+}
+
+bool term_program_t::logical_and(size_t num_args) {
+    return append(opcode_t::AND, num_args, num_args);
+}
+
+bool term_program_t::logical_or(size_t num_args) {
+    return append(opcode_t::OR, num_args, num_args);
+}
+
+bool term_program_t::is_complete() const {
+    return stack_size == 1;
+}
+
+bool term_program_t::append(opcode_t opcode, size_t num_pops, size_t operand) {
+    if (num_pops > stack_size
+        || stack_size - num_pops + 1 > MAX_STACK_SIZE
+        || operand > std::numeric_limits<uint32_t>::max()) {
+        return false;
+    }
+    stack_size = stack_size - num_pops + 1;
+    instruction_t instruction;
+    instruction.opcode = opcode;
+    instruction.invert = false;
+    instruction.operand = static_cast<uint32_t>(operand);
+    instruction.pred = nullptr;
+    instructions.push_back(instruction);
+    return true;
+}
+
+datum_t term_program_t::run(const std::vector<datum_t> &args) const {
+    rassert(is_complete());
+    if (args.size() != arg_names.size()) {
+        return datum_t();
+    }
+    datum_t stack[MAX_STACK_SIZE];
+    size_t size = 0;
+    try {
+        for (const instruction_t &instruction : instructions) {
+            if (!run_instruction(instruction, args, stack, &size)) {
+                return datum_t();
+            }
+        }
+    } catch (const base_exc_t &) {
+        // Evaluating the body will produce the error again, with a backtrace.
+        return datum_t();
+    }
+    rassert(size == 1);
+    return std::move(stack[0]);
+}
+
+bool term_program_t::run_instruction(const instruction_t &instruction,
+                                     const std::vector<datum_t> &args,
+                                     datum_t *stack,
+                                     size_t *stack_size_inout) const {
+    size_t &size = *stack_size_inout;
+    switch (instruction.opcode) {
+    case opcode_t::PUSH_ARG:
+        stack[size] = args[instruction.operand];
+        ++size;
+        return true;
+    case opcode_t::PUSH_DATUM:
+        stack[size] = datums[instruction.operand];
+        ++size;
+        return true;
+    case opcode_t::GET_FIELD: {
+        const datum_t &obj = stack[size - 2];
+        const datum_t &key = stack[size - 1];
+        if (obj.get_type() != datum_t::R_OBJECT || key.get_type() != datum_t::R_STR
+            || obj.is_ptype()) {
+            // `get_field` does other things with other types, like mapping over
+            // arrays, and rejects pseudotypes like times.
+            return false;
+        }
+        datum_t value = obj.get_field(key.as_str(), NOTHROW);
+        if (!value.has()) {
+            return false;
+        }
+        size -= 2;
+        stack[size] = std::move(value);
+        ++size;
+        return true;
+    }
+    case opcode_t::COMPARE: {
+        const size_t first = size - instruction.operand;
+        bool result = true;
+        for (size_t i = first + 1; i < size; ++i) {
+            if (!instruction.pred(stack[i - 1], stack[i])) {
+                result = false;
+                break;
+            }
+        }
+        size = first;
+        stack[size] = datum_t::boolean(result != instruction.invert);
+        ++size;
+        return true;
+    }
+    case opcode_t::NOT:
+        stack[size - 1] = datum_t::boolean(!stack[size - 1].as_bool());
+        return true;
+    case opcode_t::AND: // fallthru
+    case opcode_t::OR: {
+        // `r.and` returns the first false value or the last one, `r.or` the first
+        // true value or the last one.
+        const bool stop_at = instruction.opcode == opcode_t::OR;
+        const size_t first = size - instruction.operand;
+        datum_t result = datum_t::boolean(!stop_at);
+        for (size_t i = first; i < size; ++i) {
+            result = std::move(stack[i]);
+            if (result.as_bool() == stop_at) {
+                break;
+            }
+        }
+        size = first;
+        stack[size] = std::move(result);
+        ++size;
+        return true;
+    }
+    default:
+        unreachable();
+    }
+}
+
+}  // namespace ql
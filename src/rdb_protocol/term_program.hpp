@@ -0,0 +1,96 @@
+// Copyright 2010-2015 RethinkDB, all rights reserved.
+#ifndef RDB_PROTOCOL_TERM_PROGRAM_HPP_
+#define RDB_PROTOCOL_TERM_PROGRAM_HPP_
+
+#include <stdint.h>
+
+#include <vector>
+
+#include "rdb_protocol/datum.hpp"
+#include "rdb_protocol/sym.hpp"
+
+namespace ql {
+
+/* A `term_program_t` is what the body of a function compiles to if all of its terms
+are simple enough to be evaluated on the function's arguments alone, without a scope,
+an environment or `val_t`s.  That's the case for the field lookups, comparisons and
+boolean operators that most `filter` and `map` functions consist of.  The terms are
+compiled (by `term_t::compile()`) into instructions of a small stack machine, in the
+order in which the terms would evaluate their arguments.
+
+Running a program either produces the same datum that evaluating the body would have
+produced, or it fails, for example because a field is missing.  Then the body has to
+be evaluated as usual, which also produces whatever error there is.  Instructions
+don't have side effects, so evaluating the body after a program failed is safe. */
+class term_program_t {
+public:
+    // `implicit_is_first_arg` says whether `r.row` refers to the first argument.
+    term_program_t(std::vector<sym_t> arg_names, bool implicit_is_first_arg);
+
+    // These append instructions, and return false if the program can't express what
+    // they are asked to do.
+
+    // Pushes the argument named `var`.
+    MUST_USE bool push_var(sym_t var);
+    // Pushes the argument that `r.row` refers to.
+    MUST_USE bool push_implicit_var();
+    MUST_USE bool push_datum(datum_t datum);
+    // Pops a key and an object, and pushes the object's field with that key.
+    MUST_USE bool get_field();
+    // Pops `num_args` values and pushes whether `pred` (inverted if `invert` is true)
+    // holds for every neighbouring pair of them, like the comparison terms do.
+    MUST_USE bool compare(bool (*pred)(const datum_t &, const datum_t &),
+                          bool invert,
+                          size_t num_args);
+    MUST_USE bool logical_not();
+    // Pop `num_args` values and push what `r.and` or `r.or` would return for them.
+    MUST_USE bool logical_and(size_t num_args);
+    MUST_USE bool logical_or(size_t num_args);
+
+    // Whether the instructions leave exactly one value on the stack.
+    bool is_complete() const;
+
+    // Returns an empty datum if the program failed.
+    datum_t run(const std::vector<datum_t> &args) const;
+
+private:
+    static const size_t MAX_STACK_SIZE = 16;
+
+    enum class opcode_t : uint8_t {
+        PUSH_ARG,
+        PUSH_DATUM,
+        GET_FIELD,
+        COMPARE,
+        NOT,
+        AND,
+        OR
+    };
+
+    struct instruction_t {
+        opcode_t opcode;
+        bool invert;
+        // Which argument or datum to push, or how many values to pop.
+        uint32_t operand;
+        bool (*pred)(const datum_t &, const datum_t &);
+    };
+
+    bool append(opcode_t opcode, size_t num_pops, size_t operand);
+    bool run_instruction(const instruction_t &instruction,
+                         const std::vector<datum_t> &args,
+                         datum_t *stack,
+                         size_t *stack_size) const;
+
+    const std::vector<sym_t> arg_names;
+    const bool implicit_is_first_arg;
+
+    std::vector<instruction_t> instructions;
+    std::vector<datum_t> datums;
+    // How many values the instructions leave on the stack.
+    size_t stack_size;
+
+    DISABLE_COPYING(term_program_t);
+};
+
+}  // namespace ql
+
+#endif  // RDB_PROTOCOL_TERM_PROGRAM_HPP_
@@ -229,20 +229,33 @@ bool term_storage_t::static_optarg_as_bool(UNUSED const std::string &key,
     unreachable();
 }
 
+optional<std::string> term_storage_t::static_optarg_as_string(
+        UNUSED const std::string &key) const {
+    r_sanity_check(false, "static_optarg_as_string() is unimplemented "
+                   "for this term_storage_t type");
+    unreachable();
+}
+
 global_optargs_t term_storage_t::global_optargs() {
     r_sanity_check(false, "global_optargs() is unimplemented "
                    "for this term_storage_t type");
     unreachable();
 }
 
+const rapidjson::Value *term_storage_t::root_term_json() const {
+    return nullptr;
+}
+
 const backtrace_registry_t &term_storage_t::backtrace_registry() const {
     return bt_reg;
 }
 
-json_term_storage_t::json_term_storage_t(scoped_array_t<char> &&_original_data,
+json_term_storage_t::json_term_storage_t(counted_t<shared_buf_t> &&_original_data,
                                          rapidjson::Document &&_query_json) :
         original_data(std::move(_original_data)),
-        query_json(std::move(_query_json)) {
+        query_json(std::move(_query_json)),
+        tracked_memory(memory_tag_t::query_terms) {
+    update_tracked_memory();
     // We throw `bt_exc_t`s here because we cannot use backtrace IDs until the
     // `preprocess` step has completed.
     if (!query_json.IsArray()) {
@@ -288,6 +301,14 @@ Query::QueryType json_term_storage_t::query_type() const {
 void json_term_storage_t::preprocess() {
     r_sanity_check(query_json.Size() >= 2);
     preprocess_term_tree(&query_json[1], &query_json.GetAllocator(), &bt_reg);
+    // Preprocessing adds terms to the JSON.
+    update_tracked_memory();
+}
+
+void json_term_storage_t::update_tracked_memory() {
+    tracked_memory.set_size(
+        (original_data.has() ? original_data->size() : 0)
+        + query_json.GetAllocator().Capacity());
 }
 
 raw_term_t json_term_storage_t::root_term() const {
@@ -295,11 +316,16 @@ raw_term_t json_term_storage_t::root_term() const {
     return raw_term_t(&query_json[1]);
 }
 
-bool json_term_storage_t::static_optarg_as_bool(const std::string &key,
-                                                bool default_value) const {
+const rapidjson::Value *json_term_storage_t::root_term_json() const {
+    r_sanity_check(query_json.Size() >= 2);
+    return &query_json[1];
+}
+
+const rapidjson::Value *json_term_storage_t::static_optarg(
+        const std::string &key) const {
     r_sanity_check(query_json.IsArray());
     if (query_json.Size() < 3) {
-        return default_value;
+        return nullptr;
     }
 
     const rapidjson::Value *_global_optargs = &query_json[2];
@@ -307,19 +333,33 @@ bool json_term_storage_t::static_optarg_as_bool(const std::string &key,
 
     const auto it = _global_optargs->FindMember(key.c_str());
     if (it == _global_optargs->MemberEnd()) {
-        return default_value;
-    } else if (it->value.IsBool()) {
-        return it->value.GetBool();
-    } else if (!it->value.IsArray() ||
-               it->value.Size() != 2 ||
+        return nullptr;
+    } else if (!it->value.IsArray()) {
+        return &it->value;
+    } else if (it->value.Size() != 2 ||
                !it->value[0].IsNumber() ||
                static_cast<Term::TermType>(it->value[0].GetInt()) != Term::DATUM) {
-        return default_value;
-    } else if (!it->value[1].IsBool()) {
+        return nullptr;
+    }
+    return &it->value[1];
+}
+
+bool json_term_storage_t::static_optarg_as_bool(const std::string &key,
+                                                bool default_value) const {
+    const rapidjson::Value *value = static_optarg(key);
+    if (value == nullptr || !value->IsBool()) {
         return default_value;
     }
-    return it->value[1].GetBool();
+    return value->GetBool();
+}
 
+optional<std::string> json_term_storage_t::static_optarg_as_string(
+        const std::string &key) const {
+    const rapidjson::Value *value = static_optarg(key);
+    if (value == nullptr || !value->IsString()) {
+        return optional<std::string>();
+    }
+    return make_optional(std::string(value->GetString(), value->GetStringLength()));
 }
 
 global_optargs_t json_term_storage_t::global_optargs() {
@@ -552,7 +592,13 @@ MUST_USE archive_result_t deserialize_term_tree<cluster_version_t::v2_4>(
 }
 
 template <>
-MUST_USE archive_result_t deserialize_term_tree<cluster_version_t::v2_5_is_latest>(
+MUST_USE archive_result_t deserialize_term_tree<cluster_version_t::v2_5>(
+        read_stream_t *s, scoped_ptr_t<term_storage_t> *term_storage_out) {
+    return deserialize_term_tree<cluster_version_t::v2_2>(s, term_storage_out);
+}
+
+template <>
+MUST_USE archive_result_t deserialize_term_tree<cluster_version_t::v2_6_is_latest>(
         read_stream_t *s, scoped_ptr_t<term_storage_t> *term_storage_out) {
     return deserialize_term_tree<cluster_version_t::v2_2>(s, term_storage_out);
 }
@@ -11,6 +11,8 @@
 
 #include "containers/counted.hpp"
 #include "containers/scoped.hpp"
+#include "containers/shared_buffer.hpp"
+#include "perfmon/memory.hpp"
 #include "rapidjson/rapidjson.h"
 #include "rdb_protocol/rdb_backtrace.hpp"
 #include "rdb_protocol/datum.hpp"
@@ -131,26 +133,38 @@ public:
     virtual Query::QueryType query_type() const;
     virtual bool static_optarg_as_bool(const std::string &key,
                                        bool default_value) const;
+    virtual optional<std::string> static_optarg_as_string(const std::string &key) const;
     virtual void preprocess();
     virtual global_optargs_t global_optargs();
 
+    // The JSON of the root term, or null if the terms don't come from JSON.
+    virtual const rapidjson::Value *root_term_json() const;
+
 protected:
     backtrace_registry_t bt_reg;
 };
 
 class json_term_storage_t : public term_storage_t {
 public:
-    json_term_storage_t(scoped_array_t<char> &&_original_data,
+    json_term_storage_t(counted_t<shared_buf_t> &&_original_data,
                         rapidjson::Document &&_query_json);
     Query::QueryType query_type() const;
     bool static_optarg_as_bool(const std::string &key,
                                bool default_value) const;
+    optional<std::string> static_optarg_as_string(const std::string &key) const;
     void preprocess();
     raw_term_t root_term() const;
     global_optargs_t global_optargs();
+    const rapidjson::Value *root_term_json() const;
 private:
-    scoped_array_t<char> original_data;
+    // The value of the global optarg `key` if it is a literal, or `nullptr`.
+    const rapidjson::Value *static_optarg(const std::string &key) const;
+    void update_tracked_memory();
+
+    // The query was parsed in place, so `query_json` points into this.
+    counted_t<shared_buf_t> original_data;
     rapidjson::Document query_json;
+    tracked_memory_t tracked_memory;
 };
 
 class wire_term_storage_t : public term_storage_t {
@@ -139,8 +139,9 @@ private:
             if (args != nullptr) {
                 r_sanity_check(args->IsArray());
                 for (size_t i = 0; i < args->Size(); ++i) {
-                    backtrace_id_t child_bt
-                        = make_bt(bt, datum_t(static_cast<double>(i)));
+                    backtrace_id_t child_bt = parent->bt_reg == nullptr
+                        ? backtrace_id_t::empty()
+                        : parent->bt_reg->new_arg_frame(bt, i);
                     walker_frame_t child_frame(parent, i == 0, this);
                     call_with_enough_stack([&]() {
                             child_frame.walk(&(*args)[i], child_bt);
@@ -152,9 +153,10 @@ private:
                 r_sanity_check(optargs->IsObject());
                 for (auto it = optargs->MemberBegin();
                      it != optargs->MemberEnd(); ++it) {
-                    backtrace_id_t child_bt = make_bt(bt,
-                        datum_t(datum_string_t(it->name.GetStringLength(),
-                                               it->name.GetString())));
+                    backtrace_id_t child_bt = parent->bt_reg == nullptr
+                        ? backtrace_id_t::empty()
+                        : parent->bt_reg->new_optarg_frame(
+                            bt, it->name.GetString(), it->name.GetStringLength());
                     walker_frame_t child_frame(parent, false, this);
                     call_with_enough_stack([&]() {
                             child_frame.walk(&it->value, child_bt);
@@ -163,13 +165,6 @@ private:
             }
         }
 
-        backtrace_id_t make_bt(backtrace_id_t prev, const datum_t &d) {
-            if (parent->bt_reg == nullptr) {
-                return backtrace_id_t::empty();
-            }
-            return parent->bt_reg->new_frame(prev, d);
-        }
-
         // True if writes are still legal at this node.  Basically:
         // * Once writes become illegal, they are never legal again.
         // * Writes are legal at the root.
@@ -204,6 +199,26 @@ void preprocess_global_optarg(rapidjson::Value *term_tree,
     term_walker.walk(term_tree);
 }
 
+optional<raw_term_t> find_write_or_meta_term(const raw_term_t &term) {
+    if (term_is_write_or_meta(term.type())) {
+        return make_optional(term);
+    }
+    optional<raw_term_t> res;
+    for (size_t i = 0; i < term.num_args() && !res; ++i) {
+        call_with_enough_stack([&]() {
+                res = find_write_or_meta_term(term.arg(i));
+            }, MIN_WALK_STACK_SPACE);
+    }
+    term.each_optarg([&](const raw_term_t &optarg, const std::string &) {
+            if (!res) {
+                call_with_enough_stack([&]() {
+                        res = find_write_or_meta_term(optarg);
+                    }, MIN_WALK_STACK_SPACE);
+            }
+        });
+    return res;
+}
+
 bool term_type_is_valid(Term::TermType type) {
     switch (type) {
     case Term::UPDATE:
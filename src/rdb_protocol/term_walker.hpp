@@ -2,11 +2,13 @@
 #ifndef RDB_PROTOCOL_TERM_WALKER_HPP_
 #define RDB_PROTOCOL_TERM_WALKER_HPP_
 
+#include "containers/optional.hpp"
 #include "rapidjson/document.h"
 
 namespace ql {
 
 class backtrace_registry_t;
+class raw_term_t;
 
 // `preprocess_term_tree(...)` walks the raw term tree provided, edits it to add
 // backtraces, and checks the validity of the terms and their placement.
@@ -24,6 +26,11 @@ void preprocess_term_tree(rapidjson::Value *query_json,
 void preprocess_global_optarg(rapidjson::Value *optarg,
                               rapidjson::Value::AllocatorType *allocator);
 
+// `find_write_or_meta_term(...)` returns the first term in the tree that writes or is a
+// meta operation, if there is one.  Queries run with `explain` may not contain any,
+// since explaining a query evaluates it up to the point where it would read.
+optional<raw_term_t> find_write_or_meta_term(const raw_term_t &term);
+
 } // namespace ql
 
 #endif // RDB_PROTOCOL_TERM_WALKER_HPP_
@@ -6,6 +6,7 @@
 #include "rdb_protocol/error.hpp"
 #include "rdb_protocol/func.hpp"
 #include "rdb_protocol/op.hpp"
+#include "rdb_protocol/term_program.hpp"
 
 namespace ql {
 
@@ -17,6 +18,11 @@ class and_term_t : public op_term_t {
 public:
     and_term_t(compile_env_t *env, const raw_term_t &term)
         : op_term_t(env, term, argspec_t(0, -1)) { }
+
+    bool compile(term_program_t *program) const final {
+        return compile_args(program)
+            && program->logical_and(get_original_args().size());
+    }
 private:
     virtual scoped_ptr_t<val_t> eval_impl(
         scope_env_t *env, args_t *args, eval_flags_t) const {
@@ -34,6 +40,11 @@ class or_term_t : public op_term_t {
 public:
     or_term_t(compile_env_t *env, const raw_term_t &term)
         : op_term_t(env, term, argspec_t(0, -1)) { }
+
+    bool compile(term_program_t *program) const final {
+        return compile_args(program)
+            && program->logical_or(get_original_args().size());
+    }
 private:
     virtual scoped_ptr_t<val_t> eval_impl(
         scope_env_t *env, args_t *args, eval_flags_t) const {
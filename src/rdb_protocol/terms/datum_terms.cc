@@ -4,6 +4,7 @@
 #include <string>
 
 #include "rdb_protocol/op.hpp"
+#include "rdb_protocol/term_program.hpp"
 
 namespace ql {
 
@@ -22,6 +23,10 @@ public:
         return false;
     }
 
+    bool compile(term_program_t *program) const final {
+        return program->push_datum(datum);
+    }
+
 private:
     virtual void accumulate_captures(var_captures_t *) const { /* do nothing */ }
     virtual deterministic_t is_deterministic() const {
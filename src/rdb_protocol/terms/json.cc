@@ -40,19 +40,17 @@ public:
             }
             str_buf[data.size()] = '\0';
 
-            rapidjson::Document json;
-            // Note: Insitu will cause some parts of `json` to directly point into
-            // `str_buf`. `str_buf`'s life time must be at least as long as `json`'s.
-            json.ParseInsitu(str_buf.data());
+            rapidjson::ParseErrorCode error = rapidjson::kParseErrorNone;
+            datum_t res = parse_json_to_datum_insitu(str_buf.data(),
+                                                     env->env->limits(), &error);
 
-            rcheck(!json.HasParseError(), base_exc_t::LOGIC,
+            rcheck(res.has(), base_exc_t::LOGIC,
                    strprintf("Failed to parse \"%s\" as JSON: %s",
                        (data.size() > 40
                         ? (data.to_std().substr(0, 37) + "...").c_str()
                         : data.to_std().c_str()),
-                       rapidjson::GetParseError_En(json.GetParseError())));
-            return new_val(to_datum(json, env->env->limits(),
-                                    env->env->reql_version()));
+                       rapidjson::GetParseError_En(error)));
+            return new_val(std::move(res));
         }
     }
 
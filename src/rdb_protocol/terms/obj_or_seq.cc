@@ -10,6 +10,7 @@
 #include "rdb_protocol/pathspec.hpp"
 #include "rdb_protocol/pseudo_literal.hpp"
 #include "rdb_protocol/minidriver.hpp"
+#include "rdb_protocol/term_program.hpp"
 #include "rdb_protocol/term_walker.hpp"
 #include "rdb_protocol/terms/arr.hpp"
 #include "rdb_protocol/terms/obj_or_seq.hpp"
@@ -281,6 +282,10 @@ public:
         return recursive_is_simple_selector();
     }
 
+    bool compile(term_program_t *program) const final {
+        return compile_args(program) && program->get_field();
+    }
+
 private:
     virtual scoped_ptr_t<val_t> obj_eval(
         scope_env_t *env, args_t *args, const scoped_ptr_t<val_t> &v0) const {
@@ -301,6 +306,10 @@ public:
         return recursive_is_simple_selector();
     }
 
+    bool compile(term_program_t *program) const final {
+        return compile_args(program) && program->get_field();
+    }
+
 private:
     scoped_ptr_t<val_t> obj_eval_dereferenced(
         const scoped_ptr_t<val_t> &v0, const scoped_ptr_t<val_t> &v1) const {
@@ -2,6 +2,7 @@
 #include "rdb_protocol/terms/terms.hpp"
 
 #include "rdb_protocol/op.hpp"
+#include "rdb_protocol/term_program.hpp"
 
 namespace ql {
 
@@ -63,6 +64,11 @@ public:
         }
         guarantee(namestr && pred);
     }
+
+    bool compile(term_program_t *program) const final {
+        return compile_args(program)
+            && program->compare(pred, invert, get_original_args().size());
+    }
 private:
     virtual scoped_ptr_t<val_t> eval_impl(
         scope_env_t *env, args_t *args, eval_flags_t) const {
@@ -86,6 +92,10 @@ class not_term_t : public op_term_t {
 public:
     not_term_t(compile_env_t *env, const raw_term_t &term)
         : op_term_t(env, term, argspec_t(1)) { }
+
+    bool compile(term_program_t *program) const final {
+        return compile_args(program) && program->logical_not();
+    }
 private:
     virtual scoped_ptr_t<val_t> eval_impl(scope_env_t *env, args_t *args, eval_flags_t) const {
         return new_val_bool(!args->arg(env, 0)->as_bool());
@@ -679,7 +679,8 @@ class between_term_t : public bounded_op_term_t {
 public:
     between_term_t(compile_env_t *env, const raw_term_t &term,
                    between_null_t _null_behavior)
-        : bounded_op_term_t(env, term, argspec_t(3), optargspec_t({"index"})),
+        : bounded_op_term_t(env, term, argspec_t(3),
+                            optargspec_t({"index", "skip_scan"})),
           null_behavior(_null_behavior) { }
 private:
     datum_t check_bound(scoped_ptr_t<val_t> bound_val,
@@ -712,14 +713,25 @@ private:
             optional<std::string> old_idx = tbl_slice->get_idx();
             idx = old_idx ? *old_idx : tbl_slice->get_tbl()->get_pkey();
         }
+        datum_range_t range(
+            lb, left_open ? key_range_t::open : key_range_t::closed,
+            rb, right_open ? key_range_t::open : key_range_t::closed);
+
+        scoped_ptr_t<val_t> skip_scan = args->optarg(env, "skip_scan");
+        if (skip_scan.has() && skip_scan->as_bool()) {
+            rcheck(idx != tbl_slice->get_tbl()->get_pkey(), base_exc_t::LOGIC,
+                   "`skip_scan` can only be used with a secondary index.");
+            rcheck(lb.get_type() == datum_t::R_ARRAY && lb.arr_size() >= 2
+                   && rb.get_type() == datum_t::R_ARRAY && rb.arr_size() >= 2,
+                   base_exc_t::LOGIC,
+                   "The bounds of BETWEEN must be arrays of at least two elements "
+                   "when using `skip_scan`.");
+            range = range.with_skip_scan();
+        }
         return new_val(
             // `table_slice_t` can handle emtpy / invalid `datum_range_t`'s, checking is
             // done there.
-            tbl_slice->with_bounds(
-                idx,
-                datum_range_t(
-                    lb, left_open ? key_range_t::open : key_range_t::closed,
-                    rb, right_open ? key_range_t::open : key_range_t::closed)));
+            tbl_slice->with_bounds(idx, std::move(range)));
     }
     virtual const char *name() const { return "between"; }
 
@@ -154,7 +154,8 @@ ql::datum_t sindex_status_to_datum(
 class sindex_create_term_t : public op_term_t {
 public:
     sindex_create_term_t(compile_env_t *env, const raw_term_t &term)
-        : op_term_t(env, term, argspec_t(2, 3), optargspec_t({"multi", "geo"})) { }
+        : op_term_t(env, term, argspec_t(2, 3),
+                    optargspec_t({"multi", "geo", "where"})) { }
 
     virtual scoped_ptr_t<val_t> eval_impl(
         scope_env_t *env, args_t *args, eval_flags_t) const {
@@ -170,9 +171,9 @@ public:
         sindex_config_t config;
         config.multi = sindex_multi_bool_t::SINGLE;
         config.geo = sindex_geo_bool_t::REGULAR;
+        bool got_func = false;
         if (args->num_args() == 3) {
             scoped_ptr_t<val_t> v = args->arg(env, 2);
-            bool got_func = false;
             if (v->get_type().is_convertible(val_t::type_t::DATUM)) {
                 datum_t d = v->as_datum();
                 if (d.get_type() == datum_t::R_BINARY) {
@@ -203,6 +204,31 @@ public:
             config.func_version = reql_version_t::LATEST;
         }
 
+        /* A partial index only holds the rows that `where` accepts.  Rows that the
+        index function fails on don't get indexed, so we wrap the index function in one
+        that fails on every other row. */
+        if (scoped_ptr_t<val_t> where_val = args->optarg(env, "where")) {
+            // This produces a type error if `where` isn't a function.
+            where_val->as_func();
+            rcheck(!got_func, base_exc_t::LOGIC,
+                   "Cannot use `where` with an index function from `index_status`.");
+            minidriver_t r(backtrace());
+            auto x = minidriver_t::dummy_var_t::SINDEXCREATE_X;
+            minidriver_t::reql_t mapping = args->num_args() == 3
+                ? r.expr(get_src().arg(2))(r.var(x))
+                : r.var(x)[name_datum];
+            minidriver_t::reql_t where = r.expr(*get_src().optarg("where"));
+            minidriver_t::reql_t partial_func = r.fun(x,
+                r.branch(where(r.var(x)),
+                         mapping,
+                         r.error(std::string("Row is not in the partial index."))));
+
+            compile_env_t compile_env(env->scope.compute_visibility());
+            counted_t<func_term_t> func_term =
+                make_counted<func_term_t>(&compile_env, partial_func.root_term());
+            config.func = ql::map_wire_func_t(func_term->eval_to_func(env->scope));
+        }
+
         config.func.compile_wire_func()->assert_deterministic(
                 constant_now_t::no,
                 "Index functions must be deterministic.");
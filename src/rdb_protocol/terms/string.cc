@@ -66,7 +66,7 @@ private:
         std::shared_ptr<re2::RE2> regexp;
         regex_cache_t &cache = env->env->regex_cache();
         std::shared_ptr<re2::RE2> *found;
-        if (!cache.regexes.lookup(re, &found)) {
+        if (!cache.lookup(re, &found)) {
             regexp.reset(new re2::RE2(re, re2::RE2::Quiet));
             if (!regexp->ok()) {
                 rfail(base_exc_t::LOGIC,
@@ -75,7 +75,7 @@ private:
                       regexp->error_arg().c_str(),
                       regexp->error().c_str());
             }
-            cache.regexes.insert(re, regexp);
+            cache.insert(re, regexp);
         } else {
             regexp = *found;
         }
@@ -444,26 +444,7 @@ private:
                 break;
             default: unreachable();
             }
-            if (ts->bounds.left_bound.get_type() == datum_t::type_t::MINVAL) {
-                b |= info.add("left_bound_type", datum_t("unbounded"));
-            } else if (ts->bounds.left_bound.get_type() == datum_t::type_t::MAXVAL) {
-                b |= info.add("left_bound_type", datum_t("unachievable"));
-            } else {
-                b |= info.add("left_bound", ts->bounds.left_bound);
-                b |= info.add("left_bound_type",
-                              datum_t(ts->bounds.left_bound_type == key_range_t::open
-                                      ? "open" : "closed"));
-            }
-            if (ts->bounds.right_bound.get_type() == datum_t::type_t::MAXVAL) {
-                b |= info.add("right_bound_type", datum_t("unbounded"));
-            } else if (ts->bounds.right_bound.get_type() == datum_t::type_t::MINVAL) {
-                b |= info.add("right_bound_type", datum_t("unachievable"));
-            } else {
-                b |= info.add("right_bound", ts->bounds.right_bound);
-                b |= info.add("right_bound_type",
-                              datum_t(ts->bounds.right_bound_type == key_range_t::open
-                                      ? "open" : "closed"));
-            }
+            ts->bounds.add_bounds_info(&info);
         } break;
         case SELECTION_TYPE: {
             b |= info.add("table",
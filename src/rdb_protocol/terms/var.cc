@@ -3,6 +3,7 @@
 
 #include "rdb_protocol/error.hpp"
 #include "rdb_protocol/op.hpp"
+#include "rdb_protocol/term_program.hpp"
 #include "math.hpp"
 
 namespace ql {
@@ -30,6 +31,10 @@ public:
         return true;
     }
 
+    bool compile(term_program_t *program) const final {
+        return program->push_var(varname);
+    }
+
 private:
     virtual void accumulate_captures(var_captures_t *captures) const {
         captures->vars_captured.insert(varname);
@@ -63,6 +68,10 @@ public:
         return true;
     }
 
+    bool compile(term_program_t *program) const final {
+        return program->push_implicit_var();
+    }
+
 private:
     virtual void accumulate_captures(var_captures_t *captures) const {
         captures->implicit_is_captured = true;
@@ -1,9 +1,11 @@
 // Copyright 2010-2015 RethinkDB, all rights reserved.
 
+#include <exception>
 #include <string>
 #include <utility>
 #include <vector>
 
+#include "concurrency/pmap.hpp"
 #include "rdb_protocol/error.hpp"
 #include "rdb_protocol/func.hpp"
 #include "rdb_protocol/minidriver.hpp"
@@ -90,14 +92,38 @@ public:
                                   "return_changes", "ignore_write_hook"})) { }
 
 private:
+    /* Generates the UUIDs for all the documents in `datums` that will need a primary
+    key in one go. `maybe_generate_key` takes them from the back of `uuids_out`. */
+    static void generate_uuids_for_batch(const counted_t<table_t> &tbl,
+                                         const std::vector<datum_t> &datums,
+                                         std::vector<uuid_u> *uuids_out) {
+        const datum_string_t pkey(tbl->get_pkey());
+        size_t count = 0;
+        for (const datum_t &d : datums) {
+            if (d.get_type() == datum_t::R_OBJECT && !d.get_field(pkey, NOTHROW).has()) {
+                ++count;
+            }
+        }
+        uuids_out->resize(count);
+        generate_uuids(uuids_out->data(), count);
+    }
+
     static void maybe_generate_key(counted_t<table_t> tbl,
                                    const configured_limits_t &limits,
+                                   std::vector<uuid_u> *uuids,
                                    std::vector<std::string> *generated_keys_out,
                                    size_t *keys_skipped_out,
                                    datum_t *datum_out,
                                    bool *pkey_was_autogenerated_out) {
         if (!(*datum_out).get_field(datum_string_t(tbl->get_pkey()), NOTHROW).has()) {
-            std::string key = uuid_to_str(generate_uuid());
+            uuid_u id;
+            if (uuids->empty()) {
+                id = generate_uuid();
+            } else {
+                id = uuids->back();
+                uuids->pop_back();
+            }
+            std::string key = uuid_to_str(id);
             datum_t keyd((datum_string_t(key)));
             {
                 datum_object_builder_t d;
@@ -184,8 +210,9 @@ private:
             if (datums[0].get_type() == datum_t::R_OBJECT) {
                 try {
                     bool was_autogenerated;
-                    maybe_generate_key(t, env->env->limits(), &generated_keys,
-                                       &keys_skipped, &datums[0],
+                    std::vector<uuid_u> no_uuids;
+                    maybe_generate_key(t, env->env->limits(), &no_uuids,
+                                       &generated_keys, &keys_skipped, &datums[0],
                                        &was_autogenerated);
                     pkey_was_autogenerated[0] = was_autogenerated;
                 } catch (const base_exc_t &) {
@@ -211,29 +238,32 @@ private:
             counted_t<datum_stream_t> datum_stream = v1->as_seq(env->env);
 
             batchspec_t batchspec = batchspec_t::user(batch_type_t::TERMINAL, env->env);
-            for (;;) {
-                std::vector<datum_t> datums
-                    = datum_stream->next_batch(env->env, batchspec);
-                if (datums.empty()) {
-                    break;
-                }
-                std::vector<bool> pkey_was_autogenerated(datums.size());
-
+            auto next_batch = [&](std::vector<datum_t> *datums_out,
+                                  std::vector<bool> *pkey_was_autogenerated_out) {
+                *datums_out = datum_stream->next_batch(env->env, batchspec);
+                std::vector<datum_t> &datums = *datums_out;
+                pkey_was_autogenerated_out->assign(datums.size(), false);
+
+                std::vector<uuid_u> uuids;
+                generate_uuids_for_batch(t, datums, &uuids);
                 for (size_t i = 0; i < datums.size(); ++i) {
                     try {
                         bool was_autogenerated;
-                        maybe_generate_key(t, env->env->limits(), &generated_keys,
-                                           &keys_skipped, &datums[i],
+                        maybe_generate_key(t, env->env->limits(), &uuids,
+                                           &generated_keys, &keys_skipped, &datums[i],
                                            &was_autogenerated);
-                        pkey_was_autogenerated[i] = was_autogenerated;
+                        (*pkey_was_autogenerated_out)[i] = was_autogenerated;
                     } catch (const base_exc_t &) {
                         // We just ignore it, the same error will be handled in
                         // `replace`.  TODO: that solution sucks.
                     }
                 }
-
-                datum_t replace_stats = t->batched_insert(
-                    env->env,
+            };
+            auto insert_batch = [&](env_t *insert_env,
+                                    std::vector<datum_t> &&datums,
+                                    std::vector<bool> &&pkey_was_autogenerated) {
+                return t->batched_insert(
+                    insert_env,
                     std::move(datums),
                     std::move(pkey_was_autogenerated),
                     conflict_behavior,
@@ -241,6 +271,53 @@ private:
                     durability_requirement,
                     return_changes,
                     ignore_write_hook);
+            };
+
+            // A large insert from a stream is a pipeline: while one batch is being
+            // written, we fetch the next one.  The write gets an environment of its
+            // own, because the stream may be using ours.  Profiling needs the events
+            // of the query in order, so we don't overlap anything then.
+            std::vector<datum_t> datums;
+            std::vector<bool> pkey_was_autogenerated;
+            next_batch(&datums, &pkey_was_autogenerated);
+            while (!datums.empty()) {
+                datum_t replace_stats;
+                if (env->env->trace != nullptr) {
+                    replace_stats = insert_batch(env->env, std::move(datums),
+                                                 std::move(pkey_was_autogenerated));
+                    next_batch(&datums, &pkey_was_autogenerated);
+                } else {
+                    std::vector<datum_t> next_datums;
+                    std::vector<bool> next_pkey_was_autogenerated;
+                    std::exception_ptr excs[2];
+                    pmap(2, [&](int i) {
+                        try {
+                            if (i == 0) {
+                                env_t insert_env(env->env->get_rdb_ctx(),
+                                                 env->env->return_empty_normal_batches,
+                                                 env->env->interruptor,
+                                                 env->env->get_serializable_env(),
+                                                 nullptr);
+                                replace_stats = insert_batch(
+                                    &insert_env, std::move(datums),
+                                    std::move(pkey_was_autogenerated));
+                            } else {
+                                next_batch(&next_datums, &next_pkey_was_autogenerated);
+                            }
+                        } catch (...) {
+                            excs[i] = std::current_exception();
+                        }
+                    });
+                    // A failed write takes precedence, because it's what we would
+                    // have run into first if we hadn't overlapped anything.
+                    for (const std::exception_ptr &exc : excs) {
+                        if (exc) {
+                            std::rethrow_exception(exc);
+                        }
+                    }
+                    datums = std::move(next_datums);
+                    pkey_was_autogenerated = std::move(next_pkey_was_autogenerated);
+                }
                 stats = stats.merge(
                     replace_stats, stats_merge, env->env->limits(), &conditions);
             }
@@ -339,6 +416,12 @@ private:
             stats = stats.merge(replace_stats, stats_merge, env->env->limits(),
                                 &conditions);
         } else {
+            const val_t::type_t::raw_type_t raw_type = v0->get_type().get_raw_type();
+            counted_t<table_slice_t> slice;
+            if (raw_type == val_t::type_t::TABLE
+                || raw_type == val_t::type_t::TABLE_SLICE) {
+                slice = v0->as_table_slice();
+            }
             counted_t<selection_t> tblrows = v0->as_selection(env->env);
             counted_t<table_t> tbl = tblrows->table;
             counted_t<datum_stream_t> ds = tblrows->seq;
@@ -349,6 +432,26 @@ private:
                     tbl->db->id,
                     tbl->get_id());
             }
+
+            /* If we're deleting a range of primary keys, the table can delete the rows
+            without us reading them first. */
+            datum_range_t bounds;
+            datum_t constant = f->constant_result();
+            if (slice.has()
+                && return_changes == return_changes_t::NO
+                && constant.has() && constant.get_type() == datum_t::R_NULL
+                && slice->get_primary_bounds(&bounds)
+                && !bounds.is_empty()) {
+                datum_t delete_stats = tbl->tbl->write_range_delete(
+                    env->env, bounds, durability_requirement, ignore_write_hook);
+                if (delete_stats.has()) {
+                    stats = stats.merge(delete_stats, stats_merge, env->env->limits(),
+                                        &conditions);
+                    datum_object_builder_t obj(stats);
+                    obj.add_warnings(conditions, env->env->limits());
+                    return new_val(std::move(obj).to_datum());
+                }
+            }
             if (f->is_deterministic().test(single_server_t::no, constant_now_t::yes)) {
                 // Attach a transformation to `ds` to pull out the primary key.
                 minidriver_t r(backtrace());
@@ -140,6 +140,14 @@ counted_t<datum_stream_t> table_slice_t::as_seq(
     return tbl->as_seq(env, idx ? *idx : tbl->get_pkey(), _bt, bounds, sorting);
 }
 
+bool table_slice_t::get_primary_bounds(datum_range_t *bounds_out) const {
+    if (idx && *idx != tbl->get_pkey()) {
+        return false;
+    }
+    *bounds_out = bounds;
+    return true;
+}
+
 counted_t<table_slice_t>
 table_slice_t::with_sorting(std::string _idx, sorting_t _sorting) {
     rcheck(sorting == sorting_t::UNORDERED, base_exc_t::LOGIC,
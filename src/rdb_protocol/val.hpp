@@ -129,6 +129,9 @@ public:
     counted_t<table_slice_t> with_bounds(std::string idx, datum_range_t bounds);
     const counted_t<table_t> &get_tbl() const { return tbl; }
     const optional<std::string> &get_idx() const { return idx; }
+    // If the slice is a range of primary keys, sets `*bounds_out` to that range and
+    // returns true.
+    bool get_primary_bounds(datum_range_t *bounds_out) const;
     ql::changefeed::keyspec_t::range_t get_range_spec();
 private:
     friend class info_term_t;
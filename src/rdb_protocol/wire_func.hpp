@@ -2,10 +2,12 @@
 #ifndef RDB_PROTOCOL_WIRE_FUNC_HPP_
 #define RDB_PROTOCOL_WIRE_FUNC_HPP_
 
+#include <utility>
 #include <vector>
 
 #include "containers/counted.hpp"
 #include "containers/optional.hpp"
+#include "rdb_protocol/order_util.hpp"
 #include "rdb_protocol/sym.hpp"
 #include "rdb_protocol/error.hpp"
 #include "rpc/serialize_macros.hpp"
@@ -123,6 +125,7 @@ public:
     group_wire_func_t(std::vector<counted_t<const func_t> > &&_funcs,
                       bool _append_index, bool _multi);
     std::vector<counted_t<const func_t> > compile_funcs() const;
+    size_t num_funcs() const { return funcs.size(); }
     bool should_append_index() const;
     bool is_multi() const;
     backtrace_id_t get_bt() const;
@@ -177,6 +180,25 @@ public:
     explicit max_wire_func_t(Args... args) : skip_wire_func_t(args...) { }
 };
 
+// Keeps the elements of a stream that can be among the first `n` once the stream is
+// sorted by `comparisons`, so that the shards can throw away everything else.  The
+// result is an unsorted array of at most `2 * n` elements, which still has to be cut
+// down with `lt_cmp_t::sort_prefix`.
+class top_k_wire_func_t {
+public:
+    top_k_wire_func_t() : n(0) { }
+    top_k_wire_func_t(
+        const std::vector<std::pair<order_direction_t, counted_t<const func_t> > >
+            &_comparisons,
+        uint64_t _n);
+    std::vector<std::pair<order_direction_t, counted_t<const func_t> > >
+    compile_comparisons() const;
+
+    std::vector<std::pair<order_direction_t, wire_func_t> > comparisons;
+    uint64_t n;
+};
+RDB_DECLARE_SERIALIZABLE_FOR_CLUSTER(top_k_wire_func_t);
+
 }  // namespace ql
 
 #endif  // RDB_PROTOCOL_WIRE_FUNC_HPP_
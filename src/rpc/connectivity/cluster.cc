@@ -16,11 +16,13 @@
 #include "concurrency/pmap.hpp"
 #include "concurrency/semaphore.hpp"
 #include "config/args.hpp"
+#include "containers/buffer_group.hpp"
 #include "containers/archive/vector_stream.hpp"
 #include "containers/archive/versioned.hpp"
 #include "containers/object_buffer.hpp"
 #include "containers/uuid.hpp"
 #include "logger.hpp"
+#include "rpc/connectivity/failure_detector.hpp"
 #include "rpc/semilattice/watchable.hpp"
 #include "stl_utils.hpp"
 #include "utils.hpp"
@@ -28,14 +30,20 @@
 // Number of messages after which the message handling loop yields
 #define MESSAGE_HANDLER_MAX_BATCH_SIZE           16
 
+// How long an incoming parallel stream waits for its connection to be set up, on top of
+// the join delay
+#define STREAM_ACCEPT_TIMEOUT_SECS               10
+
 // The cluster communication protocol version.
-static_assert(cluster_version_t::CLUSTER == cluster_version_t::v2_5_is_latest,
+static_assert(cluster_version_t::CLUSTER == cluster_version_t::v2_6_is_latest,
               "We need to update CLUSTER_VERSION_STRING when we add a new cluster "
               "version.");
 
-#define CLUSTER_VERSION_STRING "2.5.0"
+#define CLUSTER_VERSION_STRING "2.6.0"
 
 const std::string connectivity_cluster_t::cluster_proto_header("RethinkDB cluster\n");
+const std::string connectivity_cluster_t::cluster_stream_header(
+    "RethinkDB cluster stream\n");
 const std::string connectivity_cluster_t::cluster_version_string(CLUSTER_VERSION_STRING);
 
 // Returns true and sets *out to the version number, if the version number in
@@ -114,6 +122,29 @@ const std::string connectivity_cluster_t::cluster_build_mode("release");
 const std::string connectivity_cluster_t::cluster_build_mode("debug");
 #endif
 
+/* `stream_t` is one of the extra TCP connections of a `connection_t`.
+`run_t::run_stream()` creates it on the stream's thread, and sets `conn` to null once
+the TCP connection is closed. The `connection_t` destructor deletes it. */
+class connectivity_cluster_t::connection_t::stream_t : public home_thread_mixin_t {
+public:
+    explicit stream_t(keepalive_tcp_conn_stream_t *_conn) :
+        conn(_conn),
+        flusher([this](signal_t *) {
+            mutex_t::acq_t acq(&send_mutex);
+            if (conn != nullptr) {
+                conn->flush_buffer();
+            }
+        }, 1) { }
+
+    /* Only changes while `send_mutex` is held */
+    keepalive_tcp_conn_stream_t *conn;
+    mutex_t send_mutex;
+    pump_coro_t flusher;
+
+private:
+    DISABLE_COPYING(stream_t);
+};
+
 void connectivity_cluster_t::connection_t::kill_connection() {
     /* `heartbeat_manager_t` assumes this doesn't block as long as it's called on the
     home thread. */
@@ -157,6 +188,9 @@ connectivity_cluster_t::connection_t::connection_t(
     server_id(_server_id),
     drainers()
 {
+    for (auto &stream : streams) {
+        stream.store(nullptr);
+    }
     pmap(get_num_threads(), [this](int thread_id) {
         on_thread_t thread_switcher((threadnum_t(thread_id)));
         parent->parent->connections.get()->set_key_no_equals(
@@ -175,6 +209,16 @@ connectivity_cluster_t::connection_t::~connection_t() THROWS_NOTHING {
 
     /* The drainers have been destroyed, so nothing can be holding the `send_mutex`. */
     guarantee(!send_mutex.is_locked());
+
+    /* For the same reason, nothing is using the streams anymore. */
+    for (auto &slot : streams) {
+        stream_t *stream = slot.exchange(nullptr);
+        if (stream != nullptr) {
+            on_thread_t thread_switcher(stream->home_thread());
+            guarantee(!stream->send_mutex.is_locked());
+            delete stream;
+        }
+    }
 }
 
 // Helper function for the `run_t` constructor's initialization list
@@ -221,11 +265,13 @@ connectivity_cluster_t::run_t::run_t(
             _heartbeat_sl_view,
         std::shared_ptr<semilattice_read_view_t<auth_semilattice_metadata_t> >
             _auth_sl_view,
-        tls_ctx_t *_tls_ctx)
+        tls_ctx_t *_tls_ctx,
+        bool _parallel_streams)
         THROWS_ONLY(address_in_use_exc_t, tcp_socket_exc_t) :
     parent(_parent),
     server_id(_server_id),
     tls_ctx(_tls_ctx),
+    parallel_streams(_parallel_streams),
 
     /* Create the socket to use when listening for connections from peers */
     cluster_listener_socket(new tcp_bound_socket_t(local_addresses, port)),
@@ -299,6 +345,25 @@ void connectivity_cluster_t::run_t::join(
         auto_drainer_t::lock_t(&drainer)));
 }
 
+/* Returns `true` if the data that `conn` receives starts with `cluster_stream_header`,
+without consuming it. It only waits for as much data as it needs to tell. */
+static bool starts_with_stream_header(tcp_conn_t *conn, signal_t *interruptor)
+        THROWS_ONLY(tcp_conn_read_closed_exc_t) {
+    const std::string &header = connectivity_cluster_t::cluster_stream_header;
+    while (true) {
+        const_charslice data = conn->peek();
+        const size_t size = std::min(static_cast<size_t>(data.end - data.beg),
+                                     header.length());
+        if (!std::equal(data.beg, data.beg + size, header.begin())) {
+            return false;
+        }
+        if (size == header.length()) {
+            return true;
+        }
+        conn->read_more_buffered(interruptor);
+    }
+}
+
 void connectivity_cluster_t::run_t::on_new_connection(
         const scoped_ptr_t<tcp_conn_descriptor_t> &nconn,
         const int join_delay_secs,
@@ -321,7 +386,21 @@ void connectivity_cluster_t::run_t::on_new_connection(
 
     keepalive_tcp_conn_stream_t conn_stream(conn);
 
-    handle(&conn_stream, r_nullopt, r_nullopt, r_nullopt, lock, nullptr, join_delay_secs);
+    /* The extra connections of parallel streams come in on the same port as new peers,
+    but start with a different header. */
+    bool is_stream;
+    try {
+        is_stream = starts_with_stream_header(conn, lock.get_drain_signal());
+    } catch (const tcp_conn_read_closed_exc_t &) {
+        return;
+    }
+
+    if (is_stream) {
+        accept_stream(&conn_stream, join_delay_secs, lock);
+    } else {
+        handle(&conn_stream, r_nullopt, r_nullopt, r_nullopt, lock, nullptr,
+               join_delay_secs);
+    }
 }
 
 join_result_t connectivity_cluster_t::run_t::connect_to_peer(
@@ -455,7 +534,17 @@ private:
 /* `heartbeat_manager_t` is responsible for sending heartbeats over a single connection
 and making sure that heartbeats have arrived on time.
 `connectivity_cluster_t::run_t::handle()` constructs one after constructing the
-`connection_t`. */
+`connection_t`.
+
+Heartbeats ride along with regular traffic: any data read from the connection counts as
+a heartbeat, and we only send an explicit heartbeat in intervals in which we didn't
+write anything else. The timer rings `HEARTBEAT_TIMEOUT_INTERVALS` times per heartbeat
+timeout. A `phi_accrual_failure_detector_t` remembers how many intervals the gaps
+between reads have lasted. Once the configured timeout has passed without a read, we
+only kill the connection if the silence is also unusual given those gaps, or if it has
+lasted `MAX_TIMEOUT_MULTIPLIER` timeouts. That way a peer that is known to stall for a
+while under load doesn't get disconnected, which would force expensive backfills when
+it reconnects. */
 class connectivity_cluster_t::heartbeat_manager_t :
     public keepalive_tcp_conn_stream_t::keepalive_callback_t,
     private repeating_timer_callback_t,
@@ -463,6 +552,9 @@ class connectivity_cluster_t::heartbeat_manager_t :
 {
 public:
     static const int HEARTBEAT_TIMEOUT_INTERVALS = 5;
+    static const int MAX_TIMEOUT_MULTIPLIER = 3;
+    static const size_t FAILURE_DETECTOR_SAMPLES = 100;
+    static constexpr double PHI_THRESHOLD = 8.0;
 
     heartbeat_manager_t(
             connectivity_cluster_t::connection_t *connection_,
@@ -477,6 +569,9 @@ public:
         intervals_since_last_read_done(0),
         peer_str(peer_str_),
         timeout(0),
+        /* The gaps are measured in intervals, so half an interval of deviation is
+        less than the timer can even resolve. */
+        failure_detector(FAILURE_DETECTOR_SAMPLES, 0.5),
         heartbeat_sl_view(std::move(heartbeat_sl_view_)),
         heartbeat_sl_view_sub(std::bind(&heartbeat_manager_t::on_heartbeat_change, this))
     {
@@ -504,7 +599,11 @@ public:
     void on_ring() {
         ASSERT_FINITE_CORO_WAITING;
 
-        if (intervals_since_last_read_done > HEARTBEAT_TIMEOUT_INTERVALS) {
+        if (intervals_since_last_read_done > HEARTBEAT_TIMEOUT_INTERVALS &&
+                (intervals_since_last_read_done >
+                        HEARTBEAT_TIMEOUT_INTERVALS * MAX_TIMEOUT_MULTIPLIER ||
+                    failure_detector.phi(intervals_since_last_read_done)
+                        > PHI_THRESHOLD)) {
             logERR("Heartbeat timeout, killing connection to peer %s", peer_str.c_str());
 
             /* This won't block if we call it from the same thread. This is an
@@ -531,6 +630,7 @@ public:
             /* `intervals_since_last_read_done` may be negative when transitioning
                between timeouts, we should't reset it to zero when it's doing so. */
             if (intervals_since_last_read_done >= 0) {
+                failure_detector.add_sample(intervals_since_last_read_done + 1);
                 intervals_since_last_read_done = 0;
             } else {
                 intervals_since_last_read_done++;
@@ -568,6 +668,8 @@ public:
         } else {
             intervals_since_last_read_done = 0;
         }
+        /* The samples are measured in intervals, whose length is about to change. */
+        failure_detector.reset();
         timeout = timeout_new;
         timer = scoped_ptr_t<repeating_timer_t>(new repeating_timer_t(
             timeout / HEARTBEAT_TIMEOUT_INTERVALS, this));
@@ -580,6 +682,7 @@ private:
     int64_t intervals_since_last_read_done;
     std::string peer_str;
     int64_t timeout;
+    phi_accrual_failure_detector_t failure_detector;
 
     /* Order is important here. When destroying the `heartbeat_manager_t`, we must first
     destroy the timer so that new `on_ring()` calls don't get spawned; then destroy the
@@ -890,7 +993,8 @@ join_result_t connectivity_cluster_t::run_t::handle(
     // Get the name of our peer, for error reporting.
     ip_and_port_t peer_addr;
     std::string peerstr = "(unknown)";
-    if (conn->get_underlying_conn()->getpeername(&peer_addr))
+    const bool has_peer_addr = conn->get_underlying_conn()->getpeername(&peer_addr);
+    if (has_peer_addr)
         peerstr = peer_addr.to_string();
     const char *peername = peerstr.c_str();
 
@@ -1328,40 +1432,31 @@ join_result_t connectivity_cluster_t::run_t::handle(
             peerstr,
             cross_thread_heartbeat_sl_view.get_watchable());
 
+        /* Only the side that opened the connection opens parallel streams, so that
+        there's one set of them. If `cluster_client_port` is set, all of our
+        connections to the peer would have the same source and destination, and TCP
+        couldn't tell them apart. */
+        if (parallel_streams && static_cast<bool>(expected_address) && has_peer_addr
+                && cluster_client_port == 0) {
+            for (int i = 1; i < num_message_classes; ++i) {
+                coro_t::spawn_sometime(std::bind(
+                    &connectivity_cluster_t::run_t::connect_stream, this,
+                    peer_addr, &conn_structure, static_cast<message_class_t>(i),
+                    auto_drainer_t::lock_t(conn_structure.drainers.get())));
+            }
+        }
+
         /* Main message-handling loop: read messages off the connection until
         it's closed, which may be due to network events, or the other end
         shutting down, or us shutting down. */
         try {
-            int messages_handled_since_yield = 0;
-            while (true) {
-                message_tag_t tag;
-                archive_result_t res = deserialize_universal(conn, &tag);
-                if (bad(res)) { throw fake_archive_exc_t(); }
-
-                /* Ignore messages tagged with the heartbeat tag. The
-                `keepalive_tcp_conn_stream_t` will have already notified the
-                `heartbeat_manager_t` as soon as the heartbeat arrived. */
-                if (tag != heartbeat_tag) {
-                    cluster_message_handler_t *handler = parent->message_handlers[tag];
-                    guarantee(handler != nullptr, "Got a message for an unfamiliar tag. "
-                        "Apparently we aren't compatible with the cluster on the other "
-                        "end.");
-
-                    /* If you really want to support old cluster versions, the
-                    resolved_version should be passed into the on_message() handler. */
-                    guarantee(resolved_version == cluster_version_t::CLUSTER);
-                    handler->on_message(
-                        &conn_structure,
-                        auto_drainer_t::lock_t(conn_structure.drainers.get()),
-                        conn); // might raise fake_archive_exc_t
-                }
-
-                ++messages_handled_since_yield;
-                if (messages_handled_since_yield >= MESSAGE_HANDLER_MAX_BATCH_SIZE) {
-                    coro_t::yield();
-                    messages_handled_since_yield = 0;
-                }
-            }
+            /* If you really want to support old cluster versions, the
+            resolved_version should be passed into the on_message() handler. */
+            guarantee(resolved_version == cluster_version_t::CLUSTER);
+            parent->handle_messages(
+                &conn_structure,
+                auto_drainer_t::lock_t(conn_structure.drainers.get()),
+                conn);
         } catch (const fake_archive_exc_t &) {
             /* The exception broke us out of the loop, and that's what we
             wanted. This could either be because we lost contact with the peer
@@ -1393,6 +1488,221 @@ join_result_t connectivity_cluster_t::run_t::handle(
     return join_result_t::SUCCESS;
 }
 
+void connectivity_cluster_t::run_t::connect_stream(
+        ip_and_port_t peer_addr,
+        connection_t *connection,
+        message_class_t message_class,
+        auto_drainer_t::lock_t keepalive) THROWS_NOTHING {
+    const std::string peerstr = peer_addr.to_string();
+    const char *peername = peerstr.c_str();
+
+    try {
+        keepalive_tcp_conn_stream_t conn(
+            tls_ctx, peer_addr.ip(), peer_addr.port().value(),
+            keepalive.get_drain_signal());
+
+        cluster_conn_closing_subscription_t conn_closer(&conn);
+        conn_closer.reset(keepalive.get_drain_signal());
+
+        {
+            write_message_t wm;
+            wm.append(cluster_stream_header.data(), cluster_stream_header.length());
+            serialize_universal(
+                &wm, static_cast<uint64_t>(cluster_version_string.length()));
+            wm.append(cluster_version_string.data(), cluster_version_string.length());
+            serialize_universal(&wm, parent->me);
+            serialize_universal(&wm, connection->get_peer_id());
+            serialize_universal(&wm, static_cast<uint8_t>(message_class));
+            if (send_write_message(&conn, &wm)) {
+                return; // network error.
+            }
+        }
+
+        /* A server that doesn't know about parallel streams sends the header of a
+        normal connection instead, and then closes the connection once it has seen
+        ours. */
+        {
+            scoped_array_t<char> header(cluster_stream_header.length());
+            if (conn.read(header.data(), header.size())
+                    != static_cast<int64_t>(header.size())) {
+                return;
+            }
+            if (!std::equal(header.data(), header.data() + header.size(),
+                            cluster_stream_header.begin())) {
+                logINF("Server %s doesn't support parallel cluster streams.",
+                       connection->get_server_id().print().c_str());
+                return;
+            }
+        }
+
+        bool accepted;
+        if (deserialize_universal_and_check(&conn, &accepted, peername)) {
+            return;
+        }
+        if (!accepted) {
+            logWRN("Server %s refused a parallel cluster stream.",
+                   connection->get_server_id().print().c_str());
+            return;
+        }
+
+        conn_closer.reset();
+        run_stream(&conn, connection, message_class, keepalive);
+    } catch (const tcp_conn_t::connect_failed_exc_t &) {
+        /* Ignore. The messages of this class keep using the main connection. */
+    } catch (const crypto::openssl_error_t &) {
+        /* Ignore */
+    } catch (const interrupted_exc_t &) {
+        /* Ignore */
+    }
+}
+
+void connectivity_cluster_t::run_t::accept_stream(
+        keepalive_tcp_conn_stream_t *conn,
+        const int join_delay_secs,
+        auto_drainer_t::lock_t drainer_lock) THROWS_NOTHING {
+    parent->assert_thread();
+
+    ip_and_port_t peer_addr;
+    std::string peerstr = "(unknown)";
+    if (conn->get_underlying_conn()->getpeername(&peer_addr))
+        peerstr = peer_addr.to_string();
+    const char *peername = peerstr.c_str();
+
+    cluster_conn_closing_subscription_t conn_closer(conn);
+    conn_closer.reset(drainer_lock.get_drain_signal());
+
+    // `on_new_connection()` has already checked the header.
+    {
+        scoped_array_t<char> header(cluster_stream_header.length());
+        if (!read_header_chunk(conn, header.data(), header.size(), peername)) {
+            return;
+        }
+    }
+
+    std::string remote_version_string;
+    peer_id_t other_id;
+    peer_id_t our_id;
+    uint8_t message_class_int;
+    if (!deserialize_compatible_string(conn, &remote_version_string, peername)
+            || deserialize_universal_and_check(conn, &other_id, peername)
+            || deserialize_universal_and_check(conn, &our_id, peername)
+            || deserialize_universal_and_check(conn, &message_class_int, peername)) {
+        return;
+    }
+
+    /* The peer sets up its streams as soon as its end of the connection is ready, which
+    can be before our end is, for example while we wait out the join delay. */
+    connection_t *connection = nullptr;
+    auto_drainer_t::lock_t keepalive;
+    cluster_version_t resolved_version;
+    if (resolve_protocol_version(remote_version_string, &resolved_version)
+            && resolved_version == cluster_version_t::CLUSTER
+            && our_id == parent->me
+            && message_class_int > static_cast<uint8_t>(message_class_t::CONTROL)
+            && message_class_int < num_message_classes) {
+        signal_timer_t timeout;
+        timeout.start(
+            static_cast<int64_t>(join_delay_secs + STREAM_ACCEPT_TIMEOUT_SECS) * 1000);
+        wait_any_t interruptor(&timeout, drainer_lock.get_drain_signal());
+        try {
+            parent->connections.get()->run_key_until_satisfied(other_id,
+                [&](const connection_pair_t *pair) {
+                    if (pair == nullptr || pair->first->is_loopback()) {
+                        return false;
+                    }
+                    connection = pair->first;
+                    keepalive = pair->second;
+                    return true;
+                },
+                &interruptor);
+        } catch (const interrupted_exc_t &) {
+            /* The connection didn't come up in time, or we're shutting down. */
+        }
+    }
+
+    {
+        write_message_t wm;
+        wm.append(cluster_stream_header.data(), cluster_stream_header.length());
+        serialize_universal(&wm, connection != nullptr);
+        if (send_write_message(conn, &wm)) {
+            return; // network error.
+        }
+    }
+    if (connection == nullptr) {
+        logWRN("Rejected a parallel cluster stream from %s, which doesn't belong to a "
+               "connection.", peername);
+        return;
+    }
+
+    conn_closer.reset();
+    run_stream(conn, connection, static_cast<message_class_t>(message_class_int),
+               keepalive);
+}
+
+void connectivity_cluster_t::run_t::run_stream(
+        keepalive_tcp_conn_stream_t *conn,
+        connection_t *connection,
+        message_class_t message_class,
+        auto_drainer_t::lock_t home_keepalive) THROWS_NOTHING {
+    guarantee(home_keepalive.has_lock());
+    thread_allocation_t chosen_thread(&parent->thread_allocator);
+
+    rethread_tcp_conn_stream_t unregister_conn(conn, INVALID_THREAD);
+    on_thread_t conn_threader(chosen_thread.get_thread());
+    rethread_tcp_conn_stream_t reregister_conn(conn, get_thread_id());
+
+    /* `home_keepalive` keeps `connection` alive, so if we find a connection at the
+    same address on this thread, it's the same one and not a newer one to the same
+    peer. */
+    auto_drainer_t::lock_t keepalive;
+    if (parent->get_connection(connection->get_peer_id(), &keepalive) != connection) {
+        return;
+    }
+
+    cluster_conn_closing_subscription_t conn_closer(conn);
+    conn_closer.reset(keepalive.get_drain_signal());
+
+    connection_t::stream_t *stream = new connection_t::stream_t(conn);
+    connection_t::stream_t *no_stream = nullptr;
+    if (!connection->streams[static_cast<int>(message_class)].compare_exchange_strong(
+            no_stream, stream)) {
+        delete stream;
+        logWRN("Got a second parallel cluster stream for the same messages from "
+               "server %s. Disconnecting it.",
+               connection->get_server_id().print().c_str());
+        return;
+    }
+    /* From now on, `connection` owns `stream`, and it carries the messages of
+    `message_class` in both directions. Messages that were sent on the main connection
+    before this point can arrive after those sent on `stream`. */
+
+    try {
+        parent->handle_messages(connection, keepalive, conn);
+    } catch (const fake_archive_exc_t &) {
+        /* The stream was closed or broken, or the connection is going away. */
+    }
+
+    if (conn->is_read_open()) {
+        logWRN("Received invalid data on a cluster connection. Disconnecting.");
+        conn->shutdown_read();
+    }
+    if (conn->is_write_open()) {
+        conn->shutdown_write();
+    }
+    {
+        mutex_t::acq_t acq(&stream->send_mutex);
+        stream->conn = nullptr;
+    }
+
+    /* Messages of this class can't be delivered anymore, so if the connection isn't
+    already going away, the whole connection has to go. */
+    if (!keepalive.get_drain_signal()->is_pulsed()) {
+        connection->kill_connection();
+    }
+
+    conn->flush_buffer();
+}
+
 connectivity_cluster_t::connectivity_cluster_t() THROWS_NOTHING :
     me(peer_id_t(generate_uuid())),
     /* We assign threads from the highest thread number downwards. This is to reduce the
@@ -1463,10 +1773,120 @@ connectivity_cluster_t::connection_t *connectivity_cluster_t::get_connection(
     return conn;
 }
 
+void connectivity_cluster_t::handle_messages(
+        connection_t *connection,
+        const auto_drainer_t::lock_t &keepalive,
+        keepalive_tcp_conn_stream_t *conn) {
+    int messages_handled_since_yield = 0;
+    while (true) {
+        message_tag_t tag;
+        archive_result_t res = deserialize_universal(conn, &tag);
+        if (bad(res)) { throw fake_archive_exc_t(); }
+
+        /* Ignore messages tagged with the heartbeat tag. The
+        `keepalive_tcp_conn_stream_t` will have already notified the
+        `heartbeat_manager_t` as soon as the heartbeat arrived. */
+        if (tag != heartbeat_tag) {
+            cluster_message_handler_t *handler = message_handlers[tag];
+            guarantee(handler != nullptr, "Got a message for an unfamiliar tag. "
+                "Apparently we aren't compatible with the cluster on the other "
+                "end.");
+
+            // might raise fake_archive_exc_t
+            handler->on_message(connection, keepalive, conn);
+        }
+
+        ++messages_handled_since_yield;
+        if (messages_handled_since_yield >= MESSAGE_HANDLER_MAX_BATCH_SIZE) {
+            coro_t::yield();
+            messages_handled_since_yield = 0;
+        }
+    }
+}
+
+/* Messages at least this big are handed to the socket straight from their buffers,
+instead of being copied into the connection's write buffer first. */
+#define MIN_UNBUFFERED_MESSAGE_SIZE (16 * KILOBYTE)
+
+/* Writes a message to `*conn`, which must be on the current thread. `send_mutex` and
+`flusher` belong to the same connection. Returns `false` if the connection is closed.
+`*conn` is null if it's a stream that has closed. */
+static bool send_on_conn(keepalive_tcp_conn_stream_t *const *conn,
+                         mutex_t *send_mutex,
+                         pump_coro_t *flusher,
+                         connectivity_cluster_t::message_tag_t tag,
+                         write_message_t *msg,
+                         size_t msg_size) {
+    static_assert(std::is_same<connectivity_cluster_t::message_tag_t, uint8_t>::value,
+                  "We expect to be serializing a uint8_t -- if this has "
+                  "changed, the cluster communication format has changed and "
+                  "you need to ask yourself whether live cluster upgrades work.");
+    intrusive_list_t<write_buffer_t> *buffers = msg->unsafe_expose_buffers();
+
+    /* Acquire the send-mutex so we don't collide with other things trying
+    to send on the same connection. */
+    {
+        /* The `true` is for eager waiting, which is a significant performance
+        optimization in this case. */
+        mutex_t::acq_t acq(send_mutex, true);
+        if (*conn == nullptr) {
+            return false;
+        }
+
+        /* Write the tag and the message to the network. All cluster versions use a
+        uint8_t tag. Small messages go into the connection's write buffer, so that
+        several of them can go out in one write. Large ones are written from the
+        message's own buffers, which saves copying them. */
+        bool ok;
+        if (msg_size < MIN_UNBUFFERED_MESSAGE_SIZE) {
+            ok = (*conn)->write_buffered(&tag, sizeof(tag)) != -1;
+            for (write_buffer_t *b = buffers->head();
+                 ok && b != nullptr;
+                 b = buffers->next(b)) {
+                ok = (*conn)->write_buffered(b->contents(), b->size) != -1;
+            }
+        } else {
+            const_buffer_group_t group;
+            group.add_buffer(sizeof(tag), &tag);
+            for (write_buffer_t *b = buffers->head();
+                 b != nullptr;
+                 b = buffers->next(b)) {
+                group.add_buffer(b->size, b->contents());
+            }
+            ok = (*conn)->write_buffers(&group);
+        }
+        if (!ok) {
+            /* Close the other half of the connection to make sure that
+               `connectivity_cluster_t::run_t::handle()` notices that something is
+               up */
+            if ((*conn)->is_read_open()) {
+                (*conn)->shutdown_read();
+            }
+            return false;
+        }
+    } /* Releases the send_mutex */
+
+    flusher->notify();
+    cond_t dummy_interruptor;
+    flusher->flush(&dummy_interruptor);
+    keepalive_tcp_conn_stream_t *flushed_conn = *conn;
+    if (flushed_conn == nullptr) {
+        return false;
+    }
+    if (!flushed_conn->is_write_open()) {
+        if (flushed_conn->is_read_open()) {
+            flushed_conn->shutdown_read();
+        }
+        return false;
+    }
+    return true;
+}
+
 void connectivity_cluster_t::send_message(connection_t *connection,
                                      auto_drainer_t::lock_t connection_keepalive,
                                      message_tag_t tag,
-                                     cluster_send_message_write_callback_t *callback) {
+                                     cluster_send_message_write_callback_t *callback,
+                                     message_class_t message_class) {
     // We could be on _any_ thread.
 
     /* If the connection is being closed, just drop the message now. It's not going
@@ -1475,17 +1895,14 @@ void connectivity_cluster_t::send_message(connection_t *connection,
         return;
     }
 
-    /* We currently write the message to a vector_stream_t, then
-       serialize that as a string. It's horribly inefficient, of course. */
-    // TODO: If we don't do it this way, we (or the caller) will need
-    // to worry about having the writer run on the connection thread.
-    vector_stream_t buffer;
-    // Reserve some space to reduce overhead (especially for small messages)
-    buffer.reserve(1024);
+    /* We build the message here rather than on the connection's thread so that the
+    callback doesn't have to worry about which thread it runs on. */
+    write_message_t msg;
     {
         ASSERT_FINITE_CORO_WAITING;
-        callback->write(&buffer);
+        callback->write_message(&msg);
     }
+    intrusive_list_t<write_buffer_t> *msg_buffers = msg.unsafe_expose_buffers();
 
 #ifdef CLUSTER_MESSAGE_DEBUGGING
     {
@@ -1495,7 +1912,13 @@ void connectivity_cluster_t::send_message(connection_t *connection,
         buf.appendf(" to ");
         debug_print(&buf, dest);
         buf.appendf("\n");
-        print_hd(buffer.vector().data(), 0, buffer.vector().size());
+        size_t offset = 0;
+        for (write_buffer_t *b = msg_buffers->head();
+             b != nullptr;
+             b = msg_buffers->next(b)) {
+            print_hd(b->contents(), offset, b->size);
+            offset += b->size;
+        }
     }
 #endif
 
@@ -1509,7 +1932,7 @@ void connectivity_cluster_t::send_message(connection_t *connection,
     }
 #endif
 
-    size_t bytes_sent = buffer.vector().size();
+    size_t bytes_sent = msg.size();
 
 #ifdef ENABLE_MESSAGE_PROFILER
     std::pair<uint64_t, uint64_t> *stats =
@@ -1521,65 +1944,31 @@ void connectivity_cluster_t::send_message(connection_t *connection,
     if (connection->is_loopback()) {
         // We could be on any thread here! Oh no!
         std::vector<char> buffer_data;
-        buffer.swap(&buffer_data);
+        buffer_data.reserve(bytes_sent);
+        for (write_buffer_t *b = msg_buffers->head();
+             b != nullptr;
+             b = msg_buffers->next(b)) {
+            buffer_data.insert(buffer_data.end(), b->contents(), b->contents() + b->size);
+        }
         rassert(message_handlers[tag], "No message handler for tag %" PRIu8, tag);
         message_handlers[tag]->on_local_message(connection, connection_keepalive,
             std::move(buffer_data));
     } else {
-        on_thread_t threader(connection->conn->home_thread());
-
-        /* Acquire the send-mutex so we don't collide with other things trying
-        to send on the same connection. */
-        {
-            /* The `true` is for eager waiting, which is a significant performance
-            optimization in this case. */
-            mutex_t::acq_t acq(&connection->send_mutex, true);
-
-            /* Write the tag to the network */
-            {
-                // All cluster versions use a uint8_t tag here.
-                write_message_t wm;
-                static_assert(std::is_same<message_tag_t, uint8_t>::value,
-                              "We expect to be serializing a uint8_t -- if this has "
-                              "changed, the cluster communication format has changed and "
-                              "you need to ask yourself whether live cluster upgrades work."
-                              );
-                serialize_universal(&wm, tag);
-                make_buffered_tcp_conn_stream_wrapper_t buffered_conn(connection->conn);
-                int res = send_write_message(&buffered_conn, &wm);
-                if (res == -1) {
-                    /* Close the other half of the connection to make sure that
-                       `connectivity_cluster_t::run_t::handle()` notices that something is
-                       up */
-                    if (connection->conn->is_read_open()) {
-                        connection->conn->shutdown_read();
-                    }
-                    return;
-                }
-            }
-
-            /* Write the message itself to the network */
-            {
-                int64_t res = connection->conn->write_buffered(buffer.vector().data(),
-                                                               buffer.vector().size());
-                if (res == -1) {
-                    if (connection->conn->is_read_open()) {
-                        connection->conn->shutdown_read();
-                    }
-                    return;
-                } else {
-                    guarantee(res == static_cast<int64_t>(buffer.vector().size()));
-                }
-            }
-        } /* Releases the send_mutex */
-
-        connection->flusher.notify();
-        cond_t dummy_interruptor;
-        connection->flusher.flush(&dummy_interruptor);
-        if (!connection->conn->is_write_open()) {
-            if (connection->conn->is_read_open()) {
-                connection->conn->shutdown_read();
-            }
+        /* The stream of a class can only appear, not go away, while we hold
+        `connection_keepalive`. */
+        connection_t::stream_t *stream =
+            connection->streams[static_cast<int>(message_class)].load();
+        bool sent;
+        if (stream != nullptr) {
+            on_thread_t threader(stream->home_thread());
+            sent = send_on_conn(&stream->conn, &stream->send_mutex, &stream->flusher,
+                                tag, &msg, bytes_sent);
+        } else {
+            on_thread_t threader(connection->conn->home_thread());
+            sent = send_on_conn(&connection->conn, &connection->send_mutex,
+                                &connection->flusher, tag, &msg, bytes_sent);
+        }
+        if (!sent) {
             return;
         }
     }
@@ -1587,6 +1976,23 @@ void connectivity_cluster_t::send_message(connection_t *connection,
     connection->pm_bytes_sent.record(bytes_sent);
 }
 
+/* Appends whatever is written to it to a `write_message_t`. */
+class write_message_stream_t : public write_stream_t {
+public:
+    explicit write_message_stream_t(write_message_t *_msg) : msg(_msg) { }
+    int64_t write(const void *p, int64_t n) {
+        msg->append(p, n);
+        return n;
+    }
+private:
+    write_message_t *msg;
+};
+
+void cluster_send_message_write_callback_t::write_message(write_message_t *msg) {
+    write_message_stream_t stream(msg);
+    write(&stream);
+}
+
 cluster_message_handler_t::cluster_message_handler_t(
         connectivity_cluster_t *cm,
         connectivity_cluster_t::message_tag_t t) :
@@ -2,6 +2,8 @@
 #ifndef RPC_CONNECTIVITY_CLUSTER_HPP_
 #define RPC_CONNECTIVITY_CLUSTER_HPP_
 
+#include <array>
+#include <atomic>
 #include <map>
 #include <set>
 #include <string>
@@ -59,6 +61,12 @@ public:
     // cluster_version_t::CLUSTER for cluster messages.
     virtual void write(write_stream_t *stream) = 0;
 
+    /* `connectivity_cluster_t` calls this one to build the message, which it then
+    hands to the socket buffer by buffer. The default implementation calls `write()`
+    and copies what it writes; callbacks that serialize into a `write_message_t`
+    anyway can override it to move their buffers into `msg` instead. */
+    virtual void write_message(write_message_t *msg);
+
 #ifdef ENABLE_MESSAGE_PROFILER
     /* This should return a string that describes the type of message being sent for
     profiling purposes. The returned string must be statically allocated (i.e. valid
@@ -81,15 +89,18 @@ connection. Once a connection is established, messages can be sent across it in
 directions. Every message is guaranteed to eventually arrive unless the connection goes
 down. Messages cannot be duplicated.
 
-Can messages be reordered? I think the current implementation doesn't ever reorder
-messages, but don't rely on this guarantee. However, some old code may rely on this
-guarantee (I'm not sure) so don't break this property without checking first. */
+Can messages be reordered? Messages of different classes (see `message_class_t`) can
+be, and so can messages of one class around the moment its parallel stream is set up.
+Otherwise I think the current implementation doesn't ever reorder messages, but don't
+rely on this guarantee. However, some old code may rely on this guarantee (I'm not sure)
+so don't break this property without checking first. */
 
 class connectivity_cluster_t :
     public home_thread_mixin_debug_only_t
 {
 public:
     static const std::string cluster_proto_header;
+    static const std::string cluster_stream_header;
     static const std::string cluster_version_string;
     static const std::string cluster_arch_bitsize;
     static const std::string cluster_build_mode;
@@ -105,6 +116,19 @@ public:
     /* This tag is reserved exclusively for heartbeat messages. */
     static const message_tag_t heartbeat_tag = 'H';
 
+    /* Every message also has a class, which the sender picks. Normally all messages
+    to a peer share one TCP connection. With parallel streams, every class except
+    `CONTROL` gets a TCP connection of its own, handled by a thread of its own, so
+    that a long backfill message doesn't hold up the small messages of queries and the
+    traffic isn't limited by what one connection and one thread can do. Directory,
+    semilattice and heartbeat messages are always `CONTROL`. */
+    enum class message_class_t {
+        CONTROL = 0,
+        QUERY = 1,
+        BACKFILL = 2
+    };
+    static const int num_message_classes = 3;
+
     class run_t;
 
     /* `connection_t` represents an open connection to another server. If we lose
@@ -141,12 +165,20 @@ public:
             return conn == nullptr;
         }
 
+        /* Returns `true` if messages of `message_class` have a TCP connection of their
+        own, rather than sharing the `CONTROL` one. */
+        bool has_stream(message_class_t message_class) const {
+            return streams[static_cast<int>(message_class)].load() != nullptr;
+        }
+
         /* Drops the connection. */
         void kill_connection();
 
     private:
         friend class connectivity_cluster_t;
 
+        class stream_t;
+
         /* The constructor registers us in every thread's `connections` map, thereby
         notifying event subscribers. */
         connection_t(
@@ -172,6 +204,12 @@ public:
         buffered write makes it to the TCP stack. */
         pump_coro_t flusher;
 
+        /* The extra TCP connections of the parallel streams, indexed by message class.
+        An entry is null until its stream has been set up, and the class uses `conn` in
+        the meantime. The `CONTROL` entry is always null. Each `stream_t` lives on its
+        own thread; the destructor deletes them. */
+        std::array<std::atomic<stream_t *>, num_message_classes> streams;
+
         perfmon_collection_t pm_collection;
         perfmon_sampler_t pm_bytes_sent;
         perfmon_membership_t pm_collection_membership, pm_bytes_sent_membership;
@@ -203,7 +241,8 @@ public:
                   heartbeat_semilattice_metadata_t> > heartbeat_sl_view,
               std::shared_ptr<semilattice_read_view_t<
                   auth_semilattice_metadata_t> > auth_sl_view,
-              tls_ctx_t *tls_ctx)
+              tls_ctx_t *tls_ctx,
+              bool parallel_streams)
             THROWS_ONLY(address_in_use_exc_t, tcp_socket_exc_t);
 
         ~run_t();
@@ -289,6 +328,31 @@ public:
             bool *successful_join_inout,
             const int join_delay_secs) THROWS_NOTHING;
 
+        /* `connect_stream()` is spawned by `handle()` for each message class other than
+        `CONTROL`, on the side that opened the connection and only if `parallel_streams`
+        is set. It opens the extra TCP connection for the class. `keepalive` is a lock
+        on the connection on the current thread. */
+        void connect_stream(ip_and_port_t peer_addr,
+                            connection_t *connection,
+                            message_class_t message_class,
+                            auto_drainer_t::lock_t keepalive) THROWS_NOTHING;
+
+        /* `accept_stream()` handles the other end, for incoming connections that start
+        with `cluster_stream_header` rather than `cluster_proto_header`. Whether or not
+        `parallel_streams` is set, we accept streams. */
+        void accept_stream(keepalive_tcp_conn_stream_t *c,
+                           const int join_delay_secs,
+                           auto_drainer_t::lock_t) THROWS_NOTHING;
+
+        /* Both of the above end by calling `run_stream()`, which moves the stream to a
+        thread of its own, attaches it to `connection` and handles messages from it until
+        either of them is closed. `keepalive` is a lock on `connection` on the current
+        thread. */
+        void run_stream(keepalive_tcp_conn_stream_t *c,
+                        connection_t *connection,
+                        message_class_t message_class,
+                        auto_drainer_t::lock_t keepalive) THROWS_NOTHING;
+
         connectivity_cluster_t *parent;
 
         /* The server's own id and the set of servers we are connected to, we only allow
@@ -298,6 +362,9 @@ public:
 
         tls_ctx_t *tls_ctx;
 
+        /* Whether to open parallel streams on the connections that we initiate. */
+        const bool parallel_streams;
+
         /* `attempt_table` is a table of all the host:port pairs we're currently
         trying to connect to or have connected to. If we are told to connect to
         an address already in this table, we'll just ignore it. That's important
@@ -358,12 +425,13 @@ public:
             auto_drainer_t::lock_t *keepalive_out) THROWS_NOTHING;
 
     /* Sends a message to the other server. The message is associated with a "tag",
-    which determines which message handler on the other server will receive the message.
-    */
+    which determines which message handler on the other server will receive the message,
+    and a class, which determines the TCP connection that carries it. */
     void send_message(connection_t *connection,
                       auto_drainer_t::lock_t connection_keepalive,
                       message_tag_t tag,
-                      cluster_send_message_write_callback_t *callback);
+                      cluster_send_message_write_callback_t *callback,
+                      message_class_t message_class = message_class_t::CONTROL);
 
 private:
     friend class cluster_message_handler_t;
@@ -371,6 +439,13 @@ private:
 
     class heartbeat_manager_t;
 
+    /* Reads messages off `conn` and passes them to the message handlers until the
+    connection is closed or they receive invalid data; then throws
+    `fake_archive_exc_t`. */
+    void handle_messages(connection_t *connection,
+                         const auto_drainer_t::lock_t &keepalive,
+                         keepalive_tcp_conn_stream_t *conn);
+
     /* `me` is our `peer_id_t`. */
     const peer_id_t me;
 
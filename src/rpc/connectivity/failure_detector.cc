@@ -0,0 +1,55 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#include "rpc/connectivity/failure_detector.hpp"
+
+#include <math.h>
+
+#include <algorithm>
+
+phi_accrual_failure_detector_t::phi_accrual_failure_detector_t(
+        size_t _max_samples, double _min_stddev) :
+    max_samples(_max_samples),
+    min_stddev(_min_stddev),
+    sum(0),
+    sum_of_squares(0) {
+    guarantee(max_samples > 0);
+}
+
+void phi_accrual_failure_detector_t::add_sample(double interval) {
+    rassert(interval >= 0);
+    if (samples.size() == max_samples) {
+        sum -= samples.front();
+        sum_of_squares -= samples.front() * samples.front();
+        samples.pop_front();
+    }
+    samples.push_back(interval);
+    sum += interval;
+    sum_of_squares += interval * interval;
+}
+
+double phi_accrual_failure_detector_t::phi(double time_since_last_arrival) const {
+    if (samples.empty()) {
+        return 0;
+    }
+    const double n = static_cast<double>(samples.size());
+    const double mean = sum / n;
+    /* Rounding errors in the running sums can make the variance slightly negative. */
+    const double variance = std::max(0.0, sum_of_squares / n - mean * mean);
+    const double stddev = std::max(min_stddev, sqrt(variance));
+
+    /* This is a logistic approximation of the cumulative distribution function of the
+    normal distribution, which is accurate to within 0.02% and doesn't lose precision in
+    the tail the way `1 - erf()` would. */
+    const double y = (time_since_last_arrival - mean) / stddev;
+    const double e = exp(-y * (1.5976 + 0.070566 * y * y));
+    if (time_since_last_arrival > mean) {
+        return -log10(e / (1.0 + e));
+    } else {
+        return -log10(1.0 - 1.0 / (1.0 + e));
+    }
+}
+
+void phi_accrual_failure_detector_t::reset() {
+    samples.clear();
+    sum = 0;
+    sum_of_squares = 0;
+}
@@ -0,0 +1,46 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#ifndef RPC_CONNECTIVITY_FAILURE_DETECTOR_HPP_
+#define RPC_CONNECTIVITY_FAILURE_DETECTOR_HPP_
+
+#include <stddef.h>
+
+#include <deque>
+
+#include "errors.hpp"
+
+/* `phi_accrual_failure_detector_t` implements the phi accrual failure detector from
+Hayashibara et al. Instead of saying whether a peer is up or down, it records how long
+the gaps between arrivals of messages from the peer have been, and estimates how
+unlikely the current silence is given that history. `phi()` is `-log10` of the
+probability that a gap at least as long as the current one occurs; so a phi of 1 means
+a 10% chance, 2 a 1% chance, and so on.
+
+The gaps are modeled as normally distributed. `min_stddev` keeps a very regular peer
+from being declared dead because of a small deviation. The units of time are up to the
+caller, as long as they are used consistently. */
+class phi_accrual_failure_detector_t {
+public:
+    phi_accrual_failure_detector_t(size_t max_samples, double min_stddev);
+
+    void add_sample(double interval);
+
+    /* Returns 0 if no samples have been recorded yet. */
+    double phi(double time_since_last_arrival) const;
+
+    size_t num_samples() const {
+        return samples.size();
+    }
+
+    void reset();
+
+private:
+    const size_t max_samples;
+    const double min_stddev;
+    std::deque<double> samples;
+    double sum;
+    double sum_of_squares;
+
+    DISABLE_COPYING(phi_accrual_failure_detector_t);
+};
+
+#endif  // RPC_CONNECTIVITY_FAILURE_DETECTOR_HPP_
@@ -0,0 +1,39 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#include "rpc/directory/delta.hpp"
+
+#include <algorithm>
+
+directory_delta_t directory_delta_t::compute(
+        const std::string &old_value, const std::string &new_value) {
+    const size_t max_common = std::min(old_value.size(), new_value.size());
+    size_t prefix = 0;
+    while (prefix < max_common && old_value[prefix] == new_value[prefix]) {
+        ++prefix;
+    }
+    /* The prefix and the suffix mustn't overlap in either value */
+    size_t suffix = 0;
+    while (suffix < max_common - prefix
+            && old_value[old_value.size() - suffix - 1]
+                == new_value[new_value.size() - suffix - 1]) {
+        ++suffix;
+    }
+    directory_delta_t delta;
+    delta.prefix_size = prefix;
+    delta.suffix_size = suffix;
+    delta.middle = new_value.substr(prefix, new_value.size() - prefix - suffix);
+    return delta;
+}
+
+bool directory_delta_t::apply(
+        const std::string &old_value, std::string *new_value_out) const {
+    if (prefix_size > old_value.size()
+            || suffix_size > old_value.size() - prefix_size) {
+        return false;
+    }
+    new_value_out->clear();
+    new_value_out->reserve(prefix_size + middle.size() + suffix_size);
+    new_value_out->append(old_value, 0, prefix_size);
+    new_value_out->append(middle);
+    new_value_out->append(old_value, old_value.size() - suffix_size, suffix_size);
+    return true;
+}
@@ -0,0 +1,44 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#ifndef RPC_DIRECTORY_DELTA_HPP_
+#define RPC_DIRECTORY_DELTA_HPP_
+
+#include <string>
+
+#include "containers/archive/stl_types.hpp"
+#include "rpc/serialize_macros.hpp"
+
+/* `directory_map_write_manager_t` describes the new value of each key it sends in one
+of these ways. */
+enum class directory_update_type_t {
+    /* The serialized value follows in full. */
+    full,
+    /* A `directory_delta_t` against the value that was last sent for the key over the
+    same connection follows. */
+    delta,
+    /* The key was deleted. */
+    deleted
+};
+ARCHIVE_PRIM_MAKE_RANGED_SERIALIZABLE(directory_update_type_t, int8_t,
+    directory_update_type_t::full, directory_update_type_t::deleted);
+
+/* `directory_delta_t` describes how to turn one serialized directory value into
+another: keep the first `prefix_size` and the last `suffix_size` bytes of the old value,
+and put `middle` in between. Directory values tend to change in one or two fields at a
+time, so the delta is usually much smaller than the new value. */
+class directory_delta_t {
+public:
+    static directory_delta_t compute(
+        const std::string &old_value, const std::string &new_value);
+
+    /* Returns `false` if `old_value` is too short to be the value that the delta was
+    computed against. */
+    bool apply(const std::string &old_value, std::string *new_value_out) const;
+
+    uint64_t prefix_size;
+    uint64_t suffix_size;
+    std::string middle;
+
+    RDB_MAKE_ME_SERIALIZABLE_3(directory_delta_t, prefix_size, suffix_size, middle);
+};
+
+#endif /* RPC_DIRECTORY_DELTA_HPP_ */
@@ -3,6 +3,7 @@
 
 /* for unit tests */
 template class directory_map_read_manager_t<int, int>;
+template class directory_map_read_manager_t<int, std::string>;
 
 #include "clustering/table_manager/table_metadata.hpp"
 template class directory_map_read_manager_t<
@@ -2,6 +2,11 @@
 #ifndef RPC_DIRECTORY_MAP_READ_MANAGER_HPP_
 #define RPC_DIRECTORY_MAP_READ_MANAGER_HPP_
 
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
 #include "concurrency/auto_drainer.hpp"
 #include "concurrency/one_per_thread.hpp"
 #include "concurrency/watchable_map.hpp"
@@ -32,12 +37,27 @@ private:
             auto_drainer_t::lock_t connection_keepalive,
             auto_drainer_t::lock_t this_keepalive,
             uint64_t timestamp,
-            const key_t &key,
-            const optional<value_t> &value);
+            const std::vector<std::pair<key_t, optional<value_t> > > &updates);
+
+    /* For each key, the timestamp and serialized value that we last received. */
+    typedef std::map<key_t, std::pair<uint64_t, std::string> > received_values_t;
+
+    /* Returns the `received_values_t` for `connection`, creating it if necessary. Must
+    be called on the thread that handles messages from `connection`. */
+    received_values_t *get_received_values(
+            connectivity_cluster_t::connection_t *connection,
+            const auto_drainer_t::lock_t &connection_keepalive);
 
     watchable_map_var_t<std::pair<peer_id_t, key_t>, value_t> map_var;
     std::map<peer_id_t, std::map<key_t, uint64_t> > timestamps;
 
+    /* The values that deltas refer to. The write manager computes deltas against the
+    values it sent over the same connection, so we keep them per connection. Messages
+    from a connection are all handled on the same thread, so each thread has its own map
+    of connections. */
+    one_per_thread_t<std::map<connectivity_cluster_t::connection_t *,
+        received_values_t> > received_values;
+
     /* Instances of `do_update()` hold a lock on one of these drainers. */
     one_per_thread_t<auto_drainer_t> per_thread_drainers;
 };
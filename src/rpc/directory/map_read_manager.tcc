@@ -6,6 +6,8 @@
 
 #include "concurrency/wait_any.hpp"
 #include "containers/archive/optional.hpp"
+#include "containers/archive/string_stream.hpp"
+#include "rpc/directory/delta.hpp"
 
 template<class key_t, class value_t>
 directory_map_read_manager_t<key_t, value_t>::directory_map_read_manager_t(
@@ -33,21 +35,113 @@ void directory_map_read_manager_t<key_t, value_t>::on_message(
     if (res != archive_result_t::SUCCESS) {
         throw fake_archive_exc_t();
     }
-    key_t key;
-    res = deserialize<cluster_version_t::CLUSTER>(s, &key);
+    uint64_t num_updates;
+    res = deserialize<cluster_version_t::CLUSTER>(s, &num_updates);
     if (res != archive_result_t::SUCCESS) {
         throw fake_archive_exc_t();
     }
-    optional<value_t> value;
-    res = deserialize<cluster_version_t::CLUSTER>(s, &value);
-    if (res != archive_result_t::SUCCESS) {
-        throw fake_archive_exc_t();
+    /* Messages from ourself never contain deltas, and we don't keep their values. See
+    `directory_map_write_manager_t::stream_to_conn()`. */
+    received_values_t *received = connection->is_loopback()
+        ? nullptr
+        : get_received_values(connection, connection_keepalive);
+    std::vector<std::pair<key_t, optional<value_t> > > updates;
+    for (uint64_t i = 0; i < num_updates; ++i) {
+        key_t key;
+        res = deserialize<cluster_version_t::CLUSTER>(s, &key);
+        if (res != archive_result_t::SUCCESS) {
+            throw fake_archive_exc_t();
+        }
+        directory_update_type_t type;
+        res = deserialize<cluster_version_t::CLUSTER>(s, &type);
+        if (res != archive_result_t::SUCCESS) {
+            throw fake_archive_exc_t();
+        }
+        std::string serialized_value;
+        switch (type) {
+        case directory_update_type_t::full: {
+            res = deserialize<cluster_version_t::CLUSTER>(s, &serialized_value);
+            if (res != archive_result_t::SUCCESS) {
+                throw fake_archive_exc_t();
+            }
+        } break;
+        case directory_update_type_t::delta: {
+            uint64_t base_timestamp;
+            res = deserialize<cluster_version_t::CLUSTER>(s, &base_timestamp);
+            if (res != archive_result_t::SUCCESS) {
+                throw fake_archive_exc_t();
+            }
+            directory_delta_t delta;
+            res = deserialize<cluster_version_t::CLUSTER>(s, &delta);
+            if (res != archive_result_t::SUCCESS) {
+                throw fake_archive_exc_t();
+            }
+            /* If we don't have the value that the delta is against, something went
+            wrong. Dropping the connection will make the peer start over from full
+            values when it reconnects. */
+            if (received == nullptr) {
+                throw fake_archive_exc_t();
+            }
+            auto it = received->find(key);
+            if (it == received->end() || it->second.first != base_timestamp ||
+                    !delta.apply(it->second.second, &serialized_value)) {
+                throw fake_archive_exc_t();
+            }
+        } break;
+        case directory_update_type_t::deleted:
+            if (received != nullptr) {
+                received->erase(key);
+            }
+            updates.push_back(std::make_pair(key, optional<value_t>()));
+            continue;
+        default:
+            unreachable();
+        }
+        value_t value;
+        {
+            string_read_stream_t value_stream(std::move(serialized_value), 0);
+            res = deserialize<cluster_version_t::CLUSTER>(&value_stream, &value);
+            if (res != archive_result_t::SUCCESS) {
+                throw fake_archive_exc_t();
+            }
+            /* Take the serialized value back, so we can keep it for the next delta */
+            int64_t offset = 0;
+            value_stream.swap(&serialized_value, &offset);
+        }
+        if (received != nullptr) {
+            (*received)[key] = std::make_pair(timestamp, std::move(serialized_value));
+        }
+        updates.push_back(std::make_pair(key, make_optional(std::move(value))));
     }
     auto_drainer_t::lock_t this_keepalive(per_thread_drainers.get());
     coro_t::spawn_sometime(std::bind(
         &directory_map_read_manager_t::do_update, this,
         connection->get_peer_id(), connection_keepalive, this_keepalive,
-        timestamp, key, value));
+        timestamp, std::move(updates)));
+}
+
+template<class key_t, class value_t>
+typename directory_map_read_manager_t<key_t, value_t>::received_values_t *
+directory_map_read_manager_t<key_t, value_t>::get_received_values(
+        connectivity_cluster_t::connection_t *connection,
+        const auto_drainer_t::lock_t &connection_keepalive) {
+    auto res = received_values.get()->insert(
+        std::make_pair(connection, received_values_t()));
+    if (res.second) {
+        /* Forget the values once the connection goes away. We hold
+        `connection_keepalive` until then, so `connection` can't be reused for a
+        different connection in the meantime. */
+        auto_drainer_t::lock_t this_keepalive(per_thread_drainers.get());
+        coro_t::spawn_sometime([this, connection, connection_keepalive,
+                this_keepalive]() {
+            wait_any_t waiter(
+                connection_keepalive.get_drain_signal(),
+                this_keepalive.get_drain_signal());
+            waiter.wait_lazily_unordered();
+            this->received_values.get()->erase(connection);
+        });
+    }
+    return &res.first->second;
 }
 
 template<class key_t, class value_t>
@@ -56,8 +150,7 @@ void directory_map_read_manager_t<key_t, value_t>::do_update(
         auto_drainer_t::lock_t connection_keepalive,
         auto_drainer_t::lock_t this_keepalive,
         uint64_t timestamp,
-        const key_t &key,
-        const optional<value_t> &value) {
+        const std::vector<std::pair<key_t, optional<value_t> > > &updates) {
     /* If we're the first call to `do_update()` for this connection, then we create the
     entry in `timestamps` for this peer, and then the coroutine stays alive and waits for
     the connection to end so it can clean up. If we're not the first call to
@@ -68,24 +161,28 @@ void directory_map_read_manager_t<key_t, value_t>::do_update(
         auto pair = timestamps.insert(std::make_pair(
             peer_id, std::map<key_t, uint64_t>()));
         should_cleanup = pair.second;
-        /* If there's no entry in `timestamps` for this key, or there is an entry but the
-        timestamp is earlier, then we should deliver our update. Otherwise, we shouldn't,
-        because we don't want to overwrite a later value. */
-        auto pair2 = pair.first->second.insert(std::make_pair(key, timestamp));
-        bool should_update = false;
-        if (pair2.second) {
-            should_update = true;
-        } else {
-            if (pair2.first->second < timestamp) {
-                pair2.first->second = timestamp;
+        for (const auto &update : updates) {
+            const key_t &key = update.first;
+            const optional<value_t> &value = update.second;
+            /* If there's no entry in `timestamps` for this key, or there is an entry but
+            the timestamp is earlier, then we should deliver our update. Otherwise, we
+            shouldn't, because we don't want to overwrite a later value. */
+            auto pair2 = pair.first->second.insert(std::make_pair(key, timestamp));
+            bool should_update = false;
+            if (pair2.second) {
                 should_update = true;
-            }
-        }
-        if (should_update) {
-            if (static_cast<bool>(value)) {
-                map_var.set_key_no_equals(std::make_pair(peer_id, key), *value);
             } else {
-                map_var.delete_key(std::make_pair(peer_id, key));
+                if (pair2.first->second < timestamp) {
+                    pair2.first->second = timestamp;
+                    should_update = true;
+                }
+            }
+            if (should_update) {
+                if (static_cast<bool>(value)) {
+                    map_var.set_key_no_equals(std::make_pair(peer_id, key), *value);
+                } else {
+                    map_var.delete_key(std::make_pair(peer_id, key));
+                }
             }
         }
     }
@@ -2,6 +2,11 @@
 #ifndef RPC_DIRECTORY_WRITE_MAP_MANAGER_HPP_
 #define RPC_DIRECTORY_WRITE_MAP_MANAGER_HPP_
 
+#include <map>
+#include <set>
+#include <string>
+#include <utility>
+
 #include "concurrency/auto_drainer.hpp"
 #include "concurrency/new_semaphore.hpp"
 #include "concurrency/watchable_map.hpp"
@@ -32,8 +37,18 @@ private:
         and `pulse_on_dirty` will be pulsed if it is non-null. */
         std::set<key_t> dirty_keys;
         cond_t *pulse_on_dirty;
+        /* For each key, the timestamp and the serialized value that we last sent over
+        the connection. The next change to the key is sent as a delta against it. */
+        std::map<key_t, std::pair<uint64_t, std::string> > sent_values;
     };
 
+    /* After a change, we wait this long for more changes before sending anything, so
+    that they can go out together. */
+    static const int64_t batch_window_ms = 10;
+
+    /* We stop adding keys to a message once it's about this big. */
+    static const size_t max_batch_bytes = 64 * KILOBYTE;
+
     void on_connection_change(
         const peer_id_t &peer_id,
         const connectivity_cluster_t::connection_pair_t *pair);
@@ -4,8 +4,11 @@
 
 #include "rpc/directory/map_write_manager.hpp"
 
+#include "arch/timing.hpp"
 #include "concurrency/wait_any.hpp"
 #include "containers/archive/optional.hpp"
+#include "containers/archive/string_stream.hpp"
+#include "rpc/directory/delta.hpp"
 
 template<class key_t, class value_t>
 directory_map_write_manager_t<key_t, value_t>::directory_map_write_manager_t(
@@ -41,15 +44,81 @@ class directory_map_write_manager_t<key_t, value_t>::update_writer_t :
     public cluster_send_message_write_callback_t
 {
 public:
-    update_writer_t(
-            uint64_t _timestamp, const key_t &_key, optional<value_t> &&_value) :
-        timestamp(_timestamp), key(_key), value(std::move(_value)) { }
+    explicit update_writer_t(uint64_t _timestamp) :
+        timestamp(_timestamp), size(0) { }
+
+    /* Adds the current value of `key` to the message, as a delta against the one in
+    `sent_values` if that's smaller, and records it in `sent_values`. */
+    void add(const key_t &key,
+             const optional<value_t> &value,
+             bool use_deltas,
+             std::map<key_t, std::pair<uint64_t, std::string> > *sent_values) {
+        updates.emplace_back();
+        update_t *update = &updates.back();
+        update->key = key;
+        if (!value.has_value()) {
+            update->type = directory_update_type_t::deleted;
+            sent_values->erase(key);
+            return;
+        }
+        write_message_t wm;
+        serialize<cluster_version_t::CLUSTER>(&wm, value.get());
+        string_stream_t stream;
+        int res = send_write_message(&stream, &wm);
+        guarantee(res == 0);
+        update->type = directory_update_type_t::full;
+        update->full_value = std::move(stream.str());
+        if (use_deltas) {
+            auto it = sent_values->find(key);
+            if (it != sent_values->end()) {
+                directory_delta_t delta =
+                    directory_delta_t::compute(it->second.second, update->full_value);
+                if (delta.middle.size() < update->full_value.size() / 2) {
+                    update->type = directory_update_type_t::delta;
+                    update->base_timestamp = it->second.first;
+                    update->delta = std::move(delta);
+                }
+            }
+            std::pair<uint64_t, std::string> *sent = &(*sent_values)[key];
+            sent->first = timestamp;
+            if (update->type == directory_update_type_t::delta) {
+                sent->second = std::move(update->full_value);
+                update->full_value.clear();
+            } else {
+                sent->second = update->full_value;
+            }
+        }
+        size += update->type == directory_update_type_t::delta
+            ? update->delta.middle.size()
+            : update->full_value.size();
+    }
+
+    /* Roughly how many bytes of values the message contains */
+    size_t get_size() const {
+        return size;
+    }
 
     void write(write_stream_t *s) {
         write_message_t wm;
         serialize<cluster_version_t::CLUSTER>(&wm, timestamp);
-        serialize<cluster_version_t::CLUSTER>(&wm, key);
-        serialize<cluster_version_t::CLUSTER>(&wm, value);
+        serialize<cluster_version_t::CLUSTER>(&wm, static_cast<uint64_t>(updates.size()));
+        for (const update_t &update : updates) {
+            serialize<cluster_version_t::CLUSTER>(&wm, update.key);
+            serialize<cluster_version_t::CLUSTER>(&wm, update.type);
+            switch (update.type) {
+            case directory_update_type_t::full:
+                serialize<cluster_version_t::CLUSTER>(&wm, update.full_value);
+                break;
+            case directory_update_type_t::delta:
+                serialize<cluster_version_t::CLUSTER>(&wm, update.base_timestamp);
+                serialize<cluster_version_t::CLUSTER>(&wm, update.delta);
+                break;
+            case directory_update_type_t::deleted:
+                break;
+            default:
+                unreachable();
+            }
+        }
         int res = send_write_message(s, &wm);
         if (res) {
             throw fake_archive_exc_t();
@@ -65,9 +134,20 @@ public:
 #endif
 
 private:
+    class update_t {
+    public:
+        key_t key;
+        directory_update_type_t type;
+        /* If `type` is `full`, the serialized value */
+        std::string full_value;
+        /* If `type` is `delta`, the delta and the timestamp of the value it's against */
+        uint64_t base_timestamp;
+        directory_delta_t delta;
+    };
+
     uint64_t timestamp;
-    key_t key;
-    optional<value_t> value;
+    std::vector<update_t> updates;
+    size_t size;
 };
 
 template<class key_t, class value_t>
@@ -98,6 +178,11 @@ void directory_map_write_manager_t<key_t, value_t>::stream_to_conn(
         wait_any_t interruptor(
             connection_keepalive.get_drain_signal(),
             this_keepalive.get_drain_signal());
+        /* The read manager applies deltas as messages arrive, so it needs them to
+        arrive in order. That's the case over a real connection, but messages to
+        ourselves can be handled on any thread. There's nothing to save there anyway. */
+        const bool use_deltas = !connection->is_loopback();
+        bool first_batch = true;
         while (true) {
             /* Wait until there is at least one dirty key. */
             if (conns_entry->second.dirty_keys.empty()) {
@@ -108,22 +193,37 @@ void directory_map_write_manager_t<key_t, value_t>::stream_to_conn(
                 wait_interruptible(&pulse_on_dirty, &interruptor);
             }
 
+            /* Give other changes a chance to join this one. We don't delay the initial
+            values, since the peer has nothing at all until they arrive. */
+            if (!first_batch) {
+                nap(batch_window_ms, &interruptor);
+            }
+            first_batch = false;
+
             /* Copy all dirty keys to a local variable, then iterate over that variable.
             The naive approach would be to always send the first dirty key in
             `conns_entry` until there are no dirty keys left; but that has starvation
             issues. */
             std::set<key_t> dirty_keys;
             std::swap(dirty_keys, conns_entry->second.dirty_keys);
-            for (const key_t &key : dirty_keys) {
+            auto it = dirty_keys.begin();
+            while (it != dirty_keys.end()) {
                 if (interruptor.is_pulsed()) {
                     throw interrupted_exc_t();
                 }
-                /* If the key changed again since we copied `dirty_keys`, we'll be
-                sending the newest value, because we didn't copy the value at the same
-                time as we copied `dirty_keys`. So it's OK to remove the key from
-                `dirty_keys` to prevent sending a redundant message. */
-                conns_entry->second.dirty_keys.erase(key);
-                update_writer_t writer(timestamp, key, value->get_key(key));
+                /* Several keys go into each message. We don't block while filling in
+                the message, so its values are all consistent with `timestamp`. */
+                update_writer_t writer(timestamp);
+                for (; it != dirty_keys.end() && writer.get_size() < max_batch_bytes;
+                        ++it) {
+                    /* If the key changed again since we copied `dirty_keys`, we'll be
+                    sending the newest value, because we didn't copy the value at the
+                    same time as we copied `dirty_keys`. So it's OK to remove the key
+                    from `dirty_keys` to prevent sending a redundant message. */
+                    conns_entry->second.dirty_keys.erase(*it);
+                    writer.add(*it, value->get_key(*it), use_deltas,
+                        &conns_entry->second.sent_values);
+                }
                 connectivity_cluster->send_message(
                     connection, connection_keepalive, message_tag, &writer);
             }
@@ -7,6 +7,7 @@
 
 #include "debug.hpp"
 #include "containers/archive/archive.hpp"
+#include "containers/archive/buffer_stream.hpp"
 #include "containers/archive/vector_stream.hpp"
 #include "containers/archive/versioned.hpp"
 #include "concurrency/pmap.hpp"
@@ -75,6 +76,13 @@ public:
     virtual ~raw_mailbox_writer_t() { }
 
     void write(write_stream_t *stream) {
+        write_message_t msg;
+        write_message(&msg);
+        int res = send_write_message(stream, &msg);
+        if (res) { throw fake_archive_exc_t(); }
+    }
+
+    void write_message(write_message_t *msg) {
         write_message_t wm;
         // Right now, we serialize this length/thread/mailbox information the same
         // way irrespective of version. (Serialization methods for primitive types
@@ -87,17 +95,10 @@ public:
 
         subwriter->write(cluster_version_t::CLUSTER, &wm);
 
-        // Prepend the message length.
-        // TODO: It would be more efficient if we could make this part of `msg`.
-        //  e.g. with a `prepend()` method on write_message_t.
-        write_message_t length_msg;
-        serialize_universal(&length_msg,
-                            static_cast<uint64_t>(wm.size()) - prefix_length);
-
-        int res = send_write_message(stream, &length_msg);
-        if (res) { throw fake_archive_exc_t(); }
-        res = send_write_message(stream, &wm);
-        if (res) { throw fake_archive_exc_t(); }
+        // Prepend the message length. Moving the buffers of `wm` behind it doesn't
+        // copy them.
+        serialize_universal(msg, static_cast<uint64_t>(wm.size()) - prefix_length);
+        msg->append_and_clear(&wm);
     }
 
 #ifdef ENABLE_MESSAGE_PROFILER
@@ -113,20 +114,26 @@ private:
 };
 
 void send_write(mailbox_manager_t *src, raw_mailbox_t::address_t dest,
-                mailbox_write_callback_t *callback) {
+                mailbox_write_callback_t *callback,
+                connectivity_cluster_t::message_class_t message_class) {
     guarantee(src);
     guarantee(!dest.is_nil());
-    new_semaphore_in_line_t acq(src->semaphores.get(), 1);
-    acq.acquisition_signal()->wait();
     connectivity_cluster_t::connection_t *connection;
     auto_drainer_t::lock_t connection_keepalive;
     if (!(connection = src->get_connectivity_cluster()->get_connection(
             dest.peer, &connection_keepalive))) {
         return;
     }
+    /* If the peer has no stream for this class, the message goes over the main
+    connection and has to wait its turn with the other control messages. */
+    if (!connection->has_stream(message_class)) {
+        message_class = connectivity_cluster_t::message_class_t::CONTROL;
+    }
+    new_semaphore_in_line_t acq(src->semaphores.get()->get(message_class), 1);
+    acq.acquisition_signal()->wait();
     raw_mailbox_writer_t writer(dest.thread, dest.mailbox_id, callback);
     src->get_connectivity_cluster()->send_message(connection, connection_keepalive,
-        src->get_message_tag(), &writer);
+        src->get_message_tag(), &writer, message_class);
 }
 
 static const int MAX_OUTSTANDING_MAILBOX_WRITES_PER_THREAD = 4;
@@ -137,6 +144,19 @@ mailbox_manager_t::mailbox_manager_t(connectivity_cluster_t *_connectivity_clust
     semaphores(MAX_OUTSTANDING_MAILBOX_WRITES_PER_THREAD)
     { }
 
+mailbox_manager_t::semaphores_t::semaphores_t(int64_t capacity) :
+    control(capacity), query(capacity), backfill(capacity) { }
+
+new_semaphore_t *mailbox_manager_t::semaphores_t::get(
+        connectivity_cluster_t::message_class_t message_class) {
+    switch (message_class) {
+    case connectivity_cluster_t::message_class_t::CONTROL: return &control;
+    case connectivity_cluster_t::message_class_t::QUERY: return &query;
+    case connectivity_cluster_t::message_class_t::BACKFILL: return &backfill;
+    default: unreachable();
+    }
+}
+
 mailbox_manager_t::mailbox_table_t::mailbox_table_t() {
     next_mailbox_id = (UINT64_MAX / get_num_threads()) * get_thread_id().threadnum;
 }
@@ -153,7 +173,7 @@ mailbox_manager_t::mailbox_table_t::~mailbox_table_t() {
 }
 
 raw_mailbox_t *mailbox_manager_t::mailbox_table_t::find_mailbox(raw_mailbox_t::id_t id) {
-    std::map<raw_mailbox_t::id_t, raw_mailbox_t *>::iterator it = mailboxes.find(id);
+    auto it = mailboxes.find(id);
     if (it == mailboxes.end()) {
         return nullptr;
     } else {
@@ -207,13 +227,14 @@ void mailbox_manager_t::on_local_message(
     }
 
     // We use `spawn_now_dangerously()` to avoid having to heap-allocate `stream_data`.
-    // Instead we pass in a pointer to our local automatically allocated object
-    // and `mailbox_read_coroutine()` moves the data out of it before it yields.
+    // Instead we capture a reference to our local automatically allocated object
+    // and the coroutine moves the data out of it before it yields.
     coro_t::spawn_now_dangerously(
         [this, mbox_header, &stream_data, stream_data_offset]() {
+            vector_read_stream_t data_stream(std::move(stream_data), stream_data_offset);
             mailbox_read_coroutine(
                 threadnum_t(mbox_header.dest_thread), mbox_header.dest_mailbox_id,
-                &stream_data, stream_data_offset, FORCE_YIELD);
+                &data_stream, FORCE_YIELD);
         });
 }
 
@@ -225,37 +246,30 @@ void mailbox_manager_t::on_message(
     read_mailbox_header(stream, &mbox_header);
 
     // Read the data from the read stream, so it can be deallocated before we continue
-    // in a coroutine
-    std::vector<char> stream_data;
-    stream_data.resize(mbox_header.data_length);
-    int64_t bytes_read = force_read(stream, stream_data.data(), mbox_header.data_length);
+    // in a coroutine. We read it into a shared buffer, so that large datums in the
+    // message can point into it when they are deserialized instead of being copied
+    // out of it again.
+    counted_t<shared_buf_t> stream_data = shared_buf_t::create(mbox_header.data_length);
+    int64_t bytes_read = force_read(stream, stream_data->data(), mbox_header.data_length);
     if (bytes_read != static_cast<int64_t>(mbox_header.data_length)) {
         throw fake_archive_exc_t();
     }
 
-    // We use `spawn_now_dangerously()` to avoid having to heap-allocate `stream_data`.
-    // Instead we pass in a pointer to our local automatically allocated object
-    // and `mailbox_read_coroutine()` moves the data out of it before it yields.
     coro_t::spawn_now_dangerously(
         [this, mbox_header, &stream_data]() {
+            shared_buf_read_stream_t data_stream(
+                shared_buf_ref_t<char>(std::move(stream_data), 0));
             mailbox_read_coroutine(
                 threadnum_t(mbox_header.dest_thread), mbox_header.dest_mailbox_id,
-                &stream_data, 0, MAYBE_YIELD);
+                &data_stream, MAYBE_YIELD);
         });
 }
 
 void mailbox_manager_t::mailbox_read_coroutine(
         threadnum_t dest_thread,
         raw_mailbox_t::id_t dest_mailbox_id,
-        std::vector<char> *stream_data,
-        int64_t stream_data_offset,
+        read_stream_t *stream,
         force_yield_t force_yield) {
-
-    // Construct a new stream to use
-    vector_read_stream_t stream(std::move(*stream_data), stream_data_offset);
-    stream_data = nullptr; // <- It is not safe to use `stream_data` anymore once we
-                        //    switch the thread
-
     {
         on_thread_t rethreader(dest_thread);
         if (force_yield == FORCE_YIELD && rethreader.home_thread() == get_thread_id()) {
@@ -269,7 +283,7 @@ void mailbox_manager_t::mailbox_read_coroutine(
             if (mbox != nullptr) {
                 try {
                     auto_drainer_t::lock_t keepalive(&mbox->drainer);
-                    mbox->callback->read(&stream, keepalive.get_drain_signal());
+                    mbox->callback->read(stream, keepalive.get_drain_signal());
                 } catch (const interrupted_exc_t &) {
                     /* Do nothing. It's no longer safe to access `mbox` (because the
                     destructor is running) but otherwise we don't need to take any
@@ -289,10 +303,7 @@ raw_mailbox_t::id_t mailbox_manager_t::generate_mailbox_id() {
 
 raw_mailbox_t::id_t mailbox_manager_t::register_mailbox(raw_mailbox_t *mb) {
     raw_mailbox_t::id_t id = generate_mailbox_id();
-    std::map<raw_mailbox_t::id_t, raw_mailbox_t *> *mailboxes =
-        &mailbox_tables.get()->mailboxes;
-    std::pair<std::map<raw_mailbox_t::id_t, raw_mailbox_t *>::iterator, bool> res
-        = mailboxes->insert(std::make_pair(id, mb));
+    auto res = mailbox_tables.get()->mailboxes.emplace(id, mb);
     guarantee(res.second);  // Assert a new element was inserted.
     return id;
 }
@@ -10,6 +10,7 @@
 #include "concurrency/new_semaphore.hpp"
 #include "containers/archive/archive.hpp"
 #include "containers/archive/vector_stream.hpp"
+#include "containers/flat_hash_map.hpp"
 #include "rpc/connectivity/cluster.hpp"
 #include "rpc/semilattice/joins/macros.hpp"
 
@@ -53,7 +54,8 @@ public:
 private:
     friend class mailbox_manager_t;
     friend class raw_mailbox_writer_t;
-    friend void send_write(mailbox_manager_t *, address_t, mailbox_write_callback_t *);
+    friend void send_write(mailbox_manager_t *, address_t, mailbox_write_callback_t *,
+                           connectivity_cluster_t::message_class_t);
 
     mailbox_manager_t *manager;
 
@@ -98,7 +100,9 @@ public:
         RDB_MAKE_ME_SERIALIZABLE_3(address_t, peer, thread, mailbox_id);
 
     private:
-        friend void send_write(mailbox_manager_t *, raw_mailbox_t::address_t, mailbox_write_callback_t *callback);
+        friend void send_write(mailbox_manager_t *, raw_mailbox_t::address_t,
+                               mailbox_write_callback_t *callback,
+                               connectivity_cluster_t::message_class_t);
         friend struct raw_mailbox_t;
         friend class mailbox_manager_t;
 
@@ -127,11 +131,15 @@ public:
 
 /* `send_write()` sends a message to a mailbox. `send_write()` can block and must be called
 in a coroutine. If the mailbox does not exist or the peer is disconnected, `send_write()`
-will silently fail. Mailbox messages are not necessarily delivered in order. */
+will silently fail. Mailbox messages are not necessarily delivered in order.
+`message_class` picks the TCP connection that carries the message if the peer has
+parallel streams; see `connectivity_cluster_t::message_class_t`. */
 
 void send_write(mailbox_manager_t *src,
                 raw_mailbox_t::address_t dest,
-                mailbox_write_callback_t *callback);
+                mailbox_write_callback_t *callback,
+                connectivity_cluster_t::message_class_t message_class =
+                    connectivity_cluster_t::message_class_t::CONTROL);
 
 /* `mailbox_manager_t` is a `cluster_message_handler_t` that takes care
 of actually routing messages to mailboxes. */
@@ -143,22 +151,30 @@ public:
 
 private:
     friend struct raw_mailbox_t;
-    friend void send_write(mailbox_manager_t *, raw_mailbox_t::address_t, mailbox_write_callback_t *callback);
+    friend void send_write(mailbox_manager_t *, raw_mailbox_t::address_t,
+                           mailbox_write_callback_t *callback,
+                           connectivity_cluster_t::message_class_t);
 
     struct mailbox_table_t {
         mailbox_table_t();
         ~mailbox_table_t();
         raw_mailbox_t::id_t next_mailbox_id;
-        // TODO: use a buffered structure to reduce dynamic allocation
-        std::map<raw_mailbox_t::id_t, raw_mailbox_t *> mailboxes;
+        // Every incoming message looks up its mailbox here.
+        flat_hash_map_t<raw_mailbox_t::id_t, raw_mailbox_t *> mailboxes;
         raw_mailbox_t *find_mailbox(raw_mailbox_t::id_t);
     };
     one_per_thread_t<mailbox_table_t> mailbox_tables;
 
     /* We must acquire one of these semaphores whenever we want to send a message over a
     mailbox. This prevents mailbox messages from starving directory and semilattice
-    messages. */
-    one_per_thread_t<new_semaphore_t> semaphores;
+    messages. Messages that go over a parallel stream use the semaphore of their class,
+    so that they don't hold up the messages on other connections. */
+    struct semaphores_t {
+        explicit semaphores_t(int64_t capacity);
+        new_semaphore_t *get(connectivity_cluster_t::message_class_t message_class);
+        new_semaphore_t control, query, backfill;
+    };
+    one_per_thread_t<semaphores_t> semaphores;
 
     raw_mailbox_t::id_t generate_mailbox_id();
 
@@ -178,10 +194,11 @@ private:
                           std::vector<char> &&data);
 
     enum force_yield_t {FORCE_YIELD, MAYBE_YIELD};
+    /* Delivers the message in `stream` to the mailbox. `stream` must be on the
+    stack of the calling coroutine, because this switches threads. */
     void mailbox_read_coroutine(threadnum_t dest_thread,
                                 raw_mailbox_t::id_t dest_mailbox_id,
-                                std::vector<char> *stream_data,
-                                int64_t stream_data_offset,
+                                read_stream_t *stream,
                                 force_yield_t force_yield);
 };
 
@@ -29,7 +29,8 @@ public:
 
 private:
     template <class... Args2>
-    friend void send(mailbox_manager_t *, mailbox_addr_t<Args2...>, const Args2 &... args);
+    friend void send(mailbox_manager_t *, connectivity_cluster_t::message_class_t,
+                     mailbox_addr_t<Args2...>, const Args2 &... args);
 
     raw_mailbox_t::address_t addr;
 };
@@ -74,7 +75,8 @@ public:
 
 private:
     template <class... Args2>
-    friend void send(mailbox_manager_t *, mailbox_addr_t<Args2...>, const Args2 &... args);
+    friend void send(mailbox_manager_t *, connectivity_cluster_t::message_class_t,
+                     mailbox_addr_t<Args2...>, const Args2 &... args);
 
     std::function< void(signal_t *, Args...) > fun;
     raw_mailbox_t mailbox;
@@ -99,10 +101,20 @@ public:
 #endif
 };
 
+/* `message_class` tells the cluster which connection the message should go over if the
+peer has parallel streams; see `connectivity_cluster_t::message_class_t`. Messages that
+carry query traffic or backfill data should say so, so that they don't hold up the
+control messages on the main connection. */
 template <class... Args>
-void send(mailbox_manager_t *src, mailbox_addr_t<Args...> dest, const Args &... args) {
+void send(mailbox_manager_t *src, connectivity_cluster_t::message_class_t message_class,
+          mailbox_addr_t<Args...> dest, const Args &... args) {
     mailbox_write_impl<Args...> writer(args...);
-    send_write(src, dest.addr, &writer);
+    send_write(src, dest.addr, &writer, message_class);
+}
+
+template <class... Args>
+void send(mailbox_manager_t *src, mailbox_addr_t<Args...> dest, const Args &... args) {
+    send(src, connectivity_cluster_t::message_class_t::CONTROL, dest, args...);
 }
 
 #endif // RPC_MAILBOX_TYPED_HPP_
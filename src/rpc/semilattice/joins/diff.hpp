@@ -0,0 +1,18 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#ifndef RPC_SEMILATTICE_JOINS_DIFF_HPP_
+#define RPC_SEMILATTICE_JOINS_DIFF_HPP_
+
+/* `semilattice_diff(before, after, &diff)` sets `diff` to a value such that joining it
+into `before` gives `after`, where `after` is the result of joining something into
+`before`. `semilattice_manager_t` uses it to send peers only the part of the metadata
+that a change touched.
+
+This default just copies all of `after`. Types that are made of independently
+versioned sub-objects should overload it to return only the sub-objects that differ;
+`rpc/semilattice/joins/map.hpp` does that for `std::map`. */
+template<class T>
+void semilattice_diff(const T &, const T &after, T *diff_out) {
+    *diff_out = after;
+}
+
+#endif /* RPC_SEMILATTICE_JOINS_DIFF_HPP_ */
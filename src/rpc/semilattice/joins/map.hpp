@@ -4,6 +4,8 @@
 
 #include <map>
 
+#include "rpc/semilattice/joins/diff.hpp"
+
 /* We join `std::map`s by taking their union and resolving conflicts by doing a
 semilattice join on the values. */
 
@@ -21,6 +23,22 @@ void semilattice_join(std::map<key_t, value_t> *a, const std::map<key_t, value_t
     }
 }
 
+/* For `semilattice_diff()` (see `rpc/semilattice/joins/diff.hpp`), the entries of a
+map are the independently versioned sub-objects: the diff is the entries of `after`
+that aren't the same in `before`. */
+template<class key_t, class value_t>
+void semilattice_diff(const std::map<key_t, value_t> &before,
+                      const std::map<key_t, value_t> &after,
+                      std::map<key_t, value_t> *diff_out) {
+    diff_out->clear();
+    for (const auto &pair : after) {
+        auto it = before.find(pair.first);
+        if (it == before.end() || !(it->second == pair.second)) {
+            diff_out->insert(diff_out->end(), pair);
+        }
+    }
+}
+
 }   /* namespace std */
 
 #endif /* RPC_SEMILATTICE_JOINS_MAP_HPP_ */
@@ -66,6 +66,8 @@ private:
     class sync_from_reply_writer_t;
     class sync_to_query_writer_t;
     class sync_to_reply_writer_t;
+    class hash_writer_t;
+    class metadata_request_writer_t;
 
     /* These are called by the `connectivity_cluster_t`. They shouldn't block. */
     void on_message(connectivity_cluster_t::connection_t *, auto_drainer_t::lock_t,
@@ -75,6 +77,9 @@ private:
         const connectivity_cluster_t::connection_pair_t *pair);
 
     void join_metadata_locally(metadata_t);
+    /* Records that we've seen `peer`'s metadata up to `version`, and wakes up anything
+    in `wait_for_version_from_peer()` that was waiting for it. */
+    void note_version_from_peer(peer_id_t peer, metadata_version_t version);
     void wait_for_version_from_peer(peer_id_t peer, metadata_version_t version, signal_t *interruptor) THROWS_ONLY(interrupted_exc_t, sync_failed_exc_t);
 
     const std::shared_ptr<root_view_t> root_view;
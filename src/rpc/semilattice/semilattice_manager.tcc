@@ -11,8 +11,10 @@
 #include "concurrency/pmap.hpp"
 #include "concurrency/promise.hpp"
 #include "concurrency/wait_any.hpp"
+#include "containers/archive/string_stream.hpp"
 #include "containers/archive/versioned.hpp"
 #include "logger.hpp"
+#include "rpc/semilattice/joins/diff.hpp"
 
 #define MAX_OUTSTANDING_SEMILATTICE_WRITES 4
 
@@ -66,8 +68,15 @@ void semilattice_manager_t<metadata_t>::root_view_t::join(const metadata_t &adde
     parent->assert_thread();
 
     metadata_version_t new_version = ++parent->metadata_version;
+    metadata_t old_metadata = parent->metadata;
     parent->join_metadata_locally(added_metadata);
 
+    /* Callers usually pass in the whole metadata with one part changed, so we only
+    send the part that actually changed. We still send a message if nothing did, so
+    that `sync_to()` sees the new version. */
+    metadata_t changes;
+    semilattice_diff(old_metadata, parent->metadata, &changes);
+
     /* Distribute changes to all peers we can currently see. If we can't
     currently see a peer, that's OK; it will hear about the metadata change when
     it reconnects, via the `semilattice_manager_t`'s `on_connections_change()`
@@ -81,8 +90,8 @@ void semilattice_manager_t<metadata_t>::root_view_t::join(const metadata_t &adde
         coro_t::spawn_sometime(
             [this, parent_keepalive /* important to capture */,
              connection, connection_keepalive /* important to capture */,
-             new_version, added_metadata]() {
-                metadata_writer_t writer(added_metadata, new_version);
+             new_version, changes]() {
+                metadata_writer_t writer(changes, new_version);
                 new_semaphore_in_line_t acq(&parent->semaphore, 1);
                 acq.acquisition_signal()->wait();
                 parent->get_connectivity_cluster()->send_message(connection,
@@ -96,6 +105,26 @@ static const char message_code_sync_from_query = 'F';
 static const char message_code_sync_from_reply = 'f';
 static const char message_code_sync_to_query = 'T';
 static const char message_code_sync_to_reply = 't';
+static const char message_code_hash = 'H';
+static const char message_code_metadata_request = 'R';
+
+/* `hash_metadata()` is used to check if two peers already have the same metadata when
+they connect, so they only have to exchange it if not. The hash has to be the same on
+every server, so we don't use `std::hash`. This is 64-bit FNV-1a. */
+template <class metadata_t>
+uint64_t hash_metadata(const metadata_t &metadata) {
+    write_message_t wm;
+    serialize<cluster_version_t::CLUSTER>(&wm, metadata);
+    string_stream_t stream;
+    int res = send_write_message(&stream, &wm);
+    guarantee(res == 0);
+    uint64_t hash = 14695981039346656037ull;
+    for (char c : stream.str()) {
+        hash ^= static_cast<uint8_t>(c);
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
 
 template <class metadata_t>
 class semilattice_manager_t<metadata_t>::metadata_writer_t :
@@ -253,6 +282,61 @@ private:
     sync_to_query_id_t query_id;
 };
 
+template <class metadata_t>
+class semilattice_manager_t<metadata_t>::hash_writer_t :
+        public cluster_send_message_write_callback_t
+{
+public:
+    hash_writer_t(uint64_t _hash, metadata_version_t _version) :
+        hash(_hash), version(_version) { }
+
+    void write(write_stream_t *stream) {
+        write_message_t wm;
+        // All cluster versions so far use a uint8_t code.
+        uint8_t code = message_code_hash;
+        serialize_universal(&wm, code);
+        serialize<cluster_version_t::CLUSTER>(&wm, hash);
+        serialize<cluster_version_t::CLUSTER>(&wm, version);
+        int res = send_write_message(stream, &wm);
+        if (res) { throw fake_archive_exc_t(); }
+    }
+
+#ifdef ENABLE_MESSAGE_PROFILER
+    const char *message_profiler_tag() const {
+        static const std::string tag =
+            strprintf("semilattice<%s>.hash", typeid(metadata_t).name());
+        return tag.c_str();
+    }
+#endif
+
+private:
+    uint64_t hash;
+    metadata_version_t version;
+};
+
+template <class metadata_t>
+class semilattice_manager_t<metadata_t>::metadata_request_writer_t :
+        public cluster_send_message_write_callback_t
+{
+public:
+    void write(write_stream_t *stream) {
+        write_message_t wm;
+        // All cluster versions so far use a uint8_t code.
+        uint8_t code = message_code_metadata_request;
+        serialize_universal(&wm, code);
+        int res = send_write_message(stream, &wm);
+        if (res) { throw fake_archive_exc_t(); }
+    }
+
+#ifdef ENABLE_MESSAGE_PROFILER
+    const char *message_profiler_tag() const {
+        static const std::string tag =
+            strprintf("semilattice<%s>.metadata_request", typeid(metadata_t).name());
+        return tag.c_str();
+    }
+#endif
+};
+
 template<class metadata_t>
 void semilattice_manager_t<metadata_t>::root_view_t::sync_from(peer_id_t peer, signal_t *interruptor) THROWS_ONLY(interrupted_exc_t, sync_failed_exc_t) {
     guarantee(parent, "accessing `semilattice_manager_t` root view when cluster no longer exists");
@@ -373,21 +457,56 @@ void semilattice_manager_t<metadata_t>::on_message(
                 /* This is the meat of the change */
                 this->join_metadata_locally(added_metadata);
                 /* Also notify anything that was waiting for us to reach this version */
-                DEBUG_VAR mutex_assertion_t::acq_t acq(&this->peer_version_mutex);
-                auto inserted = this->last_versions_seen.insert(
-                    std::make_pair(sender, change_version));
-                if (!inserted.second) {
-                    inserted.first->second =
-                        std::max(inserted.first->second, change_version);
+                this->note_version_from_peer(sender, change_version);
+            });
+            break;
+        }
+        /* A peer that just connected to us sent us a hash of its metadata. If ours is
+        the same, we already have all of its metadata up to the given version;
+        otherwise we ask for its metadata. */
+        case message_code_hash: {
+            uint64_t hash;
+            metadata_version_t version;
+            {
+                archive_result_t res =
+                    deserialize<cluster_version_t::CLUSTER>(stream, &hash);
+                if (bad(res)) { throw fake_archive_exc_t(); }
+                res = deserialize<cluster_version_t::CLUSTER>(stream, &version);
+                if (bad(res)) { throw fake_archive_exc_t(); }
+            }
+            coro_t::spawn_sometime([this, this_keepalive /* important to capture */,
+                    connection, connection_keepalive /* important to capture */,
+                    hash, version, sender, original_thread]() {
+                on_thread_t thread_switcher(home_thread());
+                if (hash_metadata(metadata) == hash) {
+                    this->note_version_from_peer(sender, version);
+                    return;
                 }
-                for (auto it = version_waiters.begin();
-                          it != version_waiters.end();
-                          it++) {
-                    if (it->first.first == sender &&
-                            it->first.second <= change_version &&
-                            !it->second->is_pulsed()) {
-                        it->second->pulse();
-                    }
+                metadata_request_writer_t writer;
+                new_semaphore_in_line_t acq(&this->semaphore, 1);
+                acq.acquisition_signal()->wait();
+                {
+                    on_thread_t thread_switcher_2(original_thread);
+                    get_connectivity_cluster()->send_message(connection,
+                        connection_keepalive, get_message_tag(), &writer);
+                }
+            });
+            break;
+        }
+        /* A peer found that its metadata is different from ours. We must send it our
+        metadata. */
+        case message_code_metadata_request: {
+            coro_t::spawn_sometime([this, this_keepalive /* important to capture */,
+                    connection, connection_keepalive /* important to capture */,
+                    original_thread]() {
+                on_thread_t thread_switcher(home_thread());
+                metadata_writer_t writer(metadata, metadata_version);
+                new_semaphore_in_line_t acq(&this->semaphore, 1);
+                acq.acquisition_signal()->wait();
+                {
+                    on_thread_t thread_switcher_2(original_thread);
+                    get_connectivity_cluster()->send_message(connection,
+                        connection_keepalive, get_message_tag(), &writer);
                 }
             });
             break;
@@ -529,7 +648,9 @@ void semilattice_manager_t<metadata_t>::on_connection_change(
         auto_drainer_t::lock_t this_keepalive(drainers.get());
         coro_t::spawn_sometime([this, this_keepalive /* important to capture */,
                 connection, connection_keepalive /* important to capture */]() {
-            metadata_writer_t writer(metadata, metadata_version);
+            /* Rather than sending the peer all of our metadata, we send a hash of it.
+            The peer will ask for the metadata if it has something different. */
+            hash_writer_t writer(hash_metadata(metadata), metadata_version);
             new_semaphore_in_line_t acq(&this->semaphore, 1);
             acq.acquisition_signal()->wait();
             get_connectivity_cluster()->send_message(connection,
@@ -552,6 +673,24 @@ void semilattice_manager_t<metadata_t>::join_metadata_locally(metadata_t added_m
         });
 }
 
+template<class metadata_t>
+void semilattice_manager_t<metadata_t>::note_version_from_peer(
+        peer_id_t peer, metadata_version_t version) {
+    assert_thread();
+    DEBUG_VAR mutex_assertion_t::acq_t acq(&peer_version_mutex);
+    auto inserted = last_versions_seen.insert(std::make_pair(peer, version));
+    if (!inserted.second) {
+        inserted.first->second = std::max(inserted.first->second, version);
+    }
+    for (auto it = version_waiters.begin(); it != version_waiters.end(); it++) {
+        if (it->first.first == peer &&
+                it->first.second <= version &&
+                !it->second->is_pulsed()) {
+            it->second->pulse();
+        }
+    }
+}
+
 template<class metadata_t>
 void semilattice_manager_t<metadata_t>::wait_for_version_from_peer(peer_id_t peer, metadata_version_t version, signal_t *interruptor) THROWS_ONLY(interrupted_exc_t, sync_failed_exc_t) {
     assert_thread();
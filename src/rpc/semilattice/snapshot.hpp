@@ -0,0 +1,40 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#ifndef RPC_SEMILATTICE_SNAPSHOT_HPP_
+#define RPC_SEMILATTICE_SNAPSHOT_HPP_
+
+#include <memory>
+
+#include "concurrency/per_thread_snapshot.hpp"
+#include "concurrency/pump_coro.hpp"
+#include "rpc/semilattice/view.hpp"
+
+/* `semilattice_snapshot_t` keeps a `per_thread_snapshot_t` up to date with a semilattice
+view. Create it on the view's home thread; `get()` may then be read from any thread.
+If the metadata changes several times while the last version is still being published,
+only the newest one gets published. */
+template<class metadata_t>
+class semilattice_snapshot_t {
+public:
+    explicit semilattice_snapshot_t(
+            const std::shared_ptr<semilattice_read_view_t<metadata_t> > &_view)
+        : view(_view),
+          snapshot(view->get()),
+          pump([this](UNUSED signal_t *interruptor) {
+              snapshot.publish(view->get());
+          }),
+          subscription([this]() { pump.notify(); }, view) { }
+
+    per_thread_snapshot_t<metadata_t> *get() {
+        return &snapshot;
+    }
+
+private:
+    std::shared_ptr<semilattice_read_view_t<metadata_t> > view;
+    per_thread_snapshot_t<metadata_t> snapshot;
+    pump_coro_t pump;
+    typename semilattice_read_view_t<metadata_t>::subscription_t subscription;
+
+    DISABLE_COPYING(semilattice_snapshot_t);
+};
+
+#endif  // RPC_SEMILATTICE_SNAPSHOT_HPP_
@@ -31,6 +31,10 @@ public:
         guarantee(ser_buffer_.has());
     }
 
+    // Gives the buffer back to the pool of buffers it came from (see
+    // serializer/ser_buffer_pool.hpp).
+    ~buf_ptr_t();
+
     buf_ptr_t &operator=(buf_ptr_t &&movee) {
         buf_ptr_t tmp(std::move(movee));
         std::swap(block_size_, tmp.block_size_);
@@ -38,10 +42,7 @@ public:
         return *this;
     }
 
-    void reset() {
-        block_size_ = block_size_t::undefined();
-        ser_buffer_.reset();
-    }
+    void reset();
 
     // Allocates a block, all of whose bytes are zeroed.
     static buf_ptr_t alloc_zeroed(block_size_t size);
@@ -1,8 +1,17 @@
 #include "serializer/checksum.hpp"
 
+#include <algorithm>
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <immintrin.h>
+#define CHECKSUM_HAS_X86_KERNELS 1
+#else
+#define CHECKSUM_HAS_X86_KERNELS 0
+#endif
+
 // The return value of this function or its behavior can't be changed -- the on-disk
 // format obviously requires a specific checksum algorithm.
-serializer_checksum compute_checksum(const void *word32s, size_t wordcount) {
+serializer_checksum compute_checksum_portable(const void *word32s, size_t wordcount) {
     const uint32_t *p = static_cast<const uint32_t *>(word32s);
 
     // This is the Fletcher-64 algorithm, applied to the input whose words are xored with
@@ -30,7 +39,7 @@ serializer_checksum compute_checksum(const void *word32s, size_t wordcount) {
     // We go through a minor shenanigan here to handle very large buffers.
     for (;;) {
         // 0xFFFFul is low enough that a and b can't overflow.
-        const size_t n = wordcount & 0xFFFFul;
+        const size_t n = std::min<size_t>(wordcount, 0xFFFFul);
 
         // At this point, a and b are <= 0x1_FFFF_FFFE and non-zero.
 
@@ -88,3 +97,154 @@ serializer_checksum compute_checksum_concat(serializer_checksum left,
 
     return serializer_checksum{(b << 32) | a};
 }
+
+#if CHECKSUM_HAS_X86_KERNELS
+
+namespace {
+
+const uint64_t fletcher_modulus = 0xFFFFFFFFull;
+
+// The vectorized kernels split the input into steps of `lanes` consecutive words.
+// Lane j keeps A_j, the sum of the j'th words of all steps so far, and B_j, the sum
+// of the A_j values after each step.  For a chunk of T steps (N = lanes * T words)
+// the scalar algorithm's running sums are then updated by
+//
+//   a' = a + sum_j A_j
+//   b' = b + N * a + lanes * sum_j B_j - sum_j j * A_j
+//
+// all modulo 2**32 - 1.  Chunks are short enough that no lane can overflow.
+const size_t max_steps_per_chunk = 0x4000;
+
+void fold_lanes(size_t lanes, const uint64_t *lane_a, const uint64_t *lane_b,
+                uint64_t chunk_words, uint64_t *a, uint64_t *b) {
+    uint64_t sum_a = 0;
+    uint64_t sum_b = 0;
+    uint64_t sum_ja = 0;
+    for (size_t j = 0; j < lanes; ++j) {
+        const uint64_t la = lane_a[j] % fletcher_modulus;
+        sum_a += la;
+        sum_b += lane_b[j] % fletcher_modulus;
+        sum_ja += j * la;
+    }
+    sum_a %= fletcher_modulus;
+    sum_b %= fletcher_modulus;
+    sum_ja %= fletcher_modulus;
+
+    // `*a` and `*b` are already reduced, so none of these products can overflow.
+    uint64_t new_b = *b + (chunk_words % fletcher_modulus) * *a % fletcher_modulus
+        + lanes * sum_b + (fletcher_modulus - sum_ja);
+    *b = new_b % fletcher_modulus;
+    *a = (*a + sum_a) % fletcher_modulus;
+}
+
+// Finishes the checksum of the words that the vectorized loop didn't consume, and
+// maps the canonical zero residue to 2**32 - 1 like the portable implementation.
+serializer_checksum finish_checksum(const uint32_t *p, size_t n, uint64_t a, uint64_t b) {
+    for (size_t i = 0; i < n; ++i) {
+        a += static_cast<uint64_t>(p[i] ^ 1u);
+        b += a;
+    }
+    a %= fletcher_modulus;
+    b %= fletcher_modulus;
+    if (a == 0) {
+        a = fletcher_modulus;
+    }
+    if (b == 0) {
+        b = fletcher_modulus;
+    }
+    return serializer_checksum{(b << 32) | a};
+}
+
+// Four words per step, one pair of 64-bit lanes per register.  SSE2 is part of the
+// x86-64 baseline, so this is always available.
+serializer_checksum compute_checksum_sse2(const void *word32s, size_t wordcount) {
+    const uint32_t *p = static_cast<const uint32_t *>(word32s);
+    const size_t lanes = 4;
+    const __m128i xorer = _mm_set1_epi32(1);
+    const __m128i zero = _mm_setzero_si128();
+
+    uint64_t a = 0;
+    uint64_t b = 0;
+    while (wordcount >= lanes) {
+        const size_t steps = std::min<size_t>(wordcount / lanes, max_steps_per_chunk);
+        __m128i a_lo = zero, a_hi = zero, b_lo = zero, b_hi = zero;
+        for (size_t t = 0; t < steps; ++t) {
+            __m128i v = _mm_xor_si128(
+                _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + t * lanes)), xorer);
+            a_lo = _mm_add_epi64(a_lo, _mm_unpacklo_epi32(v, zero));
+            a_hi = _mm_add_epi64(a_hi, _mm_unpackhi_epi32(v, zero));
+            b_lo = _mm_add_epi64(b_lo, a_lo);
+            b_hi = _mm_add_epi64(b_hi, a_hi);
+        }
+        uint64_t lane_a[4];
+        uint64_t lane_b[4];
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(lane_a), a_lo);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(lane_a + 2), a_hi);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(lane_b), b_lo);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(lane_b + 2), b_hi);
+        fold_lanes(lanes, lane_a, lane_b, steps * lanes, &a, &b);
+        p += steps * lanes;
+        wordcount -= steps * lanes;
+    }
+    return finish_checksum(p, wordcount, a, b);
+}
+
+// Eight words per step, four 64-bit lanes per register.
+__attribute__((target("avx2")))
+serializer_checksum compute_checksum_avx2(const void *word32s, size_t wordcount) {
+    const uint32_t *p = static_cast<const uint32_t *>(word32s);
+    const size_t lanes = 8;
+    const __m128i xorer = _mm_set1_epi32(1);
+
+    uint64_t a = 0;
+    uint64_t b = 0;
+    while (wordcount >= lanes) {
+        const size_t steps = std::min<size_t>(wordcount / lanes, max_steps_per_chunk);
+        __m256i a_lo = _mm256_setzero_si256(), a_hi = _mm256_setzero_si256();
+        __m256i b_lo = _mm256_setzero_si256(), b_hi = _mm256_setzero_si256();
+        for (size_t t = 0; t < steps; ++t) {
+            const __m128i *q = reinterpret_cast<const __m128i *>(p + t * lanes);
+            __m128i lo = _mm_xor_si128(_mm_loadu_si128(q), xorer);
+            __m128i hi = _mm_xor_si128(_mm_loadu_si128(q + 1), xorer);
+            a_lo = _mm256_add_epi64(a_lo, _mm256_cvtepu32_epi64(lo));
+            a_hi = _mm256_add_epi64(a_hi, _mm256_cvtepu32_epi64(hi));
+            b_lo = _mm256_add_epi64(b_lo, a_lo);
+            b_hi = _mm256_add_epi64(b_hi, a_hi);
+        }
+        uint64_t lane_a[8];
+        uint64_t lane_b[8];
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(lane_a), a_lo);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(lane_a + 4), a_hi);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(lane_b), b_lo);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(lane_b + 4), b_hi);
+        fold_lanes(lanes, lane_a, lane_b, steps * lanes, &a, &b);
+        p += steps * lanes;
+        wordcount -= steps * lanes;
+    }
+    return finish_checksum(p, wordcount, a, b);
+}
+
+typedef serializer_checksum (*checksum_fn_t)(const void *, size_t);
+
+checksum_fn_t choose_checksum_fn() {
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return &compute_checksum_avx2;
+    }
+    return &compute_checksum_sse2;
+}
+
+}  // namespace
+
+serializer_checksum compute_checksum(const void *word32s, size_t wordcount) {
+    static const checksum_fn_t fn = choose_checksum_fn();
+    return fn(word32s, wordcount);
+}
+
+#else  // CHECKSUM_HAS_X86_KERNELS
+
+serializer_checksum compute_checksum(const void *word32s, size_t wordcount) {
+    return compute_checksum_portable(word32s, wordcount);
+}
+
+#endif  // CHECKSUM_HAS_X86_KERNELS
@@ -20,8 +20,15 @@ ATTR_PACKED(struct serializer_checksum {
 // wordcount: the number of 32-bit words in the buffer.
 // return value: the checksum.
 // The checksum is never zero.
+// This dispatches (once, based on the running CPU) to a vectorized implementation
+// when one is available.
 serializer_checksum compute_checksum(const void *word32s, size_t wordcount);
 
+// The plain, word-at-a-time implementation of compute_checksum.  Every other
+// implementation must return exactly what this returns.  Used as a fallback on CPUs
+// without vector support and by the unit tests.
+serializer_checksum compute_checksum_portable(const void *word32s, size_t wordcount);
+
 // Combines checksums into the checksum of the concatenated buffer.  Given two buffers,
 // s, and t, serializer_checksum_concat(serializer_checksum(s), serializer_checksum(t),
 // t.wordcount) computes serializer_checksum(concat(s, t)).
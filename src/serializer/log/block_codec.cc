@@ -0,0 +1,132 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#include "serializer/log/block_codec.hpp"
+
+#include <string.h>
+#include <zlib.h>
+
+#include "config/args.hpp"
+#include "math.hpp"
+
+const char *block_codec_name(block_codec_t codec) {
+    switch (codec) {
+    case block_codec_t::none: return "none";
+    case block_codec_t::zlib: return "zlib";
+    default: unreachable();
+    }
+}
+
+namespace {
+
+const size_t compressed_prefix_size
+    = sizeof(ls_buf_data_t) + sizeof(compressed_block_header_t);
+
+// Fast compression levels are a better fit here than good ratios: blocks are small,
+// and every extra microsecond is spent on the flush path.
+const int zlib_compression_level = 1;
+
+bool zlib_compress(const char *in, size_t in_size, char *out, size_t out_capacity,
+                   size_t *out_size) {
+    uLongf dest_len = out_capacity;
+    int res = compress2(reinterpret_cast<Bytef *>(out), &dest_len,
+                        reinterpret_cast<const Bytef *>(in), in_size,
+                        zlib_compression_level);
+    if (res != Z_OK) {
+        // Most likely `Z_BUF_ERROR`, the block doesn't compress well enough to fit.
+        return false;
+    }
+    *out_size = dest_len;
+    return true;
+}
+
+}  // namespace
+
+buf_ptr_t compress_block(block_codec_t codec,
+                         const ser_buffer_t *in,
+                         block_size_t in_size) {
+    if (codec == block_codec_t::none) {
+        return buf_ptr_t();
+    }
+
+    const size_t aligned_in_size = buf_ptr_t::compute_aligned_block_size(in_size);
+    if (aligned_in_size <= DEVICE_BLOCK_SIZE
+        || aligned_in_size - DEVICE_BLOCK_SIZE <= compressed_prefix_size) {
+        return buf_ptr_t();
+    }
+
+    // The compressed image must shrink the block by at least one device block,
+    // or writing it compressed isn't worth the CPU time spent reading it back.
+    const size_t max_payload_size
+        = aligned_in_size - DEVICE_BLOCK_SIZE - compressed_prefix_size;
+    scoped_array_t<char> payload(max_payload_size);
+    size_t payload_size;
+    bool ok;
+    switch (codec) {
+    case block_codec_t::zlib:
+        ok = zlib_compress(in->cache_data, in_size.value(),
+                           payload.data(), payload.size(), &payload_size);
+        break;
+    case block_codec_t::none:
+    default:
+        unreachable();
+    }
+    if (!ok) {
+        return buf_ptr_t();
+    }
+
+    const block_size_t out_size
+        = block_size_t::unsafe_make(compressed_prefix_size + payload_size);
+    buf_ptr_t out = buf_ptr_t::alloc_uninitialized(out_size);
+    ser_buffer_t *out_buf = out.ser_buffer();
+    out_buf->ser_header = in->ser_header;
+
+    compressed_block_header_t header;
+    header.magic = COMPRESSED_BLOCK_MAGIC;
+    header.codec = static_cast<uint8_t>(codec);
+    header.reserved = 0;
+    header.uncompressed_ser_block_size = in_size.ser_value();
+    header.payload_size = payload_size;
+    memcpy(out_buf->cache_data, &header, sizeof(header));
+    memcpy(out_buf->cache_data + sizeof(header), payload.data(), payload_size);
+    out.fill_padding_zero();
+    return out;
+}
+
+buf_ptr_t decompress_block(const ser_buffer_t *in,
+                           block_size_t disk_size,
+                           block_size_t uncompressed_size) {
+    guarantee(disk_size.ser_value() >= compressed_prefix_size,
+              "Compressed block is too small to hold its header.");
+
+    compressed_block_header_t header;
+    memcpy(&header, in->cache_data, sizeof(header));
+    guarantee(header.magic == COMPRESSED_BLOCK_MAGIC,
+              "Bad magic in compressed block (block id %" PR_BLOCK_ID ").",
+              in->ser_header.block_id);
+    guarantee(header.uncompressed_ser_block_size == uncompressed_size.ser_value(),
+              "Compressed block size doesn't match the index (%" PRIu16 " vs %" PRIu16
+              ").", header.uncompressed_ser_block_size, uncompressed_size.ser_value());
+    guarantee(compressed_prefix_size + header.payload_size == disk_size.ser_value());
+
+    buf_ptr_t out = buf_ptr_t::alloc_uninitialized(uncompressed_size);
+    ser_buffer_t *out_buf = out.ser_buffer();
+    out_buf->ser_header = in->ser_header;
+
+    const char *payload = in->cache_data + sizeof(header);
+    switch (static_cast<block_codec_t>(header.codec)) {
+    case block_codec_t::zlib: {
+        uLongf dest_len = uncompressed_size.value();
+        int res = uncompress(reinterpret_cast<Bytef *>(out_buf->cache_data), &dest_len,
+                             reinterpret_cast<const Bytef *>(payload),
+                             header.payload_size);
+        guarantee(res == Z_OK && dest_len == uncompressed_size.value(),
+                  "Could not decompress block %" PR_BLOCK_ID " (zlib error %d).",
+                  in->ser_header.block_id, res);
+    } break;
+    case block_codec_t::none:
+    default:
+        crash("Unknown block codec %d in compressed block.", header.codec);
+    }
+
+    out.fill_padding_zero();
+    return out;
+}
@@ -0,0 +1,51 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#ifndef SERIALIZER_LOG_BLOCK_CODEC_HPP_
+#define SERIALIZER_LOG_BLOCK_CODEC_HPP_
+
+#include <stdint.h>
+
+#include "arch/compiler.hpp"
+#include "serializer/buf_ptr.hpp"
+#include "serializer/types.hpp"
+
+// The codec used to compress data blocks before they're written into extents.  The
+// numeric values are stored in the header of compressed blocks, so they define the
+// disk format.  Do not renumber.
+enum class block_codec_t : uint8_t {
+    none = 0,
+    zlib = 1,
+};
+
+const char *block_codec_name(block_codec_t codec);
+
+// Compressed blocks keep the usual `ls_buf_data_t` serializer header (so that the GC
+// and read-ahead code can still find the block id at the front of every block),
+// followed by this header and then the compressed cache data.  The uncompressed
+// size is also recorded in the LBA; it's stored here again so that a block can be
+// verified on its own.  This defines the disk format!
+ATTR_PACKED(struct compressed_block_header_t {
+    uint32_t magic;
+    uint8_t codec;
+    uint8_t reserved;
+    uint16_t uncompressed_ser_block_size;
+    uint32_t payload_size;
+});
+
+static const uint32_t COMPRESSED_BLOCK_MAGIC = 0x7a636272;  // "rbcz"
+
+// Tries to compress the block `in` of size `in_size` with `codec`.  Returns an
+// empty buf_ptr_t if compression wouldn't save at least one DEVICE_BLOCK_SIZE on
+// disk (or if `codec` is `none`), in which case the block should be written as is.
+// Otherwise the result holds the compressed on-disk image of the block.
+buf_ptr_t compress_block(block_codec_t codec,
+                         const ser_buffer_t *in,
+                         block_size_t in_size);
+
+// Turns the on-disk image of a compressed block back into the original block.
+// `uncompressed_size` is the size that was recorded in the LBA for the block.
+// Crashes if the block is corrupted.
+buf_ptr_t decompress_block(const ser_buffer_t *in,
+                           block_size_t disk_size,
+                           block_size_t uncompressed_size);
+
+#endif  // SERIALIZER_LOG_BLOCK_CODEC_HPP_
@@ -6,6 +6,7 @@
 
 #include "config/args.hpp"
 #include "containers/archive/archive.hpp"
+#include "serializer/log/block_codec.hpp"
 #include "serializer/types.hpp"
 #include "rpc/serialize_macros.hpp"
 
@@ -17,6 +18,7 @@ struct log_serializer_dynamic_config_t {
         // This is probably too low, thanks to status quo bias (the status quo having
         // been to never compute checksums).
         checksum_threshold = 65536;
+        block_codec = block_codec_t::none;
     }
 
     /* Enable reading more data than requested to let the cache warmup more quickly
@@ -26,6 +28,11 @@ struct log_serializer_dynamic_config_t {
        writing the serializer superblock.  Designed to make single-document writes
        fast. */
     uint32_t checksum_threshold;
+    /* The codec used to compress blocks when they get written.  This only affects
+       new writes: every compressed block records its codec, and blocks are
+       decompressed on read no matter what this is set to, so it can be changed from
+       run to run. */
+    block_codec_t block_codec;
 };
 
 /* This is equivalent to log_serializer_static_config_t below, but is an on-disk
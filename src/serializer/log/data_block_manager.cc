@@ -4,6 +4,7 @@
 #include <inttypes.h>
 #include <sys/uio.h>
 
+#include <algorithm>
 #include <functional>
 
 #include "arch/arch.hpp"
@@ -13,6 +14,7 @@
 #include "errors.hpp"
 #include "perfmon/perfmon.hpp"
 #include "serializer/buf_ptr.hpp"
+#include "serializer/log/block_codec.hpp"
 #include "serializer/log/log_serializer.hpp"
 #include "stl_utils.hpp"
 
@@ -51,6 +53,17 @@ const size_t GC_YOUNG_EXTENT_MAX_SIZE = 50;
 // What's the definition of a "young" extent in microseconds?
 const kiloticks_t GC_YOUNG_EXTENT_TIMELIMIT = { 50000 };
 
+// How many of the extents with the most garbage we consider when picking the next
+// extent to GC.  Among those, we pick the one with the best cost-benefit score.
+// Extents with little garbage are expensive to GC no matter how old their data is,
+// so there's no point in looking further down the priority queue.
+const size_t GC_COST_BENEFIT_CANDIDATES = 8;
+
+// How far (in repli timestamps) a block's recency has to lag behind the newest
+// recency we've seen for the block to count as cold.  Cold blocks are written to
+// their own extents, see `cold_active_extent`.
+const uint64_t COLD_BLOCK_RECENCY_DISTANCE = 1 << 16;
+
 
 // Identifies an extent, the time we started writing to the
 // extent, whether it's the extent we're currently writing to, and
@@ -67,15 +80,18 @@ private:
     };
 
 public:
-    /* This constructor is for starting a new active extent. */
-    explicit gc_entry_t(data_block_manager_t *_parent)
+    /* This constructor is for starting a new active extent in a freshly generated
+       extent. */
+    gc_entry_t(data_block_manager_t *_parent, extent_reference_t &&_extent_ref)
         : parent(_parent),
-          extent_ref(parent->extent_manager->gen_extent()),
+          extent_ref(std::move(_extent_ref)),
           timestamp(get_kiloticks()),
+          data_timestamp({0}),
           was_written(false),
           state(state_active),
           garbage_bytes_stat(_parent->static_config->extent_size()),
           num_live_blocks_stat(0),
+          garbage_histogram_bucket(-1),
           extent_offset(extent_ref.offset()) {
         static_assert(sizeof(block_info_t) == 4, "block_info_t not 4 bytes");
         add_self_to_parent_entries();
@@ -87,10 +103,12 @@ public:
         : parent(_parent),
           extent_ref(parent->extent_manager->reserve_extent(_offset)),
           timestamp(get_kiloticks()),
+          data_timestamp(timestamp),
           was_written(false),
           state(state_reconstructing),
           garbage_bytes_stat(_parent->static_config->extent_size()),
           num_live_blocks_stat(0),
+          garbage_histogram_bucket(-1),
           extent_offset(extent_ref.offset()) {
         add_self_to_parent_entries();
     }
@@ -101,6 +119,8 @@ public:
     }
 
     ~gc_entry_t() {
+        set_garbage_histogram_bucket(-1);
+
         uint64_t extent_id = parent->static_config->extent_index(extent_offset);
         guarantee(parent->entries.get(extent_id) == this);
         parent->entries.set(extent_id, nullptr);
@@ -312,6 +332,17 @@ public:
         block_infos.shrink_to_fit();
     }
 
+    // Must be called whenever `state` changes, so that the garbage histogram in the
+    // serializer stats keeps counting exactly the extents in `state_old`.  (Changes
+    // to the garbage bytes are taken care of by `update_stats()`.)
+    void update_garbage_histogram() {
+        set_garbage_histogram_bucket(
+            state == state_old
+            ? ::garbage_histogram_bucket(garbage_bytes_stat,
+                                         parent->static_config->extent_size())
+            : -1);
+    }
+
 private:
     // Private because we cannot guarantee that our stats remain consistent if somebody
     // gets a non-const iterator.
@@ -340,6 +371,20 @@ private:
             num_live_blocks_stat += 1;
             garbage_bytes_stat -= aligned_value(new_block->block_size);
         }
+        update_garbage_histogram();
+    }
+
+    void set_garbage_histogram_bucket(int bucket) {
+        if (bucket != garbage_histogram_bucket) {
+            if (garbage_histogram_bucket != -1) {
+                --parent->stats->pm_serializer_old_extents_by_garbage[
+                    garbage_histogram_bucket];
+            }
+            if (bucket != -1) {
+                ++parent->stats->pm_serializer_old_extents_by_garbage[bucket];
+            }
+            garbage_histogram_bucket = bucket;
+        }
     }
 
     // Used by constructors.
@@ -360,6 +405,10 @@ public:
     // When we started writing to the extent (this time).
     const kiloticks_t timestamp;
 
+    // When the youngest data in the extent was originally written.  This is older
+    // than `timestamp` for extents that the GC moved blocks into.
+    kiloticks_t data_timestamp;
+
     // The PQ entry pointing to us.
     priority_queue_t<gc_entry_t *, gc_entry_less_t>::entry_t *our_pq_entry;
 
@@ -388,6 +437,9 @@ private:
     uint32_t garbage_bytes_stat;
     unsigned int num_live_blocks_stat;
 
+    // The bucket of the garbage histogram that we're counted in, or -1.
+    int garbage_histogram_bucket;
+
     // Only to be used by the destructor, used to look up the gc entry in the
     // parent's entries array.
     const int64_t extent_offset;
@@ -402,6 +454,7 @@ data_block_manager_t::data_block_manager_t(
     : stats(_stats), shutdown_callback(nullptr), state(state_unstarted),
       gc_enabled(true), static_config(_static_config), extent_manager(em),
       serializer(_serializer),
+      newest_recency(repli_timestamp_t::distant_past),
       gc_index_write_pumper(std::bind(
           &data_block_manager_t::flush_gc_index_writes, this, std::placeholders::_1)),
       /* The capacity of the gc_index_write_semaphore will be scaled
@@ -453,8 +506,10 @@ void data_block_manager_t::start_existing(
         const dbm_metablock_mixin_t *last_metablock) {
     guarantee(state == state_unstarted);
     dbfile = file;
-    gc_io_account_nice.init(new file_account_t(file, GC_IO_PRIORITY_NICE));
-    gc_io_account_high.init(new file_account_t(file, GC_IO_PRIORITY_HIGH));
+    gc_io_account_nice.init(
+        new file_account_t(file, GC_IO_PRIORITY_NICE, io_caller_t::gc));
+    gc_io_account_high.init(
+        new file_account_t(file, GC_IO_PRIORITY_HIGH, io_caller_t::gc));
 
     /* Reconstruct the active data block extents from the metablock. */
     const int64_t offset = last_metablock->active_extent;
@@ -479,6 +534,10 @@ void data_block_manager_t::start_existing(
     } else {
         active_extent = nullptr;
     }
+    // We don't keep cold blocks apart from other blocks across restarts: whatever
+    // cold extents we were writing to have been turned into old extents below.
+    cold_active_extent = nullptr;
+    gc_active_extents.assign(extent_manager->device_count(), nullptr);
 
     /* Convert any extents that we found live blocks in, but that are not active
     extents, into old extents */
@@ -487,6 +546,7 @@ void data_block_manager_t::start_existing(
 
         guarantee(entry->state == gc_entry_t::state_reconstructing);
         entry->state = gc_entry_t::state_old;
+        entry->update_garbage_histogram();
         entry->shrink_to_fit();
 
         entry->our_pq_entry = gc_pq.push(entry);
@@ -663,16 +723,24 @@ public:
                     continue;
                 }
 
-                const block_size_t block_size
+                const block_size_t disk_block_size
                     = block_size_t::unsafe_make(info.ser_block_size);
-                buf_ptr_t buf = buf_ptr_t::alloc_uninitialized(block_size);
-                memcpy(buf.ser_buffer(), current_buf, info.ser_block_size);
-                buf.fill_padding_zero();
                 guarantee(info.ser_block_size <= *(lower_it + 1) - *lower_it);
+                buf_ptr_t buf;
+                if (info.uncompressed_ser_block_size != 0) {
+                    buf = decompress_block(
+                        reinterpret_cast<const ser_buffer_t *>(current_buf),
+                        disk_block_size, info.logical_block_size());
+                } else {
+                    buf = buf_ptr_t::alloc_uninitialized(disk_block_size);
+                    memcpy(buf.ser_buffer(), current_buf, info.ser_block_size);
+                    buf.fill_padding_zero();
+                }
 
                 counted_t<block_token_t> token
                     = parent->serializer->generate_block_token(current_offset,
-                                                               block_size);
+                                                               info.logical_block_size(),
+                                                               disk_block_size);
 
                 parent->serializer->offer_buf_to_read_ahead_callbacks(
                         block_id,
@@ -736,17 +804,101 @@ buf_ptr_t data_block_manager_t::read(int64_t off_in, block_size_t block_size,
     }
 }
 
-// Sets maybe_checksum_out if one was computed, or sets it to zero otherwise.
 std::vector<counted_t<block_token_t>>
 data_block_manager_t::many_writes(const buf_write_info_t *writes,
                                   size_t writes_count,
                                   file_account_t *io_account,
                                   iocallback_t *cb) {
+    for (size_t i = 0; i < writes_count; ++i) {
+        newest_recency = superceding_recency(newest_recency, writes[i].recency);
+    }
+    std::vector<bool> is_cold(writes_count);
+    for (size_t i = 0; i < writes_count; ++i) {
+        is_cold[i] = is_cold_recency(writes[i].recency, newest_recency);
+    }
+    return many_writes_by_temperature(is_cold, -1, &cold_active_extent,
+                                      extent_manager->pick_cold_device(),
+                                      get_kiloticks(),
+                                      writes, writes_count, io_account, cb);
+}
+
+std::vector<counted_t<block_token_t>>
+data_block_manager_t::many_writes_by_temperature(const std::vector<bool> &is_cold,
+                                                 int hot_device,
+                                                 gc_entry_t **cold_extent,
+                                                 int cold_device,
+                                                 kiloticks_t data_timestamp,
+                                                 const buf_write_info_t *writes,
+                                                 size_t writes_count,
+                                                 file_account_t *io_account,
+                                                 iocallback_t *cb) {
+    rassert(is_cold.size() == writes_count);
+    std::vector<buf_write_info_t> hot_writes;
+    std::vector<buf_write_info_t> cold_writes;
+    for (size_t i = 0; i < writes_count; ++i) {
+        (is_cold[i] ? cold_writes : hot_writes).push_back(writes[i]);
+    }
+    stats->pm_serializer_cold_blocks_written += cold_writes.size();
+
+    if (cold_writes.empty()) {
+        return many_writes_into(&active_extent, hot_device, data_timestamp,
+                                writes, writes_count, io_account, cb);
+    } else if (hot_writes.empty()) {
+        return many_writes_into(cold_extent, cold_device, data_timestamp,
+                                writes, writes_count, io_account, cb);
+    }
+
+    struct both_writes_cb_t : public iocallback_t {
+        void on_io_complete() {
+            --ops_remaining;
+            if (ops_remaining == 0) {
+                iocallback_t *local_cb = cb;
+                delete this;
+                local_cb->on_io_complete();
+            }
+        }
+        int ops_remaining;
+        iocallback_t *cb;
+    };
+    both_writes_cb_t *both_cb = new both_writes_cb_t;
+    both_cb->ops_remaining = 2;
+    both_cb->cb = cb;
+
+    std::vector<counted_t<block_token_t>> hot_tokens
+        = many_writes_into(&active_extent, hot_device, data_timestamp,
+                           hot_writes.data(), hot_writes.size(), io_account, both_cb);
+    std::vector<counted_t<block_token_t>> cold_tokens
+        = many_writes_into(cold_extent, cold_device, data_timestamp,
+                           cold_writes.data(), cold_writes.size(), io_account, both_cb);
+
+    // Put the tokens back into the order of `writes`.
+    std::vector<counted_t<block_token_t>> result;
+    result.reserve(writes_count);
+    size_t hot_pos = 0;
+    size_t cold_pos = 0;
+    for (size_t i = 0; i < writes_count; ++i) {
+        result.push_back(std::move(is_cold[i]
+                                   ? cold_tokens[cold_pos++]
+                                   : hot_tokens[hot_pos++]));
+    }
+    return result;
+}
+
+// Sets maybe_checksum_out if one was computed, or sets it to zero otherwise.
+std::vector<counted_t<block_token_t>>
+data_block_manager_t::many_writes_into(gc_entry_t **target_extent,
+                                       int device,
+                                       kiloticks_t data_timestamp,
+                                       const buf_write_info_t *writes,
+                                       size_t writes_count,
+                                       file_account_t *io_account,
+                                       iocallback_t *cb) {
     // These tokens are grouped by extent.  You can do a contiguous write in each
     // extent.
     uint64_t cumulative_aligned_size;
     std::vector<std::vector<counted_t<block_token_t>>> token_groups
-        = gimme_some_new_offsets(writes, writes_count, &cumulative_aligned_size);
+        = gimme_some_new_offsets(target_extent, device, data_timestamp,
+                                 writes, writes_count, &cumulative_aligned_size);
     const bool wants_checksum
         = cumulative_aligned_size <= serializer->dynamic_config.checksum_threshold;
 
@@ -778,7 +930,7 @@ data_block_manager_t::many_writes(const buf_write_info_t *writes,
     for (const std::vector<counted_t<block_token_t>> &group : token_groups) {
         const int64_t front_offset = group.front()->offset();
         const int64_t back_offset = group.back()->offset()
-            + gc_entry_t::aligned_value(group.back()->block_size());
+            + gc_entry_t::aligned_value(group.back()->disk_block_size_);
 
         guarantee(divides(DEVICE_BLOCK_SIZE, front_offset));
 
@@ -792,7 +944,7 @@ data_block_manager_t::many_writes(const buf_write_info_t *writes,
         for (size_t j = 0, je = group.size(); j < je; ++j) {
             block_token_t *token = group[j].get();
             const int64_t j_offset = token->offset();
-            const block_size_t j_block_size = token->block_size();
+            const block_size_t j_block_size = token->disk_block_size_;
             guarantee(j_offset == last_written_offset);
             const size_t j_aligned_size = gc_entry_t::aligned_value(j_block_size);
             total_aligned_size += j_aligned_size;
@@ -1089,11 +1241,11 @@ void data_block_manager_t::gc_one_extent(gc_state_t *gc_state) {
         /* grab the entry */
         guarantee (!gc_pq.empty());
         guarantee(gc_state->current_entry == nullptr);
-        gc_state->current_entry = gc_pq.pop();
-        gc_state->current_entry->our_pq_entry = nullptr;
+        gc_state->current_entry = pick_gc_victim();
 
         guarantee(gc_state->current_entry->state == gc_entry_t::state_old);
         gc_state->current_entry->state = gc_entry_t::state_in_gc;
+        gc_state->current_entry->update_garbage_histogram();
         gc_stats.old_garbage_block_bytes -= gc_state->current_entry->garbage_bytes();
         gc_stats.old_total_block_bytes -= static_config->extent_size();
 
@@ -1261,19 +1413,48 @@ void data_block_manager_t::write_gcs(
 
         std::vector<buf_write_info_t> the_writes;
         the_writes.reserve(writes.size());
+        std::vector<bool> is_cold;
+        is_cold.reserve(writes.size());
         for (size_t i = 0; i < writes.size(); ++i) {
             old_block_tokens.push_back(
                     serializer->generate_block_token(writes[i].old_offset,
+                                                     writes[i].block_size,
                                                      writes[i].block_size));
 
+            const block_id_t block_id = writes[i].buf->ser_header.block_id;
+            const repli_timestamp_t recency
+                = serializer->lba_index->get_block_recency(block_id);
+            newest_recency = superceding_recency(newest_recency, recency);
             the_writes.push_back(buf_write_info_t(writes[i].buf,
                                                   writes[i].block_size,
-                                                  writes[i].buf->ser_header.block_id));
+                                                  block_id,
+                                                  recency));
+        }
+        for (size_t i = 0; i < the_writes.size(); ++i) {
+            is_cold.push_back(is_cold_recency(the_writes[i].recency, newest_recency));
         }
 
-        new_block_tokens = many_writes(the_writes.data(), the_writes.size(),
-                                       choose_gc_io_account(),
-                                       &block_write_cond);
+        // The blocks keep the age of the extent they came from.  Cold blocks stay on
+        // its device so that the copy doesn't have to cross devices, unless the
+        // extent is on the hot tier and there's a cold tier to move them to.  Blocks
+        // that were written recently go back to the hot extent, where they'll likely
+        // become garbage soon.
+        int device = extent_manager->device_of_extent(
+            gc_state->current_entry->extent_ref.offset());
+        if (!extent_manager->device_is_cold(device)) {
+            const int cold_device = extent_manager->pick_cold_device();
+            if (cold_device != -1) {
+                device = cold_device;
+                stats->pm_serializer_blocks_moved_to_cold_tier
+                    += std::count(is_cold.begin(), is_cold.end(), true);
+            }
+        }
+        new_block_tokens = many_writes_by_temperature(
+            is_cold, -1, &gc_active_extents[device], device,
+            gc_state->current_entry->data_timestamp,
+            the_writes.data(), the_writes.size(),
+            choose_gc_io_account(),
+            &block_write_cond);
 
         guarantee(new_block_tokens.size() == writes.size());
     }
@@ -1337,6 +1518,15 @@ void data_block_manager_t::flush_gc_index_writes(signal_t *) {
                 if (iw.gc_state->current_entry->block_referenced_by_index(block_index)) {
                     block_id_t block_id = write.buf->ser_header.block_id;
 
+                    // The GC moves the on-disk image of the block as is.  If that's a
+                    // compressed image, the new token has to carry the uncompressed
+                    // size the index recorded for the block.
+                    const index_block_info_t info
+                        = serializer->lba_index->get_block_info(block_id);
+                    guarantee(info.offset.has_value()
+                              && info.offset.get_value() == write.old_offset);
+                    iw.new_block_tokens[i]->block_size_ = info.logical_block_size();
+
                     index_write_ops.push_back(
                         index_write_op_t(block_id,
                             make_optional(iw.new_block_tokens[i])));
@@ -1425,6 +1615,20 @@ void data_block_manager_t::actually_shutdown() {
         active_extent = nullptr;
     }
 
+    if (cold_active_extent != nullptr) {
+        UNUSED int64_t extent = cold_active_extent->extent_ref.release();
+        delete cold_active_extent;
+        cold_active_extent = nullptr;
+    }
+
+    for (gc_entry_t *&gc_active_extent : gc_active_extents) {
+        if (gc_active_extent != nullptr) {
+            UNUSED int64_t extent = gc_active_extent->extent_ref.release();
+            delete gc_active_extent;
+            gc_active_extent = nullptr;
+        }
+    }
+
     while (gc_entry_t *entry = young_extent_queue.head()) {
         young_extent_queue.remove(entry);
         UNUSED int64_t extent = entry->extent_ref.release();
@@ -1445,19 +1649,28 @@ void data_block_manager_t::actually_shutdown() {
 // Outputs how many bytes would get written, so we can use that info to decide later
 // whether to checksum the blocks (which'll let us save an fdatasync)
 std::vector<std::vector<counted_t<block_token_t>>>
-data_block_manager_t::gimme_some_new_offsets(const buf_write_info_t *writes,
+data_block_manager_t::gimme_some_new_offsets(gc_entry_t **target_extent,
+                                             int device,
+                                             kiloticks_t data_timestamp,
+                                             const buf_write_info_t *writes,
                                              size_t writes_count,
                                              uint64_t *cumulative_aligned_size_out) {
     ASSERT_NO_CORO_WAITING;
 
+    // `active_extent`, `cold_active_extent` or one of `gc_active_extents`.
+    gc_entry_t *&extent = *target_extent;
+    auto new_extent = [&]() {
+        return new gc_entry_t(this, extent_manager->gen_extent_on_device(device));
+    };
+
     // Start a new extent if necessary.
-    if (active_extent == nullptr) {
-        active_extent = new gc_entry_t(this);
+    if (extent == nullptr) {
+        extent = new_extent();
         ++stats->pm_serializer_data_extents_allocated;
     }
 
 
-    guarantee(active_extent->state == gc_entry_t::state_active);
+    guarantee(extent->state == gc_entry_t::state_active);
 
     std::vector<std::vector<counted_t<block_token_t>>> ret;
     uint64_t cumulative_aligned_size = 0;
@@ -1468,26 +1681,25 @@ data_block_manager_t::gimme_some_new_offsets(const buf_write_info_t *writes,
         uint32_t relative_offset = valgrind_undefined<uint32_t>(UINT32_MAX);
         unsigned int block_index = valgrind_undefined<unsigned int>(UINT_MAX);
         cumulative_aligned_size += gc_entry_t::aligned_value(block_size);
-        if (!active_extent->new_offset(block_size,
-                                       &relative_offset, &block_index)) {
-            // Move the active_extent gc_entry_t to the young extent queue (if it's
-            // not already empty), and make a new gc_entry_t.
-            if (active_extent->num_live_blocks() == 0) {
-                gc_entry_t *old_active_extent = active_extent;
-                active_extent = new gc_entry_t(this);
-                destroy_entry(old_active_extent);
+        if (!extent->new_offset(block_size, &relative_offset, &block_index)) {
+            // Move the full extent's gc_entry_t to the young extent queue (if
+            // it's not already empty), and make a new gc_entry_t.
+            if (extent->num_live_blocks() == 0) {
+                gc_entry_t *old_extent = extent;
+                extent = new_extent();
+                destroy_entry(old_extent);
             } else {
-                active_extent->state = gc_entry_t::state_young;
-                active_extent->shrink_to_fit();
-                young_extent_queue.push_back(active_extent);
+                extent->state = gc_entry_t::state_young;
+                extent->shrink_to_fit();
+                young_extent_queue.push_back(extent);
                 mark_unyoung_entries();
-                active_extent = new gc_entry_t(this);
+                extent = new_extent();
             }
 
             ++stats->pm_serializer_data_extents_allocated;
-            const bool succeeded = active_extent->new_offset(block_size,
-                                                             &relative_offset,
-                                                             &block_index);
+            const bool succeeded = extent->new_offset(block_size,
+                                                      &relative_offset,
+                                                      &block_index);
             guarantee(succeeded);
 
             // Push the current group of tokens, if it's nonempty, onto the return
@@ -1498,11 +1710,14 @@ data_block_manager_t::gimme_some_new_offsets(const buf_write_info_t *writes,
             }
         }
 
-        const int64_t offset = active_extent->extent_ref.offset() + relative_offset;
-        active_extent->was_written = true;
-        active_extent->mark_live_tokenwise(block_index);
+        const int64_t offset = extent->extent_ref.offset() + relative_offset;
+        extent->was_written = true;
+        extent->data_timestamp.micros
+            = std::max(extent->data_timestamp.micros, data_timestamp.micros);
+        extent->mark_live_tokenwise(block_index);
 
-        tokens.push_back(serializer->generate_block_token(offset, block_size));
+        tokens.push_back(serializer->generate_block_token(offset, block_size,
+                                                          block_size));
     }
 
     if (!tokens.empty()) {
@@ -1542,6 +1757,7 @@ void data_block_manager_t::remove_last_unyoung_entry() {
 
     guarantee(entry->state == gc_entry_t::state_young);
     entry->state = gc_entry_t::state_old;
+    entry->update_garbage_histogram();
 
     entry->our_pq_entry = gc_pq.push(entry);
 
@@ -1574,6 +1790,62 @@ bool gc_entry_less_t::operator()(const gc_entry_t *x, const gc_entry_t *y) {
     return x->garbage_bytes() < y->garbage_bytes();
 }
 
+// `gc_pq` is ordered by garbage bytes alone, because the ages of the extents keep
+// changing and so a priority queue can't be ordered by cost-benefit scores.
+// Instead we look at the first few extents of the queue, which are the cheapest
+// ones to GC, and pick the one with the best cost-benefit score among them.  That
+// way we avoid GCing an extent with lots of freshly written data that is about to
+// become garbage anyway, when there's an older extent that is almost as empty.
+gc_entry_t *data_block_manager_t::pick_gc_victim() {
+    ASSERT_NO_CORO_WAITING;
+    guarantee(!gc_pq.empty());
+
+    std::vector<gc_entry_t *> candidates;
+    while (!gc_pq.empty() && candidates.size() < GC_COST_BENEFIT_CANDIDATES) {
+        candidates.push_back(gc_pq.pop());
+    }
+
+    const kiloticks_t now = get_kiloticks();
+    size_t best = 0;
+    double best_score = -1.0;
+    for (size_t i = 0; i < candidates.size(); ++i) {
+        const double score = gc_cost_benefit(
+            candidates[i]->garbage_bytes(), static_config->extent_size(),
+            now.micros - candidates[i]->data_timestamp.micros);
+        if (score > best_score) {
+            best = i;
+            best_score = score;
+        }
+    }
+
+    for (size_t i = 0; i < candidates.size(); ++i) {
+        if (i == best) {
+            candidates[i]->our_pq_entry = nullptr;
+        } else {
+            candidates[i]->our_pq_entry = gc_pq.push(candidates[i]);
+        }
+    }
+    return candidates[best];
+}
+
+double gc_cost_benefit(int64_t garbage_bytes, int64_t extent_size, int64_t age_micros) {
+    rassert(extent_size > 0);
+    const double live_fraction
+        = 1.0 - static_cast<double>(garbage_bytes) / static_cast<double>(extent_size);
+    // We read the whole extent (cost 1) and write back its live part.  Add one to
+    // the age so that a difference in garbage still counts between extents of the
+    // same (zero) age.
+    const double age = static_cast<double>(std::max<int64_t>(age_micros, 0) + 1);
+    return (1.0 - live_fraction) * age / (1.0 + live_fraction);
+}
+
+int garbage_histogram_bucket(int64_t garbage_bytes, int64_t extent_size) {
+    rassert(extent_size > 0);
+    const int buckets = log_serializer_stats_t::garbage_histogram_buckets;
+    const int64_t bucket = garbage_bytes * buckets / extent_size;
+    return clamp<int64_t>(bucket, 0, buckets - 1);
+}
+
 /****************
  *Stat functions*
  ****************/
@@ -1601,3 +1873,11 @@ void data_block_manager_t::gc_stat_t::operator-=(int64_t num) {
 data_block_manager_t::gc_stats_t::gc_stats_t(log_serializer_stats_t *_stats)
     : old_total_block_bytes(&_stats->pm_serializer_old_total_block_bytes),
       old_garbage_block_bytes(&_stats->pm_serializer_old_garbage_block_bytes) { }
+
+bool is_cold_recency(repli_timestamp_t recency, repli_timestamp_t newest_recency) {
+    // Blocks that don't have a recency (like aux blocks) count as hot, so that we
+    // don't push anything into cold extents that we don't know to be cold.
+    return recency != repli_timestamp_t::invalid
+        && newest_recency != repli_timestamp_t::invalid
+        && recency.longtime + COLD_BLOCK_RECENCY_DISTANCE < newest_recency.longtime;
+}
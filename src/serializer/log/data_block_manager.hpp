@@ -17,6 +17,7 @@
 #include "serializer/log/config.hpp"
 #include "serializer/log/extent_manager.hpp"
 #include "serializer/types.hpp"
+#include "time.hpp"
 
 class buf_ptr_t;
 class log_serializer_t;
@@ -92,15 +93,46 @@ public:
                 file_account_t *io_account,
                 iocallback_t *cb);
 
-    std::vector<std::vector<counted_t<block_token_t> > >
-    gimme_some_new_offsets(const buf_write_info_t *writes, size_t writes_count,
-                           uint64_t *cumulative_aligned_size_out);
-
     bool is_gc_active() const;
 
 private:
     void actually_shutdown();
 
+    // Writes the blocks into `*target_extent`, which is `active_extent`,
+    // `cold_active_extent` or one of `gc_active_extents`.  New extents are taken
+    // from `device`, or from whichever device the extent manager likes best if
+    // it's -1.  `data_timestamp` is when the data in the blocks was originally
+    // written.
+    std::vector<counted_t<block_token_t> >
+    many_writes_into(gc_entry_t **target_extent,
+                     int device,
+                     kiloticks_t data_timestamp,
+                     const buf_write_info_t *writes,
+                     size_t writes_count,
+                     file_account_t *io_account,
+                     iocallback_t *cb);
+
+    // Writes the blocks for which `is_cold` is false into `active_extent`, taking new
+    // extents from `hot_device`, and the others into `*cold_extent`, taking new
+    // extents from `cold_device`.  Returns the tokens in the order of `writes`.
+    std::vector<counted_t<block_token_t> >
+    many_writes_by_temperature(const std::vector<bool> &is_cold,
+                               int hot_device,
+                               gc_entry_t **cold_extent,
+                               int cold_device,
+                               kiloticks_t data_timestamp,
+                               const buf_write_info_t *writes,
+                               size_t writes_count,
+                               file_account_t *io_account,
+                               iocallback_t *cb);
+
+    std::vector<std::vector<counted_t<block_token_t> > >
+    gimme_some_new_offsets(gc_entry_t **target_extent,
+                           int device,
+                           kiloticks_t data_timestamp,
+                           const buf_write_info_t *writes, size_t writes_count,
+                           uint64_t *cumulative_aligned_size_out);
+
     struct gc_state_t : public intrusive_list_node_t<gc_state_t>{
     public:
         // The entry we're currently GCing.
@@ -129,6 +161,9 @@ private:
 
     void gc_one_extent(gc_state_t *gc_state);
 
+    // Takes the extent that we should GC next out of `gc_pq`.
+    gc_entry_t *pick_gc_victim();
+
     void write_gcs(
         std::vector<gc_write_t> &&writes,
         gc_state_t *gc_state,
@@ -198,8 +233,22 @@ private:
     /* Contains every extent in the gc_entry_t::state_reconstructing state */
     intrusive_list_t<gc_entry_t> reconstructed_extents;
 
-    /* Contains the extent in the gc_entry_t::state_active state. */
+    /* Contains the extents in the gc_entry_t::state_active state.  Blocks are hot or
+    cold, depending on how far their recency lags behind `newest_recency` (see
+    `is_cold_recency()`).  Hot blocks go to `active_extent`.  Cold blocks that the GC
+    moves go to `gc_active_extents`, other cold blocks (typically from a backfill)
+    go to `cold_active_extent`.  Keeping cold blocks apart gives us extents that
+    stay mostly live, and extents that become mostly garbage quickly, instead of
+    extents that are somewhere in between.  Only `active_extent` is recorded in the
+    metablock.  There's one GC extent per device of the file, because the GC copies
+    blocks within the device they're on, except that it moves cold blocks off the hot
+    tier if the file has a cold tier. */
     gc_entry_t *active_extent;
+    gc_entry_t *cold_active_extent;
+    std::vector<gc_entry_t *> gc_active_extents;
+
+    /* The newest recency of any block we've written or GCed. */
+    repli_timestamp_t newest_recency;
 
     /* Contains every extent in the gc_entry_t::state_young state */
     intrusive_list_t<gc_entry_t> young_extent_queue;
@@ -283,4 +332,18 @@ void unaligned_read_ahead_interval(const int64_t block_offset,
                                    int64_t *const offset_out,
                                    int64_t *const end_offset_out);
 
+// Exposed for unit tests.  The cost-benefit score that the GC uses to pick extents
+// (higher means more worth GCing), as in LFS: the space we get back, weighed by how
+// long the data has stayed live, relative to the cost of reading the extent and
+// writing its live data back.
+double gc_cost_benefit(int64_t garbage_bytes, int64_t extent_size, int64_t age_micros);
+
+// Exposed for unit tests.  Which bucket of the serializer's old extent garbage
+// histogram an extent with `garbage_bytes` of garbage falls into.
+int garbage_histogram_bucket(int64_t garbage_bytes, int64_t extent_size);
+
+// Exposed for unit tests.  Whether a block with the given recency belongs in a cold
+// extent, given the newest recency that the serializer has seen.
+bool is_cold_recency(repli_timestamp_t recency, repli_timestamp_t newest_recency);
+
 #endif /* SERIALIZER_LOG_DATA_BLOCK_MANAGER_HPP_ */
@@ -60,9 +60,21 @@ class extent_zone_t {
 
     // We want to remove the minimum element from the free_queue first, leaving
     // free extents at the end of the file.
-    std::priority_queue<size_t,
-                        std::vector<size_t>,
-                        std::greater<size_t> > free_queue;
+    typedef std::priority_queue<size_t,
+                                std::vector<size_t>,
+                                std::greater<size_t> > free_queue_t;
+
+    // The free extents and usage of one of the devices the file is spread over.  An
+    // ordinary file has just one.
+    struct device_t {
+        device_t() : held_extents(0), extents_in_use(0) { }
+        free_queue_t free_queue;
+        // The number of entries in free_queue that don't point past the end of the
+        // file.
+        size_t held_extents;
+        size_t extents_in_use;
+    };
+    std::vector<device_t> devices;
 
     file_t *const dbfile;
 
@@ -71,14 +83,85 @@ class extent_zone_t {
     // The number of free extents in the file.
     size_t held_extents_;
 
+    int device_for_id(size_t id) const {
+        return dbfile->device_for_offset(id * extent_size);
+    }
+
+    perfmon_counter_t *tier_extents_in_use(size_t id) {
+        return dbfile->device_is_cold(device_for_id(id))
+            ? &stats->pm_cold_tier_extents_in_use
+            : &stats->pm_hot_tier_extents_in_use;
+    }
+
+    void set_in_use(size_t id) {
+        extents[id].set_state(extent_info_t::state_in_use);
+        ++devices[device_for_id(id)].extents_in_use;
+        ++*tier_extents_in_use(id);
+    }
+
+    void push_free(size_t id) {
+        extents[id].set_state(extent_info_t::state_free);
+        device_t *device = &devices[device_for_id(id)];
+        device->free_queue.push(id);
+        ++device->held_extents;
+        ++held_extents_;
+    }
+
+    // Drops the free queue entries that point past the end of the file.
+    void drop_stale_free_extents(device_t *device) {
+        if (device->free_queue.size() == device->held_extents) {
+            return;
+        }
+        free_queue_t tmp;
+        for (size_t i = 0; i < device->held_extents; ++i) {
+            tmp.push(device->free_queue.top());
+            device->free_queue.pop();
+        }
+
+        // held_extents was and will be the number of entries in the free_queue that
+        // _didn't_ point off the end of the file.  We just moved those entries to
+        // tmp.  The remaining entries must therefore point off the end of the file.
+        // Check that no remaining entries point within the file.
+        guarantee(device->free_queue.top() >= extents.size(),
+                  "Tried to discard valid held extents.");
+        device->free_queue = std::move(tmp);
+    }
+
 public:
+    // Picks a device of the given tier for a new extent: the one with the fewest
+    // requests in flight, and among those the one with the fewest extents in use.
+    // Returns -1 if the file has no device on that tier.
+    int pick_device(bool cold) const {
+        int best = -1;
+        int64_t best_outstanding = 0;
+        for (size_t i = 0; i < devices.size(); ++i) {
+            if (dbfile->device_is_cold(i) != cold) {
+                continue;
+            }
+            const int64_t outstanding = dbfile->device_outstanding_requests(i);
+            if (best == -1
+                || outstanding < best_outstanding
+                || (outstanding == best_outstanding
+                    && devices[i].extents_in_use < devices[best].extents_in_use)) {
+                best = i;
+                best_outstanding = outstanding;
+            }
+        }
+        return best;
+    }
+
     size_t held_extents() const {
         return held_extents_;
     }
 
     extent_zone_t(file_t *_dbfile, uint64_t _extent_size,
                   log_serializer_stats_t *_stats)
-        : extent_size(_extent_size), dbfile(_dbfile), stats(_stats), held_extents_(0) {
+        : extent_size(_extent_size), devices(_dbfile->device_count()),
+          dbfile(_dbfile), stats(_stats), held_extents_(0) {
+        // Extents must not span devices.
+        guarantee(dbfile->device_for_offset(0)
+                  == dbfile->device_for_offset(extent_size - 1),
+                  "The extent size is larger than the stripe size.");
         // (Avoid a bunch of reallocations by resize calls (avoiding O(n log n)
         // work on average).)
         extents.reserve(dbfile->get_file_size() / extent_size);
@@ -98,43 +181,56 @@ public:
                 extents[id].state() == extent_info_t::state_in_use ? "in_use"
                   : extents[id].state() == extent_info_t::state_free ? "free"
                   : "unknown");
-        extents[id].set_state(extent_info_t::state_in_use);
+        set_in_use(id);
         return make_extent_reference(extent);
     }
 
     void reconstruct_free_list() {
         for (size_t extent_id = 0; extent_id < extents.size(); ++extent_id) {
             if (extents[extent_id].state() == extent_info_t::state_unreserved) {
-                extents[extent_id].set_state(extent_info_t::state_free);
-                free_queue.push(extent_id);
-                ++held_extents_;
+                push_free(extent_id);
             }
         }
     }
 
-    extent_reference_t gen_extent() {
-        int64_t extent;
-
-        if (free_queue.empty()) {
-            rassert(held_extents_ == 0);
-            extent = extents.size() * extent_size;
-            extents.push_back(extent_info_t());
-        } else if (free_queue.top() >= extents.size()) {
-            rassert(held_extents_ == 0);
-            std::priority_queue<size_t,
-                                std::vector<size_t>,
-                                std::greater<size_t> > tmp;
-            free_queue = tmp;
-            extent = extents.size() * extent_size;
-            extents.push_back(extent_info_t());
+    // `device` is -1 if the extent may go to any device of the hot tier (or of the
+    // cold tier, if that's all there is).
+    extent_reference_t gen_extent(int device) {
+        if (device == -1) {
+            device = pick_device(false);
+        }
+        if (device == -1) {
+            device = pick_device(true);
+        }
+        guarantee(device >= 0 && static_cast<size_t>(device) < devices.size());
+        device_t *dev = &devices[device];
+
+        size_t id;
+        if (dev->held_extents == 0) {
+            // Grow the file until we get to an extent on the device.  The extents
+            // we pass over on the way become free extents of the other devices.
+            for (device_t &d : devices) {
+                drop_stale_free_extents(&d);
+            }
+            for (;;) {
+                id = extents.size();
+                extents.push_back(extent_info_t());
+                if (device_for_id(id) == device) {
+                    break;
+                }
+                push_free(id);
+            }
         } else {
-            extent = free_queue.top() * extent_size;
-            free_queue.pop();
+            // Valid entries sort before the ones pointing past the end of the file.
+            rassert(dev->free_queue.top() < extents.size());
+            id = dev->free_queue.top();
+            dev->free_queue.pop();
+            --dev->held_extents;
             --held_extents_;
         }
 
-        extent_info_t *info = &extents[offset_to_id(extent)];
-        info->set_state(extent_info_t::state_in_use);
+        set_in_use(id);
+        const int64_t extent = id * extent_size;
 
         extent_reference_t extent_ref = make_extent_reference(extent);
 
@@ -165,6 +261,7 @@ public:
         bool shrink_file = false;
         while (!extents.empty() && extents.back().state() == extent_info_t::state_free) {
             shrink_file = true;
+            --devices[device_for_id(extents.size() - 1)].held_extents;
             --held_extents_;
             extents.pop_back();
         }
@@ -182,48 +279,37 @@ public:
 
             // Prevent the existence of a relatively large free queue after the file
             // size shrinks.
-            if (held_extents_ < free_queue.size() / 2) {
-                std::priority_queue<size_t,
-                                    std::vector<size_t>,
-                                    std::greater<size_t> > tmp;
-                for (size_t i = 0; i < held_extents_; ++i) {
-                    tmp.push(free_queue.top());
-                    free_queue.pop();
+            for (device_t &device : devices) {
+                if (device.held_extents < device.free_queue.size() / 2) {
+                    drop_stale_free_extents(&device);
                 }
-
-                // held_extents_ was and will be the number of entries in the free_queue
-                // that _didn't_ point off the end of the file.  We just moved those
-                // entries to tmp.  The remaining entries must therefore point off the
-                // end of the file.  Check that no remaining entries point within the
-                // file.
-                guarantee(free_queue.top() >= extents.size(),
-                          "Tried to discard valid held extents.");
-                free_queue = std::move(tmp);
             }
         }
     }
 
     void release_extent(extent_reference_t &&extent_ref) {
         int64_t extent = extent_ref.release();
-        extent_info_t *info = &extents[offset_to_id(extent)];
+        size_t id = offset_to_id(extent);
+        extent_info_t *info = &extents[id];
         guarantee(info->state() == extent_info_t::state_in_use);
         guarantee(info->extent_use_refcount > 0);
         --info->extent_use_refcount;
         if (info->extent_use_refcount == 0) {
-            info->set_state(extent_info_t::state_free);
-            free_queue.push(offset_to_id(extent));
-            ++held_extents_;
+            --devices[device_for_id(id)].extents_in_use;
+            --*tier_extents_in_use(id);
+            push_free(id);
             try_shrink_file();
         }
     }
 };
 
-extent_manager_t::extent_manager_t(file_t *file,
+extent_manager_t::extent_manager_t(file_t *_file,
                                    const log_serializer_on_disk_static_config_t *static_config,
                                    log_serializer_stats_t *_stats)
     : stats(_stats), extent_size(static_config->extent_size()),
-      state(state_reserving_extents) {
+      file(_file), state(state_reserving_extents) {
     guarantee(divides(DEVICE_BLOCK_SIZE, extent_size));
+    check_stripe_size(file, extent_size);
 
     zone.init(new extent_zone_t(file, extent_size, stats));
 }
@@ -243,6 +329,15 @@ void extent_manager_t::prepare_initial_metablock(extent_manager_metablock_mixin_
     mb->padding = 0;
 }
 
+void extent_manager_t::check_stripe_size(file_t *file, int64_t extent_size) {
+    const int64_t stripe_size = file->device_stripe_size();
+    if (stripe_size != 0 && !divides(extent_size, stripe_size)) {
+        crash("The stripe size of the database file (%" PRIi64 " bytes) is not a "
+              "multiple of its extent size (%" PRIi64 " bytes).",
+              stripe_size, extent_size);
+    }
+}
+
 void extent_manager_t::start_existing() {
     assert_thread();
     rassert(state == state_reserving_extents);
@@ -273,11 +368,31 @@ void extent_manager_t::begin_transaction(extent_transaction_t *out) {
 }
 
 extent_reference_t extent_manager_t::gen_extent() {
+    return gen_extent_on_device(-1);
+}
+
+extent_reference_t extent_manager_t::gen_extent_on_device(int device) {
     assert_thread();
     rassert(state == state_running);
     ++stats->pm_extents_in_use;
 
-    return zone->gen_extent();
+    return zone->gen_extent(device);
+}
+
+int extent_manager_t::device_of_extent(int64_t extent) const {
+    return file->device_for_offset(extent);
+}
+
+int extent_manager_t::device_count() const {
+    return file->device_count();
+}
+
+bool extent_manager_t::device_is_cold(int device) const {
+    return file->device_is_cold(device);
+}
+
+int extent_manager_t::pick_cold_device() const {
+    return zone->pick_device(true);
 }
 
 extent_reference_t
@@ -105,6 +105,8 @@ public:
     MUST_USE extent_reference_t reserve_extent(int64_t extent);
 
     static void prepare_initial_metablock(extent_manager_metablock_mixin_t *mb);
+    // Crashes if `file` is striped with stripes that extents don't fit into evenly.
+    static void check_stripe_size(file_t *file, int64_t extent_size);
     void start_existing();
     void prepare_metablock(extent_manager_metablock_mixin_t *metablock);
     void shutdown();
@@ -122,6 +124,10 @@ public:
 
     void begin_transaction(extent_transaction_t *out);
     MUST_USE extent_reference_t gen_extent();
+    // Like gen_extent(), but the extent is placed on the given device of the file
+    // (see `file_t::device_count()`), instead of on the least busy one.  A device of
+    // -1 means the same as gen_extent().
+    MUST_USE extent_reference_t gen_extent_on_device(int device);
     void release_extent_into_transaction(extent_reference_t &&extent_ref,
                                          extent_transaction_t *txn);
     void release_extent(extent_reference_t &&extent_ref);
@@ -131,12 +137,21 @@ public:
     /* Number of extents that have been released but not handed back out again. */
     size_t held_extents();
 
+    int device_count() const;
+    int device_of_extent(int64_t extent) const;
+    bool device_is_cold(int device) const;
+    // The device of the cold tier that a new cold extent should go to, or -1 if the
+    // file doesn't have a cold tier.
+    int pick_cold_device() const;
+
     log_serializer_stats_t *const stats;
     const uint64_t extent_size;   /* Same as static_config->extent_size */
 
 private:
     void release_extent_preliminaries();
 
+    file_t *const file;
+
     scoped_ptr_t<extent_zone_t> zone;
 
     /* During serializer startup, each component informs the extent manager
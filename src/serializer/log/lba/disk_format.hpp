@@ -64,8 +64,11 @@ ATTR_PACKED(struct lba_entry_t {
     // the first 16 bits, perhaps, as a version flag.
     uint32_t zero_reserved;
 
-    // This could be a uint16_t if you wanted it to be, as long as block sizes are
-    // all less than or equal to 4K (which is less than 64K).
+    // The low 16 bits hold the size of the block on disk.  The high 16 bits are zero
+    // for blocks that are stored uncompressed, and hold the block's size before
+    // compression otherwise.  (Older versions guarantee that the high bits are zero,
+    // so they refuse to open files with compressed blocks instead of misreading
+    // them.)
     uint32_t ser_block_size;
 
     block_id_t block_id;
@@ -76,24 +79,34 @@ ATTR_PACKED(struct lba_entry_t {
     flagged_off64_t offset;
 
     static lba_entry_t make(block_id_t block_id, repli_timestamp_t recency,
-                            flagged_off64_t offset, uint16_t ser_block_size) {
+                            flagged_off64_t offset, uint16_t ser_block_size,
+                            uint16_t uncompressed_ser_block_size) {
         guarantee(ser_block_size != 0 || !offset.has_value());
         lba_entry_t entry;
         entry.zero_reserved = 0;
-        entry.ser_block_size = ser_block_size;
+        entry.ser_block_size = static_cast<uint32_t>(ser_block_size)
+            | (static_cast<uint32_t>(uncompressed_ser_block_size) << 16);
         entry.block_id = block_id;
         entry.recency = recency;
         entry.offset = offset;
         return entry;
     }
 
+    uint16_t disk_ser_block_size() const {
+        return static_cast<uint16_t>(ser_block_size & 0xFFFFu);
+    }
+
+    uint16_t uncompressed_ser_block_size() const {
+        return static_cast<uint16_t>(ser_block_size >> 16);
+    }
+
     static bool is_padding(const lba_entry_t *entry) {
         return entry->block_id == PADDING_BLOCK_ID  && entry->offset.is_padding();
     }
 
     static lba_entry_t make_padding_entry() {
         return make(PADDING_BLOCK_ID, repli_timestamp_t::invalid,
-                    flagged_off64_t::padding(), 0);
+                    flagged_off64_t::padding(), 0, 0);
     }
 });
 
@@ -2,9 +2,12 @@
 #include "serializer/log/lba/disk_structure.hpp"
 
 #include <algorithm>
+#include <functional>
 
+#include "arch/runtime/coroutines.hpp"
 #include "containers/scoped.hpp"
 #include "math.hpp"
+#include "threading.hpp"
 
 lba_disk_structure_t::lba_disk_structure_t(extent_manager_t *_em, file_t *_file)
     : em(_em), file(_file), superblock_extent(nullptr), last_extent(nullptr)
@@ -70,6 +73,7 @@ void lba_disk_structure_t::on_extent_read() {
 
 void lba_disk_structure_t::add_entry(block_id_t block_id, repli_timestamp_t recency,
                                      flagged_off64_t offset, uint16_t ser_block_size,
+                                     uint16_t uncompressed_ser_block_size,
                                      file_account_t *io_account,
                                      extent_transaction_t *txn,
                                      optional<std::vector<checksum_filerange>> *checksums) {
@@ -91,7 +95,8 @@ void lba_disk_structure_t::add_entry(block_id_t block_id, repli_timestamp_t rece
 
     rassert(!last_extent->full());
 
-    last_extent->add_entry(lba_entry_t::make(block_id, recency, offset, ser_block_size),
+    last_extent->add_entry(lba_entry_t::make(block_id, recency, offset, ser_block_size,
+                                             uncompressed_ser_block_size),
                            io_account, checksums);
 }
 
@@ -223,6 +228,7 @@ struct reader_t
 {
     lba_disk_structure_t *ds;   // The disk structure we are reading from
     in_memory_index_t *index;   // The in-memory-index we are reading into
+    threadnum_t apply_thread;   // The thread on which we write to `index`
     lba_disk_structure_t::read_callback_t *rcb;   // Who to call back when we finish
 
     /* extent_reader_t takes care of reading a single extent. */
@@ -269,7 +275,16 @@ struct reader_t
             if (have_read) done();
         }
         void done() {
-            extent->read_step_2(&read_info, parent->index);
+            coro_t::spawn_sometime(std::bind(&extent_reader_t::apply, this));
+        }
+        void apply() {
+            {
+                // Applying the entries is pure CPU work, so we leave the serializer
+                // thread for it.  Each LBA shard uses its own thread, so the shards
+                // get replayed in parallel.
+                on_thread_t thread_switcher(parent->apply_thread);
+                extent->read_step_2(&read_info, parent->index);
+            }
             parent->active_readers--;
             parent->start_more_readers();
             if (index == static_cast<int>(parent->readers.size()) - 1) {
@@ -289,8 +304,9 @@ struct reader_t
     // throttle the reading process so that we stay under LBA_READ_BUFFER_SIZE.
     int active_readers;
 
-    reader_t(lba_disk_structure_t *_ds, in_memory_index_t *_index, lba_disk_structure_t::read_callback_t *cb)
-        : ds(_ds), index(_index), rcb(cb)
+    reader_t(lba_disk_structure_t *_ds, in_memory_index_t *_index,
+             threadnum_t _apply_thread, lba_disk_structure_t::read_callback_t *cb)
+        : ds(_ds), index(_index), apply_thread(_apply_thread), rcb(cb)
     {
         for (lba_disk_extent_t *e = ds->extents_in_superblock.head();
              e != nullptr; e = ds->extents_in_superblock.next(e)) {
@@ -325,8 +341,9 @@ struct reader_t
     }
 };
 
-void lba_disk_structure_t::read(in_memory_index_t *index, read_callback_t *cb) {
-    new reader_t(this, index, cb);
+void lba_disk_structure_t::read(in_memory_index_t *index, threadnum_t apply_thread,
+                                read_callback_t *cb) {
+    new reader_t(this, index, apply_thread, cb);
 }
 
 void lba_disk_structure_t::prepare_metablock(lba_shard_metablock_t *mb_out) {
@@ -9,6 +9,7 @@
 #include "serializer/log/lba/disk_format.hpp"
 #include "serializer/log/lba/disk_extent.hpp"
 #include "serializer/log/types.hpp"
+#include "threading.hpp"
 
 class lba_load_fsm_t;
 class lba_writer_t;
@@ -35,6 +36,7 @@ public:
     // Put entries in an LBA and then call wait_for_write_completion() to write to disk
     void add_entry(block_id_t block_id, repli_timestamp_t recency,
                    flagged_off64_t offset, uint16_t ser_block_size,
+                   uint16_t uncompressed_ser_block_size,
                    file_account_t *io_account,
                    extent_transaction_t *txn,
                    optional<std::vector<checksum_filerange>> *checksums);
@@ -59,12 +61,14 @@ public:
                          optional<std::vector<checksum_filerange>> *checksums);
 
     // If you call read(), then the in_memory_index_t will be populated and then the
-    // read_callback_t will be called when it is done.
+    // read_callback_t will be called when it is done.  The entries are written into
+    // the index on `apply_thread`, so the index must not be accessed by anything
+    // else on other threads until the callback has been called.
     struct read_callback_t {
         virtual void on_lba_extents_read() = 0;
         virtual ~read_callback_t() {}
     };
-    void read(in_memory_index_t *index, read_callback_t *cb);
+    void read(in_memory_index_t *index, threadnum_t apply_thread, read_callback_t *cb);
 
     void prepare_metablock(lba_shard_metablock_t *mb_out);
 
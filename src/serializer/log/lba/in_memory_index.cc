@@ -2,51 +2,241 @@
 #include "serializer/log/lba/in_memory_index.hpp"
 
 #include <inttypes.h>
+#include <string.h>
+
+#include <algorithm>
 
 #include "serializer/log/lba/disk_format.hpp"
 
-in_memory_index_t::in_memory_index_t()
-    : end_block_id_(0), end_aux_block_id_(FIRST_AUX_BLOCK_ID) { }
+/* The packed encoding of an all-default `index_block_info_t` is all zero bytes: an offset
+of zero means `flagged_off64_t::unused()`, and a packed recency of zero means
+`repli_timestamp_t::invalid`. Other recencies are stored with a bias of 2^31, so that
+the difference to the base can be negative. */
+static const uint32_t RECENCY_BIAS = 0x80000000u;
+
+static void write_le(char *dest, uint64_t value, size_t bytes) {
+    for (size_t i = 0; i < bytes; ++i) {
+        dest[i] = static_cast<char>((value >> (8 * i)) & 0xFF);
+    }
+}
+
+static uint64_t read_le(const char *src, size_t bytes) {
+    uint64_t value = 0;
+    for (size_t i = 0; i < bytes; ++i) {
+        value |= static_cast<uint64_t>(static_cast<uint8_t>(src[i])) << (8 * i);
+    }
+    return value;
+}
+
+template<bool with_recency>
+packed_block_info_array_t<with_recency>::chunk_t::chunk_t()
+    : count(0), packed(CHUNK_SIZE * ENTRY_SIZE), has_recency_base(false),
+      recency_base(0) {
+    memset(packed.data(), 0, packed.size());
+}
+
+template<bool with_recency>
+packed_block_info_array_t<with_recency>::~packed_block_info_array_t() {
+    for (chunk_t *chunk : chunks) {
+        delete chunk;
+    }
+}
+
+template<bool with_recency>
+index_block_info_t packed_block_info_array_t<with_recency>::get(size_t key) const {
+    const size_t chunk_id = key / CHUNK_SIZE;
+    if (chunk_id < chunks.size() && chunks[chunk_id] != nullptr) {
+        return unpack(chunks[chunk_id], key % CHUNK_SIZE);
+    } else {
+        return index_block_info_t();
+    }
+}
+
+template<bool with_recency>
+void packed_block_info_array_t<with_recency>::set(
+        size_t key, const index_block_info_t &info) {
+    const size_t chunk_id = key / CHUNK_SIZE;
+    const bool is_default = info == index_block_info_t();
+    if (chunk_id >= chunks.size() || chunks[chunk_id] == nullptr) {
+        if (is_default) {
+            return;
+        }
+        if (chunk_id >= chunks.size()) {
+            chunks.resize(chunk_id + 1, nullptr);
+        }
+        chunks[chunk_id] = new chunk_t;
+    }
+
+    chunk_t *chunk = chunks[chunk_id];
+    const size_t index = key % CHUNK_SIZE;
+    if (!(unpack(chunk, index) == index_block_info_t())) {
+        --chunk->count;
+    }
+    if (chunk->wide.has()) {
+        chunk->wide[index] = info;
+    } else if (!pack(chunk, index, info)) {
+        widen(chunk);
+        chunk->wide[index] = info;
+    }
+    if (!is_default) {
+        ++chunk->count;
+    }
+
+    if (chunk->count == 0) {
+        chunks[chunk_id] = nullptr;
+        delete chunk;
+
+        while (!chunks.empty() && chunks.back() == nullptr) {
+            chunks.pop_back();
+        }
+    }
+}
+
+template<bool with_recency>
+index_block_info_t packed_block_info_array_t<with_recency>::unpack(
+        const chunk_t *chunk, size_t index) {
+    if (chunk->wide.has()) {
+        return chunk->wide[index];
+    }
+    const char *entry = chunk->packed.data() + index * ENTRY_SIZE;
+
+    const uint64_t offset_units = read_le(entry, OFFSET_BYTES);
+    entry += OFFSET_BYTES;
+    const flagged_off64_t offset = offset_units == 0
+        ? flagged_off64_t::unused()
+        : flagged_off64_t::make((offset_units - 1) * DEVICE_BLOCK_SIZE);
+
+    repli_timestamp_t recency = repli_timestamp_t::invalid;
+    if (with_recency) {
+        const uint32_t packed_recency = read_le(entry, 4);
+        entry += 4;
+        if (packed_recency != 0) {
+            const int64_t delta = static_cast<int64_t>(packed_recency) - RECENCY_BIAS;
+            recency.longtime = chunk->recency_base + delta;
+        }
+    }
+
+    const uint16_t ser_block_size = read_le(entry, 2);
+    const uint16_t uncompressed_ser_block_size = read_le(entry + 2, 2);
+    return index_block_info_t(offset, recency, ser_block_size,
+                              uncompressed_ser_block_size);
+}
+
+template<bool with_recency>
+bool packed_block_info_array_t<with_recency>::pack(
+        chunk_t *chunk, size_t index, const index_block_info_t &info) {
+    uint64_t offset_units;
+    if (info.offset == flagged_off64_t::unused()) {
+        offset_units = 0;
+    } else if (info.offset.has_value()
+               && info.offset.get_value() % DEVICE_BLOCK_SIZE == 0
+               && static_cast<uint64_t>(info.offset.get_value() / DEVICE_BLOCK_SIZE) + 1
+                   < (uint64_t(1) << (8 * OFFSET_BYTES))) {
+        offset_units = info.offset.get_value() / DEVICE_BLOCK_SIZE + 1;
+    } else {
+        return false;
+    }
+
+    uint32_t packed_recency = 0;
+    if (with_recency && info.recency != repli_timestamp_t::invalid) {
+        if (!chunk->has_recency_base) {
+            chunk->has_recency_base = true;
+            chunk->recency_base = info.recency.longtime;
+        }
+        const int64_t delta =
+            static_cast<int64_t>(info.recency.longtime - chunk->recency_base);
+        if (delta <= -static_cast<int64_t>(RECENCY_BIAS)
+                || delta >= static_cast<int64_t>(RECENCY_BIAS)) {
+            return false;
+        }
+        packed_recency = static_cast<uint32_t>(delta + RECENCY_BIAS);
+    } else {
+        // Aux blocks don't have a recency; it's discarded.
+        rassert(with_recency || info.recency == repli_timestamp_t::invalid);
+    }
+
+    char *entry = chunk->packed.data() + index * ENTRY_SIZE;
+    write_le(entry, offset_units, OFFSET_BYTES);
+    entry += OFFSET_BYTES;
+    if (with_recency) {
+        write_le(entry, packed_recency, 4);
+        entry += 4;
+    }
+    write_le(entry, info.ser_block_size, 2);
+    write_le(entry + 2, info.uncompressed_ser_block_size, 2);
+    return true;
+}
+
+template<bool with_recency>
+void packed_block_info_array_t<with_recency>::widen(chunk_t *chunk) {
+    rassert(!chunk->wide.has());
+    scoped_array_t<index_block_info_t> wide(CHUNK_SIZE);
+    for (size_t i = 0; i < CHUNK_SIZE; ++i) {
+        wide[i] = unpack(chunk, i);
+    }
+    chunk->wide = std::move(wide);
+    chunk->packed.reset();
+}
+
+template class packed_block_info_array_t<true>;
+template class packed_block_info_array_t<false>;
+
+in_memory_index_t::shard_t::shard_t()
+    : end_block_id(0), end_aux_block_id(FIRST_AUX_BLOCK_ID) { }
+
+in_memory_index_t::in_memory_index_t() {
+    // Aux block ids have to map to the same shards as they do in the LBA, after
+    // being made relative.
+    CT_ASSERT(FIRST_AUX_BLOCK_ID % LBA_SHARD_FACTOR == 0);
+}
 
 block_id_t in_memory_index_t::end_block_id() {
-    return end_block_id_;
+    block_id_t res = 0;
+    for (int i = 0; i < LBA_SHARD_FACTOR; ++i) {
+        res = std::max(res, shards_[i].end_block_id);
+    }
+    return res;
 }
 
 block_id_t in_memory_index_t::end_aux_block_id() {
-    return end_aux_block_id_;
+    block_id_t res = FIRST_AUX_BLOCK_ID;
+    for (int i = 0; i < LBA_SHARD_FACTOR; ++i) {
+        res = std::max(res, shards_[i].end_aux_block_id);
+    }
+    return res;
 }
 
 index_block_info_t in_memory_index_t::get_block_info(block_id_t id) {
+    shard_t *shard = &shards_[id % LBA_SHARD_FACTOR];
     if (is_aux_block_id(id)) {
-        index_aux_block_info_t aux_info
-            = aux_infos_.get(make_aux_block_id_relative(id));
-        return index_block_info_t(aux_info.offset,
-                                  repli_timestamp_t::invalid,
-                                  aux_info.ser_block_size);
+        return shard->aux_infos.get(make_aux_block_id_relative(id) / LBA_SHARD_FACTOR);
     } else {
-        return infos_.get(id);
+        return shard->infos.get(id / LBA_SHARD_FACTOR);
     }
 }
 
 void in_memory_index_t::set_block_info(block_id_t id, repli_timestamp_t recency,
                                        flagged_off64_t offset,
-                                       uint16_t ser_block_size) {
+                                       uint16_t ser_block_size,
+                                       uint16_t uncompressed_ser_block_size) {
+    shard_t *shard = &shards_[id % LBA_SHARD_FACTOR];
     if (is_aux_block_id(id)) {
-        if (id >= end_aux_block_id_) {
-            end_aux_block_id_ = id + 1;
+        if (id >= shard->end_aux_block_id) {
+            shard->end_aux_block_id = id + 1;
         }
         // If you're trying to set the timestamp of  an aux block to anything
         // other than `invalid`, you might be doing something wrong. It will be
         // discarded anyway.
         rassert(recency == repli_timestamp_t::invalid);
-        index_aux_block_info_t info(offset, ser_block_size);
-        aux_infos_.set(make_aux_block_id_relative(id), info);
+        index_block_info_t info(offset, repli_timestamp_t::invalid, ser_block_size,
+                                uncompressed_ser_block_size);
+        shard->aux_infos.set(make_aux_block_id_relative(id) / LBA_SHARD_FACTOR, info);
     } else {
-        if (id >= end_block_id_) {
-            end_block_id_ = id + 1;
+        if (id >= shard->end_block_id) {
+            shard->end_block_id = id + 1;
         }
-        index_block_info_t info(offset, recency, ser_block_size);
-        infos_.set(id, info);
+        index_block_info_t info(offset, recency, ser_block_size,
+                                uncompressed_ser_block_size);
+        shard->infos.set(id / LBA_SHARD_FACTOR, info);
     }
 }
-
@@ -2,8 +2,10 @@
 #ifndef SERIALIZER_LOG_LBA_IN_MEMORY_INDEX_HPP_
 #define SERIALIZER_LOG_LBA_IN_MEMORY_INDEX_HPP_
 
+#include <vector>
+
 #include "arch/compiler.hpp"
-#include "containers/two_level_array.hpp"
+#include "containers/scoped.hpp"
 #include "config/args.hpp"
 #include "serializer/serializer.hpp"
 #include "serializer/log/lba/disk_format.hpp"
@@ -12,57 +14,102 @@ ATTR_PACKED(struct index_block_info_t {
     index_block_info_t()
         : offset(flagged_off64_t::unused()),
           recency(repli_timestamp_t::invalid),
-          ser_block_size(0) { }
+          ser_block_size(0),
+          uncompressed_ser_block_size(0) { }
 
     index_block_info_t(flagged_off64_t _offset,
                        repli_timestamp_t _recency,
-                       uint16_t _ser_block_size)
+                       uint16_t _ser_block_size,
+                       uint16_t _uncompressed_ser_block_size)
         : offset(_offset),
           recency(_recency),
-          ser_block_size(_ser_block_size) { }
+          ser_block_size(_ser_block_size),
+          uncompressed_ser_block_size(_uncompressed_ser_block_size) { }
 
-    // For two_level_array_t.
     bool operator==(const index_block_info_t &other) const {
         return offset == other.offset &&
             recency == other.recency &&
-            ser_block_size == other.ser_block_size;
+            ser_block_size == other.ser_block_size &&
+            uncompressed_ser_block_size == other.uncompressed_ser_block_size;
     }
 
-    flagged_off64_t offset;
-    repli_timestamp_t recency;
-    uint16_t ser_block_size;
-});
-
-/* This is a reduced-size block info for auxiliary blocks (currently
-blob blocks used for large values). It doesn't store a replication
-timestamp, because we don't need it for those blocks. */
-ATTR_PACKED(struct index_aux_block_info_t {
-    index_aux_block_info_t()
-        : offset(flagged_off64_t::unused()),
-          ser_block_size(0) { }
-
-    index_aux_block_info_t(flagged_off64_t _offset,
-                           uint16_t _ser_block_size)
-        : offset(_offset),
-          ser_block_size(_ser_block_size) { }
-
-    // For two_level_array_t.
-    bool operator==(const index_aux_block_info_t &other) const {
-        return offset == other.offset &&
-            ser_block_size == other.ser_block_size;
+    // The size of the block as seen by users of the serializer.
+    block_size_t logical_block_size() const {
+        return block_size_t::unsafe_make(uncompressed_ser_block_size != 0
+                                         ? uncompressed_ser_block_size
+                                         : ser_block_size);
     }
 
     flagged_off64_t offset;
+    repli_timestamp_t recency;
+    // The size of the block on disk.
     uint16_t ser_block_size;
+    // Zero if the block is stored uncompressed, otherwise the block's size before
+    // compression.
+    uint16_t uncompressed_ser_block_size;
 });
 
-
+/* `packed_block_info_array_t` maps indexes to `index_block_info_t`s, like a
+`two_level_array_t<index_block_info_t>` would, but stores them in fewer bytes, since the
+index of a big file holds hundreds of millions of them. Every chunk of `CHUNK_SIZE`
+entries starts out packed:
+ - Offsets are multiples of `DEVICE_BLOCK_SIZE`, so they're stored in units of it, in 40
+   bits. That covers files of up to 512 TB.
+ - Recencies are stored as a signed 32-bit difference to the first recency that was set
+   in the chunk, which they are rarely more than two billion writes away from.
+ - Block sizes are kept as they are.
+That is 13 bytes per entry instead of 20, or 9 instead of 12 with `with_recency` false
+(aux blocks have no recency). If a chunk is ever asked to store a value that doesn't fit,
+it switches to plain `index_block_info_t`s for good, so nothing is ever lost. */
+template<bool with_recency>
+class packed_block_info_array_t {
+public:
+    packed_block_info_array_t() { }
+    ~packed_block_info_array_t();
+
+    index_block_info_t get(size_t key) const;
+    void set(size_t key, const index_block_info_t &info);
+
+private:
+    static const size_t CHUNK_SIZE = 1 << 14;
+    static const size_t OFFSET_BYTES = 5;
+    static const size_t ENTRY_SIZE = OFFSET_BYTES + (with_recency ? 4 : 0) + 2 + 2;
+
+    struct chunk_t {
+        chunk_t();
+        // The number of entries that aren't `index_block_info_t()`.
+        size_t count;
+        // Exactly one of these is allocated.
+        scoped_array_t<char> packed;
+        scoped_array_t<index_block_info_t> wide;
+        // What the packed recencies are relative to, once one has been set.
+        bool has_recency_base;
+        uint64_t recency_base;
+    };
+
+    static index_block_info_t unpack(const chunk_t *chunk, size_t index);
+    // Returns `false` if `info` can't be packed into `chunk`.
+    static bool pack(chunk_t *chunk, size_t index, const index_block_info_t &info);
+    static void widen(chunk_t *chunk);
+
+    std::vector<chunk_t *> chunks;
+
+    DISABLE_COPYING(packed_block_info_array_t);
+};
 
 class in_memory_index_t {
-    two_level_array_t<index_block_info_t> infos_;
-    block_id_t end_block_id_;
-    two_level_array_t<index_aux_block_info_t> aux_infos_;
-    block_id_t end_aux_block_id_;
+    // The index is split up the same way as the LBA: block id `i` lives in shard
+    // `i % LBA_SHARD_FACTOR`.  The shards don't share any state, which lets the LBA
+    // shards be replayed into the index concurrently on different threads during
+    // startup.
+    struct shard_t {
+        shard_t();
+        packed_block_info_array_t<true> infos;
+        block_id_t end_block_id;
+        packed_block_info_array_t<false> aux_infos;
+        block_id_t end_aux_block_id;
+    };
+    shard_t shards_[LBA_SHARD_FACTOR];
 
 public:
     in_memory_index_t();
@@ -72,9 +119,15 @@ public:
     block_id_t end_aux_block_id();
 
     index_block_info_t get_block_info(block_id_t id);
+
+    // Calls for block ids that belong to different LBA shards may run concurrently
+    // on different threads (as long as nothing else accesses the index meanwhile).
     void set_block_info(block_id_t id, repli_timestamp_t recency,
-                        flagged_off64_t offset, uint16_t ser_block_size);
+                        flagged_off64_t offset, uint16_t ser_block_size,
+                        uint16_t uncompressed_ser_block_size);
 
+private:
+    DISABLE_COPYING(in_memory_index_t);
 };
 
 #endif  // SERIALIZER_LOG_LBA_IN_MEMORY_INDEX_HPP_
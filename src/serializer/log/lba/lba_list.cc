@@ -85,9 +85,18 @@ public:
         rassert(cbs_out > 0);
         cbs_out--;
         if (cbs_out == 0) {
+            // The shards are independent of each other, both on disk and in the
+            // in-memory index, so we replay each of them into the index on a
+            // different thread.  We start with the threads after ours so that
+            // serializers that start up at the same time don't all pile onto the
+            // same ones.
+            const int num_threads = get_num_threads();
+            const int32_t base_thread = get_thread_id().threadnum;
             cbs_out = LBA_SHARD_FACTOR;
             for (int i = 0; i < LBA_SHARD_FACTOR; i++) {
-                owner->disk_structures[i]->read(&owner->in_memory_index, this);
+                const threadnum_t apply_thread((base_thread + 1 + i) % num_threads);
+                owner->disk_structures[i]->read(&owner->in_memory_index, apply_thread,
+                                                this);
             }
         }
     }
@@ -101,15 +110,12 @@ public:
             // the metablock into the index:
             for (int32_t i = 0; i < owner->inline_lba_entries_count; ++i) {
                 lba_entry_t *e = &owner->inline_lba_entries[i];
-                // The on-disk format still stores 32 bit block sizes.
-                // We've never actually used them, and we now use 16 bit block sizes
-                // for the in-memory index to save a few bytes.
-                guarantee(e->ser_block_size <= std::numeric_limits<uint16_t>::max());
                 owner->in_memory_index.set_block_info(
                         e->block_id,
                         e->recency,
                         e->offset,
-                        static_cast<uint16_t>(e->ser_block_size));
+                        e->disk_ser_block_size(),
+                        e->uncompressed_ser_block_size());
             }
 
             owner->state = lba_list_t::state_ready;
@@ -124,7 +130,7 @@ bool lba_list_t::start_existing(file_t *file, lba_metablock_mixin_t *last_metabl
     rassert(state == state_unstarted);
 
     dbfile = file;
-    gc_io_account.init(new file_account_t(dbfile, LBA_GC_IO_PRIORITY));
+    gc_io_account.init(new file_account_t(dbfile, LBA_GC_IO_PRIORITY, io_caller_t::lba));
 
     lba_start_fsm_t *starter = new lba_start_fsm_t(this, last_metablock);
     if (state == state_ready) {
@@ -192,11 +198,13 @@ segmented_vector_t<repli_timestamp_t> lba_list_t::get_block_recencies(block_id_t
 
 void lba_list_t::set_block_info(block_id_t block, repli_timestamp_t recency,
                                 flagged_off64_t offset, uint16_t ser_block_size,
+                                uint16_t uncompressed_ser_block_size,
                                 file_account_t *io_account, extent_transaction_t *txn,
                                 optional<std::vector<checksum_filerange>> *checksums) {
     rassert(state == state_ready || state == state_gc_shutting_down);
 
-    in_memory_index.set_block_info(block, recency, offset, ser_block_size);
+    in_memory_index.set_block_info(block, recency, offset, ser_block_size,
+                                   uncompressed_ser_block_size);
 
     // If the inline LBA is full, free it up first by moving its entries to
     // the LBA extents
@@ -205,7 +213,8 @@ void lba_list_t::set_block_info(block_id_t block, repli_timestamp_t recency,
         rassert(!check_inline_lba_full());
     }
     // Then store the entry inline
-    add_inline_entry(block, recency, offset, ser_block_size);
+    add_inline_entry(block, recency, offset, ser_block_size,
+                     uncompressed_ser_block_size);
 }
 
 bool lba_list_t::check_inline_lba_full() const {
@@ -244,7 +253,8 @@ void lba_list_t::move_inline_entries_to_extents(
                 e.block_id,
                 e.recency,
                 e.offset,
-                e.ser_block_size,
+                e.disk_ser_block_size(),
+                e.uncompressed_ser_block_size(),
                 io_account,
                 txn,
                 checksums);
@@ -254,11 +264,13 @@ void lba_list_t::move_inline_entries_to_extents(
 }
 
 void lba_list_t::add_inline_entry(block_id_t block, repli_timestamp_t recency,
-                                flagged_off64_t offset, uint16_t ser_block_size) {
+                                flagged_off64_t offset, uint16_t ser_block_size,
+                                uint16_t uncompressed_ser_block_size) {
 
     rassert(!check_inline_lba_full());
     inline_lba_entries[inline_lba_entries_count++] =
-            lba_entry_t::make(block, recency, offset, ser_block_size);
+            lba_entry_t::make(block, recency, offset, ser_block_size,
+                              uncompressed_ser_block_size);
 }
 
 class lba_writer_t :
@@ -361,11 +373,12 @@ void lba_list_t::gc(int lba_shard, auto_drainer_t::lock_t) {
 
         flagged_off64_t off = get_block_offset(id);
         if (off.has_value()) {
-            uint16_t ser_block_size = get_ser_block_size(id);
+            const index_block_info_t info = get_block_info(id);
             disk_structures[lba_shard]->add_entry(id,
-                                                  get_block_recency(id),
+                                                  info.recency,
                                                   off,
-                                                  ser_block_size,
+                                                  info.ser_block_size,
+                                                  info.uncompressed_ser_block_size,
                                                   gc_io_account.get(),
                                                   txns.back().get(),
                                                   &checksums);
@@ -64,6 +64,7 @@ public:
                         repli_timestamp_t recency,
                         flagged_off64_t offset,
                         uint16_t ser_block_size,
+                        uint16_t uncompressed_ser_block_size,
                         file_account_t *io_account,
                         extent_transaction_t *txn,
                         optional<std::vector<checksum_filerange>> *checksums);
@@ -123,7 +124,8 @@ private:
             file_account_t *io_account, extent_transaction_t *txn,
             optional<std::vector<checksum_filerange>> *checksums);
     void add_inline_entry(block_id_t block, repli_timestamp_t recency,
-                          flagged_off64_t offset, uint16_t ser_block_size);
+                          flagged_off64_t offset, uint16_t ser_block_size,
+                          uint16_t uncompressed_ser_block_size);
 
     lba_disk_structure_t *disk_structures[LBA_SHARD_FACTOR];
 
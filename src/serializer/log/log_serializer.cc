@@ -2,6 +2,7 @@
 #include "serializer/log/log_serializer.hpp"
 
 #include <fcntl.h>
+#include <string.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <unistd.h>
@@ -16,13 +17,32 @@
 #include "logger.hpp"
 #include "perfmon/perfmon.hpp"
 #include "serializer/buf_ptr.hpp"
+#include "serializer/log/block_codec.hpp"
 #include "serializer/log/data_block_manager.hpp"
+#include "serializer/log/striped_file.hpp"
+
+static std::vector<serializer_filepath_t> concat_filepaths(
+        const std::vector<serializer_filepath_t> &a,
+        const std::vector<serializer_filepath_t> &b) {
+    std::vector<serializer_filepath_t> res(a);
+    for (const serializer_filepath_t &filepath : b) {
+        res.push_back(filepath);
+    }
+    return res;
+}
 
-filepath_file_opener_t::filepath_file_opener_t(const serializer_filepath_t &filepath,
-                                               io_backender_t *backender)
+filepath_file_opener_t::filepath_file_opener_t(
+        const serializer_filepath_t &filepath,
+        io_backender_t *backender,
+        const std::vector<serializer_filepath_t> &stripe_filepaths,
+        const std::vector<serializer_filepath_t> &cold_filepaths)
     : filepath_(filepath),
+      stripe_filepaths_(concat_filepaths(stripe_filepaths, cold_filepaths)),
+      tiers_(1 + stripe_filepaths.size(), storage_tier_t::hot),
       backender_(backender),
-      opened_temporary_(false) { }
+      opened_temporary_(false) {
+    tiers_.resize(1 + stripe_filepaths_.size(), storage_tier_t::cold);
+}
 
 filepath_file_opener_t::~filepath_file_opener_t() { }
 
@@ -31,16 +51,26 @@ std::string filepath_file_opener_t::file_name() const {
 }
 
 std::string filepath_file_opener_t::temporary_file_name() const {
+    return temporary_file_name(filepath_);
+}
+
+std::string filepath_file_opener_t::temporary_file_name(
+        const serializer_filepath_t &filepath) {
 #ifdef _WIN32
     // TODO WINDOWS: use temporary files
-    return filepath_.permanent_path();
+    return filepath.permanent_path();
 #else
-    return filepath_.temporary_path();
+    return filepath.temporary_path();
 #endif
 }
 
 std::string filepath_file_opener_t::current_file_name() const {
-    return opened_temporary_ ? temporary_file_name() : file_name();
+    return current_file_name(filepath_);
+}
+
+std::string filepath_file_opener_t::current_file_name(
+        const serializer_filepath_t &filepath) const {
+    return opened_temporary_ ? temporary_file_name(filepath) : filepath.permanent_path();
 }
 
 void filepath_file_opener_t::open_serializer_file(const std::string &path,
@@ -67,9 +97,28 @@ void filepath_file_opener_t::open_serializer_file(const std::string &path,
 void filepath_file_opener_t::open_serializer_file_create_temporary(
         scoped_ptr_t<file_t> *file_out) {
     mutex_assertion_t::acq_t acq(&reentrance_mutex_);
-    open_serializer_file(temporary_file_name(),
-                         linux_file_t::mode_create | linux_file_t::mode_truncate,
-                         file_out);
+    const int flags = linux_file_t::mode_create | linux_file_t::mode_truncate;
+    if (stripe_filepaths_.empty()) {
+        open_serializer_file(temporary_file_name(), flags, file_out);
+    } else {
+        std::vector<scoped_ptr_t<file_t> > files(1 + stripe_filepaths_.size());
+        open_serializer_file(temporary_file_name(), flags, &files[0]);
+        for (size_t i = 0; i < stripe_filepaths_.size(); ++i) {
+            open_serializer_file(temporary_file_name(stripe_filepaths_[i]), flags,
+                                 &files[i + 1]);
+        }
+
+        std::vector<file_t *> raw_files;
+        for (const scoped_ptr_t<file_t> &file : files) {
+            raw_files.push_back(file.get());
+        }
+        striped_file_t::write_stripe_headers(raw_files,
+                                             striped_file_t::default_stripe_size,
+                                             tiers_);
+        file_out->init(new striped_file_t(std::move(files),
+                                          striped_file_t::default_stripe_size,
+                                          tiers_));
+    }
     opened_temporary_ = true;
 }
 
@@ -85,15 +134,23 @@ void filepath_file_opener_t::move_serializer_file_to_permanent_location() {
     // TODO WINDOWS: temporary files are not used because, by default,
     // files cannot be renamed while still open
 #else
-    const int res = ::rename(temporary_file_name().c_str(), file_name().c_str());
-
-    if (res != 0) {
-        crash("Could not rename database file %s to permanent location %s (%s)\n",
-              temporary_file_name().c_str(), file_name().c_str(),
-              errno_string(errno).c_str());
+    std::vector<const serializer_filepath_t *> filepaths(1, &filepath_);
+    for (const serializer_filepath_t &filepath : stripe_filepaths_) {
+        filepaths.push_back(&filepath);
     }
+    for (const serializer_filepath_t *filepath : filepaths) {
+        const std::string temporary = temporary_file_name(*filepath);
+        const std::string permanent = filepath->permanent_path();
+        const int res = ::rename(temporary.c_str(), permanent.c_str());
+
+        if (res != 0) {
+            crash("Could not rename database file %s to permanent location %s (%s)\n",
+                  temporary.c_str(), permanent.c_str(),
+                  errno_string(errno).c_str());
+        }
 
-    warn_fsync_parent_directory(file_name().c_str());
+        warn_fsync_parent_directory(permanent.c_str());
+    }
 #endif
 
     opened_temporary_ = false;
@@ -101,7 +158,61 @@ void filepath_file_opener_t::move_serializer_file_to_permanent_location() {
 
 void filepath_file_opener_t::open_serializer_file_existing(scoped_ptr_t<file_t> *file_out) {
     mutex_assertion_t::acq_t acq(&reentrance_mutex_);
-    open_serializer_file(current_file_name(), 0, file_out);
+    scoped_ptr_t<file_t> file;
+    open_serializer_file(current_file_name(), 0, &file);
+
+    // The file itself tells us whether it was created striped.  If it wasn't, any
+    // stripe filepaths we got are only used for new files.
+    stripe_header_t header;
+    if (striped_file_t::read_stripe_header(file.get(), &header)) {
+        open_stripes_existing(std::move(file), header, file_out);
+    } else {
+        file_out->init(file.release());
+    }
+}
+
+void filepath_file_opener_t::open_stripes_existing(
+        scoped_ptr_t<file_t> &&first_file,
+        const stripe_header_t &first_header,
+        scoped_ptr_t<file_t> *file_out) {
+    if (first_header.stripe_index != 0
+        || first_header.stripe_count != 1 + stripe_filepaths_.size()) {
+        crash("Database file %s is stripe %" PRIu32 " of %" PRIu32 ", "
+              "but %zu stripe directories are configured.",
+              current_file_name().c_str(), first_header.stripe_index,
+              first_header.stripe_count, 1 + stripe_filepaths_.size());
+    }
+    check_stripe_tier(current_file_name(), first_header, 0);
+
+    std::vector<scoped_ptr_t<file_t> > files(first_header.stripe_count);
+    files[0].init(first_file.release());
+    for (size_t i = 0; i < stripe_filepaths_.size(); ++i) {
+        const std::string path = current_file_name(stripe_filepaths_[i]);
+        open_serializer_file(path, 0, &files[i + 1]);
+        stripe_header_t header;
+        if (!striped_file_t::read_stripe_header(files[i + 1].get(), &header)
+            || memcmp(header.set_id, first_header.set_id, sizeof(header.set_id)) != 0
+            || header.stripe_index != i + 1
+            || header.stripe_count != first_header.stripe_count
+            || header.stripe_size != first_header.stripe_size) {
+            crash("Database file %s is not stripe %zu of the same striped file as %s.",
+                  path.c_str(), i + 1, current_file_name().c_str());
+        }
+        check_stripe_tier(path, header, i + 1);
+    }
+    file_out->init(
+        new striped_file_t(std::move(files), first_header.stripe_size, tiers_));
+}
+
+void filepath_file_opener_t::check_stripe_tier(const std::string &path,
+                                               const stripe_header_t &header,
+                                               size_t index) const {
+    if (header.tier != tiers_[index]) {
+        crash("Database file %s was created on the %s storage tier, but its directory "
+              "is now configured as a %s directory.", path.c_str(),
+              header.tier == storage_tier_t::cold ? "cold" : "hot",
+              tiers_[index] == storage_tier_t::cold ? "cold" : "stripe");
+    }
 }
 
 void filepath_file_opener_t::unlink_serializer_file() {
@@ -110,8 +221,12 @@ void filepath_file_opener_t::unlink_serializer_file() {
 
     mutex_assertion_t::acq_t acq(&reentrance_mutex_);
     guarantee(opened_temporary_);
-    const int res = ::unlink(current_file_name().c_str());
+    int res = ::unlink(current_file_name().c_str());
     guarantee_err(res == 0, "unlink() failed");
+    for (const serializer_filepath_t &filepath : stripe_filepaths_) {
+        res = ::unlink(current_file_name(filepath).c_str());
+        guarantee_err(res == 0, "unlink() failed");
+    }
 }
 
 
@@ -127,14 +242,21 @@ log_serializer_stats_t::log_serializer_stats_t(perfmon_collection_t *parent)
       pm_serializer_read_bytes_total(),
       pm_serializer_written_bytes_per_sec(secs_to_ticks(1)),
       pm_serializer_written_bytes_total(),
+      pm_serializer_compressed_blocks_written(),
+      pm_serializer_compression_saved_bytes(),
       pm_extents_in_use(),
       pm_file_size_bytes(),
+      pm_hot_tier_extents_in_use(),
+      pm_cold_tier_extents_in_use(),
       pm_serializer_lba_extents(),
       pm_serializer_data_extents(),
       pm_serializer_data_extents_allocated(),
       pm_serializer_data_extents_gced(),
+      pm_serializer_cold_blocks_written(),
+      pm_serializer_blocks_moved_to_cold_tier(),
       pm_serializer_old_garbage_block_bytes(),
       pm_serializer_old_total_block_bytes(),
+      pm_serializer_old_extents_by_garbage(),
       pm_serializer_lba_gcs(),
       parent_collection_membership(parent, &serializer_collection, "serializer"),
       stats_membership(&serializer_collection,
@@ -147,16 +269,34 @@ log_serializer_stats_t::log_serializer_stats_t(perfmon_collection_t *parent)
           &pm_serializer_read_bytes_total, "serializer_read_bytes_total",
           &pm_serializer_written_bytes_per_sec, "serializer_written_bytes_per_sec",
           &pm_serializer_written_bytes_total, "serializer_written_bytes_total",
+          &pm_serializer_compressed_blocks_written,
+          "serializer_compressed_blocks_written",
+          &pm_serializer_compression_saved_bytes, "serializer_compression_saved_bytes",
           &pm_extents_in_use, "serializer_extents_in_use",
           &pm_file_size_bytes, "serializer_file_size_bytes",
+          &pm_hot_tier_extents_in_use, "serializer_hot_tier_extents_in_use",
+          &pm_cold_tier_extents_in_use, "serializer_cold_tier_extents_in_use",
           &pm_serializer_lba_extents, "serializer_lba_extents",
           &pm_serializer_data_extents, "serializer_data_extents",
           &pm_serializer_data_extents_allocated, "serializer_data_extents_allocated",
           &pm_serializer_data_extents_gced, "serializer_data_extents_gced",
+          &pm_serializer_cold_blocks_written, "serializer_cold_blocks_written",
+          &pm_serializer_blocks_moved_to_cold_tier,
+          "serializer_blocks_moved_to_cold_tier",
           &pm_serializer_old_garbage_block_bytes, "serializer_old_garbage_block_bytes",
           &pm_serializer_old_total_block_bytes, "serializer_old_total_block_bytes",
-          &pm_serializer_lba_gcs, "serializer_lba_gcs")
-{ }
+          &pm_serializer_old_extents_by_garbage[0],
+          "serializer_old_extents_garbage_under_25_percent",
+          &pm_serializer_old_extents_by_garbage[1],
+          "serializer_old_extents_garbage_under_50_percent",
+          &pm_serializer_old_extents_by_garbage[2],
+          "serializer_old_extents_garbage_under_75_percent",
+          &pm_serializer_old_extents_by_garbage[3],
+          "serializer_old_extents_garbage_under_100_percent",
+          &pm_serializer_lba_gcs, "serializer_lba_gcs") {
+    // The names of the histogram buckets above assume four buckets.
+    CT_ASSERT(garbage_histogram_buckets == 4);
+}
 
 void log_serializer_stats_t::bytes_read(size_t count) {
     pm_serializer_read_bytes_per_sec.record(count);
@@ -174,6 +314,7 @@ void log_serializer_t::create(serializer_file_opener_t *file_opener,
 
     scoped_ptr_t<file_t> file;
     file_opener->open_serializer_file_create_temporary(&file);
+    extent_manager_t::check_stripe_size(file.get(), static_config.extent_size());
 
     co_static_header_write(file.get(), on_disk_config, sizeof(*on_disk_config));
 
@@ -217,7 +358,10 @@ struct ls_start_existing_fsm_t :
         file_opener->open_serializer_file_existing(&dbfile);
         ser->dbfile = dbfile.release();
         ser->index_writes_io_account.init(
-            new file_account_t(ser->dbfile, INDEX_WRITE_IO_PRIORITY));
+            new file_account_t(ser->dbfile, INDEX_WRITE_IO_PRIORITY, io_caller_t::lba));
+        ser->metablock_writes_io_account.init(
+            new file_account_t(ser->dbfile, INDEX_WRITE_IO_PRIORITY,
+                               io_caller_t::metablock));
 
         start_existing_state = state_read_static_header;
         // STATE A above implies STATE B here
@@ -446,11 +590,11 @@ log_serializer_t::~log_serializer_t() {
     rassert(active_write_count == 0);
 }
 
-file_account_t *log_serializer_t::make_io_account(int priority,
+file_account_t *log_serializer_t::make_io_account(int priority, io_caller_t caller,
                                                   int outstanding_requests_limit) {
     assert_thread();
     rassert(dbfile);
-    return new file_account_t(dbfile, priority, outstanding_requests_limit);
+    return new file_account_t(dbfile, priority, caller, outstanding_requests_limit);
 }
 
 buf_ptr_t log_serializer_t::block_read(const counted_t<block_token_t> &token,
@@ -462,8 +606,12 @@ buf_ptr_t log_serializer_t::block_read(const counted_t<block_token_t> &token,
     ticks_t pm_time;
     stats->pm_serializer_block_reads.begin(&pm_time);
 
-    buf_ptr_t ret = data_block_manager->read(token->offset_, token->block_size(),
+    buf_ptr_t ret = data_block_manager->read(token->offset_, token->disk_block_size_,
                                              io_account);
+    if (token->is_compressed()) {
+        ret = decompress_block(ret.ser_buffer(), token->disk_block_size_,
+                               token->block_size_);
+    }
 
     stats->pm_serializer_block_reads.end(&pm_time);
     return ret;
@@ -495,8 +643,10 @@ void log_serializer_t::index_write(new_mutex_in_line_t *mutex_acq,
              write_op_it != write_ops.end();
              ++write_op_it) {
             const index_write_op_t &op = *write_op_it;
-            flagged_off64_t offset = lba_index->get_block_offset(op.block_id);
-            uint16_t ser_block_size = lba_index->get_ser_block_size(op.block_id);
+            const index_block_info_t old_info = lba_index->get_block_info(op.block_id);
+            flagged_off64_t offset = old_info.offset;
+            uint16_t ser_block_size = old_info.ser_block_size;
+            uint16_t uncompressed_ser_block_size = old_info.uncompressed_ser_block_size;
 
             if (op.token) {
                 // Update the offset pointed to, and mark garbage/liveness as necessary.
@@ -510,7 +660,10 @@ void log_serializer_t::index_write(new_mutex_in_line_t *mutex_acq,
                 // Write new token to index, or remove from index as appropriate.
                 if (token.has()) {
                     offset = flagged_off64_t::make(token->offset_);
-                    ser_block_size = token->block_size().ser_value();
+                    ser_block_size = token->disk_block_size_.ser_value();
+                    uncompressed_ser_block_size = token->is_compressed()
+                        ? token->block_size_.ser_value()
+                        : 0;
 
                     if (checksums) {
                         serializer_checksum checksum = token->checksum_;
@@ -530,10 +683,11 @@ void log_serializer_t::index_write(new_mutex_in_line_t *mutex_acq,
 
                     /* mark the life */
                     data_block_manager->mark_live(offset.get_value(),
-                                                  token->block_size());
+                                                  token->disk_block_size_);
                 } else {
                     offset = flagged_off64_t::unused();
                     ser_block_size = 0;
+                    uncompressed_ser_block_size = 0;
                 }
             }
 
@@ -542,6 +696,7 @@ void log_serializer_t::index_write(new_mutex_in_line_t *mutex_acq,
 
             lba_index->set_block_info(op.block_id, recency,
                                       offset, ser_block_size,
+                                      uncompressed_ser_block_size,
                                       index_writes_io_account.get(), &txn,
                                       &checksums);
         }
@@ -596,7 +751,8 @@ void log_serializer_t::index_write_finish(
     extent_manager->end_transaction(txn);
 
     /* Write the metablock */
-    write_metablock(mutex_acq, &on_lba_written, io_account, std::move(checksums));
+    write_metablock(mutex_acq, &on_lba_written, metablock_writes_io_account.get(),
+                    std::move(checksums));
 
     active_write_count--;
 
@@ -678,9 +834,11 @@ void log_serializer_t::write_metablock_sans_pipelining(
 }
 
 counted_t<block_token_t>
-log_serializer_t::generate_block_token(int64_t offset, block_size_t block_size) {
+log_serializer_t::generate_block_token(int64_t offset, block_size_t block_size,
+                                       block_size_t disk_block_size) {
     assert_thread();
-    counted_t<block_token_t> token(new block_token_t(this, offset, block_size));
+    counted_t<block_token_t> token(new block_token_t(this, offset, block_size,
+                                                     disk_block_size));
 
     auto location = offset_tokens.find(offset);
     if (location == offset_tokens.end()) {
@@ -699,9 +857,65 @@ log_serializer_t::block_writes(const buf_write_info_t *write_infos,
     assert_thread();
     stats->pm_serializer_block_writes += write_infos_count;
 
+    if (dynamic_config.block_codec == block_codec_t::none) {
+        std::vector<counted_t<block_token_t> > result
+            = data_block_manager->many_writes(write_infos, write_infos_count,
+                                              io_account, cb);
+        guarantee(result.size() == write_infos_count);
+        return result;
+    }
+
+    // The compressed images have to stay alive until the writes have completed, so
+    // they're owned by the callback we hand to the data block manager.
+    struct compressed_writes_cb_t : public iocallback_t {
+        void on_io_complete() {
+            iocallback_t *local_cb = cb;
+            delete this;
+            local_cb->on_io_complete();
+        }
+        std::vector<buf_ptr_t> compressed_bufs;
+        iocallback_t *cb;
+    };
+
+    compressed_writes_cb_t *compressed_cb = new compressed_writes_cb_t;
+    compressed_cb->cb = cb;
+    compressed_cb->compressed_bufs.reserve(write_infos_count);
+
+    std::vector<buf_write_info_t> disk_write_infos;
+    disk_write_infos.reserve(write_infos_count);
+    for (size_t i = 0; i < write_infos_count; ++i) {
+        const buf_write_info_t &info = write_infos[i];
+        // `many_writes` sets the block id in the serializer header of the buffers it
+        // writes.  Set it here too, since the compressed image copies the header.
+        info.buf->ser_header.block_id = info.block_id;
+        buf_ptr_t compressed = compress_block(dynamic_config.block_codec,
+                                              info.buf, info.block_size);
+        if (compressed.has()) {
+            ++stats->pm_serializer_compressed_blocks_written;
+            stats->pm_serializer_compression_saved_bytes
+                += buf_ptr_t::compute_aligned_block_size(info.block_size)
+                - compressed.aligned_block_size();
+            disk_write_infos.push_back(buf_write_info_t(compressed.ser_buffer(),
+                                                        compressed.block_size(),
+                                                        info.block_id,
+                                                        info.recency));
+        } else {
+            disk_write_infos.push_back(info);
+        }
+        compressed_cb->compressed_bufs.push_back(std::move(compressed));
+    }
+
     std::vector<counted_t<block_token_t> > result
-        = data_block_manager->many_writes(write_infos, write_infos_count, io_account, cb);
+        = data_block_manager->many_writes(disk_write_infos.data(),
+                                          disk_write_infos.size(),
+                                          io_account, compressed_cb);
     guarantee(result.size() == write_infos_count);
+
+    // The tokens were created with the on-disk size.  Users of the serializer want
+    // to see the size of the block they wrote.
+    for (size_t i = 0; i < write_infos_count; ++i) {
+        result[i]->block_size_ = write_infos[i].block_size;
+    }
     return result;
 }
 
@@ -821,6 +1035,7 @@ counted_t<block_token_t> log_serializer_t::index_read(block_id_t block_id) {
     index_block_info_t info = lba_index->get_block_info(block_id);
     if (info.offset.has_value()) {
         return generate_block_token(info.offset.get_value(),
+                                    info.logical_block_size(),
                                     block_size_t::unsafe_make(info.ser_block_size));
     } else {
         return counted_t<block_token_t>();
@@ -941,6 +1156,7 @@ void log_serializer_t::next_shutdown_step() {
 
 void log_serializer_t::delete_dbfile_and_continue_shutdown() {
     index_writes_io_account.reset();
+    metablock_writes_io_account.reset();
     rassert(dbfile != nullptr);
     delete dbfile;
     dbfile = nullptr;
@@ -1016,9 +1232,11 @@ bool log_serializer_t::should_perform_read_ahead() {
 
 block_token_t::block_token_t(log_serializer_t *serializer,
                              int64_t initial_offset,
-                             block_size_t initial_block_size)
+                             block_size_t initial_block_size,
+                             block_size_t initial_disk_block_size)
     : serializer_(serializer), ref_count_(0),
       block_size_(initial_block_size),
+      disk_block_size_(initial_disk_block_size),
       checksum_(no_checksum()),
       offset_(initial_offset) {
     serializer_->assert_thread();
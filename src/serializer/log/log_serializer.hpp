@@ -30,6 +30,8 @@ class data_block_manager_t;
 struct block_magic_t;
 class io_backender_t;
 class log_serializer_t;
+struct stripe_header_t;
+enum class storage_tier_t : uint32_t;
 
 namespace data_block_manager {
 struct shutdown_callback_t {
@@ -46,11 +48,19 @@ struct shutdown_callback_t {
  * respect that it deserves.
  */
 
-// Used to open a file (with the given filepath) for the log serializer.
+// Used to open a file (with the given filepath) for the log serializer.  If
+// `stripe_filepaths` or `cold_filepaths` is non-empty, new serializer files are striped
+// over `filepath`, followed by the files in `stripe_filepaths` and then the ones in
+// `cold_filepaths` (see `striped_file_t`).  The latter are the cold storage tier.
+// Existing files are opened the way they were created.
 class filepath_file_opener_t : public serializer_file_opener_t {
 public:
     filepath_file_opener_t(const serializer_filepath_t &filepath,
-                           io_backender_t *backender);
+                           io_backender_t *backender,
+                           const std::vector<serializer_filepath_t> &stripe_filepaths
+                               = std::vector<serializer_filepath_t>(),
+                           const std::vector<serializer_filepath_t> &cold_filepaths
+                               = std::vector<serializer_filepath_t>());
     ~filepath_file_opener_t();
 
     // The path of the final position of the file.
@@ -64,16 +74,33 @@ public:
 private:
     void open_serializer_file(const std::string &path, int extra_flags, scoped_ptr_t<file_t> *file_out);
 
+    // Opens the stripe files of a striped serializer file whose first file is
+    // `first_file`, and checks that they belong together.
+    void open_stripes_existing(scoped_ptr_t<file_t> &&first_file,
+                               const stripe_header_t &first_header,
+                               scoped_ptr_t<file_t> *file_out);
+    // Crashes if the stripe at `path` isn't on the tier it's configured for.
+    void check_stripe_tier(const std::string &path, const stripe_header_t &header,
+                           size_t index) const;
+
     // The path of the temporary file.  This is file_name() with some suffix appended.
     std::string temporary_file_name() const;
+    static std::string temporary_file_name(const serializer_filepath_t &filepath);
 
     // Either file_name() or temporary_file_name(), depending on whether
     // opened_temporary_ is true.
     std::string current_file_name() const;
+    std::string current_file_name(const serializer_filepath_t &filepath) const;
 
     // The filepath of the final position of the file.
     const serializer_filepath_t filepath_;
 
+    // The filepaths of the other stripes of a striped file, in order.
+    const std::vector<serializer_filepath_t> stripe_filepaths_;
+
+    // The tier of every stripe, starting with the one at `filepath_`.
+    std::vector<storage_tier_t> tiers_;
+
     io_backender_t *const backender_;
 
     // Makes sure that only one member function gets called at a time.  Some of them are
@@ -124,7 +151,8 @@ public:
     virtual ~log_serializer_t();
 
     using serializer_t::make_io_account;
-    file_account_t *make_io_account(int priority, int outstanding_requests_limit);
+    file_account_t *make_io_account(int priority, io_caller_t caller,
+                                    int outstanding_requests_limit);
 
     void register_read_ahead_cb(serializer_read_ahead_callback_t *cb);
     void unregister_read_ahead_cb(serializer_read_ahead_callback_t *cb);
@@ -158,8 +186,12 @@ public:
 private:
     void unregister_block_token(block_token_t *token);
     void remap_block_to_new_offset(int64_t current_offset, int64_t new_offset);
+    // `block_size` is the block's size as seen by users of the serializer,
+    // `disk_block_size` is the size it takes up on disk (these differ for
+    // compressed blocks).
     counted_t<block_token_t> generate_block_token(int64_t offset,
-                                                             block_size_t block_size);
+                                                  block_size_t block_size,
+                                                  block_size_t disk_block_size);
 
     void offer_buf_to_read_ahead_callbacks(
             block_id_t block_id,
@@ -253,6 +285,10 @@ private:
 
     file_t *dbfile;
     scoped_ptr_t<file_account_t> index_writes_io_account;
+    // Only the metablock writes of index writes use this, but it has the same priority
+    // as `index_writes_io_account`. It's separate so that the disk stats can tell the
+    // LBA writes and the metablock writes apart.
+    scoped_ptr_t<file_account_t> metablock_writes_io_account;
 
     extent_manager_t *extent_manager;
     metablock_manager_t *metablock_manager;
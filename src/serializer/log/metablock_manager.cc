@@ -244,8 +244,9 @@ bool disk_format_version_is_recognized(uint32_t disk_format_version) {
         || disk_format_version == static_cast<uint32_t>(cluster_version_t::v2_2)
         || disk_format_version == static_cast<uint32_t>(cluster_version_t::v2_3)
         || disk_format_version == static_cast<uint32_t>(cluster_version_t::v2_4)
+        || disk_format_version == static_cast<uint32_t>(cluster_version_t::v2_5)
         || disk_format_version ==
-            static_cast<uint32_t>(cluster_version_t::v2_5_is_latest_disk);
+            static_cast<uint32_t>(cluster_version_t::v2_6_is_latest_disk);
 }
 
 bool metablock_manager_t::verify_checksum_fileranges(const crc_metablock_t *mb) {
@@ -257,7 +258,7 @@ bool metablock_manager_t::verify_checksum_fileranges(const crc_metablock_t *mb)
                 mb->disk_format_version);
     }
 
-    if (mb->disk_format_version != static_cast<uint32_t>(cluster_version_t::v2_5_is_latest_disk)) {
+    if (mb->disk_format_version < static_cast<uint32_t>(cluster_version_t::v2_5)) {
         // There are no checksums.
         return true;
     }
@@ -22,9 +22,15 @@ struct log_serializer_stats_t {
     perfmon_rate_monitor_t pm_serializer_written_bytes_per_sec;
     perfmon_counter_t pm_serializer_written_bytes_total;
 
+    /* used for block compression in serializer/log/log_serializer.cc */
+    perfmon_counter_t pm_serializer_compressed_blocks_written;
+    perfmon_counter_t pm_serializer_compression_saved_bytes;
+
     /* used in serializer/log/extent_manager.cc */
     perfmon_counter_t pm_extents_in_use;
     perfmon_counter_t pm_file_size_bytes;
+    perfmon_counter_t pm_hot_tier_extents_in_use;
+    perfmon_counter_t pm_cold_tier_extents_in_use;
 
     /* used in serializer/log/lba/extent.cc */
     perfmon_counter_t pm_serializer_lba_extents;
@@ -33,8 +39,14 @@ struct log_serializer_stats_t {
     perfmon_counter_t pm_serializer_data_extents;
     perfmon_counter_t pm_serializer_data_extents_allocated;
     perfmon_counter_t pm_serializer_data_extents_gced;
+    perfmon_counter_t pm_serializer_cold_blocks_written;
+    perfmon_counter_t pm_serializer_blocks_moved_to_cold_tier;
     perfmon_counter_t pm_serializer_old_garbage_block_bytes;
     perfmon_counter_t pm_serializer_old_total_block_bytes;
+    // The number of old (GC candidate) extents, by their fraction of garbage: bucket
+    // `i` counts the extents with a garbage fraction in [i / N, (i + 1) / N).
+    static const int garbage_histogram_buckets = 4;
+    perfmon_counter_t pm_serializer_old_extents_by_garbage[garbage_histogram_buckets];
 
     /* used in serializer/log/lba/lba_list.cc */
     perfmon_counter_t pm_serializer_lba_gcs;
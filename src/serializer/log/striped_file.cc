@@ -0,0 +1,343 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#include "serializer/log/striped_file.hpp"
+
+#include <string.h>
+#include <sys/uio.h>
+
+#include <algorithm>
+#include <functional>
+
+#include "arch/arch.hpp"
+#include "containers/uuid.hpp"
+#include "math.hpp"
+
+static const char STRIPE_HEADER_MAGIC[8] = { 'r', 'd', 'b', 's', 't', 'r', 'p', '1' };
+
+// Wraps the callback of a request forwarded to one of the underlying files, to keep
+// track of how many requests each device has in flight.
+class striped_file_t::striped_iocallback_t : public linux_iocallback_t {
+public:
+    striped_iocallback_t(striped_file_t *parent, int device, linux_iocallback_t *cb)
+        : parent_(parent), device_(device), cb_(cb) { }
+
+    void on_io_complete() {
+        linux_iocallback_t *cb = cb_;
+        finish();
+        cb->on_io_complete();
+    }
+
+    void on_io_failure(int errsv, int64_t offset, int64_t count) {
+        linux_iocallback_t *cb = cb_;
+        finish();
+        cb->on_io_failure(errsv, offset, count);
+    }
+
+private:
+    void finish() {
+        --parent_->outstanding_requests_[device_];
+        delete this;
+    }
+
+    striped_file_t *const parent_;
+    const int device_;
+    linux_iocallback_t *const cb_;
+
+    DISABLE_COPYING(striped_iocallback_t);
+};
+
+// Waits for the datasyncs of several of the underlying files, and then runs `then`.  If
+// one of them fails, `cb` gets the failure instead.
+class striped_file_t::datasyncs_callback_t : public linux_iocallback_t {
+public:
+    datasyncs_callback_t(int count, std::function<void()> &&then,
+                         linux_iocallback_t *cb)
+        : count_(count), failed_(false), errsv_(0), offset_(0), failed_count_(0),
+          then_(std::move(then)), cb_(cb) {
+        guarantee(count_ > 0);
+    }
+
+    void on_io_complete() {
+        finish();
+    }
+
+    void on_io_failure(int errsv, int64_t offset, int64_t count) {
+        if (!failed_) {
+            failed_ = true;
+            errsv_ = errsv;
+            offset_ = offset;
+            failed_count_ = count;
+        }
+        finish();
+    }
+
+private:
+    void finish() {
+        --count_;
+        if (count_ > 0) {
+            return;
+        }
+        if (failed_) {
+            cb_->on_io_failure(errsv_, offset_, failed_count_);
+        } else {
+            then_();
+        }
+        delete this;
+    }
+
+    int count_;
+    bool failed_;
+    int errsv_;
+    int64_t offset_;
+    int64_t failed_count_;
+    std::function<void()> then_;
+    linux_iocallback_t *const cb_;
+
+    DISABLE_COPYING(datasyncs_callback_t);
+};
+
+// An account on a `striped_file_t` is an account on each of the underlying files.
+struct striped_file_t::striped_account_t {
+    std::vector<scoped_ptr_t<file_account_t> > device_accounts;
+};
+
+striped_file_t::striped_file_t(std::vector<scoped_ptr_t<file_t> > &&files,
+                               int64_t stripe_size,
+                               const std::vector<storage_tier_t> &tiers)
+    : files_(std::move(files)),
+      stripe_size_(stripe_size),
+      file_size_(0),
+      outstanding_requests_(files_.size(), 0),
+      cold_devices_(files_.size(), false),
+      unsynced_devices_(files_.size(), false) {
+    guarantee(!files_.empty());
+    guarantee(tiers.empty() || tiers.size() == files_.size());
+    for (size_t i = 0; i < tiers.size(); ++i) {
+        cold_devices_[i] = (tiers[i] == storage_tier_t::cold);
+    }
+    guarantee(stripe_size_ > 0 && divides(DEVICE_BLOCK_SIZE, stripe_size_));
+    CT_ASSERT(header_size % DEVICE_BLOCK_SIZE == 0);
+    CT_ASSERT(sizeof(stripe_header_t) <= header_size);
+
+    // The logical file size is however far the stripes that are present on the
+    // devices reach without a gap.
+    const int64_t n = files_.size();
+    for (int64_t stripe = 0; ; ++stripe) {
+        const int64_t device_size = files_[stripe % n]->get_file_size() - header_size;
+        const int64_t stripe_start = (stripe / n) * stripe_size_;
+        if (device_size < stripe_start + stripe_size_) {
+            file_size_ = stripe * stripe_size_
+                + std::max<int64_t>(0, device_size - stripe_start);
+            break;
+        }
+    }
+}
+
+striped_file_t::~striped_file_t() {
+    for (int64_t outstanding : outstanding_requests_) {
+        rassert(outstanding == 0);
+    }
+}
+
+void striped_file_t::write_stripe_headers(const std::vector<file_t *> &files,
+                                          int64_t stripe_size,
+                                          const std::vector<storage_tier_t> &tiers) {
+    guarantee(tiers.empty() || tiers.size() == files.size());
+    const uuid_u set_id = generate_uuid();
+    CT_ASSERT(sizeof(stripe_header_t::set_id) == uuid_u::kStaticSize);
+    scoped_device_block_aligned_ptr_t<char> buf(header_size);
+    for (size_t i = 0; i < files.size(); ++i) {
+        memset(buf.get(), 0, header_size);
+        stripe_header_t header;
+        memcpy(header.magic, STRIPE_HEADER_MAGIC, sizeof(header.magic));
+        memcpy(header.set_id, set_id.data(), sizeof(header.set_id));
+        header.stripe_index = i;
+        header.stripe_count = files.size();
+        header.stripe_size = stripe_size;
+        header.tier = tiers.empty() ? storage_tier_t::hot : tiers[i];
+        memcpy(buf.get(), &header, sizeof(header));
+
+        files[i]->set_file_size(header_size);
+        co_write(files[i], 0, header_size, buf.get(), DEFAULT_DISK_ACCOUNT,
+                 datasync_op::wrap_in_datasyncs);
+    }
+}
+
+bool striped_file_t::read_stripe_header(file_t *file, stripe_header_t *header_out) {
+    if (file->get_file_size() < header_size) {
+        return false;
+    }
+    scoped_device_block_aligned_ptr_t<char> buf(header_size);
+    co_read(file, 0, header_size, buf.get(), DEFAULT_DISK_ACCOUNT);
+    memcpy(header_out, buf.get(), sizeof(*header_out));
+    return memcmp(header_out->magic, STRIPE_HEADER_MAGIC, sizeof(header_out->magic)) == 0;
+}
+
+int64_t striped_file_t::get_file_size() {
+    return file_size_;
+}
+
+void striped_file_t::set_file_size(int64_t size) {
+    for (size_t i = 0; i < files_.size(); ++i) {
+        files_[i]->set_file_size(device_file_size(i, size));
+    }
+    file_size_ = size;
+}
+
+void striped_file_t::set_file_size_at_least(int64_t size, int64_t extent_size) {
+    if (file_size_ < size) {
+        for (size_t i = 0; i < files_.size(); ++i) {
+            files_[i]->set_file_size_at_least(device_file_size(i, size), extent_size);
+        }
+        file_size_ = size;
+    }
+}
+
+void striped_file_t::read_async(int64_t offset, size_t length, void *buf,
+                                file_account_t *account, linux_iocallback_t *cb) {
+    const int device = device_for_offset(offset);
+    files_[device]->read_async(device_offset(offset, length), length, buf,
+                               device_account(account, device),
+                               track_request(device, cb));
+}
+
+void striped_file_t::write_async(int64_t offset, size_t length, const void *buf,
+                                 file_account_t *account, linux_iocallback_t *cb,
+                                 datasync_op ds_op) {
+    const int device = device_for_offset(offset);
+    const int64_t dev_offset = device_offset(offset, length);
+    if (ds_op == datasync_op::no_datasyncs) {
+        unsynced_devices_[device] = true;
+        files_[device]->write_async(dev_offset, length, buf,
+                                    device_account(account, device),
+                                    track_request(device, cb), ds_op);
+        return;
+    }
+    // The datasync of `device` itself is done along with the write.
+    unsynced_devices_[device] = false;
+    datasync_unsynced_devices(
+        device, account,
+        [this, device, dev_offset, length, buf, account, cb, ds_op]() {
+            files_[device]->write_async(dev_offset, length, buf,
+                                        device_account(account, device),
+                                        track_request(device, cb), ds_op);
+        },
+        cb);
+}
+
+void striped_file_t::writev_async(int64_t offset, size_t length,
+                                  scoped_array_t<iovec> &&bufs,
+                                  file_account_t *account, linux_iocallback_t *cb) {
+    const int device = device_for_offset(offset);
+    unsynced_devices_[device] = true;
+    files_[device]->writev_async(device_offset(offset, length), length,
+                                 std::move(bufs), device_account(account, device),
+                                 track_request(device, cb));
+}
+
+void striped_file_t::datasync_async(file_account_t *account, linux_iocallback_t *cb) {
+    datasync_unsynced_devices(-1, account, [cb]() { cb->on_io_complete(); }, cb);
+}
+
+void *striped_file_t::create_account(int priority, io_caller_t caller,
+                                     int outstanding_requests_limit) {
+    striped_account_t *account = new striped_account_t;
+    account->device_accounts.resize(files_.size());
+    for (size_t i = 0; i < files_.size(); ++i) {
+        account->device_accounts[i].init(
+            new file_account_t(files_[i].get(), priority, caller,
+                               outstanding_requests_limit));
+    }
+    return account;
+}
+
+void striped_file_t::destroy_account(void *account) {
+    delete static_cast<striped_account_t *>(account);
+}
+
+bool striped_file_t::coop_lock_and_check() {
+    for (const scoped_ptr_t<file_t> &file : files_) {
+        if (!file->coop_lock_and_check()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int striped_file_t::device_count() {
+    return files_.size();
+}
+
+int striped_file_t::device_for_offset(int64_t offset) {
+    rassert(offset >= 0);
+    return (offset / stripe_size_) % files_.size();
+}
+
+int64_t striped_file_t::device_outstanding_requests(int device) {
+    return outstanding_requests_[device];
+}
+
+bool striped_file_t::device_is_cold(int device) {
+    return cold_devices_[device];
+}
+
+int64_t striped_file_t::device_stripe_size() {
+    return stripe_size_;
+}
+
+int64_t striped_file_t::device_offset(int64_t offset, size_t length) {
+    const int64_t stripe = offset / stripe_size_;
+    guarantee(length > 0
+              && (offset + static_cast<int64_t>(length) - 1) / stripe_size_ == stripe,
+              "I/O request (offset %" PRIi64 ", length %zu) crosses a stripe boundary.",
+              offset, length);
+    return header_size + (stripe / files_.size()) * stripe_size_
+        + offset % stripe_size_;
+}
+
+int64_t striped_file_t::device_file_size(int device, int64_t size) {
+    const int64_t n = files_.size();
+    const int64_t full_stripes = size / stripe_size_;
+    int64_t res = header_size + (full_stripes / n) * stripe_size_;
+    if (device < full_stripes % n) {
+        res += stripe_size_;
+    } else if (device == full_stripes % n) {
+        res += size % stripe_size_;
+    }
+    return res;
+}
+
+file_account_t *striped_file_t::device_account(file_account_t *account, int device) {
+    if (account == DEFAULT_DISK_ACCOUNT) {
+        return DEFAULT_DISK_ACCOUNT;
+    }
+    striped_account_t *striped = static_cast<striped_account_t *>(account->get_account());
+    return striped->device_accounts[device].get();
+}
+
+linux_iocallback_t *striped_file_t::track_request(int device, linux_iocallback_t *cb) {
+    ++outstanding_requests_[device];
+    return new striped_iocallback_t(this, device, cb);
+}
+
+void striped_file_t::datasync_unsynced_devices(int except_device,
+                                               file_account_t *account,
+                                               std::function<void()> &&then,
+                                               linux_iocallback_t *cb) {
+    std::vector<int> devices;
+    for (size_t i = 0; i < files_.size(); ++i) {
+        if (static_cast<int>(i) != except_device && unsynced_devices_[i]) {
+            devices.push_back(i);
+        }
+    }
+    if (devices.empty()) {
+        then();
+        return;
+    }
+    datasyncs_callback_t *syncs_cb
+        = new datasyncs_callback_t(devices.size(), std::move(then), cb);
+    for (int device : devices) {
+        unsynced_devices_[device] = false;
+        files_[device]->datasync_async(device_account(account, device),
+                                       track_request(device, syncs_cb));
+    }
+}
@@ -0,0 +1,125 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#ifndef SERIALIZER_LOG_STRIPED_FILE_HPP_
+#define SERIALIZER_LOG_STRIPED_FILE_HPP_
+
+#include <stdint.h>
+
+#include <functional>
+#include <vector>
+
+#include "arch/compiler.hpp"
+#include "arch/types.hpp"
+#include "config/args.hpp"
+#include "containers/scoped.hpp"
+
+// The storage tier a file of a stripe set is on.  New extents go to the hot tier, and
+// the GC moves cold blocks to the cold tier (see `data_block_manager_t`).
+enum class storage_tier_t : uint32_t {
+    hot = 0,
+    cold = 1
+};
+
+// Every file of a stripe set starts with this header, followed by padding up to
+// `striped_file_t::header_size`.  This defines the disk format!
+ATTR_PACKED(struct stripe_header_t {
+    char magic[8];
+    // Identifies the stripe set, so that files from different sets can't get mixed up.
+    uint8_t set_id[16];
+    uint32_t stripe_index;
+    uint32_t stripe_count;
+    uint64_t stripe_size;
+    // Stripe sets from before there were tiers have zero padding here, so all of
+    // their files are on the hot tier.
+    storage_tier_t tier;
+});
+
+// A `file_t` that spreads one serializer file over several files, usually on
+// different devices.  The logical file is cut into stripes of `stripe_size` bytes,
+// and stripe `s` is stored in file `s % N`.  The stripe size is a multiple of the
+// extent size, so an extent (and therefore every read or write the serializer does)
+// lies entirely within one file.  The extent manager uses `device_for_offset`,
+// `device_outstanding_requests` and `device_is_cold` to decide where new extents go.
+//
+// A write that asks for a datasync also datasyncs the other files that were written to
+// since their last datasync, before it goes to its own file.  Otherwise a metablock
+// could become durable before the extents it points to on other devices.
+class striped_file_t : public file_t {
+public:
+    static const int64_t header_size = 4096;
+    // One stripe per extent spreads the extents of a file evenly over the devices.
+    static const int64_t default_stripe_size = DEFAULT_EXTENT_SIZE;
+
+    // Takes ownership of `files`, which must already carry matching stripe headers
+    // (see `write_stripe_headers` and `read_stripe_header`), ordered by stripe index.
+    // `tiers` holds the tier of each file; if it's empty, they're all hot.
+    striped_file_t(std::vector<scoped_ptr_t<file_t> > &&files, int64_t stripe_size,
+                   const std::vector<storage_tier_t> &tiers
+                       = std::vector<storage_tier_t>());
+    ~striped_file_t();
+
+    // Truncates `files` to just their headers and writes fresh stripe headers for a
+    // new stripe set, with the tiers as for the constructor.  Blocks.
+    static void write_stripe_headers(const std::vector<file_t *> &files,
+                                     int64_t stripe_size,
+                                     const std::vector<storage_tier_t> &tiers
+                                         = std::vector<storage_tier_t>());
+
+    // Reads the stripe header of `file`.  Returns false if `file` isn't part of a
+    // stripe set (e.g. because it is an ordinary serializer file).  Blocks.
+    static bool read_stripe_header(file_t *file, stripe_header_t *header_out);
+
+    int64_t get_file_size();
+    void set_file_size(int64_t size);
+    void set_file_size_at_least(int64_t size, int64_t extent_size);
+
+    void read_async(int64_t offset, size_t length, void *buf,
+                    file_account_t *account, linux_iocallback_t *cb);
+    void write_async(int64_t offset, size_t length, const void *buf,
+                     file_account_t *account, linux_iocallback_t *cb,
+                     datasync_op ds_op);
+    void writev_async(int64_t offset, size_t length, scoped_array_t<iovec> &&bufs,
+                      file_account_t *account, linux_iocallback_t *cb);
+    void datasync_async(file_account_t *account, linux_iocallback_t *cb);
+
+    void *create_account(int priority, io_caller_t caller,
+                         int outstanding_requests_limit);
+    void destroy_account(void *account);
+
+    bool coop_lock_and_check();
+
+    int device_count();
+    int device_for_offset(int64_t offset);
+    int64_t device_outstanding_requests(int device);
+    bool device_is_cold(int device);
+    int64_t device_stripe_size();
+
+private:
+    class striped_iocallback_t;
+    class datasyncs_callback_t;
+    struct striped_account_t;
+
+    // Maps a logical offset to an offset in `files_[device_for_offset(offset)]`, and
+    // checks that the range doesn't cross into another stripe.
+    int64_t device_offset(int64_t offset, size_t length);
+    // The size `files_[device]` has to have to store a logical file of `size` bytes.
+    int64_t device_file_size(int device, int64_t size);
+    file_account_t *device_account(file_account_t *account, int device);
+    linux_iocallback_t *track_request(int device, linux_iocallback_t *cb);
+    // Datasyncs the files other than `except_device` (which may be -1) that have been
+    // written to since their last datasync, and then runs `then`.  If a datasync
+    // fails, `cb` gets the failure instead.
+    void datasync_unsynced_devices(int except_device, file_account_t *account,
+                                   std::function<void()> &&then,
+                                   linux_iocallback_t *cb);
+
+    std::vector<scoped_ptr_t<file_t> > files_;
+    const int64_t stripe_size_;
+    int64_t file_size_;
+    std::vector<int64_t> outstanding_requests_;
+    std::vector<bool> cold_devices_;
+    std::vector<bool> unsynced_devices_;
+
+    DISABLE_COPYING(striped_file_t);
+};
+
+#endif  // SERIALIZER_LOG_STRIPED_FILE_HPP_
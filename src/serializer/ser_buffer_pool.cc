@@ -0,0 +1,348 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#include "serializer/ser_buffer_pool.hpp"
+
+#include <sys/mman.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <vector>
+
+#include "arch/runtime/numa.hpp"
+#include "arch/runtime/runtime.hpp"
+#include "arch/spinlock.hpp"
+#include "concurrency/cache_line_padded.hpp"
+#include "config/args.hpp"
+#include "logger.hpp"
+#include "math.hpp"
+#include "memory_utils.hpp"
+#include "perfmon/memory.hpp"
+#include "perfmon/perfmon.hpp"
+
+namespace {
+
+// We don't pool buffers bigger than this.  Blocks are hardly ever bigger than the
+// default block size, so it's not worth holding on to bigger buffers.
+const size_t MAX_POOLED_SIZE = 4 * DEFAULT_BTREE_BLOCK_SIZE;
+const size_t NUM_SIZE_CLASSES = MAX_POOLED_SIZE / DEVICE_BLOCK_SIZE;
+
+// How many bytes of buffers of each size class a thread keeps at most.  A thread
+// that has more hands half of them to the depot.
+const size_t THREAD_FREE_LIST_BYTES = MEGABYTE;
+
+// How many bytes of buffers of each size class the depot keeps at most.
+const size_t DEPOT_FREE_LIST_BYTES = 16 * MEGABYTE;
+
+// How many bytes of buffers all the free lists together keep at most.  The caches
+// don't account for the buffers in the pool, so without this the pool could hold on
+// to several megabytes per thread on top of the cache size.
+const size_t MAX_POOLED_BYTES = 64 * MEGABYTE;
+
+const size_t HUGE_PAGE_SIZE = 2 * MEGABYTE;
+
+size_t size_class(size_t aligned_size) {
+    return aligned_size / DEVICE_BLOCK_SIZE - 1;
+}
+
+// The memory that the pool carves buffers out of when huge pages are enabled.  It
+// never gets unmapped, and buffers that come back to it are kept in its own free
+// lists, since they can't go back to the allocator.
+struct huge_page_arena_t {
+    std::atomic<bool> enabled;
+    huge_page_mode_t mode;
+    char *begin;
+    char *end;
+
+    spinlock_t lock;
+    // Everything from `next` to `end` hasn't been handed out yet.
+    char *next;
+    std::vector<void *> free_lists[NUM_SIZE_CLASSES];
+
+    bool contains(const void *buf) const {
+        return enabled.load(std::memory_order_acquire)
+            && static_cast<const char *>(buf) >= begin
+            && static_cast<const char *>(buf) < end;
+    }
+};
+
+// This gets constructed before and destroyed after the free lists below, which hand
+// their buffers back to it when they are destroyed.
+huge_page_arena_t huge_page_arena;
+
+struct pool_stats_t {
+    perfmon_counter_t pm_hits;
+    perfmon_counter_t pm_misses;
+    perfmon_counter_t pm_huge_page_bytes;
+    perfmon_multi_membership_t membership;
+
+    pool_stats_t()
+        : membership(&get_global_perfmon_collection(),
+                     &pm_hits, "ser_buffer_pool_hits",
+                     &pm_misses, "ser_buffer_pool_misses",
+                     &pm_huge_page_bytes, "ser_buffer_pool_huge_page_bytes") { }
+};
+
+pool_stats_t *get_pool_stats() {
+    static pool_stats_t stats;
+    return &stats;
+}
+
+// Returns null if huge pages aren't enabled or the arena has run out.
+void *huge_page_arena_alloc(size_t aligned_size) {
+    huge_page_arena_t *arena = &huge_page_arena;
+    if (!arena->enabled.load(std::memory_order_acquire)) {
+        return nullptr;
+    }
+    spinlock_acq_t acq(&arena->lock);
+    std::vector<void *> *list = &arena->free_lists[size_class(aligned_size)];
+    if (!list->empty()) {
+        void *buf = list->back();
+        list->pop_back();
+        return buf;
+    }
+    if (static_cast<size_t>(arena->end - arena->next) < aligned_size) {
+        return nullptr;
+    }
+    void *buf = arena->next;
+    arena->next += aligned_size;
+    get_pool_stats()->pm_huge_page_bytes += aligned_size;
+    return buf;
+}
+
+// Frees a buffer that the pool doesn't keep, which might have come from the arena.
+// Buffers bigger than MAX_POOLED_SIZE never do.
+void free_buffer(void *buf, size_t aligned_size) {
+    huge_page_arena_t *arena = &huge_page_arena;
+    if (arena->contains(buf)) {
+        spinlock_acq_t acq(&arena->lock);
+        arena->free_lists[size_class(aligned_size)].push_back(buf);
+    } else {
+        raw_free_aligned(buf);
+    }
+}
+
+struct free_lists_t {
+    free_lists_t() { }
+    ~free_lists_t() {
+        for (size_t i = 0; i < NUM_SIZE_CLASSES; ++i) {
+            for (void *buf : lists[i]) {
+                free_buffer(buf, (i + 1) * DEVICE_BLOCK_SIZE);
+            }
+        }
+    }
+
+    std::vector<void *> lists[NUM_SIZE_CLASSES];
+
+    DISABLE_COPYING(free_lists_t);
+};
+
+std::array<cache_line_padded_t<free_lists_t>, MAX_THREADS> thread_free_lists;
+
+// How many bytes of buffers the thread free lists and the depots keep in total.
+std::atomic<size_t> pooled_bytes(0);
+
+// Makes room for a buffer of `aligned_size` bytes in the free lists.  Returns false
+// if the pool already keeps MAX_POOLED_BYTES.
+bool reserve_pooled_bytes(size_t aligned_size) {
+    size_t cur = pooled_bytes.load(std::memory_order_relaxed);
+    do {
+        if (cur + aligned_size > MAX_POOLED_BYTES) {
+            return false;
+        }
+    } while (!pooled_bytes.compare_exchange_weak(cur, cur + aligned_size,
+                                                 std::memory_order_relaxed));
+    return true;
+}
+
+// There is a depot per NUMA node, so that buffers stay on the node of the threads
+// that first touched them.
+struct depot_t {
+    spinlock_t lock;
+    free_lists_t free_lists;
+};
+
+std::array<cache_line_padded_t<depot_t>, MAX_NUMA_NODES> depots;
+
+depot_t *thread_depot() {
+    return &depots[get_thread_numa_node(get_thread_id())].value;
+}
+
+size_t thread_capacity(size_t aligned_size) {
+    return std::max<size_t>(2, THREAD_FREE_LIST_BYTES / aligned_size);
+}
+
+size_t depot_capacity(size_t aligned_size) {
+    return std::max<size_t>(2, DEPOT_FREE_LIST_BYTES / aligned_size);
+}
+
+// Moves up to `count` buffers from the back of `from` to `to`.
+void move_buffers(std::vector<void *> *from, std::vector<void *> *to, size_t count) {
+    count = std::min(count, from->size());
+    to->insert(to->end(), from->end() - count, from->end());
+    from->resize(from->size() - count);
+}
+
+// Returns the free list of the calling thread for buffers of `aligned_size` bytes,
+// or null if they aren't pooled.
+std::vector<void *> *thread_free_list(size_t aligned_size) {
+    guarantee(aligned_size > 0 && divides(DEVICE_BLOCK_SIZE, aligned_size));
+    // Blocker pool threads and threads outside the thread pool don't get a pool.
+    const int thread = get_thread_id().threadnum;
+    if (aligned_size > MAX_POOLED_SIZE || thread < 0) {
+        return nullptr;
+    }
+    rassert(thread < MAX_THREADS);
+    return &thread_free_lists[thread].value.lists[size_class(aligned_size)];
+}
+
+// Maps `size` bytes that start on a huge page boundary, or returns null.
+char *map_huge_page_arena(huge_page_mode_t mode, size_t size) {
+#ifdef __linux__
+    if (mode == huge_page_mode_t::hugetlb) {
+        // The kernel aligns hugetlb mappings for us.  We don't pass MAP_NORESERVE,
+        // so that this fails right away if there aren't enough huge pages, instead of
+        // crashing with SIGBUS once the in-use part of the arena grows beyond them.
+        void *mem = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        return mem == MAP_FAILED ? nullptr : static_cast<char *>(mem);
+    }
+    // Transparent huge pages only back the mapping where it's aligned to them.
+    void *mem = mmap(nullptr, size + HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (mem == MAP_FAILED) {
+        return nullptr;
+    }
+    char *begin = reinterpret_cast<char *>(
+        ceil_aligned(reinterpret_cast<uintptr_t>(mem), HUGE_PAGE_SIZE));
+    if (madvise(begin, size, MADV_HUGEPAGE) != 0) {
+        logWRN("The kernel doesn't support transparent huge pages (errno %d), so the "
+               "cache isn't going to use them.", get_errno());
+        munmap(mem, size + HUGE_PAGE_SIZE);
+        return nullptr;
+    }
+    return begin;
+#else
+    (void)mode;
+    (void)size;
+    return nullptr;
+#endif
+}
+
+}  // namespace
+
+bool ser_buffer_pool_enable_huge_pages(huge_page_mode_t mode, size_t size) {
+    huge_page_arena_t *arena = &huge_page_arena;
+    guarantee(!arena->enabled.load(std::memory_order_acquire));
+    if (mode == huge_page_mode_t::none || size == 0) {
+        return false;
+    }
+    size = ceil_aligned(size, HUGE_PAGE_SIZE);
+    char *begin = map_huge_page_arena(mode, size);
+    if (begin == nullptr && mode == huge_page_mode_t::hugetlb) {
+        const int errsv = get_errno();
+        logWRN("Failed to reserve %zu MB of explicit huge pages for the cache (errno "
+               "%d), falling back to transparent huge pages.  Check "
+               "/proc/sys/vm/nr_hugepages.", static_cast<size_t>(size / MEGABYTE), errsv);
+        mode = huge_page_mode_t::transparent;
+        begin = map_huge_page_arena(mode, size);
+    }
+    if (begin == nullptr) {
+        return false;
+    }
+    arena->mode = mode;
+    arena->begin = begin;
+    arena->end = begin + size;
+    arena->next = begin;
+    arena->enabled.store(true, std::memory_order_release);
+    return true;
+}
+
+huge_page_usage_t ser_buffer_pool_huge_page_usage() {
+    huge_page_arena_t *arena = &huge_page_arena;
+    huge_page_usage_t ret;
+    if (!arena->enabled.load(std::memory_order_acquire)) {
+        ret.mode = huge_page_mode_t::none;
+        ret.arena_size = 0;
+        ret.used_size = 0;
+        return ret;
+    }
+    spinlock_acq_t acq(&arena->lock);
+    ret.mode = arena->mode;
+    ret.arena_size = arena->end - arena->begin;
+    ret.used_size = arena->next - arena->begin;
+    return ret;
+}
+
+scoped_device_block_aligned_ptr_t<ser_buffer_t>
+ser_buffer_pool_alloc(size_t aligned_size) {
+    track_memory(memory_tag_t::page_cache, aligned_size);
+    scoped_device_block_aligned_ptr_t<ser_buffer_t> ret;
+    std::vector<void *> *list = thread_free_list(aligned_size);
+    if (list == nullptr) {
+        ret = scoped_device_block_aligned_ptr_t<ser_buffer_t>(aligned_size);
+        return ret;
+    }
+
+    if (list->empty()) {
+        depot_t *depot = thread_depot();
+        spinlock_acq_t acq(&depot->lock);
+        move_buffers(&depot->free_lists.lists[size_class(aligned_size)], list,
+                     thread_capacity(aligned_size) / 2);
+    }
+
+    if (list->empty()) {
+        ++get_pool_stats()->pm_misses;
+        void *buf = huge_page_arena_alloc(aligned_size);
+        if (buf != nullptr) {
+            ret.init(static_cast<ser_buffer_t *>(buf));
+        } else {
+            ret = scoped_device_block_aligned_ptr_t<ser_buffer_t>(aligned_size);
+        }
+    } else {
+        ++get_pool_stats()->pm_hits;
+        ret.init(static_cast<ser_buffer_t *>(list->back()));
+        list->pop_back();
+        pooled_bytes.fetch_sub(aligned_size, std::memory_order_relaxed);
+    }
+    return ret;
+}
+
+void ser_buffer_pool_free(scoped_device_block_aligned_ptr_t<ser_buffer_t> &&buf,
+                          size_t aligned_size) {
+    if (!buf.has()) {
+        return;
+    }
+    track_memory(memory_tag_t::page_cache, -static_cast<int64_t>(aligned_size));
+    std::vector<void *> *list = thread_free_list(aligned_size);
+    if (list == nullptr) {
+        // Non-pool threads can still free buffers that came from the arena.
+        free_buffer(buf.release(), aligned_size);
+        return;
+    }
+
+    if (list->size() >= thread_capacity(aligned_size)) {
+        std::vector<void *> surplus;
+        move_buffers(list, &surplus, list->size() / 2);
+        {
+            depot_t *depot = thread_depot();
+            spinlock_acq_t acq(&depot->lock);
+            std::vector<void *> *depot_list
+                = &depot->free_lists.lists[size_class(aligned_size)];
+            const size_t room = depot_capacity(aligned_size)
+                - std::min(depot_capacity(aligned_size), depot_list->size());
+            move_buffers(&surplus, depot_list, room);
+        }
+        // Whatever didn't fit into the depot goes back to the allocator, or the
+        // arena.
+        for (void *surplus_buf : surplus) {
+            free_buffer(surplus_buf, aligned_size);
+        }
+        pooled_bytes.fetch_sub(surplus.size() * aligned_size,
+                               std::memory_order_relaxed);
+    }
+    if (!reserve_pooled_bytes(aligned_size)) {
+        free_buffer(buf.release(), aligned_size);
+        return;
+    }
+    list->push_back(buf.release());
+}
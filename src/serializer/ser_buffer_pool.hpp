@@ -0,0 +1,61 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#ifndef SERIALIZER_SER_BUFFER_POOL_HPP_
+#define SERIALIZER_SER_BUFFER_POOL_HPP_
+
+#include <stddef.h>
+
+#include "containers/scoped.hpp"
+#include "serializer/types.hpp"
+
+// A pool of DEVICE_BLOCK_SIZE-aligned block buffers, so that reading blocks in and
+// evicting them again doesn't keep going through the allocator.  `buf_ptr_t` gets
+// its buffers from here, which covers both the serializer's read path and the
+// pages that the cache loads and copies.
+//
+// Buffers are kept by their aligned size, so the buffers of blocks of the usual
+// (maximum) block size all end up in the same size class.  Every thread has its own
+// free lists.  Since blocks are typically read on the serializer's thread and freed
+// on the cache's thread, threads hand batches of surplus buffers to a depot shared by
+// the threads on their NUMA node, which threads that run out of buffers take them
+// from.  The free lists together never keep more than a fixed number of bytes,
+// since the buffers in them don't count towards the cache size.
+//
+// When huge pages are enabled, the pool carves the buffers it doesn't have yet out of
+// one big arena backed by 2MB pages, instead of allocating every one of them, so
+// that the cache takes fewer TLB misses.  Buffers from the pool must therefore go
+// back to it through `ser_buffer_pool_free`, never through `raw_free_aligned`.
+
+enum class huge_page_mode_t {
+    none,
+    // Transparent huge pages, which the kernel may or may not back the arena with.
+    transparent,
+    // Explicit huge pages that have to be set aside with vm.nr_hugepages.
+    hugetlb
+};
+
+// Reserves an arena of `size` bytes (rounded up to a multiple of the huge page size)
+// for the pool's buffers.  If explicit huge pages aren't available, this falls back
+// to transparent ones.  Once the arena is used up, buffers come from the allocator
+// again.  Returns false if it couldn't reserve the arena.  Must be called at most
+// once, before the pool is used.
+bool ser_buffer_pool_enable_huge_pages(huge_page_mode_t mode, size_t size);
+
+struct huge_page_usage_t {
+    // `none` if huge pages aren't enabled.
+    huge_page_mode_t mode;
+    size_t arena_size;
+    // How much of the arena has been handed out as buffers so far.
+    size_t used_size;
+};
+
+huge_page_usage_t ser_buffer_pool_huge_page_usage();
+
+// `aligned_size` must be a multiple of DEVICE_BLOCK_SIZE.
+scoped_device_block_aligned_ptr_t<ser_buffer_t>
+ser_buffer_pool_alloc(size_t aligned_size);
+
+// Gives `buf`, which has `aligned_size` bytes, back to the pool.
+void ser_buffer_pool_free(scoped_device_block_aligned_ptr_t<ser_buffer_t> &&buf,
+                          size_t aligned_size);
+
+#endif  // SERIALIZER_SER_BUFFER_POOL_HPP_
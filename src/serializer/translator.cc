@@ -235,8 +235,9 @@ translator_serializer_t::translator_serializer_t(serializer_t *_inner, int _mod_
     rassert(mod_id < mod_count);
 }
 
-file_account_t *translator_serializer_t::make_io_account(int priority, int outstanding_requests_limit) {
-    return inner->make_io_account(priority, outstanding_requests_limit);
+file_account_t *translator_serializer_t::make_io_account(
+        int priority, io_caller_t caller, int outstanding_requests_limit) {
+    return inner->make_io_account(priority, caller, outstanding_requests_limit);
 }
 
 void translator_serializer_t::index_write(
@@ -259,7 +260,8 @@ translator_serializer_t::block_writes(const buf_write_info_t *write_infos, size_
         const buf_write_info_t *info = &write_infos[i];
         guarantee(info->block_id != NULL_BLOCK_ID);
         tmp.push_back(buf_write_info_t(info->buf, info->block_size,
-                                       translate_block_id(info->block_id)));
+                                       translate_block_id(info->block_id),
+                                       info->recency));
     }
 
     return inner->block_writes(tmp.data(), tmp.size(), io_account, cb);
@@ -12,6 +12,7 @@
 #include "containers/counted.hpp"
 #include "containers/scoped.hpp"
 #include "errors.hpp"
+#include "repli_timestamp.hpp"
 #include "serializer/checksum.hpp"
 #include "valgrind.hpp"
 
@@ -127,8 +128,6 @@ private:
         : block_size_t(ser_bs) { }
 };
 
-class repli_timestamp_t;
-
 class log_serializer_t;
 
 class block_token_t {
@@ -146,14 +145,21 @@ private:
 
     block_token_t(log_serializer_t *serializer,
                   int64_t initial_offset,
-                  block_size_t initial_ser_block_size);
+                  block_size_t initial_ser_block_size,
+                  block_size_t initial_disk_block_size);
 
     log_serializer_t *const serializer_;
     std::atomic<intptr_t> ref_count_;
 
-    // The block's size.
+    // The block's size, as seen by users of the serializer.
     block_size_t block_size_;
 
+    // The size the block takes up on disk.  This is the same as block_size_ unless
+    // the block was written compressed.
+    block_size_t disk_block_size_;
+
+    bool is_compressed() const { return disk_block_size_ != block_size_; }
+
     // Either (a.) a checksum of what the block's on-disk contents should be, (b.)(i.)
     // the value datasync_checksum(), which means the block's write has been datasynced,
     // or (b.)(ii.) the value no_checksum(), which means the block is not known to have
@@ -216,11 +222,16 @@ public:
 
 struct buf_write_info_t {
     buf_write_info_t(ser_buffer_t *_buf, block_size_t _block_size,
-                     block_id_t _block_id)
-        : buf(_buf), block_size(_block_size), block_id(_block_id) { }
+                     block_id_t _block_id,
+                     repli_timestamp_t _recency = repli_timestamp_t::invalid)
+        : buf(_buf), block_size(_block_size), block_id(_block_id),
+          recency(_recency) { }
     ser_buffer_t *buf;
     block_size_t block_size;
     block_id_t block_id;
+    // The recency the block is going to get in the index, or `invalid` if the
+    // writer doesn't know.  The serializer uses it to keep cold blocks together.
+    repli_timestamp_t recency;
 };
 
 void debug_print(printf_buffer_t *buf, const buf_write_info_t &info);
@@ -1,6 +1,10 @@
 #ifndef STORE_SUBVIEW_HPP_
 #define STORE_SUBVIEW_HPP_
 
+#include <algorithm>
+#include <string>
+#include <vector>
+
 #include "store_view.hpp"
 
 /* The query-routing logic provides the following ordering guarantees:
@@ -184,6 +188,25 @@ public:
         store_view->reset_data(zero_version, subregion, durability, interruptor);
     }
 
+    void get_expired_keys(
+            const std::string &sindex,
+            double cutoff,
+            size_t max_keys,
+            std::vector<store_key_t> *keys_out,
+            signal_t *interruptor)
+            THROWS_ONLY(interrupted_exc_t) {
+        home_thread_mixin_t::assert_thread();
+        store_view->get_expired_keys(sindex, cutoff, max_keys, keys_out, interruptor);
+        /* The index covers the whole underlying store, so drop the keys that are
+        outside of our region. */
+        keys_out->erase(
+            std::remove_if(keys_out->begin(), keys_out->end(),
+                [&](const store_key_t &key) {
+                    return !region_contains_key(get_region(), key);
+                }),
+            keys_out->end());
+    }
+
 private:
     store_view_t *store_view;
 
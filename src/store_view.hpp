@@ -249,6 +249,18 @@ public:
             signal_t *interruptor)
             THROWS_ONLY(interrupted_exc_t) = 0;
 
+    /* Collects the primary keys of up to `max_keys` rows that the secondary index
+    `sindex` maps to a time before `cutoff` (in seconds since the epoch), oldest first.
+    This only reads the local copy, and finds nothing if the index doesn't exist here
+    or isn't ready yet. The TTL sweep uses it to choose the rows to expire. */
+    virtual void get_expired_keys(
+            const std::string &sindex,
+            double cutoff,
+            size_t max_keys,
+            std::vector<store_key_t> *keys_out,
+            signal_t *interruptor)
+            THROWS_ONLY(interrupted_exc_t) = 0;
+
 protected:
     explicit store_view_t(region_t r) : region(r) { }
 
@@ -1,6 +1,7 @@
 #include "threading.hpp"
 
 #include "arch/runtime/coroutines.hpp"
+#include "arch/runtime/numa.hpp"
 #include "arch/runtime/runtime.hpp"
 #include "errors.hpp"
 
@@ -64,11 +65,25 @@ thread_allocator_t::~thread_allocator_t() {
 }
 
 thread_allocation_t::thread_allocation_t(thread_allocator_t *p)
+    : thread_allocation_t(p, -1) { }
+
+thread_allocation_t::thread_allocation_t(thread_allocator_t *p, int numa_node)
     : thread(0), /* temporary, will be overwritten below */
       parent(p) {
     parent->assert_thread();
-    int32_t best_thread = 0;
-    for (int32_t i = 1; static_cast<size_t>(i) < parent->num_allocated.size(); ++i) {
+    std::vector<int32_t> candidates;
+    for (int32_t i = 0; static_cast<size_t>(i) < parent->num_allocated.size(); ++i) {
+        if (numa_node == -1 || get_thread_numa_node(threadnum_t(i)) == numa_node) {
+            candidates.push_back(i);
+        }
+    }
+    if (candidates.empty()) {
+        for (int32_t i = 0; static_cast<size_t>(i) < parent->num_allocated.size(); ++i) {
+            candidates.push_back(i);
+        }
+    }
+    int32_t best_thread = candidates[0];
+    for (int32_t i : candidates) {
         if (parent->num_allocated[i] < parent->num_allocated[best_thread]) {
             best_thread = i;
         } else if (parent->num_allocated[i] == parent->num_allocated[best_thread] &&
@@ -111,6 +111,9 @@ private:
 class thread_allocation_t {
 public:
     explicit thread_allocation_t(thread_allocator_t *p);
+    // Only picks among the threads on NUMA node `numa_node`, as long as there are
+    // any, so that allocations that work together can share a node.
+    thread_allocation_t(thread_allocator_t *p, int numa_node);
     ~thread_allocation_t();
     threadnum_t get_thread() const;
 private:
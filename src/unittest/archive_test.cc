@@ -13,7 +13,7 @@ void dump_to_string(write_message_t *wm, std::string *out) {
 
     out->clear();
     for (write_buffer_t *p = buffers->head(); p; p = buffers->next(p)) {
-        out->append(p->data, p->data + p->size);
+        out->append(p->contents(), p->size);
     }
 }
 
@@ -34,6 +34,23 @@ TEST(WriteMessageTest, Variant) {
     ASSERT_EQ(15u, s.size());
 }
 
+TEST(WriteMessageTest, AppendAndClear) {
+    write_message_t wm;
+    wm.append("abc", 3);
+    write_message_t other;
+    other.append("de", 2);
+    wm.append_and_clear(&other);
+    ASSERT_EQ(0u, other.size());
+
+    // Appending after the moved buffers must not write into them.
+    wm.append("f", 1);
+    std::string s;
+    dump_to_string(&wm, &s);
+    ASSERT_EQ("abcdef", s);
+    dump_to_string(&other, &s);
+    ASSERT_EQ("", s);
+}
+
 
 
 }  // namespace unittest
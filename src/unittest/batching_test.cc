@@ -0,0 +1,29 @@
+// Copyright 2010-2015 RethinkDB, all rights reserved.
+#include "rdb_protocol/batching.hpp"
+#include "rdb_protocol/datum.hpp"
+#include "unittest/gtest.hpp"
+
+namespace unittest {
+
+int64_t batch_size(const ql::batchspec_t &batchspec) {
+    ql::batcher_t batcher = batchspec.to_batcher();
+    int64_t size = 0;
+    do {
+        ++size;
+    } while (!batcher.note_el(ql::datum_t(1.0)) && size < 1000);
+    return size;
+}
+
+TEST(BatchingTest, SlowStart) {
+    ql::batchspec_t normal =
+        ql::batchspec_t::default_for(ql::batch_type_t::NORMAL).with_at_most(64);
+    ql::batchspec_t first =
+        ql::batchspec_t::default_for(ql::batch_type_t::NORMAL_FIRST).with_at_most(64);
+    ASSERT_EQ(16, batch_size(first));
+    ASSERT_EQ(32, batch_size(normal.with_slow_start(1)));
+    ASSERT_EQ(64, batch_size(normal.with_slow_start(2)));
+    ASSERT_EQ(64, batch_size(normal.with_slow_start(100)));
+    ASSERT_EQ(64, batch_size(normal));
+}
+
+}  // namespace unittest
@@ -2,6 +2,9 @@
 
 #include "arch/io/disk.hpp"
 #include "arch/types.hpp"
+#include "btree/compaction.hpp"
+#include "btree/concurrent_traversal.hpp"
+#include "btree/get_distribution.hpp"
 #include "btree/reql_specific.hpp"
 #include "buffer_cache/cache_balancer.hpp"
 #include "rdb_protocol/btree.hpp"
@@ -36,6 +39,29 @@ private:
     scoped_ptr_t<store_key_t> last_key;
 };
 
+// Collects the keys in the order in which they get exclusive access, and stops the
+// traversal once it has `limit` of them.
+class key_collector_callback_t : public concurrent_traversal_callback_t {
+public:
+    key_collector_callback_t(size_t limit, std::vector<store_key_t> *keys_out)
+        : limit_(limit), keys_out_(keys_out) { }
+
+    continue_bool_t handle_pair(scoped_key_value_t &&keyvalue,
+                                concurrent_traversal_fifo_enforcer_signal_t waiter)
+            THROWS_ONLY(interrupted_exc_t) {
+        store_key_t key(keyvalue.key());
+        keyvalue.reset();
+        waiter.wait_interruptible();
+        keys_out_->push_back(key);
+        return keys_out_->size() < limit_
+            ? continue_bool_t::CONTINUE : continue_bool_t::ABORT;
+    }
+
+private:
+    const size_t limit_;
+    std::vector<store_key_t> *keys_out_;
+};
+
 class BTreeTestContext {
 public:
     BTreeTestContext()
@@ -214,6 +240,38 @@ public:
         remove(key, repli_timestamp_t::distant_past);
     }
 
+    // Reads the population from the stat block of a snapshot of the tree that is
+    // taken before `fn` runs.
+    int64_t snapshotted_population(const std::function<void()> &fn) {
+        scoped_ptr_t<txn_t> txn;
+        scoped_ptr_t<real_superblock_t> superblock;
+        get_btree_superblock_and_txn_for_reading(
+            cache_conn.get(), CACHE_SNAPSHOTTED_YES, &superblock, &txn);
+        fn();
+        int64_t population = -1;
+        EXPECT_TRUE(get_btree_population(superblock.get(), &population));
+        return population;
+    }
+
+    // Compacts the cold leaves in `_range`, and then merges the ones that are
+    // underfull afterwards.  Returns how many of them were.
+    size_t compact(const key_range_t &_range, repli_timestamp_t cold_before) {
+        std::vector<store_key_t> underfull_keys;
+        run_txn_fn(true, [&](scoped_ptr_t<real_superblock_t> &&superblock){
+            cond_t non_interruptor;
+            btree_compact_cold_leaves(sizer.get(), superblock.get(), _range,
+                                      cold_before, &underfull_keys, &non_interruptor);
+        });
+        for (const store_key_t &key : underfull_keys) {
+            run_txn_fn(true, [&](scoped_ptr_t<real_superblock_t> &&superblock){
+                noop_value_deleter_t deleter;
+                btree_merge_underfull_leaf(sizer.get(), superblock.get(),
+                                           key.btree_key(), &deleter);
+            });
+        }
+        return underfull_keys.size();
+    }
+
     void range(const key_range_t &_range) {
         std::map<store_key_t, std::string> bt_map;
 
@@ -243,6 +301,36 @@ public:
         expect_maps_equal(bt_map, kv_map);
     }
 
+    // Checks that a concurrent traversal of `_range` sees the keys in order, and that
+    // it stops right after the pair that aborts it.
+    void concurrent_range(const key_range_t &_range, direction_t direction,
+                          int scan_concurrency, size_t limit) {
+        std::vector<store_key_t> bt_keys;
+        continue_bool_t cont;
+        run_txn_fn(false, [&](scoped_ptr_t<real_superblock_t> &&superblock){
+            key_collector_callback_t collector(limit, &bt_keys);
+            cont = btree_concurrent_traversal(superblock.get(), _range, &collector,
+                                              direction, release_superblock_t::RELEASE,
+                                              scan_concurrency);
+        });
+
+        std::vector<store_key_t> kv_keys;
+        for (const auto &pair : kv) {
+            if (_range.contains_key(pair.first)) {
+                kv_keys.push_back(pair.first);
+            }
+        }
+        if (direction == direction_t::BACKWARD) {
+            std::reverse(kv_keys.begin(), kv_keys.end());
+        }
+        const bool aborted = kv_keys.size() >= limit;
+        if (aborted) {
+            kv_keys.resize(limit);
+        }
+        EXPECT_EQ(aborted ? continue_bool_t::ABORT : continue_bool_t::CONTINUE, cont);
+        EXPECT_TRUE(kv_keys == bt_keys);
+    }
+
     bool should_have(const store_key_t &key) {
         return kv.find(key) != kv.end();
     }
@@ -507,4 +595,77 @@ TPTEST(BTree, RemoveRandomOrder) {
     ctx.verify();
 }
 
+TPTEST(BTree, CompactColdLeaves) {
+    BTreeTestContext ctx;
+    rng_t rng;
+    const repli_timestamp_t written = repli_timestamp_t::distant_past.next();
+    const repli_timestamp_t removed = written.next();
+    const repli_timestamp_t cold = removed.next();
+
+    for (int i = 0; i < 2000; i++) {
+        ctx.set(store_key_t(random_letter_string(&rng, 1, 250)),
+                random_letter_string(&rng, 0, 250), written);
+    }
+    // This leaves deletion entries behind.
+    for (int i = 0; i < 1600; i++) {
+        ctx.remove(ctx.pick_random_key(&rng), removed);
+    }
+    ctx.verify();
+
+    // None of the leaves are cold yet.
+    EXPECT_EQ(0u, ctx.compact(key_range_t::universe(), written));
+    ctx.verify();
+
+    ctx.compact(random_key_range(&rng), cold);
+    ctx.verify();
+    ctx.compact(key_range_t::universe(), cold);
+    ctx.verify();
+
+    for (int i = 0; i < 100; i++) {
+        ctx.get(ctx.pick_random_key(&rng));
+        ctx.range(random_key_range(&rng));
+    }
+    while (!ctx.is_empty()) {
+        ctx.remove(ctx.pick_random_key(&rng), cold.next());
+    }
+    ctx.verify();
+}
+
+TPTEST(BTree, PopulationFromSnapshot) {
+    BTreeTestContext ctx;
+    ctx.set(store_key_t("a"), "1");
+    ctx.set(store_key_t("b"), "2");
+
+    // The writes after the snapshot mustn't show up in its count.
+    EXPECT_EQ(2, ctx.snapshotted_population([&]() {
+        ctx.set(store_key_t("c"), "3");
+        ctx.remove(store_key_t("a"));
+        ctx.remove(store_key_t("b"));
+    }));
+    EXPECT_EQ(1, ctx.snapshotted_population([]() { }));
+}
+
+TPTEST(BTree, ConcurrentSubrangeTraversal) {
+    BTreeTestContext ctx;
+    rng_t rng;
+
+    // Enough pairs for the root to have plenty of children.
+    for (int i = 0; i < 5000; i++) {
+        ctx.set(store_key_t(random_letter_string(&rng, 1, 250)),
+                random_letter_string(&rng, 0, 250));
+    }
+    ctx.verify();
+
+    for (int i = 0; i < 50; i++) {
+        const key_range_t range
+            = i == 0 ? key_range_t::universe() : random_key_range(&rng);
+        const direction_t direction
+            = rng.randint(2) == 0 ? direction_t::FORWARD : direction_t::BACKWARD;
+        const size_t limit = rng.randint(2) == 0 ? SIZE_MAX : 1 + rng.randint(200);
+        ctx.concurrent_range(range, direction, 1, limit);
+        ctx.concurrent_range(range, direction, 4, limit);
+        ctx.concurrent_range(range, direction, 100, limit);
+    }
+}
+
 } // namespace unittest
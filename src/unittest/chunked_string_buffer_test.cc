@@ -0,0 +1,73 @@
+// Copyright 2010-2015 RethinkDB, all rights reserved.
+#include "unittest/gtest.hpp"
+
+#include "containers/chunked_string_buffer.hpp"
+#include "rapidjson/stringbuffer.h"
+#include "rapidjson/writer.h"
+
+namespace unittest {
+
+std::string chunked_contents(chunked_string_buffer_t *buf) {
+    std::string ret;
+    for (size_t i = 0; i < buf->num_chunks(); ++i) {
+        ret.append(buf->chunk_data(i), buf->chunk_size(i));
+    }
+    return ret;
+}
+
+TEST(ChunkedStringBufferTest, PutAndPop) {
+    chunked_string_buffer_t buf(4);
+    ASSERT_EQ(0u, buf.GetSize());
+    ASSERT_EQ(0u, buf.num_chunks());
+
+    const std::string str = "abcdefghij";
+    for (char c : str) {
+        buf.Put(c);
+    }
+    ASSERT_EQ(str.size(), buf.GetSize());
+    ASSERT_EQ(3u, buf.num_chunks());
+    ASSERT_EQ(str, chunked_contents(&buf));
+
+    // Pop within the last chunk, then across chunk boundaries.
+    buf.Pop(1);
+    ASSERT_EQ("abcdefghi", chunked_contents(&buf));
+    buf.Pop(1);
+    ASSERT_EQ("abcdefgh", chunked_contents(&buf));
+    ASSERT_EQ(2u, buf.num_chunks());
+    buf.Pop(5);
+    ASSERT_EQ("abc", chunked_contents(&buf));
+    ASSERT_EQ(1u, buf.num_chunks());
+
+    buf.Put('x');
+    buf.Put('y');
+    ASSERT_EQ("abcxy", chunked_contents(&buf));
+    ASSERT_EQ(5u, buf.GetSize());
+
+    buf.Pop(5);
+    ASSERT_EQ(0u, buf.GetSize());
+    ASSERT_EQ(0u, buf.num_chunks());
+}
+
+TEST(ChunkedStringBufferTest, MatchesStringBuffer) {
+    chunked_string_buffer_t chunked(7);
+    rapidjson::StringBuffer contiguous;
+    rapidjson::Writer<chunked_string_buffer_t> chunked_writer(chunked);
+    rapidjson::Writer<rapidjson::StringBuffer> contiguous_writer(contiguous);
+
+    chunked_writer.StartArray();
+    contiguous_writer.StartArray();
+    for (int i = 0; i < 100; ++i) {
+        chunked_writer.Int(i);
+        contiguous_writer.Int(i);
+        chunked_writer.String("a string");
+        contiguous_writer.String("a string");
+    }
+    chunked_writer.EndArray();
+    contiguous_writer.EndArray();
+
+    ASSERT_EQ(contiguous.GetSize(), chunked.GetSize());
+    ASSERT_EQ(std::string(contiguous.GetString(), contiguous.GetSize()),
+              chunked_contents(&chunked));
+}
+
+}  // namespace unittest
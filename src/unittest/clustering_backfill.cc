@@ -153,4 +153,51 @@ TPTEST(ClusteringBackfill, BackfillTest) {
     //EXPECT_EQ(timestamp, backfillee_metadata[0].second.timestamp);
 }
 
+TEST(ClusteringBackfill, CompressedItemSeq) {
+    backfill_item_seq_t<backfill_item_t> seq(
+        0, HASH_REGION_HASH_SIZE, key_range_t::right_bound_t(store_key_t()));
+    backfill_item_t item;
+    item.range = key_range_t(key_range_t::closed, store_key_t("a"),
+                             key_range_t::open, store_key_t("z"));
+    item.min_deletion_timestamp = repli_timestamp_t::distant_past;
+    for (char c = 'a'; c < 'z'; ++c) {
+        backfill_item_t::pair_t pair;
+        pair.key = store_key_t(std::string(1, c));
+        pair.recency = repli_timestamp_t::distant_past;
+        pair.value.set(std::vector<char>(1000, c));
+        item.pairs.push_back(std::move(pair));
+    }
+    seq.push_back(std::move(item));
+
+    for (bool compress : {false, true}) {
+        compressed_backfill_item_seq_t packed(seq, compress);
+        ASSERT_EQ(compress, packed.is_compressed());
+        if (compress) {
+            ASSERT_LT(packed.get_data_size(), seq.get_mem_size() / 10);
+        }
+        backfill_item_seq_t<backfill_item_t> unpacked = packed.decompress();
+        ASSERT_EQ(seq.get_region(), unpacked.get_region());
+        ASSERT_EQ(seq.get_mem_size(), unpacked.get_mem_size());
+        ASSERT_EQ(seq.begin()->pairs.size(), unpacked.begin()->pairs.size());
+        ASSERT_EQ(*seq.begin()->pairs.back().value,
+                  *unpacked.begin()->pairs.back().value);
+    }
+}
+
+TEST(ClusteringBackfill, PreItemMaskDropsHash) {
+    backfill_pre_item_t pre_item;
+    pre_item.range = key_range_t(key_range_t::closed, store_key_t("a"),
+                                 key_range_t::open, store_key_t("z"));
+    pre_item.content_hash.set(std::string(32, 'x'));
+
+    /* Masking with a superset doesn't change the range, so the hash stays valid */
+    pre_item.mask_in_place(key_range_t::universe());
+    ASSERT_TRUE(static_cast<bool>(pre_item.content_hash));
+
+    pre_item.mask_in_place(key_range_t(key_range_t::closed, store_key_t("m"),
+                                       key_range_t::none, store_key_t()));
+    ASSERT_FALSE(static_cast<bool>(pre_item.content_hash));
+    ASSERT_EQ(store_key_t("m"), pre_item.range.left);
+}
+
 }   /* namespace unittest */
@@ -188,4 +188,78 @@ TPTEST(ClusteringBranch, Backfill) {
     run_with_primary(&run_backfill_test);
 }
 
+/* The `LeaseRead` test checks that once a secondary holds a read lease, every write is
+visible on it by the time the write is acked by anyone. */
+
+void run_lease_read_test(
+        simple_mailbox_cluster_t *cluster,
+        primary_dispatcher_t *dispatcher,
+        UNUSED mock_store_t *store1,
+        local_replicator_t *local_replicator,
+        order_source_t *order_source) {
+    remote_replicator_server_t remote_replicator_server(
+        cluster->get_mailbox_manager(),
+        dispatcher);
+
+    standard_backfill_throttler_t backfill_throttler;
+    backfill_progress_tracker_t backfill_progress_tracker;
+    mock_store_t store2((binary_blob_t(version_t::zero())));
+    in_memory_branch_history_manager_t bhm2;
+    cond_t interruptor;
+    remote_replicator_client_t remote_replicator_client(
+        &backfill_throttler,
+        backfill_config_t(),
+        &backfill_progress_tracker,
+        cluster->get_mailbox_manager(),
+        server_id_t::generate_server_id(),
+        backfill_throttler_t::priority_t::critical_t::NO,
+        dispatcher->get_branch_id(),
+        remote_replicator_server.get_bcard(),
+        local_replicator->get_replica_bcard(),
+        server_id_t::generate_server_id(),
+        &store2,
+        &bhm2,
+        &interruptor);
+
+    /* The first lease read asks for a lease, but can't use it yet. */
+    read_response_t response;
+    EXPECT_FALSE(remote_replicator_client.lease_read(
+        mock_read("a"), &response, &interruptor));
+    int attempts = 0;
+    while (!remote_replicator_client.lease_read(
+            mock_read("a"), &response, &interruptor)) {
+        ASSERT_LT(++attempts, 100);
+        nap(10);
+    }
+
+    class first_ack_callback_t : public primary_dispatcher_t::write_callback_t {
+    public:
+        write_durability_t get_default_write_durability() {
+            return write_durability_t::SOFT;
+        }
+        void on_ack(const server_id_t &, write_response_t &&) {
+            acked.pulse_if_not_already_pulsed();
+        }
+        void on_end() {
+            ended.pulse();
+        }
+        cond_t acked, ended;
+    };
+    for (int i = 0; i < 10; ++i) {
+        first_ack_callback_t write_callback;
+        dispatcher->spawn_write(
+            mock_overwrite("a", strprintf("%d", i)),
+            order_source->check_in("run_lease_read_test(write)"),
+            &write_callback);
+        write_callback.acked.wait_lazily_unordered();
+        ASSERT_TRUE(remote_replicator_client.lease_read(
+            mock_read("a"), &response, &interruptor));
+        EXPECT_EQ(strprintf("%d", i), mock_parse_read_response(response));
+        write_callback.ended.wait_lazily_unordered();
+    }
+}
+TPTEST(ClusteringBranch, LeaseRead) {
+    run_with_primary(&run_lease_read_test);
+}
+
 }   /* namespace unittest */
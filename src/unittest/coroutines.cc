@@ -1,5 +1,6 @@
 // Copyright 2010-2015 RethinkDB, all rights reserved.
 
+#include "arch/runtime/coro_sampler.hpp"
 #include "arch/runtime/coroutines.hpp"
 #include "arch/runtime/runtime.hpp"
 #include "concurrency/auto_drainer.hpp"
@@ -106,9 +107,60 @@ TEST(CoroutinesTest, NotifyNow) {
     });
 }
 
+TEST(CoroutinesTest, SamplesWaits) {
+    run_in_thread_pool([&]() {
+        coro_sampler_t *sampler = &coro_sampler_t::get_global_sampler();
+        sampler->reset();
+        ASSERT_EQ("", sampler->get_folded_stacks());
+
+        // Every other wait gets sampled.
+        sampler->set_sample_interval(2);
+        for (int i = 0; i < 10; ++i) {
+            coro_t::yield();
+        }
+        sampler->set_sample_interval(0);
+        coro_t::yield();
+
+        const std::string stacks = sampler->get_folded_stacks();
+        uint64_t total = 0;
+        size_t line_start = 0;
+        while (line_start < stacks.size()) {
+            size_t line_end = stacks.find('\n', line_start);
+            ASSERT_NE(std::string::npos, line_end);
+            size_t space = stacks.rfind(' ', line_end);
+            ASSERT_TRUE(space != std::string::npos && space > line_start);
+            uint64_t count;
+            ASSERT_TRUE(strtou64_strict(
+                stacks.substr(space + 1, line_end - space - 1), 10, &count));
+            total += count;
+            line_start = line_end + 1;
+        }
+        // Other coroutines on the thread might have waited in between.
+        ASSERT_LE(5u, total);
+
+        sampler->reset();
+        ASSERT_EQ("", sampler->get_folded_stacks());
+    });
+}
+
 // The following test does not work on 32 bit architectures because it will exceed
 // their virtual memory.
 #if defined (__x86_64__) || defined (_WIN64)
+TEST(CoroutinesTest, MaybeYield) {
+    run_in_thread_pool([&]() {
+        bool other_ran = false;
+        coro_t::spawn_later_ordered([&]() { other_ran = true; });
+
+        // Calling `maybe_yield()` in a busy loop gives the other coroutine a chance to
+        // run once the budget is used up, but not before.
+        const int64_t start_nanos = get_ticks().nanos;
+        while (!other_ran) {
+            coro_t::maybe_yield();
+        }
+        ASSERT_LE(COROUTINE_YIELD_BUDGET_MS * MILLION, get_ticks().nanos - start_nanos);
+    });
+}
+
 TEST(CoroutinesTest, LotsOfCoroutines) {
     // Test that we can spawn a lot of coroutines without exceeding kernel resources or
     // memory. (This test is still going to need about 2 GB of RAM.)
@@ -0,0 +1,56 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#include "arch/timing.hpp"
+#include "concurrency/coro_pool.hpp"
+#include "concurrency/pmap.hpp"
+#include "concurrency/queue/cross_thread_fifo.hpp"
+#include "unittest/unittest_utils.hpp"
+#include "unittest/gtest.hpp"
+
+namespace unittest {
+
+TEST(CrossThreadFifo, RingIsBounded) {
+    mpmc_bounded_queue_t<int> ring(4);
+    for (int i = 0; i < 4; ++i) {
+        EXPECT_TRUE(ring.try_push(i));
+    }
+    EXPECT_FALSE(ring.try_push(4));
+    for (int i = 0; i < 4; ++i) {
+        int value;
+        EXPECT_TRUE(ring.try_pop(&value));
+        EXPECT_EQ(i, value);
+    }
+    int value;
+    EXPECT_FALSE(ring.try_pop(&value));
+}
+
+TPTEST(CrossThreadFifo, ProducersOnEveryThread, 4) {
+    static const int per_thread = 1000;
+    cross_thread_fifo_queue_t<int> queue(16);
+
+    int64_t sum = 0;
+    int count = 0;
+    cond_t all_consumed;
+    std_function_callback_t<int> callback([&](int value, signal_t *) {
+        sum += value;
+        if (++count == per_thread * get_num_threads()) {
+            all_consumed.pulse();
+        }
+    });
+    coro_pool_t<int> pool(4, &queue, &callback);
+
+    cond_t non_interruptor;
+    pmap(get_num_threads(), [&](int thread) {
+        on_thread_t thread_switcher((threadnum_t(thread)));
+        for (int i = 0; i < per_thread; ++i) {
+            queue.push(i, &non_interruptor);
+        }
+    });
+
+    signal_timer_t timer;
+    timer.start(5000);
+    wait_interruptible(&all_consumed, &timer);
+    EXPECT_EQ(static_cast<int64_t>(get_num_threads()) * per_thread * (per_thread - 1) / 2,
+              sum);
+}
+
+}  // namespace unittest
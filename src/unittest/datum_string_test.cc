@@ -0,0 +1,105 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#include <string.h>
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "containers/archive/varint.hpp"
+#include "rdb_protocol/datum_string.hpp"
+#include "unittest/gtest.hpp"
+#include "unittest/unittest_utils.hpp"
+
+namespace unittest {
+
+// Lengths around the largest string that gets stored inline.
+const std::vector<size_t> test_lengths{0, 1, 7, 14, 15, 16, 17, 200};
+
+std::string test_string(size_t length, char first) {
+    std::string ret;
+    for (size_t i = 0; i < length; ++i) {
+        ret.push_back(static_cast<char>(first + i % 26));
+    }
+    return ret;
+}
+
+TEST(DatumStringTest, CopyAndMove) {
+    for (size_t length : test_lengths) {
+        const std::string str = test_string(length, 'a');
+        datum_string_t s(str);
+        ASSERT_EQ(str, s.to_std());
+        ASSERT_EQ(length, s.size());
+
+        datum_string_t copy(s);
+        ASSERT_EQ(str, copy.to_std());
+        datum_string_t moved(std::move(copy));
+        ASSERT_EQ(str, moved.to_std());
+        ASSERT_TRUE(copy.empty());
+
+        datum_string_t assigned("x");
+        assigned = s;
+        ASSERT_EQ(str, assigned.to_std());
+        assigned = datum_string_t(test_string(length, 'A'));
+        ASSERT_EQ(test_string(length, 'A'), assigned.to_std());
+        assigned = std::move(moved);
+        ASSERT_EQ(str, assigned.to_std());
+        ASSERT_EQ(str, s.to_std());
+    }
+}
+
+TEST(DatumStringTest, CompareAndConcat) {
+    std::vector<datum_string_t> strings;
+    for (size_t length : test_lengths) {
+        strings.push_back(datum_string_t(test_string(length, 'a')));
+    }
+    for (size_t i = 0; i < strings.size(); ++i) {
+        for (size_t j = 0; j < strings.size(); ++j) {
+            const std::string a = strings[i].to_std();
+            const std::string b = strings[j].to_std();
+            ASSERT_EQ(a < b, strings[i] < strings[j]);
+            ASSERT_EQ(a == b, strings[i] == strings[j]);
+            ASSERT_EQ(a + b, concat(strings[i], strings[j]).to_std());
+        }
+    }
+}
+
+TEST(DatumStringTest, FromBufRef) {
+    for (size_t length : test_lengths) {
+        // Put a string into a buffer that holds other data in front of it.
+        const std::string str = test_string(length, 'a');
+        const datum_string_t original(str);
+        const size_t prefix_size = 3;
+        const size_t length_size = varint_uint64_serialized_size(length);
+        counted_t<shared_buf_t> buf =
+            shared_buf_t::create(prefix_size + length_size + length);
+        serialize_varint_uint64_into_buf(
+            length, reinterpret_cast<uint8_t *>(buf->data(prefix_size)));
+        memcpy(buf->data(prefix_size + length_size), str.data(), length);
+
+        datum_string_t s(shared_buf_ref_t<char>(std::move(buf), prefix_size));
+        ASSERT_EQ(str, s.to_std());
+        ASSERT_EQ(original, s);
+        datum_string_t copy = s;
+        s = datum_string_t();
+        ASSERT_EQ(str, copy.to_std());
+    }
+}
+
+TPTEST(DatumStringTest, Interned) {
+    for (size_t length : test_lengths) {
+        const std::string str = test_string(length, 'a');
+        datum_string_t a = datum_string_t::interned(str.size(), str.data());
+        datum_string_t b = datum_string_t::interned(str.size(), str.data());
+        ASSERT_EQ(str, a.to_std());
+        ASSERT_EQ(a, b);
+        if (length > 15 && length <= 64) {
+            ASSERT_EQ(a.data(), b.data());
+        }
+        const std::string other = test_string(length, 'A');
+        datum_string_t c = datum_string_t::interned(other.size(), other.data());
+        ASSERT_EQ(other, c.to_std());
+        ASSERT_EQ(length == 0, a == c);
+    }
+}
+
+}  // namespace unittest
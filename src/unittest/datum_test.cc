@@ -1,8 +1,12 @@
 // Copyright 2010-2013 RethinkDB, all rights reserved.
 
+#include <string.h>
+
+#include "containers/archive/buffer_stream.hpp"
 #include "containers/archive/string_stream.hpp"
 #include "rdb_protocol/datum.hpp"
 #include "rdb_protocol/datum_string.hpp"
+#include "rdb_protocol/datumspec.hpp"
 #include "rdb_protocol/env.hpp"
 #include "unittest/gtest.hpp"
 
@@ -144,6 +148,82 @@ TEST(DatumTest, ObjectSerialization) {
     }
 }
 
+// Looks up fields of an object that has been deserialized into a shared buffer, with
+// keys that are prefixes of each other and offsets of different sizes.
+TEST(DatumTest, BufferFieldLookup) {
+    for (size_t value_size : {1, 300, 70000}) {
+        std::map<datum_string_t, ql::datum_t> fields;
+        const std::vector<std::string> keys{"", "a", "ab", "abc", "b", "ba", "z"};
+        for (size_t i = 0; i < keys.size(); ++i) {
+            fields[datum_string_t(keys[i])] =
+                ql::datum_t(datum_string_t(std::string(value_size, 'a' + i)));
+        }
+        const ql::datum_t test_object(std::move(fields));
+
+        string_stream_t write_stream;
+        write_message_t wm;
+        serialize<cluster_version_t::LATEST_OVERALL>(&wm, test_object);
+        ASSERT_EQ(0, send_write_message(&write_stream, &wm));
+        string_read_stream_t read_stream(std::move(write_stream.str()), 0);
+        ql::datum_t deserialized_object;
+        ASSERT_EQ(archive_result_t::SUCCESS,
+                  deserialize<cluster_version_t::LATEST_OVERALL>(
+                      &read_stream, &deserialized_object));
+
+        for (size_t i = 0; i < keys.size(); ++i) {
+            ql::datum_t value = deserialized_object.get_field(
+                datum_string_t(keys[i]), ql::NOTHROW);
+            ASSERT_TRUE(value.has());
+            ASSERT_EQ(test_object.get_field(datum_string_t(keys[i])), value);
+        }
+        for (const char *missing : {"aa", "abcd", "bb", "c", "zz"}) {
+            ASSERT_FALSE(deserialized_object.get_field(missing, ql::NOTHROW).has());
+            ASSERT_FALSE(test_object.get_field(missing, ql::NOTHROW).has());
+        }
+    }
+}
+
+// Deserializes an array from a shared buffer, as cluster messages are, and checks that
+// the array points into the buffer instead of a copy. Serializing it again should
+// refer to the buffer as well.
+TEST(DatumTest, SharedBufferDeserialization) {
+    ql::datum_t test_string(datum_string_t(std::string(10000, 'A')));
+    const ql::datum_t test_array(
+        std::vector<ql::datum_t>{test_string, test_string},
+        ql::configured_limits_t::unlimited);
+
+    string_stream_t write_stream;
+    write_message_t wm;
+    serialize<cluster_version_t::LATEST_OVERALL>(&wm, test_array);
+    ASSERT_EQ(0, send_write_message(&write_stream, &wm));
+    const std::string serialized = write_stream.str();
+    counted_t<shared_buf_t> buf = shared_buf_t::create(serialized.size());
+    memcpy(buf->data(), serialized.data(), serialized.size());
+
+    shared_buf_read_stream_t read_stream(shared_buf_ref_t<char>(buf, 0));
+    ql::datum_t deserialized_array;
+    ASSERT_EQ(archive_result_t::SUCCESS,
+              deserialize<cluster_version_t::LATEST_OVERALL>(
+                  &read_stream, &deserialized_array));
+    ASSERT_EQ(test_array, deserialized_array);
+    ASSERT_EQ(static_cast<int64_t>(serialized.size()), read_stream.tell());
+    ASSERT_TRUE(deserialized_array.get_buf_ref() != nullptr);
+    ASSERT_EQ(buf.get(), deserialized_array.get_buf_ref()->get_buf().get());
+
+    write_message_t wm2;
+    serialize<cluster_version_t::LATEST_OVERALL>(&wm2, deserialized_array);
+    ASSERT_EQ(serialized.size(), wm2.size());
+    bool refers_to_buf = false;
+    intrusive_list_t<write_buffer_t> *buffers = wm2.unsafe_expose_buffers();
+    for (write_buffer_t *b = buffers->head(); b != nullptr; b = buffers->next(b)) {
+        refers_to_buf |= b->external_buf == buf.get();
+    }
+    ASSERT_TRUE(refers_to_buf);
+    string_stream_t write_stream2;
+    ASSERT_EQ(0, send_write_message(&write_stream2, &wm2));
+    ASSERT_EQ(serialized, write_stream2.str());
+}
+
 TEST(DatumTest, ArraySerialization) {
     {
         ql::datum_t test_array(
@@ -172,6 +252,43 @@ TEST(DatumTest, ArraySerialization) {
     }
 }
 
+TEST(DatumTest, ParseJsonInsitu) {
+    const std::vector<std::string> inputs{
+        "null", "true", "-12", "18446744073709551615", "1.5e300", "\"a\\u00e9\"",
+        "[]", "{}", "[1, [2, [3, {}]], \"x\"]",
+        "{\"b\": {\"c\": [null, false]}, \"a\": 1, \"\": \"\"}",
+        "{\"$reql_type$\": \"LITERAL\", \"value\": 1}"};
+    for (const std::string &input : inputs) {
+        rapidjson::Document doc;
+        doc.Parse(input.c_str());
+        ASSERT_FALSE(doc.HasParseError());
+        const ql::datum_t expected = ql::to_datum(
+            doc, ql::configured_limits_t::unlimited, reql_version_t::LATEST);
+
+        std::vector<char> buf(input.begin(), input.end());
+        buf.push_back('\0');
+        rapidjson::ParseErrorCode error = rapidjson::kParseErrorNone;
+        const ql::datum_t parsed = ql::parse_json_to_datum_insitu(
+            buf.data(), ql::configured_limits_t::unlimited, &error);
+        ASSERT_EQ(rapidjson::kParseErrorNone, error);
+        ASSERT_EQ(expected, parsed);
+    }
+
+    for (const char *invalid : {"", "[1,", "{\"a\" 1}", "1 2"}) {
+        std::vector<char> buf(invalid, invalid + strlen(invalid) + 1);
+        rapidjson::ParseErrorCode error = rapidjson::kParseErrorNone;
+        ASSERT_FALSE(ql::parse_json_to_datum_insitu(
+            buf.data(), ql::configured_limits_t::unlimited, &error).has());
+        ASSERT_NE(rapidjson::kParseErrorNone, error);
+    }
+
+    std::string duplicate = "{\"a\": 1, \"b\": 2, \"a\": 3}";
+    rapidjson::ParseErrorCode error = rapidjson::kParseErrorNone;
+    ASSERT_THROW(ql::parse_json_to_datum_insitu(
+                     &duplicate[0], ql::configured_limits_t::unlimited, &error),
+                 ql::base_exc_t);
+}
+
 // Tests serialization with different offset sizes, up to 32 bit
 // (64 bit not tested here, because that would use too much memory for a unit test)
 TEST(DatumTest, OffsetScaling) {
@@ -205,4 +322,29 @@ TEST(DatumTest, OffsetScaling) {
     }
 }
 
+ql::datum_t make_pair_datum(double a, double b) {
+    return ql::datum_t(
+        std::vector<ql::datum_t>{ql::datum_t(a), ql::datum_t(b)},
+        ql::configured_limits_t::unlimited);
+}
+
+TEST(DatumTest, SkipScanRange) {
+    ql::datum_range_t range = ql::datum_range_t(
+        make_pair_datum(1, 5), key_range_t::closed,
+        make_pair_datum(3, 6), key_range_t::open).with_skip_scan();
+    ASSERT_TRUE(range.is_skip_scan());
+
+    ASSERT_TRUE(range.contains(make_pair_datum(1, 5)));
+    ASSERT_TRUE(range.contains(make_pair_datum(2, 5.5)));
+    ASSERT_TRUE(range.contains(make_pair_datum(3, 5)));
+    // These are in the plain range from `[1, 5]` to `[3, 6]`, but not in the
+    // skip-scan range.
+    ASSERT_FALSE(range.contains(make_pair_datum(2, 4)));
+    ASSERT_FALSE(range.contains(make_pair_datum(2, 7)));
+    ASSERT_FALSE(range.contains(make_pair_datum(1, 6)));
+    ASSERT_FALSE(range.contains(make_pair_datum(0, 5)));
+    ASSERT_FALSE(range.contains(make_pair_datum(4, 5)));
+    ASSERT_FALSE(range.contains(ql::datum_t(2.0)));
+}
+
 }  // namespace unittest
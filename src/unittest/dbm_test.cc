@@ -48,6 +48,51 @@ TEST(DBMTest, ReadAheadInterval) {
     ASSERT_EQ(100, end_offset);
 }
 
+TEST(DBMTest, CostBenefit) {
+    const int64_t extent_size = 2 * MEGABYTE;
 
+    // Without garbage there's nothing to gain, regardless of age.
+    ASSERT_EQ(0.0, gc_cost_benefit(0, extent_size, 1000000));
+
+    // At the same age, more garbage is better.
+    ASSERT_LT(gc_cost_benefit(extent_size / 4, extent_size, 1000),
+              gc_cost_benefit(extent_size / 2, extent_size, 1000));
+    ASSERT_LT(gc_cost_benefit(extent_size / 4, extent_size, 0),
+              gc_cost_benefit(extent_size / 2, extent_size, 0));
+
+    // At the same amount of garbage, older is better.
+    ASSERT_LT(gc_cost_benefit(extent_size / 2, extent_size, 1000),
+              gc_cost_benefit(extent_size / 2, extent_size, 100000));
+
+    // An old extent can beat a young extent with a bit more garbage.  That's the
+    // point of the cost-benefit policy.
+    ASSERT_LT(gc_cost_benefit(extent_size * 6 / 10, extent_size, 1000),
+              gc_cost_benefit(extent_size / 2, extent_size, 1000000));
+}
+
+TEST(DBMTest, GarbageHistogramBucket) {
+    const int64_t extent_size = 2 * MEGABYTE;
+    ASSERT_EQ(0, garbage_histogram_bucket(0, extent_size));
+    ASSERT_EQ(0, garbage_histogram_bucket(extent_size / 4 - 1, extent_size));
+    ASSERT_EQ(1, garbage_histogram_bucket(extent_size / 4, extent_size));
+    ASSERT_EQ(2, garbage_histogram_bucket(extent_size / 2, extent_size));
+    ASSERT_EQ(3, garbage_histogram_bucket(extent_size - 1, extent_size));
+    // A completely empty extent goes into the last bucket, too.
+    ASSERT_EQ(3, garbage_histogram_bucket(extent_size, extent_size));
+}
+
+TEST(DBMTest, ColdRecency) {
+    repli_timestamp_t newest;
+    newest.longtime = 10000000;
+    repli_timestamp_t recent;
+    recent.longtime = newest.longtime - 10;
+    ASSERT_FALSE(is_cold_recency(recent, newest));
+    ASSERT_FALSE(is_cold_recency(newest, newest));
+    ASSERT_TRUE(is_cold_recency(repli_timestamp_t::distant_past, newest));
+    // Blocks without a recency are never cold.
+    ASSERT_FALSE(is_cold_recency(repli_timestamp_t::invalid, newest));
+    ASSERT_FALSE(is_cold_recency(repli_timestamp_t::distant_past,
+                                 repli_timestamp_t::invalid));
+}
 
 }  // namespace unittest
@@ -0,0 +1,37 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#include <string>
+#include <vector>
+
+#include "rpc/directory/delta.hpp"
+#include "unittest/gtest.hpp"
+
+namespace unittest {
+
+TEST(DirectoryDeltaTest, RoundTrip) {
+    const std::vector<std::string> values{
+        "", "a", "aa", "abc", "abcabc", "xbcabc", "abcabx", "abxabc", "aaaaaaaa",
+        std::string(200, 'q') + "middle" + std::string(200, 'r')};
+    for (const std::string &old_value : values) {
+        for (const std::string &new_value : values) {
+            directory_delta_t delta = directory_delta_t::compute(old_value, new_value);
+            ASSERT_LE(delta.middle.size(), new_value.size());
+            std::string result;
+            ASSERT_TRUE(delta.apply(old_value, &result));
+            ASSERT_EQ(new_value, result);
+        }
+    }
+}
+
+TEST(DirectoryDeltaTest, SmallChange) {
+    std::string old_value = std::string(1000, 'a') + std::string(1000, 'b');
+    std::string new_value = old_value;
+    new_value[1000] = 'c';
+    directory_delta_t delta = directory_delta_t::compute(old_value, new_value);
+    ASSERT_EQ(1u, delta.middle.size());
+    std::string result;
+    ASSERT_TRUE(delta.apply(old_value, &result));
+    ASSERT_EQ(new_value, result);
+    ASSERT_FALSE(delta.apply("short", &result));
+}
+
+}  // namespace unittest
@@ -74,6 +74,46 @@ TEST(DiskBackedQueue, BigVals) {
     unittest::run_in_thread_pool(&run_big_values_test, 2);
 }
 
+void run_tiered_test() {
+    io_backender_t io_backender(file_direct_io_mode_t::buffered_desired);
+
+    const serializer_filepath_t serializer_path = dbq_serializer_path();
+
+    // Make room for about a hundred of the entries in memory.
+    disk_backed_queue_t<int> queue(&io_backender, serializer_path,
+                                   &get_global_perfmon_collection(), 100 * sizeof(int));
+    std::queue<int> ref_queue;
+
+    // Alternate between pushing more than fits into memory and draining part of the
+    // queue, so that values go back and forth between the two tiers.
+    int next = 0;
+    for (int round = 0; round < 10; ++round) {
+        for (int i = 0; i < 150; ++i, ++next) {
+            queue.push(next);
+            ref_queue.push(next);
+        }
+        for (int i = 0; i < 120; ++i) {
+            ASSERT_FALSE(queue.empty());
+            int x;
+            queue.pop(&x);
+            EXPECT_EQ(ref_queue.front(), x);
+            ref_queue.pop();
+        }
+        EXPECT_EQ(static_cast<int64_t>(ref_queue.size()), queue.size());
+    }
+    while (!ref_queue.empty()) {
+        int x;
+        queue.pop(&x);
+        EXPECT_EQ(ref_queue.front(), x);
+        ref_queue.pop();
+    }
+    EXPECT_TRUE(queue.empty());
+}
+
+TEST(DiskBackedQueue, Tiered) {
+    unittest::run_in_thread_pool(&run_tiered_test, 2);
+}
+
 static void randomly_delay(int, signal_t *) {
     nap(randint(100));
 }
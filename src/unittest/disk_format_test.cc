@@ -69,12 +69,18 @@ TEST(DiskFormatTest, LbaEntryT) {
     ASSERT_TRUE(lba_entry_t::is_padding(&ent));
     flagged_off64_t real = flagged_off64_t::unused();
     real = flagged_off64_t::make(1);
-    ent = lba_entry_t::make(1, repli_timestamp_t::invalid, real, 1234);
+    ent = lba_entry_t::make(1, repli_timestamp_t::invalid, real, 1234, 0);
     ASSERT_FALSE(lba_entry_t::is_padding(&ent));
+    // Uncompressed blocks must keep the format older versions can read.
+    EXPECT_EQ(1234u, ent.ser_block_size);
     flagged_off64_t deleteblock = flagged_off64_t::unused();
     deleteblock = flagged_off64_t::make(1);
-    ent = lba_entry_t::make(1, repli_timestamp_t::invalid, deleteblock, 1234);
+    ent = lba_entry_t::make(1, repli_timestamp_t::invalid, deleteblock, 1234, 0);
     ASSERT_FALSE(lba_entry_t::is_padding(&ent));
+
+    ent = lba_entry_t::make(1, repli_timestamp_t::invalid, real, 1234, 4096);
+    EXPECT_EQ(1234u, ent.disk_ser_block_size());
+    EXPECT_EQ(4096u, ent.uncompressed_ser_block_size());
 }
 
 TEST(DiskFormatTest, LbaExtentT) {
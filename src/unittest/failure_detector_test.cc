@@ -0,0 +1,40 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#include "rpc/connectivity/failure_detector.hpp"
+#include "unittest/gtest.hpp"
+
+namespace unittest {
+
+TEST(FailureDetectorTest, RegularArrivals) {
+    phi_accrual_failure_detector_t detector(10, 0.5);
+    ASSERT_EQ(0, detector.phi(100));
+    for (int i = 0; i < 20; ++i) {
+        detector.add_sample(1);
+    }
+    ASSERT_EQ(10u, detector.num_samples());
+    ASSERT_LT(detector.phi(1), 1);
+    ASSERT_GT(detector.phi(6), 8);
+    ASSERT_LT(detector.phi(2), detector.phi(3));
+
+    detector.reset();
+    ASSERT_EQ(0u, detector.num_samples());
+    ASSERT_EQ(0, detector.phi(100));
+}
+
+TEST(FailureDetectorTest, IrregularArrivalsAreTolerated) {
+    phi_accrual_failure_detector_t regular(100, 0.5);
+    phi_accrual_failure_detector_t irregular(100, 0.5);
+    for (int i = 0; i < 100; ++i) {
+        regular.add_sample(1);
+        irregular.add_sample(i % 20 == 0 ? 8 : 1);
+    }
+    ASSERT_GT(regular.phi(6), 8);
+    ASSERT_LT(irregular.phi(6), 8);
+
+    /* Old samples fall out of the window. */
+    for (int i = 0; i < 100; ++i) {
+        irregular.add_sample(1);
+    }
+    ASSERT_GT(irregular.phi(6), 8);
+}
+
+}  // namespace unittest
@@ -0,0 +1,63 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#include <map>
+#include <string>
+
+#include "containers/flat_hash_map.hpp"
+#include "containers/scoped.hpp"
+#include "random.hpp"
+#include "unittest/gtest.hpp"
+#include "unittest/unittest_utils.hpp"
+
+namespace unittest {
+
+TPTEST(FlatHashMap, MatchesStdMap) {
+    flat_hash_map_t<int64_t, std::string> map;
+    std::map<int64_t, std::string> reference;
+    rng_t rng;
+    for (int i = 0; i < 20000; ++i) {
+        const int64_t key = rng.randint(2000);
+        switch (rng.randint(3)) {
+        case 0: {
+            const std::string value = std::to_string(i);
+            const bool inserted = map.emplace(key, value).second;
+            EXPECT_EQ(reference.insert(std::make_pair(key, value)).second, inserted);
+        } break;
+        case 1:
+            EXPECT_EQ(reference.erase(key), map.erase(key));
+            break;
+        case 2: {
+            auto it = map.find(key);
+            auto ref_it = reference.find(key);
+            ASSERT_EQ(ref_it == reference.end(), it == map.end());
+            if (it != map.end()) {
+                EXPECT_EQ(ref_it->second, it->second);
+            }
+        } break;
+        default: unreachable();
+        }
+        ASSERT_EQ(reference.size(), map.size());
+    }
+
+    std::map<int64_t, std::string> contents(map.begin(), map.end());
+    EXPECT_EQ(reference, contents);
+}
+
+TEST(FlatHashMap, EraseWhileIterating) {
+    flat_hash_map_t<int64_t, scoped_ptr_t<int64_t> > map;
+    for (int64_t i = 0; i < 1000; ++i) {
+        map.emplace(i, make_scoped<int64_t>(i));
+    }
+    for (auto it = map.begin(); it != map.end();) {
+        if (*it->second % 2 == 0) {
+            it = map.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    EXPECT_EQ(500u, map.size());
+    for (int64_t i = 0; i < 1000; ++i) {
+        EXPECT_EQ(i % 2 == 0 ? 0u : 1u, map.count(i));
+    }
+}
+
+}  // namespace unittest
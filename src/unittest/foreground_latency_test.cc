@@ -0,0 +1,40 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#include "clustering/immediate_consistency/foreground_latency.hpp"
+#include "unittest/gtest.hpp"
+#include "unittest/unittest_utils.hpp"
+
+namespace unittest {
+
+TEST(ForegroundLatencyTest, Percentiles) {
+    latency_histogram_t histogram;
+    ASSERT_EQ(0u, histogram.num_samples());
+    ASSERT_EQ(0, histogram.percentile_nanos(0.99));
+
+    for (int64_t i = 1; i <= 1000; ++i) {
+        histogram.add(i * 1000);
+    }
+    ASSERT_EQ(1000u, histogram.num_samples());
+    /* Percentiles are upper bounds that are at most 25% too high. */
+    for (double fraction : {0.1, 0.5, 0.99}) {
+        const int64_t exact = static_cast<int64_t>(fraction * 1000) * 1000;
+        ASSERT_GE(histogram.percentile_nanos(fraction), exact);
+        ASSERT_LE(histogram.percentile_nanos(fraction), exact * 5 / 4);
+    }
+
+    latency_histogram_t other;
+    other.add(0);
+    other.add(INT64_MAX);
+    histogram.merge(other);
+    ASSERT_EQ(1002u, histogram.num_samples());
+    ASSERT_LT(1000000000, histogram.percentile_nanos(1.0));
+}
+
+TPTEST(ForegroundLatencyTest, Collect) {
+    collect_foreground_latencies();
+    record_foreground_latency(get_ticks());
+    record_foreground_latency(get_ticks());
+    ASSERT_EQ(2u, collect_foreground_latencies().num_samples());
+    ASSERT_EQ(0u, collect_foreground_latencies().num_samples());
+}
+
+}  // namespace unittest
@@ -473,6 +473,28 @@ TPTEST(GeoIndexes, GetIntersecting) {
     run_with_namespace_interface(&run_get_intersecting_test);
 }
 
+// Test that `prepared_geometry_t`, which `get_intersecting` uses, agrees with
+// `geo_does_intersect`
+TPTEST(GeoIndexes, PreparedGeometry) {
+    const int rng_seed = randint(INT_MAX);
+    debugf("Using RNG seed %i\n", rng_seed);
+    rng_t rng(rng_seed);
+
+    std::vector<datum_t> data = generate_data(300, &rng);
+    std::vector<datum_t> queries = generate_data(30, &rng);
+    try {
+        for (const datum_t &query : queries) {
+            prepared_geometry_t prepared(query);
+            for (const datum_t &d : data) {
+                ASSERT_EQ(geo_does_intersect(query, d), prepared.intersects(d));
+            }
+        }
+    } catch (const geo_exception_t &e) {
+        debugf("Caught a geo exception: %s\n", e.what());
+        FAIL();
+    }
+}
+
 } /* namespace unittest */
 
 
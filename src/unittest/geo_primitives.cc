@@ -106,5 +106,32 @@ TPTEST(GeoPrimitives, InExRadiusTest) {
     }
 }
 
+void test_distance_lower_bound(const ellipsoid_spec_t &e, rng_t *rng) {
+    for (int i = 0; i < 1000; ++i) {
+        lon_lat_point_t p1(rng->randdouble() * 360.0 - 180.0,
+                           rng->randdouble() * 180.0 - 90.0);
+        lon_lat_point_t p2(rng->randdouble() * 360.0 - 180.0,
+                           rng->randdouble() * 180.0 - 90.0);
+        S2Point s2p1 = S2LatLng::FromDegrees(p1.latitude, p1.longitude).ToPoint();
+        datum_t datum_p2 = construct_geo_point(p2, ql::configured_limits_t());
+
+        const double dist = geodesic_distance(p1, p2, e);
+        const double bound = geodesic_distance_up_to(s2p1, datum_p2, e, 0.0);
+        ASSERT_LE(bound, dist * (1.0 + 1e-12));
+        ASSERT_EQ(geodesic_distance(s2p1, datum_p2, e),
+                  geodesic_distance_up_to(s2p1, datum_p2, e, dist * 1.01));
+    }
+}
+
+TPTEST(GeoPrimitives, DistanceLowerBound) {
+    const int rng_seed = randint(INT_MAX);
+    debugf("Using RNG seed %i\n", rng_seed);
+    rng_t rng(rng_seed);
+    test_distance_lower_bound(UNIT_SPHERE, &rng);
+    test_distance_lower_bound(WGS84_ELLIPSOID, &rng);
+    test_distance_lower_bound(ellipsoid_spec_t(1.0, 0.4), &rng);
+    test_distance_lower_bound(ellipsoid_spec_t(1.0, -0.5), &rng);
+}
+
 }   /* namespace unittest */
 
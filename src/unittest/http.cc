@@ -8,6 +8,7 @@
 #include "arch/types.hpp"
 #include "arch/timing.hpp"
 #include "arch/io/network.hpp"
+#include "clustering/administration/http/metrics_app.hpp"
 #include "unittest/gtest.hpp"
 #include "http/http.hpp"
 #include "http/routing_app.hpp"
@@ -200,6 +201,53 @@ private:
     }
 };
 
+class echo_http_app_t : public http_app_t {
+public:
+    void handle(const http_req_t &req, http_res_t *result, signal_t *) {
+        *result = http_res_t(http_status_code_t::OK, "text/plain",
+                             req.resource.as_string());
+    }
+};
+
+TPTEST(Http, PipelinedRequests) {
+    echo_http_app_t app;
+    ip_address_t loopback("127.0.0.1");
+    std::set<ip_address_t> ip_addresses;
+    ip_addresses.insert(loopback);
+    http_server_t server(nullptr, ip_addresses, 0, &app);
+
+    cond_t non_interruptor;
+    tcp_conn_t http_conn(loopback, server.get_port(), &non_interruptor);
+
+    // Send both requests before reading either response.  The server closes the
+    // connection after the second one.
+    std::string requests =
+        "GET /first HTTP/1.1\r\nHost: localhost\r\n\r\n"
+        "GET /second HTTP/1.1\r\nConnection: close\r\n\r\n";
+    http_conn.write(requests.data(), requests.size(), &non_interruptor);
+
+    signal_timer_t timeout(5000);
+    std::string responses;
+    try {
+        while (true) {
+            http_conn.read_more_buffered(&timeout);
+            const_charslice data = http_conn.peek();
+            responses.append(data.beg, data.end);
+            http_conn.pop(data.end - data.beg, &timeout);
+        }
+    } catch (const tcp_conn_read_closed_exc_t &) {
+    }
+    ASSERT_FALSE(timeout.is_pulsed());
+
+    const size_t first = responses.find("\r\n\r\n/first");
+    const size_t second = responses.find("\r\n\r\n/second");
+    ASSERT_NE(std::string::npos, first);
+    ASSERT_NE(std::string::npos, second);
+    ASSERT_LT(first, second);
+    ASSERT_NE(std::string::npos, responses.find("connection: keep-alive"));
+    ASSERT_NE(std::string::npos, responses.find("connection: close"));
+}
+
 TPTEST(Http, InterruptRoutingApp) {
     {
         routing_app_interrupt_test_t router_test("/");
@@ -212,4 +260,32 @@ TPTEST(Http, InterruptRoutingApp) {
     }
 }
 
+TPTEST(Http, OpenMetrics) {
+    ql::datum_object_builder_t query_engine;
+    query_engine.overwrite("queries_per_sec", ql::datum_t(2.5));
+    query_engine.overwrite("version", ql::datum_t("2.4"));
+    ql::datum_object_builder_t stats;
+    stats.overwrite("query_engine", std::move(query_engine).to_datum());
+    const char *table_ids[] = {
+        "0d5e12f4-b1a4-4f33-8a6f-b3f1d5a0c8e1", "7b9c3d2e-5f6a-4b8c-9d0e-1f2a3b4c5d6e" };
+    for (const char *table_id : table_ids) {
+        ql::datum_object_builder_t btree;
+        btree.overwrite("keys_read", ql::datum_t(1.0));
+        ql::datum_object_builder_t table;
+        table.overwrite("btree-primary", std::move(btree).to_datum());
+        stats.overwrite(table_id, std::move(table).to_datum());
+    }
+
+    EXPECT_EQ(
+        "# TYPE rethinkdb_btree_primary_keys_read gauge\n"
+        "rethinkdb_btree_primary_keys_read"
+            "{table=\"0d5e12f4-b1a4-4f33-8a6f-b3f1d5a0c8e1\"} 1\n"
+        "rethinkdb_btree_primary_keys_read"
+            "{table=\"7b9c3d2e-5f6a-4b8c-9d0e-1f2a3b4c5d6e\"} 1\n"
+        "# TYPE rethinkdb_query_engine_queries_per_sec gauge\n"
+        "rethinkdb_query_engine_queries_per_sec 2.5\n"
+        "# EOF\n",
+        perfmon_stats_to_openmetrics(std::move(stats).to_datum()));
+}
+
 }  // namespace unittest
@@ -138,6 +138,54 @@ SPAWNER_TEST(JSProc, EvalAndCall) {
     });
 }
 
+SPAWNER_TEST(JSProc, CompiledFunctionOutlivesRunner) {
+    ql::configured_limits_t limits;
+    const std::string source_code = "(function (x) { return x + 1; })";
+
+    js_runner_t::req_config_t config;
+    config.timeout_ms = 10000;
+
+    // The second runner gets the program that the first one compiled, and has to be
+    // able to use it after the first one released its id.
+    for (int i = 0; i < 2; ++i) {
+        js_runner_t js_runner(limits);
+        js_result_t result = js_runner.eval(source_code, config);
+        ASSERT_TRUE(boost::get<js_id_t>(&result) != nullptr);
+
+        result = js_runner.call(source_code,
+                                std::vector<ql::datum_t>(1, ql::datum_t(10.0)),
+                                config);
+        ql::datum_t *res_datum = boost::get<ql::datum_t>(&result);
+        ASSERT_TRUE(res_datum != nullptr);
+        ASSERT_EQ(res_datum->as_int(), 11);
+    }
+}
+
+SPAWNER_TEST(JSProc, CompiledFunctionGetsFreshGlobals) {
+    ql::configured_limits_t limits;
+    const std::string source_code =
+        "(function (x) { counter = (typeof counter === 'undefined') ? x : counter + x;"
+        " return counter; })";
+
+    js_runner_t::req_config_t config;
+    config.timeout_ms = 10000;
+
+    // Each runner's first call has to see its own globals, not the ones the runner
+    // that compiled the source left behind.
+    for (int i = 0; i < 2; ++i) {
+        js_runner_t js_runner(limits);
+        js_result_t result = js_runner.eval(source_code, config);
+        ASSERT_TRUE(boost::get<js_id_t>(&result) != nullptr);
+
+        result = js_runner.call(source_code,
+                                std::vector<ql::datum_t>(1, ql::datum_t(10.0)),
+                                config);
+        ql::datum_t *res_datum = boost::get<ql::datum_t>(&result);
+        ASSERT_TRUE(res_datum != nullptr);
+        ASSERT_EQ(res_datum->as_int(), 10);
+    }
+}
+
 SPAWNER_TEST(JSProc, BrokenFunction) {
     ql::configured_limits_t limits;
     js_runner_t js_runner(limits);
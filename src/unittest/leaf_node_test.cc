@@ -27,6 +27,8 @@ public:
 
     leaf_node_t *node() { return node_.get(); }
     value_sizer_t *sizer() { return &sizer_; }
+    max_block_size_t block_size() const { return bs_; }
+    size_t KeyCount() const { return kv_.size(); }
 
     bool Insert(
             const store_key_t &key,
@@ -194,6 +196,10 @@ public:
         return leaf::is_underfull(&sizer_, node());
     }
 
+    bool ChangeUnsafe(const store_key_t &key) {
+        return leaf::change_unsafe(&sizer_, node(), key.btree_key());
+    }
+
     bool ShouldHave(const store_key_t& key) {
         return kv_.end() != kv_.find(key);
     }
@@ -242,6 +248,16 @@ public:
             printf("\n");
         }
         ASSERT_TRUE(leaf_guts == kv_);
+
+        // The iterators hand out whole keys, even if the node doesn't store them.
+        auto it = leaf::begin(bs_, *node());
+        for (const auto &pair : kv_) {
+            ASSERT_TRUE(it != leaf::end(*node()));
+            ASSERT_EQ(key_to_unescaped_str(pair.first),
+                      key_to_unescaped_str(store_key_t((*it).first)));
+            ++it;
+        }
+        ASSERT_TRUE(it == leaf::end(*node()));
     }
 
 private:
@@ -402,7 +418,7 @@ void make_node_underfull(LeafNodeTracker *tracker, rng_t *rng) {
     while (!tracker->IsUnderfull() ||
            (node->num_pairs > 0 && rng->randint(2) == 0)) {
         int chosen = rng->randint(node->num_pairs);
-        auto pair = *leaf_node_t::iterator(node, chosen);
+        auto pair = *leaf_node_t::iterator(tracker->block_size(), node, chosen);
 
         // We might hit a removal entry; skip those.
         if (tracker->ShouldHave(store_key_t(pair.first))) {
@@ -462,6 +478,28 @@ TEST(LeafNodeTest, RandomSplitting) {
     }
 }
 
+TEST(LeafNodeTest, SplitAtEnd) {
+    LeafNodeTracker node;
+    int i = 0;
+    while (!node.IsFull(store_key_t(strprintf("k%06d", i)), "value")) {
+        node.Insert(store_key_t(strprintf("k%06d", i)), "value");
+        ++i;
+    }
+    const store_key_t next(strprintf("k%06d", i));
+    const store_key_t last(strprintf("k%06d", i - 1));
+    ASSERT_TRUE(leaf::is_past_end(node.sizer(), node.node(), next.btree_key()));
+    ASSERT_FALSE(leaf::is_past_end(node.sizer(), node.node(), last.btree_key()));
+
+    LeafNodeTracker right;
+    store_key_t median;
+    leaf::split_at_end(node.sizer(), node.node(), right.node(), median.btree_key());
+    EXPECT_EQ(last, median);
+    EXPECT_TRUE(leaf::is_empty(right.node()));
+    node.Verify();
+
+    right.Insert(next, "value");
+}
+
 TEST(LeafNodeTest, DeletionTimestamp) {
     LeafNodeTracker tracker;
 
@@ -711,4 +749,79 @@ TEST(LeafNodeTest, Fullness) {
     ASSERT_TRUE(node.IsFull(store_key_t(strprintf("a%d", i)), strprintf("A%d", i)));
 }
 
+TEST(LeafNodeTest, ChangeUnsafe) {
+    LeafNodeTracker node;
+    const store_key_t key("b");
+    // An empty node would be underfull, and a full one would have to be split.
+    ASSERT_TRUE(node.ChangeUnsafe(key));
+    int i = 0;
+    while (node.ChangeUnsafe(key)) {
+        node.Insert(store_key_t(strprintf("a%d", i)), strprintf("A%d", i));
+        ++i;
+    }
+    ASSERT_FALSE(node.IsUnderfull());
+    // Any single write in between leaves it neither underfull nor full.
+    node.Remove(store_key_t("a0"));
+    ASSERT_FALSE(node.IsUnderfull());
+    while (!node.ChangeUnsafe(key)) {
+        ASSERT_FALSE(node.IsFull(key, std::string(250, 'x')));
+        node.Insert(store_key_t(strprintf("a%d", i)), strprintf("A%d", i));
+        ++i;
+    }
+}
+
+void fill_with_prefixed_keys(LeafNodeTracker *tracker, const char *format) {
+    for (int i = 0; tracker->Insert(store_key_t(strprintf(format, i)), "V"); ++i) { }
+}
+
+TEST(LeafNodeTest, PrefixedSplitting) {
+    LeafNodeTracker left;
+    fill_with_prefixed_keys(&left, "user:%08d");
+    const size_t full_count = left.KeyCount();
+
+    LeafNodeTracker right;
+    left.Split(&right);
+
+    // The halves only store what comes after the prefix their keys share, so they
+    // hold more keys than the node did before.
+    fill_with_prefixed_keys(&left, "user:%08dx");
+    EXPECT_LT(full_count, left.KeyCount());
+
+    // Keys that don't have the prefix still go in whole.
+    const store_key_t outside("zebra");
+    ASSERT_TRUE(right.Insert(outside, "Z"));
+    short_value_buffer_t value("");
+    ASSERT_TRUE(leaf::lookup(right.sizer(), right.node(), outside.btree_key(),
+                             value.data()));
+    EXPECT_EQ("Z", value.as_str());
+
+    const store_key_t key("user:00000100");
+    auto it = leaf::inclusive_lower_bound(left.block_size(), key.btree_key(),
+                                          *left.node());
+    ASSERT_TRUE(it != leaf::end(*left.node()));
+    EXPECT_EQ(key_to_unescaped_str(key), key_to_unescaped_str(store_key_t((*it).first)));
+}
+
+TEST(LeafNodeTest, PrefixedLevelingAndMerging) {
+    LeafNodeTracker left;
+    fill_with_prefixed_keys(&left, "user:%08d");
+    LeafNodeTracker right;
+    left.Split(&right);
+
+    // Keys that sort after all of the keys in `left`, some of them without the
+    // prefix that the keys of `right` share.
+    ASSERT_TRUE(right.Insert(store_key_t("zebra"), "Z"));
+    fill_with_prefixed_keys(&right, "user:1%07d");
+
+    rng_t rng;
+    make_node_underfull(&left, &rng);
+    bool could_level;
+    left.Level(-1, &right, &could_level);
+    ASSERT_TRUE(could_level);
+
+    make_node_underfull(&left, &rng);
+    make_node_underfull(&right, &rng);
+    right.Merge(&left);
+}
+
 }  // namespace unittest
@@ -38,4 +38,27 @@ TEST(LRUCacheTest, Basic) {
     EXPECT_FALSE(res);
 }
 
+TEST(LRUCacheTest, EraseIf) {
+    lru_cache_t<std::string, std::string> cache(4);
+    EXPECT_TRUE(cache.insert("1", "odd"));
+    EXPECT_TRUE(cache.insert("2", "even"));
+    EXPECT_TRUE(cache.insert("3", "odd"));
+    cache.erase_if([](const std::string &, const std::string &v) {
+        return v == "odd";
+    });
+    EXPECT_EQ(1, cache.size());
+    std::string *p;
+    EXPECT_FALSE(cache.lookup("1", &p));
+    ASSERT_TRUE(cache.lookup("2", &p));
+    EXPECT_EQ("even", *p);
+    // The erased entries don't count towards the size anymore.
+    EXPECT_TRUE(cache.insert("4", ""));
+    EXPECT_TRUE(cache.insert("5", ""));
+    EXPECT_TRUE(cache.insert("6", ""));
+    EXPECT_TRUE(cache.lookup("2", &p));
+    cache.clear();
+    EXPECT_EQ(0, cache.size());
+    EXPECT_FALSE(cache.lookup("2", &p));
+}
+
 } // namespace unittest
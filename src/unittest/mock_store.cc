@@ -552,6 +552,16 @@ void mock_store_t::reset_data(
     metainfo_.update(subregion, zero_version);
 }
 
+void mock_store_t::get_expired_keys(
+        UNUSED const std::string &sindex,
+        UNUSED double cutoff,
+        UNUSED size_t max_keys,
+        UNUSED std::vector<store_key_t> *keys_out,
+        UNUSED signal_t *interruptor) THROWS_ONLY(interrupted_exc_t) {
+    assert_thread();
+    // The mock store has no secondary indexes, so nothing ever expires.
+}
+
 std::string mock_store_t::values(std::string key) {
     auto it = table_.find(store_key_t(key));
     if (it == table_.end()) {
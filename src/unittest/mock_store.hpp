@@ -96,6 +96,14 @@ public:
             signal_t *interruptor)
         THROWS_ONLY(interrupted_exc_t);
 
+    void get_expired_keys(
+            const std::string &sindex,
+            double cutoff,
+            size_t max_keys,
+            std::vector<store_key_t> *keys_out,
+            signal_t *interruptor)
+        THROWS_ONLY(interrupted_exc_t);
+
     // Used by unit tests that expected old-style stuff.
     std::string values(std::string key);
     repli_timestamp_t timestamps(std::string key);
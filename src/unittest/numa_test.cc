@@ -0,0 +1,52 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#include <vector>
+
+#include "arch/runtime/numa.hpp"
+#include "unittest/gtest.hpp"
+#include "utils.hpp"
+
+namespace unittest {
+
+TEST(NumaTest, ParseCpuList) {
+    std::vector<int> cpus;
+    ASSERT_TRUE(parse_cpu_list("0-3,8,10-11\n", &cpus));
+    EXPECT_EQ((std::vector<int>{0, 1, 2, 3, 8, 10, 11}), cpus);
+
+    // Nodes that only have memory have an empty list.
+    ASSERT_TRUE(parse_cpu_list("\n", &cpus));
+    EXPECT_TRUE(cpus.empty());
+
+    EXPECT_FALSE(parse_cpu_list("0-", &cpus));
+    EXPECT_FALSE(parse_cpu_list("3-1", &cpus));
+    EXPECT_FALSE(parse_cpu_list("a", &cpus));
+}
+
+TEST(NumaTest, FormatCpuList) {
+    EXPECT_EQ("0-3,8,10-11", format_cpu_list({10, 0, 1, 2, 3, 8, 11, 2}));
+    EXPECT_EQ("", format_cpu_list({}));
+
+    std::vector<int> cpus;
+    ASSERT_TRUE(parse_cpu_set("5,1-2", &cpus));
+    EXPECT_EQ((std::vector<int>{5, 1, 2}), cpus);
+    EXPECT_FALSE(parse_cpu_set("", &cpus));
+
+    // Node 0 always exists and has CPUs.
+    ASSERT_TRUE(parse_cpu_set("node:0", &cpus));
+    EXPECT_EQ(get_numa_node_cpus(0), cpus);
+    EXPECT_FALSE(parse_cpu_set(strprintf("node:%d", get_numa_node_count()), &cpus));
+}
+
+TEST(NumaTest, NodeForThread) {
+    // Eight threads on two nodes go four to a node.
+    for (int i = 0; i < 8; ++i) {
+        EXPECT_EQ(i < 4 ? 0 : 1, numa_node_for_thread(i, 8, 2));
+    }
+    // With fewer threads than nodes, every thread still gets a valid node.
+    for (int i = 0; i < 3; ++i) {
+        int node = numa_node_for_thread(i, 3, 4);
+        EXPECT_LE(0, node);
+        EXPECT_GT(4, node);
+    }
+}
+
+}  // namespace unittest
@@ -1,9 +1,12 @@
 // Copyright 2010-2014 RethinkDB, all rights reserved.
+#include <algorithm>
+
 #include "arch/runtime/coroutines.hpp"
 #include "arch/timing.hpp"
 #include "buffer_cache/page_cache.hpp"
 #include "buffer_cache/alt.hpp"
 #include "buffer_cache/cache_balancer.hpp"
+#include "buffer_cache/warm_up.hpp"
 #include "concurrency/auto_drainer.hpp"
 #include "concurrency/pmap.hpp"
 #include "containers/scoped.hpp"
@@ -264,6 +267,365 @@ TPTEST(PageTest, ReadAfterWrite, 4) {
     pmap(2, std::bind(&ReadAfterWrite_cases, &s, &page_cache, ph::_1));
 }
 
+TPTEST(PageTest, PrefetchBlocks, 4) {
+    mock_ser_t mock;
+    dummy_cache_balancer_t balancer(GIGABYTE);
+    block_id_t block_id;
+    {
+        test_cache_t page_cache(mock.ser.get(), &balancer, mock.throttler.get());
+        auto txn = make_scoped<test_txn_t>(&page_cache);
+        {
+            current_test_acq_t acq(txn.get(), alt_create_t::create);
+            block_id = acq.block_id();
+            test_acq_t page_acq;
+            page_acq.init(acq.current_page_for_write(), &page_cache);
+            memset(page_acq.get_buf_write(), 'p', page_cache.max_block_size().value());
+        }
+        page_cache.flush(std::move(txn));
+    }
+
+    // A fresh cache has to load the block from the serializer.  Prefetching it (and
+    // a block id that doesn't exist) must not get in the way of reading it.
+    test_cache_t page_cache(mock.ser.get(), &balancer, mock.throttler.get());
+    std::vector<block_id_t> block_ids;
+    block_ids.push_back(block_id);
+    block_ids.push_back(block_id + 1000);
+    page_cache.prefetch_blocks(block_ids, page_cache.default_reads_account());
+
+    auto txn = make_scoped<test_txn_t>(&page_cache);
+    {
+        current_test_acq_t acq(txn.get(), block_id, access_t::read);
+        test_acq_t page_acq;
+        page_acq.init(acq.current_page_for_read(), &page_cache);
+        const char *buf = static_cast<const char *>(page_acq.get_buf_read());
+        for (uint32_t i = 0; i < page_cache.max_block_size().value(); ++i) {
+            ASSERT_EQ('p', buf[i]);
+        }
+    }
+    page_cache.flush(std::move(txn));
+}
+
+// Reads the hot blocks twice and then scans all the others with low priority, in a
+// cache with room for only a few blocks, and returns how many of the hot blocks are
+// still in memory afterwards.
+size_t count_hot_blocks_surviving_scan(eviction_policy_t policy) {
+    const size_t num_hot_blocks = 3;
+    const size_t num_scanned_blocks = 40;
+    mock_ser_t mock;
+    std::vector<block_id_t> block_ids;
+    {
+        dummy_cache_balancer_t balancer(GIGABYTE);
+        test_cache_t page_cache(mock.ser.get(), &balancer, mock.throttler.get());
+        auto txn = make_scoped<test_txn_t>(&page_cache);
+        for (size_t i = 0; i < num_hot_blocks + num_scanned_blocks; ++i) {
+            current_test_acq_t acq(txn.get(), alt_create_t::create);
+            block_ids.push_back(acq.block_id());
+            test_acq_t page_acq;
+            page_acq.init(acq.current_page_for_write(), &page_cache);
+            memset(page_acq.get_buf_write(), 'h', page_cache.max_block_size().value());
+        }
+        page_cache.flush(std::move(txn));
+    }
+
+    dummy_cache_balancer_t balancer(10 * DEFAULT_BTREE_BLOCK_SIZE, policy);
+    test_cache_t page_cache(mock.ser.get(), &balancer, mock.throttler.get());
+    auto read = [&](block_id_t block_id, page_access_priority_t priority) {
+        auto txn = make_scoped<test_txn_t>(&page_cache);
+        {
+            current_test_acq_t acq(txn.get(), block_id, access_t::read);
+            test_acq_t page_acq;
+            page_acq.init(acq.current_page_for_read(), &page_cache);
+            page_acq.get_buf_read(priority);
+        }
+        page_cache.flush(std::move(txn));
+    };
+    for (int pass = 0; pass < 2; ++pass) {
+        for (size_t i = 0; i < num_hot_blocks; ++i) {
+            read(block_ids[i], page_access_priority_t::normal);
+        }
+    }
+    for (size_t i = num_hot_blocks; i < block_ids.size(); ++i) {
+        read(block_ids[i], page_access_priority_t::low);
+    }
+
+    size_t surviving = 0;
+    auto txn = make_scoped<test_txn_t>(&page_cache);
+    for (size_t i = 0; i < num_hot_blocks; ++i) {
+        current_test_acq_t acq(txn.get(), block_ids[i], access_t::read);
+        if (acq.current_page_for_read()->is_loaded()) {
+            ++surviving;
+        }
+    }
+    page_cache.flush(std::move(txn));
+    return surviving;
+}
+
+TPTEST(PageTest, ScanResistantEviction, 4) {
+    ASSERT_EQ(3u, count_hot_blocks_surviving_scan(eviction_policy_t::scan_resistant));
+    // Evicting by access time alone lets the scan push the hot blocks out.
+    ASSERT_EQ(0u, count_hot_blocks_surviving_scan(eviction_policy_t::access_time));
+}
+
+// Like dummy_cache_balancer_t, but the caches on each thread share an eviction
+// domain.
+class shared_domain_cache_balancer_t final : public cache_balancer_t {
+public:
+    explicit shared_domain_cache_balancer_t(uint64_t _base_mem_per_store)
+        : base_mem_per_store_(_base_mem_per_store),
+          domains_(get_num_threads()),
+          notify_activity_boolean_(false) { }
+
+    uint64_t base_mem_per_store() const final { return base_mem_per_store_; }
+    bool read_ahead_ok_at_start() const final { return false; }
+    eviction_policy_t eviction_policy() const final {
+        return eviction_policy_t::scan_resistant;
+    }
+    double compressed_tier_fraction() const final { return 0; }
+    alt::eviction_domain_t *eviction_domain(threadnum_t thread) final {
+        return &domains_[thread.threadnum];
+    }
+    bool *notify_activity_boolean(threadnum_t) final {
+        return &notify_activity_boolean_;
+    }
+    void wake_up_activity_happened() final { }
+
+private:
+    void add_evicter(alt::evicter_t *) final { }
+    void remove_evicter(alt::evicter_t *) final { }
+
+    uint64_t base_mem_per_store_;
+    scoped_array_t<alt::eviction_domain_t> domains_;
+    bool notify_activity_boolean_;
+};
+
+std::vector<block_id_t> create_blocks(mock_ser_t *mock, size_t count) {
+    std::vector<block_id_t> block_ids;
+    dummy_cache_balancer_t balancer(GIGABYTE);
+    test_cache_t page_cache(mock->ser.get(), &balancer, mock->throttler.get());
+    auto txn = make_scoped<test_txn_t>(&page_cache);
+    for (size_t i = 0; i < count; ++i) {
+        current_test_acq_t acq(txn.get(), alt_create_t::create);
+        block_ids.push_back(acq.block_id());
+        test_acq_t page_acq;
+        page_acq.init(acq.current_page_for_write(), &page_cache);
+        memset(page_acq.get_buf_write(), 'd', page_cache.max_block_size().value());
+    }
+    page_cache.flush(std::move(txn));
+    return block_ids;
+}
+
+// Reads the blocks that create_blocks created, and returns how many of them are
+// still in memory afterwards.
+size_t read_blocks(test_cache_t *page_cache, const std::vector<block_id_t> &block_ids) {
+    auto txn = make_scoped<test_txn_t>(page_cache);
+    for (block_id_t block_id : block_ids) {
+        current_test_acq_t acq(txn.get(), block_id, access_t::read);
+        test_acq_t page_acq;
+        page_acq.init(acq.current_page_for_read(), page_cache);
+        const char *buf = static_cast<const char *>(page_acq.get_buf_read());
+        const uint32_t size = page_cache->max_block_size().value();
+        EXPECT_EQ(size, static_cast<uint32_t>(std::count(buf, buf + size, 'd')));
+    }
+    size_t loaded = 0;
+    for (block_id_t block_id : block_ids) {
+        current_test_acq_t acq(txn.get(), block_id, access_t::read);
+        if (acq.current_page_for_read()->is_loaded()) {
+            ++loaded;
+        }
+    }
+    page_cache->flush(std::move(txn));
+    return loaded;
+}
+
+TPTEST(PageTest, SharedEvictionDomain, 4) {
+    const size_t num_blocks = 10;
+    mock_ser_t busy_mock;
+    mock_ser_t idle_mock;
+    std::vector<block_id_t> busy_blocks = create_blocks(&busy_mock, num_blocks);
+    std::vector<block_id_t> idle_blocks = create_blocks(&idle_mock, num_blocks);
+
+    // Each cache has room for fewer than `num_blocks` blocks, but the two of them
+    // together have room for more.
+    const uint64_t memory_limit = 8 * DEFAULT_BTREE_BLOCK_SIZE;
+    {
+        dummy_cache_balancer_t balancer(memory_limit);
+        test_cache_t busy(busy_mock.ser.get(), &balancer, busy_mock.throttler.get());
+        test_cache_t idle(idle_mock.ser.get(), &balancer, idle_mock.throttler.get());
+        ASSERT_GT(num_blocks, read_blocks(&busy, busy_blocks));
+    }
+
+    shared_domain_cache_balancer_t balancer(memory_limit);
+    test_cache_t busy(busy_mock.ser.get(), &balancer, busy_mock.throttler.get());
+    test_cache_t idle(idle_mock.ser.get(), &balancer, idle_mock.throttler.get());
+    // The busy cache can use the memory that the idle one doesn't need...
+    ASSERT_EQ(num_blocks, read_blocks(&busy, busy_blocks));
+    ASSERT_LT(busy.evicter().memory_limit(), busy.evicter().in_memory_size());
+    // ... until the idle one needs it.
+    read_blocks(&idle, idle_blocks);
+    ASSERT_GE(busy.evicter().memory_limit() + idle.evicter().memory_limit(),
+              busy.evicter().in_memory_size() + idle.evicter().in_memory_size());
+}
+
+TPTEST(PageTest, CompressedTier, 4) {
+    const size_t num_blocks = 10;
+    mock_ser_t mock;
+    std::vector<block_id_t> block_ids = create_blocks(&mock, num_blocks);
+
+    dummy_cache_balancer_t balancer(8 * DEFAULT_BTREE_BLOCK_SIZE,
+                                    eviction_policy_t::scan_resistant,
+                                    0.5);
+    test_cache_t page_cache(mock.ser.get(), &balancer, mock.throttler.get());
+    alt::compressed_page_tier_t *tier = page_cache.evicter().compressed_tier();
+    ASSERT_GT(num_blocks, read_blocks(&page_cache, block_ids));
+    // The blocks compress very well, so the evicted ones are all in the tier.
+    ASSERT_LT(0u, tier->size());
+    ASSERT_EQ(0u, tier->hits());
+    ASSERT_EQ(num_blocks, tier->misses());
+
+    // Reading them again gets the evicted ones from the tier, not from disk.
+    read_blocks(&page_cache, block_ids);
+    ASSERT_LT(0u, tier->hits());
+    ASSERT_EQ(num_blocks, tier->misses());
+}
+
+TPTEST(PageTest, CacheQuota, 4) {
+    const size_t num_blocks = 10;
+    mock_ser_t mock;
+    std::vector<block_id_t> block_ids = create_blocks(&mock, num_blocks);
+
+    const uint64_t memory_limit = 4 * DEFAULT_BTREE_BLOCK_SIZE;
+    dummy_cache_balancer_t balancer(memory_limit);
+    size_t unprotected_loaded;
+    {
+        test_cache_t page_cache(mock.ser.get(), &balancer, mock.throttler.get());
+        unprotected_loaded = read_blocks(&page_cache, block_ids);
+    }
+    {
+        // The cache keeps what it has reserved, even beyond its memory limit...
+        test_cache_t page_cache(mock.ser.get(), &balancer, mock.throttler.get());
+        page_cache.evicter().set_quota(
+            cache_quota_t{7 * DEFAULT_BTREE_BLOCK_SIZE, false});
+        size_t loaded = read_blocks(&page_cache, block_ids);
+        ASSERT_LT(unprotected_loaded, loaded);
+        ASSERT_GT(num_blocks, loaded);
+    }
+    {
+        // ... and everything if it's pinned.
+        test_cache_t page_cache(mock.ser.get(), &balancer, mock.throttler.get());
+        page_cache.evicter().set_quota(cache_quota_t{0, true});
+        ASSERT_EQ(num_blocks, read_blocks(&page_cache, block_ids));
+    }
+
+    // In an eviction domain, the other caches give up their pages instead.
+    mock_ser_t busy_mock;
+    std::vector<block_id_t> busy_blocks = create_blocks(&busy_mock, 2 * num_blocks);
+    shared_domain_cache_balancer_t domain_balancer(memory_limit);
+    test_cache_t pinned(mock.ser.get(), &domain_balancer, mock.throttler.get());
+    test_cache_t busy(busy_mock.ser.get(), &domain_balancer,
+                      busy_mock.throttler.get());
+    pinned.evicter().set_quota(cache_quota_t{0, true});
+    ASSERT_EQ(num_blocks, read_blocks(&pinned, block_ids));
+    const uint64_t pinned_size = pinned.evicter().in_memory_size();
+    read_blocks(&busy, busy_blocks);
+    ASSERT_EQ(pinned_size, pinned.evicter().in_memory_size());
+}
+
+TEST(PageTest, WarmUpFileFormat) {
+    const std::vector<block_id_t> block_ids = {7, 3, 12};
+    std::vector<block_id_t> parsed;
+    ASSERT_TRUE(alt::cache_warm_up_t::deserialize_block_ids(
+        alt::cache_warm_up_t::serialize_block_ids(block_ids), &parsed));
+    ASSERT_EQ(block_ids, parsed);
+    ASSERT_FALSE(alt::cache_warm_up_t::deserialize_block_ids("garbage", &parsed));
+}
+
+TPTEST(PageTest, WarmUp, 4) {
+    const size_t num_blocks = 10;
+    mock_ser_t mock;
+    std::vector<block_id_t> block_ids = create_blocks(&mock, num_blocks);
+    std::vector<block_id_t> used_blocks(block_ids.begin(),
+                                        block_ids.begin() + num_blocks / 2);
+    temp_file_t file;
+    const std::string file_path = file.name().permanent_path();
+
+    dummy_cache_balancer_t balancer(GIGABYTE);
+    {
+        test_cache_t page_cache(mock.ser.get(), &balancer, mock.throttler.get());
+        // The file doesn't list any blocks yet.
+        alt::cache_warm_up_t warm_up(&page_cache, file_path);
+        warm_up.warm_up_done()->wait();
+        ASSERT_EQ(used_blocks.size(), read_blocks(&page_cache, used_blocks));
+    }
+
+    // After the "restart", the cache loads the blocks that were used before.
+    test_cache_t page_cache(mock.ser.get(), &balancer, mock.throttler.get());
+    alt::cache_warm_up_t warm_up(&page_cache, file_path);
+    warm_up.warm_up_done()->wait();
+    std::vector<block_id_t> resident = page_cache.resident_block_ids();
+    std::sort(resident.begin(), resident.end());
+    std::sort(used_blocks.begin(), used_blocks.end());
+    ASSERT_EQ(used_blocks, resident);
+}
+
+TPTEST(PageTest, PeekCleanPage, 4) {
+    const size_t num_blocks = 4;
+    mock_ser_t mock;
+    std::vector<block_id_t> block_ids = create_blocks(&mock, num_blocks);
+
+    dummy_cache_balancer_t balancer(GIGABYTE);
+    test_cache_t page_cache(mock.ser.get(), &balancer, mock.throttler.get());
+    // Blocks that aren't in memory have to be acquired.
+    ASSERT_TRUE(page_cache.peek_clean_page(block_ids[0]) == nullptr);
+
+    ASSERT_EQ(num_blocks, read_blocks(&page_cache, block_ids));
+    const char *buf
+        = static_cast<const char *>(page_cache.peek_clean_page(block_ids[0]));
+    ASSERT_TRUE(buf != nullptr);
+    ASSERT_EQ('d', buf[0]);
+
+    // Neither can we peek at a block that a writer holds.
+    auto txn = make_scoped<test_txn_t>(&page_cache);
+    {
+        current_test_acq_t acq(txn.get(), block_ids[1], access_t::write);
+        ASSERT_TRUE(page_cache.peek_clean_page(block_ids[1]) == nullptr);
+        ASSERT_TRUE(page_cache.peek_clean_page(block_ids[2]) != nullptr);
+    }
+    ASSERT_TRUE(page_cache.peek_clean_page(block_ids[1]) != nullptr);
+    page_cache.flush(std::move(txn));
+}
+
+TPTEST(PageTest, CoalescedFlushes, 4) {
+    // More hard durability txn's than the cache flushes at a time, so that the later
+    // ones have to be written together.
+    const size_t num_txns = 3 * PAGE_CACHE_MAX_ACTIVE_FLUSHES;
+    mock_ser_t mock;
+    dummy_cache_balancer_t balancer(GIGABYTE);
+    test_cache_t page_cache(mock.ser.get(), &balancer, mock.throttler.get());
+
+    std::vector<block_id_t> block_ids;
+    std::vector<page_txn_complete_cb_t> flush_cbs(num_txns);
+    for (size_t i = 0; i < num_txns; ++i) {
+        auto txn = make_scoped<test_txn_t>(&page_cache);
+        {
+            current_test_acq_t acq(txn.get(), alt_create_t::create);
+            block_ids.push_back(acq.block_id());
+            test_acq_t page_acq;
+            page_acq.init(acq.current_page_for_write(), &page_cache);
+            memset(page_acq.get_buf_write(), 'd', page_cache.max_block_size().value());
+        }
+        page_cache.flush_and_destroy_txn(std::move(txn), write_durability_t::HARD,
+                                         &flush_cbs[i]);
+    }
+    for (page_txn_complete_cb_t &cb : flush_cbs) {
+        cb.cond.wait();
+    }
+
+    for (block_id_t block_id : block_ids) {
+        ASSERT_TRUE(mock.ser->index_read(block_id).has());
+    }
+    ASSERT_EQ(num_txns, read_blocks(&page_cache, block_ids));
+}
+
 struct WriteWaitForFlush_state_t {
     block_id_t block_id;
     cond_t coro_1_begin;
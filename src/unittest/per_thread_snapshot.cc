@@ -0,0 +1,45 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#include "arch/timing.hpp"
+#include "concurrency/cond_var.hpp"
+#include "concurrency/per_thread_snapshot.hpp"
+#include "unittest/unittest_utils.hpp"
+#include "unittest/gtest.hpp"
+
+namespace unittest {
+
+TPTEST(PerThreadSnapshot, PublishReachesEveryThread, 4) {
+    per_thread_snapshot_t<int> snapshot(0);
+    std::shared_ptr<const int> held = snapshot.get();
+
+    for (int i = 1; i < 50; ++i) {
+        snapshot.publish(i);
+        pmap(get_num_threads(), [&](int thread) {
+            on_thread_t thread_switcher((threadnum_t(thread)));
+            EXPECT_EQ(i, *snapshot.get());
+        });
+    }
+
+    /* A reader that took the value before the publishes still sees the old copy. */
+    EXPECT_EQ(0, *held);
+}
+
+TPTEST(PerThreadSnapshot, RunUntilSatisfied, 2) {
+    per_thread_snapshot_t<int> snapshot(0);
+    cond_t publisher_done;
+    coro_t::spawn_sometime([&]() {
+        for (int i = 1; i <= 10; ++i) {
+            snapshot.publish(i);
+        }
+        publisher_done.pulse();
+    });
+    {
+        on_thread_t thread_switcher((threadnum_t(1)));
+        signal_timer_t timer;
+        timer.start(5000);
+        snapshot.run_until_satisfied([](int value) { return value == 10; }, &timer);
+        EXPECT_EQ(10, *snapshot.get());
+    }
+    publisher_done.wait();
+}
+
+}  // namespace unittest
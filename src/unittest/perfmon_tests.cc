@@ -5,8 +5,12 @@
 
 #include <cmath>  // for std::isnan -- read the comment below.
 
+#include "perfmon/collect.hpp"
+#include "perfmon/memory.hpp"
 #include "perfmon/perfmon.hpp"
+#include "rdb_protocol/slow_query_log.hpp"
 #include "unittest/gtest.hpp"
+#include "unittest/unittest_utils.hpp"
 
 namespace unittest {
 
@@ -57,4 +61,51 @@ TEST(PerfmonTest, StddevComputation) {
     }
 }
 
+TPTEST(PerfmonTest, SlowQueryLog) {
+    slow_query_log_t log(ticks_t{MILLION});
+    EXPECT_FALSE(log.is_slow(ticks_t{MILLION - 1}));
+    EXPECT_TRUE(log.is_slow(ticks_t{MILLION}));
+    EXPECT_FALSE(slow_query_log_t(ticks_t{0}).is_slow(ticks_t{BILLION}));
+
+    // Only the most recent entries are kept.
+    const size_t num_entries = slow_query_log_t::MAX_ENTRIES_PER_THREAD + 5;
+    for (size_t i = 0; i < num_entries; ++i) {
+        slow_query_log_entry_t entry;
+        entry.id = generate_uuid();
+        entry.time = i;
+        entry.duration = ticks_t{MILLION};
+        entry.batch = 0;
+        entry.client_port = 0;
+        entry.rows_returned = i;
+        log.record(std::move(entry));
+    }
+    void *ctx = log.begin_stats();
+    log.visit_stats(ctx);
+    ql::datum_t stats = log.end_stats(ctx);
+    ASSERT_EQ(slow_query_log_t::MAX_ENTRIES_PER_THREAD, stats.arr_size());
+    EXPECT_EQ(5, stats.get(0).get_field("rows_returned").as_num());
+    EXPECT_EQ(ql::datum_t::null(), stats.get(0).get_field("shards_touched"));
+}
+
+double get_disk_backed_queue_memory() {
+    return perfmon_get_stats().get_field("memory")
+        .get_field("disk_backed_queues_bytes").as_num();
+}
+
+TPTEST(PerfmonTest, TrackedMemory) {
+    const double initial = get_disk_backed_queue_memory();
+    {
+        tracked_memory_t memory(memory_tag_t::disk_backed_queues, 1000);
+        EXPECT_EQ(initial + 1000, get_disk_backed_queue_memory());
+        memory.set_size(300);
+        EXPECT_EQ(initial + 300, get_disk_backed_queue_memory());
+
+        // Moving the memory doesn't count it twice.
+        tracked_memory_t moved(std::move(memory));
+        EXPECT_EQ(0u, memory.size());
+        EXPECT_EQ(initial + 300, get_disk_backed_queue_memory());
+    }
+    EXPECT_EQ(initial, get_disk_backed_queue_memory());
+}
+
 }  // namespace unittest
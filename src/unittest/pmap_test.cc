@@ -0,0 +1,29 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#include <vector>
+
+#include "arch/runtime/runtime.hpp"
+#include "arch/timing.hpp"
+#include "concurrency/pmap.hpp"
+#include "unittest/gtest.hpp"
+#include "unittest/unittest_utils.hpp"
+
+namespace unittest {
+
+TEST(PmapTest, OnAllThreads) {
+    run_in_thread_pool([&]() {
+        std::vector<int> calls(get_num_threads(), 0);
+        pmap_on_all_threads([&](int thread) {
+            ASSERT_EQ(thread, get_thread_id().threadnum);
+            // Make some of the calls block, and some finish after the others.
+            if (thread % 2 == 1) {
+                nap(thread);
+            }
+            ++calls[thread];
+        });
+        for (int count : calls) {
+            ASSERT_EQ(1, count);
+        }
+    }, 4);
+}
+
+}  // namespace unittest
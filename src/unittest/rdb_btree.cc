@@ -28,56 +28,60 @@
 
 namespace unittest {
 
+void insert_row(int id, const ql::datum_t &row, store_t *store) {
+    cond_t dummy_interruptor;
+    scoped_ptr_t<txn_t> txn;
+    {
+        scoped_ptr_t<real_superblock_t> superblock;
+        write_token_t token;
+        store->new_write_token(&token);
+        store->acquire_superblock_for_write(
+            1, write_durability_t::SOFT,
+            &token, &txn, &superblock, &dummy_interruptor);
+        buf_lock_t sindex_block(
+            superblock->expose_buf(),
+            superblock->get_sindex_block_id(),
+            access_t::write);
+
+        point_write_response_t response;
+
+        store_key_t pk(ql::datum_t(static_cast<double>(id)).print_primary());
+        rdb_modification_report_t mod_report(pk);
+        rdb_live_deletion_context_t deletion_context;
+        rdb_set(
+            pk,
+            row,
+            false, store->btree.get(), repli_timestamp_t::distant_past,
+            superblock.get(), &deletion_context, &response, &mod_report.info,
+            static_cast<profile::trace_t *>(NULL));
+
+        store_t::sindex_access_vector_t sindexes;
+        store->acquire_all_sindex_superblocks_for_write(&sindex_block, &sindexes);
+        rdb_update_sindexes(
+            store,
+            sindexes,
+            &mod_report,
+            txn.get(),
+            &deletion_context,
+            nullptr,
+            nullptr,
+            nullptr);
+
+        new_mutex_in_line_t acq = store->get_in_line_for_sindex_queue(&sindex_block);
+        store->sindex_queue_push(mod_report, &acq);
+    }
+    txn->commit();
+}
+
 void insert_rows(int start, int finish, store_t *store) {
     ql::configured_limits_t limits;
 
     guarantee(start <= finish);
     for (int i = start; i < finish; ++i) {
-        cond_t dummy_interruptor;
-        scoped_ptr_t<txn_t> txn;
-        {
-            scoped_ptr_t<real_superblock_t> superblock;
-            write_token_t token;
-            store->new_write_token(&token);
-            store->acquire_superblock_for_write(
-                1, write_durability_t::SOFT,
-                &token, &txn, &superblock, &dummy_interruptor);
-            buf_lock_t sindex_block(
-                superblock->expose_buf(),
-                superblock->get_sindex_block_id(),
-                access_t::write);
-
-            std::string data = strprintf("{\"id\" : %d, \"sid\" : %d}", i, i * i);
-            point_write_response_t response;
-
-            store_key_t pk(ql::datum_t(static_cast<double>(i)).print_primary());
-            rdb_modification_report_t mod_report(pk);
-            rdb_live_deletion_context_t deletion_context;
-            rapidjson::Document doc;
-            doc.Parse(data.c_str());
-            rdb_set(
-                pk,
-                ql::to_datum(doc, limits, reql_version_t::LATEST),
-                false, store->btree.get(), repli_timestamp_t::distant_past,
-                superblock.get(), &deletion_context, &response, &mod_report.info,
-                static_cast<profile::trace_t *>(NULL));
-
-            store_t::sindex_access_vector_t sindexes;
-            store->acquire_all_sindex_superblocks_for_write(&sindex_block, &sindexes);
-            rdb_update_sindexes(
-                store,
-                sindexes,
-                &mod_report,
-                txn.get(),
-                &deletion_context,
-                nullptr,
-                nullptr,
-                nullptr);
-
-            new_mutex_in_line_t acq = store->get_in_line_for_sindex_queue(&sindex_block);
-            store->sindex_queue_push(mod_report, &acq);
-        }
-        txn->commit();
+        std::string data = strprintf("{\"id\" : %d, \"sid\" : %d}", i, i * i);
+        rapidjson::Document doc;
+        doc.Parse(data.c_str());
+        insert_row(i, ql::to_datum(doc, limits, reql_version_t::LATEST), store);
     }
 }
 
@@ -110,10 +114,10 @@ void spawn_writes(store_t *store, cond_t *background_inserts_done) {
                 store, background_inserts_done));
 }
 
-ql::grouped_t<ql::stream_t> read_row_via_sindex(
+ql::grouped_t<ql::stream_t> read_rows_via_sindex(
         store_t *store,
         const sindex_name_t &sindex_name,
-        int sindex_value) {
+        const ql::datumspec_t &datumspec) {
     cond_t dummy_interruptor;
     read_token_t token;
     store->new_read_token(&token);
@@ -146,7 +150,6 @@ ql::grouped_t<ql::stream_t> read_row_via_sindex(
     }
 
     rget_read_response_t res;
-    ql::datum_range_t datum_range(ql::datum_t(static_cast<double>(sindex_value)));
     /* The only thing this does is have a NULL `profile::trace_t *` in it which
      * prevents to profiling code from crashing. */
     ql::env_t dummy_env(&dummy_interruptor,
@@ -156,8 +159,8 @@ ql::grouped_t<ql::stream_t> read_row_via_sindex(
     rdb_rget_secondary_slice(
         store->get_sindex_slice(sindex_uuid),
         region_t(),
-        ql::datumspec_t(datum_range),
-        datum_range.to_sindex_keyrange(reql_version_t::LATEST),
+        datumspec,
+        datumspec.covering_range().to_sindex_keyrange(reql_version_t::LATEST),
         sindex_sb.get(),
         &dummy_env, // env_t
         ql::batchspec_t::default_for(ql::batch_type_t::NORMAL),
@@ -176,6 +179,17 @@ ql::grouped_t<ql::stream_t> read_row_via_sindex(
     return *groups;
 }
 
+ql::grouped_t<ql::stream_t> read_row_via_sindex(
+        store_t *store,
+        const sindex_name_t &sindex_name,
+        int sindex_value) {
+    return read_rows_via_sindex(
+        store,
+        sindex_name,
+        ql::datumspec_t(
+            ql::datum_range_t(ql::datum_t(static_cast<double>(sindex_value)))));
+}
+
 void _check_keys_are_present(store_t *store,
         sindex_name_t sindex_name) {
     ql::configured_limits_t limits;
@@ -373,6 +387,185 @@ TPTEST(RDBBtree, SindexEraseRange) {
     check_keys_are_NOT_present(&store, sindex_name);
 }
 
+TPTEST(RDBBtree, SindexDeleteRange) {
+    recreate_temporary_directory(base_path_t("."));
+    temp_file_t temp_file;
+
+    io_backender_t io_backender(file_direct_io_mode_t::buffered_desired);
+    dummy_cache_balancer_t balancer(GIGABYTE);
+
+    filepath_file_opener_t file_opener(temp_file.name(), &io_backender);
+    log_serializer_t::create(
+        &file_opener,
+        log_serializer_t::static_config_t());
+
+    log_serializer_t serializer(
+        log_serializer_t::dynamic_config_t(),
+        &file_opener,
+        &get_global_perfmon_collection());
+
+    store_t store(
+            region_t::universe(),
+            &serializer,
+            &balancer,
+            "unit_test_store",
+            true,
+            &get_global_perfmon_collection(),
+            nullptr,
+            &io_backender,
+            base_path_t("."),
+            generate_uuid(),
+            update_sindexes_t::UPDATE,
+            which_cpu_shard_t{0, 1});
+
+    cond_t dummy_interruptor;
+
+    insert_rows(0, (TOTAL_KEYS_TO_INSERT * 9) / 10, &store);
+
+    sindex_name_t sindex_name = create_sindex(&store);
+
+    cond_t background_inserts_done;
+    spawn_writes(&store, &background_inserts_done);
+    background_inserts_done.wait();
+
+    check_keys_are_present(&store, sindex_name);
+
+    /* Now we delete all of the keys we just inserted, a few at a time, like a
+    `range_delete_t` does. */
+    size_t total_deleted = 0;
+    for (continue_bool_t done = continue_bool_t::CONTINUE;
+         done == continue_bool_t::CONTINUE;) {
+        write_token_t token;
+        store.new_write_token(&token);
+
+        scoped_ptr_t<txn_t> txn;
+        {
+            scoped_ptr_t<real_superblock_t> super_block;
+            store.acquire_superblock_for_write(
+                1,
+                write_durability_t::SOFT,
+                &token,
+                &txn,
+                &super_block,
+                &dummy_interruptor);
+
+            buf_lock_t sindex_block(
+                super_block->expose_buf(),
+                super_block->get_sindex_block_id(),
+                access_t::write);
+
+            rdb_live_deletion_context_t deletion_context;
+            std::vector<rdb_modification_report_t> mod_reports;
+            key_range_t deleted_range;
+            done = rdb_delete_small_range(
+                store.btree.get(),
+                repli_timestamp_t::distant_past.next(),
+                key_range_t::universe(),
+                super_block.get(),
+                &deletion_context,
+                &dummy_interruptor,
+                100,
+                &mod_reports,
+                &deleted_range);
+            ASSERT_LE(mod_reports.size(), 100u);
+            total_deleted += mod_reports.size();
+
+            super_block.reset();
+            if (!mod_reports.empty()) {
+                store.update_sindexes(txn.get(), &sindex_block, mod_reports, true);
+            }
+        }
+        txn->commit();
+    }
+
+    ASSERT_EQ(static_cast<size_t>(TOTAL_KEYS_TO_INSERT), total_deleted);
+    check_keys_are_NOT_present(&store, sindex_name);
+}
+
+// Counts how often each row shows up in the result of a `get_all` over the index.
+std::map<int, int> count_rows_via_sindex(
+        store_t *store,
+        const sindex_name_t &sindex_name,
+        const std::map<ql::datum_t, uint64_t> &values) {
+    ql::grouped_t<ql::stream_t> groups =
+        read_rows_via_sindex(store, sindex_name, ql::datumspec_t(values));
+    std::map<int, int> counts;
+    for (auto &&group : groups) {
+        for (const auto &substream : group.second.substreams) {
+            for (const ql::rget_item_t &item : substream.second.stream) {
+                counts[static_cast<int>(
+                    item.data.get_field("id").as_num())] += 1;
+            }
+        }
+    }
+    return counts;
+}
+
+TPTEST(RDBBtree, SindexGetAllTruncatedAndDuplicates) {
+    recreate_temporary_directory(base_path_t("."));
+    temp_file_t temp_file;
+
+    io_backender_t io_backender(file_direct_io_mode_t::buffered_desired);
+    dummy_cache_balancer_t balancer(GIGABYTE);
+
+    filepath_file_opener_t file_opener(temp_file.name(), &io_backender);
+    log_serializer_t::create(
+        &file_opener,
+        log_serializer_t::static_config_t());
+
+    log_serializer_t serializer(
+        log_serializer_t::dynamic_config_t(),
+        &file_opener,
+        &get_global_perfmon_collection());
+
+    store_t store(
+            region_t::universe(),
+            &serializer,
+            &balancer,
+            "unit_test_store",
+            true,
+            &get_global_perfmon_collection(),
+            nullptr,
+            &io_backender,
+            base_path_t("."),
+            generate_uuid(),
+            update_sindexes_t::UPDATE,
+            which_cpu_shard_t{0, 1});
+
+    sindex_name_t sindex_name = create_sindex(&store);
+
+    // The first three values only differ after the part of them that fits into the
+    // index keys, so the key ranges of their `get_all`s overlap.
+    const std::string prefix(ql::datum_t::max_trunc_size(), 'x');
+    const ql::datum_t long_a(datum_string_t(prefix + "a"));
+    const ql::datum_t long_b(datum_string_t(prefix + "b"));
+    const ql::datum_t long_c(datum_string_t(prefix + "c"));
+    const ql::datum_t short_d(datum_string_t("d"));
+    const std::vector<ql::datum_t> sids = {long_a, long_b, long_c, short_d, long_a};
+    for (size_t i = 0; i < sids.size(); ++i) {
+        ql::datum_object_builder_t row;
+        row.overwrite("id", ql::datum_t(static_cast<double>(i)));
+        row.overwrite("sid", sids[i]);
+        insert_row(static_cast<int>(i), std::move(row).to_datum(), &store);
+    }
+
+    // `long_a` is in the `get_all` twice, so its rows have to come back twice.
+    std::map<ql::datum_t, uint64_t> values;
+    values[long_a] = 2;
+    values[long_b] = 1;
+    values[short_d] = 1;
+    const std::map<int, int> expected = {{0, 2}, {1, 1}, {3, 1}, {4, 2}};
+
+    for (int i = 0; i < MAX_RETRIES_FOR_SINDEX_POSTCONSTRUCT; ++i) {
+        try {
+            ASSERT_EQ(expected, count_rows_via_sindex(&store, sindex_name, values));
+            return;
+        } catch (const sindex_not_ready_exc_t&) { }
+        nap(500);
+    }
+    ADD_FAILURE() << "Sindex still not available after many tries.";
+}
+
 TPTEST(RDBBtree, SindexInterruptionViaDrop) {
     recreate_temporary_directory(base_path_t("."));
     temp_file_t temp_file;
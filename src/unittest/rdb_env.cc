@@ -246,6 +246,15 @@ void NORETURN mock_namespace_interface_t::write_visitor_t::operator()(const sync
     throw cannot_perform_query_exc_t("unimplemented", query_state_t::FAILED);
 }
 
+void NORETURN mock_namespace_interface_t::write_visitor_t::operator()(const ttl_expire_t &) {
+    throw cannot_perform_query_exc_t("unimplemented", query_state_t::FAILED);
+}
+
+void NORETURN mock_namespace_interface_t::write_visitor_t::operator()(
+        const range_delete_t &) {
+    throw cannot_perform_query_exc_t("unimplemented", query_state_t::FAILED);
+}
+
 mock_namespace_interface_t::write_visitor_t::write_visitor_t(
             mock_namespace_interface_t *_parent,
             write_response_t *_response) :
@@ -98,6 +98,8 @@ private:
         void NORETURN operator()(UNUSED const point_write_t &w);
         void NORETURN operator()(UNUSED const point_delete_t &d);
         void NORETURN operator()(UNUSED const sync_t &s);
+        void NORETURN operator()(UNUSED const ttl_expire_t &te);
+        void NORETURN operator()(UNUSED const range_delete_t &rd);
 
         write_visitor_t(mock_namespace_interface_t *parent, write_response_t *_response);
 
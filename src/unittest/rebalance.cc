@@ -70,4 +70,24 @@ TEST(Rebalance, MaxKeyLength) {
     do_rebalance(distribution, 3);
 }
 
+TEST(Rebalance, HotRange) {
+    std::map<store_key_t, int64_t> distribution;
+    for (char c = 'a'; c <= 'p'; ++c) {
+        distribution[store_key_t(std::string(1, c))] = 10;
+    }
+    std::map<store_key_t, int64_t> load;
+    EXPECT_EQ(distribution, combine_distribution_with_load(distribution, load));
+
+    table_shard_scheme_t by_count = do_rebalance(distribution, 2);
+    ASSERT_EQ(1u, by_count.split_points.size());
+    EXPECT_LT(by_count.split_points[0], store_key_t("k"));
+
+    /* All of the load goes to the last key, like appends to a time series */
+    load[store_key_t("p")] = 1600;
+    table_shard_scheme_t by_load =
+        do_rebalance(combine_distribution_with_load(distribution, load), 2);
+    ASSERT_EQ(1u, by_load.split_points.size());
+    EXPECT_GT(by_load.split_points[0], store_key_t("o"));
+}
+
 }  // namespace unittest
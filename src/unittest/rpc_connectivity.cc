@@ -32,16 +32,20 @@ public:
         cluster_message_handler_t(cm, _tag),
         sequence_number(0)
         { }
-    void send(int message, peer_id_t peer) {
+    void send(int message, peer_id_t peer,
+            connectivity_cluster_t::message_class_t message_class =
+                connectivity_cluster_t::message_class_t::CONTROL) {
         auto_drainer_t::lock_t connection_keepalive;
         connectivity_cluster_t::connection_t *connection =
             get_connectivity_cluster()->get_connection(peer, &connection_keepalive);
         if (connection) {
-            send(message, connection, connection_keepalive);
+            send(message, connection, connection_keepalive, message_class);
         }
     }
     void send(int message, connectivity_cluster_t::connection_t *connection,
-            auto_drainer_t::lock_t connection_keepalive) {
+            auto_drainer_t::lock_t connection_keepalive,
+            connectivity_cluster_t::message_class_t message_class =
+                connectivity_cluster_t::message_class_t::CONTROL) {
         class writer_t : public cluster_send_message_write_callback_t {
         public:
             explicit writer_t(int _data) : data(_data) { }
@@ -60,7 +64,7 @@ public:
             int32_t data;
         } writer(message);
         get_connectivity_cluster()->send_message(connection, connection_keepalive,
-            get_message_tag(), &writer);
+            get_message_tag(), &writer, message_class);
     }
     void expect(int message, peer_id_t peer) {
         expect_delivered(message);
@@ -241,6 +245,41 @@ TPTEST_MULTITHREAD(RPCConnectivityTest, Ordering, 3) {
     }
 }
 
+/* `ParallelStreams` checks that two servers that both have parallel streams turned on
+open a stream for each message class, and that messages get delivered over them. */
+
+TPTEST_MULTITHREAD(RPCConnectivityTest, ParallelStreams, 3) {
+    connectivity_cluster_t c1, c2;
+    recording_test_application_t a1(&c1, 'T'), a2(&c2, 'T');
+    test_cluster_run_t cr1(&c1, peer_address_t(), true);
+    test_cluster_run_t cr2(&c2, peer_address_t(), true);
+
+    cr1.join(get_cluster_local_address(&c2), 0);
+
+    let_stuff_happen();
+
+    auto_drainer_t::lock_t connection_keepalive;
+    connectivity_cluster_t::connection_t *connection =
+        c1.get_connection(c2.get_me(), &connection_keepalive);
+    ASSERT_TRUE(connection != nullptr);
+    typedef connectivity_cluster_t::message_class_t message_class_t;
+    EXPECT_FALSE(connection->has_stream(message_class_t::CONTROL));
+    EXPECT_TRUE(connection->has_stream(message_class_t::QUERY));
+    EXPECT_TRUE(connection->has_stream(message_class_t::BACKFILL));
+
+    a1.send(1, c2.get_me(), message_class_t::CONTROL);
+    a1.send(2, c2.get_me(), message_class_t::QUERY);
+    a1.send(3, c2.get_me(), message_class_t::BACKFILL);
+    a2.send(4, c1.get_me(), message_class_t::BACKFILL);
+
+    let_stuff_happen();
+
+    a2.expect(1, c1.get_me());
+    a2.expect(2, c1.get_me());
+    a2.expect(3, c1.get_me());
+    a1.expect(4, c2.get_me());
+}
+
 /* `GetConnections` confirms that the behavior of `cluster_t::get_connections()` is
 correct. */
 
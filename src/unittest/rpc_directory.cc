@@ -120,6 +120,43 @@ TPTEST(RPCDirectoryTest, MapUpdate) {
         rm2.get_root_view()->get_key(std::make_pair(c1.get_me(), 102)));
 }
 
+/* `MapDelta` tests that large values that change a little at a time arrive intact
+when they're sent as deltas, and that several keys changing at once all arrive. */
+TPTEST(RPCDirectoryTest, MapDelta) {
+    connectivity_cluster_t c1, c2;
+    directory_map_read_manager_t<int, std::string> rm1(&c1, 'D'), rm2(&c2, 'D');
+    watchable_map_var_t<int, std::string> w1, w2;
+    std::string big(10000, 'a');
+    w1.set_key(1, big);
+    directory_map_write_manager_t<int, std::string> wm1(&c1, 'D', &w1),
+                                                    wm2(&c2, 'D', &w2);
+    test_cluster_run_t cr1(&c1);
+    test_cluster_run_t cr2(&c2);
+    cr2.join(get_cluster_local_address(&c1), 0);
+    let_stuff_happen();
+    ASSERT_TRUE(optional<std::string>(big) ==
+        rm2.get_root_view()->get_key(std::make_pair(c1.get_me(), 1)));
+    for (size_t i = 0; i < 5; ++i) {
+        big[i * 1000] = 'b';
+        w1.set_key(1, big);
+        w1.set_key(static_cast<int>(i) + 2, big.substr(i));
+        let_stuff_happen();
+        ASSERT_TRUE(optional<std::string>(big) ==
+            rm2.get_root_view()->get_key(std::make_pair(c1.get_me(), 1)));
+        ASSERT_TRUE(optional<std::string>(big.substr(i)) ==
+            rm2.get_root_view()->get_key(
+                std::make_pair(c1.get_me(), static_cast<int>(i) + 2)));
+    }
+    big.append("tail");
+    w1.set_key(1, big);
+    w1.delete_key(2);
+    let_stuff_happen();
+    ASSERT_TRUE(optional<std::string>(big) ==
+        rm2.get_root_view()->get_key(std::make_pair(c1.get_me(), 1)));
+    ASSERT_TRUE(optional<std::string>() ==
+        rm2.get_root_view()->get_key(std::make_pair(c1.get_me(), 2)));
+}
+
 /* `DestructorRace` tests a nasty race condition that we had at some point. */
 TPTEST(RPCDirectoryTest, DestructorRace) {
     connectivity_cluster_t c;
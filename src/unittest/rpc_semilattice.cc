@@ -216,6 +216,33 @@ TPTEST_MULTITHREAD(RPCSemilatticeTest, MemberView, 3) {
     EXPECT_EQ(9u, foo_view->get().i);
 }
 
+inline bool operator==(const sl_int_t &a, const sl_int_t &b) {
+    return a.i == b.i;
+}
+
+/* `MapDiff` tests that `semilattice_diff()` on a map only returns the entries that
+changed, and that joining them gives the same result as the original join. */
+TEST(RPCSemilatticeTest, MapDiff) {
+    std::map<std::string, sl_int_t> before;
+    before["foo"] = sl_int_t(1);
+    before["bar"] = sl_int_t(2);
+    std::map<std::string, sl_int_t> added = before;
+    added["bar"] = sl_int_t(4);
+    added["baz"] = sl_int_t(1);
+    std::map<std::string, sl_int_t> after = before;
+    semilattice_join(&after, added);
+
+    std::map<std::string, sl_int_t> diff;
+    semilattice_diff(before, after, &diff);
+    EXPECT_EQ(2u, diff.size());
+    EXPECT_EQ(0u, diff.count("foo"));
+    EXPECT_EQ(6u, diff["bar"].i);
+    EXPECT_EQ(1u, diff["baz"].i);
+
+    semilattice_join(&before, diff);
+    EXPECT_TRUE(before == after);
+}
+
 }   /* namespace unittest */
 
 #include "rpc/semilattice/semilattice_manager.tcc"
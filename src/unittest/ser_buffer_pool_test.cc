@@ -0,0 +1,88 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#include <set>
+#include <vector>
+
+#include "arch/runtime/coroutines.hpp"
+#include "serializer/buf_ptr.hpp"
+#include "serializer/ser_buffer_pool.hpp"
+#include "unittest/gtest.hpp"
+#include "unittest/unittest_utils.hpp"
+
+namespace unittest {
+
+TPTEST(SerBufferPoolTest, ReusesBuffers) {
+    const block_size_t size = block_size_t::unsafe_make(DEFAULT_BTREE_BLOCK_SIZE);
+    buf_ptr_t buf = buf_ptr_t::alloc_uninitialized(size);
+    ser_buffer_t *const ptr = buf.ser_buffer();
+    buf.reset();
+
+    buf_ptr_t other = buf_ptr_t::alloc_uninitialized(size);
+    ASSERT_EQ(ptr, other.ser_buffer());
+
+    // Buffers of other sizes don't get mixed up with it.
+    buf_ptr_t smaller = buf_ptr_t::alloc_zeroed(block_size_t::unsafe_make(1000));
+    ASSERT_NE(ptr, smaller.ser_buffer());
+    for (uint16_t i = 0; i < smaller.aligned_block_size(); ++i) {
+        ASSERT_EQ(0, reinterpret_cast<char *>(smaller.ser_buffer())[i]);
+    }
+}
+
+TPTEST(SerBufferPoolTest, BuffersMoveBetweenThreads, 2) {
+    const block_size_t size = block_size_t::unsafe_make(DEFAULT_BTREE_BLOCK_SIZE);
+    const size_t count = 4 * MEGABYTE / DEFAULT_BTREE_BLOCK_SIZE;
+
+    // Allocate the buffers on one thread, and free them on another one.  That
+    // thread can't keep them all, so it passes some of them on to the depot.
+    std::vector<buf_ptr_t> bufs;
+    std::set<ser_buffer_t *> ptrs;
+    for (size_t i = 0; i < count; ++i) {
+        bufs.push_back(buf_ptr_t::alloc_uninitialized(size));
+        ptrs.insert(bufs.back().ser_buffer());
+    }
+    {
+        on_thread_t thread_switcher((threadnum_t(1)));
+        bufs.clear();
+    }
+
+    // The first thread gets them back from the depot, once it has used up whatever
+    // other buffers it had lying around.
+    size_t reused = 0;
+    for (size_t i = 0; i < count; ++i) {
+        bufs.push_back(buf_ptr_t::alloc_uninitialized(size));
+        reused += ptrs.count(bufs.back().ser_buffer());
+    }
+    ASSERT_LT(0u, reused);
+}
+
+TPTEST(SerBufferPoolTest, HugePageArena) {
+    // This can only happen once per process, and the kernel might not let us.
+    if (!ser_buffer_pool_enable_huge_pages(huge_page_mode_t::transparent,
+                                           MEGABYTE)) {
+        return;
+    }
+    huge_page_usage_t usage = ser_buffer_pool_huge_page_usage();
+    ASSERT_EQ(huge_page_mode_t::transparent, usage.mode);
+    // The arena is made of whole huge pages.
+    ASSERT_EQ(static_cast<size_t>(2 * MEGABYTE), usage.arena_size);
+
+    // We get buffers out of the arena once the free lists run dry, and the
+    // allocator's once the arena does.  This is more than the free lists can hold.
+    const block_size_t size = block_size_t::unsafe_make(DEFAULT_BTREE_BLOCK_SIZE);
+    const size_t count = 24 * MEGABYTE / DEFAULT_BTREE_BLOCK_SIZE;
+    std::vector<buf_ptr_t> bufs;
+    for (size_t i = 0; i < count; ++i) {
+        bufs.push_back(buf_ptr_t::alloc_zeroed(size));
+    }
+    usage = ser_buffer_pool_huge_page_usage();
+    ASSERT_EQ(usage.arena_size, usage.used_size);
+
+    // Buffers from the arena can be used over again, even once they no longer fit
+    // into the free lists.
+    bufs.clear();
+    for (size_t i = 0; i < count; ++i) {
+        bufs.push_back(buf_ptr_t::alloc_zeroed(size));
+    }
+    ASSERT_EQ(usage.used_size, ser_buffer_pool_huge_page_usage().used_size);
+}
+
+}  // namespace unittest
@@ -1,9 +1,14 @@
 #include <functional>
 
+#include "arch/arch.hpp"
 #include "arch/runtime/starter.hpp"
 #include "concurrency/new_mutex.hpp"
+#include "random.hpp"
 #include "serializer/buf_ptr.hpp"
+#include "serializer/checksum.hpp"
+#include "serializer/log/lba/in_memory_index.hpp"
 #include "serializer/log/log_serializer.hpp"
+#include "serializer/log/striped_file.hpp"
 #include "unittest/mock_file.hpp"
 #include "unittest/gtest.hpp"
 #include "unittest/unittest_utils.hpp"
@@ -30,7 +35,7 @@ void run_AddDeleteRepeatedly(bool perform_index_write) {
 
     buf_ptr_t buf = buf_ptr_t::alloc_zeroed(ser.max_block_size());
 
-    scoped_ptr_t<file_account_t> account(ser.make_io_account(1));
+    scoped_ptr_t<file_account_t> account(ser.make_io_account(1, io_caller_t::other));
 
     // We run enough create/delete operations to run ourselves through the young
     // extent queue and (with perform_index_write true) kick off a GC that reproduces
@@ -90,5 +95,361 @@ TEST(SerializerTest, AddDeleteRepeatedlyWithIndex) {
     run_in_thread_pool(std::bind(run_AddDeleteRepeatedly, true), 4);
 }
 
+void write_and_index_blocks(log_serializer_t *ser,
+                            const std::vector<buf_ptr_t> &bufs) {
+    scoped_ptr_t<file_account_t> account(ser->make_io_account(1, io_caller_t::other));
+    std::vector<buf_write_info_t> infos;
+    for (size_t i = 0; i < bufs.size(); ++i) {
+        infos.push_back(buf_write_info_t(bufs[i].ser_buffer(), bufs[i].block_size(), i));
+    }
+
+    struct : public iocallback_t, public cond_t {
+        void on_io_complete() {
+            pulse();
+        }
+    } cb;
+    std::vector<counted_t<block_token_t>> tokens
+        = ser->block_writes(infos.data(), infos.size(), account.get(), &cb);
+    cb.wait();
+
+    std::vector<index_write_op_t> write_ops;
+    for (size_t i = 0; i < tokens.size(); ++i) {
+        ASSERT_EQ(bufs[i].block_size(), tokens[i]->block_size());
+        write_ops.push_back(index_write_op_t(i, make_optional(tokens[i]),
+                                             make_optional(repli_timestamp_t::distant_past)));
+    }
+    new_mutex_in_line_t dummy_acq;
+    ser->index_write(&dummy_acq, []{ }, write_ops);
+}
+
+void check_indexed_blocks(log_serializer_t *ser, const std::vector<buf_ptr_t> &bufs) {
+    scoped_ptr_t<file_account_t> account(ser->make_io_account(1, io_caller_t::other));
+    for (size_t i = 0; i < bufs.size(); ++i) {
+        counted_t<block_token_t> token = ser->index_read(i);
+        ASSERT_TRUE(token.has());
+        ASSERT_EQ(bufs[i].block_size(), token->block_size());
+        buf_ptr_t read = ser->block_read(token, account.get());
+        ASSERT_EQ(bufs[i].block_size(), read.block_size());
+        ASSERT_EQ(0, memcmp(bufs[i].cache_data(), read.cache_data(),
+                            bufs[i].block_size().value()));
+    }
+}
+
+TPTEST(SerializerTest, CompressedBlocks) {
+    mock_file_opener_t file_opener;
+    log_serializer_t::create(&file_opener, log_serializer_t::static_config_t());
+
+    rng_t rng(42);
+    std::vector<buf_ptr_t> bufs;
+    {
+        log_serializer_t::dynamic_config_t config;
+        config.block_codec = block_codec_t::zlib;
+        log_serializer_t ser(config, &file_opener, &get_global_perfmon_collection());
+
+        // One block that compresses well, and one that doesn't compress at all.
+        bufs.push_back(buf_ptr_t::alloc_zeroed(ser.max_block_size()));
+        char *compressible = static_cast<char *>(bufs[0].cache_data());
+        for (uint16_t i = 0; i < ser.max_block_size().value(); ++i) {
+            compressible[i] = "{\"id\": 1234, \"name\": \"foo\"}"[i % 30];
+        }
+        bufs.push_back(buf_ptr_t::alloc_zeroed(ser.max_block_size()));
+        char *random = static_cast<char *>(bufs[1].cache_data());
+        for (uint16_t i = 0; i < ser.max_block_size().value(); ++i) {
+            random[i] = rng.randint(256);
+        }
+
+        write_and_index_blocks(&ser, bufs);
+        check_indexed_blocks(&ser, bufs);
+    }
+
+    // The uncompressed sizes must survive a restart, even if compression is turned
+    // off now.
+    log_serializer_t ser(log_serializer_t::dynamic_config_t(),
+                         &file_opener, &get_global_perfmon_collection());
+    check_indexed_blocks(&ser, bufs);
+}
+
+// Stripes a serializer file over several mock files, on the given tiers (all hot if
+// `tiers` is empty).
+class striped_mock_file_opener_t : public serializer_file_opener_t {
+public:
+    explicit striped_mock_file_opener_t(
+            size_t stripe_count,
+            const std::vector<storage_tier_t> &tiers = std::vector<storage_tier_t>())
+        : files_(stripe_count), tiers_(tiers) { }
+
+    std::string file_name() const { return "<striped mock file>"; }
+
+    void open_serializer_file_create_temporary(scoped_ptr_t<file_t> *file_out) {
+        std::vector<scoped_ptr_t<file_t> > files = open_files();
+        std::vector<file_t *> raw_files;
+        for (const scoped_ptr_t<file_t> &file : files) {
+            raw_files.push_back(file.get());
+        }
+        striped_file_t::write_stripe_headers(raw_files,
+                                             striped_file_t::default_stripe_size,
+                                             tiers_);
+        file_out->init(new striped_file_t(std::move(files),
+                                          striped_file_t::default_stripe_size,
+                                          tiers_));
+    }
+    void move_serializer_file_to_permanent_location() { }
+    void open_serializer_file_existing(scoped_ptr_t<file_t> *file_out) {
+        std::vector<scoped_ptr_t<file_t> > files = open_files();
+        for (size_t i = 0; i < files.size(); ++i) {
+            stripe_header_t header;
+            ASSERT_TRUE(striped_file_t::read_stripe_header(files[i].get(), &header));
+            ASSERT_EQ(i, header.stripe_index);
+            ASSERT_EQ(files.size(), header.stripe_count);
+            ASSERT_EQ(tiers_.empty() ? storage_tier_t::hot : tiers_[i], header.tier);
+        }
+        file_out->init(new striped_file_t(std::move(files),
+                                          striped_file_t::default_stripe_size,
+                                          tiers_));
+    }
+    void unlink_serializer_file() { }
+
+    const std::vector<std::vector<char> > &files() const { return files_; }
+
+private:
+    std::vector<scoped_ptr_t<file_t> > open_files() {
+        std::vector<scoped_ptr_t<file_t> > files(files_.size());
+        for (size_t i = 0; i < files_.size(); ++i) {
+            files[i].init(new mock_file_t(mock_file_t::mode_rw, &files_[i]));
+        }
+        return files;
+    }
+
+    std::vector<std::vector<char> > files_;
+    const std::vector<storage_tier_t> tiers_;
+};
+
+TPTEST(SerializerTest, StripedFile) {
+    striped_mock_file_opener_t file_opener(3);
+    log_serializer_t::create(&file_opener, log_serializer_t::static_config_t());
+
+    // Enough blocks to fill a few extents.
+    rng_t rng(1234);
+    std::vector<buf_ptr_t> bufs;
+    {
+        log_serializer_t ser(log_serializer_t::dynamic_config_t(),
+                             &file_opener, &get_global_perfmon_collection());
+        for (int i = 0; i < 2000; ++i) {
+            bufs.push_back(buf_ptr_t::alloc_zeroed(ser.max_block_size()));
+            char *data = static_cast<char *>(bufs.back().cache_data());
+            for (int j = 0; j < 64; ++j) {
+                data[j] = rng.randint(256);
+            }
+        }
+        write_and_index_blocks(&ser, bufs);
+        check_indexed_blocks(&ser, bufs);
+    }
+
+    // Every file got some of the data.
+    for (const std::vector<char> &file : file_opener.files()) {
+        EXPECT_LE(striped_file_t::header_size + static_cast<int64_t>(DEFAULT_EXTENT_SIZE),
+                  static_cast<int64_t>(file.size()));
+    }
+
+    log_serializer_t ser(log_serializer_t::dynamic_config_t(),
+                         &file_opener, &get_global_perfmon_collection());
+    check_indexed_blocks(&ser, bufs);
+}
+
+// Counts the datasyncs that a mock file gets on its own.
+class datasync_counting_file_t : public mock_file_t {
+public:
+    datasync_counting_file_t(std::vector<char> *data, int *datasyncs)
+        : mock_file_t(mock_file_t::mode_rw, data), datasyncs_(datasyncs) { }
+    void datasync_async(file_account_t *account, linux_iocallback_t *cb) {
+        ++*datasyncs_;
+        mock_file_t::datasync_async(account, cb);
+    }
+private:
+    int *datasyncs_;
+};
+
+TPTEST(SerializerTest, StripedFileDatasyncsOtherDevices) {
+    const int64_t stripe_size = striped_file_t::default_stripe_size;
+    std::vector<std::vector<char> > contents(3);
+    std::vector<int> datasyncs(3, 0);
+    std::vector<scoped_ptr_t<file_t> > files(3);
+    std::vector<file_t *> raw_files;
+    for (size_t i = 0; i < files.size(); ++i) {
+        files[i].init(new datasync_counting_file_t(&contents[i], &datasyncs[i]));
+        raw_files.push_back(files[i].get());
+    }
+    striped_file_t::write_stripe_headers(raw_files, stripe_size);
+    striped_file_t file(std::move(files), stripe_size);
+    file.set_file_size(3 * stripe_size);
+    ASSERT_EQ(stripe_size, file.device_stripe_size());
+
+    scoped_device_block_aligned_ptr_t<char> buf(DEVICE_BLOCK_SIZE);
+    memset(buf.get(), 1, DEVICE_BLOCK_SIZE);
+    co_write(&file, 0, DEVICE_BLOCK_SIZE, buf.get(), DEFAULT_DISK_ACCOUNT,
+             datasync_op::no_datasyncs);
+    co_write(&file, stripe_size, DEVICE_BLOCK_SIZE, buf.get(), DEFAULT_DISK_ACCOUNT,
+             datasync_op::no_datasyncs);
+    datasyncs.assign(3, 0);
+
+    // A write with a datasync to the third file has to make the writes to the other
+    // two durable first.  Its own file gets synced along with the write.
+    co_write(&file, 2 * stripe_size, DEVICE_BLOCK_SIZE, buf.get(),
+             DEFAULT_DISK_ACCOUNT, datasync_op::wrap_in_datasyncs);
+    EXPECT_EQ(std::vector<int>({1, 1, 0}), datasyncs);
+
+    // Nothing got written to them since.
+    co_write(&file, 2 * stripe_size, DEVICE_BLOCK_SIZE, buf.get(),
+             DEFAULT_DISK_ACCOUNT, datasync_op::wrap_in_datasyncs);
+    EXPECT_EQ(std::vector<int>({1, 1, 0}), datasyncs);
+}
+
+TPTEST(SerializerTest, TieredFile) {
+    std::vector<storage_tier_t> tiers;
+    tiers.push_back(storage_tier_t::hot);
+    tiers.push_back(storage_tier_t::cold);
+    striped_mock_file_opener_t file_opener(2, tiers);
+    log_serializer_t::create(&file_opener, log_serializer_t::static_config_t());
+
+    {
+        scoped_ptr_t<file_t> file;
+        file_opener.open_serializer_file_existing(&file);
+        EXPECT_FALSE(file->device_is_cold(0));
+        EXPECT_TRUE(file->device_is_cold(1));
+    }
+
+    // New blocks go to the hot tier, but reads have to work no matter which tier
+    // anything ended up on.
+    std::vector<buf_ptr_t> bufs;
+    {
+        log_serializer_t ser(log_serializer_t::dynamic_config_t(),
+                             &file_opener, &get_global_perfmon_collection());
+        for (int i = 0; i < 1000; ++i) {
+            bufs.push_back(buf_ptr_t::alloc_zeroed(ser.max_block_size()));
+            static_cast<char *>(bufs.back().cache_data())[0] = i % 256;
+        }
+        write_and_index_blocks(&ser, bufs);
+        check_indexed_blocks(&ser, bufs);
+    }
+
+    log_serializer_t ser(log_serializer_t::dynamic_config_t(),
+                         &file_opener, &get_global_perfmon_collection());
+    check_indexed_blocks(&ser, bufs);
+}
+
+TEST(SerializerTest, InMemoryIndexShards) {
+    in_memory_index_t index;
+    EXPECT_EQ(0u, index.end_block_id());
+    EXPECT_EQ(FIRST_AUX_BLOCK_ID, index.end_aux_block_id());
+
+    // Spread blocks over all the shards, with the largest id in neither the first nor
+    // the last shard.
+    const block_id_t ids[] = { 0, 3, 5, 17, 6, FIRST_AUX_BLOCK_ID + 2,
+                               FIRST_AUX_BLOCK_ID + 9 };
+    for (block_id_t id : ids) {
+        index.set_block_info(id,
+                             is_aux_block_id(id)
+                                 ? repli_timestamp_t::invalid
+                                 : repli_timestamp_t::distant_past,
+                             flagged_off64_t::make(id * DEVICE_BLOCK_SIZE),
+                             100 + id % 1000, id % 7);
+    }
+    EXPECT_EQ(18u, index.end_block_id());
+    EXPECT_EQ(FIRST_AUX_BLOCK_ID + 10, index.end_aux_block_id());
+
+    for (block_id_t id : ids) {
+        index_block_info_t info = index.get_block_info(id);
+        EXPECT_EQ(static_cast<int64_t>(id * DEVICE_BLOCK_SIZE), info.offset.get_value());
+        EXPECT_EQ(100 + id % 1000, info.ser_block_size);
+        EXPECT_EQ(id % 7, info.uncompressed_ser_block_size);
+    }
+    EXPECT_FALSE(index.get_block_info(4).offset.has_value());
+    EXPECT_FALSE(index.get_block_info(FIRST_AUX_BLOCK_ID + 1).offset.has_value());
+}
+
+TEST(SerializerTest, InMemoryIndexPackedValues) {
+    in_memory_index_t index;
+    repli_timestamp_t recency;
+    recency.longtime = 1000000;
+
+    // These all fit the packed encoding, including recencies below the first one.
+    for (block_id_t id = 0; id < 100; ++id) {
+        repli_timestamp_t r;
+        r.longtime = recency.longtime + id * 1000 - 50000;
+        index.set_block_info(id, r, flagged_off64_t::make(id * 7 * DEVICE_BLOCK_SIZE),
+                             4000 + id, id % 2 == 0 ? 0 : 4096);
+    }
+    // This recency is too far away from the others and forces the chunk to be stored
+    // unpacked; nothing should change for the other entries.
+    repli_timestamp_t far_recency;
+    far_recency.longtime = recency.longtime + (uint64_t(1) << 40);
+    index.set_block_info(LBA_SHARD_FACTOR * 200, far_recency,
+                         flagged_off64_t::make(DEVICE_BLOCK_SIZE + 1), 10, 0);
+
+    for (block_id_t id = 0; id < 100; ++id) {
+        index_block_info_t info = index.get_block_info(id);
+        EXPECT_EQ(recency.longtime + id * 1000 - 50000, info.recency.longtime);
+        EXPECT_EQ(static_cast<int64_t>(id * 7 * DEVICE_BLOCK_SIZE),
+                  info.offset.get_value());
+        EXPECT_EQ(4000 + id, info.ser_block_size);
+        EXPECT_EQ(id % 2 == 0 ? 0 : 4096, info.uncompressed_ser_block_size);
+    }
+    index_block_info_t far_info = index.get_block_info(LBA_SHARD_FACTOR * 200);
+    EXPECT_EQ(far_recency, far_info.recency);
+    EXPECT_EQ(DEVICE_BLOCK_SIZE + 1, far_info.offset.get_value());
+
+    // Clearing an entry goes back to the default value.
+    index.set_block_info(3, repli_timestamp_t::invalid, flagged_off64_t::unused(), 0, 0);
+    EXPECT_FALSE(index.get_block_info(3).offset.has_value());
+    EXPECT_EQ(repli_timestamp_t::invalid, index.get_block_info(3).recency);
+}
+
+std::vector<uint32_t> random_checksum_input(rng_t *rng, size_t wordcount) {
+    std::vector<uint32_t> words(wordcount);
+    for (size_t i = 0; i < wordcount; ++i) {
+        // Mix in plenty of 0x00000000, 0x00000001 and 0xFFFFFFFF words, which are the
+        // interesting ones for Fletcher sums on xored inputs.
+        switch (rng->randint(4)) {
+        case 0: words[i] = 0; break;
+        case 1: words[i] = 1; break;
+        case 2: words[i] = 0xFFFFFFFFu; break;
+        default:
+            words[i] = (static_cast<uint32_t>(rng->randint(1 << 16)) << 16)
+                | static_cast<uint32_t>(rng->randint(1 << 16));
+            break;
+        }
+    }
+    return words;
+}
+
+TPTEST(SerializerTest, ChecksumMatchesPortable) {
+    rng_t rng(12345);
+    std::vector<size_t> sizes;
+    for (size_t n = 0; n < 70; ++n) {
+        sizes.push_back(n);
+    }
+    sizes.push_back(1024);
+    sizes.push_back(0xFFFF);
+    sizes.push_back(0x10000);
+    sizes.push_back(0x20000 + 7);
+    for (size_t n : sizes) {
+        std::vector<uint32_t> words = random_checksum_input(&rng, n);
+        ASSERT_EQ(compute_checksum_portable(words.data(), n).value,
+                  compute_checksum(words.data(), n).value) << "wordcount " << n;
+    }
+}
+
+TPTEST(SerializerTest, ChecksumConcat) {
+    rng_t rng(6789);
+    for (int i = 0; i < 100; ++i) {
+        const size_t n = rng.randint(3000);
+        const size_t split = rng.randint(n + 1);
+        std::vector<uint32_t> words = random_checksum_input(&rng, n);
+        serializer_checksum left = compute_checksum(words.data(), split);
+        serializer_checksum right = compute_checksum(words.data() + split, n - split);
+        ASSERT_EQ(compute_checksum(words.data(), n).value,
+                  compute_checksum_concat(left, right, n - split).value);
+    }
+}
 
 }  // namespace unittest
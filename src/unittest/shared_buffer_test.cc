@@ -0,0 +1,36 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#include <string.h>
+
+#include "containers/shared_buffer.hpp"
+#include "unittest/gtest.hpp"
+#include "unittest/unittest_utils.hpp"
+
+namespace unittest {
+
+TPTEST(SharedBufferTest, ReusesSmallBuffers) {
+    counted_t<shared_buf_t> buf = shared_buf_t::create(20);
+    const shared_buf_t *const ptr = buf.get();
+    buf.reset();
+
+    // Sizes that round up to the same size class share buffers.
+    counted_t<shared_buf_t> other = shared_buf_t::create(24);
+    ASSERT_EQ(ptr, other.get());
+    ASSERT_EQ(24u, other->size());
+    memset(other->data(), 'a', other->size());
+
+    counted_t<shared_buf_t> different_class = shared_buf_t::create(100);
+    ASSERT_NE(ptr, different_class.get());
+    ASSERT_EQ(100u, different_class->size());
+}
+
+TPTEST(SharedBufferTest, LargeBuffers) {
+    counted_t<shared_buf_t> buf = shared_buf_t::create(100000);
+    ASSERT_EQ(100000u, buf->size());
+    memset(buf->data(), 'a', buf->size());
+    buf.reset();
+
+    counted_t<shared_buf_t> other = shared_buf_t::create(1);
+    ASSERT_EQ(1u, other->size());
+}
+
+}  // namespace unittest
@@ -0,0 +1,39 @@
+// Copyright 2010-2015 RethinkDB, all rights reserved.
+#include "unittest/gtest.hpp"
+
+#include "rdb_protocol/sindex_count_view.hpp"
+
+namespace unittest {
+
+TEST(SindexCountView, BuildAndApply) {
+    const ql::datum_t a(1.0), b(2.0);
+    sindex_count_view_t view(0);
+    EXPECT_FALSE(view.is_ready());
+
+    // A write that the building read's snapshot doesn't contain.
+    view.apply({a}, {b});
+
+    ql::grouped_t<uint64_t> read_counts;
+    read_counts[a] = 3;
+    view.finish_building(&read_counts);
+    ASSERT_TRUE(view.is_ready());
+
+    ql::grouped_t<uint64_t> counts;
+    ASSERT_TRUE(view.get_counts(10, &counts));
+    EXPECT_EQ(2u, counts.size());
+    EXPECT_EQ(2u, counts[a]);
+    EXPECT_EQ(1u, counts[b]);
+
+    view.apply({a, a}, {});
+    ASSERT_TRUE(view.get_counts(10, &counts));
+    EXPECT_EQ(1u, counts.size());
+    EXPECT_EQ(1u, counts[b]);
+    EXPECT_FALSE(view.get_counts(0, &counts));
+
+    // Removing an entry that the view doesn't know of makes it unusable.
+    view.apply({a}, {});
+    EXPECT_FALSE(view.is_ready());
+    EXPECT_FALSE(view.is_valid());
+}
+
+}  // namespace unittest
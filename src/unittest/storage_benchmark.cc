@@ -0,0 +1,291 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#include <inttypes.h>
+
+#include <string>
+#include <vector>
+
+#include "btree/operations.hpp"
+#include "btree/reql_specific.hpp"
+#include "buffer_cache/alt.hpp"
+#include "buffer_cache/cache_balancer.hpp"
+#include "concurrency/new_mutex.hpp"
+#include "rdb_protocol/btree.hpp"
+#include "repli_timestamp.hpp"
+#include "serializer/buf_ptr.hpp"
+#include "serializer/log/log_serializer.hpp"
+#include "unittest/btree_utils.hpp"
+#include "unittest/gtest.hpp"
+#include "unittest/mock_file.hpp"
+#include "unittest/unittest_utils.hpp"
+
+/* These are micro benchmarks of the storage engine rather than unit tests, so they
+are disabled by default. Run them on a release build with
+
+    rebirthdb-unittest --gtest_also_run_disabled_tests \
+                       --gtest_filter='StorageBenchmark.*'
+
+Every benchmark prints one JSON object per line, so that the results of different
+builds are easy to compare. The serializer runs on a `mock_file_t`, so the numbers
+are for the storage engine's own overhead, not for the disk. */
+
+namespace unittest {
+
+class benchmark_timer_t {
+public:
+    explicit benchmark_timer_t(const char *_name)
+        : name(_name), start(get_ticks()) { }
+
+    void report(uint64_t ops) {
+        const double secs = ticks_to_secs(ticks_t{get_ticks().nanos - start.nanos});
+        printf("{\"benchmark\": \"%s\", \"ops\": %" PRIu64 ", \"seconds\": %.6f, "
+               "\"ops_per_sec\": %.1f}\n",
+               name, ops, secs, secs > 0 ? ops / secs : 0.0);
+    }
+
+private:
+    const char *const name;
+    const ticks_t start;
+};
+
+class benchmark_serializer_t {
+public:
+    benchmark_serializer_t() {
+        log_serializer_t::create(&file_opener, log_serializer_t::static_config_t());
+        ser.init(new log_serializer_t(log_serializer_t::dynamic_config_t(),
+                                      &file_opener,
+                                      &get_global_perfmon_collection()));
+        account.init(ser->make_io_account(1, io_caller_t::other));
+    }
+
+    // Writes `bufs` to the blocks `0` to `bufs.size() - 1`.
+    void write_blocks(const std::vector<buf_ptr_t> &bufs) {
+        std::vector<buf_write_info_t> infos;
+        for (size_t i = 0; i < bufs.size(); ++i) {
+            infos.push_back(
+                buf_write_info_t(bufs[i].ser_buffer(), bufs[i].block_size(), i));
+        }
+        struct : public iocallback_t, public cond_t {
+            void on_io_complete() {
+                pulse();
+            }
+        } cb;
+        std::vector<counted_t<block_token_t> > tokens
+            = ser->block_writes(infos.data(), infos.size(), account.get(), &cb);
+        cb.wait();
+
+        std::vector<index_write_op_t> write_ops;
+        for (size_t i = 0; i < tokens.size(); ++i) {
+            write_ops.push_back(index_write_op_t(
+                i, make_optional(tokens[i]),
+                make_optional(repli_timestamp_t::distant_past)));
+        }
+        new_mutex_in_line_t dummy_acq;
+        ser->index_write(&dummy_acq, []{ }, write_ops);
+    }
+
+    std::vector<buf_ptr_t> make_bufs(size_t count) {
+        std::vector<buf_ptr_t> bufs;
+        for (size_t i = 0; i < count; ++i) {
+            bufs.push_back(buf_ptr_t::alloc_zeroed(ser->max_block_size()));
+        }
+        return bufs;
+    }
+
+    mock_file_opener_t file_opener;
+    scoped_ptr_t<log_serializer_t> ser;
+    scoped_ptr_t<file_account_t> account;
+};
+
+TPTEST(StorageBenchmark, DISABLED_SerializerWriteRead) {
+    const size_t num_blocks = 10000;
+    const size_t batch_size = 100;
+    benchmark_serializer_t bench;
+    const std::vector<buf_ptr_t> bufs = bench.make_bufs(batch_size);
+
+    {
+        benchmark_timer_t timer("serializer_block_write");
+        for (size_t i = 0; i < num_blocks / batch_size; ++i) {
+            bench.write_blocks(bufs);
+        }
+        timer.report(num_blocks);
+    }
+    {
+        benchmark_timer_t timer("serializer_block_read");
+        for (size_t i = 0; i < num_blocks; ++i) {
+            counted_t<block_token_t> token = bench.ser->index_read(i % batch_size);
+            buf_ptr_t buf = bench.ser->block_read(token, bench.account.get());
+        }
+        timer.report(num_blocks);
+    }
+}
+
+/* Overwriting the same blocks over and over turns almost every extent into garbage,
+so this measures how fast writes can go while the GC keeps up with them. */
+TPTEST(StorageBenchmark, DISABLED_SerializerGarbageCollection) {
+    const size_t num_blocks = 100000;
+    const size_t batch_size = 100;
+    benchmark_serializer_t bench;
+    const std::vector<buf_ptr_t> bufs = bench.make_bufs(batch_size);
+
+    benchmark_timer_t timer("serializer_overwrite_with_gc");
+    for (size_t i = 0; i < num_blocks / batch_size; ++i) {
+        bench.write_blocks(bufs);
+    }
+    timer.report(num_blocks);
+}
+
+TPTEST(StorageBenchmark, DISABLED_PageCacheHitMiss) {
+    const int num_blocks = 10000;
+    benchmark_serializer_t bench;
+    dummy_cache_balancer_t balancer(GIGABYTE);
+
+    std::vector<block_id_t> block_ids;
+    {
+        cache_t cache(bench.ser.get(), &balancer, &get_global_perfmon_collection(),
+                      which_cpu_shard_t{0, 1});
+        cache_conn_t cache_conn(&cache);
+        txn_t txn(&cache_conn, write_durability_t::HARD, num_blocks);
+        for (int i = 0; i < num_blocks; ++i) {
+            buf_lock_t lock(buf_parent_t(&txn), alt_create_t::create);
+            buf_write_t write(&lock);
+            write.get_data_write();
+            block_ids.push_back(lock.block_id());
+        }
+        txn.commit();
+    }
+
+    /* A new cache starts out cold, so the first pass only has misses and the second
+    pass only has hits. */
+    cache_t cache(bench.ser.get(), &balancer, &get_global_perfmon_collection(),
+                  which_cpu_shard_t{0, 1});
+    cache_conn_t cache_conn(&cache);
+    for (const char *name : {"page_cache_miss", "page_cache_hit"}) {
+        txn_t txn(&cache_conn, read_access_t::read);
+        benchmark_timer_t timer(name);
+        for (block_id_t block_id : block_ids) {
+            buf_lock_t lock(buf_parent_t(&txn), block_id, access_t::read);
+            buf_read_t read(&lock);
+            read.get_data_read();
+        }
+        timer.report(block_ids.size());
+    }
+}
+
+class benchmark_btree_t {
+public:
+    benchmark_btree_t()
+        : balancer(GIGABYTE),
+          cache(bench.ser.get(), &balancer, &get_global_perfmon_collection(),
+                which_cpu_shard_t{0, 1}),
+          cache_conn(&cache),
+          sizer(cache.max_block_size()),
+          stats(&get_global_perfmon_collection(), "benchmark") {
+        txn_t txn(&cache_conn, write_durability_t::SOFT, 1);
+        {
+            buf_lock_t sb_lock(&txn, SUPERBLOCK_ID, alt_create_t::create);
+            real_superblock_t superblock(std::move(sb_lock));
+            btree_slice_t::init_real_superblock(
+                &superblock, std::vector<char>(), binary_blob_t());
+        }
+        txn.commit();
+    }
+
+    void set(const store_key_t &key, const std::string &value) {
+        scoped_ptr_t<txn_t> txn;
+        scoped_ptr_t<real_superblock_t> superblock;
+        get_btree_superblock_and_txn_for_writing(
+            &cache_conn, nullptr, write_access_t::write, 1, write_durability_t::SOFT,
+            &superblock, &txn);
+        profile::trace_t trace;
+        noop_value_deleter_t deleter;
+        null_key_modification_callback_t null_cb;
+        keyvalue_location_t kv_location;
+        find_keyvalue_location_for_write(
+            &sizer, superblock.get(), key.btree_key(), repli_timestamp_t::distant_past,
+            &deleter, &kv_location, &trace);
+        short_value_buffer_t buf(value);
+        kv_location.value = scoped_malloc_t<void>(
+            reinterpret_cast<char *>(buf.data()), buf.size());
+        apply_keyvalue_change(
+            &sizer, &kv_location, key.btree_key(), repli_timestamp_t::distant_past,
+            &deleter, &null_cb, delete_mode_t::REGULAR_QUERY);
+        superblock.reset();
+        txn->commit();
+    }
+
+    bool get(const store_key_t &key) {
+        scoped_ptr_t<txn_t> txn;
+        scoped_ptr_t<real_superblock_t> superblock;
+        get_btree_superblock_and_txn_for_reading(
+            &cache_conn, CACHE_SNAPSHOTTED_NO, &superblock, &txn);
+        profile::trace_t trace;
+        keyvalue_location_t kv_location;
+        find_keyvalue_location_for_read(
+            &sizer, superblock.get(), key.btree_key(), &kv_location, &stats, &trace);
+        return kv_location.value.has();
+    }
+
+    uint64_t scan() {
+        class counter_t : public depth_first_traversal_callback_t {
+        public:
+            counter_t() : count(0) { }
+            continue_bool_t handle_pair(scoped_key_value_t &&, signal_t *) {
+                ++count;
+                return continue_bool_t::CONTINUE;
+            }
+            uint64_t count;
+        } counter;
+        scoped_ptr_t<txn_t> txn;
+        scoped_ptr_t<real_superblock_t> superblock;
+        get_btree_superblock_and_txn_for_reading(
+            &cache_conn, CACHE_SNAPSHOTTED_NO, &superblock, &txn);
+        cond_t non_interruptor;
+        btree_depth_first_traversal(
+            superblock.get(), key_range_t::universe(), &counter, access_t::read,
+            direction_t::FORWARD, release_superblock_t::RELEASE, &non_interruptor);
+        return counter.count;
+    }
+
+private:
+    benchmark_serializer_t bench;
+    dummy_cache_balancer_t balancer;
+    cache_t cache;
+    cache_conn_t cache_conn;
+    short_value_sizer_t sizer;
+    btree_stats_t stats;
+};
+
+TPTEST(StorageBenchmark, DISABLED_BTreeOperations) {
+    const int num_keys = 50000;
+    benchmark_btree_t btree;
+    std::vector<store_key_t> keys;
+    for (int i = 0; i < num_keys; ++i) {
+        // Scramble the order so that inserts don't all go to the rightmost leaf.
+        keys.push_back(store_key_t(strprintf("%08d", (i * 7919) % num_keys)));
+    }
+
+    {
+        benchmark_timer_t timer("btree_point_insert");
+        for (const store_key_t &key : keys) {
+            btree.set(key, "value");
+        }
+        timer.report(keys.size());
+    }
+    {
+        benchmark_timer_t timer("btree_point_lookup");
+        for (const store_key_t &key : keys) {
+            ASSERT_TRUE(btree.get(key));
+        }
+        timer.report(keys.size());
+    }
+    {
+        const int num_scans = 10;
+        benchmark_timer_t timer("btree_range_scan_row");
+        for (int i = 0; i < num_scans; ++i) {
+            ASSERT_EQ(static_cast<uint64_t>(num_keys), btree.scan());
+        }
+        timer.report(num_scans * num_keys);
+    }
+}
+
+}  // namespace unittest
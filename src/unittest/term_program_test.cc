@@ -0,0 +1,86 @@
+// Copyright 2010-2015 RethinkDB, all rights reserved.
+#include <vector>
+
+#include "rdb_protocol/datum.hpp"
+#include "rdb_protocol/pseudo_time.hpp"
+#include "rdb_protocol/term_program.hpp"
+#include "unittest/gtest.hpp"
+
+namespace unittest {
+
+bool test_datum_lt(const ql::datum_t &lhs, const ql::datum_t &rhs) {
+    return lhs.cmp(rhs) < 0;
+}
+
+ql::datum_t test_object(double a) {
+    ql::datum_object_builder_t builder;
+    builder.overwrite("a", ql::datum_t(a));
+    return std::move(builder).to_datum();
+}
+
+TEST(TermProgramTest, FieldComparison) {
+    // function(x, y) { return x('a').lt(y, 10).and(true); }
+    const ql::sym_t x(1), y(2);
+    ql::term_program_t program(std::vector<ql::sym_t>{x, y}, false);
+    ASSERT_TRUE(program.push_var(x));
+    ASSERT_TRUE(program.push_datum(ql::datum_t("a")));
+    ASSERT_TRUE(program.get_field());
+    ASSERT_TRUE(program.push_var(y));
+    ASSERT_TRUE(program.push_datum(ql::datum_t(10.0)));
+    ASSERT_TRUE(program.compare(&test_datum_lt, false, 3));
+    ASSERT_TRUE(program.push_datum(ql::datum_t::boolean(true)));
+    ASSERT_TRUE(program.logical_and(2));
+    ASSERT_TRUE(program.is_complete());
+
+    ASSERT_EQ(ql::datum_t::boolean(true),
+              program.run({test_object(1), ql::datum_t(5.0)}));
+    ASSERT_EQ(ql::datum_t::boolean(false),
+              program.run({test_object(7), ql::datum_t(5.0)}));
+
+    // The program fails where `get_field` would throw or do something else.
+    ASSERT_FALSE(program.run({ql::datum_t::empty_object(), ql::datum_t(5.0)}).has());
+    ASSERT_FALSE(program.run({ql::datum_t(1.0), ql::datum_t(5.0)}).has());
+    ASSERT_FALSE(program.run({test_object(1)}).has());
+}
+
+TEST(TermProgramTest, PseudotypeField) {
+    // function(x) { return x('epoch_time'); }
+    const ql::sym_t x(1);
+    ql::term_program_t program(std::vector<ql::sym_t>{x}, false);
+    ASSERT_TRUE(program.push_var(x));
+    ASSERT_TRUE(program.push_datum(ql::datum_t("epoch_time")));
+    ASSERT_TRUE(program.get_field());
+    ASSERT_TRUE(program.is_complete());
+
+    // Times are objects underneath, but `bracket` rejects them.
+    ASSERT_FALSE(program.run({ql::pseudo::make_time(1.0, "+00:00")}).has());
+    ql::datum_object_builder_t builder;
+    builder.overwrite("epoch_time", ql::datum_t(1.0));
+    ASSERT_EQ(ql::datum_t(1.0), program.run({std::move(builder).to_datum()}));
+}
+
+TEST(TermProgramTest, AndOr) {
+    // r.row.or(false, r.row.not())
+    ql::term_program_t program(std::vector<ql::sym_t>{ql::sym_t(1)}, true);
+    ASSERT_TRUE(program.push_implicit_var());
+    ASSERT_TRUE(program.push_datum(ql::datum_t::boolean(false)));
+    ASSERT_TRUE(program.push_implicit_var());
+    ASSERT_TRUE(program.logical_not());
+    ASSERT_TRUE(program.logical_or(3));
+    ASSERT_TRUE(program.is_complete());
+
+    ASSERT_EQ(ql::datum_t(3.0), program.run({ql::datum_t(3.0)}));
+    ASSERT_EQ(ql::datum_t::boolean(true), program.run({ql::datum_t::null()}));
+}
+
+TEST(TermProgramTest, Unsupported) {
+    ql::term_program_t program(std::vector<ql::sym_t>{ql::sym_t(1)}, false);
+    // Variables from an enclosing scope and `r.row` that isn't the argument.
+    ASSERT_FALSE(program.push_var(ql::sym_t(2)));
+    ASSERT_FALSE(program.push_implicit_var());
+    // Not enough values on the stack.
+    ASSERT_FALSE(program.get_field());
+    ASSERT_FALSE(program.is_complete());
+}
+
+}  // namespace unittest
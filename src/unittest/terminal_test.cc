@@ -0,0 +1,111 @@
+// Copyright 2010-2015 RethinkDB, all rights reserved.
+#include <cmath>
+
+#include "rdb_protocol/shards.hpp"
+#include "rdb_protocol/val.hpp"
+#include "unittest/gtest.hpp"
+
+namespace unittest {
+
+// Runs the terminal over `batches`, each of which is one call of the accumulator.
+ql::datum_t run_terminal(const ql::terminal_variant_t &terminal,
+                         const std::vector<std::vector<ql::datum_t> > &batches) {
+    scoped_ptr_t<ql::eager_acc_t> acc = ql::make_eager_terminal(terminal);
+    for (const auto &batch : batches) {
+        ql::groups_t groups;
+        groups[ql::datum_t()] = batch;
+        (*acc)(nullptr, &groups);
+    }
+    return acc->finish_eager(ql::backtrace_id_t::empty(),
+                             false,
+                             ql::configured_limits_t::unlimited)->as_datum();
+}
+
+template<class wire_func_t>
+ql::datum_t run(const std::vector<std::vector<ql::datum_t> > &batches) {
+    return run_terminal(wire_func_t(ql::backtrace_id_t::empty()), batches);
+}
+
+// Splits `els` into batches at every position where `split_mask` has a bit set.
+std::vector<std::vector<ql::datum_t> > split_into_batches(
+        const std::vector<ql::datum_t> &els, uint32_t split_mask) {
+    std::vector<std::vector<ql::datum_t> > batches(1);
+    for (size_t i = 0; i < els.size(); ++i) {
+        if (i != 0 && (split_mask & (1u << i)) != 0) {
+            batches.emplace_back();
+        }
+        batches.back().push_back(els[i]);
+    }
+    return batches;
+}
+
+std::vector<ql::datum_t> make_nums(const std::vector<double> &nums) {
+    std::vector<ql::datum_t> res;
+    for (double num : nums) {
+        res.push_back(ql::datum_t(num));
+    }
+    return res;
+}
+
+TEST(TerminalTest, SumDoesNotDependOnBatches) {
+    const std::vector<double> nums = {1e16, 1.0, -1e16, 0.1, 3.0, 1e-8, 2.5, -0.3};
+    double expected_sum = 0;
+    for (double num : nums) {
+        expected_sum += num;
+    }
+    const double expected_avg = expected_sum / nums.size();
+    const std::vector<ql::datum_t> els = make_nums(nums);
+    for (uint32_t split_mask = 0; split_mask < (1u << nums.size()); ++split_mask) {
+        auto batches = split_into_batches(els, split_mask);
+        ASSERT_EQ(expected_sum, run<ql::sum_wire_func_t>(batches).as_num());
+        ASSERT_EQ(expected_avg, run<ql::avg_wire_func_t>(batches).as_num());
+    }
+}
+
+TEST(TerminalTest, MinMaxTies) {
+    // `0` and `-0` are equal, so the first one of them has to win.
+    const std::vector<ql::datum_t> els = make_nums({0.0, -0.0, 1.0, -0.0, 0.0});
+    for (uint32_t split_mask = 0; split_mask < (1u << els.size()); ++split_mask) {
+        auto batches = split_into_batches(els, split_mask);
+        ql::datum_t min = run<ql::min_wire_func_t>(batches);
+        ASSERT_EQ(0.0, min.as_num());
+        ASSERT_FALSE(std::signbit(min.as_num()));
+    }
+
+    const std::vector<ql::datum_t> neg_zero_first = make_nums({-0.0, 1.0, 0.0, 1.0});
+    for (uint32_t split_mask = 0; split_mask < (1u << neg_zero_first.size());
+         ++split_mask) {
+        auto batches = split_into_batches(neg_zero_first, split_mask);
+        ql::datum_t min = run<ql::min_wire_func_t>(batches);
+        ASSERT_TRUE(std::signbit(min.as_num()));
+        ql::datum_t max = run<ql::max_wire_func_t>(batches);
+        ASSERT_EQ(1.0, max.as_num());
+    }
+}
+
+TEST(TerminalTest, MinMaxMixedTypes) {
+    // Null sorts before numbers, and strings after them.
+    const std::vector<ql::datum_t> els = {
+        ql::datum_t(2.0),
+        ql::datum_t("b"),
+        ql::datum_t(-1.0),
+        ql::datum_t::null(),
+        ql::datum_t(5.0),
+        ql::datum_t("a")};
+    for (uint32_t split_mask = 0; split_mask < (1u << els.size()); ++split_mask) {
+        auto batches = split_into_batches(els, split_mask);
+        ASSERT_EQ(ql::datum_t::null(), run<ql::min_wire_func_t>(batches));
+        ASSERT_EQ(ql::datum_t("b"), run<ql::max_wire_func_t>(batches));
+    }
+
+    const std::vector<ql::datum_t> nums_and_strings = {
+        ql::datum_t(2.0), ql::datum_t("a"), ql::datum_t(-1.0), ql::datum_t(7.0)};
+    for (uint32_t split_mask = 0; split_mask < (1u << nums_and_strings.size());
+         ++split_mask) {
+        auto batches = split_into_batches(nums_and_strings, split_mask);
+        ASSERT_EQ(ql::datum_t(-1.0), run<ql::min_wire_func_t>(batches));
+        ASSERT_EQ(ql::datum_t("a"), run<ql::max_wire_func_t>(batches));
+    }
+}
+
+}  // namespace unittest
@@ -1,6 +1,7 @@
 // Copyright 2010-2014 RethinkDB, all rights reserved.
 #include <algorithm>
 
+#include "arch/runtime/starter.hpp"
 #include "arch/timing.hpp"
 #include "concurrency/pmap.hpp"
 #include "unittest/gtest.hpp"
@@ -58,6 +59,17 @@ TPTEST(TimerTest, TestApproximateWaitTimes) {
         << "Average timer error too high";
 }
 
+TEST(TimerTest, TestTimerWheelWaitTimes) {
+    set_use_timer_wheel(true);
+    run_in_thread_pool([&]() {
+        uint64_t mse = 0;
+        walk_wait_times(0, &mse);
+        EXPECT_LT(sqrt(mse) / MILLION, max_average_error_ms + 1)
+            << "Average timer error too high";
+    });
+    set_use_timer_wheel(false);
+}
+
 TPTEST(TimerTest, TestRepeatingTimer) {
     int64_t first_ticks = get_ticks().nanos;
     int count = 0;
@@ -0,0 +1,89 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#include <map>
+#include <vector>
+
+#include "containers/scoped.hpp"
+#include "containers/timer_wheel.hpp"
+#include "random.hpp"
+#include "unittest/gtest.hpp"
+
+namespace unittest {
+
+struct test_timer_t : public timer_wheel_node_t<test_timer_t> {
+    explicit test_timer_t(int64_t _due) : due(_due), in_wheel(true) { }
+    int64_t due;
+    bool in_wheel;
+};
+
+// Advances the wheel to `tick` and checks that exactly the timers that are due expire.
+void advance_and_check(timer_wheel_t<test_timer_t> *wheel, int64_t tick,
+                       const std::vector<scoped_ptr_t<test_timer_t> > &timers) {
+    wheel->advance(tick);
+    while (test_timer_t *timer = wheel->pop_expired()) {
+        ASSERT_TRUE(timer->in_wheel);
+        ASSERT_LE(timer->due, tick);
+        timer->in_wheel = false;
+    }
+    for (const auto &timer : timers) {
+        ASSERT_TRUE(!timer->in_wheel || timer->due > tick);
+    }
+}
+
+TEST(TimerWheelTest, ExpiresOnTime) {
+    timer_wheel_t<test_timer_t> wheel(1000);
+    std::vector<scoped_ptr_t<test_timer_t> > timers;
+    // Distances that end up on each of the levels, and around their boundaries.
+    for (int64_t distance : {1, 2, 255, 256, 257, 1000, 65535, 65536, 65537,
+                             100000, 16777216, 20000000}) {
+        timers.push_back(make_scoped<test_timer_t>(1000 + distance));
+        wheel.add(timers.back().get(), timers.back()->due);
+    }
+    ASSERT_EQ(timers.size(), wheel.size());
+
+    while (!wheel.empty()) {
+        const int64_t next = wheel.next_interesting_tick();
+        ASSERT_LT(wheel.current_tick(), next);
+        for (const auto &timer : timers) {
+            ASSERT_TRUE(!timer->in_wheel || timer->due >= next);
+        }
+        advance_and_check(&wheel, next, timers);
+    }
+}
+
+TEST(TimerWheelTest, RandomAddsAndRemoves) {
+    rng_t rng(12345);
+    timer_wheel_t<test_timer_t> wheel(0);
+    std::vector<scoped_ptr_t<test_timer_t> > timers;
+    int64_t tick = 0;
+    for (int i = 0; i < 20000; ++i) {
+        const int action = rng.randint(10);
+        if (action < 5) {
+            const int64_t distance = rng.randint(3) == 0
+                ? rng.randint(100000)
+                : rng.randint(300);
+            timers.push_back(make_scoped<test_timer_t>(tick + 1 + distance));
+            wheel.add(timers.back().get(), timers.back()->due);
+        } else if (action < 7 && !timers.empty()) {
+            test_timer_t *timer = timers[rng.randint(timers.size())].get();
+            if (timer->in_wheel) {
+                wheel.remove(timer);
+                timer->in_wheel = false;
+            }
+        } else {
+            tick += rng.randint(action == 9 ? 5000 : 20);
+            advance_and_check(&wheel, tick, timers);
+        }
+    }
+
+    size_t in_wheel = 0;
+    for (const auto &timer : timers) {
+        if (timer->in_wheel) {
+            ++in_wheel;
+        }
+    }
+    ASSERT_EQ(in_wheel, wheel.size());
+    advance_and_check(&wheel, tick + 200000, timers);
+    ASSERT_TRUE(wheel.empty());
+}
+
+}  // namespace unittest
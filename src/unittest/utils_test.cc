@@ -120,6 +120,27 @@ TEST(BtreeUtilsTest, SizedStrcmp) {
     ASSERT_NE(0, sized_strcmp(test3, 11, test1, 14));
 }
 
+TEST(BtreeUtilsTest, KeyPrefixWordCmp) {
+    // Keys that differ in, right after or well beyond their first eight bytes, and
+    // keys that only differ in trailing zero bytes.
+    const std::string strs[] = {
+        "", std::string(1, '\0'), "a", std::string("a\0", 2), "a\x01", "abcdefg",
+        "abcdefgh", std::string("abcdefgh\0", 9), "abcdefgi", "abcdefghijklmnop",
+        "abcdefghijklmnoq", "\xff\xff\xff\xff\xff\xff\xff\xff\xff" };
+    for (const std::string &l : strs) {
+        store_key_t left(l);
+        const uint64_t word = key_prefix_word(left.contents(), left.size());
+        for (const std::string &r : strs) {
+            store_key_t right(r);
+            int expected = btree_key_cmp(left.btree_key(), right.btree_key());
+            int actual = key_prefix_word_cmp(word, left.contents(), left.size(),
+                                             right.btree_key());
+            EXPECT_EQ(expected < 0, actual < 0) << l << " vs " << r;
+            EXPECT_EQ(expected == 0, actual == 0) << l << " vs " << r;
+        }
+    }
+}
+
 /* This doesn't quite belong in `utils_test.cc`, but I don't want to create a
 new file just for it. */
 
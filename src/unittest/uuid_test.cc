@@ -3,8 +3,12 @@
 #include <arpa/inet.h>
 #endif
 
+#include <set>
+#include <vector>
+
 #include "containers/uuid.hpp"
 #include "unittest/gtest.hpp"
+#include "unittest/unittest_utils.hpp"
 
 // We keep the sha1 function hidden to avoid encouraging others from using it.
 namespace sha1 {
@@ -63,6 +67,23 @@ TEST(UuidTest, StrToUuid) {
     ASSERT_FALSE(failure);
 }
 
+TPTEST(UuidTest, GenerateUuids) {
+    std::vector<uuid_u> uuids(1000);
+    generate_uuids(uuids.data(), uuids.size());
+    uuids.push_back(generate_uuid());
+    std::set<uuid_u> distinct(uuids.begin(), uuids.end());
+    EXPECT_EQ(uuids.size(), distinct.size());
+    for (const uuid_u &u : uuids) {
+        std::string s = uuid_to_str(u);
+        // These are version 4 UUIDs.
+        EXPECT_EQ('4', s[14]);
+        EXPECT_NE(std::string::npos, std::string("89ab").find(s[19]));
+        uuid_u parsed;
+        ASSERT_TRUE(str_to_uuid(s, &parsed));
+        EXPECT_EQ(u, parsed);
+    }
+}
+
 void check_sha(const std::string &str, uint32_t expected[5]) {
     union {
         uint8_t hash[24];
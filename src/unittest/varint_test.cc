@@ -1,8 +1,10 @@
 // Copyright 2010-2014 RethinkDB, all rights reserved.
 #include <inttypes.h>
 
+#include "containers/archive/buffer_stream.hpp"
 #include "containers/archive/string_stream.hpp"
 #include "containers/archive/varint.hpp"
+#include "containers/archive/vector_stream.hpp"
 #include "unittest/gtest.hpp"
 #include "utils.hpp"
 
@@ -44,6 +46,49 @@ TEST(VarintTest, Success64) {
     }
 }
 
+// Streams over a buffer in memory decode varints straight out of the buffer, except
+// within ten bytes of its end.
+TEST(VarintTest, DirectStream) {
+    std::vector<uint64_t> vals;
+    for (int shift = 0; shift < 64; ++shift) {
+        vals.push_back(uint64_t(1) << shift);
+        vals.push_back((uint64_t(1) << shift) - 1);
+    }
+    vals.push_back(UINT64_MAX);
+
+    write_message_t wm;
+    for (uint64_t value : vals) {
+        serialize_varint_uint64(&wm, value);
+    }
+    vector_stream_t write_stream;
+    ASSERT_EQ(0, send_write_message(&write_stream, &wm));
+    std::vector<char> data;
+    write_stream.swap(&data);
+
+    vector_read_stream_t read_stream(std::move(data));
+    for (uint64_t value : vals) {
+        SCOPED_TRACE("value = " + strprintf("%" PRIu64, value));
+        uint64_t output_value;
+        ASSERT_EQ(archive_result_t::SUCCESS,
+                  deserialize_varint_uint64(&read_stream, &output_value));
+        EXPECT_EQ(value, output_value);
+    }
+    EXPECT_EQ(0, read_stream.direct_bytes_left());
+
+    // An overflowing 10-byte and an 11-byte varint, with enough bytes after them,
+    // so they're decoded out of the buffer.
+    std::string overflow(9, -128);
+    overflow += std::string(1, 2) + std::string(10, 0);
+    std::string too_long(10, -128);
+    too_long += std::string(1, 1) + std::string(10, 0);
+    for (const std::string &s : { overflow, too_long }) {
+        buffer_read_stream_t buffer_stream(s.data(), s.size());
+        uint64_t output_value;
+        EXPECT_EQ(archive_result_t::RANGE_ERROR,
+                  deserialize_varint_uint64(&buffer_stream, &output_value));
+    }
+}
+
 TEST(VarintTest, RangeError) {
     // First we test 1 + UINT64_MAX / 2, to make sure it works.
     std::string s;
@@ -0,0 +1,38 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#include "arch/runtime/coroutines.hpp"
+#include "concurrency/cond_var.hpp"
+#include "concurrency/interruptor.hpp"
+#include "concurrency/wait_any.hpp"
+#include "unittest/gtest.hpp"
+#include "unittest/unittest_utils.hpp"
+
+namespace unittest {
+
+TPTEST(WaitInterruptibleTest, AlreadyPulsed) {
+    cond_t signal, interruptor;
+    signal.pulse();
+    {
+        ASSERT_NO_CORO_WAITING;
+        wait_interruptible(&signal, &interruptor);
+    }
+    interruptor.pulse();
+    EXPECT_THROW(wait_interruptible(&signal, &interruptor), interrupted_exc_t);
+
+    cond_t unpulsed;
+    wait_any_t waiter(&unpulsed, &signal);
+    EXPECT_TRUE(waiter.is_pulsed());
+}
+
+TPTEST(WaitInterruptibleTest, PulsedLater) {
+    cond_t signal, interruptor;
+    coro_t::spawn_sometime([&]() { signal.pulse(); });
+    wait_interruptible(&signal, &interruptor);
+    EXPECT_TRUE(signal.is_pulsed());
+
+    cond_t other_signal, other_interruptor;
+    coro_t::spawn_sometime([&]() { other_interruptor.pulse(); });
+    EXPECT_THROW(wait_interruptible(&other_signal, &other_interruptor),
+                 interrupted_exc_t);
+}
+
+}  // namespace unittest
@@ -0,0 +1,356 @@
+#!/usr/bin/env python
+# Copyright 2010-2016 RethinkDB, all rights reserved.
+
+'''Runs YCSB-style workloads, changefeed fan-out, secondary index queries and bulk
+inserts against a server with several concurrent clients. Throughput is printed
+every few seconds while a workload runs, and the latencies of every operation are
+saved in results/ in the same format as test.py, so that compare.py can compare
+runs.'''
+
+from __future__ import print_function
+
+import argparse
+import json
+import math
+import os
+import random
+import subprocess
+import sys
+import threading
+import time
+
+from util import compare
+
+sys.path.append(os.path.abspath(os.path.join(os.path.dirname(__file__), os.path.pardir, 'common')))
+import driver, utils
+
+r = utils.import_python_driver()
+
+try:
+    xrange
+except NameError:
+    xrange = range
+
+db_name = 'bench'
+table_name = 'usertable'
+num_fields = 10
+field_length = 100
+
+# The YCSB core workloads. "read", "update", "insert", "scan" and "rmw" are the
+# proportions of the operations; keys are chosen with "distribution".
+ycsb_workloads = {
+    'a': {'read': 0.5, 'update': 0.5, 'distribution': 'zipfian'},
+    'b': {'read': 0.95, 'update': 0.05, 'distribution': 'zipfian'},
+    'c': {'read': 1.0, 'distribution': 'zipfian'},
+    'd': {'read': 0.95, 'insert': 0.05, 'distribution': 'latest'},
+    'e': {'scan': 0.95, 'insert': 0.05, 'distribution': 'zipfian'},
+    'f': {'read': 0.5, 'rmw': 0.5, 'distribution': 'zipfian'}
+}
+
+class ZipfianGenerator(object):
+    '''Picks integers in [0, n) with a Zipfian distribution, using the method from
+    Gray et al., "Quickly Generating Billion-Record Synthetic Databases", like YCSB
+    does. Popular items are scattered over the key space by hashing.'''
+
+    def __init__(self, n, theta=0.99):
+        self.n = n
+        self.theta = theta
+        zetan = sum(1.0 / (i ** theta) for i in xrange(1, n + 1))
+        zeta2 = 1 + 0.5 ** theta
+        self.alpha = 1.0 / (1.0 - theta)
+        self.zetan = zetan
+        self.eta = (1 - (2.0 / n) ** (1 - theta)) / (1 - zeta2 / zetan)
+
+    def next(self, rng):
+        u = rng.random()
+        uz = u * self.zetan
+        if uz < 1:
+            rank = 0
+        elif uz < 1 + 0.5 ** self.theta:
+            rank = 1
+        else:
+            rank = int(self.n * ((self.eta * u - self.eta + 1) ** self.alpha))
+        return hash(str(rank)) % self.n
+
+class KeySpace(object):
+    '''Hands out the keys for inserts, and keeps track of how many there are.'''
+
+    def __init__(self, count):
+        self.count = count
+        self.lock = threading.Lock()
+
+    def next_insert(self):
+        with self.lock:
+            key = self.count
+            self.count += 1
+            return key
+
+def make_doc(key):
+    doc = {'id': key, 'ts': time.time()}
+    for f in xrange(num_fields):
+        doc['field%d' % f] = ('%d-%d-' % (key, f)).ljust(field_length, 'x')
+    # Used by the secondary index queries
+    doc['group'] = key % 1000
+    return doc
+
+class Recorder(object):
+    '''Collects the latencies of an operation from all the clients.'''
+
+    def __init__(self):
+        self.lock = threading.Lock()
+        self.durations = {}
+        self.ops_since_report = 0
+
+    def record(self, op, duration):
+        with self.lock:
+            self.durations.setdefault(op, []).append(duration)
+            self.ops_since_report += 1
+
+    def take_ops_since_report(self):
+        with self.lock:
+            ops = self.ops_since_report
+            self.ops_since_report = 0
+            return ops
+
+def summarize(durations, total_time):
+    durations = sorted(durations)
+    def centile(fraction):
+        return durations[min(len(durations) - 1, int(math.floor(len(durations) * fraction)))]
+    return {
+        # As in test.py, "average" is the time per operation over the whole run.
+        "average": total_time / len(durations),
+        "min": durations[0],
+        "max": durations[-1],
+        "first_centile": centile(0.01),
+        "last_centile": centile(0.99),
+        "p50": centile(0.5),
+        "p99": centile(0.99),
+        "p999": centile(0.999),
+        "ops": len(durations)
+    }
+
+def run_clients(name, options, client_fn, results):
+    '''Runs `client_fn(conn, rng, recorder, stop_time)` on `options.clients` threads
+    and reports throughput every `options.report_interval` seconds.'''
+    recorder = Recorder()
+    start = time.time()
+    stop_time = start + options.duration
+    threads = []
+    for i in xrange(options.clients):
+        conn = r.connect(host=options.host, port=options.port, db=db_name)
+        rng = random.Random(i)
+        thread = threading.Thread(target=client_fn, args=(conn, rng, recorder, stop_time))
+        thread.daemon = True
+        thread.start()
+        threads.append(thread)
+
+    last_report = start
+    while any(thread.is_alive() for thread in threads):
+        time.sleep(min(options.report_interval, max(0, stop_time - time.time()) + 0.1))
+        now = time.time()
+        ops = recorder.take_ops_since_report()
+        print("[%6.1fs] %s: %.1f ops/s" % (now - start, name, ops / (now - last_report)))
+        sys.stdout.flush()
+        last_report = now
+    for thread in threads:
+        thread.join()
+
+    total_time = time.time() - start
+    for op, durations in recorder.durations.items():
+        results[name + "-" + op] = summarize(durations, total_time)
+
+def load_table(conn, options):
+    print("Loading %d documents..." % options.records, end=' ')
+    sys.stdout.flush()
+    if db_name in r.db_list().run(conn):
+        r.db_drop(db_name).run(conn)
+    r.db_create(db_name).run(conn)
+    r.db(db_name).table_create(table_name).run(conn)
+    r.db(db_name).table(table_name).index_create('group').run(conn)
+    r.db(db_name).table(table_name).index_wait().run(conn)
+    for start in xrange(0, options.records, options.batch_size):
+        docs = [make_doc(key) for key in xrange(start, min(options.records, start + options.batch_size))]
+        r.db(db_name).table(table_name).insert(docs, durability='soft').run(conn)
+    print("Done.")
+    sys.stdout.flush()
+
+def ycsb_client(workload, key_space, options):
+    table = r.table(table_name)
+    zipfian = ZipfianGenerator(options.records)
+
+    def choose_key(rng):
+        if workload['distribution'] == 'latest':
+            # Recently inserted keys are the most popular
+            return max(0, key_space.count - 1 - zipfian.next(rng) % key_space.count)
+        return zipfian.next(rng) % key_space.count
+
+    ops = [(op, workload[op]) for op in ['read', 'update', 'insert', 'scan', 'rmw'] if op in workload]
+
+    def client(conn, rng, recorder, stop_time):
+        while time.time() < stop_time:
+            choice = rng.random()
+            for op, proportion in ops:
+                if choice < proportion:
+                    break
+                choice -= proportion
+            start = time.time()
+            if op == 'read':
+                table.get(choose_key(rng)).run(conn)
+            elif op == 'update':
+                field = 'field%d' % rng.randint(0, num_fields - 1)
+                table.get(choose_key(rng)).update({field: 'u' * field_length}).run(conn)
+            elif op == 'insert':
+                table.insert(make_doc(key_space.next_insert())).run(conn)
+            elif op == 'scan':
+                key = choose_key(rng)
+                list(table.between(key, r.maxval).limit(rng.randint(1, options.max_scan_length)).run(conn))
+            elif op == 'rmw':
+                key = choose_key(rng)
+                doc = table.get(key).run(conn)
+                table.get(key).update({'field0': (doc or {}).get('field1', '')}).run(conn)
+            recorder.record(op, time.time() - start)
+    return client
+
+def sindex_client(key_space, options):
+    table = r.table(table_name)
+
+    def client(conn, rng, recorder, stop_time):
+        while time.time() < stop_time:
+            group = rng.randint(0, 999)
+            start = time.time()
+            list(table.get_all(group, index='group').run(conn))
+            recorder.record('get_all', time.time() - start)
+            start = time.time()
+            list(table.between(group, group + 10, index='group').limit(100).run(conn))
+            recorder.record('between', time.time() - start)
+    return client
+
+def bulk_insert_client(key_space, options):
+    table = r.table(table_name)
+
+    def client(conn, rng, recorder, stop_time):
+        while time.time() < stop_time:
+            docs = [make_doc(key_space.next_insert()) for i in xrange(options.batch_size)]
+            start = time.time()
+            table.insert(docs).run(conn)
+            recorder.record('batch', time.time() - start)
+    return client
+
+def run_changefeeds(options, key_space, results):
+    '''Opens `options.changefeeds` changefeeds on the table while the clients update
+    documents, and records how long each change takes to reach every feed.'''
+    recorder = Recorder()
+    stop_time = time.time() + options.duration
+    ready = threading.Semaphore(0)
+
+    def subscriber():
+        conn = r.connect(host=options.host, port=options.port, db=db_name)
+        feed = r.table(table_name).changes().run(conn)
+        ready.release()
+        for change in feed:
+            if change.get('new_val') is not None and 'ts' in change['new_val']:
+                recorder.record('delivery', time.time() - change['new_val']['ts'])
+            if time.time() >= stop_time:
+                break
+        conn.close(noreply_wait=False)
+
+    subscribers = [threading.Thread(target=subscriber) for i in xrange(options.changefeeds)]
+    for thread in subscribers:
+        thread.daemon = True
+        thread.start()
+    for thread in subscribers:
+        ready.acquire()
+
+    def writer(conn, rng, recorder_, stop_time_):
+        while time.time() < stop_time_:
+            key = rng.randint(0, key_space.count - 1)
+            start = time.time()
+            r.table(table_name).get(key).update({'ts': time.time()}).run(conn)
+            recorder_.record('update', time.time() - start)
+
+    run_clients("changefeed-fanout-%d" % options.changefeeds, options, writer, results)
+    for thread in subscribers:
+        thread.join(options.report_interval)
+
+    if 'delivery' in recorder.durations:
+        results["changefeed-fanout-%d-delivery" % options.changefeeds] = \
+            summarize(recorder.durations['delivery'], options.duration)
+
+def save_results(results):
+    '''Saves the results like test.py does, and compares them with the previous
+    results of this script.'''
+    commit = subprocess.Popen(['git', 'log', '-n 1', '--pretty=format:"%H"'], stdout=subprocess.PIPE).communicate()[0]
+    results["hash"] = commit
+
+    if not os.path.exists("results"):
+        os.makedirs("results")
+    str_date = time.strftime("%y.%m.%d-%H:%M:%S")
+    f = open("results/workload_" + str_date + ".txt", "w")
+    f.write(json.dumps(results, indent=2))
+    f.close()
+    print("Results saved in results/workload_" + str_date + ".txt")
+
+    previous = sorted(name for name in os.listdir("results") if name.startswith("workload_"))
+    previous_results = {}
+    if len(previous) > 1:
+        f = open(os.path.join("results", previous[-2]), "r")
+        previous_results = json.loads(f.read())
+        f.close()
+    compare(results, previous_results)
+
+def run(options):
+    conn = r.connect(host=options.host, port=options.port)
+    load_table(conn, options)
+    key_space = KeySpace(options.records)
+    results = {}
+
+    for name in options.workloads.split(','):
+        name = name.strip().lower()
+        if name in ycsb_workloads:
+            run_clients("ycsb-" + name, options,
+                        ycsb_client(ycsb_workloads[name], key_space, options), results)
+        elif name == 'sindex':
+            run_clients("sindex", options, sindex_client(key_space, options), results)
+        elif name == 'bulk':
+            run_clients("bulk-insert-%d" % options.batch_size, options,
+                        bulk_insert_client(key_space, options), results)
+        elif name == 'changefeed':
+            run_changefeeds(options, key_space, results)
+        else:
+            raise ValueError('Unknown workload: %s' % name)
+
+    save_results(results)
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument('--workloads', default='a,b,c,d,e,f,sindex,bulk,changefeed',
+                        help='comma separated list of YCSB workloads (a-f), "sindex", "bulk" and "changefeed"')
+    parser.add_argument('--records', type=int, default=100000, help='number of documents to load')
+    parser.add_argument('--clients', type=int, default=16, help='number of concurrent connections')
+    parser.add_argument('--duration', type=float, default=60, help='seconds per workload')
+    parser.add_argument('--report-interval', type=float, default=5, help='seconds between throughput reports')
+    parser.add_argument('--batch-size', type=int, default=500, help='documents per bulk insert')
+    parser.add_argument('--max-scan-length', type=int, default=100, help='longest scan in workload e')
+    parser.add_argument('--changefeeds', type=int, default=100, help='number of changefeeds for the fan-out workload')
+    parser.add_argument('--host', default=None, help='use a running server instead of starting one')
+    parser.add_argument('--port', type=int, default=28015)
+    parser.add_argument('--build', default=None, help='build directory of the server to start')
+    parser.add_argument('--data-dir', default='./', help='where to put the files of the server')
+    parser.add_argument('--cache-size', type=int, default=1024, help='cache size in MB of the server')
+    options = parser.parse_args()
+
+    if options.host is not None:
+        run(options)
+        return
+
+    executable_path = utils.find_rethinkdb_executable() if options.build is None else os.path.realpath(os.path.join(options.build, 'rethinkdb'))
+    if not os.path.basename(os.path.dirname(executable_path)).startswith('release'):
+        sys.stderr.write('Warning: Testing a non-release build: %s\n' % executable_path)
+    with driver.Process(name=os.path.join(options.data_dir, 'workload'), executable_path=executable_path,
+                        extra_options=['--cache-size', str(options.cache_size)]) as server:
+        options.host = 'localhost'
+        options.port = server.driver_port
+        run(options)
+
+if __name__ == "__main__":
+    main()